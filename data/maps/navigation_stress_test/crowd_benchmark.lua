@@ -0,0 +1,35 @@
+-- attach to an entity inside a navmesh zone of navigation_stress_test, spawns `agent_count` agents
+-- walking to random points and logs average frame time, see "dtCrowd::update" in profiler for the crowd itself
+agent_count = 2000 -- crowds are created with 2000 agent slots
+spacing = 1.5
+range = 100
+
+local frames = 0
+local time = 0
+
+function start()
+	local side = math.ceil(math.sqrt(agent_count))
+	local origin = this.position
+	for i = 0, agent_count - 1 do
+		local x = (i % side - side * 0.5) * spacing
+		local z = (math.floor(i / side) - side * 0.5) * spacing
+		local e : Entity = this.world:createEntityEx {
+			position = { origin[1] + x, origin[2], origin[3] + z },
+			navmesh_agent = {},
+			lua_script = {}
+		}
+		e.lua_script.scripts.add()
+		e.lua_script.scripts[1].path = "maps/navigation_stress_test/crowd_benchmark_agent.lua"
+		e.lua_script[1].range = range
+	end
+end
+
+function update(time_delta)
+	frames = frames + 1
+	time = time + time_delta
+	if time > 5 then
+		LumixAPI.logInfo(`{agent_count} agents: {time / frames * 1000} ms per frame`)
+		frames = 0
+		time = 0
+	end
+end
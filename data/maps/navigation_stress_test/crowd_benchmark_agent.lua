@@ -0,0 +1,18 @@
+range = range or 100
+
+function goToRandomPoint()
+	local dst = {
+		math.random(-range, range), 
+		0, 
+		math.random(-range, range)
+	}
+	this.navmesh_agent:navigate(dst, math.random(2, 5), 0.5)
+end
+
+function start()
+	goToRandomPoint()
+end
+
+function onPathFinished()
+	goToRandomPoint()
+end
@@ -289,6 +289,9 @@ type navmesh_zone_component =  {
 	drawContours: (navmesh_zone_component) -> (),
 	generateNavmesh: (navmesh_zone_component) -> any,
 	saveZone: (navmesh_zone_component) -> boolean,
+	addBoxObstacle: (navmesh_zone_component, DVec3, Vec3) -> number,
+	addCylinderObstacle: (navmesh_zone_component, DVec3, number, number) -> number,
+	removeObstacle: (navmesh_zone_component, number) -> (),
 }
 
 type navmesh_agent_component =  {
@@ -530,6 +533,8 @@ type bone_attachment_component =  {
 type particle_emitter_component =  {
 	path: string,
 	autodestroy: boolean,
+	update_policy: number,
+	throttle_distance: number,
 }
 
 type instanced_model_component =  {
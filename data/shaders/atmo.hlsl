@@ -27,6 +27,12 @@ cbuffer Data : register (b4) {
 	TextureHandle u_optical_depth;
 	TextureHandle u_depth_buffer;
 	TextureHandle u_inscatter;
+	uint u_downscale;
+	float u_depth_diff_weight;
+	TextureHandle u_depth_buffer_small; // downscaled, if available
+	RWTextureHandle u_transmittance; // if u_downscale > 0, we write atmo to u_output and scene transmittance here
+	TextureHandle u_atmo_small; // UPSAMPLE input
+	TextureHandle u_transmittance_small; // UPSAMPLE input
 };
 
 // mie - Schlick appoximation phase function of Henyey-Greenstein
@@ -328,15 +334,34 @@ Cloud cloud(float2 screen_uv) {
 	return result;
 }
 
+#ifdef UPSAMPLE
+// composite downscaled atmo into full resolution u_output
+[numthreads(16, 16, 1)]
+void main(uint3 thread_id : SV_DispatchThreadID) {
+	UpsampleWeights w = getDepthAwareUpsampleWeights(thread_id.xy, u_downscale, u_depth_buffer, u_depth_buffer_small, u_depth_diff_weight);
+	float4 atmo = depthAwareUpsample(u_atmo_small, w);
+	float4 scene = depthAwareUpsample(u_transmittance_small, w);
+	if (u_downscale > 0) {
+		bindless_rw_textures[u_output][thread_id.xy] = atmo;
+		bindless_rw_textures[u_transmittance][thread_id.xy] = scene;
+		return;
+	}
+
+	bindless_rw_textures[u_output][thread_id.xy] = atmo + bindless_rw_textures[u_output][thread_id.xy] * scene;
+}
+#endif
+#else
 [numthreads(16, 16, 1)]
 void main(uint3 thread_id : SV_DispatchThreadID) {
 	float4 atmo;
 	float4 scene = 1;
 	atmo.a = 1;
 	
+	// full resolution texel, we pick the same one as ssao_downscale_depth.hlsl
+	const uint2 frag_coord = thread_id.xy << u_downscale;
 	float3 sunlight = u_sunlight.rgb * u_sunlight.a;
-	float ndc_depth = bindless_textures[u_depth_buffer][thread_id.xy].r;
-	float2 uv = thread_id.xy * Global_rcp_framebuffer_size;
+	float ndc_depth = bindless_textures[u_depth_buffer][frag_coord].r;
+	float2 uv = frag_coord * Global_rcp_framebuffer_size;
 	float3 eyedir = getViewDirection(uv);
 	const float cos_theta = dot(eyedir, Global_light_dir.xyz);
 
@@ -11,7 +11,7 @@ cbuffer Data : register(b4) {
 	float4 u_scatter_mie;
 	float4 u_absorb_mie;
 	float4 u_sunlight;
-	float4 u_resolution;
+	float4 u_resolution; // w = first row, LUT can be updated over several frames
 	float4 u_fog_scattering;
 	float u_fog_top;
 	float u_fog_enabled;
@@ -32,7 +32,8 @@ float4 sampleOpticalDepth(float3 dir, float3 up, float height) {
 }
 
 [numthreads(16, 16, 1)]
-void main(uint3 thread_id : SV_DispatchThreadID) {
+void main(uint3 dispatch_id : SV_DispatchThreadID) {
+	const uint3 thread_id = dispatch_id + uint3(0, uint(u_resolution.w), 0);
 	const float3 extinction_rayleigh = u_scatter_rayleigh.rgb;
 	const float3 extinction_mie = u_scatter_mie.rgb + 4.4e-6;
 
@@ -87,6 +87,8 @@ struct Cluster {
 	int lights_count;
 	int env_probes_count;
 	int refl_probes_count;
+	// only decals using shaders/decal.hlsl
+	int decals_count;
 };
 
 struct Surface {
@@ -774,3 +776,46 @@ bool ditherLOD(float lod, float2 frag_coord){
 	float ret = lod < 0.0 ? step(s, lod + 1.0) : step(lod, s);
 	return ret < 1e-3;
 }
+
+// bilinear weights of 4 texels in downscaled buffer, adjusted by depth differences to avoid bleeding over depth discontinuities
+struct UpsampleWeights {
+	uint2 xy;
+	float4 w; // (0, 0), (1, 0), (0, 1), (1, 1)
+};
+
+// depth_buffer_small is created by ssao_downscale_depth.hlsl, it does not contain 0
+UpsampleWeights getDepthAwareUpsampleWeights(uint2 frag_coord, uint downscale, uint depth_buffer, uint depth_buffer_small, float depth_diff_weight) {
+	UpsampleWeights res;
+	uint downscale_mask = (1 << downscale) - 1;
+	uint step = 1 << downscale;
+	uint2 ij = frag_coord & ~downscale_mask;
+	res.xy = frag_coord >> downscale;
+
+	// sky/background has depth == 0, we use small value instead to avoid division by 0
+	float d = 1 / max(10e-30, bindless_textures[depth_buffer][frag_coord].r);
+	float4 ds = float4(
+		bindless_textures[depth_buffer_small][res.xy + uint2(0, 0)].r,
+		bindless_textures[depth_buffer_small][res.xy + uint2(1, 0)].r,
+		bindless_textures[depth_buffer_small][res.xy + uint2(0, 1)].r,
+		bindless_textures[depth_buffer_small][res.xy + uint2(1, 1)].r
+	);
+	ds = 1 / ds;
+
+	// coefs for bilinear filtering
+	float2 uv = float2(frag_coord - ij) / (step - 1);
+	float4 r = float4((1 - uv.x) * (1 - uv.y), uv.x * (1 - uv.y), (1 - uv.x) * uv.y, uv.x * uv.y);
+
+	// depth difference added to bilinear coefs to fixed artifacts at depth discontinuities
+	res.w = saturate(r - saturate(r * abs(d - ds) * depth_diff_weight));
+	float sum_w = dot(res.w, 1);
+	// our depth is not close to any from the four sampled depths, just use the first one
+	res.w = sum_w < 10e-6 ? float4(1, 0, 0, 0) : res.w / sum_w;
+	return res;
+}
+
+float4 depthAwareUpsample(uint tex, UpsampleWeights weights) {
+	return bindless_textures[tex][weights.xy + uint2(0, 0)] * weights.w.x
+		+ bindless_textures[tex][weights.xy + uint2(1, 0)] * weights.w.y
+		+ bindless_textures[tex][weights.xy + uint2(0, 1)] * weights.w.z
+		+ bindless_textures[tex][weights.xy + uint2(1, 1)] * weights.w.w;
+}
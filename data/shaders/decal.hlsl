@@ -4,6 +4,74 @@
 
 #include "shaders/common.hlsli"
 
+#ifdef CLUSTERED
+// decals using this shader are binned to light clusters and applied in one fullscreen pass, see PipelineImpl::fillClusters
+struct ClusterDecal {
+	float3 pos;
+	uint material_index;
+	float4 rot;
+	float3 half_extents;
+	float pad0;
+	float2 uv_scale;
+	float2 pad1;
+};
+
+StructuredBuffer<ClusterDecal> b_decals : register(t6);
+
+cbuffer DC : register(b4) {
+	TextureHandle u_gbuffer_depth;
+};
+
+struct VSOutput {
+	float2 uv : TEXCOORD0;
+	float4 position : SV_POSITION;
+};
+
+VSOutput mainVS(uint vertexID : SV_VertexID) {
+	VSOutput output;
+	output.position = fullscreenQuad(vertexID, output.uv);
+	return output;
+}
+
+GBufferOutput mainPS(VSOutput input) {
+	float ndc_depth;
+	float3 pos_ws = getPositionWS(u_gbuffer_depth, input.uv, ndc_depth);
+	// decals are sampled in divergent flow, so derivatives are computed here
+	float3 pos_ws_dx = ddx(pos_ws);
+	float3 pos_ws_dy = ddy(pos_ws);
+	Cluster cluster = getCluster(ndc_depth, input.position.xy);
+	int from = cluster.offset + cluster.lights_count + cluster.env_probes_count + cluster.refl_probes_count;
+	int to = from + cluster.decals_count;
+
+	// decals are composited here, result is blended the same way as a single decal
+	float3 premultiplied = 0;
+	float alpha = 0;
+	for (int i = from; i < to; ++i) {
+		ClusterDecal decal = b_decals[b_cluster_map[i]];
+		float3 pos_ls = rotateByQuat(decal.rot, pos_ws - decal.pos);
+		if (any(abs(pos_ls) > decal.half_extents)) continue;
+
+		MaterialData material = getMaterialData(decal.material_index);
+		float2 uv_mul = 0.5 / decal.half_extents.xz * decal.uv_scale;
+		float2 uv = pos_ls.xz * uv_mul + 0.5 * decal.uv_scale;
+		float2 uv_dx = rotateByQuat(decal.rot, pos_ws_dx).xz * uv_mul;
+		float2 uv_dy = rotateByQuat(decal.rot, pos_ws_dy).xz * uv_mul;
+		float4 color = bindless_textures[material.t_texture].SampleGrad(LinearSampler, uv, uv_dx, uv_dy);
+		color.rgb *= material.u_material_color.rgb;
+		premultiplied = premultiplied * (1 - color.a) + color.rgb * color.a;
+		alpha = alpha + color.a * (1 - alpha);
+	}
+	if (alpha < 1e-3) discard;
+
+	GBufferOutput output;
+	output.gbuffer0 = float4(premultiplied / alpha, alpha);
+	output.gbuffer1 = float4(0, 0, 0, 0);
+	output.gbuffer2 = float4(0, 0, 0, 0);
+	output.gbuffer3 = float4(0, 0, 0, 0);
+	return output;
+}
+#else
+
 struct VSInput {
 	float3 position : TEXCOORD0;
 	float3 i_pos_ws : TEXCOORD1;
@@ -61,3 +129,4 @@ GBufferOutput mainPS(VSOutput input) {
 	output.gbuffer3 = float4(0, 0, 0, 0);
 	return output;
 }
+#endif
@@ -1,20 +1,27 @@
 //@surface
 #include "shaders/common.hlsli"
 
+// textures and clip rects are indexed per vertex, see Draw2D
 cbuffer DC : register(b4) {
 	float4x4 u_matrix;
-	TextureHandle u_texture;
+	TextureHandle u_atlas;
+	uint u_atlas_mode;
+	float4 u_clip_rects[64];
+	uint4 u_textures[16];
 };
 
 struct VSInput {
 	float2 position : TEXCOORD0;
 	float2 uv : TEXCOORD1;
 	float4 color : TEXCOORD2;
+	uint2 indices : TEXCOORD3;
 };
 
 struct VSOutput {
 	float4 color : TEXCOORD0;
 	float2 uv : TEXCOORD1;
+	float2 canvas_pos : TEXCOORD2;
+	nointerpolation uint2 indices : TEXCOORD3;
 	float4 position : SV_POSITION;
 };
 
@@ -22,10 +29,26 @@ VSOutput mainVS(VSInput input) {
 	VSOutput output;
 	output.color = input.color;
 	output.uv = input.uv;
+	output.canvas_pos = input.position;
+	output.indices = input.indices;
 	output.position = transformPosition(float3(input.position, 0), u_matrix);
 	return output;
 }
 
 float4 mainPS(VSOutput input) :SV_TARGET {
-	return input.color * sampleBindlessLod(LinearSampler, u_texture, input.uv, 0);
-}
\ No newline at end of file
+	// clip rect with negative `to` does not clip
+	float4 clip_rect = u_clip_rects[input.indices.y];
+	if (clip_rect.z >= 0 && (any(input.canvas_pos < clip_rect.xy) || any(input.canvas_pos >= clip_rect.zw))) discard;
+
+	uint tex = u_textures[input.indices.x >> 2][input.indices.x & 3];
+	float4 t = bindless_textures[NonUniformResourceIndex(tex)].SampleLevel(LinearSampler, input.uv, 0);
+	// derivatives are computed outside of non-uniform control flow
+	float sdf_aa = max(fwidth(t.r), 1e-4) * 0.5;
+	if (tex == u_atlas) {
+		// font atlas is R8 with coverage
+		if (u_atlas_mode == 1) t = float4(1, 1, 1, t.r);
+		// or signed distance, 0.5 is on the outline, antialiased over one screen pixel
+		else if (u_atlas_mode == 2) t = float4(1, 1, 1, smoothstep(0.5 - sdf_aa, 0.5 + sdf_aa, t.r));
+	}
+	return input.color * t;
+}
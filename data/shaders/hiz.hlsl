@@ -0,0 +1,34 @@
+#include "shaders/common.hlsli"
+
+// hierarchical depth for occlusion culling
+// each texel contains the farthest depth of the area it covers, depth is reversed, so it's the minimum
+cbuffer Data : register(b4) {
+	uint2 u_src_size;
+	uint2 u_dst_size;
+	uint u_input;
+	RWTextureHandle u_output;
+};
+
+float loadDepth(uint2 coord) {
+	#ifdef FROM_DEPTH
+		return bindless_textures[u_input][coord].r;
+	#else
+		return bindless_rw_textures[u_input][coord].r;
+	#endif
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 thread_id : SV_DispatchThreadID) {
+	if (any(thread_id.xy >= u_dst_size)) return;
+
+	// if src size is not a multiple of dst size, dst texel covers parts of up to 3x3 src texels
+	uint2 from = thread_id.xy * u_src_size / u_dst_size;
+	uint2 to = min(((thread_id.xy + 1) * u_src_size + u_dst_size - 1) / u_dst_size, u_src_size);
+	float depth = 1;
+	for (uint y = from.y; y < to.y; ++y) {
+		for (uint x = from.x; x < to.x; ++x) {
+			depth = min(depth, loadDepth(uint2(x, y)));
+		}
+	}
+	bindless_rw_textures[u_output][thread_id.xy] = depth;
+}
@@ -29,12 +29,23 @@ cbuffer UniformData : register(b4){
 	int4 u_lod_indices;
 	uint u_indirect_offset;
 	float u_radius;
-	float2 padding;
+	uint u_batch_size;
+	// in bytes, float4 origin of each chunk of 16 instances follows instance data
+	uint u_chunk_origins_offset;
 	float4 u_camera_planes[6];
 	uint4 u_indices_count[32];
 	uint u_culled_buffer;
 	uint u_instance_data;
 	uint u_indirect_buffer;
+	// depth pyramid of the previous frame, 0 if occlusion culling is disabled
+	uint u_hiz;
+	uint2 u_hiz_size;
+	uint u_hiz_mips;
+	uint u_hiz_pad;
+	// camera relative position -> previous frame's clip space
+	float4x4 u_hiz_mtx;
+	// quantized position -> position relative to chunk origin
+	float4 u_quantization_step;
 };
 
 cbuffer UniformData2 : register(b5) {
@@ -81,20 +92,56 @@ void storeIndirect(uint idx, Indirect indirect) {
 	b_indirect.Store(20 * idx + 16, indirect.base_instance);
 }
 
-void storeInstanceLod(uint idx, float lod) {
-	bindless_rw_buffers[u_instance_data].Store(32 * idx + 12, asuint(lod));
+// see InstancedModel::GPUInstanceData
+uint3 loadQuantizedInstanceData(uint idx) {
+	return bindless_rw_buffers[u_instance_data].Load3(idx * 12);
+}
+
+// lod is stored in 8 bits, rounded toward dst_lod, so small steps still make progress
+// returns the stored value, so the following passes see the same lod
+float storeInstanceLod(uint idx, float lod, float dst_lod) {
+	RWByteAddressBuffer b_instances = bindless_rw_buffers[u_instance_data];
+	float qlod = lod * 63;
+	uint ilod = uint(clamp(dst_lod > lod ? ceil(qlod) : floor(qlod), 0, 252));
+	uint packed = b_instances.Load(idx * 12 + 4);
+	b_instances.Store(idx * 12 + 4, (packed & 0xffFFff) | (ilod << 24));
+	return ilod / 63.0;
+}
+
+float3 decodeRotation(uint packed) {
+	uint largest = packed >> 30;
+	float3 small = float3((packed >> 20) & 0x3ff, (packed >> 10) & 0x3ff, packed & 0x3ff) / 1023.0;
+	small = (small * 2 - 1) * 0.70710678;
+	float l = sqrt(saturate(1 - dot(small, small)));
+	float4 q;
+	if (largest == 0) q = float4(l, small);
+	else if (largest == 1) q = float4(small.x, l, small.yz);
+	else if (largest == 2) q = float4(small.xy, l, small.z);
+	else q = float4(small, l);
+	// w is reconstructed by users, so it must be positive
+	return q.w < 0 ? -q.xyz : q.xyz;
 }
 
 InstanceData getInstanceData(uint idx) {
+	uint3 packed = loadQuantizedInstanceData(idx);
+	float3 chunk_origin = asfloat(bindless_rw_buffers[u_instance_data].Load3(u_chunk_origins_offset + idx / 16 * 16));
+	uint scale = (packed.y >> 16) & 0xff;
+
 	InstanceData result;
-	result.rot_lod = asfloat(bindless_rw_buffers[u_instance_data].Load4(idx * 32));
-	result.pos_scale = asfloat(bindless_rw_buffers[u_instance_data].Load4(idx * 32 + 16));
+	result.rot_lod.xyz = decodeRotation(packed.z);
+	result.rot_lod.w = (packed.y >> 24) / 63.0;
+	result.pos_scale.xyz = chunk_origin + float3(packed.x & 0xffFF, packed.x >> 16, packed.y & 0xffFF) * u_quantization_step.xyz;
+	result.pos_scale.w = scale == 0 ? 0 : exp2((float(scale) - 128) / 16);
 	return result;
 }
 
+// same metric as on CPU, see PipelineImpl::createSortKeys
 uint getLOD(uint id) {
-	float3 p = getInstanceData(id).pos_scale.xyz + u_camera_offset.xyz;
-	float d = dot(p, p);
+	float4 pos_scale = getInstanceData(id).pos_scale;
+	// free slot
+	if (pos_scale.w == 0) return 4;
+	float3 p = pos_scale.xyz + u_camera_offset.xyz;
+	float d = dot(p, p) / max(1e-10, pos_scale.w * pos_scale.w);
 	if (d > u_lod_distances.w) return 4;
 	else if (d > u_lod_distances.z) return 3;
 	else if (d > u_lod_distances.y) return 2;
@@ -102,6 +149,41 @@ uint getLOD(uint id) {
 	return 0;
 }
 
+// tests bounding box of the sphere against the previous frame's depth, depth is reversed
+bool isOccluded(float3 center, float radius) {
+	float2 uv_min = 1e10;
+	float2 uv_max = -1e10;
+	float z_max = 0;
+	for (uint i = 0; i < 8; ++i) {
+		float3 corner = center + float3(i & 1 ? radius : -radius, i & 2 ? radius : -radius, i & 4 ? radius : -radius);
+		float4 p = transformPosition(corner, u_hiz_mtx);
+		// behind the previous camera
+		if (p.w <= 0) return false;
+		p.xyz /= p.w;
+		float2 uv = p.xy * float2(0.5, -0.5) + 0.5;
+		uv_min = min(uv_min, uv);
+		uv_max = max(uv_max, uv);
+		z_max = max(z_max, p.z);
+	}
+	// we know nothing about things outside of the previous frame
+	if (any(uv_max < 0) || any(uv_min > 1)) return false;
+	uv_min = saturate(uv_min);
+	uv_max = saturate(uv_max);
+
+	// pick mip where the box covers at most 2x2 texels
+	float2 extent = (uv_max - uv_min) * u_hiz_size;
+	uint mip = min(uint(ceil(log2(max(max(extent.x, extent.y), 1)))), u_hiz_mips - 1);
+	uint2 mip_size = max(u_hiz_size >> mip, 1);
+	uint2 from = min(uint2(uv_min * mip_size), mip_size - 1);
+	uint2 to = min(uint2(uv_max * mip_size), mip_size - 1);
+	Texture2D<float4> hiz = bindless_textures[u_hiz];
+	float occluder_depth = min(
+		min(hiz.Load(int3(from.x, from.y, mip)).r, hiz.Load(int3(to.x, from.y, mip)).r),
+		min(hiz.Load(int3(from.x, to.y, mip)).r, hiz.Load(int3(to.x, to.y, mip)).r)
+	);
+	return z_max < occluder_depth;
+}
+
 bool cull(uint id) {
 	InstanceData instance_data = getInstanceData(id);
 	float scale = instance_data.pos_scale.w;
@@ -112,6 +194,7 @@ bool cull(uint id) {
 			return false;
 		}
 	}
+	if (u_hiz != 0 && isOccluded(cullp.xyz, scaled_radius)) return false;
 	return true;
 }
 
@@ -142,9 +225,10 @@ void main(uint3 thread_id : SV_DispatchThreadID, uint3 group_thread_id : SV_Grou
 				float dst_lod = getLOD(id);
 				float src_lod = getInstanceData(id).rot_lod.w;
 				float d = dst_lod - src_lod;
-				float td = Global_frame_time_delta * 2;
+				// LOD_CROSSFADE_SPEED in pipeline.cpp
+				float td = Global_frame_time_delta * 4;
 				float lod = abs(d) < td ? dst_lod : src_lod + td * sign(d);
-				storeInstanceLod(id, lod);
+				lod = storeInstanceLod(id, lod, dst_lod);
 			#else
 				float lod = getInstanceData(id).rot_lod.w;
 			#endif
@@ -249,7 +333,8 @@ void main(uint3 thread_id : SV_DispatchThreadID, uint3 group_thread_id : SV_Grou
 	#elif defined UPDATE_LODS
 		if (id < u_instance_count) {
 			id += u_from_instance;
-			storeInstanceLod(id, getLOD(id));
+			float lod = getLOD(id);
+			storeInstanceLod(id, lod, lod);
 		}
 	#endif
 }
@@ -0,0 +1,22 @@
+#include "shaders/common.hlsli"
+
+// merges cached shadow of static casters into shadow atlas slot containing only dynamic casters
+// depth is reversed, so the closer caster is the maximum
+cbuffer Drawcall : register(b4) {
+	uint u_x;
+	uint u_y;
+	uint u_w;
+	uint u_h;
+	TextureHandle u_static;
+	RWTextureHandle u_dst;
+};
+
+[numthreads(16, 16, 1)]
+void main(uint3 thread_id : SV_DispatchThreadID) {
+	if (thread_id.x >= u_w || thread_id.y >= u_h) return;
+
+	uint2 coord = thread_id.xy + uint2(u_x, u_y);
+	float static_depth = bindless_textures[u_static][coord].r;
+	float dynamic_depth = bindless_rw_textures[u_dst][coord].r;
+	bindless_rw_textures[u_dst][coord] = max(static_depth, dynamic_depth);
+}
@@ -3,6 +3,7 @@
 cbuffer Data : register(b4) {
 	float u_max_steps;
 	float u_stride;
+	float2 u_size; // size of u_sss_buffer, can be downscaled
 	TextureHandle u_depth;
 	RWTextureHandle u_sss_buffer;
 };
@@ -16,8 +17,8 @@ void raycast(float3 ray_origin, float3 ray_dir, float stride, float jitter, uint
 
 	float k0 = 1 / H0.w, k1 = 1 / H1.w;
 
-	float2 P0 = toScreenUV(H0.xy * k0 * 0.5 + 0.5) * Global_framebuffer_size;
-	float2 P1 = toScreenUV(H1.xy * k1 * 0.5 + 0.5) * Global_framebuffer_size;
+	float2 P0 = toScreenUV(H0.xy * k0 * 0.5 + 0.5) * u_size;
+	float2 P1 = toScreenUV(H1.xy * k1 * 0.5 + 0.5) * u_size;
 
 	float2 delta = P1 - P0;
 	bool permute = abs(delta.x) < abs(delta.y);
@@ -47,9 +48,9 @@ void raycast(float3 ray_origin, float3 ray_dir, float stride, float jitter, uint
 
 			float2 p = permute ? P.yx : P;
 			if (any(p < 0)) break;
-			if (any(p > float2(Global_framebuffer_size))) break;
+			if (any(p > u_size)) break;
 
-			float ndc_depth = sampleBindlessLod(LinearSamplerClamp, u_depth, p * Global_rcp_framebuffer_size, 0).x;
+			float ndc_depth = sampleBindlessLod(LinearSamplerClamp, u_depth, p / u_size, 0).x;
 			float linear_depth = toLinearDepth(ndc_depth);
 			
 			float dif = ray_z_far - linear_depth;
@@ -72,7 +73,7 @@ void raycast(float3 ray_origin, float3 ray_dir, float stride, float jitter, uint
 
 [numthreads(16, 16, 1)]
 void main(uint3 thread_id : SV_DispatchThreadID) {
-	float2 screen_uv = float2(thread_id.xy) * Global_rcp_framebuffer_size;
+	float2 screen_uv = float2(thread_id.xy) / u_size;
 	float3 pos_ws = getPositionWS(u_depth, screen_uv);
 	float4 pos_vs = transformPosition(pos_ws, Global_ws_to_vs);
 	float3 light_dir_vs = mul(Global_light_dir.xyz, (float3x3)Global_ws_to_vs);
@@ -2,28 +2,45 @@
 
 cbuffer Data : register(b4) {
 	float u_current_frame_weight;
+	uint u_downscale;
+	float2 u_rcp_size; // size of u_sss
+	float u_depth_diff_weight;
 	RWTextureHandle u_sss;
 	TextureHandle u_history;
 	TextureHandle u_depthbuf;
+	TextureHandle u_depthbuf_small; // downscaled, if available
 	RWTextureHandle u_gbuffer2;
 };
 
-[numthreads(16, 16, 1)]
-void main(uint3 thread_id : SV_DispatchThreadID) {
-	float depth = bindless_textures[u_depthbuf][thread_id.xy].x;
-	
-	float2 screen_uv = (float2(thread_id.xy) + 0.5) * Global_rcp_framebuffer_size;
-	float2 screen_uv_prev = cameraReproject(screen_uv, depth).xy;
+void apply(uint2 frag_coord, float sss) {
+	float4 gb2v = bindless_rw_textures[u_gbuffer2][frag_coord];
+	gb2v.w = min(sss, gb2v.w);
+	bindless_rw_textures[u_gbuffer2][frag_coord] = gb2v;
+}
 
-	float current = bindless_textures[u_sss][thread_id.xy].x;
-	if (all(screen_uv_prev < 1) && all(screen_uv_prev > 0)) {
-		float prev = bindless_textures[u_history].SampleLevel(LinearSamplerClamp, screen_uv_prev, 0).x;
-		current = lerp(prev, current, 0.1);
-		bindless_rw_textures[u_sss][thread_id.xy] = current;
+#ifdef UPSAMPLE
+	// u_sss is downscaled, apply it to full resolution gbuffer
+	[numthreads(16, 16, 1)]
+	void main(uint3 thread_id : SV_DispatchThreadID) {
+		UpsampleWeights w = getDepthAwareUpsampleWeights(thread_id.xy, u_downscale, u_depthbuf, u_depthbuf_small, u_depth_diff_weight);
+		apply(thread_id.xy, saturate(depthAwareUpsample(u_sss, w).x));
 	}
-	
-	float4 gb2v = bindless_rw_textures[u_gbuffer2][thread_id.xy];
-	gb2v.w = min(current, gb2v.w);
-	bindless_rw_textures[u_gbuffer2][thread_id.xy] = gb2v;
-}
+#else
+	// temporal accumulation in u_sss resolution
+	[numthreads(16, 16, 1)]
+	void main(uint3 thread_id : SV_DispatchThreadID) {
+		float depth = bindless_textures[u_depthbuf_small][thread_id.xy].x;
+		
+		float2 screen_uv = (float2(thread_id.xy) + 0.5) * u_rcp_size;
+		float2 screen_uv_prev = cameraReproject(screen_uv, depth).xy;
 
+		float current = bindless_textures[u_sss][thread_id.xy].x;
+		if (all(screen_uv_prev < 1) && all(screen_uv_prev > 0)) {
+			float prev = bindless_textures[u_history].SampleLevel(LinearSamplerClamp, screen_uv_prev, 0).x;
+			current = lerp(prev, current, 0.1);
+			bindless_rw_textures[u_sss][thread_id.xy] = current;
+		}
+		
+		if (u_downscale == 0) apply(thread_id.xy, current);
+	}
+#endif
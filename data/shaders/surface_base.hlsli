@@ -93,7 +93,15 @@ struct VSOutput {
 		uint material_index;
 		row_major float4x4 mtx;
 		row_major float4x4 prev_matrix;
-		row_major float2x4 bones[255];
+		// dual quaternion per bone, computed once per frame, see computeSkinningPalette
+		uint bones_buffer;
+		uint bones_offset;
+	}
+
+	float2x4 getBone(uint idx) {
+		ByteAddressBuffer bones = bindless_buffers[bones_buffer];
+		const uint addr = bones_offset + idx * 32;
+		return float2x4(asfloat(bones.Load4(addr)), asfloat(bones.Load4(addr + 16)));
 	}
 #elif defined INSTANCED
 	cbuffer ModelState : register(b4) {
@@ -174,13 +182,17 @@ VSOutput mainVS(VSInput input) {
 		output.prev_ndcpos_no_jitter = float4(input.i_prev_pos_lod.xyz + rotateByQuat(input.i_prev_rot, input.position * input.i_prev_scale.xyz), 1);
 		output.prev_ndcpos_no_jitter = mul(output.prev_ndcpos_no_jitter, mul(Global_ws_to_ndc_no_jitter, Global_reprojection));
 	#elif defined SKINNED
-		float2x4 dq = mul(bones[input.indices.x], input.weights.x);
-		float w = dot(bones[input.indices.y][0], bones[input.indices.x][0]) < 0 ? -input.weights.y : input.weights.y;
-		dq += mul(bones[input.indices.y], w);
-		w = dot(bones[input.indices.z][0], bones[input.indices.x][0]) < 0 ? -input.weights.z : input.weights.z;
-		dq += mul(bones[input.indices.z], w);
-		w = dot(bones[input.indices.w][0], bones[input.indices.x][0]) < 0 ? -input.weights.w : input.weights.w;
-		dq += mul(bones[input.indices.w], w);
+		const float2x4 b0 = getBone(input.indices.x);
+		const float2x4 b1 = getBone(input.indices.y);
+		const float2x4 b2 = getBone(input.indices.z);
+		const float2x4 b3 = getBone(input.indices.w);
+		float2x4 dq = mul(b0, input.weights.x);
+		float w = dot(b1[0], b0[0]) < 0 ? -input.weights.y : input.weights.y;
+		dq += mul(b1, w);
+		w = dot(b2[0], b0[0]) < 0 ? -input.weights.z : input.weights.z;
+		dq += mul(b2, w);
+		w = dot(b3[0], b0[0]) < 0 ? -input.weights.w : input.weights.w;
+		dq += mul(b3, w);
 	
 		dq *= 1 / length(dq[0]);
 
@@ -13,12 +13,27 @@ cbuffer Drawcall : register(b4) {
 	TextureHandle u_depth_buffer;
 	RWTextureHandle u_gbufferB;
 	TextureHandle u_topdown_depthmap;
+	uint u_downscale;
+	RWTextureHandle u_output; // used instead of u_gbufferB if u_downscale > 0, it's upscaled by ssao_blit.hlsl
 };
 
+void writeAO(uint2 thread_id, float ao) {
+	if (u_downscale > 0) {
+		bindless_rw_textures[u_output][thread_id] = 1 - ao;
+		return;
+	}
+
+	// add tdao to ao
+	float4 gbufferB_value = bindless_rw_textures[u_gbufferB][thread_id];
+	gbufferB_value.w = gbufferB_value.w * (1 - ao);
+	bindless_rw_textures[u_gbufferB][thread_id] = gbufferB_value;
+}
+
 [numthreads(16, 16, 1)]
 void main(uint3 thread_id : SV_DispatchThreadID) {
 	// compute td-space position
-	float2 screen_uv = thread_id.xy * u_rcp_size;
+	// u_rcp_size is full resolution, we pick the same texel as ssao_downscale_depth.hlsl
+	float2 screen_uv = (thread_id.xy << u_downscale) * u_rcp_size;
 	float3 pos_td = getPositionWS(u_depth_buffer, screen_uv);
 	pos_td += u_offset.xyz;
 	pos_td.y += u_depth_offset;
@@ -28,7 +43,10 @@ void main(uint3 thread_id : SV_DispatchThreadID) {
 	#ifdef _ORIGIN_BOTTOM_LEFT
 		uv = uv * float2(1, -1);
 	#endif
-	if (any(abs(uv) > 1)) return;
+	if (any(abs(uv) > 1)) {
+		writeAO(thread_id.xy, 0);
+		return;
+	}
 	uv = saturate(uv * 0.5 + 0.5);
 
 	// create random rotation matrix
@@ -47,9 +65,6 @@ void main(uint3 thread_id : SV_DispatchThreadID) {
 	}
 	ao *= u_intensity / 16;
 
-	// add tdao to ao
-	float4 gbufferB_value = bindless_rw_textures[u_gbufferB][thread_id.xy];
-	gbufferB_value.w = gbufferB_value.w * (1 - ao);
-	bindless_rw_textures[u_gbufferB][thread_id.xy] = gbufferB_value;
+	writeAO(thread_id.xy, ao);
 }
 
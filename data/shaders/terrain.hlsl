@@ -25,8 +25,39 @@ cbuffer Drawcall : register(b4) {
 	float2 u_hm_size;
 	float u_cell_size;
 	uint u_material_index;
+	// see Terrain::Clipmap, 0 levels if material's heightmap and splatmap are used
+	uint u_clipmap_levels;
+	uint u_clipmap_heightmap;
+	uint u_clipmap_splatmap;
+	uint u_clipmap_size;
+	int4 u_clipmap_origins[8];
+	// selected patches, see terrain_lod.hlsl, 0 if terrain is drawn in rings around the camera
+	uint u_lod_patches;
+	// grid cells per patch side
+	uint u_lod_patch_res;
+	// view distance of level 0 patches, it doubles with each level
+	float u_lod_range;
+	uint u_lod_pad;
 };
 
+static const float CLIPMAP_MARGIN = 2;
+
+// finest clipmap level containing `texel` (in heightmap texels) with enough margin
+uint getClipmapLevel(float2 texel) {
+	for (uint l = 0; l + 1 < u_clipmap_levels; ++l) {
+		float2 t = texel / float(1 << l);
+		float2 from = u_clipmap_origins[l].xy + CLIPMAP_MARGIN;
+		float2 to = u_clipmap_origins[l].xy + u_clipmap_size - CLIPMAP_MARGIN - 1;
+		if (all(t >= from) && all(t <= to)) return l;
+	}
+	return u_clipmap_levels - 1;
+}
+
+// levels are stored toroidally, so wrapping sampler is used
+float3 getClipmapUV(float2 texel, uint level) {
+	return float3((texel / float(1 << level) + 0.5) / u_clipmap_size, level);
+}
+
 struct VSOutput {
 	#ifndef DEPTH
 		float2 uv : TEXCOORD0;
@@ -37,28 +68,62 @@ struct VSOutput {
 };
 
 
+float sampleHeight(float2 xz, MaterialData material) {
+	if (u_clipmap_levels > 0) {
+		float2 texel = xz / u_terrain_scale.x;
+		float3 clipmap_uv = getClipmapUV(texel, getClipmapLevel(texel));
+		return bindless_2D_arrays[u_clipmap_heightmap].SampleLevel(LinearSampler, clipmap_uv, 0).x * u_terrain_scale.y;
+	}
+	float2 hm_uv = (xz + 0.5 * u_terrain_scale.x) / (u_hm_size + u_terrain_scale.x);
+	return sampleBindlessLod(LinearSamplerClamp, material.t_heightmap, hm_uv, 0).x * u_terrain_scale.y;
+}
+
+// each instance is one patch, drawn as a list of u_lod_patch_res x u_lod_patch_res quads
+float3 getPatchVertex(uint vertex_id, uint instance_id, MaterialData material) {
+	static const uint2 corners[6] = { uint2(0, 0), uint2(0, 1), uint2(1, 0), uint2(1, 0), uint2(0, 1), uint2(1, 1) };
+	// origin.xz, size, level
+	float4 patch = asfloat(bindless_buffers[u_lod_patches].Load4(16 + instance_id * 16));
+	uint cell = vertex_id / 6;
+	uint2 ij = uint2(cell % u_lod_patch_res, cell / u_lod_patch_res) + corners[vertex_id % 6];
+	float cell_size = patch.z / u_lod_patch_res;
+
+	float3 v;
+	v.xz = min(patch.xy + ij * cell_size, u_hm_size);
+	v.y = sampleHeight(v.xz, material);
+	// odd vertices morph to the grid of the next level in the last quarter of the range, so there are no cracks between levels
+	float range = u_lod_range * exp2(asuint(patch.w));
+	float morph = saturate(length(v - u_rel_camera_pos.xyz) / range * 4 - 3);
+	v.xz = patch.xy + (ij - (ij & 1) * morph) * cell_size;
+	v.xz = min(v.xz, u_hm_size);
+	v.y = sampleHeight(v.xz, material);
+	return v;
+}
+
 VSOutput mainVS(uint vertex_id : SV_VertexID, uint instance_id : SV_InstanceID) {
 	MaterialData material = getMaterialData(u_material_index);
-	int2 ij = u_from_to.xy + int2((vertex_id >> 1), instance_id + (vertex_id & 1));
-
 	float3 v = 0;
-	v.xz = ij * u_cell_size;
-	int mask = ~1;
-	float3 npos = 0;
-	npos.xz = (ij & mask) * u_cell_size;
-
-	float2 size = float2(u_from_to_sup.zw - u_from_to_sup.xy);
-	float2 rel = (ij - u_from_to_sup.xy) / size;
-	
-	rel = saturate(abs(rel - 0.5) * 10 - 4);
-	v.xz = lerp(v.xz, npos.xz, rel.yx);
-	v.xz = clamp(v.xz, 0, u_hm_size);
-
-	float2 hm_uv = (v.xz + 0.5 * u_terrain_scale.x) / (u_hm_size + u_terrain_scale.x);
-	VSOutput output;
-	float h = sampleBindlessLod(LinearSamplerClamp, material.t_heightmap, hm_uv, 0).x * u_terrain_scale.y;
+	if (u_lod_patches != 0) {
+		v = getPatchVertex(vertex_id, instance_id, material);
+	}
+	else {
+		int2 ij = u_from_to.xy + int2((vertex_id >> 1), instance_id + (vertex_id & 1));
+
+		v.xz = ij * u_cell_size;
+		int mask = ~1;
+		float3 npos = 0;
+		npos.xz = (ij & mask) * u_cell_size;
+
+		float2 size = float2(u_from_to_sup.zw - u_from_to_sup.xy);
+		float2 rel = (ij - u_from_to_sup.xy) / size;
+		
+		rel = saturate(abs(rel - 0.5) * 10 - 4);
+		v.xz = lerp(v.xz, npos.xz, rel.yx);
+		v.xz = clamp(v.xz, 0, u_hm_size);
+		v.y = sampleHeight(v.xz, material);
+	}
 
-	float3 pos_ws = u_position.xyz + v + float3(0, h, 0);		
+	VSOutput output;
+	float3 pos_ws = u_position.xyz + v;
 	#ifndef DEPTH
 		output.uv = v.xz / u_hm_size;
 		output.pos_ws = pos_ws;
@@ -76,10 +141,24 @@ VSOutput mainVS(uint vertex_id : SV_VertexID, uint instance_id : SV_InstanceID)
 
 	float3x3 getTBN(float2 uv, MaterialData material) {
 		float hscale = u_terrain_scale.y / u_terrain_scale.x;
-		float s01 = sampleBindlessLodOffset(LinearSamplerClamp, material.t_heightmap, uv, 0, int2(-1, 0)).x;
-		float s21 = sampleBindlessLodOffset(LinearSamplerClamp, material.t_heightmap, uv, 0, int2(1, 0)).x;
-		float s10 = sampleBindlessLodOffset(LinearSamplerClamp, material.t_heightmap, uv, 0, int2(0, -1)).x;
-		float s12 = sampleBindlessLodOffset(LinearSamplerClamp, material.t_heightmap, uv, 0, int2(0, 1)).x;
+		float s01, s21, s10, s12;
+		if (u_clipmap_levels > 0) {
+			float2 texel = uv * u_hm_size / u_terrain_scale.x;
+			uint level = getClipmapLevel(texel);
+			float3 clipmap_uv = getClipmapUV(texel, level);
+			s01 = bindless_2D_arrays[u_clipmap_heightmap].SampleLevel(LinearSampler, clipmap_uv, 0, int2(-1, 0)).x;
+			s21 = bindless_2D_arrays[u_clipmap_heightmap].SampleLevel(LinearSampler, clipmap_uv, 0, int2(1, 0)).x;
+			s10 = bindless_2D_arrays[u_clipmap_heightmap].SampleLevel(LinearSampler, clipmap_uv, 0, int2(0, -1)).x;
+			s12 = bindless_2D_arrays[u_clipmap_heightmap].SampleLevel(LinearSampler, clipmap_uv, 0, int2(0, 1)).x;
+			// neighbours are (1 << level) heightmap texels apart
+			hscale /= float(1 << level);
+		}
+		else {
+			s01 = sampleBindlessLodOffset(LinearSamplerClamp, material.t_heightmap, uv, 0, int2(-1, 0)).x;
+			s21 = sampleBindlessLodOffset(LinearSamplerClamp, material.t_heightmap, uv, 0, int2(1, 0)).x;
+			s10 = sampleBindlessLodOffset(LinearSamplerClamp, material.t_heightmap, uv, 0, int2(0, -1)).x;
+			s12 = sampleBindlessLodOffset(LinearSamplerClamp, material.t_heightmap, uv, 0, int2(0, 1)).x;
+		}
 		float3 va = normalize(float3(1.0, (s21-s01) * hscale, 0.0));
 		float3 vb = normalize(float3(0.0, (s12-s10) * hscale, 1.0));
 		float3 N = normalize(cross(vb,va));
@@ -154,12 +233,23 @@ VSOutput mainVS(uint vertex_id : SV_VertexID, uint instance_id : SV_InstanceID)
 				uv_ratio.x * uv_ratio.y
 			);
 
-			float2 uv_grid = uv / resolution;
 			// todo textureGather
-			float4 splat00 = bindless_textures[material.t_splatmap].SampleLevel(LinearSampler, uv_grid, 0, int2(0, 0));
-			float4 splat10 = bindless_textures[material.t_splatmap].SampleLevel(LinearSampler, uv_grid, 0, int2(1, 0));
-			float4 splat01 = bindless_textures[material.t_splatmap].SampleLevel(LinearSampler, uv_grid, 0, int2(0, 1));
-			float4 splat11 = bindless_textures[material.t_splatmap].SampleLevel(LinearSampler, uv_grid, 0, int2(1, 1));
+			float4 splat00, splat10, splat01, splat11;
+			if (u_clipmap_levels > 0) {
+				uint level = getClipmapLevel(uv);
+				float3 clipmap_uv = float3(uv / float(1 << level) / u_clipmap_size, level);
+				splat00 = bindless_2D_arrays[u_clipmap_splatmap].SampleLevel(LinearSampler, clipmap_uv, 0, int2(0, 0));
+				splat10 = bindless_2D_arrays[u_clipmap_splatmap].SampleLevel(LinearSampler, clipmap_uv, 0, int2(1, 0));
+				splat01 = bindless_2D_arrays[u_clipmap_splatmap].SampleLevel(LinearSampler, clipmap_uv, 0, int2(0, 1));
+				splat11 = bindless_2D_arrays[u_clipmap_splatmap].SampleLevel(LinearSampler, clipmap_uv, 0, int2(1, 1));
+			}
+			else {
+				float2 uv_grid = uv / resolution;
+				splat00 = bindless_textures[material.t_splatmap].SampleLevel(LinearSampler, uv_grid, 0, int2(0, 0));
+				splat10 = bindless_textures[material.t_splatmap].SampleLevel(LinearSampler, uv_grid, 0, int2(1, 0));
+				splat01 = bindless_textures[material.t_splatmap].SampleLevel(LinearSampler, uv_grid, 0, int2(0, 1));
+				splat11 = bindless_textures[material.t_splatmap].SampleLevel(LinearSampler, uv_grid, 0, int2(1, 1));
+			}
 
 			float2 uv_detail = material.u_detail_scale * input.uv * u_hm_size;
 
@@ -0,0 +1,133 @@
+#include "shaders/common.hlsli"
+
+// CDLOD terrain patch selection, see Terrain::LODTree
+// node is drawn if its parent is subdivided and the node itself is not, so the drawn nodes cover the terrain without overlaps
+// node at level `l` is subdivided if it's closer than the range of level `l - 1`
+// output - indirect draw arguments (vertex count, instance count, first vertex, first instance) followed by patches
+cbuffer Data : register(b4) {
+	float4 u_camera_planes[6];
+	// terrain relative to the camera
+	float4 u_position;
+	// LOD camera in terrain space
+	float4 u_rel_camera_pos;
+	float4 u_terrain_scale;
+	float2 u_hm_size;
+	// size of level 0 nodes
+	float u_leaf_size;
+	// view distance of level 0 patches, it doubles with each level
+	float u_lod_range;
+	uint u_levels;
+	uint u_nodes_count;
+	uint u_minmax;
+	uint u_patches;
+	uint u_vertex_count;
+	// depth pyramid of the previous frame, 0 if occlusion culling is disabled
+	uint u_hiz;
+	uint2 u_hiz_size;
+	uint u_hiz_mips;
+	uint3 u_pad;
+	// first node of each level, 4 levels per element
+	uint4 u_level_offsets[4];
+	// nodes per row of each level, 4 levels per element
+	uint4 u_level_widths[4];
+	// camera relative position -> previous frame's clip space
+	float4x4 u_hiz_mtx;
+};
+
+struct Node {
+	float3 min;
+	float3 max;
+};
+
+uint getLevelOffset(uint level) { return u_level_offsets[level >> 2][level & 3]; }
+uint getLevelWidth(uint level) { return u_level_widths[level >> 2][level & 3]; }
+float getRange(uint level) { return u_lod_range * exp2(level); }
+
+Node getNode(uint level, uint2 xz) {
+	float2 minmax = asfloat(bindless_buffers[u_minmax].Load2((getLevelOffset(level) + xz.x + xz.y * getLevelWidth(level)) * 8));
+	float size = u_leaf_size * exp2(level);
+	Node node;
+	node.min = float3(xz.x * size, minmax.x * u_terrain_scale.y, xz.y * size);
+	node.max = float3(min((xz.x + 1) * size, u_hm_size.x), minmax.y * u_terrain_scale.y, min((xz.y + 1) * size, u_hm_size.y));
+	return node;
+}
+
+bool isSubdivided(uint level, Node node) {
+	if (level == 0) return false;
+	float3 d = max(max(node.min - u_rel_camera_pos.xyz, u_rel_camera_pos.xyz - node.max), 0);
+	return dot(d, d) < getRange(level - 1) * getRange(level - 1);
+}
+
+bool isInFrustum(float3 center, float3 extents) {
+	for (int i = 0; i < 6; ++i) {
+		if (dot(u_camera_planes[i].xyz, center) + u_camera_planes[i].w < -dot(abs(u_camera_planes[i].xyz), extents)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// same as in instancing.hlsl, but for a box, depth is reversed
+bool isOccluded(float3 center, float3 extents) {
+	float2 uv_min = 1e10;
+	float2 uv_max = -1e10;
+	float z_max = 0;
+	for (uint i = 0; i < 8; ++i) {
+		float3 corner = center + float3(i & 1 ? extents.x : -extents.x, i & 2 ? extents.y : -extents.y, i & 4 ? extents.z : -extents.z);
+		float4 p = transformPosition(corner, u_hiz_mtx);
+		// behind the previous camera
+		if (p.w <= 0) return false;
+		p.xyz /= p.w;
+		float2 uv = p.xy * float2(0.5, -0.5) + 0.5;
+		uv_min = min(uv_min, uv);
+		uv_max = max(uv_max, uv);
+		z_max = max(z_max, p.z);
+	}
+	// we know nothing about things outside of the previous frame
+	if (any(uv_max < 0) || any(uv_min > 1)) return false;
+	uv_min = saturate(uv_min);
+	uv_max = saturate(uv_max);
+
+	// pick mip where the box covers at most 2x2 texels
+	float2 extent = (uv_max - uv_min) * u_hiz_size;
+	uint mip = min(uint(ceil(log2(max(max(extent.x, extent.y), 1)))), u_hiz_mips - 1);
+	uint2 mip_size = max(u_hiz_size >> mip, 1);
+	uint2 from = min(uint2(uv_min * mip_size), mip_size - 1);
+	uint2 to = min(uint2(uv_max * mip_size), mip_size - 1);
+	Texture2D<float4> hiz = bindless_textures[u_hiz];
+	float occluder_depth = min(
+		min(hiz.Load(int3(from.x, from.y, mip)).r, hiz.Load(int3(to.x, from.y, mip)).r),
+		min(hiz.Load(int3(from.x, to.y, mip)).r, hiz.Load(int3(to.x, to.y, mip)).r)
+	);
+	return z_max < occluder_depth;
+}
+
+[numthreads(256, 1, 1)]
+void main(uint3 thread_id : SV_DispatchThreadID) {
+	uint id = thread_id.x;
+	#ifdef PASS0
+		if (id == 0) bindless_rw_buffers[u_patches].Store4(0, uint4(u_vertex_count, 0, 0, 0));
+	#else
+		if (id >= u_nodes_count) return;
+
+		uint level = 0;
+		while (level + 1 < u_levels && id >= getLevelOffset(level + 1)) ++level;
+		uint idx = id - getLevelOffset(level);
+		uint2 xz = uint2(idx % getLevelWidth(level), idx / getLevelWidth(level));
+
+		Node node = getNode(level, xz);
+		if (isSubdivided(level, node)) return;
+		// nodes of the last level are roots
+		if (level + 1 < u_levels && !isSubdivided(level + 1, getNode(level + 1, xz / 2))) return;
+
+		float3 center = u_position.xyz + (node.min + node.max) * 0.5;
+		float3 extents = (node.max - node.min) * 0.5;
+		if (!isInFrustum(center, extents)) return;
+		if (u_hiz != 0 && isOccluded(center, extents)) return;
+
+		uint patch_idx;
+		bindless_rw_buffers[u_patches].InterlockedAdd(4, 1, patch_idx);
+		float4 patch = float4(node.min.xz, u_leaf_size * exp2(level), asfloat(level));
+		bindless_rw_buffers[u_patches].Store4(16 + patch_idx * 16, asuint(patch));
+	#endif
+}
@@ -0,0 +1,13 @@
+#include "shaders/common.hlsli"
+
+cbuffer Drawcall : register(b4) {
+	float2 u_rcp_size;
+	TextureHandle u_input;
+	RWTextureHandle u_output;
+};
+
+[numthreads(16, 16, 1)]
+void main(uint3 thread_id : SV_DispatchThreadID) {
+	float2 uv = (thread_id.xy + 0.5) * u_rcp_size;
+	bindless_rw_textures[u_output][thread_id.xy] = sampleBindlessLod(LinearSamplerClamp, u_input, uv, 0);
+}
@@ -51,6 +51,17 @@ static const int DT_CROWD_MAX_OBSTAVOIDANCE_PARAMS = 8;
 ///		dtCrowdAgentParams::queryFilterType
 static const int DT_CROWD_MAX_QUERY_FILTER_TYPE = 16;
 
+/// The maximum number of batches the per-agent phases of dtCrowd::update() are split into.
+/// @ingroup crowd
+/// @see dtCrowd::setParallelFor()
+static const int DT_CROWD_MAX_BATCHES = 64;
+
+/// Calls @p func for each index in [0, @p count), possibly in parallel. 
+/// Must not return before all the calls are finished.
+/// @ingroup crowd
+/// @see dtCrowd::setParallelFor()
+typedef void (dtCrowdParallelForFunc)(void* userData, const int count, void (*func)(void* data, const int idx), void* data);
+
 /// Provides neighbor data for agents managed by the crowd.
 /// @ingroup crowd
 /// @see dtCrowdAgent::neis, dtCrowd
@@ -230,6 +241,28 @@ class dtCrowd
 
 	dtNavMeshQuery* m_navquery;
 
+	dtCrowdParallelForFunc* m_parallelFor;
+	void* m_parallelForUserData;
+	int m_maxBatches;
+	dtObstacleAvoidanceQuery* m_batchObstacleQueries[DT_CROWD_MAX_BATCHES];
+	int m_batchVelocitySampleCounts[DT_CROWD_MAX_BATCHES];
+
+	enum BatchPhase
+	{
+		PHASE_NEIGHBOURS,
+		PHASE_CORNERS,
+		PHASE_STEERING,
+		PHASE_VELOCITY_PLANNING,
+		PHASE_INTEGRATE,
+		PHASE_COLLISION_DISP,
+		PHASE_COLLISION_APPLY,
+	};
+
+	void runBatches(const BatchPhase phase, dtCrowdAgent** agents, const int nagents, const float dt, dtCrowdAgentDebugInfo* debug);
+	void updateBatch(const BatchPhase phase, const int batch, dtCrowdAgent** agents, const int from, const int to,
+					 const int nagents, const float dt, dtCrowdAgentDebugInfo* debug);
+	void freeBatchObstacleQueries();
+
 	void updateTopologyOptimization(dtCrowdAgent** agents, const int nagents, const float dt);
 	void updateMoveRequest(const float dt);
 	void checkPathValidity(dtCrowdAgent** agents, const int nagents, const float dt);
@@ -309,6 +342,15 @@ public:
 	/// @return True if the request was successfully reseted.
 	bool resetMoveTarget(const int idx);
 
+	/// Sets a path found outside of the crowd, e.g. by sliced queries on other threads.
+	///  @param[in]		idx		The agent index. [Limits: 0 <= value < #getAgentCount()]
+	///  @param[in]		ref		The target position's polygon reference.
+	///  @param[in]		pos		The target position within the polygon. [(x, y, z)]
+	///  @param[in]		path	The path, starting at a polygon of the agent's corridor. [(polyRef) * @p npath]
+	///  @param[in]		npath	The number of polygons in the path.
+	/// @return True if the path was set or the target was requested the usual way.
+	bool setMoveTargetPath(const int idx, dtPolyRef ref, const float* pos, const dtPolyRef* path, const int npath);
+
 	/// Gets the active agents int the agent pool.
 	///  @param[out]	agents		An array of agent pointers. [(#dtCrowdAgent *) * maxAgents]
 	///  @param[in]		maxAgents	The size of the crowd agent array.
@@ -322,6 +364,15 @@ public:
 	
 	void doMove(float dt);
 
+	/// Lets #update() split its per-agent phases (neighbour queries, corners and path visibility, steering,
+	/// obstacle avoidance, integration and collisions) into batches run through @p func. 
+	/// Results do not depend on the number of batches or the order they are run in.
+	///  @param[in]		func		The parallel for, or null to run everything on the calling thread.
+	///  @param[in]		userData	Passed to @p func.
+	///  @param[in]		maxBatches	The maximum number of batches per phase. [Limits: 1 <= value <= #DT_CROWD_MAX_BATCHES]
+	/// @return True if the per-batch obstacle queries were allocated.
+	bool setParallelFor(dtCrowdParallelForFunc* func, void* userData, const int maxBatches);
+
 	/// Gets the filter used by the crowd.
 	/// @return The filter used by the crowd.
 	inline const dtQueryFilter* getFilter(const int i) const { return (i >= 0 && i < DT_CROWD_MAX_QUERY_FILTER_TYPE) ? &m_filters[i] : 0; }
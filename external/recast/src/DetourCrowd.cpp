@@ -343,8 +343,13 @@ dtCrowd::dtCrowd() :
 	m_maxPathResult(0),
 	m_maxAgentRadius(0),
 	m_velocitySampleCount(0),
-	m_navquery(0)
+	m_navquery(0),
+	m_parallelFor(0),
+	m_parallelForUserData(0),
+	m_maxBatches(1)
 {
+	memset(m_batchObstacleQueries, 0, sizeof(m_batchObstacleQueries));
+	memset(m_batchVelocitySampleCounts, 0, sizeof(m_batchVelocitySampleCounts));
 }
 
 dtCrowd::~dtCrowd()
@@ -374,6 +379,10 @@ void dtCrowd::purge()
 
 	dtFreeObstacleAvoidanceQuery(m_obstacleQuery);
 	m_obstacleQuery = 0;
+
+	freeBatchObstacleQueries();
+	m_parallelFor = 0;
+	m_parallelForUserData = 0;
 	
 	dtFreeNavMeshQuery(m_navquery);
 	m_navquery = 0;
@@ -666,6 +675,75 @@ bool dtCrowd::resetMoveTarget(const int idx)
 	return true;
 }
 
+/// @par
+///
+/// The agent could move while the path was being searched. Polygons it already passed are skipped,
+/// or its corridor is prepended if it did not reach the start of the path yet. If the agent left
+/// both, the target is requested the same way as #requestMoveTarget() does.
+///
+/// The position is constrained to the last polygon if the path does not reach @p ref.
+bool dtCrowd::setMoveTargetPath(const int idx, dtPolyRef ref, const float* pos, const dtPolyRef* path, const int npath)
+{
+	if (idx < 0 || idx >= m_maxAgents)
+		return false;
+	if (!ref || npath <= 0)
+		return false;
+
+	dtCrowdAgent* ag = &m_agents[idx];
+	const dtPolyRef* cur = ag->corridor.getPath();
+	const int ncur = ag->corridor.getPathCount();
+	if (!ncur)
+		return false;
+
+	dtPolyRef* res = m_pathResult;
+	int nres = 0;
+	for (int i = 0; i < npath; ++i)
+	{
+		if (path[i] == cur[0])
+		{
+			nres = dtMin(npath - i, m_maxPathResult);
+			memcpy(res, path + i, sizeof(dtPolyRef) * nres);
+			break;
+		}
+	}
+	if (!nres)
+	{
+		for (int i = 1; i < ncur; ++i)
+		{
+			if (cur[i] == path[0])
+			{
+				nres = dtMin(i + npath, m_maxPathResult);
+				memcpy(res, cur, sizeof(dtPolyRef) * i);
+				memcpy(res + i, path, sizeof(dtPolyRef) * (nres - i));
+				break;
+			}
+		}
+	}
+	if (!nres)
+		return requestMoveTarget(idx, ref, pos);
+
+	float target[3];
+	dtVcopy(target, pos);
+	if (res[nres-1] != ref)
+	{
+		if (dtStatusFailed(m_navquery->closestPointOnPoly(res[nres-1], pos, target, 0)))
+			return requestMoveTarget(idx, ref, pos);
+	}
+
+	ag->targetRef = ref;
+	dtVcopy(ag->targetPos, pos);
+	ag->targetPathqRef = DT_PATHQ_INVALID;
+	ag->targetReplan = false;
+	ag->corridor.setCorridor(target, res, nres);
+	// Force to update boundary.
+	ag->boundary.reset();
+	ag->partial = res[nres-1] != ref;
+	ag->targetState = DT_CROWDAGENT_TARGET_VALID;
+	ag->targetReplanTime = 0.0;
+
+	return true;
+}
+
 int dtCrowd::getActiveAgents(dtCrowdAgent** agents, const int maxAgents)
 {
 	int n = 0;
@@ -1057,8 +1135,6 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 {
 	m_velocitySampleCount = 0;
 	
-	const int debugIdx = debug ? debug->idx : -1;
-	
 	dtCrowdAgent** agents = m_activeAgents;
 	int nagents = getActiveAgents(agents, m_maxAgents);
 	m_numActiveAgents = nagents;
@@ -1082,7 +1158,8 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 		m_grid->addItem((unsigned short)i, p[0]-r, p[2]-r, p[0]+r, p[2]+r);
 	}
 	
-	// Get nearby navmesh segments and agents to collide with.
+	// Get nearby navmesh segments to collide with.
+	// The boundary queries use the shared navquery's node pool, so they stay serial.
 	for (int i = 0; i < nagents; ++i)
 	{
 		dtCrowdAgent* ag = agents[i];
@@ -1098,52 +1175,13 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 			ag->boundary.update(ag->corridor.getFirstPoly(), ag->npos, ag->params.collisionQueryRange,
 								m_navquery, &m_filters[ag->params.queryFilterType]);
 		}
-		// Query neighbour agents
-		ag->nneis = getNeighbours(ag->npos, ag->params.height, ag->params.collisionQueryRange,
-								  ag, ag->neis, DT_CROWDAGENT_MAX_NEIGHBOURS,
-								  agents, nagents, m_grid);
-		for (int j = 0; j < ag->nneis; j++)
-			ag->neis[j].idx = getAgentIndex(agents[ag->neis[j].idx]);
 	}
+
+	// Query neighbour agents.
+	runBatches(PHASE_NEIGHBOURS, agents, nagents, dt, debug);
 	
 	// Find next corner to steer to.
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-			continue;
-		
-		// Find corners for steering
-		ag->ncorners = ag->corridor.findCorners(ag->cornerVerts, ag->cornerFlags, ag->cornerPolys,
-												DT_CROWDAGENT_MAX_CORNERS, m_navquery, &m_filters[ag->params.queryFilterType]);
-		
-		// Check to see if the corner after the next corner is directly visible,
-		// and short cut to there.
-		if ((ag->params.updateFlags & DT_CROWD_OPTIMIZE_VIS) && ag->ncorners > 0)
-		{
-			const float* target = &ag->cornerVerts[dtMin(1,ag->ncorners-1)*3];
-			ag->corridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, m_navquery, &m_filters[ag->params.queryFilterType]);
-			
-			// Copy data for debug purposes.
-			if (debugIdx == i)
-			{
-				dtVcopy(debug->optStart, ag->corridor.getPos());
-				dtVcopy(debug->optEnd, target);
-			}
-		}
-		else
-		{
-			// Copy data for debug purposes.
-			if (debugIdx == i)
-			{
-				dtVset(debug->optStart, 0,0,0);
-				dtVset(debug->optEnd, 0,0,0);
-			}
-		}
-	}
+	runBatches(PHASE_CORNERS, agents, nagents, dt, debug);
 	
 	// Trigger off-mesh connections (depends on corners).
 	for (int i = 0; i < nagents; ++i)
@@ -1187,156 +1225,290 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 	}
 		
 	// Calculate steering.
-	for (int i = 0; i < nagents; ++i)
+	runBatches(PHASE_STEERING, agents, nagents, dt, debug);
+	
+	// Velocity planning.	
+	runBatches(PHASE_VELOCITY_PLANNING, agents, nagents, dt, debug);
+
+	// Integrate.
+	runBatches(PHASE_INTEGRATE, agents, nagents, dt, debug);
+
+	// Handle collisions.
+	for (int iter = 0; iter < 4; ++iter)
 	{
-		dtCrowdAgent* ag = agents[i];
+		runBatches(PHASE_COLLISION_DISP, agents, nagents, dt, debug);
+		runBatches(PHASE_COLLISION_APPLY, agents, nagents, dt, debug);
+	}
+}
 
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE)
-			continue;
-		
-		float dvel[3] = {0,0,0};
+/// @par
+///
+/// Agents are split into contiguous ranges and each range only writes to its own agents
+/// (and its own obstacle query), so the results are the same as with a single batch.
+void dtCrowd::runBatches(const BatchPhase phase, dtCrowdAgent** agents, const int nagents, const float dt, dtCrowdAgentDebugInfo* debug)
+{
+	static const int MIN_AGENTS_PER_BATCH = 32;
+	int nbatches = (nagents + MIN_AGENTS_PER_BATCH - 1) / MIN_AGENTS_PER_BATCH;
+	nbatches = dtClamp(nbatches, 1, m_parallelFor ? m_maxBatches : 1);
+	
+	if (phase == PHASE_VELOCITY_PLANNING)
+		memset(m_batchVelocitySampleCounts, 0, sizeof(m_batchVelocitySampleCounts));
 
-		if (ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+	if (nbatches == 1)
+	{
+		updateBatch(phase, 0, agents, 0, nagents, nagents, dt, debug);
+	}
+	else
+	{
+		struct Batches
 		{
-			dtVcopy(dvel, ag->targetPos);
-			ag->desiredSpeed = dtVlen(ag->targetPos);
-		}
-		else
+			dtCrowd* crowd;
+			BatchPhase phase;
+			dtCrowdAgent** agents;
+			int nagents;
+			int nbatches;
+			float dt;
+			dtCrowdAgentDebugInfo* debug;
+
+			static void run(void* data, const int batch)
+			{
+				const Batches* b = (const Batches*)data;
+				const int from = (int)((long long)b->nagents * batch / b->nbatches);
+				const int to = (int)((long long)b->nagents * (batch + 1) / b->nbatches);
+				b->crowd->updateBatch(b->phase, batch, b->agents, from, to, b->nagents, b->dt, b->debug);
+			}
+		};
+		Batches batches = { this, phase, agents, nagents, nbatches, dt, debug };
+		m_parallelFor(m_parallelForUserData, nbatches, &Batches::run, &batches);
+	}
+
+	if (phase == PHASE_VELOCITY_PLANNING)
+	{
+		for (int i = 0; i < nbatches; ++i)
+			m_velocitySampleCount += m_batchVelocitySampleCounts[i];
+	}
+}
+
+void dtCrowd::updateBatch(const BatchPhase phase, const int batch, dtCrowdAgent** agents, const int from, const int to,
+						  const int nagents, const float dt, dtCrowdAgentDebugInfo* debug)
+{
+	const int debugIdx = debug ? debug->idx : -1;
+
+	switch (phase)
+	{
+	case PHASE_NEIGHBOURS:
+		for (int i = from; i < to; ++i)
 		{
-			// Calculate steering direction.
-			if (ag->params.updateFlags & DT_CROWD_ANTICIPATE_TURNS)
-				calcSmoothSteerDirection(ag, dvel);
-			else
-				calcStraightSteerDirection(ag, dvel);
-			
-			// Calculate speed scale, which tells the agent to slowdown at the end of the path.
-			const float slowDownRadius = 0.5f * ag->params.maxSpeed * ag->params.maxSpeed / ag->params.maxAcceleration;
-			const float speedScale = getDistanceToGoal(ag, slowDownRadius) / slowDownRadius;
-				
-			ag->desiredSpeed = ag->params.maxSpeed;
-			dtVscale(dvel, dvel, ag->desiredSpeed * speedScale);
+			dtCrowdAgent* ag = agents[i];
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+
+			ag->nneis = getNeighbours(ag->npos, ag->params.height, ag->params.collisionQueryRange,
+									  ag, ag->neis, DT_CROWDAGENT_MAX_NEIGHBOURS,
+									  agents, nagents, m_grid);
+			for (int j = 0; j < ag->nneis; j++)
+				ag->neis[j].idx = getAgentIndex(agents[ag->neis[j].idx]);
 		}
+		break;
 
-		// Separation
-		if (ag->params.updateFlags & DT_CROWD_SEPARATION)
+	case PHASE_CORNERS:
+		// findCorners and optimizePathVisibility only read the navmesh, so they are safe to run concurrently.
+		for (int i = from; i < to; ++i)
 		{
-			const float separationDist = ag->params.collisionQueryRange; 
-			const float invSeparationDist = 1.0f / separationDist; 
-			const float separationWeight = ag->params.separationWeight;
+			dtCrowdAgent* ag = agents[i];
 			
-			float w = 0;
-			float disp[3] = {0,0,0};
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+				continue;
 			
-			for (int j = 0; j < ag->nneis; ++j)
+			// Find corners for steering
+			ag->ncorners = ag->corridor.findCorners(ag->cornerVerts, ag->cornerFlags, ag->cornerPolys,
+													DT_CROWDAGENT_MAX_CORNERS, m_navquery, &m_filters[ag->params.queryFilterType]);
+			
+			// Check to see if the corner after the next corner is directly visible,
+			// and short cut to there.
+			if ((ag->params.updateFlags & DT_CROWD_OPTIMIZE_VIS) && ag->ncorners > 0)
 			{
-				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
-				
-				float diff[3];
-				dtVsub(diff, ag->npos, nei->npos);
-				diff[1] = 0;
-				
-				const float distSqr = dtVlenSqr(diff);
-				if (distSqr < 0.00001f)
-					continue;
-				if (distSqr > dtSqr(separationDist))
-					continue;
-				const float dist = dtMathSqrtf(distSqr);
-				const float weight = separationWeight * (1.0f - dtSqr(dist*invSeparationDist));
+				const float* target = &ag->cornerVerts[dtMin(1,ag->ncorners-1)*3];
+				ag->corridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, m_navquery, &m_filters[ag->params.queryFilterType]);
 				
-				dtVmad(disp, disp, diff, weight/dist);
-				w += 1.0f;
+				// Copy data for debug purposes.
+				if (debugIdx == i)
+				{
+					dtVcopy(debug->optStart, ag->corridor.getPos());
+					dtVcopy(debug->optEnd, target);
+				}
 			}
-			
-			if (w > 0.0001f)
+			else
 			{
-				// Adjust desired velocity.
-				dtVmad(dvel, dvel, disp, 1.0f/w);
-				// Clamp desired velocity to desired speed.
-				const float speedSqr = dtVlenSqr(dvel);
-				const float desiredSqr = dtSqr(ag->desiredSpeed);
-				if (speedSqr > desiredSqr)
-					dtVscale(dvel, dvel, desiredSqr/speedSqr);
+				// Copy data for debug purposes.
+				if (debugIdx == i)
+				{
+					dtVset(debug->optStart, 0,0,0);
+					dtVset(debug->optEnd, 0,0,0);
+				}
 			}
 		}
-		
-		// Set the desired velocity.
-		dtVcopy(ag->dvel, dvel);
-	}
-	
-	// Velocity planning.	
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		
-		if (ag->params.updateFlags & DT_CROWD_OBSTACLE_AVOIDANCE)
+		break;
+
+	case PHASE_STEERING:
+		for (int i = from; i < to; ++i)
 		{
-			m_obstacleQuery->reset();
+			dtCrowdAgent* ag = agents[i];
+
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			if (ag->targetState == DT_CROWDAGENT_TARGET_NONE)
+				continue;
 			
-			// Add neighbours as obstacles.
-			for (int j = 0; j < ag->nneis; ++j)
+			float dvel[3] = {0,0,0};
+
+			if (ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
 			{
-				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
-				m_obstacleQuery->addCircle(nei->npos, nei->params.radius, nei->vel, nei->dvel);
+				dtVcopy(dvel, ag->targetPos);
+				ag->desiredSpeed = dtVlen(ag->targetPos);
+			}
+			else
+			{
+				// Calculate steering direction.
+				if (ag->params.updateFlags & DT_CROWD_ANTICIPATE_TURNS)
+					calcSmoothSteerDirection(ag, dvel);
+				else
+					calcStraightSteerDirection(ag, dvel);
+				
+				// Calculate speed scale, which tells the agent to slowdown at the end of the path.
+				const float slowDownRadius = 0.5f * ag->params.maxSpeed * ag->params.maxSpeed / ag->params.maxAcceleration;
+				const float speedScale = getDistanceToGoal(ag, slowDownRadius) / slowDownRadius;
+					
+				ag->desiredSpeed = ag->params.maxSpeed;
+				dtVscale(dvel, dvel, ag->desiredSpeed * speedScale);
 			}
 
-			// Append neighbour segments as obstacles.
-			for (int j = 0; j < ag->boundary.getSegmentCount(); ++j)
+			// Separation
+			if (ag->params.updateFlags & DT_CROWD_SEPARATION)
 			{
-				const float* s = ag->boundary.getSegment(j);
-				if (dtTriArea2D(ag->npos, s, s+3) < 0.0f)
-					continue;
-				m_obstacleQuery->addSegment(s, s+3);
+				const float separationDist = ag->params.collisionQueryRange; 
+				const float invSeparationDist = 1.0f / separationDist; 
+				const float separationWeight = ag->params.separationWeight;
+				
+				float w = 0;
+				float disp[3] = {0,0,0};
+				
+				for (int j = 0; j < ag->nneis; ++j)
+				{
+					const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+					
+					float diff[3];
+					dtVsub(diff, ag->npos, nei->npos);
+					diff[1] = 0;
+					
+					const float distSqr = dtVlenSqr(diff);
+					if (distSqr < 0.00001f)
+						continue;
+					if (distSqr > dtSqr(separationDist))
+						continue;
+					const float dist = dtMathSqrtf(distSqr);
+					const float weight = separationWeight * (1.0f - dtSqr(dist*invSeparationDist));
+					
+					dtVmad(disp, disp, diff, weight/dist);
+					w += 1.0f;
+				}
+				
+				if (w > 0.0001f)
+				{
+					// Adjust desired velocity.
+					dtVmad(dvel, dvel, disp, 1.0f/w);
+					// Clamp desired velocity to desired speed.
+					const float speedSqr = dtVlenSqr(dvel);
+					const float desiredSqr = dtSqr(ag->desiredSpeed);
+					if (speedSqr > desiredSqr)
+						dtVscale(dvel, dvel, desiredSqr/speedSqr);
+				}
 			}
+			
+			// Set the desired velocity.
+			dtVcopy(ag->dvel, dvel);
+		}
+		break;
 
-			dtObstacleAvoidanceDebugData* vod = 0;
-			if (debugIdx == i) 
-				vod = debug->vod;
+	case PHASE_VELOCITY_PLANNING:
+	{
+		// Each batch samples with its own query, the query keeps state between addCircle and sampleVelocity.
+		dtObstacleAvoidanceQuery* obstacleQuery = batch == 0 ? m_obstacleQuery : m_batchObstacleQueries[batch];
+		for (int i = from; i < to; ++i)
+		{
+			dtCrowdAgent* ag = agents[i];
+			
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
 			
-			// Sample new safe velocity.
-			bool adaptive = true;
-int ns = 0;
+			if (ag->params.updateFlags & DT_CROWD_OBSTACLE_AVOIDANCE)
+			{
+				obstacleQuery->reset();
+				
+				// Add neighbours as obstacles.
+				for (int j = 0; j < ag->nneis; ++j)
+				{
+					const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+					obstacleQuery->addCircle(nei->npos, nei->params.radius, nei->vel, nei->dvel);
+				}
 
-const dtObstacleAvoidanceParams* params = &m_obstacleQueryParams[ag->params.obstacleAvoidanceType];
+				// Append neighbour segments as obstacles.
+				for (int j = 0; j < ag->boundary.getSegmentCount(); ++j)
+				{
+					const float* s = ag->boundary.getSegment(j);
+					if (dtTriArea2D(ag->npos, s, s+3) < 0.0f)
+						continue;
+					obstacleQuery->addSegment(s, s+3);
+				}
 
-if (adaptive)
-{
-	ns = m_obstacleQuery->sampleVelocityAdaptive(ag->npos, ag->params.radius, ag->desiredSpeed,
-		ag->vel, ag->dvel, ag->nvel, params, vod);
-}
-else
-{
-	ns = m_obstacleQuery->sampleVelocityGrid(ag->npos, ag->params.radius, ag->desiredSpeed,
-		ag->vel, ag->dvel, ag->nvel, params, vod);
-}
-m_velocitySampleCount += ns;
+				dtObstacleAvoidanceDebugData* vod = 0;
+				if (debugIdx == i) 
+					vod = debug->vod;
+				
+				// Sample new safe velocity.
+				bool adaptive = true;
+				int ns = 0;
+
+				const dtObstacleAvoidanceParams* params = &m_obstacleQueryParams[ag->params.obstacleAvoidanceType];
+
+				if (adaptive)
+				{
+					ns = obstacleQuery->sampleVelocityAdaptive(ag->npos, ag->params.radius, ag->desiredSpeed,
+						ag->vel, ag->dvel, ag->nvel, params, vod);
+				}
+				else
+				{
+					ns = obstacleQuery->sampleVelocityGrid(ag->npos, ag->params.radius, ag->desiredSpeed,
+						ag->vel, ag->dvel, ag->nvel, params, vod);
+				}
+				m_batchVelocitySampleCounts[batch] += ns;
+			}
+			else
+			{
+				// If not using velocity planning, new velocity is directly the desired velocity.
+				dtVcopy(ag->nvel, ag->dvel);
+			}
 		}
-		else
+		break;
+	}
+
+	case PHASE_INTEGRATE:
+		for (int i = from; i < to; ++i)
 		{
-			// If not using velocity planning, new velocity is directly the desired velocity.
-			dtVcopy(ag->nvel, ag->dvel);
+			dtCrowdAgent* ag = agents[i];
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			integrate(ag, dt);
 		}
-	}
+		break;
 
-	// Integrate.
-	for (int i = 0; i < nagents; ++i)
+	case PHASE_COLLISION_DISP:
 	{
-		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		integrate(ag, dt);
-	}
-
-	// Handle collisions.
-	static const float COLLISION_RESOLVE_FACTOR = 0.7f;
+		static const float COLLISION_RESOLVE_FACTOR = 0.7f;
 
-	for (int iter = 0; iter < 4; ++iter)
-	{
-		for (int i = 0; i < nagents; ++i)
+		for (int i = from; i < to; ++i)
 		{
 			dtCrowdAgent* ag = agents[i];
 			const int idx0 = getAgentIndex(ag);
@@ -1387,8 +1559,11 @@ m_velocitySampleCount += ns;
 				dtVscale(ag->disp, ag->disp, iw);
 			}
 		}
+		break;
+	}
 
-		for (int i = 0; i < nagents; ++i)
+	case PHASE_COLLISION_APPLY:
+		for (int i = from; i < to; ++i)
 		{
 			dtCrowdAgent* ag = agents[i];
 			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
@@ -1396,9 +1571,40 @@ m_velocitySampleCount += ns;
 
 			dtVadd(ag->npos, ag->npos, ag->disp);
 		}
+		break;
+	}
+}
+
+bool dtCrowd::setParallelFor(dtCrowdParallelForFunc* func, void* userData, const int maxBatches)
+{
+	freeBatchObstacleQueries();
+
+	m_parallelFor = func;
+	m_parallelForUserData = userData;
+	m_maxBatches = func ? dtClamp(maxBatches, 1, DT_CROWD_MAX_BATCHES) : 1;
+
+	// Batch 0 uses m_obstacleQuery.
+	for (int i = 1; i < m_maxBatches; ++i)
+	{
+		m_batchObstacleQueries[i] = dtAllocObstacleAvoidanceQuery();
+		if (!m_batchObstacleQueries[i] || !m_batchObstacleQueries[i]->init(6, 8))
+		{
+			freeBatchObstacleQueries();
+			return false;
+		}
 	}
+	return true;
 }
 
+void dtCrowd::freeBatchObstacleQueries()
+{
+	for (int i = 0; i < DT_CROWD_MAX_BATCHES; ++i)
+	{
+		dtFreeObstacleAvoidanceQuery(m_batchObstacleQueries[i]);
+		m_batchObstacleQueries[i] = 0;
+	}
+	m_maxBatches = 1;
+}
 
 void dtCrowd::doMove(float dt)
 {
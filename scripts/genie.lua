@@ -53,6 +53,11 @@ newoption {
 	description = "Do build app."
 }
 
+newoption {
+	trigger = "with-bench",
+	description = "Build microbenchmarks of core containers and allocators and gpu_replay tool."
+}
+
 newoption {
 	trigger = "with-basis-universal",
 	description = "Use basis universal compression."
@@ -78,6 +83,11 @@ newoption {
 	description = "Arguments passed to Studio in release mode."
 }
 
+newoption {
+	trigger = "with-avx2",
+	description = "Target CPUs with AVX2, enables 8-wide SIMD paths."
+}
+
 newoption {
 	trigger = "no-studio",
 	description = "Do not build Studio."
@@ -111,12 +121,14 @@ newoption {
 -- process _OPTIONS
 build_studio = not _OPTIONS["no-studio"]
 build_app = _OPTIONS["with-app"] or false
+build_bench = _OPTIONS["with-bench"] or false
 local embed_resources = _OPTIONS["embed-resources"]
 local working_dir = _OPTIONS["working-dir"]
 local debug_args = _OPTIONS["debug-args"]
 local release_args = _OPTIONS["release-args"]
 local luau_dynamic = _OPTIONS["luau-dynamic"]
 local use_basisu =  _OPTIONS["with-basis-universal"]
+local use_avx2 = _OPTIONS["with-avx2"]
 local dynamic_plugins = _OPTIONS["dynamic-plugins"]
 local split_projects = _OPTIONS["split-projects"] or dynamic_plugins
 local build_luau = os.isdir("../external/_repos/luau")
@@ -324,6 +336,14 @@ solution "LumixEngine"
 		removefiles { "../src/**/editor/*" }
 	end
 
+	if use_avx2 then
+		configuration { "vs*" }
+			buildoptions { "/arch:AVX2" }
+		configuration { "not vs*" }
+			buildoptions { "-mavx2", "-mfma" }
+		configuration {}
+	end
+
 	if "windows-clang" == _OPTIONS["gcc"] then
 		removeflags { "LinkSupportCircularDependencies"}
 		buildoptions { 
@@ -525,7 +545,7 @@ if plugin "audio" then
 	dynamic_link_plugin { "core", "engine" }
 
 	configuration "windows"
-		links { "dxguid" }
+		links { "ole32" }
 end
 
 if plugin "navigation" then
@@ -703,6 +723,56 @@ if build_app then
 		end
 end
 
+if build_bench then
+	exe_project "bench"
+		kind "ConsoleApp"
+		defaultConfigurations()
+		includedirs { "../src", "../external" }
+		files { "../src/bench/main.cpp" }
+		debugdir "../"
+
+		if split_projects then
+			links { "core", "engine" }
+		else
+			links { "engine_merged" }
+		end
+
+		configuration { "vs*" }
+			links { "winmm" }
+
+		configuration { "linux" }
+			links { "dl", "X11", "rt", "Xi" }
+		configuration {}
+
+	-- replays frames captured with -gpu_capture, see renderer/draw_stream_capture.h
+	if hasPlugin "renderer" then
+		exe_project "gpu_replay"
+			kind "ConsoleApp"
+			defaultConfigurations()
+			includedirs { "../src", "../external" }
+			files { "../src/gpu_replay/main.cpp" }
+			debugdir "../data"
+			libdirs { "../external/pix/bin/x64" }
+
+			if split_projects then
+				links { "core", "engine", "renderer" }
+			else
+				links { "engine_merged" }
+				if hasPlugin "lua" then linkLib "Luau" end
+				if hasPlugin "physics" then linkPhysX() end
+				if use_basisu then linkLib "basisu" end
+			end
+			linkLib "freetype"
+
+			configuration { "vs*" }
+				links { "winmm", "psapi", "dxguid" }
+
+			configuration { "linux" }
+				links { "dl", "GL", "X11", "rt", "Xi" }
+			configuration {}
+	end
+end
+
 if build_studio then
 	lib_project "editor"
 		libType()
@@ -12,10 +12,28 @@
 namespace Lumix
 {
 
+void BoneMask::serialize(OutputMemoryStream& stream) const {
+	stream.writeString(name);
+	stream.write((u32)bones.size());
+	for (auto iter = bones.begin(), end = bones.end(); iter != end; ++iter) {
+		stream.write(iter.key().getHashValue());
+	}
+}
+
+void BoneMask::deserialize(InputMemoryStream& stream) {
+	name = stream.readString();
+	bones.clear();
+	const u32 count = stream.read<u32>();
+	for (u32 i = 0; i < count; ++i) {
+		bones.insert(BoneNameHash::fromU64(stream.read<u64>()), 1);
+	}
+}
+
 Animation::Animation(const Path& path, ResourceManager& resource_manager, IAllocator& allocator)
 	: Resource(path, resource_manager, allocator)
 	, m_allocator(allocator, m_path.c_str())
 	, m_mem(m_allocator)
+	, m_segment_tracks(m_allocator)
 	, m_translations(m_allocator)
 	, m_const_translations(m_allocator)
 	, m_rotations(m_allocator)
@@ -53,8 +71,9 @@ struct AnimationSampler {
 		if (anim.m_max_accessed_bone_index >= pose.count) return; // can happen if skeletons do not match
 		const Model& model = *ctx.model;
 		const Time time = ctx.time;
-		//const BoneMask* mask = ctx.mask;
+		const u64* mask = ctx.mask;
 		const float weight = ctx.weight;
+		const u32 min_bone_height = ctx.min_bone_height;
 
 		ASSERT(!pose.is_absolute);
 		ASSERT(model.isReady());
@@ -68,10 +87,10 @@ struct AnimationSampler {
 		
 		for (u32 i = 0, c = anim.m_const_translations.size(); i < c; ++i) {
 			const Animation::ConstTranslationTrack& track = anim.m_const_translations[i];
+			if (min_bone_height > 0 && model.getBone(track.bone_index).height < min_bone_height) continue;
 
 			if constexpr(use_mask) {
-				ASSERT(false);
-				//if (mask->bones.find(track.) == mask->bones.end()) continue;
+				if (!(mask[track.bone_index >> 6] & (u64(1) << (track.bone_index & 63)))) continue;
 			}
 
 			if constexpr (use_weight) {
@@ -82,30 +101,41 @@ struct AnimationSampler {
 			}
 		}
 
-		for (u32 i = 0, c = anim.m_translations.size(); i < c; ++i) {
-			const Animation::TranslationTrack& track = anim.m_translations[i];
-
-			if constexpr(use_mask) {
-				ASSERT(false);
-				//if (mask->bones.find(track.) == mask->bones.end()) continue;
+		// animated tracks are decoded in batches, interpolation and blending of a batch is SIMD, see lerp(const Vec3*, ...)
+		constexpr u32 BATCH_SIZE = 16;
+		u16 bone_indices[BATCH_SIZE];
+
+		Vec3 pos0[BATCH_SIZE];
+		Vec3 pos1[BATCH_SIZE];
+		for (u32 i = 0, c = anim.m_translations.size(); i < c;) {
+			u32 n = 0;
+			for (; i < c && n < BATCH_SIZE; ++i) {
+				const Animation::TranslationTrack& track = anim.m_translations[i];
+				if (min_bone_height > 0 && model.getBone(track.bone_index).height < min_bone_height) continue;
+
+				if constexpr(use_mask) {
+					if (!(mask[track.bone_index >> 6] & (u64(1) << (track.bone_index & 63)))) continue;
+				}
+
+				bone_indices[n] = track.bone_index;
+				anim.getTranslations(sample_idx, track, pos0[n], pos1[n]);
+				++n;
 			}
 
-			Vec3 anim_pos = lerp(anim.getTranslation(sample_idx, track), anim.getTranslation(sample_idx + 1, track), t);
-
+			lerp(pos0, pos1, pos0, n, t);
 			if constexpr (use_weight) {
-				pos[track.bone_index] = lerp(pos[track.bone_index], anim_pos, weight);
-			}
-			else {
-				pos[track.bone_index] = anim_pos;
+				for (u32 j = 0; j < n; ++j) pos1[j] = pos[bone_indices[j]];
+				lerp(pos1, pos0, pos0, n, weight);
 			}
+			for (u32 j = 0; j < n; ++j) pos[bone_indices[j]] = pos0[j];
 		}
 
 		for (u32 i = 0, c = anim.m_const_rotations.size(); i < c; ++i) {
 			const Animation::ConstRotationTrack& track = anim.m_const_rotations[i];
+			if (min_bone_height > 0 && model.getBone(track.bone_index).height < min_bone_height) continue;
 
 			if constexpr(use_mask) {
-				ASSERT(false);
-				//if (mask->bones.find(track.) == mask->bones.end()) continue;
+				if (!(mask[track.bone_index >> 6] & (u64(1) << (track.bone_index & 63)))) continue;
 			}
 
 			if constexpr (use_weight) {
@@ -116,21 +146,28 @@ struct AnimationSampler {
 			}
 		}
 
-		for (u32 i = 0, c = anim.m_rotations.size(); i < c; ++i) {
-			const Animation::RotationTrack& track = anim.m_rotations[i];
-			if constexpr(use_mask) {
-				ASSERT(false);
-				//if (mask->bones.find(track.) == mask->bones.end()) continue;
+		Quat rot0[BATCH_SIZE];
+		Quat rot1[BATCH_SIZE];
+		for (u32 i = 0, c = anim.m_rotations.size(); i < c;) {
+			u32 n = 0;
+			for (; i < c && n < BATCH_SIZE; ++i) {
+				const Animation::RotationTrack& track = anim.m_rotations[i];
+				if (min_bone_height > 0 && model.getBone(track.bone_index).height < min_bone_height) continue;
+				if constexpr(use_mask) {
+					if (!(mask[track.bone_index >> 6] & (u64(1) << (track.bone_index & 63)))) continue;
+				}
+
+				bone_indices[n] = track.bone_index;
+				anim.getRotations(sample_idx, track, rot0[n], rot1[n]);
+				++n;
 			}
 
-			Quat anim_rot = nlerp(anim.getRotation(sample_idx, track), anim.getRotation(sample_idx + 1, track), t);
-
+			nlerp(rot0, rot1, rot0, n, t);
 			if constexpr (use_weight) {
-				rot[track.bone_index] = nlerp(rot[track.bone_index], anim_rot, weight);
-			}
-			else {
-				rot[track.bone_index] = anim_rot;
+				for (u32 j = 0; j < n; ++j) rot1[j] = rot[bone_indices[j]];
+				nlerp(rot1, rot0, rot0, n, weight);
 			}
+			for (u32 j = 0; j < n; ++j) rot[bone_indices[j]] = rot0[j];
 		}
 	}
 }; // AnimationSampler
@@ -241,48 +278,65 @@ void Animation::getRelativePose(const SampleContext& ctx) {
 	}
 }
 
-static float unpackChannel(u64 val, float min, float to_float_range, u32 bitsize) {
-	if (bitsize == 0) return min;
+static LUMIX_FORCE_INLINE float decodeChannel(u64 packed, float min, float range, u8 range_min, u8 range_extent, u32 bitsize) {
+	if (bitsize == 0) return min + range * (range_min * (1 / 255.f));
 	const u64 mask = (u64(1) << bitsize) - 1;
-	return float(min + to_float_range * double(val & mask));
+	const float normalized = (range_min + range_extent * (float(packed & mask) / float(mask))) * (1 / 255.f);
+	return min + range * normalized;
 }
 
-Vec3 Animation::getTranslation(u32 frame, const TranslationTrack& track) const {
+void Animation::locate(u32 frame, u32& segment, u32& local_frame, u32& segment_length) const {
+	segment = minimum(frame / SEGMENT_FRAMES, m_segments_count - 1);
+	local_frame = frame - segment * SEGMENT_FRAMES;
+	segment_length = minimum(SEGMENT_FRAMES, m_frame_count - segment * SEGMENT_FRAMES);
+}
+
+const Animation::SegmentTrack& Animation::getSegmentTrack(u32 segment, const TranslationTrack& track) const {
 	ASSERT(&track >= m_translations.begin() && &track < m_translations.end());
-	if (u32(&track - m_translations.begin()) == m_root_motion.translation_track_idx) return m_root_motion.pose_translations[frame];
-	const u32 offset = m_translations_frame_size_bits * frame + track.offset_bits;
+	const u32 tracks_count = m_translations.size() + m_rotations.size();
+	return m_segment_tracks[segment * tracks_count + u32(&track - m_translations.begin())];
+}
+
+const Animation::SegmentTrack& Animation::getSegmentTrack(u32 segment, const RotationTrack& track) const {
+	ASSERT(&track >= m_rotations.begin() && &track < m_rotations.end());
+	const u32 tracks_count = m_translations.size() + m_rotations.size();
+	return m_segment_tracks[segment * tracks_count + m_translations.size() + u32(&track - m_rotations.begin())];
+}
+
+Vec3 Animation::decodeTranslation(const SegmentTrack& st, const TranslationTrack& track, u32 key) const {
+	const u32 key_bits = st.bitsizes[0] + st.bitsizes[1] + st.bitsizes[2];
+	const u32 offset = st.offset_bits + key * key_bits;
 
 	u64 tmp;
-	memcpy(&tmp, &m_translation_stream[offset / 8], sizeof(tmp));
+	memcpy(&tmp, &m_mem[offset / 8], sizeof(tmp));
 	tmp >>= offset & 7;
 
 	Vec3 res;
-	res.x = unpackChannel(tmp, track.min.x, track.to_range.x, track.bitsizes[0]);
-	tmp >>= track.bitsizes[0];
-	res.y = unpackChannel(tmp, track.min.y, track.to_range.y, track.bitsizes[1]);
-	tmp >>= track.bitsizes[1];
-	res.z = unpackChannel(tmp, track.min.z, track.to_range.z, track.bitsizes[2]);
+	res.x = decodeChannel(tmp, track.min.x, track.range.x, st.range_min[0], st.range_extent[0], st.bitsizes[0]);
+	tmp >>= st.bitsizes[0];
+	res.y = decodeChannel(tmp, track.min.y, track.range.y, st.range_min[1], st.range_extent[1], st.bitsizes[1]);
+	tmp >>= st.bitsizes[1];
+	res.z = decodeChannel(tmp, track.min.z, track.range.z, st.range_min[2], st.range_extent[2], st.bitsizes[2]);
 	return res;
 }
 
-Quat Animation::getRotation(u32 frame, const RotationTrack& track) const {
-	ASSERT(&track >= m_rotations.begin() && &track < m_rotations.end());
-	if (&track - m_rotations.begin() == m_root_motion.rotation_track_idx) return m_root_motion.pose_rotations[frame];
-	const u32 offset = m_rotations_frame_size_bits * frame + track.offset_bits;
+Quat Animation::decodeRotation(const SegmentTrack& st, const RotationTrack& track, u32 key) const {
+	const u32 key_bits = st.bitsizes[0] + st.bitsizes[1] + st.bitsizes[2] + 1/*sign bit*/;
+	const u32 offset = st.offset_bits + key * key_bits;
 
 	u64 packed;
-	memcpy(&packed, &m_rotation_stream[offset / 8], sizeof(packed));
+	memcpy(&packed, &m_mem[offset / 8], sizeof(packed));
 	packed >>= offset & 7;
 
 	bool is_negative = packed & 1;
 	packed >>= 1;
 	Vec3 v3;
 
-	v3.x = unpackChannel(packed, track.min.x, track.to_range.x, track.bitsizes[0]);
-	packed >>= track.bitsizes[0];
-	v3.y = unpackChannel(packed, track.min.y, track.to_range.y, track.bitsizes[1]);
-	packed >>= track.bitsizes[1];
-	v3.z = unpackChannel(packed, track.min.z, track.to_range.z, track.bitsizes[2]);
+	v3.x = decodeChannel(packed, track.min.x, track.range.x, st.range_min[0], st.range_extent[0], st.bitsizes[0]);
+	packed >>= st.bitsizes[0];
+	v3.y = decodeChannel(packed, track.min.y, track.range.y, st.range_min[1], st.range_extent[1], st.bitsizes[1]);
+	packed >>= st.bitsizes[1];
+	v3.z = decodeChannel(packed, track.min.z, track.range.z, st.range_min[2], st.range_extent[2], st.bitsizes[2]);
 	float skipped = sqrtf(maximum(0.f, 1 - dot(v3, v3))) * (is_negative ? -1 : 1);
 
 	switch (track.skipped_channel) {
@@ -295,6 +349,98 @@ Quat Animation::getRotation(u32 frame, const RotationTrack& track) const {
 	return {};
 }
 
+Vec3 Animation::getTranslation(u32 frame, const TranslationTrack& track) const {
+	ASSERT(&track >= m_translations.begin() && &track < m_translations.end());
+	if (u32(&track - m_translations.begin()) == m_root_motion.translation_track_idx) return m_root_motion.pose_translations[frame];
+
+	u32 segment, local_frame, segment_length;
+	locate(frame, segment, local_frame, segment_length);
+	const SegmentTrack& st = getSegmentTrack(segment, track);
+	const u32 key = local_frame >> st.stride_log2;
+	const u32 key_frame = key << st.stride_log2;
+	if (key_frame == local_frame) return decodeTranslation(st, track, key);
+
+	const u32 next_key_frame = minimum(key_frame + (1 << st.stride_log2), segment_length);
+	const float t = float(local_frame - key_frame) / float(next_key_frame - key_frame);
+	return lerp(decodeTranslation(st, track, key), decodeTranslation(st, track, key + 1), t);
+}
+
+Quat Animation::getRotation(u32 frame, const RotationTrack& track) const {
+	ASSERT(&track >= m_rotations.begin() && &track < m_rotations.end());
+	if (&track - m_rotations.begin() == m_root_motion.rotation_track_idx) return m_root_motion.pose_rotations[frame];
+
+	u32 segment, local_frame, segment_length;
+	locate(frame, segment, local_frame, segment_length);
+	const SegmentTrack& st = getSegmentTrack(segment, track);
+	const u32 key = local_frame >> st.stride_log2;
+	const u32 key_frame = key << st.stride_log2;
+	if (key_frame == local_frame) return decodeRotation(st, track, key);
+
+	const u32 next_key_frame = minimum(key_frame + (1 << st.stride_log2), segment_length);
+	const float t = float(local_frame - key_frame) / float(next_key_frame - key_frame);
+	return nlerp(decodeRotation(st, track, key), decodeRotation(st, track, key + 1), t);
+}
+
+void Animation::getTranslations(u32 frame, const TranslationTrack& track, Vec3& v0, Vec3& v1) const {
+	if (u32(&track - m_translations.begin()) == m_root_motion.translation_track_idx) {
+		v0 = m_root_motion.pose_translations[frame];
+		v1 = m_root_motion.pose_translations[frame + 1];
+		return;
+	}
+
+	u32 segment, local_frame, segment_length;
+	locate(frame, segment, local_frame, segment_length);
+	const SegmentTrack& st = getSegmentTrack(segment, track);
+	const u32 key = local_frame >> st.stride_log2;
+	const u32 key_frame = key << st.stride_log2;
+	const u32 next_key_frame = minimum(key_frame + (1 << st.stride_log2), segment_length);
+	const Vec3 k0 = decodeTranslation(st, track, key);
+	if (next_key_frame == key_frame) {
+		v0 = v1 = k0;
+		return;
+	}
+	
+	const Vec3 k1 = decodeTranslation(st, track, key + 1);
+	if (st.stride_log2 == 0) {
+		v0 = k0;
+		v1 = k1;
+		return;
+	}
+	const float inv_len = 1.f / float(next_key_frame - key_frame);
+	v0 = lerp(k0, k1, float(local_frame - key_frame) * inv_len);
+	v1 = lerp(k0, k1, float(local_frame + 1 - key_frame) * inv_len);
+}
+
+void Animation::getRotations(u32 frame, const RotationTrack& track, Quat& v0, Quat& v1) const {
+	if (u32(&track - m_rotations.begin()) == m_root_motion.rotation_track_idx) {
+		v0 = m_root_motion.pose_rotations[frame];
+		v1 = m_root_motion.pose_rotations[frame + 1];
+		return;
+	}
+
+	u32 segment, local_frame, segment_length;
+	locate(frame, segment, local_frame, segment_length);
+	const SegmentTrack& st = getSegmentTrack(segment, track);
+	const u32 key = local_frame >> st.stride_log2;
+	const u32 key_frame = key << st.stride_log2;
+	const u32 next_key_frame = minimum(key_frame + (1 << st.stride_log2), segment_length);
+	const Quat k0 = decodeRotation(st, track, key);
+	if (next_key_frame == key_frame) {
+		v0 = v1 = k0;
+		return;
+	}
+	
+	const Quat k1 = decodeRotation(st, track, key + 1);
+	if (st.stride_log2 == 0) {
+		v0 = k0;
+		v1 = k1;
+		return;
+	}
+	const float inv_len = 1.f / float(next_key_frame - key_frame);
+	v0 = nlerp(k0, k1, float(local_frame - key_frame) * inv_len);
+	v1 = nlerp(k0, k1, float(local_frame + 1 - key_frame) * inv_len);
+}
+
 void Animation::onBeforeReady() {
 	// TODO bake this
 	ASSERT(m_skeleton);
@@ -331,6 +477,7 @@ bool Animation::load(Span<const u8> mem) {
 	m_const_translations.clear();
 	m_rotations.clear();
 	m_const_rotations.clear();
+	m_segment_tracks.clear();
 	m_mem.clear();
 	Header header;
 	InputMemoryStream file(mem);
@@ -345,16 +492,14 @@ bool Animation::load(Span<const u8> mem) {
 		return false;
 	}
 
-	if (header.version <= Version::COMPRESSION) {
+	if (header.version < Version::SEGMENTS) {
 		logError(getPath(), ": version too old. Please delete '.lumix' directory and try again");
 		return false;
 	}
 
-	if (header.version > Version::SKELETON) {
-		Path path(file.readString());
-		m_skeleton = m_resource_manager.getOwner().load<Model>(path);
-		if (m_skeleton) addDependency(*m_skeleton);
-	}
+	Path path(file.readString());
+	m_skeleton = m_resource_manager.getOwner().load<Model>(path);
+	if (m_skeleton) addDependency(*m_skeleton);
 
 	if (!m_skeleton) {
 		logError(getPath(), ": missing skeleton.");
@@ -365,61 +510,75 @@ bool Animation::load(Span<const u8> mem) {
 	file.read(m_frame_count);
 	file.read(m_flags);
 
-	u32 translations_count;
-	file.read(&translations_count, sizeof(translations_count));
-	const u32 size = u32(file.size() - file.getPosition());
-	m_mem.resize(size + 8/*padding for unpacker*/);
-	file.read(&m_mem[0], size);
-
-	m_translations_frame_size_bits = 0;
-	InputMemoryStream blob(&m_mem[0], size);
+	const u32 translations_count = file.read<u32>();
 	for (u32 i = 0; i < translations_count; ++i) {
-		auto name = blob.read<BoneNameHash>();
-		auto type = blob.read<Animation::TrackType>();
+		auto name = file.read<BoneNameHash>();
+		auto type = file.read<Animation::TrackType>();
 		
 		if (type == Animation::TrackType::CONSTANT) {
 			ConstTranslationTrack& track = m_const_translations.emplace();
 			track.bone_name = name;
-			blob.read(track.value);
+			file.read(track.value);
 		}
 		else {
 			TranslationTrack& track = m_translations.emplace();
 			track.bone_name = name;
-			blob.read(track.min);
-			blob.read(track.to_range);
-			blob.read(track.bitsizes);
-			blob.read(track.offset_bits);
-			m_translations_frame_size_bits += track.bitsizes[0] + track.bitsizes[1] + track.bitsizes[2];
+			file.read(track.min);
+			file.read(track.range);
 		}
 	}
-	
-	m_translation_stream = (const u8*)blob.skip((m_translations_frame_size_bits * (m_frame_count + 1) + 7) / 8);
-
-	const u32 rotations_count = blob.read<u32>();
 
-	m_rotations_frame_size_bits = 0;
+	const u32 rotations_count = file.read<u32>();
 	for (u32 i = 0; i < rotations_count; ++i) {
-		auto bone_name_hash = blob.read<BoneNameHash>();
-		auto type = blob.read<Animation::TrackType>();
+		auto bone_name_hash = file.read<BoneNameHash>();
+		auto type = file.read<Animation::TrackType>();
 
 		if (type == Animation::TrackType::CONSTANT) {
 			ConstRotationTrack& track = m_const_rotations.emplace();
 			track.bone_name = bone_name_hash;
-			blob.read(track.value);
+			file.read(track.value);
 		}
 		else {
 			RotationTrack& track = m_rotations.emplace();
 			track.bone_name = bone_name_hash;
-			blob.read(track.min);
-			blob.read(track.to_range);
-			blob.read(track.bitsizes);
-			blob.read(track.offset_bits);
-			blob.read(track.skipped_channel);
-			m_rotations_frame_size_bits += track.bitsizes[0] + track.bitsizes[1] + track.bitsizes[2] + 1/*sign bit*/;
+			file.read(track.skipped_channel);
+			file.read(track.min);
+			file.read(track.range);
+		}
+	}
+
+	m_segments_count = m_frame_count == 0 ? 1 : (m_frame_count + SEGMENT_FRAMES - 1) / SEGMENT_FRAMES;
+	const u32 tracks_count = m_translations.size() + m_rotations.size();
+	m_segment_tracks.resize(m_segments_count * tracks_count);
+	u32 offset_bits = 0;
+	for (u32 segment = 0; segment < m_segments_count; ++segment) {
+		const u32 segment_length = minimum(SEGMENT_FRAMES, m_frame_count - segment * SEGMENT_FRAMES);
+		for (u32 i = 0; i < tracks_count; ++i) {
+			SegmentTrack& st = m_segment_tracks[segment * tracks_count + i];
+			file.read(st.range_min);
+			file.read(st.range_extent);
+			file.read(st.bitsizes);
+			file.read(st.stride_log2);
+			if (st.stride_log2 > 31) {
+				logError(getPath(), ": corrupted file");
+				return false;
+			}
+			st.offset_bits = offset_bits;
+			const u32 stride = 1 << st.stride_log2;
+			const u32 keys_count = (segment_length + stride - 1) / stride + 1;
+			const u32 key_bits = st.bitsizes[0] + st.bitsizes[1] + st.bitsizes[2] + (i < (u32)m_translations.size() ? 0 : 1/*sign bit*/);
+			offset_bits += keys_count * key_bits;
 		}
 	}
 
-	m_rotation_stream = (const u8*)blob.skip(0);
+	const u32 total_bits = file.read<u32>();
+	if (total_bits != offset_bits || file.size() - file.getPosition() < (total_bits + 7) / 8) {
+		logError(getPath(), ": corrupted file");
+		return false;
+	}
+	m_mem.resize((total_bits + 7) / 8 + 8/*padding for unpacker*/);
+	memset(m_mem.begin(), 0, m_mem.byte_size());
+	file.read(m_mem.begin(), (total_bits + 7) / 8);
 
 	return true;
 }
@@ -433,6 +592,8 @@ void Animation::unload()
 	m_const_rotations.clear();
 	m_const_translations.clear();
 	m_mem.clear();
+	m_segment_tracks.clear();
+	m_segments_count = 0;
 	m_frame_count = 0;
 	if (m_skeleton) {
 		removeDependency(*m_skeleton);
@@ -9,7 +9,9 @@
 namespace Lumix
 {
 
+struct InputMemoryStream;
 struct Model;
+struct OutputMemoryStream;
 struct Pose;
 struct Quat;
 struct Vec3;
@@ -46,6 +48,9 @@ struct BoneMask
 {
 	BoneMask(IAllocator& allocator) : bones(allocator), name(allocator) {}
 	BoneMask(BoneMask&& rhs) = default;
+	void serialize(OutputMemoryStream& stream) const;
+	void deserialize(InputMemoryStream& stream);
+
 	String name;
 	HashMap<BoneNameHash, u8> bones;
 };
@@ -64,10 +69,15 @@ struct Animation final : Resource {
 	enum class Version : u32 {
 		COMPRESSION = 6,
 		SKELETON,
+		SEGMENTS = 9,
 
 		LAST
 	};
 
+	// animated tracks are split into segments of this many frames, each segment can be decoded independently
+	static constexpr u32 SEGMENT_FRAMES = 16;
+	static constexpr u32 MAX_CHANNEL_BITS = 18;
+
 	enum Flags : u32 {
 		NONE = 0,
 		Y_ROOT_TRANSLATION = 1 << 0,
@@ -93,9 +103,7 @@ struct Animation final : Resource {
 		BoneNameHash bone_name;
 		u16 bone_index;
 		Vec3 min;
-		Vec3 to_range; //  * to_normalized * (max - min)
-		u16 offset_bits = 0;
-		u8 bitsizes[3] = {};
+		Vec3 range; // max - min over the whole clip
 	};
 
 	struct ConstRotationTrack {
@@ -108,18 +116,30 @@ struct Animation final : Resource {
 		BoneNameHash bone_name;
 		u16 bone_index;
 		Vec3 min;
-		Vec3 to_range; //  * to_normalized * (max - min)
-		u16 offset_bits;
-		u8 bitsizes[3];
+		Vec3 range; // max - min over the whole clip, of the 3 stored channels
 		u8 skipped_channel;
 	};
 
+	// one per segment and animated track, translations first
+	// keys are stored every `1 << stride_log2` frames (+ the last frame of segment)
+	// channel value = track.min + track.range * (range_min + range_extent * quantized / max_quantized) / 255
+	struct SegmentTrack {
+		u32 offset_bits;
+		u8 range_min[3];
+		u8 range_extent[3];
+		u8 bitsizes[3];
+		u8 stride_log2;
+	};
+
 	struct SampleContext {
 		Pose* pose;
 		const Model* model;
 		Time time;
 		float weight = 1;
-		const BoneMask* mask = nullptr;
+		// bitset indexed by bone index, see anim::RuntimeContext::getBoneMask; null means all bones
+		const u64* mask = nullptr;
+		// bones with lower Model::Bone::height keep their current value, used by animation LOD to skip fingers, face, ...
+		u32 min_bone_height = 0;
 	};
 
 	Animation(const Path& path, ResourceManager& resource_manager, IAllocator& allocator);
@@ -128,7 +148,7 @@ struct Animation final : Resource {
 	Time getLength() const { return Time::fromSeconds(m_frame_count / m_fps); }
 
 	Vec3 getTranslation(u32 frame, const TranslationTrack& track) const;
-	Quat getRotation(u32 sample, const RotationTrack& track) const;
+	Quat getRotation(u32 frame, const RotationTrack& track) const;
 	
 	const Array<TranslationTrack>& getTranslations() const { return m_translations; }
 	const Array<ConstTranslationTrack>& getConstTranslations() const { return m_const_translations; }
@@ -137,14 +157,22 @@ struct Animation final : Resource {
 	struct LocalRigidTransform getRootMotion(Time t) const;
 	void setRootMotionBone(BoneNameHash bone_name);
 	u32 getFramesCount() const { return m_frame_count; }
-	u32 getRotationFrameSizeBits() const { return m_rotations_frame_size_bits; }
-	u32 getTranslationFrameSizeBits() const { return m_translations_frame_size_bits; }
+	u32 getSegmentsCount() const { return m_segments_count; }
+	u32 getCompressedSize() const { return m_mem.size() + m_segment_tracks.byte_size(); }
+	const SegmentTrack& getSegmentTrack(u32 segment, const TranslationTrack& track) const;
+	const SegmentTrack& getSegmentTrack(u32 segment, const RotationTrack& track) const;
 	Flags m_flags = Flags::NONE;
 
 private:
 	void unload() override;
 	bool load(Span<const u8> mem) override;
 	void onBeforeReady() override;
+	void locate(u32 frame, u32& segment, u32& local_frame, u32& segment_length) const;
+	Vec3 decodeTranslation(const SegmentTrack& st, const TranslationTrack& track, u32 key) const;
+	Quat decodeRotation(const SegmentTrack& st, const RotationTrack& track, u32 key) const;
+	// values at `frame` and `frame + 1`, decodes each key only once
+	void getTranslations(u32 frame, const TranslationTrack& track, Vec3& v0, Vec3& v1) const;
+	void getRotations(u32 frame, const RotationTrack& track, Quat& v0, Quat& v1) const;
 
 	TagAllocator m_allocator;
 	Array<TranslationTrack> m_translations;
@@ -164,10 +192,8 @@ private:
 	} m_root_motion;
 
 	Array<u8> m_mem;
-	const u8* m_rotation_stream;
-	const u8* m_translation_stream;
-	u32 m_rotations_frame_size_bits;
-	u32 m_translations_frame_size_bits;
+	Array<SegmentTrack> m_segment_tracks;
+	u32 m_segments_count = 0;
 	u32 m_frame_count = 0;
 	float m_fps = 30;
 	Model* m_skeleton = nullptr;
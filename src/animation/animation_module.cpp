@@ -2,7 +2,10 @@
 
 #include "core/associative_array.h"
 #include "core/atomic.h"
+#include "core/command_line_parser.h"
+#include "core/geometry.h"
 #include "core/hash.h"
+#include "core/hash_map.h"
 #include "core/job_system.h"
 #include "core/log.h"
 #include "core/profiler.h"
@@ -57,32 +60,67 @@ struct AnimationModuleImpl final : AnimationModule {
 		Flags flags = Flags::NONE;
 		anim::RuntimeContext* ctx = nullptr;
 		LocalRigidTransform root_motion = {{0, 0, 0}, {0, 0, 0, 1}};
+		// see AnimationModule::setAnimationLOD
+		u32 lod = 0;
+		// time since the last update, animators with lod > 0 are not updated every frame
+		float skipped_time = 0;
+		// animators in the same group share one evaluated pose, 0 - not shared, see AnimationModule::setAnimatorShareGroup
+		u32 share_group = 0;
+		// index of animator evaluated for the whole group, -1 if this animator is evaluated by itself
+		i32 leader = -1;
+		// pose was evaluated in the current frame
+		bool updated = false;
+		// root motion computed in updateParallel, waiting for applyRootMotions
+		bool root_motion_pending = false;
 	};
 
+	// data shared by all animators when computing their LOD, see computeAnimatorLOD
+	struct LODContext {
+		bool valid = false;
+		ShiftedFrustum frustum;
+		float lod_multiplier;
+	};
 
-	struct PropertyAnimator {
-		struct Key {
-			int frame0;
-			int frame1;
-			float value0;
-			float value1;
-		};
 
+	struct PropertyAnimator {
 		enum Flags {
 			NONE = 0,
 			LOOPED = 1 << 0,
 			DISABLED = 1 << 1
 		};
 
-		PropertyAnimator(IAllocator& allocator) : keys(allocator) {}
+		enum Dirty : u8 {
+			POSITION = 1 << 0,
+			LOCAL_POSITION = 1 << 1,
+			SCALE = 1 << 2,
+			EVALUATED = 1 << 3
+		};
+
+		PropertyAnimator(IAllocator& allocator) : cursors(allocator), values(allocator) {}
 
 		PropertyAnimation* animation;
-		Array<Key> keys;
+		// per curve, index of the key found last frame, so the search does not start from the beginning; 0 - no value
+		Array<u32> cursors;
+		// per curve, computed in evalPropertyAnimator, set in applyPropertyAnimator
+		Array<float> values;
+		Transform transform;
+		DVec3 local_pos;
+		u8 dirty = 0;
 
 		Flags flags = Flags::NONE;
 		float time;
 	};
 
+	// values of a single property for all animated entities, see flushPropertyBatches
+	struct PropertyBatch {
+		PropertyBatch(IAllocator& allocator) : entities(allocator), values(allocator) {}
+
+		const reflection::Property<float>* property;
+		IModule* module;
+		Array<EntityRef> entities;
+		Array<float> values;
+	};
+
 
 	AnimationModuleImpl(Engine& engine, ISystem& anim_system, World& world, IAllocator& allocator)
 		: m_world(world)
@@ -90,11 +128,19 @@ struct AnimationModuleImpl final : AnimationModule {
 		, m_anim_system(anim_system)
 		, m_animables(allocator)
 		, m_property_animators(allocator)
+		, m_property_batches(allocator)
+		, m_property_transform_entities(allocator)
+		, m_property_transforms(allocator)
+		, m_property_local_pos_entities(allocator)
 		, m_animators(allocator)
 		, m_allocator(allocator)
 		, m_animator_map(allocator)
+		, m_share_group_leaders(allocator)
+		, m_root_motion_entities(allocator)
+		, m_root_motion_transforms(allocator)
 	{
 		m_is_game_running = false;
+		m_animation_lod = CommandLineParser::isOn("-animation_lod");
 	}
 
 	void init() override {
@@ -398,9 +444,11 @@ struct AnimationModuleImpl final : AnimationModule {
 
 		setFlag(animator.flags, PropertyAnimator::DISABLED, !enabled);
 		animator.time = 0;
-		if (enabled) {
+		if (enabled && animator.animation && animator.animation->isReady() && !animator.animation->curves.empty()) {
+			evalPropertyAnimator(entity, animator);
 			applyPropertyAnimator(entity, animator);
 		}
+		flushPropertyBatches();
 	}
 
 	void setPropertyAnimatorLooped(EntityRef entity, bool looped) override {
@@ -420,6 +468,8 @@ struct AnimationModuleImpl final : AnimationModule {
 	{
 		auto& animator = m_property_animators[entity];
 		animator.time = 0;
+		animator.cursors.clear();
+		animator.values.clear();
 		unloadResource(animator.animation);
 		animator.animation = loadPropertyAnimation(path);
 	}
@@ -488,8 +538,15 @@ struct AnimationModuleImpl final : AnimationModule {
 	void updateAnimator(EntityRef entity, float time_delta) override {
 		Animator& animator = m_animators[m_animator_map[entity]];
 		updateAnimator(animator, time_delta);
+		applyRootMotion(animator);
 	}
 
+	void setAnimationLOD(bool enable) override { m_animation_lod = enable; }
+	bool isAnimationLOD() const override { return m_animation_lod; }
+	u32 getAnimatorLOD(EntityRef entity) const override { return m_animators[m_animator_map[entity]].lod; }
+	void setAnimatorShareGroup(EntityRef entity, u32 group) override { m_animators[m_animator_map[entity]].share_group = group; }
+	u32 getAnimatorShareGroup(EntityRef entity) const override { return m_animators[m_animator_map[entity]].share_group; }
+
 	void setAnimatorInput(EntityRef entity, u32 input_idx, float value) override {
 		Animator& animator = m_animators[m_animator_map[entity]];
 		if (!animator.ctx) return;
@@ -586,6 +643,7 @@ struct AnimationModuleImpl final : AnimationModule {
 	OutputMemoryStream& beginBlendstackUpdate(EntityRef entity) override {
 		Animator& animator = m_animators[m_animator_map[entity]];
 		updateAnimator(animator, 0);
+		applyRootMotion(animator);
 		animator.ctx->blendstack.clear();
 		return animator.ctx->blendstack;
 	}
@@ -605,23 +663,54 @@ struct AnimationModuleImpl final : AnimationModule {
 		m_render_module->unlockPose(entity, true);
 	}
 
-	void updateAnimator(Animator& animator, float time_delta) {
+	Transform getRootMotionTransform(const Animator& animator) const {
+		Transform tr = m_world.getTransform(animator.entity);
+		tr.pos += tr.rot.rotate(animator.root_motion.pos);
+		tr.rot = animator.root_motion.rot * tr.rot;
+		return tr;
+	}
+
+	void applyRootMotion(Animator& animator) {
+		if (!animator.root_motion_pending) return;
+		animator.root_motion_pending = false;
+		m_world.setTransform(animator.entity, getRootMotionTransform(animator));
+	}
+
+	// root motion of all animators updated in updateParallel, applied in one batch, so worker jobs do not write transforms
+	void applyRootMotions() {
 		PROFILE_FUNCTION();
-		if (!animator.resource || !animator.resource->isReady()) return;
+		for (Animator& animator : m_animators) {
+			if (!animator.root_motion_pending) continue;
+			animator.root_motion_pending = false;
+			m_root_motion_entities.push(animator.entity);
+			m_root_motion_transforms.push(getRootMotionTransform(animator));
+		}
+		if (m_root_motion_entities.empty()) return;
+
+		m_world.setTransforms(m_root_motion_entities, m_root_motion_transforms);
+		m_root_motion_entities.clear();
+		m_root_motion_transforms.clear();
+	}
+
+	// returns true if pose was updated
+	bool updateAnimator(Animator& animator, float time_delta) {
+		PROFILE_FUNCTION();
+		if (!animator.resource || !animator.resource->isReady()) return false;
 		if (!animator.ctx) {
 			animator.ctx = animator.resource->createRuntime(animator.default_set);
 		}
 
 		const EntityRef entity = animator.entity;
-		if (!m_world.hasComponent(entity, MODEL_INSTANCE_TYPE)) return;
+		if (!m_world.hasComponent(entity, MODEL_INSTANCE_TYPE)) return false;
 
 		Model* model = m_render_module->getModelInstanceModel(entity);
-		if (!model || !model->isReady()) return;
+		if (!model || !model->isReady()) return false;
 
 		Pose* pose = m_render_module->lockPose(entity);
-		if (!pose) return;
+		if (!pose) return false;
 
-		animator.ctx->model = model;
+		animator.ctx->setModel(model);
+		animator.ctx->lod = animator.lod;
 		animator.ctx->time_delta = Time::fromSeconds(time_delta);
 		animator.resource->update(*animator.ctx);
 		animator.root_motion = animator.ctx->root_motion;
@@ -633,131 +722,308 @@ struct AnimationModuleImpl final : AnimationModule {
 
 		m_render_module->unlockPose(entity, true);
 
-		if (animator.flags & Animator::USE_ROOT_MOTION) {
-			Transform tr = m_world.getTransform(animator.entity);
-			tr.pos += tr.rot.rotate(animator.root_motion.pos);
-			tr.rot = animator.root_motion.rot * tr.rot;
-			m_world.setTransform(animator.entity, tr);
+		animator.root_motion_pending = animator.flags & Animator::USE_ROOT_MOTION;
+		return true;
+	}
+
+	// copies pose and root motion of the group's leader, see setAnimatorShareGroup
+	bool copySharedPose(Animator& animator, const Animator& leader) {
+		if (animator.resource != leader.resource) return false;
+		if (!m_world.hasComponent(animator.entity, MODEL_INSTANCE_TYPE)) return false;
+
+		Model* model = m_render_module->getModelInstanceModel(animator.entity);
+		if (!model || !model->isReady()) return false;
+		if (model != m_render_module->getModelInstanceModel(leader.entity)) return false;
+
+		Pose* pose = m_render_module->lockPose(animator.entity);
+		const Pose* leader_pose = m_render_module->lockPose(leader.entity);
+		if (!pose || !leader_pose || pose->count != leader_pose->count) return false;
+
+		memcpy(pose->positions, leader_pose->positions, sizeof(pose->positions[0]) * pose->count);
+		memcpy(pose->rotations, leader_pose->rotations, sizeof(pose->rotations[0]) * pose->count);
+		pose->is_absolute = leader_pose->is_absolute;
+		m_render_module->unlockPose(leader.entity, false);
+		m_render_module->unlockPose(animator.entity, true);
+
+		animator.root_motion = leader.root_motion;
+		animator.root_motion_pending = animator.flags & Animator::USE_ROOT_MOTION;
+		return true;
+	}
+
+	PropertyBatch& getPropertyBatch(const PropertyAnimation::Curve& curve) {
+		for (PropertyBatch& batch : m_property_batches) {
+			if (batch.property == curve.property) return batch;
 		}
+		PropertyBatch& batch = m_property_batches.emplace(m_allocator);
+		batch.property = curve.property;
+		batch.module = m_world.getModule(curve.cmp_type);
+		return batch;
 	}
 
-	void applyPropertyAnimator(EntityRef entity, PropertyAnimator& animator) {
+	// property curves of all animators are set together, one setMany per property
+	// batches are kept, so their arrays do not need to be reallocated each frame
+	void flushPropertyBatches() {
+		for (PropertyBatch& batch : m_property_batches) {
+			if (batch.entities.empty()) continue;
+			batch.property->setMany(batch.module, batch.entities, -1, batch.values);
+			batch.entities.clear();
+			batch.values.clear();
+		}
+
+		if (!m_property_transform_entities.empty()) {
+			m_world.setTransforms(m_property_transform_entities, m_property_transforms);
+			m_property_transform_entities.clear();
+			m_property_transforms.clear();
+		}
+
+		// there's no batched API for local transforms
+		for (EntityRef e : m_property_local_pos_entities) {
+			m_world.setLocalPosition(e, m_property_animators[e].local_pos);
+		}
+		m_property_local_pos_entities.clear();
+	}
+
+	// does not modify the world, so it can run in parallel for all animators
+	void evalPropertyAnimator(EntityRef entity, PropertyAnimator& animator) {
 		const bool is_looped = animator.flags & PropertyAnimator::LOOPED;
 		const PropertyAnimation* animation = animator.animation;
 		Time time = Time::fromSeconds(animator.time);
-		DVec3 local_pos = m_world.getLocalTransform(entity).pos;
-		DVec3 pos = m_world.getPosition(entity);
-		Vec3 scale = m_world.getScale(entity);
-		bool set_local_pos = false;
-		bool set_pos = false;
-		bool set_scale = false;
 		if (is_looped) {
 			time = time % animation->length;
 		}
 		else {
 			time = minimum(time, animation->length);
 		}
-		for (PropertyAnimation::Curve& curve : animation->curves) {
-			if (curve.frames.size() < 2) continue;
-			for (int i = 1, n = curve.frames.size(); i < n; ++i) {
-				if (time <= curve.frames[i]) {
-					float t = (time - curve.frames[i - 1]) / (curve.frames[i] - curve.frames[i - 1]);
-					float v = curve.values[i] * t + curve.values[i - 1] * (1 - t);
-					switch (curve.type) {
-						case PropertyAnimation::CurveType::PROPERTY: {
-							ComponentUID cmp;
-							cmp.type = curve.cmp_type;
-							cmp.module = m_world.getModule(cmp.type);
-							cmp.entity = entity;
-							ASSERT(curve.property->setter);
-							curve.property->set(cmp, -1, v);
-							break;
-						}
-						case PropertyAnimation::CurveType::LOCAL_POS_X:
-							local_pos.x = v;
-							set_local_pos = true;
-							break;
-						case PropertyAnimation::CurveType::LOCAL_POS_Y:
-							local_pos.y = v;
-							set_local_pos = true;
-							break;
-						case PropertyAnimation::CurveType::LOCAL_POS_Z:
-							local_pos.z = v;
-							set_local_pos = true;
-							break;
-						case PropertyAnimation::CurveType::POS_X:
-							pos.x = v;
-							set_pos = true;
-							break;
-						case PropertyAnimation::CurveType::POS_Y:
-							pos.y = v;
-							set_pos = true;
-							break;
-						case PropertyAnimation::CurveType::POS_Z:
-							set_pos = true;
-							pos.z = v;
-							break;
-						case PropertyAnimation::CurveType::NOT_SET:
-							ASSERT(false);
-							break;
-						case PropertyAnimation::CurveType::SCALE_X:
-							scale.x = v;
-							set_scale = true;
-							break;
-						case PropertyAnimation::CurveType::SCALE_Y:
-							scale.y = v;
-							set_scale = true;
-							break;
-						case PropertyAnimation::CurveType::SCALE_Z:
-							scale.z = v;
-							set_scale = true;
-							break;
-					}
+
+		const u32 curves_count = animation->curves.size();
+		if ((u32)animator.cursors.size() != curves_count) {
+			animator.cursors.resize(curves_count);
+			animator.values.resize(curves_count);
+			memset(animator.cursors.begin(), 0, animator.cursors.byte_size());
+		}
+
+		animator.dirty = PropertyAnimator::EVALUATED;
+		animator.transform = m_world.getTransform(entity);
+		animator.local_pos = m_world.getLocalTransform(entity).pos;
+		for (u32 curve_idx = 0; curve_idx < curves_count; ++curve_idx) {
+			const PropertyAnimation::Curve& curve = animation->curves[curve_idx];
+			u32& cursor = animator.cursors[curve_idx];
+			const u32 n = curve.frames.size();
+			if (n < 2) {
+				cursor = 0;
+				continue;
+			}
+
+			u32 i = maximum(cursor, 1u);
+			if (i >= n || time < curve.frames[i - 1]) i = 1; // time went back, e.g. looped
+			while (i < n && curve.frames[i] < time) ++i;
+			if (i == n) {
+				cursor = 0;
+				continue;
+			}
+			cursor = i;
+
+			const float t = (time - curve.frames[i - 1]) / (curve.frames[i] - curve.frames[i - 1]);
+			const float v = curve.values[i] * t + curve.values[i - 1] * (1 - t);
+			animator.values[curve_idx] = v;
+			switch (curve.type) {
+				case PropertyAnimation::CurveType::PROPERTY: break;
+				case PropertyAnimation::CurveType::LOCAL_POS_X:
+					animator.local_pos.x = v;
+					animator.dirty |= PropertyAnimator::LOCAL_POSITION;
+					break;
+				case PropertyAnimation::CurveType::LOCAL_POS_Y:
+					animator.local_pos.y = v;
+					animator.dirty |= PropertyAnimator::LOCAL_POSITION;
+					break;
+				case PropertyAnimation::CurveType::LOCAL_POS_Z:
+					animator.local_pos.z = v;
+					animator.dirty |= PropertyAnimator::LOCAL_POSITION;
+					break;
+				case PropertyAnimation::CurveType::POS_X:
+					animator.transform.pos.x = v;
+					animator.dirty |= PropertyAnimator::POSITION;
+					break;
+				case PropertyAnimation::CurveType::POS_Y:
+					animator.transform.pos.y = v;
+					animator.dirty |= PropertyAnimator::POSITION;
+					break;
+				case PropertyAnimation::CurveType::POS_Z:
+					animator.transform.pos.z = v;
+					animator.dirty |= PropertyAnimator::POSITION;
+					break;
+				case PropertyAnimation::CurveType::NOT_SET:
+					ASSERT(false);
+					break;
+				case PropertyAnimation::CurveType::SCALE_X:
+					animator.transform.scale.x = v;
+					animator.dirty |= PropertyAnimator::SCALE;
+					break;
+				case PropertyAnimation::CurveType::SCALE_Y:
+					animator.transform.scale.y = v;
+					animator.dirty |= PropertyAnimator::SCALE;
+					break;
+				case PropertyAnimation::CurveType::SCALE_Z:
+					animator.transform.scale.z = v;
+					animator.dirty |= PropertyAnimator::SCALE;
 					break;
-				}
 			}
 		}
-		if (set_pos) m_world.setPosition(entity, pos);
-		if (set_local_pos) m_world.setLocalPosition(entity, local_pos);
-		if (set_scale) m_world.setScale(entity, scale);
 	}
 
-	void updatePropertyAnimators(float time_delta) {
-		PROFILE_FUNCTION();
-		for (int anim_idx = 0, c = m_property_animators.size(); anim_idx < c; ++anim_idx) {
-			EntityRef entity = m_property_animators.getKey(anim_idx);
-			PropertyAnimator& animator = m_property_animators.at(anim_idx);
-			const PropertyAnimation* animation = animator.animation;
-			if (!animation || !animation->isReady()) continue;
-			if (animation->curves.empty()) continue;
-			if (animation->curves[0].frames.empty()) continue;
-			if (animator.flags & PropertyAnimator::DISABLED) continue;
-
-			animator.time += time_delta;
+	// queues values computed in evalPropertyAnimator, see flushPropertyBatches
+	void applyPropertyAnimator(EntityRef entity, PropertyAnimator& animator) {
+		if (!(animator.dirty & PropertyAnimator::EVALUATED)) return;
+
+		const PropertyAnimation* animation = animator.animation;
+		for (u32 i = 0, c = animator.cursors.size(); i < c; ++i) {
+			if (animator.cursors[i] == 0) continue;
+			const PropertyAnimation::Curve& curve = animation->curves[i];
+			if (curve.type != PropertyAnimation::CurveType::PROPERTY) continue;
 			
-			applyPropertyAnimator(entity, animator);
+			ASSERT(curve.property->setter);
+			PropertyBatch& batch = getPropertyBatch(curve);
+			batch.entities.push(entity);
+			batch.values.push(animator.values[i]);
+		}
+		if (animator.dirty & (PropertyAnimator::POSITION | PropertyAnimator::SCALE)) {
+			m_property_transform_entities.push(entity);
+			m_property_transforms.push(animator.transform);
+		}
+		if (animator.dirty & PropertyAnimator::LOCAL_POSITION) {
+			m_property_local_pos_entities.push(entity);
 		}
 	}
 
+	void updatePropertyAnimators(float time_delta) {
+		PROFILE_FUNCTION();
+		if (m_property_animators.size() == 0) return;
+
+		jobs::forEach(m_property_animators.size(), [&](u32 from, u32 to){
+			PROFILE_BLOCK("eval property animators");
+			for (u32 anim_idx = from; anim_idx < to; ++anim_idx) {
+				PropertyAnimator& animator = m_property_animators.at(anim_idx);
+				animator.dirty = 0;
+				const PropertyAnimation* animation = animator.animation;
+				if (!animation || !animation->isReady()) continue;
+				if (animation->curves.empty()) continue;
+				if (animation->curves[0].frames.empty()) continue;
+				if (animator.flags & PropertyAnimator::DISABLED) continue;
+
+				animator.time += time_delta;
+				evalPropertyAnimator(m_property_animators.getKey(anim_idx), animator);
+			}
+		});
+
+		for (u32 anim_idx = 0, c = m_property_animators.size(); anim_idx < c; ++anim_idx) {
+			applyPropertyAnimator(m_property_animators.getKey(anim_idx), m_property_animators.at(anim_idx));
+		}
+		flushPropertyBatches();
+	}
 
 	void updateAnimables(float time_delta)
 	{
 		PROFILE_FUNCTION();
 		if (m_animables.size() == 0) return;
 
-		jobs::forEach(m_animables.size(), 1, [&](i32 idx, i32){
-			Animable& animable = m_animables.at(idx);
-			updateAnimable(animable, time_delta);
+		jobs::forEach(m_animables.size(), [&](u32 from, u32 to){
+			for (u32 idx = from; idx < to; ++idx) {
+				Animable& animable = m_animables.at(idx);
+				updateAnimable(animable, time_delta);
+			}
 		});
 	}
 
 
+	LODContext getLODContext() const {
+		LODContext ctx;
+		if (!m_animation_lod) return ctx;
+		const EntityPtr camera = m_render_module->getActiveCamera();
+		if (!camera.isValid()) return ctx;
+
+		ctx.valid = true;
+		ctx.frustum = m_render_module->getCameraFrustum(*camera);
+		ctx.lod_multiplier = m_render_module->getCameraLODMultiplier(*camera);
+		return ctx;
+	}
+
+	// 0 - every frame, full skeleton
+	// 1 - every 2nd frame
+	// 2 - every 4th frame, without IK and leaf bones
+	// 3 - every 8th frame, without IK and two lowest levels of bones; used for animators outside of the view
+	u32 computeAnimatorLOD(const Animator& animator, const LODContext& ctx) const {
+		if (!ctx.valid) return 0;
+		const Model* model = m_render_module->getModelInstanceModel(animator.entity);
+		if (!model || !model->isReady()) return 0;
+
+		const DVec3 pos = m_world.getPosition(animator.entity);
+		const Vec3 scale = m_world.getScale(animator.entity);
+		const float radius = model->getOriginBoundingRadius() * maximum(scale.x, scale.y, scale.z);
+		if (!ctx.frustum.intersectsAABB(pos - DVec3(radius), Vec3(2 * radius))) return 3;
+
+		// squared distance in multiples of bounding radius, i.e. inverse of squared screen size
+		const float squared_distance = (float)squaredLength(pos - ctx.frustum.origin) * ctx.lod_multiplier;
+		const float ratio = squared_distance / maximum(radius * radius, 1e-5f);
+		if (ratio < 20 * 20) return 0;
+		if (ratio < 40 * 40) return 1;
+		if (ratio < 80 * 80) return 2;
+		return 3;
+	}
+
 	void updateParallel(float time_delta) override {
 		PROFILE_FUNCTION();
 		if (!m_is_game_running) return;
 		
-		jobs::forEach(m_animators.size(), 1, [&](i32 idx, i32){
-			updateAnimator(m_animators[idx], time_delta);
+		// first animator of each share group is the group's leader
+		bool any_shared = false;
+		m_share_group_leaders.clear();
+		for (u32 idx = 0, c = m_animators.size(); idx < c; ++idx) {
+			Animator& animator = m_animators[idx];
+			animator.leader = -1;
+			animator.updated = false;
+			if (animator.share_group == 0) continue;
+			auto iter = m_share_group_leaders.find(animator.share_group);
+			if (iter.isValid()) {
+				animator.leader = iter.value();
+				any_shared = true;
+			}
+			else {
+				m_share_group_leaders.insert(animator.share_group, idx);
+			}
+		}
+
+		const LODContext lod_ctx = getLODContext();
+		const u32 frame = m_lod_frame++;
+		jobs::forEach(m_animators.size(), [&](u32 from, u32 to){
+			for (u32 idx = from; idx < to; ++idx) {
+				Animator& animator = m_animators[idx];
+				if (animator.leader >= 0) continue;
+				animator.lod = computeAnimatorLOD(animator, lod_ctx);
+				animator.skipped_time += time_delta;
+				// animators are offset by their index, so skipped updates are spread across frames
+				const u32 interval_mask = (1 << animator.lod) - 1;
+				if (((frame + idx) & interval_mask) != 0) continue;
+
+				animator.updated = updateAnimator(animator, animator.skipped_time);
+				animator.skipped_time = 0;
+			}
+		});
+
+		if (!any_shared) return;
+
+		// followers copy their leader's pose, or are evaluated by themselves if they can not share it
+		jobs::forEach(m_animators.size(), [&](u32 from, u32 to){
+			for (u32 idx = from; idx < to; ++idx) {
+				Animator& animator = m_animators[idx];
+				if (animator.leader < 0) continue;
+				const Animator& leader = m_animators[animator.leader];
+				animator.lod = leader.lod;
+				animator.skipped_time += time_delta;
+				if (!leader.updated) continue;
+
+				if (!copySharedPose(animator, leader)) updateAnimator(animator, animator.skipped_time);
+				animator.skipped_time = 0;
+			}
 		});
 	}
 
@@ -765,6 +1031,7 @@ struct AnimationModuleImpl final : AnimationModule {
 		PROFILE_FUNCTION();
 		if (!m_is_game_running) return;
 
+		applyRootMotions();
 		updateAnimables(time_delta);
 		updatePropertyAnimators(time_delta);
 	}
@@ -828,10 +1095,20 @@ struct AnimationModuleImpl final : AnimationModule {
 	Engine& m_engine;
 	AssociativeArray<EntityRef, Animable> m_animables;
 	AssociativeArray<EntityRef, PropertyAnimator> m_property_animators;
+	Array<PropertyBatch> m_property_batches;
+	Array<EntityRef> m_property_transform_entities;
+	Array<Transform> m_property_transforms;
+	Array<EntityRef> m_property_local_pos_entities;
 	HashMap<EntityRef, u32> m_animator_map;
 	Array<Animator> m_animators;
 	RenderModule* m_render_module;
 	bool m_is_game_running;
+	bool m_animation_lod = false;
+	u32 m_lod_frame = 0;
+	// share group -> index of its leader in m_animators, rebuilt each frame
+	HashMap<u32, u32> m_share_group_leaders;
+	Array<EntityRef> m_root_motion_entities;
+	Array<Transform> m_root_motion_transforms;
 };
 
 
@@ -56,6 +56,14 @@ struct AnimationModule : IModule {
 	virtual int getAnimatorInputIndex(EntityRef entity, const char* name) const = 0;	//@ function alias getInputIndex
 	//@ end
 	virtual void updateAnimator(EntityRef entity, float time_delta) = 0;
+	// animators far from or outside of the active camera are updated less often and with fewer bones, enabled with -animation_lod
+	virtual void setAnimationLOD(bool enable) = 0;
+	virtual bool isAnimationLOD() const = 0;
+	virtual u32 getAnimatorLOD(EntityRef entity) const = 0;
+	// opt-in for crowds, animators with the same nonzero group are evaluated once and share the pose
+	// they must use the same controller and model and get the same inputs; use more groups for variation, e.g. one per time offset
+	virtual void setAnimatorShareGroup(EntityRef entity, u32 group) = 0;
+	virtual u32 getAnimatorShareGroup(EntityRef entity) const = 0;
 	virtual bool getAnimatorBoolInput(EntityRef entity, u32 input_idx) = 0;
 	virtual float getAnimatorFloatInput(EntityRef entity, u32 input_idx) = 0;
 	virtual Vec3 getAnimatorVec3Input(EntityRef entity, u32 input_idx) = 0;
@@ -69,6 +69,8 @@ AnimationSystemImpl::AnimationSystemImpl(Engine& engine)
 	AnimationModule::reflect(engine);
 	m_animation_manager.create(Animation::TYPE, m_engine.getResourceManager());
 	m_property_animation_manager.create(PropertyAnimation::TYPE, m_engine.getResourceManager());
+	// property animations only parse their content
+	m_property_animation_manager.setLoadThreadSafe(true);
 	m_controller_manager.create(anim::Controller::TYPE, m_engine.getResourceManager());
 }
 
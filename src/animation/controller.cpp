@@ -68,14 +68,15 @@ RuntimeContext* Controller::createRuntime(u32 anim_set) {
 
 void Controller::update(RuntimeContext& ctx) const {
 	ASSERT(&ctx.controller == this);
-	// TODO better allocation strategy
-	const Span<u8> mem = ctx.data.releaseOwnership();
-	ctx.data.reserve(mem.length());
+	// last frame's data is read from `prev_data` while this frame's is written to `data`,
+	// both buffers keep their capacity, so there are no allocations in steady state
+	OutputMemoryStream tmp(static_cast<OutputMemoryStream&&>(ctx.prev_data));
+	ctx.prev_data = static_cast<OutputMemoryStream&&>(ctx.data);
+	ctx.data = static_cast<OutputMemoryStream&&>(tmp);
+	ctx.data.clear();
 	ctx.blendstack.clear();
-	ctx.input_runtime.set(mem.begin(), mem.length());
+	ctx.input_runtime.set(ctx.prev_data.data(), ctx.prev_data.size());
 	if (m_root) m_root->update(ctx);
-
-	m_allocator.deallocate(mem.begin());
 }
 
 struct Header {
@@ -97,6 +98,11 @@ void Controller::serialize(OutputMemoryStream& stream) {
 		stream.writeString(entry.animation ? entry.animation->getPath() : Path());
 	}
 
+	stream.write((u32)m_bone_masks.size());
+	for (const BoneMask& mask : m_bone_masks) {
+		mask.serialize(stream);
+	}
+
 	stream.write(m_root->type());
 	m_root->serialize(stream);
 }
@@ -132,6 +138,14 @@ bool Controller::deserialize(InputMemoryStream& stream) {
 		}
 	}
 
+	if (header.version >= ControllerVersion::BONE_MASKS) {
+		const u32 masks_count = stream.read<u32>();
+		m_bone_masks.reserve(masks_count);
+		for (u32 i = 0; i < masks_count; ++i) {
+			m_bone_masks.emplace(m_allocator).deserialize(stream);
+		}
+	}
+
 	NodeType type;
 	stream.read(type);
 	m_root = (PoseNode*)Node::create(type, *this);
@@ -152,7 +166,8 @@ static void getPose(const anim::RuntimeContext& ctx, Time time, float weight, u3
 	sample_ctx.time = anim_time;
 	sample_ctx.model = ctx.model;
 	sample_ctx.weight = weight;
-	sample_ctx.mask = mask_idx < (u32)ctx.controller.m_bone_masks.size() ? &ctx.controller.m_bone_masks[mask_idx] : nullptr;
+	sample_ctx.min_bone_height = ctx.lod > 1 ? ctx.lod - 1 : 0;
+	sample_ctx.mask = ctx.getBoneMask(mask_idx);
 	anim->getRelativePose(sample_ctx);
 }
 
@@ -276,6 +291,7 @@ void evalBlendStack(const anim::RuntimeContext& ctx, Pose& pose) {
 				Vec3 pos = bs.read<Vec3>();
 				u32 leaf_bone = bs.read<u32>();
 				u32 bone_count = bs.read<u32>();
+				if (ctx.lod > 1) break;
 				evalIK(alpha * ctx.weight, pos, leaf_bone, bone_count, *ctx.model, pose);
 				break;
 			}
@@ -284,7 +300,16 @@ void evalBlendStack(const anim::RuntimeContext& ctx, Pose& pose) {
 				float weight = bs.read<float>();
 				Time time = bs.read<Time>();
 				bool looped = bs.read<bool>();
-				getPose(ctx, time, weight, slot, pose, 0, looped);
+				getPose(ctx, time, weight, slot, pose, 0xffFFffFF, looped);
+				break;
+			}
+			case anim::BlendStackInstructions::SAMPLE_MASKED: {
+				u32 slot = bs.read<u32>();
+				float weight = bs.read<float>();
+				Time time = bs.read<Time>();
+				bool looped = bs.read<bool>();
+				u32 mask_idx = bs.read<u32>();
+				getPose(ctx, time, weight, slot, pose, mask_idx, looped);
 				break;
 			}
 		}
@@ -41,28 +41,42 @@ struct RuntimeContext {
 
 	void setInput(u32 input_idx, float value);
 	void setInput(u32 input_idx, bool value);
+	// resolves controller's bone masks to bone indices of `model`, call when model changes
+	void setModel(Model* model);
+	// bitset of bones in mask, indexed by bone index; null if mask does not exist
+	const u64* getBoneMask(u32 mask_idx) const;
 
 	Controller& controller;
 	Array<Value> inputs;
 	Array<Animation*> animations;
 	OutputMemoryStream data;
+	OutputMemoryStream prev_data;
 	OutputMemoryStream blendstack;
 
 	float weight = 1;
 	Time time_delta;
 	Model* model = nullptr;
+	// animation LOD, 0 is full quality; higher LODs skip IK and sampling of leaf bones, see evalBlendStack
+	u32 lod = 0;
 	InputMemoryStream input_runtime;
 	LocalRigidTransform root_motion;
+	Array<u64> bone_masks;
+	u32 bone_mask_words = 0;
+	u32 bone_masks_bone_count = 0;
+	const Model* bone_masks_model = nullptr;
 };
 
 enum BlendStackInstructions : u8 {
 	END,
 	SAMPLE,
-	IK
+	IK,
+	SAMPLE_MASKED
 };
 
 enum class ControllerVersion : u32 {
 	FIRST,
+	BONE_MASKS = 2,
+	FLAT_VALUES,
 
 	LATEST
 };
@@ -234,10 +234,10 @@ struct AnimationAssetBrowserPlugin : AssetBrowser::IPlugin {
 
 			ImGuiEx::Label("Frames");
 			ImGui::Text("%d", m_resource->getFramesCount());
-			ImGuiEx::Label("Translation frame size");
-			ImGui::Text("%d", m_resource->getTranslationFrameSizeBits());
-			ImGuiEx::Label("Rotation frame size");
-			ImGui::Text("%d", m_resource->getRotationFrameSizeBits());
+			ImGuiEx::Label("Segments");
+			ImGui::Text("%d", m_resource->getSegmentsCount());
+			ImGuiEx::Label("Compressed size");
+			ImGui::Text("%.1f KB", m_resource->getCompressedSize() / 1024.f);
 
 			ImGuiEx::Label("Translation tracks (constant / animated)");
 			ImGui::Text("%d / %d", const_translations.size(), translations.size());
@@ -251,8 +251,12 @@ struct AnimationAssetBrowserPlugin : AssetBrowser::IPlugin {
 					const Model::Bone& bone = m_model->getBone(track.bone_index);
 					ImGuiTreeNodeFlags flags = m_selected_bone == track.bone_index ? ImGuiTreeNodeFlags_Selected : 0;
 					flags |= ImGuiTreeNodeFlags_OpenOnArrow;
-					u32 bits = track.bitsizes[0] + track.bitsizes[1] + track.bitsizes[2];
-					bool open = ImGui::TreeNodeEx(&bone, flags, "%s (%d bits)", bone.name.c_str(), bits);
+					u32 bits = 0;
+					for (u32 i = 0; i < m_resource->getSegmentsCount(); ++i) {
+						const Animation::SegmentTrack& st = m_resource->getSegmentTrack(i, track);
+						bits += st.bitsizes[0] + st.bitsizes[1] + st.bitsizes[2];
+					}
+					bool open = ImGui::TreeNodeEx(&bone, flags, "%s (%.1f bits per key)", bone.name.c_str(), bits / float(m_resource->getSegmentsCount()));
 					if (ImGui::IsItemHovered() && ImGui::IsMouseReleased(ImGuiMouseButton_Left)) {
 						m_selected_bone = track.bone_index;
 					}
@@ -296,8 +300,12 @@ struct AnimationAssetBrowserPlugin : AssetBrowser::IPlugin {
 					ImGuiTreeNodeFlags flags = m_selected_bone == track.bone_index ? ImGuiTreeNodeFlags_Selected : 0;
 					flags |= ImGuiTreeNodeFlags_OpenOnArrow;
 
-					u32 bits = track.bitsizes[0] + track.bitsizes[1] + track.bitsizes[2] + 1;
-					bool open = ImGui::TreeNodeEx(&bone, flags, "%s (%d bits)", bone.name.c_str(), bits);
+					u32 bits = 0;
+					for (u32 i = 0; i < m_resource->getSegmentsCount(); ++i) {
+						const Animation::SegmentTrack& st = m_resource->getSegmentTrack(i, track);
+						bits += st.bitsizes[0] + st.bitsizes[1] + st.bitsizes[2] + 1;
+					}
+					bool open = ImGui::TreeNodeEx(&bone, flags, "%s (%.1f bits per key)", bone.name.c_str(), bits / float(m_resource->getSegmentsCount()));
 					if (ImGui::IsItemHovered() && ImGui::IsMouseReleased(ImGuiMouseButton_Left)) {
 						m_selected_bone = track.bone_index;
 					}
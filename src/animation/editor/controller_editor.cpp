@@ -75,6 +75,10 @@ void Controller::serialize(OutputMemoryStream& stream) {
 		stream.write(entry.set);
 		stream.writeString(entry.animation);
 	}
+	stream.write((u32)m_bone_masks.size());
+	for (const BoneMask& mask : m_bone_masks) {
+		mask.serialize(stream);
+	}
 	m_root->serialize(stream);
 }
 
@@ -97,6 +101,15 @@ bool Controller::compile(StudioApp& app, OutputMemoryStream& blob) {
 		controller.m_animation_entries[i].animation = path.isEmpty() ? nullptr : rm->getOwner().load<Animation>(path);
 	}
 
+	controller.m_bone_masks.reserve(m_bone_masks.size());
+	for (const BoneMask& mask : m_bone_masks) {
+		BoneMask& dst = controller.m_bone_masks.emplace(m_allocator);
+		dst.name = mask.name;
+		for (auto iter = mask.bones.begin(), end = mask.bones.end(); iter != end; ++iter) {
+			dst.bones.insert(iter.key(), iter.value());
+		}
+	}
+
 	controller.m_root = (anim::PoseNode*)m_root->compile(controller);
 	if (!controller.m_root) return false;
 	controller.serialize(blob);
@@ -136,6 +149,14 @@ bool Controller::deserialize(InputMemoryStream& stream) {
 		entry.animation = stream.readString();
 	}
 
+	if (header.version >= ControllerVersion::BONE_MASKS) {
+		const u32 masks_count = stream.read<u32>();
+		m_bone_masks.reserve(masks_count);
+		for (u32 i = 0; i < masks_count; ++i) {
+			m_bone_masks.emplace(m_allocator).deserialize(stream);
+		}
+	}
+
 	LUMIX_DELETE(m_allocator, m_root);
 
 	m_root = LUMIX_NEW(m_allocator, TreeNode)(nullptr, *this, m_allocator);
@@ -591,6 +612,15 @@ struct ControllerEditorImpl : ControllerEditor, AssetBrowser::IPlugin, AssetComp
 						ImGui::Text("slot = %d, weight = %f, time = %f, looped = %s", slot, weight, time.seconds(), looped ? "true" : "false");
 						break;
 					}
+					case anim::BlendStackInstructions::SAMPLE_MASKED: {
+						u32 slot = blob.read<u32>();
+						float weight = blob.read<float>();
+						Time time = blob.read<Time>();
+						bool looped = blob.read<bool>();
+						u32 mask = blob.read<u32>();
+						ImGui::Text("slot = %d, weight = %f, time = %f, looped = %s, mask = %d", slot, weight, time.seconds(), looped ? "true" : "false", mask);
+						break;
+					}
 				}
 			}		
 		}
@@ -84,6 +84,14 @@ static ValueNode* castToValueNode(Node* n) {
 	return (ValueNode*)n;
 }
 
+static bool compileValue(ValueNode& node, anim::Controller& controller, anim::ValueProgram& program) {
+	anim::ValueNode* tree = (anim::ValueNode*)node.compile(controller);
+	if (!tree) return false;
+	const bool compiled = program.compile(*tree);
+	anim::destroyValueNode(controller.m_allocator, tree);
+	return compiled;
+}
+
 Blend2DNode::Blend2DNode(Node* parent, Controller& controller, IAllocator& allocator)
 	: PoseNode(parent, controller, allocator) 
 	, m_children(allocator)
@@ -113,10 +121,8 @@ anim::Node* Blend2DNode::compile(anim::Controller& controller) {
 	if (x->getReturnType() != anim::Value::NUMBER) return nullptr;
 	if (y->getReturnType() != anim::Value::NUMBER) return nullptr;
 
-	node->m_x_value = (anim::ValueNode*)x->compile(controller);
-	node->m_y_value = (anim::ValueNode*)y->compile(controller);
-	if (!node->m_x_value) return nullptr;
-	if (!node->m_y_value) return nullptr;
+	if (!compileValue(*x, controller, node->m_x_value)) return nullptr;
+	if (!compileValue(*y, controller, node->m_y_value)) return nullptr;
 
 	return node.detach();
 }
@@ -404,8 +410,7 @@ anim::Node* Blend1DNode::compile(anim::Controller& controller) {
 	if (!val) return nullptr;
 	if (val->getReturnType() != anim::Value::NUMBER) return nullptr;
 
-	node->m_value = (anim::ValueNode*)val->compile(controller);
-	if (!node->m_value) return nullptr;
+	if (!compileValue(*val, controller, node->m_value)) return nullptr;
 
 	return node.detach();	
 }
@@ -698,14 +703,12 @@ anim::Node* IKNode::compile(anim::Controller& controller) {
 	ValueNode* alpha = castToValueNode(getInput(0));
 	if (!alpha) return nullptr;
 	if (alpha->getReturnType() != anim::Value::NUMBER) return nullptr;
-	node->m_alpha = (anim::ValueNode*)alpha->compile(controller);
-	if (!node->m_alpha) return nullptr;
+	if (!compileValue(*alpha, controller, node->m_alpha)) return nullptr;
 
 	ValueNode* effector = castToValueNode(getInput(1));
 	if (!effector) return nullptr;
 	if (effector->getReturnType() != anim::Value::VEC3) return nullptr;
-	node->m_effector_position = (anim::ValueNode*)effector->compile(controller);
-	if (!node->m_effector_position) return nullptr;
+	if (!compileValue(*effector, controller, node->m_effector_position)) return nullptr;
 
 	PoseNode* input = castToPoseNode(getInput(2));
 	if (!input) return nullptr;
@@ -792,8 +795,7 @@ anim::Node* PlayRateNode::compile(anim::Controller& controller) {
 	ValueNode* value = castToValueNode(getInput(0));
 	if (!value) return nullptr;
 	if (value->getReturnType() != anim::Value::NUMBER) return nullptr;
-	node->m_value = (anim::ValueNode*)value->compile(controller);
-	if (!node->m_value) return nullptr;
+	if (!compileValue(*value, controller, node->m_value)) return nullptr;
 
 	Node* pose = getInput(1);
 	if (!pose) return nullptr;
@@ -920,8 +922,7 @@ anim::Node* SelectNode::compile(anim::Controller& controller) {
 
 	UniquePtr<anim::SelectNode> node = UniquePtr<anim::SelectNode>::create(controller.m_allocator, controller.m_allocator);
 	node->m_blend_length = m_blend_length;
-	node->m_value = (anim::ValueNode*)value_node->compile(controller);
-	if (!node->m_value) return nullptr;
+	if (!compileValue(*value_node, controller, node->m_value)) return nullptr;
 
 	node->m_children.resize(m_options_count);
 	for (u32 i = 0; i < m_options_count; ++i) {
@@ -969,8 +970,7 @@ anim::Node* SwitchNode::compile(anim::Controller& controller) {
 
 	UniquePtr<anim::SwitchNode> node = UniquePtr<anim::SwitchNode>::create(controller.m_allocator, controller.m_allocator);
 	node->m_blend_length = m_blend_length;
-	node->m_value = (anim::ValueNode*)value_node->compile(controller);
-	if (!node->m_value) return nullptr;
+	if (!compileValue(*value_node, controller, node->m_value)) return nullptr;
 
 	PoseNode* truenode = castToPoseNode(getInput(1));
 	if (!truenode) return nullptr;
@@ -38,14 +38,48 @@ static LUMIX_FORCE_INLINE LocalRigidTransform getRootMotion(const RuntimeContext
 
 RuntimeContext::RuntimeContext(Controller& controller, IAllocator& allocator)
 	: data(allocator)
+	, prev_data(allocator)
 	, inputs(allocator)
 	, controller(controller)
 	, animations(allocator)
 	, blendstack(allocator)
 	, input_runtime(nullptr, 0)
+	, bone_masks(allocator)
 {
 }
 
+void RuntimeContext::setModel(Model* m) {
+	model = m;
+	if (controller.m_bone_masks.empty()) return;
+	// the model can be reloaded with a different skeleton, so check bone count too
+	const u32 bone_count = m && m->isReady() ? m->getBoneCount() : 0;
+	if (bone_masks_model == m && bone_masks_bone_count == bone_count) return;
+
+	bone_masks_model = m;
+	bone_masks_bone_count = bone_count;
+	bone_masks.clear();
+	if (bone_count == 0) return;
+
+	bone_mask_words = (bone_count + 63) / 64;
+	bone_masks.resize(bone_mask_words * controller.m_bone_masks.size());
+	memset(bone_masks.begin(), 0, bone_masks.byte_size());
+	for (u32 i = 0, c = controller.m_bone_masks.size(); i < c; ++i) {
+		u64* bits = &bone_masks[i * bone_mask_words];
+		for (auto iter = controller.m_bone_masks[i].bones.begin(), end = controller.m_bone_masks[i].bones.end(); iter != end; ++iter) {
+			auto bone = m->getBoneIndex(iter.key());
+			if (!bone.isValid()) continue;
+			const u32 bone_idx = bone.value();
+			bits[bone_idx >> 6] |= u64(1) << (bone_idx & 63);
+		}
+	}
+}
+
+const u64* RuntimeContext::getBoneMask(u32 mask_idx) const {
+	if (mask_idx >= (u32)controller.m_bone_masks.size()) return nullptr;
+	if (bone_masks.empty()) return nullptr;
+	return &bone_masks[mask_idx * bone_mask_words];
+}
+
 void RuntimeContext::setInput(u32 input_idx, float value) {
 	ASSERT(controller.m_inputs[input_idx].type == Value::NUMBER);
 	inputs[input_idx].f = value;
@@ -145,8 +179,6 @@ void AnimationNode::deserialize(InputMemoryStream& stream, Controller& ctrl, u32
 }
 
 SelectNode::~SelectNode() {
-	LUMIX_DELETE(m_allocator, m_value);
-	
 	for (PoseNode* child : m_children) {
 		LUMIX_DELETE(m_allocator, child);
 	}
@@ -155,12 +187,13 @@ SelectNode::~SelectNode() {
 SelectNode::SelectNode(IAllocator& allocator)
 	: m_children(allocator)
 	, m_allocator(allocator)
+	, m_value(allocator)
 {}
 
 void SelectNode::update(RuntimeContext& ctx) const {
 	RuntimeData data = ctx.input_runtime.read<RuntimeData>();
 	
-	i32 child_idx = m_value->eval(ctx).toI32();
+	i32 child_idx = m_value.eval(ctx).toI32();
 	child_idx = clamp(child_idx, 0, m_children.size() - 1);
 
 	if (data.from != data.to) {
@@ -207,7 +240,7 @@ void SelectNode::update(RuntimeContext& ctx) const {
 
 void SelectNode::enter(RuntimeContext& ctx) {
 	RuntimeData runtime_data = { 0, 0, Time(0) };
-	i32 child_idx = m_value->eval(ctx).toI32();
+	i32 child_idx = m_value.eval(ctx).toI32();
 	child_idx = clamp(child_idx, 0, m_children.size() - 1);
 	runtime_data.from = child_idx;
 	runtime_data.to = runtime_data.from;
@@ -231,7 +264,7 @@ void SelectNode::serialize(OutputMemoryStream& stream) const {
 	for (const Node* n : m_children) {
 		serializeNode(stream, *n);
 	}
-	serializeNode(stream, *m_value);
+	m_value.serialize(stream);
 }
 
 void SelectNode::deserialize(InputMemoryStream& stream, Controller& ctrl, u32 version) {
@@ -241,7 +274,7 @@ void SelectNode::deserialize(InputMemoryStream& stream, Controller& ctrl, u32 ve
 	for (u32 i = 0; i < count; ++i) {
 		m_children[i] = (PoseNode*)deserializeNode(stream, ctrl, version);
 	}
-	m_value = (ValueNode*)deserializeNode(stream, ctrl, version);
+	m_value.deserialize(stream, ctrl, version);
 }
 
 Time SelectNode::length(const RuntimeContext& ctx) const {	return Time::fromSeconds(1); }
@@ -249,19 +282,19 @@ Time SelectNode::length(const RuntimeContext& ctx) const {	return Time::fromSeco
 Time SelectNode::time(const RuntimeContext& ctx) const { return Time(0); }
 
 SwitchNode::~SwitchNode() {
-	LUMIX_DELETE(m_allocator, m_value);
 	LUMIX_DELETE(m_allocator, m_true_node);
 	LUMIX_DELETE(m_allocator, m_false_node);
 }
 
 SwitchNode::SwitchNode(IAllocator& allocator)
 	: m_allocator(allocator)
+	, m_value(allocator)
 {}
 
 void SwitchNode::update(RuntimeContext& ctx) const {
 	RuntimeData data = ctx.input_runtime.read<RuntimeData>();
 	
-	bool condition = m_value->eval(ctx).toBool();
+	bool condition = m_value.eval(ctx).toBool();
 
 	if (data.switching) {
 		data.t += ctx.time_delta;
@@ -308,7 +341,7 @@ void SwitchNode::update(RuntimeContext& ctx) const {
 
 void SwitchNode::enter(RuntimeContext& ctx) {
 	RuntimeData runtime_data;
-	bool condition = m_value->eval(ctx).toBool();
+	bool condition = m_value.eval(ctx).toBool();
 	runtime_data.current = condition;
 	runtime_data.switching = false;
 	runtime_data.t = Time(0);
@@ -328,14 +361,14 @@ void SwitchNode::serialize(OutputMemoryStream& stream) const {
 	stream.write(m_blend_length);
 	serializeNode(stream, *m_true_node);
 	serializeNode(stream, *m_false_node);
-	serializeNode(stream, *m_value);
+	m_value.serialize(stream);
 }
 
 void SwitchNode::deserialize(InputMemoryStream& stream, Controller& ctrl, u32 version) {
 	stream.read(m_blend_length);
 	m_true_node = (PoseNode*)deserializeNode(stream, ctrl, version);
 	m_false_node = (PoseNode*)deserializeNode(stream, ctrl, version);
-	m_value = (ValueNode*)deserializeNode(stream, ctrl, version);
+	m_value.deserialize(stream, ctrl, version);
 }
 
 Time SwitchNode::length(const RuntimeContext& ctx) const {	return Time::fromSeconds(1); }
@@ -344,21 +377,21 @@ Time SwitchNode::time(const RuntimeContext& ctx) const { return Time(0); }
 
 
 IKNode::~IKNode() {
-	LUMIX_DELETE(m_allocator, m_alpha);
 	LUMIX_DELETE(m_allocator, m_input);
-	LUMIX_DELETE(m_allocator, m_effector_position);
 }
 
 IKNode::IKNode(IAllocator& allocator)
 	: m_allocator(allocator)
+	, m_alpha(allocator)
+	, m_effector_position(allocator)
 {}
 
 void IKNode::update(RuntimeContext& ctx) const {
 	m_input->update(ctx);
-	float alpha = m_alpha->eval(ctx).toFloat();
+	float alpha = m_alpha.eval(ctx).toFloat();
 	if (alpha > 0) {
 		alpha = minimum(1.f, alpha);
-		Vec3 effector_position = m_effector_position->eval(ctx).toVec3();
+		Vec3 effector_position = m_effector_position.eval(ctx).toVec3();
 		ctx.blendstack.write(BlendStackInstructions::IK);
 		ctx.blendstack.write(alpha);
 		ctx.blendstack.write(effector_position);
@@ -378,16 +411,16 @@ void IKNode::skip(RuntimeContext& ctx) const {
 void IKNode::serialize(OutputMemoryStream& stream) const {
 	stream.write(m_bones_count);
 	stream.write(m_leaf_bone);
-	serializeNode(stream, *m_alpha);
-	serializeNode(stream, *m_effector_position);
+	m_alpha.serialize(stream);
+	m_effector_position.serialize(stream);
 	serializeNode(stream, *m_input);
 }
 
 void IKNode::deserialize(InputMemoryStream& stream, Controller& ctrl, u32 version) {
 	stream.read(m_bones_count);
 	stream.read(m_leaf_bone);
-	m_alpha = (ValueNode*)deserializeNode(stream, ctrl, version);
-	m_effector_position = (ValueNode*)deserializeNode(stream, ctrl, version);
+	m_alpha.deserialize(stream, ctrl, version);
+	m_effector_position.deserialize(stream, ctrl, version);
 	m_input = (PoseNode*)deserializeNode(stream, ctrl, version);
 }
 
@@ -420,6 +453,83 @@ Value ConstNode::eval(const RuntimeContext& ctx) const {
 	return m_value;
 }
 
+void destroyValueNode(IAllocator& allocator, ValueNode* node) {
+	if (!node) return;
+	switch (node->type()) {
+		case NodeType::INPUT:
+		case NodeType::CONSTANT: break;
+		default: {
+			MathNodeBase* math = (MathNodeBase*)node;
+			destroyValueNode(allocator, math->m_input0);
+			destroyValueNode(allocator, math->m_input1);
+			break;
+		}
+	}
+	LUMIX_DELETE(allocator, node);
+}
+
+// appends `node` in postfix order, returns stack depth needed to evaluate it
+static u32 flattenValue(const ValueNode& node, Array<ValueProgram::Op>& ops) {
+	ValueProgram::Op op;
+	op.type = node.type();
+	op.input_index = 0;
+	switch (op.type) {
+		case NodeType::INPUT:
+			op.input_index = ((const InputNode&)node).m_input_index;
+			ops.push(op);
+			return 1;
+		case NodeType::CONSTANT:
+			op.constant = ((const ConstNode&)node).m_value;
+			ops.push(op);
+			return 1;
+		default: {
+			const MathNodeBase& math = (const MathNodeBase&)node;
+			const u32 depth0 = flattenValue(*math.m_input0, ops);
+			const u32 depth1 = flattenValue(*math.m_input1, ops);
+			ops.push(op);
+			return maximum(depth0, depth1 + 1);
+		}
+	}
+}
+
+bool ValueProgram::compile(const ValueNode& node) {
+	m_ops.clear();
+	return flattenValue(node, m_ops) <= MAX_STACK;
+}
+
+Value ValueProgram::eval(const RuntimeContext& ctx) const {
+	Value stack[MAX_STACK];
+	u32 top = 0;
+	for (const Op& op : m_ops) {
+		switch (op.type) {
+			case NodeType::INPUT: stack[top++] = ctx.inputs[op.input_index]; break;
+			case NodeType::CONSTANT: stack[top++] = op.constant; break;
+			default:
+				ASSERT(top >= 2);
+				stack[top - 2] = evalMath(op.type, stack[top - 2], stack[top - 1]);
+				--top;
+				break;
+		}
+	}
+	ASSERT(top == 1);
+	return stack[0];
+}
+
+void ValueProgram::serialize(OutputMemoryStream& stream) const {
+	stream.writeArray(m_ops);
+}
+
+void ValueProgram::deserialize(InputMemoryStream& stream, Controller& ctrl, u32 version) {
+	if (version < (u32)ControllerVersion::FLAT_VALUES) {
+		ValueNode* tree = (ValueNode*)deserializeNode(stream, ctrl, version);
+		const bool compiled = compile(*tree);
+		ASSERT(compiled);
+		destroyValueNode(ctrl.m_allocator, tree);
+		return;
+	}
+	stream.readArray(&m_ops);
+}
+
 struct Blend2DActiveTrio {
 	u32 a, b, c;
 	float ta, tb, tc;
@@ -465,29 +575,28 @@ static Blend2DActiveTrio getActiveTrio(const Blend2DNode& node, Vec2 input_val)
 	return res;
 }
 
-Blend2DNode::~Blend2DNode() {
-	LUMIX_DELETE(m_allocator, m_x_value);
-	LUMIX_DELETE(m_allocator, m_y_value);
-}
+Blend2DNode::~Blend2DNode() {}
 
 Blend2DNode::Blend2DNode(IAllocator& allocator)
 	: m_children(allocator)
 	, m_triangles(allocator)
 	, m_allocator(allocator)
+	, m_x_value(allocator)
+	, m_y_value(allocator)
 {}
 
 void Blend2DNode::serialize(OutputMemoryStream& stream) const {
 	stream.writeArray(m_children);
 	stream.writeArray(m_triangles);
-	serializeNode(stream, *m_x_value);
-	serializeNode(stream, *m_y_value);
+	m_x_value.serialize(stream);
+	m_y_value.serialize(stream);
 }
 
 void Blend2DNode::deserialize(InputMemoryStream& stream, Controller& ctrl, u32 version) {
 	stream.readArray(&m_children);
 	stream.readArray(&m_triangles);
-	m_x_value = (ValueNode*)deserializeNode(stream, ctrl, version);
-	m_y_value = (ValueNode*)deserializeNode(stream, ctrl, version);
+	m_x_value.deserialize(stream, ctrl, version);
+	m_y_value.deserialize(stream, ctrl, version);
 }
 
 static Time toTime(const Animation& anim, float relt) {
@@ -499,8 +608,8 @@ void Blend2DNode::update(RuntimeContext& ctx) const {
 	const float relt0 = relt;
 	
 	Vec2 input_val;
-	input_val.x = m_x_value->eval(ctx).toFloat();
-	input_val.y = m_y_value->eval(ctx).toFloat();
+	input_val.x = m_x_value.eval(ctx).toFloat();
+	input_val.y = m_y_value.eval(ctx).toFloat();
 	const Blend2DActiveTrio trio = getActiveTrio(*this, input_val);
 	const Animation* anim_a = ctx.animations[trio.a];
 	const Animation* anim_b = ctx.animations[trio.b];
@@ -564,8 +673,8 @@ Time Blend2DNode::length(const RuntimeContext& ctx) const {
 	if (m_children.size() < 3) return Time(1);
 
 	Vec2 input_val;
-	input_val.x = m_x_value->eval(ctx).toFloat();
-	input_val.y = m_y_value->eval(ctx).toFloat();
+	input_val.x = m_x_value.eval(ctx).toFloat();
+	input_val.y = m_y_value.eval(ctx).toFloat();
 	const Blend2DActiveTrio trio = getActiveTrio(*this, input_val);
 
 	Animation* anim_a = ctx.animations[trio.a];
@@ -615,30 +724,29 @@ static Blend1DActivePair getActivePair(const Blend1DNode& node, float input_val)
 	return { &children[0], nullptr, 0 };
 }
 
-Blend1DNode::~Blend1DNode() {
-	LUMIX_DELETE(m_allocator, m_value);
-}
+Blend1DNode::~Blend1DNode() {}
 
 Blend1DNode::Blend1DNode(IAllocator& allocator)
 	: m_children(allocator)
 	, m_allocator(allocator)
+	, m_value(allocator)
 {}
 
 void Blend1DNode::serialize(OutputMemoryStream& stream) const {
 	stream.writeArray(m_children);
-	serializeNode(stream, *m_value);
+	m_value.serialize(stream);
 }
 
 void Blend1DNode::deserialize(InputMemoryStream& stream, Controller& ctrl, u32 version) {
 	stream.readArray(&m_children);
-	m_value = (ValueNode*)deserializeNode(stream, ctrl, version);
+	m_value.deserialize(stream, ctrl, version);
 }
 
 void Blend1DNode::update(RuntimeContext& ctx) const {
 	float relt = ctx.input_runtime.read<float>();
 	const float relt0 = relt;
 	
-	const float input_val = m_value->eval(ctx).toFloat();
+	const float input_val = m_value.eval(ctx).toFloat();
 	const Blend1DActivePair pair = getActivePair(*this, input_val);
 	const Animation* anim_a = pair.a ? ctx.animations[pair.a->slot] : nullptr;
 	const Animation* anim_b = pair.b ? ctx.animations[pair.b->slot] : nullptr;
@@ -681,7 +789,7 @@ void Blend1DNode::update(RuntimeContext& ctx) const {
 }
 
 Time Blend1DNode::length(const RuntimeContext& ctx) const {
-	const float input_val = m_value->eval(ctx).toFloat();
+	const float input_val = m_value.eval(ctx).toFloat();
 	const Blend1DActivePair pair = getActivePair(*this, input_val);
 	Animation* anim_a = ctx.animations[pair.a->slot];
 	if (!anim_a) return Time::fromSeconds(1);
@@ -709,26 +817,26 @@ void Blend1DNode::skip(RuntimeContext& ctx) const {
 
 PlayRateNode::~PlayRateNode() {
 	LUMIX_DELETE(m_allocator, m_node);
-	LUMIX_DELETE(m_allocator, m_value);
 }
 
 PlayRateNode::PlayRateNode(IAllocator& allocator)
 	: m_allocator(allocator)
+	, m_value(allocator)
 {}
 
 void PlayRateNode::serialize(OutputMemoryStream& stream) const {
-	serializeNode(stream, *m_value);
+	m_value.serialize(stream);
 	serializeNode(stream, *m_node);
 }
 
 void PlayRateNode::deserialize(InputMemoryStream& stream, Controller& ctrl, u32 version) {
-	m_value = (ValueNode*)deserializeNode(stream, ctrl, version);
+	m_value.deserialize(stream, ctrl, version);
 	m_node = (PoseNode*)deserializeNode(stream, ctrl, version);
 }
 
 void PlayRateNode::update(RuntimeContext& ctx) const {
 	float td = ctx.time_delta.seconds();
-	ctx.time_delta = ctx.time_delta * maximum(0.f, m_value->eval(ctx).toFloat());
+	ctx.time_delta = ctx.time_delta * maximum(0.f, m_value.eval(ctx).toFloat());
 	m_node->update(ctx);
 	ctx.time_delta = Time::fromSeconds(td);
 }
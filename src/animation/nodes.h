@@ -89,8 +89,37 @@ struct ConstNode final : ValueNode {
 	Value m_value;
 };
 
+// shared by MathNode and ValueProgram
+inline Value evalMath(NodeType type, Value v0, Value v1) {
+	// TODO other types
+	switch (type) {
+		case NodeType::CMP_GT: return v0.f > v1.f;
+		case NodeType::CMP_GTE: return v0.f >= v1.f;
+		case NodeType::CMP_LT: return v0.f < v1.f;
+		case NodeType::CMP_LTE: return v0.f <= v1.f;
+		case NodeType::CMP_NEQ: return v0.f != v1.f;
+		case NodeType::CMP_EQ: return v0.f == v1.f;
+
+		case NodeType::AND: return v0.b && v1.b;
+		case NodeType::OR: return v0.b || v1.b;
+
+		case NodeType::MUL: return v0.f * v1.f;
+		case NodeType::DIV: return v0.f / v1.f;
+		case NodeType::ADD: return v0.f + v1.f;
+		case NodeType::SUB: return v0.f - v1.f;
+		default:
+			ASSERT(false);
+			return false;
+	}
+}
+
+struct MathNodeBase : ValueNode {
+	ValueNode* m_input0 = nullptr;
+	ValueNode* m_input1 = nullptr;
+};
+
 template <NodeType T>
-struct MathNode final : ValueNode {
+struct MathNode final : MathNodeBase {
 	NodeType type() const override { return T; }
 
 	void serialize(OutputMemoryStream& stream) const override {
@@ -104,31 +133,32 @@ struct MathNode final : ValueNode {
 	}
 
 	Value eval(const RuntimeContext& ctx) const override {
-		Value v0 = m_input0->eval(ctx);
-		Value v1 = m_input1->eval(ctx);
-		// TODO other types
-		if constexpr (T == NodeType::CMP_GT) return v0.f > v1.f;
-		else if constexpr (T == NodeType::CMP_GTE) return v0.f >= v1.f;
-		else if constexpr (T == NodeType::CMP_LT) return v0.f < v1.f;
-		else if constexpr (T == NodeType::CMP_LTE) return v0.f <= v1.f;
-		else if constexpr (T == NodeType::CMP_NEQ) return v0.f != v1.f;
-		else if constexpr (T == NodeType::CMP_EQ) return v0.f == v1.f;
-		
-		else if constexpr (T == NodeType::AND) return v0.b && v1.b;
-		else if constexpr (T == NodeType::OR) return v0.b || v1.b;
-
-		else if constexpr (T == NodeType::MUL) return v0.f * v1.f;
-		else if constexpr (T == NodeType::DIV) return v0.f / v1.f;
-		else if constexpr (T == NodeType::ADD) return v0.f + v1.f;
-		else if constexpr (T == NodeType::SUB) return v0.f - v1.f;
-		else {
-			ASSERT(false);
-			return false;
-		}
+		return evalMath(T, m_input0->eval(ctx), m_input1->eval(ctx));
 	}
+};
 
-	ValueNode* m_input0 = nullptr;
-	ValueNode* m_input1 = nullptr;
+// destroys `node` including all its inputs
+void destroyValueNode(IAllocator& allocator, ValueNode* node);
+
+// ValueNode tree flattened in postfix order, pose nodes evaluate their values through this
+// with a loop over a small stack instead of recursive virtual calls
+struct ValueProgram {
+	static constexpr u32 MAX_STACK = 16;
+
+	struct Op {
+		NodeType type;
+		u32 input_index;
+		Value constant;
+	};
+
+	ValueProgram(IAllocator& allocator) : m_ops(allocator) {}
+	// fails if `node` is too deep to be evaluated with MAX_STACK
+	bool compile(const ValueNode& node);
+	Value eval(const RuntimeContext& ctx) const;
+	void serialize(OutputMemoryStream& stream) const;
+	void deserialize(InputMemoryStream& stream, Controller& ctrl, u32 version);
+
+	Array<Op> m_ops;
 };
 
 struct PlayRateNode final : PoseNode {
@@ -144,7 +174,7 @@ struct PlayRateNode final : PoseNode {
 	Time time(const RuntimeContext& ctx) const override;
 
 	IAllocator& m_allocator;
-	ValueNode* m_value = nullptr;
+	ValueProgram m_value;
 	PoseNode* m_node = nullptr;
 };
 
@@ -167,7 +197,7 @@ struct Blend1DNode final : PoseNode {
 
 	IAllocator& m_allocator;
 	Array<Child> m_children;
-	ValueNode* m_value = nullptr;
+	ValueProgram m_value;
 };
 
 
@@ -196,8 +226,8 @@ struct Blend2DNode final : PoseNode {
 	IAllocator& m_allocator;
 	Array<Triangle> m_triangles;
 	Array<Child> m_children;
-	ValueNode* m_x_value = nullptr;
-	ValueNode* m_y_value = nullptr;
+	ValueProgram m_x_value;
+	ValueProgram m_y_value;
 };
 
 struct SelectNode final : PoseNode {
@@ -220,7 +250,7 @@ struct SelectNode final : PoseNode {
 
 	IAllocator& m_allocator;
 	Array<PoseNode*> m_children;
-	ValueNode* m_value = nullptr;
+	ValueProgram m_value;
 	Time m_blend_length;
 };
 
@@ -245,7 +275,7 @@ struct SwitchNode final : PoseNode {
 	IAllocator& m_allocator;
 	PoseNode* m_true_node = nullptr;
 	PoseNode* m_false_node = nullptr;
-	ValueNode* m_value = nullptr;
+	ValueProgram m_value;
 	Time m_blend_length;
 };
 
@@ -262,8 +292,8 @@ struct IKNode final : PoseNode {
 	Time time(const RuntimeContext& ctx) const override;
 
 	IAllocator& m_allocator;
-	ValueNode* m_alpha = nullptr;
-	ValueNode* m_effector_position = nullptr;
+	ValueProgram m_alpha;
+	ValueProgram m_effector_position;
 	PoseNode* m_input = nullptr;
 	u32 m_leaf_bone;
 	u32 m_bones_count;
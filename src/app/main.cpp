@@ -1,6 +1,7 @@
 #if 1 // set to 0 to build minimal lunex example
 
 #include "core/atomic.h"
+#include "core/allocator.h"
 #include "core/command_line_parser.h"
 #include "core/debug.h"
 #include "core/default_allocator.h"
@@ -11,7 +12,9 @@
 #include "core/os.h"
 #include "core/path.h"
 #include "core/profiler.h"
+#include "core/sort.h"
 #include "core/thread.h"
+#include "engine/core.h"
 #include "engine/engine.h"
 #include "engine/input_system.h"
 #include "engine/plugin.h"
@@ -19,6 +22,7 @@
 #include "engine/resource_manager.h"
 #include "engine/world.h"
 #include "gui/gui_system.h"
+#include "renderer/gpu/gpu.h"
 #include "renderer/pipeline.h"
 #include "renderer/render_module.h"
 #include "renderer/renderer.h"
@@ -32,6 +36,341 @@
 using namespace Lumix;
 
 static const ComponentType ENVIRONMENT_TYPE = reflection::getComponentType("environment");
+static const ComponentType SPLINE_TYPE = reflection::getComponentType("spline");
+
+// `app -benchmark <world> [-camera_path <entity name>] [-frames N] [-warmup N] [-benchmark_report <path>]`
+// renders `warmup` frames, then measures `frames` frames while the active camera flies along the spline
+// component of the `camera_path` entity, writes a JSON report and exits
+struct Benchmark {
+	explicit Benchmark(IAllocator& allocator)
+		: frame_times(allocator)
+		, gpu_frame_times(allocator)
+		, path(allocator)
+		, allocator(allocator)
+	{}
+
+	// returns false if benchmark mode is not requested
+	bool parseCommandLine(Path& world) {
+		char cmd_line[4096];
+		if (!os::getCommandLine(cmd_line)) return false;
+
+		CommandLineParser parser(cmd_line);
+		char tmp[MAX_PATH];
+		while (parser.next()) {
+			if (parser.currentEquals("-benchmark")) {
+				if (!parser.next()) break;
+				parser.getCurrent(tmp, lengthOf(tmp));
+				world = tmp;
+				enabled = true;
+			}
+			else if (parser.currentEquals("-camera_path")) {
+				if (!parser.next()) break;
+				parser.getCurrent(camera_path.data, sizeof(camera_path.data));
+			}
+			else if (parser.currentEquals("-benchmark_report")) {
+				if (!parser.next()) break;
+				parser.getCurrent(report_path.data, sizeof(report_path.data));
+			}
+			else if (parser.currentEquals("-frames")) {
+				if (!parser.next()) break;
+				parser.getCurrent(tmp, lengthOf(tmp));
+				fromCString(tmp, frames);
+			}
+			else if (parser.currentEquals("-warmup")) {
+				if (!parser.next()) break;
+				parser.getCurrent(tmp, lengthOf(tmp));
+				fromCString(tmp, warmup);
+			}
+		}
+		frames = maximum(frames, 1u);
+		return enabled;
+	}
+
+	void start(World& world) {
+		frame_times.reserve(frames);
+		gpu_frame_times.reserve(frames);
+
+		if (camera_path[0]) {
+			const EntityPtr e = world.findByName(INVALID_ENTITY, camera_path);
+			if (!e.isValid() || !world.hasComponent((EntityRef)e, SPLINE_TYPE)) {
+				logError("Benchmark: entity ", camera_path, " with spline component not found");
+			}
+			else {
+				CoreModule* core = (CoreModule*)world.getModule(SPLINE_TYPE);
+				const Spline& spline = core->getSpline((EntityRef)e);
+				const Transform tr = world.getTransform((EntityRef)e);
+				for (const Vec3& p : spline.points) path.push(tr.transform(p));
+			}
+		}
+		frame_timer.tick();
+	}
+
+	// moves camera by distance along the path, so speed is constant even if points are not evenly spaced
+	void moveCamera(World& world, EntityPtr camera) {
+		if (!camera.isValid() || path.size() < 2) return;
+
+		const float t = clamp(float(frame) - warmup, 0.f, (float)frames) / frames;
+		double total = 0;
+		for (i32 i = 1; i < path.size(); ++i) total += length(path[i] - path[i - 1]);
+		double dist = total * t;
+		i32 segment = 1;
+		for (; segment < path.size() - 1; ++segment) {
+			const double l = length(path[segment] - path[segment - 1]);
+			if (dist <= l) break;
+			dist -= l;
+		}
+
+		const DVec3 a = path[segment - 1];
+		const DVec3 b = path[segment];
+		const double seg_len = length(b - a);
+		const DVec3 pos = seg_len > 0 ? a + (b - a) * minimum(dist / seg_len, 1.0) : a;
+		const Vec3 dir = seg_len > 0 ? normalize(Vec3(b - a)) : Vec3(0, 0, -1);
+		const float yaw = atan2f(-dir.x, -dir.z);
+		const float pitch = asinf(clamp(dir.y, -1.f, 1.f));
+		const Quat rot = Quat(Vec3(0, 1, 0), yaw) * Quat(Vec3(1, 0, 0), pitch);
+		world.setTransform((EntityRef)camera, pos, rot, world.getScale((EntityRef)camera));
+	}
+
+	// returns true when all frames are measured
+	bool endFrame(Renderer& renderer) {
+		const float dt = frame_timer.tick();
+		++frame;
+		if (frame == warmup) profiler::enableBlockStats(true);
+		if (frame <= warmup) return false;
+
+		frame_times.push(dt);
+		gpu_frame_times.push(renderer.getGPUFrameTime());
+		return frame_times.size() >= (i32)frames;
+	}
+
+	static float percentile(const Array<float>& sorted, float p) {
+		if (sorted.empty()) return 0;
+		const u32 idx = minimum(u32(p * (sorted.size() - 1) + 0.5f), u32(sorted.size() - 1));
+		return sorted[idx];
+	}
+
+	static void writeTimes(IOutputStream& out, const char* name, Array<float>& times) {
+		sort(times.begin(), times.end());
+		double sum = 0;
+		for (float t : times) sum += t;
+		const float avg = times.empty() ? 0 : float(sum / times.size());
+		out << "\t\"" << name << "\": { "
+			<< "\"avg\": " << avg * 1000.f
+			<< ", \"min\": " << percentile(times, 0) * 1000.f
+			<< ", \"p50\": " << percentile(times, 0.5f) * 1000.f
+			<< ", \"p90\": " << percentile(times, 0.9f) * 1000.f
+			<< ", \"p95\": " << percentile(times, 0.95f) * 1000.f
+			<< ", \"p99\": " << percentile(times, 0.99f) * 1000.f
+			<< ", \"max\": " << percentile(times, 1) * 1000.f
+			<< " },\n";
+	}
+
+	// all times are in milliseconds, block and GPU scope times are averages per frame
+	void writeReport() {
+		Array<profiler::BlockStats> blocks(allocator);
+		blocks.resize(4096);
+		blocks.resize(profiler::getBlockStats(blocks));
+		profiler::enableBlockStats(false);
+		sort(blocks.begin(), blocks.end(), [](const profiler::BlockStats& a, const profiler::BlockStats& b){
+			return a.total_ticks > b.total_ticks;
+		});
+
+		Array<profiler::GPUScopeStats> gpu_scopes(allocator);
+		gpu_scopes.resize(profiler::getGPUScopeStats({}));
+		gpu_scopes.resize(profiler::getGPUScopeStats(gpu_scopes));
+
+		os::OutputFile file;
+		if (!file.open(report_path)) {
+			logError("Benchmark: failed to create ", report_path);
+			return;
+		}
+
+		file << "{\n\t\"frames\": " << frame_times.size() << ",\n";
+		file << "\t\"warmup\": " << warmup << ",\n";
+		writeTimes(file, "cpu_frame", frame_times);
+		writeTimes(file, "gpu_frame", gpu_frame_times);
+
+		const double to_ms = 1000.0 / profiler::frequency();
+		file << "\t\"blocks\": [";
+		for (const profiler::BlockStats& b : blocks) {
+			file << (&b == blocks.begin() ? "\n" : ",\n");
+			file << "\t\t{ \"name\": \"" << b.name
+				<< "\", \"avg\": " << float(b.total_ticks * to_ms / frame_times.size())
+				<< ", \"count\": " << float(double(b.count) / frame_times.size()) << " }";
+		}
+		file << "\n\t],\n";
+
+		// GPU scopes keep only last few samples
+		file << "\t\"gpu_scopes\": [";
+		for (const profiler::GPUScopeStats& s : gpu_scopes) {
+			file << (&s == gpu_scopes.begin() ? "\n" : ",\n");
+			file << "\t\t{ \"name\": \"" << s.name
+				<< "\", \"avg\": " << s.avg * 1000.f
+				<< ", \"min\": " << s.min * 1000.f
+				<< ", \"max\": " << s.max * 1000.f;
+			if (s.has_pipeline_stats) {
+				file << ", \"input_primitives\": " << s.pipeline_stats.input_primitives
+					<< ", \"culled_primitives\": " << s.pipeline_stats.culled_primitives
+					<< ", \"vs_invocations\": " << s.pipeline_stats.vs_invocations
+					<< ", \"ps_invocations\": " << s.pipeline_stats.ps_invocations;
+			}
+			file << " }";
+		}
+		file << "\n\t],\n";
+
+		file << "\t\"memory\": {\n";
+		file << "\t\t\"registered_allocs_mb\": " << float(debug::getRegisteredAllocsSize() / (1024.0 * 1024.0));
+		#ifdef _WIN32
+			file << ",\n\t\t\"process_mb\": " << float(os::getProcessMemory() / (1024.0 * 1024.0));
+		#endif
+		gpu::MemoryStats gpu_mem;
+		if (gpu::getMemoryStats(gpu_mem)) {
+			file << ",\n\t\t\"gpu_usage_mb\": " << float(gpu_mem.usage / (1024.0 * 1024.0));
+			file << ",\n\t\t\"gpu_textures_mb\": " << float(gpu_mem.texture_mem / (1024.0 * 1024.0));
+			file << ",\n\t\t\"gpu_buffers_mb\": " << float(gpu_mem.buffer_mem / (1024.0 * 1024.0));
+			file << ",\n\t\t\"gpu_render_targets_mb\": " << float(gpu_mem.render_target_mem / (1024.0 * 1024.0));
+		}
+		file << "\n\t}\n}\n";
+		file.close();
+		logInfo("Benchmark: report written to ", report_path);
+	}
+
+	IAllocator& allocator;
+	bool enabled = false;
+	u32 frames = 2000;
+	u32 warmup = 200;
+	u32 frame = 0;
+	StaticString<64> camera_path;
+	StaticString<MAX_PATH> report_path = "benchmark.json";
+	Array<DVec3> path;
+	Array<float> frame_times;
+	Array<float> gpu_frame_times;
+	os::Timer frame_timer;
+};
+
+// `app -server [-world <path>]... [-tick_rate N] [-server_stats S]`
+// headless dedicated server, no window and no GPU, see Engine::InitArgs::headless
+// all worlds are ticked at a fixed rate, sharing the job system and resources, the process sleeps between ticks
+// tick times are pushed to profiler counters per world, and logged every `S` seconds
+struct Server {
+	struct ServerWorld {
+		World* world;
+		Path path;
+		u32 counter;
+		u64 ticks_sum = 0;
+		u64 ticks_max = 0;
+	};
+
+	explicit Server(IAllocator& allocator)
+		: worlds(allocator)
+		, world_paths(allocator)
+	{}
+
+	void parseCommandLine() {
+		enabled = CommandLineParser::isOn("-server");
+		if (!enabled) return;
+
+		char cmd_line[4096];
+		if (!os::getCommandLine(cmd_line)) return;
+
+		CommandLineParser parser(cmd_line);
+		char tmp[MAX_PATH];
+		while (parser.next()) {
+			if (parser.currentEquals("-world")) {
+				if (!parser.next()) break;
+				parser.getCurrent(tmp, lengthOf(tmp));
+				world_paths.emplace(tmp);
+			}
+			else if (parser.currentEquals("-tick_rate")) {
+				if (!parser.next()) break;
+				parser.getCurrent(tmp, lengthOf(tmp));
+				fromCString(tmp, tick_rate);
+			}
+			else if (parser.currentEquals("-server_stats")) {
+				if (!parser.next()) break;
+				parser.getCurrent(tmp, lengthOf(tmp));
+				fromCString(tmp, stats_interval);
+			}
+		}
+		tick_rate = maximum(tick_rate, 1u);
+	}
+
+	void add(World& world, const Path& path) {
+		ServerWorld& w = worlds.emplace();
+		w.world = &world;
+		w.path = path;
+		const StaticString<MAX_PATH + 32> name("Tick ", worlds.size() - 1, " ", Path::getBasename(path), " (ms)");
+		w.counter = profiler::createCounter(name, 0);
+	}
+
+	void start() {
+		next_tick = os::Timer::getRawTimestamp();
+		stats_start = next_tick;
+		logInfo("Server: ", worlds.size(), " worlds at ", tick_rate, " ticks per second");
+	}
+
+	void tick(Engine& engine) {
+		PROFILE_FUNCTION();
+		const float dt = 1.f / tick_rate;
+		const double to_ms = 1000.0 / os::Timer::getFrequency();
+		for (ServerWorld& w : worlds) {
+			const u64 start = os::Timer::getRawTimestamp();
+			engine.update(*w.world, dt);
+			const u64 ticks = os::Timer::getRawTimestamp() - start;
+			w.ticks_sum += ticks;
+			w.ticks_max = maximum(w.ticks_max, ticks);
+			profiler::pushCounter(w.counter, float(ticks * to_ms));
+		}
+		engine.updateSystems(dt);
+		++tick_count;
+
+		const u64 now = os::Timer::getRawTimestamp();
+		if (stats_interval > 0 && now - stats_start > stats_interval * os::Timer::getFrequency()) {
+			for (ServerWorld& w : worlds) {
+				logInfo("Server: ", w.path, " avg ", float(w.ticks_sum * to_ms / tick_count), " ms, max ", float(w.ticks_max * to_ms), " ms");
+				w.ticks_sum = 0;
+				w.ticks_max = 0;
+			}
+			if (dropped_ticks > 0) logWarning("Server: ", dropped_ticks, " ticks dropped, too slow");
+			dropped_ticks = 0;
+			tick_count = 0;
+			stats_start = now;
+		}
+	}
+
+	// sleeps until the next tick, time is measured from the previous tick's start, so ticks do not drift
+	void sleep() {
+		PROFILE_FUNCTION();
+		const u64 freq = os::Timer::getFrequency();
+		const u64 period = freq / tick_rate;
+		next_tick += period;
+		u64 now = os::Timer::getRawTimestamp();
+		if (now > next_tick) {
+			// too far behind, skip the missed ticks instead of running them all at once
+			dropped_ticks += u32((now - next_tick) / period);
+			next_tick = now;
+			return;
+		}
+		// os::sleep is not precise, so it sleeps for less and the rest is spent yielding
+		const u64 precision = freq / 500;
+		while (next_tick - now > precision) {
+			os::sleep(u32((next_tick - now - precision) * 1000 / freq) + 1);
+			now = os::Timer::getRawTimestamp();
+			if (now >= next_tick) return;
+		}
+		while (os::Timer::getRawTimestamp() < next_tick) os::sleep(0);
+	}
+
+	bool enabled = false;
+	u32 tick_rate = 30;
+	u32 stats_interval = 10;
+	u32 tick_count = 0;
+	u32 dropped_ticks = 0;
+	u64 next_tick = 0;
+	u64 stats_start = 0;
+	Array<ServerWorld> worlds;
+	Array<Path> world_paths;
+};
 
 struct GUIInterface : GUISystem::Interface {
 	Pipeline* getPipeline() override { return pipeline; }
@@ -50,10 +389,16 @@ struct Runner final
 	Runner() 
 		: m_allocator(m_main_allocator)
 		, m_imgui(m_allocator)
+		, m_benchmark(m_allocator)
+		, m_server(m_allocator)
 	{
 		debug::init(m_allocator);
 		profiler::init(m_allocator);
-		if (!jobs::init(os::getCPUsCount(), m_allocator)) {
+		jobs::FiberPoolConfig fibers;
+		CommandLineParser::getValue("-fibers", fibers.small_count);
+		CommandLineParser::getValue("-large_fibers", fibers.large_count);
+		if (CommandLineParser::getValue("-fiber_stack_kb", fibers.small_stack_size)) fibers.small_stack_size *= 1024;
+		if (!jobs::init(os::getCPUsCount(), m_allocator, CommandLineParser::isOn("-cpu_topology"), fibers)) {
 			logError("Failed to initialize job system.");
 		}
 	}
@@ -107,7 +452,7 @@ struct Runner final
 		m_world->setRotation(env, rot);
 	}
 
-	bool loadWorld(const char* path) {
+	bool loadWorld(World& world, const char* path) {
 		FileSystem& fs = m_engine->getFileSystem();
 		OutputMemoryStream data(m_allocator);
 		if (!fs.getContentSync(Path(path), data)) return false;
@@ -116,7 +461,7 @@ struct Runner final
 		EntityMap entity_map(m_allocator);
 
 		WorldVersion editor_version;
-		if (!m_world->deserialize(blob, entity_map, editor_version)) {
+		if (!world.deserialize(blob, entity_map, editor_version)) {
 			logError("Failed to deserialize ", path);
 			return false;
 		}
@@ -149,6 +494,38 @@ struct Runner final
 		}
 	}
 
+	void waitForFileSystem() {
+		while (m_engine->getFileSystem().hasWork()) {
+			os::sleep(10);
+			m_engine->getFileSystem().processCallbacks();
+		}
+		m_engine->getFileSystem().processCallbacks();
+	}
+
+	void initServer() {
+		m_engine->init();
+		loadProject();
+		if (m_server.world_paths.empty()) m_server.world_paths.push(m_startup_world);
+
+		for (const Path& path : m_server.world_paths) {
+			World& world = m_engine->createWorld();
+			if (!loadWorld(world, path.c_str())) {
+				logError("Server: failed to load ", path);
+				m_engine->destroyWorld(world);
+				continue;
+			}
+			m_server.add(world, path);
+		}
+		waitForFileSystem();
+
+		for (Server::ServerWorld& w : m_server.worlds) m_engine->startGame(*w.world);
+		if (m_server.worlds.empty()) {
+			logError("Server: no world loaded");
+			m_finished = true;
+		}
+		m_server.start();
+	}
+
 	void onInit() {
 		Engine::InitArgs init_data;
 
@@ -156,10 +533,18 @@ struct Runner final
 			init_data.file_system = FileSystem::createPacked("main.pak", m_allocator);
 		}
 		init_data.log_path = "lumix_app.log";
+		init_data.use_slab_allocator = CommandLineParser::isOn("-slab_allocator");
+		m_server.parseCommandLine();
+		init_data.headless = m_server.enabled;
 
 		m_engine = Engine::create(static_cast<Engine::InitArgs&&>(init_data), m_allocator);
 		m_imgui.m_engine = m_engine.get();
 
+		if (m_server.enabled) {
+			initServer();
+			return;
+		}
+
 		os::InitWindowArgs init_window_args;
 		init_window_args.name = "Lumix App";
 		m_window = os::createWindow(init_window_args);
@@ -180,16 +565,13 @@ struct Runner final
 		gui->setInterface(&m_gui_interface);
 
 		loadProject();
+		m_benchmark.parseCommandLine(m_startup_world);
 
-		if (!loadWorld(m_startup_world.c_str())) {
+		if (!loadWorld(*m_world, m_startup_world.c_str())) {
 			initDemoScene();
 		}
 		os::showCursor(false);
-		while (m_engine->getFileSystem().hasWork()) {
-			os::sleep(10);
-			m_engine->getFileSystem().processCallbacks();
-		}
-		m_engine->getFileSystem().processCallbacks();
+		waitForFileSystem();
 
 		os::showCursor(false);
 		onResize();
@@ -197,9 +579,17 @@ struct Runner final
 
 		os::showWindow(m_window);
 		m_imgui.init();
+		if (m_benchmark.enabled) m_benchmark.start(*m_world);
 	}
 
 	void shutdown() {
+		if (m_server.enabled) {
+			for (Server::ServerWorld& w : m_server.worlds) m_engine->destroyWorld(*w.world);
+			m_server.worlds.clear();
+			m_engine.reset();
+			return;
+		}
+
 		m_engine->destroyWorld(*m_world);
 		auto* gui = static_cast<GUISystem*>(m_engine->getSystemManager().getSystem("gui"));
 		gui->setInterface(nullptr);
@@ -251,6 +641,12 @@ struct Runner final
 
 
 	void onIdle() {
+		if (m_server.enabled) {
+			m_server.tick(*m_engine);
+			m_server.sleep();
+			return;
+		}
+
 		if (m_mouse_captured) {
 			os::Rect r = os::getWindowScreenRect(m_engine->getMainWindow());
 			os::clipCursor(m_engine->getMainWindow(), r);
@@ -260,6 +656,7 @@ struct Runner final
 		m_engine->update(*m_world);
 
 		EntityPtr camera = m_pipeline->getModule()->getActiveCamera();
+		if (m_benchmark.enabled) m_benchmark.moveCamera(*m_world, camera);
 		if (camera.isValid()) {
 			int w = m_viewport.w;
 			int h = m_viewport.h;
@@ -273,6 +670,11 @@ struct Runner final
 		m_pipeline->blitOutputToScreen();
 		m_imgui.endFrame();
 		m_renderer->frame();
+
+		if (m_benchmark.enabled && m_benchmark.endFrame(*m_renderer)) {
+			m_benchmark.writeReport();
+			m_finished = true;
+		}
 	}
 
 	DefaultAllocator m_main_allocator;
@@ -291,6 +693,8 @@ struct Runner final
 	GUIInterface m_gui_interface;
 
 	ImGuiIntegration m_imgui;
+	Benchmark m_benchmark;
+	Server m_server;
 };
 
 
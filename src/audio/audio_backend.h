@@ -0,0 +1,33 @@
+#pragma once
+
+
+#include "core/core.h"
+#include "core/delegate.h"
+
+
+namespace Lumix
+{
+
+
+struct IAllocator;
+template <typename T> struct UniquePtr;
+
+
+// platform audio output, pulls mixed frames from the device on its own high priority thread
+struct AudioBackend
+{
+	// `out` is interleaved, with getChannels() channels
+	using MixFunction = Delegate<void(float* out, u32 frames)>;
+
+	virtual ~AudioBackend() {}
+
+	// returns null if there's no usable output
+	static UniquePtr<AudioBackend> create(IAllocator& allocator);
+
+	virtual u32 getChannels() const = 0;
+	virtual u32 getSampleRate() const = 0;
+	virtual bool start(const MixFunction& mix) = 0;
+};
+
+
+} // namespace Lumix
@@ -0,0 +1,719 @@
+#include "core/allocator.h"
+#include "core/array.h"
+#include "core/command_line_parser.h"
+#include "core/log.h"
+#include "core/math.h"
+#include "core/os.h"
+#include "core/profiler.h"
+#include "core/simd.h"
+#include "core/sort.h"
+#include "core/sync.h"
+
+#include "audio_backend.h"
+#include "audio_device.h"
+#include "clip.h"
+#include "engine/engine.h"
+
+
+namespace Lumix
+{
+
+
+// software mixer shared by all platforms, backends only output mixed frames
+// mixing runs on backend's thread, everything else locks the same mutex
+struct AudioDeviceImpl final : AudioDevice
+{
+	// voices above this limit are virtual - they advance, but are not mixed, so CPU cost is bounded
+	static constexpr u32 MAX_MIXED_VOICES = 64;
+	static constexpr u32 MIX_BLOCK_FRAMES = 128;
+	// voices with higher frequency than MAX_RESAMPLE_STEP * output rate are played slower
+	static constexpr float MAX_RESAMPLE_STEP = 16;
+	static constexpr u32 MAX_SOURCE_FRAMES = MIX_BLOCK_FRAMES * 2 + 2;
+	// one ADPCM block is decoded at once
+	static constexpr u32 STAGING_FRAMES = ADPCM::BLOCK_FRAMES;
+	// same as DirectSound's default 3d min distance, volume halves with each doubling of distance above this
+	static constexpr float MIN_3D_DISTANCE = 2.f;
+
+	// allocated only for voices in echo or chorus zones
+	struct Effects
+	{
+		Effects(IAllocator& allocator)
+			: echo_lines{Array<float>(allocator), Array<float>(allocator)}
+			, chorus_line(allocator)
+		{}
+
+		float echo_wet = 0;
+		float echo_feedback = 0;
+		Array<float> echo_lines[2];
+		u32 echo_pos[2] = {};
+
+		float chorus_wet = 0;
+		float chorus_feedback = 0;
+		// in frames
+		float chorus_delay = 0;
+		float chorus_depth = 0;
+		// radians per frame
+		float chorus_lfo_step = 0;
+		float chorus_lfo = 0;
+		float chorus_phase = 0;
+		// interleaved stereo
+		Array<float> chorus_line;
+		u32 chorus_pos = 0;
+	};
+
+	struct Voice
+	{
+		Voice(IAllocator& allocator) : samples(allocator), adpcm(allocator) {}
+
+		bool used = false;
+		bool playing = false;
+		bool looped = false;
+		bool ended = false;
+		bool is_3d = false;
+		// copy of 16-bit PCM, so the clip can be reloaded while playing; empty if the voice plays `stream`
+		Array<i16> samples;
+		// copy of ADPCM blocks, see ADPCM
+		Array<u8> adpcm;
+		ClipStream* stream = nullptr;
+		u32 num_frames;
+		u32 channels;
+		// source's rate, `frequency` can differ if the sound is pitched
+		u32 sample_rate;
+		u32 frequency;
+		float volume = 1;
+		DVec3 pos;
+		Effects* effects = nullptr;
+
+		// linear resampling, output is between `prev` and `next` source frames
+		float prev[2];
+		float next[2];
+		float frac;
+		// next source frame to fetch from `data`
+		u32 read_frame;
+		// source frame being played
+		u32 position;
+		i16 staging[STAGING_FRAMES * 2];
+		u32 staging_pos;
+		u32 staging_count;
+		// ADPCM block in `staging`, -1 if none
+		u32 staging_block;
+
+		// computed each mix
+		float gains[2];
+		float audibility;
+	};
+
+	// `backend` can be null, e.g. in benchmark, then mix() must be called manually
+	AudioDeviceImpl(UniquePtr<AudioBackend>&& backend, u32 channels, u32 sample_rate, IAllocator& allocator)
+		: m_allocator(allocator)
+		, m_backend(backend.move())
+		, m_channels(channels)
+		, m_sample_rate(sample_rate)
+		, m_voices(allocator)
+		, m_mixed_voices(allocator)
+	{
+		m_voices.reserve(MAX_PLAYING_SOUNDS);
+		for (u32 i = 0; i < MAX_PLAYING_SOUNDS; ++i) m_voices.emplace(allocator);
+		m_mixed_voices.reserve(MAX_PLAYING_SOUNDS);
+	}
+
+	~AudioDeviceImpl() {
+		// stops mixing thread
+		m_backend.reset();
+		for (Voice& voice : m_voices) {
+			if (voice.effects) LUMIX_DELETE(m_allocator, voice.effects);
+		}
+	}
+
+	bool start() {
+		AudioBackend::MixFunction f;
+		f.bind<&AudioDeviceImpl::mix>(this);
+		return m_backend->start(f);
+	}
+
+	Voice* allocVoice(BufferHandle* handle) {
+		for (Voice& voice : m_voices) {
+			if (voice.used) continue;
+			*handle = BufferHandle(&voice - m_voices.begin());
+			return &voice;
+		}
+		return nullptr;
+	}
+
+	void initVoice(Voice& voice, u32 channels, u32 sample_rate, int flags) {
+		voice.used = true;
+		voice.playing = false;
+		voice.looped = false;
+		voice.is_3d = (flags & (int)BufferFlags::IS3D) != 0;
+		voice.channels = channels;
+		voice.sample_rate = sample_rate;
+		voice.frequency = sample_rate;
+		voice.volume = 1;
+		voice.pos = DVec3(0);
+		seekVoice(voice, 0);
+	}
+
+	BufferHandle createBuffer(const void* data, int size_bytes, int channels, int sample_rate, int flags) override {
+		if (channels < 1 || channels > 2) {
+			logError("Only mono and stereo sounds are supported");
+			return INVALID_BUFFER_HANDLE;
+		}
+
+		MutexGuard lock(m_mutex);
+		BufferHandle handle;
+		Voice* voice = allocVoice(&handle);
+		if (!voice) return INVALID_BUFFER_HANDLE;
+
+		voice->stream = nullptr;
+		voice->adpcm.clear();
+		voice->num_frames = u32(size_bytes / (sizeof(i16) * channels));
+		voice->samples.resize(voice->num_frames * channels);
+		memcpy(voice->samples.begin(), data, voice->samples.byte_size());
+		initVoice(*voice, channels, sample_rate, flags);
+		return handle;
+	}
+
+	BufferHandle createADPCMBuffer(const void* data, int size_bytes, u32 frames, int channels, int sample_rate, int flags) override {
+		if (channels < 1 || channels > 2) {
+			logError("Only mono and stereo sounds are supported");
+			return INVALID_BUFFER_HANDLE;
+		}
+		const u32 blocks = (frames + ADPCM::BLOCK_FRAMES - 1) / ADPCM::BLOCK_FRAMES;
+		if ((u32)size_bytes < blocks * ADPCM::getBlockSize(channels)) {
+			logError("Not enough ADPCM data");
+			return INVALID_BUFFER_HANDLE;
+		}
+
+		MutexGuard lock(m_mutex);
+		BufferHandle handle;
+		Voice* voice = allocVoice(&handle);
+		if (!voice) return INVALID_BUFFER_HANDLE;
+
+		voice->stream = nullptr;
+		voice->samples.clear();
+		voice->num_frames = frames;
+		voice->adpcm.resize(size_bytes);
+		memcpy(voice->adpcm.begin(), data, size_bytes);
+		initVoice(*voice, channels, sample_rate, flags);
+		return handle;
+	}
+
+	BufferHandle createBuffer(ClipStream& stream, int flags) override {
+		Clip& clip = stream.getClip();
+		if (clip.getChannels() < 1 || clip.getChannels() > 2) {
+			logError(clip.getPath(), ": only mono and stereo sounds are supported");
+			return INVALID_BUFFER_HANDLE;
+		}
+
+		MutexGuard lock(m_mutex);
+		BufferHandle handle;
+		Voice* voice = allocVoice(&handle);
+		if (!voice) return INVALID_BUFFER_HANDLE;
+
+		voice->samples.clear();
+		voice->adpcm.clear();
+		voice->stream = &stream;
+		voice->num_frames = u32(clip.getSize() / (sizeof(i16) * clip.getChannels()));
+		initVoice(*voice, clip.getChannels(), clip.getSampleRate(), flags);
+		return handle;
+	}
+
+	Effects& getEffects(Voice& voice) {
+		if (!voice.effects) voice.effects = LUMIX_NEW(m_allocator, Effects)(m_allocator);
+		return *voice.effects;
+	}
+
+	void setEcho(BufferHandle handle, float wet_dry_mix, float feedback, float left_delay, float right_delay) override {
+		MutexGuard lock(m_mutex);
+		Effects& effects = getEffects(m_voices[handle]);
+		effects.echo_wet = clamp(wet_dry_mix, 0.f, 1.f);
+		effects.echo_feedback = clamp(feedback, 0.f, 0.99f);
+		// delays are in milliseconds, as in DirectSound's echo
+		const float delays[] = { left_delay, right_delay };
+		for (u32 i = 0; i < 2; ++i) {
+			const u32 size = maximum(u32(clamp(delays[i], 1.f, 2000.f) * m_sample_rate / 1000), 1u);
+			effects.echo_lines[i].resize(size);
+			memset(effects.echo_lines[i].begin(), 0, effects.echo_lines[i].byte_size());
+			effects.echo_pos[i] = 0;
+		}
+	}
+
+	void setChorus(BufferHandle handle, float wet_dry_mix, float depth, float feedback, float frequency, float delay, i32 phase) override {
+		MutexGuard lock(m_mutex);
+		Effects& effects = getEffects(m_voices[handle]);
+		// parameters are mapped to the same ranges as in DirectSound's chorus
+		effects.chorus_wet = clamp(wet_dry_mix, 0.f, 1.f);
+		effects.chorus_feedback = clamp(feedback, -0.99f, 0.99f);
+		effects.chorus_delay = clamp(delay, 0.f, 1.f) * 20 * m_sample_rate / 1000;
+		effects.chorus_depth = clamp(depth, 0.f, 1.f) * effects.chorus_delay;
+		effects.chorus_lfo_step = clamp(frequency, 0.f, 1.f) * 10 * 2 * PI / m_sample_rate;
+		effects.chorus_phase = (clamp(phase, 0, 4) - 2) * PI * 0.5f;
+		effects.chorus_line.resize((u32(effects.chorus_delay + effects.chorus_depth) + 2) * 2);
+		memset(effects.chorus_line.begin(), 0, effects.chorus_line.byte_size());
+		effects.chorus_pos = 0;
+	}
+
+	void play(BufferHandle handle, bool looped) override {
+		MutexGuard lock(m_mutex);
+		Voice& voice = m_voices[handle];
+		voice.playing = true;
+		voice.looped = looped;
+		if (voice.stream) voice.stream->setLooped(looped);
+	}
+
+	bool isPlaying(BufferHandle handle) override {
+		MutexGuard lock(m_mutex);
+		return m_voices[handle].playing && !m_voices[handle].ended;
+	}
+
+	bool isEnd(BufferHandle handle) override {
+		MutexGuard lock(m_mutex);
+		return m_voices[handle].ended;
+	}
+
+	void stop(BufferHandle handle) override {
+		MutexGuard lock(m_mutex);
+		Voice& voice = m_voices[handle];
+		voice.used = false;
+		voice.playing = false;
+		// caller destroys the stream after this
+		voice.stream = nullptr;
+		if (voice.effects) {
+			LUMIX_DELETE(m_allocator, voice.effects);
+			voice.effects = nullptr;
+		}
+	}
+
+	void pause(BufferHandle handle) override {
+		MutexGuard lock(m_mutex);
+		m_voices[handle].playing = false;
+	}
+
+	void setMasterVolume(float volume) override {
+		MutexGuard lock(m_mutex);
+		m_master_volume = volume;
+	}
+
+	void setVolume(BufferHandle handle, float volume) override {
+		MutexGuard lock(m_mutex);
+		m_voices[handle].volume = volume;
+	}
+
+	void setFrequency(BufferHandle handle, u32 frequency_hz) override {
+		MutexGuard lock(m_mutex);
+		m_voices[handle].frequency = frequency_hz;
+	}
+
+	void setCurrentTime(BufferHandle handle, float time_seconds) override {
+		MutexGuard lock(m_mutex);
+		Voice& voice = m_voices[handle];
+		const u32 frame = u32(maximum(time_seconds, 0.f) * voice.sample_rate);
+		seekVoice(voice, frame < voice.num_frames ? frame : 0);
+	}
+
+	float getCurrentTime(BufferHandle handle) override {
+		MutexGuard lock(m_mutex);
+		const Voice& voice = m_voices[handle];
+		return voice.position / (float)voice.sample_rate;
+	}
+
+	void setListenerPosition(const DVec3& pos) override {
+		MutexGuard lock(m_mutex);
+		m_listener_pos = pos;
+	}
+
+	void setListenerOrientation(float front_x, float front_y, float front_z, float up_x, float up_y, float up_z) override {
+		MutexGuard lock(m_mutex);
+		m_listener_right = normalize(cross(Vec3(up_x, up_y, up_z), Vec3(front_x, front_y, front_z)));
+	}
+
+	void setSourcePosition(BufferHandle handle, const DVec3& pos) override {
+		MutexGuard lock(m_mutex);
+		m_voices[handle].pos = pos;
+	}
+
+	void update(float time_delta) override {}
+
+	void seekVoice(Voice& voice, u32 frame) {
+		if (voice.stream) voice.stream->seek(frame);
+		voice.read_frame = frame;
+		voice.position = frame;
+		voice.staging_pos = 0;
+		voice.staging_count = 0;
+		voice.staging_block = 0xffFFffFF;
+		voice.ended = false;
+		voice.frac = 0;
+		fetchFrame(voice, voice.prev);
+		fetchFrame(voice, voice.next);
+	}
+
+	void fetchFrame(Voice& voice, float* frame) {
+		frame[0] = frame[1] = 0;
+		const i16* src;
+		if (voice.stream) {
+			if (voice.staging_pos == voice.staging_count) {
+				if (voice.stream->isEnd()) {
+					voice.ended = true;
+					return;
+				}
+				// stream handles looping
+				voice.stream->read(voice.staging, sizeof(voice.staging[0]) * STAGING_FRAMES * voice.channels);
+				voice.staging_pos = 0;
+				voice.staging_count = STAGING_FRAMES;
+			}
+			src = voice.staging + voice.staging_pos * voice.channels;
+			++voice.staging_pos;
+			++voice.position;
+			if (voice.position >= voice.num_frames) voice.position = 0;
+		}
+		else {
+			if (voice.read_frame >= voice.num_frames) {
+				if (!voice.looped || voice.num_frames == 0) {
+					voice.ended = true;
+					return;
+				}
+				voice.read_frame = 0;
+			}
+			if (voice.adpcm.empty()) {
+				src = voice.samples.begin() + voice.read_frame * voice.channels;
+			}
+			else {
+				const u32 block = voice.read_frame / ADPCM::BLOCK_FRAMES;
+				if (block != voice.staging_block) {
+					ADPCM::decodeBlock(voice.adpcm.begin() + block * ADPCM::getBlockSize(voice.channels), voice.channels, voice.staging);
+					voice.staging_block = block;
+				}
+				src = voice.staging + (voice.read_frame % ADPCM::BLOCK_FRAMES) * voice.channels;
+			}
+			voice.position = voice.read_frame;
+			++voice.read_frame;
+		}
+		for (u32 c = 0; c < voice.channels; ++c) frame[c] = src[c] * (1 / 32768.f);
+	}
+
+	// writes interleaved stereo, source frames are first converted to float and then linearly resampled
+	void renderVoice(Voice& voice, float* out, u32 frames) {
+		const float step = minimum(voice.frequency / (float)m_sample_rate, MAX_RESAMPLE_STEP);
+		float* src = m_source_buffer;
+		while (frames > 0) {
+			// `src` holds `prev`, `next` and all source frames needed for `n` output frames
+			const u32 n = minimum(frames, u32((MAX_SOURCE_FRAMES - 2 - voice.frac) / step));
+			const float end = voice.frac + n * step;
+			const u32 consumed = u32(end);
+
+			memcpy(src, voice.prev, sizeof(voice.prev));
+			memcpy(src + 2, voice.next, sizeof(voice.next));
+			for (u32 i = 2; i < consumed + 2; ++i) {
+				fetchFrame(voice, src + i * 2);
+			}
+			if (voice.channels == 1) {
+				for (u32 i = 0; i < consumed + 2; ++i) src[i * 2 + 1] = src[i * 2];
+			}
+
+			if (step == 1 && voice.frac == 0) {
+				memcpy(out, src, sizeof(float) * 2 * n);
+			}
+			else {
+				float pos = voice.frac;
+				for (u32 i = 0; i < n; ++i) {
+					const u32 idx = u32(pos);
+					const float t = pos - idx;
+					const float* a = src + idx * 2;
+					out[i * 2] = a[0] + (a[2] - a[0]) * t;
+					out[i * 2 + 1] = a[1] + (a[3] - a[1]) * t;
+					pos += step;
+				}
+			}
+
+			memcpy(voice.prev, src + consumed * 2, sizeof(voice.prev));
+			memcpy(voice.next, src + consumed * 2 + 2, sizeof(voice.next));
+			voice.frac = end - consumed;
+			out += n * 2;
+			frames -= n;
+		}
+	}
+
+	// virtual voice, only its position advances
+	void skipVoice(Voice& voice, u32 frames) {
+		const float advance = voice.frac + frames * minimum(voice.frequency / (float)m_sample_rate, MAX_RESAMPLE_STEP);
+		const u32 skipped = u32(advance);
+		voice.frac = advance - skipped;
+		if (voice.stream) {
+			// stream must be read even if it's not heard, so it stays in sync
+			for (u32 i = 0; i < skipped; ++i) {
+				voice.prev[0] = voice.next[0];
+				voice.prev[1] = voice.next[1];
+				fetchFrame(voice, voice.next);
+			}
+			return;
+		}
+
+		if (skipped == 0) return;
+		// `prev` was fetched two frames before `read_frame`
+		i64 frame = i64(voice.read_frame) + skipped - 2;
+		if (frame < 0) frame += voice.num_frames;
+		if (frame >= voice.num_frames) {
+			if (!voice.looped || voice.num_frames == 0) {
+				voice.ended = true;
+				return;
+			}
+			frame %= voice.num_frames;
+		}
+		voice.read_frame = u32(frame);
+		fetchFrame(voice, voice.prev);
+		fetchFrame(voice, voice.next);
+	}
+
+	void applyEffects(Effects& effects, float* buf, u32 frames) {
+		if (effects.echo_wet > 0 && !effects.echo_lines[0].empty()) {
+			for (u32 c = 0; c < 2; ++c) {
+				float* line = effects.echo_lines[c].begin();
+				const u32 size = effects.echo_lines[c].size();
+				u32 pos = effects.echo_pos[c];
+				for (u32 i = 0; i < frames; ++i) {
+					float& s = buf[i * 2 + c];
+					const float delayed = line[pos];
+					line[pos] = s + delayed * effects.echo_feedback;
+					s = s * (1 - effects.echo_wet) + delayed * effects.echo_wet;
+					pos = pos + 1 == size ? 0 : pos + 1;
+				}
+				effects.echo_pos[c] = pos;
+			}
+		}
+
+		if (effects.chorus_wet > 0 && !effects.chorus_line.empty()) {
+			float* line = effects.chorus_line.begin();
+			const u32 size = effects.chorus_line.size() / 2;
+			for (u32 i = 0; i < frames; ++i) {
+				for (u32 c = 0; c < 2; ++c) {
+					const float lfo = sinf(effects.chorus_lfo + c * effects.chorus_phase);
+					const float delay = effects.chorus_delay + effects.chorus_depth * 0.5f * (1 + lfo);
+					const float read = effects.chorus_pos + size - delay;
+					const u32 r0 = u32(read) % size;
+					const u32 r1 = (r0 + 1) % size;
+					const float t = read - floorf(read);
+					const float delayed = line[r0 * 2 + c] + (line[r1 * 2 + c] - line[r0 * 2 + c]) * t;
+					float& s = buf[i * 2 + c];
+					line[effects.chorus_pos * 2 + c] = s + delayed * effects.chorus_feedback;
+					s = s * (1 - effects.chorus_wet) + delayed * effects.chorus_wet;
+				}
+				effects.chorus_pos = (effects.chorus_pos + 1) % size;
+				effects.chorus_lfo += effects.chorus_lfo_step;
+				if (effects.chorus_lfo > 2 * PI) effects.chorus_lfo -= 2 * PI;
+			}
+		}
+	}
+
+	void computeGains(Voice& voice) {
+		voice.gains[0] = voice.gains[1] = voice.volume;
+		if (voice.is_3d) {
+			const Vec3 dir = Vec3(voice.pos - m_listener_pos);
+			const float dist = length(dir);
+			const float attenuation = MIN_3D_DISTANCE / maximum(dist, MIN_3D_DISTANCE);
+			// equal power panning, stereo sources are only attenuated
+			const float pan = dist > 0.001f && voice.channels == 1 ? dot(dir, m_listener_right) / dist : 0;
+			const float angle = (pan + 1) * PI * 0.25f;
+			voice.gains[0] *= attenuation * cosf(angle) * SQRT2;
+			voice.gains[1] *= attenuation * sinf(angle) * SQRT2;
+		}
+		voice.audibility = maximum(voice.gains[0], voice.gains[1]);
+	}
+
+	// mixes MIX_BLOCK_FRAMES of interleaved stereo into m_mix_buffer
+	void mixBlock() {
+		constexpr u32 FLOATS = MIX_BLOCK_FRAMES * 2;
+		memset(m_mix_buffer, 0, sizeof(m_mix_buffer));
+
+		m_mixed_voices.clear();
+		for (Voice& voice : m_voices) {
+			if (!voice.used || !voice.playing || voice.ended) continue;
+			computeGains(voice);
+			m_mixed_voices.push(&voice);
+		}
+		if ((u32)m_mixed_voices.size() > MAX_MIXED_VOICES) {
+			// the least audible voices become virtual
+			sort(m_mixed_voices.begin(), m_mixed_voices.end(), [](const Voice* a, const Voice* b){
+				return a->audibility > b->audibility;
+			});
+		}
+
+		for (u32 i = 0, c = m_mixed_voices.size(); i < c; ++i) {
+			Voice& voice = *m_mixed_voices[i];
+			if (i >= MAX_MIXED_VOICES) {
+				skipVoice(voice, MIX_BLOCK_FRAMES);
+				continue;
+			}
+
+			renderVoice(voice, m_voice_buffer, MIX_BLOCK_FRAMES);
+			if (voice.effects) applyEffects(*voice.effects, m_voice_buffer, MIX_BLOCK_FRAMES);
+
+			alignas(32) const float gains[] = {
+				voice.gains[0], voice.gains[1], voice.gains[0], voice.gains[1],
+				voice.gains[0], voice.gains[1], voice.gains[0], voice.gains[1]
+			};
+			const float8 gains8 = f8Load(gains);
+			for (u32 j = 0; j < FLOATS; j += 8) {
+				const float8 v = f8Mul(f8Load(m_voice_buffer + j), gains8);
+				f8Store(m_mix_buffer + j, f8Add(f8Load(m_mix_buffer + j), v));
+			}
+		}
+
+		const float8 master = f8Splat(m_master_volume);
+		const float8 min = f8Splat(-1);
+		const float8 max = f8Splat(1);
+		for (u32 j = 0; j < FLOATS; j += 8) {
+			f8Store(m_mix_buffer + j, f8Min(f8Max(f8Mul(f8Load(m_mix_buffer + j), master), min), max));
+		}
+	}
+
+	// called from backend's thread
+	void mix(float* out, u32 frames) {
+		PROFILE_FUNCTION();
+		MutexGuard lock(m_mutex);
+		while (frames > 0) {
+			// mixing is done in fixed blocks, so kernels do not need to handle tails
+			// frames not requested by backend are kept for the next call
+			if (m_mix_buffer_offset == MIX_BLOCK_FRAMES) {
+				mixBlock();
+				m_mix_buffer_offset = 0;
+			}
+			const u32 n = minimum(frames, MIX_BLOCK_FRAMES - m_mix_buffer_offset);
+			const float* src = m_mix_buffer + m_mix_buffer_offset * 2;
+			if (m_channels == 2) {
+				memcpy(out, src, sizeof(float) * 2 * n);
+			}
+			else {
+				for (u32 i = 0; i < n; ++i) {
+					float* dst = out + i * m_channels;
+					if (m_channels == 1) {
+						dst[0] = (src[i * 2] + src[i * 2 + 1]) * 0.5f;
+						continue;
+					}
+					dst[0] = src[i * 2];
+					dst[1] = src[i * 2 + 1];
+					for (u32 c = 2; c < m_channels; ++c) dst[c] = 0;
+				}
+			}
+			m_mix_buffer_offset += n;
+			out += n * m_channels;
+			frames -= n;
+		}
+	}
+
+	IAllocator& m_allocator;
+	UniquePtr<AudioBackend> m_backend;
+	Mutex m_mutex;
+	u32 m_channels;
+	u32 m_sample_rate;
+	float m_master_volume = 1;
+	DVec3 m_listener_pos = DVec3(0);
+	Vec3 m_listener_right = Vec3(1, 0, 0);
+	Array<Voice> m_voices;
+	Array<Voice*> m_mixed_voices;
+	u32 m_mix_buffer_offset = MIX_BLOCK_FRAMES;
+	alignas(32) float m_mix_buffer[MIX_BLOCK_FRAMES * 2];
+	alignas(32) float m_voice_buffer[MIX_BLOCK_FRAMES * 2];
+	float m_source_buffer[MAX_SOURCE_FRAMES * 2];
+};
+
+
+struct NullAudioDevice final : AudioDevice
+{
+	BufferHandle createBuffer(const void* data,
+		int size_bytes,
+		int channels,
+		int sample_rate,
+		int flags) override
+	{
+		return INVALID_BUFFER_HANDLE;
+	}
+	BufferHandle createADPCMBuffer(const void* data, int size_bytes, u32 frames, int channels, int sample_rate, int flags) override {
+		return INVALID_BUFFER_HANDLE;
+	}
+	BufferHandle createBuffer(ClipStream& stream, int flags) override { return INVALID_BUFFER_HANDLE; }
+	void setEcho(BufferHandle handle,
+		float wet_dry_mix,
+		float feedback,
+		float left_delay,
+		float right_delay) override {}
+
+	void setChorus(BufferHandle handle,
+		float wet_dry_mix,
+		float depth,
+		float feedback,
+		float frequency,
+		float delay,
+		i32 phase) override {}
+
+	void play(BufferHandle buffer, bool looped) override {}
+	bool isPlaying(BufferHandle buffer) override { return false; }
+	void stop(BufferHandle buffer) override {}
+	bool isEnd(BufferHandle buffer) override { return true; }
+	void pause(BufferHandle buffer) override {}
+	void setMasterVolume(float volume) override {}
+	void setVolume(BufferHandle buffer, float volume) override {}
+	void setFrequency(BufferHandle buffer, u32 frequency_hz) override {}
+	void setCurrentTime(BufferHandle buffer, float time_seconds) override {}
+	float getCurrentTime(BufferHandle buffer) override { return -1; }
+	void setListenerPosition(const DVec3& pos) override {}
+	void setListenerOrientation(float front_x,
+		float front_y,
+		float front_z,
+		float up_x,
+		float up_y,
+		float up_z) override {}
+	void setSourcePosition(BufferHandle buffer, const DVec3& pos) override {}
+	void update(float time_delta) override {}
+};
+
+
+float AudioDevice::benchmarkMixer(const void* data, int size_bytes, int channels, int sample_rate, u32 voices_count, u32 iterations, IAllocator& allocator)
+{
+	PROFILE_FUNCTION();
+	// not connected to any output, so it does not disturb the running device
+	AudioDeviceImpl device({}, 2, 48000, allocator);
+	voices_count = minimum(voices_count, AudioDeviceImpl::MAX_MIXED_VOICES);
+	for (u32 i = 0; i < voices_count; ++i) {
+		const BufferHandle handle = device.createBuffer(data, size_bytes, channels, sample_rate, channels == 1 ? (int)BufferFlags::IS3D : 0);
+		if (handle == INVALID_BUFFER_HANDLE) return 0;
+		device.setSourcePosition(handle, DVec3(i % 8 - 4.0, 0, i / 8 * 2.0));
+		device.play(handle, true);
+	}
+
+	constexpr u32 FRAMES = AudioDeviceImpl::MIX_BLOCK_FRAMES;
+	float out[FRAMES * 2];
+	const u64 start = os::Timer::getRawTimestamp();
+	for (u32 i = 0; i < iterations; ++i) {
+		device.mix(out, FRAMES);
+	}
+	const float ms = maximum(os::Timer::rawToSeconds(os::Timer::getRawTimestamp() - start) * 1000.f, 1e-3f);
+	const float mixed_seconds = float(FRAMES) * iterations / 48000.f;
+	return voices_count * mixed_seconds / ms;
+}
+
+
+UniquePtr<AudioDevice> AudioDevice::create(Engine& engine, IAllocator& allocator)
+{
+	if (CommandLineParser::isOn("-nullaudio")) {
+		logInfo("Using null audio device because it was requested on command line");
+		return UniquePtr<NullAudioDevice>::create(engine.getAllocator());
+	}
+
+	UniquePtr<AudioBackend> backend = AudioBackend::create(allocator);
+	if (!backend) {
+		logWarning("Using null audio device");
+		return UniquePtr<NullAudioDevice>::create(engine.getAllocator());
+	}
+
+	const u32 channels = backend->getChannels();
+	const u32 sample_rate = backend->getSampleRate();
+	UniquePtr<AudioDeviceImpl> device = UniquePtr<AudioDeviceImpl>::create(allocator, backend.move(), channels, sample_rate, allocator);
+	if (!device->start()) {
+		logWarning("Using null audio device");
+		return UniquePtr<NullAudioDevice>::create(engine.getAllocator());
+	}
+	return device.move();
+}
+
+
+} // namespace Lumix
@@ -18,6 +18,7 @@ namespace Lumix
 
 
 struct Clip;
+struct ClipStream;
 struct DVec3;
 struct Engine;
 struct IAllocator;
@@ -39,8 +40,15 @@ struct LUMIX_AUDIO_API AudioDevice
 	virtual ~AudioDevice() {}
 
 	static UniquePtr<AudioDevice> create(Engine& engine, IAllocator& allocator);
+	// mixes looped copies of the sound into a device without output, single threaded
+	// returns how many such voices can be mixed in realtime for each millisecond of CPU time per second of output
+	static float benchmarkMixer(const void* data, int size_bytes, int channels, int sample_rate, u32 voices_count, u32 iterations, IAllocator& allocator);
 
 	virtual BufferHandle createBuffer(const void* data, int size_bytes, int channels, int sample_rate, int flags) = 0;
+	// `data` are ADPCM blocks, see ADPCM in clip.h
+	virtual BufferHandle createADPCMBuffer(const void* data, int size_bytes, u32 frames, int channels, int sample_rate, int flags) = 0;
+	// data are read from `stream` while the buffer plays, caller destroys `stream` after the buffer is stopped
+	virtual BufferHandle createBuffer(ClipStream& stream, int flags) = 0;
 	virtual void setEcho(BufferHandle handle,
 		float wet_dry_mix,
 		float feedback,
@@ -3,6 +3,7 @@
 #include "core/hash.h"
 #include "core/log.h"
 #include "core/math.h"
+#include "core/sort.h"
 #include "core/stream.h"
 
 #include "audio_module.h"
@@ -40,17 +41,38 @@ struct AmbientSound
 };
 
 
+// sound is real if it has a device buffer, otherwise it's virtual and only its playback time is tracked
 struct PlayingSound
 {
 	AudioDevice::BufferHandle buffer_id;
 	EntityPtr entity;
+	// null if the slot is free
 	Clip* clip = nullptr;
+	// only for streamed clips
+	ClipStream* stream = nullptr;
 	bool is_3d;
+	bool paused = false;
+	float volume;
+	// 0 - clip's sample rate
+	u32 frequency = 0;
+	// playback position of virtual sound
+	float time = 0;
+	float audibility = 0;
+	bool has_echo = false;
+	float echo_wet_dry_mix;
+	float echo_feedback;
+	float echo_left_delay;
+	float echo_right_delay;
 };
 
 
 struct AudioModuleImpl final : AudioModule
 {
+	// sounds above this limit or quieter than threshold are virtual
+	static constexpr u32 MAX_REAL_SOUNDS = 64;
+	static constexpr float AUDIBILITY_THRESHOLD = 0.01f;
+	static constexpr float MIN_3D_DISTANCE = 2.f;
+
 	enum class Version : i32 {
 		INIT,
 		CLIPS_REWORKED,
@@ -78,11 +100,148 @@ struct AudioModuleImpl final : AudioModule
 	const char* getName() const override { return "audio"; }
 
 	~AudioModuleImpl() {
+		for (PlayingSound& sound : m_playing_sounds) {
+			if (sound.clip) release(sound);
+		}
 		for (const AmbientSound& snd : m_ambient_sounds) {
 			if (snd.clip) snd.clip->decRefCount();
 		}
 	}
 
+	void stopBuffer(PlayingSound& sound) {
+		m_device.stop(sound.buffer_id);
+		sound.buffer_id = AudioDevice::INVALID_BUFFER_HANDLE;
+		if (sound.stream) {
+			LUMIX_DELETE(m_allocator, sound.stream);
+			sound.stream = nullptr;
+		}
+	}
+
+	void release(PlayingSound& sound) {
+		if (sound.buffer_id != AudioDevice::INVALID_BUFFER_HANDLE) stopBuffer(sound);
+		sound.clip->decRefCount();
+		sound.clip = nullptr;
+	}
+
+	DVec3 getListenerPosition() const {
+		return m_listener.entity.isValid() ? m_world.getPosition((EntityRef)m_listener.entity) : DVec3(0);
+	}
+
+	// same attenuation as in the device's mixer
+	float computeAudibility(const PlayingSound& sound, const DVec3& listener_pos) const {
+		if (!sound.is_3d || !sound.entity.isValid()) return sound.volume;
+		const float dist = (float)length(m_world.getPosition((EntityRef)sound.entity) - listener_pos);
+		return sound.volume * MIN_3D_DISTANCE / maximum(dist, MIN_3D_DISTANCE);
+	}
+
+	void applyZones(AudioDevice::BufferHandle buffer, const DVec3& pos) {
+		for (const EchoZone& zone : m_echo_zones) {
+			const double dist2 = squaredLength(pos - m_world.getPosition(zone.entity));
+			const double r2 = zone.radius * zone.radius;
+			if (dist2 > r2) continue;
+
+			const float w = float(dist2 / r2);
+			m_device.setEcho(buffer, 1, 1 - w, zone.delay, zone.delay);
+			break;
+		}
+
+		for (const ChorusZone& zone : m_chorus_zones) {
+			const double dist2 = squaredLength(pos - m_world.getPosition(zone.entity));
+			double r2 = zone.radius * zone.radius;
+			if (dist2 > r2) continue;
+
+			m_device.setChorus(buffer, 1, 1, 0, 1, zone.delay, 0);
+			break;
+		}
+	}
+
+	// gets a device buffer for a virtual sound, it continues from the tracked time
+	bool makeReal(PlayingSound& sound) {
+		Clip* clip = sound.clip;
+		int flags = sound.is_3d ? (int)AudioDevice::BufferFlags::IS3D : 0;
+		if (sound.is_3d && clip->getChannels() > 1) flags = 0;
+
+		AudioDevice::BufferHandle buffer;
+		if (clip->isStreamed()) {
+			sound.stream = LUMIX_NEW(m_allocator, ClipStream)(*clip);
+			buffer = m_device.createBuffer(*sound.stream, flags);
+		}
+		else if (clip->getStorage() == Clip::Storage::ADPCM) {
+			const Span<const u8> data = clip->getEncodedData();
+			buffer = m_device.createADPCMBuffer(data.begin(), data.length(), clip->getFramesCount(), clip->getChannels(), clip->getSampleRate(), flags);
+		}
+		else {
+			buffer = m_device.createBuffer(clip->getData(), clip->getSize(), clip->getChannels(), clip->getSampleRate(), flags);
+		}
+		if (buffer == AudioDevice::INVALID_BUFFER_HANDLE) {
+			LUMIX_DELETE(m_allocator, sound.stream);
+			sound.stream = nullptr;
+			return false;
+		}
+
+		const DVec3 pos = sound.entity.isValid() ? m_world.getPosition((EntityRef)sound.entity) : DVec3(0);
+		m_device.setVolume(buffer, sound.volume);
+		if (sound.frequency != 0) m_device.setFrequency(buffer, sound.frequency);
+		if (sound.time > 0) m_device.setCurrentTime(buffer, sound.time);
+		m_device.setSourcePosition(buffer, pos);
+		applyZones(buffer, pos);
+		if (sound.has_echo) {
+			m_device.setEcho(buffer, sound.echo_wet_dry_mix, sound.echo_feedback, sound.echo_left_delay, sound.echo_right_delay);
+		}
+		if (!sound.paused) m_device.play(buffer, clip->m_looped);
+		sound.buffer_id = buffer;
+		return true;
+	}
+
+	void makeVirtual(PlayingSound& sound) {
+		sound.time = m_device.getCurrentTime(sound.buffer_id);
+		stopBuffer(sound);
+	}
+
+	// virtual sounds advance their time, the most audible sounds get device buffers
+	void updateVirtualization(float time_delta) {
+		const DVec3 listener_pos = getListenerPosition();
+		u16 sorted[AudioDevice::MAX_PLAYING_SOUNDS];
+		u32 count = 0;
+		for (PlayingSound& sound : m_playing_sounds) {
+			if (!sound.clip) continue;
+			if (sound.buffer_id == AudioDevice::INVALID_BUFFER_HANDLE && !sound.paused) {
+				const Clip* clip = sound.clip;
+				const float rate = sound.frequency ? sound.frequency / (float)clip->getSampleRate() : 1.f;
+				sound.time += time_delta * rate;
+				const float length = clip->getLengthSeconds();
+				if (sound.time >= length) {
+					if (!clip->m_looped || length <= 0) {
+						release(sound);
+						continue;
+					}
+					sound.time = fmodf(sound.time, length);
+				}
+			}
+			sound.audibility = computeAudibility(sound, listener_pos);
+			sorted[count] = u16(&sound - m_playing_sounds);
+			++count;
+		}
+
+		sort(sorted, sorted + count, [&](u16 a, u16 b){
+			return m_playing_sounds[a].audibility > m_playing_sounds[b].audibility;
+		});
+
+		// demote first, so promoted sounds have free device buffers
+		for (u32 i = 0; i < count; ++i) {
+			PlayingSound& sound = m_playing_sounds[sorted[i]];
+			if (sound.buffer_id == AudioDevice::INVALID_BUFFER_HANDLE) continue;
+			// lower threshold for demotion, so sounds at the edge do not flip each frame
+			if (i >= MAX_REAL_SOUNDS || sound.audibility < AUDIBILITY_THRESHOLD * 0.5f) makeVirtual(sound);
+		}
+		for (u32 i = 0; i < count && i < MAX_REAL_SOUNDS; ++i) {
+			PlayingSound& sound = m_playing_sounds[sorted[i]];
+			if (sound.buffer_id != AudioDevice::INVALID_BUFFER_HANDLE) continue;
+			if (sound.audibility < AUDIBILITY_THRESHOLD) break;
+			makeReal(sound);
+		}
+	}
+
 	void updateAnimationEvents()
 	{
 		/*if (!m_animation_module) return;
@@ -130,19 +289,21 @@ struct AudioModuleImpl final : AudioModule
 		for (PlayingSound & sound : m_playing_sounds)
 		{
 			if (sound.buffer_id == AudioDevice::INVALID_BUFFER_HANDLE) continue;
-			if (sound.is_3d && sound.entity.isValid())
-			{
-				const DVec3 pos = m_world.getPosition((EntityRef)sound.entity);
-				m_device.setSourcePosition(sound.buffer_id, pos);
-			}
 
 			Clip* clip_info = sound.clip;
 			if (!clip_info->m_looped && m_device.isEnd(sound.buffer_id))
 			{
-				m_device.stop(sound.buffer_id);
-				sound.buffer_id = AudioDevice::INVALID_BUFFER_HANDLE;
+				release(sound);
+				continue;
+			}
+
+			if (sound.is_3d && sound.entity.isValid())
+			{
+				const DVec3 pos = m_world.getPosition((EntityRef)sound.entity);
+				m_device.setSourcePosition(sound.buffer_id, pos);
 			}
 		}
+		updateVirtualization(time_delta);
 		m_device.update(time_delta);
 
 		updateAnimationEvents();
@@ -163,14 +324,20 @@ struct AudioModuleImpl final : AudioModule
 	void pauseAmbientSound(EntityRef entity) override {
 		const i32 idx = m_ambient_sounds[entity].playing_sound;
 		if (idx < 0) return;
-		m_device.pause(m_playing_sounds[idx].buffer_id);
+		PlayingSound& sound = m_playing_sounds[idx];
+		if (!sound.clip) return;
+		sound.paused = true;
+		if (sound.buffer_id != AudioDevice::INVALID_BUFFER_HANDLE) m_device.pause(sound.buffer_id);
 	}
 
 	void resumeAmbientSound(EntityRef entity) override {
 		const AmbientSound& as = m_ambient_sounds[entity];
 		const i32 idx = as.playing_sound;
 		if (idx < 0) return;
-		m_device.play(m_playing_sounds[idx].buffer_id, as.clip->m_looped);
+		PlayingSound& sound = m_playing_sounds[idx];
+		if (!sound.clip) return;
+		sound.paused = false;
+		if (sound.buffer_id != AudioDevice::INVALID_BUFFER_HANDLE) m_device.play(sound.buffer_id, sound.clip->m_looped);
 	}
 
 	void startGame() override
@@ -188,11 +355,7 @@ struct AudioModuleImpl final : AudioModule
 		m_animation_module = nullptr;
 		for (auto& i : m_playing_sounds)
 		{
-			if (i.buffer_id != AudioDevice::INVALID_BUFFER_HANDLE)
-			{
-				m_device.stop(i.buffer_id);
-				i.buffer_id = AudioDevice::INVALID_BUFFER_HANDLE;
-			}
+			if (i.clip) release(i);
 		}
 
 		for (AmbientSound& sound : m_ambient_sounds)
@@ -383,70 +546,54 @@ struct AudioModuleImpl final : AudioModule
 	}
 	
 	SoundHandle play(EntityRef entity, Clip* clip, bool is_3d) override {
-		for (PlayingSound& sound : m_playing_sounds) {
-			if (sound.buffer_id == AudioDevice::INVALID_BUFFER_HANDLE) {
-				if (!clip->isReady()) return INVALID_SOUND_HANDLE;
-
-				int flags = is_3d ? (int)AudioDevice::BufferFlags::IS3D : 0;
-				if (is_3d && clip->getChannels() > 1) {
-					logWarning(clip->getPath(), ": can not play sound with 2 channels as 3d");
-					flags = 0;
-				}
-				auto buffer = m_device.createBuffer(clip->getData(), clip->getSize(), clip->getChannels(), clip->getSampleRate(), flags);
-				if (buffer == AudioDevice::INVALID_BUFFER_HANDLE) return INVALID_SOUND_HANDLE;
-
-				m_device.play(buffer, clip->m_looped);
-				m_device.setVolume(buffer, clip->m_volume);
-
-				const DVec3 pos = m_world.getPosition(entity);
-				m_device.setSourcePosition(buffer, pos);
-
-				sound.is_3d = is_3d;
-				sound.buffer_id = buffer;
-				sound.entity = entity;
-				clip->incRefCount();
-				sound.clip = clip;
-
-				for (const EchoZone& zone : m_echo_zones) {
-					const double dist2 = squaredLength(pos - m_world.getPosition(zone.entity));
-					const double r2 = zone.radius * zone.radius;
-					if (dist2 > r2) continue;
-
-					const float w = float(dist2 / r2);
-					m_device.setEcho(buffer, 1, 1 - w, zone.delay, zone.delay);
-					break;
-				}
-
-				for (const ChorusZone& zone : m_chorus_zones) {
-					const double dist2 = squaredLength(pos - m_world.getPosition(zone.entity));
-					double r2 = zone.radius * zone.radius;
-					if (dist2 > r2) continue;
-
-					m_device.setChorus(buffer, 1, 1, 0, 1, zone.delay, 0);
-					break;
-				}
+		if (!clip->isReady()) return INVALID_SOUND_HANDLE;
+		if (is_3d && clip->getChannels() > 1) {
+			logWarning(clip->getPath(), ": can not play sound with 2 channels as 3d");
+		}
 
-				return SoundHandle(&sound - m_playing_sounds);
+		u32 real_count = 0;
+		PlayingSound* free_slot = nullptr;
+		for (PlayingSound& sound : m_playing_sounds) {
+			if (!sound.clip) {
+				if (!free_slot) free_slot = &sound;
+			}
+			else if (sound.buffer_id != AudioDevice::INVALID_BUFFER_HANDLE) {
+				++real_count;
 			}
 		}
+		if (!free_slot) return INVALID_SOUND_HANDLE;
 
-		return INVALID_SOUND_HANDLE;
+		PlayingSound& sound = *free_slot;
+		sound.is_3d = is_3d;
+		sound.entity = entity;
+		sound.paused = false;
+		sound.volume = clip->m_volume;
+		sound.frequency = 0;
+		sound.time = 0;
+		sound.has_echo = false;
+		clip->incRefCount();
+		sound.clip = clip;
+
+		// starts virtual if it's not audible, it's promoted later in update
+		sound.audibility = computeAudibility(sound, getListenerPosition());
+		if (sound.audibility >= AUDIBILITY_THRESHOLD && real_count < MAX_REAL_SOUNDS) makeReal(sound);
+
+		return SoundHandle(&sound - m_playing_sounds);
 	}
 
 	bool isEnd(SoundHandle sound_id) override {
 		ASSERT(sound_id >= 0 && sound_id < (int)lengthOf(m_playing_sounds));
-		return m_device.isEnd(m_playing_sounds[sound_id].buffer_id);
+		const PlayingSound& sound = m_playing_sounds[sound_id];
+		if (!sound.clip) return true;
+		// virtual sounds are released once they end
+		if (sound.buffer_id == AudioDevice::INVALID_BUFFER_HANDLE) return false;
+		return m_device.isEnd(sound.buffer_id);
 	}
 
 	void stop(SoundHandle sound_id) override
 	{
 		ASSERT(sound_id >= 0 && sound_id < (int)lengthOf(m_playing_sounds));
-		m_device.stop(m_playing_sounds[sound_id].buffer_id);
-		m_playing_sounds[sound_id].buffer_id = AudioDevice::INVALID_BUFFER_HANDLE;
-		if (m_playing_sounds[sound_id].clip) {
-			m_playing_sounds[sound_id].clip->decRefCount();
-			m_playing_sounds[sound_id].clip = nullptr;
-		}
+		if (m_playing_sounds[sound_id].clip) release(m_playing_sounds[sound_id]);
 	}
 
 
@@ -457,19 +604,32 @@ struct AudioModuleImpl final : AudioModule
 	{
 		ASSERT(sound_id != AudioModule::INVALID_SOUND_HANDLE);
 		ASSERT(sound_id >= 0 && sound_id < (int)lengthOf(m_playing_sounds));
-		m_device.setVolume(m_playing_sounds[sound_id].buffer_id, volume);
+		PlayingSound& sound = m_playing_sounds[sound_id];
+		sound.volume = volume;
+		if (sound.buffer_id != AudioDevice::INVALID_BUFFER_HANDLE) m_device.setVolume(sound.buffer_id, volume);
 	}
 
 	void setFrequency(SoundHandle sound_id, u32 frequency) override {
 		ASSERT(sound_id != AudioModule::INVALID_SOUND_HANDLE);
 		ASSERT(sound_id >= 0 && sound_id < (int)lengthOf(m_playing_sounds));
-		m_device.setFrequency(m_playing_sounds[sound_id].buffer_id, frequency);
+		PlayingSound& sound = m_playing_sounds[sound_id];
+		sound.frequency = frequency;
+		if (sound.buffer_id != AudioDevice::INVALID_BUFFER_HANDLE) m_device.setFrequency(sound.buffer_id, frequency);
 	}
 
 	void setEcho(SoundHandle sound_id, float wet_dry_mix, float feedback, float left_delay, float right_delay) override
 	{
 		ASSERT(sound_id >= 0 && sound_id < (int)lengthOf(m_playing_sounds));
-		m_device.setEcho(m_playing_sounds[sound_id].buffer_id, wet_dry_mix, feedback, left_delay, right_delay);
+		PlayingSound& sound = m_playing_sounds[sound_id];
+		// kept, so it can be applied again when virtual sound becomes real
+		sound.has_echo = true;
+		sound.echo_wet_dry_mix = wet_dry_mix;
+		sound.echo_feedback = feedback;
+		sound.echo_left_delay = left_delay;
+		sound.echo_right_delay = right_delay;
+		if (sound.buffer_id != AudioDevice::INVALID_BUFFER_HANDLE) {
+			m_device.setEcho(sound.buffer_id, wet_dry_mix, feedback, left_delay, right_delay);
+		}
 	}
 
 	World& getWorld() override { return m_world; }
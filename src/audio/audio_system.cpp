@@ -14,24 +14,6 @@ namespace Lumix
 {
 
 
-struct ClipManager final : ResourceManager {
-	explicit ClipManager(IAllocator& allocator)
-		: ResourceManager(allocator)
-		, m_allocator(allocator)
-	{}
-
-	Resource* createResource(const Path& path) override {
-		return LUMIX_NEW(m_allocator, Clip)(path, *this, m_allocator);
-	}
-
-	void destroyResource(Resource& resource) override {
-		LUMIX_DELETE(m_allocator, static_cast<Clip*>(&resource));
-	}
-
-	IAllocator& m_allocator;
-};
-
-
 struct AudioSystemImpl final : AudioSystem {
 	explicit AudioSystemImpl(Engine& engine)
 		: m_engine(engine)
@@ -57,6 +39,18 @@ struct AudioSystemImpl final : AudioSystem {
 	}
 
 
+	void update(float) override {
+		static const u32 counters[] = {
+			profiler::createCounter("Audio decompressed (MB)", 0),
+			profiler::createCounter("Audio ADPCM (MB)", 0),
+			profiler::createCounter("Audio streamed (MB)", 0),
+		};
+		static_assert(lengthOf(counters) == (u32)Clip::Storage::COUNT);
+		for (u32 i = 0; i < lengthOf(counters); ++i) {
+			profiler::pushCounter(counters[i], m_manager.getMemoryUsage((Clip::Storage)i) / (1024.f * 1024.f));
+		}
+	}
+
 	Engine& getEngine() override { return m_engine; }
 	AudioDevice& getDevice() override { return *m_device; }
 
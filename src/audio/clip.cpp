@@ -1,6 +1,8 @@
 #include "core/allocator.h"
 #include "core/core.h"
 #include "core/crt.h"
+#include "core/job_system.h"
+#include "core/math.h"
 #include "core/profiler.h"
 #include "core/string.h"
 #include "core/stream.h"
@@ -18,9 +20,113 @@ namespace Lumix
 const ResourceType Clip::TYPE("clip");
 
 
+static const i16 ADPCM_STEPS[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060,
+	1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
+	7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const i8 ADPCM_INDEX_STEPS[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+struct ADPCMState {
+	i32 predictor;
+	i32 index;
+
+	void apply(u8 code) {
+		const i32 step = ADPCM_STEPS[index];
+		i32 diff = step >> 3;
+		if (code & 4) diff += step;
+		if (code & 2) diff += step >> 1;
+		if (code & 1) diff += step >> 2;
+		predictor = clamp(code & 8 ? predictor - diff : predictor + diff, -32768, 32767);
+		index = clamp(index + ADPCM_INDEX_STEPS[code], 0, 88);
+	}
+
+	u8 encode(i32 sample) {
+		const i32 step = ADPCM_STEPS[index];
+		i32 diff = sample - predictor;
+		u8 code = 0;
+		if (diff < 0) {
+			code = 8;
+			diff = -diff;
+		}
+		if (diff >= step) { code |= 4; diff -= step; }
+		if (diff >= step >> 1) { code |= 2; diff -= step >> 1; }
+		if (diff >= step >> 2) code |= 1;
+		// decoder must end in the same state
+		apply(code);
+		return code;
+	}
+};
+
+void ADPCM::encode(const i16* pcm, u32 frames, u32 channels, OutputMemoryStream& out) {
+	PROFILE_FUNCTION();
+	ADPCMState states[2] = {};
+	ASSERT(channels <= lengthOf(states));
+	for (u32 block_start = 0; block_start < frames; block_start += BLOCK_FRAMES) {
+		for (u32 c = 0; c < channels; ++c) {
+			out.write((i16)states[c].predictor);
+			out.write((u8)states[c].index);
+			out.write((u8)0);
+		}
+		for (u32 c = 0; c < channels; ++c) {
+			for (u32 i = 0; i < BLOCK_FRAMES; i += 2) {
+				const u32 frame = block_start + i;
+				const i32 s0 = frame < frames ? pcm[frame * channels + c] : 0;
+				const i32 s1 = frame + 1 < frames ? pcm[(frame + 1) * channels + c] : 0;
+				const u8 lo = states[c].encode(s0);
+				const u8 hi = states[c].encode(s1);
+				out.write(u8(lo | (hi << 4)));
+			}
+		}
+	}
+}
+
+void ADPCM::decodeBlock(const u8* block, u32 channels, i16* out) {
+	const u8* nibbles = block + 4 * channels;
+	for (u32 c = 0; c < channels; ++c) {
+		ADPCMState state;
+		i16 predictor;
+		memcpy(&predictor, block + c * 4, sizeof(predictor));
+		state.predictor = predictor;
+		state.index = minimum(block[c * 4 + 2], (u8)88);
+		i16* dst = out + c;
+		for (u32 i = 0; i < BLOCK_FRAMES / 2; ++i) {
+			const u8 byte = nibbles[i];
+			state.apply(byte & 0xf);
+			*dst = (i16)state.predictor;
+			dst += channels;
+			state.apply(byte >> 4);
+			*dst = (i16)state.predictor;
+			dst += channels;
+		}
+		nibbles += BLOCK_FRAMES / 2;
+	}
+}
+
+
+ClipManager::ClipManager(IAllocator& allocator)
+	: ResourceManager(allocator)
+	, m_allocator(allocator)
+{}
+
+Resource* ClipManager::createResource(const Path& path) {
+	return LUMIX_NEW(m_allocator, Clip)(path, *this, m_allocator);
+}
+
+void ClipManager::destroyResource(Resource& resource) {
+	LUMIX_DELETE(m_allocator, static_cast<Clip*>(&resource));
+}
+
+
 void Clip::unload()
 {
+	ClipManager& manager = static_cast<ClipManager&>(m_resource_manager);
+	manager.m_storage_usage[(u32)m_storage] -= m_data.byte_size() + m_encoded.byte_size();
 	m_data.clear();
+	m_encoded.clear();
+	m_num_frames = 0;
 }
 
 struct WAVHeader {
@@ -42,15 +148,9 @@ struct WAVChunk {
 	u32 size;
 };
 
-bool Clip::load(Span<const u8> mem) {
+bool Clip::decode(Format format, Span<const u8> src, Array<i16>& pcm, u32& channels, u32& sample_rate) {
 	PROFILE_FUNCTION();
-	InputMemoryStream blob(mem);
-	const u32 version = blob.read<u32>();
-	if (version != 0) return false;
-
-	const Format format = blob.read<Format>();
-	m_looped = blob.read<bool>();
-	m_volume = blob.read<float>();
+	InputMemoryStream blob(src);
 	switch(format) {
 		case Format::WAV: {
 			WAVHeader header = blob.read<WAVHeader>();
@@ -58,34 +158,232 @@ bool Clip::load(Span<const u8> mem) {
 			if (header.wave != 'EVAW') return false;
 			if (header.bits_per_sample != 16) return false;
 			blob.skip(header.subchunk_size - 16);
-			m_channels = header.channels;
-			m_sample_rate = header.frequency;
+			channels = header.channels;
+			sample_rate = header.frequency;
 
 			for (;;) {
 				const WAVChunk chunk = blob.read<WAVChunk>();
 				if (chunk.type == 'atad') {
-					m_data.resize(u32(chunk.size / sizeof(m_data[0])));
-					return blob.read(m_data.begin(), m_data.byte_size());
+					pcm.resize(u32(chunk.size / sizeof(pcm[0])));
+					return blob.read(pcm.begin(), pcm.byte_size());
 				}
 				blob.skip(chunk.size);
 				if (blob.getPosition() >= blob.size()) return false;
 			}
 		}
 		case Format::OGG: {
-			PROFILE_BLOCK("ogg");
 			short* output = nullptr;
-			auto res = stb_vorbis_decode_memory((unsigned char*)blob.skip(0), (int)blob.remaining(), &m_channels, &m_sample_rate, &output);
+			int ch, rate;
+			const int res = stb_vorbis_decode_memory(src.begin(), (int)src.length(), &ch, &rate, &output);
 			if (res <= 0) return false;
 
-			m_data.resize(res * m_channels);
-			memcpy(&m_data[0], output, res * m_channels * sizeof(m_data[0]));
+			channels = ch;
+			sample_rate = rate;
+			pcm.resize(res * ch);
+			memcpy(pcm.begin(), output, pcm.byte_size());
 			free(output);
 			return true;
 		}
+		case Format::ADPCM: break;
 	}
 	ASSERT(false);
 	return false;
 }
 
+float Clip::getSourceLength(Format format, Span<const u8> src) {
+	InputMemoryStream blob(src);
+	switch(format) {
+		case Format::WAV: {
+			const WAVHeader header = blob.read<WAVHeader>();
+			if (header.riff != 'FFIR' || header.wave != 'EVAW' || header.bytes_per_sec == 0) return -1;
+			blob.skip(header.subchunk_size - 16);
+			for (;;) {
+				const WAVChunk chunk = blob.read<WAVChunk>();
+				if (chunk.type == 'atad') return chunk.size / float(header.bytes_per_sec);
+				blob.skip(chunk.size);
+				if (blob.getPosition() >= blob.size()) return -1;
+			}
+		}
+		case Format::OGG: {
+			stb_vorbis* vorbis = stb_vorbis_open_memory(src.begin(), (int)src.length(), nullptr, nullptr);
+			if (!vorbis) return -1;
+			const float length = stb_vorbis_stream_length_in_seconds(vorbis);
+			stb_vorbis_close(vorbis);
+			return length;
+		}
+		case Format::ADPCM: break;
+	}
+	ASSERT(false);
+	return -1;
+}
+
+bool Clip::load(Span<const u8> mem) {
+	PROFILE_FUNCTION();
+	InputMemoryStream blob(mem);
+	const u32 version = blob.read<u32>();
+	if (version > 1) return false;
+
+	const Format format = blob.read<Format>();
+	m_looped = blob.read<bool>();
+	m_volume = blob.read<float>();
+	// older clips are streamed if they are long ogg files
+	const bool has_storage = version > 0;
+	m_storage = has_storage ? blob.read<Storage>() : Storage::DECOMPRESSED;
+	const Span<const u8> src((const u8*)blob.skip(0), (u32)blob.remaining());
+
+	if (format == Format::ADPCM) {
+		u32 channels, sample_rate;
+		blob.read(channels);
+		blob.read(sample_rate);
+		blob.read(m_num_frames);
+		m_channels = channels;
+		m_sample_rate = sample_rate;
+		m_storage = Storage::ADPCM;
+		m_encoded.resize((u32)blob.remaining());
+		blob.read(m_encoded.begin(), m_encoded.byte_size());
+	}
+	else if (format == Format::OGG && (m_storage == Storage::STREAMED || !has_storage)) {
+		stb_vorbis* vorbis = stb_vorbis_open_memory(src.begin(), (int)src.length(), nullptr, nullptr);
+		if (!vorbis) return false;
+		const stb_vorbis_info info = stb_vorbis_get_info(vorbis);
+		m_channels = info.channels;
+		m_sample_rate = info.sample_rate;
+		m_num_frames = stb_vorbis_stream_length_in_samples(vorbis);
+		stb_vorbis_close(vorbis);
+
+		if (has_storage || m_num_frames * m_channels * sizeof(m_data[0]) > STREAMING_THRESHOLD) {
+			m_storage = Storage::STREAMED;
+			m_encoded.resize(src.length());
+			memcpy(m_encoded.begin(), src.begin(), src.length());
+		}
+	}
+	
+	if (m_encoded.empty()) {
+		u32 channels, sample_rate;
+		if (!decode(format, src, m_data, channels, sample_rate)) return false;
+		m_channels = channels;
+		m_sample_rate = sample_rate;
+		m_num_frames = m_data.size() / channels;
+		m_storage = Storage::DECOMPRESSED;
+
+		m_quality_bias = m_resource_manager.getQualityBias();
+		if (m_quality_bias > 0 && channels <= 2) {
+			// over budget, keep the clip compressed in memory
+			OutputMemoryStream encoded(m_resource_manager.getOwner().getAllocator());
+			ADPCM::encode(m_data.begin(), m_num_frames, channels, encoded);
+			m_encoded.resize((u32)encoded.size());
+			memcpy(m_encoded.begin(), encoded.data(), encoded.size());
+			m_data.clear();
+			m_storage = Storage::ADPCM;
+		}
+	}
+
+	ClipManager& manager = static_cast<ClipManager&>(m_resource_manager);
+	manager.m_storage_usage[(u32)m_storage] += m_data.byte_size() + m_encoded.byte_size();
+	return true;
+}
+
+
+ClipStream::ClipStream(Clip& clip)
+	: m_clip(clip)
+{
+	ASSERT(clip.isStreamed());
+	const Span<const u8> encoded = clip.getEncodedData();
+	m_vorbis = stb_vorbis_open_memory(encoded.begin(), encoded.length(), nullptr, nullptr);
+	// so the sound does not start with silence
+	decode();
+}
+
+
+ClipStream::~ClipStream() {
+	jobs::wait(&m_decode_job);
+	if (m_vorbis) stb_vorbis_close(m_vorbis);
+}
+
+
+void ClipStream::decode() {
+	PROFILE_FUNCTION();
+	if (!m_vorbis) {
+		m_decoded_all = true;
+		return;
+	}
+
+	const int channels = m_clip.getChannels();
+	while (!m_decoded_all && m_decoded - m_read < (i32)BLOCK_COUNT) {
+		const u32 idx = u32(m_decoded) % BLOCK_COUNT;
+		short* block = (short*)m_blocks[idx];
+		const u32 block_shorts = BLOCK_SIZE / sizeof(short) / channels * channels;
+		u32 decoded = 0;
+		bool restarted = false;
+		while (decoded < block_shorts) {
+			const int frames = stb_vorbis_get_samples_short_interleaved(m_vorbis, channels, block + decoded, block_shorts - decoded);
+			if (frames > 0) {
+				decoded += frames * channels;
+				restarted = false;
+				continue;
+			}
+			// restarted stream without any data would loop forever
+			if (!m_looped || restarted) {
+				m_decoded_all = true;
+				break;
+			}
+			stb_vorbis_seek_start(m_vorbis);
+			restarted = true;
+		}
+		if (decoded == 0) break;
+		m_block_sizes[idx] = decoded * sizeof(short);
+		m_decoded.inc();
+	}
+}
+
+
+void ClipStream::requestDecode() {
+	if (m_decoded_all) return;
+	if (m_decoded - m_read >= (i32)BLOCK_COUNT) return;
+	if (!m_decoding.compareExchange(1, 0)) return;
+
+	jobs::runLambda([this](){
+		decode();
+		m_decoding = 0;
+	}, &m_decode_job, jobs::ANY_WORKER, jobs::Priority::BACKGROUND);
+}
+
+
+void ClipStream::read(void* data, u32 size_bytes) {
+	u8* dst = (u8*)data;
+	while (size_bytes > 0 && m_read != m_decoded) {
+		const u32 idx = u32(m_read) % BLOCK_COUNT;
+		const u32 to_copy = minimum(size_bytes, m_block_sizes[idx] - m_read_offset);
+		memcpy(dst, m_blocks[idx] + m_read_offset, to_copy);
+		dst += to_copy;
+		size_bytes -= to_copy;
+		m_read_offset += to_copy;
+		if (m_read_offset == m_block_sizes[idx]) {
+			m_read_offset = 0;
+			m_read.inc();
+		}
+	}
+	if (size_bytes > 0) memset(dst, 0, size_bytes);
+	requestDecode();
+}
+
+
+void ClipStream::seek(u32 frame) {
+	jobs::wait(&m_decode_job);
+	if (!m_vorbis) return;
+	
+	stb_vorbis_seek(m_vorbis, frame);
+	m_decoded = 0;
+	m_read = 0;
+	m_read_offset = 0;
+	m_decoded_all = false;
+	decode();
+}
+
+
+bool ClipStream::isEnd() const {
+	return m_decoded_all && m_read == m_decoded;
+}
+
 
 } // namespace Lumix
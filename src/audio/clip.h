@@ -1,23 +1,63 @@
 #pragma once
 
 #include "core/array.h"
+#include "core/atomic.h"
+#include "core/job_system.h"
 
 #include "engine/resource.h"
+#include "engine/resource_manager.h"
+
+
+struct stb_vorbis;
 
 
 namespace Lumix {
 
 
+struct OutputMemoryStream;
+
+
+// IMA ADPCM, 4 bits per sample, blocks can be decoded independently
+// block has 4B header (predictor, step index) per channel followed by BLOCK_FRAMES nibbles per channel
+struct ADPCM {
+	static constexpr u32 BLOCK_FRAMES = 256;
+
+	static u32 getBlockSize(u32 channels) { return channels * (4 + BLOCK_FRAMES / 2); }
+	// last block is padded with silence
+	static void encode(const i16* pcm, u32 frames, u32 channels, OutputMemoryStream& out);
+	// writes BLOCK_FRAMES interleaved frames
+	static void decodeBlock(const u8* block, u32 channels, i16* out);
+};
+
+
 struct Clip final : Resource
 {
 	enum class Format : u8 {
 		OGG,
-		WAV
+		WAV,
+		// encoded by asset compiler
+		ADPCM
+	};
+
+	// how is the clip kept in memory, chosen by asset compiler from clip's length
+	enum class Storage : u8 {
+		// 16-bit PCM, for short clips
+		DECOMPRESSED,
+		// ADPCM blocks, decoded by the mixer while playing
+		ADPCM,
+		// ogg, decoded in background through ClipStream, for long clips
+		STREAMED,
+
+		COUNT
 	};
 
+	// used for compiled clips without storage
+	static constexpr u32 STREAMING_THRESHOLD = 1024 * 1024;
+
 	Clip(const Path& path, ResourceManager& manager, IAllocator& allocator)
 		: Resource(path, manager, allocator)
 		, m_data(allocator)
+		, m_encoded(allocator)
 	{
 	}
 
@@ -25,11 +65,26 @@ struct Clip final : Resource
 
 	void unload() override;
 	bool load(Span<const u8> mem) override;
+	u64 getMemoryUsage() const override { return m_data.byte_size() + m_encoded.byte_size(); }
+	// decompressed clips are kept as ADPCM when loaded with quality bias
+	bool supportsQualityBias() const override { return m_storage == Storage::DECOMPRESSED; }
 	int getChannels() const { return m_channels; }
 	int getSampleRate() const { return m_sample_rate; }
-	int getSize() const { return m_data.size() * sizeof(m_data[0]); }
-	u16* getData() { return m_data.begin(); }
-	float getLengthSeconds() const { return m_data.size() / float(m_channels * m_sample_rate); }
+	u32 getFramesCount() const { return m_num_frames; }
+	// size of decoded data, even if the clip is not decompressed
+	int getSize() const { return m_num_frames * m_channels * sizeof(m_data[0]); }
+	// nullptr if the clip is not decompressed
+	const i16* getData() const { return m_data.begin(); }
+	float getLengthSeconds() const { return m_num_frames / float(m_sample_rate); }
+	Storage getStorage() const { return m_storage; }
+	bool isStreamed() const { return m_storage == Storage::STREAMED; }
+	// ogg if the clip is streamed, ADPCM blocks if it's compressed in memory
+	Span<const u8> getEncodedData() const { return m_encoded; }
+
+	// decodes source wav or ogg file to 16-bit PCM, e.g. for asset compiler
+	static bool decode(Format format, Span<const u8> src, Array<i16>& pcm, u32& channels, u32& sample_rate);
+	// length of source wav or ogg file in seconds without decoding it, negative on error
+	static float getSourceLength(Format format, Span<const u8> src);
 
 	static const ResourceType TYPE;
 	bool m_looped = false;
@@ -38,7 +93,60 @@ struct Clip final : Resource
 private:
 	int m_channels;
 	int m_sample_rate;
-	Array<u16> m_data;
+	u32 m_num_frames = 0;
+	Storage m_storage = Storage::DECOMPRESSED;
+	Array<i16> m_data;
+	// ogg data of streamed clip or ADPCM blocks
+	Array<u8> m_encoded;
+};
+
+
+struct ClipManager final : ResourceManager {
+	explicit ClipManager(IAllocator& allocator);
+
+	Resource* createResource(const Path& path) override;
+	void destroyResource(Resource& resource) override;
+	// total size of loaded clips with `storage`
+	u64 getMemoryUsage(Clip::Storage storage) const { return m_storage_usage[(u32)storage]; }
+
+	IAllocator& m_allocator;
+	u64 m_storage_usage[(u32)Clip::Storage::COUNT] = {};
+};
+
+
+// decodes a streamed clip in background jobs into a small ring of blocks, one stream per playing sound
+// audio device reads from one thread, while at most one decoding job writes
+struct ClipStream {
+	static constexpr u32 BLOCK_SIZE = 16 * 1024;
+	static constexpr u32 BLOCK_COUNT = 4;
+
+	explicit ClipStream(Clip& clip);
+	~ClipStream();
+
+	Clip& getClip() const { return m_clip; }
+	// writes silence if decoding falls behind or the clip ended
+	void read(void* data, u32 size_bytes);
+	// must not be called while the stream is being read
+	void seek(u32 frame);
+	void setLooped(bool looped) { m_looped = looped; }
+	bool isEnd() const;
+
+private:
+	void decode();
+	void requestDecode();
+
+	Clip& m_clip;
+	stb_vorbis* m_vorbis = nullptr;
+	u8 m_blocks[BLOCK_COUNT][BLOCK_SIZE];
+	u32 m_block_sizes[BLOCK_COUNT];
+	// total number of decoded and read blocks, ring is full if they differ by BLOCK_COUNT
+	AtomicI32 m_decoded = 0;
+	AtomicI32 m_read = 0;
+	u32 m_read_offset = 0;
+	AtomicI32 m_decoding = 0;
+	jobs::Counter m_decode_job;
+	volatile bool m_looped = false;
+	volatile bool m_decoded_all = false;
 };
 
 
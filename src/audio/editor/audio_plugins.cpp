@@ -91,6 +91,21 @@ struct AssetBrowserPlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin
 
 			ImGuiEx::Label("Length");
 			ImGui::Text("%f", m_resource->getLengthSeconds());
+
+			ImGuiEx::Label("Storage");
+			const char* storage_names[] = { "Decompressed", "ADPCM", "Streamed" };
+			static_assert(lengthOf(storage_names) == (u32)Clip::Storage::COUNT);
+			ImGui::TextUnformatted(storage_names[(u32)m_resource->getStorage()]);
+
+			if (m_resource->getStorage() == Clip::Storage::DECOMPRESSED) {
+				if (ImGui::Button("Benchmark mixer")) {
+					m_benchmark = AudioDevice::benchmarkMixer(m_resource->getData(), m_resource->getSize(), m_resource->getChannels(), m_resource->getSampleRate(), 64, 1000, m_app.getAllocator());
+				}
+				if (m_benchmark > 0) {
+					ImGui::SameLine();
+					ImGui::Text("%.1f voices/ms", m_benchmark);
+				}
+			}
 			auto& device = getAudioDevice(m_app.getEngine());
 
 			if (m_playing_clip >= 0)
@@ -109,8 +124,23 @@ struct AssetBrowserPlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin
 			if (m_playing_clip < 0 && ImGui::Button(ICON_FA_PLAY "Play")) {
 				stopAudio();
 
-				AudioDevice::BufferHandle handle = device.createBuffer(m_resource->getData(), m_resource->getSize(), m_resource->getChannels(), m_resource->getSampleRate(), 0);
-				if (handle != AudioDevice::INVALID_BUFFER_HANDLE) {
+				AudioDevice::BufferHandle handle;
+				if (m_resource->isStreamed()) {
+					m_stream = LUMIX_NEW(m_app.getAllocator(), ClipStream)(*m_resource);
+					handle = device.createBuffer(*m_stream, 0);
+				}
+				else if (m_resource->getStorage() == Clip::Storage::ADPCM) {
+					const Span<const u8> data = m_resource->getEncodedData();
+					handle = device.createADPCMBuffer(data.begin(), data.length(), m_resource->getFramesCount(), m_resource->getChannels(), m_resource->getSampleRate(), 0);
+				}
+				else {
+					handle = device.createBuffer(m_resource->getData(), m_resource->getSize(), m_resource->getChannels(), m_resource->getSampleRate(), 0);
+				}
+				if (handle == AudioDevice::INVALID_BUFFER_HANDLE) {
+					LUMIX_DELETE(m_app.getAllocator(), m_stream);
+					m_stream = nullptr;
+				}
+				else {
 					device.setVolume(handle, m_resource->m_volume);
 					device.play(handle, true);
 					m_playing_clip = handle;
@@ -132,12 +162,18 @@ struct AssetBrowserPlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin
 
 			getAudioDevice(m_app.getEngine()).stop(m_playing_clip);
 			m_playing_clip = -1;
+			if (m_stream) {
+				LUMIX_DELETE(m_app.getAllocator(), m_stream);
+				m_stream = nullptr;
+			}
 		}
 
 		StudioApp& m_app;
 		Clip* m_resource;
 		Meta m_meta;
 		i32 m_playing_clip;
+		ClipStream* m_stream = nullptr;
+		float m_benchmark = 0;
 	};
 
 	explicit AssetBrowserPlugin(StudioApp& app)
@@ -162,17 +198,52 @@ struct AssetBrowserPlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin
 		Meta meta;
 		meta.load(src, m_app);
 
+		const bool is_wav = Path::hasExtension(src, "wav");
+		const Clip::Format src_format = is_wav ? Clip::Format::WAV : Clip::Format::OGG;
+		const float length = Clip::getSourceLength(src_format, src_data);
+		if (length < 0) {
+			logError("Failed to read ", src);
+			return false;
+		}
+
+		// short clips are played often, so they are decompressed; long ogg clips would take too much memory even as ADPCM
+		Clip::Storage storage = Clip::Storage::ADPCM;
+		if (length < DECOMPRESS_MAX_SECONDS) storage = Clip::Storage::DECOMPRESSED;
+		else if (!is_wav && length >= STREAM_MIN_SECONDS) storage = Clip::Storage::STREAMED;
+
+		Array<i16> pcm(m_app.getAllocator());
+		u32 channels, sample_rate;
+		if (storage == Clip::Storage::ADPCM) {
+			if (!Clip::decode(src_format, src_data, pcm, channels, sample_rate)) {
+				logError("Failed to decode ", src);
+				return false;
+			}
+			if (channels > 2) storage = Clip::Storage::DECOMPRESSED;
+		}
+
 		OutputMemoryStream compiled(m_app.getAllocator());
 		compiled.reserve(64 + src_data.size());
-		compiled.write((u32)0);
-		const bool is_wav = Path::hasExtension(src, "wav");
-		compiled.write(is_wav ? Clip::Format::WAV : Clip::Format::OGG);
+		compiled.write((u32)1);
+		compiled.write(storage == Clip::Storage::ADPCM ? Clip::Format::ADPCM : src_format);
 		compiled.write(meta.looped);
 		compiled.write(meta.volume);
-		compiled.write(src_data.data(), src_data.size());
+		compiled.write(storage);
+		if (storage == Clip::Storage::ADPCM) {
+			const u32 frames = pcm.size() / channels;
+			compiled.write(channels);
+			compiled.write(sample_rate);
+			compiled.write(frames);
+			ADPCM::encode(pcm.begin(), frames, channels, compiled);
+		}
+		else {
+			compiled.write(src_data.data(), src_data.size());
+		}
 		return m_app.getAssetCompiler().writeCompiledResource(src, Span(compiled.data(), (i32)compiled.size()));
 	}
 
+	static constexpr float DECOMPRESS_MAX_SECONDS = 2;
+	static constexpr float STREAM_MIN_SECONDS = 20;
+
 	const char* getIcon() const override { return ICON_FA_FILE_AUDIO; }
 	const char* getLabel() const override { return "Audio"; }
 	ResourceType getResourceType() const override { return Clip::TYPE; }
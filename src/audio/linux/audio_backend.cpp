@@ -0,0 +1,180 @@
+#include "core/allocator.h"
+#include "core/log.h"
+#include "core/os.h"
+#include "core/thread.h"
+
+#include "../audio_backend.h"
+#include <alsa/asoundlib.h>
+
+
+namespace Lumix
+{
+
+
+// blocking ALSA output, libasound is loaded dynamically so the engine runs without it
+struct ALSABackend final : AudioBackend, Thread
+{
+	static constexpr u32 CHANNELS = 2;
+	static constexpr u32 PERIOD_FRAMES = 256;
+
+	struct API
+	{
+		int	(*snd_pcm_open)(snd_pcm_t** pcm, const char* name, snd_pcm_stream_t stream, int mode);
+		int (*snd_pcm_close)(snd_pcm_t* handle);
+		int (*snd_pcm_hw_params_any)(snd_pcm_t* pcm, snd_pcm_hw_params_t* params);
+		int (*snd_pcm_hw_params)(snd_pcm_t* pcm, snd_pcm_hw_params_t* params);
+		const char* (*snd_strerror)(int error_num);
+		int (*snd_pcm_recover)(snd_pcm_t* pcm, int err, int silent);
+		int (*snd_pcm_prepare)(snd_pcm_t* pcm);
+		size_t (*snd_pcm_hw_params_sizeof)();
+		int (*snd_pcm_hw_params_set_access)(snd_pcm_t* pcm, snd_pcm_hw_params_t* params, snd_pcm_access_t _access);
+		int (*snd_pcm_hw_params_set_format)(snd_pcm_t* pcm, snd_pcm_hw_params_t* params, snd_pcm_format_t val);
+		int (*snd_pcm_hw_params_set_channels)(snd_pcm_t* pcm, snd_pcm_hw_params_t* params, unsigned int val);
+		int (*snd_pcm_hw_params_set_rate_near)(snd_pcm_t* pcm, snd_pcm_hw_params_t* params, unsigned int* val, int* dir);
+		int (*snd_pcm_hw_params_set_period_size_near)(snd_pcm_t* pcm, snd_pcm_hw_params_t* params, snd_pcm_uframes_t* val, int* dir);
+		int (*snd_pcm_hw_params_set_buffer_size_near)(snd_pcm_t* pcm, snd_pcm_hw_params_t* params, snd_pcm_uframes_t* val);
+		const char* (*snd_pcm_name)(snd_pcm_t* pcm);
+		snd_pcm_sframes_t (*snd_pcm_writei)(snd_pcm_t* pcm, const void* buffer, snd_pcm_uframes_t size);
+	};
+
+	ALSABackend(IAllocator& allocator)
+		: Thread(allocator)
+	{}
+
+	~ALSABackend() {
+		if (m_running) {
+			m_finished = true;
+			destroy();
+		}
+		if (m_device) m_api.snd_pcm_close(m_device);
+		if (m_alsa_lib) os::unloadLibrary(m_alsa_lib);
+	}
+
+	u32 getChannels() const override { return CHANNELS; }
+	u32 getSampleRate() const override { return m_sample_rate; }
+
+	bool loadAlsa() {
+		m_alsa_lib = os::loadLibrary("libasound.so");
+		if (!m_alsa_lib) return false;
+
+		#define API(func) \
+			do { \
+				m_api.func = (decltype(m_api.func))os::getLibrarySymbol(m_alsa_lib, #func);\
+				if(!m_api.func)\
+				{\
+					os::unloadLibrary(m_alsa_lib);\
+					m_alsa_lib = nullptr;\
+					return false;\
+				}\
+			} while(false)
+
+		API(snd_pcm_open);
+		API(snd_pcm_close);
+		API(snd_pcm_writei);
+		API(snd_strerror);
+		API(snd_pcm_hw_params);
+		API(snd_pcm_hw_params_any);
+		API(snd_pcm_hw_params_sizeof);
+		API(snd_pcm_hw_params_set_format);
+		API(snd_pcm_hw_params_set_channels);
+		API(snd_pcm_hw_params_set_rate_near);
+		API(snd_pcm_hw_params_set_access);
+		API(snd_pcm_hw_params_set_period_size_near);
+		API(snd_pcm_hw_params_set_buffer_size_near);
+		API(snd_pcm_name);
+		API(snd_pcm_recover);
+		API(snd_pcm_prepare);
+
+		#undef API
+
+		return true;
+	}
+
+	bool init() {
+		if (!loadAlsa()) return false;
+
+		unsigned int rate = 44100;
+		snd_pcm_hw_params_t* hw_params;
+		snd_pcm_uframes_t period_size = PERIOD_FRAMES;
+		// two periods in flight, anything more is just latency
+		snd_pcm_uframes_t buffer_size = PERIOD_FRAMES * 2;
+
+		int res = m_api.snd_pcm_open(&m_device, "default", SND_PCM_STREAM_PLAYBACK, 0);
+		if (res < 0) goto error;
+
+		hw_params = (snd_pcm_hw_params_t*)alloca(m_api.snd_pcm_hw_params_sizeof());
+		res = m_api.snd_pcm_hw_params_any(m_device, hw_params);
+		if (res < 0) goto error;
+
+		if ((res = m_api.snd_pcm_hw_params_set_access(m_device, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) goto error;
+		if ((res = m_api.snd_pcm_hw_params_set_format(m_device, hw_params, SND_PCM_FORMAT_S16_LE)) < 0) goto error;
+		if ((res = m_api.snd_pcm_hw_params_set_channels(m_device, hw_params, CHANNELS)) < 0) goto error;
+		if ((res = m_api.snd_pcm_hw_params_set_rate_near(m_device, hw_params, &rate, 0)) < 0) goto error;
+		if ((res = m_api.snd_pcm_hw_params_set_period_size_near(m_device, hw_params, &period_size, 0)) < 0) goto error;
+		if ((res = m_api.snd_pcm_hw_params_set_buffer_size_near(m_device, hw_params, &buffer_size)) < 0) goto error;
+		res = m_api.snd_pcm_hw_params(m_device, hw_params);
+		if (res < 0) goto error;
+
+		res = m_api.snd_pcm_prepare(m_device);
+		if (res < 0) goto error;
+
+		m_sample_rate = rate;
+		logInfo("PCM name: '", m_api.snd_pcm_name(m_device), "', ", rate, " Hz, ", u32(buffer_size), " frames buffer");
+		return true;
+
+		error:
+			logError(m_api.snd_strerror(res));
+			return false;
+	}
+
+	bool start(const MixFunction& mix) override {
+		m_mix = mix;
+		m_running = true;
+		return create("audio", true);
+	}
+
+	int task() override {
+		float mixed[PERIOD_FRAMES * CHANNELS];
+		i16 output[PERIOD_FRAMES * CHANNELS];
+		while (!m_finished) {
+			m_mix.invoke(mixed, PERIOD_FRAMES);
+			for (u32 i = 0; i < lengthOf(output); ++i) output[i] = i16(mixed[i] * 32767);
+
+			const i16* iter = output;
+			snd_pcm_uframes_t frames = PERIOD_FRAMES;
+			while (frames > 0 && !m_finished) {
+				// blocks until there's space in the buffer
+				const snd_pcm_sframes_t written = m_api.snd_pcm_writei(m_device, iter, frames);
+				if (written < 0) {
+					const int res = m_api.snd_pcm_recover(m_device, (int)written, 1);
+					if (res < 0) {
+						logError(m_api.snd_strerror(res));
+						return 0;
+					}
+					continue;
+				}
+				frames -= written;
+				iter += written * CHANNELS;
+			}
+		}
+		return 0;
+	}
+
+	MixFunction m_mix;
+	API m_api;
+	void* m_alsa_lib = nullptr;
+	snd_pcm_t* m_device = nullptr;
+	u32 m_sample_rate = 44100;
+	bool m_running = false;
+	volatile bool m_finished = false;
+};
+
+
+UniquePtr<AudioBackend> AudioBackend::create(IAllocator& allocator) {
+	UniquePtr<ALSABackend> backend = UniquePtr<ALSABackend>::create(allocator, allocator);
+	if (!backend->init()) return {};
+	return backend.move();
+}
+
+
+} // namespace Lumix
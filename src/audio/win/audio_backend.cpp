@@ -0,0 +1,190 @@
+#include "core/allocator.h"
+#include "core/log.h"
+#include "core/thread.h"
+
+#include "../audio_backend.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <mmdeviceapi.h>
+#include <audioclient.h>
+#include <mmreg.h>
+#include <ksmedia.h>
+
+
+namespace Lumix
+{
+
+
+// shared mode WASAPI output, uses IAudioClient3's minimal period if available
+struct WASAPIBackend final : AudioBackend, Thread
+{
+	WASAPIBackend(IAllocator& allocator)
+		: Thread(allocator)
+	{}
+
+	~WASAPIBackend() {
+		if (m_running) {
+			m_finished = true;
+			SetEvent(m_event);
+			destroy();
+			m_client->Stop();
+		}
+		if (m_render_client) m_render_client->Release();
+		if (m_client) m_client->Release();
+		if (m_device) m_device->Release();
+		if (m_event) CloseHandle(m_event);
+		if (m_com_initialized) CoUninitialize();
+	}
+
+	u32 getChannels() const override { return m_channels; }
+	u32 getSampleRate() const override { return m_sample_rate; }
+
+	bool initLowLatency(WAVEFORMATEX* format) {
+		IAudioClient3* client3;
+		if (FAILED(m_device->Activate(__uuidof(IAudioClient3), CLSCTX_ALL, nullptr, (void**)&client3))) return false;
+
+		UINT32 default_period, fundamental_period, min_period, max_period;
+		HRESULT hr = client3->GetSharedModeEnginePeriod(format, &default_period, &fundamental_period, &min_period, &max_period);
+		if (SUCCEEDED(hr)) {
+			hr = client3->InitializeSharedAudioStream(AUDCLNT_STREAMFLAGS_EVENTCALLBACK, min_period, format, nullptr);
+		}
+		if (FAILED(hr)) {
+			client3->Release();
+			return false;
+		}
+		m_client = client3;
+		return true;
+	}
+
+	bool initDefault() {
+		if (FAILED(m_device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, (void**)&m_client))) return false;
+
+		WAVEFORMATEX format = {};
+		format.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
+		format.nChannels = 2;
+		format.nSamplesPerSec = 48000;
+		format.wBitsPerSample = 32;
+		format.nBlockAlign = format.nChannels * format.wBitsPerSample / 8;
+		format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+
+		// 10 ms, in 100 ns units
+		const REFERENCE_TIME duration = 100'000;
+		const DWORD flags = AUDCLNT_STREAMFLAGS_EVENTCALLBACK | AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM | AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY;
+		if (FAILED(m_client->Initialize(AUDCLNT_SHAREMODE_SHARED, flags, duration, 0, &format, nullptr))) return false;
+
+		m_channels = format.nChannels;
+		m_sample_rate = format.nSamplesPerSec;
+		return true;
+	}
+
+	bool init() {
+		m_com_initialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+
+		IMMDeviceEnumerator* enumerator;
+		if (FAILED(CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL, __uuidof(IMMDeviceEnumerator), (void**)&enumerator))) {
+			logError("Failed to create audio device enumerator");
+			return false;
+		}
+		const HRESULT hr = enumerator->GetDefaultAudioEndpoint(eRender, eConsole, &m_device);
+		enumerator->Release();
+		if (FAILED(hr)) {
+			logError("No audio output device found");
+			return false;
+		}
+
+		WAVEFORMATEX* mix_format;
+		IAudioClient* tmp_client;
+		if (FAILED(m_device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, (void**)&tmp_client))) return false;
+		const bool has_mix_format = SUCCEEDED(tmp_client->GetMixFormat(&mix_format));
+		tmp_client->Release();
+
+		// low latency stream must use the engine's mix format, which we can write only if it's float
+		bool initialized = false;
+		if (has_mix_format) {
+			const bool is_float = mix_format->wBitsPerSample == 32
+				&& (mix_format->wFormatTag == WAVE_FORMAT_IEEE_FLOAT
+					|| mix_format->wFormatTag == WAVE_FORMAT_EXTENSIBLE && ((WAVEFORMATEXTENSIBLE*)mix_format)->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT);
+			if (is_float && initLowLatency(mix_format)) {
+				m_channels = mix_format->nChannels;
+				m_sample_rate = mix_format->nSamplesPerSec;
+				initialized = true;
+			}
+			CoTaskMemFree(mix_format);
+		}
+		if (!initialized) {
+			if (m_client) {
+				m_client->Release();
+				m_client = nullptr;
+			}
+			if (!initDefault()) {
+				logError("Failed to initialize audio client");
+				return false;
+			}
+		}
+
+		m_event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		if (FAILED(m_client->SetEventHandle(m_event))) return false;
+		if (FAILED(m_client->GetBufferSize(&m_buffer_frames))) return false;
+		if (FAILED(m_client->GetService(__uuidof(IAudioRenderClient), (void**)&m_render_client))) return false;
+
+		logInfo("Audio output: ", m_channels, " channels, ", m_sample_rate, " Hz, ", m_buffer_frames, " frames buffer");
+		return true;
+	}
+
+	void fill() {
+		UINT32 padding;
+		if (FAILED(m_client->GetCurrentPadding(&padding))) return;
+		const UINT32 frames = m_buffer_frames - padding;
+		if (frames == 0) return;
+
+		BYTE* data;
+		if (FAILED(m_render_client->GetBuffer(frames, &data))) return;
+		m_mix.invoke((float*)data, frames);
+		m_render_client->ReleaseBuffer(frames, 0);
+	}
+
+	bool start(const MixFunction& mix) override {
+		m_mix = mix;
+		// prefill, so the first period is not silent
+		fill();
+		if (FAILED(m_client->Start())) {
+			logError("Failed to start audio client");
+			return false;
+		}
+		m_running = true;
+		return create("audio", true);
+	}
+
+	int task() override {
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+		while (!m_finished) {
+			WaitForSingleObject(m_event, INFINITE);
+			if (m_finished) break;
+			fill();
+		}
+		return 0;
+	}
+
+	MixFunction m_mix;
+	IMMDevice* m_device = nullptr;
+	IAudioClient* m_client = nullptr;
+	IAudioRenderClient* m_render_client = nullptr;
+	HANDLE m_event = nullptr;
+	UINT32 m_buffer_frames = 0;
+	u32 m_channels = 2;
+	u32 m_sample_rate = 48000;
+	bool m_com_initialized = false;
+	bool m_running = false;
+	volatile bool m_finished = false;
+};
+
+
+UniquePtr<AudioBackend> AudioBackend::create(IAllocator& allocator) {
+	UniquePtr<WASAPIBackend> backend = UniquePtr<WASAPIBackend>::create(allocator, allocator);
+	if (!backend->init()) return {};
+	return backend.move();
+}
+
+
+} // namespace Lumix
@@ -0,0 +1,328 @@
+// microbenchmarks of core containers, allocators and job system
+// results are printed to stdout as JSON, so they can be compared between commits
+// usage: bench [-filter <substring>] [-repeat <count>]
+
+#include <lz4/lz4.h>
+#include <stdio.h>
+
+#include "core/arena_allocator.h"
+#include "core/atomic.h"
+#include "core/array.h"
+#include "core/command_line_parser.h"
+#include "core/debug.h"
+#include "core/default_allocator.h"
+#include "core/hash_map.h"
+#include "core/job_system.h"
+#include "core/math.h"
+#include "core/os.h"
+#include "core/page_allocator.h"
+#include "core/profiler.h"
+#include "core/ring_buffer.h"
+#include "core/sort.h"
+#include "core/string.h"
+#include "core/sync.h"
+
+using namespace Lumix;
+
+// all benchmarks use the same seeds, so every run processes the same data
+static constexpr u32 SEED_U = 0x12345678;
+static constexpr u32 SEED_V = 0x9abcdef0;
+static constexpr u32 COUNT = 1 << 20;
+
+// prevents the compiler from optimizing out results
+static volatile u64 g_sink = 0;
+
+struct Bench {
+	Bench(IAllocator& allocator) : allocator(allocator) {}
+
+	template <typename F>
+	void run(const char* name, u32 ops, F&& f) {
+		if (filter[0] && !findInsensitive(name, filter)) return;
+
+		// the best of several runs, it's the least noisy
+		double best = 1e30;
+		for (u32 i = 0; i < repeat; ++i) {
+			os::Timer timer;
+			f();
+			best = minimum(best, (double)timer.getTimeSinceStart());
+		}
+
+		const double ns_per_op = best * 1e9 / ops;
+		printf("%s\n\t\t{ \"name\": \"%s\", \"ops\": %u, \"best_ms\": %.4f, \"ns_per_op\": %.4f }", first ? "" : ",", name, ops, best * 1e3, ns_per_op);
+		fflush(stdout);
+		first = false;
+	}
+
+	IAllocator& allocator;
+	char filter[64] = "";
+	u32 repeat = 5;
+	bool first = true;
+};
+
+static void randomKeys(Array<u32>& keys, u32 count) {
+	RandomGenerator rng(SEED_U, SEED_V);
+	keys.resize(count);
+	for (u32& k : keys) k = rng.rand();
+}
+
+static void benchArray(Bench& bench) {
+	bench.run("array_push", COUNT, [&](){
+		Array<u32> array(bench.allocator);
+		for (u32 i = 0; i < COUNT; ++i) array.push(i);
+		g_sink += array.size();
+	});
+
+	bench.run("array_push_reserved", COUNT, [&](){
+		Array<u32> array(bench.allocator);
+		array.reserve(COUNT);
+		for (u32 i = 0; i < COUNT; ++i) array.push(i);
+		g_sink += array.size();
+	});
+
+	Array<u32> src(bench.allocator);
+	randomKeys(src, COUNT);
+	bench.run("array_iterate", COUNT, [&](){
+		u64 sum = 0;
+		for (u32 v : src) sum += v;
+		g_sink += sum;
+	});
+}
+
+static void benchHashMap(Bench& bench) {
+	Array<u32> keys(bench.allocator);
+	randomKeys(keys, COUNT);
+
+	bench.run("hash_map_insert", COUNT, [&](){
+		HashMap<u32, u32> map(bench.allocator);
+		for (u32 i = 0; i < COUNT; ++i) map.insert(keys[i], i);
+		g_sink += map.size();
+	});
+
+	bench.run("hash_map_insert_reserved", COUNT, [&](){
+		HashMap<u32, u32> map(bench.allocator);
+		map.reserve(COUNT);
+		for (u32 i = 0; i < COUNT; ++i) map.insert(keys[i], i);
+		g_sink += map.size();
+	});
+
+	HashMap<u32, u32> map(bench.allocator);
+	map.reserve(COUNT);
+	for (u32 i = 0; i < COUNT; ++i) map.insert(keys[i], i);
+
+	bench.run("hash_map_find_hit", COUNT, [&](){
+		u64 sum = 0;
+		for (u32 k : keys) {
+			auto iter = map.find(k);
+			if (iter.isValid()) sum += iter.value();
+		}
+		g_sink += sum;
+	});
+
+	RandomGenerator rng(SEED_V, SEED_U);
+	Array<u32> misses(bench.allocator);
+	misses.resize(COUNT);
+	for (u32& k : misses) k = rng.rand();
+	bench.run("hash_map_find_miss", COUNT, [&](){
+		u64 found = 0;
+		for (u32 k : misses) found += map.find(k).isValid() ? 1 : 0;
+		g_sink += found;
+	});
+}
+
+static void benchRingBuffer(Bench& bench) {
+	bench.run("ring_buffer_push_pop", COUNT, [&](){
+		RingBuffer<u32, 512> rb(bench.allocator);
+		u64 sum = 0;
+		for (u32 i = 0; i < COUNT; ++i) {
+			rb.push(i);
+			u32 v;
+			if (rb.pop(v)) sum += v;
+		}
+		g_sink += sum;
+	});
+
+	// more items than capacity, so the fallback is used too
+	bench.run("ring_buffer_overflow", COUNT, [&](){
+		RingBuffer<u32, 512> rb(bench.allocator);
+		u64 sum = 0;
+		for (u32 j = 0; j < COUNT / 4096; ++j) {
+			for (u32 i = 0; i < 4096; ++i) rb.push(i);
+			u32 v;
+			while (rb.pop(v)) sum += v;
+		}
+		g_sink += sum;
+	});
+}
+
+static void benchAllocators(Bench& bench) {
+	constexpr u32 PAGES = 1024;
+	bench.run("page_allocator", COUNT, [&](){
+		PageAllocator allocator(bench.allocator);
+		void* pages[PAGES];
+		for (u32 j = 0; j < COUNT / PAGES; ++j) {
+			for (u32 i = 0; i < PAGES; ++i) pages[i] = allocator.allocate();
+			for (u32 i = 0; i < PAGES; ++i) allocator.deallocate(pages[i]);
+		}
+	});
+
+	ArenaAllocator arena(256 * 1024 * 1024, bench.allocator, "bench arena");
+	bench.run("arena_allocator", COUNT, [&](){
+		RandomGenerator rng(SEED_U, SEED_V);
+		for (u32 j = 0; j < 16; ++j) {
+			for (u32 i = 0; i < COUNT / 16; ++i) {
+				void* mem = arena.allocate(16 + (rng.rand() & 63), 8);
+				g_sink += (u64)(uintptr)mem;
+			}
+			arena.reset();
+		}
+	});
+
+	bench.run("default_allocator", COUNT, [&](){
+		RandomGenerator rng(SEED_U, SEED_V);
+		void* ptrs[256];
+		for (u32 j = 0; j < COUNT / 256; ++j) {
+			for (u32 i = 0; i < 256; ++i) ptrs[i] = bench.allocator.allocate(16 + (rng.rand() & 255), 8);
+			for (u32 i = 0; i < 256; ++i) bench.allocator.deallocate(ptrs[i]);
+		}
+	});
+}
+
+static void benchJobs(Bench& bench) {
+	Array<u32> data(bench.allocator);
+	randomKeys(data, COUNT * 4);
+
+	bench.run("jobs_for_each", data.size(), [&](){
+		AtomicI64 sum = 0;
+		jobs::forEach(data.size(), 4096, [&](i32 from, i32 to){
+			u64 s = 0;
+			for (i32 i = from; i < to; ++i) s += data[i];
+			sum.add(s);
+		});
+		g_sink += sum;
+	});
+
+	bench.run("jobs_for_each_adaptive", data.size(), [&](){
+		AtomicI64 sum = 0;
+		jobs::forEach(data.size(), [&](u32 from, u32 to){
+			u64 s = 0;
+			for (u32 i = from; i < to; ++i) s += data[i];
+			sum.add(s);
+		});
+		g_sink += sum;
+	});
+
+	// overhead of scheduling many tiny jobs
+	constexpr u32 JOBS = 16 * 1024;
+	bench.run("jobs_run_n", JOBS, [&](){
+		AtomicI32 counter = 0;
+		jobs::Counter done;
+		jobs::runN(&counter, [](void* ptr){ ((AtomicI32*)ptr)->inc(); }, &done, JOBS);
+		jobs::wait(&done);
+		g_sink += counter;
+	});
+}
+
+static void benchSort(Bench& bench) {
+	Array<u32> src(bench.allocator);
+	randomKeys(src, COUNT);
+	Array<u32> tmp(bench.allocator);
+	tmp.resize(COUNT);
+
+	bench.run("sort_random", COUNT, [&](){
+		memcpy(tmp.begin(), src.begin(), src.byte_size());
+		sort(tmp.begin(), tmp.end());
+		g_sink += tmp[0];
+	});
+
+	bench.run("sort_sorted", COUNT, [&](){
+		sort(tmp.begin(), tmp.end(), [](u32 a, u32 b){ return a < b; });
+		g_sink += tmp[0];
+	});
+}
+
+static void benchLZ4(Bench& bench) {
+	// mix of runs and noise, compresses roughly like typical asset data
+	constexpr u32 SIZE = 16 * 1024 * 1024;
+	Array<u8> src(bench.allocator);
+	src.resize(SIZE);
+	RandomGenerator rng(SEED_U, SEED_V);
+	for (u32 i = 0; i < SIZE;) {
+		const u32 run = minimum(1 + (rng.rand() & 31), SIZE - i);
+		const u8 v = u8(rng.rand());
+		const bool noise = (rng.rand() & 3) == 0;
+		for (u32 j = 0; j < run; ++j) src[i + j] = noise ? u8(rng.rand()) : v;
+		i += run;
+	}
+
+	Array<u8> compressed(bench.allocator);
+	compressed.resize(LZ4_compressBound(SIZE));
+	i32 compressed_size = 0;
+	bench.run("lz4_compress", SIZE, [&](){
+		compressed_size = LZ4_compress_default((const char*)src.begin(), (char*)compressed.begin(), SIZE, compressed.size());
+		g_sink += compressed_size;
+	});
+
+	Array<u8> decompressed(bench.allocator);
+	decompressed.resize(SIZE);
+	bench.run("lz4_decompress", SIZE, [&](){
+		const i32 res = LZ4_decompress_safe((const char*)compressed.begin(), (char*)decompressed.begin(), compressed_size, SIZE);
+		ASSERT(res == SIZE);
+		g_sink += res;
+	});
+}
+
+static void runAll(Bench& bench) {
+	printf("{\n\t\"benchmarks\": [");
+	benchArray(bench);
+	benchHashMap(bench);
+	benchRingBuffer(bench);
+	benchAllocators(bench);
+	benchJobs(bench);
+	benchSort(bench);
+	benchLZ4(bench);
+	printf("\n\t],\n\t\"workers\": %u\n}\n", (u32)jobs::getWorkersCount());
+}
+
+int main(int argc, char* argv[]) {
+	os::init();
+	DefaultAllocator allocator;
+	debug::init(allocator);
+	profiler::init(allocator);
+	jobs::init(os::getCPUsCount(), allocator);
+
+	struct Data {
+		Data(IAllocator& allocator) : bench(allocator), semaphore(0, 1) {}
+		Bench bench;
+		Semaphore semaphore;
+	} data(allocator);
+
+	char cmd_line[2048];
+	os::getCommandLine(Span(cmd_line));
+	CommandLineParser parser(cmd_line);
+	while (parser.next()) {
+		if (parser.currentEquals("-filter")) {
+			if (!parser.next()) break;
+			parser.getCurrent(data.bench.filter, sizeof(data.bench.filter));
+		}
+		else if (parser.currentEquals("-repeat")) {
+			if (!parser.next()) break;
+			char tmp[16];
+			parser.getCurrent(tmp, sizeof(tmp));
+			fromCString(tmp, data.bench.repeat);
+			data.bench.repeat = maximum(data.bench.repeat, 1u);
+		}
+	}
+
+	// job system functions must be called from a job
+	jobs::run(&data, [](void* ptr) {
+		Data* data = (Data*)ptr;
+		runAll(data->bench);
+		data->semaphore.signal();
+	}, nullptr, 0);
+	data.semaphore.wait();
+
+	jobs::shutdown();
+	profiler::shutdown();
+	debug::shutdown();
+	return 0;
+}
@@ -1,9 +1,14 @@
 #include "core/arena_allocator.h"
+#include "core/array.h"
 #include "core/atomic.h"
 #include "core/crt.h"
+#include "core/debug.h"
 #include "core/default_allocator.h"
+#include "core/hash_map.h"
 #include "core/math.h"
 #include "core/os.h"
+#include "core/span.h"
+#include "core/stack_tree.h"
 #include "core/tag_allocator.h"
 #if !defined __linux__ && defined __clang__
 	#include <intrin.h>
@@ -83,6 +88,75 @@ void* ArenaAllocator::reallocate(void* ptr, size_t new_size, size_t old_size, si
 	return nullptr;
 }
 
+static constexpr u32 FRAME_ARENA_BLOCK_SIZE = 64 * 1024;
+// generations are unique across all frame arenas, so a new arena at the same address can not reuse stale block
+static AtomicI32 g_frame_arena_generation = 1;
+
+// thread local block of a frame arena, a thread can use several arenas at once (e.g. frames in flight)
+struct FrameArenaBlock {
+	const FrameArena* arena = nullptr;
+	i32 generation = 0;
+	u8* ptr = nullptr;
+	u8* end = nullptr;
+};
+
+static thread_local FrameArenaBlock t_frame_arena_blocks[4];
+
+FrameArena::FrameArena(u32 reserved, IAllocator& parent, const char* tag)
+	: m_arena(reserved, parent, tag)
+	, m_generation(g_frame_arena_generation.inc())
+{}
+
+void FrameArena::reset() {
+	m_generation = g_frame_arena_generation.inc();
+	m_arena.reset();
+}
+
+void* FrameArena::allocate(size_t size, size_t align) {
+	if (size > FRAME_ARENA_BLOCK_SIZE / 4) return m_arena.allocate(size, align);
+
+	const i32 generation = m_generation;
+	FrameArenaBlock* block = nullptr;
+	for (FrameArenaBlock& b : t_frame_arena_blocks) {
+		if (b.arena == this) {
+			block = &b;
+			break;
+		}
+	}
+	if (!block) {
+		// evict some other arena's block, it just wastes the rest of that block
+		block = &t_frame_arena_blocks[0];
+		for (FrameArenaBlock& b : t_frame_arena_blocks) {
+			if (b.generation < block->generation) block = &b;
+		}
+		block->arena = this;
+		block->generation = 0;
+	}
+
+	if (block->generation == generation) {
+		u8* ptr = (u8*)(((uintptr)block->ptr + align - 1) & ~(uintptr)(align - 1));
+		if (ptr + size <= block->end) {
+			block->ptr = ptr + size;
+			return ptr;
+		}
+	}
+
+	u8* mem = (u8*)m_arena.allocate(FRAME_ARENA_BLOCK_SIZE, 16);
+	block->generation = generation;
+	block->end = mem + FRAME_ARENA_BLOCK_SIZE;
+	u8* ptr = (u8*)(((uintptr)mem + align - 1) & ~(uintptr)(align - 1));
+	block->ptr = ptr + size;
+	return ptr;
+}
+
+void FrameArena::deallocate(void* ptr) { /*everything should be "deallocated" with reset()*/ }
+void* FrameArena::reallocate(void* ptr, size_t new_size, size_t old_size, size_t align) { 
+	if (!ptr) return allocate(new_size, align);
+	// realloc not supported
+	ASSERT(false); 
+	return nullptr;
+}
+
 TagAllocator::TagAllocator(IAllocator& allocator, const char* tag_name)
 	: m_tag(tag_name)
 {
@@ -94,8 +168,119 @@ TagAllocator::TagAllocator(IAllocator& allocator, const char* tag_name)
 
 thread_local TagAllocator* active_allocator = nullptr;
 
+namespace debug {
+
+static struct AllocationSampler {
+	struct Site {
+		AllocationSample sample;
+		const char* tag_ptr;
+		i32 next; // next site with the same callstack but different tag
+	};
+
+	// allocated lazily, the sampler is used before debug::init and after debug::shutdown
+	struct Data {
+		Data(IAllocator& allocator)
+			: stack_tree(allocator)
+			, sites(allocator)
+			, site_map(allocator)
+		{}
+
+		StackTree stack_tree;
+		Array<Site> sites;
+		HashMap<StackNode*, i32> site_map;
+	};
+
+	volatile bool enabled = false;
+	u32 sample_bytes = 64 * 1024;
+	AtomicI64 sampled_bytes = 0;
+	Mutex mutex;
+	Data* data = nullptr;
+} g_allocation_sampler;
+
+thread_local i64 bytes_to_next_sample = 0;
+thread_local bool is_sampling = false;
+
+static void sampleAllocation(const TagAllocator& tag, size_t size) {
+	bytes_to_next_sample -= (i64)size;
+	if (bytes_to_next_sample > 0) return;
+	// allocations made by the sampler itself
+	if (is_sampling) return;
+
+	AllocationSampler& sampler = g_allocation_sampler;
+	u32 samples = 0;
+	while (bytes_to_next_sample <= 0) {
+		bytes_to_next_sample += sampler.sample_bytes;
+		++samples;
+	}
+
+	is_sampling = true;
+	MutexGuard guard(sampler.mutex);
+	if (sampler.data) {
+		const u64 bytes = u64(samples) * sampler.sample_bytes;
+		sampler.sampled_bytes.add(bytes);
+		StackNode* leaf = sampler.data->stack_tree.record();
+		auto iter = sampler.data->site_map.find(leaf);
+		i32 idx = iter.isValid() ? iter.value() : -1;
+		while (idx >= 0 && sampler.data->sites[idx].tag_ptr != tag.m_tag) idx = sampler.data->sites[idx].next;
+		if (idx < 0) {
+			AllocationSampler::Site& site = sampler.data->sites.emplace();
+			site.sample.tag = tag.m_tag;
+			site.sample.stack_leaf = leaf;
+			site.sample.bytes = 0;
+			site.sample.samples = 0;
+			site.tag_ptr = tag.m_tag;
+			site.next = iter.isValid() ? iter.value() : -1;
+			idx = sampler.data->sites.size() - 1;
+			if (iter.isValid()) iter.value() = idx;
+			else sampler.data->site_map.insert(leaf, idx);
+		}
+		sampler.data->sites[idx].sample.bytes += bytes;
+		sampler.data->sites[idx].sample.samples += samples;
+	}
+	is_sampling = false;
+}
+
+void enableAllocationSampling(bool enable, u32 sample_bytes) {
+	AllocationSampler& sampler = g_allocation_sampler;
+	MutexGuard guard(sampler.mutex);
+	sampler.sample_bytes = maximum(sample_bytes, 1u);
+	// not a tag allocator, so the sampler's own allocations are not sampled
+	if (enable && !sampler.data) sampler.data = LUMIX_NEW(getGlobalAllocator(), AllocationSampler::Data)(getGlobalAllocator());
+	sampler.enabled = enable;
+}
+
+bool isAllocationSamplingEnabled() {
+	return g_allocation_sampler.enabled;
+}
+
+void resetAllocationSamples() {
+	AllocationSampler& sampler = g_allocation_sampler;
+	MutexGuard guard(sampler.mutex);
+	sampler.sampled_bytes = 0;
+	if (!sampler.data) return;
+	// keep the stack tree, nodes are shared by all samples and it's append-only
+	sampler.data->sites.clear();
+	sampler.data->site_map.clear();
+}
+
+u64 getSampledBytes() {
+	return g_allocation_sampler.sampled_bytes;
+}
+
+u32 getAllocationSamples(Span<AllocationSample> out) {
+	AllocationSampler& sampler = g_allocation_sampler;
+	MutexGuard guard(sampler.mutex);
+	if (!sampler.data) return 0;
+	const u32 count = minimum(out.length(), sampler.data->sites.size());
+	for (u32 i = 0; i < count; ++i) out[i] = sampler.data->sites[i].sample;
+	return sampler.data->sites.size();
+}
+
+} // namespace debug
+
 void* TagAllocator::allocate(size_t size, size_t align) {
 	active_allocator = this;
+	if (debug::g_allocation_sampler.enabled) debug::sampleAllocation(*this, size);
 	return m_effective_allocator->allocate(size, align);
 }
 
@@ -105,6 +290,7 @@ void TagAllocator::deallocate(void* ptr) {
 
 void* TagAllocator::reallocate(void* ptr, size_t new_size, size_t old_size, size_t align) {
 	active_allocator = this;
+	if (debug::g_allocation_sampler.enabled && new_size > old_size) debug::sampleAllocation(*this, new_size);
 	return m_effective_allocator->reallocate(ptr, new_size, old_size, align);
 }
 
@@ -38,5 +38,24 @@ private:
 	#endif
 };
 
+// same use case as ArenaAllocator, but each thread bumps its own block, taken in bulk from ArenaAllocator
+// so there's no atomic operation on shared cache line in the common case 
+// big allocations go directly to the underlying arena
+struct LUMIX_CORE_API FrameArena : IAllocator {
+	FrameArena(u32 reserved, IAllocator& parent, const char* tag);
+
+	// rewinds blocks of all threads
+	void reset();
+	void* allocate(size_t size, size_t align) override;
+	void deallocate(void* ptr) override;
+	void* reallocate(void* ptr, size_t new_size, size_t old_size, size_t align) override;
+	ArenaAllocator& getArena() { return m_arena; }
+
+private:
+	ArenaAllocator m_arena;
+	// thread blocks with different generation are stale, changed in every reset()
+	AtomicI32 m_generation;
+};
+
 
 } // namespace Lumix
@@ -25,6 +25,26 @@ struct CommandLineParser {
 		return false;
 	}
 
+	// value of `-option value`, `value` is not changed if the option is not on the command line
+	static bool getValue(const char* option, u32& value) {
+		char tmp[4096];
+		if (!os::getCommandLine(Span(tmp))) return false;
+
+		CommandLineParser parser(tmp);
+		while (parser.next()) {
+			if (!parser.currentEquals(option)) continue;
+			if (!parser.next()) return false;
+			char str[32];
+			parser.getCurrent(str, sizeof(str));
+			u32 parsed;
+			if (!fromCString(str, parsed)) return false;
+			value = parsed;
+			return true;
+		}
+
+		return false;
+	}
+
 
 	explicit CommandLineParser(const char* cmd_line)
 		: m_cmd_line(cmd_line)
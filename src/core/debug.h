@@ -4,6 +4,7 @@
 #include "allocator.h"
 #include "atomic.h"
 #include "core.h"
+#include "string.h"
 #include "sync.h"
 
 
@@ -62,6 +63,24 @@ LUMIX_CORE_API void checkGuards();
 LUMIX_CORE_API const AllocationInfo* lockAllocationInfos();
 LUMIX_CORE_API void unlockAllocationInfos();
 
+// sampling allocation profiler, works in release builds too
+// allocations through TagAllocator take a callstack every `sample_bytes` allocated bytes (counted per thread)
+// and samples are aggregated by tag and callstack; sizes are estimates, i.e. number of samples * sample_bytes
+struct AllocationSample {
+	StaticString<64> tag;
+	StackNode* stack_leaf;
+	u64 bytes;
+	u32 samples;
+};
+
+LUMIX_CORE_API void enableAllocationSampling(bool enable, u32 sample_bytes = 64 * 1024);
+LUMIX_CORE_API bool isAllocationSamplingEnabled();
+LUMIX_CORE_API void resetAllocationSamples();
+// estimated bytes allocated through tag allocators since the last reset
+LUMIX_CORE_API u64 getSampledBytes();
+// returns number of sites, can be larger than out.length()
+LUMIX_CORE_API u32 getAllocationSamples(Span<AllocationSample> out);
+
 
 struct LUMIX_CORE_API Allocator final : IAllocator {
 	explicit Allocator(IAllocator& source);
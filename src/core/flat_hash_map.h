@@ -0,0 +1,484 @@
+#pragma once
+
+
+#include "allocator.h"
+#include "core.h"
+#include "crt.h"
+#include "hash_map.h"
+
+#if defined _M_X64 || defined __SSE2__
+	#define LUMIX_FLAT_HASH_MAP_SSE2
+	#include <emmintrin.h>
+#elif defined __ARM_NEON
+	#define LUMIX_FLAT_HASH_MAP_NEON
+	#include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+
+namespace Lumix
+{
+
+
+// open addressing hash map with the same interface as HashMap
+// each slot has a control byte, 7 bits of hash for full slots, or EMPTY / DELETED
+// lookup compares 16 control bytes at once, so usually only one key comparison is needed
+// keys and values are stored inline, iterators and pointers are invalidated by insert
+template<typename Key, typename Value, typename Hasher = HashFunc<Key>>
+struct FlatHashMap
+{
+private:
+	static constexpr u32 GROUP_SIZE = 16;
+	static constexpr u8 EMPTY = 0x80;
+	static constexpr u8 DELETED = 0xFE;
+
+	struct Slot {
+		alignas(Key) u8 key_mem[sizeof(Key)];
+		alignas(Value) u8 value_mem[sizeof(Value)];
+
+		Value& value() { return *(Value*)value_mem; }
+		Key& key() { return *(Key*)key_mem; }
+		const Value& value() const { return *(Value*)value_mem; }
+		const Key& key() const { return *(Key*)key_mem; }
+	};
+
+	static bool isFull(u8 ctrl) { return (ctrl & 0x80) == 0; }
+
+	static u32 firstBit(u32 mask) {
+		ASSERT(mask);
+		#ifdef _MSC_VER
+			unsigned long res;
+			_BitScanForward(&res, mask);
+			return res;
+		#else
+			return __builtin_ctz(mask);
+		#endif
+	}
+
+	// bit i is set if ctrl[i] == value
+	static u32 matchGroup(const u8* ctrl, u8 value) {
+		#if defined LUMIX_FLAT_HASH_MAP_SSE2
+			const __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+			return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)value)));
+		#elif defined LUMIX_FLAT_HASH_MAP_NEON
+			static const u8 bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+			const uint8x16_t eq = vandq_u8(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(value)), vld1q_u8(bits));
+			return vaddv_u8(vget_low_u8(eq)) | (vaddv_u8(vget_high_u8(eq)) << 8);
+		#else
+			u32 res = 0;
+			for (u32 i = 0; i < GROUP_SIZE; ++i) {
+				if (ctrl[i] == value) res |= 1 << i;
+			}
+			return res;
+		#endif
+	}
+
+	// bit i is set if ctrl[i] is EMPTY or DELETED
+	static u32 matchNotFull(const u8* ctrl) {
+		#if defined LUMIX_FLAT_HASH_MAP_SSE2
+			return (u32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+		#elif defined LUMIX_FLAT_HASH_MAP_NEON
+			static const u8 bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+			const uint8x16_t high = vandq_u8(vcltq_s8(vreinterpretq_s8_u8(vld1q_u8(ctrl)), vdupq_n_s8(0)), vld1q_u8(bits));
+			return vaddv_u8(vget_low_u8(high)) | (vaddv_u8(vget_high_u8(high)) << 8);
+		#else
+			u32 res = 0;
+			for (u32 i = 0; i < GROUP_SIZE; ++i) {
+				if (!isFull(ctrl[i])) res |= 1 << i;
+			}
+			return res;
+		#endif
+	}
+
+	template <typename HM, typename K, typename V>
+	struct IteratorBase {
+		HM* hm;
+		u32 idx;
+
+		template <typename HM2, typename K2, typename V2>
+		bool operator !=(const IteratorBase<HM2, K2, V2>& rhs) const {
+			ASSERT(hm == rhs.hm);
+			return idx != rhs.idx;
+		}
+
+		template <typename HM2, typename K2, typename V2>
+		bool operator ==(const IteratorBase<HM2, K2, V2>& rhs) const {
+			ASSERT(hm == rhs.hm);
+			return idx == rhs.idx;
+		}
+
+		void operator++() {
+			const u8* ctrl = hm->m_ctrl;
+			for (u32 i = idx + 1, c = hm->m_capacity; i < c; ++i) {
+				if (isFull(ctrl[i])) {
+					idx = i;
+					return;
+				}
+			}
+			idx = hm->m_capacity;
+		}
+
+		K& key() {
+			ASSERT(isFull(hm->m_ctrl[idx]));
+			return hm->m_slots[idx].key();
+		}
+
+		const V& value() const {
+			ASSERT(isFull(hm->m_ctrl[idx]));
+			return hm->m_slots[idx].value();
+		}
+
+		V& value() {
+			ASSERT(isFull(hm->m_ctrl[idx]));
+			return hm->m_slots[idx].value();
+		}
+
+		V& operator*() {
+			ASSERT(isFull(hm->m_ctrl[idx]));
+			return hm->m_slots[idx].value();
+		}
+
+		bool isValid() const { return idx != hm->m_capacity; }
+	};
+
+public:
+	using Iterator = IteratorBase<FlatHashMap, Key, Value>;
+	using ConstIterator = IteratorBase<const FlatHashMap, const Key, const Value>;
+
+	explicit FlatHashMap(IAllocator& allocator)
+		: m_allocator(allocator)
+	{
+	}
+
+	FlatHashMap(u32 size, IAllocator& allocator)
+		: m_allocator(allocator)
+	{
+		init(size);
+	}
+
+	FlatHashMap(FlatHashMap&& rhs)
+		: m_allocator(rhs.m_allocator)
+	{
+		m_slots = rhs.m_slots;
+		m_ctrl = rhs.m_ctrl;
+		m_capacity = rhs.m_capacity;
+		m_size = rhs.m_size;
+		m_growth_left = rhs.m_growth_left;
+
+		rhs.m_slots = nullptr;
+		rhs.m_ctrl = nullptr;
+		rhs.m_capacity = 0;
+		rhs.m_size = 0;
+		rhs.m_growth_left = 0;
+	}
+
+	~FlatHashMap() {
+		destroyAll();
+		m_allocator.deallocate(m_slots);
+	}
+
+	FlatHashMap&& move() {
+		return static_cast<FlatHashMap&&>(*this);
+	}
+
+	void operator =(FlatHashMap&& rhs) = delete;
+
+	struct Iterated {
+		struct IteratorProxy {
+			Iterator inner;
+
+			bool operator != (const IteratorProxy& rhs) const { return rhs.inner != inner; }
+			Iterator operator*() { return inner; }
+			void operator ++() { ++inner; }
+		};
+
+		IteratorProxy begin() { return {hm.begin()}; }
+		IteratorProxy end() { return {hm.end()}; }
+
+		FlatHashMap& hm;
+	};
+
+	// for easy access to both key and value during iteration
+	// usage: for (auto iter : hashmap.iterated()) logInfo(iter.key(), iter.value())
+	Iterated iterated() { return {*this}; }
+
+	Iterator begin() {
+		for (u32 i = 0, c = m_capacity; i < c; ++i) {
+			if (isFull(m_ctrl[i])) return { this, i };
+		}
+		return { this, m_capacity };
+	}
+
+	ConstIterator begin() const {
+		for (u32 i = 0, c = m_capacity; i < c; ++i) {
+			if (isFull(m_ctrl[i])) return { this, i };
+		}
+		return { this, m_capacity };
+	}
+
+	Iterator end() { return Iterator { this, m_capacity }; }
+	ConstIterator end() const { return ConstIterator { this, m_capacity }; }
+
+	void clear() {
+		destroyAll();
+		if (m_capacity > 0) {
+			memset(m_ctrl, EMPTY, m_capacity + GROUP_SIZE);
+			m_growth_left = maxLoad(m_capacity);
+		}
+		m_size = 0;
+	}
+
+	ConstIterator find(const Key& key) const {
+		return { this, findPos(key) };
+	}
+
+	Iterator find(const Key& key) {
+		return { this, findPos(key) };
+	}
+
+	template <typename K>
+	Iterator find(const K& key) {
+		return { this, findPos(key) };
+	}
+
+	const Value* getFromIndex(u32 index) const {
+		if (!isFull(m_ctrl[index])) return nullptr;
+		return &m_slots[index].value();
+	}
+
+	Value* getFromIndex(u32 index) {
+		if (!isFull(m_ctrl[index])) return nullptr;
+		return &m_slots[index].value();
+	}
+
+	Value& operator[](const Key& key) {
+		const u32 pos = findPos(key);
+		ASSERT(pos < m_capacity);
+		return m_slots[pos].value();
+	}
+
+	const Value& operator[](const Key& key) const {
+		const u32 pos = findPos(key);
+		ASSERT(pos < m_capacity);
+		return m_slots[pos].value();
+	}
+
+	Value& insert(const Key& key) {
+		auto iter = insert(key, {});
+		return iter.value();
+	}
+
+	Value& insert(Key&& key) {
+		auto iter = insert(static_cast<Key&&>(key), {m_allocator});
+		return iter.value();
+	}
+
+	// same as in HashMap, key must not be already in the map
+	Iterator insert(const Key& key, Value&& value) {
+		const u32 hash = Hasher::get(key);
+		const u32 pos = prepareInsert(hash);
+		new (NewPlaceholder(), m_slots[pos].key_mem) Key(key);
+		new (NewPlaceholder(), m_slots[pos].value_mem) Value(static_cast<Value&&>(value));
+		return { this, pos };
+	}
+
+	Iterator insert(Key&& key, Value&& value) {
+		const u32 hash = Hasher::get(key);
+		const u32 pos = prepareInsert(hash);
+		new (NewPlaceholder(), m_slots[pos].key_mem) Key(static_cast<Key&&>(key));
+		new (NewPlaceholder(), m_slots[pos].value_mem) Value(static_cast<Value&&>(value));
+		return { this, pos };
+	}
+
+	Iterator insert(const Key& key, const Value& value) {
+		const u32 hash = Hasher::get(key);
+		const u32 pos = prepareInsert(hash);
+		new (NewPlaceholder(), m_slots[pos].key_mem) Key(key);
+		new (NewPlaceholder(), m_slots[pos].value_mem) Value(value);
+		return { this, pos };
+	}
+
+	template <typename F>
+	void eraseIf(F predicate) {
+		for (u32 i = 0; i < m_capacity; ++i) {
+			if (!isFull(m_ctrl[i])) continue;
+			if (predicate(m_slots[i].value())) erase(Iterator{this, i});
+		}
+	}
+
+	void erase(const Iterator& key) {
+		ASSERT(key.isValid());
+
+		const u32 pos = key.idx;
+		m_slots[pos].key().~Key();
+		m_slots[pos].value().~Value();
+		--m_size;
+
+		// if there's an empty slot in both directions within a group, no probe sequence could have
+		// passed through this slot while looking for the key, so it can be marked as empty
+		const u32 mask = m_capacity - 1;
+		const u32 empty_after = matchGroup(&m_ctrl[pos], EMPTY);
+		const u32 empty_before = matchGroup(&m_ctrl[(pos - GROUP_SIZE) & mask], EMPTY);
+		const u32 leading = empty_before ? GROUP_SIZE - 1 - lastBit(empty_before) : GROUP_SIZE;
+		const u32 trailing = empty_after ? firstBit(empty_after) : GROUP_SIZE;
+		if (leading + trailing < GROUP_SIZE) {
+			setCtrl(pos, EMPTY);
+			++m_growth_left;
+		}
+		else {
+			setCtrl(pos, DELETED);
+		}
+	}
+
+	template <typename K>
+	void erase(const K& key) {
+		const u32 pos = findPos(key);
+		if (pos < m_capacity) erase(Iterator{this, pos});
+	}
+
+	void erase(const Key& key) {
+		const u32 pos = findPos(key);
+		if (pos < m_capacity) erase(Iterator{this, pos});
+	}
+
+	bool empty() const { return m_size == 0; }
+	u32 size() const { return m_size; }
+	u32 capacity() const { return m_capacity; }
+
+	// reserve space for `new_size` elements without rehashing
+	void reserve(u32 new_size) {
+		u32 capacity = GROUP_SIZE;
+		while (maxLoad(capacity) < new_size) capacity <<= 1;
+		if (capacity > m_capacity) rehash(capacity);
+	}
+
+private:
+	static u32 lastBit(u32 mask) {
+		ASSERT(mask);
+		#ifdef _MSC_VER
+			unsigned long res;
+			_BitScanReverse(&res, mask);
+			return res;
+		#else
+			return 31 - __builtin_clz(mask);
+		#endif
+	}
+
+	// 7/8 load factor, groups make long probe sequences cheap
+	static u32 maxLoad(u32 capacity) { return capacity - capacity / 8; }
+
+	static u8 getH2(u32 hash) { return u8(hash & 0x7f); }
+	static u32 getH1(u32 hash) { return hash >> 7; }
+
+	// first GROUP_SIZE control bytes are mirrored after the last one, so a group can be loaded from any position
+	void setCtrl(u32 pos, u8 value) {
+		m_ctrl[pos] = value;
+		if (pos < GROUP_SIZE) m_ctrl[m_capacity + pos] = value;
+	}
+
+	void destroyAll() {
+		for (u32 i = 0, c = m_capacity; i < c; ++i) {
+			if (!isFull(m_ctrl[i])) continue;
+			m_slots[i].key().~Key();
+			m_slots[i].value().~Value();
+		}
+	}
+
+	// find free slot for element with `hash` and mark it as used
+	u32 prepareInsert(u32 hash) {
+		if (m_capacity == 0) rehash(GROUP_SIZE);
+		u32 pos = findNotFull(hash);
+		if (m_growth_left == 0 && m_ctrl[pos] == EMPTY) {
+			// if map is full of tombstones, rehash in place, otherwise grow
+			rehash(m_size * 2 >= maxLoad(m_capacity) ? m_capacity << 1 : m_capacity);
+			pos = findNotFull(hash);
+		}
+		if (m_ctrl[pos] == EMPTY) --m_growth_left;
+		setCtrl(pos, getH2(hash));
+		++m_size;
+		return pos;
+	}
+
+	u32 findNotFull(u32 hash) const {
+		const u32 mask = m_capacity - 1;
+		u32 pos = getH1(hash) & mask;
+		for (u32 step = GROUP_SIZE;; step += GROUP_SIZE) {
+			const u32 free = matchNotFull(&m_ctrl[pos]);
+			if (free) return (pos + firstBit(free)) & mask;
+			pos = (pos + step) & mask;
+		}
+	}
+
+	void rehash(u32 new_capacity) {
+		Slot* old_slots = m_slots;
+		u8* old_ctrl = m_ctrl;
+		const u32 old_capacity = m_capacity;
+
+		init(new_capacity);
+		for (u32 i = 0; i < old_capacity; ++i) {
+			if (!isFull(old_ctrl[i])) continue;
+
+			Slot& old = old_slots[i];
+			const u32 hash = Hasher::get(old.key());
+			const u32 pos = findNotFull(hash);
+			setCtrl(pos, getH2(hash));
+			new (NewPlaceholder(), m_slots[pos].key_mem) Key(static_cast<Key&&>(old.key()));
+			new (NewPlaceholder(), m_slots[pos].value_mem) Value(static_cast<Value&&>(old.value()));
+			old.key().~Key();
+			old.value().~Value();
+			++m_size;
+		}
+		m_growth_left -= m_size;
+		m_allocator.deallocate(old_slots);
+	}
+
+	template <typename K>
+	u32 findPos(const K& key, u32 hash) const {
+		if (m_capacity == 0) return 0;
+		const u32 mask = m_capacity - 1;
+		const u8 h2 = getH2(hash);
+		u32 pos = getH1(hash) & mask;
+		for (u32 step = GROUP_SIZE;; step += GROUP_SIZE) {
+			const u8* group = &m_ctrl[pos];
+			u32 match = matchGroup(group, h2);
+			while (match) {
+				const u32 idx = (pos + firstBit(match)) & mask;
+				if (m_slots[idx].key() == key) return idx;
+				match &= match - 1;
+			}
+			if (matchGroup(group, EMPTY)) return m_capacity;
+			pos = (pos + step) & mask;
+		}
+	}
+
+	u32 findPos(const Key& key) const { return findPos(key, Hasher::get(key)); }
+
+	template <typename K>
+	u32 findPos(const K& key) const { return findPos(key, HashFunc<K>::get(key)); }
+
+	// slots and control bytes are in one allocation
+	void init(u32 capacity) {
+		const bool is_pow_2 = capacity && !(capacity & (capacity - 1));
+		ASSERT(is_pow_2);
+		if (capacity < GROUP_SIZE) capacity = GROUP_SIZE;
+		m_size = 0;
+		m_capacity = capacity;
+		m_growth_left = maxLoad(capacity);
+		m_slots = (Slot*)m_allocator.allocate(sizeof(Slot) * capacity + capacity + GROUP_SIZE, alignof(Slot));
+		m_ctrl = (u8*)(m_slots + capacity);
+		memset(m_ctrl, EMPTY, capacity + GROUP_SIZE);
+	}
+
+	IAllocator& m_allocator;
+	Slot* m_slots = nullptr;
+	u8* m_ctrl = nullptr;
+	u32 m_capacity = 0;
+	u32 m_size = 0;
+	u32 m_growth_left = 0;
+};
+
+
+} // namespace Lumix
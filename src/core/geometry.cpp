@@ -251,34 +251,22 @@ Sphere Frustum::computeBoundingSphere() const
 
 bool Frustum::isSphereInside(const Vec3& center, float radius) const
 {
-	float4 px = f4Load(xs);
-	float4 py = f4Load(ys);
-	float4 pz = f4Load(zs);
-	float4 pd = f4Load(ds);
-
-	float4 cx = f4Splat(center.x);
-	float4 cy = f4Splat(center.y);
-	float4 cz = f4Splat(center.z);
-
-	float4 t = f4Mul(cx, px);
-	t = f4Add(t, f4Mul(cy, py));
-	t = f4Add(t, f4Mul(cz, pz));
-	t = f4Add(t, pd);
-	t = f4Sub(t, f4Splat(-radius));
-	if (f4MoveMask(t)) return false;
-
-	px = f4Load(&xs[4]);
-	py = f4Load(&ys[4]);
-	pz = f4Load(&zs[4]);
-	pd = f4Load(&ds[4]);
-
-	t = f4Mul(cx, px);
-	t = f4Add(t, f4Mul(cy, py));
-	t = f4Add(t, f4Mul(cz, pz));
-	t = f4Add(t, pd);
-	t = f4Sub(t, f4Splat(-radius));
-	
-	return f4MoveMask(t) == 0;
+	// frustum is only 16B aligned
+	const float8 px = f8LoadUnaligned(xs);
+	const float8 py = f8LoadUnaligned(ys);
+	const float8 pz = f8LoadUnaligned(zs);
+	const float8 pd = f8LoadUnaligned(ds);
+
+	const float8 cx = f8Splat(center.x);
+	const float8 cy = f8Splat(center.y);
+	const float8 cz = f8Splat(center.z);
+
+	float8 t = f8Mul(cx, px);
+	t = f8Add(t, f8Mul(cy, py));
+	t = f8Add(t, f8Mul(cz, pz));
+	t = f8Add(t, pd);
+	t = f8Sub(t, f8Splat(-radius));
+	return f8MoveMask(t) == 0;
 }
 
 
@@ -3,6 +3,9 @@
 #include "core/atomic.h"
 #include "core/color.h"
 #include "core/fibers.h"
+#include "core/log.h"
+#include "core/math.h"
+#include "core/os.h"
 #include "core/profiler.h"
 #include "core/ring_buffer.h"
 #include "core/string.h"
@@ -13,13 +16,18 @@
 
 /* 
 There are three types of queues:
-	1. Work Stealing Queue - Each worker has its own. Jobs can only be pushed by the worker itself but can be consumed by any worker.
+	1. Work Stealing Queue - Each worker has one per priority. Jobs can only be pushed by the worker itself but can be consumed by any worker.
 	2. Worker Queue - Each worker has its own queue for jobs pinned to that worker.
 		Jobs in this queue are executed only by the owning worker.
 		Any thread, including those outside the job system, can push jobs to this queue.
-	3. Global Queue - A single global queue where jobs can be executed by any worker (unlike queue 2.).
+	3. Global Queue - One global queue per priority where jobs can be executed by any worker (unlike queue 2.).
 		Any thread, including those outside the job system, can push jobs to this queue (unlike queue 1.).
 
+Priorities:
+	* Worker queues are checked first, then all queues (own WSQ, steal, global) of HIGH priority, then NORMAL, then BACKGROUND.
+	* So a background job is popped only if a worker does not see any other job waiting. 
+	* Running jobs are not preempted, long background jobs should be split into smaller ones.
+
 Invariants:
 	* Jobs are executed in undefined order, i.e. if we push jobs A and B, we can't be sure that A will be executed before B. 
 	* tryPop in sequence "push(), tryPop()" is guaranteed to pop a job. The consumer in this case can be on a different thread, if we are sure that push() returned.
@@ -35,15 +43,24 @@ struct Job {
 	void* data = nullptr;
 	Counter* dec_on_finish;
 	u8 worker_index;
+	Priority priority = Priority::NORMAL;
+	bool large_stack = false;
 };
 
+static constexpr u32 PRIORITY_COUNT = (u32)Priority::COUNT;
+
 struct WorkerTask;
 static constexpr u64 STATE_COUNTER_MASK = 0xffFF;
 static constexpr u64 STATE_WAITING_FIBER_MASK = (~u64(0)) & ~STATE_COUNTER_MASK;
 
+struct FiberPool;
+
 struct FiberJobPair {
 	Fiber::Handle fiber = Fiber::INVALID_FIBER;
 	Job current_job;
+	// passed by the fiber which switched to us, executed before we pop any other work
+	Job handoff;
+	FiberPool* pool = nullptr;
 };
 
 #ifdef _WIN32
@@ -52,6 +69,56 @@ struct FiberJobPair {
 	static void manage(void* data);
 #endif
 
+// fibers are allocated in blocks, blocks are not freed or moved until shutdown, since there are pointers to fibers in the queues
+struct FiberPool {
+	struct Block {
+		FiberJobPair* fibers;
+		u32 count;
+	};
+
+	FiberPool(IAllocator& allocator)
+		: allocator(allocator)
+		, free_fibers(allocator)
+		, blocks(allocator)
+	{}
+
+	~FiberPool() {
+		for (const Block& block : blocks) {
+			for (u32 i = 0; i < block.count; ++i) {
+				if (Fiber::isValid(block.fibers[i].fiber)) Fiber::destroy(block.fibers[i].fiber);
+			}
+			allocator.deallocate(block.fibers);
+		}
+	}
+
+	// returns one fiber from the new block, the rest is pushed to free fibers
+	FiberJobPair* grow(u32 count) {
+		FiberJobPair* fibers = (FiberJobPair*)allocator.allocate(sizeof(FiberJobPair) * count, alignof(FiberJobPair));
+		for (u32 i = 0; i < count; ++i) {
+			new (NewPlaceholder(), &fibers[i]) FiberJobPair;
+			fibers[i].pool = this;
+		}
+		{
+			Lumix::MutexGuard guard(mutex);
+			blocks.push({fibers, count});
+		}
+		size.add(count);
+		for (u32 i = 1; i < count; ++i) free_fibers.push(&fibers[i]);
+		return &fibers[0];
+	}
+
+	IAllocator& allocator;
+	RingBuffer<FiberJobPair*, 512> free_fibers;
+	Lumix::Mutex mutex;
+	Array<Block> blocks; // only access while holding mutex
+	u32 stack_size = 64 * 1024;
+	u32 grow_count = 16;
+	bool large = false;
+	AtomicI32 size = 0;
+	AtomicI32 in_use = 0;
+	AtomicI32 high_water_mark = 0;
+};
+
 struct Work {
 	Work() : type(NONE) {}
 	Work(const Job& job) : job(job), type(JOB) {}
@@ -66,6 +133,8 @@ struct Work {
 		Job job;
 		FiberJobPair* fiber;
 	};
+
+	Priority getPriority() const { return type == FIBER ? fiber->current_job.priority : job.priority; }
 };
 
 LUMIX_FORCE_INLINE static void wake(WorkerTask& to_wake);
@@ -207,17 +276,21 @@ struct System {
 	System(IAllocator& allocator) 
 		: m_allocator(allocator, "job system")
 		, m_workers(m_allocator)
-		, m_free_fibers(m_allocator)
+		, m_small_fibers(m_allocator)
+		, m_large_fibers(m_allocator)
 		, m_sleeping_workers(m_allocator)
-		, m_global_queue(m_allocator)
-	{}
+		, m_global_queues{{m_allocator}, {m_allocator}, {m_allocator}}
+	{
+		static_assert(PRIORITY_COUNT == 3, "update m_global_queues initialization");
+	}
 
 	TagAllocator m_allocator;
 	Array<WorkerTask*> m_workers;
-	FiberJobPair m_fiber_pool[512];
-	RingBuffer<FiberJobPair*, 512> m_free_fibers;
-	WorkQueue m_global_queue; // non-worker threads must push here
+	FiberPool m_small_fibers;
+	FiberPool m_large_fibers; // for jobs started with runOnLargeStack
+	WorkQueue m_global_queues[PRIORITY_COUNT]; // non-worker threads must push here
 	AtomicI32 m_num_sleeping = 0; // if 0, we are sure that no worker is sleeping; if not 0, workers can be in any state
+	WorkerStats m_last_pushed_stats = {}; // totals at the last pushProfilerCounters call
 	Lumix::Mutex m_sleeping_sync;
 	Array<WorkerTask*> m_sleeping_workers; // only access while holding m_sleeping_sync
 };
@@ -242,16 +315,35 @@ WorkerTask* getWorker()
 	#pragma clang optimize on
 #endif
 
-LUMIX_FORCE_INLINE static FiberJobPair* popFreeFiber() {
+LUMIX_FORCE_INLINE static FiberJobPair* popFreeFiber(FiberPool& pool) {
 	FiberJobPair* new_fiber;
-	bool popped = g_system->m_free_fibers.pop(new_fiber);
-	ASSERT(popped);
+	if (!pool.free_fibers.pop(new_fiber)) {
+		// too many fibers are blocked in wait()
+		new_fiber = pool.grow(pool.grow_count);
+		logInfo("Job system: ", pool.large ? "large" : "small", " fiber pool grown to ", (i32)pool.size, " fibers");
+	}
+	
+	const i32 in_use = pool.in_use.inc() + 1;
+	for (;;) {
+		const i32 high_water_mark = pool.high_water_mark;
+		if (in_use <= high_water_mark || pool.high_water_mark.compareExchange(in_use, high_water_mark)) break;
+	}
+
 	if (!Fiber::isValid(new_fiber->fiber)) {
-		new_fiber->fiber = Fiber::create(64 * 1024, manage, new_fiber);
+		new_fiber->fiber = Fiber::create(pool.stack_size, manage, new_fiber);
 	}
 	return new_fiber;
 }
 
+LUMIX_FORCE_INLINE static FiberJobPair* popFreeFiber() {
+	return popFreeFiber(g_system->m_small_fibers);
+}
+
+LUMIX_FORCE_INLINE static void pushFreeFiber(FiberJobPair* fiber) {
+	fiber->pool->in_use.dec();
+	fiber->pool->free_fibers.push(fiber);
+}
+
 // intrusive linked list of fibers waiting on a signal/mutex
 struct WaitingFiber {
 	WaitingFiber* next;
@@ -276,6 +368,7 @@ struct WorkerTask : Thread {
 		, m_system(system)
 		, m_worker_index(worker_index)
 		, m_work_queue(system.m_allocator)
+		, m_steal_order(system.m_allocator)
 	{}
 
 	i32 task() override {
@@ -302,14 +395,21 @@ struct WorkerTask : Thread {
 
 	Signal* m_signal_to_check = nullptr;
 	WaitingFiber* m_waiting_fiber_to_push = nullptr;
+	// fiber we switched from, it's free, but we can't push it to free fibers before we switch away from it
+	FiberJobPair* m_fiber_to_free = nullptr;
 	i32 m_deferred_push_to_worker = -1;
 	
 	Fiber::Handle m_primary_fiber;
 	System& m_system;
 	WorkQueue m_work_queue; // for jobs that need to be pinned to a worker
-	WorkStealingQueue m_wsq;
+	WorkStealingQueue m_wsq[PRIORITY_COUNT];
 	u8 m_worker_index;
-	u8 m_last_steal_idx = 0; // index of the last worker we managed to steal from
+	u8 m_last_steal_idx[PRIORITY_COUNT] = {}; // index of the last worker we managed to steal from, per priority
+	Array<u8> m_steal_order; // other workers, the closest ones (sharing cache, NUMA node) first
+	CoreClass m_core_class = CoreClass::PERFORMANCE;
+	os::CPUCoreInfo m_cpu = {};
+	// written only by the worker's thread, other threads can read slightly stale values
+	WorkerStats m_stats = {};
 	
 	// if m_is_sleeping == 0, we are sure that we are not sleeping
 	// but if m_is_sleeping == 1, we are not sure if we are sleeping or not
@@ -320,7 +420,7 @@ struct WorkerTask : Thread {
 LUMIX_FORCE_INLINE static void scheduleFiber(FiberJobPair* fiber) {
 	const u8 worker_idx = fiber->current_job.worker_index;
 	if (worker_idx == ANY_WORKER) {
-		getWorker()->m_wsq.pushAndWake(fiber);
+		getWorker()->m_wsq[(u32)fiber->current_job.priority].pushAndWake(fiber);
 	} else {
 		WorkerTask* worker = g_system->m_workers[worker_idx % g_system->m_workers.size()];
 		worker->m_work_queue.pushAndWake(fiber, worker);
@@ -329,19 +429,21 @@ LUMIX_FORCE_INLINE static void scheduleFiber(FiberJobPair* fiber) {
 
 // try to steal a job from any other worker
 // we have to try all workers, otherwise we could miss a job
-LUMIX_FORCE_INLINE static bool trySteal(Work& work, WorkerTask* stealing_worker) {
+LUMIX_FORCE_INLINE static bool trySteal(Work& work, WorkerTask* stealing_worker, u32 priority) {
 	Array<WorkerTask*>& workers = g_system->m_workers;
 	const u32 num_workers = workers.size();	
-	const u32 start = stealing_worker->m_last_steal_idx;
-	for (u32 i = stealing_worker->m_last_steal_idx; i < num_workers; ++i) {
-		if (workers[i]->m_wsq.trySteal(work)) {
-			stealing_worker->m_last_steal_idx = i;
-			return true;
-		}
+	u8& last_steal_idx = stealing_worker->m_last_steal_idx[priority];
+	++stealing_worker->m_stats.steal_attempts;
+	// worker we stole from the last time is likely to have more jobs
+	if (last_steal_idx < num_workers && workers[last_steal_idx]->m_wsq[priority].trySteal(work)) {
+		++stealing_worker->m_stats.steals;
+		return true;
 	}
-	for (u32 i = 0; i < stealing_worker->m_last_steal_idx; ++i) {
-		if (workers[i]->m_wsq.trySteal(work)) {
-			stealing_worker->m_last_steal_idx = i;
+
+	for (u8 i : stealing_worker->m_steal_order) {
+		if (workers[i]->m_wsq[priority].trySteal(work)) {
+			last_steal_idx = i;
+			++stealing_worker->m_stats.steals;
 			return true;
 		}
 	}
@@ -349,19 +451,35 @@ LUMIX_FORCE_INLINE static bool trySteal(Work& work, WorkerTask* stealing_worker)
 }
 
 // try to pop a job from the queues
-LUMIX_FORCE_INLINE static bool tryPopWork(Work& work, WorkerTask* worker) {
+// if `take_others_high` is false, HIGH priority jobs are not taken from other workers and from the global queue
+// this is used to let workers on performance cores take these jobs first
+LUMIX_FORCE_INLINE static bool tryPopWork(Work& work, WorkerTask* worker, bool take_others_high) {
 	// jobs in worker's work queue are rare but usually in the critical path, so we need to try first
 	// try on empty queue is very fast
-	if (worker->m_work_queue.tryPop(work)) return true;
-	
-	// then try to pop a job from wsq first, since it's very fast
-	if (worker->m_wsq.tryPop(work)) return true;
-	
-	// then try to steal a job from other workers, this is slower than tryPop
-	if (trySteal(work, worker)) return true;
+	if (worker->m_work_queue.tryPop(work)) {
+		++worker->m_stats.worker_queue_pops;
+		return true;
+	}
 	
-	// it's very rare to have a job in the global queue, so we check it last
-	if (g_system->m_global_queue.tryPop(work)) return true;
+	// lower priority queues are checked only if all higher priority queues are empty
+	for (u32 priority = 0; priority < PRIORITY_COUNT; ++priority) {
+		// then try to pop a job from wsq first, since it's very fast
+		if (worker->m_wsq[priority].tryPop(work)) {
+			++worker->m_stats.local_pops;
+			return true;
+		}
+		
+		if (priority == (u32)Priority::HIGH && !take_others_high) continue;
+
+		// then try to steal a job from other workers, this is slower than tryPop
+		if (trySteal(work, worker, priority)) return true;
+		
+		// it's very rare to have a job in the global queue, so we check it last
+		if (g_system->m_global_queues[priority].tryPop(work)) {
+			++worker->m_stats.global_pops;
+			return true;
+		}
+	}
 
 	// no jobs to pop
 	return false;
@@ -373,7 +491,9 @@ LUMIX_FORCE_INLINE static bool tryPopWork(Work& work, WorkerTask* worker) {
 LUMIX_FORCE_INLINE static bool popWork(Work& work, WorkerTask* worker) {
 	while (!worker->m_finished) {
 		for (u32 i = 0; i < 20; ++i) {
-			if (tryPopWork(work, worker)) return true;
+			// efficiency cores take HIGH priority jobs from others only if nobody else took them in a while
+			const bool take_others_high = worker->m_core_class == CoreClass::PERFORMANCE || i >= 10;
+			if (tryPopWork(work, worker, take_others_high)) return true;
 		}
 
 		// no jobs, let's mark the worker as going to sleep / sleeping
@@ -383,7 +503,7 @@ LUMIX_FORCE_INLINE static bool popWork(Work& work, WorkerTask* worker) {
 		Lumix::MutexGuard guard(g_system->m_sleeping_sync);
 		
 		// we must recheck the queues while holding the mutex, because somebody might have pushed a job in the meantime
-		if (tryPopWork(work, worker)) {
+		if (tryPopWork(work, worker, true)) {
 			g_system->m_num_sleeping.dec();
 			worker->m_is_sleeping = 0;
 			return true;
@@ -397,7 +517,10 @@ LUMIX_FORCE_INLINE static bool popWork(Work& work, WorkerTask* worker) {
 		#endif
 
 		g_system->m_sleeping_workers.push(worker);
+		const u64 sleep_start = os::Timer::getRawTimestamp();
 		worker->sleep(g_system->m_sleeping_sync);
+		++worker->m_stats.sleeps;
+		worker->m_stats.sleep_ticks += os::Timer::getRawTimestamp() - sleep_start;
 		g_system->m_num_sleeping.dec();
 		worker->m_is_sleeping = 0;
 	}
@@ -413,13 +536,19 @@ LUMIX_FORCE_INLINE static bool popWork(Work& work, WorkerTask* worker) {
 static void afterSwitch() {
 	WorkerTask* worker = getWorker();
 	
+	if (worker->m_fiber_to_free) {
+		pushFreeFiber(worker->m_fiber_to_free);
+		worker->m_fiber_to_free = nullptr;
+	}
+
 	if (worker->m_deferred_push_to_worker >= 0) {
 		if (worker->m_deferred_push_to_worker != ANY_WORKER) {
 			WorkerTask* dst_worker = g_system->m_workers[worker->m_deferred_push_to_worker % g_system->m_workers.size()];
 			dst_worker->m_work_queue.pushAndWake(worker->m_waiting_fiber_to_push->fiber, dst_worker);
 		}
 		else {
-			g_system->m_global_queue.pushAndWake(worker->m_waiting_fiber_to_push->fiber, nullptr);
+			FiberJobPair* fiber = worker->m_waiting_fiber_to_push->fiber;
+			g_system->m_global_queues[(u32)fiber->current_job.priority].pushAndWake(fiber, nullptr);
 		}
 		worker->m_deferred_push_to_worker = -1;
 	}
@@ -531,6 +660,12 @@ LUMIX_FORCE_INLINE static void addCounter(Counter* counter, u32 value) {
 LUMIX_FORCE_INLINE static void executeJob(const Job& job) {
 	#ifdef LUMIX_PROFILE_JOBS
 		profiler::beginJob(job.dec_on_finish ? job.dec_on_finish->signal.generation : 0);
+		// normal priority jobs keep the default color
+		switch (job.priority) {
+			case Priority::HIGH: profiler::blockColor(Color(0xff, 0x90, 0x60, 0xff).abgr()); break;
+			case Priority::BACKGROUND: profiler::blockColor(Color(0x70, 0x90, 0xb0, 0xff).abgr()); break;
+			default: break;
+		}
 	#endif
 	job.task(job.data);
 	#ifdef LUMIX_PROFILE_JOBS
@@ -541,6 +676,20 @@ LUMIX_FORCE_INLINE static void executeJob(const Job& job) {
 	}
 }
 
+// continue on a free fiber from `pool`, it executes `job` first (if there's any), `this_fiber` is returned to its pool
+static void handOff(FiberJobPair* this_fiber, FiberPool& pool, const Job& job) {
+	WorkerTask* worker = getWorker();
+	FiberJobPair* new_fiber = popFreeFiber(pool);
+	new_fiber->handoff = job;
+	worker->m_current_fiber = new_fiber;
+	worker->m_fiber_to_free = this_fiber;
+
+	Fiber::switchTo(&this_fiber->fiber, new_fiber->fiber);
+	afterSwitch();
+
+	getWorker()->m_current_fiber = this_fiber;
+}
+
 #ifdef _WIN32
 	static void __stdcall manage(void* data)
 #else
@@ -554,12 +703,17 @@ LUMIX_FORCE_INLINE static void executeJob(const Job& job) {
 	WorkerTask* worker = getWorker();
 	while (!worker->m_finished) {
 		Work work;
-		if (!popWork(work, worker)) break;
+		if (this_fiber->handoff.task) {
+			work = Work(this_fiber->handoff);
+			this_fiber->handoff.task = nullptr;
+		}
+		else if (!popWork(work, worker)) break;
 
 		if (work.type == Work::FIBER) {
 			worker->m_current_fiber = work.fiber;
+			++worker->m_stats.fiber_resumes;
 
-			g_system->m_free_fibers.push(this_fiber);
+			worker->m_fiber_to_free = this_fiber;
 			Fiber::switchTo(&this_fiber->fiber, work.fiber->fiber);
 			afterSwitch();
 
@@ -569,11 +723,23 @@ LUMIX_FORCE_INLINE static void executeJob(const Job& job) {
 		else if (work.type == Work::JOB) {
 			if (!work.job.task) continue;
 
+			if (work.job.large_stack && !this_fiber->pool->large) {
+				handOff(this_fiber, g_system->m_large_fibers, work.job);
+				worker = getWorker();
+				continue;
+			}
+
 			this_fiber->current_job = work.job;
+			++worker->m_stats.jobs;
 
 			executeJob(work.job);
 
 			this_fiber->current_job.task = nullptr;
+			
+			if (this_fiber->pool->large) {
+				// other jobs run on small stack, so large fibers are free for jobs which need them
+				handOff(this_fiber, g_system->m_small_fibers, Job());
+			}
 			worker = getWorker();
 		}
 		else ASSERT(false);
@@ -585,23 +751,86 @@ IAllocator& getAllocator() {
 	return g_system->m_allocator;
 }
 
-bool init(u8 workers_count, IAllocator& allocator) {
-	g_system.create(allocator);
+// assign cores to workers, performance cores first, cores sharing NUMA node / cache next to each other
+static void assignCores(u32 count) {
+	os::CPUCoreInfo cpus[64];
+	const u32 num_cpus = os::getCPUTopology(Span(cpus));
+	if (num_cpus == 0) {
+		for (u32 i = 0; i < count; ++i) g_system->m_workers[i]->m_cpu.index = i % 64;
+		return;
+	}
 
-	for (FiberJobPair& fiber : g_system->m_fiber_pool) {
-		g_system->m_free_fibers.push(&fiber);
+	u8 max_efficiency_class = 0;
+	for (u32 i = 0; i < num_cpus; ++i) max_efficiency_class = maximum(max_efficiency_class, cpus[i].efficiency_class);
+	
+	auto less = [](const os::CPUCoreInfo& a, const os::CPUCoreInfo& b){
+		if (a.efficiency_class != b.efficiency_class) return a.efficiency_class > b.efficiency_class;
+		if (a.numa_node != b.numa_node) return a.numa_node < b.numa_node;
+		if (a.cache_group != b.cache_group) return a.cache_group < b.cache_group;
+		return a.index < b.index;
+	};
+	for (u32 i = 1; i < num_cpus; ++i) {
+		for (u32 j = i; j > 0 && less(cpus[j], cpus[j - 1]); --j) swap(cpus[j], cpus[j - 1]);
 	}
 
+	for (u32 i = 0; i < count; ++i) {
+		WorkerTask* worker = g_system->m_workers[i];
+		worker->m_cpu = cpus[i % num_cpus];
+		worker->m_core_class = worker->m_cpu.efficiency_class == max_efficiency_class ? CoreClass::PERFORMANCE : CoreClass::EFFICIENCY;
+	}
+}
+
+static u32 getStealDistance(const WorkerTask& a, const WorkerTask& b) {
+	if (a.m_cpu.numa_node != b.m_cpu.numa_node) return 2;
+	if (a.m_cpu.cache_group != b.m_cpu.cache_group) return 1;
+	return 0;
+}
+
+static void initFiberPool(FiberPool& pool, u32 count, u32 stack_size, bool large) {
+	pool.stack_size = stack_size;
+	pool.grow_count = maximum(count, 16u);
+	pool.large = large;
+	if (count > 0) pool.free_fibers.push(pool.grow(count));
+}
+
+bool init(u8 workers_count, IAllocator& allocator, bool use_cpu_topology, const FiberPoolConfig& fibers) {
+	g_system.create(allocator);
+
+	initFiberPool(g_system->m_small_fibers, fibers.small_count, fibers.small_stack_size, false);
+	initFiberPool(g_system->m_large_fibers, fibers.large_count, fibers.large_stack_size, true);
+
 	const u32 count = workers_count > 1 ? workers_count : 1;
 	for (u32 i = 0; i < count; ++i) {
 		WorkerTask* task = LUMIX_NEW(getAllocator(), WorkerTask)(*g_system, i);
+		task->m_cpu.index = i % 64;
 		g_system->m_workers.push(task);
 	}
 
+	if (use_cpu_topology) assignCores(count);
+
+	for (WorkerTask* worker : g_system->m_workers) {
+		// start with the next worker, so not everybody tries to steal from the same worker
+		for (u32 i = 1; i < count; ++i) {
+			worker->m_steal_order.push(u8((worker->m_worker_index + i) % count));
+		}
+		if (use_cpu_topology) {
+			// stable sort by distance
+			Array<u8>& order = worker->m_steal_order;
+			for (i32 i = 1; i < order.size(); ++i) {
+				for (i32 j = i; j > 0; --j) {
+					const u32 d0 = getStealDistance(*worker, *g_system->m_workers[order[j - 1]]);
+					const u32 d1 = getStealDistance(*worker, *g_system->m_workers[order[j]]);
+					if (d1 >= d0) break;
+					swap(order[j], order[j - 1]);
+				}
+			}
+		}
+	}
+
 	for (u32 i = 0; i < count; ++i) {
 		WorkerTask* task = g_system->m_workers[i];
 		if (task->create(StaticString<64>("Worker #", i), false)) {
-			task->setAffinityMask((u64)1 << i);
+			task->setAffinityMask((u64)1 << task->m_cpu.index);
 		}
 		else {
 			LUMIX_DELETE(getAllocator(), task);
@@ -611,6 +840,75 @@ bool init(u8 workers_count, IAllocator& allocator) {
 	return !g_system->m_workers.empty();
 }
 
+CoreClass getWorkerCoreClass(u8 worker_index) {
+	return g_system->m_workers[worker_index % g_system->m_workers.size()]->m_core_class;
+}
+
+
+u32 getWorkerStats(Span<WorkerStats> out) {
+	const u32 count = minimum(out.length(), g_system->m_workers.size());
+	for (u32 i = 0; i < count; ++i) {
+		out[i] = g_system->m_workers[i]->m_stats;
+	}
+	return count;
+}
+
+FiberPoolStats getFiberPoolStats(bool large_stack) {
+	const FiberPool& pool = large_stack ? g_system->m_large_fibers : g_system->m_small_fibers;
+	FiberPoolStats stats;
+	stats.size = pool.size;
+	stats.in_use = pool.in_use;
+	stats.high_water_mark = pool.high_water_mark;
+	return stats;
+}
+
+u32 getFibersInUse() {
+	return g_system->m_small_fibers.in_use + g_system->m_large_fibers.in_use;
+}
+
+u32 getFiberPoolSize() {
+	return g_system->m_small_fibers.size + g_system->m_large_fibers.size;
+}
+
+void pushProfilerCounters() {
+	WorkerStats total = {};
+	for (WorkerTask* worker : g_system->m_workers) {
+		const WorkerStats& s = worker->m_stats;
+		total.jobs += s.jobs;
+		total.fiber_resumes += s.fiber_resumes;
+		total.worker_queue_pops += s.worker_queue_pops;
+		total.local_pops += s.local_pops;
+		total.global_pops += s.global_pops;
+		total.steal_attempts += s.steal_attempts;
+		total.steals += s.steals;
+		total.sleeps += s.sleeps;
+		total.sleep_ticks += s.sleep_ticks;
+	}
+
+	static const u32 jobs_counter = profiler::createCounter("Jobs executed", 0);
+	static const u32 resumes_counter = profiler::createCounter("Fibers resumed", 0);
+	static const u32 local_counter = profiler::createCounter("Local queue pops", 0);
+	static const u32 global_counter = profiler::createCounter("Global queue pops", 0);
+	static const u32 attempts_counter = profiler::createCounter("Steal attempts", 0);
+	static const u32 steals_counter = profiler::createCounter("Steals", 0);
+	static const u32 sleep_counter = profiler::createCounter("Workers sleeping (ms)", 0);
+	static const u32 fibers_counter = profiler::createCounter("Fibers in use", 0);
+	static const u32 fibers_hwm_counter = profiler::createCounter("Fibers high water mark", 0);
+	static const u32 large_fibers_counter = profiler::createCounter("Large stack fibers in use", 0);
+
+	const WorkerStats& last = g_system->m_last_pushed_stats;
+	profiler::pushCounter(jobs_counter, float(total.jobs - last.jobs));
+	profiler::pushCounter(resumes_counter, float(total.fiber_resumes - last.fiber_resumes));
+	profiler::pushCounter(local_counter, float(total.local_pops - last.local_pops));
+	profiler::pushCounter(global_counter, float(total.global_pops - last.global_pops));
+	profiler::pushCounter(attempts_counter, float(total.steal_attempts - last.steal_attempts));
+	profiler::pushCounter(steals_counter, float(total.steals - last.steals));
+	profiler::pushCounter(sleep_counter, os::Timer::rawToSeconds(total.sleep_ticks - last.sleep_ticks) * 1000.f);
+	profiler::pushCounter(fibers_counter, (float)g_system->m_small_fibers.in_use);
+	profiler::pushCounter(fibers_hwm_counter, (float)g_system->m_small_fibers.high_water_mark);
+	profiler::pushCounter(large_fibers_counter, (float)g_system->m_large_fibers.in_use);
+	g_system->m_last_pushed_stats = total;
+}
 
 u8 getWorkersCount()
 {
@@ -637,13 +935,7 @@ void shutdown()
 		LUMIX_DELETE(allocator, task);
 	}
 
-	for (FiberJobPair& fiber : g_system->m_fiber_pool)
-	{
-		if(Fiber::isValid(fiber.fiber)) {
-			Fiber::destroy(fiber.fiber);
-		}
-	}
-
+	// fibers are destroyed in ~FiberPool
 	g_system.destroy();
 }
 
@@ -774,48 +1066,71 @@ void yield() {
 	moveJobToWorker(ANY_WORKER);
 }
 
-void run(void* data, void(*task)(void*), Counter* on_finished, u8 worker_index)
+// push job to appropriate queue, job.dec_on_finish must be already incremented
+LUMIX_FORCE_INLINE static void pushJob(const Job& job) {
+	if (job.worker_index != ANY_WORKER) {
+		WorkerTask* worker = g_system->m_workers[job.worker_index % g_system->m_workers.size()];
+		worker->m_work_queue.pushAndWake(job, worker);
+		return;
+	}
+
+	WorkerTask* worker = getWorker();
+	if (worker) {
+		worker->m_wsq[(u32)job.priority].pushAndWake(job);
+		return;
+	}
+
+	g_system->m_global_queues[(u32)job.priority].pushAndWake(job, nullptr);
+}
+
+void run(void* data, void(*task)(void*), Counter* on_finished, u8 worker_index, Priority priority)
 {
 	Job job;
 	job.data = data;
 	job.task = task;
 	job.worker_index = worker_index != ANY_WORKER ? worker_index % getWorkersCount() : worker_index;
 	job.dec_on_finish = on_finished;
+	job.priority = priority;
 
 	if (on_finished) {
 		addCounter(on_finished, 1);
 	}
 
-	if (worker_index != ANY_WORKER) {
-		WorkerTask* worker = g_system->m_workers[worker_index % g_system->m_workers.size()];
-		worker->m_work_queue.pushAndWake(job, worker);
-		return;
-	}
+	pushJob(job);
+}
 
-	WorkerTask* worker = getWorker();
-	if (worker) {
-		worker->m_wsq.pushAndWake(job);
-		return;
+void runOnLargeStack(void* data, void(*task)(void*), Counter* on_finished, Priority priority) {
+	Job job;
+	job.data = data;
+	job.task = task;
+	job.worker_index = ANY_WORKER;
+	job.dec_on_finish = on_finished;
+	job.priority = priority;
+	job.large_stack = true;
+
+	if (on_finished) {
+		addCounter(on_finished, 1);
 	}
 
-	g_system->m_global_queue.pushAndWake(job, nullptr);
+	pushJob(job);
 }
 
-void runN(void* data, void(*task)(void*), Counter* on_finished, u32 num_jobs)
+void runN(void* data, void(*task)(void*), Counter* on_finished, u32 num_jobs, Priority priority)
 {
 	Job job;
 	job.data = data;
 	job.task = task;
 	job.worker_index = ANY_WORKER;
 	job.dec_on_finish = on_finished;
+	job.priority = priority;
 
 	if (on_finished) {
 		addCounter(on_finished, num_jobs);
 	}
 
 	WorkerTask* worker = getWorker();
-	if (worker) worker->m_wsq.pushAndWakeN(job, num_jobs);
-	else g_system->m_global_queue.pushAndWakeN(job, num_jobs);
+	if (worker) worker->m_wsq[(u32)priority].pushAndWakeN(job, num_jobs);
+	else g_system->m_global_queues[(u32)priority].pushAndWakeN(job, num_jobs);
 }
 
 // wake the worker (if any is sleeping)
@@ -861,7 +1176,7 @@ void WorkStealingQueue::pushAndWakeN(const Work& obj, u32 num) {
 	const i32 size = producing_end - m_stealing_end;
 
 	if (size + num > RING_BUFFER_SIZE) {
-		g_system->m_global_queue.pushAndWakeN(obj, num);
+		g_system->m_global_queues[(u32)obj.getPriority()].pushAndWakeN(obj, num);
 		return;
 	}
 	
@@ -885,7 +1200,7 @@ void WorkStealingQueue::pushAndWake(const Work& obj) {
 	if (size == RING_BUFFER_SIZE) {
 		// queue is full, push to global queue instead
 		// queue should be big enough for this to never happen
-		g_system->m_global_queue.pushAndWake(obj, nullptr);
+		g_system->m_global_queues[(u32)obj.getPriority()].pushAndWake(obj, nullptr);
 		return;
 	}
 
@@ -897,4 +1212,214 @@ void WorkStealingQueue::pushAndWake(const Work& obj) {
 	wake();
 }
 
+Graph::Graph(IAllocator& allocator)
+	: m_nodes(allocator)
+	, m_edges(allocator)
+	, m_successors(allocator)
+{}
+
+Graph::Node Graph::add(void* data, void (*task)(void*), Priority priority) {
+	NodeData& node = m_nodes.emplace();
+	node.data = data;
+	node.task = task;
+	node.graph = this;
+	node.priority = priority;
+	m_dirty = true;
+	return m_nodes.size() - 1;
+}
+
+void Graph::addEdge(Node from, Node to) {
+	ASSERT(from < (u32)m_nodes.size() && to < (u32)m_nodes.size());
+	ASSERT(from != to);
+	m_edges.push((u64(from) << 32) | to);
+	m_dirty = true;
+}
+
+void Graph::clear() {
+	m_nodes.clear();
+	m_edges.clear();
+	m_successors.clear();
+	m_dirty = false;
+}
+
+static void pushGraphNode(Graph::NodeData& node);
+
+static void runGraphNode(void* ptr) {
+	Graph::NodeData* node = (Graph::NodeData*)ptr;
+	node->task(node->data);
+	
+	// the last finished predecessor schedules the successor
+	Graph& graph = *node->graph;
+	for (u32 i = 0; i < node->successors_count; ++i) {
+		Graph::NodeData& successor = graph.m_nodes[graph.m_successors[node->successors_offset + i]];
+		if (successor.remaining_predecessors.dec() == 1) pushGraphNode(successor);
+	}
+}
+
+static void pushGraphNode(Graph::NodeData& node) {
+	Job job;
+	job.data = &node;
+	job.task = runGraphNode;
+	job.worker_index = ANY_WORKER;
+	job.priority = node.priority;
+	// counter is incremented for all nodes in Graph::run
+	job.dec_on_finish = node.graph->m_on_finish;
+	pushJob(job);
+}
+
+void Graph::run(Counter* on_finish) {
+	ASSERT(on_finish);
+	if (m_nodes.empty()) return;
+
+	if (m_dirty) {
+		// build successor lists, grouped by predecessor
+		for (NodeData& node : m_nodes) {
+			node.num_predecessors = 0;
+			node.successors_count = 0;
+		}
+		for (u64 edge : m_edges) {
+			++m_nodes[u32(edge >> 32)].successors_count;
+			++m_nodes[u32(edge)].num_predecessors;
+		}
+		u32 offset = 0;
+		for (NodeData& node : m_nodes) {
+			node.successors_offset = offset;
+			offset += node.successors_count;
+			node.successors_count = 0;
+		}
+		m_successors.resize(m_edges.size());
+		for (u64 edge : m_edges) {
+			NodeData& from = m_nodes[u32(edge >> 32)];
+			m_successors[from.successors_offset + from.successors_count] = u32(edge);
+			++from.successors_count;
+		}
+		m_dirty = false;
+	}
+
+	m_on_finish = on_finish;
+	addCounter(on_finish, m_nodes.size());
+	for (NodeData& node : m_nodes) {
+		node.remaining_predecessors = node.num_predecessors;
+	}
+	
+	// we must not touch `this` after the last node is pushed, since it can be already finished
+	u32 num_roots = 0;
+	for (NodeData& node : m_nodes) {
+		if (node.num_predecessors == 0) ++num_roots;
+	}
+	ASSERT(num_roots > 0); // cycle
+	for (NodeData& node : m_nodes) {
+		if (node.num_predecessors != 0) continue;
+		--num_roots;
+		const bool is_last = num_roots == 0;
+		pushGraphNode(node);
+		if (is_last) break;
+	}
+}
+
+// [begin, end) packed in single 64bit value, so it can be changed by one CAS
+// owner takes chunks from the beginning, thieves take the second half
+struct alignas(64) ParallelRange {
+	static u64 pack(u32 begin, u32 end) { return (u64(end) << 32) | begin; }
+	static u32 begin(u64 value) { return u32(value); }
+	static u32 end(u64 value) { return u32(value >> 32); }
+
+	AtomicI64 value = 0;
+};
+
+struct ParallelForData {
+	void* data;
+	void (*f)(void*, u32, u32);
+	ParallelRange* ranges;
+	u32 num_ranges;
+	AtomicI32 next_range = 0;
+	u64 chunk_ticks; // target duration of one chunk
+};
+
+// steal the second half of a range of any other participant and make it our own
+static bool stealRange(ParallelForData& data, u32 thief_idx) {
+	for (u32 i = 1; i < data.num_ranges; ++i) {
+		ParallelRange& victim = data.ranges[(thief_idx + i) % data.num_ranges];
+		for (;;) {
+			const u64 value = victim.value;
+			const u32 begin = ParallelRange::begin(value);
+			const u32 end = ParallelRange::end(value);
+			if (begin >= end) break;
+			
+			const u32 mid = begin + (end - begin) / 2;
+			if (victim.value.compareExchange(ParallelRange::pack(begin, mid), value)) {
+				// nobody steals from an empty range, so we can just store it
+				data.ranges[thief_idx].value = ParallelRange::pack(mid, end);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static void processRanges(ParallelForData& data) {
+	const u32 idx = data.next_range.inc();
+	ASSERT(idx < data.num_ranges);
+	ParallelRange& range = data.ranges[idx];
+	
+	// start with single item to measure the cost
+	u32 grain = 1;
+	for (;;) {
+		const u64 value = range.value;
+		const u32 begin = ParallelRange::begin(value);
+		const u32 end = ParallelRange::end(value);
+		if (begin >= end) {
+			if (!stealRange(data, idx)) return;
+			continue;
+		}
+
+		const u32 to = end - begin > grain ? begin + grain : end;
+		if (!range.value.compareExchange(ParallelRange::pack(to, end), value)) continue;
+		
+		const u64 start_time = os::Timer::getRawTimestamp();
+		data.f(data.data, begin, to);
+		const u64 duration = os::Timer::getRawTimestamp() - start_time;
+		
+		// grow or shrink chunk so it takes approximately `chunk_ticks`
+		const u64 per_item = maximum(duration / (to - begin), (u64)1);
+		const u64 new_grain = data.chunk_ticks / per_item;
+		grain = u32(clamp(new_grain, (u64)1, (u64)0xffFFffFF));
+	}
+}
+
+void forEachAdaptive(u32 count, void* data, void (*f)(void*, u32, u32), Priority priority) {
+	if (count == 0) return;
+	
+	const u32 num_workers = getWorkersCount();
+	if (count == 1 || num_workers == 1) {
+		f(data, 0, count);
+		return;
+	}
+	
+	ParallelForData pf;
+	pf.data = data;
+	pf.f = f;
+	pf.num_ranges = minimum(num_workers, count);
+	// chunks should be long enough to amortize the CAS and short enough to be balanced
+	pf.chunk_ticks = maximum(os::Timer::getFrequency() / 50'000, (u64)1); // 20us
+	pf.ranges = (ParallelRange*)g_system->m_allocator.allocate(sizeof(ParallelRange) * pf.num_ranges, alignof(ParallelRange));
+	
+	for (u32 i = 0; i < pf.num_ranges; ++i) {
+		const u32 begin = u32(u64(count) * i / pf.num_ranges);
+		const u32 end = u32(u64(count) * (i + 1) / pf.num_ranges);
+		new (NewPlaceholder(), &pf.ranges[i]) ParallelRange;
+		pf.ranges[i].value = ParallelRange::pack(begin, end);
+	}
+
+	Counter counter;
+	runN(&pf, [](void* ptr){
+		processRanges(*(ParallelForData*)ptr);
+	}, &counter, pf.num_ranges - 1, priority);
+	
+	processRanges(pf);
+	wait(&counter);
+
+	g_system->m_allocator.deallocate(pf.ranges);
+}
+
 } // namespace Lumix::jobs
@@ -1,16 +1,33 @@
 #pragma once
 #include "allocator.h"
+#include "array.h"
 #include "atomic.h"
 #include "core.h"
 
 namespace Lumix {
 
 struct IAllocator;
+template <typename T> struct Span;
 
 namespace jobs {
 
 constexpr u8 ANY_WORKER = 0xff;
 
+// jobs with higher priority are popped first, background jobs run only if there are no other jobs waiting
+// fibers resumed after wait keep the priority of the job they run
+enum class Priority : u8 {
+	HIGH,		// frame-critical work, e.g. render setup
+	NORMAL,
+	BACKGROUND,	// long-running work which is not needed this frame, e.g. navmesh tiles, asset compilation
+
+	COUNT
+};
+
+enum class CoreClass : u8 {
+	PERFORMANCE,	// also used for all cores on non-hybrid CPUs
+	EFFICIENCY
+};
+
 // can be in two states: red and green, red signal blocks wait() callers, green does not
 struct Signal;
 
@@ -36,10 +53,51 @@ LUMIX_CORE_API void wait(Counter* counter);
 LUMIX_CORE_API void enter(Mutex* mutex);
 LUMIX_CORE_API void exit(Mutex* mutex);
 
-LUMIX_CORE_API bool init(u8 workers_count, IAllocator& allocator);
+// every job runs on a fiber, a fiber blocked in wait() keeps its stack until it's resumed
+// pools start with `*_count` fibers and grow when they run out, fibers are created lazily on the first use
+struct FiberPoolConfig {
+	u32 small_count = 512;
+	u32 small_stack_size = 64 * 1024;
+	// only for jobs started with runOnLargeStack
+	u32 large_count = 16;
+	u32 large_stack_size = 1024 * 1024;
+};
+
+// if `use_cpu_topology` is true, workers are pinned to cores ordered by performance, NUMA node and shared cache,
+// workers steal from workers on the same shared cache / NUMA node first
+// and HIGH priority jobs prefer workers on performance cores
+LUMIX_CORE_API bool init(u8 workers_count, IAllocator& allocator, bool use_cpu_topology = false, const FiberPoolConfig& fibers = {});
 LUMIX_CORE_API IAllocator& getAllocator();
 LUMIX_CORE_API void shutdown();
 LUMIX_CORE_API u8 getWorkersCount();
+LUMIX_CORE_API CoreClass getWorkerCoreClass(u8 worker_index);
+
+// scheduler statistics of a worker, cumulative since init
+struct WorkerStats {
+	u64 jobs;				// executed jobs
+	u64 fiber_resumes;		// fibers resumed after wait
+	u64 worker_queue_pops;	// work pinned to the worker
+	u64 local_pops;			// work from the worker's own work stealing queues
+	u64 global_pops;		// work from the global queues
+	u64 steal_attempts;		// one attempt tries all other workers
+	u64 steals;				// successful attempts
+	u64 sleeps;
+	u64 sleep_ticks;		// time spent sleeping, in os::Timer::getFrequency() units, updated when the worker wakes up
+};
+
+struct FiberPoolStats {
+	u32 size;				// current size, including growth
+	u32 in_use;
+	u32 high_water_mark;	// max in_use since init
+};
+
+LUMIX_CORE_API u32 getWorkerStats(Span<WorkerStats> out);
+LUMIX_CORE_API FiberPoolStats getFiberPoolStats(bool large_stack);
+// sum of both pools
+LUMIX_CORE_API u32 getFibersInUse();
+LUMIX_CORE_API u32 getFiberPoolSize();
+// push per-frame scheduler stats, summed over all workers, as profiler counters, call once per frame
+LUMIX_CORE_API void pushProfilerCounters();
 
 // yield current job and push it to worker queue
 LUMIX_CORE_API void moveJobToWorker(u8 worker_index);
@@ -47,24 +105,73 @@ LUMIX_CORE_API void moveJobToWorker(u8 worker_index);
 LUMIX_CORE_API void yield();
 
 // run single job, increment on_finished counter, decrement it when job is done
-LUMIX_CORE_API void run(void* data, void(*task)(void*), Counter* on_finish, u8 worker_index = ANY_WORKER);
+LUMIX_CORE_API void run(void* data, void(*task)(void*), Counter* on_finish, u8 worker_index = ANY_WORKER, Priority priority = Priority::NORMAL);
+// same as run, but the job is executed on a fiber with large stack, for deep recursion, e.g. in third party libraries
+LUMIX_CORE_API void runOnLargeStack(void* data, void(*task)(void*), Counter* on_finish, Priority priority = Priority::NORMAL);
 // same as calling `run` `num_jobs` times, except it's faster
-LUMIX_CORE_API void runN(void* data, void(*task)(void*), Counter* on_finish, u32 num_jobs);
+LUMIX_CORE_API void runN(void* data, void(*task)(void*), Counter* on_finish, u32 num_jobs, Priority priority = Priority::NORMAL);
 
 // spawn as many jobs as there are worker threads, and call `f`
 template <typename F> void runOnWorkers(const F& f);
 
 // same as run, but uses lambda instead of function and data pointer
 // it can allocate memory for lambda, if the lambda is too big to fit in pointer
-template <typename F> void runLambda(F&& f, Counter* on_finish, u8 worker = ANY_WORKER);
+template <typename F> void runLambda(F&& f, Counter* on_finish, u8 worker = ANY_WORKER, Priority priority = Priority::NORMAL);
+// same as runLambda, but the lambda is executed on a fiber with large stack, see runOnLargeStack
+template <typename F> void runLambdaOnLargeStack(F&& f, Counter* on_finish, Priority priority = Priority::NORMAL);
 
 // call F for each element in range [0, `count`) in steps of `step`
 // F is called in parallel
-template <typename F> void forEach(u32 count, u32 step, const F& f);
+template <typename F> void forEach(u32 count, u32 step, const F& f, Priority priority = Priority::NORMAL);
+
+// call F(from, to) for subranges of [0, `count`) in parallel, size of subranges is chosen automatically
+// each worker starts with its own part of the range and processes it in chunks sized by measured per-item cost
+// idle workers steal half of the remaining range from other workers, so uneven per-item cost is balanced
+template <typename F> void forEach(u32 count, const F& f, Priority priority = Priority::NORMAL);
+
+// non-template implementation of adaptive forEach, `f` is called with `data` and subrange [from, to)
+LUMIX_CORE_API void forEachAdaptive(u32 count, void* data, void (*f)(void* data, u32 from, u32 to), Priority priority = Priority::NORMAL);
 
 // RAII mutex guard
 struct MutexGuard;
 
+// set of jobs with dependencies, a job is started as soon as all its predecessors are finished
+// so there are no fibers blocked in wait() between the jobs
+// graph can be built once and run every frame, but it must not be changed or run again until previous run is finished
+struct LUMIX_CORE_API Graph {
+	using Node = u32;
+
+	explicit Graph(IAllocator& allocator);
+	
+	Node add(void* data, void (*task)(void*), Priority priority = Priority::NORMAL);
+	// `f` must be alive until the graph is finished
+	template <typename F> Node add(F& f, Priority priority = Priority::NORMAL);
+	// `to` is started only after `from` is finished
+	void addEdge(Node from, Node to);
+	void clear();
+	u32 size() const { return m_nodes.size(); }
+	
+	// start all nodes without predecessors, `on_finish` is green when all nodes are finished
+	void run(Counter* on_finish);
+
+	struct NodeData {
+		void* data;
+		void (*task)(void*);
+		Graph* graph;
+		Priority priority;
+		u32 num_predecessors = 0;
+		u32 successors_offset = 0;
+		u32 successors_count = 0;
+		AtomicI32 remaining_predecessors = 0;
+	};
+
+	Array<NodeData> m_nodes;
+	Array<u64> m_edges; // (from << 32) | to
+	Array<Node> m_successors; // built from m_edges in run()
+	Counter* m_on_finish = nullptr;
+	bool m_dirty = false;
+};
+
 // implementation
 struct MutexGuard {
 	MutexGuard(Mutex& mutex) : mutex(mutex) { enter(&mutex); }
@@ -95,14 +202,21 @@ struct Counter {
 };
 
 template <typename F>
-void runLambda(F&& f, Counter* on_finish, u8 worker) {
+Graph::Node Graph::add(F& f, Priority priority) {
+	return add(&f, [](void* data){
+		(*(F*)data)();
+	}, priority);
+}
+
+template <typename F>
+void runLambda(F&& f, Counter* on_finish, u8 worker, Priority priority) {
 	void* arg;
 	if constexpr (sizeof(f) == sizeof(void*) && __is_trivially_copyable(F)) {
 		memcpy(&arg, &f, sizeof(arg));
 		run(arg, [](void* arg){
 			F* f = (F*)&arg;
 			(*f)();
-		}, on_finish, worker);
+		}, on_finish, worker, priority);
 	}
 	else {
 		F* tmp = LUMIX_NEW(getAllocator(), F)(static_cast<F&&>(f));
@@ -110,11 +224,21 @@ void runLambda(F&& f, Counter* on_finish, u8 worker) {
 			F* f = (F*)arg;
 			(*f)();
 			LUMIX_DELETE(getAllocator(), f);
-		}, on_finish, worker);
+		}, on_finish, worker, priority);
 
 	}
 }
 
+template <typename F>
+void runLambdaOnLargeStack(F&& f, Counter* on_finish, Priority priority) {
+	F* tmp = LUMIX_NEW(getAllocator(), F)(static_cast<F&&>(f));
+	runOnLargeStack(tmp, [](void* arg){
+		F* f = (F*)arg;
+		(*f)();
+		LUMIX_DELETE(getAllocator(), f);
+	}, on_finish, priority);
+}
+
 
 template <typename F>
 void runOnWorkers(const F& f)
@@ -129,7 +253,7 @@ void runOnWorkers(const F& f)
 
 
 template <typename F>
-void forEach(u32 count, u32 step, const F& f) {
+void forEach(u32 count, u32 step, const F& f, Priority priority) {
 	if (count == 0) return;
 	if (count <= step) {
 		f(0, count);
@@ -166,7 +290,7 @@ void forEach(u32 count, u32 step, const F& f) {
 			to = to > count ? count : to;
 			(*f)(idx, to);
 		}
-	}, &counter, num_jobs - 1);
+	}, &counter, num_jobs - 1, priority);
 
 	for (;;) {
 		const i32 idx = data.offset.add(step);
@@ -179,6 +303,13 @@ void forEach(u32 count, u32 step, const F& f) {
 	jobs::wait(&counter);
 }
 
+template <typename F>
+void forEach(u32 count, const F& f, Priority priority) {
+	forEachAdaptive(count, (void*)&f, [](void* data, u32 from, u32 to){
+		(*(const F*)data)(from, to);
+	}, priority);
+}
+
 } // namespace jobs
 
 } // namespace Lumix
\ No newline at end of file
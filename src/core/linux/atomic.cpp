@@ -29,10 +29,18 @@ bool AtomicI64::compareExchange(i64 exchange, i64 comperand) {
 	return __sync_bool_compare_and_swap(&value, comperand, exchange);
 }
 
-bool compareExchangePtr(volatile void** value, void* exchange, void* comperand) {
+bool compareExchangePtr(void* volatile* value, void* exchange, void* comperand) {
 	return __sync_bool_compare_and_swap(value, comperand, exchange);
 }
 
+void* exchangePtr(void* volatile* value, void* exchange) {
+	return __atomic_exchange_n(value, exchange, __ATOMIC_ACQ_REL);
+}
+
+void cpuRelax() {
+	__builtin_ia32_pause();
+}
+
 LUMIX_CORE_API void memoryBarrier()
 {
 	__sync_synchronize();
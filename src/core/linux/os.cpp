@@ -16,12 +16,15 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <linux/perf_event.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/sendfile.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/utsname.h>
 #include <sys/wait.h>
 #include <time.h>
@@ -399,6 +402,52 @@ u64 InputFile::size() const {
 }
 
 
+MappedFile::~MappedFile() {
+	ASSERT(!m_is_open);
+}
+
+
+bool MappedFile::open(const char* path) {
+	ASSERT(!m_is_open);
+	const int fd = ::open(path, O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		::close(fd);
+		return false;
+	}
+
+	// empty files can not be mapped
+	if (st.st_size == 0) {
+		::close(fd);
+		m_data = nullptr;
+		m_size = 0;
+		m_is_open = true;
+		return true;
+	}
+
+	// the mapping keeps the file alive
+	void* mem = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mem == MAP_FAILED) return false;
+
+	m_data = (const u8*)mem;
+	m_size = st.st_size;
+	m_is_open = true;
+	return true;
+}
+
+
+void MappedFile::close() {
+	if (!m_is_open) return;
+	if (m_data) munmap((void*)m_data, m_size);
+	m_data = nullptr;
+	m_size = 0;
+	m_is_open = false;
+}
+
+
 u64 InputFile::pos() {
 	ASSERT(nullptr != m_handle);
 	long pos = ftell((FILE*)m_handle);
@@ -415,6 +464,67 @@ bool InputFile::seek(u64 pos) {
 u32 getCPUsCount() {
 	return sysconf(_SC_NPROCESSORS_ONLN);
 }
+// reads small sysfs file, returns false if it does not exist
+static bool readSysFile(const char* path, Span<char> out) {
+	const int fd = ::open(path, O_RDONLY);
+	if (fd < 0) return false;
+	const ssize_t size = ::read(fd, out.begin(), out.length() - 1);
+	::close(fd);
+	if (size < 0) return false;
+	out[u32(size)] = '\0';
+	return true;
+}
+
+// parses list in sysfs format, e.g. "0-3,8,10-11", and calls `f` for each cpu in the list
+template <typename F>
+static void forEachInCPUList(const char* list, F f) {
+	const char* c = list;
+	while (*c >= '0' && *c <= '9') {
+		u32 from = 0;
+		while (*c >= '0' && *c <= '9') { from = from * 10 + (*c - '0'); ++c; }
+		u32 to = from;
+		if (*c == '-') {
+			++c;
+			to = 0;
+			while (*c >= '0' && *c <= '9') { to = to * 10 + (*c - '0'); ++c; }
+		}
+		for (u32 i = from; i <= to; ++i) f(i);
+		if (*c == ',') ++c;
+	}
+}
+
+u32 getCPUTopology(Span<CPUCoreInfo> out) {
+	const u32 count = minimum(getCPUsCount(), out.length(), 64);
+	char tmp[4096];
+	for (u32 i = 0; i < count; ++i) {
+		CPUCoreInfo& cpu = out[i];
+		cpu.index = i;
+		cpu.efficiency_class = 0;
+		cpu.cache_group = 0;
+		cpu.numa_node = 0;
+		
+		const StaticString<MAX_PATH> cache_path("/sys/devices/system/cpu/cpu", i, "/cache/index3/id");
+		if (readSysFile(cache_path.data, Span(tmp))) cpu.cache_group = (u16)atoi(tmp);
+		
+		// ARM big.LITTLE
+		const StaticString<MAX_PATH> capacity_path("/sys/devices/system/cpu/cpu", i, "/cpu_capacity");
+		if (readSysFile(capacity_path.data, Span(tmp))) cpu.efficiency_class = u8(minimum(atoi(tmp) / 128, 255));
+	}
+	
+	// intel hybrid CPUs
+	if (readSysFile("/sys/devices/cpu_core/cpus", Span(tmp))) {
+		forEachInCPUList(tmp, [&](u32 i){ if (i < count) out[i].efficiency_class = 1; });
+	}
+
+	for (u16 node = 0; ; ++node) {
+		const StaticString<MAX_PATH> node_path("/sys/devices/system/node/node", node, "/cpulist");
+		if (!readSysFile(node_path.data, Span(tmp))) break;
+		forEachInCPUList(tmp, [&](u32 i){ if (i < count) out[i].numa_node = node; });
+	}
+
+	return count;
+}
+
 void sleep(u32 milliseconds) {
 	if (milliseconds) usleep(useconds_t(milliseconds * 1000));
 }
@@ -422,6 +532,68 @@ ThreadID getCurrentThreadID() {
 	return pthread_self();
 }
 
+// perf_event group, all counters are read with single syscall
+// index in group for each counter in PerfCounters, -1 if not available
+struct PerfEventGroup {
+	int leader = -1;
+	i32 indices[5] = { -1, -1, -1, -1, -1 };
+};
+static thread_local PerfEventGroup t_perf_events;
+
+bool initPerfCounters() {
+	if (t_perf_events.leader >= 0) return true;
+
+	const struct {
+		u32 type;
+		u64 config;
+	} events[] = {
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+	};
+	static_assert(lengthOf(events) == lengthOf(t_perf_events.indices));
+	static_assert(sizeof(PerfCounters) == sizeof(u64) * lengthOf(events));
+
+	i32 count = 0;
+	for (u32 i = 0; i < lengthOf(events); ++i) {
+		perf_event_attr attr = {};
+		attr.size = sizeof(attr);
+		attr.type = events[i].type;
+		attr.config = events[i].config;
+		attr.read_format = PERF_FORMAT_GROUP;
+		attr.disabled = t_perf_events.leader < 0 ? 1 : 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		const int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, t_perf_events.leader, 0);
+		if (fd < 0) continue;
+		if (t_perf_events.leader < 0) t_perf_events.leader = fd;
+		t_perf_events.indices[i] = count;
+		++count;
+	}
+	if (t_perf_events.leader < 0) return false;
+
+	ioctl(t_perf_events.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(t_perf_events.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return true;
+}
+
+void readPerfCounters(PerfCounters& out) {
+	out = {};
+	if (t_perf_events.leader < 0) return;
+
+	// PERF_FORMAT_GROUP: number of counters followed by values
+	u64 data[1 + lengthOf(t_perf_events.indices)];
+	if (::read(t_perf_events.leader, data, sizeof(data)) <= 0) return;
+
+	u64* values = &out.cycles;
+	for (u32 i = 0; i < lengthOf(t_perf_events.indices); ++i) {
+		const i32 idx = t_perf_events.indices[i];
+		if (idx >= 0 && u64(idx) < data[0]) values[i] = data[1 + idx];
+	}
+}
+
 void logInfo() {
 	struct utsname tmp;
 	if (uname(&tmp) == 0) {
@@ -1009,6 +1181,15 @@ bool getNextFile(FileIterator* iterator, FileInfo* info) {
 
 	info->is_directory = dir_ent->d_type == DT_DIR;
 	Lumix::copyString(info->filename, dir_ent->d_name);
+	struct stat tmp;
+	if (fstatat(dirfd(dir), dir_ent->d_name, &tmp, 0) == 0) {
+		info->last_modified = tmp.st_mtim.tv_sec * 1000 + Lumix::u64(tmp.st_mtim.tv_nsec / 1000000);
+		info->size = tmp.st_size;
+	}
+	else {
+		info->last_modified = 0;
+		info->size = 0;
+	}
 	return true;
 }
 
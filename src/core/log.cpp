@@ -1,11 +1,17 @@
+#include "core/array.h"
+#include "core/atomic.h"
 #include "core/crt.h"
 #include "core/delegate_list.h"
 #include "core/log.h"
 #include "core/log_callback.h"
+#include "core/os.h"
 #include "core/path.h"
+#include "core/ring_buffer.h"
+#include "core/sort.h"
 #include "core/stream.h"
 #include "core/string.h"
 #include "core/sync.h"
+#include "core/thread.h"
 
 
 namespace Lumix
@@ -13,11 +19,136 @@ namespace Lumix
 
 
 namespace detail {
+	// formatted message passed from logging thread to the log thread
+	struct LogEntry {
+		i32 seq;
+		LogLevel level;
+		u32 size;
+		// zero terminated message follows
+		const char* text() const { return (const char*)(this + 1); }
+	};
+
+	struct LogThread;
+
 	struct Logger {
 		Logger() : callback(getGlobalAllocator()) {}
 
 		Mutex mutex;
 		LogCallback callback;
+		LogThread* thread = nullptr;
+		volatile bool async = false;
+		// threads between checking `async` and pushing the entry, stopAsyncLog waits for them
+		AtomicI32 producers = 0;
+		// logged but not yet passed to callbacks
+		AtomicI32 pending = 0;
+		AtomicI32 seq = 0;
+	};
+
+	static Logger g_logger;
+
+	struct LogThread : Thread {
+		// more messages per second are dropped, except errors
+		static constexpr u32 MAX_MESSAGES_PER_SECOND = 1000;
+
+		LogThread(IAllocator& allocator)
+			: Thread(allocator)
+			, allocator(allocator)
+			, queue(getGlobalAllocator())
+			, batch(allocator)
+			, last(allocator)
+			, semaphore(0, 1)
+		{}
+
+		void push(LogEntry* entry) {
+			queue.push(entry);
+			if (sleeping.compareExchange(0, 1)) semaphore.signal();
+		}
+
+		int task() override {
+			while (!finished) {
+				sleeping = 1;
+				// timeout, because a producer can push right after we set `sleeping` and before we wait
+				semaphore.wait(50);
+				sleeping = 0;
+				drain();
+			}
+			drain();
+			emitRepeats();
+			return 0;
+		}
+
+		void invoke(LogLevel level, const char* text) {
+			MutexGuard lock(g_logger.mutex);
+			g_logger.callback.invoke(level, text);
+		}
+
+		// consecutive identical messages are collapsed into one and a counter
+		void emitRepeats() {
+			if (repeats == 0) return;
+			StaticString<64> msg("Last message repeated ", repeats, " times");
+			repeats = 0;
+			invoke(last_level, msg);
+		}
+
+		void dispatch(const LogEntry& entry) {
+			if (!last.empty() && entry.level == last_level && equalStrings(entry.text(), (const char*)last.begin())) {
+				++repeats;
+				return;
+			}
+			emitRepeats();
+			last.resize(entry.size);
+			memcpy(last.begin(), entry.text(), entry.size);
+			last_level = entry.level;
+
+			const u64 now = os::Timer::getRawTimestamp();
+			if (now - window_start > os::Timer::getFrequency()) {
+				if (dropped > 0) {
+					StaticString<64> msg(dropped, " log messages dropped, too many messages per second");
+					invoke(LogLevel::WARNING, msg);
+				}
+				window_start = now;
+				window_count = 0;
+				dropped = 0;
+			}
+			if (entry.level != LogLevel::ERROR && window_count >= MAX_MESSAGES_PER_SECOND) {
+				++dropped;
+				return;
+			}
+			++window_count;
+			invoke(entry.level, entry.text());
+		}
+
+		void drain() {
+			LogEntry* entry;
+			while (queue.pop(entry)) batch.push(entry);
+			if (batch.empty()) {
+				// idle, so the counter is not stuck until the next different message
+				emitRepeats();
+				return;
+			}
+
+			// full queue falls back to a stack, which does not keep the order
+			sort(batch.begin(), batch.end(), [](const LogEntry* a, const LogEntry* b){ return a->seq < b->seq; });
+			for (LogEntry* e : batch) {
+				dispatch(*e);
+				getGlobalAllocator().deallocate(e);
+			}
+			g_logger.pending.subtract(batch.size());
+			batch.clear();
+		}
+
+		IAllocator& allocator;
+		RingBuffer<LogEntry*, 1024> queue;
+		Array<LogEntry*> batch;
+		Array<char> last;
+		LogLevel last_level = LogLevel::INFO;
+		u32 repeats = 0;
+		u64 window_start = 0;
+		u32 window_count = 0;
+		u32 dropped = 0;
+		Semaphore semaphore;
+		AtomicI32 sleeping = 0;
+		volatile bool finished = false;
 	};
 
 	struct Log {
@@ -34,7 +165,6 @@ namespace detail {
 		OutputMemoryStream message;
 	};
 
-	static Logger g_logger;
 	thread_local Log g_log;
 
 	void addLog(StringView val) { g_log.message << val; }
@@ -49,7 +179,20 @@ namespace detail {
 
 	void emitLog(LogLevel level) {
 		g_log.message.write('\0');
-		{
+		g_logger.producers.inc();
+		if (g_logger.async) {
+			const u32 size = (u32)g_log.message.size();
+			LogEntry* entry = (LogEntry*)getGlobalAllocator().allocate(sizeof(LogEntry) + size, alignof(LogEntry));
+			entry->seq = g_logger.seq.inc();
+			entry->level = level;
+			entry->size = size;
+			memcpy(entry + 1, g_log.message.data(), size);
+			g_logger.pending.inc();
+			g_logger.thread->push(entry);
+			g_logger.producers.dec();
+		}
+		else {
+			g_logger.producers.dec();
 			MutexGuard lock(g_logger.mutex);
 			g_logger.callback.invoke(level, (const char*)g_log.message.data());
 		}
@@ -59,5 +202,42 @@ namespace detail {
 	LogCallback& getLogCallback() { return g_logger.callback; }
 } // namespace detail
 
+void startAsyncLog(IAllocator& allocator) {
+	using namespace detail;
+	ASSERT(!g_logger.thread);
+	g_logger.thread = LUMIX_NEW(allocator, LogThread)(allocator);
+	if (!g_logger.thread->create("log", true)) {
+		LUMIX_DELETE(allocator, g_logger.thread);
+		g_logger.thread = nullptr;
+		return;
+	}
+	memoryBarrier();
+	g_logger.async = true;
+}
+
+void flushLog() {
+	using namespace detail;
+	if (!g_logger.async) return;
+	while (g_logger.pending > 0) {
+		g_logger.thread->semaphore.signal();
+		os::sleep(1);
+	}
+}
+
+void stopAsyncLog() {
+	using namespace detail;
+	if (!g_logger.thread) return;
+	g_logger.async = false;
+	memoryBarrier();
+	while (g_logger.producers > 0) cpuRelax();
+
+	LogThread* thread = g_logger.thread;
+	thread->finished = true;
+	thread->semaphore.signal();
+	thread->destroy();
+	g_logger.thread = nullptr;
+	LUMIX_DELETE(thread->allocator, thread);
+}
+
 
 } // namespace Lumix
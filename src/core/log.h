@@ -12,6 +12,7 @@ enum class LogLevel {
 	COUNT
 };
 
+struct IAllocator;
 struct StringView;
 
 namespace detail {
@@ -31,6 +32,14 @@ namespace detail {
 	}
 } // namespace detail
 
+// messages are still formatted on the logging thread, but callbacks are called from a background thread,
+// so threads do not wait for each other and for slow callbacks (file, UI), see log.cpp for dedupe and rate limit
+LUMIX_CORE_API void startAsyncLog(IAllocator& allocator);
+// passes pending messages to callbacks, then callbacks are called on the logging thread again
+LUMIX_CORE_API void stopAsyncLog();
+// blocks until all messages logged so far are passed to callbacks
+LUMIX_CORE_API void flushLog();
+
 template <typename... T> void logInfo(const T&... args) { detail::log(LogLevel::INFO, args...); }
 template <typename... T> void logWarning(const T&... args) { detail::log(LogLevel::WARNING, args...); }
 template <typename... T> void logError(const T&... args) { detail::log(LogLevel::ERROR, args...); }
@@ -692,6 +692,68 @@ Quat nlerp(const Quat& q1, const Quat& q2, float t)
 }
 
 
+void lerp(const Vec3* a, const Vec3* b, Vec3* out, u32 count, float t) {
+	// component-wise, so we can go over xyz as plain floats
+	const float* fa = &a->x;
+	const float* fb = &b->x;
+	float* fout = &out->x;
+	const u32 float_count = count * 3;
+	const float4 t4 = f4Splat(t);
+	u32 i = 0;
+	for (; i + 4 <= float_count; i += 4) {
+		const float4 va = f4LoadUnaligned(fa + i);
+		const float4 vb = f4LoadUnaligned(fb + i);
+		f4StoreUnaligned(fout + i, f4Add(va, f4Mul(f4Sub(vb, va), t4)));
+	}
+	for (; i < float_count; ++i) {
+		fout[i] = fa[i] + (fb[i] - fa[i]) * t;
+	}
+}
+
+void nlerp(const Quat* a, const Quat* b, Quat* out, u32 count, float t) {
+	const float4 t4 = f4Splat(t);
+	const float4 inv4 = f4Splat(1 - t);
+	const float4 zero = f4Splat(0);
+	u32 i = 0;
+	// 4 quaternions at a time, transposed so each register holds one component of all 4
+	for (; i + 4 <= count; i += 4) {
+		float4 ax = f4LoadUnaligned(&a[i + 0]);
+		float4 ay = f4LoadUnaligned(&a[i + 1]);
+		float4 az = f4LoadUnaligned(&a[i + 2]);
+		float4 aw = f4LoadUnaligned(&a[i + 3]);
+		float4 bx = f4LoadUnaligned(&b[i + 0]);
+		float4 by = f4LoadUnaligned(&b[i + 1]);
+		float4 bz = f4LoadUnaligned(&b[i + 2]);
+		float4 bw = f4LoadUnaligned(&b[i + 3]);
+		f4Transpose(ax, ay, az, aw);
+		f4Transpose(bx, by, bz, bw);
+
+		// shortest path, same as scalar nlerp
+		const float4 d = ax * bx + ay * by + az * bz + aw * bw;
+		const float4 bt = f4Blend(t4, zero - t4, f4CmpLT(d, zero));
+
+		float4 ox = ax * inv4 + bx * bt;
+		float4 oy = ay * inv4 + by * bt;
+		float4 oz = az * inv4 + bz * bt;
+		float4 ow = aw * inv4 + bw * bt;
+		const float4 l = f4Div(f4Splat(1), f4Sqrt(ox * ox + oy * oy + oz * oz + ow * ow));
+		ox = ox * l;
+		oy = oy * l;
+		oz = oz * l;
+		ow = ow * l;
+
+		f4Transpose(ox, oy, oz, ow);
+		f4StoreUnaligned(&out[i + 0], ox);
+		f4StoreUnaligned(&out[i + 1], oy);
+		f4StoreUnaligned(&out[i + 2], oz);
+		f4StoreUnaligned(&out[i + 3], ow);
+	}
+	for (; i < count; ++i) {
+		out[i] = nlerp(a[i], b[i], t);
+	}
+}
+
+
 Quat Quat::operator*(const Quat& rhs) const
 {
 	return Quat(w * rhs.x + rhs.w * x + y * rhs.z - rhs.y * z,
@@ -542,6 +542,9 @@ LUMIX_CORE_API DVec3 lerp(const DVec3& op1, const DVec3& op2, float t);
 LUMIX_CORE_API Vec2 lerp(const Vec2& op1, const Vec2& op2, float t);
 LUMIX_CORE_API Vec3 slerp(const Vec3& a, const Vec3& b, float t);
 LUMIX_CORE_API Quat nlerp(const Quat& q1, const Quat& q2, float t);
+// batched versions, out[i] = lerp(a[i], b[i], t); `out` can be the same as `a` or `b`
+LUMIX_CORE_API void lerp(const Vec3* a, const Vec3* b, Vec3* out, u32 count, float t);
+LUMIX_CORE_API void nlerp(const Quat* a, const Quat* b, Quat* out, u32 count, float t);
 
 LUMIX_CORE_API u32 nextPow2(u32 v);
 LUMIX_CORE_API u32 log2(u32 v);
@@ -159,11 +159,33 @@ private:
 	void* m_handle;
     bool m_is_error;
 };
+
+
+// whole file mapped read-only to memory, pages are loaded by OS on first access
+// the file can not be modified while it's mapped
+struct LUMIX_CORE_API MappedFile {
+	MappedFile() = default;
+	~MappedFile();
+
+	[[nodiscard]] bool open(const char* path);
+	void close();
+	bool isOpen() const { return m_is_open; }
+	Span<const u8> data() const { return Span(m_data, m_size); }
+
+private:
+	MappedFile(const MappedFile&) = delete;
+	const u8* m_data = nullptr;
+	u64 m_size = 0;
+	bool m_is_open = false;
+};
 	
 
 struct FileInfo {
 	bool is_directory;
 	char filename[MAX_PATH];
+	// same units as getLastModified, filled while iterating, so callers do not need to query each file
+	u64 last_modified;
+	u64 size;
 };
 
 
@@ -172,13 +194,34 @@ struct WindowState {
 	Rect rect;
 };
 
+struct CPUCoreInfo {
+	u32 index; // logical processor index, i.e. bit in affinity mask
+	u8 efficiency_class; // higher is faster, it's 0 for all processors on non-hybrid CPUs
+	u16 cache_group; // logical processors sharing the last level cache (e.g. AMD CCX) have the same value
+	u16 numa_node;
+};
+
 LUMIX_CORE_API void init();
 LUMIX_CORE_API void abort();
 LUMIX_CORE_API void logInfo();
 LUMIX_CORE_API u32 getCPUsCount();
+// fills `out` with info about logical processors (only first 64 are supported), returns number of written elements
+LUMIX_CORE_API u32 getCPUTopology(Span<CPUCoreInfo> out);
 LUMIX_CORE_API void sleep(u32 milliseconds);
 LUMIX_CORE_API ThreadID getCurrentThreadID();
 
+// hardware performance counters of the calling thread, values are cumulative, unsupported counters are 0
+struct PerfCounters {
+	u64 cycles;
+	u64 instructions;
+	u64 l1d_misses;
+	u64 llc_misses;
+	u64 branch_misses;
+};
+// must be called on each thread before readPerfCounters, returns false if counters are not available
+LUMIX_CORE_API bool initPerfCounters();
+LUMIX_CORE_API void readPerfCounters(PerfCounters& out);
+
 LUMIX_CORE_API void* memReserve(size_t size);
 LUMIX_CORE_API void memCommit(void* ptr, size_t size);
 LUMIX_CORE_API void memRelease(void* ptr, size_t size); // size must be full size used in reserve
@@ -1,27 +1,157 @@
+#include "core/atomic.h"
+#include "core/crt.h"
+#include "core/os.h"
 #include "core/path.h"
+#include "core/sync.h"
 
 namespace Lumix {
 
-Path::Path() : m_path{} {}
+namespace {
+
+// interned string, immutable once published in a bucket
+struct PathEntry {
+	PathEntry* next;
+	FilePathHash hash;
+	u32 length;
+	// zero terminated string follows
+	char* str() { return (char*)(this + 1); }
+};
+
+struct EmptyPath {
+	PathEntry entry = { nullptr, StableHash(""), 0 };
+	char str[1] = {};
+};
+
+// Lookups are lock-free, inserts are lock-free too, except when arena needs to commit more memory.
+// Entries are allocated from an arena in reserved virtual memory, so they never move and are never freed.
+struct PathTable {
+	static constexpr u32 BUCKETS_COUNT = 64 * 1024;
+	static constexpr u64 RESERVED = 256 * 1024 * 1024;
+
+	PathTable() {
+		mem = (u8*)os::memReserve(RESERVED);
+		memset((void*)buckets, 0, sizeof(buckets));
+	}
+
+	PathEntry* allocate(u32 length) {
+		const u32 size = (sizeof(PathEntry) + length + 1 + alignof(PathEntry) - 1) & ~u32(alignof(PathEntry) - 1);
+		const u64 start = end.add(size);
+		ASSERT(start + size <= RESERVED);
+		if (start + size > (u64)committed) {
+			MutexGuard guard(mutex);
+			if (start + size > (u64)committed) {
+				const u64 new_committed = (start + size + 65535) & ~u64(65535);
+				os::memCommit(mem + committed, new_committed - committed);
+				// publish only after the memory is committed
+				memoryBarrier();
+				committed = new_committed;
+			}
+		}
+		return (PathEntry*)(mem + start);
+	}
+
+	static PathEntry* find(PathEntry* entry, PathEntry* last, FilePathHash hash, StringView str) {
+		for (; entry != last; entry = entry->next) {
+			if (entry->hash == hash && entry->length == str.size() && memcmp(entry->str(), str.begin, str.size()) == 0) return entry;
+		}
+		return nullptr;
+	}
+
+	PathEntry* intern(StringView str) {
+		const FilePathHash hash(str.begin, str.size());
+		const u64 hash_value = hash.getHashValue();
+		PathEntry* volatile* bucket = &buckets[(hash_value ^ (hash_value >> 32)) & (BUCKETS_COUNT - 1)];
+
+		PathEntry* head = *bucket;
+		if (PathEntry* e = find(head, nullptr, hash, str)) return e;
+
+		PathEntry* entry = allocate(str.size());
+		entry->hash = hash;
+		entry->length = str.size();
+		memcpy(entry->str(), str.begin, str.size());
+		entry->str()[str.size()] = '\0';
+
+		for (;;) {
+			entry->next = head;
+			if (compareExchangePtr((void* volatile*)bucket, entry, head)) break;
+			// somebody else inserted into the bucket, check only the new entries
+			PathEntry* new_head = *bucket;
+			if (PathEntry* e = find(new_head, head, hash, str)) {
+				// `entry` is wasted, but it's rare enough
+				return e;
+			}
+			head = new_head;
+		}
+		count.inc();
+		return entry;
+	}
+
+	PathEntry* volatile buckets[BUCKETS_COUNT];
+	u8* mem;
+	AtomicI64 end = 0;
+	volatile u64 committed = 0;
+	AtomicI32 count = 0;
+	Mutex mutex;
+};
+
+} // anonymous namespace
+
+static PathTable& getPathTable() {
+	// paths can be created by static initializers in other translation units
+	static PathTable table;
+	return table;
+}
+
+static EmptyPath& getEmptyPath() {
+	static EmptyPath empty;
+	return empty;
+}
+
+static PathEntry* getEntry(const char* path) {
+	return (PathEntry*)path - 1;
+}
+
+Path::Path() {
+	intern(StringView());
+}
 
 Path::Path(StringView path) {
-	m_length = u32(normalize(path, Span(m_path)) - m_path);
-	m_hash = StableHash(m_path);
+	char tmp[MAX_PATH];
+	intern(StringView(tmp, normalize(path, Span(tmp))));
+}
+
+void Path::intern(StringView path) {
+	if (path.empty()) {
+		EmptyPath& empty = getEmptyPath();
+		m_path = empty.str;
+		m_hash = empty.entry.hash;
+		return;
+	}
+	PathEntry* entry = getPathTable().intern(path);
+	m_path = entry->str();
+	m_hash = entry->hash;
+}
+
+u32 Path::length() const {
+	return getEntry(m_path)->length;
 }
 
-void Path::add(StringView value) {
-	Span span(m_path + m_length, m_path + MAX_PATH);
-	m_length = u32(copyString(span, value) - m_path);
+void Path::getInternStats(u32& count, u64& bytes) {
+	PathTable& table = getPathTable();
+	count = table.count;
+	bytes = table.end;
 }
 
-void Path::add(StableHash hash) {
-	Span span(m_path + m_length, m_path + MAX_PATH);
-	m_length = u32(toCString(hash.getHashValue(), span) - m_path);
+void Path::add(Span<char> buf, u32& len, StringView value) {
+	len = u32(copyString(Span(buf.begin() + len, buf.end()), value) - buf.begin());
 }
 
-void Path::add(u64 value) {
-	Span span(m_path + m_length, m_path + MAX_PATH);
-	m_length = u32(toCString(value, span) - m_path);
+void Path::add(Span<char> buf, u32& len, StableHash hash) {
+	len = u32(toCString(hash.getHashValue(), Span(buf.begin() + len, buf.end())) - buf.begin());
+}
+
+void Path::add(Span<char> buf, u32& len, u64 value) {
+	len = u32(toCString(value, Span(buf.begin() + len, buf.end())) - buf.begin());
 }
 
 char* Path::normalize(char* path) {
@@ -54,15 +184,10 @@ char* Path::normalize(char* path) {
 	return dst;
 }
 
-void Path::endUpdate() {
-	m_length = u32(normalize(m_path) - m_path);
-	m_hash = StableHash(m_path);
-}
-
 void Path::operator=(StringView rhs) {
-	ASSERT(rhs.size() < lengthOf(m_path));
-	m_length = u32(normalize(rhs, Span(m_path)) - m_path);
-	m_hash = StableHash(m_path); 
+	ASSERT(rhs.size() < MAX_PATH);
+	char tmp[MAX_PATH];
+	intern(StringView(tmp, normalize(rhs, Span(tmp))));
 }
 
 bool Path::operator==(const char* rhs) const {
@@ -74,13 +199,13 @@ bool Path::operator!=(const char* rhs) const {
 }
 
 bool Path::operator==(const Path& rhs) const {
-	ASSERT(equalStrings(m_path, rhs.m_path) == (m_hash == rhs.m_hash));
-	return m_hash == rhs.m_hash;
+	ASSERT(equalStrings(m_path, rhs.m_path) == (m_path == rhs.m_path));
+	return m_path == rhs.m_path;
 }
 
 bool Path::operator!=(const Path& rhs) const {
-	ASSERT(equalStrings(m_path, rhs.m_path) == (m_hash == rhs.m_hash));
-	return m_hash != rhs.m_hash;
+	ASSERT(equalStrings(m_path, rhs.m_path) == (m_path == rhs.m_path));
+	return m_path != rhs.m_path;
 }
 
 char* Path::normalize(StringView path, Span<char> output) {
@@ -219,7 +344,7 @@ bool Path::hasExtension(StringView filename, StringView ext) {
 }
 
 Path::operator StringView() const {
-	return StringView(m_path, m_length);
+	return StringView(m_path, length());
 }
 
 PathInfo::PathInfo(StringView path) {
@@ -18,6 +18,9 @@ struct LUMIX_CORE_API PathInfo {
 };
 
 
+// Paths are interned - the normalized string is stored only once in a global append-only table
+// and Path is just a pointer to it and its hash, so copies are cheap and comparisons are pointer compares.
+// Interned strings are never freed, so `c_str()` is valid until the end of the program.
 struct LUMIX_CORE_API Path {
 	static char* normalize(StringView in_path, Span<char> out_normalized);
 	static char* normalize(char* in_out_path);
@@ -38,38 +41,43 @@ struct LUMIX_CORE_API Path {
 	bool operator!=(const char* rhs) const;
 	bool operator!=(const Path& rhs) const;
 
-	u32 length() const { return m_length; }
+	u32 length() const;
 	FilePathHash getHash() const { return m_hash; }
 	template <typename... Args> void append(Args... args);
-	char* beginUpdate() { return m_path; }
-	void endUpdate();
 	const char* c_str() const { return m_path; }
 	bool isEmpty() const { return m_path[0] == '\0'; }
 	static u32 capacity() { return MAX_PATH; }
 	operator StringView() const;
+	// number of unique paths and bytes used by them
+	static void getInternStats(u32& count, u64& bytes);
 
 private:
-	void add(StringView);
-	void add(StableHash hash);
-	void add(u64 value);
+	static void add(Span<char> buf, u32& len, StringView);
+	static void add(Span<char> buf, u32& len, StableHash hash);
+	static void add(Span<char> buf, u32& len, u64 value);
+	// points this to the interned copy of already normalized `path`
+	void intern(StringView path);
 
-	char m_path[MAX_PATH];
-	u32 m_length = 0;
+	const char* m_path;
 	FilePathHash m_hash;
 };
 
 
 template <typename... Args> Path::Path(Args... args) {
-	m_path[0] = '\0';
-	int tmp[] = { (add(args), 0)... };
-	(void)tmp;
-	endUpdate();
+	char tmp[MAX_PATH];
+	tmp[0] = '\0';
+	u32 len = 0;
+	int dummy[] = { (add(Span(tmp), len, args), 0)... };
+	(void)dummy;
+	intern(StringView(tmp, normalize(tmp)));
 }
 
 template <typename... Args> void Path::append(Args... args) {
-	int tmp[] = { (add(args), 0)... };
-	(void)tmp;
-	endUpdate();
+	char tmp[MAX_PATH];
+	u32 len = u32(copyString(Span(tmp), m_path) - tmp);
+	int dummy[] = { (add(Span(tmp), len, args), 0)... };
+	(void)dummy;
+	intern(StringView(tmp, normalize(tmp)));
 }
 
 
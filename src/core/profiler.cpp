@@ -46,12 +46,15 @@ struct GPUScope {
 	Pair pairs[100];
 	u32 read = 0;
 	u32 write = 0;
+	bool has_pipeline_stats = false;
+	GPUPipelineStats pipeline_stats = {};
 };
 
 struct ThreadContext {
 	ThreadContext(IAllocator& allocator) 
 		: allocator(allocator)
 	{
+		current_page = LUMIX_NEW(allocator, Page)();
 	}
 
 	~ThreadContext() {
@@ -61,17 +64,21 @@ struct ThreadContext {
 			LUMIX_DELETE(allocator, page);
 			page = next;
 		}
+		LUMIX_DELETE(allocator, current_page);
 	}
 
 	struct OpenBlock {
 		i32 id;
 		const char* name;
+		// 0 if the block is not included in block stats, e.g. continued after a fiber switch
+		u64 begin = 0;
 	};
 
 	struct Page {
 		struct Header {
 			Page* next = nullptr;
 			u32 size = 0;
+			u32 context_index = 0;
 		};
 		Header header;
 		u8 buffer[4096 - sizeof(Header)];
@@ -81,10 +88,10 @@ struct ThreadContext {
 	OpenBlock open_block_stack[16] = {};
 	u32 open_block_stack_size = 0;
 	
-	// we write to `tmp` until it's full, then we flush it to the `buffer`
-	// tmp is only accessed by the thread that owns the context
-	u8 tmp[sizeof(Page::buffer)];
-	u32 tmp_pos = 0;
+	// we write directly to `current_page` until it's full, then we flush it to the ring buffer,
+	// or to the capture queue if capture is active
+	// current_page is only written by the thread that owns the context
+	Page* current_page;
 	
 	// ring buffer, access only while holding the mutex
 	// the ring buffer can be read by profiler UI
@@ -95,7 +102,37 @@ struct ThreadContext {
 
 	StaticString<64> thread_name;
 	bool show_in_profiler = false;
-	u32 thread_id;
+	u32 thread_id = 0;
+	u32 index = 0; // identifies the context in capture files, 0 is the global context
+	bool hw_counters_initialized = false;
+	bool hw_counters_available = false;
+
+	// open addressing by name pointer, written only by the owning thread, see enableBlockStats
+	BlockStats block_stats[512] = {};
+	i32 block_stats_generation = 0;
+};
+
+// headless capture, full pages are moved (not copied) to a queue and a background thread writes them to a file
+// file format:
+//	u32 version (CAPTURE_VERSION)
+//	chunks: u32 context index, u32 size, u8[size] events; terminated by CAPTURE_END_CHUNK
+//	u32 counters count, Counter[]
+//	u32 contexts count (without global), per context (global first): name, u32 thread id, u8 show in profiler
+//	string table, same as in serialize()
+// profiler UI converts it to the format produced by serialize() when loading
+struct CaptureTask : Thread {
+	CaptureTask(IAllocator& allocator)
+		: Thread(allocator)
+		, strings(allocator)
+	{}
+
+	int task() override;
+	void writePages();
+
+	os::OutputFile file;
+	HashMap<const char*, const char*> strings;
+	volatile bool finished = false;
+	bool io_error = false;
 };
 
 #ifdef _WIN32
@@ -161,6 +198,7 @@ struct Instance {
 
 	~Instance()
 	{
+		ASSERT(!capture_task);
 		CloseTrace(trace_task.open_handle);
 		trace_task.destroy();
 		for (ThreadContext* ctx : contexts) {
@@ -212,6 +250,7 @@ struct Instance {
 			ThreadContext* new_ctx = LUMIX_NEW(tag_allocator, ThreadContext)(tag_allocator);
 			new_ctx->thread_id = os::getCurrentThreadID();
 			MutexGuard lock(mutex);
+			new_ctx->index = contexts.size() + 1;
 			contexts.push(new_ctx);
 			return new_ctx;
 		}();
@@ -230,78 +269,100 @@ struct Instance {
 	u64 last_frame_duration = 0;
 	u64 last_frame_time = 0;
 	AtomicI32 fiber_wait_id = 0;
+	bool hw_counters_enabled = false;
+	bool block_stats_enabled = false;
+	// changed by enableBlockStats, threads reset their stats when they see a different value
+	AtomicI32 block_stats_generation = 1;
 	TraceTask trace_task;
 	ThreadContext global_context;
+
+	CaptureTask* capture_task = nullptr;
+	// linked list of full pages waiting to be written by capture_task, newest first
+	void* volatile capture_pages = nullptr;
+	AtomicI32 capture_active = 0;
+	// number of threads currently in flush, so we know when no more pages can be pushed after capture stops
+	AtomicI32 capture_pushers = 0;
 };
 
 Local<Instance> g_instance;
 
-// move data from temporary buffer to the main buffer
+static constexpr u32 CAPTURE_VERSION = 1;
+static constexpr u32 CAPTURE_END_CHUNK = 0xffFFffFF;
+
+static bool pushCapturePage(ThreadContext& ctx) {
+	g_instance->capture_pushers.inc();
+	if (!g_instance->capture_active) {
+		g_instance->capture_pushers.dec();
+		return false;
+	}
+
+	ThreadContext::Page* page = ctx.current_page;
+	page->header.context_index = ctx.index;
+	for (;;) {
+		void* head = g_instance->capture_pages;
+		page->header.next = (ThreadContext::Page*)head;
+		if (compareExchangePtr(&g_instance->capture_pages, page, head)) break;
+	}
+	ctx.current_page = LUMIX_NEW(ctx.allocator, ThreadContext::Page)();
+	g_instance->capture_pushers.dec();
+	return true;
+}
+
+// move full current page to the ring buffer or to the capture queue
 template <bool lock>
 static void flush(ThreadContext& ctx) {
+	if (pushCapturePage(ctx)) return;
+
 	if constexpr (lock) ctx.mutex.enter();
 
+	ThreadContext::Page* full_page = ctx.current_page;
 	if (ctx.num_pages < 500) {
-		auto* new_page = LUMIX_NEW(ctx.allocator, ThreadContext::Page)();
-		memcpy(new_page->buffer, ctx.tmp, ctx.tmp_pos);
-		new_page->header.size = ctx.tmp_pos;
-		if (!ctx.first_page) ctx.first_page = new_page;
-		if (ctx.last_page) ctx.last_page->header.next = new_page;
-		ctx.last_page = new_page;
+		ctx.current_page = LUMIX_NEW(ctx.allocator, ThreadContext::Page)();
 		++ctx.num_pages;
 	}
 	else {
-		ThreadContext::Page* new_page = ctx.first_page;
-		ctx.first_page = new_page->header.next;
-		new_page->header.next = nullptr;
-
-		memcpy(new_page->buffer, ctx.tmp, ctx.tmp_pos);
-		new_page->header.size = ctx.tmp_pos;
-
-		ctx.last_page->header.next = new_page;
-		ctx.last_page = new_page;
+		ctx.current_page = ctx.first_page;
+		ctx.first_page = ctx.current_page->header.next;
+		if (!ctx.first_page) ctx.last_page = nullptr;
+		ctx.current_page->header.next = nullptr;
+		ctx.current_page->header.size = 0;
 	}
-	ctx.tmp_pos = 0;
+
+	if (!ctx.first_page) ctx.first_page = full_page;
+	if (ctx.last_page) ctx.last_page->header.next = full_page;
+	ctx.last_page = full_page;
 
 	if constexpr (lock) ctx.mutex.exit();
 }
 
-template <bool lock, typename T>
-LUMIX_FORCE_INLINE static void write(ThreadContext& ctx, u64 timestamp, EventType type, const T& value) {
-	enum { num_bytes_to_write = sizeof(T) + sizeof(EventHeader) };
-	ASSERT(num_bytes_to_write <= lengthOf(ctx.tmp));
+template <bool lock>
+LUMIX_FORCE_INLINE static void write(ThreadContext& ctx, u64 timestamp, EventType type, const void* data, u32 data_size) {
+	const u32 num_bytes_to_write = data_size + sizeof(EventHeader);
+	ASSERT(num_bytes_to_write <= sizeof(ThreadContext::Page::buffer));
 	
 	if constexpr (lock) ctx.mutex.enter();
-	if (ctx.tmp_pos + num_bytes_to_write > lengthOf(ctx.tmp)) {
+	if (ctx.current_page->header.size + num_bytes_to_write > sizeof(ThreadContext::Page::buffer)) {
 		flush<!lock>(ctx);
 	}
 
-	EventHeader* header = (EventHeader*)(ctx.tmp + ctx.tmp_pos);
+	ThreadContext::Page* page = ctx.current_page;
+	EventHeader* header = (EventHeader*)(page->buffer + page->header.size);
 	header->type = type;
 	header->size = num_bytes_to_write;
 	header->time = timestamp;
-	memcpy((u8*)header + sizeof(*header), &value, sizeof(value));
-	ctx.tmp_pos += num_bytes_to_write;
+	memcpy((u8*)header + sizeof(*header), data, data_size);
+	page->header.size += num_bytes_to_write;
 	if constexpr (lock) ctx.mutex.exit();
+}
+
+template <bool lock, typename T>
+LUMIX_FORCE_INLINE static void write(ThreadContext& ctx, u64 timestamp, EventType type, const T& value) {
+	write<lock>(ctx, timestamp, type, &value, sizeof(value));
 };
 
 template <bool lock>
 LUMIX_FORCE_INLINE static void write(ThreadContext& ctx, u64 timestamp, EventType type, Span<const u8> data) {
-	const u32 num_bytes_to_write = (u32)data.length() + sizeof(EventHeader);
-	ASSERT(num_bytes_to_write <= lengthOf(ctx.tmp));
-	
-	if constexpr (lock) ctx.mutex.enter();
-	if (ctx.tmp_pos + num_bytes_to_write > lengthOf(ctx.tmp)) {
-		flush<!lock>(ctx);
-	}
-
-	EventHeader* header = (EventHeader*)(ctx.tmp + ctx.tmp_pos);
-	header->type = type;
-	header->size = num_bytes_to_write;
-	header->time = timestamp;
-	memcpy((u8*)header + sizeof(*header), data.begin(), data.length());
-	ctx.tmp_pos += num_bytes_to_write;
-	if constexpr (lock) ctx.mutex.exit();
+	write<lock>(ctx, timestamp, type, data.begin(), (u32)data.length());
 };
 
 #ifdef _WIN32
@@ -383,6 +444,33 @@ void blockColor(u32 abgr) {
 
 static AtomicI32 last_block_id = 0;
 
+static void writeHWCounters(ThreadContext& ctx, bool is_end) {
+	if (!ctx.hw_counters_initialized) {
+		ctx.hw_counters_initialized = true;
+		ctx.hw_counters_available = os::initPerfCounters();
+	}
+	if (!ctx.hw_counters_available) return;
+
+	os::PerfCounters counters;
+	os::readPerfCounters(counters);
+	HWCountersRecord r;
+	r.cycles = counters.cycles;
+	r.instructions = counters.instructions;
+	r.l1d_misses = counters.l1d_misses;
+	r.llc_misses = counters.llc_misses;
+	r.branch_misses = counters.branch_misses;
+	r.is_end = is_end;
+	write<false>(ctx, os::Timer::getRawTimestamp(), EventType::HW_COUNTERS, r);
+}
+
+void enableHWCounters(bool enable) {
+	g_instance->hw_counters_enabled = enable;
+}
+
+bool hwCountersEnabled() {
+	return g_instance->hw_counters_enabled;
+}
+
 void beginJob(i32 signal_on_finish) {
 	ThreadContext* ctx = g_instance->getThreadContext();
 
@@ -393,10 +481,12 @@ void beginJob(i32 signal_on_finish) {
 	if (ctx->open_block_stack_size < lengthOf(ctx->open_block_stack)) {
 		ctx->open_block_stack[ctx->open_block_stack_size].id = r.id;
 		ctx->open_block_stack[ctx->open_block_stack_size].name = "job";
+		ctx->open_block_stack[ctx->open_block_stack_size].begin = 0;
 	}
 	++ctx->open_block_stack_size;
 
 	write<false>(*ctx, os::Timer::getRawTimestamp(), EventType::BEGIN_JOB, r);
+	if (g_instance->hw_counters_enabled) writeHWCounters(*ctx, false);
 }
 
 u32 getOpenBlocks(Span<const char*> output) {
@@ -416,22 +506,93 @@ void beginBlock(const char* name) {
 	r.id = last_block_id.inc();
 	r.name = name;
 	ThreadContext* ctx = g_instance->getThreadContext();
+	const u64 now = os::Timer::getRawTimestamp();
 
 	if (ctx->open_block_stack_size < lengthOf(ctx->open_block_stack)) {
-		ctx->open_block_stack[ctx->open_block_stack_size] = { r.id, name };
+		ctx->open_block_stack[ctx->open_block_stack_size] = { r.id, name, now };
 	}
 	++ctx->open_block_stack_size;
 	
-	write<false>(*ctx, os::Timer::getRawTimestamp(), EventType::BEGIN_BLOCK, r);
+	write<false>(*ctx, now, EventType::BEGIN_BLOCK, r);
+	if (g_instance->hw_counters_enabled) writeHWCounters(*ctx, false);
+}
+
+static void accumulateBlockStats(ThreadContext& ctx, const ThreadContext::OpenBlock& block, u64 now) {
+	if (block.begin == 0) return;
+
+	const i32 generation = g_instance->block_stats_generation;
+	if (ctx.block_stats_generation != generation) {
+		for (BlockStats& s : ctx.block_stats) s = {};
+		ctx.block_stats_generation = generation;
+	}
+
+	const u32 mask = lengthOf(ctx.block_stats) - 1;
+	u32 idx = u32(uintptr(block.name) >> 3) & mask;
+	for (u32 i = 0; i <= mask; ++i) {
+		BlockStats& s = ctx.block_stats[idx];
+		if (s.name == block.name) {
+			s.total_ticks += now - block.begin;
+			++s.count;
+			return;
+		}
+		if (!s.name) {
+			s.total_ticks = now - block.begin;
+			s.count = 1;
+			s.name = block.name;
+			return;
+		}
+		idx = (idx + 1) & mask;
+	}
 }
 
 void endBlock()
 {
 	ThreadContext* ctx = g_instance->getThreadContext();
 	if (ctx->open_block_stack_size > 0) {
+		if (g_instance->hw_counters_enabled) writeHWCounters(*ctx, true);
 		--ctx->open_block_stack_size;
-		write<false>(*ctx, os::Timer::getRawTimestamp(), EventType::END_BLOCK, 0);
+		const u64 now = os::Timer::getRawTimestamp();
+		if (g_instance->block_stats_enabled && ctx->open_block_stack_size < lengthOf(ctx->open_block_stack)) {
+			accumulateBlockStats(*ctx, ctx->open_block_stack[ctx->open_block_stack_size], now);
+		}
+		write<false>(*ctx, now, EventType::END_BLOCK, 0);
+	}
+}
+
+void enableBlockStats(bool enable) {
+	g_instance->block_stats_generation.inc();
+	g_instance->block_stats_enabled = enable;
+}
+
+u32 getBlockStats(Span<BlockStats> out) {
+	const i32 generation = g_instance->block_stats_generation;
+	u32 num_outputs = 0;
+	MutexGuard lock(g_instance->mutex);
+	for (const ThreadContext* ctx : g_instance->contexts) {
+		if (ctx->block_stats_generation != generation) continue;
+
+		for (const BlockStats& s : ctx->block_stats) {
+			if (!s.name) continue;
+
+			// the same literal can have different addresses in different modules
+			BlockStats* merged = nullptr;
+			for (u32 i = 0; i < num_outputs; ++i) {
+				if (equalStrings(out[i].name, s.name)) {
+					merged = &out[i];
+					break;
+				}
+			}
+			if (!merged) {
+				if (num_outputs == out.length()) continue;
+				merged = &out[num_outputs];
+				++num_outputs;
+				*merged = { s.name, 0, 0 };
+			}
+			merged->total_ticks += s.total_ticks;
+			merged->count += s.count;
+		}
 	}
+	return num_outputs;
 }
 
 static GPUScope& getGPUScope(const char* name, u32& scope_id) {
@@ -464,6 +625,14 @@ void gpuStats(u64 primitives_generated) {
 	write<true>(g_instance->global_context, os::Timer::getRawTimestamp(), EventType::GPU_STATS, primitives_generated);
 }
 
+void gpuPipelineStats(const GPUPipelineStats& stats) {
+	MutexGuard lock(g_instance->global_context.mutex);
+	if (g_instance->gpu_scope_stack.empty()) return;
+	GPUScope& scope = g_instance->gpu_scopes[g_instance->gpu_scope_stack.back()];
+	scope.has_pipeline_stats = true;
+	scope.pipeline_stats = stats;
+}
+
 void endGPUBlock(u64 timestamp) {
 	write<true>(g_instance->global_context, os::Timer::getRawTimestamp(), EventType::END_GPU_BLOCK, timestamp);
 	MutexGuard lock(g_instance->global_context.mutex);
@@ -485,6 +654,8 @@ u32 getGPUScopeStats(Span<GPUScopeStats> out) {
 		const GPUScope& scope = g_instance->gpu_scopes[i];
 		GPUScopeStats& stats = out[i];
 		stats.name = scope.name.c_str();
+		stats.has_pipeline_stats = scope.has_pipeline_stats;
+		stats.pipeline_stats = scope.pipeline_stats;
 		stats.min = scope.read == scope.write ? 0 : FLT_MAX;
 		stats.max = 0;
 		stats.avg = 0;
@@ -629,40 +800,53 @@ void setThreadName(const char* name)
 	ctx->thread_name = name;
 }
 
+static void gatherStrings(const u8* data, u32 size, HashMap<const char*, const char*>& map) {
+	u32 iter = 0;
+	while (iter < size) {
+		profiler::EventHeader header;
+		memcpy(&header, &data[iter], sizeof(header));
+		
+		switch (header.type) {
+			case profiler::EventType::BEGIN_BLOCK: {
+				BlockRecord b;
+				memcpy(&b, &data[iter + sizeof(profiler::EventHeader)], sizeof(b));
+				if (!map.find(b.name).isValid()) {
+					map.insert(b.name, b.name);
+				}
+				break;
+			}
+			case profiler::EventType::INT: {
+				IntRecord r;
+				memcpy(&r, &data[iter + sizeof(profiler::EventHeader)], sizeof(r));
+				if (!map.find(r.key).isValid()) {
+					map.insert(r.key, r.key);
+				}
+				break;
+			}
+			default: break;
+		}
+		iter += header.size;
+	}
+}
+
+static void writeStrings(OutputMemoryStream& blob, const HashMap<const char*, const char*>& map) {
+	blob.write(map.size());
+	for (const char* iter : map) {
+		blob.write((u64)(uintptr)iter);
+		blob.write(iter, strlen(iter) + 1);
+	}
+}
+
 static void saveStrings(OutputMemoryStream& blob) {
 	HashMap<const char*, const char*> map(getGlobalAllocator());
 	map.reserve(512);
 	auto gather = [&](const ThreadContext& ctx){
 		const ThreadContext::Page* page = ctx.first_page;
 		while (page) {
-			u32 iter = 0;
-			while (iter < page->header.size) {
-				profiler::EventHeader header;
-				memcpy(&header, &page->buffer[iter], sizeof(header));
-				
-				switch (header.type) {
-					case profiler::EventType::BEGIN_BLOCK: {
-						BlockRecord b;
-						memcpy(&b, &page->buffer[iter + sizeof(profiler::EventHeader)], sizeof(b));
-						if (!map.find(b.name).isValid()) {
-							map.insert(b.name, b.name);
-						}
-						break;
-					}
-					case profiler::EventType::INT: {
-						IntRecord r;
-						memcpy(&r, &page->buffer[iter + sizeof(profiler::EventHeader)], sizeof(r));
-						if (!map.find(r.key).isValid()) {
-							map.insert(r.key, r.key);
-						}
-						break;
-					}
-					default: break;
-				}
-				iter += header.size;
-			}
+			gatherStrings(page->buffer, page->header.size, map);
 			page = page->header.next;
 		}
+		gatherStrings(ctx.current_page->buffer, ctx.current_page->header.size, map);
 	};
 
 	gather(g_instance->global_context);
@@ -670,20 +854,15 @@ static void saveStrings(OutputMemoryStream& blob) {
 		gather(*ctx);
 	}
 
-	blob.write(map.size());
-	for (const char* iter : map) {
-		blob.write((u64)(uintptr)iter);
-		blob.write(iter, strlen(iter) + 1);
-	}
+	writeStrings(blob, map);
 }
 
 void serialize(OutputMemoryStream& blob, ThreadContext& ctx) {
 	MutexGuard lock(ctx.mutex);
-	flush<false>(ctx);
 	blob.writeString(ctx.thread_name);
 	blob.write(ctx.thread_id);
 	blob.write((u8)ctx.show_in_profiler);
-	u32 size = 0;
+	u32 size = ctx.current_page->header.size;
 	const ThreadContext::Page* page = ctx.first_page;
 	while (page) {
 		size += page->header.size;
@@ -697,9 +876,12 @@ void serialize(OutputMemoryStream& blob, ThreadContext& ctx) {
 		blob.write(page->buffer, page->header.size);
 		page = page->header.next;
 	}
+	blob.write(ctx.current_page->buffer, ctx.current_page->header.size);
 }
 
 void serialize(OutputMemoryStream& blob) {
+	// pages are not kept in memory while capturing
+	ASSERT(!g_instance->capture_active);
 	MutexGuard lock(g_instance->mutex);
 	
 	const u32 version = 0;
@@ -715,11 +897,121 @@ void serialize(OutputMemoryStream& blob) {
 	saveStrings(blob);
 }
 
+void CaptureTask::writePages() {
+	ThreadContext::Page* page = (ThreadContext::Page*)exchangePtr(&g_instance->capture_pages, nullptr);
+	
+	// pages are pushed newest first, reverse so events of each thread stay in order
+	ThreadContext::Page* ordered = nullptr;
+	while (page) {
+		ThreadContext::Page* next = page->header.next;
+		page->header.next = ordered;
+		ordered = page;
+		page = next;
+	}
+
+	IAllocator& allocator = g_instance->tag_allocator;
+	while (ordered) {
+		ThreadContext::Page* next = ordered->header.next;
+		gatherStrings(ordered->buffer, ordered->header.size, strings);
+		if (!io_error) {
+			// written straight from the page, no intermediate buffer
+			io_error = !file.write(&ordered->header.context_index, sizeof(ordered->header.context_index))
+				|| !file.write(&ordered->header.size, sizeof(ordered->header.size))
+				|| !file.write(ordered->buffer, ordered->header.size);
+		}
+		LUMIX_DELETE(allocator, ordered);
+		ordered = next;
+	}
+}
+
+int CaptureTask::task() {
+	while (!finished) {
+		writePages();
+		os::sleep(20);
+	}
+	writePages();
+	return 0;
+}
+
+bool startCapture(const char* path) {
+	ASSERT(!g_instance->capture_task);
+	CaptureTask* task = LUMIX_NEW(g_instance->tag_allocator, CaptureTask)(g_instance->tag_allocator);
+	if (!task->file.open(path)) {
+		LUMIX_DELETE(g_instance->tag_allocator, task);
+		return false;
+	}
+	if (!task->file.write(&CAPTURE_VERSION, sizeof(CAPTURE_VERSION))) {
+		task->file.close();
+		LUMIX_DELETE(g_instance->tag_allocator, task);
+		return false;
+	}
+	task->strings.reserve(512);
+	g_instance->capture_task = task;
+	g_instance->capture_active = 1;
+	task->create("profiler capture", true);
+	return true;
+}
+
+bool stopCapture() {
+	CaptureTask* task = g_instance->capture_task;
+	if (!task) return false;
+
+	g_instance->capture_active = 0;
+	// wait for threads that already decided to push to capture queue
+	while (g_instance->capture_pushers != 0) cpuRelax();
+	task->finished = true;
+	task->destroy();
+
+	// partially filled pages are not in the queue, data still in them is not part of the capture
+	OutputMemoryStream footer(g_instance->tag_allocator);
+	footer.write(CAPTURE_END_CHUNK);
+	{
+		MutexGuard lock(g_instance->mutex);
+		footer.write((u32)g_instance->counters.size());
+		footer.write(g_instance->counters.begin(), g_instance->counters.byte_size());
+		footer.write((u32)g_instance->contexts.size());
+		auto writeContext = [&](ThreadContext& ctx) {
+			MutexGuard ctx_lock(ctx.mutex);
+			footer.writeString(ctx.thread_name);
+			footer.write(ctx.thread_id);
+			footer.write((u8)ctx.show_in_profiler);
+		};
+		writeContext(g_instance->global_context);
+		for (ThreadContext* ctx : g_instance->contexts) writeContext(*ctx);
+	}
+	writeStrings(footer, task->strings);
+
+	bool res = !task->io_error && task->file.write(footer.data(), footer.size());
+	task->file.close();
+	LUMIX_DELETE(g_instance->tag_allocator, task);
+	g_instance->capture_task = nullptr;
+	return res;
+}
+
+bool isCapturing() {
+	return g_instance->capture_task != nullptr;
+}
+
 void init(IAllocator& allocator) {
 	g_instance.create(allocator);
+	g_instance->hw_counters_enabled = CommandLineParser::isOn("-profile_hw_counters");
+
+	char cmd_line[2048];
+	os::getCommandLine(Span(cmd_line));
+	CommandLineParser parser(cmd_line);
+	while (parser.next()) {
+		if (!parser.currentEquals("-profile_capture")) continue;
+		if (!parser.next()) break;
+
+		char path[MAX_PATH];
+		parser.getCurrent(path, lengthOf(path));
+		startCapture(path);
+		break;
+	}
 }
 
 void shutdown() {
+	stopCapture();
 	g_instance.destroy();
 }
 
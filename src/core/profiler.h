@@ -35,10 +35,27 @@ LUMIX_CORE_API void pushCounter(u32 counter, float value);
 LUMIX_CORE_API void beginGPUBlock(const char* name, u64 timestamp, i64 profiler_link);
 LUMIX_CORE_API void endGPUBlock(u64 timestamp);
 LUMIX_CORE_API void gpuStats(u64 primitives_generated);
+
+struct GPUPipelineStats {
+	u64 input_primitives;
+	u64 vs_invocations;
+	u64 culled_primitives; // input primitives which did not survive clipping
+	u64 ps_invocations;
+};
+
+// attach pipeline stats to the innermost open GPU block, call before endGPUBlock
+LUMIX_CORE_API void gpuPipelineStats(const GPUPipelineStats& stats);
 LUMIX_CORE_API void link(i64 link);
 LUMIX_CORE_API i64 createNewLinkID();
 LUMIX_CORE_API void serialize(OutputMemoryStream& blob);
 
+// headless capture, all events are streamed to a file until stopCapture, profiler UI can load the file
+// started automatically in init() with `-profile_capture <path>`, stopped in shutdown()
+// serialize() must not be called while capturing
+LUMIX_CORE_API bool startCapture(const char* path);
+LUMIX_CORE_API bool stopCapture();
+LUMIX_CORE_API bool isCapturing();
+
 struct FiberSwitchData {
 	i32 id;
 	i32 blocks[16];
@@ -51,6 +68,9 @@ LUMIX_CORE_API void signalTriggered(i32 job_system_signal);
 LUMIX_CORE_API FiberSwitchData beginFiberWait(i32 job_system_signal);
 LUMIX_CORE_API void endFiberWait(const FiberSwitchData& switch_data);
 LUMIX_CORE_API float getLastFrameDuration();
+// read hardware performance counters at block boundaries, also enabled by `-profile_hw_counters`
+LUMIX_CORE_API void enableHWCounters(bool enable);
+LUMIX_CORE_API bool hwCountersEnabled();
 
 struct Scope
 {
@@ -70,10 +90,24 @@ struct GPUScopeStats {
 	float min;
 	float max;
 	float avg;
+	bool has_pipeline_stats;
+	GPUPipelineStats pipeline_stats; // from the last frame, if the scope has them
 };
 
 LUMIX_CORE_API u32 getGPUScopeStats(Span<GPUScopeStats> out);
 
+// inclusive CPU time of blocks, summed over all threads, ticks are in frequency() units
+// blocks interrupted by a fiber switch are not included
+struct BlockStats {
+	const char* name;
+	u64 total_ticks;
+	u32 count;
+};
+
+// resets stats, accumulating them makes endBlock slower, so it's off by default
+LUMIX_CORE_API void enableBlockStats(bool enable);
+LUMIX_CORE_API u32 getBlockStats(Span<BlockStats> out);
+
 struct ContextSwitchRecord
 {
 	u32 old_thread_id;
@@ -117,6 +151,16 @@ struct FiberWaitRecord
 	i32 job_system_signal;
 };
 
+// cumulative values, difference between begin and end record of a block is the block's cost
+struct HWCountersRecord {
+	u64 cycles;
+	u64 instructions;
+	u64 l1d_misses;
+	u64 llc_misses;
+	u64 branch_misses;
+	bool is_end;
+};
+
 struct MutexEvent {
 	u64 mutex_id;
 	u64 begin_enter;
@@ -152,7 +196,8 @@ enum class EventType : u8
 	CONTINUE_BLOCK,
 	SIGNAL_TRIGGERED,
 	COUNTER,
-	MUTEX_EVENT
+	MUTEX_EVENT,
+	HW_COUNTERS
 };
 
 #pragma pack(1)
@@ -1,10 +1,107 @@
 #pragma once
 
-#include "core/array.h"
-#include "core/sync.h"
+#include "core/allocator.h"
+#include "core/atomic.h"
 
 namespace Lumix {
 
+// lock-free MPMC stack, grows by allocating segments of nodes
+// nodes are never freed until the stack is destroyed, so concurrent pop can always read node->next
+// head pointers are tagged with a counter in the upper 16 bits to prevent ABA
+template <typename T>
+struct LockFreeStack {
+	struct Node {
+		T value;
+		Node* next;
+	};
+
+	struct Segment {
+		Segment* next;
+		Node nodes[64];
+	};
+
+	LockFreeStack(IAllocator& allocator) : m_allocator(allocator) {}
+
+	~LockFreeStack() {
+		Segment* s = (Segment*)m_segments;
+		while (s) {
+			Segment* next = s->next;
+			m_allocator.deallocate(s);
+			s = next;
+		}
+	}
+
+	LockFreeStack(const LockFreeStack&) = delete;
+	void operator=(const LockFreeStack&) = delete;
+
+	void push(const T& value) {
+		Node* node = popNode(m_free_nodes);
+		if (!node) node = allocSegment();
+		node->value = value;
+		pushNode(m_values, node);
+	}
+
+	bool pop(T& value) {
+		for (;;) {
+			const i64 head = m_values;
+			Node* node = getPtr(head);
+			if (!node) return false;
+			// node can be popped and reused by somebody else, so we read value before we own it, and discard it if CAS fails
+			value = node->value;
+			if (m_values.compareExchange(makeTagged(node->next, head), head)) {
+				pushNode(m_free_nodes, node);
+				return true;
+			}
+		}
+	}
+
+	bool empty() const { return getPtr(m_values) == nullptr; }
+
+private:
+	static Node* getPtr(i64 tagged) { return (Node*)(tagged & 0x0000ffFFffFFffFF); }
+	static i64 makeTagged(Node* ptr, i64 prev) {
+		const u64 tag = (u64(prev) >> 48) + 1;
+		return i64((tag << 48) | (u64)(uintptr)ptr);
+	}
+
+	static void pushNode(AtomicI64& head, Node* node) {
+		for (;;) {
+			const i64 old = head;
+			node->next = getPtr(old);
+			if (head.compareExchange(makeTagged(node, old), old)) return;
+		}
+	}
+
+	static Node* popNode(AtomicI64& head) {
+		for (;;) {
+			const i64 old = head;
+			Node* node = getPtr(old);
+			if (!node) return nullptr;
+			if (head.compareExchange(makeTagged(node->next, old), old)) return node;
+		}
+	}
+
+	// returns one node from the new segment, the rest is pushed to free nodes
+	Node* allocSegment() {
+		Segment* segment = (Segment*)m_allocator.allocate(sizeof(Segment), alignof(Segment));
+		for (;;) {
+			Segment* head = (Segment*)m_segments;
+			segment->next = head;
+			if (compareExchangePtr(&m_segments, segment, head)) break;
+		}
+		for (u32 i = 1; i < lengthOf(segment->nodes); ++i) {
+			pushNode(m_free_nodes, &segment->nodes[i]);
+		}
+		return &segment->nodes[0];
+	}
+
+	IAllocator& m_allocator;
+	AtomicI64 m_values = 0;
+	AtomicI64 m_free_nodes = 0;
+	void* volatile m_segments = nullptr;
+};
+
+// lock-free MPMC ring buffer, if it's full, it falls back to lock-free growable stack
 template <typename T, u32 CAPACITY>
 struct RingBuffer {
 	struct Item {
@@ -29,11 +126,7 @@ struct RingBuffer {
 			const i32 seq = j->seq;
 			if (seq < pos + 1) {
 				// nothing to pop, try fallback
-				MutexGuard guard(mutex);
-				if (m_fallback.empty()) return false;
-				obj = m_fallback.back();
-				m_fallback.pop();
-				return true;
+				return m_fallback.pop(obj);
 			}
 			else if (seq == pos + 1) {
 				// try to pop
@@ -55,9 +148,7 @@ struct RingBuffer {
 			const i32 seq = j->seq;
 			if (seq < pos) {
 				// buffer full
-				mutex.enter();
 				m_fallback.push(obj);
-				mutex.exit();
 				return;
 			}
 			else if (seq == pos) {
@@ -76,8 +167,7 @@ struct RingBuffer {
 	Item objects[CAPACITY];
 	AtomicI32 rd = 0;
 	AtomicI32 wr = 0;
-	Array<T> m_fallback;
-	Lumix::Mutex mutex;
+	LockFreeStack<T> m_fallback;
 };
 
 
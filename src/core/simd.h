@@ -12,6 +12,14 @@
 	#include <string.h>
 #endif
 
+#if defined __AVX2__
+	#define LUMIX_SIMD_AVX2
+	#include <immintrin.h>
+#elif defined __ARM_NEON
+	#define LUMIX_SIMD_NEON
+	#include <arm_neon.h>
+#endif
+
 namespace Lumix
 {
 
@@ -65,6 +73,17 @@ namespace Lumix
 		_mm_store_ps((float*)dest, src);
 	}
 
+	LUMIX_FORCE_INLINE void f4StoreUnaligned(void* dest, float4 src)
+	{
+		_mm_storeu_ps((float*)dest, src);
+	}
+
+	// 4x4 matrix transpose, e.g. 4 quaternions (xyzw) to xxxx, yyyy, zzzz, wwww
+	LUMIX_FORCE_INLINE void f4Transpose(float4& a, float4& b, float4& c, float4& d)
+	{
+		_MM_TRANSPOSE4_PS(a, b, c, d);
+	}
+
 	LUMIX_FORCE_INLINE float4 f4Blend(float4 false_val, float4 true_val, float4 mask)
 	{
 		return _mm_blendv_ps(false_val, true_val, mask);
@@ -216,6 +235,20 @@ namespace Lumix
 		(*(float4*)dest) = src;
 	}
 
+	LUMIX_FORCE_INLINE void f4StoreUnaligned(void* dest, float4 src)
+	{
+		memcpy(dest, &src, sizeof(src));
+	}
+
+	LUMIX_FORCE_INLINE void f4Transpose(float4& a, float4& b, float4& c, float4& d)
+	{
+		const float4 ta = a, tb = b, tc = c, td = d;
+		a = {ta.x, tb.x, tc.x, td.x};
+		b = {ta.y, tb.y, tc.y, td.y};
+		c = {ta.z, tb.z, tc.z, td.z};
+		d = {ta.w, tb.w, tc.w, td.w};
+	}
+
 	LUMIX_FORCE_INLINE float4 f4And(float4 a, float4 b)
 	{
 		static const float true_val = [](){
@@ -412,6 +445,134 @@ namespace Lumix
 
 #endif
 
+// 8-wide version of float4, AVX2 is used if the compiler targets it (/arch:AVX2, -mavx2, see --with-avx2 in genie)
+// NEON uses a pair of 128bit registers, everything else falls back to a pair of float4
+#if defined LUMIX_SIMD_AVX2
+	using float8 = __m256;
+
+	LUMIX_FORCE_INLINE float8 f8LoadUnaligned(const void* src) { return _mm256_loadu_ps((const float*)src); }
+	LUMIX_FORCE_INLINE float8 f8Load(const void* src) { return _mm256_load_ps((const float*)src); }
+	LUMIX_FORCE_INLINE float8 f8Splat(float value) { return _mm256_set1_ps(value); }
+	LUMIX_FORCE_INLINE void f8Store(void* dest, float8 src) { _mm256_store_ps((float*)dest, src); }
+	LUMIX_FORCE_INLINE void f8StoreUnaligned(void* dest, float8 src) { _mm256_storeu_ps((float*)dest, src); }
+	LUMIX_FORCE_INLINE float8 f8Blend(float8 false_val, float8 true_val, float8 mask) { return _mm256_blendv_ps(false_val, true_val, mask); }
+	LUMIX_FORCE_INLINE float8 f8CmpGT(float8 a, float8 b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	LUMIX_FORCE_INLINE float8 f8CmpLT(float8 a, float8 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	LUMIX_FORCE_INLINE float8 f8Or(float8 a, float8 b) { return _mm256_or_ps(a, b); }
+	LUMIX_FORCE_INLINE float8 f8And(float8 a, float8 b) { return _mm256_and_ps(a, b); }
+	LUMIX_FORCE_INLINE int f8MoveMask(float8 a) { return _mm256_movemask_ps(a); }
+	LUMIX_FORCE_INLINE float8 f8Add(float8 a, float8 b) { return _mm256_add_ps(a, b); }
+	LUMIX_FORCE_INLINE float8 f8Sub(float8 a, float8 b) { return _mm256_sub_ps(a, b); }
+	LUMIX_FORCE_INLINE float8 f8Mul(float8 a, float8 b) { return _mm256_mul_ps(a, b); }
+	LUMIX_FORCE_INLINE float8 f8Div(float8 a, float8 b) { return _mm256_div_ps(a, b); }
+	LUMIX_FORCE_INLINE float8 f8Sqrt(float8 a) { return _mm256_sqrt_ps(a); }
+	LUMIX_FORCE_INLINE float8 f8Min(float8 a, float8 b) { return _mm256_min_ps(a, b); }
+	LUMIX_FORCE_INLINE float8 f8Max(float8 a, float8 b) { return _mm256_max_ps(a, b); }
+
+	// gcc and clang have builtin operators for vector types
+	#if defined _MSC_VER && !defined __clang__
+		LUMIX_FORCE_INLINE float8 operator +(float8 a, float8 b) { return _mm256_add_ps(a, b); }
+		LUMIX_FORCE_INLINE float8 operator -(float8 a, float8 b) { return _mm256_sub_ps(a, b); }
+		LUMIX_FORCE_INLINE float8 operator *(float8 a, float8 b) { return _mm256_mul_ps(a, b); }
+	#endif
+#elif defined LUMIX_SIMD_NEON
+	struct float8 {
+		float32x4_t lo, hi;
+	};
+
+	LUMIX_FORCE_INLINE float8 f8LoadUnaligned(const void* src) { return { vld1q_f32((const float*)src), vld1q_f32((const float*)src + 4) }; }
+	LUMIX_FORCE_INLINE float8 f8Load(const void* src) { return f8LoadUnaligned(src); }
+	LUMIX_FORCE_INLINE float8 f8Splat(float value) { return { vdupq_n_f32(value), vdupq_n_f32(value) }; }
+	LUMIX_FORCE_INLINE void f8StoreUnaligned(void* dest, float8 src) {
+		vst1q_f32((float*)dest, src.lo);
+		vst1q_f32((float*)dest + 4, src.hi);
+	}
+	LUMIX_FORCE_INLINE void f8Store(void* dest, float8 src) { f8StoreUnaligned(dest, src); }
+
+	// only sign bit of mask is used, same as on x86
+	LUMIX_FORCE_INLINE float8 f8Blend(float8 false_val, float8 true_val, float8 mask) {
+		const uint32x4_t lo = vreinterpretq_u32_s32(vshrq_n_s32(vreinterpretq_s32_f32(mask.lo), 31));
+		const uint32x4_t hi = vreinterpretq_u32_s32(vshrq_n_s32(vreinterpretq_s32_f32(mask.hi), 31));
+		return { vbslq_f32(lo, true_val.lo, false_val.lo), vbslq_f32(hi, true_val.hi, false_val.hi) };
+	}
+
+	LUMIX_FORCE_INLINE float8 f8CmpGT(float8 a, float8 b) {
+		return { vreinterpretq_f32_u32(vcgtq_f32(a.lo, b.lo)), vreinterpretq_f32_u32(vcgtq_f32(a.hi, b.hi)) };
+	}
+
+	LUMIX_FORCE_INLINE float8 f8CmpLT(float8 a, float8 b) {
+		return { vreinterpretq_f32_u32(vcltq_f32(a.lo, b.lo)), vreinterpretq_f32_u32(vcltq_f32(a.hi, b.hi)) };
+	}
+
+	LUMIX_FORCE_INLINE float8 f8Or(float8 a, float8 b) {
+		return {
+			vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a.lo), vreinterpretq_u32_f32(b.lo))),
+			vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a.hi), vreinterpretq_u32_f32(b.hi)))
+		};
+	}
+
+	LUMIX_FORCE_INLINE float8 f8And(float8 a, float8 b) {
+		return {
+			vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a.lo), vreinterpretq_u32_f32(b.lo))),
+			vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a.hi), vreinterpretq_u32_f32(b.hi)))
+		};
+	}
+
+	LUMIX_FORCE_INLINE int f8MoveMask(float8 a) {
+		static const uint32_t weights_lo[4] = { 1, 2, 4, 8 };
+		static const uint32_t weights_hi[4] = { 16, 32, 64, 128 };
+		const uint32x4_t lo = vmulq_u32(vshrq_n_u32(vreinterpretq_u32_f32(a.lo), 31), vld1q_u32(weights_lo));
+		const uint32x4_t hi = vmulq_u32(vshrq_n_u32(vreinterpretq_u32_f32(a.hi), 31), vld1q_u32(weights_hi));
+		return (int)vaddvq_u32(vorrq_u32(lo, hi));
+	}
+
+	LUMIX_FORCE_INLINE float8 f8Add(float8 a, float8 b) { return { vaddq_f32(a.lo, b.lo), vaddq_f32(a.hi, b.hi) }; }
+	LUMIX_FORCE_INLINE float8 f8Sub(float8 a, float8 b) { return { vsubq_f32(a.lo, b.lo), vsubq_f32(a.hi, b.hi) }; }
+	LUMIX_FORCE_INLINE float8 f8Mul(float8 a, float8 b) { return { vmulq_f32(a.lo, b.lo), vmulq_f32(a.hi, b.hi) }; }
+	LUMIX_FORCE_INLINE float8 f8Div(float8 a, float8 b) { return { vdivq_f32(a.lo, b.lo), vdivq_f32(a.hi, b.hi) }; }
+	LUMIX_FORCE_INLINE float8 f8Sqrt(float8 a) { return { vsqrtq_f32(a.lo), vsqrtq_f32(a.hi) }; }
+	LUMIX_FORCE_INLINE float8 f8Min(float8 a, float8 b) { return { vminq_f32(a.lo, b.lo), vminq_f32(a.hi, b.hi) }; }
+	LUMIX_FORCE_INLINE float8 f8Max(float8 a, float8 b) { return { vmaxq_f32(a.lo, b.lo), vmaxq_f32(a.hi, b.hi) }; }
+	LUMIX_FORCE_INLINE float8 operator +(float8 a, float8 b) { return f8Add(a, b); }
+	LUMIX_FORCE_INLINE float8 operator -(float8 a, float8 b) { return f8Sub(a, b); }
+	LUMIX_FORCE_INLINE float8 operator *(float8 a, float8 b) { return f8Mul(a, b); }
+#else
+	struct float8 {
+		float4 lo, hi;
+	};
+
+	LUMIX_FORCE_INLINE float8 f8LoadUnaligned(const void* src) { return { f4LoadUnaligned(src), f4LoadUnaligned((const float*)src + 4) }; }
+	LUMIX_FORCE_INLINE float8 f8Load(const void* src) { return { f4Load(src), f4Load((const float*)src + 4) }; }
+	LUMIX_FORCE_INLINE float8 f8Splat(float value) { return { f4Splat(value), f4Splat(value) }; }
+	LUMIX_FORCE_INLINE void f8Store(void* dest, float8 src) {
+		f4Store(dest, src.lo);
+		f4Store((float*)dest + 4, src.hi);
+	}
+	LUMIX_FORCE_INLINE void f8StoreUnaligned(void* dest, float8 src) {
+		const float* from = (const float*)&src;
+		float* to = (float*)dest;
+		for (int i = 0; i < 8; ++i) to[i] = from[i];
+	}
+	LUMIX_FORCE_INLINE float8 f8Blend(float8 false_val, float8 true_val, float8 mask) {
+		return { f4Blend(false_val.lo, true_val.lo, mask.lo), f4Blend(false_val.hi, true_val.hi, mask.hi) };
+	}
+	LUMIX_FORCE_INLINE float8 f8CmpGT(float8 a, float8 b) { return { f4CmpGT(a.lo, b.lo), f4CmpGT(a.hi, b.hi) }; }
+	LUMIX_FORCE_INLINE float8 f8CmpLT(float8 a, float8 b) { return { f4CmpLT(a.lo, b.lo), f4CmpLT(a.hi, b.hi) }; }
+	LUMIX_FORCE_INLINE float8 f8Or(float8 a, float8 b) { return { f4Or(a.lo, b.lo), f4Or(a.hi, b.hi) }; }
+	LUMIX_FORCE_INLINE float8 f8And(float8 a, float8 b) { return { f4And(a.lo, b.lo), f4And(a.hi, b.hi) }; }
+	LUMIX_FORCE_INLINE int f8MoveMask(float8 a) { return f4MoveMask(a.lo) | (f4MoveMask(a.hi) << 4); }
+	LUMIX_FORCE_INLINE float8 f8Add(float8 a, float8 b) { return { f4Add(a.lo, b.lo), f4Add(a.hi, b.hi) }; }
+	LUMIX_FORCE_INLINE float8 f8Sub(float8 a, float8 b) { return { f4Sub(a.lo, b.lo), f4Sub(a.hi, b.hi) }; }
+	LUMIX_FORCE_INLINE float8 f8Mul(float8 a, float8 b) { return { f4Mul(a.lo, b.lo), f4Mul(a.hi, b.hi) }; }
+	LUMIX_FORCE_INLINE float8 f8Div(float8 a, float8 b) { return { f4Div(a.lo, b.lo), f4Div(a.hi, b.hi) }; }
+	LUMIX_FORCE_INLINE float8 f8Sqrt(float8 a) { return { f4Sqrt(a.lo), f4Sqrt(a.hi) }; }
+	LUMIX_FORCE_INLINE float8 f8Min(float8 a, float8 b) { return { f4Min(a.lo, b.lo), f4Min(a.hi, b.hi) }; }
+	LUMIX_FORCE_INLINE float8 f8Max(float8 a, float8 b) { return { f4Max(a.lo, b.lo), f4Max(a.hi, b.hi) }; }
+	LUMIX_FORCE_INLINE float8 operator +(float8 a, float8 b) { return f8Add(a, b); }
+	LUMIX_FORCE_INLINE float8 operator -(float8 a, float8 b) { return f8Sub(a, b); }
+	LUMIX_FORCE_INLINE float8 operator *(float8 a, float8 b) { return f8Mul(a, b); }
+#endif
+
 
 
 } // namespace Lumix
\ No newline at end of file
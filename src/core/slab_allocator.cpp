@@ -0,0 +1,285 @@
+#include "core/slab_allocator.h"
+#include "core/crt.h"
+#include "core/math.h"
+#include "core/os.h"
+#include "core/tag_allocator.h"
+
+namespace Lumix {
+
+static constexpr u32 SLAB_PAGE_SIZE = 4096;
+static constexpr u64 SLAB_RESERVED_SIZE = 1024 * 1024 * 1024;
+static constexpr u32 SIZE_CLASSES[] = { 8, 16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024 };
+static_assert(lengthOf(SIZE_CLASSES) == SlabAllocator::NUM_SIZE_CLASSES);
+static_assert(SIZE_CLASSES[SlabAllocator::NUM_SIZE_CLASSES - 1] == SlabAllocator::MAX_SIZE);
+
+#ifdef LUMIX_DEBUG
+	static const char* SIZE_CLASS_TAGS[] = { "slab 8B", "slab 16B", "slab 32B", "slab 48B", "slab 64B", "slab 96B", "slab 128B"
+		, "slab 192B", "slab 256B", "slab 384B", "slab 512B", "slab 768B", "slab 1024B" };
+	static_assert(lengthOf(SIZE_CLASS_TAGS) == SlabAllocator::NUM_SIZE_CLASSES);
+#endif
+
+// maps (size + 7) / 8 to size class
+struct SizeClassTable {
+	constexpr SizeClassTable() : map() {
+		u32 c = 0;
+		for (u32 i = 0; i <= SlabAllocator::MAX_SIZE / 8; ++i) {
+			while (SIZE_CLASSES[c] < i * 8) ++c;
+			map[i] = u8(c);
+		}
+	}
+	u8 map[SlabAllocator::MAX_SIZE / 8 + 1];
+};
+
+static constexpr SizeClassTable s_size_class_table;
+
+// number of slots moved between thread cache and pages at once
+static u32 getBatchSize(u32 size_class) {
+	return clamp(2048 / SIZE_CLASSES[size_class], 4u, 64u);
+}
+
+struct SlabAllocator::Page {
+	struct Header {
+		Page* next;
+		Page* prev;
+		void* free_list;
+		u32 bump_offset; // slots after this offset were never allocated
+		u32 size_class;
+		bool in_partial_list;
+	};
+
+	static constexpr u32 DATA_OFFSET = 64;
+	static_assert(sizeof(Header) <= DATA_OFFSET);
+
+	void* popSlot() {
+		if (header.free_list) {
+			void* res = header.free_list;
+			header.free_list = *(void**)res;
+			return res;
+		}
+		const u32 size = SIZE_CLASSES[header.size_class];
+		if (header.bump_offset + size > SLAB_PAGE_SIZE) return nullptr;
+		void* res = (u8*)this + header.bump_offset;
+		header.bump_offset += size;
+		return res;
+	}
+
+	bool isExhausted() const {
+		return !header.free_list && header.bump_offset + SIZE_CLASSES[header.size_class] > SLAB_PAGE_SIZE;
+	}
+
+	Header header;
+};
+
+static SlabAllocator::Page* getPage(void* ptr) {
+	return (SlabAllocator::Page*)((uintptr)ptr & ~uintptr(SLAB_PAGE_SIZE - 1));
+}
+
+static AtomicI32 g_slab_allocator_id = 1;
+
+// maps allocators to thread caches, a thread can use several slab allocators
+struct ThreadCacheLink {
+	u32 allocator_id = 0;
+	SlabAllocator::ThreadCache* cache = nullptr;
+};
+static thread_local ThreadCacheLink t_thread_cache_links[4];
+
+SlabAllocator::SlabAllocator(IAllocator& parent)
+	: m_parent(parent)
+	, m_reserved(SLAB_RESERVED_SIZE)
+	, m_id(g_slab_allocator_id.inc())
+{
+	m_memory = (u8*)os::memReserve(m_reserved);
+	#ifdef LUMIX_DEBUG
+		for (u32 i = 0; i < NUM_SIZE_CLASSES; ++i) {
+			SizeClass& c = m_size_classes[i];
+			c.tag_allocator = LUMIX_NEW(m_parent, TagAllocator)(m_parent, SIZE_CLASS_TAGS[i]);
+			c.allocation_info.flags = debug::AllocationInfo::IS_PAGED;
+			c.allocation_info.tag = c.tag_allocator;
+			c.allocation_info.size = 0;
+			debug::registerAlloc(c.allocation_info);
+		}
+	#endif
+}
+
+SlabAllocator::~SlabAllocator() {
+	#ifdef LUMIX_DEBUG
+		for (SizeClass& c : m_size_classes) {
+			debug::unregisterAlloc(c.allocation_info);
+			LUMIX_DELETE(m_parent, c.tag_allocator);
+		}
+	#endif
+	os::memRelease(m_memory, m_reserved);
+}
+
+SlabAllocator::ThreadCache* SlabAllocator::getThreadCache() {
+	for (ThreadCacheLink& link : t_thread_cache_links) {
+		if (link.allocator_id == m_id) return link.cache;
+	}
+
+	// first allocation from this thread, links to dead allocators are reused first
+	ThreadCacheLink* link = &t_thread_cache_links[0];
+	for (ThreadCacheLink& l : t_thread_cache_links) {
+		if (l.allocator_id < link->allocator_id) link = &l;
+	}
+	const i32 idx = m_thread_caches_count.inc();
+	// if there are too many threads, the rest uses the locked path
+	// if a link is overwritten, the old cache is abandoned, it's rare enough to not matter
+	link->allocator_id = m_id;
+	link->cache = idx < (i32)MAX_THREAD_CACHES ? &m_thread_caches[idx] : nullptr;
+	return link->cache;
+}
+
+SlabAllocator::Page* SlabAllocator::newPage(u32 size_class) {
+	const i32 idx = m_page_count.inc();
+	if (u64(idx + 1) * SLAB_PAGE_SIZE > m_reserved) return nullptr;
+
+	Page* page = (Page*)(m_memory + u64(idx) * SLAB_PAGE_SIZE);
+	os::memCommit(page, SLAB_PAGE_SIZE);
+	page->header.next = nullptr;
+	page->header.prev = nullptr;
+	page->header.free_list = nullptr;
+	page->header.bump_offset = Page::DATA_OFFSET;
+	page->header.size_class = size_class;
+	page->header.in_partial_list = false;
+
+	SizeClass& c = m_size_classes[size_class];
+	++c.page_count;
+	#ifdef LUMIX_DEBUG
+		debug::resizeAlloc(c.allocation_info, u64(c.page_count) * SLAB_PAGE_SIZE);
+	#endif
+	return page;
+}
+
+u32 SlabAllocator::popSlots(u32 size_class, u32 count, void*& out) {
+	SizeClass& c = m_size_classes[size_class];
+	MutexGuard guard(c.mutex);
+
+	u32 res = 0;
+	while (res < count) {
+		Page* page = c.partial_pages;
+		if (!page) {
+			page = newPage(size_class);
+			if (!page) break;
+			page->header.in_partial_list = true;
+			c.partial_pages = page;
+		}
+
+		while (res < count) {
+			void* slot = page->popSlot();
+			if (!slot) break;
+			*(void**)slot = out;
+			out = slot;
+			++res;
+		}
+
+		if (page->isExhausted()) {
+			c.partial_pages = page->header.next;
+			if (page->header.next) page->header.next->header.prev = nullptr;
+			page->header.next = nullptr;
+			page->header.in_partial_list = false;
+		}
+	}
+	return res;
+}
+
+void SlabAllocator::pushSlots(u32 size_class, void* slots) {
+	SizeClass& c = m_size_classes[size_class];
+	MutexGuard guard(c.mutex);
+	while (slots) {
+		void* next = *(void**)slots;
+		Page* page = getPage(slots);
+		*(void**)slots = page->header.free_list;
+		page->header.free_list = slots;
+		if (!page->header.in_partial_list) {
+			page->header.in_partial_list = true;
+			page->header.prev = nullptr;
+			page->header.next = c.partial_pages;
+			if (c.partial_pages) c.partial_pages->header.prev = page;
+			c.partial_pages = page;
+		}
+		slots = next;
+	}
+}
+
+void* SlabAllocator::allocSmall(u32 size_class) {
+	ThreadCache* cache = getThreadCache();
+	if (!cache) {
+		void* slot = nullptr;
+		popSlots(size_class, 1, slot);
+		return slot;
+	}
+
+	if (!cache->free_slots[size_class]) {
+		cache->counts[size_class] = popSlots(size_class, getBatchSize(size_class), cache->free_slots[size_class]);
+		if (!cache->free_slots[size_class]) return nullptr;
+	}
+
+	void* res = cache->free_slots[size_class];
+	cache->free_slots[size_class] = *(void**)res;
+	--cache->counts[size_class];
+	return res;
+}
+
+void SlabAllocator::freeSmall(void* ptr) {
+	const u32 size_class = getPage(ptr)->header.size_class;
+	ThreadCache* cache = getThreadCache();
+	if (!cache) {
+		*(void**)ptr = nullptr;
+		pushSlots(size_class, ptr);
+		return;
+	}
+
+	*(void**)ptr = cache->free_slots[size_class];
+	cache->free_slots[size_class] = ptr;
+	++cache->counts[size_class];
+
+	// too many cached slots, return a batch to pages, so other threads can use them
+	const u32 batch = getBatchSize(size_class);
+	if (cache->counts[size_class] > 2 * batch) {
+		void* to_push = cache->free_slots[size_class];
+		void* last = to_push;
+		for (u32 i = 1; i < batch; ++i) last = *(void**)last;
+		cache->free_slots[size_class] = *(void**)last;
+		*(void**)last = nullptr;
+		cache->counts[size_class] -= batch;
+		pushSlots(size_class, to_push);
+	}
+}
+
+void* SlabAllocator::allocate(size_t size, size_t align) {
+	const size_t effective_size = maximum(size, align);
+	if (effective_size <= MAX_SIZE && align <= 16 && size > 0) {
+		void* res = allocSmall(s_size_class_table.map[(effective_size + 7) / 8]);
+		if (res) return res;
+	}
+	return m_parent.allocate(size, align);
+}
+
+void SlabAllocator::deallocate(void* ptr) {
+	if (!ptr) return;
+	if (isSmall(ptr)) {
+		freeSmall(ptr);
+		return;
+	}
+	m_parent.deallocate(ptr);
+}
+
+void* SlabAllocator::reallocate(void* ptr, size_t new_size, size_t old_size, size_t align) {
+	if (!ptr) return allocate(new_size, align);
+	if (!isSmall(ptr)) return m_parent.reallocate(ptr, new_size, old_size, align);
+
+	const u32 size_class = getPage(ptr)->header.size_class;
+	if (new_size == 0) {
+		freeSmall(ptr);
+		return nullptr;
+	}
+	if (new_size <= SIZE_CLASSES[size_class] && align <= 16) return ptr;
+
+	void* new_mem = allocate(new_size, align);
+	if (!new_mem) return nullptr;
+	memcpy(new_mem, ptr, minimum((size_t)SIZE_CLASSES[size_class], new_size));
+	freeSmall(ptr);
+	return new_mem;
+}
+
+} // namespace Lumix
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "allocator.h"
+#include "atomic.h"
+#include "sync.h"
+#ifdef LUMIX_DEBUG
+	#include "debug.h"
+#endif
+
+namespace Lumix {
+
+struct TagAllocator;
+
+// size-class allocator for small objects (<= MAX_SIZE), bigger allocations go to parent
+// slots are carved from 4KB pages in a reserved address range, pages are never released until destruction
+// each thread has its own cache of free slots per size class, so most allocations and deallocations do not lock
+// use case: lots of small allocations from many threads, e.g. HashMap, Array, String and Path while loading big worlds
+struct LUMIX_CORE_API SlabAllocator final : IAllocator {
+	static constexpr u32 MAX_SIZE = 1024;
+	static constexpr u32 NUM_SIZE_CLASSES = 13;
+	static constexpr u32 MAX_THREAD_CACHES = 128;
+
+	explicit SlabAllocator(IAllocator& parent);
+	~SlabAllocator();
+
+	void* allocate(size_t size, size_t align) override;
+	void deallocate(void* ptr) override;
+	void* reallocate(void* ptr, size_t new_size, size_t old_size, size_t align) override;
+
+	struct Page;
+
+	struct SizeClass {
+		Mutex mutex;
+		Page* partial_pages = nullptr; // pages with at least one free slot
+		u32 page_count = 0;
+		#ifdef LUMIX_DEBUG
+			debug::AllocationInfo allocation_info;
+			TagAllocator* tag_allocator = nullptr;
+		#endif
+	};
+
+	// only accessed by the thread owning the cache
+	struct alignas(64) ThreadCache {
+		void* free_slots[NUM_SIZE_CLASSES] = {};
+		u32 counts[NUM_SIZE_CLASSES] = {};
+	};
+
+private:
+	bool isSmall(const void* ptr) const { return ptr >= m_memory && ptr < m_memory + m_reserved; }
+	ThreadCache* getThreadCache();
+	void* allocSmall(u32 size_class);
+	void freeSmall(void* ptr);
+	// move at most `count` free slots from pages to linked list `out`, returns number of moved slots
+	u32 popSlots(u32 size_class, u32 count, void*& out);
+	// return linked list of slots to their pages
+	void pushSlots(u32 size_class, void* slots);
+	Page* newPage(u32 size_class);
+
+	IAllocator& m_parent;
+	u8* m_memory;
+	u64 m_reserved;
+	AtomicI32 m_page_count = 0;
+	u32 m_id; // unique for each SlabAllocator, used to identify thread caches
+	SizeClass m_size_classes[NUM_SIZE_CLASSES];
+	ThreadCache m_thread_caches[MAX_THREAD_CACHES];
+	AtomicI32 m_thread_caches_count = 0;
+};
+
+} // namespace Lumix
@@ -1,5 +1,12 @@
 #pragma once
 
+#include "core/allocator.h"
+#include "core/array.h"
+#include "core/crt.h"
+#include "core/job_system.h"
+#include "core/math.h"
+#include "core/metaprogramming.h"
+
 namespace Lumix {
 	template <typename T>
 	void insertSort(T* from, T* to) {
@@ -105,4 +112,211 @@ namespace Lumix {
 		sort(from, from + pivot_pos, depth + 1);
 		sort(from + pivot_pos + 1, to, depth + 1);
 	}
+
+	namespace detail {
+		static constexpr u32 RADIX_BITS = 11;
+		static constexpr u32 RADIX_SIZE = 1 << RADIX_BITS;
+		static constexpr u32 RADIX_MASK = RADIX_SIZE - 1;
+		// minimal number of elements processed by a single job
+		static constexpr u32 PARALLEL_SORT_MIN_CHUNK = 16 * 1024;
+
+		// `values` can be null if Value is void
+		template <typename Key, typename Value>
+		void radixSort(Key* keys, Value* values, u32 size, IAllocator& allocator) {
+			static_assert(Key(0) < Key(-1), "Key must be an unsigned integer");
+			constexpr bool HAS_VALUES = !IsSame<Value, void>::Value;
+			if (size < 2) return;
+
+			u32 num_chunks = (size + PARALLEL_SORT_MIN_CHUNK - 1) / PARALLEL_SORT_MIN_CHUNK;
+			num_chunks = minimum(num_chunks, (u32)jobs::getWorkersCount());
+			const u32 chunk_size = (size + num_chunks - 1) / num_chunks;
+
+			// each chunk has its own histogram, which is then turned into chunk's scatter offsets
+			// so chunks can scatter in parallel and the sort stays stable
+			Array<u32> histograms(allocator);
+			histograms.resize(num_chunks * RADIX_SIZE);
+
+			// bits which are not the same in all keys, digits are placed only over these bits
+			// so e.g. keys using only 20 bits need 2 passes instead of 6 and constant digits are never read
+			Array<Key> chunk_varying_bits(allocator);
+			chunk_varying_bits.resize(num_chunks);
+			jobs::forEach(num_chunks, 1, [&](u32 chunk, u32){
+				const u32 from = minimum(size, chunk * chunk_size);
+				const u32 to = minimum(size, from + chunk_size);
+				Key all_or = 0;
+				Key all_and = Key(-1);
+				for (u32 i = from; i < to; ++i) {
+					all_or |= keys[i];
+					all_and &= keys[i];
+				}
+				// keys[0] makes the result the same as for one chunk containing all keys
+				chunk_varying_bits[chunk] = (all_or ^ all_and) | (from < to ? (keys[from] ^ keys[0]) : 0);
+			});
+			Key varying_bits = 0;
+			for (Key bits : chunk_varying_bits) varying_bits |= bits;
+			if (varying_bits == 0) return;
+
+			constexpr u32 KEY_BITS = sizeof(Key) * 8;
+			auto nextVaryingBit = [&](u32 bit) {
+				while (bit < KEY_BITS && ((varying_bits >> bit) & 1) == 0) ++bit;
+				return bit;
+			};
+
+			u8* tmp_mem = nullptr;
+			Key* src_keys = keys;
+			Key* dst_keys = nullptr;
+			Value* src_values = values;
+			Value* dst_values = nullptr;
+
+			for (u32 shift = nextVaryingBit(0); shift < KEY_BITS; shift = nextVaryingBit(shift + RADIX_BITS)) {
+				AtomicI32 unsorted_chunks = 0;
+				jobs::forEach(num_chunks, 1, [&](u32 chunk, u32){
+					u32* histogram = &histograms[chunk * RADIX_SIZE];
+					memset(histogram, 0, sizeof(u32) * RADIX_SIZE);
+					const u32 from = minimum(size, chunk * chunk_size);
+					const u32 to = minimum(size, from + chunk_size);
+					bool sorted = true;
+					Key prev_key = src_keys[from > 0 ? from - 1 : 0];
+					for (u32 i = from; i < to; ++i) {
+						const Key key = src_keys[i];
+						++histogram[(key >> shift) & RADIX_MASK];
+						sorted &= prev_key <= key;
+						prev_key = key;
+					}
+					if (!sorted) unsorted_chunks.inc();
+				});
+
+				if (unsorted_chunks == 0) break;
+
+				u32 offset = 0;
+				for (u32 bucket = 0; bucket < RADIX_SIZE; ++bucket) {
+					for (u32 chunk = 0; chunk < num_chunks; ++chunk) {
+						u32& h = histograms[chunk * RADIX_SIZE + bucket];
+						const u32 count = h;
+						h = offset;
+						offset += count;
+					}
+				}
+
+				if (!tmp_mem) {
+					if constexpr (HAS_VALUES) {
+						const size_t values_offset = (sizeof(Key) * size + alignof(Value) - 1) & ~(alignof(Value) - 1);
+						tmp_mem = (u8*)allocator.allocate(values_offset + sizeof(Value) * size, maximum(alignof(Key), alignof(Value)));
+						dst_values = (Value*)(tmp_mem + values_offset);
+					}
+					else {
+						tmp_mem = (u8*)allocator.allocate(sizeof(Key) * size, alignof(Key));
+					}
+					dst_keys = (Key*)tmp_mem;
+				}
+
+				jobs::forEach(num_chunks, 1, [&](u32 chunk, u32){
+					u32* offsets = &histograms[chunk * RADIX_SIZE];
+					const u32 from = minimum(size, chunk * chunk_size);
+					const u32 to = minimum(size, from + chunk_size);
+					for (u32 i = from; i < to; ++i) {
+						const Key key = src_keys[i];
+						const u32 dst = offsets[(key >> shift) & RADIX_MASK]++;
+						dst_keys[dst] = key;
+						if constexpr (HAS_VALUES) dst_values[dst] = src_values[i];
+					}
+				});
+
+				swap(src_keys, dst_keys);
+				swap(src_values, dst_values);
+			}
+
+			if (src_keys != keys) {
+				memcpy(keys, src_keys, sizeof(Key) * size);
+				if constexpr (HAS_VALUES) memcpy(values, src_values, sizeof(Value) * size);
+			}
+			if (tmp_mem) allocator.deallocate(tmp_mem);
+		}
+
+		// writes `count` first elements of merged [a, a_end) and [b, b_end) to `out`, equal elements are taken from `a` first
+		template <typename T, typename LessThan>
+		void merge(const T* a, const T* a_end, const T* b, const T* b_end, T* out, u32 count, const LessThan& less_than) {
+			T* out_end = out + count;
+			while (out != out_end && a != a_end && b != b_end) {
+				if (less_than(*b, *a)) *out++ = *b++;
+				else *out++ = *a++;
+			}
+			while (out != out_end && a != a_end) *out++ = *a++;
+			while (out != out_end && b != b_end) *out++ = *b++;
+		}
+	} // namespace detail
+
+	// parallel LSD radix sort, `values` are reordered together with `keys`
+	// Key must be an unsigned integer, Value must be trivially copyable
+	// stable, returns early if keys are sorted, digits are placed only over bits which differ between keys
+	// uses jobs, temporary memory for a copy of keys and values is allocated from `allocator`
+	template <typename Key, typename Value>
+	void radixSort(Key* keys, Value* values, u32 size, IAllocator& allocator) {
+		static_assert(__is_trivially_copyable(Value));
+		detail::radixSort(keys, values, size, allocator);
+	}
+
+	template <typename Key>
+	void radixSort(Key* keys, u32 size, IAllocator& allocator) {
+		detail::radixSort<Key, void>(keys, nullptr, size, allocator);
+	}
+
+	// parallel merge sort, chunks are sorted by `sort` on workers and then merged in parallel
+	// not stable, T must be trivially copyable, small arrays are sorted serially without allocation
+	template <typename T, typename LessThan>
+	void parallelSort(T* from, T* to, LessThan less_than, IAllocator& allocator) {
+		static_assert(__is_trivially_copyable(T));
+		if (from >= to) return;
+		const u32 size = u32(to - from);
+
+		// power of two, so merged runs are always made from whole chunks
+		u32 num_chunks = 1;
+		const u32 num_workers = jobs::getWorkersCount();
+		while (num_chunks < num_workers && size / (num_chunks * 2) >= detail::PARALLEL_SORT_MIN_CHUNK) num_chunks *= 2;
+		if (num_chunks == 1) {
+			sort(from, to, less_than);
+			return;
+		}
+
+		const u32 chunk_size = (size + num_chunks - 1) / num_chunks;
+		jobs::forEach(num_chunks, 1, [&](u32 chunk, u32){
+			const u32 begin = minimum(size, chunk * chunk_size);
+			const u32 end = minimum(size, begin + chunk_size);
+			sort(from + begin, from + end, less_than);
+		});
+
+		T* tmp = (T*)allocator.allocate(sizeof(T) * size, alignof(T));
+		T* src = from;
+		T* dst = tmp;
+		for (u32 run = chunk_size; run < size; run *= 2) {
+			// each job writes one chunk of output, its inputs are found by binary search of the merge path
+			jobs::forEach(num_chunks, 1, [&](u32 chunk, u32){
+				const u32 out_begin = minimum(size, chunk * chunk_size);
+				const u32 count = minimum(size, out_begin + chunk_size) - out_begin;
+				const u32 a_begin = out_begin / (run * 2) * (run * 2);
+				const u32 b_begin = minimum(size, a_begin + run);
+				const u32 b_end = minimum(size, a_begin + run * 2);
+				const T* a = src + a_begin;
+				const T* b = src + b_begin;
+				const u32 a_size = b_begin - a_begin;
+				const u32 b_size = b_end - b_begin;
+				const u32 diagonal = out_begin - a_begin;
+
+				// number of elements taken from `a` for the first `diagonal` elements of output
+				u32 lo = diagonal > b_size ? diagonal - b_size : 0;
+				u32 hi = minimum(diagonal, a_size);
+				while (lo < hi) {
+					const u32 mid = (lo + hi) / 2;
+					if (less_than(b[diagonal - mid - 1], a[mid])) hi = mid;
+					else lo = mid + 1;
+				}
+
+				detail::merge(a + lo, a + a_size, b + diagonal - lo, b + b_size, dst + out_begin, count, less_than);
+			});
+			swap(src, dst);
+		}
+
+		if (src != from) memcpy(from, src, sizeof(T) * size);
+		allocator.deallocate(tmp);
+	}
 }
\ No newline at end of file
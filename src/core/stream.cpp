@@ -72,6 +72,11 @@ IOutputStream& IOutputStream::operator << (StringView str) {
 	return *this;
 }
 
+bool IOutputStream::writeString(StringView string) {
+	const char zero = 0;
+	return write(string.begin, string.size()) && write(&zero, 1);
+}
+
 IOutputStream& IOutputStream::operator << (i32 value)
 {
 	char tmp[20];
@@ -259,6 +264,53 @@ bool OutputPagedStream::write(const void* data, u64 size) {
 	return true;
 }
 
+static_assert(sizeof(OutputChunkedStream::Chunk) == OutputChunkedStream::CHUNK_SIZE);
+
+OutputChunkedStream::OutputChunkedStream(IAllocator& allocator)
+	: m_allocator(allocator)
+{}
+
+OutputChunkedStream::~OutputChunkedStream() {
+	clear();
+}
+
+void OutputChunkedStream::clear() {
+	Chunk* c = m_head;
+	while (c) {
+		Chunk* tmp = c;
+		c = c->next;
+		LUMIX_DELETE(m_allocator, tmp);
+	}
+	m_head = m_tail = nullptr;
+	m_size = 0;
+}
+
+bool OutputChunkedStream::write(const void* data, u64 size) {
+	const u8* src = (const u8*)data;
+	m_size += size;
+	while (size > 0) {
+		if (!m_tail || m_tail->size == sizeof(m_tail->data)) {
+			Chunk* chunk = LUMIX_NEW(m_allocator, Chunk);
+			if (m_tail) m_tail->next = chunk;
+			else m_head = chunk;
+			m_tail = chunk;
+		}
+		const u32 to_copy = (u32)minimum(size, u64(sizeof(m_tail->data) - m_tail->size));
+		memcpy(m_tail->data + m_tail->size, src, to_copy);
+		m_tail->size += to_copy;
+		src += to_copy;
+		size -= to_copy;
+	}
+	return true;
+}
+
+bool OutputChunkedStream::writeTo(IOutputStream& stream) const {
+	for (const Chunk* c = m_head; c; c = c->next) {
+		if (!stream.write(c->data, c->size)) return false;
+	}
+	return true;
+}
+
 InputPagedStream::InputPagedStream(const OutputPagedStream& src)
 	: m_page(src.m_head)
 {
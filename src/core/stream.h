@@ -17,6 +17,8 @@ struct LUMIX_CORE_API IOutputStream {
 	IOutputStream& operator << (u32 value);
 	IOutputStream& operator << (float value);
 	IOutputStream& operator << (double value);
+	// zero terminated
+	bool writeString(struct StringView string);
 	template <typename T> bool write(const T& value);
 	template <typename T> bool writeArray(const Array<T>& value);
 };
@@ -52,6 +54,39 @@ private:
 	Page* m_tail;
 };
 
+// Chain of big chunks, it grows without reallocating and copying already written data.
+// Use for big outputs (e.g. serialized worlds), chunks are written to files or compressed one by one, without flattening.
+struct LUMIX_CORE_API OutputChunkedStream final : IOutputStream {
+	static constexpr u32 CHUNK_SIZE = 64 * 1024;
+
+	struct Chunk {
+		Chunk* next = nullptr;
+		u32 size = 0;
+		u8 data[CHUNK_SIZE - sizeof(next) - sizeof(size)];
+	};
+
+	explicit OutputChunkedStream(struct IAllocator& allocator);
+	~OutputChunkedStream();
+	OutputChunkedStream(const OutputChunkedStream&) = delete;
+	void operator=(const OutputChunkedStream&) = delete;
+
+	bool write(const void* buffer, u64 size) override;
+	using IOutputStream::write;
+
+	u64 size() const { return m_size; }
+	void clear();
+	// all chunks except the last one are full
+	const Chunk* getFirstChunk() const { return m_head; }
+	// writes chunk by chunk
+	bool writeTo(IOutputStream& stream) const;
+
+private:
+	IAllocator& m_allocator;
+	Chunk* m_head = nullptr;
+	Chunk* m_tail = nullptr;
+	u64 m_size = 0;
+};
+
 struct LUMIX_CORE_API InputPagedStream final : IInputStream {
 	InputPagedStream(const OutputPagedStream& src);
 	bool read(void* buffer, u64 size) override;
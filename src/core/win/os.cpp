@@ -2,6 +2,7 @@
 #include "core/atomic.h"
 #include "core/log.h"
 #include "core/core.h"
+#include "core/math.h"
 #include "core/os.h"
 #include "core/profiler.h"
 #include "core/string.h"
@@ -196,6 +197,58 @@ bool InputFile::seek(u64 pos)
 }
 
 
+MappedFile::~MappedFile()
+{
+	ASSERT(!m_is_open);
+}
+
+
+bool MappedFile::open(const char* path)
+{
+	ASSERT(!m_is_open);
+	const HANDLE file = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER size;
+	if (!::GetFileSizeEx(file, &size)) {
+		::CloseHandle(file);
+		return false;
+	}
+
+	// empty files can not be mapped
+	if (size.QuadPart == 0) {
+		::CloseHandle(file);
+		m_data = nullptr;
+		m_size = 0;
+		m_is_open = true;
+		return true;
+	}
+
+	const HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	// the view keeps the file and the mapping alive
+	::CloseHandle(file);
+	if (!mapping) return false;
+
+	m_data = (const u8*)::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	::CloseHandle(mapping);
+	if (!m_data) return false;
+
+	m_size = size.QuadPart;
+	m_is_open = true;
+	return true;
+}
+
+
+void MappedFile::close()
+{
+	if (!m_is_open) return;
+	if (m_data) ::UnmapViewOfFile(m_data);
+	m_data = nullptr;
+	m_size = 0;
+	m_is_open = false;
+}
+
+
 static void fromWChar(Span<char> out, const WCHAR* in)
 {
 	const WCHAR* c = in;
@@ -251,6 +304,16 @@ bool isAppForeground() {
 static_assert(sizeof(ThreadID) == sizeof(::GetCurrentThreadId()));
 ThreadID getCurrentThreadID() { return ::GetCurrentThreadId(); }
 
+// there's no user mode PMU API on Windows (PMC sources in ETW need admin and kernel logger),
+// so only thread cycle time is available
+bool initPerfCounters() { return true; }
+
+void readPerfCounters(PerfCounters& out) {
+	out = {};
+	ULONG64 cycles;
+	if (QueryThreadCycleTime(GetCurrentThread(), &cycles)) out.cycles = cycles;
+}
+
 u32 getCPUsCount() {
 	SYSTEM_INFO sys_info;
 	GetSystemInfo(&sys_info);
@@ -261,6 +324,60 @@ u32 getCPUsCount() {
 	return num;
 }
 
+u32 getCPUTopology(Span<CPUCoreInfo> out) {
+	DWORD size = 0;
+	GetLogicalProcessorInformationEx(RelationAll, nullptr, &size);
+	if (GetLastError() != ERROR_INSUFFICIENT_BUFFER) return 0;
+
+	u8* buffer = (u8*)malloc(size);
+	if (!GetLogicalProcessorInformationEx(RelationAll, (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)buffer, &size)) {
+		free(buffer);
+		return 0;
+	}
+	
+	// we support only the first processor group, since affinity masks are 64bit
+	u32 count = minimum(getCPUsCount(), out.length(), 64);
+	for (u32 i = 0; i < count; ++i) {
+		out[i].index = i;
+		out[i].efficiency_class = 0;
+		out[i].cache_group = 0;
+		out[i].numa_node = 0;
+	}
+
+	auto forEachCPU = [&](KAFFINITY mask, WORD group, auto f) {
+		if (group != 0) return;
+		for (u32 i = 0; i < count; ++i) {
+			if (mask & ((KAFFINITY)1 << i)) f(out[i]);
+		}
+	};
+
+	u16 cache_group = 0;
+	for (u8* ptr = buffer; ptr < buffer + size;) {
+		const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX* info = (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)ptr;
+		switch (info->Relationship) {
+			case RelationProcessorCore:
+				for (WORD i = 0; i < info->Processor.GroupCount; ++i) {
+					const GROUP_AFFINITY& affinity = info->Processor.GroupMask[i];
+					forEachCPU(affinity.Mask, affinity.Group, [&](CPUCoreInfo& cpu){ cpu.efficiency_class = info->Processor.EfficiencyClass; });
+				}
+				break;
+			case RelationCache:
+				if (info->Cache.Level == 3) {
+					forEachCPU(info->Cache.GroupMask.Mask, info->Cache.GroupMask.Group, [&](CPUCoreInfo& cpu){ cpu.cache_group = cache_group; });
+					++cache_group;
+				}
+				break;
+			case RelationNumaNode:
+				forEachCPU(info->NumaNode.GroupMask.Mask, info->NumaNode.GroupMask.Group, [&](CPUCoreInfo& cpu){ cpu.numa_node = (u16)info->NumaNode.NodeNumber; });
+				break;
+			default: break;
+		}
+		ptr += info->Size;
+	}
+	free(buffer);
+	return count;
+}
+
 void logInfo() {
 	DWORD dwVersion = 0;
 	DWORD dwMajorVersion = 0;
@@ -1070,6 +1187,11 @@ bool getNextFile(FileIterator* iterator, FileInfo* info)
 
 	info->is_directory = (iterator->ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
 	fromWChar(Span(info->filename), iterator->ffd.cFileName);
+	ULARGE_INTEGER last_modified;
+	last_modified.LowPart = iterator->ffd.ftLastWriteTime.dwLowDateTime;
+	last_modified.HighPart = iterator->ffd.ftLastWriteTime.dwHighDateTime;
+	info->last_modified = last_modified.QuadPart;
+	info->size = (u64(iterator->ffd.nFileSizeHigh) << 32) | iterator->ffd.nFileSizeLow;
 
 	iterator->is_valid = FindNextFile(iterator->handle, &iterator->ffd) != FALSE;
 	return true;
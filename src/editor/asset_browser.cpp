@@ -82,6 +82,8 @@ struct AssetBrowserImpl : AssetBrowser {
 		Path filepath;
 		void* tex = nullptr;
 		bool create_called = false;
+		// tile state is not checked again before this frame, see m_tile_frame
+		u32 next_state_check = 0;
 		u64 extension = 0;
 		u32 score = 0;
 	};
@@ -195,6 +197,7 @@ struct AssetBrowserImpl : AssetBrowser {
 					ri->unloadTexture(info.tex);
 					info.create_called = false;
 					info.tex = nullptr;
+					info.next_state_check = 0;
 					return;
 				case TileState::OK: return;
 			}
@@ -243,6 +246,7 @@ struct AssetBrowserImpl : AssetBrowser {
 					ri->unloadTexture(info.tex);
 					info.create_called = false;
 					info.tex = nullptr;
+					info.next_state_check = 0;
 					return;
 				case TileState::OK: return;
 			}
@@ -256,6 +260,10 @@ struct AssetBrowserImpl : AssetBrowser {
 	{
 		PROFILE_FUNCTION();
 
+		++m_tile_frame;
+		m_tile_loads = 0;
+		m_tile_budget_timer.tick();
+
 		RenderInterface* ri = m_app.getRenderInterface();
 		for (i32 i = m_immediate_tiles.size() - 1; i >= 0; --i) {
 			u32& counter = m_immediate_tiles[i].gc_counter;
@@ -396,6 +404,13 @@ struct AssetBrowserImpl : AssetBrowser {
 	}
 
 
+	// checking tile state and loading tiles is not free, with thousands of files in a directory
+	// we spread the work over several frames
+	bool hasTileBudget() const {
+		if (m_tile_loads >= MAX_TILE_LOADS_PER_FRAME) return false;
+		return m_tile_budget_timer.getTimeSinceTick() < TILE_FRAME_BUDGET;
+	}
+
 	void createTile(FileInfo& tile, const char* out_path) {
 		if (m_create_tile_cooldown > 0) return;
 		if (tile.create_called) return;
@@ -599,20 +614,25 @@ struct AssetBrowserImpl : AssetBrowser {
 		else {
 			const char* icon = getIconByExtension(tile.extension);
 			tileIcon(icon, size);
-
-			RenderInterface* ri = m_app.getRenderInterface();
-			const Path path(".lumix/asset_tiles/", tile.filepath.getHash().getHashValue(), ".lbc");
-			FileSystem& fs = m_app.getEngine().getFileSystem();
-			switch (getState(tile, fs)) {
-				case TileState::OK:
-					tile.tex = ri->loadTexture(path);
-					break;
-				case TileState::NOT_CREATED:
-				case TileState::OUTDATED:
-					createTile(tile, path.c_str());
-					break;
-				case TileState::DELETED:
-					break;
+			// only visible tiles get here, so they are checked and loaded before anything offscreen
+			if (hasTileBudget() && tile.next_state_check <= m_tile_frame) {
+				RenderInterface* ri = m_app.getRenderInterface();
+				const Path path(".lumix/asset_tiles/", tile.filepath.getHash().getHashValue(), ".lbc");
+				FileSystem& fs = m_app.getEngine().getFileSystem();
+				switch (getState(tile, fs)) {
+					case TileState::OK:
+						tile.tex = ri->loadTexture(path);
+						++m_tile_loads;
+						break;
+					case TileState::NOT_CREATED:
+					case TileState::OUTDATED:
+						createTile(tile, path.c_str());
+						tile.next_state_check = m_tile_frame + TILE_RECHECK_FRAMES;
+						break;
+					case TileState::DELETED:
+						tile.next_state_check = m_tile_frame + TILE_RECHECK_FRAMES;
+						break;
+				}
 			}
 		}
 
@@ -644,6 +664,7 @@ struct AssetBrowserImpl : AssetBrowser {
 			if (fi.filepath.getHash() == hash) {
 				m_app.getRenderInterface()->unloadTexture(fi.tex);
 				fi.tex = nullptr;
+				fi.next_state_check = 0;
 				break;
 			}
 		}
@@ -653,6 +674,7 @@ struct AssetBrowserImpl : AssetBrowser {
 		for (FileInfo& fi : m_file_infos) {
 			const Path path(".lumix/asset_tiles/", fi.filepath.getHash().getHashValue(), ".res");
 			fi.create_called = false;
+			fi.next_state_check = 0;
 			createTile(fi, path.c_str());
 		}
 	}
@@ -1488,6 +1510,12 @@ struct AssetBrowserImpl : AssetBrowser {
 	Array<Path> m_selected_resources;
 	TextFilter m_filter;
 	float m_create_tile_cooldown = 0.f;
+	static constexpr float TILE_FRAME_BUDGET = 0.002f; // seconds
+	static constexpr u32 MAX_TILE_LOADS_PER_FRAME = 8;
+	static constexpr u32 TILE_RECHECK_FRAMES = 30;
+	os::Timer m_tile_budget_timer;
+	u32 m_tile_loads = 0;
+	u32 m_tile_frame = 1;
 	bool m_show_thumbnails;
 	bool m_show_subresources;
 	bool m_request_delete = false;
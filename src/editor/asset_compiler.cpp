@@ -1,6 +1,7 @@
 #include "asset_compiler.h"
 #include "core/array.h"
 #include "core/atomic.h"
+#include "core/command_line_parser.h"
 #include "core/hash.h"
 #include "core/job_system.h"
 #include "core/log.h"
@@ -8,6 +9,7 @@
 #include "core/os.h"
 #include "core/path.h"
 #include "core/profiler.h"
+#include "core/sort.h"
 #include "core/sync.h"
 #include "core/tag_allocator.h"
 #include "core/thread.h"
@@ -45,10 +47,58 @@ void AssetCompiler::IPlugin::addSubresources(AssetCompiler& compiler, const Path
 
 
 struct AssetCompilerImpl : AssetCompiler {
+	static constexpr u32 CACHE_MAGIC = 'LCAC';
+	static constexpr u32 CACHE_VERSION = 0;
+	static constexpr u32 SCAN_INDEX_MAGIC = 'LSCN';
+	static constexpr u32 SCAN_INDEX_VERSION = 0;
+	static constexpr const char* SCAN_INDEX_PATH = ".lumix/resources/_scan_index.bin";
+
+	struct FileStamp {
+		bool operator ==(const FileStamp& rhs) const { return last_modified == rhs.last_modified && size == rhs.size; }
+		u64 last_modified;
+		u64 size;
+	};
+
+	// all files found by the last asset scan, saved to SCAN_INDEX_PATH, hashes are sorted
+	// a file is processed on startup only if it's not in the index or its stamp changed
+	struct ScanIndex {
+		ScanIndex(IAllocator& allocator) : hashes(allocator), stamps(allocator) {}
+		Array<u64> hashes;
+		Array<FileStamp> stamps;
+	};
+
+	enum class CookState : u8 {
+		NONE,
+		WAITING_FOR_SCAN,
+		COMPILING,
+		FINISHED
+	};
+
+	// per file extension
+	struct CookStats {
+		char extension[10];
+		u32 count = 0;
+		u32 failed = 0;
+		float total_time = 0;
+		float max_time = 0;
+	};
+
+	// output of one scan job, merged into the shared one when the job finishes
+	struct ScanResult {
+		ScanResult(IAllocator& allocator) : index(allocator), to_add(allocator) {}
+		ScanIndex index;
+		Array<Path> to_add;
+	};
+
 	struct CompileJob {
 		u32 generation;
 		Path path;
 		bool compiled = false;
+		// requested through LoadHook, i.e. someone waits for it, such jobs are started first
+		bool requested = false;
+		// of the source file, limits memory used by jobs in flight, see m_max_jobs_memory
+		u64 size = 0;
+		float duration = 0;
 	};
 
 	struct LoadHook : ResourceManagerHub::LoadHook {
@@ -64,17 +114,51 @@ struct AssetCompilerImpl : AssetCompiler {
 		, m_allocator(app.getAllocator(), "asset compiler")
 		, m_plugins(m_allocator)
 		, m_to_compile(m_allocator)
+		, m_in_flight(m_allocator)
 		, m_compiled(m_allocator)
 		, m_registered_extensions(m_allocator)
 		, m_resources(m_allocator)
 		, m_generations(m_allocator)
 		, m_dependencies(m_allocator)
+		, m_cache_captures(m_allocator)
 		, m_changed_files(m_allocator)
 		, m_changed_dirs(m_allocator)
 		, m_on_list_changed(m_allocator)
 		, m_resource_compiled(m_allocator)
 		, m_on_init_load(m_allocator)
+		, m_cook_stats(m_allocator)
 	{
+		char cmd_line[2048];
+		os::getCommandLine(Span(cmd_line));
+		CommandLineParser parser(cmd_line);
+		m_max_jobs = maximum(1, jobs::getWorkersCount() - 1);
+		while (parser.next()) {
+			if (parser.currentEquals("-asset_cache")) {
+				if (!parser.next()) break;
+				parser.getCurrent(m_cache_dir.data, lengthOf(m_cache_dir.data));
+				if (!os::dirExists(m_cache_dir) && !os::makePath(m_cache_dir)) {
+					logError("Could not create asset cache ", m_cache_dir);
+					m_cache_dir = "";
+				}
+			}
+			else if (parser.currentEquals("-asset_compile_jobs")) {
+				if (!parser.next()) break;
+				char tmp[32];
+				parser.getCurrent(tmp, lengthOf(tmp));
+				fromCString(tmp, m_max_jobs);
+				m_max_jobs = maximum(m_max_jobs, 1);
+				m_max_jobs_from_cmd_line = true;
+			}
+			else if (parser.currentEquals("-asset_compile_memory")) {
+				if (!parser.next()) break;
+				char tmp[32];
+				parser.getCurrent(tmp, lengthOf(tmp));
+				u64 mb;
+				fromCString(tmp, mb);
+				m_max_jobs_memory = mb * 1024 * 1024;
+			}
+		}
+
 		onBasePathChanged();
 
 		Engine& engine = app.getEngine();
@@ -218,33 +302,58 @@ struct AssetCompilerImpl : AssetCompiler {
 	bool writeCompiledResource(const Path& path, Span<const u8> data) override {
 		PROFILE_FUNCTION();
 		constexpr u32 COMPRESSION_SIZE_LIMIT = 4096;
+		// big resources are compressed in blocks, so they are decompressed in parallel
+		constexpr u32 BLOCK_COMPRESSION_SIZE_LIMIT = 1024 * 1024;
+		const bool use_blocks = data.length() > BLOCK_COMPRESSION_SIZE_LIMIT;
 		OutputMemoryStream compressed(m_allocator);
 		if (data.length() > COMPRESSION_SIZE_LIMIT) {
-			if (!m_app.getEngine().compress(data, compressed)) {
+			Engine& engine = m_app.getEngine();
+			if (!(use_blocks ? engine.compressBlocks(data, compressed) : engine.compress(data, compressed))) {
 				logWarning("Could not compress ", path, ", using uncompressed file.");
 				compressed.clear();
 			}
 		}
 
-		FileSystem& fs = m_app.getEngine().getFileSystem();
-		const Path out_path(".lumix/resources/", path.getHash().getHashValue(), ".res");
-		os::OutputFile file;
-		if(!fs.open(out_path, file)) {
-			logError("Could not create ", out_path);
-			return false;
-		}
 		CompiledResourceHeader header;
 		header.decompressed_size = data.length();
 		const u32 compressed_size = (u32)compressed.size();
+		OutputMemoryStream file_data(m_allocator);
 		if (data.length() > COMPRESSION_SIZE_LIMIT && compressed_size > 0 && compressed_size < i32(data.length() / 4 * 3)) {
-			header.flags |= CompiledResourceHeader::COMPRESSED;
-			(void)file.write(&header, sizeof(header));
-			(void)file.write(compressed.data(), compressed_size);
+			header.flags |= use_blocks ? CompiledResourceHeader::COMPRESSED_BLOCKS : CompiledResourceHeader::COMPRESSED;
+			file_data.reserve(sizeof(header) + compressed_size);
+			file_data.write(header);
+			file_data.write(compressed.data(), compressed_size);
 		}
 		else {
-			(void)file.write(&header, sizeof(header));
-			(void)file.write(data.begin(), data.length());
+			file_data.reserve(sizeof(header) + data.length());
+			file_data.write(header);
+			file_data.write(data.begin(), data.length());
+		}
+
+		// compiled as part of a cacheable compile, remember the output so it can be stored in cache
+		{
+			MutexGuard lock(m_cache_mutex);
+			auto iter = m_cache_captures.find(Path(ResourcePath::getResource(path)).getHash());
+			if (iter.isValid()) {
+				iter.value()->writeString(path);
+				iter.value()->write(file_data.size());
+				iter.value()->write(file_data.data(), file_data.size());
+			}
 		}
+
+		return writeCompiledFile(path, file_data);
+	}
+
+	// `file_data` is the whole content of .res file, including header
+	bool writeCompiledFile(const Path& path, Span<const u8> file_data) {
+		FileSystem& fs = m_app.getEngine().getFileSystem();
+		const Path out_path(".lumix/resources/", path.getHash().getHashValue(), ".res");
+		os::OutputFile file;
+		if(!fs.open(out_path, file)) {
+			logError("Could not create ", out_path);
+			return false;
+		}
+		(void)file.write(file_data.begin(), file_data.length());
 		file.close();
 		if (file.isError()) logError("Could not write ", out_path);
 		jobs::MutexGuard guard(m_resources_mutex);
@@ -257,6 +366,95 @@ struct AssetCompilerImpl : AssetCompiler {
 		return !file.isError();
 	}
 
+	// cache key is made of the content of source and its meta, the source path and versions
+	bool getCacheKey(const Path& src, u32 plugin_version, StableHash& key) {
+		FileSystem& fs = m_app.getEngine().getFileSystem();
+		OutputMemoryStream content(m_allocator);
+		if (!fs.getContentSync(src, content)) return false;
+		if (content.size() > 0xffFFffFF) return false;
+		
+		OutputMemoryStream key_data(m_allocator);
+		key_data.write(CACHE_VERSION);
+		key_data.write(plugin_version);
+		key_data.write(StableHash(content.data(), (u32)content.size()));
+		content.clear();
+		if (getMeta(src, content)) key_data.write(StableHash(content.data(), (u32)content.size()));
+		key_data.writeString(src);
+		key = StableHash(key_data.data(), (u32)key_data.size());
+		return true;
+	}
+
+	bool restoreFromCache(const Path& cache_path) {
+		PROFILE_FUNCTION();
+		os::InputFile file;
+		if (!file.open(cache_path.c_str())) return false;
+		
+		OutputMemoryStream bundle(m_allocator);
+		bundle.resize(file.size());
+		const bool read = file.read(bundle.getMutableData(), bundle.size());
+		file.close();
+		if (!read) return false;
+
+		InputMemoryStream blob(bundle);
+		if (blob.read<u32>() != CACHE_MAGIC || blob.read<u32>() != CACHE_VERSION) return false;
+		while (blob.getPosition() < blob.size()) {
+			const Path path(blob.readString());
+			const u64 size = blob.read<u64>();
+			const void* data = blob.skip(size);
+			if (blob.hasOverflow()) {
+				logError("Corrupted ", cache_path);
+				return false;
+			}
+			if (!writeCompiledFile(path, Span((const u8*)data, size))) return false;
+		}
+		return true;
+	}
+
+	void saveToCache(const Path& cache_path, Span<const u8> bundle) {
+		PROFILE_FUNCTION();
+		// cache directory can be shared, so we write to a unique temporary file and rename it, so nobody sees partial file
+		const Path tmp_path(cache_path, ".", os::Timer::getRawTimestamp(), "_", m_cache_tmp_counter.inc(), ".tmp");
+		os::OutputFile file;
+		if (!file.open(tmp_path.c_str())) {
+			logWarning("Could not create ", tmp_path);
+			return;
+		}
+		(void)file.write(CACHE_MAGIC);
+		(void)file.write(CACHE_VERSION);
+		(void)file.write(bundle.begin(), bundle.length());
+		file.close();
+		if (file.isError() || !os::moveFile(tmp_path, cache_path)) {
+			logWarning("Could not write ", cache_path);
+			(void)os::deleteFile(tmp_path);
+		}
+	}
+
+	// appends cached data to `blob`
+	bool getCachedBlob(StableHash key, OutputMemoryStream& blob) override {
+		if (m_cache_dir.empty()) return false;
+		const Path cache_path(m_cache_dir, "/", key.getHashValue(), ".blob");
+		os::InputFile file;
+		if (!file.open(cache_path.c_str())) return false;
+
+		u32 header[2];
+		const u64 size = file.size();
+		bool res = size >= sizeof(header) && file.read(header, sizeof(header));
+		res = res && header[0] == CACHE_MAGIC && header[1] == CACHE_VERSION;
+		if (res) {
+			const u64 offset = blob.size();
+			blob.resize(offset + size - sizeof(header));
+			res = file.read(blob.getMutableData() + offset, size - sizeof(header));
+			if (!res) blob.resize(offset);
+		}
+		file.close();
+		return res;
+	}
+
+	void cacheBlob(StableHash key, Span<const u8> blob) override {
+		if (m_cache_dir.empty()) return;
+		saveToCache(Path(m_cache_dir, "/", key.getHashValue(), ".blob"), blob);
+	}
+
 	static RuntimeHash dirHash(const Path& path) {
 		StringView dir = Path::getDir(ResourcePath::getResource(path));
 		if (!dir.empty() && (dir.back() == '\\' || dir.back() == '/')) dir.removeSuffix(1);
@@ -310,15 +508,137 @@ struct AssetCompilerImpl : AssetCompiler {
 		m_registered_extensions.insert(q, type);
 	}
 
-	void addResource(const Path& fullpath) {
+	IPlugin* getPlugin(StringView path) {
 		char ext[10];
-		copyString(Span(ext), Path::getExtension(fullpath));
+		copyString(Span(ext), Path::getExtension(path));
 		makeLowercase(Span(ext), ext);
 		
 		auto iter = m_plugins.find(RuntimeHash(ext));
-		if (!iter.isValid()) return;
+		return iter.isValid() ? iter.value() : nullptr;
+	}
+
+	void addResource(const Path& fullpath) {
+		IPlugin* plugin = getPlugin(fullpath);
+		if (plugin) plugin->addSubresources(*this, fullpath, m_scan_counter);
+	}
+
+	bool loadScanIndex(ScanIndex& index) {
+		FileSystem& fs = m_app.getEngine().getFileSystem();
+		OutputMemoryStream content(m_allocator);
+		if (!fs.getContentSync(Path(SCAN_INDEX_PATH), content)) return false;
+
+		InputMemoryStream blob(content);
+		if (blob.read<u32>() != SCAN_INDEX_MAGIC) return false;
+		if (blob.read<u32>() != SCAN_INDEX_VERSION) return false;
+		const u32 count = blob.read<u32>();
+		if (blob.remaining() != count * (sizeof(u64) + sizeof(FileStamp))) return false;
+
+		index.hashes.resize(count);
+		index.stamps.resize(count);
+		blob.read(index.hashes.begin(), index.hashes.byte_size());
+		blob.read(index.stamps.begin(), index.stamps.byte_size());
+		return true;
+	}
+
+	void saveScanIndex(ScanIndex& index) {
+		PROFILE_FUNCTION();
+		radixSort(index.hashes.begin(), index.stamps.begin(), index.hashes.size(), m_allocator);
+
+		FileSystem& fs = m_app.getEngine().getFileSystem();
+		OutputMemoryStream blob(m_allocator);
+		blob.write(SCAN_INDEX_MAGIC);
+		blob.write(SCAN_INDEX_VERSION);
+		blob.write((u32)index.hashes.size());
+		blob.write(index.hashes.begin(), index.hashes.byte_size());
+		blob.write(index.stamps.begin(), index.stamps.byte_size());
+		if (!fs.saveContentSync(Path(SCAN_INDEX_PATH), blob)) {
+			logError("Could not save ", SCAN_INDEX_PATH);
+		}
+	}
+
+	// without `prev_index`, files modified after `list_last_modified` are considered changed
+	static bool isChanged(const ScanIndex* prev_index, u64 list_last_modified, FilePathHash hash, const FileStamp& stamp) {
+		if (!prev_index) return stamp.last_modified > list_last_modified;
+
+		const u64 key = hash.getHashValue();
+		u32 from = 0;
+		u32 to = prev_index->hashes.size();
+		while (from < to) {
+			const u32 mid = (from + to) / 2;
+			if (prev_index->hashes[mid] < key) from = mid + 1;
+			else to = mid;
+		}
+		if (from == (u32)prev_index->hashes.size() || prev_index->hashes[from] != key) return true;
+		return !(prev_index->stamps[from] == stamp);
+	}
+
+	// can run on any worker, files which need addResource are collected in `result.to_add`
+	// if `subdirs` is not null, subdirectories are not scanned, but pushed to `subdirs`
+	void scanDir(StringView dir, const ScanIndex* prev_index, u64 list_last_modified, ScanResult& result, Array<Path>* subdirs) {
+		FileSystem& fs = m_app.getEngine().getFileSystem();
+		Array<Path> unchanged(m_allocator);
+		auto* iter = fs.createFileIterator(dir);
+		os::FileInfo info;
+		while (getNextFile(iter, &info)) {
+			if (info.filename[0] == '.') continue;
+
+			char fullpath[MAX_PATH];
+			copyString(fullpath, dir);
+			if (!dir.empty()) catString(fullpath, "/");
+			catString(fullpath, info.filename);
+
+			if (info.is_directory) {
+				if (subdirs) subdirs->push(Path(fullpath));
+				else scanDir(fullpath, prev_index, list_last_modified, result, nullptr);
+				continue;
+			}
+
+			const Path path(fullpath[0] == '/' ? fullpath + 1 : fullpath);
+			const FileStamp stamp = {info.last_modified, info.size};
+			result.index.hashes.push(path.getHash().getHashValue());
+			result.index.stamps.push(stamp);
+			if (!getPlugin(path)) continue;
 
-		iter.value()->addSubresources(*this, fullpath, m_scan_counter);
+			if (isChanged(prev_index, list_last_modified, path.getHash(), stamp)) result.to_add.push(path);
+			else unchanged.push(path);
+		}
+		destroyFileIterator(iter);
+
+		if (unchanged.empty()) return;
+
+		jobs::MutexGuard lock(m_resources_mutex);
+		for (const Path& path : unchanged) {
+			if (!m_resources.find(path.getHash()).isValid()) result.to_add.push(path);
+		}
+	}
+
+	// top level directories are scanned in parallel, only new or changed files and files missing in _resources.txt are added
+	void scanProject(u64 list_last_modified) {
+		PROFILE_FUNCTION();
+		ScanIndex prev_index(m_allocator);
+		const bool has_prev_index = loadScanIndex(prev_index);
+		const ScanIndex* prev = has_prev_index ? &prev_index : nullptr;
+
+		ScanResult result(m_allocator);
+		Array<Path> subdirs(m_allocator);
+		scanDir("", prev, list_last_modified, result, &subdirs);
+
+		Mutex mutex;
+		jobs::forEach(subdirs.size(), 1, [&](u32 idx, u32){
+			PROFILE_BLOCK("scan dir");
+			ScanResult dir_result(m_allocator);
+			scanDir(subdirs[idx], prev, list_last_modified, dir_result, nullptr);
+
+			MutexGuard lock(mutex);
+			for (u64 hash : dir_result.index.hashes) result.index.hashes.push(hash);
+			for (const FileStamp& stamp : dir_result.index.stamps) result.index.stamps.push(stamp);
+			for (const Path& path : dir_result.to_add) result.to_add.push(path);
+		});
+
+		logInfo("Asset scan found ", result.index.hashes.size(), " files, ", result.to_add.size(), " new or changed.");
+		// plugins can notify listeners which expect the main thread
+		for (const Path& path : result.to_add) addResource(path);
+		saveScanIndex(result.index);
 	}
 
 	
@@ -477,7 +797,7 @@ struct AssetCompilerImpl : AssetCompiler {
 			m_scan_timer.tick();
 			PROFILE_BLOCK("asset scan")
 			const u64 list_last_modified = os::getLastModified(list_path);
-			processDir("", list_last_modified);
+			scanProject(list_last_modified);
 		}
 		m_save_list_after_scan = true;
 	}
@@ -487,7 +807,7 @@ struct AssetCompilerImpl : AssetCompiler {
 		m_init_finished = true;
 		for (Resource* res : m_on_init_load) {
 			StringView filepath = ResourcePath::getResource(res->getPath());
-			pushToCompileQueue(Path(filepath));
+			pushToCompileQueue(Path(filepath), true);
 			res->decRefCount();
 		}
 		m_on_init_load.clear();
@@ -546,7 +866,26 @@ struct AssetCompilerImpl : AssetCompiler {
 			logError("Unknown resource type ", src);
 			return false;
 		}
-		return plugin->compile(src);
+
+		const u32 plugin_version = !m_cache_dir.empty() ? plugin->getCacheVersion(src) : 0;
+		StableHash key;
+		if (plugin_version == 0 || !getCacheKey(src, plugin_version, key)) return plugin->compile(src);
+
+		const Path cache_path(m_cache_dir, "/", key.getHashValue(), ".res");
+		if (restoreFromCache(cache_path)) return true;
+
+		OutputMemoryStream bundle(m_allocator);
+		{
+			MutexGuard lock(m_cache_mutex);
+			m_cache_captures.insert(src.getHash(), &bundle);
+		}
+		const bool res = plugin->compile(src);
+		{
+			MutexGuard lock(m_cache_mutex);
+			m_cache_captures.erase(src.getHash());
+		}
+		if (res) saveToCache(cache_path, bundle);
+		return res;
 	}
 	
 	ResourceManagerHub::LoadHook::Action onBeforeLoad(Resource& res) {
@@ -573,13 +912,13 @@ struct AssetCompilerImpl : AssetCompiler {
 			}
 			if (!getPlugin(res.getPath())) return ResourceManagerHub::LoadHook::Action::IMMEDIATE;
 
-			pushToCompileQueue(Path(filepath));
+			pushToCompileQueue(Path(filepath), true);
 			return ResourceManagerHub::LoadHook::Action::DEFERRED;
 		}
 		return ResourceManagerHub::LoadHook::Action::IMMEDIATE;
 	}
 
-	void pushToCompileQueue(const Path& path) {
+	void pushToCompileQueue(const Path& path, bool requested = false) {
 		auto iter = m_generations.find(path);
 		if (!iter.isValid()) {
 			iter = m_generations.insert(path, 0);
@@ -591,6 +930,7 @@ struct AssetCompilerImpl : AssetCompiler {
 		CompileJob job;
 		job.path = path;
 		job.generation = iter.value();
+		job.requested = requested;
 
 		m_to_compile.push(job);
 		++m_compile_batch_count;
@@ -599,12 +939,34 @@ struct AssetCompilerImpl : AssetCompiler {
 
 	CompileJob popCompiledResource()
 	{
-		MutexGuard lock(m_compiled_mutex);
-		if (m_compiled.empty()) return {};
-		const CompileJob p = m_compiled.back();
-		m_compiled.pop();
+		CompileJob p;
+		{
+			MutexGuard lock(m_compiled_mutex);
+			if (m_compiled.empty()) return {};
+			p = m_compiled.back();
+			m_compiled.pop();
+		}
+
+		for (u32 i = 0, c = m_in_flight.size(); i < c; ++i) {
+			if (m_in_flight[i].path == p.path && m_in_flight[i].generation == p.generation) {
+				m_in_flight_memory -= m_in_flight[i].size;
+				m_in_flight.swapAndPop(i);
+				break;
+			}
+		}
+		++m_batch_compiled_count;
+		m_batch_compile_time += p.duration;
+		if (m_cook_state == CookState::COMPILING) addCookStats(p);
 		--m_batch_remaining_count;
-		if (m_batch_remaining_count == 0) m_compile_batch_count = 0;
+		if (m_batch_remaining_count == 0) {
+			const float batch_time = m_batch_timer.getTimeSinceTick();
+			logInfo("Compiled ", m_batch_compiled_count, " resources in ", batch_time, " s, "
+				, m_batch_compiled_count / maximum(batch_time, 0.001f), " resources/s, "
+				, m_batch_compile_time / maximum(batch_time, 0.001f), " jobs busy on average.");
+			m_compile_batch_count = 0;
+			m_batch_compiled_count = 0;
+			m_batch_compile_time = 0;
+		}
 		return p;
 	}
 
@@ -627,6 +989,8 @@ struct AssetCompilerImpl : AssetCompiler {
 		if (ImGui::Begin("Resource compilation", nullptr, flags)) {
 			ImGui::TextUnformatted("Compiling resources...");
 			ImGui::ProgressBar(((float)m_compile_batch_count - m_batch_remaining_count) / m_compile_batch_count);
+			const float batch_time = maximum(m_batch_timer.getTimeSinceTick(), 0.001f);
+			ImGui::Text("%d jobs, %.1f resources/s", m_in_flight.size(), m_batch_compiled_count / batch_time);
 			ImGui::TextWrapped("%s", m_res_in_progress.c_str());
 		}
 		ImGui::End();
@@ -642,28 +1006,133 @@ struct AssetCompilerImpl : AssetCompiler {
 		return nullptr;
 	}
 
-	void runOneJob() {
-		if (m_to_compile.empty()) return;
+	// keeps up to m_max_jobs compile jobs in flight, requested jobs are started first
+	// job is not started while any of its dependencies (see registerDependency) or the same path is queued or compiling
+	void startJobs() {
+		if (m_to_compile.empty() || m_in_flight.size() >= m_max_jobs) return;
+		if (m_batch_compiled_count == 0 && m_in_flight.empty()) m_batch_timer.tick();
+
+		HashMap<FilePathHash, bool> blocked(m_allocator);
+		auto blockDependents = [&](const Path& path){
+			auto iter = m_dependencies.find(path);
+			if (!iter.isValid()) return;
+			for (const Path& dependent : iter.value()) blocked.insert(dependent.getHash(), true);
+		};
+		for (const CompileJob& job : m_in_flight) {
+			blocked.insert(job.path.getHash(), true);
+			blockDependents(job.path);
+		}
+		for (const CompileJob& job : m_to_compile) blockDependents(job.path);
 
-		AssetCompilerImpl::CompileJob p = m_to_compile.back();
-		m_to_compile.pop();
-		auto iter = m_generations.find(p.path);
-		const bool is_most_recent = p.generation == iter.value();
-		if (!is_most_recent) {
-			--m_batch_remaining_count;
-			return;
+		FileSystem& fs = m_app.getEngine().getFileSystem();
+		while (!m_to_compile.empty() && m_in_flight.size() < m_max_jobs) {
+			i32 picked = -1;
+			for (i32 i = m_to_compile.size() - 1; i >= 0; --i) {
+				const CompileJob& job = m_to_compile[i];
+				if (job.generation != m_generations[job.path]) {
+					m_to_compile.erase(i);
+					--m_batch_remaining_count;
+					if (picked > i) --picked;
+					continue;
+				}
+				if (blocked.find(job.path.getHash()).isValid()) continue;
+				if (picked < 0) picked = i;
+				if (job.requested) {
+					picked = i;
+					break;
+				}
+			}
+			// dependency cycle, everything is blocked, so just start something
+			if (picked < 0 && m_in_flight.empty() && !m_to_compile.empty()) picked = m_to_compile.size() - 1;
+			if (picked < 0) break;
+
+			CompileJob p = m_to_compile[picked];
+			p.size = os::getFileSize(Path(fs.getBasePath(), p.path));
+			if (!m_in_flight.empty() && m_in_flight_memory + p.size > m_max_jobs_memory) break;
+			m_to_compile.erase(picked);
+
+			m_in_flight.push(p);
+			m_in_flight_memory += p.size;
+			blocked.insert(p.path.getHash(), true);
+			blockDependents(p.path);
+			m_res_in_progress = p.path.c_str();
+
+			// importers (FBX, shaders, ...) can recurse deep
+			jobs::runLambdaOnLargeStack([p, this]() mutable {
+				PROFILE_BLOCK("compile asset");
+				profiler::pushString(p.path.c_str());
+				os::Timer timer;
+				p.compiled = compile(p.path);
+				p.duration = timer.getTimeSinceStart();
+				if (!p.compiled) logError("Failed to compile resource ", p.path);
+				MutexGuard lock(m_compiled_mutex);
+				m_compiled.push(p);
+			}, nullptr, jobs::Priority::BACKGROUND);
 		}
+	}
 
-		m_res_in_progress = p.path.c_str();
+	void addCookStats(const CompileJob& job) {
+		char ext[10];
+		copyString(Span(ext), Path::getExtension(job.path));
+		makeLowercase(Span(ext), ext);
+		const RuntimeHash key(ext);
+		auto iter = m_cook_stats.find(key);
+		if (!iter.isValid()) {
+			iter = m_cook_stats.insert(key, {});
+			copyString(iter.value().extension, ext);
+		}
+		CookStats& stats = iter.value();
+		++stats.count;
+		if (!job.compiled) {
+			++stats.failed;
+			++m_cook_failures;
+		}
+		stats.total_time += job.duration;
+		stats.max_time = maximum(stats.max_time, job.duration);
+	}
 
-		jobs::runLambda([p, this]() mutable {
-			PROFILE_BLOCK("compile asset");
-			profiler::pushString(p.path.c_str());
-			p.compiled = compile(p.path);
-			if (!p.compiled) logError("Failed to compile resource ", p.path);
-			MutexGuard lock(m_compiled_mutex);
-			m_compiled.push(p);
-		}, nullptr);
+	void cook() override {
+		m_cook_state = CookState::WAITING_FOR_SCAN;
+		m_cook_failures = 0;
+		m_cook_stats.clear();
+		// nothing else runs while cooking, so use all workers
+		if (!m_max_jobs_from_cmd_line) m_max_jobs = jobs::getWorkersCount();
+	}
+
+	bool isCooking() const override { return m_cook_state == CookState::WAITING_FOR_SCAN || m_cook_state == CookState::COMPILING; }
+	u32 getCookFailuresCount() const override { return m_cook_failures; }
+
+	// same up-to-date test as onBeforeLoad, source file is queued once even if it has many subresources
+	void queueOutdated() {
+		PROFILE_FUNCTION();
+		FileSystem& fs = m_app.getEngine().getFileSystem();
+		HashMap<FilePathHash, bool> queued(m_allocator);
+		Array<Path> to_compile(m_allocator);
+		{
+			jobs::MutexGuard lock(m_resources_mutex);
+			for (const ResourceItem& ri : m_resources) {
+				const Path src(ResourcePath::getResource(ri.path));
+				if (queued.find(src.getHash()).isValid()) continue;
+				
+				const Path dst_path(".lumix/resources/", ri.path.getHash(), ".res");
+				const Path meta_path(src, ".meta");
+				if (fs.fileExists(dst_path)) {
+					const u64 dst_last_modified = fs.getLastModified(dst_path);
+					if (dst_last_modified >= fs.getLastModified(src) && dst_last_modified >= fs.getLastModified(meta_path)) continue;
+				}
+				queued.insert(src.getHash(), true);
+				to_compile.push(src);
+			}
+		}
+		logInfo("Cooking ", to_compile.size(), " resources with up to ", m_max_jobs, " jobs.");
+		for (const Path& path : to_compile) pushToCompileQueue(path);
+	}
+
+	void logCookStats() {
+		logInfo("Cook finished in ", m_cook_timer.getTimeSinceTick(), " s, ", m_cook_failures, " failed.");
+		for (const CookStats& stats : m_cook_stats) {
+			logInfo("\t", stats.extension, ": ", stats.count, " resources, ", stats.failed, " failed, ", stats.total_time, " s total, ", stats.max_time, " s max");
+		}
 	}
 
 	void update() override {
@@ -673,8 +1142,14 @@ struct AssetCompilerImpl : AssetCompiler {
 			logInfo("Asset scan took ", m_scan_timer.getTimeSinceTick(), " seconds.");
 		}
 
+		if (m_cook_state == CookState::WAITING_FOR_SCAN && m_init_finished && !m_save_list_after_scan && m_scan_counter == 0) {
+			m_cook_state = CookState::COMPILING;
+			m_cook_timer.tick();
+			queueOutdated();
+		}
+
 		for(;;) {
-			runOneJob();
+			startJobs();
 			CompileJob job = popCompiledResource();
 			if (job.path.isEmpty()) break;
 
@@ -715,6 +1190,11 @@ struct AssetCompilerImpl : AssetCompiler {
 			}
 		}
 
+		if (m_cook_state == CookState::COMPILING && m_batch_remaining_count == 0) {
+			m_cook_state = CookState::FINISHED;
+			logCookStats();
+		}
+
 		for (;;) {
 			Path path_obj;
 			{
@@ -828,10 +1308,20 @@ struct AssetCompilerImpl : AssetCompiler {
 	jobs::Mutex m_resources_mutex;
 	HashMap<Path, u32> m_generations; 
 	HashMap<Path, Array<Path>> m_dependencies; 
+	// shared cache of compiled resources, see compile()
+	StaticString<MAX_PATH> m_cache_dir;
+	HashMap<FilePathHash, OutputMemoryStream*> m_cache_captures;
+	Mutex m_cache_mutex;
+	AtomicI32 m_cache_tmp_counter = 0;
 	Array<Path> m_changed_files;
 	Array<Path> m_changed_dirs;
 	Array<CompileJob> m_to_compile;
+	Array<CompileJob> m_in_flight;
 	Array<CompileJob> m_compiled;
+	u32 m_max_jobs = 1;
+	bool m_max_jobs_from_cmd_line = false;
+	u64 m_max_jobs_memory = 1024 * 1024 * 1024;
+	u64 m_in_flight_memory = 0;
 	StudioApp& m_app;
 	LoadHook m_load_hook;
 	HashMap<RuntimeHash, IPlugin*> m_plugins;
@@ -847,6 +1337,14 @@ struct AssetCompilerImpl : AssetCompiler {
 
 	u32 m_compile_batch_count = 0;
 	u32 m_batch_remaining_count = 0;
+	u32 m_batch_compiled_count = 0;
+	// sum of durations of all jobs in the batch
+	float m_batch_compile_time = 0;
+	os::Timer m_batch_timer;
+	CookState m_cook_state = CookState::NONE;
+	u32 m_cook_failures = 0;
+	HashMap<RuntimeHash, CookStats> m_cook_stats;
+	os::Timer m_cook_timer;
 	Path m_res_in_progress;
 };
 
@@ -13,6 +13,9 @@ struct LUMIX_EDITOR_API AssetCompiler {
 	struct LUMIX_EDITOR_API IPlugin {
 		virtual ~IPlugin() {}
 		virtual bool compile(const Path& src) = 0;
+		// compiled resources are stored in a shared cache (-asset_cache <dir>) keyed by content of `src` and its meta
+		// return non-zero only if the output depends on nothing else, bump when the output changes
+		virtual u32 getCacheVersion(const Path& src) const { return 0; }
 		
 		// Some plugins do async scan for subresources (e.g. ModelPlugin).
 		// They increment `signal` when they start the scan and decrement it when they finish.
@@ -34,6 +37,10 @@ struct LUMIX_EDITOR_API AssetCompiler {
 	virtual void onInitFinished() = 0;
 	virtual void onGUI() = 0;
 	virtual void update() = 0;
+	// compile all outdated resources once the asset scan finishes, used by headless cooking (-cook)
+	virtual void cook() = 0;
+	virtual bool isCooking() const = 0;
+	virtual u32 getCookFailuresCount() const = 0;
 	virtual void addPlugin(IPlugin& plugin, Span<const char*> extensions) = 0;
 	virtual void removePlugin(IPlugin& plugin) = 0;
 	virtual bool compile(const Path& path) = 0;
@@ -46,6 +53,10 @@ struct LUMIX_EDITOR_API AssetCompiler {
 	virtual void registerDependency(const Path& included_from, const Path& dependency) = 0;
 	virtual void addResource(ResourceType type, const Path& path) = 0;
 	virtual bool writeCompiledResource(const Path& path, Span<const u8> data) = 0;
+	// content addressed blobs in the shared cache (-asset_cache <dir>) for intermediate results, e.g. cooked physics meshes
+	// `key` must hash everything the blob depends on; without the shared cache, nothing is cached
+	virtual bool getCachedBlob(StableHash key, OutputMemoryStream& blob) = 0;
+	virtual void cacheBlob(StableHash key, Span<const u8> blob) = 0;
 	virtual bool copyCompile(const Path& src) = 0;
 	virtual DelegateList<void(const Path&)>& listChanged() = 0;
 	virtual DelegateList<void(Resource&, bool)>& resourceCompiled() = 0;
@@ -162,7 +162,7 @@ const EntityFolders::Folder& EntityFolders::getFolder(FolderHandle folder_id) co
 	return const_cast<EntityFolders*>(this)->getFolder(folder_id);
 }
 
-void EntityFolders::serialize(OutputMemoryStream& blob) {
+void EntityFolders::serialize(IOutputStream& blob) {
 	blob.write(m_entities.size());
 	blob.write(m_entities.begin(), m_entities.byte_size());
 	const u32 size = m_folders.size();
@@ -481,7 +481,7 @@ public:
 		}
 	}
 
-	void serialize(OutputMemoryStream& serializer) override
+	void serialize(IOutputStream& serializer) override
 	{
 		serializer.write((u32)m_entity_to_prefab.size());
 		if (!m_entity_to_prefab.empty()) serializer.write(m_entity_to_prefab.begin(), m_entity_to_prefab.byte_size());
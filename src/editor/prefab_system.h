@@ -24,7 +24,7 @@ struct LUMIX_EDITOR_API PrefabSystem
 	virtual ~PrefabSystem() {}
 	virtual void setWorld(struct World*) = 0;
 	virtual void update() = 0;
-	virtual void serialize(struct OutputMemoryStream& serializer) = 0;
+	virtual void serialize(struct IOutputStream& serializer) = 0;
 	virtual void deserialize(struct InputMemoryStream& serializer, const struct EntityMap& entity_map, WorldVersion version) = 0;
 	virtual EntityPtr instantiatePrefab(struct PrefabResource& prefab, const struct DVec3& pos, const struct Quat& rot, const struct Vec3& scale) = 0;
 	virtual void instantiatePrefabs(struct PrefabResource& prefab, Span<struct Transform> transforms) = 0;
@@ -33,6 +33,7 @@ namespace Lumix {
 namespace {
 
 static constexpr u64 DEFAULT_RANGE = 100'000;
+static constexpr u32 INVALID_OFFSET = 0xffFFffFF;
 
 struct ThreadData {
 	struct Rect {
@@ -42,6 +43,9 @@ struct ThreadData {
 		u32 line;
 		i32 first_property;
 		u32 num_properties = 0;
+		// offsets of profiler::HWCountersRecord events
+		u32 hw_counters_begin = INVALID_OFFSET;
+		u32 hw_counters_end = INVALID_OFFSET;
 	};
 
 	struct Signal {
@@ -124,6 +128,65 @@ struct ThreadContextProxy {
 	u8* buffer;
 };
 
+// convert file created by profiler::startCapture to the format created by profiler::serialize
+// see profiler.cpp for description of the capture format
+static bool convertCapture(Span<const u8> capture, OutputMemoryStream& out, IAllocator& allocator) {
+	struct Chunk {
+		u32 context;
+		u32 size;
+		const u8* data;
+	};
+
+	InputMemoryStream blob(capture);
+	if (blob.read<u32>() != 1) return false;
+
+	Array<Chunk> chunks(allocator);
+	for (;;) {
+		const u32 context = blob.read<u32>();
+		if (blob.hasOverflow()) return false;
+		if (context == 0xffFFffFF) break;
+
+		Chunk& chunk = chunks.emplace();
+		chunk.context = context;
+		chunk.size = blob.read<u32>();
+		chunk.data = (const u8*)blob.skip(chunk.size);
+		if (blob.hasOverflow()) return false;
+	}
+
+	const u32 version = 0;
+	out.write(version);
+	const u32 counters_count = blob.read<u32>();
+	out.write(counters_count);
+	out.write(blob.skip(counters_count * sizeof(profiler::Counter)), counters_count * sizeof(profiler::Counter));
+
+	// global context is not included in count
+	const u32 contexts_count = blob.read<u32>();
+	out.write(contexts_count);
+	for (u32 i = 0; i <= contexts_count; ++i) {
+		const char* name = blob.readString();
+		const u32 thread_id = blob.read<u32>();
+		const u8 show = blob.read<u8>();
+		if (blob.hasOverflow()) return false;
+
+		out.writeString(name);
+		out.write(thread_id);
+		out.write(show);
+
+		u32 size = 0;
+		for (const Chunk& chunk : chunks) {
+			if (chunk.context == i) size += chunk.size;
+		}
+		out.write(size);
+		for (const Chunk& chunk : chunks) {
+			if (chunk.context == i) out.write(chunk.data, chunk.size);
+		}
+	}
+
+	// string table
+	out.write((const u8*)blob.getData() + blob.getPosition(), blob.remaining());
+	return true;
+}
+
 const char* getContexSwitchReasonString(i8 reason) {
 	const char* reasons[] = {
 		"Executive"		   ,
@@ -273,6 +336,7 @@ struct MemoryProfilerUI {
 		, m_focus_filter(focus_filter)
 		// we can't use m_allocator for tags, because it would create circular dependency and deadlock
 		, m_allocation_tags(getGlobalAllocator())
+		, m_allocation_samples(getGlobalAllocator())
 	{
 	}
 
@@ -295,6 +359,95 @@ struct MemoryProfilerUI {
 		ImGui::EndTooltip();
 	}
 
+	static void getCallsite(debug::StackNode* n, Span<char> out, i32& line) {
+		// skip allocator internals
+		do {
+			if (!debug::StackTree::getFunction(n, out, line)) {
+				copyString(out, "N/A");
+				return;
+			}
+			n = debug::StackTree::getParent(n);
+		} while (n && (strstr(out.begin(), "Allocator::") != 0 || strstr(out.begin(), "sampleAllocation") != 0));
+	}
+
+	// in live mode, samples are reset on every refresh, so the view shows current allocation rate
+	void samplingGUI() {
+		bool enabled = debug::isAllocationSamplingEnabled();
+		if (ImGui::Checkbox("Enabled", &enabled)) {
+			debug::enableAllocationSampling(enabled, m_sample_kb * 1024);
+			debug::resetAllocationSamples();
+			m_sampling_timer.tick();
+			m_sampling_frames = 0;
+		}
+		ImGui::SameLine();
+		ImGui::SetNextItemWidth(100);
+		if (ImGui::DragInt("Sample every (KB)", (i32*)&m_sample_kb, 1, 1, 16 * 1024) && enabled) {
+			debug::enableAllocationSampling(true, m_sample_kb * 1024);
+		}
+		ImGui::SameLine();
+		ImGui::Checkbox("Live", &m_sampling_live);
+		ImGui::SameLine();
+		if (ImGui::Button("Reset")) {
+			debug::resetAllocationSamples();
+			m_sampling_timer.tick();
+			m_sampling_frames = 0;
+		}
+		if (!enabled) return;
+
+		++m_sampling_frames;
+		const float elapsed = m_sampling_timer.getTimeSinceTick();
+		if (elapsed > 0.5f || !m_sampling_live) {
+			m_allocation_samples.resize(4096);
+			m_allocation_samples.resize(minimum(debug::getAllocationSamples(m_allocation_samples), 4096u));
+			sort(m_allocation_samples.begin(), m_allocation_samples.end(), [](const debug::AllocationSample& a, const debug::AllocationSample& b) {
+				return a.bytes > b.bytes;
+			});
+			m_sampled_bytes = debug::getSampledBytes();
+			m_sampled_time = elapsed;
+			m_sampled_frames = m_sampling_frames;
+			if (m_sampling_live) {
+				debug::resetAllocationSamples();
+				m_sampling_timer.tick();
+				m_sampling_frames = 0;
+			}
+		}
+
+		const float to_mb = 1 / (1024.f * 1024.f);
+		const float seconds = maximum(m_sampled_time, 1e-3f);
+		const float frames = (float)maximum(m_sampled_frames, 1u);
+		ImGui::Text("Total: %.2f MB/s, %.3f MB/frame", m_sampled_bytes * to_mb / seconds, m_sampled_bytes * to_mb / frames);
+
+		if (!ImGui::BeginTable("samples", 4, ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY)) return;
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Callsite");
+		ImGui::TableSetupColumn("Tag");
+		ImGui::TableSetupColumn("MB/s");
+		ImGui::TableSetupColumn("KB/frame");
+		ImGui::TableHeadersRow();
+		ImGuiListClipper clipper;
+		clipper.Begin(m_allocation_samples.size());
+		while (clipper.Step()) {
+			for (i32 i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+				const debug::AllocationSample& s = m_allocation_samples[i];
+				if (m_filter.isActive() && !m_filter.pass(s.tag)) continue;
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				char fn_name[256];
+				i32 line = 0;
+				getCallsite(s.stack_leaf, Span(fn_name), line);
+				ImGui::Text("%s: L%d", startsWith(fn_name, "Lumix::") ? fn_name + 7 : fn_name, line);
+				if (ImGui::IsItemHovered()) callstackTooltip(s.stack_leaf);
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(s.tag);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", s.bytes * to_mb / seconds);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", s.bytes / 1024.f / frames);
+			}
+		}
+		ImGui::EndTable();
+	}
+
 	void gui(const AllocationTag& tag) {
 		if (m_filter.isActive()) {
 			for (const AllocationTag& child : tag.m_child_tags) gui(child);
@@ -370,9 +523,9 @@ struct MemoryProfilerUI {
 		});
 		
 		// sort by stack_node, so we can collapse allocations with the same stack node
-		sort(tag.m_allocations.begin(), tag.m_allocations.end(), [](const AllocationTag::Allocation& a, const AllocationTag::Allocation& b) {
+		parallelSort(tag.m_allocations.begin(), tag.m_allocations.end(), [](const AllocationTag::Allocation& a, const AllocationTag::Allocation& b) {
 			return a.stack_node < b.stack_node;
-		});
+		}, getGlobalAllocator());
 
 		// collapse allocations with the same stack node, i.e., keep only one of them and sum their size and count
 		for (i32 i = tag.m_allocations.size() - 1; i > 0; --i) {
@@ -384,9 +537,9 @@ struct MemoryProfilerUI {
 		}
 
 		// sort by size
-		sort(tag.m_allocations.begin(), tag.m_allocations.end(), [](const AllocationTag::Allocation& a, const AllocationTag::Allocation& b) {
+		parallelSort(tag.m_allocations.begin(), tag.m_allocations.end(), [](const AllocationTag::Allocation& a, const AllocationTag::Allocation& b) {
 			return b.size < a.size;
-		});
+		}, getGlobalAllocator());
 	}
 
 	void captureAllocations() {
@@ -423,10 +576,20 @@ struct MemoryProfilerUI {
 		}
 		ImGui::Separator();
 		ImGui::Text("Total: %d MB", u32(total / 1024 / 1024));
+
+		if (ImGui::CollapsingHeader("Allocation sampling")) samplingGUI();
 	}
 
 	StudioApp& m_app;
 	Array<AllocationTag> m_allocation_tags;
+	Array<debug::AllocationSample> m_allocation_samples;
+	u32 m_sample_kb = 64;
+	bool m_sampling_live = true;
+	os::Timer m_sampling_timer;
+	u32 m_sampling_frames = 0;
+	u64 m_sampled_bytes = 0;
+	float m_sampled_time = 0;
+	u32 m_sampled_frames = 0;
 	Action* m_focus_filter;
 	TextFilter m_filter;
 };
@@ -439,6 +602,10 @@ struct ProfilerUIImpl final : ProfilerUI {
 		, m_data(m_allocator)
 		, m_blocks(m_allocator)
 		, m_counters(m_allocator)
+		, m_aggregate_rows(m_allocator)
+		, m_aggregate_baseline(m_allocator)
+		, m_flame_nodes(m_allocator)
+		, m_flame_roots(m_allocator)
 		, m_engine(app.getEngine())
 		, m_memory_ui(app, &m_focus_filter)
 	{
@@ -457,6 +624,7 @@ struct ProfilerUIImpl final : ProfilerUI {
 		patchStrings();
 		preprocess();
 		cacheVisibleBlocks();
+		m_aggregate_dirty = true;
 	}
 
 	ThreadContextProxy getGlobalThreadContextProxy() {
@@ -671,8 +839,23 @@ struct ProfilerUIImpl final : ProfilerUI {
 					m_data.clear();
 				}
 				else {
-					patchStrings();
-					preprocess();
+					u32 version = 0;
+					if (m_data.size() >= sizeof(version)) memcpy(&version, m_data.data(), sizeof(version));
+					if (version == 1) {
+						OutputMemoryStream converted(m_allocator);
+						if (convertCapture(m_data, converted, m_allocator)) {
+							m_data = static_cast<OutputMemoryStream&&>(converted);
+						}
+						else {
+							logError(path, " is not a valid profiler capture");
+							m_data.clear();
+						}
+					}
+					if (!m_data.empty()) {
+						patchStrings();
+						preprocess();
+					}
+					m_aggregate_dirty = true;
 				}
 				file.close();
 			}
@@ -852,6 +1035,8 @@ struct ProfilerUIImpl final : ProfilerUI {
 				if (vtab("GPU", tab == 1)) tab = 1;
 				if (vtab("Memory", tab == 2)) tab = 2;
 				if (vtab("Resources", tab == 3)) tab = 3;
+				if (vtab("Jobs", tab == 4)) tab = 4;
+				if (vtab("Aggregate", tab == 5)) tab = 5;
 			}
 			ImGui::EndChild();
 			ImGui::PopStyleColor();
@@ -862,6 +1047,8 @@ struct ProfilerUIImpl final : ProfilerUI {
 					case 1: GPUUI(); break;
 					case 2: m_memory_ui.gui(); break;
 					case 3: resourcesUI(); break;
+					case 4: jobsUI(); break;
+					case 5: aggregateUI(); break;
 				}
 			}
 			ImGui::EndChild();
@@ -987,6 +1174,7 @@ struct ProfilerUIImpl final : ProfilerUI {
 			struct OpenBlock {
 				i32 id;
 				u64 start_time;
+				u32 hw_counters = INVALID_OFFSET;
 			};
 			struct Property {
 				u32 offset;
@@ -1000,6 +1188,7 @@ struct ProfilerUIImpl final : ProfilerUI {
 			u32 p = 0;
 			u64 primitives_generated = 0;
 			i32 gpu_stats_line = -1;
+			u32 hw_counters_end = INVALID_OFFSET;
 			
 			while (p != ctx.buffer_size) {
 				profiler::EventHeader header;
@@ -1071,6 +1260,13 @@ struct ProfilerUIImpl final : ProfilerUI {
 
 						break;
 					}
+					case profiler::EventType::HW_COUNTERS: {
+						profiler::HWCountersRecord r;
+						read(ctx, p + sizeof(profiler::EventHeader), r);
+						if (r.is_end) hw_counters_end = p;
+						else if (open_blocks.size() > 0) open_blocks.last().hw_counters = p;
+						break;
+					}
 					case profiler::EventType::FRAME:
 						if (header.time < from_time || header.time > to_time) break;
 						thread.frames.push(header.time);
@@ -1144,6 +1340,8 @@ struct ProfilerUIImpl final : ProfilerUI {
 								r.start_time = open_blocks.last().start_time;
 								r.end_time = header.time;
 								r.line = line;
+								r.hw_counters_begin = open_blocks.last().hw_counters;
+								r.hw_counters_end = hw_counters_end;
 								if (!properties.empty()) {
 									r.first_property = thread.properties.size();
 									r.num_properties = 0;
@@ -1166,6 +1364,7 @@ struct ProfilerUIImpl final : ProfilerUI {
 							}
 							open_blocks.pop();
 						}
+						hw_counters_end = INVALID_OFFSET;
 						break;
 					case profiler::EventType::BLOCK_COLOR:
 						if (open_blocks.size() > 0) {
@@ -1390,6 +1589,24 @@ struct ProfilerUIImpl final : ProfilerUI {
 					m_hovered_job.pos = ImVec2(x_end, block_y);
 					m_hovered_job.signal = block.job_info.signal_on_finish;
 				}
+				if (r.hw_counters_begin != INVALID_OFFSET && r.hw_counters_end != INVALID_OFFSET) {
+					profiler::HWCountersRecord from;
+					profiler::HWCountersRecord to;
+					read(ctx, r.hw_counters_begin + sizeof(profiler::EventHeader), from);
+					read(ctx, r.hw_counters_end + sizeof(profiler::EventHeader), to);
+					const u64 cycles = to.cycles - from.cycles;
+					const u64 instructions = to.instructions - from.instructions;
+					const double kilo_instructions = maximum(instructions, (u64)1) / 1000.0;
+					ImGui::Separator();
+					ImGui::Text("Cycles: %" PRIu64, cycles);
+					if (instructions > 0) {
+						ImGui::Text("Instructions: %" PRIu64 " (IPC %.2f)", instructions, instructions / double(maximum(cycles, (u64)1)));
+						ImGui::Text("L1D misses: %" PRIu64 " (%.2f per 1k instr)", to.l1d_misses - from.l1d_misses, (to.l1d_misses - from.l1d_misses) / kilo_instructions);
+						ImGui::Text("LLC misses: %" PRIu64 " (%.2f per 1k instr)", to.llc_misses - from.llc_misses, (to.llc_misses - from.llc_misses) / kilo_instructions);
+						ImGui::Text("Branch misses: %" PRIu64 " (%.2f per 1k instr)", to.branch_misses - from.branch_misses, (to.branch_misses - from.branch_misses) / kilo_instructions);
+					}
+					ImGui::Separator();
+				}
 				if (r.num_properties > 0) {
 					for (u32 i = 0; i < r.num_properties; ++i) {
 						const u32 offset = thread.properties[r.first_property + i];
@@ -1537,6 +1754,460 @@ struct ProfilerUIImpl final : ProfilerUI {
 		}
 	}
 
+	// aggregate blocks started in the last `m_aggregate_frames` frames of the snapshot, per block name and thread
+	// blocks interrupted by fiber switch are counted as separate instances
+	void computeAggregate() {
+		m_aggregate_dirty = false;
+		m_aggregate_rows.clear();
+		m_flame_nodes.clear();
+		m_flame_roots.clear();
+		m_aggregate_frame_times = {};
+		if (m_data.empty()) return;
+
+		Array<u64> frames(m_allocator);
+		forEachThread([&](ThreadContextProxy& ctx){
+			if (ctx.thread_id != 0) return;
+			for (u32 p = 0; p != ctx.buffer_size;) {
+				profiler::EventHeader header;
+				read(ctx, p, header);
+				if (header.type == profiler::EventType::FRAME) frames.push(header.time);
+				p += header.size;
+			}
+		});
+		if (frames.size() < 2) return;
+
+		const u32 num_frames = minimum(m_aggregate_frames, u32(frames.size() - 1));
+		const u64 from_time = frames[frames.size() - 1 - num_frames];
+		const u64 to_time = frames.last();
+		m_aggregate_num_frames = num_frames;
+
+		Array<u64> frame_durations(m_allocator);
+		for (i32 i = frames.size() - num_frames; i < frames.size(); ++i) frame_durations.push(frames[i] - frames[i - 1]);
+		sort(frame_durations.begin(), frame_durations.end());
+		m_aggregate_frame_times.p50 = frame_durations[frame_durations.size() / 2];
+		m_aggregate_frame_times.p95 = frame_durations[frame_durations.size() * 95 / 100];
+		m_aggregate_frame_times.p99 = frame_durations[frame_durations.size() * 99 / 100];
+		m_aggregate_frame_times.max = frame_durations.last();
+		m_aggregate_frame_times.total = to_time - from_time;
+
+		struct Key {
+			const char* name;
+			u64 thread_id;
+		};
+		HashMap<RuntimeHash, i32> row_map(m_allocator);
+		Array<Array<u64>> durations(m_allocator);
+
+		forEachThread([&](ThreadContextProxy& ctx){
+			if (ctx.thread_id == 0) return;
+
+			struct OpenBlock {
+				i32 id;
+				u64 start_time;
+				i32 flame_node;
+			};
+			StackArray<OpenBlock, 16> open_blocks(m_allocator);
+			auto thread_iter = m_threads.find(ctx.thread_id);
+			const char* thread_name = thread_iter.isValid() ? thread_iter.value().name : "N/A";
+			FlameRoot& root = m_flame_roots.emplace();
+			root.thread = thread_name;
+			root.first_child = -1;
+
+			// returns index of child of `parent` (or of thread root if -1) with `name`, adds it if it does not exist
+			auto getFlameNode = [&](i32 parent, const char* name) -> i32 {
+				i32& first = parent < 0 ? root.first_child : m_flame_nodes[parent].first_child;
+				for (i32 i = first; i >= 0; i = m_flame_nodes[i].next_sibling) {
+					if (m_flame_nodes[i].name == name) return i;
+				}
+				FlameNode& node = m_flame_nodes.emplace();
+				node.name = name;
+				node.next_sibling = first;
+				first = m_flame_nodes.size() - 1;
+				return first;
+			};
+
+			for (u32 p = 0; p != ctx.buffer_size;) {
+				profiler::EventHeader header;
+				read(ctx, p, header);
+				switch (header.type) {
+					case profiler::EventType::BEGIN_JOB: {
+						profiler::JobRecord tmp;
+						read(ctx, p + sizeof(profiler::EventHeader), tmp);
+						open_blocks.push({tmp.id, header.time, -1});
+						break;
+					}
+					case profiler::EventType::BEGIN_BLOCK: {
+						profiler::BlockRecord tmp;
+						read(ctx, p + sizeof(profiler::EventHeader), tmp);
+						open_blocks.push({tmp.id, header.time, -1});
+						break;
+					}
+					case profiler::EventType::CONTINUE_BLOCK: {
+						i32 id;
+						read(ctx, p + sizeof(profiler::EventHeader), id);
+						open_blocks.push({id, header.time, -1});
+						break;
+					}
+					case profiler::EventType::END_BLOCK: {
+						if (open_blocks.empty()) break;
+						const OpenBlock block = open_blocks.last();
+						open_blocks.pop();
+						if (block.start_time < from_time || block.start_time >= to_time) break;
+
+						auto block_iter = m_blocks.find(block.id);
+						const char* name = block_iter.isValid() ? block_iter.value().name : "N/A";
+						const u64 duration = header.time - block.start_time;
+
+						Key key;
+						memset(&key, 0, sizeof(key));
+						key.name = name;
+						key.thread_id = ctx.thread_id;
+						const RuntimeHash hash(&key, sizeof(key));
+						auto row_iter = row_map.find(hash);
+						i32 row_idx;
+						if (row_iter.isValid()) {
+							row_idx = row_iter.value();
+						}
+						else {
+							row_idx = m_aggregate_rows.size();
+							AggregateRow& row = m_aggregate_rows.emplace();
+							row.name = name;
+							row.thread = thread_name;
+							durations.emplace(m_allocator);
+							row_map.insert(hash, row_idx);
+						}
+						AggregateRow& row = m_aggregate_rows[row_idx];
+						++row.count;
+						row.total += duration;
+						durations[row_idx].push(duration);
+
+						// blocks nested in a block started before the window are not in the flame graph
+						if (!open_blocks.empty() && open_blocks[0].start_time < from_time) break;
+
+						// flame node path is built from the outermost block, but blocks end from the innermost one
+						i32 parent = -1;
+						for (OpenBlock& b : open_blocks) {
+							if (b.flame_node < 0) {
+								auto iter = m_blocks.find(b.id);
+								b.flame_node = getFlameNode(parent, iter.isValid() ? iter.value().name : "N/A");
+							}
+							parent = b.flame_node;
+						}
+						const i32 node_idx = block.flame_node >= 0 ? block.flame_node : getFlameNode(parent, name);
+						m_flame_nodes[node_idx].total += duration;
+						++m_flame_nodes[node_idx].count;
+						break;
+					}
+					default: break;
+				}
+				p += header.size;
+			}
+			
+			root.total = 0;
+			for (i32 i = root.first_child; i >= 0; i = m_flame_nodes[i].next_sibling) root.total += m_flame_nodes[i].total;
+			if (root.total == 0) m_flame_roots.pop();
+		});
+
+		for (i32 i = 0; i < m_aggregate_rows.size(); ++i) {
+			AggregateRow& row = m_aggregate_rows[i];
+			Array<u64>& d = durations[i];
+			sort(d.begin(), d.end());
+			row.p50 = d[d.size() / 2];
+			row.p95 = d[d.size() * 95 / 100];
+			row.p99 = d[d.size() * 99 / 100];
+			row.max = d.last();
+		}
+		matchBaseline();
+		m_aggregate_sort_dirty = true;
+	}
+
+	void matchBaseline() {
+		for (AggregateRow& row : m_aggregate_rows) {
+			row.baseline = -1;
+			for (i32 i = 0; i < m_aggregate_baseline.size(); ++i) {
+				const AggregateRow& b = m_aggregate_baseline[i];
+				if (equalStrings(b.name.data, row.name.data) && equalStrings(b.thread.data, row.thread.data)) {
+					row.baseline = i;
+					break;
+				}
+			}
+		}
+	}
+
+	void sortAggregateRows(ImGuiTableSortSpecs* specs) {
+		if (!specs || specs->SpecsCount == 0) return;
+		const ImGuiTableColumnSortSpecs& spec = specs->Specs[0];
+		const bool asc = spec.SortDirection == ImGuiSortDirection_Ascending;
+		auto value = [&](const AggregateRow& r) -> double {
+			switch (spec.ColumnIndex) {
+				case 2: return r.count;
+				case 3: return (double)r.total;
+				case 4: return r.total / (double)r.count;
+				case 5: return (double)r.p50;
+				case 6: return (double)r.p95;
+				case 7: return (double)r.p99;
+				case 8: return (double)r.max;
+				case 9: return r.baseline < 0 ? 0 : (double)r.total - (double)m_aggregate_baseline[r.baseline].total;
+				default: return 0;
+			}
+		};
+		sort(m_aggregate_rows.begin(), m_aggregate_rows.end(), [&](const AggregateRow& a, const AggregateRow& b){
+			if (spec.ColumnIndex == 0) {
+				const i32 cmp = compareString(a.name.data, b.name.data);
+				return asc ? cmp < 0 : cmp > 0;
+			}
+			if (spec.ColumnIndex == 1) {
+				const i32 cmp = compareString(a.thread.data, b.thread.data);
+				return asc ? cmp < 0 : cmp > 0;
+			}
+			return asc ? value(a) < value(b) : value(a) > value(b);
+		});
+	}
+
+	void flameGraphUI(float per_frame) {
+		ImDrawList* dl = ImGui::GetWindowDrawList();
+		const float line_h = ImGui::GetTextLineHeightWithSpacing();
+		const float width = ImGui::GetContentRegionAvail().x;
+		const double to_ms = 1000.0 / profiler::frequency();
+		for (const FlameRoot& root : m_flame_roots) {
+			if (!ImGui::TreeNode(&root, "%s - %.3f ms/frame", root.thread.data, float(root.total * to_ms * per_frame))) continue;
+
+			const ImVec2 origin = ImGui::GetCursorScreenPos();
+			u32 depth = 0;
+			// draw nodes depth-first, children start at parent's x and are laid out next to each other
+			struct Item { i32 node; float x; u32 depth; };
+			StackArray<Item, 64> stack(m_allocator);
+			float x = origin.x;
+			for (i32 i = root.first_child; i >= 0; i = m_flame_nodes[i].next_sibling) {
+				stack.push({i, x, 0});
+				x += float(m_flame_nodes[i].total / (double)root.total * width);
+			}
+			while (!stack.empty()) {
+				const Item item = stack.last();
+				stack.pop();
+				const FlameNode& node = m_flame_nodes[item.node];
+				const float w = float(node.total / (double)root.total * width);
+				depth = maximum(depth, item.depth + 1);
+				if (w < 1) continue;
+
+				const ImVec2 a(item.x, origin.y + item.depth * line_h);
+				const ImVec2 b(item.x + w, a.y + line_h);
+				const u32 color = 0xff000000 | (u32(RuntimeHash(node.name).getHashValue()) & 0x007f7f7f) | 0x00404040;
+				dl->AddRectFilled(a, b, color);
+				dl->AddRect(a, b, 0xff000000);
+				if (w > 20) {
+					dl->PushClipRect(a, b, true);
+					dl->AddText(ImVec2(a.x + 2, a.y), 0xffffffff, node.name);
+					dl->PopClipRect();
+				}
+				if (ImGui::IsMouseHoveringRect(a, b)) {
+					ImGui::SetTooltip("%s\n%.3f ms/frame\n%.2f calls/frame", node.name, float(node.total * to_ms * per_frame), node.count * per_frame);
+				}
+
+				float child_x = item.x;
+				for (i32 i = node.first_child; i >= 0; i = m_flame_nodes[i].next_sibling) {
+					stack.push({i, child_x, item.depth + 1});
+					child_x += float(m_flame_nodes[i].total / (double)root.total * width);
+				}
+			}
+			ImGui::Dummy(ImVec2(width, depth * line_h));
+			ImGui::TreePop();
+		}
+	}
+
+	void aggregateUI() {
+		if (m_data.empty()) {
+			ImGui::TextUnformatted("Make a snapshot in the flamegraph tab first");
+			return;
+		}
+
+		ImGuiEx::Label("Frames");
+		if (ImGui::DragInt("##frames", (i32*)&m_aggregate_frames, 1, 1, 10000)) {
+			m_aggregate_frames = maximum(m_aggregate_frames, 1u);
+			m_aggregate_dirty = true;
+		}
+		if (m_aggregate_dirty) computeAggregate();
+		
+		if (ImGui::Button("Set as baseline")) {
+			m_aggregate_baseline.clear();
+			for (const AggregateRow& row : m_aggregate_rows) m_aggregate_baseline.push(row);
+			m_aggregate_baseline_frames = m_aggregate_num_frames;
+			matchBaseline();
+		}
+		if (!m_aggregate_baseline.empty()) {
+			ImGui::SameLine();
+			if (ImGui::Button("Clear baseline")) {
+				m_aggregate_baseline.clear();
+				matchBaseline();
+			}
+		}
+		if (m_aggregate_num_frames == 0) {
+			ImGui::TextUnformatted("Not enough frames in the snapshot");
+			return;
+		}
+
+		const double to_ms = 1000.0 / profiler::frequency();
+		const float per_frame = 1.f / m_aggregate_num_frames;
+		ImGui::Text("%u frames, frame time avg %.2f ms, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms"
+			, m_aggregate_num_frames
+			, float(m_aggregate_frame_times.total * to_ms * per_frame)
+			, float(m_aggregate_frame_times.p50 * to_ms)
+			, float(m_aggregate_frame_times.p95 * to_ms)
+			, float(m_aggregate_frame_times.p99 * to_ms)
+			, float(m_aggregate_frame_times.max * to_ms));
+
+		if (m_app.checkShortcut(m_focus_filter)) ImGui::SetKeyboardFocusHere();
+		m_filter.gui("Filter", -1, false, &m_focus_filter);
+
+		if (ImGui::CollapsingHeader("Flame graph")) flameGraphUI(per_frame);
+
+		const bool has_baseline = !m_aggregate_baseline.empty();
+		const ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_Sortable | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+		if (!ImGui::BeginTable("aggregate", has_baseline ? 10 : 9, flags)) return;
+
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Name");
+		ImGui::TableSetupColumn("Thread");
+		ImGui::TableSetupColumn("Count/frame");
+		ImGui::TableSetupColumn("Total ms/frame", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+		ImGui::TableSetupColumn("Mean (ms)");
+		ImGui::TableSetupColumn("p50 (ms)");
+		ImGui::TableSetupColumn("p95 (ms)");
+		ImGui::TableSetupColumn("p99 (ms)");
+		ImGui::TableSetupColumn("Max (ms)");
+		if (has_baseline) ImGui::TableSetupColumn("Diff ms/frame");
+		ImGui::TableHeadersRow();
+
+		ImGuiTableSortSpecs* specs = ImGui::TableGetSortSpecs();
+		if (specs && (specs->SpecsDirty || m_aggregate_sort_dirty)) {
+			sortAggregateRows(specs);
+			specs->SpecsDirty = false;
+			m_aggregate_sort_dirty = false;
+		}
+
+		for (const AggregateRow& row : m_aggregate_rows) {
+			if (!m_filter.pass(row.name) && !m_filter.pass(row.thread)) continue;
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(row.name);
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(row.thread);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", row.count * per_frame);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", float(row.total * to_ms * per_frame));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", float(row.total * to_ms / row.count));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", float(row.p50 * to_ms));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", float(row.p95 * to_ms));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", float(row.p99 * to_ms));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", float(row.max * to_ms));
+			if (has_baseline) {
+				ImGui::TableNextColumn();
+				if (row.baseline < 0) {
+					ImGui::TextUnformatted("new");
+				}
+				else {
+					const AggregateRow& b = m_aggregate_baseline[row.baseline];
+					const float now = float(row.total * to_ms * per_frame);
+					const float before = float(b.total * to_ms / maximum(m_aggregate_baseline_frames, 1u));
+					const float diff = now - before;
+					const ImVec4 color = diff > 0 ? ImVec4(1, 0.4f, 0.4f, 1) : ImVec4(0.4f, 1, 0.4f, 1);
+					ImGui::TextColored(color, "%+.3f (%+.0f%%)", diff, before > 0 ? diff / before * 100 : 0.f);
+				}
+			}
+		}
+		ImGui::EndTable();
+	}
+
+	// per-frame averages of job system stats, resampled every half a second, so they are readable
+	void jobsUI() {
+		jobs::WorkerStats stats[256];
+		const u32 num_workers = jobs::getWorkerStats(Span(stats));
+		const u64 now = os::Timer::getRawTimestamp();
+		++m_jobs_stats.frames;
+		if (m_jobs_stats.num_workers != num_workers) {
+			m_jobs_stats.num_workers = num_workers;
+			m_jobs_stats.frames = 0;
+			m_jobs_stats.sample_time = now;
+			memcpy(m_jobs_stats.prev, stats, sizeof(stats[0]) * num_workers);
+			memset(m_jobs_stats.per_frame, 0, sizeof(m_jobs_stats.per_frame));
+			memset(m_jobs_stats.idle, 0, sizeof(m_jobs_stats.idle));
+		}
+		else if (os::Timer::rawToSeconds(now - m_jobs_stats.sample_time) > 0.5f && m_jobs_stats.frames > 0) {
+			const float frames = (float)m_jobs_stats.frames;
+			const u64 elapsed = now - m_jobs_stats.sample_time;
+			for (u32 i = 0; i < num_workers; ++i) {
+				const jobs::WorkerStats& s = stats[i];
+				const jobs::WorkerStats& p = m_jobs_stats.prev[i];
+				JobsStats::PerFrame& r = m_jobs_stats.per_frame[i];
+				r.jobs = (s.jobs - p.jobs) / frames;
+				r.fiber_resumes = (s.fiber_resumes - p.fiber_resumes) / frames;
+				r.worker_queue_pops = (s.worker_queue_pops - p.worker_queue_pops) / frames;
+				r.local_pops = (s.local_pops - p.local_pops) / frames;
+				r.global_pops = (s.global_pops - p.global_pops) / frames;
+				r.steal_attempts = (s.steal_attempts - p.steal_attempts) / frames;
+				r.steals = (s.steals - p.steals) / frames;
+				m_jobs_stats.idle[i] = minimum(float(double(s.sleep_ticks - p.sleep_ticks) / elapsed), 1.f);
+			}
+			memcpy(m_jobs_stats.prev, stats, sizeof(stats[0]) * num_workers);
+			m_jobs_stats.frames = 0;
+			m_jobs_stats.sample_time = now;
+		}
+
+		for (u32 i = 0; i < 2; ++i) {
+			const bool large = i == 1;
+			const jobs::FiberPoolStats fibers = jobs::getFiberPoolStats(large);
+			ImGuiEx::Label(large ? "Large stack fibers in use" : "Fibers in use");
+			ImGui::ProgressBar(fibers.in_use / maximum((float)fibers.size, 1.f), ImVec2(-1, 0), StaticString<64>(fibers.in_use, " / ", fibers.size, " (max ", fibers.high_water_mark, ")"));
+		}
+
+		if (!ImGui::BeginTable("jobs", 10, ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg)) return;
+
+		ImGui::TableSetupColumn("Worker");
+		ImGui::TableSetupColumn("Utilization");
+		ImGui::TableSetupColumn("Jobs");
+		ImGui::TableSetupColumn("Resumed fibers");
+		ImGui::TableSetupColumn("Pinned pops");
+		ImGui::TableSetupColumn("Local pops");
+		ImGui::TableSetupColumn("Global pops");
+		ImGui::TableSetupColumn("Steal attempts");
+		ImGui::TableSetupColumn("Steals");
+		ImGui::TableSetupColumn("Steal success");
+		ImGui::TableHeadersRow();
+		for (u32 i = 0; i < num_workers; ++i) {
+			const JobsStats::PerFrame& r = m_jobs_stats.per_frame[i];
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("#%u%s", i, jobs::getWorkerCoreClass(i) == jobs::CoreClass::EFFICIENCY ? " (E)" : "");
+			ImGui::TableNextColumn();
+			// time not spent sleeping, includes spinning on empty queues
+			const float utilization = 1 - m_jobs_stats.idle[i];
+			ImGui::ProgressBar(utilization, ImVec2(-1, 0), StaticString<16>(u32(utilization * 100 + 0.5f), "%"));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", r.jobs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", r.fiber_resumes);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", r.worker_queue_pops);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", r.local_pops);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", r.global_pops);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", r.steal_attempts);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", r.steals);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f%%", r.steal_attempts > 0 ? r.steals / r.steal_attempts * 100 : 0.f);
+		}
+		ImGui::EndTable();
+		ImGui::TextDisabled("Values are averages per frame");
+	}
+
 	void GPUUI() {
 		profiler::GPUScopeStats stats[256];
 		const u32 num_stats = profiler::getGPUScopeStats(Span(stats));
@@ -1547,11 +2218,15 @@ struct ProfilerUIImpl final : ProfilerUI {
 			ImGuiEx::Label("GPU clock");
 			ImGui::Text("%d MHz", u32(gpu_clock));
 		}
-		if (ImGui::BeginTable("gpu", 4, ImGuiTableFlags_Resizable)) {
+		if (ImGui::BeginTable("gpu", 8, ImGuiTableFlags_Resizable)) {
 			ImGui::TableSetupColumn("Name");
 			ImGui::TableSetupColumn("Min (ms)");
 			ImGui::TableSetupColumn("Max (ms)");
 			ImGui::TableSetupColumn("Avg (ms)");
+			ImGui::TableSetupColumn("Primitives");
+			ImGui::TableSetupColumn("Culled");
+			ImGui::TableSetupColumn("VS invocations");
+			ImGui::TableSetupColumn("PS invocations");
 			ImGui::TableHeadersRow();
 			for (u32 i = 0; i < num_stats; ++i) {
 				const profiler::GPUScopeStats& s = stats[i];
@@ -1565,6 +2240,16 @@ struct ProfilerUIImpl final : ProfilerUI {
 				ImGui::Text("%.3f", s.max * 1000);
 				ImGui::TableNextColumn();
 				ImGui::Text("%.3f", s.avg * 1000);
+				if (s.has_pipeline_stats) {
+					ImGui::TableNextColumn();
+					ImGui::Text("%" PRIu64, s.pipeline_stats.input_primitives);
+					ImGui::TableNextColumn();
+					ImGui::Text("%" PRIu64, s.pipeline_stats.culled_primitives);
+					ImGui::TableNextColumn();
+					ImGui::Text("%" PRIu64, s.pipeline_stats.vs_invocations);
+					ImGui::TableNextColumn();
+					ImGui::Text("%" PRIu64, s.pipeline_stats.ps_invocations);
+				}
 			}
 			ImGui::EndTable();
 		}
@@ -1590,6 +2275,8 @@ struct ProfilerUIImpl final : ProfilerUI {
 			if (ImGui::MenuItem("Save")) save();
 			ImGui::Checkbox("Show frames", &m_show_frames);
 			ImGui::Checkbox("Show mutex events", &m_show_mutex_events);
+			bool hw_counters = profiler::hwCountersEnabled();
+			if (ImGui::Checkbox("Hardware counters", &hw_counters)) profiler::enableHWCounters(hw_counters);
 			ImGui::Text("Zoom: %f", m_range / double(DEFAULT_RANGE));
 			if (ImGui::MenuItem("Reset zoom")) m_range = DEFAULT_RANGE;
 			bool do_autopause = m_autopause >= 0;
@@ -1717,6 +2404,50 @@ struct ProfilerUIImpl final : ProfilerUI {
 	Array<Counter> m_counters;
 	HashMap<i32, Block> m_blocks;
 
+	struct AggregateRow {
+		StaticString<128> name;
+		StaticString<32> thread;
+		u32 count = 0;
+		u64 total = 0; // ticks
+		u64 p50 = 0;
+		u64 p95 = 0;
+		u64 p99 = 0;
+		u64 max = 0;
+		i32 baseline = -1; // index of the same block in m_aggregate_baseline
+	};
+
+	// names point to m_data, so nodes are rebuilt on every snapshot
+	struct FlameNode {
+		const char* name;
+		i32 first_child = -1;
+		i32 next_sibling = -1;
+		u64 total = 0;
+		u32 count = 0;
+	};
+
+	struct FlameRoot {
+		StaticString<32> thread;
+		i32 first_child;
+		u64 total;
+	};
+
+	Array<AggregateRow> m_aggregate_rows;
+	Array<AggregateRow> m_aggregate_baseline; // copy, so it survives new snapshots
+	Array<FlameNode> m_flame_nodes;
+	Array<FlameRoot> m_flame_roots;
+	u32 m_aggregate_frames = 100;
+	u32 m_aggregate_num_frames = 0; // can be less than m_aggregate_frames if the snapshot is short
+	u32 m_aggregate_baseline_frames = 0;
+	bool m_aggregate_dirty = true;
+	bool m_aggregate_sort_dirty = true;
+	struct {
+		u64 total;
+		u64 p50;
+		u64 p95;
+		u64 p99;
+		u64 max;
+	} m_aggregate_frame_times = {};
+
 	Action m_toggle_ui{"Profiler", "Profiler", "Toggle UI", "profiler_toggle_ui", "", Action::WINDOW};
 	Action m_snapshot{"Profiler", "Make snapshot", "Make snapshot", "profiler_play_pause", ICON_FA_DOWNLOAD};
 	Action m_focus_filter{"Profiler", "Focus filter", "Focus filter", "profiler_focus_filter", ""};
@@ -1754,6 +2485,24 @@ struct ProfilerUIImpl final : ProfilerUI {
 		u32 frame = 0;
 		i32 id = -1;
 	} m_hovered_block;
+
+	struct JobsStats {
+		struct PerFrame {
+			float jobs;
+			float fiber_resumes;
+			float worker_queue_pops;
+			float local_pops;
+			float global_pops;
+			float steal_attempts;
+			float steals;
+		};
+		u32 num_workers = 0;
+		u32 frames = 0;
+		u64 sample_time = 0;
+		jobs::WorkerStats prev[256];
+		PerFrame per_frame[256];
+		float idle[256];
+	} m_jobs_stats;
 };
 
 } // anonymous namespace
@@ -370,8 +370,10 @@ struct GridUIVisitor final : reflection::IPropertyVisitor
 			}
 		}
 		else {
-			if (ImGui::InputText("##v", path.beginUpdate(), path.capacity())) {
-				path.endUpdate();
+			char tmp[MAX_PATH];
+			copyString(Span(tmp), path);
+			if (ImGui::InputText("##v", tmp, sizeof(tmp))) {
+				path = tmp;
 				m_editor.setProperty(m_cmp_type, m_array, m_index, prop.name, m_entities, path);
 			}
 		}
@@ -18,6 +18,7 @@
 #include "core/os.h"
 #include "core/path.h"
 #include "core/profiler.h"
+#include "core/sort.h"
 #include "editor/asset_browser.h"
 #include "editor/asset_compiler.h"
 #include "editor/entity_folders.h"
@@ -583,7 +584,11 @@ struct StudioAppImpl final : StudioApp {
 		if (workersCountOption(workers)) {
 			cpus_count = workers;
 		}
-		if (!jobs::init(cpus_count, m_allocator)) {
+		jobs::FiberPoolConfig fibers;
+		CommandLineParser::getValue("-fibers", fibers.small_count);
+		CommandLineParser::getValue("-large_fibers", fibers.large_count);
+		if (CommandLineParser::getValue("-fiber_stack_kb", fibers.small_stack_size)) fibers.small_stack_size *= 1024;
+		if (!jobs::init(cpus_count, m_allocator, CommandLineParser::isOn("-cpu_topology"), fibers)) {
 			logError("Failed to initialize job system.");
 		}
 
@@ -844,7 +849,9 @@ struct StudioAppImpl final : StudioApp {
 
 		guiEndFrame();
 
-		if (m_first_update) {
+		if (m_cook && !m_asset_compiler->isCooking()) finishCook();
+
+		if (m_first_update && !m_cook) {
 			// we show window after the first update, so it does not show default (white) background
 			// only to be replace with actual (potentially dark) content
 			os::showWindow(m_main_window);
@@ -855,7 +862,7 @@ struct StudioAppImpl final : StudioApp {
 		if (os::isAppForeground()) m_frames_since_foreground = 0;
 		else ++m_frames_since_foreground;
 
-		if (m_sleep_when_inactive && m_frames_since_foreground > 10) {
+		if (m_sleep_when_inactive && m_frames_since_foreground > 10 && !m_cook) {
 			const float frame_time = m_inactive_fps_timer.tick();
 			const float wanted_fps = 5.0f;
 
@@ -949,6 +956,7 @@ struct StudioAppImpl final : StudioApp {
 			#undef LUMIX_PLUGINS_STRINGS
 		};
 		init_data.plugins = Span(plugins, plugins + lengthOf(plugins) - 1);
+		init_data.use_slab_allocator = CommandLineParser::isOn("-slab_allocator");
 		m_engine = Engine::create(static_cast<Engine::InitArgs&&>(init_data), m_allocator);
 		FileSystem& fs = m_engine->getFileSystem();
 		const char* base_path = fs.getBasePath();
@@ -959,11 +967,13 @@ struct StudioAppImpl final : StudioApp {
 		m_settings.registerOption("welcome_shader", &m_welcome_screen_use_shader, "General", "Animated background in welcome screen");
 		m_settings.registerOption("report_crashes", &m_crash_reporting, "General", "Report crashes");
 		m_settings.registerOption("sleep_when_inactive", &m_sleep_when_inactive, "General", "Throttle FPS in background");
+		m_settings.registerOption("render_on_demand", &ViewThrottle::s_enabled, "General", "Render idle views on demand");
 		m_settings.registerOption("fileselector_dir", &m_file_selector.m_path);
 		m_settings.registerOption("font_size", &m_font_size, "General", "Font size").setMin(1);
 		m_settings.registerOption("code_editor_font_size", &CodeEditor::s_font_size, "Code editor", "Font size").setMin(1);
 		m_settings.registerOption("code_editor_show_line_nums", &CodeEditor::s_show_line_numbers, "Code editor", "Show line numbers");
 		m_settings.registerOption("export_pack", &m_export.pack);
+		m_settings.registerOption("export_compress", &m_export.compress);
 		m_settings.registerOption("export_dir", &m_export.dest_dir);
 		m_settings.registerOption("gizmo_scale", &m_gizmo_config.scale, "General", "Gizmo scale").setMin(0.001f);
 		m_settings.registerOption("fov", &m_fov, "General", "FOV").setMin(1).setMax(179).setIsAngle(true);
@@ -1013,6 +1023,7 @@ struct StudioAppImpl final : StudioApp {
 
 		m_asset_compiler->onInitFinished();
 		m_asset_browser->onInitFinished();
+		checkCookCommandLine();
 		
 		loadLogo();
 
@@ -2454,6 +2465,8 @@ struct StudioAppImpl final : StudioApp {
 			return;
 		}
 
+		m_watched_plugin.system->initAsync();
+
 		InputMemoryStream input_blob(blob);
 		m_watched_plugin.system->createModules(*world);
 		for (const UniquePtr<IModule>& module : world->getModules()) {
@@ -2504,6 +2517,44 @@ struct StudioAppImpl final : StudioApp {
 		}
 	}
 
+	// -cook compiles all outdated resources with the main window hidden and exits, -cook_export <dir> also exports main.pak to <dir>
+	// exit code is 1 if any resource failed to compile or the export failed
+	void checkCookCommandLine() {
+		char cmd_line[2048];
+		os::getCommandLine(Span(cmd_line));
+
+		CommandLineParser parser(cmd_line);
+		while (parser.next()) {
+			if (parser.currentEquals("-cook")) {
+				m_cook = true;
+			}
+			else if (parser.currentEquals("-cook_export")) {
+				if (!parser.next()) break;
+				char dir[MAX_PATH];
+				parser.getCurrent(dir, lengthOf(dir));
+				if (dir[0] && !endsWith(dir, "/") && !endsWith(dir, "\\")) catString(dir, "/");
+				m_cook = true;
+				m_cook_export = true;
+				m_export.dest_dir = dir;
+			}
+		}
+		if (m_cook) m_asset_compiler->cook();
+	}
+
+	void finishCook() {
+		m_cook = false;
+		int exit_code = m_asset_compiler->getCookFailuresCount() > 0 ? 1 : 0;
+		if (m_cook_export && exit_code == 0) {
+			m_export.mode = ExportConfig::Mode::ALL_FILES;
+			m_export.pack = true;
+			if (!exportData()) {
+				logError("Export to ", m_export.dest_dir, " failed");
+				exit_code = 1;
+			}
+		}
+		exitWithCode(exit_code);
+	}
+
 	static void checkDataDirCommandLine(char* dir, int max_size)
 	{
 		char cmd_line[2048];
@@ -2887,6 +2938,11 @@ struct StudioAppImpl final : StudioApp {
 
 			ImGuiEx::Label("Pack data");
 			ImGui::Checkbox("##pack", &m_export.pack);
+			if (m_export.pack) {
+				ImGuiEx::Label("Compress");
+				ImGui::Checkbox("##compress", &m_export.compress);
+				if (ImGui::IsItemHovered()) ImGui::SetTooltip("Compressed files must be decompressed when loaded, uncompressed are used directly from memory mapped pak");
+			}
 			ImGuiEx::Label("Mode");
 			ImGui::Combo("##mode", (int*)&m_export.mode, "All files\0Loaded world\0");
 
@@ -2948,28 +3004,20 @@ struct StudioAppImpl final : StudioApp {
 				logError("No files found while trying to create ", dest);
 				return false;
 			}
-			u64 total_size = 0;
-			for (ExportFileInfo& info : infos) {
-				info.offset = total_size;
-				total_size += info.size;
-			}
-			
 			os::OutputFile file;
 			if (!file.open(dest)) {
 				logError("Could not create ", dest);
 				return false;
 			}
 
-			const u32 count = (u32)infos.size();
-			bool success = file.write(&count, sizeof(count));
-
-			for (auto& info : infos) {
-				success = file.write(&info.hash, sizeof(info.hash)) && success;
-				success = file.write(&info.offset, sizeof(info.offset)) && success;
-				success = file.write(&info.size, sizeof(info.size)) && success;
-			}
-
+			// see PakEntry for the layout
+			static const u8 zeros[PakFooter::ALIGNMENT] = {};
+			Array<PakEntry> entries(m_allocator);
+			entries.reserve(infos.size());
 			OutputMemoryStream src(m_allocator);
+			OutputMemoryStream compressed(m_allocator);
+			bool success = true;
+			u64 offset = 0;
 			for (const ExportFileInfo& info : infos) {
 				src.clear();
 				if (!fs.getContentSync(Path(info.path), src)) {
@@ -2977,8 +3025,36 @@ struct StudioAppImpl final : StudioApp {
 					file.close();
 					return false;
 				}
-				success = file.write(src.data(), src.size()) && success;
+
+				PakEntry& entry = entries.emplace();
+				entry.hash = info.hash;
+				entry.offset = offset;
+				entry.original_size = src.size();
+				Span<const u8> data = src;
+				if (m_export.compress && src.size() > 0) {
+					compressed.clear();
+					// compress only if it's worth it, uncompressed files are loaded without copy
+					if (m_engine->compress(src, compressed) && compressed.size() < src.size() - src.size() / 8) {
+						data = compressed;
+						entry.flags = PakEntry::Flags::LZ4;
+					}
+				}
+				entry.size = data.length();
+				success = file.write(data.begin(), data.length()) && success;
+
+				const u64 aligned_offset = (offset + entry.size + PakFooter::ALIGNMENT - 1) & ~u64(PakFooter::ALIGNMENT - 1);
+				const u64 padding = aligned_offset - offset - entry.size;
+				if (padding > 0) success = file.write(zeros, padding) && success;
+				offset = aligned_offset;
 			}
+
+			sort(entries.begin(), entries.end(), [](const PakEntry& a, const PakEntry& b){ return a.hash < b.hash; });
+			success = file.write(entries.begin(), entries.byte_size()) && success;
+
+			PakFooter footer;
+			footer.index_offset = offset;
+			footer.count = entries.size();
+			success = file.write(&footer, sizeof(footer)) && success;
 			file.close();
 
 			if (!success) {
@@ -3114,6 +3190,9 @@ struct StudioAppImpl final : StudioApp {
 	Gizmo::Config m_gizmo_config;
 
 	bool m_first_update = true;
+	// headless asset cooking, see checkCookCommandLine
+	bool m_cook = false;
+	bool m_cook_export = false;
 	bool m_show_save_world_ui = false;
 	bool m_cursor_clipped = false;
 	bool m_confirm_exit = false;
@@ -3159,6 +3238,7 @@ struct StudioAppImpl final : StudioApp {
 		Mode mode = Mode::ALL_FILES;
 
 		bool pack = false;
+		bool compress = false;
 		Path startup_world;
 		String dest_dir;
 	};
@@ -4,6 +4,8 @@
 #include "action.h"
 #include "core/command_line_parser.h"
 #include "core/defer.h"
+#include "core/geometry.h"
+#include "core/hash.h"
 #include "core/log.h"
 #include "core/math.h"
 #include "core/os.h"
@@ -2495,6 +2497,55 @@ bool inputRotation(const char* label, Quat* value) {
 	return false;
 }
 
+bool ViewThrottle::s_enabled = true;
+
+RuntimeHash32 ViewThrottle::getWorldViewState(const Viewport& vp, WorldEditor& editor) {
+	const World* world = editor.getWorld();
+	const u32 change_counter = editor.getChangeCounter();
+	const Span<const EntityRef> selected = editor.getSelectedEntities();
+	RollingHasher hasher;
+	hasher.begin();
+	hasher.update(&vp.pos, sizeof(vp.pos));
+	hasher.update(&vp.rot, sizeof(vp.rot));
+	hasher.update(&vp.w, sizeof(vp.w));
+	hasher.update(&vp.h, sizeof(vp.h));
+	hasher.update(&vp.fov, sizeof(vp.fov));
+	hasher.update(&vp.is_ortho, sizeof(vp.is_ortho));
+	hasher.update(&vp.ortho_size, sizeof(vp.ortho_size));
+	hasher.update(&vp.near, sizeof(vp.near));
+	hasher.update(&vp.far, sizeof(vp.far));
+	hasher.update(&world, sizeof(world));
+	hasher.update(&change_counter, sizeof(change_counter));
+	hasher.update(selected.begin(), selected.length() * sizeof(selected[0]));
+	return hasher.end();
+}
+
+bool ViewThrottle::shouldRender(RuntimeHash32 state, bool focused) {
+	const bool changed = state != m_state;
+	m_state = state;
+	return throttle(changed, focused);
+}
+
+bool ViewThrottle::shouldRender(bool focused) {
+	return throttle(true, focused);
+}
+
+bool ViewThrottle::throttle(bool changed, bool focused) {
+	if (changed) m_settle_frames = SETTLE_FRAMES;
+	if (!s_enabled) return true;
+
+	float min_interval = 0;
+	if (!focused) min_interval = 1 / BACKGROUND_FPS;
+	if (m_settle_frames == 0) min_interval = 1 / IDLE_FPS;
+
+	const u64 now = os::Timer::getRawTimestamp();
+	if (m_last_render != 0 && float(now - m_last_render) < min_interval * os::Timer::getFrequency()) return false;
+
+	m_last_render = now;
+	if (m_settle_frames > 0) --m_settle_frames;
+	return true;
+}
+
 SimpleUndoRedo::SimpleUndoRedo(IAllocator& allocator)
 	: m_stack(allocator)
 	, m_allocator(allocator)
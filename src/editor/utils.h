@@ -4,6 +4,7 @@
 
 #include "core/array.h"
 #include "core/delegate.h"
+#include "core/hash.h"
 #include "core/span.h"
 #include "core/string.h"
 #include "core/stream.h"
@@ -36,6 +37,34 @@ LUMIX_EDITOR_API void openCenterStrip(const char* str_id);
 LUMIX_EDITOR_API bool beginCenterStrip(const char* str_id, u32 lines = 5);
 LUMIX_EDITOR_API void endCenterStrip();
 
+// decides when an editor view renders its pipeline, so idle views do not keep GPU busy
+// view renders when its state changes, then a few more frames so temporal effects (TAA, exposure) settle,
+// otherwise at IDLE_FPS, which picks up changes not in the state, e.g. resources finishing loading
+// views which are not focused render at most at BACKGROUND_FPS
+struct LUMIX_EDITOR_API ViewThrottle {
+	static constexpr u32 SETTLE_FRAMES = 8;
+	static constexpr float IDLE_FPS = 4;
+	static constexpr float BACKGROUND_FPS = 10;
+	// views render every frame if disabled, see "render_on_demand" setting
+	static bool s_enabled;
+
+	// `state` - hash of everything the view's image depends on, e.g. camera and world changes
+	bool shouldRender(RuntimeHash32 state, bool focused);
+	// view's image changes every frame, e.g. game is running, so only views which are not focused are throttled
+	bool shouldRender(bool focused);
+	// next frames render as if the state changed
+	void invalidate() { m_settle_frames = SETTLE_FRAMES; }
+	// state of a view showing editor's world from `vp` - camera, world changes and selection
+	static RuntimeHash32 getWorldViewState(const struct Viewport& vp, struct WorldEditor& editor);
+
+private:
+	bool throttle(bool changed, bool focused);
+
+	RuntimeHash32 m_state;
+	u32 m_settle_frames = SETTLE_FRAMES;
+	u64 m_last_render = 0;
+};
+
 struct LUMIX_EDITOR_API SimpleUndoRedo {
 	enum { NO_MERGE_UNDO = 0xffFFffFF };
 	struct Undo {
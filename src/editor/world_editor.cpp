@@ -626,84 +626,126 @@ public:
 		ASSERT(count > 0);
 		World* world = m_editor.getWorld();
 		m_entities.reserve(count);
-		m_new_positions.reserve(count);
-		m_new_rotations.reserve(count);
 		m_old_positions.reserve(count);
 		m_old_rotations.reserve(count);
 		for (int i = count - 1; i >= 0; --i)
 		{
 			m_entities.push(entities[i]);
-			m_new_positions.push(new_positions[i]);
-			m_new_rotations.push(new_rotations[i]);
 			m_old_positions.push(world->getPosition(entities[i]));
 			m_old_rotations.push(world->getRotation(entities[i]));
 		}
+
+		// moving a selection with gizmo translates all entities by the same offset,
+		// in that case we keep only the offset instead of new transforms
+		m_delta = new_positions[count - 1] - m_old_positions[0];
+		m_is_uniform = true;
+		for (int i = 0; i < count && m_is_uniform; ++i) {
+			const DVec3 d = new_positions[count - 1 - i] - m_old_positions[i];
+			const Quat& new_rot = new_rotations[count - 1 - i];
+			const Quat& old_rot = m_old_rotations[i];
+			m_is_uniform = squaredLength(d - m_delta) < 1e-12
+				&& new_rot.x == old_rot.x && new_rot.y == old_rot.y && new_rot.z == old_rot.z && new_rot.w == old_rot.w;
+		}
+
+		if (!m_is_uniform) {
+			m_new_positions.reserve(count);
+			m_new_rotations.reserve(count);
+			for (int i = count - 1; i >= 0; --i) {
+				m_new_positions.push(new_positions[i]);
+				m_new_rotations.push(new_rotations[i]);
+			}
+		}
 	}
 
 
-	bool execute() override
-	{
+	void apply(bool is_undo) {
 		World* world = m_editor.getWorld();
+		Array<EntityRef> entities(m_editor.getAllocator());
+		Array<Transform> transforms(m_editor.getAllocator());
+		entities.reserve(m_entities.size());
+		transforms.reserve(m_entities.size());
 		for (int i = 0, c = m_entities.size(); i < c; ++i) {
-			if(m_entities[i].isValid()) {
-				const EntityRef entity = (EntityRef)m_entities[i];
-				world->setPosition(entity, m_new_positions[i]);
-				world->setRotation(entity, m_new_rotations[i]);
+			if (!m_entities[i].isValid()) continue;
+
+			const EntityRef entity = (EntityRef)m_entities[i];
+			Transform& tr = transforms.emplace(world->getTransform(entity));
+			entities.push(entity);
+			if (is_undo) {
+				tr.pos = m_old_positions[i];
+				tr.rot = m_old_rotations[i];
+			}
+			else if (m_is_uniform) {
+				tr.pos = m_old_positions[i] + m_delta;
+				tr.rot = m_old_rotations[i];
+			}
+			else {
+				tr.pos = m_new_positions[i];
+				tr.rot = m_new_rotations[i];
 			}
 		}
+		world->setTransforms(entities, transforms);
+	}
+
+
+	bool execute() override
+	{
+		apply(false);
 		return true;
 	}
 
 
 	void undo() override
 	{
-		World* world = m_editor.getWorld();
-		for (int i = 0, c = m_entities.size(); i < c; ++i) {
-			if(m_entities[i].isValid()) {
-				EntityRef entity = (EntityRef)m_entities[i];
-				world->setPosition(entity, m_old_positions[i]);
-				world->setRotation(entity, m_old_rotations[i]);
-			}
-		}
+		apply(true);
 	}
 
 
 	const char* getType() override { return "move_entity"; }
 
 
+	u64 getMemorySize() override {
+		return m_entities.byte_size() + m_new_positions.byte_size() + m_new_rotations.byte_size() + m_old_positions.byte_size() + m_old_rotations.byte_size();
+	}
+
+
 	bool merge(IEditorCommand& command) override
 	{
 		ASSERT(command.getType() == getType());
 		MoveEntityCommand& my_command = static_cast<MoveEntityCommand&>(command);
-		if (my_command.m_entities.size() == m_entities.size())
+		if (my_command.m_entities.size() != m_entities.size()) return false;
+		if (my_command.m_is_uniform != m_is_uniform) return false;
+
+		for (int i = 0, c = m_entities.size(); i < c; ++i)
 		{
-			for (int i = 0, c = m_entities.size(); i < c; ++i)
+			if (m_entities[i] != my_command.m_entities[i])
 			{
-				if (m_entities[i] != my_command.m_entities[i])
-				{
-					return false;
-				}
+				return false;
 			}
+		}
+
+		if (m_is_uniform) {
+			my_command.m_delta = my_command.m_delta + m_delta;
+		}
+		else {
 			for (int i = 0, c = m_entities.size(); i < c; ++i)
 			{
 				my_command.m_new_positions[i] = m_new_positions[i];
 				my_command.m_new_rotations[i] = m_new_rotations[i];
 			}
-			return true;
-		}
-		else
-		{
-			return false;
 		}
+		return true;
 	}
 
 private:
 	WorldEditor& m_editor;
 	Array<EntityPtr> m_entities;
+	// empty if m_is_uniform
 	Array<DVec3> m_new_positions;
 	Array<Quat> m_new_rotations;
 	Array<DVec3> m_old_positions;
 	Array<Quat> m_old_rotations;
+	DVec3 m_delta = DVec3(0);
+	bool m_is_uniform = false;
 };
 
 struct LocalRotateEntityCommand final : IEditorCommand {
@@ -929,34 +971,42 @@ public:
 	}
 
 
-	bool execute() override
-	{
+	void apply(const Array<Vec3>& scales) {
 		World* world = m_editor.getWorld();
+		Array<EntityRef> entities(m_editor.getAllocator());
+		Array<Transform> transforms(m_editor.getAllocator());
+		entities.reserve(m_entities.size());
+		transforms.reserve(m_entities.size());
 		for (int i = 0, c = m_entities.size(); i < c; ++i) {
-			if (m_entities[i].isValid()) {
-				EntityRef entity = (EntityRef)m_entities[i];
-				world->setScale(entity, m_new_scales[i]);
-			}
+			if (!m_entities[i].isValid()) continue;
+
+			const EntityRef entity = (EntityRef)m_entities[i];
+			transforms.emplace(world->getTransform(entity)).scale = scales[i];
+			entities.push(entity);
 		}
+		world->setTransforms(entities, transforms);
+	}
+
+
+	bool execute() override
+	{
+		apply(m_new_scales);
 		return true;
 	}
 
 
 	void undo() override
 	{
-		World* world = m_editor.getWorld();
-		for (int i = 0, c = m_entities.size(); i < c; ++i) {
-			if (m_entities[i].isValid()) {
-				EntityRef entity = (EntityRef)m_entities[i];
-				world->setScale(entity, m_old_scales[i]);
-			}
-		}
+		apply(m_old_scales);
 	}
 
 
 	const char* getType() override { return "scale_entity"; }
 
 
+	u64 getMemorySize() override { return m_entities.byte_size() + m_new_scales.byte_size() + m_old_scales.byte_size(); }
+
+
 	bool merge(IEditorCommand& command) override
 	{
 		ASSERT(command.getType() == getType());
@@ -1203,11 +1253,11 @@ public:
 				if (!equalIStrings(prop_name, prop.name)) return;
 				found = true;
 				World* world = cmd->m_editor.getWorld();
-				for (EntityPtr entity : cmd->m_entities) {
-					const ComponentUID cmp(entity, cmd->m_component_type, world->getModule(cmd->m_component_type));
-					ASSERT(prop.setter);
-					prop.set(cmp, cmd->m_index, StoredType<T>::get(cmd->m_new_value));
-				}
+				ASSERT(prop.setter);
+				Array<T> values(cmd->m_editor.getAllocator());
+				values.resize(cmd->m_entities.size());
+				for (T& value : values) value = StoredType<T>::get(cmd->m_new_value);
+				prop.setMany(world->getModule(cmd->m_component_type), cmd->m_entities, cmd->m_index, values);
 			}
 
 			void visit(const reflection::ArrayProperty& prop) override { 
@@ -1935,6 +1985,7 @@ public:
 	}
 
 	bool isWorldChanged() const override { return m_is_world_changed; }
+	u32 getChangeCounter() const override { return m_change_counter; }
 
 	void savePartition(World::PartitionHandle partition) override {
 		ASSERT(!isGameMode());
@@ -1988,8 +2039,8 @@ public:
 
 		ASSERT(m_world);
 
-		OutputMemoryStream blob(m_allocator);
-		blob.reserve(64 * 1024);
+		// big worlds would reallocate and copy a contiguous buffer many times
+		OutputChunkedStream blob(m_allocator);
 
 		m_world->serialize(blob, is_game_mode_save ? WorldSerializeFlags::HAS_PARTITIONS : WorldSerializeFlags::NONE);
 		m_prefab_system->serialize(blob);
@@ -2004,7 +2055,7 @@ public:
 			blob.write(pos);
 			blob.write(Quat::IDENTITY);
 		}
-		file.write(blob.data(), blob.size());
+		blob.writeTo(file);
 	}
 
 
@@ -2234,6 +2285,7 @@ public:
 
 	void executeCommand(UniquePtr<IEditorCommand>&& command) override {
 		m_is_world_changed = true;
+		++m_change_counter;
 		if (m_undo_index >= 0 && command->getType() == m_undo_stack[m_undo_index]->getType()) {
 			if (command->merge(*m_undo_stack[m_undo_index])) {
 				m_undo_stack[m_undo_index]->execute();
@@ -2252,6 +2304,34 @@ public:
 		m_undo_stack.emplace(command.move());
 		if (m_is_game_mode) ++m_game_mode_commands;
 		++m_undo_index;
+		trimUndoHistory();
+	}
+
+	// drops the oldest commands while undo history takes more than MAX_UNDO_HISTORY_MEMORY
+	void trimUndoHistory() {
+		if (m_is_game_mode) return;
+
+		u64 total = 0;
+		for (UniquePtr<IEditorCommand>& cmd : m_undo_stack) total += cmd->getMemorySize();
+		if (total <= MAX_UNDO_HISTORY_MEMORY) return;
+
+		i32 count = 0;
+		while (total > MAX_UNDO_HISTORY_MEMORY) {
+			// groups are dropped as a whole
+			i32 last = count;
+			if (equalStrings(m_undo_stack[count]->getType(), "begin_group")) {
+				while (last < m_undo_stack.size() && !equalStrings(m_undo_stack[last]->getType(), "end_group")) ++last;
+			}
+			// keep the command we've just executed
+			if (last >= m_undo_index) break;
+			for (i32 i = count; i <= last; ++i) total -= m_undo_stack[i]->getMemorySize();
+			count = last + 1;
+		}
+		if (count == 0) return;
+
+		for (i32 i = 0; i < count; ++i) m_undo_stack[i].reset();
+		m_undo_stack.eraseRange(0, count);
+		m_undo_index -= count;
 	}
 
 	bool isGameMode() const override { return m_is_game_mode; }
@@ -2500,6 +2580,7 @@ public:
 			newWorld();
 			return;
 		}
+		++m_change_counter;
 
 		World::PartitionHandle partition = m_world->getActivePartition();
 		EntityFolders::FolderHandle root_folder = m_entity_folders->getRoot(partition);
@@ -2760,6 +2841,7 @@ public:
 		m_entity_folders->destroyPartitionFolders(partition);
 		clearUndoStack();
 		m_is_world_changed = true;
+		++m_change_counter;
 	}
 
 	void addArrayPropertyItem(const ComponentUID& cmp, const char* property) override
@@ -2889,6 +2971,7 @@ public:
 		ASSERT(!m_world);
 
 		m_is_world_changed = false;
+		++m_change_counter;
 		clearUndoStack();
 		m_world = &m_engine.createWorld();
 		World* world = m_world;
@@ -2920,6 +3003,7 @@ public:
 
 		if (m_undo_index >= m_undo_stack.size() || m_undo_index < 0) return;
 
+		++m_change_counter;
 		if (equalStrings(m_undo_stack[m_undo_index]->getType(), "end_group"))
 		{
 			--m_undo_index;
@@ -2944,6 +3028,7 @@ public:
 
 		if (m_undo_index + 1 >= m_undo_stack.size()) return;
 
+		++m_change_counter;
 		++m_undo_index;
 		if(equalStrings(m_undo_stack[m_undo_index]->getType(), "begin_group"))
 		{
@@ -2977,7 +3062,9 @@ private:
 	World* m_world;
 	bool m_is_loading;
 	bool m_is_world_changed;
+	u32 m_change_counter = 0;
 	
+	static constexpr u64 MAX_UNDO_HISTORY_MEMORY = 256 * 1024 * 1024;
 	Array<UniquePtr<IEditorCommand>> m_undo_stack;
 	int m_undo_index;
 	RuntimeHash m_current_group_type;
@@ -27,6 +27,8 @@ struct IEditorCommand
 	virtual void undo() = 0;
 	virtual const char* getType() = 0;
 	virtual bool merge(IEditorCommand& command) = 0;
+	// approximate heap memory used by the command, undo history is trimmed when it gets too big
+	virtual u64 getMemorySize() { return 0; }
 };
 
 struct RayHit {
@@ -100,6 +102,8 @@ struct LUMIX_EDITOR_API WorldEditor
 	virtual void resetChangedFlag() = 0;
 	virtual void executeCommand(UniquePtr<IEditorCommand>&& command) = 0;
 	virtual bool isWorldChanged() const = 0;
+	// incremented whenever the world is changed through the editor, e.g. by a command, undo or load, never reset
+	virtual u32 getChangeCounter() const = 0;
 	virtual bool canUndo() const = 0;
 	virtual bool canRedo() const = 0;
 	virtual void undo() = 0;
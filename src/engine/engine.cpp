@@ -1,4 +1,5 @@
 #include "core/atomic.h"
+#include "core/command_line_parser.h"
 #include "core/debug.h"
 #include "core/hash.h"
 #include "core/job_system.h"
@@ -8,6 +9,7 @@
 #include "core/page_allocator.h"
 #include "core/path.h"
 #include "core/profiler.h"
+#include "core/slab_allocator.h"
 #include "core/sort.h"
 #include "core/stream.h"
 #include "core/string.h"
@@ -25,6 +27,8 @@ namespace Lumix
 {
 
 static const u32 SERIALIZED_PROJECT_MAGIC = 0x5f50524c;
+// fixed steps per frame are limited, so slow frames do not cause even slower frames
+static constexpr u32 MAX_FIXED_STEPS = 4;
 
 struct PrefabResourceManager final : ResourceManager {
 	explicit PrefabResourceManager(IAllocator& allocator)
@@ -44,12 +48,16 @@ struct PrefabResourceManager final : ResourceManager {
 };
 
 
+// blocks are compressed independently, so they can be (de)compressed in parallel
+static constexpr u32 LZ4_BLOCK_SIZE = 256 * 1024;
+
 struct EngineImpl final : Engine {
 	void operator=(const EngineImpl&) = delete;
 	EngineImpl(const EngineImpl&) = delete;
 
 	EngineImpl(InitArgs&& init_data, IAllocator& allocator)
-		: m_allocator(allocator, "engine")
+		: m_slab_allocator(init_data.use_slab_allocator ? UniquePtr<SlabAllocator>::create(allocator, allocator) : UniquePtr<SlabAllocator>())
+		, m_allocator(m_slab_allocator ? *m_slab_allocator : allocator, "engine")
 		, m_page_allocator(m_allocator)
 		, m_prefab_resource_manager(m_allocator)
 		, m_resource_manager(*this, m_allocator)
@@ -58,6 +66,7 @@ struct EngineImpl final : Engine {
 		, m_time_multiplier(1.0f)
 		, m_paused(false)
 		, m_next_frame(false)
+		, m_headless(init_data.headless)
 	{
 		PROFILE_FUNCTION();
 		for (float& f : m_last_time_deltas) f = 1/60.f;
@@ -66,6 +75,7 @@ struct EngineImpl final : Engine {
 		registerLogCallback<logToDebugOutput>();
 
 		m_is_log_file_open = m_log_file.open(init_data.log_path);
+		startAsyncLog(m_allocator);
 		
 		installUnhandledExceptionHandler();
 
@@ -77,6 +87,17 @@ struct EngineImpl final : Engine {
 
 		os::logInfo();
 
+		CommandLineParser parser(cmd_line);
+		while (parser.next()) {
+			if (!parser.currentEquals("-fixed_timestep")) continue;
+			if (!parser.next()) break;
+			char tmp[32];
+			parser.getCurrent(tmp, sizeof(tmp));
+			u32 hz;
+			if (fromCString(tmp, hz) && hz > 0) m_fixed_timestep = 1.f / hz;
+			else logError("Invalid fixed timestep rate ", tmp);
+		}
+
 		if (init_data.file_system.get()) {
 			m_file_system = static_cast<UniquePtr<FileSystem>&&>(init_data.file_system);
 		}
@@ -91,6 +112,7 @@ struct EngineImpl final : Engine {
 
 		m_resource_manager.init(*m_file_system);
 		m_prefab_resource_manager.create(PrefabResource::TYPE, m_resource_manager);
+		m_prefab_resource_manager.setLoadThreadSafe(true);
 
 		m_system_manager = SystemManager::create(*this);
 		m_input_system = InputSystem::create(*this);
@@ -115,8 +137,6 @@ struct EngineImpl final : Engine {
 				logInfo(plugin_name, " plugin has not been loaded");
 			}
 		}
-
-		m_lz4_state = (u8*)m_allocator.allocate(LZ4_sizeofState(), 8);
 	}
 
 	void setMainWindow(os::WindowHandle wnd) override {
@@ -129,8 +149,6 @@ struct EngineImpl final : Engine {
 
 	~EngineImpl()
 	{
-		m_allocator.deallocate(m_lz4_state);
-		
 		for (ISystem* system : m_system_manager->getSystems()) {
 			system->shutdownStarted();
 		}
@@ -141,6 +159,7 @@ struct EngineImpl final : Engine {
 		m_input_system.reset();
 		m_file_system.reset();
 
+		stopAsyncLog();
 		unregisterLogCallback<&EngineImpl::logToFile>(this);
 		m_log_file.close();
 		m_is_log_file_open = false;
@@ -174,17 +193,28 @@ struct EngineImpl final : Engine {
 	IAllocator& getAllocator() override { return m_allocator; }
 	PageAllocator& getPageAllocator() override { return m_page_allocator; }
 
-	EntityPtr instantiatePrefab(World& world,
-		const struct PrefabResource& prefab,
-		const struct DVec3& pos,
-		const struct Quat& rot,
-		const Vec3& scale,
-		EntityMap& entity_map) override
-	{
+	// deserializes prefab without moving its root
+	EntityPtr deserializePrefab(World& world, const PrefabResource& prefab, EntityMap& entity_map) {
 		ASSERT(prefab.isReady());
-		InputMemoryStream blob(prefab.data);
-		WorldVersion editor_header_version;
-		if (!world.deserialize(blob, entity_map, editor_header_version)) {
+		PrefabResource& mutable_prefab = const_cast<PrefabResource&>(prefab);
+		if (!prefab.instancing_template && !prefab.instancing_template_failed) {
+			UniquePtr<World::PreparedWorld> prepared = UniquePtr<World::PreparedWorld>::create(m_allocator, m_allocator);
+			InputMemoryStream blob(prefab.data);
+			// old formats are deserialized the slow way
+			if (world.prepareDeserialize(blob, *prepared)) mutable_prefab.instancing_template = prepared.move();
+			else mutable_prefab.instancing_template_failed = true;
+		}
+
+		bool success;
+		if (prefab.instancing_template) {
+			success = world.commitDeserialize(*prefab.instancing_template, entity_map);
+		}
+		else {
+			InputMemoryStream blob(prefab.data);
+			WorldVersion editor_header_version;
+			success = world.deserialize(blob, entity_map, editor_header_version);
+		}
+		if (!success) {
 			logError("Failed to instantiate prefab ", prefab.getPath());
 			return INVALID_ENTITY;
 		}
@@ -193,10 +223,39 @@ struct EngineImpl final : Engine {
 		const EntityRef root = (EntityRef)entity_map.m_map[0];
 		ASSERT(!world.getParent(root).isValid());
 		ASSERT(!world.getNextSibling(root).isValid());
-		world.setTransform(root, pos, rot, scale);
 		return root;
 	}
 
+	EntityPtr instantiatePrefab(World& world,
+		const struct PrefabResource& prefab,
+		const struct DVec3& pos,
+		const struct Quat& rot,
+		const Vec3& scale,
+		EntityMap& entity_map) override
+	{
+		const EntityPtr root = deserializePrefab(world, prefab, entity_map);
+		if (root.isValid()) world.setTransform((EntityRef)root, pos, rot, scale);
+		return root;
+	}
+
+	bool instantiatePrefabs(World& world, const PrefabResource& prefab, Span<const Transform> transforms, Array<EntityRef>& roots) override {
+		PROFILE_FUNCTION();
+		const u32 first_root = roots.size();
+		roots.reserve(first_root + transforms.length());
+		EntityMap entity_map(m_allocator);
+		for (u32 i = 0; i < transforms.length(); ++i) {
+			entity_map.m_map.clear();
+			const EntityPtr root = deserializePrefab(world, prefab, entity_map);
+			if (!root.isValid()) {
+				world.setTransforms(Span(roots.begin() + first_root, roots.end()), Span(transforms.begin(), i));
+				return false;
+			}
+			roots.push((EntityRef)root);
+		}
+		world.setTransforms(Span(roots.begin() + first_root, roots.end()), transforms);
+		return true;
+	}
+
 	World& createWorld() override {
 		return *LUMIX_NEW(m_allocator, World)(*this);
 	}
@@ -209,10 +268,13 @@ struct EngineImpl final : Engine {
 	}
 
 
+	bool isGameRunning() const override { return m_is_game_running; }
+
 	void startGame(World& world) override
 	{
 		ASSERT(!m_is_game_running);
 		m_is_game_running = true;
+		m_fixed_accumulator = 0;
 		for (UniquePtr<IModule>& module : world.getModules()) {
 			module->startGame();
 		}
@@ -254,22 +316,113 @@ struct EngineImpl final : Engine {
 		return result == output.length();
 	}
 
+	// each thread has its own state, so threads do not block each other
+	static LZ4_stream_t* getLZ4State() {
+		static thread_local LZ4_stream_t state;
+		return &state;
+	}
+
 	bool compress(Span<const u8> mem, OutputMemoryStream& output) override {
 		const i32 cap = LZ4_compressBound(mem.length());
 		const u32 start_size = (u32)output.size();
 		output.resize(cap + start_size);
-		jobs::MutexGuard guard(m_lz4_mutex);
-		const i32 compressed_size = LZ4_compress_fast_extState(m_lz4_state, (const char*)mem.begin(), (char*)output.getMutableData() + start_size, mem.length(), cap, 1); 
+		const i32 compressed_size = LZ4_compress_fast_extState(getLZ4State(), (const char*)mem.begin(), (char*)output.getMutableData() + start_size, mem.length(), cap, 1); 
 		if (compressed_size == 0) return false;
 		output.resize(compressed_size + start_size);
 		return true;
 	}
 
+	// block format: u32 block_size, u32 num_blocks, u32 compressed_size[num_blocks], compressed blocks
+	bool compressBlocks(Span<const u8> mem, OutputMemoryStream& output) override {
+		PROFILE_FUNCTION();
+		const u32 num_blocks = u32((mem.length() + LZ4_BLOCK_SIZE - 1) / LZ4_BLOCK_SIZE);
+		Array<Span<const u8>> blocks(m_allocator);
+		blocks.reserve(num_blocks);
+		for (u32 i = 0; i < num_blocks; ++i) {
+			const u64 from = u64(i) * LZ4_BLOCK_SIZE;
+			blocks.push(Span(mem.begin() + from, (u32)minimum(u64(LZ4_BLOCK_SIZE), mem.length() - from)));
+		}
+		return compressBlocks(blocks, LZ4_BLOCK_SIZE, output);
+	}
+
+	// each chunk is a block, so the stream does not need to be flattened
+	bool compressBlocks(const OutputChunkedStream& src, OutputMemoryStream& output) override {
+		PROFILE_FUNCTION();
+		Array<Span<const u8>> blocks(m_allocator);
+		for (const OutputChunkedStream::Chunk* c = src.getFirstChunk(); c; c = c->next) {
+			blocks.push(Span(c->data, c->size));
+		}
+		return compressBlocks(blocks, sizeof(OutputChunkedStream::Chunk::data), output);
+	}
+
+	// all blocks except the last one must have `block_size` bytes
+	bool compressBlocks(Span<const Span<const u8>> blocks, u32 block_size, OutputMemoryStream& output) {
+		const u32 num_blocks = blocks.length();
+		const u32 cap = LZ4_compressBound(block_size);
+		OutputMemoryStream tmp(m_allocator);
+		tmp.resize(u64(cap) * num_blocks);
+		Array<u32> sizes(m_allocator);
+		sizes.resize(num_blocks);
+
+		AtomicI32 failed = 0;
+		jobs::forEach(num_blocks, 1, [&](i32 block, i32){
+			const Span<const u8> src = blocks[block];
+			char* dst = (char*)tmp.getMutableData() + u64(block) * cap;
+			sizes[block] = LZ4_compress_fast_extState(getLZ4State(), (const char*)src.begin(), dst, src.length(), cap, 1);
+			if (sizes[block] == 0) failed = 1;
+		});
+		if (failed) return false;
+
+		output.write(block_size);
+		output.write(num_blocks);
+		output.write(sizes.begin(), sizes.byte_size());
+		for (u32 i = 0; i < num_blocks; ++i) {
+			output.write(tmp.data() + u64(i) * cap, sizes[i]);
+		}
+		return true;
+	}
+
+	bool decompressBlocks(Span<const u8> src, Span<u8> output) override {
+		PROFILE_FUNCTION();
+		InputMemoryStream blob(src);
+		const u32 block_size = blob.read<u32>();
+		const u32 num_blocks = blob.read<u32>();
+		if (num_blocks == 0) return output.length() == 0;
+		if (block_size == 0 || u64(num_blocks) * block_size < output.length() || u64(num_blocks - 1) * block_size >= output.length()) return false;
+		const u32* sizes = (const u32*)blob.skip(sizeof(u32) * num_blocks);
+		if (blob.hasOverflow()) return false;
+
+		Array<u64> offsets(m_allocator);
+		offsets.resize(num_blocks);
+		u64 offset = blob.getPosition();
+		for (u32 i = 0; i < num_blocks; ++i) {
+			offsets[i] = offset;
+			offset += sizes[i];
+		}
+		if (offset > src.length()) return false;
+
+		AtomicI32 failed = 0;
+		jobs::forEach(num_blocks, 1, [&](i32 block, i32){
+			const u64 to = u64(block) * block_size;
+			const i32 size = (i32)minimum(u64(block_size), output.length() - to);
+			const i32 res = LZ4_decompress_safe((const char*)src.begin() + offsets[block], (char*)output.begin() + to, sizes[block], size);
+			if (res != size) failed = 1;
+		});
+		return failed == 0;
+	}
+
 	void setTimeMultiplier(float multiplier) override
 	{
 		m_time_multiplier = maximum(multiplier, 0.001f);
 	}
 
+	void setFixedTimestep(float step) override {
+		m_fixed_timestep = maximum(step, 0.f);
+		m_fixed_accumulator = 0;
+	}
+
+	float getFixedTimestep() const override { return m_fixed_timestep; }
+
 	void computeSmoothTimeDelta() {
 		float tmp[11];
 		memcpy(tmp, m_last_time_deltas, sizeof(tmp));
@@ -283,6 +436,90 @@ struct EngineImpl final : Engine {
 		profiler::pushCounter(counter, m_smooth_time_delta * 1000.f);
 	}
 
+	static bool conflicts(const ModuleUpdateAccess& a, const ModuleUpdateAccess& b) {
+		if (a.writes & (b.reads | b.writes)) return true;
+		if (b.writes & a.reads) return true;
+		if (a.writes_transforms && (b.reads_transforms || b.writes_transforms)) return true;
+		if (b.writes_transforms && a.reads_transforms) return true;
+		return false;
+	}
+
+	static bool dependsOn(const ModuleUpdateAccess& access, const IModule& module) {
+		for (const char* name : access.after) {
+			if (name && equalStrings(name, module.getName())) return true;
+		}
+		return false;
+	}
+
+	// modules are scheduled in waves, modules in the same wave are updated in parallel
+	// module goes to the first wave after all earlier conflicting modules and after all its dependencies
+	void updateModules(Span<IModule* const> modules, float dt) {
+		jobs::forEach(modules.length(), 1, [&](u32 idx, u32){
+			modules[idx]->updateParallel(dt);
+		});
+		scheduleUpdate(modules, dt);
+		{
+			PROFILE_BLOCK("late update modules");
+			for (IModule* module : modules) {
+				module->lateUpdate(dt);
+			}
+		}
+	}
+
+	void scheduleUpdate(Span<IModule* const> modules, float dt) {
+		PROFILE_BLOCK("update modules");
+		const u32 count = modules.length();
+		Array<ModuleUpdateAccess> accesses(m_allocator);
+		Array<bool> has_access(m_allocator);
+		Array<u32> waves(m_allocator);
+		accesses.resize(count);
+		has_access.resize(count);
+		waves.resize(count);
+		for (u32 i = 0; i < count; ++i) {
+			has_access[i] = modules[i]->getUpdateAccess(accesses[i]);
+			waves[i] = 0;
+		}
+
+		// dependencies can point to later modules, so iterate until nothing moves
+		bool changed = true;
+		for (u32 iter = 0; iter <= count && changed; ++iter) {
+			changed = false;
+			for (u32 i = 0; i < count; ++i) {
+				u32 wave = waves[i];
+				for (u32 j = 0; j < count; ++j) {
+					if (i == j) continue;
+					bool must_follow = false;
+					if (j < i) must_follow = !has_access[i] || !has_access[j] || conflicts(accesses[i], accesses[j]);
+					if (has_access[i] && dependsOn(accesses[i], *modules[j])) must_follow = true;
+					if (must_follow) wave = maximum(wave, waves[j] + 1);
+				}
+				changed = changed || wave != waves[i];
+				waves[i] = wave;
+			}
+		}
+		if (changed) {
+			// cyclic dependencies, fallback to serial update
+			for (u32 i = 0; i < count; ++i) waves[i] = i;
+		}
+
+		u32 num_waves = 0;
+		for (u32 wave : waves) num_waves = maximum(num_waves, wave + 1);
+		Array<IModule*> wave_modules(m_allocator);
+		for (u32 wave = 0; wave < num_waves; ++wave) {
+			wave_modules.clear();
+			for (u32 i = 0; i < count; ++i) {
+				if (waves[i] == wave) wave_modules.push(modules[i]);
+			}
+			if (wave_modules.size() == 1) {
+				wave_modules[0]->update(dt);
+				continue;
+			}
+			jobs::forEach(wave_modules.size(), 1, [&](u32 idx, u32){
+				wave_modules[idx]->update(dt);
+			});
+		}
+	}
+
 	void update(World& world) override
 	{
 		{
@@ -308,35 +545,77 @@ struct EngineImpl final : Engine {
 		m_last_time_deltas[m_last_time_deltas_frame % lengthOf(m_last_time_deltas)] = dt;
 		static u32 counter = profiler::createCounter("Raw time delta (ms)", 0);
 		profiler::pushCounter(counter, dt * 1000.f);
+		jobs::pushProfilerCounters();
 
 		computeSmoothTimeDelta();
 
 		if (!m_paused || m_next_frame) {
-			auto& modules =  world.getModules();
-			jobs::forEach(modules.size(), 1, [&](u32 idx, u32){
-				modules[idx]->updateParallel(dt);
-			});
-			{
-				PROFILE_BLOCK("update modules");
-				for (UniquePtr<IModule>& module : modules)
-				{
-					module->update(dt);
-				}
+			Array<IModule*> fixed_modules(m_allocator);
+			Array<IModule*> variable_modules(m_allocator);
+			for (UniquePtr<IModule>& module : world.getModules()) {
+				const bool fixed = m_fixed_timestep > 0 && module->usesFixedTimestep();
+				(fixed ? fixed_modules : variable_modules).push(module.get());
 			}
-			{
-				PROFILE_BLOCK("late update modules");
-				for (UniquePtr<IModule>& module : modules)
-				{
-					module->lateUpdate(dt);
+
+			if (fixed_modules.empty()) {
+				world.clearInterpolation();
+			}
+			else {
+				m_fixed_accumulator += dt;
+				u32 steps = 0;
+				while (m_fixed_accumulator >= m_fixed_timestep && steps < MAX_FIXED_STEPS) {
+					PROFILE_BLOCK("fixed step");
+					world.beginFixedStep();
+					updateModules(fixed_modules, m_fixed_timestep);
+					world.endFixedStep();
+					m_fixed_accumulator -= m_fixed_timestep;
+					++steps;
 				}
+				// too far behind, drop the rest
+				if (m_fixed_accumulator >= m_fixed_timestep) m_fixed_accumulator = 0;
+				world.interpolateTransforms(m_fixed_accumulator / m_fixed_timestep);
 			}
+
+			updateModules(variable_modules, dt);
 			m_system_manager->update(dt);
 		}
 		m_input_system->update(dt);
 		m_file_system->processCallbacks();
+		m_resource_manager.updateResidency();
 		m_next_frame = false;
 	}
 
+	void update(World& world, float dt) override {
+		PROFILE_FUNCTION();
+		for (UniquePtr<IModule>& module : world.getModules()) {
+			module->endFrame();
+		}
+
+		Array<IModule*> fixed_modules(m_allocator);
+		Array<IModule*> variable_modules(m_allocator);
+		for (UniquePtr<IModule>& module : world.getModules()) {
+			(module->usesFixedTimestep() ? fixed_modules : variable_modules).push(module.get());
+		}
+
+		world.beginFixedStep();
+		updateModules(fixed_modules, dt);
+		world.endFixedStep();
+		// whole steps only, nothing to interpolate
+		world.clearInterpolation();
+		updateModules(variable_modules, dt);
+	}
+
+	void updateSystems(float dt) override {
+		PROFILE_FUNCTION();
+		jobs::pushProfilerCounters();
+		m_system_manager->update(dt);
+		m_input_system->update(dt);
+		m_file_system->processCallbacks();
+		m_resource_manager.updateResidency();
+	}
+
+	bool isHeadless() const override { return m_headless; }
+
 	enum class ProjectVersion : u32 {
 		FIRST,
 		HASH64,
@@ -399,6 +678,8 @@ struct EngineImpl final : Engine {
 	float getLastTimeDelta() const override { return m_smooth_time_delta / m_time_multiplier; }
 
 private:
+	// must be destroyed after everything allocated from m_allocator
+	UniquePtr<SlabAllocator> m_slab_allocator;
 	TagAllocator m_allocator;
 	PageAllocator m_page_allocator;
 	UniquePtr<FileSystem> m_file_system;
@@ -408,17 +689,18 @@ private:
 	UniquePtr<InputSystem> m_input_system;
 	os::Timer m_timer;
 	float m_time_multiplier;
+	float m_fixed_timestep = 0;
+	float m_fixed_accumulator = 0;
 	float m_last_time_deltas[11] = {};
 	u32 m_last_time_deltas_frame = 0;
 	float m_smooth_time_delta;
 	bool m_is_game_running;
 	bool m_paused;
 	bool m_next_frame;
+	bool m_headless;
 	os::WindowHandle m_window_handle = os::INVALID_WINDOW;
 	os::OutputFile m_log_file;
 	bool m_is_log_file_open = false;
-	u8* m_lz4_state = nullptr;
-	jobs::Mutex m_lz4_mutex;
 };
 
 
@@ -8,6 +8,7 @@
 namespace Lumix {
 
 struct Path;
+template <typename T> struct Array;
 
 namespace os { using WindowHandle = void*; }
 
@@ -26,6 +27,10 @@ struct LUMIX_ENGINE_API Engine {
 		const char* log_path = "lumix.log";
 		Span<const char*> plugins;
 		UniquePtr<struct FileSystem> file_system;
+		// small engine allocations are served by SlabAllocator, bigger ones go to the allocator passed to create()
+		bool use_slab_allocator = false;
+		// no window and no GPU, e.g. dedicated servers, systems skip loading GPU-only resources, see isHeadless
+		bool headless = false;
 	};
 
 	virtual ~Engine() {}
@@ -50,20 +55,39 @@ struct LUMIX_ENGINE_API Engine {
 		const struct Quat& rot,
 		const struct Vec3& scale,
 		struct EntityMap& entity_map) = 0;
+	// same as calling instantiatePrefab for each transform, but roots are moved as a batch, see World::setTransforms
+	// `roots` gets the root entity of each instance
+	[[nodiscard]] virtual bool instantiatePrefabs(World& world, const PrefabResource& prefab, Span<const struct Transform> transforms, Array<EntityRef>& roots) = 0;
 
 	virtual void startGame(World& world) = 0;
 	virtual void stopGame(World& world) = 0;
+	virtual bool isGameRunning() const = 0;
 
 	virtual void update(World& world) = 0;
+	// updates `world` by exactly `dt` instead of measured time, fixed timestep modules are updated once with `dt`
+	// does not update systems, call updateSystems once per tick, e.g. server ticking several worlds at a fixed rate
+	virtual void update(World& world, float dt) = 0;
+	// updates systems, input, file system callbacks and resource residency, see update(World&, float)
+	virtual void updateSystems(float dt) = 0;
+	virtual bool isHeadless() const = 0;
 	[[nodiscard]] virtual DeserializeProjectResult deserializeProject(struct InputMemoryStream& serializer, Path& startup_world) = 0;
 	virtual void serializeProject(struct OutputMemoryStream& serializer, const Path& startup_world) const = 0;
 	virtual float getLastTimeDelta() const = 0;
 	virtual void setTimeMultiplier(float multiplier) = 0;
+	// modules with IModule::usesFixedTimestep are updated in steps of `step` seconds, 0 == variable timestep
+	// several steps can run in one frame, transforms are interpolated for rendering, see World::getRenderTransforms
+	virtual void setFixedTimestep(float step) = 0;
+	virtual float getFixedTimestep() const = 0;
 	virtual void pause(bool pause) = 0;
 	virtual bool isPaused() const = 0;
 	virtual void nextFrame() = 0;
 	virtual bool decompress(Span<const u8> src, Span<u8> dst) = 0;
 	virtual bool compress(Span<const u8> src, OutputMemoryStream& dst) = 0;
+	// `src` is split to blocks compressed independently, blocks are (de)compressed in parallel using jobs
+	virtual bool compressBlocks(Span<const u8> src, OutputMemoryStream& dst) = 0;
+	// same format as above, block size is the size of chunks
+	virtual bool compressBlocks(const struct OutputChunkedStream& src, OutputMemoryStream& dst) = 0;
+	virtual bool decompressBlocks(Span<const u8> src, Span<u8> dst) = 0;
 
 protected:
 	Engine() {}
@@ -1,8 +1,12 @@
 #include "core/allocator.h"
 #include "core/array.h"
+#include "core/atomic.h"
+#include "core/crt.h"
 #include "core/delegate_list.h"
 #include "core/hash_map.h"
+#include "core/job_system.h"
 #include "core/log.h"
+#include "core/math.h"
 #include "core/sync.h"
 #include "core/thread.h"
 #include "core/os.h"
@@ -12,6 +16,7 @@
 #include "core/string.h"
 
 #include "engine/file_system.h"
+#include <lz4/lz4.h>
 
 namespace Lumix {
 
@@ -20,18 +25,36 @@ struct AsyncItem {
 		NONE = 0,
 		FAILED = 1 << 0,
 		CANCELED = 1 << 1,
+		IN_FLIGHT = 1 << 2, // being read by one of FS threads or processed in a job
+		PROCESSING = 1 << 3, // ProcessCallback is running
 	};
 
 	AsyncItem(IAllocator& allocator) : data(allocator) {}
 	
 	bool isFailed() const { return isFlagSet(flags, Flags::FAILED); }
 	bool isCanceled() const { return isFlagSet(flags, Flags::CANCELED); }
+	bool isInFlight() const { return isFlagSet(flags, Flags::IN_FLIGHT); }
+	bool isProcessing() const { return isFlagSet(flags, Flags::PROCESSING); }
 
 	FileSystem::ContentCallback callback;
+	FileSystem::ProcessCallback process;
 	OutputMemoryStream data;
+	Span<const u8> mapped; // if not empty, used instead of `data`, owned by file system
 	Path path;
 	u32 id = 0;
 	Flags flags = Flags::NONE;
+	FileSystem::Priority priority = FileSystem::Priority::NORMAL;
+};
+
+// entry in the priority queue of pending reads, entries are not removed on reprioritization or cancel
+// but skipped when popped if they do not match their item anymore
+struct AsyncQueueEntry {
+	// lower is popped first, requests with the same priority are served in FIFO order
+	static u64 getKey(FileSystem::Priority priority, u32 id) { return (u64(priority) << 32) | id; }
+
+	u64 key;
+	u32 id;
+	FileSystem::Priority priority;
 };
 
 struct FileSystemImpl;
@@ -45,32 +68,43 @@ struct FSTask final : Thread {
 
 	~FSTask() = default;
 
-	void stop();
 	int task() override;
 
 private:
 	FileSystemImpl& m_fs;
-	bool m_finish = false;
 };
 
 
 struct FileSystemImpl : FileSystem {
-	explicit FileSystemImpl(const char* base_path, IAllocator& allocator)
+	explicit FileSystemImpl(const char* base_path, u32 num_threads, IAllocator& allocator)
 		: m_allocator(allocator)
+		, m_tasks(allocator)
+		, m_items(allocator)
 		, m_queue(allocator)	
 		, m_finished(allocator)	
+		, m_mapped_files(allocator)
 		, m_last_id(0)
 		, m_semaphore(0, 0xffFF)
 	{
 		setBasePath(base_path);
-		m_task.create(*this, m_allocator);
-		m_task->create("Filesystem", true);
+		num_threads = clamp(num_threads, 1u, MAX_THREADS);
+		for (u32 i = 0; i < num_threads; ++i) {
+			FSTask* task = LUMIX_NEW(m_allocator, FSTask)(*this, m_allocator);
+			task->create("Filesystem", true);
+			m_tasks.push(task);
+		}
 	}
 
 	~FileSystemImpl() override {
-		m_task->stop();
-		m_task->destroy();
-		m_task.destroy();
+		// process jobs access m_items
+		while (m_process_jobs > 0) os::sleep(1);
+		m_finish = true;
+		for (FSTask* task : m_tasks) m_semaphore.signal();
+		for (FSTask* task : m_tasks) {
+			task->destroy();
+			LUMIX_DELETE(m_allocator, task);
+		}
+		ASSERT(m_mapped_files.empty());
 	}
 
 
@@ -117,34 +151,145 @@ struct FileSystemImpl : FileSystem {
 		return true;
 	}
 
-	AsyncHandle getContent(const Path& file, const ContentCallback& callback) override
+	bool mapContent(const Path& path, Span<const u8>& content) override {
+		PROFILE_FUNCTION();
+		const Path full_path(m_base_path, path);
+		os::MappedFile* file = LUMIX_NEW(m_allocator, os::MappedFile);
+		if (!file->open(full_path.c_str())) {
+			LUMIX_DELETE(m_allocator, file);
+			return false;
+		}
+
+		content = file->data();
+		// empty file, nothing to keep mapped
+		if (!content.begin()) {
+			file->close();
+			LUMIX_DELETE(m_allocator, file);
+			return true;
+		}
+
+		MutexGuard lock(m_mapped_mutex);
+		m_mapped_files.insert(content.begin(), file);
+		return true;
+	}
+
+	void unmapContent(Span<const u8> content) override {
+		if (!content.begin()) return;
+
+		os::MappedFile* file;
+		{
+			MutexGuard lock(m_mapped_mutex);
+			auto iter = m_mapped_files.find(content.begin());
+			ASSERT(iter.isValid());
+			file = iter.value();
+			m_mapped_files.erase(iter);
+		}
+		file->close();
+		LUMIX_DELETE(m_allocator, file);
+	}
+
+	void pushQueueEntry(u32 id, Priority priority) {
+		AsyncQueueEntry& entry = m_queue.emplace();
+		entry.key = AsyncQueueEntry::getKey(priority, id);
+		entry.id = id;
+		entry.priority = priority;
+		// sift up
+		for (u32 i = m_queue.size() - 1; i > 0;) {
+			const u32 parent = (i - 1) / 2;
+			if (m_queue[parent].key <= m_queue[i].key) break;
+			swap(m_queue[parent], m_queue[i]);
+			i = parent;
+		}
+	}
+
+	AsyncQueueEntry popQueueEntry() {
+		AsyncQueueEntry res = m_queue[0];
+		m_queue[0] = m_queue.back();
+		m_queue.pop();
+		// sift down
+		const u32 size = m_queue.size();
+		for (u32 i = 0;;) {
+			const u32 left = i * 2 + 1;
+			if (left >= size) break;
+			const u32 right = left + 1;
+			const u32 child = right < size && m_queue[right].key < m_queue[left].key ? right : left;
+			if (m_queue[i].key <= m_queue[child].key) break;
+			swap(m_queue[i], m_queue[child]);
+			i = child;
+		}
+		return res;
+	}
+
+	// called on FS thread with m_mutex locked, returns item with the highest priority and marks it in flight
+	AsyncItem* popItem() {
+		while (!m_queue.empty()) {
+			const AsyncQueueEntry entry = popQueueEntry();
+			auto iter = m_items.find(entry.id);
+			// canceled
+			if (!iter.isValid()) continue;
+			AsyncItem& item = iter.value();
+			// reprioritized, there's another entry in the queue, or the item was reprioritized back and it's already read
+			if (item.priority != entry.priority || item.isInFlight()) continue;
+			item.flags |= AsyncItem::Flags::IN_FLIGHT;
+			return &item;
+		}
+		return nullptr;
+	}
+
+	AsyncHandle getContent(const Path& file, const ContentCallback& callback, Priority priority) override {
+		return getContent(file, callback, ProcessCallback(), priority);
+	}
+
+	AsyncHandle getContent(const Path& file, const ContentCallback& callback, const ProcessCallback& process, Priority priority) override
 	{
 		if (file.isEmpty()) return AsyncHandle::invalid();
 
 		MutexGuard lock(m_mutex);
 		++m_work_counter;
-		AsyncItem& item = m_queue.emplace(m_allocator);
 		++m_last_id;
 		if (m_last_id == 0) ++m_last_id;
+		AsyncItem& item = m_items.insert(m_last_id, AsyncItem(m_allocator)).value();
 		item.id = m_last_id;
 		item.path = file.c_str();
 		item.callback = callback;
+		item.process = process;
+		item.priority = priority;
+		pushQueueEntry(item.id, priority);
 		m_semaphore.signal();
 		return AsyncHandle(item.id);
 	}
 
+	void setPriority(AsyncHandle async, Priority priority) override {
+		MutexGuard lock(m_mutex);
+		auto iter = m_items.find(async.value);
+		// already finished or being read
+		if (!iter.isValid()) return;
+		AsyncItem& item = iter.value();
+		if (item.isInFlight() || item.priority == priority) return;
+
+		item.priority = priority;
+		pushQueueEntry(item.id, priority);
+	}
 
 	void cancel(AsyncHandle async) override
 	{
 		MutexGuard lock(m_mutex);
-		for (AsyncItem& item : m_queue) {
-			if (item.id == async.value) {
-				item.flags |= AsyncItem::Flags::CANCELED;
-				--m_work_counter;
-				return;
-			}
+		// process job is already running on some worker, it does not need this thread to finish
+		for (auto iter = m_items.find(async.value); iter.isValid() && iter.value().isProcessing(); iter = m_items.find(async.value)) {
+			m_mutex.exit();
+			os::sleep(0);
+			m_mutex.enter();
+		}
+		auto iter = m_items.find(async.value);
+		if (iter.isValid()) {
+			--m_work_counter;
+			// in-flight items are removed by FS thread when the read is done
+			if (iter.value().isInFlight()) iter.value().flags |= AsyncItem::Flags::CANCELED;
+			else m_items.erase(iter);
+			return;
 		}
-		for (AsyncItem& item : m_finished) {
+		for (u32 i = m_finished_offset, c = m_finished.size(); i < c; ++i) {
+			AsyncItem& item = m_finished[i];
 			if (item.id == async.value) {
 				item.flags |= AsyncItem::Flags::CANCELED;
 				return;
@@ -218,20 +363,28 @@ struct FileSystemImpl : FileSystem {
 		os::Timer timer;
 		for(;;) {
 			m_mutex.enter();
-			if (m_finished.empty()) {
+			if (m_finished_offset == m_finished.size()) {
+				m_finished.clear();
+				m_finished_offset = 0;
 				m_mutex.exit();
 				break;
 			}
 
-			AsyncItem item = static_cast<AsyncItem&&>(m_finished[0]);
-			m_finished.erase(0);
+			// items are not erased one by one from the front, that would be O(n) each
+			AsyncItem item = static_cast<AsyncItem&&>(m_finished[m_finished_offset]);
+			++m_finished_offset;
+			if (m_finished_offset > 64 && m_finished_offset * 2 > m_finished.size()) {
+				m_finished.eraseRange(0, m_finished_offset);
+				m_finished_offset = 0;
+			}
 			ASSERT(m_work_counter > 0);
 			--m_work_counter;
 
 			m_mutex.exit();
 
 			if(!item.isCanceled()) {
-				item.callback.invoke(Span((const u8*)item.data.data(), (u32)item.data.size()), !item.isFailed());
+				const Span<const u8> content = item.mapped.length() > 0 ? item.mapped : Span((const u8*)item.data.data(), (u32)item.data.size());
+				item.callback.invoke(content, !item.isFailed());
 			}
 
 			if (timer.getTimeSinceStart() > 0.1f) {
@@ -240,14 +393,84 @@ struct FileSystemImpl : FileSystem {
 		}
 	}
 
+	// called on FS thread with m_mutex locked
+	void runProcessJob(u32 id) {
+		m_process_jobs.inc();
+		struct Job {
+			FileSystemImpl* fs;
+			u32 id;
+		};
+		Job* job = LUMIX_NEW(m_allocator, Job){this, id};
+		jobs::run(job, [](void* ptr){
+			PROFILE_FUNCTION();
+			Job* job = (Job*)ptr;
+			FileSystemImpl& fs = *job->fs;
+			const u32 id = job->id;
+			LUMIX_DELETE(fs.m_allocator, job);
+
+			OutputMemoryStream input(fs.m_allocator);
+			Span<const u8> mapped;
+			ProcessCallback process;
+			{
+				MutexGuard lock(fs.m_mutex);
+				AsyncItem& item = fs.m_items[id];
+				if (item.isCanceled()) {
+					fs.m_items.erase(id);
+					fs.m_process_jobs.dec();
+					return;
+				}
+				item.flags |= AsyncItem::Flags::PROCESSING;
+				input = static_cast<OutputMemoryStream&&>(item.data);
+				mapped = item.mapped;
+				process = item.process;
+			}
+
+			OutputMemoryStream processed(fs.m_allocator);
+			const Span<const u8> content = mapped.length() > 0 ? mapped : Span((const u8*)input.data(), (u32)input.size());
+			const bool success = process.invoke(content, processed);
+
+			MutexGuard lock(fs.m_mutex);
+			auto iter = fs.m_items.find(id);
+			ASSERT(iter.isValid());
+			AsyncItem& item = iter.value();
+			AsyncItem& finished = fs.m_finished.emplace(static_cast<AsyncItem&&>(item));
+			if (processed.size() > 0) {
+				finished.data = static_cast<OutputMemoryStream&&>(processed);
+				finished.mapped = {};
+			}
+			else {
+				finished.data = static_cast<OutputMemoryStream&&>(input);
+			}
+			finished.flags &= ~(AsyncItem::Flags::IN_FLIGHT | AsyncItem::Flags::PROCESSING);
+			if (!success) finished.flags |= AsyncItem::Flags::FAILED;
+			fs.m_items.erase(iter);
+			fs.m_process_jobs.dec();
+		}, nullptr, jobs::ANY_WORKER, jobs::Priority::BACKGROUND);
+	}
+
+	// called on FS thread
+	virtual bool getContentAsync(const Path& path, OutputMemoryStream& data, Span<const u8>& mapped) {
+		return getContentSync(path, data);
+	}
+
+	static constexpr u32 MAX_THREADS = 16;
+
 	IAllocator& m_allocator;
-	Local<FSTask> m_task;
+	Array<FSTask*> m_tasks;
+	bool m_finish = false;
 	StaticString<MAX_PATH> m_base_path;
-	Array<AsyncItem> m_queue;
+	// queued and in-flight items
+	HashMap<u32, AsyncItem> m_items;
+	// binary heap of m_items' ids
+	Array<AsyncQueueEntry> m_queue;
 	u32 m_work_counter = 0;
+	AtomicI32 m_process_jobs = 0;
 	Array<AsyncItem> m_finished;
+	u32 m_finished_offset = 0; // items before this are already processed
 	Mutex m_mutex;
 	Semaphore m_semaphore;
+	HashMap<const u8*, os::MappedFile*> m_mapped_files;
+	Mutex m_mapped_mutex;
 
 	u32 m_last_id;
 };
@@ -255,70 +478,104 @@ struct FileSystemImpl : FileSystem {
 
 int FSTask::task()
 {
-	while (!m_finish) {
+	for (;;) {
 		m_fs.m_semaphore.wait();
-		if (m_finish) break;
+		if (m_fs.m_finish) break;
 
 		Path path;
+		u32 id;
 		{
 			MutexGuard lock(m_fs.m_mutex);
-			ASSERT(!m_fs.m_queue.empty());
-			path = m_fs.m_queue[0].path;
-			if (m_fs.m_queue[0].isCanceled()) {
-				m_fs.m_queue.erase(0);
-				continue;
-			}
+			AsyncItem* item = m_fs.popItem();
+			// canceled or already read by other thread
+			if (!item) continue;
+			path = item->path;
+			id = item->id;
 		}
 
 		OutputMemoryStream data(m_fs.m_allocator);
-		bool success = m_fs.getContentSync(path, data);
+		Span<const u8> mapped;
+		bool success = m_fs.getContentAsync(path, data, mapped);
 
 		{
 			MutexGuard lock(m_fs.m_mutex);
-			if (!m_fs.m_queue[0].isCanceled()) {
-				m_fs.m_finished.emplace(static_cast<AsyncItem&&>(m_fs.m_queue[0]));
-				m_fs.m_finished.back().data = static_cast<OutputMemoryStream&&>(data);
+			auto iter = m_fs.m_items.find(id);
+			ASSERT(iter.isValid());
+			AsyncItem& item = iter.value();
+			if (success && !item.isCanceled() && item.process.isValid()) {
+				// stays in m_items as in-flight until the job is done, so it can be canceled the same way
+				item.data = static_cast<OutputMemoryStream&&>(data);
+				item.mapped = mapped;
+				m_fs.runProcessJob(id);
+				continue;
+			}
+			if (!item.isCanceled()) {
+				AsyncItem& finished = m_fs.m_finished.emplace(static_cast<AsyncItem&&>(item));
+				finished.data = static_cast<OutputMemoryStream&&>(data);
+				finished.mapped = mapped;
+				finished.flags &= ~AsyncItem::Flags::IN_FLIGHT;
 				if(!success) {
-					m_fs.m_finished.back().flags |= AsyncItem::Flags::FAILED;
+					finished.flags |= AsyncItem::Flags::FAILED;
 				}
 			}
-			m_fs.m_queue.erase(0);
+			m_fs.m_items.erase(iter);
 		}
 	}
 	return 0;
 }
 
-
-void FSTask::stop()
-{
-	m_finish = true;
-	m_fs.m_semaphore.signal();
-}
-
+// whole pak is mapped to memory, so files can be read from several threads without locking
 struct PackFileSystem : FileSystemImpl {
 	PackFileSystem(const char* pak_path, IAllocator& allocator) 
-		: FileSystemImpl("pack://", allocator) 
-		, m_map(allocator)
+		: FileSystemImpl("pack://", 2, allocator) 
 	{
-		if (!m_file.open(pak_path)) {
-			logError("Failed to open game.pak");
+		if (!m_mapped.open(pak_path)) {
+			logError("Failed to open ", pak_path);
+			return;
+		}
+
+		const Span<const u8> data = m_mapped.data();
+		PakFooter footer;
+		if (data.length() < sizeof(footer)) {
+			logError(pak_path, " is corrupted");
+			m_mapped.close();
+			return;
+		}
+
+		memcpy(&footer, data.end() - sizeof(footer), sizeof(footer));
+		if (footer.magic != PakFooter::MAGIC || footer.version != PakFooter::VERSION) {
+			logError(pak_path, " has unsupported format, please export the game again");
+			m_mapped.close();
 			return;
 		}
-		const u32 count = m_file.read<u32>();
-		for (u32 i = 0; i < count; ++i) {
-			const FilePathHash hash = m_file.read<FilePathHash>();
-			PackFile& f = m_map.insert(hash);
-			f.offset = m_file.read<u64>();
-			f.size = m_file.read<u64>();
+
+		if (footer.index_offset + u64(footer.count) * sizeof(PakEntry) > data.length() - sizeof(footer)) {
+			logError(pak_path, " is corrupted");
+			m_mapped.close();
+			return;
 		}
+
+		m_entries = Span((const PakEntry*)(data.begin() + footer.index_offset), footer.count);
 	}
 
 	~PackFileSystem() {
-		m_file.close();
+		m_mapped.close();
 	}
 
-	bool getContentSync(const Path& path, OutputMemoryStream& content) override {
-		ASSERT(content.size() == 0);
+	const PakEntry* findEntry(FilePathHash hash) const {
+		// m_entries are sorted by hash
+		u32 lo = 0;
+		u32 hi = m_entries.length();
+		while (lo < hi) {
+			const u32 mid = (lo + hi) / 2;
+			if (m_entries[mid].hash < hash) lo = mid + 1;
+			else hi = mid;
+		}
+		if (lo < m_entries.length() && m_entries[lo].hash == hash) return &m_entries[lo];
+		return nullptr;
+	}
+
+	const PakEntry* getEntry(const Path& path) const {
 		StringView basename = Path::getBasename(path);
 		u64 hashu64;
 		fromCString(basename, hashu64);
@@ -326,36 +583,68 @@ struct PackFileSystem : FileSystemImpl {
 		if (basename[0] < '0' || basename[0] > '9' || hashu64 == 0) {
 			hash = path.getHash();
 		}
-		auto iter = m_map.find(hash);
-		if (!iter.isValid()) {
-			iter = m_map.find(path.getHash());
-			if (!iter.isValid()) return false;
-		}
+		const PakEntry* entry = findEntry(hash);
+		if (!entry) entry = findEntry(path.getHash());
+		return entry;
+	}
 
-		content.resize(iter.value().size);
-		MutexGuard lock(m_mutex);
-		const u32 header_size = sizeof(u32) + m_map.size() * (2 * sizeof(u64) + sizeof(FilePathHash));
-		if (!m_file.seek(iter.value().offset + header_size) || !m_file.read(content.getMutableData(), content.size())) {
-			logError("Could not read ", path);
-			return false;
+	Span<const u8> getData(const PakEntry& entry) const {
+		return Span(m_mapped.data().begin() + entry.offset, entry.size);
+	}
+
+	bool getContentSync(const Path& path, OutputMemoryStream& content) override {
+		ASSERT(content.size() == 0);
+		const PakEntry* entry = getEntry(path);
+		if (!entry) return false;
+
+		const Span<const u8> data = getData(*entry);
+		if (isFlagSet(entry->flags, PakEntry::Flags::LZ4)) {
+			content.resize(entry->original_size);
+			const i32 res = LZ4_decompress_safe((const char*)data.begin(), (char*)content.getMutableData(), (i32)data.length(), (i32)content.size());
+			if (res != (i32)content.size()) {
+				logError("Could not decompress ", path);
+				return false;
+			}
+			return true;
 		}
 
+		content.write(data.begin(), data.length());
+		return true;
+	}
+
+	bool mapContent(const Path& path, Span<const u8>& content) override {
+		const PakEntry* entry = getEntry(path);
+		// compressed entries must be decompressed to memory
+		if (!entry || entry->flags != PakEntry::Flags::NONE) return false;
+		
+		content = getData(*entry);
+		return true;
+	}
+
+	// the whole pak stays mapped
+	void unmapContent(Span<const u8> content) override {}
+
+	bool getContentAsync(const Path& path, OutputMemoryStream& data, Span<const u8>& mapped) override {
+		if (!mapContent(path, mapped)) return getContentSync(path, data);
+
+		PROFILE_BLOCK("touch pages");
+		// fault the pages in on the FS thread, so the callback on the main thread does not wait for disk
+		u8 sum = 0;
+		const u8* ptr = mapped.begin();
+		for (u64 i = 0, c = mapped.length(); i < c; i += 4096) sum += ptr[i];
+		m_touch_sink = sum;
 		return true;
 	}
-	
-	struct PackFile {
-		u64 offset;
-		u64 size;
-	};
 
-	HashMap<FilePathHash, PackFile> m_map;
-	os::InputFile m_file;
+	os::MappedFile m_mapped;
+	Span<const PakEntry> m_entries;
+	volatile u8 m_touch_sink = 0;
 };
 
 
-UniquePtr<FileSystem> FileSystem::create(const char* base_path, IAllocator& allocator)
+UniquePtr<FileSystem> FileSystem::create(const char* base_path, IAllocator& allocator, u32 num_threads)
 {
-	return UniquePtr<FileSystemImpl>::create(allocator, base_path, allocator);
+	return UniquePtr<FileSystemImpl>::create(allocator, base_path, num_threads, allocator);
 }
 
 UniquePtr<FileSystem> FileSystem::createPacked(const char* pak_path, IAllocator& allocator)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "lumix.h"
+#include "core/hash.h"
 
 namespace Lumix {
 
@@ -14,8 +15,48 @@ namespace os {
 	struct OutputFile;
 }
 
+// pak file layout: data of all entries, each starting at PakFooter::ALIGNMENT
+// followed by PakEntry for each entry sorted by hash, followed by PakFooter
+struct PakEntry {
+	enum class Flags : u32 {
+		NONE = 0,
+		LZ4 = 1 << 0
+	};
+
+	FilePathHash hash;
+	u64 offset;
+	u64 size; // size in pak
+	u64 original_size; // size after decompression
+	Flags flags = Flags::NONE;
+	u32 padding = 0;
+};
+
+struct PakFooter {
+	static constexpr u32 MAGIC = 'LPAK';
+	static constexpr u32 VERSION = 2;
+	static constexpr u32 ALIGNMENT = 4096;
+
+	u32 magic = MAGIC;
+	u32 version = VERSION;
+	u64 index_offset = 0;
+	u32 count = 0;
+	u32 padding = 0;
+};
+
 struct LUMIX_ENGINE_API FileSystem {
 	using ContentCallback = Delegate<void(Span<const u8>, bool)>;
+	// called in a job after a successful read, before ContentCallback is called on the main thread
+	// it can write transformed content (e.g. decompressed) to the stream, ContentCallback then gets that instead of the file content
+	// if nothing is written, ContentCallback gets the file content, returning false fails the request
+	// cancel() waits for it on the main thread, so it must not depend on the main thread
+	using ProcessCallback = Delegate<bool(Span<const u8>, struct OutputMemoryStream&)>;
+
+	// pending requests with higher priority are read first, requests with the same priority in FIFO order
+	enum class Priority : u8 {
+		HIGH,
+		NORMAL,
+		LOW
+	};
 
 	struct LUMIX_ENGINE_API AsyncHandle {
 		static AsyncHandle invalid() { return AsyncHandle(0xffFFffFF); };
@@ -24,7 +65,8 @@ struct LUMIX_ENGINE_API FileSystem {
 		bool isValid() const { return value != 0xffFFffFF; }
 	};
 
-	static UniquePtr<FileSystem> create(const char* base_path, struct IAllocator& allocator);
+	// `num_threads` - number of threads reading files in parallel
+	static UniquePtr<FileSystem> create(const char* base_path, struct IAllocator& allocator, u32 num_threads = 2);
 	static UniquePtr<FileSystem> createPacked(const char* pak_path, struct IAllocator& allocator);
 
 	virtual ~FileSystem() {}
@@ -45,7 +87,15 @@ struct LUMIX_ENGINE_API FileSystem {
 
 	[[nodiscard]] virtual bool saveContentSync(const struct Path& file, Span<const u8> content) = 0;
 	[[nodiscard]] virtual bool getContentSync(const struct Path& file, struct OutputMemoryStream& content) = 0;
-	virtual AsyncHandle getContent(const Path& file, const ContentCallback& callback) = 0;
+	// like getContentSync, but `content` points to the file mapped to memory, so there's no copy nor allocation
+	// `content` is valid until unmapContent is called, the file can not be modified in the meantime
+	[[nodiscard]] virtual bool mapContent(const Path& file, Span<const u8>& content) = 0;
+	virtual void unmapContent(Span<const u8> content) = 0;
+	virtual AsyncHandle getContent(const Path& file, const ContentCallback& callback, Priority priority = Priority::NORMAL) = 0;
+	virtual AsyncHandle getContent(const Path& file, const ContentCallback& callback, const ProcessCallback& process, Priority priority = Priority::NORMAL) = 0;
+	// change priority of a request which is still waiting to be read, does nothing otherwise
+	virtual void setPriority(AsyncHandle handle, Priority priority) = 0;
+	// if the request's ProcessCallback is running, waits until it's done, so it can safely use caller's data
 	virtual void cancel(AsyncHandle handle) = 0;
 };
 
@@ -1,6 +1,7 @@
 #include "core/array.h"
 #include "core/debug.h"
 #include "core/delegate_list.h"
+#include "core/job_system.h"
 #include "core/log.h"
 #include "core/os.h"
 #include "core/path.h"
@@ -52,6 +53,10 @@ namespace Lumix
 			for (i32 i = 0, c = m_systems.size(); i < c; ++i) {
 				m_systems[i]->initBegin();
 			}
+			jobs::forEach(m_systems.size(), 1, [&](u32 i, u32){
+				PROFILE_BLOCK("init async");
+				m_systems[i]->initAsync();
+			});
 			for (i32 i = 0, c = m_systems.size(); i < c; ++i) {
 				m_systems[i]->initEnd();
 			}
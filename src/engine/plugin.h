@@ -32,6 +32,17 @@ struct LUMIX_ENGINE_API SystemManager
 };
 
 // Modules inherited from IModule manage components of certain types in single world,
+// what IModule::update accesses, modules without conflicting access can be updated at the same time
+struct ModuleUpdateAccess {
+	u64 reads = 0; // bit per ComponentType::index
+	u64 writes = 0;
+	// modules listening to componentTransformed must read transforms, since any transform write can call them
+	bool reads_transforms = false;
+	bool writes_transforms = false;
+	// names of modules which must finish their update before this module's update starts
+	const char* after[4] = {};
+};
+
 // e.g. RenderModule manages all render components - models, lights, ... 
 // Each world has its own instance of every type of module, e.g. RenderModule, AnimationModule, ...
 struct LUMIX_ENGINE_API IModule
@@ -49,7 +60,12 @@ struct LUMIX_ENGINE_API IModule
 	// called for all modules at once, i.e. all modules are updated in parallel
 	virtual void updateParallel(float time_delta) {}
 	// called after all updateParallel calls are finished, called on "main thread"
+	// unless getUpdateAccess returns true, then it can be called on any thread, in parallel with non-conflicting modules
 	virtual void update(float time_delta) = 0;
+	// return false if update can access anything, such modules are updated alone, in the order of modules
+	virtual bool getUpdateAccess(ModuleUpdateAccess& access) const { return false; }
+	// if true and engine uses fixed timestep, all update functions are called with fixed time delta, see Engine::setFixedTimestep
+	virtual bool usesFixedTimestep() const { return false; }
 	// called after all update calls are finished, called on "main thread"
 	virtual void lateUpdate(float time_delta) {}
 	
@@ -67,7 +83,10 @@ struct LUMIX_ENGINE_API ISystem
 
 	// can start async stuff, called for all systems at once
 	virtual void initBegin() {}
-	// wait for all async stuff to finish, called after initBegin is called on all system
+	// called after initBegin on all systems, runs in parallel with initAsync of other systems, on worker threads
+	// for heavy work, which does not touch engine, other systems or anything shared, e.g. initializing 3rd party libraries
+	virtual void initAsync() {}
+	// wait for all async stuff to finish, called after initAsync is finished on all systems
 	virtual void initEnd() {}
 
 	// shutdown is in progress, other systems still exists
@@ -81,6 +100,9 @@ struct LUMIX_ENGINE_API ISystem
 	virtual void systemAdded(ISystem& system) {}
 
 	virtual void createModules(World&) {}
+	// if true, createModules is called when world first needs the modules, i.e. a component of their type is created
+	// or they are requested by World::getModule, instead of when world is created
+	virtual bool createModulesLazily() const { return false; }
 	virtual void startGame() {}
 	virtual void stopGame() {}
 };
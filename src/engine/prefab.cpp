@@ -19,7 +19,11 @@ PrefabResource::PrefabResource(const Path& path, ResourceManager& resource_manag
 ResourceType PrefabResource::getType() const { return TYPE; }
 
 
-void PrefabResource::unload() { data.clear(); }
+void PrefabResource::unload() {
+	data.clear();
+	instancing_template.reset();
+	instancing_template_failed = false;
+}
 
 
 bool PrefabResource::load(Span<const u8> blob)
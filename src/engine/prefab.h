@@ -2,6 +2,7 @@
 
 #include "core/hash.h"
 #include "engine/resource.h"
+#include "engine/world.h"
 #include "core/stream.h"
 
 namespace Lumix {
@@ -21,6 +22,10 @@ struct LUMIX_ENGINE_API PrefabResource final : Resource {
 
 	OutputMemoryStream data;
 	StableHash content_hash;
+	// decompressed `data`, created on first instantiation, so it's not decompressed for each instance
+	// empty if prefab is in old format, which can not be prepared
+	UniquePtr<World::PreparedWorld> instancing_template;
+	bool instancing_template_failed = false;
 	static const ResourceType TYPE;
 };
 
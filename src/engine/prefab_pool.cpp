@@ -0,0 +1,68 @@
+#include "core/math.h"
+#include "core/profiler.h"
+#include "engine/engine.h"
+#include "engine/prefab.h"
+#include "engine/prefab_pool.h"
+#include "engine/world.h"
+
+namespace Lumix {
+
+PrefabPool::PrefabPool(Engine& engine, World& world, PrefabResource& prefab)
+	: m_engine(engine)
+	, m_world(world)
+	, m_prefab(prefab)
+	, m_free(engine.getAllocator())
+{
+	m_prefab.incRefCount();
+}
+
+PrefabPool::~PrefabPool() {
+	for (EntityRef e : m_free) destroyInstance(e);
+	m_prefab.decRefCount();
+}
+
+void PrefabPool::destroyInstance(EntityRef entity) {
+	for (EntityPtr child = m_world.getFirstChild(entity); child.isValid(); child = m_world.getFirstChild(entity)) {
+		destroyInstance((EntityRef)child);
+	}
+	m_world.destroyEntity(entity);
+}
+
+EntityPtr PrefabPool::acquire(const Transform& transform) {
+	PROFILE_FUNCTION();
+	if (m_free.empty()) {
+		Array<EntityRef> roots(m_engine.getAllocator());
+		if (!m_engine.instantiatePrefabs(m_world, m_prefab, Span(&transform, 1), roots)) return INVALID_ENTITY;
+		return roots[0];
+	}
+
+	const EntityRef root = m_free.back();
+	m_free.pop();
+	// move before activation, so physics actors are not added at old position
+	m_world.setTransforms(Span(&root, 1), Span(&transform, 1));
+	m_world.setEntityActive(root, true);
+	return root;
+}
+
+void PrefabPool::release(EntityRef root) {
+	ASSERT(m_world.getParent(root) == INVALID_ENTITY);
+	m_world.setEntityActive(root, false);
+	m_free.push(root);
+}
+
+bool PrefabPool::reserve(u32 count) {
+	PROFILE_FUNCTION();
+	if (m_free.size() >= count) return true;
+
+	const u32 first = m_free.size();
+	Array<Transform> transforms(m_engine.getAllocator());
+	transforms.resize(count - first);
+	for (Transform& tr : transforms) tr = Transform::IDENTITY;
+	const bool res = m_engine.instantiatePrefabs(m_world, m_prefab, transforms, m_free);
+	for (u32 i = first; i < (u32)m_free.size(); ++i) {
+		m_world.setEntityActive(m_free[i], false);
+	}
+	return res;
+}
+
+} // namespace Lumix
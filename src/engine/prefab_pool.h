@@ -0,0 +1,33 @@
+#pragma once
+
+#include "core/array.h"
+#include "engine/lumix.h"
+
+
+namespace Lumix {
+
+// reuses instances of a prefab instead of destroying and recreating them, e.g. for projectiles or effects
+// released instances are deactivated (see World::setEntityActive), they keep their components and resources
+struct LUMIX_ENGINE_API PrefabPool {
+	PrefabPool(struct Engine& engine, struct World& world, struct PrefabResource& prefab);
+	// destroys all pooled instances, acquired instances are left in world
+	~PrefabPool();
+
+	// prefab must be ready
+	EntityPtr acquire(const struct Transform& transform);
+	// `root` must be acquired from this pool
+	void release(EntityRef root);
+	// creates inactive instances, so there are at least `count` instances in pool
+	[[nodiscard]] bool reserve(u32 count);
+	u32 getPooledCount() const { return m_free.size(); }
+
+private:
+	void destroyInstance(EntityRef entity);
+
+	Engine& m_engine;
+	World& m_world;
+	PrefabResource& m_prefab;
+	Array<EntityRef> m_free;
+};
+
+} // namespace Lumix
@@ -51,6 +51,16 @@ const ComponentBase* getComponent(ComponentType cmp_type) {
 const PropertyBase* getProperty(ComponentType cmp_type, StringView prop_name) {
 	const ComponentBase* cmp = getComponent(cmp_type);
 	if (!cmp) return nullptr;
+	if (cmp->prop_table) {
+		const PropertyTable& table = *cmp->prop_table;
+		const u64 hash = RuntimeHash(prop_name.begin, prop_name.size()).getHashValue();
+		const u32 slot = u32(hash >> table.shift) & table.mask;
+		if (table.hashes[slot] == hash) {
+			const u32 idx = table.indices[slot];
+			if (idx < (u32)cmp->props.size() && equalStrings(cmp->props[idx]->name, prop_name)) return cmp->props[idx];
+		}
+		// not in the table, e.g. registered manually after the generated code
+	}
 	for (PropertyBase* prop : cmp->props) {
 		if (equalStrings(prop->name, prop_name)) return prop;
 	}
@@ -230,6 +240,11 @@ builder& builder::icon(const char* icon) {
 	return *this;
 }
 
+builder& builder::prop_table(const PropertyTable& table) {
+	module->cmps.back()->prop_table = &table;
+	return *this;
+}
+
 void builder::addProp(PropertyBase* p) {
 	if (array) {
 		array->children.push(p);
@@ -142,8 +142,34 @@ struct Property : PropertyBase {
 
 	virtual bool isReadonly() const { return setter == nullptr; }
 
+	// same as calling get/set for each entity, `values` has one value per entity
+	// member functions are called directly in a loop, instead of one getter/setter call per value
+	void getMany(IModule* module, Span<const EntityRef> entities, u32 idx, Span<T> values) const {
+		ASSERT(entities.length() == values.length());
+		if (many_getter) {
+			many_getter(module, entities, idx, values);
+			return;
+		}
+		for (u32 i = 0; i < entities.length(); ++i) values[i] = getter(module, entities[i], idx);
+	}
+
+	void setMany(IModule* module, Span<const EntityRef> entities, u32 idx, Span<const T> values) const {
+		ASSERT(entities.length() == values.length());
+		if (many_setter) {
+			many_setter(module, entities, idx, values);
+			return;
+		}
+		for (u32 i = 0; i < entities.length(); ++i) setter(module, entities[i], idx, values[i]);
+	}
+
+	using ManySetter = void (*)(IModule*, Span<const EntityRef>, u32, Span<const T>);
+	using ManyGetter = void (*)(IModule*, Span<const EntityRef>, u32, Span<T>);
+
 	Setter setter = nullptr;
 	Getter getter = nullptr;
+	// optional, getMany and setMany fall back to getter and setter
+	ManySetter many_setter = nullptr;
+	ManyGetter many_getter = nullptr;
 };
 
 struct IPropertyVisitor {
@@ -616,6 +642,14 @@ struct StructVar : StructVarBase {
 	}
 };
 
+// generated by meta, perfect hash of property names, maps name to index in ComponentBase::props
+struct PropertyTable {
+	const u64* hashes; // RuntimeHash of the name, 0 in empty slots
+	const u8* indices;
+	u32 mask;
+	u32 shift;
+};
+
 struct LUMIX_ENGINE_API ComponentBase {
 	ComponentBase(IAllocator& allocator);
 
@@ -630,6 +664,7 @@ struct LUMIX_ENGINE_API ComponentBase {
 	ComponentType component_type;
 	Array<PropertyBase*> props;
 	Array<FunctionBase*> functions;
+	const PropertyTable* prop_table = nullptr;
 };
 
 template <typename T>
@@ -745,6 +780,34 @@ struct LUMIX_ENGINE_API builder {
 			};
 		}
 
+		if constexpr (Setter != nullptr) {
+			p->many_setter = [](IModule* module, Span<const EntityRef> entities, u32 idx, Span<const Backing> values) {
+				using C = typename ClassOf<decltype(Setter)>::Type;
+				C* m = static_cast<C*>(module);
+				for (u32 i = 0; i < entities.length(); ++i) {
+					if constexpr (ArgsCount<decltype(Setter)>::value == 2) {
+						(m->*Setter)(entities[i], static_cast<T>(values[i]));
+					}
+					else {
+						(m->*Setter)(entities[i], idx, static_cast<T>(values[i]));
+					}
+				}
+			};
+		}
+
+		p->many_getter = [](IModule* module, Span<const EntityRef> entities, u32 idx, Span<Backing> values) {
+			using C = typename ClassOf<decltype(Getter)>::Type;
+			C* m = static_cast<C*>(module);
+			for (u32 i = 0; i < entities.length(); ++i) {
+				if constexpr (ArgsCount<decltype(Getter)>::value == 1) {
+					values[i] = static_cast<Backing>((m->*Getter)(entities[i]));
+				}
+				else {
+					values[i] = static_cast<Backing>((m->*Getter)(entities[i], idx));
+				}
+			}
+		};
+
 		p->name = name;
 		addProp(p);
 		return *this;
@@ -792,6 +855,57 @@ struct LUMIX_ENGINE_API builder {
 			auto& v = c.*PropGetter;
 			return static_cast<T>(v);
 		};
+		p->many_setter = [](IModule* module, Span<const EntityRef> entities, u32, Span<const T> values) {
+			using C = typename ClassOf<decltype(Getter)>::Type;
+			C* m = static_cast<C*>(module);
+			for (u32 i = 0; i < entities.length(); ++i) {
+				auto& c = (m->*Getter)(entities[i]);
+				c.*PropGetter = values[i];
+			}
+		};
+		p->many_getter = [](IModule* module, Span<const EntityRef> entities, u32, Span<T> values) {
+			using C = typename ClassOf<decltype(Getter)>::Type;
+			C* m = static_cast<C*>(module);
+			for (u32 i = 0; i < entities.length(); ++i) {
+				auto& c = (m->*Getter)(entities[i]);
+				values[i] = static_cast<T>(c.*PropGetter);
+			}
+		};
+		p->name = name;
+		addProp(p);
+		return *this;
+	}
+
+	// property stored in a column of generated structure of arrays storage, see `//@ component_struct hot` in meta
+	template <typename T, auto StorageGetter, auto Column>
+	builder& soa_prop(const char* name) {
+		auto* p = LUMIX_NEW(allocator, Property<T>)(allocator);
+		p->setter = [](IModule* module, EntityRef e, u32, const T& value) {
+			using C = typename ClassOf<decltype(StorageGetter)>::Type;
+			auto& storage = (static_cast<C*>(module)->*StorageGetter)();
+			(storage.*Column)[storage.indexOf(e)] = value;
+		};
+		p->getter = [](IModule* module, EntityRef e, u32) -> T {
+			using C = typename ClassOf<decltype(StorageGetter)>::Type;
+			auto& storage = (static_cast<C*>(module)->*StorageGetter)();
+			return (storage.*Column)[storage.indexOf(e)];
+		};
+		p->many_setter = [](IModule* module, Span<const EntityRef> entities, u32, Span<const T> values) {
+			using C = typename ClassOf<decltype(StorageGetter)>::Type;
+			auto& storage = (static_cast<C*>(module)->*StorageGetter)();
+			auto& column = storage.*Column;
+			for (u32 i = 0; i < entities.length(); ++i) {
+				column[storage.indexOf(entities[i])] = values[i];
+			}
+		};
+		p->many_getter = [](IModule* module, Span<const EntityRef> entities, u32, Span<T> values) {
+			using C = typename ClassOf<decltype(StorageGetter)>::Type;
+			auto& storage = (static_cast<C*>(module)->*StorageGetter)();
+			const auto& column = storage.*Column;
+			for (u32 i = 0; i < entities.length(); ++i) {
+				values[i] = column[storage.indexOf(entities[i])];
+			}
+		};
 		p->name = name;
 		addProp(p);
 		return *this;
@@ -856,6 +970,7 @@ struct LUMIX_ENGINE_API builder {
 	builder& noUIAttribute();
 	builder& multilineAttribute();
 	builder& icon(const char* icon);
+	builder& prop_table(const PropertyTable& table);
 	builder& end_array();
 
 	void addProp(PropertyBase* prop);
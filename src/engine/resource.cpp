@@ -3,6 +3,7 @@
 #include "core/hash.h"
 #include "core/log.h"
 #include "core/path.h"
+#include "core/profiler.h"
 #include "core/stream.h"
 #include "core/string.h"
 #include "engine/engine.h"
@@ -79,6 +80,10 @@ void Resource::checkState()
 			}
 
 			m_current_state = State::READY;
+			if (m_resident_size == 0) {
+				m_resident_size = getMemoryUsage();
+				m_resource_manager.m_memory_usage += m_resident_size;
+			}
 			m_cb.invoke(old_state, m_current_state, *this);
 		}
 
@@ -91,6 +96,57 @@ void Resource::checkState()
 }
 
 
+bool Resource::getCompiledContent(Span<const u8> blob, OutputMemoryStream& tmp, Span<const u8>& content) {
+	const CompiledResourceHeader* header = (const CompiledResourceHeader*)blob.begin();
+	if (blob.length() < sizeof(*header) || header->magic != CompiledResourceHeader::MAGIC) {
+		logError("Invalid resource file, please delete .lumix directory");
+		return false;
+	}
+	if (header->version != 0) {
+		logError("Unsupported resource file version, please delete .lumix directory");
+		return false;
+	}
+	if (header->flags & (CompiledResourceHeader::COMPRESSED | CompiledResourceHeader::COMPRESSED_BLOCKS)) {
+		tmp.resize(header->decompressed_size);
+		Engine& engine = m_resource_manager.getOwner().getEngine();
+		const Span<const u8> src((const u8*)blob.begin() + sizeof(*header), u64(blob.length() - sizeof(*header)));
+		const Span<u8> dst(tmp.getMutableData(), tmp.size());
+		const bool decompressed = header->flags & CompiledResourceHeader::COMPRESSED_BLOCKS
+			? engine.decompressBlocks(src, dst)
+			: engine.decompress(src, dst);
+		if (!decompressed) return false;
+		content = tmp;
+		return true;
+	}
+	content = blob.fromLeft(sizeof(*header));
+	return true;
+}
+
+void Resource::updateMemoryUsage() {
+	ASSERT(isReady());
+	ASSERT(m_resource_manager.m_memory_usage >= m_resident_size);
+	m_resource_manager.m_memory_usage -= m_resident_size;
+	m_resident_size = getMemoryUsage();
+	m_resource_manager.m_memory_usage += m_resident_size;
+}
+
+bool Resource::processContent(Span<const u8> blob, OutputMemoryStream& processed) {
+	PROFILE_FUNCTION();
+	m_file_size = blob.length();
+	Span<const u8> content = blob;
+	if (!startsWith(getPath(), ".lumix/asset_tiles/")) {
+		if (!getCompiledContent(blob, processed, content)) return false;
+		if (processed.size() > 0) m_process_result = ProcessResult::CONTENT;
+	}
+
+	if (m_resource_manager.isLoadThreadSafe()) {
+		m_process_result = load(content) ? ProcessResult::LOADED : ProcessResult::LOAD_FAILED;
+		// fileLoaded does not need the content anymore
+		processed.clear();
+	}
+	return true;
+}
+
 void Resource::fileLoaded(Span<const u8> blob, bool success) {
 	ASSERT(m_async_op.isValid());
 	m_async_op = FileSystem::AsyncHandle::invalid();
@@ -120,37 +176,24 @@ void Resource::fileLoaded(Span<const u8> blob, bool success) {
 		return;
 	}
 
-	const CompiledResourceHeader* header = (const CompiledResourceHeader*)blob.begin();
-	m_file_size = blob.length();
-	if (startsWith(getPath(), ".lumix/asset_tiles/")) {
-		if (!load(blob)) ++m_failed_dep_count;
-	}
-	else if (blob.length() < sizeof(*header)) {
-		logError("Invalid resource file, please delete .lumix directory");
+	const ProcessResult process_result = m_process_result;
+	m_process_result = ProcessResult::NONE;
+	if (process_result == ProcessResult::LOAD_FAILED) {
 		++m_failed_dep_count;
 	}
-	else if (header->magic != CompiledResourceHeader::MAGIC) {
-		logError("Invalid resource file, please delete .lumix directory");
-		++m_failed_dep_count;
+	else if (process_result == ProcessResult::LOADED) {
 	}
-	else if (header->version != 0) {
-		logError("Unsupported resource file version, please delete .lumix directory");
-		++m_failed_dep_count;
+	else if (process_result == ProcessResult::CONTENT || startsWith(getPath(), ".lumix/asset_tiles/")) {
+		if (!load(blob)) ++m_failed_dep_count;
 	}
-	else if (header->flags & CompiledResourceHeader::COMPRESSED) {
+	else {
+		// not compressed, only the header is stripped here
 		OutputMemoryStream tmp(m_resource_manager.m_allocator);
-		tmp.resize(header->decompressed_size);
-		Engine& engine = m_resource_manager.getOwner().getEngine();
-		const Span<const u8> src((const u8*)blob.begin() + sizeof(*header), u64(blob.length() - sizeof(*header)));
-		if (!engine.decompress(src, Span<u8>(tmp.getMutableData(), tmp.size())) || !load(tmp)) {
+		Span<const u8> content;
+		if (!getCompiledContent(blob, tmp, content) || !load(content)) {
 			++m_failed_dep_count;
 		}
 	}
-	else {
-		if (!load(blob.fromLeft(sizeof(*header)))) {
-			++m_failed_dep_count;
-		}
-	} 
 
 	ASSERT(m_empty_dep_count > 0);
 	--m_empty_dep_count;
@@ -167,6 +210,11 @@ void Resource::doUnload()
 		m_async_op = FileSystem::AsyncHandle::invalid();
 	}
 
+	if (m_in_lru) m_resource_manager.removeLRU(*this);
+	ASSERT(m_resource_manager.m_memory_usage >= m_resident_size);
+	m_resource_manager.m_memory_usage -= m_resident_size;
+	m_resident_size = 0;
+
 	m_hooked = false;
 	m_desired_state = State::EMPTY;
 	unload();
@@ -202,14 +250,17 @@ void Resource::doLoad()
 
 	FileSystem& fs = m_resource_manager.getOwner().getFileSystem();
 	FileSystem::ContentCallback cb = makeDelegate<&Resource::fileLoaded>(this);
+	// decompression (and parsing for thread safe resource types) does not block the main thread
+	FileSystem::ProcessCallback process = makeDelegate<&Resource::processContent>(this);
+	m_process_result = ProcessResult::NONE;
 
 	if (startsWith(m_path, ".lumix/asset_tiles/")) {
-		m_async_op = fs.getContent(m_path, cb);
+		m_async_op = fs.getContent(m_path, cb, process);
 	}
 	else {	
 		const FilePathHash hash = m_path.getHash();
 		const Path res_path(".lumix/resources/", hash, ".res");
-		m_async_op = fs.getContent(res_path, cb);
+		m_async_op = fs.getContent(res_path, cb, process);
 	}
 }
 
@@ -245,11 +296,18 @@ void Resource::removeDependency(Resource& dependent_resource)
 	checkState();
 }
 
+u32 Resource::incRefCount() {
+	// used again before it was evicted
+	if (m_in_lru) m_resource_manager.removeLRU(*this);
+	return ++m_ref_count;
+}
+
 u32 Resource::decRefCount() {
 	ASSERT(m_ref_count > 0);
 	--m_ref_count;
 	if (m_ref_count == 0 && m_resource_manager.m_is_unload_enabled) {
-		doUnload();
+		if (m_resource_manager.m_budget > 0 && isReady()) m_resource_manager.pushLRU(*this);
+		else doUnload();
 	}
 	return m_ref_count;
 }
@@ -35,7 +35,10 @@ template <> struct HashFunc<ResourceType> {
 #pragma pack(1)
 struct CompiledResourceHeader {
 	static constexpr u32 MAGIC = 'LRES';
-	enum Flags { COMPRESSED = 1 << 0 };
+	enum Flags {
+		COMPRESSED = 1 << 0,
+		COMPRESSED_BLOCKS = 1 << 1 // compressed with Engine::compressBlocks
+	};
 	u32 magic = MAGIC;
 	u32 version = 0;
 	u32 flags = 0;
@@ -69,9 +72,15 @@ struct LUMIX_ENGINE_API Resource {
 	const Path& getPath() const { return m_path; }
 	struct ResourceManager& getResourceManager() { return m_resource_manager; }
 	u32 decRefCount();
-	u32 incRefCount() { return ++m_ref_count; }
+	u32 incRefCount();
 	bool wantReady() const { return m_desired_state == State::READY; }
 	bool isHooked() const { return m_hooked; }
+	// estimated memory used by the resource when it's ready, counted in ResourceManager's budget
+	virtual u64 getMemoryUsage() const { return m_file_size; }
+	// resource can be loaded with lower quality if ResourceManager is over budget, see ResourceManager::getQualityBias
+	virtual bool supportsQualityBias() const { return false; }
+	// release data which can be streamed in again when needed, called by ResourceManager when it's over budget
+	virtual void releaseStreamed() {}
 
 	template <auto Function, typename C> void onLoaded(C* instance) {
 		m_cb.bind<Function>(instance);
@@ -86,6 +95,10 @@ protected:
 	virtual void onBeforeReady() {}
 	virtual void unload() = 0;
 	virtual bool load(Span<const u8> blob) = 0;
+	// strips CompiledResourceHeader from `blob` and decompresses it if needed, `content` points either to `blob` or to `tmp`
+	bool getCompiledContent(Span<const u8> blob, struct OutputMemoryStream& tmp, Span<const u8>& content);
+	// call when getMemoryUsage of a ready resource changes, e.g. after streaming
+	void updateMemoryUsage();
 
 	void onCreated(State state);
 	void doUnload();
@@ -100,12 +113,21 @@ protected:
 
 protected:
 	void doLoad();
+	// called in a job by file system
+	bool processContent(Span<const u8> blob, struct OutputMemoryStream& processed);
 	void fileLoaded(Span<const u8> mem, bool success);
 	void onStateChanged(State old_state, State new_state, Resource&);
 
 	Resource(const Resource&) = delete;
 	void operator=(const Resource&) = delete;
 
+	enum class ProcessResult : u8 {
+		NONE, // fileLoaded gets the file content
+		CONTENT, // fileLoaded gets decompressed content
+		LOADED, // load was called in processContent
+		LOAD_FAILED
+	};
+
 	ObserverCallback m_cb;
 	u64 m_file_size;
 	Path m_path;
@@ -113,7 +135,14 @@ protected:
 	u16 m_failed_dep_count;
 	State m_current_state;
 	FileSystem::AsyncHandle m_async_op;
+	ProcessResult m_process_result = ProcessResult::NONE;
 	bool m_hooked = false;
+	u64 m_resident_size = 0; // counted in ResourceManager::m_memory_usage
+	u32 m_quality_bias = 0; // quality bias the resource was loaded with
+	// unreferenced resources kept loaded, see ResourceManager::setBudget
+	Resource* m_lru_prev = nullptr;
+	Resource* m_lru_next = nullptr;
+	bool m_in_lru = false;
 }; // struct Resource
 
 
@@ -1,8 +1,13 @@
 #include "engine/lumix.h"
 
 #include "core/array.h"
+#include "core/command_line_parser.h"
 #include "core/log.h"
+#include "core/os.h"
+#include "core/profiler.h"
+#include "core/sort.h"
 #include "core/stream.h"
+#include "core/string.h"
 
 #include "engine/resource.h"
 #include "engine/resource_manager.h"
@@ -15,10 +20,34 @@ void ResourceManager::create(ResourceType type, ResourceManagerHub& owner)
 {
 	owner.add(type, this);
 	m_owner = &owner;
+
+	char cmd_line[2048];
+	os::getCommandLine(Span(cmd_line));
+	CommandLineParser parser(cmd_line);
+	while (parser.next()) {
+		if (!parser.currentEquals("-resource_budget")) continue;
+		char type_name[64];
+		char budget_mb[32];
+		if (!parser.next()) break;
+		parser.getCurrent(type_name, sizeof(type_name));
+		if (!parser.next()) break;
+		parser.getCurrent(budget_mb, sizeof(budget_mb));
+		if (ResourceType(type_name) != type) continue;
+		
+		u32 mb;
+		if (!fromCString(budget_mb, mb)) {
+			logError("Invalid budget for ", type_name, ": ", budget_mb);
+			continue;
+		}
+		setBudget(u64(mb) * 1024 * 1024);
+	}
 }
 
 void ResourceManager::destroy()
 {
+	// unload resources kept only because of budget
+	while (m_lru_first) m_lru_first->doUnload();
+
 	for (Resource* resource : m_resources) {
 		if (!resource->isEmpty()) {
 			logError("Leaking resource ", resource->getPath(), "\n");
@@ -76,7 +105,8 @@ void ResourceManager::removeUnreferenced()
 	Array<Resource*> to_remove(m_allocator);
 	for (auto* i : m_resources)
 	{
-		if (i->getRefCount() == 0) to_remove.push(i);
+		// resources in LRU are unreferenced on purpose, they are evicted in updateResidency
+		if (i->getRefCount() == 0 && !i->m_in_lru) to_remove.push(i);
 	}
 
 	for (auto* i : to_remove)
@@ -94,6 +124,11 @@ void ResourceManager::reload(const Path& path)
 
 void ResourceManager::reload(Resource& resource)
 {
+	if (resource.m_in_lru) {
+		// nobody uses it, loaded only because of budget
+		resource.doUnload();
+		return;
+	}
 	if (resource.m_current_state != Resource::State::EMPTY) {
 		resource.doUnload();
 	}
@@ -112,6 +147,73 @@ void ResourceManager::reload(Resource& resource)
 	}
 }
 
+void ResourceManager::pushLRU(Resource& resource) {
+	ASSERT(!resource.m_in_lru);
+	resource.m_in_lru = true;
+	resource.m_lru_prev = m_lru_last;
+	resource.m_lru_next = nullptr;
+	if (m_lru_last) m_lru_last->m_lru_next = &resource;
+	else m_lru_first = &resource;
+	m_lru_last = &resource;
+}
+
+void ResourceManager::removeLRU(Resource& resource) {
+	ASSERT(resource.m_in_lru);
+	if (resource.m_lru_prev) resource.m_lru_prev->m_lru_next = resource.m_lru_next;
+	else m_lru_first = resource.m_lru_next;
+	if (resource.m_lru_next) resource.m_lru_next->m_lru_prev = resource.m_lru_prev;
+	else m_lru_last = resource.m_lru_prev;
+	resource.m_lru_prev = nullptr;
+	resource.m_lru_next = nullptr;
+	resource.m_in_lru = false;
+}
+
+void ResourceManager::updateResidency() {
+	if (m_budget == 0) return;
+
+	while (m_memory_usage > m_budget && m_lru_first) {
+		m_lru_first->doUnload();
+	}
+
+	for (Resource* res : m_resources) {
+		if (m_memory_usage <= m_budget) break;
+		if (res->isReady()) res->releaseStreamed();
+	}
+
+	if (m_quality_bias_cooldown > 0) {
+		--m_quality_bias_cooldown;
+		return;
+	}
+
+	if (m_memory_usage > m_budget && m_quality_bias < MAX_QUALITY_BIAS) {
+		++m_quality_bias;
+		m_quality_bias_cooldown = 120;
+
+		// reload the biggest resources with lower quality, until we expect to fit in the budget
+		Array<Resource*> to_reload(m_allocator);
+		for (Resource* res : m_resources) {
+			if (res->isReady() && res->supportsQualityBias() && res->m_quality_bias < m_quality_bias) to_reload.push(res);
+		}
+		sort(to_reload.begin(), to_reload.end(), [](Resource* a, Resource* b){ return a->m_resident_size > b->m_resident_size; });
+		
+		u64 expected_usage = m_memory_usage;
+		u32 count = 0;
+		for (Resource* res : to_reload) {
+			if (expected_usage <= m_budget) break;
+			// one quality step is expected to take 1/4 of memory
+			expected_usage -= res->m_resident_size / 4 * 3;
+			reload(*res);
+			++count;
+		}
+		logWarning("Resources over budget (", m_memory_usage / (1024 * 1024), " MB / ", m_budget / (1024 * 1024), " MB), quality bias ", m_quality_bias, ", reloading ", count, " resources");
+	}
+	else if (m_memory_usage < m_budget / 2 && m_quality_bias > 0) {
+		// only newly loaded resources use higher quality
+		--m_quality_bias;
+		m_quality_bias_cooldown = 120;
+	}
+}
+
 void ResourceManager::enableUnload(bool enable)
 {
 	m_is_unload_enabled = enable;
@@ -232,6 +334,13 @@ void ResourceManagerHub::removeUnreferenced()
 	}
 }
 
+void ResourceManagerHub::updateResidency() {
+	PROFILE_FUNCTION();
+	for (ResourceManager* manager : m_resource_managers) {
+		manager->updateResidency();
+	}
+}
+
 void ResourceManagerHub::enableUnload(bool enable)
 {
 	for (auto* manager : m_resource_managers)
@@ -24,6 +24,22 @@ struct LUMIX_ENGINE_API ResourceManager {
 	void reload(Resource& resource);
 	ResourceTable& getResourceTable() { return m_resources; }
 
+	// 0 means no budget, unreferenced resources are unloaded immediately
+	// with budget, unreferenced resources stay loaded and are evicted in LRU order when the budget is exceeded
+	// then streamed data are released, see Resource::releaseStreamed
+	// if it's exceeded even then, quality bias is increased and the biggest resources supporting it are reloaded
+	// budget can be set on command line: -resource_budget <resource type> <MB>
+	void setBudget(u64 bytes) { m_budget = bytes; }
+	u64 getBudget() const { return m_budget; }
+	u64 getMemoryUsage() const { return m_memory_usage; }
+	// number of quality steps resources should drop when loaded, e.g. textures skip this many top mips
+	u32 getQualityBias() const { return m_quality_bias; }
+	void updateResidency();
+	// decompression always runs in a job, if load is thread safe, Resource::load is called there too
+	// and only the state change is done on the main thread, load must not load other resources then
+	void setLoadThreadSafe(bool is_thread_safe) { m_is_load_thread_safe = is_thread_safe; }
+	bool isLoadThreadSafe() const { return m_is_load_thread_safe; }
+
 	explicit ResourceManager(IAllocator& allocator);
 	virtual ~ResourceManager();
 	ResourceManagerHub& getOwner() const { return *m_owner; }
@@ -34,11 +50,24 @@ protected:
 	virtual void destroyResource(Resource& resource) = 0;
 	Resource* get(const Path& path);
 
+private:
+	void pushLRU(Resource& resource);
+	void removeLRU(Resource& resource);
+
 protected:
+	static constexpr u32 MAX_QUALITY_BIAS = 2;
+
 	IAllocator& m_allocator;
 	ResourceTable m_resources;
 	ResourceManagerHub* m_owner;
 	bool m_is_unload_enabled;
+	bool m_is_load_thread_safe = false;
+	u64 m_budget = 0;
+	u64 m_memory_usage = 0;
+	u32 m_quality_bias = 0;
+	u32 m_quality_bias_cooldown = 0; // quality bias is not changed again until loads with the new one are done
+	Resource* m_lru_first = nullptr; // least recently used
+	Resource* m_lru_last = nullptr;
 };
 
 
@@ -84,6 +113,8 @@ struct LUMIX_ENGINE_API ResourceManagerHub {
 	void reloadAll();
 	void removeUnreferenced();
 	void enableUnload(bool enable);
+	// evict resources and adjust quality of managers over budget, called every frame
+	void updateResidency();
 
 	FileSystem& getFileSystem() { return *m_file_system; }
 
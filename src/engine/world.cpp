@@ -1,8 +1,12 @@
 #include "world.h"
 #include "engine/engine.h"
+#include "engine/engine_hash_funcs.h"
 #include "core/hash.h"
+#include "core/hash_map.h"
+#include "core/job_system.h"
 #include "core/log.h"
 #include "core/math.h"
+#include "core/profiler.h"
 #include "core/sort.h"
 #include "engine/plugin.h"
 #include "engine/prefab.h"
@@ -22,13 +26,37 @@ static constexpr u32 EMPTY_ARCHETYPE = 0;
 
 // archetype is a unique set of component types
 struct World::ArchetypeManager {
+	struct Column {
+		ComponentType type;
+		u32 offset; // of the first element in chunk
+		u32 size;
+	};
+
 	struct Archetype {
 		Archetype(IAllocator& allocator)
 			: types(allocator)
+			, columns(allocator)
+			, chunks(allocator)
+			, entities(allocator)
 		{}
 
 		RuntimeHash32 hash;
 		Array<ComponentType> types;
+		u64 mask = 0; // bit per type, to quickly match queries
+
+		// chunk storage, only types registered with registerChunkStorage have columns
+		// chunk starts with array of entities, followed by one array per column
+		Array<Column> columns;
+		Array<u8*> chunks; // all chunks except the last one are full
+		u32 chunk_capacity = 0; // 0 if there are no columns
+		// entities of archetypes without chunk storage
+		Array<EntityRef> entities;
+		u32 rows_count = 0;
+	};
+
+	struct ChunkStorage {
+		u32 size = 0;
+		u32 align = 0;
 	};
 
 	using ArchetypeHandle = u32;
@@ -41,6 +69,88 @@ struct World::ArchetypeManager {
 		m_archetypes.emplace(m_allocator); // 0-th archetype is reserved for invalid archetype
 	}
 
+	~ArchetypeManager() {
+		for (Archetype& a : m_archetypes) {
+			for (u8* chunk : a.chunks) m_allocator.deallocate(chunk);
+		}
+	}
+
+	void initChunkLayout(Archetype& a) {
+		u32 row_size = sizeof(EntityRef);
+		u32 padding = 0;
+		for (ComponentType type : a.types) {
+			const ChunkStorage& storage = m_chunk_storages[type.index];
+			if (storage.size == 0) continue;
+			row_size += storage.size;
+			padding += storage.align;
+			a.columns.push({type, 0, storage.size});
+		}
+		if (a.columns.empty()) return;
+
+		a.chunk_capacity = (CHUNK_SIZE - padding) / row_size;
+		ASSERT(a.chunk_capacity > 0);
+		u32 offset = a.chunk_capacity * sizeof(EntityRef);
+		for (Column& column : a.columns) {
+			const u32 align = m_chunk_storages[column.type.index].align;
+			offset = (offset + align - 1) & ~(align - 1);
+			column.offset = offset;
+			offset += column.size * a.chunk_capacity;
+		}
+		ASSERT(offset <= CHUNK_SIZE);
+	}
+
+	static u8* getData(const Archetype& a, u32 row, ComponentType type) {
+		for (const Column& column : a.columns) {
+			if (column.type != type) continue;
+			return a.chunks[row / a.chunk_capacity] + column.offset + (row % a.chunk_capacity) * column.size;
+		}
+		return nullptr;
+	}
+
+	u32 addRow(Archetype& a, EntityRef entity) {
+		const u32 row = a.rows_count;
+		if (a.chunk_capacity == 0) {
+			a.entities.push(entity);
+			++a.rows_count;
+			return row;
+		}
+		if (row == a.chunks.size() * a.chunk_capacity) {
+			a.chunks.push((u8*)m_allocator.allocate(CHUNK_SIZE, 64));
+		}
+		++a.rows_count;
+		((EntityRef*)a.chunks[row / a.chunk_capacity])[row % a.chunk_capacity] = entity;
+		return row;
+	}
+
+	// last row is moved to the removed row, returns entity in the last row, if it was moved
+	EntityPtr removeRow(Archetype& a, u32 row) {
+		const u32 last = a.rows_count - 1;
+		EntityPtr moved = INVALID_ENTITY;
+		if (a.chunk_capacity == 0) {
+			if (row != last) moved = a.entities.back();
+			a.entities.swapAndPop(row);
+			--a.rows_count;
+			return moved;
+		}
+		if (row != last) {
+			u8* dst_chunk = a.chunks[row / a.chunk_capacity];
+			const u8* src_chunk = a.chunks[last / a.chunk_capacity];
+			const u32 dst_idx = row % a.chunk_capacity;
+			const u32 src_idx = last % a.chunk_capacity;
+			for (const Column& column : a.columns) {
+				memcpy(dst_chunk + column.offset + dst_idx * column.size, src_chunk + column.offset + src_idx * column.size, column.size);
+			}
+			moved = ((const EntityRef*)src_chunk)[src_idx];
+			((EntityRef*)dst_chunk)[dst_idx] = (EntityRef)moved;
+		}
+		--a.rows_count;
+		if (a.rows_count == (a.chunks.size() - 1) * a.chunk_capacity) {
+			m_allocator.deallocate(a.chunks.back());
+			a.chunks.pop();
+		}
+		return moved;
+	}
+
 	const Archetype& get(ArchetypeHandle handle) {
 		return m_archetypes[handle];
 	}
@@ -84,11 +194,14 @@ struct World::ArchetypeManager {
 		a.hash = hash;
 		a.types.resize(types.length());
 		memcpy(a.types.begin(), types.begin(), types.length() * sizeof(ComponentType));
+		for (ComponentType type : types) a.mask |= u64(1) << type.index;
+		initChunkLayout(a);
 		return m_archetypes.size() - 1;
 	}
 
 	IAllocator& m_allocator;
 	Array<Archetype> m_archetypes;
+	ChunkStorage m_chunk_storages[ComponentType::MAX_TYPES_COUNT];
 };
 
 EntityMap::EntityMap(IAllocator& allocator) 
@@ -123,15 +236,21 @@ World::World(Engine& engine)
 	: m_allocator(engine.getAllocator(), "world")
 	, m_engine(engine)
 	, m_names(m_allocator)
+	, m_name_index(m_allocator)
 	, m_entities(m_allocator)
 	, m_component_added(m_allocator)
 	, m_component_destroyed(m_allocator)
 	, m_entity_destroyed(m_allocator)
 	, m_entity_created(m_allocator)
+	, m_entity_active_changed(m_allocator)
 	, m_first_free_slot(-1)
 	, m_modules(m_allocator)
+	, m_lazy_systems(m_allocator)
 	, m_hierarchy(m_allocator)
 	, m_transforms(m_allocator)
+	, m_render_transforms(m_allocator)
+	, m_interpolated(m_allocator)
+	, m_captured_steps(m_allocator)
 	, m_partitions(m_allocator)
 {
 	m_archetype_manager = UniquePtr<ArchetypeManager>::create(m_allocator, m_allocator);
@@ -144,12 +263,38 @@ World::World(Engine& engine)
 
 	const Array<ISystem*>& systems = engine.getSystemManager().getSystems();
 	for (ISystem* system : systems) {
-		system->createModules(*this);
+		if (system->createModulesLazily()) m_lazy_systems.push(system);
+		else system->createModules(*this);
+	}
+
+	// init can create lazy modules, those are initialized in createLazyModules
+	for (i32 i = 0, c = m_modules.size(); i < c; ++i) {
+		m_modules[i]->init();
 	}
+}
 
-	for (UniquePtr<IModule>& module : m_modules) {
-		module->init();
+IModule* World::createLazyModules(ComponentType type, const char* name) {
+	while (!m_lazy_systems.empty()) {
+		PROFILE_BLOCK("create lazy modules");
+		ISystem* system = m_lazy_systems[0];
+		m_lazy_systems.erase(0);
+		const i32 first = m_modules.size();
+		system->createModules(*this);
+		for (i32 i = first, c = m_modules.size(); i < c; ++i) {
+			m_modules[i]->init();
+			if (m_engine.isGameRunning()) m_modules[i]->startGame();
+		}
+
+		if (name) {
+			for (i32 i = first; i < m_modules.size(); ++i) {
+				if (equalStrings(m_modules[i]->getName(), name)) return m_modules[i].get();
+			}
+		}
+		else if (m_component_type_map[type.index].get() && m_component_type_map[type.index]->module) {
+			return m_component_type_map[type.index]->module;
+		}
 	}
+	return nullptr;
 }
 
 World::PartitionHandle World::createPartition(const char* name) {
@@ -191,7 +336,10 @@ World::PartitionHandle World::getPartition(EntityRef entity) {
 }
 
 IModule* World::getModule(ComponentType type) const {
-	return m_component_type_map[type.index]->module;
+	const ComponentTypeEntry* entry = m_component_type_map[type.index].get();
+	if (entry && entry->module) return entry->module;
+	if (m_lazy_systems.empty()) return nullptr;
+	return const_cast<World*>(this)->createLazyModules(type, nullptr);
 }
 
 
@@ -204,7 +352,8 @@ IModule* World::getModule(const char* name) const
 			return module.get();
 		}
 	}
-	return nullptr;
+	if (m_lazy_systems.empty()) return nullptr;
+	return const_cast<World*>(this)->createLazyModules({}, name);
 }
 
 
@@ -251,38 +400,149 @@ DelegateList<void(EntityRef)>& World::componentTransformed(ComponentType type) {
 	return m_component_type_map[type.index]->transformed;
 }
 
-void World::transformEntity(EntityRef entity, bool update_local)
-{
+DelegateList<void(Span<const EntityRef>)>& World::componentTransformedBatch(ComponentType type) {
+	if (!m_component_type_map[type.index].get()) m_component_type_map[type.index].create(m_allocator);
+	return m_component_type_map[type.index]->transformed_batch;
+}
+
+void World::notifyTransformed(EntityRef entity) {
 	const ArchetypeManager::Archetype& archetype = m_archetype_manager->get(m_entities[entity.index].archetype);
 	for (ComponentType type : archetype.types) {
-		m_component_type_map[type.index]->transformed.invoke(entity);
+		ComponentTypeEntry& entry = *m_component_type_map[type.index];
+		entry.transformed.invoke(entity);
+		entry.transformed_batch.invoke(Span(&entity, 1));
+	}
+}
+
+void World::propagateTransforms(Array<EntityRef>& moved) {
+	PROFILE_FUNCTION();
+	u32 level_begin = 0;
+	u32 level_end = moved.size();
+	while (level_begin != level_end) {
+		for (u32 i = level_begin; i < level_end; ++i) {
+			const i32 hierarchy_idx = m_entities[moved[i].index].hierarchy;
+			if (hierarchy_idx < 0) continue;
+			EntityPtr child = m_hierarchy[hierarchy_idx].first_child;
+			while (child.isValid()) {
+				captureTransform((EntityRef)child);
+				moved.push((EntityRef)child);
+				child = m_hierarchy[m_entities[child.index].hierarchy].next_sibling;
+			}
+		}
+
+		// parents are in the previous level, so entities in this level can be computed independently
+		const EntityRef* level = moved.begin() + level_end;
+		jobs::forEach(moved.size() - level_end, 256, [&](u32 from, u32 to){
+			for (u32 i = from; i < to; ++i) {
+				const EntityRef e = level[i];
+				const Hierarchy& h = m_hierarchy[m_entities[e.index].hierarchy];
+				m_transforms[e.index] = m_transforms[h.parent.index].compose(h.local_transform);
+			}
+		});
+
+		level_begin = level_end;
+		level_end = moved.size();
 	}
+}
+
+void World::setTransforms(Span<const EntityRef> entities, Span<const Transform> transforms) {
+	PROFILE_FUNCTION();
+	ASSERT(entities.length() == transforms.length());
 	
-	const i32 hierarchy_idx = m_entities[entity.index].hierarchy;
-	if (hierarchy_idx >= 0) {
-		Hierarchy& h = m_hierarchy[hierarchy_idx];
-		const Transform my_transform = getTransform(entity);
-		if (update_local && h.parent.isValid()) {
-			const Transform parent_tr = getTransform((EntityRef)h.parent);
-			h.local_transform = Transform::computeLocal(parent_tr, my_transform);
+	Array<EntityRef> moved(m_allocator);
+	moved.reserve(entities.length());
+	bool any_hierarchy = false;
+	for (u32 i = 0, c = entities.length(); i < c; ++i) {
+		const EntityRef e = entities[i];
+		captureTransform(e);
+		m_transforms[e.index] = transforms[i];
+		any_hierarchy = any_hierarchy || m_entities[e.index].hierarchy >= 0;
+	}
+
+	if (!any_hierarchy) {
+		for (EntityRef e : entities) moved.push(e);
+	}
+	else {
+		// all globals are set before locals are computed, so parents in the same batch are already in their new place
+		HashMap<EntityRef, bool> in_batch(m_allocator);
+		for (EntityRef e : entities) {
+			const i32 hierarchy_idx = m_entities[e.index].hierarchy;
+			if (hierarchy_idx < 0) continue;
+			in_batch.insert(e, true);
+			Hierarchy& h = m_hierarchy[hierarchy_idx];
+			if (h.parent.isValid()) {
+				h.local_transform = Transform::computeLocal(getTransform((EntityRef)h.parent), getTransform(e));
+			}
 		}
 
-		EntityPtr child = h.first_child;
-		while (child.isValid()) {
-			const Hierarchy& child_h = m_hierarchy[m_entities[child.index].hierarchy];
-			const Transform abs_tr = my_transform.compose(child_h.local_transform);
-			Transform& child_data = m_transforms[child.index];
-			child_data = abs_tr;
-			transformEntity((EntityRef)child, false);
+		// entities with an ancestor in the batch are reached by propagation
+		for (EntityRef e : entities) {
+			const i32 hierarchy_idx = m_entities[e.index].hierarchy;
+			if (hierarchy_idx >= 0) {
+				if (!in_batch[e]) continue;
+				in_batch[e] = false; // duplicates are pushed only once
+				EntityPtr parent = m_hierarchy[hierarchy_idx].parent;
+				while (parent.isValid() && !in_batch.find((EntityRef)parent).isValid()) {
+					parent = m_hierarchy[m_entities[parent.index].hierarchy].parent;
+				}
+				if (parent.isValid()) continue;
+			}
+			moved.push(e);
+		}
+		propagateTransforms(moved);
+	}
 
-			child = child_h.next_sibling;
+	// group entities with the same components, so each component type is notified once per group
+	sort(moved.begin(), moved.end(), [this](EntityRef a, EntityRef b){
+		return m_entities[a.index].archetype < m_entities[b.index].archetype;
+	});
+
+	for (u32 from = 0, c = moved.size(); from < c;) {
+		const ArchetypeHandle archetype_handle = m_entities[moved[from].index].archetype;
+		u32 to = from + 1;
+		while (to < c && m_entities[moved[to].index].archetype == archetype_handle) ++to;
+
+		const Span<const EntityRef> group(moved.begin() + from, moved.begin() + to);
+		const ArchetypeManager::Archetype& archetype = m_archetype_manager->get(archetype_handle);
+		for (ComponentType type : archetype.types) {
+			ComponentTypeEntry& entry = *m_component_type_map[type.index];
+			entry.transformed_batch.invoke(group);
+			for (EntityRef e : group) entry.transformed.invoke(e);
 		}
+		from = to;
 	}
 }
 
+void World::transformEntity(EntityRef entity, bool update_local)
+{
+	const i32 hierarchy_idx = m_entities[entity.index].hierarchy;
+	if (hierarchy_idx < 0) {
+		notifyTransformed(entity);
+		return;
+	}
+
+	Hierarchy& h = m_hierarchy[hierarchy_idx];
+	if (update_local && h.parent.isValid()) {
+		const Transform parent_tr = getTransform((EntityRef)h.parent);
+		h.local_transform = Transform::computeLocal(parent_tr, getTransform(entity));
+	}
+
+	if (!h.first_child.isValid()) {
+		notifyTransformed(entity);
+		return;
+	}
+
+	// whole subtree is in place before any component is notified
+	Array<EntityRef> moved(m_allocator);
+	moved.push(entity);
+	propagateTransforms(moved);
+	for (EntityRef e : moved) notifyTransformed(e);
+}
+
 
 void World::setRotation(EntityRef entity, const Quat& rot)
 {
+	captureTransform(entity);
 	m_transforms[entity.index].rot = rot;
 	transformEntity(entity, true);
 }
@@ -290,6 +550,7 @@ void World::setRotation(EntityRef entity, const Quat& rot)
 
 void World::setRotation(EntityRef entity, float x, float y, float z, float w)
 {
+	captureTransform(entity);
 	m_transforms[entity.index].rot.set(x, y, z, w);
 	transformEntity(entity, true);
 }
@@ -303,14 +564,12 @@ bool World::hasEntity(EntityRef entity) const
 
 void World::setTransformKeepChildren(EntityRef entity, const Transform& transform)
 {
+	captureTransform(entity);
 	Transform& tmp = m_transforms[entity.index];
 	tmp = transform;
 	
 	int hierarchy_idx = m_entities[entity.index].hierarchy;
-	const ArchetypeManager::Archetype& archetype = m_archetype_manager->get(m_entities[entity.index].archetype);
-	for (ComponentType type : archetype.types) {
-		m_component_type_map[type.index]->transformed.invoke(entity);
-	}
+	notifyTransformed(entity);
 	if (hierarchy_idx >= 0)
 	{
 		Hierarchy& h = m_hierarchy[hierarchy_idx];
@@ -335,6 +594,7 @@ void World::setTransformKeepChildren(EntityRef entity, const Transform& transfor
 
 void World::setTransform(EntityRef entity, const Transform& transform)
 {
+	captureTransform(entity);
 	Transform& tmp = m_transforms[entity.index];
 	tmp = transform;
 	transformEntity(entity, true);
@@ -343,6 +603,7 @@ void World::setTransform(EntityRef entity, const Transform& transform)
 
 void World::setTransform(EntityRef entity, const RigidTransform& transform)
 {
+	captureTransform(entity);
 	auto& tmp = m_transforms[entity.index];
 	tmp.pos = transform.pos;
 	tmp.rot = transform.rot;
@@ -352,6 +613,7 @@ void World::setTransform(EntityRef entity, const RigidTransform& transform)
 
 void World::setTransform(EntityRef entity, const DVec3& pos, const Quat& rot, const Vec3& scale)
 {
+	captureTransform(entity);
 	auto& tmp = m_transforms[entity.index];
 	tmp.pos = pos;
 	tmp.rot = rot;
@@ -378,6 +640,7 @@ Matrix World::getRelativeMatrix(EntityRef entity, const DVec3& base_pos) const
 
 void World::setPosition(EntityRef entity, const DVec3& pos)
 {
+	captureTransform(entity);
 	m_transforms[entity.index].pos = pos;
 	transformEntity(entity, true);
 }
@@ -397,8 +660,58 @@ void World::setEntityName(EntityRef entity, StringView name)
 	}
 	else
 	{
+		removeFromNameIndex(entity);
 		copyString(m_names[name_idx].name, name);
 	}
+	addToNameIndex(entity);
+}
+
+
+RuntimeHash World::getNameKey(const char* name, EntityPtr parent) const {
+	const u64 hash = RuntimeHash(name).getHashValue();
+	return RuntimeHash::fromU64(hash ^ (u64(parent.index + 1) * 0x9E3779B97F4A7C15));
+}
+
+
+void World::addToNameIndex(EntityRef entity) {
+	const i32 name_idx = m_entities[entity.index].name;
+	if (name_idx < 0 || m_names[name_idx].name[0] == '\0') return;
+
+	const RuntimeHash key = getNameKey(m_names[name_idx].name, getParent(entity));
+	auto iter = m_name_index.find(key);
+	if (iter.isValid()) {
+		++iter.value().count;
+		return;
+	}
+	m_name_index.insert(key, {entity, 1});
+}
+
+
+void World::removeFromNameIndex(EntityRef entity) {
+	const i32 name_idx = m_entities[entity.index].name;
+	if (name_idx < 0 || m_names[name_idx].name[0] == '\0') return;
+
+	const RuntimeHash key = getNameKey(m_names[name_idx].name, getParent(entity));
+	auto iter = m_name_index.find(key);
+	ASSERT(iter.isValid());
+	NameIndexEntry& entry = iter.value();
+	if (entry.count == 1) {
+		m_name_index.erase(iter);
+		return;
+	}
+
+	--entry.count;
+	if (entry.entity != entity) return;
+
+	// duplicate names (or key collision), find any other entity with the same key, this is slow but rare
+	for (const EntityName& name : m_names) {
+		if (name.entity == entity || name.name[0] == '\0') continue;
+		if (getNameKey(name.name, getParent(name.entity)) == key) {
+			entry.entity = name.entity;
+			return;
+		}
+	}
+	ASSERT(false);
 }
 
 
@@ -412,6 +725,14 @@ const char* World::getEntityName(EntityRef entity) const
 
 EntityPtr World::findByName(EntityPtr parent, const char* name)
 {
+	if (!name[0]) return INVALID_ENTITY;
+
+	auto iter = m_name_index.find(getNameKey(name, parent));
+	if (!iter.isValid()) return INVALID_ENTITY;
+	const EntityRef found = iter.value().entity;
+	if (getParent(found) == parent && equalStrings(getEntityName(found), name)) return found;
+
+	// key collision, fallback to full search
 	if (parent.isValid()) {
 		int h_idx = m_entities[parent.index].hierarchy;
 		if (h_idx < 0) return INVALID_ENTITY;
@@ -447,6 +768,7 @@ void World::emplaceEntity(EntityRef entity)
 	{
 		EntityData& data = m_entities.emplace();
 		Transform& tr = m_transforms.emplace();
+		if (!m_render_transforms.empty()) m_render_transforms.emplace();
 		data.valid = false;
 		data.prev = -1;
 		data.name = -1;
@@ -476,10 +798,12 @@ void World::emplaceEntity(EntityRef entity)
 	tr.pos = DVec3(0, 0, 0);
 	tr.rot.set(0, 0, 0, 1);
 	tr.scale = Vec3(1);
+	if (entity.index < m_render_transforms.size()) m_render_transforms[entity.index] = tr;
 	data.name = -1;
 	data.hierarchy = -1;
 	data.archetype = EMPTY_ARCHETYPE;
 	data.valid = true;
+	data.active = true;
 
 	m_entity_created.invoke(entity);
 }
@@ -503,15 +827,19 @@ EntityRef World::createEntity(const DVec3& position, const Quat& rotation)
 		entity.index = m_entities.size();
 		data = &m_entities.emplace();
 		tr = &m_transforms.emplace();
+		// so getRenderTransforms can be indexed by new entities before next interpolateTransforms
+		if (!m_render_transforms.empty()) m_render_transforms.emplace();
 	}
 	tr->pos = position;
 	tr->rot = rotation;
 	tr->scale = Vec3(1);
+	if (entity.index < m_render_transforms.size()) m_render_transforms[entity.index] = *tr;
 	data->partition = m_active_partition;
 	data->name = -1;
 	data->hierarchy = -1;
 	data->archetype = EMPTY_ARCHETYPE;
 	data->valid = true;
+	data->active = true;
 	m_entity_created.invoke(entity);
 
 	return entity;
@@ -546,6 +874,7 @@ void World::destroyEntity(EntityRef entity)
 
 	if (entity_data.name >= 0)
 	{
+		removeFromNameIndex(entity);
 		m_entities[m_names.back().entity.index].name = entity_data.name;
 		m_names.swapAndPop(entity_data.name);
 		entity_data.name = -1;
@@ -556,6 +885,20 @@ void World::destroyEntity(EntityRef entity)
 }
 
 
+void World::setEntityActive(EntityRef entity, bool active)
+{
+	EntityData& data = m_entities[entity.index];
+	ASSERT(data.valid);
+	if (data.active != active) {
+		data.active = active;
+		m_entity_active_changed.invoke(entity, active);
+	}
+	for (EntityRef child : childrenOf(entity)) {
+		setEntityActive(child, active);
+	}
+}
+
+
 EntityPtr World::getFirstEntity() const
 {
 	for (int i = 0; i < m_entities.size(); ++i)
@@ -619,6 +962,8 @@ void World::setParent(EntityPtr new_parent, EntityRef child)
 		logError("Hierarchy can not contain a cycle.");
 		return;
 	}
+	++m_hierarchy_version;
+	removeFromNameIndex(child);
 
 	auto collectGarbage = [this](EntityRef entity) {
 		Hierarchy& h = m_hierarchy[m_entities[entity.index].hierarchy];
@@ -693,6 +1038,7 @@ void World::setParent(EntityPtr new_parent, EntityRef child)
 	{
 		if (child_idx >= 0) collectGarbage(child);
 	}
+	addToNameIndex(child);
 }
 
 
@@ -772,7 +1118,7 @@ Vec3 World::getLocalScale(EntityRef entity) const
 	return m_hierarchy[hierarchy_idx].local_transform.scale;
 }
 
-static void serializeModuleList(World& world, OutputMemoryStream& serializer) {
+static void serializeModuleList(World& world, IOutputStream& serializer) {
 	const Array<UniquePtr<IModule>>& modules = world.getModules();
 	serializer.write((i32)modules.size());
 	for (UniquePtr<IModule>& module : modules) {
@@ -829,14 +1175,7 @@ struct WorldHeader {
 };
 #pragma pack()
 
-void World::serialize(OutputMemoryStream& serializer, WorldSerializeFlags flags) {
-	const bool serialize_partitions = (u32)flags & (u32)WorldSerializeFlags::HAS_PARTITIONS;
-	WorldHeader header;
-	serializer.write(header);
-	serializeModuleList(*this, serializer);
-	serializer.write(flags);
-
-	OutputMemoryStream blob(m_allocator);
+void World::serializeEntities(OutputMemoryStream& blob, bool serialize_partitions) {
 	blob.write((u32)m_entities.size());
 
 	for (u32 i = 0, c = m_entities.size(); i < c; ++i) {
@@ -869,84 +1208,60 @@ void World::serialize(OutputMemoryStream& serializer, WorldSerializeFlags flags)
 		}
 	}
 
-	blob.write((i32)m_modules.size());
-	for (const UniquePtr<IModule>& module : m_modules) {
-		blob.writeString(module->getName());
-		blob.write(module->getVersion());
-		module->serialize(blob);
-	}
-
 	if (serialize_partitions) {
 		blob.write((u32)m_partitions.size());
 		blob.write(m_partitions.begin(), m_partitions.byte_size());
 		blob.write(m_active_partition);
 	}
-
-	const u64 offset = serializer.size();
-	serializer.write((u32)0);
-	serializer.write((u32)0);
-	m_engine.compress(blob, serializer);
-	u32* sizes = (u32*)(serializer.getMutableData() + offset);
-	sizes[0] = (u32)blob.size(); // uncompressed size
-	sizes[1] = u32(serializer.size() - offset - sizeof(u32) * 2); // compressed size
 }
 
-bool World::deserialize(InputMemoryStream& input, EntityMap& entity_map, WorldVersion& version)
-{
+// data are split to sections, each compressed separately, so they can be (de)compressed in parallel
+// 0-th section contains entities, names, hierarchy and partitions, the rest are modules, one section per module
+void World::serialize(IOutputStream& serializer, WorldSerializeFlags flags) {
+	PROFILE_FUNCTION();
+	const bool serialize_partitions = (u32)flags & (u32)WorldSerializeFlags::HAS_PARTITIONS;
 	WorldHeader header;
-	WorldHeaderLegacy::Version legacy_version = WorldHeaderLegacy::Version::LAST;
-	input.read(header);
-	if (header.magic == WorldEditorHeaderLegacy::MAGIC || header.magic == 0xffFFffFF) {
-		header.magic = WorldHeader::MAGIC;
-		// WorldEditorHeaderLegacy::Version matches first values of WorldHeaderVersion, so we can just use header.version as is
-		static_assert(sizeof(WorldEditorHeaderLegacy) == sizeof(WorldHeader));
-		input.read<u64>(); // hash
-		WorldHeaderLegacy legacy_header;
-		input.read(legacy_header);
-		if (input.hasOverflow() || legacy_header.magic != WorldHeaderLegacy::MAGIC) {
-			logError("Wrong or corrupted file");
-			return false;
-		}
-		legacy_version = legacy_header.version;
-	}
-	else if (header.magic == WorldHeaderLegacy::MAGIC) {
-		memcpy(&legacy_version, &header.version, sizeof(header.version));
-		header.magic = WorldHeader::MAGIC;
-		header.version = WorldVersion::MERGED_HEADERS;
-	}
-
-	version = header.version;
+	serializer.write(header);
+	serializeModuleList(*this, serializer);
+	serializer.write(flags);
 
-	if (input.hasOverflow() || header.magic != WorldHeader::MAGIC) {
-		logError("Wrong or corrupted file");
-		return false;
-	}
-	if (header.version > WorldVersion::LATEST) {
-		logError("Unsupported version of world");
-		return false;
-	}
-	if (!hasSerializedModules(*this, input)) return false;
+	const u32 sections_count = m_modules.size() + 1;
+	Array<OutputMemoryStream> blobs(m_allocator);
+	Array<OutputMemoryStream> compressed(m_allocator);
+	blobs.reserve(sections_count);
+	compressed.reserve(sections_count);
+	for (u32 i = 0; i < sections_count; ++i) {
+		blobs.emplace(m_allocator);
+		compressed.emplace(m_allocator);
+	}
+
+	// modules only read their own data in serialize, so they can run concurrently
+	jobs::forEach(sections_count, 1, [&](u32 idx, u32){
+		PROFILE_BLOCK("serialize section");
+		OutputMemoryStream& blob = blobs[idx];
+		if (idx == 0) {
+			serializeEntities(blob, serialize_partitions);
+		}
+		else {
+			IModule* module = m_modules[idx - 1].get();
+			blob.writeString(module->getName());
+			blob.write(module->getVersion());
+			module->serialize(blob);
+		}
+		m_engine.compress(blob, compressed[idx]);
+	});
 
-	bool deserialize_partitions = false;
-	if (legacy_version > WorldHeaderLegacy::Version::FLAGS) {
-		WorldSerializeFlags flags;
-		input.read(flags);
-		deserialize_partitions = (u32)flags & (u32)WorldSerializeFlags::HAS_PARTITIONS;
+	serializer.write(sections_count);
+	for (u32 i = 0; i < sections_count; ++i) {
+		serializer.write((u32)blobs[i].size()); // uncompressed size
+		serializer.write((u32)compressed[i].size());
 	}
-
-	InputMemoryStream serializer(input.skip(0), input.remaining());
-	OutputMemoryStream uncompressed(m_allocator);
-	if (header.version > WorldVersion::COMPRESSED) { 
-		u32 uncompressed_size;
-		u32 compressed_size;
-		input.read(uncompressed_size);
-		input.read(compressed_size);
-		uncompressed.resize(uncompressed_size);
-		m_engine.decompress(Span((const u8*)input.skip(0), compressed_size), Span(uncompressed.getMutableData(), uncompressed.size()));
-		serializer = InputMemoryStream(uncompressed);
-		input.skip(compressed_size);
+	for (const OutputMemoryStream& blob : compressed) {
+		serializer.write(blob.data(), blob.size());
 	}
+}
 
+bool World::deserializeEntities(InputMemoryStream& serializer, EntityMap& entity_map, bool has_vec3_scale, bool deserialize_partitions) {
 	u32 to_reserve;
 	serializer.read(to_reserve);
 	entity_map.reserve(to_reserve);
@@ -958,7 +1273,7 @@ bool World::deserialize(InputMemoryStream& input, EntityMap& entity_map, WorldVe
 		Transform& tr = m_transforms[new_e.index];
 		serializer.read(tr.pos);
 		serializer.read(tr.rot);
-		if (legacy_version > WorldHeaderLegacy::Version::VEC3_SCALE) {
+		if (has_vec3_scale) {
 			serializer.read(tr.scale);
 		}
 		else {
@@ -968,10 +1283,12 @@ bool World::deserialize(InputMemoryStream& input, EntityMap& entity_map, WorldVe
 			tr.scale.y = tr.scale.z = tr.scale.x;
 		}
 		if (deserialize_partitions) serializer.read(m_entities[new_e.index].partition);
+		if (serializer.hasOverflow()) return false;
 	}
 
 	u32 count;
 	serializer.read(count);
+	const u32 old_names_count = m_names.size();
 	for (u32 i = 0; i < count; ++i) {
 		EntityName& name = m_names.emplace();
 		serializer.read(name.entity);
@@ -992,7 +1309,7 @@ bool World::deserialize(InputMemoryStream& input, EntityMap& entity_map, WorldVe
 			serializer.read(h.next_sibling);
 			serializer.read(h.local_transform.pos);
 			serializer.read(h.local_transform.rot);
-			if (legacy_version > WorldHeaderLegacy::Version::VEC3_SCALE) {
+			if (has_vec3_scale) {
 				serializer.read(h.local_transform.scale);
 			}
 			else {
@@ -1009,23 +1326,191 @@ bool World::deserialize(InputMemoryStream& input, EntityMap& entity_map, WorldVe
 			m_entities[h.entity.index].hierarchy = i + old_count;
 		}
 	}
+	if (serializer.hasOverflow()) return false;
+
+	// index needs both names and parents
+	for (u32 i = old_names_count, c = m_names.size(); i < c; ++i) {
+		addToNameIndex(m_names[i].entity);
+	}
+	return true;
+}
+
+void World::deserializePartitions(InputMemoryStream& serializer) {
+	u32 partitions_count;
+	serializer.read(partitions_count);
+	m_partitions.resize(partitions_count);
+	serializer.read(m_partitions.begin(), m_partitions.byte_size());
+	serializer.read(m_active_partition);
+}
+
+void World::deserializeModule(InputMemoryStream& serializer, const EntityMap& entity_map) {
+	const char* tmp = serializer.readString();
+	IModule* module = getModule(tmp);
+	const i32 version = serializer.read<i32>();
+	module->deserialize(serializer, entity_map, version);
+}
+
+bool World::readHeader(InputMemoryStream& input, HeaderInfo& info) {
+	WorldHeader header;
+	WorldHeaderLegacy::Version legacy_version = WorldHeaderLegacy::Version::LAST;
+	input.read(header);
+	if (header.magic == WorldEditorHeaderLegacy::MAGIC || header.magic == 0xffFFffFF) {
+		header.magic = WorldHeader::MAGIC;
+		// WorldEditorHeaderLegacy::Version matches first values of WorldHeaderVersion, so we can just use header.version as is
+		static_assert(sizeof(WorldEditorHeaderLegacy) == sizeof(WorldHeader));
+		input.read<u64>(); // hash
+		WorldHeaderLegacy legacy_header;
+		input.read(legacy_header);
+		if (input.hasOverflow() || legacy_header.magic != WorldHeaderLegacy::MAGIC) {
+			logError("Wrong or corrupted file");
+			return false;
+		}
+		legacy_version = legacy_header.version;
+	}
+	else if (header.magic == WorldHeaderLegacy::MAGIC) {
+		memcpy(&legacy_version, &header.version, sizeof(header.version));
+		header.magic = WorldHeader::MAGIC;
+		header.version = WorldVersion::MERGED_HEADERS;
+	}
+
+	info.version = header.version;
+
+	if (input.hasOverflow() || header.magic != WorldHeader::MAGIC) {
+		logError("Wrong or corrupted file");
+		return false;
+	}
+	if (header.version > WorldVersion::LATEST) {
+		logError("Unsupported version of world");
+		return false;
+	}
+	if (!hasSerializedModules(*this, input)) return false;
+
+	info.deserialize_partitions = false;
+	if (legacy_version > WorldHeaderLegacy::Version::FLAGS) {
+		WorldSerializeFlags flags;
+		input.read(flags);
+		info.deserialize_partitions = (u32)flags & (u32)WorldSerializeFlags::HAS_PARTITIONS;
+	}
+	info.has_vec3_scale = legacy_version > WorldHeaderLegacy::Version::VEC3_SCALE;
+	return true;
+}
+
+bool World::prepareDeserialize(InputMemoryStream& input, PreparedWorld& prepared) {
+	PROFILE_FUNCTION();
+	if (!readHeader(input, prepared.header)) return false;
+	if (prepared.header.version <= WorldVersion::SECTIONS) {
+		logError("World must be resaved to be loaded asynchronously");
+		return false;
+	}
+	return decompressSections(input, prepared);
+}
+
+bool World::decompressSections(InputMemoryStream& input, PreparedWorld& prepared) {
+	struct Section {
+		u32 uncompressed_size;
+		u32 compressed_size;
+		const u8* compressed;
+	};
+	const u32 sections_count = input.read<u32>();
+	if (input.hasOverflow() || sections_count == 0) {
+		logError("Wrong or corrupted file");
+		return false;
+	}
+	Array<Section> sections(m_allocator);
+	sections.resize(sections_count);
+	for (Section& section : sections) {
+		input.read(section.uncompressed_size);
+		input.read(section.compressed_size);
+	}
+	for (Section& section : sections) {
+		section.compressed = (const u8*)input.skip(section.compressed_size);
+	}
+	if (input.hasOverflow()) {
+		logError("End of file encountered while trying to read data");
+		return false;
+	}
+
+	prepared.sections.clear();
+	prepared.sections.reserve(sections_count);
+	for (const Section& section : sections) {
+		prepared.sections.emplace(m_allocator).resize(section.uncompressed_size);
+	}
+	AtomicI32 failed = 0;
+	jobs::forEach(sections_count, 1, [&](u32 idx, u32){
+		PROFILE_BLOCK("decompress section");
+		const Section& section = sections[idx];
+		if (!m_engine.decompress(Span(section.compressed, section.compressed_size), Span(prepared.sections[idx].getMutableData(), section.uncompressed_size))) {
+			failed = 1;
+		}
+	});
+	if (failed != 0) {
+		logError("Failed to decompress world");
+		return false;
+	}
+	return true;
+}
+
+bool World::commitDeserialize(const PreparedWorld& prepared, EntityMap& entity_map) {
+	PROFILE_FUNCTION();
+	// modules create components and entities in deserialize, so this part is serial
+	InputMemoryStream entities_blob(prepared.sections[0]);
+	if (!deserializeEntities(entities_blob, entity_map, prepared.header.has_vec3_scale, prepared.header.deserialize_partitions)) {
+		logError("End of file encountered while trying to read data");
+		return false;
+	}
+	if (prepared.header.deserialize_partitions) deserializePartitions(entities_blob);
+	for (u32 i = 1, c = prepared.sections.size(); i < c; ++i) {
+		InputMemoryStream blob(prepared.sections[i]);
+		deserializeModule(blob, entity_map);
+		if (blob.hasOverflow() || entities_blob.hasOverflow()) {
+			logError("End of file encountered while trying to read data");
+			return false;
+		}
+	}
+	return true;
+}
+
+bool World::deserialize(InputMemoryStream& input, EntityMap& entity_map, WorldVersion& version)
+{
+	PROFILE_FUNCTION();
+	HeaderInfo header;
+	if (!readHeader(input, header)) return false;
+	version = header.version;
+	const bool deserialize_partitions = header.deserialize_partitions;
+	const bool has_vec3_scale = header.has_vec3_scale;
+
+	if (header.version > WorldVersion::SECTIONS) {
+		PreparedWorld prepared(m_allocator);
+		prepared.header = header;
+		if (!decompressSections(input, prepared)) return false;
+		return commitDeserialize(prepared, entity_map);
+	}
+
+	InputMemoryStream serializer(input.skip(0), input.remaining());
+	OutputMemoryStream uncompressed(m_allocator);
+	if (header.version > WorldVersion::COMPRESSED) { 
+		u32 uncompressed_size;
+		u32 compressed_size;
+		input.read(uncompressed_size);
+		input.read(compressed_size);
+		uncompressed.resize(uncompressed_size);
+		m_engine.decompress(Span((const u8*)input.skip(0), compressed_size), Span(uncompressed.getMutableData(), uncompressed.size()));
+		serializer = InputMemoryStream(uncompressed);
+		input.skip(compressed_size);
+	}
+
+	if (!deserializeEntities(serializer, entity_map, has_vec3_scale, deserialize_partitions)) {
+		logError("End of file encountered while trying to read data");
+		return false;
+	}
 
 	i32 module_count;
 	serializer.read(module_count);
 	for (int i = 0; i < module_count; ++i) {
-		const char* tmp = serializer.readString();
-		IModule* module = getModule(tmp);
-		const i32 version = serializer.read<i32>();
-		module->deserialize(serializer, entity_map, version);
+		deserializeModule(serializer, entity_map);
 	}
 
-	if (deserialize_partitions) {
-		u32 partitions_count;
-		serializer.read(partitions_count);
-		m_partitions.resize(partitions_count);
-		serializer.read(m_partitions.begin(), m_partitions.byte_size());
-		serializer.read(m_active_partition);
-	}
+	if (deserialize_partitions) deserializePartitions(serializer);
 	if (serializer.hasOverflow()) {
 		logError("End of file encountered while trying to read data");
 		return false;
@@ -1039,6 +1524,7 @@ bool World::deserialize(InputMemoryStream& input, EntityMap& entity_map, WorldVe
 
 void World::setScale(EntityRef entity, const Vec3& scale)
 {
+	captureTransform(entity);
 	m_transforms[entity.index].scale = scale;
 	transformEntity(entity, true);
 }
@@ -1050,6 +1536,164 @@ const Vec3& World::getScale(EntityRef entity) const
 }
 
 
+void World::captureTransform(EntityRef entity) {
+	if (!m_in_fixed_step) return;
+	if (m_captured_steps.size() <= entity.index) {
+		const u32 old_size = m_captured_steps.size();
+		m_captured_steps.resize(m_transforms.size());
+		memset(m_captured_steps.begin() + old_size, 0, (m_captured_steps.size() - old_size) * sizeof(u32));
+	}
+	if (m_captured_steps[entity.index] == m_fixed_step) return;
+	m_captured_steps[entity.index] = m_fixed_step;
+	m_interpolated.push({entity, m_transforms[entity.index]});
+}
+
+void World::beginFixedStep() {
+	ASSERT(!m_in_fixed_step);
+	m_in_fixed_step = true;
+	++m_fixed_step;
+	m_interpolated.clear();
+}
+
+void World::endFixedStep() {
+	ASSERT(m_in_fixed_step);
+	m_in_fixed_step = false;
+}
+
+void World::interpolateTransforms(float alpha) {
+	PROFILE_FUNCTION();
+	m_render_transforms.resize(m_transforms.size());
+	memcpy(m_render_transforms.begin(), m_transforms.begin(), m_transforms.byte_size());
+	for (const InterpolatedTransform& i : m_interpolated) {
+		if (i.entity.index >= m_entities.size() || !m_entities[i.entity.index].valid) continue;
+		const Transform& cur = m_transforms[i.entity.index];
+		Transform& tr = m_render_transforms[i.entity.index];
+		tr.pos = lerp(i.prev.pos, cur.pos, alpha);
+		tr.rot = nlerp(i.prev.rot, cur.rot, alpha);
+		tr.scale = lerp(i.prev.scale, cur.scale, alpha);
+	}
+}
+
+void World::clearInterpolation() {
+	m_render_transforms.clear();
+	m_interpolated.clear();
+}
+
+void World::setArchetype(EntityRef entity, ArchetypeHandle archetype) {
+	EntityData& data = m_entities[entity.index];
+	if (data.archetype == archetype) return;
+
+	ArchetypeManager::Archetype& old_a = m_archetype_manager->m_archetypes[data.archetype];
+	ArchetypeManager::Archetype& new_a = m_archetype_manager->m_archetypes[archetype];
+	
+	u32 row = 0;
+	if (archetype != EMPTY_ARCHETYPE) {
+		row = m_archetype_manager->addRow(new_a, entity);
+		for (const ArchetypeManager::Column& column : new_a.columns) {
+			u8* dst = ArchetypeManager::getData(new_a, row, column.type);
+			const u8* src = data.archetype != EMPTY_ARCHETYPE ? ArchetypeManager::getData(old_a, data.row, column.type) : nullptr;
+			if (src) memcpy(dst, src, column.size);
+			else memset(dst, 0, column.size);
+		}
+	}
+	if (data.archetype != EMPTY_ARCHETYPE) {
+		const EntityPtr moved = m_archetype_manager->removeRow(old_a, data.row);
+		if (moved.isValid()) m_entities[moved.index].row = data.row;
+	}
+
+	data.row = row;
+	data.archetype = archetype;
+}
+
+void World::registerChunkStorage(ComponentType type, u32 size, u32 align) {
+	ASSERT(size > 0);
+	ASSERT(align > 0 && align <= 64 && (align & (align - 1)) == 0);
+	for (const ArchetypeManager::Archetype& a : m_archetype_manager->m_archetypes) {
+		for (ComponentType t : a.types) ASSERT(t != type); // must be called before any component of `type` is created
+	}
+	m_archetype_manager->m_chunk_storages[type.index] = { size, align };
+}
+
+void* World::getChunkData(EntityRef entity, ComponentType type) {
+	const EntityData& data = m_entities[entity.index];
+	const ArchetypeManager::Archetype& a = m_archetype_manager->get(data.archetype);
+	if (a.chunk_capacity == 0) return nullptr;
+	return ArchetypeManager::getData(a, data.row, type);
+}
+
+void World::query(Span<const ComponentType> types, Array<Span<const EntityRef>>& entities) {
+	u64 mask = 0;
+	for (ComponentType type : types) mask |= u64(1) << type.index;
+
+	for (u32 i = 1, c = m_archetype_manager->m_archetypes.size(); i < c; ++i) {
+		const ArchetypeManager::Archetype& a = m_archetype_manager->m_archetypes[i];
+		if (a.rows_count == 0 || (a.mask & mask) != mask) continue;
+
+		if (a.chunk_capacity == 0) {
+			entities.push(a.entities);
+			continue;
+		}
+		for (u32 j = 0, num_chunks = a.chunks.size(); j < num_chunks; ++j) {
+			const u32 count = j + 1 < num_chunks ? a.chunk_capacity : a.rows_count - j * a.chunk_capacity;
+			entities.push(Span((const EntityRef*)a.chunks[j], count));
+		}
+	}
+}
+
+void World::parallelForEach(Span<const ComponentType> types, void* user_ptr, void (*f)(void* user_ptr, Span<const EntityRef> entities)) {
+	PROFILE_FUNCTION();
+	Array<Span<const EntityRef>> spans(m_allocator);
+	query(types, spans);
+	if (spans.empty()) return;
+
+	// prefix sums, so any subrange of all matching entities can be mapped to spans
+	Array<u32> offsets(m_allocator);
+	offsets.resize(spans.size() + 1);
+	offsets[0] = 0;
+	for (u32 i = 0, c = spans.size(); i < c; ++i) offsets[i + 1] = offsets[i] + spans[i].length();
+
+	jobs::forEach(offsets.back(), [&](u32 from, u32 to){
+		u32 span_idx = 0;
+		while (offsets[span_idx + 1] <= from) ++span_idx;
+		while (from < to) {
+			const Span<const EntityRef> span = spans[span_idx];
+			const u32 span_from = from - offsets[span_idx];
+			const u32 span_to = minimum(to, offsets[span_idx + 1]) - offsets[span_idx];
+			f(user_ptr, Span(span.begin() + span_from, span.begin() + span_to));
+			from = offsets[span_idx] + span_to;
+			++span_idx;
+		}
+	});
+}
+
+void World::queryChunks(Span<const ComponentType> types, Array<ChunkView>& chunks) {
+	ASSERT(types.length() <= ChunkView::MAX_COLUMNS);
+	for (const ArchetypeManager::Archetype& a : m_archetype_manager->m_archetypes) {
+		if (a.rows_count == 0) continue;
+
+		u32 offsets[ChunkView::MAX_COLUMNS];
+		bool has_all = true;
+		for (u32 i = 0; i < types.length() && has_all; ++i) {
+			has_all = false;
+			for (const ArchetypeManager::Column& column : a.columns) {
+				if (column.type != types[i]) continue;
+				offsets[i] = column.offset;
+				has_all = true;
+				break;
+			}
+		}
+		if (!has_all) continue;
+
+		for (u32 i = 0, c = a.chunks.size(); i < c; ++i) {
+			u8* chunk = a.chunks[i];
+			ChunkView& view = chunks.emplace();
+			const u32 count = i + 1 < c ? a.chunk_capacity : a.rows_count - i * a.chunk_capacity;
+			view.entities = Span((const EntityRef*)chunk, count);
+			for (u32 j = 0; j < types.length(); ++j) view.columns[j] = chunk + offsets[j];
+		}
+	}
+}
+
 Span<const ComponentType> World::getComponents(EntityRef entity) const
 {
 	ArchetypeHandle archetype = m_entities[entity.index].archetype;
@@ -1079,7 +1723,7 @@ void World::onComponentDestroyed(EntityRef entity, ComponentType component_type,
 		++count;
 	}
 
-	m_entities[entity.index].archetype = m_archetype_manager->get(Span(tmp, count));
+	setArchetype(entity, m_archetype_manager->get(Span(tmp, count)));
 
 	m_component_destroyed.invoke(ComponentUID(entity, component_type, module));
 }
@@ -1087,7 +1731,7 @@ void World::onComponentDestroyed(EntityRef entity, ComponentType component_type,
 
 void World::createComponent(ComponentType type, EntityRef entity)
 {
-	IModule* module = m_component_type_map[type.index]->module;
+	IModule* module = getModule(type);
 	auto& create_method = m_component_type_map[type.index]->create;
 	create_method(module, entity);
 }
@@ -1116,7 +1760,7 @@ void World::onComponentCreated(EntityRef entity, ComponentType component_type, I
 	tmp[count] = component_type;
 	++count;
 
-	m_entities[entity.index].archetype = m_archetype_manager->get(Span(tmp, count));
+	setArchetype(entity, m_archetype_manager->get(Span(tmp, count)));
 
 	ComponentUID cmp(entity, component_type, module);
 	m_component_added.invoke(cmp);
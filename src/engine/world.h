@@ -4,7 +4,10 @@
 
 #include "core/array.h"
 #include "core/delegate_list.h"
+#include "core/hash.h"
+#include "core/hash_map.h"
 #include "core/math.h"
+#include "core/stream.h"
 #include "core/tag_allocator.h"
 
 
@@ -21,6 +24,7 @@ enum class WorldVersion : u32 {
 	NEW_ENTITY_FOLDERS,
 	MERGED_HEADERS,
 	COMPRESSED,
+	SECTIONS,
 
 	LATEST
 };
@@ -58,11 +62,25 @@ struct LUMIX_ENGINE_API World {
 		char name[64];
 	};
 
+	static constexpr u32 CHUNK_SIZE = 16 * 1024;
+
+	// entities and component data of a single chunk, see queryChunks
+	struct ChunkView {
+		static constexpr u32 MAX_COLUMNS = 8;
+		template <typename T> T* get(u32 column) const { return (T*)columns[column]; }
+
+		Span<const EntityRef> entities;
+		// one array per queried type, in the order of the query
+		void* columns[MAX_COLUMNS];
+	};
+
 	explicit World(struct Engine& engine);
 	~World();
 
 	IAllocator& getAllocator() { return m_allocator; }
 	const Transform* getTransforms() const { return m_transforms.begin(); }
+	// transforms to render, interpolated between fixed steps if fixed timestep is used, see Engine::setFixedTimestep
+	const Transform* getRenderTransforms() const { return m_render_transforms.size() == m_transforms.size() ? m_render_transforms.begin() : m_transforms.begin(); }
 	void emplaceEntity(EntityRef entity);
 	EntityRef createEntity(const DVec3& position, const Quat& rotation);
 	void destroyEntity(EntityRef entity);
@@ -73,6 +91,26 @@ struct LUMIX_ENGINE_API World {
 	bool hasComponent(EntityRef entity, ComponentType component_type) const;
 	Span<const ComponentType> getComponents(EntityRef entity) const;
 
+	// optional storage for component data, owned by world instead of module
+	// data of entities with the same archetype are in CHUNK_SIZE chunks, with one array per component type
+	// must be called before any component of `type` is created, e.g. in module's constructor
+	// data must be trivially copyable, it's moved with memcpy and zero initialized in onComponentCreated
+	void registerChunkStorage(ComponentType type, u32 size, u32 align);
+	// pointer is invalidated when components of any entity with the same archetype are created or destroyed
+	void* getChunkData(EntityRef entity, ComponentType type);
+	template <typename T> T& getChunkData(EntityRef entity, ComponentType type) { return *(T*)getChunkData(entity, type); }
+
+	// pushes entities, which have all `types` components, to `entities`, one span per archetype or chunk
+	// spans are invalidated when components of any entity with the same archetype are created or destroyed
+	void query(Span<const ComponentType> types, Array<Span<const EntityRef>>& entities);
+	// calls `f` for all entities with all `types` components, entities are split between workers
+	// components must not be created or destroyed in `f`
+	template <typename F> void parallelForEach(Span<const ComponentType> types, const F& f);
+	void parallelForEach(Span<const ComponentType> types, void* user_ptr, void (*f)(void* user_ptr, Span<const EntityRef> entities));
+	// pushes all chunks containing all `types` to `chunks`, all `types` must use chunk storage
+	// chunks can be processed in parallel, e.g. with jobs::forEach
+	void queryChunks(Span<const ComponentType> types, Array<ChunkView>& chunks);
+
 	PartitionHandle createPartition(const char* name);
 	void destroyPartition(PartitionHandle partition);
 	void setActivePartition(PartitionHandle partition);
@@ -88,6 +126,10 @@ struct LUMIX_ENGINE_API World {
 	EntityPtr findByName(EntityPtr parent, const char* name);
 	void setEntityName(EntityRef entity, struct StringView name);
 	bool hasEntity(EntityRef entity) const;
+	// inactive entities keep their components, but modules ignore them (no rendering, physics, scripts)
+	// applied to all descendants, cheaper than destroying and recreating entities, e.g. for pooling
+	void setEntityActive(EntityRef entity, bool active);
+	bool isEntityActive(EntityRef entity) const { return m_entities[entity.index].active; }
 
 	bool isDescendant(EntityRef ancestor, EntityRef descendant) const;
 	EntityPtr getParent(EntityRef entity) const;
@@ -98,6 +140,8 @@ struct LUMIX_ENGINE_API World {
 	Transform getLocalTransform(EntityRef entity) const;
 	Vec3 getLocalScale(EntityRef entity) const;
 	void setParent(EntityPtr parent, EntityRef child);
+	// changes whenever any entity's parent changes, so hierarchy derived data can be cached
+	u32 getHierarchyVersion() const { return m_hierarchy_version; }
 	void setLocalPosition(EntityRef entity, const DVec3& pos);
 	void setLocalRotation(EntityRef entity, const Quat& rot);
 	void setLocalTransform(EntityRef entity, const Transform& transform);
@@ -107,6 +151,10 @@ struct LUMIX_ENGINE_API World {
 	void setTransform(EntityRef entity, const Transform& transform);
 	void setTransformKeepChildren(EntityRef entity, const Transform& transform);
 	void setTransform(EntityRef entity, const DVec3& pos, const Quat& rot, const Vec3& scale);
+	// same as calling setTransform for each entity, but components are notified after all transforms are set
+	// entities with the same set of components are notified together, see componentTransformedBatch
+	// hierarchies are propagated level by level, each level in parallel
+	void setTransforms(Span<const EntityRef> entities, Span<const Transform> transforms);
 	const Transform& getTransform(EntityRef entity) const;
 	void setRotation(EntityRef entity, float x, float y, float z, float w);
 	void setRotation(EntityRef entity, const Quat& rot);
@@ -118,27 +166,81 @@ struct LUMIX_ENGINE_API World {
 
 	DelegateList<void(EntityRef)>& entityCreated() { return m_entity_created; }
 	DelegateList<void(EntityRef)>& entityDestroyed() { return m_entity_destroyed; }
+	// invoked for each entity whose active state changed, see setEntityActive
+	DelegateList<void(EntityRef, bool)>& entityActiveChanged() { return m_entity_active_changed; }
 	DelegateList<void(const ComponentUID&)>& componentDestroyed() { return m_component_destroyed; }
 	DelegateList<void(const ComponentUID&)>& componentAdded() { return m_component_added; }
 	DelegateList<void(EntityRef)>& componentTransformed(ComponentType type);
+	// called with all moved entities at once in setTransforms, with single entity otherwise; bind either this or componentTransformed
+	DelegateList<void(Span<const EntityRef>)>& componentTransformedBatch(ComponentType type);
 
-	void serialize(struct OutputMemoryStream& serializer, WorldSerializeFlags flags);
-	[[nodiscard]] bool deserialize(struct InputMemoryStream& serializer, EntityMap& entity_map, WorldVersion& version);
+	struct HeaderInfo {
+		WorldVersion version;
+		bool deserialize_partitions;
+		bool has_vec3_scale;
+	};
+
+	// decompressed, but not yet deserialized world, see prepareDeserialize
+	struct PreparedWorld {
+		PreparedWorld(IAllocator& allocator) : sections(allocator) {}
+
+		HeaderInfo header;
+		Array<OutputMemoryStream> sections;
+	};
 
+	void serialize(struct IOutputStream& serializer, WorldSerializeFlags flags);
+	[[nodiscard]] bool deserialize(struct InputMemoryStream& serializer, EntityMap& entity_map, WorldVersion& version);
+	// deserialize == prepareDeserialize + commitDeserialize
+	// prepareDeserialize does not change world, so it can run on any thread, while world is used on main thread
+	// only worlds saved in WorldVersion::SECTIONS or newer format can be prepared
+	[[nodiscard]] bool prepareDeserialize(InputMemoryStream& serializer, PreparedWorld& prepared);
+	[[nodiscard]] bool commitDeserialize(const PreparedWorld& prepared, EntityMap& entity_map);
+
+	// transforms changed between beginFixedStep and endFixedStep are interpolated from their value before the step
+	void beginFixedStep();
+	void endFixedStep();
+	// `alpha` == 0 is the state before the last fixed step, `alpha` == 1 is the state after it
+	void interpolateTransforms(float alpha);
+	// stops interpolation, getRenderTransforms returns getTransforms again
+	void clearInterpolation();
+
+	// modules of systems with ISystem::createModulesLazily are created here if they do not exist yet
 	IModule* getModule(ComponentType type) const;
 	IModule* getModule(const char* name) const;
+	// only modules which were already created
 	Array<UniquePtr<IModule>>& getModules();
 	void addModule(UniquePtr<IModule>&& moudle);
 
 private:
+	// creates modules of lazy systems until a module for `type` (or with `name` if it's not null) exists
+	IModule* createLazyModules(ComponentType type, const char* name);
 	void transformEntity(EntityRef entity, bool update_local);
+	// computes global transforms of all descendants of `moved`, one hierarchy level at a time, descendants are pushed to `moved`
+	// `moved` must not contain both an entity and its ancestor
+	void propagateTransforms(Array<EntityRef>& moved);
+	void notifyTransformed(EntityRef entity);
 	void updateGlobalTransform(EntityRef entity);
+	[[nodiscard]] bool readHeader(InputMemoryStream& blob, HeaderInfo& info);
+	[[nodiscard]] bool decompressSections(InputMemoryStream& blob, PreparedWorld& prepared);
+	void serializeEntities(OutputMemoryStream& blob, bool serialize_partitions);
+	[[nodiscard]] bool deserializeEntities(InputMemoryStream& blob, EntityMap& entity_map, bool has_vec3_scale, bool deserialize_partitions);
+	void deserializePartitions(InputMemoryStream& blob);
+	void deserializeModule(InputMemoryStream& blob, const EntityMap& entity_map);
+	// remembers transform of `entity` before it's changed in fixed step
+	void captureTransform(EntityRef entity);
+	// moves chunk data of `entity` to `archetype`
+	void setArchetype(EntityRef entity, ArchetypeHandle archetype);
+	RuntimeHash getNameKey(const char* name, EntityPtr parent) const;
+	// must be called whenever entity's name or parent changes, before and after the change
+	void addToNameIndex(EntityRef entity);
+	void removeFromNameIndex(EntityRef entity);
 
 	struct EntityData {
 		EntityData() {}
 
 		i32 hierarchy; // index into m_hierarchy, < 0 if no hierarchy (== no parent & no children) 
 		i32 name; // index into m_names, < 0 if no name
+		u32 row; // index of entity in its archetype, in chunk storage or in list of entities
 
 		union {
 			struct {
@@ -152,6 +254,7 @@ private:
 			};
 		};
 		bool valid = false;
+		bool active = true; // runtime only, not serialized
 	};
 
 	struct Hierarchy {
@@ -168,12 +271,24 @@ private:
 		char name[ENTITY_NAME_MAX_LENGTH];
 	};
 
+	// entity with given name and parent, `count` is the number of such entities (or with colliding key)
+	struct NameIndexEntry {
+		EntityRef entity;
+		u32 count;
+	};
+
+	struct InterpolatedTransform {
+		EntityRef entity;
+		Transform prev;
+	};
+
 	struct ComponentTypeEntry {
-		ComponentTypeEntry(IAllocator& allocator) : transformed(allocator) {}
+		ComponentTypeEntry(IAllocator& allocator) : transformed(allocator), transformed_batch(allocator) {}
 		IModule* module = nullptr;
 		void (*create)(IModule*, EntityRef);
 		void (*destroy)(IModule*, EntityRef);
 		DelegateList<void(EntityRef)> transformed;
+		DelegateList<void(Span<const EntityRef>)> transformed_batch;
 	};
 
 
@@ -181,6 +296,7 @@ private:
 	Engine& m_engine;
 	Local<ComponentTypeEntry> m_component_type_map[ComponentType::MAX_TYPES_COUNT];
 	Array<UniquePtr<IModule>> m_modules;
+	Array<struct ISystem*> m_lazy_systems; // systems whose modules were not created yet
 	struct ArchetypeManager;
 	UniquePtr<ArchetypeManager> m_archetype_manager;
 	
@@ -189,10 +305,20 @@ private:
 	Array<EntityData> m_entities;
 	Array<Transform> m_transforms;
 	
+	// fixed timestep interpolation
+	Array<Transform> m_render_transforms;
+	Array<InterpolatedTransform> m_interpolated; // entities moved in the last fixed step
+	Array<u32> m_captured_steps; // indexed by EntityRef::index, last fixed step in which entity was captured
+	u32 m_fixed_step = 0;
+	bool m_in_fixed_step = false;
+	
 	// indexed by EntityData::hierarchy
 	Array<Hierarchy> m_hierarchy;
+	u32 m_hierarchy_version = 0;
 	// indexed by EntityData::name
 	Array<EntityName> m_names;
+	// named entities by name and parent, so findByName does not have to scan m_names
+	HashMap<RuntimeHash, NameIndexEntry> m_name_index;
 	
 	Array<Partition> m_partitions;
 	PartitionHandle m_partition_generator = 0;
@@ -201,6 +327,7 @@ private:
 	
 	DelegateList<void(EntityRef)> m_entity_created;
 	DelegateList<void(EntityRef)> m_entity_destroyed;
+	DelegateList<void(EntityRef, bool)> m_entity_active_changed;
 	DelegateList<void(const ComponentUID&)> m_component_destroyed;
 	DelegateList<void(const ComponentUID&)> m_component_added;
 	
@@ -208,6 +335,14 @@ private:
 	int m_first_free_slot;
 };
 
+template <typename F>
+void World::parallelForEach(Span<const ComponentType> types, const F& f) {
+	parallelForEach(types, (void*)&f, [](void* user_ptr, Span<const EntityRef> entities){
+		const F& f = *(const F*)user_ptr;
+		for (EntityRef e : entities) f(e);
+	});
+}
+
 // to iterate children with range-based for loop: for (EntityRef child : world->childrenOf(parent))
 struct LUMIX_ENGINE_API ChildrenRange {
 	struct LUMIX_ENGINE_API Iterator {
@@ -0,0 +1,533 @@
+#include "core/array.h"
+#include "core/hash_map.h"
+#include "core/math.h"
+#include "core/profiler.h"
+#include "core/sort.h"
+#include "core/stream.h"
+#include "core/string.h"
+#include "engine/engine.h"
+#include "engine/engine_hash_funcs.h"
+#include "engine/reflection.h"
+#include "engine/world.h"
+#include "engine/world_replicator.h"
+
+namespace Lumix {
+
+enum ReplicatedEntityFlags : u8 {
+	COMPONENTS = 1 << 0,
+	POSITION = 1 << 1,
+	ROTATION = 1 << 2,
+	SCALE = 1 << 3,
+	PROPERTIES = 1 << 4, // xor-ed with baseline, same size as in baseline
+	PROPERTIES_FULL = 1 << 5
+};
+
+struct QuantizedTransform {
+	i32 pos[3];
+	i16 rot[4];
+	Vec3 scale;
+};
+
+struct ReplicatedEntity {
+	EntityRef entity;
+	u64 components; // bit per replicated component type
+	QuantizedTransform transform;
+	u32 props_offset;
+	u32 props_size;
+};
+
+// state entities are compared against, when they are not in the other frame
+static const ReplicatedEntity EMPTY_STATE = { EntityRef{0}, 0, {{0, 0, 0}, {0, 0, 0, 0}, Vec3(0)}, 0, 0 };
+
+struct ReplicationSnapshot {
+	ReplicationSnapshot(IAllocator& allocator) : entities(allocator), props(allocator) {}
+
+	const u8* getProps(const ReplicatedEntity& state) const { return props.data() + state.props_offset; }
+
+	u32 frame = 0;
+	Array<ReplicatedEntity> entities; // sorted by entity index
+	OutputMemoryStream props;
+};
+
+struct ReplicatedType {
+	ComponentType type;
+	const reflection::ComponentBase* desc;
+	IModule* module;
+};
+
+static void writeVarint(OutputMemoryStream& out, u64 value) {
+	while (value >= 0x80) {
+		out.write(u8(value | 0x80));
+		value >>= 7;
+	}
+	out.write(u8(value));
+}
+
+static u64 readVarint(InputMemoryStream& in) {
+	u64 value = 0;
+	for (u32 shift = 0; shift < 64; shift += 7) {
+		const u8 b = in.read<u8>();
+		value |= u64(b & 0x7f) << shift;
+		if (!(b & 0x80) || in.hasOverflow()) break;
+	}
+	return value;
+}
+
+static u64 zigzag(i64 value) { return (u64(value) << 1) ^ u64(value >> 63); }
+static i64 unzigzag(u64 value) { return i64(value >> 1) ^ -i64(value & 1); }
+
+static QuantizedTransform quantize(const Transform& tr) {
+	QuantizedTransform res;
+	for (u32 i = 0; i < 3; ++i) {
+		const double p = (&tr.pos.x)[i] / WorldReplicator::POSITION_PRECISION;
+		res.pos[i] = (i32)clamp(p + (p < 0 ? -0.5 : 0.5), -2147483647.0, 2147483647.0);
+		res.rot[i] = (i16)(clamp((&tr.rot.x)[i], -1.f, 1.f) * 32767.f);
+	}
+	res.rot[3] = (i16)(clamp(tr.rot.w, -1.f, 1.f) * 32767.f);
+	res.scale = tr.scale;
+	return res;
+}
+
+static Transform dequantize(const QuantizedTransform& tr) {
+	Transform res;
+	res.pos = DVec3(tr.pos[0], tr.pos[1], tr.pos[2]) * WorldReplicator::POSITION_PRECISION;
+	res.rot = normalize(Quat(tr.rot[0] / 32767.f, tr.rot[1] / 32767.f, tr.rot[2] / 32767.f, tr.rot[3] / 32767.f));
+	res.scale = tr.scale;
+	return res;
+}
+
+// runs of (unchanged bytes count, changed bytes count, changed bytes xor-ed with `prev`)
+static void writeXorDelta(OutputMemoryStream& out, const u8* prev, const u8* cur, u32 size) {
+	u32 i = 0;
+	while (i < size) {
+		u32 same = 0;
+		while (i + same < size && prev[i + same] == cur[i + same]) ++same;
+		i += same;
+		// single unchanged byte is cheaper to send than to start a new run
+		u32 diff = 0;
+		while (i + diff < size && (prev[i + diff] != cur[i + diff] || (i + diff + 1 < size && prev[i + diff + 1] != cur[i + diff + 1]))) ++diff;
+		writeVarint(out, same);
+		writeVarint(out, diff);
+		for (u32 j = 0; j < diff; ++j) out.write(u8(prev[i + j] ^ cur[i + j]));
+		i += diff;
+	}
+}
+
+static bool readXorDelta(InputMemoryStream& in, const u8* prev, u8* cur, u32 size) {
+	memcpy(cur, prev, size);
+	u32 i = 0;
+	while (i < size) {
+		const u64 same = readVarint(in);
+		const u64 diff = readVarint(in);
+		if (in.hasOverflow() || (same == 0 && diff == 0)) return false;
+		if (i + same + diff > size || diff > in.remaining()) return false;
+		i += (u32)same;
+		const u8* x = (const u8*)in.skip(diff);
+		for (u32 j = 0; j < diff; ++j) cur[i + j] = prev[i + j] ^ x[j];
+		i += (u32)diff;
+	}
+	return true;
+}
+
+struct ReplicationPropertyWriter final : reflection::IEmptyPropertyVisitor {
+	ReplicationPropertyWriter(OutputMemoryStream& out) : out(out) {}
+
+	template <typename T> void write(const reflection::Property<T>& prop) {
+		if (prop.isReadonly()) return;
+		out.write(prop.get(cmp, -1));
+	}
+
+	void visit(const reflection::Property<float>& prop) override { write(prop); }
+	void visit(const reflection::Property<int>& prop) override { write(prop); }
+	void visit(const reflection::Property<u32>& prop) override { write(prop); }
+	void visit(const reflection::Property<EntityPtr>& prop) override { write(prop); }
+	void visit(const reflection::Property<Vec2>& prop) override { write(prop); }
+	void visit(const reflection::Property<Vec3>& prop) override { write(prop); }
+	void visit(const reflection::Property<IVec3>& prop) override { write(prop); }
+	void visit(const reflection::Property<Vec4>& prop) override { write(prop); }
+	void visit(const reflection::Property<bool>& prop) override { write(prop); }
+
+	void visit(const reflection::Property<Path>& prop) override {
+		if (prop.isReadonly()) return;
+		out.writeString(prop.get(cmp, -1).c_str());
+	}
+
+	void visit(const reflection::Property<const char*>& prop) override {
+		if (prop.isReadonly()) return;
+		const char* value = prop.get(cmp, -1);
+		out.writeString(value ? value : "");
+	}
+
+	OutputMemoryStream& out;
+	ComponentUID cmp;
+};
+
+struct WorldReplicatorImpl final : WorldReplicator {
+	// sets properties from `in`, compares them with values from `prev` if it's set and skips unchanged ones
+	struct PropertyApplier final : reflection::IEmptyPropertyVisitor {
+		PropertyApplier(WorldReplicatorImpl& replicator, InputMemoryStream& in) : replicator(replicator), in(in) {}
+
+		template <typename T> bool read(const reflection::Property<T>& prop, T& value) {
+			if (prop.isReadonly()) return false;
+			value = in.read<T>();
+			if (!prev) return true;
+			const T prev_value = prev->read<T>();
+			return memcmp(&value, &prev_value, sizeof(T)) != 0;
+		}
+
+		template <typename T> void apply(const reflection::Property<T>& prop) {
+			T value;
+			if (read(prop, value)) prop.set(cmp, -1, value);
+		}
+
+		const char* readString() {
+			const char* value = in.readString();
+			if (!value) return nullptr;
+			if (!prev) return value;
+			const char* prev_value = prev->readString();
+			return prev_value && equalStrings(value, prev_value) ? nullptr : value;
+		}
+
+		void visit(const reflection::Property<float>& prop) override { apply(prop); }
+		void visit(const reflection::Property<int>& prop) override { apply(prop); }
+		void visit(const reflection::Property<u32>& prop) override { apply(prop); }
+		void visit(const reflection::Property<Vec2>& prop) override { apply(prop); }
+		void visit(const reflection::Property<Vec3>& prop) override { apply(prop); }
+		void visit(const reflection::Property<IVec3>& prop) override { apply(prop); }
+		void visit(const reflection::Property<Vec4>& prop) override { apply(prop); }
+		void visit(const reflection::Property<bool>& prop) override { apply(prop); }
+
+		void visit(const reflection::Property<EntityPtr>& prop) override {
+			EntityPtr value;
+			if (!read(prop, value)) return;
+			prop.set(cmp, -1, value.isValid() ? replicator.getLocalEntity((EntityRef)value) : INVALID_ENTITY);
+		}
+
+		void visit(const reflection::Property<Path>& prop) override {
+			if (prop.isReadonly()) return;
+			const char* value = readString();
+			if (value) prop.set(cmp, -1, Path(value));
+		}
+
+		void visit(const reflection::Property<const char*>& prop) override {
+			if (prop.isReadonly()) return;
+			const char* value = readString();
+			if (value) prop.set(cmp, -1, value);
+		}
+
+		WorldReplicatorImpl& replicator;
+		InputMemoryStream& in;
+		InputMemoryStream* prev = nullptr;
+		ComponentUID cmp;
+	};
+
+	WorldReplicatorImpl(Engine& engine, World& world)
+		: m_allocator(engine.getAllocator(), "world replicator")
+		, m_world(world)
+		, m_types(m_allocator)
+		, m_entities(m_allocator)
+		, m_entity_indices(m_allocator)
+		, m_history(m_allocator)
+		, m_empty(m_allocator)
+		, m_entity_map(m_allocator)
+	{
+		m_world.entityDestroyed().bind<&WorldReplicatorImpl::onEntityDestroyed>(this);
+	}
+
+	~WorldReplicatorImpl() {
+		m_world.entityDestroyed().unbind<&WorldReplicatorImpl::onEntityDestroyed>(this);
+	}
+
+	void onEntityDestroyed(EntityRef entity) {
+		removeEntity(entity);
+	}
+
+	void addComponentType(ComponentType type) override {
+		ASSERT(m_types.size() < (i32)MAX_COMPONENT_TYPES);
+		ReplicatedType& t = m_types.emplace();
+		t.type = type;
+		t.desc = reflection::getComponent(type);
+		t.module = m_world.getModule(type);
+	}
+
+	void addEntity(EntityRef entity) override {
+		if (m_entity_indices.find(entity).isValid()) return;
+		m_entity_indices.insert(entity, m_entities.size());
+		m_entities.push(entity);
+	}
+
+	void removeEntity(EntityRef entity) override {
+		auto iter = m_entity_indices.find(entity);
+		if (!iter.isValid()) return;
+		const u32 idx = iter.value();
+		m_entity_indices.erase(iter);
+		if (idx != (u32)m_entities.size() - 1) m_entity_indices[m_entities.back()] = idx;
+		m_entities.swapAndPop(idx);
+	}
+
+	EntityPtr getLocalEntity(EntityRef server_entity) const override {
+		auto iter = m_entity_map.find(server_entity);
+		return iter.isValid() ? EntityPtr(iter.value()) : INVALID_ENTITY;
+	}
+
+	u32 getLastFrame() const override { return m_history.empty() ? 0 : m_history.back()->frame; }
+
+	const ReplicationSnapshot* getSnapshot(u32 frame) const {
+		if (frame == 0) return &m_empty;
+		for (const UniquePtr<ReplicationSnapshot>& s : m_history) {
+			if (s->frame == frame) return s.get();
+		}
+		return nullptr;
+	}
+
+	void pushSnapshot(UniquePtr<ReplicationSnapshot>&& snapshot) {
+		if (m_history.size() == (i32)MAX_HISTORY) m_history.erase(0);
+		m_history.push(static_cast<UniquePtr<ReplicationSnapshot>&&>(snapshot));
+	}
+
+	u32 captureFrame() override {
+		PROFILE_FUNCTION();
+		UniquePtr<ReplicationSnapshot> snapshot = UniquePtr<ReplicationSnapshot>::create(m_allocator, m_allocator);
+		snapshot->frame = getLastFrame() + 1;
+		snapshot->entities.reserve(m_entities.size());
+		ReplicationPropertyWriter writer(snapshot->props);
+		for (EntityRef e : m_entities) {
+			ReplicatedEntity& state = snapshot->entities.emplace();
+			state.entity = e;
+			state.transform = quantize(m_world.getTransform(e));
+			state.components = 0;
+			state.props_offset = (u32)snapshot->props.size();
+			for (i32 i = 0; i < m_types.size(); ++i) {
+				const ReplicatedType& t = m_types[i];
+				if (!m_world.hasComponent(e, t.type)) continue;
+				state.components |= u64(1) << i;
+				writer.cmp = ComponentUID(e, t.type, t.module);
+				t.desc->visit(writer);
+			}
+			state.props_size = u32(snapshot->props.size() - state.props_offset);
+		}
+		sort(snapshot->entities.begin(), snapshot->entities.end(), [](const ReplicatedEntity& a, const ReplicatedEntity& b){
+			return a.entity.index < b.entity.index;
+		});
+		const u32 frame = snapshot->frame;
+		pushSnapshot(snapshot.move());
+		return frame;
+	}
+
+	static void writeEntity(OutputMemoryStream& out, const ReplicationSnapshot& prev_snapshot, const ReplicatedEntity& prev, const ReplicationSnapshot& cur_snapshot, const ReplicatedEntity& cur) {
+		const u8* prev_props = prev_snapshot.getProps(prev);
+		const u8* cur_props = cur_snapshot.getProps(cur);
+		u8 flags = 0;
+		if (prev.components != cur.components) flags |= COMPONENTS;
+		if (memcmp(prev.transform.pos, cur.transform.pos, sizeof(cur.transform.pos)) != 0) flags |= POSITION;
+		if (memcmp(prev.transform.rot, cur.transform.rot, sizeof(cur.transform.rot)) != 0) flags |= ROTATION;
+		if (memcmp(&prev.transform.scale, &cur.transform.scale, sizeof(cur.transform.scale)) != 0) flags |= SCALE;
+		if (prev.props_size != cur.props_size) flags |= PROPERTIES_FULL;
+		else if (memcmp(prev_props, cur_props, cur.props_size) != 0) flags |= PROPERTIES;
+		if (!flags) return;
+
+		writeVarint(out, u64(cur.entity.index) + 1);
+		out.write(flags);
+		if (flags & COMPONENTS) writeVarint(out, cur.components);
+		if (flags & POSITION) {
+			for (u32 i = 0; i < 3; ++i) writeVarint(out, zigzag(i64(cur.transform.pos[i]) - prev.transform.pos[i]));
+		}
+		if (flags & ROTATION) out.write(cur.transform.rot);
+		if (flags & SCALE) out.write(cur.transform.scale);
+		if (flags & PROPERTIES) writeXorDelta(out, prev_props, cur_props, cur.props_size);
+		if (flags & PROPERTIES_FULL) {
+			writeVarint(out, cur.props_size);
+			out.write(cur_props, cur.props_size);
+		}
+	}
+
+	void writeDelta(u32 baseline, OutputMemoryStream& out) override {
+		PROFILE_FUNCTION();
+		ASSERT(!m_history.empty());
+		const ReplicationSnapshot& cur = *m_history.back();
+		const ReplicationSnapshot* prev = getSnapshot(baseline);
+		if (!prev) prev = &m_empty;
+
+		out.write(cur.frame);
+		out.write(prev->frame);
+
+		// removed entities
+		u32 removed_count = 0;
+		for (i32 i = 0, j = 0; i < prev->entities.size(); ++i) {
+			while (j < cur.entities.size() && cur.entities[j].entity.index < prev->entities[i].entity.index) ++j;
+			if (j == cur.entities.size() || cur.entities[j].entity.index != prev->entities[i].entity.index) ++removed_count;
+		}
+		writeVarint(out, removed_count);
+		for (i32 i = 0, j = 0; i < prev->entities.size(); ++i) {
+			while (j < cur.entities.size() && cur.entities[j].entity.index < prev->entities[i].entity.index) ++j;
+			if (j == cur.entities.size() || cur.entities[j].entity.index != prev->entities[i].entity.index) {
+				writeVarint(out, prev->entities[i].entity.index);
+			}
+		}
+
+		// changed entities, index + 1 is written, so 0 terminates the list
+		for (i32 i = 0, j = 0; j < cur.entities.size(); ++j) {
+			const ReplicatedEntity& c = cur.entities[j];
+			while (i < prev->entities.size() && prev->entities[i].entity.index < c.entity.index) ++i;
+			const bool in_prev = i < prev->entities.size() && prev->entities[i].entity.index == c.entity.index;
+			writeEntity(out, *prev, in_prev ? prev->entities[i] : EMPTY_STATE, cur, c);
+		}
+		writeVarint(out, 0);
+	}
+
+	bool readDelta(InputMemoryStream& in, const ReplicationSnapshot& prev, ReplicationSnapshot& cur) {
+		const u64 removed_count = readVarint(in);
+		if (removed_count > (u64)prev.entities.size()) return false;
+		Array<i32> removed(m_allocator);
+		removed.resize((u32)removed_count);
+		for (i32& r : removed) r = (i32)readVarint(in);
+
+		i32 prev_idx = 0;
+		i32 removed_idx = 0;
+		// unchanged entities from baseline with index < `until`
+		auto copyUnchanged = [&](i64 until) {
+			for (; prev_idx < prev.entities.size() && prev.entities[prev_idx].entity.index < until; ++prev_idx) {
+				const ReplicatedEntity& p = prev.entities[prev_idx];
+				while (removed_idx < removed.size() && removed[removed_idx] < p.entity.index) ++removed_idx;
+				if (removed_idx < removed.size() && removed[removed_idx] == p.entity.index) continue;
+				ReplicatedEntity& s = cur.entities.emplace(p);
+				s.props_offset = (u32)cur.props.size();
+				cur.props.write(prev.getProps(p), p.props_size);
+			}
+		};
+
+		for (;;) {
+			const u64 index_plus_one = readVarint(in);
+			if (in.hasOverflow()) return false;
+			if (index_plus_one == 0) break;
+			if (index_plus_one > 0x7fFFffFF) return false;
+			const u64 index = index_plus_one - 1;
+
+			copyUnchanged(index);
+			const bool in_prev = prev_idx < prev.entities.size() && prev.entities[prev_idx].entity.index == (i32)index;
+			const ReplicatedEntity& p = in_prev ? prev.entities[prev_idx] : EMPTY_STATE;
+			if (in_prev) ++prev_idx;
+
+			ReplicatedEntity& s = cur.entities.emplace(p);
+			s.entity = EntityRef{(i32)index};
+			const u8 flags = in.read<u8>();
+			if (flags & COMPONENTS) s.components = readVarint(in);
+			if (flags & POSITION) {
+				for (u32 i = 0; i < 3; ++i) s.transform.pos[i] = i32(i64(p.transform.pos[i]) + unzigzag(readVarint(in)));
+			}
+			if (flags & ROTATION) in.read(s.transform.rot);
+			if (flags & SCALE) in.read(s.transform.scale);
+			s.props_offset = (u32)cur.props.size();
+			if (flags & PROPERTIES) {
+				u8* dst = (u8*)cur.props.skip(p.props_size);
+				if (!readXorDelta(in, prev.getProps(p), dst, p.props_size)) return false;
+			}
+			else if (flags & PROPERTIES_FULL) {
+				s.props_size = (u32)readVarint(in);
+				if (s.props_size > in.remaining()) return false;
+				cur.props.write(in.skip(s.props_size), s.props_size);
+			}
+			else {
+				cur.props.write(prev.getProps(p), p.props_size);
+			}
+			if (in.hasOverflow()) return false;
+		}
+		copyUnchanged(i64(1) << 32);
+		return !in.hasOverflow();
+	}
+
+	// makes world match `cur`, world is expected to match `prev`
+	void sync(const ReplicationSnapshot& prev, const ReplicationSnapshot& cur) {
+		PROFILE_FUNCTION();
+		// destroy removed entities
+		for (i32 i = 0, j = 0; i < prev.entities.size(); ++i) {
+			const EntityRef e = prev.entities[i].entity;
+			while (j < cur.entities.size() && cur.entities[j].entity.index < e.index) ++j;
+			if (j < cur.entities.size() && cur.entities[j].entity == e) continue;
+			auto iter = m_entity_map.find(e);
+			if (!iter.isValid()) continue;
+			m_world.destroyEntity(iter.value());
+			m_entity_map.erase(iter);
+		}
+
+		// create all new entities first, so entity properties can be mapped
+		for (const ReplicatedEntity& s : cur.entities) {
+			if (m_entity_map.find(s.entity).isValid()) continue;
+			const Transform tr = dequantize(s.transform);
+			const EntityRef e = m_world.createEntity(tr.pos, tr.rot);
+			m_entity_map.insert(s.entity, e);
+		}
+
+		Array<EntityRef> moved(m_allocator);
+		Array<Transform> transforms(m_allocator);
+		for (i32 i = 0, j = 0; j < cur.entities.size(); ++j) {
+			const ReplicatedEntity& c = cur.entities[j];
+			while (i < prev.entities.size() && prev.entities[i].entity.index < c.entity.index) ++i;
+			const bool in_prev = i < prev.entities.size() && prev.entities[i].entity == c.entity;
+			const ReplicatedEntity& p = in_prev ? prev.entities[i] : EMPTY_STATE;
+			const EntityRef e = m_entity_map[c.entity];
+
+			if (!in_prev || memcmp(&p.transform, &c.transform, sizeof(c.transform)) != 0) {
+				moved.push(e);
+				transforms.push(dequantize(c.transform));
+			}
+
+			for (i32 t = 0; t < m_types.size(); ++t) {
+				const u64 bit = u64(1) << t;
+				if ((c.components & bit) && !(p.components & bit)) m_world.createComponent(m_types[t].type, e);
+				if (!(c.components & bit) && (p.components & bit)) m_world.destroyComponent(e, m_types[t].type);
+			}
+
+			const bool props_changed = p.props_size != c.props_size || memcmp(prev.getProps(p), cur.getProps(c), c.props_size) != 0;
+			if (!props_changed) continue;
+
+			InputMemoryStream blob(cur.getProps(c), c.props_size);
+			InputMemoryStream prev_blob(prev.getProps(p), p.props_size);
+			PropertyApplier applier(*this, blob);
+			// properties are compared only if the layout is the same
+			if (p.components == c.components) applier.prev = &prev_blob;
+			for (i32 t = 0; t < m_types.size(); ++t) {
+				if (!(c.components & (u64(1) << t))) continue;
+				applier.cmp = ComponentUID(e, m_types[t].type, m_types[t].module);
+				m_types[t].desc->visit(applier);
+			}
+		}
+		m_world.setTransforms(moved, transforms);
+	}
+
+	bool applyDelta(InputMemoryStream& in) override {
+		PROFILE_FUNCTION();
+		const u32 frame = in.read<u32>();
+		const u32 baseline = in.read<u32>();
+		if (in.hasOverflow()) return false;
+
+		const ReplicationSnapshot* prev = getSnapshot(baseline);
+		if (!prev) return false;
+		if (frame <= getLastFrame()) return true;
+
+		UniquePtr<ReplicationSnapshot> snapshot = UniquePtr<ReplicationSnapshot>::create(m_allocator, m_allocator);
+		snapshot->frame = frame;
+		if (!readDelta(in, *prev, *snapshot)) return false;
+
+		// world matches the last applied frame, which can be newer than baseline
+		const ReplicationSnapshot& last = m_history.empty() ? m_empty : *m_history.back();
+		sync(last, *snapshot);
+		pushSnapshot(snapshot.move());
+		return true;
+	}
+
+	TagAllocator m_allocator;
+	World& m_world;
+	Array<ReplicatedType> m_types;
+	Array<EntityRef> m_entities;
+	HashMap<EntityRef, u32> m_entity_indices;
+	Array<UniquePtr<ReplicationSnapshot>> m_history;
+	ReplicationSnapshot m_empty;
+	HashMap<EntityRef, EntityRef> m_entity_map; // server entity -> client entity
+};
+
+UniquePtr<WorldReplicator> WorldReplicator::create(Engine& engine, World& world) {
+	return UniquePtr<WorldReplicatorImpl>::create(engine.getAllocator(), engine, world);
+}
+
+} // namespace Lumix
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "engine/lumix.h"
+
+
+namespace Lumix {
+
+template <typename T> struct UniquePtr;
+
+// replicates state of selected entities, e.g. from dedicated server to clients
+// server captures frames, changes are detected by comparing captured frames, not by tracking setters
+// and writes changes between a baseline frame (the last one acknowledged by client) and the latest frame
+// positions and rotations are quantized, properties are xor-ed with baseline and unchanged bytes are skipped
+// client applies the stream and maps server entities to its own entities
+// server and client must add the same component types in the same order
+struct LUMIX_ENGINE_API WorldReplicator {
+	static constexpr double POSITION_PRECISION = 1 / 1024.0;
+	// frames older than this can not be used as baseline, full state is sent instead
+	static constexpr u32 MAX_HISTORY = 32;
+	static constexpr u32 MAX_COMPONENT_TYPES = 64;
+
+	static UniquePtr<WorldReplicator> create(struct Engine& engine, struct World& world);
+
+	virtual ~WorldReplicator() {}
+	// properties of components of `type` are replicated, readonly, array and blob properties are skipped
+	virtual void addComponentType(ComponentType type) = 0;
+
+	// server
+	virtual void addEntity(EntityRef entity) = 0;
+	virtual void removeEntity(EntityRef entity) = 0;
+	// captures state of all replicated entities, returns the frame number, first frame is 1
+	virtual u32 captureFrame() = 0;
+	// writes changes from `baseline` to the last captured frame, full state if `baseline` is 0 or it's older than MAX_HISTORY
+	virtual void writeDelta(u32 baseline, struct OutputMemoryStream& out) = 0;
+
+	// client, frames older than the last applied one are ignored
+	// fails if the baseline of the stream was not applied on this client or is too old
+	[[nodiscard]] virtual bool applyDelta(struct InputMemoryStream& in) = 0;
+	virtual EntityPtr getLocalEntity(EntityRef server_entity) const = 0;
+
+	// server - the last captured frame, client - the last applied frame
+	virtual u32 getLastFrame() const = 0;
+};
+
+} // namespace Lumix
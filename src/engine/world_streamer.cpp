@@ -0,0 +1,186 @@
+#include "core/atomic.h"
+#include "core/job_system.h"
+#include "core/log.h"
+#include "core/math.h"
+#include "core/path.h"
+#include "core/profiler.h"
+#include "core/stream.h"
+#include "engine/engine.h"
+#include "engine/file_system.h"
+#include "engine/world.h"
+#include "engine/world_streamer.h"
+
+namespace Lumix {
+
+struct WorldStreamerImpl;
+
+struct StreamedPartition {
+	enum State : i32 {
+		UNLOADED,
+		READING,
+		PREPARING, // decompressing on worker
+		PREPARED, // waiting for commit on main thread
+		LOADED,
+		FAILED
+	};
+
+	StreamedPartition(WorldStreamerImpl& streamer, IAllocator& allocator)
+		: streamer(streamer)
+		, content(allocator)
+		, prepared(allocator)
+	{}
+
+	void onFileLoaded(Span<const u8> content, bool success);
+
+	WorldStreamerImpl& streamer;
+	Path path;
+	DVec3 center;
+	float radius;
+	AtomicI32 state = UNLOADED;
+	FileSystem::AsyncHandle read_handle = FileSystem::AsyncHandle::invalid();
+	World::PartitionHandle partition = 0;
+	OutputMemoryStream content;
+	World::PreparedWorld prepared;
+};
+
+struct WorldStreamerImpl final : WorldStreamer {
+	WorldStreamerImpl(Engine& engine, World& world)
+		: m_allocator(engine.getAllocator(), "world streamer")
+		, m_engine(engine)
+		, m_world(world)
+		, m_partitions(m_allocator)
+	{}
+
+	~WorldStreamerImpl() {
+		FileSystem& fs = m_engine.getFileSystem();
+		for (UniquePtr<StreamedPartition>& p : m_partitions) {
+			if (p->state == StreamedPartition::READING) fs.cancel(p->read_handle);
+		}
+		jobs::wait(&m_jobs);
+	}
+
+	void addPartition(const Path& path, const DVec3& center, float radius) override {
+		UniquePtr<StreamedPartition> p = UniquePtr<StreamedPartition>::create(m_allocator, *this, m_allocator);
+		p->path = path;
+		p->center = center;
+		p->radius = radius;
+		m_partitions.push(p.move());
+	}
+
+	void setSource(const DVec3& pos) override { m_source = pos; }
+
+	bool isLoaded(const Path& path) const override {
+		for (const UniquePtr<StreamedPartition>& p : m_partitions) {
+			if (p->path == path) return p->state == StreamedPartition::LOADED;
+		}
+		return false;
+	}
+
+	void onFileLoaded(StreamedPartition& p, Span<const u8> content, bool success) {
+		p.read_handle = FileSystem::AsyncHandle::invalid();
+		if (!success) {
+			logError("Failed to read world partition ", p.path);
+			p.state = StreamedPartition::FAILED;
+			return;
+		}
+
+		p.content.clear();
+		p.content.write(content.begin(), content.length());
+		p.state = StreamedPartition::PREPARING;
+		jobs::runLambda([this, &p](){
+			PROFILE_BLOCK("prepare world partition");
+			InputMemoryStream blob(p.content);
+			bool success = m_world.prepareDeserialize(blob, p.prepared);
+			if (success && p.prepared.header.deserialize_partitions) {
+				logError(p.path, " contains multiple partitions, it can not be streamed");
+				success = false;
+			}
+			p.content.free();
+			p.state = success ? StreamedPartition::PREPARED : StreamedPartition::FAILED;
+		}, &m_jobs);
+	}
+
+	void startReading(StreamedPartition& p) {
+		p.state = StreamedPartition::READING;
+		FileSystem& fs = m_engine.getFileSystem();
+		p.read_handle = fs.getContent(p.path, makeDelegate<&StreamedPartition::onFileLoaded>(&p), FileSystem::Priority::LOW);
+	}
+
+	bool commit(StreamedPartition& p) {
+		PROFILE_FUNCTION();
+		const World::PartitionHandle prev_active = m_world.getActivePartition();
+		p.partition = m_world.createPartition(p.path.c_str());
+		m_world.setActivePartition(p.partition);
+		EntityMap entity_map(m_allocator);
+		const bool success = m_world.commitDeserialize(p.prepared, entity_map);
+		m_world.setActivePartition(prev_active);
+		p.prepared.sections.clear();
+		if (!success) {
+			logError("Failed to load world partition ", p.path);
+			m_world.destroyPartition(p.partition);
+		}
+		return success;
+	}
+
+	void update() override {
+		PROFILE_FUNCTION();
+		bool committed = false;
+		for (UniquePtr<StreamedPartition>& ptr : m_partitions) {
+			StreamedPartition& p = *ptr;
+			const double dist_squared = squaredLength(p.center - m_source);
+			const double unload_radius = p.radius * UNLOAD_RADIUS_FACTOR;
+			const bool in_range = dist_squared < double(p.radius) * p.radius;
+			const bool out_of_range = dist_squared > unload_radius * unload_radius;
+
+			switch (p.state) {
+				case StreamedPartition::UNLOADED:
+					if (in_range) startReading(p);
+					break;
+				case StreamedPartition::READING:
+					if (out_of_range) {
+						m_engine.getFileSystem().cancel(p.read_handle);
+						p.read_handle = FileSystem::AsyncHandle::invalid();
+						p.state = StreamedPartition::UNLOADED;
+					}
+					break;
+				case StreamedPartition::PREPARED:
+					if (out_of_range) {
+						p.prepared.sections.clear();
+						p.state = StreamedPartition::UNLOADED;
+					}
+					// commit is the only part on main thread, one per update to keep frames short
+					else if (!committed) {
+						committed = true;
+						p.state = commit(p) ? StreamedPartition::LOADED : StreamedPartition::FAILED;
+					}
+					break;
+				case StreamedPartition::LOADED:
+					if (out_of_range) {
+						m_world.destroyPartition(p.partition);
+						p.state = StreamedPartition::UNLOADED;
+					}
+					break;
+				case StreamedPartition::PREPARING:
+				case StreamedPartition::FAILED:
+					break;
+			}
+		}
+	}
+
+	TagAllocator m_allocator;
+	Engine& m_engine;
+	World& m_world;
+	Array<UniquePtr<StreamedPartition>> m_partitions;
+	DVec3 m_source = DVec3(0);
+	jobs::Counter m_jobs;
+};
+
+void StreamedPartition::onFileLoaded(Span<const u8> content, bool success) {
+	streamer.onFileLoaded(*this, content, success);
+}
+
+UniquePtr<WorldStreamer> WorldStreamer::create(Engine& engine, World& world) {
+	return UniquePtr<WorldStreamerImpl>::create(engine.getAllocator(), engine, world);
+}
+
+} // namespace Lumix
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "engine/lumix.h"
+
+
+namespace Lumix {
+
+template <typename T> struct UniquePtr;
+
+// loads and unloads world partitions by the distance to the streaming source
+// each partition is a separate world file, e.g. saved from editor with savePartition
+// file reading and decompression run in background, only the final deserialization runs on main thread, at most one partition per update
+struct LUMIX_ENGINE_API WorldStreamer {
+	// partition is unloaded when the source is farther than radius * UNLOAD_RADIUS_FACTOR, so it does not reload on the border
+	static constexpr float UNLOAD_RADIUS_FACTOR = 1.2f;
+
+	static UniquePtr<WorldStreamer> create(struct Engine& engine, struct World& world);
+
+	virtual ~WorldStreamer() {}
+	// partition is loaded when the source is closer than `radius` to `center`
+	virtual void addPartition(const struct Path& path, const struct DVec3& center, float radius) = 0;
+	virtual void setSource(const DVec3& pos) = 0;
+	virtual void update() = 0;
+	virtual bool isLoaded(const Path& path) const = 0;
+};
+
+} // namespace Lumix
@@ -0,0 +1,662 @@
+// replays a frame captured with -gpu_capture (see DrawStreamCapture) through gpu:: backend
+// measures the render thread's cost of submitting the frame without the rest of the engine
+// results are printed to stdout as JSON, so they can be compared between commits
+// usage: gpu_replay <capture.ldc> [-frames <count>] [-warmup <count>] [-width <w>] [-height <h>]
+
+#include <stdio.h>
+
+#include "core/array.h"
+#include "core/command_line_parser.h"
+#include "core/debug.h"
+#include "core/default_allocator.h"
+#include "core/hash.h"
+#include "core/hash_map.h"
+#include "core/job_system.h"
+#include "core/log.h"
+#include "core/log_callback.h"
+#include "core/math.h"
+#include "core/os.h"
+#include "core/profiler.h"
+#include "core/sort.h"
+#include "core/stream.h"
+#include "core/string.h"
+#include "core/sync.h"
+#include "renderer/draw_stream_capture.h"
+#include "renderer/gpu/gpu.h"
+
+using namespace Lumix;
+using Cmd = DrawStreamCaptureCommand;
+
+static void logToStderr(LogLevel level, const char* message) {
+	fprintf(stderr, "%s%s\n", level == LogLevel::ERROR ? "Error: " : "", message);
+}
+
+struct Replay {
+	// gpu keeps a few frames in flight, queries are read when their frame is finished
+	static constexpr u32 FRAMES_IN_FLIGHT = 3;
+
+	struct Bindless {
+		u32 value;
+		u32 id;
+		bool is_buffer;
+	};
+
+	struct Block {
+		StaticString<64> name;
+		double total = 0;
+		u32 count = 0;
+	};
+
+	struct Interval {
+		u32 block;
+		gpu::QueryHandle begin;
+		gpu::QueryHandle end;
+	};
+
+	struct InFlight {
+		InFlight(IAllocator& allocator) : intervals(allocator), stack(allocator) {}
+		Array<Interval> intervals;
+		Array<u32> stack;
+		u32 gpu_frame = 0;
+		bool pending = false;
+		// warmup frames are not measured
+		bool measure = false;
+	};
+
+	Replay(IAllocator& allocator)
+		: allocator(allocator)
+		, data(allocator)
+		, handles(allocator)
+		, bindless(allocator)
+		, free_queries(allocator)
+		, blocks(allocator)
+		, block_map(allocator)
+		, cpu_times(allocator)
+		, gpu_times(allocator)
+	{
+		for (u32 i = 0; i < FRAMES_IN_FLIGHT; ++i) in_flight[i].create(allocator);
+	}
+
+	bool load(const char* path) {
+		os::InputFile file;
+		if (!file.open(path)) {
+			logError("Could not open ", path);
+			return false;
+		}
+		data.resize(file.size());
+		const bool read = file.read(data.getMutableData(), data.size());
+		file.close();
+		if (!read) {
+			logError("Could not read ", path);
+			return false;
+		}
+
+		InputMemoryStream blob(data);
+		blob.read(header);
+		if (header.magic != DrawStreamCapture::MAGIC) {
+			logError(path, " is not a draw stream capture");
+			return false;
+		}
+		if (header.version != DrawStreamCapture::VERSION) {
+			logError(path, " has unsupported version ", header.version);
+			return false;
+		}
+		if (header.unknown_handles > 0) {
+			logWarning(header.unknown_handles, " handles in the capture were not known to the capture, null resources are used instead");
+		}
+		return true;
+	}
+
+	template <typename T> T get(u32 id) const { return id < (u32)handles.size() ? (T)handles[id] : nullptr; }
+	gpu::BufferHandle buffer(InputMemoryStream& blob) { return get<gpu::BufferHandle>(blob.read<u32>()); }
+	gpu::TextureHandle texture(InputMemoryStream& blob) { return get<gpu::TextureHandle>(blob.read<u32>()); }
+
+	void setHandle(u32 id, void* handle) {
+		if (id >= (u32)handles.size()) handles.resize(id + 1);
+		handles[id] = handle;
+	}
+
+	// shaders read bindless indices from uniforms, so textures and buffers must get the same indices as in the engine
+	// fresh device hands out indices in ascending order, so handles are allocated in that order, skipping the ones engine did not use
+	void allocHandles() {
+		sort(bindless.begin(), bindless.end(), [](const Bindless& a, const Bindless& b){ return a.value < b.value; });
+		for (const Bindless& b : bindless) {
+			for (;;) {
+				void* handle = b.is_buffer ? (void*)gpu::allocBufferHandle() : (void*)gpu::allocTextureHandle();
+				const u32 value = b.is_buffer ? gpu::getBindlessHandle((gpu::BufferHandle)handle).value : gpu::getBindlessHandle((gpu::TextureHandle)handle).value;
+				// index already taken by replay's own resources, shaders will read a wrong resource
+				if (value > b.value) ++bindless_mismatches;
+				// handles skipped to get to the right index are never created
+				if (value >= b.value) {
+					setHandle(b.id, handle);
+					break;
+				}
+			}
+		}
+	}
+
+	// setup commands are run twice, first only to collect handles, then to create the resources
+	void setup(bool collect) {
+		InputMemoryStream blob(data);
+		blob.skip(sizeof(header));
+		for (;;) {
+			const Cmd cmd = blob.read<Cmd>();
+			switch (cmd) {
+				case Cmd::CREATE_BUFFER: {
+					const u32 id = blob.read<u32>();
+					const u32 value = blob.read<u32>();
+					const gpu::BufferFlags flags = (gpu::BufferFlags)blob.read<u32>();
+					const u64 size = blob.read<u64>();
+					const char* name = blob.readString();
+					const u64 data_size = blob.read<u64>();
+					const void* content = blob.skip(data_size);
+					if (collect) {
+						bindless.push({value, id, true});
+						break;
+					}
+					const gpu::BufferHandle handle = get<gpu::BufferHandle>(id);
+					if (data_size == size) {
+						gpu::createBuffer(handle, flags, size, content, name);
+					}
+					else {
+						// mapped buffers are captured only up to the used part
+						gpu::createBuffer(handle, flags, size, nullptr, name);
+						if (data_size > 0) gpu::update(handle, content, data_size);
+					}
+					break;
+				}
+				case Cmd::CREATE_TEXTURE: {
+					const u32 id = blob.read<u32>();
+					const u32 value = blob.read<u32>();
+					const u32 w = blob.read<u32>();
+					const u32 h = blob.read<u32>();
+					const u32 depth = blob.read<u32>();
+					const gpu::TextureFormat format = (gpu::TextureFormat)blob.read<u32>();
+					const gpu::TextureFlags flags = (gpu::TextureFlags)blob.read<u32>();
+					const u32 heap = blob.read<u32>();
+					const u64 offset = blob.read<u64>();
+					const char* name = blob.readString();
+					if (collect) {
+						bindless.push({value, id, false});
+						break;
+					}
+					const gpu::TextureHandle handle = get<gpu::TextureHandle>(id);
+					if (heap) gpu::createTexture(handle, w, h, depth, format, flags, get<gpu::HeapHandle>(heap), offset, name);
+					else gpu::createTexture(handle, w, h, depth, format, flags, name);
+					break;
+				}
+				case Cmd::CREATE_HEAP: {
+					const u32 id = blob.read<u32>();
+					const u64 size = blob.read<u64>();
+					const gpu::TextureFlags flags = (gpu::TextureFlags)blob.read<u32>();
+					const char* name = blob.readString();
+					if (collect) break;
+					const gpu::HeapHandle heap = gpu::allocHeapHandle();
+					setHandle(id, heap);
+					gpu::createHeap(heap, size, flags, name);
+					break;
+				}
+				case Cmd::CREATE_TEXTURE_VIEW: {
+					const u32 id = blob.read<u32>();
+					const u32 value = blob.read<u32>();
+					const u32 texture = blob.read<u32>();
+					const u32 layer = blob.read<u32>();
+					const u32 mip = blob.read<u32>();
+					if (collect) {
+						bindless.push({value, id, false});
+						break;
+					}
+					gpu::createTextureView(get<gpu::TextureHandle>(id), get<gpu::TextureHandle>(texture), layer, mip);
+					break;
+				}
+				case Cmd::CREATE_PROGRAM: {
+					const u32 id = blob.read<u32>();
+					const gpu::StateFlags state = blob.read<gpu::StateFlags>();
+					gpu::VertexDecl decl(gpu::PrimitiveType::NONE);
+					blob.read(decl);
+					const gpu::ShaderType type = blob.read<gpu::ShaderType>();
+					const char* name = blob.readString();
+					const char* src = blob.readString();
+					if (collect) break;
+					const gpu::ProgramHandle program = gpu::allocProgramHandle();
+					setHandle(id, program);
+					gpu::createProgram(program, state, decl, src, type, name);
+					break;
+				}
+				case Cmd::UPDATE_BUFFER:
+				case Cmd::UPDATE_TEXTURE:
+				case Cmd::SET_TEXTURE_MIN_LOD:
+					// textures are in the right state only after they are created
+					if (collect) skip(blob, cmd);
+					else execute(blob, cmd);
+					break;
+				case Cmd::FRAME:
+					frame_offset = blob.getPosition();
+					return;
+				default:
+					ASSERT(false);
+					logError("Unexpected command ", (u32)cmd, " in capture's setup");
+					return;
+			}
+		}
+	}
+
+	void skip(InputMemoryStream& blob, Cmd cmd) {
+		switch (cmd) {
+			case Cmd::UPDATE_BUFFER:
+				blob.skip(sizeof(u32));
+				blob.skip(blob.read<u64>());
+				break;
+			case Cmd::UPDATE_TEXTURE:
+				blob.skip(sizeof(u32) * 7 + sizeof(gpu::TextureFormat));
+				blob.skip(blob.read<u32>());
+				break;
+			case Cmd::SET_TEXTURE_MIN_LOD:
+				blob.skip(sizeof(u32) * 2);
+				break;
+			default: ASSERT(false); break;
+		}
+	}
+
+	gpu::QueryHandle allocQuery() {
+		if (free_queries.empty()) return gpu::createQuery(gpu::QueryType::TIMESTAMP);
+		gpu::QueryHandle q = free_queries.back();
+		free_queries.pop();
+		return q;
+	}
+
+	void beginBlock(InFlight& frame, const char* name) {
+		const RuntimeHash hash(name);
+		auto iter = block_map.find(hash);
+		if (!iter.isValid()) {
+			iter = block_map.insert(hash, blocks.size());
+			blocks.emplace().name = name;
+		}
+		frame.stack.push(frame.intervals.size());
+		Interval& interval = frame.intervals.emplace();
+		interval.block = iter.value();
+		interval.begin = allocQuery();
+		interval.end = gpu::INVALID_QUERY;
+		gpu::queryTimestamp(interval.begin);
+	}
+
+	void endBlock(InFlight& frame) {
+		if (frame.stack.empty()) return;
+		Interval& interval = frame.intervals[frame.stack.back()];
+		frame.stack.pop();
+		interval.end = allocQuery();
+		gpu::queryTimestamp(interval.end);
+	}
+
+	void execute(InputMemoryStream& blob, Cmd cmd) {
+		switch (cmd) {
+			case Cmd::UPDATE_BUFFER: {
+				const gpu::BufferHandle handle = buffer(blob);
+				const u64 size = blob.read<u64>();
+				gpu::update(handle, blob.skip(size), size);
+				break;
+			}
+			case Cmd::UPDATE_TEXTURE: {
+				const gpu::TextureHandle handle = texture(blob);
+				const u32 mip = blob.read<u32>();
+				const u32 x = blob.read<u32>();
+				const u32 y = blob.read<u32>();
+				const u32 z = blob.read<u32>();
+				const u32 w = blob.read<u32>();
+				const u32 h = blob.read<u32>();
+				const gpu::TextureFormat format = blob.read<gpu::TextureFormat>();
+				const u32 size = blob.read<u32>();
+				gpu::update(handle, mip, x, y, z, w, h, format, blob.skip(size), size);
+				break;
+			}
+			case Cmd::SET_TEXTURE_MIN_LOD: {
+				const gpu::TextureHandle handle = texture(blob);
+				gpu::setMinLOD(handle, blob.read<u32>());
+				break;
+			}
+			case Cmd::DRAW: {
+				gpu::Drawcall dc;
+				dc.program = get<gpu::ProgramHandle>(blob.read<u32>());
+				dc.index_buffer = buffer(blob);
+				dc.vertex_buffers[0] = buffer(blob);
+				dc.vertex_buffers[1] = buffer(blob);
+				blob.read(dc.vertex_buffer_offsets);
+				blob.read(dc.vertex_buffer_sizes);
+				blob.read(dc.indices_count);
+				blob.read(dc.instances_count);
+				blob.read(dc.index_type);
+				gpu::draw(dc);
+				++drawcalls;
+				break;
+			}
+			case Cmd::USE_PROGRAM: gpu::useProgram(get<gpu::ProgramHandle>(blob.read<u32>())); break;
+			case Cmd::BIND_INDEX_BUFFER: gpu::bindIndexBuffer(buffer(blob)); break;
+			case Cmd::BIND_INDIRECT_BUFFER: gpu::bindIndirectBuffer(buffer(blob)); break;
+			case Cmd::BIND_VERTEX_BUFFER: {
+				const u32 idx = blob.read<u32>();
+				const gpu::BufferHandle handle = buffer(blob);
+				const u32 offset = blob.read<u32>();
+				const u32 stride = blob.read<u32>();
+				gpu::bindVertexBuffer(idx, handle, offset, stride);
+				break;
+			}
+			case Cmd::BIND_UNIFORM_BUFFER: {
+				const u32 idx = blob.read<u32>();
+				const gpu::BufferHandle handle = buffer(blob);
+				const u64 offset = blob.read<u64>();
+				const u64 size = blob.read<u64>();
+				gpu::bindUniformBuffer(idx, handle, offset, size);
+				break;
+			}
+			case Cmd::BIND_SHADER_BUFFERS: {
+				gpu::BufferHandle buffers[6];
+				for (gpu::BufferHandle& b : buffers) b = buffer(blob);
+				gpu::bindShaderBuffers(buffers);
+				break;
+			}
+			case Cmd::DRAW_ARRAYS: {
+				const u32 offset = blob.read<u32>();
+				const u32 count = blob.read<u32>();
+				gpu::drawArrays(offset, count);
+				++drawcalls;
+				break;
+			}
+			case Cmd::DRAW_INDEXED: {
+				const u32 offset = blob.read<u32>();
+				const u32 count = blob.read<u32>();
+				gpu::drawIndexed(offset, count, blob.read<gpu::DataType>());
+				++drawcalls;
+				break;
+			}
+			case Cmd::DRAW_ARRAYS_INSTANCED: {
+				const u32 indices_count = blob.read<u32>();
+				const u32 instances_count = blob.read<u32>();
+				gpu::drawArraysInstanced(indices_count, instances_count);
+				++drawcalls;
+				break;
+			}
+			case Cmd::DRAW_INDEXED_INSTANCED: {
+				const u32 indices_count = blob.read<u32>();
+				const u32 instances_count = blob.read<u32>();
+				gpu::drawIndexedInstanced(indices_count, instances_count, blob.read<gpu::DataType>());
+				++drawcalls;
+				break;
+			}
+			case Cmd::DRAW_INDIRECT: {
+				const gpu::DataType index_type = blob.read<gpu::DataType>();
+				gpu::drawIndirect(index_type, blob.read<u32>());
+				++drawcalls;
+				break;
+			}
+			case Cmd::DRAW_ARRAYS_INDIRECT:
+				gpu::drawArraysIndirect(blob.read<u32>());
+				++drawcalls;
+				break;
+			case Cmd::DISPATCH: {
+				const IVec3 size = blob.read<IVec3>();
+				gpu::dispatch(size.x, size.y, size.z);
+				break;
+			}
+			case Cmd::SET_FRAMEBUFFER: {
+				const u32 num = blob.read<u32>();
+				const gpu::TextureHandle ds = texture(blob);
+				const gpu::FramebufferFlags flags = blob.read<gpu::FramebufferFlags>();
+				gpu::TextureHandle attachments[16];
+				ASSERT(num <= lengthOf(attachments));
+				for (u32 i = 0; i < num; ++i) attachments[i] = texture(blob);
+				gpu::setFramebuffer(attachments, num, ds, flags);
+				break;
+			}
+			case Cmd::SET_FRAMEBUFFER_CUBE: {
+				const gpu::TextureHandle cube = texture(blob);
+				const u32 face = blob.read<u32>();
+				gpu::setFramebufferCube(cube, face, blob.read<u32>());
+				break;
+			}
+			case Cmd::VIEWPORT: {
+				const IVec4 v = blob.read<IVec4>();
+				gpu::viewport(v.x, v.y, v.z, v.w);
+				break;
+			}
+			case Cmd::SCISSOR: {
+				const IVec4 v = blob.read<IVec4>();
+				gpu::scissor(v.x, v.y, v.z, v.w);
+				break;
+			}
+			case Cmd::CLEAR: {
+				const gpu::ClearFlags flags = blob.read<gpu::ClearFlags>();
+				const Vec4 color = blob.read<Vec4>();
+				gpu::clear(flags, &color.x, blob.read<float>());
+				break;
+			}
+			case Cmd::MEMORY_BARRIER: gpu::memoryBarrier(buffer(blob)); break;
+			case Cmd::MEMORY_BARRIER_TEXTURE: gpu::memoryBarrier(texture(blob)); break;
+			case Cmd::TEXTURE_BARRIER: {
+				const gpu::TextureHandle handle = texture(blob);
+				gpu::barrier(handle, blob.read<gpu::BarrierType>());
+				break;
+			}
+			case Cmd::BUFFER_BARRIER: {
+				const gpu::BufferHandle handle = buffer(blob);
+				gpu::barrier(handle, blob.read<gpu::BarrierType>());
+				break;
+			}
+			case Cmd::ALIASING_BARRIER: gpu::aliasingBarrier(texture(blob)); break;
+			case Cmd::SET_QUEUE: gpu::setQueue(blob.read<gpu::QueueType>()); break;
+			case Cmd::SYNC_QUEUES: {
+				const gpu::QueueType waiting = blob.read<gpu::QueueType>();
+				gpu::syncQueues(waiting, blob.read<gpu::QueueType>());
+				break;
+			}
+			case Cmd::COPY_TEXTURE: {
+				const gpu::TextureHandle dst = texture(blob);
+				const gpu::TextureHandle src = texture(blob);
+				const u32 x = blob.read<u32>();
+				gpu::copy(dst, src, x, blob.read<u32>());
+				break;
+			}
+			case Cmd::COPY_TEXTURE_TO_BUFFER: {
+				const gpu::BufferHandle dst = buffer(blob);
+				gpu::copy(dst, texture(blob));
+				break;
+			}
+			case Cmd::COPY_BUFFER: {
+				const gpu::BufferHandle dst = buffer(blob);
+				const gpu::BufferHandle src = buffer(blob);
+				const u32 dst_offset = blob.read<u32>();
+				const u32 src_offset = blob.read<u32>();
+				gpu::copy(dst, src, dst_offset, src_offset, blob.read<u32>());
+				break;
+			}
+			case Cmd::PUSH_DEBUG_GROUP: gpu::pushDebugGroup(blob.readString()); break;
+			case Cmd::POP_DEBUG_GROUP: gpu::popDebugGroup(); break;
+			case Cmd::BEGIN_PROFILE_BLOCK: beginBlock(*current, blob.readString()); break;
+			case Cmd::END_PROFILE_BLOCK: endBlock(*current); break;
+			default:
+				ASSERT(false);
+				logError("Unexpected command ", (u32)cmd, " in captured frame");
+				break;
+		}
+	}
+
+	// reads queries of a finished frame
+	void collect(InFlight& frame) {
+		if (!frame.pending) return;
+		gpu::waitFrame(frame.gpu_frame);
+		const double freq = (double)gpu::getQueryFrequency();
+		for (const Interval& interval : frame.intervals) {
+			if (interval.end) {
+				const u64 begin = gpu::getQueryResult(interval.begin);
+				const u64 end = gpu::getQueryResult(interval.end);
+				const double ms = (end - begin) * 1000.0 / freq;
+				if (frame.measure) {
+					blocks[interval.block].total += ms;
+					++blocks[interval.block].count;
+					if (interval.block == 0) gpu_times.push(ms);
+				}
+				free_queries.push(interval.end);
+			}
+			free_queries.push(interval.begin);
+		}
+		frame.intervals.clear();
+		frame.stack.clear();
+		frame.pending = false;
+	}
+
+	void run(u32 frames, u32 warmup) {
+		allocHandles();
+		setup(false);
+
+		for (u32 i = 0; i < frames + warmup; ++i) {
+			os::Event e;
+			while (os::getEvent(e)) {}
+
+			const u32 slot = i % FRAMES_IN_FLIGHT;
+			current = in_flight[slot].get();
+			collect(*current);
+
+			drawcalls = 0;
+			const u64 begin = os::Timer::getRawTimestamp();
+			beginBlock(*current, "frame");
+			InputMemoryStream blob(data);
+			blob.setPosition(frame_offset);
+			for (Cmd cmd = blob.read<Cmd>(); cmd != Cmd::END; cmd = blob.read<Cmd>()) {
+				execute(blob, cmd);
+			}
+			endBlock(*current);
+			const u64 end = os::Timer::getRawTimestamp();
+			current->gpu_frame = gpu::present();
+			current->pending = true;
+			current->measure = i >= warmup;
+			if (i >= warmup) cpu_times.push(float((end - begin) * 1000.0 / os::Timer::getFrequency()));
+		}
+		for (u32 i = 0; i < FRAMES_IN_FLIGHT; ++i) collect(*in_flight[i]);
+	}
+
+	template <typename T>
+	static void printStats(const char* name, Array<T>& values, bool last) {
+		if (values.empty()) {
+			printf("\t\"%s\": null%s\n", name, last ? "" : ",");
+			return;
+		}
+		sort(values.begin(), values.end());
+		double sum = 0;
+		for (T v : values) sum += v;
+		printf("\t\"%s\": { \"avg\": %.4f, \"min\": %.4f, \"median\": %.4f, \"max\": %.4f }%s\n"
+			, name
+			, sum / values.size()
+			, (double)values[0]
+			, (double)values[values.size() / 2]
+			, (double)values.back()
+			, last ? "" : ",");
+	}
+
+	void print(const char* path) {
+		printf("{\n\t\"capture\": \"%s\",\n", path);
+		printf("\t\"frames\": %u,\n", (u32)cpu_times.size());
+		printf("\t\"resources\": %u,\n", header.resources_count);
+		printf("\t\"drawcalls\": %u,\n", drawcalls);
+		printf("\t\"bindless_mismatches\": %u,\n", bindless_mismatches);
+		printStats("cpu_ms", cpu_times, false);
+		printStats("gpu_ms", gpu_times, false);
+		printf("\t\"blocks\": [");
+		for (i32 i = 0; i < blocks.size(); ++i) {
+			const Block& b = blocks[i];
+			printf("%s\n\t\t{ \"name\": \"%s\", \"gpu_ms\": %.4f }", i == 0 ? "" : ",", b.name.data, b.count ? b.total / b.count : 0.0);
+		}
+		printf("\n\t]\n}\n");
+		fflush(stdout);
+	}
+
+	IAllocator& allocator;
+	OutputMemoryStream data;
+	DrawStreamCapture::Header header;
+	u64 frame_offset = 0;
+	Array<void*> handles;
+	Array<Bindless> bindless;
+	Array<gpu::QueryHandle> free_queries;
+	Array<Block> blocks;
+	HashMap<RuntimeHash, u32> block_map;
+	Local<InFlight> in_flight[FRAMES_IN_FLIGHT];
+	InFlight* current = nullptr;
+	Array<float> cpu_times;
+	Array<double> gpu_times;
+	u32 drawcalls = 0;
+	u32 bindless_mismatches = 0;
+};
+
+int main(int argc, char* argv[]) {
+	registerLogCallback<logToStderr>();
+	os::init();
+	DefaultAllocator allocator;
+	debug::init(allocator);
+	profiler::init(allocator);
+	jobs::init(os::getCPUsCount(), allocator);
+
+	struct Data {
+		Data(IAllocator& allocator) : replay(allocator), semaphore(0, 1) {}
+		Replay replay;
+		Semaphore semaphore;
+		char path[MAX_PATH] = "";
+		u32 frames = 500;
+		u32 warmup = 50;
+		u32 width = 1920;
+		u32 height = 1080;
+		int ret = 0;
+	} data(allocator);
+
+	char cmd_line[2048];
+	os::getCommandLine(Span(cmd_line));
+	CommandLineParser parser(cmd_line);
+	auto parse_u32 = [&](u32& value){
+		if (!parser.next()) return;
+		char tmp[16];
+		parser.getCurrent(tmp, sizeof(tmp));
+		fromCString(tmp, value);
+	};
+	// skip executable's path
+	parser.next();
+	while (parser.next()) {
+		if (parser.currentEquals("-frames")) parse_u32(data.frames);
+		else if (parser.currentEquals("-warmup")) parse_u32(data.warmup);
+		else if (parser.currentEquals("-width")) parse_u32(data.width);
+		else if (parser.currentEquals("-height")) parse_u32(data.height);
+		else if (!data.path[0]) parser.getCurrent(data.path, sizeof(data.path));
+	}
+	data.frames = maximum(data.frames, 1u);
+
+	// gpu and window must be used from a single thread, the same way the engine does it
+	jobs::run(&data, [](void* ptr) {
+		Data* data = (Data*)ptr;
+		if (!data->path[0]) {
+			logError("Usage: gpu_replay <capture.ldc> [-frames <count>] [-warmup <count>] [-width <w>] [-height <h>]");
+			data->ret = 1;
+		}
+		else if (!data->replay.load(data->path)) {
+			data->ret = 1;
+		}
+		else {
+			// captured frame renders to the main window's swapchain, its size should match the captured one
+			os::WindowHandle win = os::createWindow({ .name = "gpu_replay", .width = data->width, .height = data->height });
+			gpu::preinit(data->replay.allocator, false);
+			if (!gpu::init(win, gpu::InitFlags::NONE)) {
+				logError("Failed to initialize gpu");
+				data->ret = 1;
+			}
+			else {
+				data->replay.setup(true);
+				data->replay.run(data->frames, data->warmup);
+				data->replay.print(data->path);
+				gpu::shutdown();
+			}
+			os::destroyWindow(win);
+		}
+		data->semaphore.signal();
+	}, nullptr, 0);
+	data.semaphore.wait();
+
+	jobs::shutdown();
+	profiler::shutdown();
+	debug::shutdown();
+	return data.ret;
+}
@@ -7,6 +7,7 @@
 #include "core/os.h"
 #include "core/path.h"
 #include "core/profiler.h"
+#include "core/sort.h"
 #include "core/tokenizer.h"
 #include "editor/asset_browser.h"
 #include "editor/asset_compiler.h"
@@ -22,6 +23,7 @@
 #include "gui/gui_module.h"
 #include "gui/sprite.h"
 #include "renderer/draw2d.h"
+#include "renderer/editor/render_plugins.h"
 #include "renderer/gpu/gpu.h"
 #include "renderer/pipeline.h"
 #include "renderer/renderer.h"
@@ -39,6 +41,175 @@ static const ComponentType GUI_TEXT_TYPE = reflection::getComponentType("gui_tex
 static const ComponentType GUI_BUTTON_TYPE = reflection::getComponentType("gui_button");
 static const ComponentType GUI_RENDER_TARGET_TYPE = reflection::getComponentType("gui_render_target");
 
+static Path parseResourcePath(StringView path) {
+	if (startsWith(path, "/")) path.removePrefix(1);
+	return Path(path);
+}
+
+// parsed .spr file
+struct SpriteSource {
+	SpriteSource(IAllocator& allocator) : data(allocator) {}
+
+	bool load(StudioApp& app, const Path& path) {
+		FileSystem& fs = app.getEngine().getFileSystem();
+		if (!fs.getContentSync(path, data)) {
+			logError("Failed to read ", path);
+			return false;
+		}
+
+		StringView atlas_str;
+		const ParseItemDesc descs[] = {
+			{"type", &type},
+			{"top", &top},
+			{"bottom", &bottom},
+			{"left", &left},
+			{"right", &right},
+			{"texture", &texture},
+			{"atlas", &atlas_str}
+		};
+		StringView sv((const char*)data.data(), (u32)data.size());
+		if (!parse(sv, path.c_str(), descs)) return false;
+
+		// same as in Sprite::load
+		image = Path::getDir(texture).empty() ? Path(Path::getDir(path), "/", texture) : Path(texture);
+		atlas = parseResourcePath(atlas_str);
+		return true;
+	}
+
+	OutputMemoryStream data;
+	StringView type;
+	StringView texture;
+	i32 top = 0;
+	i32 bottom = 0;
+	i32 left = 0;
+	i32 right = 0;
+	Path image;
+	Path atlas;
+};
+
+// `atlas_image` is the sprite's image in `atlas`, null if the sprite is not in an atlas
+static bool writeSprite(StudioApp& app, const Path& path, const SpriteSource& src, const TextureAtlas* atlas, const TextureAtlas::Image* atlas_image) {
+	OutputMemoryStream compiled(app.getAllocator());
+	Sprite::Header header;
+	compiled.write(header);
+	compiled.write(src.top);
+	compiled.write(src.bottom);
+	compiled.write(src.left);
+	compiled.write(src.right);
+	compiled.writeString(src.texture);
+	compiled.write(equalIStrings(src.type, "patch9") ? Sprite::PATCH9 : Sprite::SIMPLE);
+	if (atlas) {
+		ASSERT(atlas_image);
+		compiled.writeString(src.atlas);
+		const Vec2 size((float)atlas->width, (float)atlas->height);
+		compiled.write(Vec2((float)atlas_image->x, (float)atlas_image->y) / size);
+		compiled.write(Vec2(float(atlas_image->x + atlas_image->w), float(atlas_image->y + atlas_image->h)) / size);
+		compiled.write(IVec2(atlas_image->w, atlas_image->h));
+	}
+	else {
+		compiled.writeString("");
+	}
+	return app.getAssetCompiler().writeCompiledResource(path, compiled);
+}
+
+// reads settings of `atlas_path` and finds all sprites packed in it, sorted by path, so all compiles see the same order
+static bool collectAtlas(StudioApp& app, const Path& atlas_path, TextureAtlas& atlas, Array<Path>& sprites) {
+	PROFILE_FUNCTION();
+	IAllocator& allocator = app.getAllocator();
+	FileSystem& fs = app.getEngine().getFileSystem();
+	OutputMemoryStream data(allocator);
+	if (!fs.getContentSync(atlas_path, data)) {
+		logError("Failed to read ", atlas_path);
+		return false;
+	}
+	const ParseItemDesc descs[] = {
+		{"padding", &atlas.padding},
+		{"max_size", &atlas.max_size},
+		{"compress", &atlas.compress},
+		{"srgb", &atlas.srgb}
+	};
+	if (!parse(StringView((const char*)data.data(), (u32)data.size()), atlas_path.c_str(), descs)) return false;
+
+	Array<Path> all_sprites(allocator);
+	AssetCompiler& compiler = app.getAssetCompiler();
+	for (const AssetCompiler::ResourceItem& ri : compiler.lockResources()) {
+		if (ri.type == Sprite::TYPE) all_sprites.push(ri.path);
+	}
+	compiler.unlockResources();
+	sort(all_sprites.begin(), all_sprites.end(), [](const Path& a, const Path& b){ return compareString(a, b) < 0; });
+
+	for (const Path& path : all_sprites) {
+		SpriteSource src(allocator);
+		if (!src.load(app, path)) continue;
+		if (src.atlas != atlas_path) continue;
+		sprites.push(path);
+		atlas.images.emplace().path = src.image;
+	}
+	return true;
+}
+
+// packs all sprites with the same `atlas` in one texture, see Sprite::atlas
+// the atlas is the only thing which knows the rects of all its sprites, so it writes all of them after it's packed
+struct SpriteAtlasPlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
+	SpriteAtlasPlugin(StudioApp& app)
+		: m_app(app)
+	{
+		m_app.getAssetCompiler().registerExtension("atl", Texture::TYPE);
+		m_app.getAssetCompiler().resourceCompiled().bind<&SpriteAtlasPlugin::onResourceCompiled>(this);
+	}
+
+	~SpriteAtlasPlugin() {
+		m_app.getAssetCompiler().resourceCompiled().unbind<&SpriteAtlasPlugin::onResourceCompiled>(this);
+	}
+
+	// loaded sprites still have the old rects
+	void onResourceCompiled(Resource& resource, bool success) {
+		if (!success || resource.getType() != Texture::TYPE || !Path::hasExtension(resource.getPath(), "atl")) return;
+
+		ResourceManager* manager = m_app.getEngine().getResourceManager().get(Sprite::TYPE);
+		for (Resource* res : manager->getResourceTable()) {
+			Sprite* sprite = static_cast<Sprite*>(res);
+			if (sprite->isReady() && sprite->atlas == resource.getPath()) manager->reload(*sprite);
+		}
+	}
+
+	bool compile(const Path& src) override {
+		IAllocator& allocator = m_app.getAllocator();
+		TextureAtlas atlas(allocator);
+		Array<Path> sprites(allocator);
+		if (!collectAtlas(m_app, src, atlas, sprites)) return false;
+
+		OutputMemoryStream compiled(allocator);
+		if (!compileTextureAtlas(m_app, atlas, compiled)) return false;
+
+		AssetCompiler& compiler = m_app.getAssetCompiler();
+		for (u32 i = 0; i < (u32)sprites.size(); ++i) {
+			compiler.registerDependency(src, sprites[i]);
+			compiler.registerDependency(src, atlas.images[i].path);
+
+			// adding an image moves other images too
+			SpriteSource sprite(allocator);
+			if (!sprite.load(m_app, sprites[i])) return false;
+			if (!writeSprite(m_app, sprites[i], sprite, &atlas, &atlas.images[i])) return false;
+		}
+		return compiler.writeCompiledResource(src, compiled);
+	}
+
+	bool canCreateResource() const override { return true; }
+	const char* getDefaultExtension() const override { return "atl"; }
+	void createResource(OutputMemoryStream& blob) override {
+		blob << "padding = 2\n";
+		blob << "max_size = 4096\n";
+		blob << "compress = true\n";
+		blob << "srgb = false\n";
+	}
+	void openEditor(const Path& path) override { m_app.getAssetBrowser().openInExternalEditor(path); }
+	const char* getLabel() const override { return "Sprite atlas"; }
+	ResourceType getResourceType() const override { return Texture::TYPE; }
+
+	StudioApp& m_app;
+};
+
 struct SpritePlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 	struct EditorWindow : AssetEditorWindow {
 		EditorWindow(const Path& path, StudioApp& app)
@@ -59,11 +230,12 @@ struct SpritePlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 			out << "bottom = " << sprite.bottom << "\n";
 			out << "left = " << sprite.left << "\n";
 			out << "right = " << sprite.right << "\n";
-			if (sprite.getTexture()) {
-				out << "texture = \"/" << sprite.getTexture()->getPath() << "\"";
+			if (!sprite.getImagePath().isEmpty()) {
+				out << "texture = \"/" << sprite.getImagePath() << "\"";
 			} else {
 				out << "texture = \"\"";
 			}
+			if (!sprite.atlas.isEmpty()) out << "\natlas = \"/" << sprite.atlas << "\"";
 		}
 
 		void save() {
@@ -77,17 +249,18 @@ struct SpritePlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 			Texture* texture = sprite->getTexture();
 
 			if (sprite->type != Sprite::Type::PATCH9 || !texture || !texture->isReady()) return false;
+			const IVec2 image_size = sprite->getSize();
 			ImVec2 size;
-			size.x = minimum(ImGui::GetContentRegionAvail().x, texture->width * 2.0f);
-			size.y = size.x / texture->width * texture->height;
-			float scale = size.x / texture->width;
+			size.x = minimum(ImGui::GetContentRegionAvail().x, image_size.x * 2.0f);
+			size.y = size.x / image_size.x * image_size.y;
+			float scale = size.x / image_size.x;
 			const float SIZE = 5;
 			ImGui::Dummy(size + ImVec2(4 * SIZE, 4 * SIZE));
 
 			ImDrawList* draw = ImGui::GetWindowDrawList();
 			ImVec2 a = ImGui::GetItemRectMin() + ImVec2(2 * SIZE, 2 * SIZE);
 			ImVec2 b = ImGui::GetItemRectMax() - ImVec2(2 * SIZE, 2 * SIZE);
-			draw->AddImage(texture->handle, a, b);
+			draw->AddImage(texture->handle, a, b, ImVec2(sprite->uv0.x, sprite->uv0.y), ImVec2(sprite->uv1.x, sprite->uv1.y));
 
 			auto drawHandle = [&](const char* id, const ImVec2& a, const ImVec2& b, int* value, bool vertical) {
 				ImVec2 rect_pos((a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f);
@@ -161,13 +334,20 @@ struct SpritePlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 
 			if (!m_resource->isReady()) return;
 		
-			Texture* tex = m_resource->getTexture();
-			Path tmp = tex ? tex->getPath() : Path();
+			Path tmp = m_resource->getImagePath();
 			ImGuiEx::Label("Texture");
 			if (m_app.getAssetBrowser().resourceInput("texture", tmp, Texture::TYPE)) {
 				m_resource->setTexture(tmp);
 				m_dirty = true;
 			}
+			ImGuiEx::Label("Atlas");
+			if (m_app.getAssetBrowser().resourceInput("atlas", m_resource->atlas, Texture::TYPE)) {
+				if (!m_resource->atlas.isEmpty() && !Path::hasExtension(m_resource->atlas, "atl")) {
+					logError(m_resource->atlas, " is not a sprite atlas");
+					m_resource->atlas = Path();
+				}
+				m_dirty = true;
+			}
 
 			static const char* TYPES_STR[] = { "9 patch", "Simple" };
 			ImGuiEx::Label("type");
@@ -213,36 +393,24 @@ struct SpritePlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 	}
 
 	bool compile(const Path& src) override {
-		// load
-		FileSystem& fs = m_app.getEngine().getFileSystem();
-		OutputMemoryStream src_data(m_app.getAllocator());
-		if (!fs.getContentSync(src, src_data)) return false;
-
-		// parse
-		StringView type_str, texture_str;
-		i32 top, bottom, left, right;
-		const ParseItemDesc descs[] = {
-			{"type", &type_str},
-			{"top", &top},
-			{"bottom", &bottom},
-			{"left", &left},
-			{"right", &right},
-			{"texture", &texture_str}
-		};
-		StringView sv((const char*)src_data.data(), (u32)src_data.size());
-		if (!parse(sv, src.c_str(), descs)) return false;
-
-		// write compiled
-		OutputMemoryStream compiled(m_app.getAllocator());
-		Sprite::Header header;
-		compiled.write(header);
-		compiled.write(top);
-		compiled.write(bottom);
-		compiled.write(left);
-		compiled.write(right);
-		compiled.writeString(texture_str);
-		compiled.write(equalIStrings(type_str, "patch9") ? Sprite::PATCH9 : Sprite::SIMPLE);
-		return m_app.getAssetCompiler().writeCompiledResource(src, compiled);
+		IAllocator& allocator = m_app.getAllocator();
+		SpriteSource sprite(allocator);
+		if (!sprite.load(m_app, src)) return false;
+		if (sprite.atlas.isEmpty()) return writeSprite(m_app, src, sprite, nullptr, nullptr);
+
+		// the atlas is compiled after this because of the dependency, and it rewrites all its sprites
+		// we still need the right rect now, so we pack the atlas without its pixels
+		m_app.getAssetCompiler().registerDependency(sprite.atlas, src);
+		TextureAtlas atlas(allocator);
+		Array<Path> sprites(allocator);
+		if (!collectAtlas(m_app, sprite.atlas, atlas, sprites)) return false;
+		if (!packTextureAtlas(m_app, atlas)) return false;
+		const i32 idx = sprites.indexOf(src);
+		if (idx < 0) {
+			logError(src, " not found in ", sprite.atlas);
+			return false;
+		}
+		return writeSprite(m_app, src, sprite, &atlas, &atlas.images[idx]);
 	}
 
 	bool canCreateResource() const override { return true; }
@@ -341,8 +509,9 @@ private:
 			editor.setProperty(GUI_RECT_TYPE, "", 0, "Left Relative", Span(&child, 1), 0.f);
 			editor.setProperty(GUI_RECT_TYPE, "", 0, "Right Relative", Span(&child, 1), 0.f);
 
-			float w = (float)texture->width;
-			float h = (float)texture->height;
+			const IVec2 size = sprite->getSize();
+			float w = (float)size.x;
+			float h = (float)size.y;
 			float x = drop_pos.x - rect.x - w / 2;
 			float y = drop_pos.y - rect.y - h / 2;
 
@@ -1132,6 +1301,7 @@ struct StudioAppPlugin : StudioApp::IPlugin
 	StudioAppPlugin(StudioApp& app)
 		: m_app(app)
 		, m_sprite_plugin(app)
+		, m_sprite_atlas_plugin(app)
 		, m_gui_editor(app)
 	{
 	}
@@ -1149,6 +1319,9 @@ struct StudioAppPlugin : StudioApp::IPlugin
 		const char* exts[] = {"spr"};
 		m_app.getAssetBrowser().addPlugin(m_sprite_plugin, Span(exts));
 		m_app.getAssetCompiler().addPlugin(m_sprite_plugin, Span(exts));
+		const char* atlas_exts[] = {"atl"};
+		m_app.getAssetBrowser().addPlugin(m_sprite_atlas_plugin, Span(atlas_exts));
+		m_app.getAssetCompiler().addPlugin(m_sprite_atlas_plugin, Span(atlas_exts));
 	}
 
 	bool showGizmo(WorldView&, ComponentUID) override { return false; }
@@ -1158,12 +1331,15 @@ struct StudioAppPlugin : StudioApp::IPlugin
 
 		m_app.getAssetCompiler().removePlugin(m_sprite_plugin);
 		m_app.getAssetBrowser().removePlugin(m_sprite_plugin);
+		m_app.getAssetCompiler().removePlugin(m_sprite_atlas_plugin);
+		m_app.getAssetBrowser().removePlugin(m_sprite_atlas_plugin);
 	}
 
 
 	StudioApp& m_app;
 	GUIEditor m_gui_editor;
 	SpritePlugin m_sprite_plugin;
+	SpriteAtlasPlugin m_sprite_atlas_plugin;
 };
 
 
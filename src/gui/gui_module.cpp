@@ -5,6 +5,7 @@
 #include "engine/input_system.h"
 #include "core/log.h"
 #include "core/os.h"
+#include "core/profiler.h"
 #include "engine/reflection.h"
 #include "engine/resource_manager.h"
 #include "core/string.h"
@@ -35,7 +36,11 @@ static gpu::TextureHandle EMPTY_RENDER_TARGET = gpu::INVALID_TEXTURE;
 
 struct GUIText
 {
-	GUIText(IAllocator& allocator) : text("", allocator) {}
+	GUIText(IAllocator& allocator)
+		: text("", allocator)
+		, m_layout(allocator)
+		, m_layout_text("", allocator)
+	{}
 	~GUIText() { setFontResource(nullptr); }
 
 
@@ -81,6 +86,19 @@ struct GUIText
 	int getFontSize() const { return m_font_size; }
 	Font* getFont() const { return m_font; }
 
+	// layout is relative to text's origin, so it does not depend on rect's size and is rebuilt only when
+	// the text, the font (incl. its size) or the font atlas change
+	const Draw2D::TextLayout& getLayout(u32 atlas_version) {
+		ASSERT(m_font);
+		if (m_layout_font != m_font || m_layout_atlas_version != atlas_version || m_layout_text != text) {
+			m_layout_font = m_font;
+			m_layout_atlas_version = atlas_version;
+			m_layout_text = text;
+			Draw2D::layoutText(*m_font, text.c_str(), m_layout);
+		}
+		return m_layout;
+	}
+
 
 	String text;
 	TextHAlign horizontal_align = TextHAlign::LEFT;
@@ -91,6 +109,10 @@ private:
 	int m_font_size = 13;
 	Font* m_font = nullptr;
 	FontResource* m_font_resource = nullptr;
+	Draw2D::TextLayout m_layout;
+	Font* m_layout_font = nullptr;
+	u32 m_layout_atlas_version = 0;
+	String m_layout_text;
 };
 
  
@@ -143,7 +165,13 @@ struct GUIRect {
 	GUIImage* image = nullptr;
 	GUIText* text = nullptr;
 	GUIInputField* input_field = nullptr;
+	GUIButton* button = nullptr;
 	gpu::TextureHandle* render_target = nullptr;
+
+	// layout cache, valid while anchors and the parent's rect do not change
+	mutable GUIModule::Rect parent_layout;
+	mutable GUIModule::Rect layout;
+	mutable bool is_layout_dirty = true;
 };
 
 struct GUIModuleImpl final : GUIModule {
@@ -152,15 +180,49 @@ struct GUIModuleImpl final : GUIModule {
 		LATEST
 	};
 
+	// draw list of a canvas, retained between frames and rebuilt only if anything it depends on changed
+	struct CanvasDrawCache {
+		CanvasDrawCache(IAllocator& allocator) : draw(allocator) {}
+
+		Draw2D draw;
+		u32 content_version = 0xffFFffFF;
+		u32 hierarchy_version = 0;
+		u32 atlas_version = 0;
+		Vec2 size = Vec2(-1);
+		Vec2 atlas_size = Vec2(-1);
+		u32 hover_version = 0;
+		EntityPtr focused = INVALID_ENTITY;
+		bool show_text_cursor = false;
+		bool is_main = false;
+		bool children_only = false;
+		// set while building
+		bool has_buttons = false; // depends on hovered buttons
+		bool has_pending_resources = false; // sprites or fonts which are not loaded yet
+	};
+
+	// rect in the hit test index, see updateHitTest
+	struct HitTestEntry {
+		Rect rect;
+		GUIRect* gui_rect;
+		u32 canvas; // index in m_canvas
+		bool is_3d;
+	};
+
+	static constexpr float HIT_TEST_CELL_SIZE = 64;
+	static constexpr i32 HIT_TEST_MAX_CELLS = 64;
+
 	GUIModuleImpl(GUISystem& system, World& world, IAllocator& allocator)
 		: m_allocator(allocator)
 		, m_world(world)
 		, m_system(system)
 		, m_rects(allocator)
-		, m_buttons(allocator)
+		, m_draw_caches(allocator)
+		, m_hit_test_entries(allocator)
+		, m_hit_test_cells(allocator)
+		, m_hit_test_cell_entries(allocator)
+		, m_hovered_buttons(allocator)
 		, m_canvas(allocator)
 		, m_rect_hovered(allocator)
-		, m_draw_2d(allocator)
 		, m_rect_hovered_out(allocator)
 		, m_rect_mouse_down(allocator)
 		, m_unhandled_mouse_button(allocator)
@@ -191,48 +253,47 @@ struct GUIModuleImpl final : GUIModule {
 			, 1);
 	}
 
-	void renderRect(GUIRect& rect, Draw2D& draw, const Rect& parent_rect, bool is_main)
+	void renderRect(GUIRect& rect, CanvasDrawCache& cache, const Rect& parent_rect, bool is_main)
 	{
+		Draw2D& draw = cache.draw;
 		if (!isFlagSet(rect.flags, GUIRect::IS_VALID)) return;
 		if (!isFlagSet(rect.flags, GUIRect::IS_ENABLED)) return;
 
-		float l = parent_rect.x + rect.left.points + parent_rect.w * rect.left.relative;
-		float r = parent_rect.x + rect.right.points + parent_rect.w * rect.right.relative;
-		float t = parent_rect.y + rect.top.points + parent_rect.h * rect.top.relative;
-		float b = parent_rect.y + rect.bottom.points + parent_rect.h * rect.bottom.relative;
+		const Rect& layout = getRectOnCanvas(parent_rect, rect);
+		const float l = layout.x;
+		const float r = layout.x + layout.w;
+		const float t = layout.y;
+		const float b = layout.y + layout.h;
 			 
 		if (rect.flags & GUIRect::IS_CLIP) draw.pushClipRect({ l, t }, { r, b });
 
-		auto button_iter = m_buttons.find(rect.entity);
 		const Color* img_color = rect.image ? (Color*)&rect.image->color : nullptr;
 		const Color* txt_color = rect.text ? (Color*)&rect.text->color : nullptr;
-		if (is_main && button_iter.isValid()) {
-			GUIButton& button = button_iter.value();
-			if (m_cursor_pos.x >= l && m_cursor_pos.x <= r && m_cursor_pos.y >= t && m_cursor_pos.y <= b) {
-				if (button.hovered_cursor != os::CursorType::UNDEFINED && !m_cursor_set) {
-					m_cursor_type = button_iter.value().hovered_cursor;
-					m_cursor_set = true;
-				}
-				img_color = (Color*)&button.hovered_color;
-			}
+		if (is_main && rect.button) {
+			cache.has_buttons = true;
+			if (m_hovered_buttons.indexOf(rect.entity) >= 0) img_color = (Color*)&rect.button->hovered_color;
 		}
 
 		if (rect.image && isFlagSet(rect.image->flags, GUIImage::IS_ENABLED))
 		{
 			const Color color = *img_color;
+			if (rect.image->sprite && !rect.image->sprite->isReady()) cache.has_pending_resources = true;
 			if (rect.image->sprite && rect.image->sprite->getTexture())
 			{
 				Sprite* sprite = rect.image->sprite;
 				Texture* tex = sprite->getTexture();
+				if (!tex->isReady()) cache.has_pending_resources = true;
+				// sprites in the same atlas share the texture, so a whole canvas is usually drawn with a single texture
 				if (sprite->type == Sprite::PATCH9)
 				{
+					const IVec2 size = sprite->getSize();
 					struct Quad {
 						float l, t, r, b;
 					} pos = {
 						l + sprite->left,
 						t + sprite->top,
-						r - tex->width + sprite->right,
-						b - tex->height + sprite->bottom
+						r - size.x + sprite->right,
+						b - size.y + sprite->bottom
 					};
 					if (pos.l > pos.r) {
 						pos.l = pos.r = (pos.l + pos.r) * 0.5f;
@@ -240,28 +301,31 @@ struct GUIModuleImpl final : GUIModule {
 					if (pos.t > pos.b) {
 						pos.t = pos.b = (pos.t + pos.b) * 0.5f;
 					}
-					Quad uvs = {
-						sprite->left / (float)tex->width,
-						sprite->top / (float)tex->height,
-						sprite->right / (float)tex->width,
-						sprite->bottom / (float)tex->height
+					const Vec2 uv_size = sprite->uv1 - sprite->uv0;
+					const float xs[] = { l, pos.l, pos.r, r };
+					const float ys[] = { t, pos.t, pos.b, b };
+					const float us[] = {
+						sprite->uv0.x,
+						sprite->uv0.x + uv_size.x * sprite->left / (float)size.x,
+						sprite->uv0.x + uv_size.x * sprite->right / (float)size.x,
+						sprite->uv1.x
+					};
+					const float vs[] = {
+						sprite->uv0.y,
+						sprite->uv0.y + uv_size.y * sprite->top / (float)size.y,
+						sprite->uv0.y + uv_size.y * sprite->bottom / (float)size.y,
+						sprite->uv1.y
 					};
 
-					draw.addImage(&tex->handle, { l, t }, { pos.l, pos.t }, { 0, 0 }, { uvs.l, uvs.t }, color);
-					draw.addImage(&tex->handle, { pos.l, t }, { pos.r, pos.t }, { uvs.l, 0 }, { uvs.r, uvs.t }, color);
-					draw.addImage(&tex->handle, { pos.r, t }, { r, pos.t }, { uvs.r, 0 }, { 1, uvs.t }, color);
-
-					draw.addImage(&tex->handle, { l, pos.t }, { pos.l, pos.b }, { 0, uvs.t }, { uvs.l, uvs.b }, color);
-					draw.addImage(&tex->handle, { pos.l, pos.t }, { pos.r, pos.b }, { uvs.l, uvs.t }, { uvs.r, uvs.b }, color);
-					draw.addImage(&tex->handle, { pos.r, pos.t }, { r, pos.b }, { uvs.r, uvs.t }, { 1, uvs.b }, color);
-
-					draw.addImage(&tex->handle, { l, pos.b }, { pos.l, b }, { 0, uvs.b }, { uvs.l, 1 }, color);
-					draw.addImage(&tex->handle, { pos.l, pos.b }, { pos.r, b }, { uvs.l, uvs.b }, { uvs.r, 1 }, color);
-					draw.addImage(&tex->handle, { pos.r, pos.b }, { r, b }, { uvs.r, uvs.b }, { 1, 1 }, color);
+					for (u32 j = 0; j < 3; ++j) {
+						for (u32 i = 0; i < 3; ++i) {
+							draw.addImage(&tex->handle, { xs[i], ys[j] }, { xs[i + 1], ys[j + 1] }, { us[i], vs[j] }, { us[i + 1], vs[j + 1] }, color);
+						}
+					}
 				}
 				else
 				{
-					draw.addImage(&tex->handle, { l, t }, { r, b }, {0, 0}, {1, 1}, color);
+					draw.addImage(&tex->handle, { l, t }, { r, b }, sprite->uv0, sprite->uv1, color);
 				}
 			}
 			else
@@ -277,10 +341,11 @@ struct GUIModuleImpl final : GUIModule {
 
 		if (rect.text) {
 			Font* font = rect.text->getFont();
+			if (!font && rect.text->getFontResource()) cache.has_pending_resources = true;
 			if (font) {
-				const char* text_cstr = rect.text->text.c_str();
+				const Draw2D::TextLayout& text_layout = rect.text->getLayout(m_font_manager->getAtlasVersion());
 				float ascender = getAscender(*font);
-				Vec2 text_size = measureTextA(*font, text_cstr, nullptr);
+				Vec2 text_size = text_layout.size;
 				Vec2 text_pos(l, t + ascender);
 
 				switch (rect.text->vertical_align) {
@@ -295,7 +360,7 @@ struct GUIModuleImpl final : GUIModule {
 					case TextHAlign::CENTER: text_pos.x = (r + l - text_size.x) * 0.5f; break;
 				}
 
-				draw.addText(*font, text_pos, *txt_color, text_cstr);
+				draw.addText(text_layout, text_pos, *txt_color);
 				renderTextCursor(rect, draw, text_pos);
 			}
 		}
@@ -303,7 +368,7 @@ struct GUIModuleImpl final : GUIModule {
 		for (EntityRef child : m_world.childrenOf(rect.entity)) {
 			auto iter = m_rects.find(child);
 			if (iter.isValid()) {
-				renderRect(*iter.value(), draw, { l, t, r - l, b - t }, is_main);
+				renderRect(*iter.value(), cache, layout, is_main);
 			}
 		}
 		if (rect.flags & GUIRect::IS_CLIP) draw.popClipRect();
@@ -348,21 +413,68 @@ struct GUIModuleImpl final : GUIModule {
 
 	IVec2 getCursorPosition() override { return m_cursor_pos; }
 
-	void draw3D(Canvas& canvas, Pipeline& pipeline) {
-		m_draw_2d.clear({2, 2});
+	CanvasDrawCache& getDrawCache(EntityRef canvas) {
+		auto iter = m_draw_caches.find(canvas);
+		if (iter.isValid()) return *iter.value();
+		CanvasDrawCache* cache = LUMIX_NEW(m_allocator, CanvasDrawCache)(m_allocator);
+		m_draw_caches.insert(canvas, cache);
+		return *cache;
+	}
+
+	// `children_only` skips the canvas' own rect, 3D canvases are drawn like that
+	const Draw2D& getCanvasDraw(GUIRect& canvas_rect, const Vec2& canvas_size, const Vec2& atlas_size, bool is_main, bool children_only) {
+		CanvasDrawCache& cache = getDrawCache(canvas_rect.entity);
+		const GUIRect* focused = getInput(m_focused_entity);
+		const bool show_text_cursor = focused && focused->input_field->anim <= CURSOR_BLINK_PERIOD * 0.5f;
+		const bool is_valid = cache.content_version == m_content_version
+			&& cache.hierarchy_version == m_world.getHierarchyVersion()
+			&& cache.atlas_version == m_font_manager->getAtlasVersion()
+			&& cache.size == canvas_size
+			&& cache.atlas_size == atlas_size
+			&& cache.is_main == is_main
+			&& cache.children_only == children_only
+			&& cache.focused == m_focused_entity
+			&& cache.show_text_cursor == show_text_cursor
+			&& !cache.has_pending_resources
+			&& !(is_main && cache.has_buttons && cache.hover_version != m_hover_version);
+
+		if (!is_valid) {
+			PROFILE_BLOCK("rebuild gui canvas");
+			cache.content_version = m_content_version;
+			cache.hierarchy_version = m_world.getHierarchyVersion();
+			cache.atlas_version = m_font_manager->getAtlasVersion();
+			cache.size = canvas_size;
+			cache.atlas_size = atlas_size;
+			cache.is_main = is_main;
+			cache.children_only = children_only;
+			cache.focused = m_focused_entity;
+			cache.show_text_cursor = show_text_cursor;
+			cache.hover_version = m_hover_version;
+			cache.has_buttons = false;
+			cache.has_pending_resources = false;
+			cache.draw.clear(atlas_size);
+
+			const Rect rect = { 0, 0, canvas_size.x, canvas_size.y };
+			if (children_only) {
+				for (EntityRef child : m_world.childrenOf(canvas_rect.entity)) {
+					auto iter = m_rects.find(child);
+					if (iter.isValid()) renderRect(*iter.value(), cache, rect, is_main);
+				}
+			}
+			else {
+				renderRect(canvas_rect, cache, rect, is_main);
+			}
+		}
+		return cache.draw;
+	}
 
+	void draw3D(Canvas& canvas, Pipeline& pipeline) {
 		auto canvas_rect_iter = m_rects.find(canvas.entity);
 		if (!canvas_rect_iter.isValid()) return;
 		if (!isFlagSet(canvas_rect_iter.value()->flags, GUIRect::IS_ENABLED)) return;
 
-		for (EntityRef child : m_world.childrenOf(canvas.entity)) {
-			auto iter = m_rects.find(child);
-			if (iter.isValid()) {
-				renderRect(*iter.value(), m_draw_2d, { 0, 0, canvas.virtual_size.x, canvas.virtual_size.y }, false);
-			}
-		}
-
-		pipeline.render3DUI(canvas.entity, m_draw_2d, canvas.virtual_size, canvas.orient_to_camera);
+		const Draw2D& draw = getCanvasDraw(*canvas_rect_iter.value(), canvas.virtual_size, {2, 2}, false, true);
+		pipeline.render3DUI(canvas.entity, draw, canvas.virtual_size, canvas.orient_to_camera);
 	}
 
 	void renderCanvas(Pipeline& pipeline, const struct Vec2& canvas_size, bool is_main, EntityRef canvas_entity) override {
@@ -370,17 +482,13 @@ struct GUIModuleImpl final : GUIModule {
 		Canvas& canvas = m_canvas[canvas_entity];
 		auto iter = m_rects.find(canvas.entity);
 		if (iter.isValid()) {
-			GUIRect* r = iter.value();
-			renderRect(*r, pipeline.getDraw2D(), { 0, 0, canvas_size.x, canvas_size.y }, is_main);
+			Draw2D& dst = pipeline.getDraw2D();
+			dst.append(getCanvasDraw(*iter.value(), canvas_size, dst.getAtlasSize(), is_main, false));
 		}
 	}
 
 	void render(Pipeline& pipeline, const Vec2& canvas_size, bool is_main, bool is_3d_only) override {
 		m_canvas_size = canvas_size;
-		if (is_main) {
-			m_cursor_type = os::CursorType::DEFAULT;
-			m_cursor_set = false;
-		}
 		for (Canvas& canvas : m_canvas) {
 			if (canvas.is_3d) {
 				draw3D(canvas, pipeline);
@@ -388,8 +496,8 @@ struct GUIModuleImpl final : GUIModule {
 			else if (!is_3d_only) {
 				auto iter = m_rects.find(canvas.entity);
 				if (iter.isValid()) {
-					GUIRect* r = iter.value();
-					renderRect(*r, pipeline.getDraw2D(), {0, 0, canvas_size.x, canvas_size.y}, is_main);
+					Draw2D& dst = pipeline.getDraw2D();
+					dst.append(getCanvasDraw(*iter.value(), canvas_size, dst.getAtlasSize(), is_main, false));
 				}
 			}
 		}
@@ -397,24 +505,29 @@ struct GUIModuleImpl final : GUIModule {
 
 	Vec4 getButtonHoveredColorRGBA(EntityRef entity) override
 	{
-		return ABGRu32ToRGBAVec4(m_buttons[entity].hovered_color);
+		return ABGRu32ToRGBAVec4(m_rects[entity]->button->hovered_color);
 	}
 
 
 	void setButtonHoveredColorRGBA(EntityRef entity, const Vec4& color) override
 	{
-		m_buttons[entity].hovered_color = RGBAVec4ToABGRu32(color);
+		++m_content_version;
+		m_rects[entity]->button->hovered_color = RGBAVec4ToABGRu32(color);
 	}
 
 	os::CursorType getButtonHoveredCursor(EntityRef entity) override {
-		return m_buttons[entity].hovered_cursor;
+		return m_rects[entity]->button->hovered_cursor;
 	}
 
 	void setButtonHoveredCursor(EntityRef entity, os::CursorType cursor) override {
-		m_buttons[entity].hovered_cursor = cursor;
+		++m_content_version;
+		m_rects[entity]->button->hovered_cursor = cursor;
 	}
 
-	void enableImage(EntityRef entity, bool enable) override { setFlag(m_rects[entity]->image->flags, GUIImage::IS_ENABLED, enable); }
+	void enableImage(EntityRef entity, bool enable) override {
+		setFlag(m_rects[entity]->image->flags, GUIImage::IS_ENABLED, enable);
+		++m_content_version;
+	}
 	bool isImageEnabled(EntityRef entity) override { return m_rects[entity]->image->flags & GUIImage::IS_ENABLED; }
 
 
@@ -463,6 +576,7 @@ struct GUIModuleImpl final : GUIModule {
 
 	void setImageSprite(EntityRef entity, const Path& path) override
 	{
+		++m_content_version;
 		GUIImage* image = m_rects[entity]->image;
 		if (image->sprite) {
 			image->sprite->decRefCount();
@@ -479,6 +593,7 @@ struct GUIModuleImpl final : GUIModule {
 
 	void setImageColorRGBA(EntityRef entity, const Vec4& color) override
 	{
+		++m_content_version;
 		GUIImage* image = m_rects[entity]->image;
 		image->color = RGBAVec4ToABGRu32(color);
 	}
@@ -498,15 +613,7 @@ struct GUIModuleImpl final : GUIModule {
 		if (!isFlagSet(rect.flags, GUIRect::IS_ENABLED)) return INVALID_ENTITY;
 		if (rect.entity.index == limit.index) return INVALID_ENTITY;
 
-		Rect r;
-		r.x = parent_rect.x + rect.left.points + parent_rect.w * rect.left.relative;
-		r.y = parent_rect.y + rect.top.points + parent_rect.h * rect.top.relative;
-		float right = parent_rect.x + rect.right.points + parent_rect.w * rect.right.relative;
-		float bottom = parent_rect.y + rect.bottom.points + parent_rect.h * rect.bottom.relative;
-
-		r.w = right - r.x;
-		r.h = bottom - r.y;
-
+		const Rect& r = getRectOnCanvas(parent_rect, rect);
 		bool intersect = pos.x >= r.x && pos.y >= r.y && pos.x <= r.x + r.w && pos.y <= r.y + r.h;
 
 		for (EntityRef child : m_world.childrenOf(rect.entity))
@@ -554,14 +661,25 @@ struct GUIModuleImpl final : GUIModule {
 	}
 
 
-	static Rect getRectOnCanvas(const Rect& parent_rect, const GUIRect& rect)
+	static bool equal(const Rect& a, const Rect& b) {
+		return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+	}
+
+	// recomputed only if anchors or parent's rect changed, so a change in canvas size, a parent or reparenting
+	// propagates down the tree, while static rects just return the cached value
+	static const Rect& getRectOnCanvas(const Rect& parent_rect, const GUIRect& rect)
 	{
+		if (!rect.is_layout_dirty && equal(parent_rect, rect.parent_layout)) return rect.layout;
+
 		float l = parent_rect.x + parent_rect.w * rect.left.relative + rect.left.points;
 		float r = parent_rect.x + parent_rect.w * rect.right.relative + rect.right.points;
 		float t = parent_rect.y + parent_rect.h * rect.top.relative + rect.top.points;
 		float b = parent_rect.y + parent_rect.h * rect.bottom.relative + rect.bottom.points;
 
-		return { l, t, r - l, b - t };
+		rect.parent_layout = parent_rect;
+		rect.layout = { l, t, r - l, b - t };
+		rect.is_layout_dirty = false;
+		return rect.layout;
 	}
 
 
@@ -579,41 +697,49 @@ struct GUIModuleImpl final : GUIModule {
 
 		EntityPtr parent = m_world.getParent((EntityRef)entity);
 		Rect parent_rect = getRectEx(parent, canvas_size);
-		GUIRect* gui = m_rects[(EntityRef)entity];
-		float l = parent_rect.x + parent_rect.w * gui->left.relative + gui->left.points;
-		float r = parent_rect.x + parent_rect.w * gui->right.relative + gui->right.points;
-		float t = parent_rect.y + parent_rect.h * gui->top.relative + gui->top.points;
-		float b = parent_rect.y + parent_rect.h * gui->bottom.relative + gui->bottom.points;
+		return getRectOnCanvas(parent_rect, *iter.value());
+	}
 
-		return { l, t, r - l, b - t };
+	void setAnchor(EntityRef entity, GUIRect::Anchor GUIRect::*anchor, float GUIRect::Anchor::*member, float value) {
+		GUIRect* rect = m_rects[entity];
+		(rect->*anchor).*member = value;
+		rect->is_layout_dirty = true;
+		++m_content_version;
 	}
 
-	void setRectClip(EntityRef entity, bool enable) override { setFlag(m_rects[entity]->flags, GUIRect::IS_CLIP, enable); }
+	void setRectClip(EntityRef entity, bool enable) override {
+		setFlag(m_rects[entity]->flags, GUIRect::IS_CLIP, enable);
+		++m_content_version;
+	}
 	bool getRectClip(EntityRef entity) override { return m_rects[entity]->flags & GUIRect::IS_CLIP; }
-	void enableRect(EntityRef entity, bool enable) override { return setFlag(m_rects[entity]->flags, GUIRect::IS_ENABLED, enable); }
+	void enableRect(EntityRef entity, bool enable) override {
+		setFlag(m_rects[entity]->flags, GUIRect::IS_ENABLED, enable);
+		++m_content_version;
+	}
 	bool isRectEnabled(EntityRef entity) override { return m_rects[entity]->flags & GUIRect::IS_ENABLED; }
 	float getRectLeftPoints(EntityRef entity) override { return m_rects[entity]->left.points; }
-	void setRectLeftPoints(EntityRef entity, float value) override { m_rects[entity]->left.points = value; }
+	void setRectLeftPoints(EntityRef entity, float value) override { setAnchor(entity, &GUIRect::left, &GUIRect::Anchor::points, value); }
 	float getRectLeftRelative(EntityRef entity) override { return m_rects[entity]->left.relative; }
-	void setRectLeftRelative(EntityRef entity, float value) override { m_rects[entity]->left.relative = value; }
+	void setRectLeftRelative(EntityRef entity, float value) override { setAnchor(entity, &GUIRect::left, &GUIRect::Anchor::relative, value); }
 
 	float getRectRightPoints(EntityRef entity) override { return m_rects[entity]->right.points; }
-	void setRectRightPoints(EntityRef entity, float value) override { m_rects[entity]->right.points = value; }
+	void setRectRightPoints(EntityRef entity, float value) override { setAnchor(entity, &GUIRect::right, &GUIRect::Anchor::points, value); }
 	float getRectRightRelative(EntityRef entity) override { return m_rects[entity]->right.relative; }
-	void setRectRightRelative(EntityRef entity, float value) override { m_rects[entity]->right.relative = value; }
+	void setRectRightRelative(EntityRef entity, float value) override { setAnchor(entity, &GUIRect::right, &GUIRect::Anchor::relative, value); }
 
 	float getRectTopPoints(EntityRef entity) override { return m_rects[entity]->top.points; }
-	void setRectTopPoints(EntityRef entity, float value) override { m_rects[entity]->top.points = value; }
+	void setRectTopPoints(EntityRef entity, float value) override { setAnchor(entity, &GUIRect::top, &GUIRect::Anchor::points, value); }
 	float getRectTopRelative(EntityRef entity) override { return m_rects[entity]->top.relative; }
-	void setRectTopRelative(EntityRef entity, float value) override { m_rects[entity]->top.relative = value; }
+	void setRectTopRelative(EntityRef entity, float value) override { setAnchor(entity, &GUIRect::top, &GUIRect::Anchor::relative, value); }
 
 	float getRectBottomPoints(EntityRef entity) override { return m_rects[entity]->bottom.points; }
-	void setRectBottomPoints(EntityRef entity, float value) override { m_rects[entity]->bottom.points = value; }
+	void setRectBottomPoints(EntityRef entity, float value) override { setAnchor(entity, &GUIRect::bottom, &GUIRect::Anchor::points, value); }
 	float getRectBottomRelative(EntityRef entity) override { return m_rects[entity]->bottom.relative; }
-	void setRectBottomRelative(EntityRef entity, float value) override { m_rects[entity]->bottom.relative = value; }
+	void setRectBottomRelative(EntityRef entity, float value) override { setAnchor(entity, &GUIRect::bottom, &GUIRect::Anchor::relative, value); }
 
 	void setTextFontSize(EntityRef entity, int value) override
 	{
+		++m_content_version;
 		GUIText* gui_text = m_rects[entity]->text;
 		gui_text->setFontSize(value);
 	}
@@ -635,6 +761,7 @@ struct GUIModuleImpl final : GUIModule {
 
 	void setTextColorRGBA(EntityRef entity, const Vec4& color) override
 	{
+		++m_content_version;
 		GUIText* gui_text = m_rects[entity]->text;
 		gui_text->color = RGBAVec4ToABGRu32(color);
 	}
@@ -649,6 +776,7 @@ struct GUIModuleImpl final : GUIModule {
 
 	void setTextFontPath(EntityRef entity, const Path& path) override
 	{
+		++m_content_version;
 		GUIText* gui_text = m_rects[entity]->text;
 		FontResource* res = path.isEmpty() ? nullptr : m_font_manager->getOwner().load<FontResource>(path);
 		gui_text->setFontResource(res);
@@ -667,12 +795,14 @@ struct GUIModuleImpl final : GUIModule {
 	}
 
 	void setTextVAlign(EntityRef entity, TextVAlign align) override {
+		++m_content_version;
 		GUIText* gui_text = m_rects[entity]->text;
 		gui_text->vertical_align = align;
 	}
 
 	void setTextHAlign(EntityRef entity, TextHAlign value) override
 	{
+		++m_content_version;
 		GUIText* gui_text = m_rects[entity]->text;
 		gui_text->horizontal_align = value;
 	}
@@ -680,6 +810,7 @@ struct GUIModuleImpl final : GUIModule {
 
 	void setText(EntityRef entity, const char* value) override
 	{
+		++m_content_version;
 		GUIText* gui_text = m_rects[entity]->text;
 		gui_text->text = value;
 	}
@@ -693,9 +824,13 @@ struct GUIModuleImpl final : GUIModule {
 
 
 	~GUIModuleImpl() {
+		for (CanvasDrawCache* cache : m_draw_caches) {
+			LUMIX_DELETE(m_allocator, cache);
+		}
 		for (GUIRect* rect : m_rects) {
 			if (rect->flags & GUIRect::IS_VALID) {
 				LUMIX_DELETE(m_allocator, rect->input_field);
+				LUMIX_DELETE(m_allocator, rect->button);
 				LUMIX_DELETE(m_allocator, rect->image);
 				LUMIX_DELETE(m_allocator, rect->text);
 				LUMIX_DELETE(m_allocator, rect);
@@ -706,37 +841,147 @@ struct GUIModuleImpl final : GUIModule {
 
 	void hoverOut(const GUIRect& rect)
 	{
-		auto iter = m_buttons.find(rect.entity);
-		if (!iter.isValid()) return;
+		if (!rect.button) return;
 		m_rect_hovered_out.invoke(rect.entity);
 	}
 
 
 	void hover(const GUIRect& rect)
 	{
-		auto iter = m_buttons.find(rect.entity);
-		if (!iter.isValid()) return;
+		if (!rect.button) return;
 		m_rect_hovered.invoke(rect.entity);
 	}
 
 
-	void handleMouseAxisEvent(const Rect& parent_rect, GUIRect& rect, const Vec2& mouse_pos, const Vec2& prev_mouse_pos)
-	{
+	// flat list of enabled rects in canvases' hierarchy, parents before children, with a grid over it
+	// so input handling does not depend on how many rects there are
+	void updateHitTest() {
+		const bool is_valid = m_hit_test_content_version == m_content_version
+			&& m_hit_test_hierarchy_version == m_world.getHierarchyVersion()
+			&& m_hit_test_canvas_size == m_canvas_size;
+		if (is_valid) return;
+
+		PROFILE_FUNCTION();
+		m_hit_test_content_version = m_content_version;
+		m_hit_test_hierarchy_version = m_world.getHierarchyVersion();
+		m_hit_test_canvas_size = m_canvas_size;
+
+		m_hit_test_entries.clear();
+		u32 canvas_idx = 0;
+		for (const Canvas& canvas : m_canvas) {
+			auto iter = m_rects.find(canvas.entity);
+			if (iter.isValid()) collectHitTest(*iter.value(), { 0, 0, m_canvas_size.x, m_canvas_size.y }, canvas_idx, canvas.is_3d);
+			++canvas_idx;
+		}
+
+		m_hit_test_grid_size.x = clamp(i32(m_canvas_size.x / HIT_TEST_CELL_SIZE) + 1, 1, HIT_TEST_MAX_CELLS);
+		m_hit_test_grid_size.y = clamp(i32(m_canvas_size.y / HIT_TEST_CELL_SIZE) + 1, 1, HIT_TEST_MAX_CELLS);
+		const u32 cells_count = m_hit_test_grid_size.x * m_hit_test_grid_size.y;
+
+		// cells are ranges in m_hit_test_cell_entries, entries in a cell keep their order
+		m_hit_test_cells.resize(cells_count + 1);
+		memset(m_hit_test_cells.begin(), 0, m_hit_test_cells.byte_size());
+		for (const HitTestEntry& entry : m_hit_test_entries) {
+			const IVec2 from = getHitTestCell({ entry.rect.x, entry.rect.y });
+			const IVec2 to = getHitTestCell({ entry.rect.x + entry.rect.w, entry.rect.y + entry.rect.h });
+			for (i32 j = from.y; j <= to.y; ++j) {
+				for (i32 i = from.x; i <= to.x; ++i) ++m_hit_test_cells[j * m_hit_test_grid_size.x + i + 1];
+			}
+		}
+		for (u32 i = 0; i < cells_count; ++i) m_hit_test_cells[i + 1] += m_hit_test_cells[i];
+
+		m_hit_test_cell_entries.resize(m_hit_test_cells[cells_count]);
+		for (u32 entry_idx = 0; entry_idx < (u32)m_hit_test_entries.size(); ++entry_idx) {
+			const HitTestEntry& entry = m_hit_test_entries[entry_idx];
+			const IVec2 from = getHitTestCell({ entry.rect.x, entry.rect.y });
+			const IVec2 to = getHitTestCell({ entry.rect.x + entry.rect.w, entry.rect.y + entry.rect.h });
+			for (i32 j = from.y; j <= to.y; ++j) {
+				for (i32 i = from.x; i <= to.x; ++i) {
+					u32& offset = m_hit_test_cells[j * m_hit_test_grid_size.x + i];
+					m_hit_test_cell_entries[offset] = entry_idx;
+					++offset;
+				}
+			}
+		}
+		// offsets were moved to the end of cells by the fill
+		for (u32 i = cells_count; i > 0; --i) m_hit_test_cells[i] = m_hit_test_cells[i - 1];
+		m_hit_test_cells[0] = 0;
+	}
+
+	void collectHitTest(GUIRect& rect, const Rect& parent_rect, u32 canvas, bool is_3d) {
+		if (!isFlagSet(rect.flags, GUIRect::IS_VALID)) return;
 		if (!isFlagSet(rect.flags, GUIRect::IS_ENABLED)) return;
 
 		const Rect& r = getRectOnCanvas(parent_rect, rect);
+		m_hit_test_entries.push({ r, &rect, canvas, is_3d });
 
-		const bool is = contains(r, mouse_pos);
-		const bool was = contains(r, prev_mouse_pos);
-		if (is != was && m_buttons.find(rect.entity).isValid()) {
-			is  ? hover(rect) : hoverOut(rect);
+		for (EntityRef child : m_world.childrenOf(rect.entity)) {
+			auto iter = m_rects.find(child);
+			if (iter.isValid()) collectHitTest(*iter.value(), r, canvas, is_3d);
 		}
+	}
 
-		for (EntityRef e : m_world.childrenOf(rect.entity)) {
-			auto iter = m_rects.find(e);
-			if (!iter.isValid()) continue;
-			handleMouseAxisEvent(r, *iter.value(), mouse_pos, prev_mouse_pos);
+	// points outside of canvas are clamped to border cells, rects outside are in border cells too
+	IVec2 getHitTestCell(const Vec2& pos) const {
+		return {
+			clamp(i32(pos.x / HIT_TEST_CELL_SIZE), 0, m_hit_test_grid_size.x - 1),
+			clamp(i32(pos.y / HIT_TEST_CELL_SIZE), 0, m_hit_test_grid_size.y - 1)
+		};
+	}
+
+	// calls `f` for all entries containing `pos`, in hierarchy order
+	template <typename F>
+	void forEachHit(const Vec2& pos, F&& f) {
+		const IVec2 cell = getHitTestCell(pos);
+		const u32 cell_idx = cell.y * m_hit_test_grid_size.x + cell.x;
+		for (u32 i = m_hit_test_cells[cell_idx], end = m_hit_test_cells[cell_idx + 1]; i < end; ++i) {
+			HitTestEntry& entry = m_hit_test_entries[m_hit_test_cell_entries[i]];
+			if (contains(entry.rect, pos)) f(entry);
+		}
+	}
+
+	void handleMouseAxisEvent(const Vec2& mouse_pos, const Vec2& prev_mouse_pos) {
+		updateHitTest();
+		forEachHit(prev_mouse_pos, [&](const HitTestEntry& entry){
+			if (entry.gui_rect->button && !contains(entry.rect, mouse_pos)) hoverOut(*entry.gui_rect);
+		});
+		forEachHit(mouse_pos, [&](const HitTestEntry& entry){
+			if (entry.gui_rect->button && !contains(entry.rect, prev_mouse_pos)) hover(*entry.gui_rect);
+		});
+	}
+
+	// buttons under cursor in 2D canvases, they are drawn with hovered color and set cursor
+	void updateHover() {
+		updateHitTest();
+		m_cursor_type = os::CursorType::DEFAULT;
+		u32 hovered_count = 0;
+		bool changed = false;
+		bool cursor_set = false;
+		forEachHit(Vec2((float)m_cursor_pos.x, (float)m_cursor_pos.y), [&](const HitTestEntry& entry){
+			if (!entry.gui_rect->button || entry.is_3d) return;
+
+			const EntityRef e = entry.gui_rect->entity;
+			if (hovered_count < (u32)m_hovered_buttons.size()) {
+				changed = changed || m_hovered_buttons[hovered_count] != e;
+				m_hovered_buttons[hovered_count] = e;
+			}
+			else {
+				changed = true;
+				m_hovered_buttons.push(e);
+			}
+			++hovered_count;
+
+			const os::CursorType cursor = entry.gui_rect->button->hovered_cursor;
+			if (cursor != os::CursorType::UNDEFINED && !cursor_set) {
+				m_cursor_type = cursor;
+				cursor_set = true;
+			}
+		});
+		if (hovered_count != (u32)m_hovered_buttons.size()) {
+			changed = true;
+			m_hovered_buttons.resize(hovered_count);
 		}
+		if (changed) ++m_hover_version;
 	}
 
 	static bool contains(const Rect& rect, const Vec2& pos)
@@ -755,58 +1000,54 @@ struct GUIModuleImpl final : GUIModule {
 	}
 
 
-	bool handleMouseButtonEvent(const Rect& parent_rect, const GUIRect& rect, const InputSystem::Event& event)
+	bool handleMouseButtonEvent(const InputSystem::Event& event)
 	{
-		if (!isFlagSet(rect.flags, GUIRect::IS_ENABLED)) return false;
+		updateHitTest();
 		const bool is_up = !event.data.button.down;
+		const Vec2 pos(event.data.button.x, event.data.button.y);
 
-		Vec2 pos(event.data.button.x, event.data.button.y);
-		const Rect& r = getRectOnCanvas(parent_rect, rect);
+		// canvases after the first one which handled the event are skipped
 		bool handled = false;
-		
-		if (contains(r, pos)) {
+		u32 handled_canvas = 0;
+		forEachHit(pos, [&](const HitTestEntry& entry){
+			if (handled && entry.canvas != handled_canvas) return;
+
+			GUIRect& rect = *entry.gui_rect;
 			if (!is_up) m_rect_mouse_down.invoke(rect.entity, event.data.button.x, event.data.button.y);
-			if (contains(r, m_mouse_down_pos)) {
-				auto button_iter = m_buttons.find(rect.entity);
-				if (button_iter.isValid())
-				{
-					handled = true;
-					if (is_up && isButtonDown(rect.entity))
-					{
-						m_focused_entity = INVALID_ENTITY;
-						m_button_clicked.invoke(rect.entity);
+			if (!contains(entry.rect, m_mouse_down_pos)) return;
+
+			bool handled_here = false;
+			if (rect.button) {
+				handled_here = true;
+				if (is_up && isButtonDown(rect.entity)) {
+					m_focused_entity = INVALID_ENTITY;
+					m_button_clicked.invoke(rect.entity);
+				}
+				if (!is_up) {
+					if (m_buttons_down_count < lengthOf(m_buttons_down)) {
+						m_buttons_down[m_buttons_down_count] = rect.entity;
+						++m_buttons_down_count;
 					}
-					if (!is_up)
-					{
-						if (m_buttons_down_count < lengthOf(m_buttons_down))
-						{
-							m_buttons_down[m_buttons_down_count] = rect.entity;
-							++m_buttons_down_count;
-						}
-						else
-						{
-							logError("Too many buttons pressed at once");
-						}
+					else {
+						logError("Too many buttons pressed at once");
 					}
 				}
-			
-				if (rect.input_field && is_up) {
-					handled = true;
-					m_focused_entity = rect.entity;
-					if (rect.text)
-					{
-						rect.input_field->cursor = rect.text->text.length();
-						rect.input_field->anim = 0;
-					}
+			}
+
+			if (rect.input_field && is_up) {
+				handled_here = true;
+				m_focused_entity = rect.entity;
+				if (rect.text) {
+					rect.input_field->cursor = rect.text->text.length();
+					rect.input_field->anim = 0;
 				}
 			}
-		}
 
-		for (EntityRef e : m_world.childrenOf(rect.entity)) {
-			auto iter = m_rects.find((EntityRef)e);
-			if (!iter.isValid()) continue;
-			handled = handleMouseButtonEvent(r, *iter.value(), event) || handled;
-		}
+			if (handled_here) {
+				handled = true;
+				handled_canvas = entry.canvas;
+			}
+		});
 		return handled;
 	}
 
@@ -835,6 +1076,7 @@ struct GUIModuleImpl final : GUIModule {
 		memcpy(tmp, &event.data.text.utf8, sizeof(event.data.text.utf8));
 		rect->text->text.insert(rect->input_field->cursor, tmp);
 		++rect->input_field->cursor;
+		++m_content_version;
 	}
 
 
@@ -845,6 +1087,7 @@ struct GUIModuleImpl final : GUIModule {
 		if (!event.data.button.down) return;
 
 		rect->input_field->anim = 0;
+		++m_content_version;
 
 		switch ((os::Keycode)event.data.button.key_id)
 		{
@@ -888,13 +1131,7 @@ struct GUIModuleImpl final : GUIModule {
 					if (event.device->type == InputSystem::Device::MOUSE) {
 						Vec2 pos(event.data.axis.x_abs, event.data.axis.y_abs);
 						m_cursor_pos = IVec2((i32)pos.x, (i32)pos.y);
-						for (const Canvas& canvas : m_canvas) {
-							auto iter = m_rects.find(canvas.entity);
-							if (iter.isValid()) {
-								GUIRect* r = iter.value();
-								handleMouseAxisEvent({0, 0,  m_canvas_size.x, m_canvas_size.y }, *r, pos, old_pos);
-							}
-						}
+						handleMouseAxisEvent(pos, old_pos);
 						old_pos = pos;
 					}
 					break;
@@ -905,15 +1142,7 @@ struct GUIModuleImpl final : GUIModule {
 							m_mouse_down_pos.x = event.data.button.x;
 							m_mouse_down_pos.y = event.data.button.y;
 						}
-						bool handled = false;
-						for (const Canvas& canvas : m_canvas) {
-							auto iter = m_rects.find(canvas.entity);
-							if (iter.isValid()) {
-								GUIRect* r = iter.value();
-								handled = handleMouseButtonEvent({ 0, 0, m_canvas_size.x, m_canvas_size.y }, *r, event);
-								if (handled) break;
-							}
-						}
+						const bool handled = handleMouseButtonEvent(event);
 						if (!handled) {
 							m_unhandled_mouse_button.invoke(event.data.button.down, (i32)event.data.button.x, (i32)event.data.button.y);
 						}
@@ -944,12 +1173,14 @@ struct GUIModuleImpl final : GUIModule {
 	void update(float time_delta) override
 	{
 		handleInput();
+		updateHover();
 		m_system.setCursor(m_cursor_type);
 		blinkCursor(time_delta);
 	}
 
 
 	void createRect(EntityRef entity) override {
+		++m_content_version;
 		auto iter = m_rects.find(entity);
 		GUIRect* rect;
 		if (iter.isValid()) {
@@ -963,6 +1194,7 @@ struct GUIModuleImpl final : GUIModule {
 		rect->right = {0, 1};
 		rect->bottom = {0, 1};
 		rect->left = {0, 0};
+		rect->is_layout_dirty = true;
 		rect->entity = entity;
 		rect->flags |= GUIRect::IS_VALID | GUIRect::IS_ENABLED;
 		m_world.onComponentCreated(entity, GUI_RECT_TYPE, this);
@@ -970,6 +1202,7 @@ struct GUIModuleImpl final : GUIModule {
 
 
 	void createText(EntityRef entity) override {
+		++m_content_version;
 		auto iter = m_rects.find(entity);
 		if (!iter.isValid())
 		{
@@ -984,6 +1217,7 @@ struct GUIModuleImpl final : GUIModule {
 
 
 	void createRenderTarget(EntityRef entity) override {
+		++m_content_version;
 		auto iter = m_rects.find(entity);
 		if (!iter.isValid())
 		{
@@ -996,28 +1230,31 @@ struct GUIModuleImpl final : GUIModule {
 
 
 	void createButton(EntityRef entity) override {
+		++m_content_version;
 		auto iter = m_rects.find(entity);
 		if (!iter.isValid())
 		{
 			createRect(entity);
 			iter = m_rects.find(entity);
 		}
-		GUIImage* image = iter.value()->image;
-		GUIButton& button = m_buttons.insert(entity);
-		if (image) {
-			button.hovered_color = image->color;
+		GUIRect& rect = *iter.value();
+		rect.button = LUMIX_NEW(m_allocator, GUIButton);
+		if (rect.image) {
+			rect.button->hovered_color = rect.image->color;
 		}
 		m_world.onComponentCreated(entity, GUI_BUTTON_TYPE, this);
 	}
 	
 
 	void createCanvas(EntityRef entity) override {
+		++m_content_version;
 		Canvas& canvas = m_canvas.insert(entity);
 		canvas.entity = entity;
 		m_world.onComponentCreated(entity, GUI_CANVAS_TYPE, this);
 	}
 
 	void createInputField(EntityRef entity) override {
+		++m_content_version;
 		auto iter = m_rects.find(entity);
 		if (!iter.isValid())
 		{
@@ -1032,6 +1269,7 @@ struct GUIModuleImpl final : GUIModule {
 
 
 	void createImage(EntityRef entity) override {
+		++m_content_version;
 		auto iter = m_rects.find(entity);
 		if (!iter.isValid())
 		{
@@ -1047,9 +1285,10 @@ struct GUIModuleImpl final : GUIModule {
 
 
 	void destroyRect(EntityRef entity) override {
+		++m_content_version;
 		GUIRect* rect = m_rects[entity];
 		rect->flags &= ~GUIRect::IS_VALID;
-		if (!rect->image && !rect->text && !rect->input_field && !rect->render_target)
+		if (!rect->image && !rect->text && !rect->input_field && !rect->button && !rect->render_target)
 		{
 			LUMIX_DELETE(m_allocator, rect);
 			m_rects.erase(entity);
@@ -1059,16 +1298,27 @@ struct GUIModuleImpl final : GUIModule {
 
 
 	void destroyButton(EntityRef entity) override {
-		m_buttons.erase(entity);
+		++m_content_version;
+		GUIRect* rect = m_rects[entity];
+		LUMIX_DELETE(m_allocator, rect->button);
+		rect->button = nullptr;
 		m_world.onComponentDestroyed(entity, GUI_BUTTON_TYPE, this);
+		checkGarbage(*rect);
 	}
 
 	void destroyCanvas(EntityRef entity) override {
+		++m_content_version;
 		m_canvas.erase(entity);
+		auto iter = m_draw_caches.find(entity);
+		if (iter.isValid()) {
+			LUMIX_DELETE(m_allocator, iter.value());
+			m_draw_caches.erase(iter);
+		}
 		m_world.onComponentDestroyed(entity, GUI_CANVAS_TYPE, this);
 	}
 
 	void destroyRenderTarget(EntityRef entity) override {
+		++m_content_version;
 		GUIRect* rect = m_rects[entity];
 		rect->render_target = nullptr;
 		m_world.onComponentDestroyed(entity, GUI_RENDER_TARGET_TYPE, this);
@@ -1077,6 +1327,7 @@ struct GUIModuleImpl final : GUIModule {
 
 
 	void destroyInputField(EntityRef entity) override {
+		++m_content_version;
 		GUIRect* rect = m_rects[entity];
 		LUMIX_DELETE(m_allocator, rect->input_field);
 		rect->input_field = nullptr;
@@ -1089,6 +1340,7 @@ struct GUIModuleImpl final : GUIModule {
 		if (rect.image) return;
 		if (rect.text) return;
 		if (rect.input_field) return;
+		if (rect.button) return;
 		if (rect.render_target) return;
 		if (rect.flags & GUIRect::IS_VALID) return;
 			
@@ -1099,6 +1351,7 @@ struct GUIModuleImpl final : GUIModule {
 
 
 	void destroyImage(EntityRef entity) override {
+		++m_content_version;
 		GUIRect* rect = m_rects[entity];
 		LUMIX_DELETE(m_allocator, rect->image);
 		rect->image = nullptr;
@@ -1108,6 +1361,7 @@ struct GUIModuleImpl final : GUIModule {
 
 
 	void destroyText(EntityRef entity) override {
+		++m_content_version;
 		GUIRect* rect = m_rects[entity];
 		LUMIX_DELETE(m_allocator, rect->text);
 		rect->text = nullptr;
@@ -1150,14 +1404,18 @@ struct GUIModuleImpl final : GUIModule {
 			}
 		}
 
-		serializer.write(m_buttons.size());
+		u32 buttons_count = 0;
+		for (GUIRect* rect : m_rects) {
+			if (rect->button) ++buttons_count;
+		}
+		serializer.write(buttons_count);
 		
-		for (auto iter : m_buttons.iterated())
+		for (GUIRect* rect : m_rects)
 		{
-			serializer.write(iter.key());
-			const GUIButton& button = iter.value();
-			serializer.write(button.hovered_color);
-			serializer.write(button.hovered_cursor);
+			if (!rect->button) continue;
+			serializer.write(rect->entity);
+			serializer.write(rect->button->hovered_color);
+			serializer.write(rect->button->hovered_cursor);
 		}
 
 		serializer.write(m_canvas.size());
@@ -1173,6 +1431,7 @@ struct GUIModuleImpl final : GUIModule {
 
 	void deserialize(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) override
 	{
+		++m_content_version;
 		u32 count = serializer.read<u32>();
 		for (u32 i = 0; i < count; ++i)
 		{
@@ -1189,6 +1448,7 @@ struct GUIModuleImpl final : GUIModule {
 			GUIRect* rect = iter.value();
 			rect->entity = entity;
 			rect->flags = flags;
+			rect->is_layout_dirty = true;
 
 			serializer.read(rect->top);
 			serializer.read(rect->right);
@@ -1247,9 +1507,10 @@ struct GUIModuleImpl final : GUIModule {
 			EntityRef e;
 			serializer.read(e);
 			e = entity_map.get(e);
-			GUIButton& button = m_buttons.insert(e);
-			serializer.read(button.hovered_color);
-			serializer.read(button.hovered_cursor);
+			GUIRect* rect = m_rects[e];
+			rect->button = LUMIX_NEW(m_allocator, GUIButton);
+			serializer.read(rect->button->hovered_color);
+			serializer.read(rect->button->hovered_cursor);
 			m_world.onComponentCreated(e, GUI_BUTTON_TYPE, this);
 		}
 		
@@ -1272,6 +1533,7 @@ struct GUIModuleImpl final : GUIModule {
 	
 	void setRenderTarget(EntityRef entity, gpu::TextureHandle* texture_handle) override
 	{
+		++m_content_version;
 		m_rects[entity]->render_target = texture_handle;
 	}
 
@@ -1290,14 +1552,24 @@ struct GUIModuleImpl final : GUIModule {
 	GUISystem& m_system;
 	
 	HashMap<EntityRef, GUIRect*> m_rects;
-	HashMap<EntityRef, GUIButton> m_buttons;
+	HashMap<EntityRef, CanvasDrawCache*> m_draw_caches;
+	// changed by anything which can change how rects look, invalidates m_draw_caches
+	u32 m_content_version = 0;
 	HashMap<EntityRef, Canvas> m_canvas;
 	EntityRef m_buttons_down[16];
 	u32 m_buttons_down_count;
 	EntityPtr m_focused_entity = INVALID_ENTITY;
 	IVec2 m_cursor_pos = {-10000, -10000};
 	os::CursorType m_cursor_type = os::CursorType::DEFAULT;
-	bool m_cursor_set;
+	Array<HitTestEntry> m_hit_test_entries;
+	Array<u32> m_hit_test_cells; // offsets into m_hit_test_cell_entries, one extra at the end
+	Array<u32> m_hit_test_cell_entries; // indices into m_hit_test_entries
+	IVec2 m_hit_test_grid_size = IVec2(1);
+	Vec2 m_hit_test_canvas_size = Vec2(-1);
+	u32 m_hit_test_content_version = 0xffFFffFF;
+	u32 m_hit_test_hierarchy_version = 0;
+	Array<EntityRef> m_hovered_buttons;
+	u32 m_hover_version = 0;
 	FontManager* m_font_manager = nullptr;
 	Vec2 m_canvas_size;
 	Vec2 m_mouse_down_pos;
@@ -1306,7 +1578,6 @@ struct GUIModuleImpl final : GUIModule {
 	DelegateList<void(EntityRef)> m_rect_hovered_out;
 	DelegateList<void(EntityRef, float, float)> m_rect_mouse_down;
 	DelegateList<void(bool, i32, i32)> m_unhandled_mouse_button;
-	Draw2D m_draw_2d;
 };
 
 
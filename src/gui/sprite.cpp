@@ -16,6 +16,11 @@ Sprite::Sprite(const Path& path, ResourceManager& manager, IAllocator& allocator
 
 
 void Sprite::unload() {
+	atlas = Path();
+	uv0 = Vec2(0);
+	uv1 = Vec2(1);
+	m_image = Path();
+	m_atlas_size = IVec2(0);
 	if (!m_texture) return;
 	
 	m_texture->decRefCount();
@@ -23,11 +28,23 @@ void Sprite::unload() {
 }
 
 
+IVec2 Sprite::getSize() const {
+	// `atlas` can be set in editor before the sprite is compiled into it
+	if (m_atlas_size.x > 0) return m_atlas_size;
+	if (!m_texture) return IVec2(0);
+	return IVec2(m_texture->width, m_texture->height);
+}
+
+
 void Sprite::setTexture(const Path& path) {
 	if (m_texture) {
 		m_texture->decRefCount();
 	}
 
+	m_image = path;
+	uv0 = Vec2(0);
+	uv1 = Vec2(1);
+	m_atlas_size = IVec2(0);
 	if (path.isEmpty()) {
 		m_texture = nullptr;
 	} else {
@@ -43,7 +60,7 @@ bool Sprite::load(Span<const u8> mem) {
 		logError(getPath(), ": invalid file");
 		return false;
 	}
-	if (header.version != 0) {
+	if (header.version > 1) {
 		logError(getPath(), ": unsupported version");
 		return false;
 	}
@@ -55,13 +72,21 @@ bool Sprite::load(Span<const u8> mem) {
 	const char* texture = stream.readString();
 	StringView dir = Path::getDir(getPath());
 	StringView tex_dir = Path::getDir(texture);
-	if (tex_dir.empty()) {
-		setTexture(Path(dir, "/", texture));
+	const Path image = tex_dir.empty() ? Path(dir, "/", texture) : Path(texture);
+	type = stream.read<Type>();
+	const char* atlas_path = header.version > 0 ? stream.readString() : "";
+	if (atlas_path[0]) {
+		// the source image is not loaded, the sprite is drawn from the atlas
+		setTexture(Path(atlas_path));
+		m_image = image;
+		atlas = atlas_path;
+		stream.read(uv0);
+		stream.read(uv1);
+		stream.read(m_atlas_size);
 	}
 	else {
-		setTexture(Path(texture));
+		setTexture(image);
 	}
-	type = stream.read<Type>();
 	return !stream.hasOverflow();
 }
 
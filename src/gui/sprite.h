@@ -1,6 +1,8 @@
 #pragma once
 
 
+#include "core/math.h"
+#include "core/path.h"
 #include "engine/resource.h"
 
 
@@ -11,7 +13,7 @@ struct Sprite final : Resource {
 	struct Header {
 		static const u32 MAGIC = '_SPR';
 		u32 magic = MAGIC;
-		u32 version = 0;
+		u32 version = 1;
 	};
 
 	enum Type : u8 {
@@ -26,19 +28,32 @@ struct Sprite final : Resource {
 	void unload() override;
 	bool load(Span<const u8> mem) override;
 	
+	// sets source image, it's drawn as it is until the sprite is compiled into its atlas
 	void setTexture(const Path& path);
+	// atlas texture if the sprite is packed in an atlas
 	struct Texture* getTexture() const { return m_texture; }
+	const Path& getImagePath() const { return m_image; }
+	// size of the image in pixels, which is not the size of getTexture() if the sprite is in an atlas
+	IVec2 getSize() const;
 
 	Type type = SIMPLE;
 	i32 top = 0;
 	i32 bottom = 0;
 	i32 left = 0;
 	i32 right = 0;
+	// .atl the sprite is packed in, empty if it's not in any, sprites in the same atlas share one texture
+	// so GUI can draw them without switching textures
+	Path atlas;
+	// rect of the image in getTexture()
+	Vec2 uv0 = Vec2(0);
+	Vec2 uv1 = Vec2(1);
 
 	static const ResourceType TYPE;
 
 private:
 	Texture* m_texture;
+	Path m_image;
+	IVec2 m_atlas_size = IVec2(0);
 };
 
 
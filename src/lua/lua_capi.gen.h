@@ -16,12 +16,235 @@
 #define XXH_STATIC_LINKING_ONLY
 #include "xxhash/xxhash.h"
 
+namespace Lumix {
+	static const XXH64_hash_t lua_atom_hashes[] = {
+		108650766517059246,
+		217713799092262575,
+		245310123528029111,
+		329780482934683790,
+		361145705378812951,
+		553508148491954027,
+		560781509978742053,
+		604890780200946858,
+		625785543228489392,
+		653079012433669534,
+		686993539073000551,
+		854520953009164070,
+		880366885425937065,
+		1007138839029607122,
+		1063905269850860960,
+		1343142603875055721,
+		1814628136324369351,
+		2173619491007772698,
+		2562035179571876730,
+		2652037676279031843,
+		2710990129242626426,
+		2783102482993102300,
+		2785194655892297410,
+		2859594769824822931,
+		2892853640672813625,
+		3012507977500415911,
+		3015162214864260720,
+		3132701658313449199,
+		3173456512864827325,
+		3192798007053220969,
+		3203804519501376147,
+		3305050883106733620,
+		3342820717099768220,
+		3386464292780187112,
+		3439375685700528633,
+		3636779622785255289,
+		3701802990388885733,
+		3712023579548425612,
+		3791305379450315311,
+		4303913335132134325,
+		5067557280613061028,
+		5145922347574273553,
+		5262915926868391893,
+		5366630513121580472,
+		5411191639289302350,
+		5454775369551634741,
+		5478302996980294400,
+		5777342048330698579,
+		5877966073471669844,
+		5972339069944419853,
+		6071940261820792332,
+		6081828252729856333,
+		6182785171120527074,
+		6218765765714358715,
+		6391177055909864478,
+		6405259518291244478,
+		6439928831641943397,
+		6477692741421575490,
+		6512589393810093616,
+		6621896392170407801,
+		6690385503285762729,
+		6764759324090625456,
+		6837981498271808957,
+		6942080154291173092,
+		7071186415882516621,
+		7124455181160832447,
+		7246320742106666122,
+		7320943736218812204,
+		7336167410229006784,
+		7392264662239472827,
+		7401995853317604073,
+		7595909218576582928,
+		7697188143647272575,
+		7713291462726426963,
+		7720528739237521768,
+		7775591933563895126,
+		7840594216495710123,
+		7886464768384394135,
+		8216748883816048291,
+		8229337662361542422,
+		8317229310512315001,
+		8331910337638582270,
+		8367939065059955720,
+		8373401147270948593,
+		8429324265072172284,
+		8431526794642328585,
+		8660453606820818866,
+		8742773298275793466,
+		8756705481922369689,
+		9000946549947402400,
+		9137665887596174557,
+		9244714665917709065,
+		9502059661590009697,
+		9557052946815348457,
+		9797720740047392814,
+		9831990634604227862,
+		9874367625088890659,
+		9955584850897845776,
+		10008642934015139818,
+		10091190592692352298,
+		10334719470066961856,
+		10369242840717673752,
+		10464521780222816712,
+		10641905485202240135,
+		10697859520051395372,
+		10748237634581008191,
+		10993858714653204735,
+		11007790430520567152,
+		11051090476852783336,
+		11058903951847365969,
+		11411330100860280528,
+		11495164026014626543,
+		11606506487617731568,
+		11618981167408611974,
+		11648327012290020021,
+		11745911936662003018,
+		11850714655574030078,
+		11879614677253768822,
+		11881123303151187909,
+		11899351776270312423,
+		11901102814051950809,
+		12438280802495919435,
+		12560806752221720165,
+		12608998532173430232,
+		12693697298512190214,
+		12820653450790247776,
+		12822292655848233293,
+		12924897109804636052,
+		13073839037530523491,
+		13078273434447554266,
+		13088881172075296505,
+		13102103059382391709,
+		13164642978374509665,
+		13172685102570950854,
+		13313766981166545030,
+		13323000532348084840,
+		13346899911515510418,
+		13355959044402572082,
+		13564639059375118904,
+		13569199342746918467,
+		13701391921693763709,
+		13840943435668507618,
+		13903571279515726310,
+		14023941067117348079,
+		14315065516641866618,
+		14316244282687965501,
+		14320350081376399052,
+		14326776324177495099,
+		14359466895747784007,
+		14597235074366301544,
+		14621152001338781589,
+		14634816653028108528,
+		14660365190981525385,
+		14973262653868318857,
+		15165270708108832870,
+		15220513277102850184,
+		15428345689627384487,
+		15491754885903120859,
+		15555178764847332552,
+		15681074705421253585,
+		15894551059266337426,
+		15900032269147374267,
+		15938965961108614155,
+		15986641726988781619,
+		16103897983733153436,
+		16325623039774346822,
+		16562895722780885937,
+		16614662065599330693,
+		16674851338683446217,
+		16706040244383067120,
+		16820564449043595678,
+		16879827851491555907,
+		16970443376847887964,
+		16971878798002571339,
+		16979673882500863995,
+		17017936901183810145,
+		17236810047590804415,
+		17256734141889372778,
+		17276897033765672782,
+		17410494145398136508,
+		17423615441029062858,
+		17425989282954003833,
+		17518662549011029808,
+		17537531595767570348,
+		17609862876178282011,
+		17615932892140262544,
+		17640912311330498303,
+		17684958279708910872,
+		17733766460475722627,
+		17827108223211535328,
+		17991945435353486994,
+		18068079505236550740,
+		18143883780470064812,
+		18280568557834126485,
+		18335556865412416553,
+		18440467892564879558,
+	};
+	
+	// called by luau when a string is created, property names get their index in lua_atom_hashes
+	static int16_t luaAtom(const char* str, size_t len) {
+		const XXH64_hash_t hash = XXH3_64bits(str, len);
+		u32 from = 0;
+		u32 to = lengthOf(lua_atom_hashes);
+		while (from < to) {
+			const u32 mid = (from + to) / 2;
+			if (lua_atom_hashes[mid] < hash) from = mid + 1;
+			else to = mid;
+		}
+		if (from < lengthOf(lua_atom_hashes) && lua_atom_hashes[from] == hash) return (int16_t)from;
+		return -1;
+	}
+	
+	// `prop_name` is the string at index 2
+	static XXH64_hash_t getPropertyHash(lua_State* L, const char* prop_name) {
+		int atom;
+		lua_tostringatom(L, 2, &atom);
+		if (atom >= 0) return lua_atom_hashes[atom];
+		return XXH3_64bits(prop_name, strlen(prop_name));
+	}
+}
+
 namespace Lumix {
 	int property_animator_getter(lua_State* L) {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (AnimationModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*enabled*/13840943435668507618: LuaWrapper::push(L, module->isPropertyAnimatorEnabled(entity)); break;
 			case /*looped*/6405259518291244478: LuaWrapper::push(L, module->getPropertyAnimatorLooped(entity)); break;
@@ -36,7 +259,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (AnimationModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*enabled*/13840943435668507618: module->enablePropertyAnimator(entity, LuaWrapper::checkArg<bool>(L, 3)); break;
 			case /*looped*/6405259518291244478: module->setPropertyAnimatorLooped(entity, LuaWrapper::checkArg<bool>(L, 3)); break;
@@ -94,7 +317,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (AnimationModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*source*/17609862876178282011: LuaWrapper::push(L, module->getAnimatorSource(entity)); break;
 			case /*use_root_motion*/7336167410229006784: LuaWrapper::push(L, module->getAnimatorUseRootMotion(entity)); break;
@@ -114,7 +337,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (AnimationModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*source*/17609862876178282011: module->setAnimatorSource(entity, LuaWrapper::checkArg<Path>(L, 3)); break;
 			case /*use_root_motion*/7336167410229006784: module->setAnimatorUseRootMotion(entity, LuaWrapper::checkArg<bool>(L, 3)); break;
@@ -129,7 +352,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (AnimationModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*animation*/9955584850897845776: LuaWrapper::push(L, module->getAnimableAnimation(entity)); break;
 			case 0:
@@ -142,7 +365,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (AnimationModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*animation*/9955584850897845776: module->setAnimableAnimation(entity, LuaWrapper::checkArg<Path>(L, 3)); break;
 			case 0:
@@ -229,7 +452,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (AudioModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*radius*/3015162214864260720: LuaWrapper::push(L, module->getEchoZone(entity).radius); break;
 			case /*delay*/13078273434447554266: LuaWrapper::push(L, module->getEchoZone(entity).delay); break;
@@ -243,7 +466,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (AudioModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*radius*/3015162214864260720: module->getEchoZone(entity).radius = LuaWrapper::checkArg<float>(L, 3); break;
 			case /*delay*/13078273434447554266: module->getEchoZone(entity).delay = LuaWrapper::checkArg<float>(L, 3); break;
@@ -257,7 +480,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (AudioModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*radius*/3015162214864260720: LuaWrapper::push(L, module->getChorusZone(entity).radius); break;
 			case /*delay*/13078273434447554266: LuaWrapper::push(L, module->getChorusZone(entity).delay); break;
@@ -271,7 +494,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (AudioModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*radius*/3015162214864260720: module->getChorusZone(entity).radius = LuaWrapper::checkArg<float>(L, 3); break;
 			case /*delay*/13078273434447554266: module->getChorusZone(entity).delay = LuaWrapper::checkArg<float>(L, 3); break;
@@ -285,7 +508,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (AudioModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case 0:
 			default: { ASSERT(false); luaL_error(L, "Unknown property %s", prop_name); break; }
@@ -297,7 +520,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (AudioModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case 0:
 			default: ASSERT(false); luaL_error(L, "Unknown property %s", prop_name); break;
@@ -323,7 +546,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (AudioModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*clip*/13569199342746918467: LuaWrapper::push(L, module->getAmbientSoundClip(entity)); break;
 			case /*is_3d*/7401995853317604073: LuaWrapper::push(L, module->isAmbientSound3D(entity)); break;
@@ -339,7 +562,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (AudioModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*clip*/13569199342746918467: module->setAmbientSoundClip(entity, LuaWrapper::checkArg<Path>(L, 3)); break;
 			case /*is_3d*/7401995853317604073: module->setAmbientSound3D(entity, LuaWrapper::checkArg<bool>(L, 3)); break;
@@ -356,7 +579,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (CoreModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case 0:
 			default: { ASSERT(false); luaL_error(L, "Unknown property %s", prop_name); break; }
@@ -368,7 +591,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (CoreModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case 0:
 			default: ASSERT(false); luaL_error(L, "Unknown property %s", prop_name); break;
@@ -380,7 +603,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (CoreModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case 0:
 			default: { ASSERT(false); luaL_error(L, "Unknown property %s", prop_name); break; }
@@ -392,7 +615,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (CoreModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case 0:
 			default: ASSERT(false); luaL_error(L, "Unknown property %s", prop_name); break;
@@ -434,7 +657,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (GUIModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*is_3d*/7401995853317604073: LuaWrapper::push(L, module->getCanvas(entity).is_3d); break;
 			case /*orient_to_camera*/8367939065059955720: LuaWrapper::push(L, module->getCanvas(entity).orient_to_camera); break;
@@ -449,7 +672,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (GUIModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*is_3d*/7401995853317604073: module->getCanvas(entity).is_3d = LuaWrapper::checkArg<bool>(L, 3); break;
 			case /*orient_to_camera*/8367939065059955720: module->getCanvas(entity).orient_to_camera = LuaWrapper::checkArg<bool>(L, 3); break;
@@ -464,7 +687,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (GUIModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case 0:
 			default: { ASSERT(false); luaL_error(L, "Unknown property %s", prop_name); break; }
@@ -476,7 +699,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (GUIModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case 0:
 			default: ASSERT(false); luaL_error(L, "Unknown property %s", prop_name); break;
@@ -488,7 +711,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (GUIModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case 0:
 			default: { ASSERT(false); luaL_error(L, "Unknown property %s", prop_name); break; }
@@ -500,7 +723,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (GUIModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case 0:
 			default: ASSERT(false); luaL_error(L, "Unknown property %s", prop_name); break;
@@ -512,7 +735,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (GUIModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*enabled*/13840943435668507618: LuaWrapper::push(L, module->isRectEnabled(entity)); break;
 			case /*clip_content*/17423615441029062858: LuaWrapper::push(L, module->getRectClip(entity)); break;
@@ -534,7 +757,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (GUIModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*enabled*/13840943435668507618: module->enableRect(entity, LuaWrapper::checkArg<bool>(L, 3)); break;
 			case /*clip_content*/17423615441029062858: module->setRectClip(entity, LuaWrapper::checkArg<bool>(L, 3)); break;
@@ -556,7 +779,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (GUIModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*hovered_color*/1007138839029607122: LuaWrapper::push(L, module->getButtonHoveredColorRGBA(entity)); break;
 			case /*hovered_cursor*/18068079505236550740: LuaWrapper::push(L, (i32)module->getButtonHoveredCursor(entity)); break;
@@ -570,7 +793,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (GUIModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*hovered_color*/1007138839029607122: module->setButtonHoveredColorRGBA(entity, LuaWrapper::checkArg<Vec4>(L, 3)); break;
 			case /*hovered_cursor*/18068079505236550740: module->setButtonHoveredCursor(entity, (os::CursorType)LuaWrapper::checkArg<i32>(L, 3)); break;
@@ -584,7 +807,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (GUIModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*enabled*/13840943435668507618: LuaWrapper::push(L, module->isImageEnabled(entity)); break;
 			case /*color*/880366885425937065: LuaWrapper::push(L, module->getImageColorRGBA(entity)); break;
@@ -599,7 +822,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (GUIModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*enabled*/13840943435668507618: module->enableImage(entity, LuaWrapper::checkArg<bool>(L, 3)); break;
 			case /*color*/880366885425937065: module->setImageColorRGBA(entity, LuaWrapper::checkArg<Vec4>(L, 3)); break;
@@ -614,7 +837,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (GUIModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*font_size*/13102103059382391709: LuaWrapper::push(L, module->getTextFontSize(entity)); break;
 			case /*color*/880366885425937065: LuaWrapper::push(L, module->getTextColorRGBA(entity)); break;
@@ -632,7 +855,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (GUIModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*font_size*/13102103059382391709: module->setTextFontSize(entity, LuaWrapper::checkArg<int>(L, 3)); break;
 			case /*color*/880366885425937065: module->setTextColorRGBA(entity, LuaWrapper::checkArg<Vec4>(L, 3)); break;
@@ -654,7 +877,7 @@ namespace Lumix {
 		auto* module = (LuaScriptModule*)imodule;
 		if (lua_isnumber(L, 2)) return lua_push_script_env(L, entity, module);
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*scripts*/8216748883816048291: {
 				using GetterModule = LuaScriptModule;
@@ -689,7 +912,7 @@ namespace Lumix {
 						auto* module = LuaWrapper::toType<GetterModule*>(L, lua_upvalueindex(1));
 						EntityRef entity = {LuaWrapper::toType<i32>(L, lua_upvalueindex(2))};
 						i32 index = LuaWrapper::toType<int>(L, lua_upvalueindex(3));
-						XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+						XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 						switch (name_hash) {
 							case /*enabled*/13840943435668507618: LuaWrapper::push(L, module->isScriptEnabled(entity, index)); break;
 							case /*path*/8756705481922369689: LuaWrapper::push(L, module->getScriptPath(entity, index)); break;
@@ -701,7 +924,7 @@ namespace Lumix {
 					auto setter = [](lua_State* L) -> int {
 						LuaWrapper::checkTableArg(L, 1);
 						const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-						XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+						XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 						auto* module = LuaWrapper::toType<GetterModule*>(L, lua_upvalueindex(1));
 						EntityRef entity = {LuaWrapper::toType<i32>(L, lua_upvalueindex(2))};
 						i32 index = LuaWrapper::toType<int>(L, lua_upvalueindex(3));
@@ -760,7 +983,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (LuaScriptModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case 0:
 			default: ASSERT(false); luaL_error(L, "Unknown property %s", prop_name); break;
@@ -772,7 +995,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (LuaScriptModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*code*/329780482934683790: LuaWrapper::push(L, module->getInlineScriptCode(entity)); break;
 			case 0:
@@ -785,7 +1008,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (LuaScriptModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*code*/329780482934683790: module->setInlineScriptCode(entity, LuaWrapper::checkArg<const char*>(L, 3)); break;
 			case 0:
@@ -854,7 +1077,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (NavigationModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*extents*/16706040244383067120: LuaWrapper::push(L, module->getZone(entity).extents); break;
 			case /*cell_size*/11901102814051950809: LuaWrapper::push(L, module->getZone(entity).cell_size); break;
@@ -882,7 +1105,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (NavigationModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*extents*/16706040244383067120: module->getZone(entity).extents = LuaWrapper::checkArg<Vec3>(L, 3); break;
 			case /*cell_size*/11901102814051950809: module->getZone(entity).cell_size = LuaWrapper::checkArg<float>(L, 3); break;
@@ -928,7 +1151,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (NavigationModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*radius*/3015162214864260720: LuaWrapper::push(L, module->getAgentRadius(entity)); break;
 			case /*height*/3439375685700528633: LuaWrapper::push(L, module->getAgentHeight(entity)); break;
@@ -947,7 +1170,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (NavigationModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*radius*/3015162214864260720: module->setAgentRadius(entity, LuaWrapper::checkArg<float>(L, 3)); break;
 			case /*height*/3439375685700528633: module->setAgentHeight(entity, LuaWrapper::checkArg<float>(L, 3)); break;
@@ -986,7 +1209,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*heightmap*/3791305379450315311: LuaWrapper::push(L, module->getHeightfieldSource(entity)); break;
 			case /*xz_scale*/2710990129242626426: LuaWrapper::push(L, module->getHeightfieldXZScale(entity)); break;
@@ -1002,7 +1225,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*heightmap*/3791305379450315311: module->setHeightfieldSource(entity, LuaWrapper::checkArg<Path>(L, 3)); break;
 			case /*xz_scale*/2710990129242626426: module->setHeightfieldXZScale(entity, LuaWrapper::checkArg<float>(L, 3)); break;
@@ -1018,7 +1241,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*xmotion*/12924897109804636052: LuaWrapper::push(L, (i32)module->getD6JointXMotion(entity)); break;
 			case /*ymotion*/2892853640672813625: LuaWrapper::push(L, (i32)module->getD6JointYMotion(entity)); break;
@@ -1045,7 +1268,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*xmotion*/12924897109804636052: module->setD6JointXMotion(entity, (PhysicsModule::D6Motion)LuaWrapper::checkArg<i32>(L, 3)); break;
 			case /*ymotion*/2892853640672813625: module->setD6JointYMotion(entity, (PhysicsModule::D6Motion)LuaWrapper::checkArg<i32>(L, 3)); break;
@@ -1072,7 +1295,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*connected_body*/16103897983733153436: LuaWrapper::push(L, module->getDistanceJointConnectedBody(entity)); break;
 			case /*axis_position*/2173619491007772698: LuaWrapper::push(L, module->getDistanceJointAxisPosition(entity)); break;
@@ -1091,7 +1314,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*connected_body*/16103897983733153436: module->setDistanceJointConnectedBody(entity, LuaWrapper::checkArg<EntityPtr>(L, 3)); break;
 			case /*axis_position*/2173619491007772698: module->setDistanceJointAxisPosition(entity, LuaWrapper::checkArg<Vec3>(L, 3)); break;
@@ -1109,7 +1332,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*connected_body*/16103897983733153436: LuaWrapper::push(L, module->getHingeJointConnectedBody(entity)); break;
 			case /*axis_position*/2173619491007772698: LuaWrapper::push(L, module->getHingeJointAxisPosition(entity)); break;
@@ -1128,7 +1351,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*connected_body*/16103897983733153436: module->setHingeJointConnectedBody(entity, LuaWrapper::checkArg<EntityPtr>(L, 3)); break;
 			case /*axis_position*/2173619491007772698: module->setHingeJointAxisPosition(entity, LuaWrapper::checkArg<Vec3>(L, 3)); break;
@@ -1147,7 +1370,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*connected_body*/16103897983733153436: LuaWrapper::push(L, module->getSphericalJointConnectedBody(entity)); break;
 			case /*axis_position*/2173619491007772698: LuaWrapper::push(L, module->getSphericalJointAxisPosition(entity)); break;
@@ -1164,7 +1387,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*connected_body*/16103897983733153436: module->setSphericalJointConnectedBody(entity, LuaWrapper::checkArg<EntityPtr>(L, 3)); break;
 			case /*axis_position*/2173619491007772698: module->setSphericalJointAxisPosition(entity, LuaWrapper::checkArg<Vec3>(L, 3)); break;
@@ -1211,7 +1434,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*layer*/12438280802495919435: LuaWrapper::push(L, module->getControllerLayer(entity)); break;
 			case /*radius*/3015162214864260720: LuaWrapper::push(L, module->getControllerRadius(entity)); break;
@@ -1233,7 +1456,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*layer*/12438280802495919435: module->setControllerLayer(entity, LuaWrapper::checkArg<u32>(L, 3)); break;
 			case /*radius*/3015162214864260720: module->setControllerRadius(entity, LuaWrapper::checkArg<float>(L, 3)); break;
@@ -1283,7 +1506,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*boxes*/8373401147270948593: {
 				using GetterModule = PhysicsModule;
@@ -1318,7 +1541,7 @@ namespace Lumix {
 						auto* module = LuaWrapper::toType<GetterModule*>(L, lua_upvalueindex(1));
 						EntityRef entity = {LuaWrapper::toType<i32>(L, lua_upvalueindex(2))};
 						i32 index = LuaWrapper::toType<int>(L, lua_upvalueindex(3));
-						XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+						XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 						switch (name_hash) {
 							case /*half_extents*/854520953009164070: LuaWrapper::push(L, module->getBoxHalfExtents(entity, index)); break;
 							case /*position_offset*/15220513277102850184: LuaWrapper::push(L, module->getBoxOffsetPosition(entity, index)); break;
@@ -1331,7 +1554,7 @@ namespace Lumix {
 					auto setter = [](lua_State* L) -> int {
 						LuaWrapper::checkTableArg(L, 1);
 						const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-						XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+						XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 						auto* module = LuaWrapper::toType<GetterModule*>(L, lua_upvalueindex(1));
 						EntityRef entity = {LuaWrapper::toType<i32>(L, lua_upvalueindex(2))};
 						i32 index = LuaWrapper::toType<int>(L, lua_upvalueindex(3));
@@ -1414,7 +1637,7 @@ namespace Lumix {
 						auto* module = LuaWrapper::toType<GetterModule*>(L, lua_upvalueindex(1));
 						EntityRef entity = {LuaWrapper::toType<i32>(L, lua_upvalueindex(2))};
 						i32 index = LuaWrapper::toType<int>(L, lua_upvalueindex(3));
-						XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+						XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 						switch (name_hash) {
 							case /*radius*/3015162214864260720: LuaWrapper::push(L, module->getSphereRadius(entity, index)); break;
 							case /*position_offset*/15220513277102850184: LuaWrapper::push(L, module->getSphereOffsetPosition(entity, index)); break;
@@ -1426,7 +1649,7 @@ namespace Lumix {
 					auto setter = [](lua_State* L) -> int {
 						LuaWrapper::checkTableArg(L, 1);
 						const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-						XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+						XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 						auto* module = LuaWrapper::toType<GetterModule*>(L, lua_upvalueindex(1));
 						EntityRef entity = {LuaWrapper::toType<i32>(L, lua_upvalueindex(2))};
 						i32 index = LuaWrapper::toType<int>(L, lua_upvalueindex(3));
@@ -1497,7 +1720,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*layer*/12438280802495919435: module->setActorLayer(entity, LuaWrapper::checkArg<u32>(L, 3)); break;
 			case /*dynamic*/9000946549947402400: module->setActorDynamicType(entity, (PhysicsModule::DynamicType)LuaWrapper::checkArg<i32>(L, 3)); break;
@@ -1515,7 +1738,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*spring_strength*/16971878798002571339: LuaWrapper::push(L, module->getWheelSpringStrength(entity)); break;
 			case /*spring_max_compression*/9874367625088890659: LuaWrapper::push(L, module->getWheelSpringMaxCompression(entity)); break;
@@ -1537,7 +1760,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*spring_strength*/16971878798002571339: module->setWheelSpringStrength(entity, LuaWrapper::checkArg<float>(L, 3)); break;
 			case /*spring_max_compression*/9874367625088890659: module->setWheelSpringMaxCompression(entity, LuaWrapper::checkArg<float>(L, 3)); break;
@@ -1558,7 +1781,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*peak_torque*/108650766517059246: LuaWrapper::push(L, module->getVehiclePeakTorque(entity)); break;
 			case /*max__r_p_m*/9244714665917709065: LuaWrapper::push(L, module->getVehicleMaxRPM(entity)); break;
@@ -1581,7 +1804,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*peak_torque*/108650766517059246: module->setVehiclePeakTorque(entity, LuaWrapper::checkArg<float>(L, 3)); break;
 			case /*max__r_p_m*/9244714665917709065: module->setVehicleMaxRPM(entity, LuaWrapper::checkArg<float>(L, 3)); break;
@@ -1601,7 +1824,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*half_extents*/854520953009164070: LuaWrapper::push(L, module->getInstancedCubeHalfExtents(entity)); break;
 			case /*layer*/12438280802495919435: LuaWrapper::push(L, module->getInstancedCubeLayer(entity)); break;
@@ -1615,7 +1838,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*half_extents*/854520953009164070: module->setInstancedCubeHalfExtents(entity, LuaWrapper::checkArg<Vec3>(L, 3)); break;
 			case /*layer*/12438280802495919435: module->setInstancedCubeLayer(entity, LuaWrapper::checkArg<u32>(L, 3)); break;
@@ -1629,7 +1852,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*layer*/12438280802495919435: LuaWrapper::push(L, module->getInstancedMeshLayer(entity)); break;
 			case /*mesh*/6218765765714358715: LuaWrapper::push(L, module->getInstancedMeshGeomPath(entity)); break;
@@ -1643,7 +1866,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (PhysicsModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*layer*/12438280802495919435: module->setInstancedMeshLayer(entity, LuaWrapper::checkArg<u32>(L, 3)); break;
 			case /*mesh*/6218765765714358715: module->setInstancedMeshGeomPath(entity, LuaWrapper::checkArg<Path>(L, 3)); break;
@@ -1822,7 +2045,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*fov*/6690385503285762729: LuaWrapper::push(L, module->getCamera(entity).fov); break;
 			case /*near*/15894551059266337426: LuaWrapper::push(L, module->getCamera(entity).near); break;
@@ -1851,7 +2074,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*fov*/6690385503285762729: module->getCamera(entity).fov = LuaWrapper::checkArg<float>(L, 3); break;
 			case /*near*/15894551059266337426: module->getCamera(entity).near = LuaWrapper::checkArg<float>(L, 3); break;
@@ -1879,7 +2102,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*uv_scale*/17518662549011029808: LuaWrapper::push(L, module->getDecal(entity).uv_scale); break;
 			case /*material*/13073839037530523491: LuaWrapper::push(L, module->getDecalMaterialPath(entity)); break;
@@ -1894,7 +2117,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*uv_scale*/17518662549011029808: module->getDecal(entity).uv_scale = LuaWrapper::checkArg<Vec2>(L, 3); break;
 			case /*material*/13073839037530523491: module->setDecalMaterialPath(entity, LuaWrapper::checkArg<Path>(L, 3)); break;
@@ -1909,7 +2132,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*light_color*/18143883780470064812: LuaWrapper::push(L, module->getEnvironment(entity).light_color); break;
 			case /*direct_intensity*/17537531595767570348: LuaWrapper::push(L, module->getEnvironment(entity).direct_intensity); break;
@@ -1945,7 +2168,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*light_color*/18143883780470064812: module->getEnvironment(entity).light_color = LuaWrapper::checkArg<Vec3>(L, 3); break;
 			case /*direct_intensity*/17537531595767570348: module->getEnvironment(entity).direct_intensity = LuaWrapper::checkArg<float>(L, 3); break;
@@ -1981,7 +2204,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*color*/880366885425937065: LuaWrapper::push(L, module->getPointLight(entity).color); break;
 			case /*intensity*/9797720740047392814: LuaWrapper::push(L, module->getPointLight(entity).intensity); break;
@@ -2000,7 +2223,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*color*/880366885425937065: module->getPointLight(entity).color = LuaWrapper::checkArg<Vec3>(L, 3); break;
 			case /*intensity*/9797720740047392814: module->getPointLight(entity).intensity = LuaWrapper::checkArg<float>(L, 3); break;
@@ -2019,7 +2242,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*size*/14597235074366301544: LuaWrapper::push(L, module->getReflectionProbe(entity).size); break;
 			case /*half_extents*/854520953009164070: LuaWrapper::push(L, module->getReflectionProbe(entity).half_extents); break;
@@ -2034,7 +2257,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*size*/14597235074366301544: module->getReflectionProbe(entity).size = LuaWrapper::checkArg<u32>(L, 3); break;
 			case /*half_extents*/854520953009164070: module->getReflectionProbe(entity).half_extents = LuaWrapper::checkArg<Vec3>(L, 3); break;
@@ -2049,7 +2272,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*inner_range*/8429324265072172284: LuaWrapper::push(L, module->getEnvironmentProbe(entity).inner_range); break;
 			case /*outer_range*/7392264662239472827: LuaWrapper::push(L, module->getEnvironmentProbe(entity).outer_range); break;
@@ -2064,7 +2287,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*inner_range*/8429324265072172284: module->getEnvironmentProbe(entity).inner_range = LuaWrapper::checkArg<Vec3>(L, 3); break;
 			case /*outer_range*/7392264662239472827: module->getEnvironmentProbe(entity).outer_range = LuaWrapper::checkArg<Vec3>(L, 3); break;
@@ -2079,7 +2302,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*layers*/5478302996980294400: LuaWrapper::push(L, module->getFur(entity).layers); break;
 			case /*scale*/13323000532348084840: LuaWrapper::push(L, module->getFur(entity).scale); break;
@@ -2095,7 +2318,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*layers*/5478302996980294400: module->getFur(entity).layers = LuaWrapper::checkArg<u32>(L, 3); break;
 			case /*scale*/13323000532348084840: module->getFur(entity).scale = LuaWrapper::checkArg<float>(L, 3); break;
@@ -2119,7 +2342,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*parent*/8742773298275793466: LuaWrapper::push(L, module->getBoneAttachmentParent(entity)); break;
 			case /*bone*/2783102482993102300: LuaWrapper::push(L, module->getBoneAttachmentBone(entity)); break;
@@ -2136,7 +2359,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*parent*/8742773298275793466: module->setBoneAttachmentParent(entity, LuaWrapper::checkArg<EntityPtr>(L, 3)); break;
 			case /*bone*/2783102482993102300: module->setBoneAttachmentBone(entity, LuaWrapper::checkArg<int>(L, 3)); break;
@@ -2152,10 +2375,12 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*source*/17609862876178282011: LuaWrapper::push(L, module->getParticleEmitterPath(entity)); break;
 			case /*autodestroy*/13701391921693763709: LuaWrapper::push(L, module->getParticleEmitterAutodestroy(entity)); break;
+			case /*update_policy*/10748237634581008191: LuaWrapper::push(L, (i32)module->getParticleEmitterUpdatePolicy(entity)); break;
+			case /*throttle_distance*/3132701658313449199: LuaWrapper::push(L, module->getParticleEmitterThrottleDistance(entity)); break;
 			case 0:
 			default: { ASSERT(false); luaL_error(L, "Unknown property %s", prop_name); break; }
 		}
@@ -2166,10 +2391,12 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*source*/17609862876178282011: module->setParticleEmitterPath(entity, LuaWrapper::checkArg<Path>(L, 3)); break;
 			case /*autodestroy*/13701391921693763709: module->setParticleEmitterAutodestroy(entity, LuaWrapper::checkArg<bool>(L, 3)); break;
+			case /*update_policy*/10748237634581008191: module->setParticleEmitterUpdatePolicy(entity, (ParticleEmitterUpdatePolicy)LuaWrapper::checkArg<i32>(L, 3)); break;
+			case /*throttle_distance*/3132701658313449199: module->setParticleEmitterThrottleDistance(entity, LuaWrapper::checkArg<float>(L, 3)); break;
 			case 0:
 			default: ASSERT(false); luaL_error(L, "Unknown property %s", prop_name); break;
 		}
@@ -2180,7 +2407,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*model*/8229337662361542422: LuaWrapper::push(L, module->getInstancedModelPath(entity)); break;
 			case 0:
@@ -2193,7 +2420,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*model*/8229337662361542422: module->setInstancedModelPath(entity, LuaWrapper::checkArg<Path>(L, 3)); break;
 			case 0:
@@ -2223,7 +2450,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*enabled*/13840943435668507618: LuaWrapper::push(L, module->isModelInstanceEnabled(entity)); break;
 			case /*source*/17609862876178282011: LuaWrapper::push(L, module->getModelInstancePath(entity)); break;
@@ -2239,7 +2466,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*enabled*/13840943435668507618: module->enableModelInstance(entity, LuaWrapper::checkArg<bool>(L, 3)); break;
 			case /*source*/17609862876178282011: module->setModelInstancePath(entity, LuaWrapper::checkArg<Path>(L, 3)); break;
@@ -2253,7 +2480,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*material*/13073839037530523491: LuaWrapper::push(L, module->getCurveDecalMaterialPath(entity)); break;
 			case /*half_extents*/854520953009164070: LuaWrapper::push(L, module->getCurveDecalHalfExtents(entity)); break;
@@ -2270,7 +2497,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*material*/13073839037530523491: module->setCurveDecalMaterialPath(entity, LuaWrapper::checkArg<Path>(L, 3)); break;
 			case /*half_extents*/854520953009164070: module->setCurveDecalHalfExtents(entity, LuaWrapper::checkArg<float>(L, 3)); break;
@@ -2305,7 +2532,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*grass*/17684958279708910872: {
 				using GetterModule = RenderModule;
@@ -2340,7 +2567,7 @@ namespace Lumix {
 						auto* module = LuaWrapper::toType<GetterModule*>(L, lua_upvalueindex(1));
 						EntityRef entity = {LuaWrapper::toType<i32>(L, lua_upvalueindex(2))};
 						i32 index = LuaWrapper::toType<int>(L, lua_upvalueindex(3));
-						XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+						XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 						switch (name_hash) {
 							case /*rotation_mode*/217713799092262575: LuaWrapper::push(L, (i32)module->getGrassRotationMode(entity, index)); break;
 							case /*distance*/17615932892140262544: LuaWrapper::push(L, module->getGrassDistance(entity, index)); break;
@@ -2354,7 +2581,7 @@ namespace Lumix {
 					auto setter = [](lua_State* L) -> int {
 						LuaWrapper::checkTableArg(L, 1);
 						const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-						XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+						XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 						auto* module = LuaWrapper::toType<GetterModule*>(L, lua_upvalueindex(1));
 						EntityRef entity = {LuaWrapper::toType<i32>(L, lua_upvalueindex(2))};
 						i32 index = LuaWrapper::toType<int>(L, lua_upvalueindex(3));
@@ -2423,7 +2650,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*material*/13073839037530523491: module->setTerrainMaterialPath(entity, LuaWrapper::checkArg<Path>(L, 3)); break;
 			case /*xz_scale*/2710990129242626426: module->setTerrainXZScale(entity, LuaWrapper::checkArg<float>(L, 3)); break;
@@ -2440,7 +2667,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*material*/13073839037530523491: LuaWrapper::push(L, module->getProceduralGeometryMaterial(entity)); break;
 			case 0:
@@ -2453,7 +2680,7 @@ namespace Lumix {
 		auto [imodule, entity] = checkComponent(L);
 		auto* module = (RenderModule*)imodule;
 		const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-		XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+		XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 		switch (name_hash) {
 			case /*material*/13073839037530523491: module->setProceduralGeometryMaterial(entity, LuaWrapper::checkArg<Path>(L, 3)); break;
 			case 0:
@@ -2467,6 +2694,7 @@ namespace Lumix {
 namespace Lumix {
 	
 	void registerLuaAPI(lua_State* L) {
+		lua_callbacks(L)->useratom = luaAtom;
 		lua_newtable(L);
 		lua_setglobal(L, "LumixModules");
 		{
@@ -21,6 +21,7 @@ void LuaScript::unload() {
 	for (LuaScript* scr : m_dependencies) scr->decRefCount();
 	m_dependencies.clear();
 	m_source_code = "";
+	m_is_parallel = false;
 }
 
 bool LuaScript::load(Span<const u8> mem) {
@@ -34,6 +35,7 @@ bool LuaScript::load(Span<const u8> mem) {
 		m_dependencies.push(scr);
 	}
 	m_source_code = StringView((const char*)blob.skip(0), (u32)blob.remaining());
+	m_is_parallel = startsWith(m_source_code, "--!parallel");
 	return true;
 }
 
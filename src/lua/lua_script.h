@@ -21,6 +21,8 @@ public:
 	void unload() override;
 	bool load(Span<const u8> mem) override;
 	StringView getSourceCode() const { return m_source_code; }
+	// script starts with `--!parallel`, its update runs in worker VMs, see LuaScriptModuleImpl::ParallelVM
+	bool isParallel() const { return m_is_parallel; }
 
 	static inline const ResourceType TYPE = ResourceType("lua_script");
 
@@ -28,6 +30,7 @@ private:
 	TagAllocator m_allocator;
 	Array<LuaScript*> m_dependencies;
 	String m_source_code;
+	bool m_is_parallel = false;
 };
 
 
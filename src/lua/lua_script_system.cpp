@@ -1,11 +1,14 @@
 #include "core/allocator.h"
 #include "core/array.h"
 #include "core/associative_array.h"
+#include "core/command_line_parser.h"
 #include "core/hash.h"
+#include "core/job_system.h"
 #include "core/log.h"
 #include "core/metaprogramming.h"
 #include "core/os.h"
 #include "core/profiler.h"
+#include "core/sort.h"
 #include "core/stream.h"
 #include "core/string.h"
 #include "engine/engine.h"
@@ -319,6 +322,93 @@ static int LUA_raycast(lua_State* L)
 	return 1;
 }
 
+// pushes array of hits, each hit is either false or {entity, position, normal}
+template <typename T>
+static void pushHits(lua_State* L, PhysicsModule& module, Span<const T> hits) {
+	lua_createtable(L, hits.length(), 0);
+	for (u32 i = 0; i < hits.length(); ++i) {
+		const T& hit = hits[i];
+		if (hit.entity.isValid()) {
+			lua_createtable(L, 0, 3);
+			LuaWrapper::pushEntity(L, hit.entity, &module.getWorld());
+			lua_setfield(L, -2, "entity");
+			LuaWrapper::push(L, hit.position);
+			lua_setfield(L, -2, "position");
+			LuaWrapper::push(L, hit.normal);
+			lua_setfield(L, -2, "normal");
+		}
+		else {
+			LuaWrapper::push(L, false);
+		}
+		lua_rawseti(L, -2, i + 1);
+	}
+}
+
+// Physics.raycastBatch(module, {{origin, dir}, ...}, [layer]) -> {hit or false, ...}
+static int LUA_raycastBatch(lua_State* L)
+{
+	auto* module = LuaWrapper::checkArg<PhysicsModule*>(L, 1);
+	LuaWrapper::checkTableArg(L, 2);
+	const int layer = lua_gettop(L) > 2 ? LuaWrapper::checkArg<int>(L, 3) : -1;
+
+	IAllocator& allocator = module->getWorld().getAllocator();
+	const u32 count = (u32)lua_objlen(L, 2);
+	Array<RaycastQuery> queries(allocator);
+	Array<RaycastHit> hits(allocator);
+	queries.reserve(count);
+	hits.resize(count);
+	for (u32 i = 0; i < count; ++i) {
+		lua_rawgeti(L, 2, i + 1);
+		if (!lua_istable(L, -1)) luaL_argerror(L, 2, "array of {origin, dir} expected");
+		RaycastQuery& query = queries.emplace();
+		lua_rawgeti(L, -1, 1);
+		query.origin = LuaWrapper::toType<Vec3>(L, -1);
+		lua_rawgeti(L, -2, 2);
+		query.dir = LuaWrapper::toType<Vec3>(L, -1);
+		lua_pop(L, 3);
+		query.distance = FLT_MAX;
+		query.layer = layer;
+	}
+
+	module->raycastBatch(queries, hits);
+	pushHits<RaycastHit>(L, *module, hits);
+	return 1;
+}
+
+// Physics.sweepSphereBatch(module, {{pos, radius, dir, distance}, ...}, [layer]) -> {hit or false, ...}
+static int LUA_sweepSphereBatch(lua_State* L)
+{
+	auto* module = LuaWrapper::checkArg<PhysicsModule*>(L, 1);
+	LuaWrapper::checkTableArg(L, 2);
+	const int layer = lua_gettop(L) > 2 ? LuaWrapper::checkArg<int>(L, 3) : -1;
+
+	IAllocator& allocator = module->getWorld().getAllocator();
+	const u32 count = (u32)lua_objlen(L, 2);
+	Array<SweepSphereQuery> queries(allocator);
+	Array<SweepHit> hits(allocator);
+	queries.reserve(count);
+	hits.resize(count);
+	for (u32 i = 0; i < count; ++i) {
+		lua_rawgeti(L, 2, i + 1);
+		if (!lua_istable(L, -1)) luaL_argerror(L, 2, "array of {pos, radius, dir, distance} expected");
+		SweepSphereQuery& query = queries.emplace();
+		lua_rawgeti(L, -1, 1);
+		query.pos = LuaWrapper::toType<DVec3>(L, -1);
+		lua_rawgeti(L, -2, 2);
+		query.radius = LuaWrapper::toType<float>(L, -1);
+		lua_rawgeti(L, -3, 3);
+		query.dir = LuaWrapper::toType<Vec3>(L, -1);
+		lua_rawgeti(L, -4, 4);
+		query.distance = LuaWrapper::toType<float>(L, -1);
+		lua_pop(L, 5);
+		query.layer = layer;
+	}
+
+	module->sweepSphereBatch(queries, hits);
+	pushHits<SweepHit>(L, *module, hits);
+	return 1;
+}
+
 
 struct LuaScriptSystemImpl final : LuaScriptSystem
 {
@@ -331,6 +421,8 @@ struct LuaScriptSystemImpl final : LuaScriptSystem
 		registerInputAPI(m_state);
 		registerRendererAPI(m_state, m_engine);
 		LuaWrapper::createSystemFunction(m_state, "Physics", "raycast", &LUA_raycast);
+		LuaWrapper::createSystemFunction(m_state, "Physics", "raycastBatch", &LUA_raycastBatch);
+		LuaWrapper::createSystemFunction(m_state, "Physics", "sweepSphereBatch", &LUA_sweepSphereBatch);
 	}
 
 	void createModules(World& world) override;
@@ -343,6 +435,52 @@ struct LuaScriptSystemImpl final : LuaScriptSystem
 	void update(float dt) override {
 		static u32 lua_mem_counter = profiler::createCounter("Lua Memory (KB)", 0);
 		profiler::pushCounter(lua_mem_counter, float(double(m_lua_allocated) / 1024.0));
+		stepGC();
+		for (i32 i = 0; i < m_memory_categories.size(); ++i) {
+			profiler::pushCounter(m_memory_categories[i].counter, float(double(lua_totalbytes(m_state, i + 1)) / 1024.0));
+		}
+	}
+
+	// incremental GC work at a fixed point in the frame, limited by `m_gc_budget_us`
+	// cycle starts before luau would start it on its own, so allocations in scripts rarely have to do GC work
+	void stepGC() {
+		PROFILE_FUNCTION();
+		static u32 heap_counter = profiler::createCounter("Lua Live Heap (KB)", 0);
+		static u32 gc_time_counter = profiler::createCounter("Lua GC (ms)", 0);
+
+		const u32 heap_kb = lua_gc(m_state, LUA_GCCOUNT, 0);
+		profiler::pushCounter(heap_counter, float(heap_kb));
+
+		if (!m_gc_cycle_running && heap_kb * 100 < m_gc_live_kb * GC_START_PERCENT) {
+			profiler::pushCounter(gc_time_counter, 0);
+			return;
+		}
+
+		m_gc_cycle_running = true;
+		os::Timer timer;
+		do {
+			if (lua_gc(m_state, LUA_GCSTEP, GC_STEP_KB)) {
+				// cycle finished
+				m_gc_cycle_running = false;
+				m_gc_live_kb = maximum(u32(lua_gc(m_state, LUA_GCCOUNT, 0)), GC_MIN_HEAP_KB);
+				break;
+			}
+		} while (timer.getTimeSinceStart() * 1'000'000 < m_gc_budget_us);
+		profiler::pushCounter(gc_time_counter, timer.getTimeSinceStart() * 1000);
+	}
+
+	// luau memory category of a script, so its heap is visible in profiler, 0 is for everything else
+	u8 getMemoryCategory(const Path& path) {
+		for (i32 i = 0; i < m_memory_categories.size(); ++i) {
+			if (m_memory_categories[i].path == path) return u8(i + 1);
+		}
+		if (m_memory_categories.size() + 1 >= LUA_MEMORY_CATEGORIES) return 0;
+
+		MemoryCategory& category = m_memory_categories.emplace();
+		category.path = path;
+		const StaticString<64> counter_name("Lua ", Path::getBasename(path), " (KB)");
+		category.counter = profiler::createCounter(counter_name, 0);
+		return u8(m_memory_categories.size());
 	}
 
 	void unloadLuaResource(LuaResourceHandle resource) override
@@ -371,27 +509,213 @@ struct LuaScriptSystemImpl final : LuaScriptSystem
 		return nullptr;
 	}
 
+	struct MemoryCategory {
+		Path path;
+		u32 counter;
+	};
+
+	static constexpr i32 GC_STEP_KB = 16;
+	// new cycle starts when heap grows by this much since the last one, luau's own GC goal is 200%
+	static constexpr u32 GC_START_PERCENT = 150;
+	static constexpr u32 GC_MIN_HEAP_KB = 1024;
+
 	TagAllocator m_allocator;
 	TagAllocator m_lua_allocator;
 	lua_State* m_state;
 	Engine& m_engine;
 	LuaScriptManager m_script_manager;
 	size_t m_lua_allocated = 0;
+	Array<MemoryCategory> m_memory_categories;
+	u32 m_gc_budget_us = 1000;
+	u32 m_gc_live_kb = GC_MIN_HEAP_KB;
+	bool m_gc_cycle_running = false;
 	HashMap<int, Resource*> m_lua_resources;
 	u32 m_last_lua_resource_idx = -1;
 };
 
 
 struct LuaScriptModuleImpl final : LuaScriptModule {
-	struct TimerData {
-		float time;
-		lua_State* state;
-		int func;
+	// callback scheduled with LuaScript.setTimer, or a coroutine suspended in LuaScript.wait
+	struct Timer {
+		LuaWrapper::RefHandle ref = -1; // function or coroutine
+		const void* owner = nullptr; // environment of the script which scheduled the timer
+		u32 generation = 0; // part of handles, so handles of released timers are not valid
+		u32 prev = INVALID_TIMER; // owner's timers are in a list, so they are released with the script
+		u32 next = INVALID_TIMER; // next free slot if the timer is not active
+		bool is_coroutine = false;
+		bool active = false;
+	};
+
+	// timers in binary min-heap by time, released timers stay in the heap until their time and are skipped
+	struct TimerHeapEntry {
+		double time;
+		u32 slot;
+		u32 generation;
 	};
 
+	static constexpr u32 INVALID_TIMER = 0xffFFffFF;
+	// timer handle is slot index in low bits and generation in high bits
+	static constexpr u32 TIMER_SLOT_BITS = 20;
+	static constexpr u32 TIMER_SLOT_MASK = (1 << TIMER_SLOT_BITS) - 1;
+
 	struct CallbackData {
 		lua_State* state;
 		int environment;
+		EntityRef entity; // callbacks of inactive entities are skipped
+	};
+
+	struct UpdateData {
+		lua_State* state;
+		EntityRef entity; // inactive entities are not updated
+		LuaWrapper::RefHandle function; // `update` from script's environment, looked up when the script starts
+		u32 name; // index in m_update_names, updates are grouped by it in profiler
+	};
+
+	// worker local VM for scripts starting with `--!parallel`
+	// their update runs in a copy of the script's environment, with read-only access to the world
+	// world writes are recorded in `commands` and applied on the main thread
+	struct ParallelVM {
+		enum class CommandType : u8 {
+			SET_POSITION,
+			SET_ROTATION,
+			SET_SCALE,
+			DESTROY_ENTITY
+		};
+
+		struct Command {
+			CommandType type;
+			EntityRef entity;
+			DVec3 position;
+			Quat rotation;
+			Vec3 scale;
+		};
+
+		struct Update {
+			lua_State* owner; // main thread instance's state, to find the update when the script is disabled
+			EntityRef entity;
+			LuaWrapper::RefHandle environment;
+			LuaWrapper::RefHandle function;
+		};
+
+		ParallelVM(World& world, IAllocator& allocator)
+			: m_world(world)
+			, m_commands(allocator)
+			, m_updates(allocator)
+		{
+			m_state = luaL_newstate();
+			luaL_openlibs(m_state);
+			LuaWrapper::setVectorMetatable(m_state);
+			lua_State* L = m_state;
+			lua_newtable(L); // [World]
+			auto reg = [&](const char* name, lua_CFunction f) {
+				lua_pushlightuserdata(L, this);
+				lua_pushcclosure(L, f, name, 1);
+				lua_setfield(L, -2, name);
+			};
+			reg("getPosition", &LUA_getPosition);
+			reg("getRotation", &LUA_getRotation);
+			reg("getScale", &LUA_getScale);
+			reg("isActive", &LUA_isActive);
+			reg("setPosition", &LUA_setPosition);
+			reg("setRotation", &LUA_setRotation);
+			reg("setScale", &LUA_setScale);
+			reg("destroyEntity", &LUA_destroyEntity);
+			lua_setglobal(L, "World"); // []
+			// globals and libraries are read-only, updates can only write to their own environment
+			luaL_sandbox(L);
+		}
+
+		~ParallelVM() { lua_close(m_state); }
+
+		static ParallelVM& getVM(lua_State* L) { return *(ParallelVM*)lua_tolightuserdata(L, lua_upvalueindex(1)); }
+
+		static EntityRef checkEntity(lua_State* L, ParallelVM& vm) {
+			const EntityRef e = {LuaWrapper::checkArg<i32>(L, 1)};
+			if (!vm.m_world.hasEntity(e)) luaL_argerrorL(L, 1, "invalid entity");
+			return e;
+		}
+
+		static int LUA_getPosition(lua_State* L) {
+			ParallelVM& vm = getVM(L);
+			LuaWrapper::push(L, vm.m_world.getPosition(checkEntity(L, vm)));
+			return 1;
+		}
+
+		static int LUA_getRotation(lua_State* L) {
+			ParallelVM& vm = getVM(L);
+			LuaWrapper::push(L, vm.m_world.getRotation(checkEntity(L, vm)));
+			return 1;
+		}
+
+		static int LUA_getScale(lua_State* L) {
+			ParallelVM& vm = getVM(L);
+			LuaWrapper::push(L, vm.m_world.getScale(checkEntity(L, vm)));
+			return 1;
+		}
+
+		static int LUA_isActive(lua_State* L) {
+			ParallelVM& vm = getVM(L);
+			lua_pushboolean(L, vm.m_world.isEntityActive(checkEntity(L, vm)));
+			return 1;
+		}
+
+		static int LUA_setPosition(lua_State* L) {
+			ParallelVM& vm = getVM(L);
+			Command& cmd = vm.m_commands.emplace();
+			cmd.type = CommandType::SET_POSITION;
+			cmd.entity = checkEntity(L, vm);
+			cmd.position = LuaWrapper::checkArg<DVec3>(L, 2);
+			return 0;
+		}
+
+		static int LUA_setRotation(lua_State* L) {
+			ParallelVM& vm = getVM(L);
+			Command& cmd = vm.m_commands.emplace();
+			cmd.type = CommandType::SET_ROTATION;
+			cmd.entity = checkEntity(L, vm);
+			cmd.rotation = LuaWrapper::checkArg<Quat>(L, 2);
+			return 0;
+		}
+
+		static int LUA_setScale(lua_State* L) {
+			ParallelVM& vm = getVM(L);
+			Command& cmd = vm.m_commands.emplace();
+			cmd.type = CommandType::SET_SCALE;
+			cmd.entity = checkEntity(L, vm);
+			cmd.scale = LuaWrapper::checkArg<Vec3>(L, 2);
+			return 0;
+		}
+
+		static int LUA_destroyEntity(lua_State* L) {
+			ParallelVM& vm = getVM(L);
+			Command& cmd = vm.m_commands.emplace();
+			cmd.type = CommandType::DESTROY_ENTITY;
+			cmd.entity = checkEntity(L, vm);
+			return 0;
+		}
+
+		// runs on a worker
+		void update(float time_delta) {
+			PROFILE_BLOCK("parallel lua update");
+			lua_State* L = m_state;
+			for (const Update& update : m_updates) {
+				if (!m_world.isEntityActive(update.entity)) continue;
+				LuaWrapper::pushRef(L, update.function);
+				lua_pushnumber(L, time_delta);
+				LuaWrapper::pcall(L, 1, 0);
+			}
+		}
+
+		void removeUpdate(i32 idx) {
+			LuaWrapper::releaseRef(m_state, m_updates[idx].function);
+			LuaWrapper::releaseRef(m_state, m_updates[idx].environment);
+			m_updates.swapAndPop(idx);
+		}
+
+		World& m_world;
+		lua_State* m_state;
+		Array<Command> m_commands;
+		Array<Update> m_updates;
 	};
 
 	struct ScriptComponent;
@@ -400,6 +724,7 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 		lua_State* m_state = nullptr;
 		int m_environment = -1;
 		int m_thread_ref = -1;
+		u8 m_memory_category = 0; // see LuaScriptSystemImpl::getMemoryCategory
 	};
 
 	struct ScriptInstance : ScriptEnvironment {
@@ -457,6 +782,7 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 			m_environment = rhs.m_environment;
 			m_thread_ref = rhs.m_thread_ref;
 			m_state = rhs.m_state;
+			m_memory_category = rhs.m_memory_category;
 			rhs.m_script = nullptr;
 			rhs.m_flags = Flags(rhs.m_flags | MOVED_FROM);
 		}
@@ -469,6 +795,7 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 			m_cmp = rhs.m_cmp;
 			m_script = rhs.m_script;
 			m_state = rhs.m_state;
+			m_memory_category = rhs.m_memory_category;
 			m_flags = rhs.m_flags;
 			rhs.m_script = nullptr;
 			rhs.m_flags = Flags(rhs.m_flags | MOVED_FROM);
@@ -820,8 +1147,13 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 		, m_scripts(system.m_allocator)
 		, m_inline_scripts(system.m_allocator)
 		, m_updates(system.m_allocator)
+		, m_update_names(system.m_allocator)
+		, m_update_memory_categories(system.m_allocator)
+		, m_parallel_vms(system.m_allocator)
 		, m_input_handlers(system.m_allocator)
 		, m_timers(system.m_allocator)
+		, m_timer_heap(system.m_allocator)
+		, m_timer_owners(system.m_allocator)
 		, m_property_names(system.m_allocator)
 		, m_is_game_running(false)
 		, m_is_api_registered(false)
@@ -905,6 +1237,12 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 	}
 
 	~LuaScriptModuleImpl() {
+		clearUpdates();
+		clearTimers();
+		lua_State* L = m_system.m_state;
+		if (m_update_batch_ref != -1) LuaWrapper::releaseRef(L, m_update_batch_ref);
+		if (m_update_groups_ref != -1) LuaWrapper::releaseRef(L, m_update_groups_ref);
+		if (m_dispatch_updates_ref != -1) LuaWrapper::releaseRef(L, m_dispatch_updates_ref);
 		Path invalid_path;
 		for (auto* script_cmp : m_scripts) {
 			ASSERT(script_cmp);
@@ -1066,9 +1404,12 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 		}
 		lua_getfield(instance.m_state, -1, "update");
 		if (lua_type(instance.m_state, -1) == LUA_TFUNCTION) {
-			auto& update_data = module->m_updates.emplace();
-			update_data.state = instance.m_state;
-			update_data.environment = instance.m_environment;
+			if (instance.m_script && instance.m_script->isParallel()) {
+				module->addParallelUpdate(entity, instance, *instance.m_script);
+			}
+			else {
+				module->addUpdate(instance.m_state, entity, instance.m_script ? instance.m_script->getPath().c_str() : "", instance.m_memory_category);
+			}
 		}
 		lua_pop(instance.m_state, 1);
 		lua_getfield(instance.m_state, -1, "onInputEvent");
@@ -1076,6 +1417,7 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 			auto& callback = module->m_input_handlers.emplace();
 			callback.state = instance.m_state;
 			callback.environment = instance.m_environment;
+			callback.entity = entity;
 		}
 		lua_pop(instance.m_state, 1);
 		lua_pop(instance.m_state, 1);
@@ -1184,34 +1526,136 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 		return 1;
 	}
 
-	void cancelTimer(int timer_func)
+	void cancelTimer(u32 handle)
 	{
-		for (int i = 0, c = m_timers.size(); i < c; ++i)
-		{
-			if (m_timers[i].func == timer_func)
-			{
-				m_timers.swapAndPop(i);
-				break;
-			}
+		const u32 slot = handle & TIMER_SLOT_MASK;
+		if (slot >= (u32)m_timers.size()) return;
+		const Timer& timer = m_timers[slot];
+		if (!timer.active || (timer.generation << TIMER_SLOT_BITS) != (handle & ~TIMER_SLOT_MASK)) return;
+		releaseTimer(slot);
+	}
+
+	// expects the function or the coroutine on the top of the stack
+	u32 scheduleTimer(lua_State* L, float time, const void* owner, bool is_coroutine) {
+		u32 slot = m_first_free_timer;
+		if (slot == INVALID_TIMER) {
+			slot = m_timers.size();
+			if (slot > TIMER_SLOT_MASK) luaL_error(L, "Too many timers");
+			m_timers.emplace();
+		}
+		else {
+			m_first_free_timer = m_timers[slot].next;
+		}
+
+		Timer& timer = m_timers[slot];
+		timer.ref = LuaWrapper::createRef(L);
+		timer.owner = owner;
+		timer.is_coroutine = is_coroutine;
+		timer.active = true;
+		timer.prev = INVALID_TIMER;
+		auto iter = m_timer_owners.find(owner);
+		if (iter.isValid()) {
+			timer.next = iter.value();
+			m_timers[timer.next].prev = slot;
+			iter.value() = slot;
+		}
+		else {
+			timer.next = INVALID_TIMER;
+			m_timer_owners.insert(owner, slot);
+		}
+
+		m_timer_heap.push({m_timer_time + time, slot, timer.generation});
+		u32 i = m_timer_heap.size() - 1;
+		while (i > 0) {
+			const u32 parent = (i - 1) / 2;
+			if (m_timer_heap[parent].time <= m_timer_heap[i].time) break;
+			swap(m_timer_heap[parent], m_timer_heap[i]);
+			i = parent;
+		}
+		return slot | ((timer.generation << TIMER_SLOT_BITS) & ~TIMER_SLOT_MASK);
+	}
+
+	void releaseTimer(u32 slot) {
+		Timer& timer = m_timers[slot];
+		LuaWrapper::releaseRef(m_system.m_state, timer.ref);
+		if (timer.prev != INVALID_TIMER) m_timers[timer.prev].next = timer.next;
+		else if (timer.next != INVALID_TIMER) m_timer_owners[timer.owner] = timer.next;
+		else m_timer_owners.erase(timer.owner);
+		if (timer.next != INVALID_TIMER) m_timers[timer.next].prev = timer.prev;
+
+		timer.active = false;
+		timer.ref = -1;
+		++timer.generation;
+		timer.next = m_first_free_timer;
+		m_first_free_timer = slot;
+	}
+
+	void popTimerHeap() {
+		m_timer_heap[0] = m_timer_heap.back();
+		m_timer_heap.pop();
+		const u32 size = m_timer_heap.size();
+		u32 i = 0;
+		for (;;) {
+			const u32 left = i * 2 + 1;
+			if (left >= size) break;
+			const u32 right = left + 1;
+			const u32 child = right < size && m_timer_heap[right].time < m_timer_heap[left].time ? right : left;
+			if (m_timer_heap[i].time <= m_timer_heap[child].time) break;
+			swap(m_timer_heap[i], m_timer_heap[child]);
+			i = child;
 		}
 	}
 
+	void clearTimers() {
+		for (u32 i = 0, c = m_timers.size(); i < c; ++i) {
+			if (m_timers[i].active) LuaWrapper::releaseRef(m_system.m_state, m_timers[i].ref);
+		}
+		m_timers.clear();
+		m_timer_heap.clear();
+		m_timer_owners.clear();
+		m_first_free_timer = INVALID_TIMER;
+	}
 
+	// timers are released with the script whose environment was active when they were scheduled
+	static const void* getTimerOwner(lua_State* L, int fn_idx) {
+		lua_getfenv(L, fn_idx);
+		const void* owner = lua_topointer(L, -1);
+		lua_pop(L, 1);
+		return owner;
+	}
+
+	// LuaScript.setTimer(module, seconds, function) -> handle
 	static int setTimer(lua_State* L)
 	{
 		auto* module = LuaWrapper::checkArg<LuaScriptModuleImpl*>(L, 1);
 		float time = LuaWrapper::checkArg<float>(L, 2);
 		if (!lua_isfunction(L, 3)) LuaWrapper::argError(L, 3, "function");
-		TimerData& timer = module->m_timers.emplace();
-		timer.time = time;
-		timer.state = L;
 		lua_pushvalue(L, 3);
-		timer.func = LuaWrapper::createRef(L);
+		const u32 handle = module->scheduleTimer(L, time, getTimerOwner(L, 3), false);
 		lua_pop(L, 1);
-		LuaWrapper::push(L, timer.func);
+		LuaWrapper::push(L, handle);
 		return 1;
 	}
 
+	// LuaScript.wait(module, seconds), suspends the calling coroutine, it's resumed after `seconds`
+	static int wait(lua_State* L)
+	{
+		auto* module = LuaWrapper::checkArg<LuaScriptModuleImpl*>(L, 1);
+		float time = LuaWrapper::checkArg<float>(L, 2);
+		if (!lua_isyieldable(L)) luaL_error(L, "wait can be called only from a coroutine");
+
+		lua_Debug ar;
+		const void* owner = nullptr;
+		if (lua_getinfo(L, 1, "f", &ar)) { // [caller]
+			owner = getTimerOwner(L, -1);
+			lua_pop(L, 1);
+		}
+		lua_pushthread(L);
+		module->scheduleTimer(L, time, owner, true);
+		lua_pop(L, 1);
+		return lua_yield(L, 0);
+	}
+
 
 	void registerAPI() {
 		if (m_is_api_registered) return;
@@ -1234,6 +1678,7 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 		LuaWrapper::createSystemFunction(L, "LuaScript", "rescan", &LuaScriptModuleImpl::rescan);
 		LuaWrapper::createSystemFunction(L, "LuaScript", "cancelTimer", &LuaWrapper::wrapMethod<&LuaScriptModuleImpl::cancelTimer>); 
 		LuaWrapper::createSystemFunction(L, "LuaScript", "setTimer", &LuaScriptModuleImpl::setTimer);
+		LuaWrapper::createSystemFunction(L, "LuaScript", "wait", &LuaScriptModuleImpl::wait);
 	}
 
 
@@ -1343,25 +1788,33 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 	void disableScript(ScriptEnvironment& inst)
 	{
 		if (!inst.m_state) return;
-		for (int i = 0; i < m_timers.size(); ++i)
-		{
-			if (m_timers[i].state == inst.m_state)
-			{
-				LuaWrapper::releaseRef(m_timers[i].state, m_timers[i].func);
-				m_timers.swapAndPop(i);
-				--i;
-			}
+		lua_rawgeti(inst.m_state, LUA_REGISTRYINDEX, inst.m_environment); // [env]
+		const void* owner = lua_topointer(inst.m_state, -1);
+		lua_pop(inst.m_state, 1); // []
+		for (auto iter = m_timer_owners.find(owner); iter.isValid(); iter = m_timer_owners.find(owner)) {
+			releaseTimer(iter.value());
 		}
 
 		for (int i = 0; i < m_updates.size(); ++i)
 		{
 			if (m_updates[i].state == inst.m_state)
 			{
+				LuaWrapper::releaseRef(m_updates[i].state, m_updates[i].function);
 				m_updates.swapAndPop(i);
+				m_updates_sorted = false;
 				break;
 			}
 		}
 
+		for (UniquePtr<ParallelVM>& vm : m_parallel_vms) {
+			for (i32 i = 0; i < vm->m_updates.size(); ++i) {
+				if (vm->m_updates[i].owner == inst.m_state) {
+					vm->removeUpdate(i);
+					break;
+				}
+			}
+		}
+
 		for (int i = 0; i < m_input_handlers.size(); ++i)
 		{
 			if (m_input_handlers[i].state == inst.m_state)
@@ -1390,17 +1843,152 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 
 	void startScript(EntityRef entity, InlineScriptComponent& instance, bool is_reload) {
 		instance.runSource();
-		startScriptInternal(entity, instance, is_reload);
+		startScriptInternal(entity, instance, is_reload, "inline script");
 	}
 
 	void startScript(EntityRef entity, ScriptInstance& instance, bool is_reload) {
 		if (!(instance.m_flags & ScriptInstance::ENABLED)) return;
 			
 		if (is_reload) disableScript(instance);
-		startScriptInternal(entity, instance, is_reload);
+		LuaScript* parallel_script = instance.m_script && instance.m_script->isParallel() ? instance.m_script : nullptr;
+		startScriptInternal(entity, instance, is_reload, instance.m_script ? instance.m_script->getPath().c_str() : "", parallel_script);
 	}
 
-	void startScriptInternal(EntityRef entity, ScriptEnvironment& instance, bool is_reload)
+	// runs a copy of `script` in the least loaded worker VM, main instance's properties are copied to the copy
+	void addParallelUpdate(EntityRef entity, const ScriptEnvironment& inst, LuaScript& script) {
+		if (m_parallel_vms.empty()) {
+			for (u8 i = 0, c = jobs::getWorkersCount(); i < c; ++i) {
+				m_parallel_vms.push(UniquePtr<ParallelVM>::create(m_system.m_allocator, m_world, m_system.m_allocator));
+			}
+		}
+		ParallelVM* vm = m_parallel_vms[0].get();
+		for (UniquePtr<ParallelVM>& iter : m_parallel_vms) {
+			if (iter->m_updates.size() < vm->m_updates.size()) vm = iter.get();
+		}
+
+		lua_State* L = vm->m_state;
+		LuaWrapper::DebugGuard guard(L);
+		lua_newtable(L); // [env]
+		lua_pushvalue(L, -1); // [env, env]
+		lua_setmetatable(L, -2); // [env]
+		lua_pushvalue(L, LUA_GLOBALSINDEX); // [env, _G]
+		lua_setfield(L, -2, "__index"); // [env]
+		lua_pushinteger(L, entity.index); // [env, entity]
+		lua_setfield(L, -2, "this"); // [env]
+
+		const StringView src = script.getSourceCode();
+		if (LuaWrapper::luaL_loadbuffer(L, src.begin, src.size(), script.getPath().c_str()) != 0) { // [env, func] | [env, error]
+			logError(script.getPath(), ": ", lua_tostring(L, -1));
+			lua_pop(L, 2);
+			return;
+		}
+		lua_pushvalue(L, -2); // [env, func, env]
+		lua_setfenv(L, -2); // [env, func]
+		if (!LuaWrapper::pcall(L, 0, 0)) { // [env]
+			lua_pop(L, 1);
+			return;
+		}
+
+		// entities are plain indices in parallel VMs
+		lua_State* main_state = inst.m_state;
+		lua_rawgeti(main_state, LUA_REGISTRYINDEX, inst.m_environment); // main: [env]
+		lua_pushnil(main_state); // main: [env, nil]
+		while (lua_next(main_state, -2)) { // main: [env, key, value]
+			if (lua_type(main_state, -2) != LUA_TSTRING) {
+				lua_pop(main_state, 1);
+				continue;
+			}
+			bool copied = true;
+			switch (lua_type(main_state, -1)) {
+				case LUA_TNUMBER: lua_pushnumber(L, lua_tonumber(main_state, -1)); break;
+				case LUA_TBOOLEAN: lua_pushboolean(L, lua_toboolean(main_state, -1)); break;
+				case LUA_TSTRING: lua_pushstring(L, lua_tostring(main_state, -1)); break;
+				case LUA_TTABLE:
+					copied = LuaWrapper::getField(main_state, -1, "_entity") == LUA_TNUMBER;
+					if (copied) lua_pushinteger(L, lua_tointeger(main_state, -1));
+					lua_pop(main_state, 1);
+					break;
+				default: copied = false; break;
+			}
+			if (copied) lua_setfield(L, -2, lua_tostring(main_state, -2));
+			lua_pop(main_state, 1); // main: [env, key]
+		}
+		lua_pop(main_state, 1); // main: []
+
+		if (LuaWrapper::getField(L, -1, "update") != LUA_TFUNCTION) { // [env, update]
+			lua_pop(L, 2);
+			return;
+		}
+		ParallelVM::Update& update = vm->m_updates.emplace();
+		update.owner = inst.m_state;
+		update.entity = entity;
+		update.function = LuaWrapper::createRef(L);
+		lua_pop(L, 1); // [env]
+		update.environment = LuaWrapper::createRef(L);
+		lua_pop(L, 1); // []
+	}
+
+	void updateParallel(float time_delta) {
+		if (m_parallel_vms.empty()) return;
+		PROFILE_FUNCTION();
+
+		// a VM is never updated by two workers at once
+		jobs::forEach(m_parallel_vms.size(), 1, [&](i32 from, i32 to){
+			for (i32 i = from; i < to; ++i) m_parallel_vms[i]->update(time_delta);
+		});
+
+		// VMs are processed in fixed order, so the result does not depend on scheduling
+		for (UniquePtr<ParallelVM>& vm : m_parallel_vms) {
+			for (const ParallelVM::Command& cmd : vm->m_commands) {
+				if (!m_world.hasEntity(cmd.entity)) continue;
+				switch (cmd.type) {
+					case ParallelVM::CommandType::SET_POSITION: m_world.setPosition(cmd.entity, cmd.position); break;
+					case ParallelVM::CommandType::SET_ROTATION: m_world.setRotation(cmd.entity, cmd.rotation); break;
+					case ParallelVM::CommandType::SET_SCALE: m_world.setScale(cmd.entity, cmd.scale); break;
+					case ParallelVM::CommandType::DESTROY_ENTITY:
+						if (m_deferred_destructions.indexOf(cmd.entity) < 0) m_deferred_destructions.push(cmd.entity);
+						break;
+				}
+			}
+			vm->m_commands.clear();
+		}
+	}
+
+	// expects the update function on the top of `state`'s stack
+	void addUpdate(lua_State* state, EntityRef entity, const char* name, u8 memory_category) {
+		UpdateData& update_data = m_updates.emplace();
+		update_data.state = state;
+		update_data.entity = entity;
+		update_data.function = LuaWrapper::createRef(state);
+		update_data.name = m_update_names.size();
+		for (i32 i = 0; i < m_update_names.size(); ++i) {
+			if (m_update_names[i] == name) {
+				update_data.name = i;
+				break;
+			}
+		}
+		if (update_data.name == (u32)m_update_names.size()) {
+			m_update_names.emplace(name, m_system.m_allocator);
+			m_update_memory_categories.push(memory_category);
+		}
+		m_updates_sorted = false;
+	}
+
+	void clearUpdates() {
+		for (const UpdateData& update : m_updates) {
+			LuaWrapper::releaseRef(update.state, update.function);
+		}
+		m_updates.clear();
+		m_update_names.clear();
+		m_update_memory_categories.clear();
+		for (UniquePtr<ParallelVM>& vm : m_parallel_vms) {
+			while (!vm->m_updates.empty()) vm->removeUpdate(vm->m_updates.size() - 1);
+			vm->m_commands.clear();
+		}
+	}
+
+	// update of `parallel_script` runs in worker VMs instead of `instance`
+	void startScriptInternal(EntityRef entity, ScriptEnvironment& instance, bool is_reload, const char* name, LuaScript* parallel_script = nullptr)
 	{
 		if (!instance.m_state) return;
 			
@@ -1414,9 +2002,8 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 		lua_getfield(instance.m_state, -1, "update");
 		if (lua_type(instance.m_state, -1) == LUA_TFUNCTION)
 		{
-			auto& update_data = m_updates.emplace();
-			update_data.state = instance.m_state;
-			update_data.environment = instance.m_environment;
+			if (parallel_script) addParallelUpdate(entity, instance, *parallel_script);
+			else addUpdate(instance.m_state, entity, name, instance.m_memory_category);
 		}
 		lua_pop(instance.m_state, 1);
 		lua_getfield(instance.m_state, -1, "onInputEvent");
@@ -1425,6 +2012,7 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 			auto& callback = m_input_handlers.emplace();
 			callback.state = instance.m_state;
 			callback.environment = instance.m_environment;
+			callback.entity = entity;
 		}
 		lua_pop(instance.m_state, 1);
 
@@ -1509,9 +2097,9 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 		}
 		m_gui_module = nullptr;
 		m_is_game_running = false;
-		m_updates.clear();
+		clearUpdates();
 		m_input_handlers.clear();
-		m_timers.clear();
+		clearTimers();
 	}
 
 	void createInlineScript(EntityRef entity) override {
@@ -1792,39 +2380,34 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 
 	void updateTimers(float time_delta)
 	{
-		int timers_to_remove[1024];
-		u32 timers_to_remove_count = 0;
-		for (int i = 0, c = m_timers.size(); i < c; ++i)
-		{
-			auto& timer = m_timers[i];
-			timer.time -= time_delta;
-			if (timer.time < 0)
-			{
-				lua_rawgeti(timer.state, LUA_REGISTRYINDEX, timer.func);
-				if (lua_type(timer.state, -1) != LUA_TFUNCTION)
-				{
-					ASSERT(false);
-				}
-
-				if (lua_pcall(timer.state, 0, 0, 0) != 0)
-				{
-					logError(lua_tostring(timer.state, -1));
-					lua_pop(timer.state, 1);
-				}
-				timers_to_remove[timers_to_remove_count] = i;
-				++timers_to_remove_count;
-				if (timers_to_remove_count >= lengthOf(timers_to_remove))
-				{
-					logError("Too many lua timers in one frame, some are not executed");
-					break;
+		PROFILE_FUNCTION();
+		m_timer_time += time_delta;
+		lua_State* L = m_system.m_state;
+		// timers scheduled while we are here have time >= m_timer_time, so they wait for the next frame
+		while (!m_timer_heap.empty() && m_timer_heap[0].time < m_timer_time) {
+			const TimerHeapEntry entry = m_timer_heap[0];
+			popTimerHeap();
+			const Timer& timer = m_timers[entry.slot];
+			if (!timer.active || timer.generation != entry.generation) continue;
+
+			// release the timer before it's called, since it can schedule or cancel timers
+			const bool is_coroutine = timer.is_coroutine;
+			LuaWrapper::pushRef(L, timer.ref); // [fn|coroutine]
+			releaseTimer(entry.slot);
+			if (is_coroutine) {
+				lua_State* co = lua_tothread(L, -1);
+				// the coroutine could be resumed by someone else in the meantime
+				if (lua_status(co) == LUA_YIELD) {
+					const int status = lua_resume(co, L, 0);
+					if (status != LUA_OK && status != LUA_YIELD) {
+						logError(lua_tostring(co, -1));
+					}
 				}
+				lua_pop(L, 1); // []
+			}
+			else {
+				LuaWrapper::pcall(L, 0, 0); // []
 			}
-		}
-		for (u32 i = timers_to_remove_count - 1; i != 0xffFFffFF; --i)
-		{
-			auto& timer = m_timers[timers_to_remove[i]];
-			LuaWrapper::releaseRef(timer.state, timer.func);
-			m_timers.swapAndPop(timers_to_remove[i]);
 		}
 	}
 
@@ -1904,12 +2487,111 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 		Span<const InputSystem::Event> events = input_system.getEvents();
 		for (const InputSystem::Event& e : events) {
 			for (const CallbackData& cb : m_input_handlers) {
+				if (!m_world.isEntityActive(cb.entity)) continue;
 				processInputEvent(cb, e);
 			}
 		}
 	}
 
 
+	static int beginUpdateGroup(lua_State* L) {
+		auto* module = (LuaScriptModuleImpl*)lua_tolightuserdata(L, lua_upvalueindex(1));
+		const u32 group = LuaWrapper::checkArg<u32>(L, 1);
+		profiler::beginBlock("lua update");
+		profiler::pushString(module->m_update_names[group].c_str());
+		// allocations in updates are attributed to the script
+		lua_setmemcat(L, module->m_update_memory_categories[group]);
+		return 0;
+	}
+
+	static int endUpdateGroup(lua_State* L) {
+		lua_setmemcat(L, 0);
+		profiler::endBlock();
+		return 0;
+	}
+
+	// all update functions are called from a single lua loop, so there's only one C -> lua transition per frame
+	// (lua) pcall per update keeps other scripts running if one fails
+	bool createUpdateDispatcher() {
+		static const char* src = R"#(
+			return function(updates, groups, group_count, time_delta, begin_group, end_group)
+				local i = 1
+				for g = 1, group_count, 2 do
+					local last = groups[g + 1]
+					begin_group(groups[g])
+					while i <= last do
+						local ok, err = xpcall(updates[i], debug.traceback, time_delta)
+						if not ok then LumixAPI.logError(err) end
+						i = i + 1
+					end
+					end_group()
+				end
+			end
+		)#";
+
+		lua_State* L = m_system.m_state;
+		if (!LuaWrapper::execute(L, StringView(src), "update dispatcher", 1)) return false;
+		m_dispatch_updates_ref = LuaWrapper::createRef(L);
+		lua_pop(L, 1);
+		lua_newtable(L);
+		m_update_batch_ref = LuaWrapper::createRef(L);
+		lua_pop(L, 1);
+		lua_newtable(L);
+		m_update_groups_ref = LuaWrapper::createRef(L);
+		lua_pop(L, 1);
+		return true;
+	}
+
+	void dispatchUpdates(float time_delta) {
+		PROFILE_FUNCTION();
+		if (m_updates.empty()) return;
+		if (m_dispatch_updates_ref == -1 && !createUpdateDispatcher()) return;
+
+		if (!m_updates_sorted) {
+			sort(m_updates.begin(), m_updates.end(), [](const UpdateData& a, const UpdateData& b){ return a.name < b.name; });
+			m_updates_sorted = true;
+		}
+
+		lua_State* L = m_system.m_state;
+		LuaWrapper::DebugGuard guard(L);
+		LuaWrapper::pushRef(L, m_dispatch_updates_ref); // [dispatch]
+		LuaWrapper::pushRef(L, m_update_batch_ref); // [dispatch, updates]
+		LuaWrapper::pushRef(L, m_update_groups_ref); // [dispatch, updates, groups]
+
+		// collect update functions of active entities, group is a pair (name, index of its last update)
+		u32 count = 0;
+		u32 groups_count = 0;
+		auto end_group = [&](u32 name){
+			lua_pushinteger(L, name);
+			lua_rawseti(L, -2, ++groups_count);
+			lua_pushinteger(L, count);
+			lua_rawseti(L, -2, ++groups_count);
+		};
+		u32 group = 0;
+		for (const UpdateData& update : m_updates) {
+			if (!m_world.isEntityActive(update.entity)) continue;
+
+			if (count > 0 && update.name != group) end_group(group);
+			group = update.name;
+			LuaWrapper::pushRef(L, update.function);
+			lua_rawseti(L, -3, ++count);
+		}
+		if (count > 0) end_group(group);
+		// release functions from previous frame
+		for (u32 i = count + 1; i <= m_update_batch_size; ++i) {
+			lua_pushnil(L);
+			lua_rawseti(L, -3, i);
+		}
+		m_update_batch_size = count;
+
+		lua_pushinteger(L, groups_count); // [dispatch, updates, groups, group_count]
+		lua_pushnumber(L, time_delta); // [dispatch, updates, groups, group_count, time_delta]
+		lua_pushlightuserdata(L, this);
+		lua_pushcclosure(L, &LuaScriptModuleImpl::beginUpdateGroup, "beginUpdateGroup", 1);
+		lua_pushcfunction(L, &LuaScriptModuleImpl::endUpdateGroup, "endUpdateGroup");
+		LuaWrapper::pcall(L, 6, 0);
+	}
+
 	void update(float time_delta) override
 	{
 		PROFILE_FUNCTION();
@@ -1920,26 +2602,8 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 		processInputEvents();
 		updateTimers(time_delta);
 
-		for (int i = 0; i < m_updates.size(); ++i)
-		{
-			CallbackData update_item = m_updates[i];
-			LuaWrapper::DebugGuard guard(update_item.state, 0);
-			lua_rawgeti(update_item.state, LUA_REGISTRYINDEX, update_item.environment);
-			if (lua_type(update_item.state, -1) != LUA_TTABLE)
-			{
-				ASSERT(false);
-			}
-			lua_getfield(update_item.state, -1, "update");
-			if (lua_type(update_item.state, -1) != LUA_TFUNCTION)
-			{
-				lua_pop(update_item.state, 2);
-				continue;
-			}
-
-			lua_pushnumber(update_item.state, time_delta);
-			LuaWrapper::pcall(update_item.state, 1, 0);
-			lua_pop(update_item.state, 1);
-		}
+		dispatchUpdates(time_delta);
+		updateParallel(time_delta);
 
 		for (EntityRef e : m_deferred_destructions) {
 			m_world.destroyEntity(e);
@@ -2208,8 +2872,24 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 	Array<CallbackData> m_input_handlers;
 	World& m_world;
 	Array<DeferredStart> m_to_start;
-	Array<CallbackData> m_updates;
-	Array<TimerData> m_timers;
+	Array<UpdateData> m_updates;
+	// names of scripts with update, for profiler
+	Array<String> m_update_names;
+	Array<u8> m_update_memory_categories; // parallel to m_update_names
+	// m_updates are grouped by name
+	bool m_updates_sorted = true;
+	LuaWrapper::RefHandle m_update_batch_ref = -1;
+	LuaWrapper::RefHandle m_update_groups_ref = -1;
+	LuaWrapper::RefHandle m_dispatch_updates_ref = -1;
+	u32 m_update_batch_size = 0;
+	// one per worker, created with the first parallel script
+	Array<UniquePtr<ParallelVM>> m_parallel_vms;
+	Array<Timer> m_timers;
+	Array<TimerHeapEntry> m_timer_heap;
+	// first timer of each owner
+	HashMap<const void*, u32> m_timer_owners;
+	u32 m_first_free_timer = INVALID_TIMER;
+	double m_timer_time = 0;
 	FunctionCall m_function_call;
 	ScriptInstance* m_current_script_instance;
 	bool m_is_api_registered = false;
@@ -2250,6 +2930,8 @@ void LuaScriptModuleImpl::ScriptInstance::onScriptLoaded(LuaScriptModuleImpl& mo
 	LuaWrapper::DebugGuard guard(m_state);
 		
 	bool is_reload = m_flags & LOADED;
+	m_memory_category = module.m_system.getMemoryCategory(m_script->getPath());
+	lua_setmemcat(m_state, m_memory_category);
 		
 	lua_rawgeti(m_state, LUA_REGISTRYINDEX, m_environment); // [env]
 	ASSERT(lua_type(m_state, -1) == LUA_TTABLE);
@@ -2490,13 +3172,27 @@ LuaScriptSystemImpl::LuaScriptSystemImpl(Engine& engine)
 	, m_script_manager(m_allocator)
 	, m_lua_allocator(engine.getAllocator(), "luau")
 	, m_lua_resources(m_allocator)
+	, m_memory_categories(m_allocator)
 {
+	char cmd_line[2048];
+	os::getCommandLine(Span(cmd_line));
+	CommandLineParser parser(cmd_line);
+	while (parser.next()) {
+		if (!parser.currentEquals("-lua_gc_budget")) continue;
+		if (!parser.next()) break;
+		char tmp[32];
+		parser.getCurrent(tmp, sizeof(tmp));
+		fromCString(tmp, m_gc_budget_us);
+		break;
+	}
+
 	#ifdef _WIN32
 		m_state = lua_newstate(luaAlloc, this);
 	#else 
 		m_state = luaL_newstate();
 	#endif
 	luaL_openlibs(m_state);
+	LuaWrapper::setVectorMetatable(m_state);
 	
 	lua_State* L = m_state;
 	lua_pushlightuserdata(L, &engine);
@@ -212,6 +212,31 @@ int luaL_loadbuffer(lua_State* L, const char* buff, size_t size, const char* nam
 	return res;
 }
 
+static int vectorIndex(lua_State* L) {
+	const float* v = lua_tovector(L, 1);
+	const int i = luaL_checkinteger(L, 2);
+	if (i < 1 || i > 3) return 0;
+	lua_pushnumber(L, v[i - 1]);
+	return 1;
+}
+
+static int vectorLen(lua_State* L) {
+	lua_pushinteger(L, 3);
+	return 1;
+}
+
+void setVectorMetatable(lua_State* L) {
+	lua_pushvector(L, 0, 0, 0); // [vec]
+	lua_newtable(L); // [vec, mt]
+	lua_pushcfunction(L, vectorIndex, "vectorIndex"); // [vec, mt, fn]
+	lua_setfield(L, -2, "__index"); // [vec, mt]
+	lua_pushcfunction(L, vectorLen, "vectorLen"); // [vec, mt, fn]
+	lua_setfield(L, -2, "__len"); // [vec, mt]
+	// metatable is shared by all vectors
+	lua_setmetatable(L, -2); // [vec]
+	lua_pop(L, 1); // []
+}
+
 void releaseRef(lua_State* L, RefHandle ref) { lua_unref(L, ref); }
 RefHandle createRef(lua_State* L) { return lua_ref(L, -1); }
 void pushRef(lua_State* L, RefHandle ref) { lua_rawgeti(L, LUA_REGISTRYINDEX, ref); }
@@ -79,6 +79,9 @@ T* getClosureObject(lua_State* L) {
 
 int luaL_loadbuffer(lua_State* L, const char* buff, size_t size, const char* name);
 void pushObject(lua_State* L, void* obj, StringView type_name);
+// Vec3 and DVec3 are pushed as native vectors, which do not allocate
+// this makes them indexable by [1], [2], [3] too, so scripts can treat them as {x, y, z} tables
+void setVectorMetatable(lua_State* L);
 
 template <typename T> inline bool isType(lua_State* L, int index)
 {
@@ -121,16 +124,17 @@ template <> inline bool isType<ComponentType>(lua_State* L, int index)
 }
 template <> inline bool isType<Vec3>(lua_State* L, int index)
 {
-	return lua_istable(L, index) != 0 && lua_objlen(L, index) == 3;
+	return lua_isvector(L, index) || lua_istable(L, index) != 0 && lua_objlen(L, index) == 3;
 }
 template <> inline bool isType<Color>(lua_State* L, int index) {
+	if (lua_isvector(L, index)) return true;
 	if (lua_istable(L, index) == 0) return false;
 	const i32 len = lua_objlen(L, index);
 	return len == 3 || len == 4;
 }
 template <> inline bool isType<DVec3>(lua_State* L, int index)
 {
-	return lua_istable(L, index) != 0 && lua_objlen(L, index) == 3;
+	return lua_isvector(L, index) || lua_istable(L, index) != 0 && lua_objlen(L, index) == 3;
 }
 template <> inline bool isType<Vec4>(lua_State* L, int index)
 {
@@ -214,6 +218,7 @@ template <> inline EntityPtr toType(lua_State* L, int index) {
 }
 
 template <> inline Vec3 toType(lua_State* L, int index) {
+	if (const float* vec = lua_tovector(L, index)) return Vec3(vec[0], vec[1], vec[2]);
 	Vec3 v;
 	lua_rawgeti(L, index, 1);
 	v.x = (float)lua_tonumber(L, -1);
@@ -242,6 +247,7 @@ template <> inline IVec3 toType(lua_State* L, int index) {
 }
 
 template <> inline DVec3 toType(lua_State* L, int index) {
+	if (const float* vec = lua_tovector(L, index)) return DVec3(vec[0], vec[1], vec[2]);
 	DVec3 v;
 	lua_rawgeti(L, index, 1);
 	v.x = (double)lua_tonumber(L, -1);
@@ -500,29 +506,11 @@ inline void push(lua_State* L, const IVec3& value)
 }
 inline void push(lua_State* L, const Vec3& value)
 {
-	lua_createtable(L, 3, 0);
-
-	lua_pushnumber(L, value.x);
-	lua_rawseti(L, -2, 1);
-
-	lua_pushnumber(L, value.y);
-	lua_rawseti(L, -2, 2);
-
-	lua_pushnumber(L, value.z);
-	lua_rawseti(L, -2, 3);
+	lua_pushvector(L, value.x, value.y, value.z);
 }
 inline void push(lua_State* L, const DVec3& value)
 {
-	lua_createtable(L, 3, 0);
-
-	lua_pushnumber(L, value.x);
-	lua_rawseti(L, -2, 1);
-
-	lua_pushnumber(L, value.y);
-	lua_rawseti(L, -2, 2);
-
-	lua_pushnumber(L, value.z);
-	lua_rawseti(L, -2, 3);
+	lua_pushvector(L, (float)value.x, (float)value.y, (float)value.z);
 }
 inline void push(lua_State* L, const Vec4& value)
 {
@@ -575,10 +575,14 @@ struct Parser {
 		StringView word = consumeWord(def);
 		StringView label;
 		StringView id;
+		bool is_hot = false;
 		while (word.size() > 0) {
 			if (equal(word, "icon")) {
 				icon = consumeWord(def);
 			}
+			else if (equal(word, "hot")) {
+				is_hot = true;
+			}
 			else if (equal(word, "name")) {
 				name = consumeWord(def);
 			}
@@ -620,6 +624,7 @@ struct Parser {
 			beginComponent(name, struct_name, makeStringView(id_str), label, icon);
 		}
 		defer { current_component = nullptr; };
+		current_component->is_hot = is_hot;
 		
 		while (readLine(line)) {
 			StringView def = find(line, "//@");
@@ -1465,6 +1470,7 @@ void formatCPP(OutputStream& out) {
 void serializeMain(OutputStream& out, Parser& parser) {
 	L("namespace Lumix {" OUT_ENDL);
 	L("void registerLuaAPI(lua_State* L) {");
+	L("	lua_callbacks(L)->useratom = luaAtom;");
 	L("	lua_newtable(L);");
 	L("	lua_setglobal(L, \"LumixModules\");");
 
@@ -1559,7 +1565,7 @@ void serializeLuaPropertySetter(OutputStream& out, Module& m, Component& c) {
 	L("auto [imodule, entity] = checkComponent(L);");
 	L("auto* module = (",m.name,"*)imodule;");
 	L("const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);");
-	L("XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));");
+	L("XXH64_hash_t name_hash = getPropertyHash(L, prop_name);");
 	L("switch (name_hash) {");
 	
 	bool is_array = false;
@@ -1569,7 +1575,12 @@ void serializeLuaPropertySetter(OutputStream& out, Module& m, Component& c) {
 		// TODO check collisions
 		XXH64_hash_t hash = XXH3_64bits(p.name.begin, p.name.size());
 		if (p.is_var) {
-			L("case /*",p.name,"*/",hash,": module->get",c.name,"(entity).",p.name," = LuaWrapper::checkArg<",p.type,">(L, 3); break;");
+			if (c.is_hot) {
+				L("case /*",p.name,"*/",hash,": { auto& s = module->get",c.name,"Storage(); s.",p.name,"[s.indexOf(entity)] = LuaWrapper::checkArg<",p.type,">(L, 3); break; }");
+			}
+			else {
+				L("case /*",p.name,"*/",hash,": module->get",c.name,"(entity).",p.name," = LuaWrapper::checkArg<",p.type,">(L, 3); break;");
+			}
 			continue;
 		}
 		
@@ -1629,7 +1640,7 @@ void serializeLuaArrayGetter(OutputStream& out, Module& m, Component& c, ArrayPr
 			auto* module = LuaWrapper::toType<GetterModule*>(L, lua_upvalueindex(1));
 			EntityRef entity = {LuaWrapper::toType<i32>(L, lua_upvalueindex(2))};
 			i32 index = LuaWrapper::toType<int>(L, lua_upvalueindex(3));
-			XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+			XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 			switch (name_hash) {
 	)#");
 
@@ -1657,7 +1668,7 @@ void serializeLuaArrayGetter(OutputStream& out, Module& m, Component& c, ArrayPr
 		auto setter = [](lua_State* L) -> int {
 			LuaWrapper::checkTableArg(L, 1);
 			const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);
-			XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));
+			XXH64_hash_t name_hash = getPropertyHash(L, prop_name);
 			auto* module = LuaWrapper::toType<GetterModule*>(L, lua_upvalueindex(1));
 			EntityRef entity = {LuaWrapper::toType<i32>(L, lua_upvalueindex(2))};
 			i32 index = LuaWrapper::toType<int>(L, lua_upvalueindex(3));
@@ -1735,7 +1746,7 @@ void serializeLuaPropertyGetter(OutputStream& out, Module& m, Component& c) {
 	}
 
 	L("const char* prop_name = LuaWrapper::checkArg<const char*>(L, 2);");
-	L("XXH64_hash_t name_hash = XXH3_64bits(prop_name, strlen(prop_name));");
+	L("XXH64_hash_t name_hash = getPropertyHash(L, prop_name);");
 	L("switch (name_hash) {");
 
 	for (ArrayProperty& a : c.arrays) {
@@ -1751,7 +1762,12 @@ void serializeLuaPropertyGetter(OutputStream& out, Module& m, Component& c) {
 		if (p.is_var) {
 			XXH64_hash_t hash = XXH3_64bits(p.name.begin, p.name.size());
 			out.add("case /*",p.name,"*/",hash, ": ");
-			L("LuaWrapper::push(L, module->get",c.name,"(entity).",p.name,"); break;");
+			if (c.is_hot) {
+				L("{ auto& s = module->get",c.name,"Storage(); LuaWrapper::push(L, s.",p.name,"[s.indexOf(entity)]); break; }");
+			}
+			else {
+				L("LuaWrapper::push(L, module->get",c.name,"(entity).",p.name,"); break;");
+			}
 			continue;
 		}
 		if (p.getter_name.size() == 0) continue;
@@ -1797,6 +1813,79 @@ void serializeLuaCAPI(OutputStream& out, Module& m) {
 	L("}" OUT_ENDL);
 }
 
+// emits table of all names accessors in serializeLuaCAPI switch on, strings with such names get index in the table as their atom
+// so accessors look up the hash instead of computing it
+void serializeLuaAtoms(OutputStream& out, Parser& parser) {
+	ExpArray<XXH64_hash_t> hashes(parser.allocator);
+	auto add = [&](StringView name){ hashes.emplace(XXH3_64bits(name.begin, name.size())); };
+	char tmp[256];
+	for (Module& m : parser.modules) {
+		for (Component& c : m.components) {
+			for (ArrayProperty& a : c.arrays) {
+				add(a.id);
+				for (Property& child : a.children) {
+					if (isBlob(child)) continue;
+					if (child.getter_name.size() == 0 && child.setter_name.size() == 0) continue;
+					toID(pickLabel(child.name, child.attributes.label), Span(tmp, tmp + 256));
+					add(makeStringView(tmp));
+				}
+			}
+			for (Property& p : c.properties) {
+				if (isBlob(p)) continue;
+				if (p.is_var) {
+					add(p.name);
+					continue;
+				}
+				if (p.getter_name.size() == 0) continue;
+				toID(pickLabel(p.name, p.attributes.label), Span(tmp, tmp + 255));
+				add(makeStringView(tmp));
+			}
+			for (Function& f : c.functions) {
+				add(pickLabel(f.name, f.attributes.alias));
+			}
+		}
+	}
+
+	XXH64_hash_t* sorted = (XXH64_hash_t*)parser.allocator.allocate(sizeof(XXH64_hash_t) * hashes.size);
+	for (i32 i = 0; i < hashes.size; ++i) sorted[i] = hashes[i];
+	qsort(sorted, hashes.size, sizeof(sorted[0]), [](const void* a, const void* b) -> int {
+		const XXH64_hash_t ha = *(const XXH64_hash_t*)a;
+		const XXH64_hash_t hb = *(const XXH64_hash_t*)b;
+		return ha < hb ? -1 : (ha > hb ? 1 : 0);
+	});
+
+	L("namespace Lumix {");
+	L("static const XXH64_hash_t lua_atom_hashes[] = {");
+	for (i32 i = 0; i < hashes.size; ++i) {
+		if (i > 0 && sorted[i] == sorted[i - 1]) continue;
+		L(sorted[i], ",");
+	}
+	L("};" OUT_ENDL);
+	out.add(R"#(// called by luau when a string is created, property names get their index in lua_atom_hashes
+	static int16_t luaAtom(const char* str, size_t len) {
+		const XXH64_hash_t hash = XXH3_64bits(str, len);
+		u32 from = 0;
+		u32 to = lengthOf(lua_atom_hashes);
+		while (from < to) {
+			const u32 mid = (from + to) / 2;
+			if (lua_atom_hashes[mid] < hash) from = mid + 1;
+			else to = mid;
+		}
+		if (from < lengthOf(lua_atom_hashes) && lua_atom_hashes[from] == hash) return (int16_t)from;
+		return -1;
+	}
+
+	// `prop_name` is the string at index 2
+	static XXH64_hash_t getPropertyHash(lua_State* L, const char* prop_name) {
+		int atom;
+		lua_tostringatom(L, 2, &atom);
+		if (atom >= 0) return lua_atom_hashes[atom];
+		return XXH3_64bits(prop_name, strlen(prop_name));
+	}
+)#");
+	L("}" OUT_ENDL);
+}
+
 StringView toLuaType(StringView ctype) {
 	if (equal(ctype, "void")) return makeStringView("()");
 
@@ -2095,8 +2184,79 @@ void serializeLuaTypes(OutputStream& out_formatted) {
 	}
 }
 
+// name the property is registered with in serializeReflection
+static StringView getReflectionLabel(const Property& prop, Span<char> tmp) {
+	if (prop.attributes.label.size() > 0) return prop.attributes.label;
+	toLabel(prop.name, tmp);
+	return makeStringView(tmp.begin);
+}
+
+// emits perfect hash table of top-level properties of `cmp`, so reflection::getProperty does not have to search by name
+// indices must match the order in which serializeReflection registers the properties
+static bool serializePropertyTable(OutputStream& out, Component& cmp) {
+	constexpr i32 MAX_SLOTS = 256;
+	XXH64_hash_t hashes[MAX_SLOTS];
+	i32 count = 0;
+	for (Property& prop : cmp.properties) {
+		if (!prop.is_var && prop.getter_name.size() == 0) continue;
+		if (count == MAX_SLOTS - 1) return false; // 0xff marks empty slot
+		char tmp[256];
+		const StringView label = getReflectionLabel(prop, Span(tmp, tmp + sizeof(tmp)));
+		hashes[count++] = XXH3_64bits(label.begin, label.size());
+	}
+	for (ArrayProperty& array : cmp.arrays) {
+		if (count == MAX_SLOTS - 1) return false; // 0xff marks empty slot
+		hashes[count++] = XXH3_64bits(array.id.begin, array.id.size());
+	}
+	if (count == 0) return false;
+
+	i32 size = 1;
+	i32 bits = 0;
+	while (size < count) {
+		size <<= 1;
+		++bits;
+	}
+	unsigned char slots[MAX_SLOTS];
+	for (; size <= MAX_SLOTS; size <<= 1, ++bits) {
+		for (i32 shift = 0; shift + bits < 64; ++shift) {
+			memset(slots, 0xff, size);
+			bool collision = false;
+			for (i32 i = 0; i < count && !collision; ++i) {
+				const i32 slot = i32(hashes[i] >> shift) & (size - 1);
+				collision = slots[slot] != 0xff;
+				slots[slot] = (unsigned char)i;
+			}
+			if (collision) continue;
+
+			L("static constexpr u64 ", cmp.name, "_prop_hashes[] = {");
+			for (i32 i = 0; i < size; ++i) {
+				if (slots[i] == 0xff) L("\t0,");
+				else L("\t", hashes[slots[i]], "ull,");
+			}
+			L("};");
+			out.add("static constexpr u8 ", cmp.name, "_prop_indices[] = {");
+			for (i32 i = 0; i < size; ++i) {
+				out.add(slots[i] == 0xff ? 0 : i32(slots[i]), ", ");
+			}
+			L("};");
+			L("static constexpr reflection::PropertyTable ", cmp.name, "_props = { ", cmp.name, "_prop_hashes, ", cmp.name, "_prop_indices, ", size - 1, ", ", shift, " };" OUT_ENDL);
+			return true;
+		}
+	}
+	return false;
+}
+
 void serializeReflection(OutputStream& out, Module& m) {
 	L("// Generated by meta.cpp" OUT_ENDL);
+	constexpr i32 MAX_PROP_TABLES = 256;
+	bool has_prop_table[MAX_PROP_TABLES] = {};
+	{
+		i32 cmp_idx = 0;
+		for (Component& cmp : m.components) {
+			if (cmp_idx < MAX_PROP_TABLES) has_prop_table[cmp_idx] = serializePropertyTable(out, cmp);
+			++cmp_idx;
+		}
+	}
 	for (Enum& e : m.enums) {
 		L("struct ", e.name, "Enum : reflection::EnumAttribute {");
 		L("\tu32 count(ComponentUID cmp) const override { return ",e.values.size,"; }");
@@ -2131,18 +2291,18 @@ void serializeReflection(OutputStream& out, Module& m) {
 		L("\t.function<(", fn.return_type, " (", m.name, "::*)(", fn.args, "))&", m.name, "::", fn.name ,">(\"", name, "\")");
 	}
 
+	i32 cmp_idx = 0;
 	for (Component& cmp : m.components) {
 		auto def_property = [&](const Property& prop) {
 			if (prop.is_var) {
-				out.add("\t\t.var_prop<&", m.name, "::get", cmp.name, ", &", cmp.struct_name, "::", prop.name, ">(\"");
-				char label[256];
-				if (prop.attributes.label.size() > 0) {
-					L(prop.attributes.label, "\")");
+				if (cmp.is_hot) {
+					out.add("\t\t.soa_prop<", prop.type, ", &", m.name, "::get", cmp.name, "Storage, &", cmp.struct_name, "Storage::", prop.name, ">(\"");
 				}
 				else {
-					toLabel(prop.name, Span(label, label + sizeof(label)));
-					L(label, "\")");
+					out.add("\t\t.var_prop<&", m.name, "::get", cmp.name, ", &", cmp.struct_name, "::", prop.name, ">(\"");
 				}
+				char label[256];
+				L(getReflectionLabel(prop, Span(label, label + sizeof(label))), "\")");
 				serializeAttributes(out, prop.attributes);
 				return;
 			}
@@ -2159,14 +2319,8 @@ void serializeReflection(OutputStream& out, Module& m) {
 					out.add(", &", m.name, "::", prop.setter_name);
 				}
 
-				if (prop.attributes.label.size() > 0) {
-					L(">(\"", prop.attributes.label, "\")");
-				}
-				else {
-					char label[256];
-					toLabel(prop.name, Span(label, label + sizeof(label)));
-					L(">(\"", label, "\")");
-				}
+				char label[256];
+				L(">(\"", getReflectionLabel(prop, Span(label, label + sizeof(label))), "\")");
 
 				serializeAttributes(out, prop.attributes);
 				bool is_enum = getEnum(m, prop.type) || prop.attributes.dynamic_enum_name.size() > 0;
@@ -2212,10 +2366,138 @@ void serializeReflection(OutputStream& out, Module& m) {
 			}
 			L("\t\t.end_array()");
 		}
+		if (cmp_idx < MAX_PROP_TABLES && has_prop_table[cmp_idx]) L("\t\t.prop_table(", cmp.name, "_props)");
+		++cmp_idx;
 	}
 	L(";" OUT_ENDL);
 }
 
+static bool isStringType(StringView type) {
+	return equal(type, "Path") || equal(type, "String");
+}
+
+// structure of arrays storage for components marked `//@ component_struct hot`
+// one column per `//@ property` variable, rows are kept dense by moving the last row in place of a destroyed one
+// module has to provide `<Component>Storage& get<Component>Storage()`, reflection uses it
+bool serializeSoAStorage(OutputStream& out, Module& m) {
+	bool any_hot = false;
+	for (Component& cmp : m.components) {
+		if (cmp.is_hot) any_hot = true;
+	}
+	if (!any_hot) return false;
+
+	L("// Generated by meta.cpp" OUT_ENDL);
+	for (Component& cmp : m.components) {
+		if (!cmp.is_hot) continue;
+
+		const StringView s = cmp.struct_name;
+		L("struct ", s, "Storage {");
+		L("\texplicit ", s, "Storage(IAllocator& allocator)");
+		L("\t\t: entities(allocator)");
+		L("\t\t, indices(allocator)");
+		for (Property& prop : cmp.properties) {
+			if (prop.is_var) L("\t\t, ", prop.name, "(allocator)");
+		}
+		L("\t{}" OUT_ENDL);
+
+		L("\tu32 size() const { return entities.size(); }");
+		L("\tbool has(EntityRef e) const { return indices.find(e).isValid(); }");
+		L("\tu32 indexOf(EntityRef e) const { return indices[e]; }" OUT_ENDL);
+
+		L("\tu32 create(EntityRef e, const ", s, "& value = {}) {");
+		L("\t\tconst u32 idx = entities.size();");
+		L("\t\tentities.push(e);");
+		L("\t\tindices.insert(e, idx);");
+		for (Property& prop : cmp.properties) {
+			if (prop.is_var) L("\t\t", prop.name, ".push(value.", prop.name, ");");
+		}
+		L("\t\treturn idx;");
+		L("\t}" OUT_ENDL);
+
+		L("\t// last row is moved in place of the destroyed one");
+		L("\tvoid destroy(EntityRef e) {");
+		L("\t\tconst u32 idx = indices[e];");
+		L("\t\tindices.erase(e);");
+		L("\t\tconst EntityRef last = entities.back();");
+		L("\t\tif (last != e) indices[last] = idx;");
+		L("\t\tentities.swapAndPop(idx);");
+		for (Property& prop : cmp.properties) {
+			if (prop.is_var) L("\t\t", prop.name, ".swapAndPop(idx);");
+		}
+		L("\t}" OUT_ENDL);
+
+		L("\t", s, " get(EntityRef e) const {");
+		L("\t\tconst u32 idx = indices[e];");
+		L("\t\t", s, " res;");
+		for (Property& prop : cmp.properties) {
+			if (prop.is_var) L("\t\tres.", prop.name, " = ", prop.name, "[idx];");
+		}
+		L("\t\treturn res;");
+		L("\t}" OUT_ENDL);
+
+		L("\tvoid set(EntityRef e, const ", s, "& value) {");
+		L("\t\tconst u32 idx = indices[e];");
+		for (Property& prop : cmp.properties) {
+			if (prop.is_var) L("\t\t", prop.name, "[idx] = value.", prop.name, ";");
+		}
+		L("\t}" OUT_ENDL);
+
+		out.add("\t// f(EntityRef entity");
+		for (Property& prop : cmp.properties) {
+			if (prop.is_var) out.add(", ", prop.type, "& ", prop.name);
+		}
+		L(")");
+		L("\ttemplate <typename F> void forEach(F&& f) {");
+		L("\t\tfor (u32 i = 0, c = entities.size(); i < c; ++i) {");
+		out.add("\t\t\tf(entities[i]");
+		for (Property& prop : cmp.properties) {
+			if (prop.is_var) out.add(", ", prop.name, "[i]");
+		}
+		L(");");
+		L("\t\t}");
+		L("\t}" OUT_ENDL);
+
+		L("\tvoid serialize(OutputMemoryStream& blob) const {");
+		L("\t\tblob.write((u32)entities.size());");
+		L("\t\tblob.write(entities.begin(), entities.byte_size());");
+		for (Property& prop : cmp.properties) {
+			if (!prop.is_var) continue;
+			if (isStringType(prop.type)) L("\t\tfor (const ", prop.type, "& v : ", prop.name, ") blob.writeString(v);");
+			else L("\t\tblob.write(", prop.name, ".begin(), ", prop.name, ".byte_size());");
+		}
+		L("\t}" OUT_ENDL);
+
+		L("\tvoid deserialize(InputMemoryStream& blob, const EntityMap& entity_map) {");
+		L("\t\tconst u32 offset = entities.size();");
+		L("\t\tconst u32 count = blob.read<u32>();");
+		L("\t\tentities.resize(offset + count);");
+		L("\t\tblob.read(entities.begin() + offset, count * sizeof(EntityRef));");
+		L("\t\tfor (u32 i = offset; i < offset + count; ++i) {");
+		L("\t\t\tentities[i] = entity_map.get(entities[i]);");
+		L("\t\t\tindices.insert(entities[i], i);");
+		L("\t\t}");
+		for (Property& prop : cmp.properties) {
+			if (!prop.is_var) continue;
+			if (isStringType(prop.type)) {
+				L("\t\tfor (u32 i = 0; i < count; ++i) ", prop.name, ".emplace(blob.readString());");
+			}
+			else {
+				L("\t\t", prop.name, ".resize(offset + count);");
+				L("\t\tblob.read(", prop.name, ".begin() + offset, count * sizeof(", prop.type, "));");
+			}
+		}
+		L("\t}" OUT_ENDL);
+
+		L("\tArray<EntityRef> entities;");
+		L("\tHashMap<EntityRef, u32> indices;");
+		for (Property& prop : cmp.properties) {
+			if (prop.is_var) L("\tArray<", prop.type, "> ", prop.name, ";");
+		}
+		L("};" OUT_ENDL);
+	}
+	return true;
+}
+
 void writeFile(const char* out_path, OutputStream& stream) {
 	// skip writing if file exists and content is identical
 	HANDLE h_existing = CreateFileA(out_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
@@ -2282,6 +2564,7 @@ int main() {
 	lua_capi_stream.add("#include \"xxhash/xxhash.h\"" OUT_ENDL);
 
 	lua_capi_stream.add(OUT_ENDL);
+	serializeLuaAtoms(lua_capi_stream, parser);
 
 	for (Module& m : parser.modules) {
 		char out_path[MAX_PATH];
@@ -2304,6 +2587,12 @@ int main() {
 		serializeReflection(stream, m);
 		writeFile(out_path, stream);
 
+		stream.length = 0;
+		if (serializeSoAStorage(stream, m)) {
+			buildString(out_path, stem, ".soa.gen.h");
+			writeFile(out_path, stream);
+		}
+
 		serializeLuaCAPI(lua_capi_stream, m);
 	}
 	serializeLuaTypes(lua_d_stream);
@@ -174,6 +174,8 @@ struct Component {
 	ExpArray<Function> functions;
 	ExpArray<Property> properties;
 	ExpArray<ArrayProperty> arrays;
+	// `//@ component_struct hot` - structure of arrays storage is generated for it, see serializeSoAStorage
+	bool is_hot = false;
 };
 
 
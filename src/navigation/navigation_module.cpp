@@ -1,6 +1,8 @@
 #include "core/array.h"
 #include "core/atomic.h"
 #include "core/crt.h"
+#include "core/delegate_list.h"
+#include "core/hash.h"
 #include "core/job_system.h"
 #include "core/log.h"
 #include "core/os.h"
@@ -23,6 +25,7 @@
 #include <DetourNavMeshBuilder.h>
 #include <DetourNavMeshQuery.h>
 #include <Recast.h>
+#include <RecastAlloc.h>
 
 
 namespace Lumix
@@ -52,7 +55,80 @@ static const ComponentType NAVMESH_AGENT_TYPE = reflection::getComponentType("na
 static const int CELLS_PER_TILE_SIDE = 256;
 
 
+// runtime obstacle, cuts a hole into navmesh, in zone space
+struct NavmeshObstacle {
+	u32 id;
+	// box center or cylinder bottom
+	Vec3 pos;
+	Vec3 half_extents;
+	// cylinder if > 0
+	float radius = 0;
+	float height = 0;
+
+	AABB getAABB() const {
+		if (radius > 0) return AABB(pos - Vec3(radius, 0, radius), pos + Vec3(radius, height, radius));
+		return AABB(pos - half_extents, pos + half_extents);
+	}
+};
+
+
+// move request of an agent, processed by sliced pathfinding, see NavigationModuleImpl::processPathRequests
+struct PathRequest {
+	EntityRef agent;
+	// matches Agent::path_request_id unless the request was canceled or replaced by a newer one
+	u32 id;
+	// zone space
+	Vec3 dest;
+};
+
+
 struct RecastZone {
+	// LZ4 compressed voxelized tile, before obstacles are applied
+	// reused by next build if its input triangles and voxelization parameters did not change
+	// and by runtime rebuilds when obstacles change
+	struct CachedTile {
+		CachedTile(IAllocator& allocator) : data(allocator) {}
+
+		StableHash key;
+		u32 size = 0;
+		OutputMemoryStream data;
+	};
+
+	struct PathResult {
+		PathRequest request;
+		dtPolyRef target_ref;
+		// polygons are in PathQuery::result_polys, path_count is 0 if no path was found
+		u32 path_offset;
+		u32 path_count;
+	};
+
+	// one per worker, each searches for one path at a time, a search can span several frames
+	struct PathQuery {
+		PathQuery(IAllocator& allocator)
+			: results(allocator)
+			, result_polys(allocator)
+		{}
+
+		dtNavMeshQuery* query = nullptr;
+		PathRequest request;
+		dtPolyRef target_ref = 0;
+		bool busy = false;
+		// (re)start the search of `request`, e.g. because tiles were swapped while searching
+		bool restart = false;
+		// results finished this frame
+		Array<PathResult> results;
+		Array<dtPolyRef> result_polys;
+	};
+
+	RecastZone(IAllocator& allocator)
+		: agents(allocator)
+		, tile_cache(allocator)
+		, obstacles(allocator)
+		, dirty_tiles(allocator)
+		, path_requests(allocator)
+		, path_queries(allocator)
+	{}
+
 	EntityRef entity;
 	NavmeshZone zone;
 
@@ -61,6 +137,8 @@ struct RecastZone {
 	dtNavMeshQuery* navquery = nullptr;
 	dtNavMesh* navmesh = nullptr;
 	dtCrowd* crowd = nullptr;
+	// agents added to `crowd`, so per-zone updates do not have to go through all agents
+	Array<EntityRef> agents;
 
 	i32 getWalkableRadius() const { return (i32)(zone.agent_radius / zone.cell_size + 0.99f); }
 	float getBorderSize() const { return getWalkableRadius() + 3.f; }
@@ -68,6 +146,39 @@ struct RecastZone {
 	rcCompactHeightfield* debug_compact_heightfield = nullptr;
 	rcHeightfield* debug_heightfield = nullptr;
 	rcContourSet* debug_contours = nullptr;
+	// navmesh debug draw, see debugDrawNavmesh
+	DebugBatchHandle debug_batch = INVALID_DEBUG_BATCH;
+	RuntimeHash debug_batch_key;
+
+	Array<CachedTile> tile_cache;
+	Array<NavmeshObstacle> obstacles;
+	// tiles affected by obstacle changes, waiting for rebuild
+	Array<u32> dirty_tiles;
+	// incremented when navmesh is recreated, so results of tile rebuilds started before are dropped
+	u32 navmesh_version = 0;
+
+	// requests waiting for a free path query, in order of navigate calls
+	Array<PathRequest> path_requests;
+	Array<PathQuery> path_queries;
+};
+
+
+// zone-space input triangles, bucketed by tiles
+struct NavmeshInputGeometry {
+	NavmeshInputGeometry(IAllocator& allocator)
+		: verts(allocator)
+		, areas(allocator)
+		, tile_offsets(allocator)
+		, tile_triangles(allocator)
+	{}
+
+	IVec2 from_tile;
+	IVec2 to_tile;
+	Array<Vec3> verts;
+	Array<u8> areas;
+	// triangles of tile `i` are tile_triangles[tile_offsets[i]..tile_offsets[i + 1]]
+	Array<u32> tile_offsets;
+	Array<u32> tile_triangles;
 };
 
 
@@ -87,6 +198,9 @@ struct Agent
 	float speed = 0;
 	float yaw_diff = 0;
 	float stop_distance = 0;
+	u32 path_request_id = 0;
+	// navigate was called, but the path was not found yet
+	bool path_pending = false;
 };
 
 
@@ -98,7 +212,13 @@ struct NavigationModuleImpl final : NavigationModule
 		, m_system(system)
 		, m_engine(engine)
 		, m_agents(m_allocator)
+		, m_moved_entities(m_allocator)
+		, m_moved_transforms(m_allocator)
 		, m_zones(m_allocator)
+		, m_crowd_zones(m_allocator)
+		, m_tile_rebuilds(m_allocator)
+		, m_finished_path_requests(m_allocator)
+		, m_path_request_finished(m_allocator)
 		, m_script_module(nullptr)
 	{
 		m_world.componentTransformed(NAVMESH_AGENT_TYPE).bind<&NavigationModuleImpl::onAgentMoved>(this);
@@ -106,8 +226,14 @@ struct NavigationModuleImpl final : NavigationModule
 
 
 	~NavigationModuleImpl() {
+		jobs::wait(&m_tile_rebuild_signal);
+		for (TileRebuild* rebuild : m_tile_rebuilds) {
+			dtFree(rebuild->nav_data);
+			LUMIX_DELETE(m_allocator, rebuild);
+		}
 		for(RecastZone& zone : m_zones) {
 			clearNavmesh(zone);
+			clearTileCache(zone);
 		}
 		m_world.componentTransformed(NAVMESH_AGENT_TYPE).unbind<&NavigationModuleImpl::onAgentMoved>(this);
 	}
@@ -116,8 +242,8 @@ struct NavigationModuleImpl final : NavigationModule
 	void onAgentMoved(EntityRef entity) {
 		auto iter = m_agents.find(entity);
 		ASSERT(iter.isValid());
-		if (m_moving_agent == entity) return;
 		Agent& agent = iter.value();
+		if (m_moving_agents && (agent.flags & Agent::MOVE_ENTITY)) return;
 		
 		if (agent.agent < 0) {
 			assignZone(agent);
@@ -135,16 +261,30 @@ struct NavigationModuleImpl final : NavigationModule
 			const Transform old_zone_tr = m_world.getTransform(zone.entity);
 			const DVec3 target_pos = old_zone_tr.transform(*(Vec3*)dt_agent->targetPos);
 			float speed = dt_agent->params.maxSpeed;
-			zone.crowd->removeAgent(agent.agent);
+			removeCrowdAgent(agent, zone);
 			addCrowdAgent(iter.value(), zone);
-			if (!agent.is_finished) {
+			// pending request is not affected, it reads agent's position when its search starts
+			if (!agent.is_finished && !agent.path_pending) {
 				navigate({entity.index}, target_pos, speed, agent.stop_distance);
 			}
 		}
 	}
 
 
+	void clearPathRequests(RecastZone& zone) {
+		for (RecastZone::PathQuery& q : zone.path_queries) dtFreeNavMeshQuery(q.query);
+		zone.path_queries.clear();
+		zone.path_requests.clear();
+		for (EntityRef e : zone.agents) {
+			Agent& agent = m_agents[e];
+			if (!agent.path_pending) continue;
+			agent.path_pending = false;
+			agent.is_finished = true;
+		}
+	}
+
 	void clearNavmesh(RecastZone& zone) {
+		clearPathRequests(zone);
 		dtFreeNavMeshQuery(zone.navquery);
 		dtFreeNavMesh(zone.navmesh);
 		rcFreeCompactHeightfield(zone.debug_compact_heightfield);
@@ -157,20 +297,116 @@ struct NavigationModuleImpl final : NavigationModule
 		zone.debug_heightfield = nullptr;
 		zone.debug_contours = nullptr;
 		zone.crowd = nullptr;
+		zone.dirty_tiles.clear();
+		++zone.navmesh_version;
 	}
 
 
-	void rasterizeGeometry(const Transform& zone_tr, const AABB& aabb, rcContext& ctx, rcConfig& cfg, rcHeightfield& solid)
-	{
-		rasterizeMeshes(zone_tr, aabb, ctx, cfg, solid);
-		rasterizeTerrains(zone_tr, aabb, ctx, cfg, solid);
+	bool compressTile(const rcCompactHeightfield& chf, RecastZone::CachedTile& tile) {
+		ASSERT(!chf.dist);
+		OutputMemoryStream blob(m_allocator);
+		blob.write(chf.width);
+		blob.write(chf.height);
+		blob.write(chf.spanCount);
+		blob.write(chf.walkableHeight);
+		blob.write(chf.walkableClimb);
+		blob.write(chf.borderSize);
+		blob.write(chf.maxDistance);
+		blob.write(chf.maxRegions);
+		blob.write(chf.bmin);
+		blob.write(chf.bmax);
+		blob.write(chf.cs);
+		blob.write(chf.ch);
+		blob.write(chf.cells, sizeof(rcCompactCell) * chf.width * chf.height);
+		blob.write(chf.spans, sizeof(rcCompactSpan) * chf.spanCount);
+		blob.write(chf.areas, sizeof(u8) * chf.spanCount);
+
+		tile.data.clear();
+		tile.size = (u32)blob.size();
+		return m_engine.compress(blob, tile.data);
 	}
 
+	rcCompactHeightfield* decompressTile(const RecastZone::CachedTile& tile) {
+		OutputMemoryStream blob(m_allocator);
+		blob.resize(tile.size);
+		if (!m_engine.decompress(tile.data, Span(blob.getMutableData(), tile.size))) return nullptr;
 
-	void rasterizeTerrains(const Transform& zone_tr, const AABB& tile_aabb, rcContext& ctx, rcConfig& cfg, rcHeightfield& solid) {
-		PROFILE_FUNCTION();
-		const float walkable_threshold = cosf(degreesToRadians(60));
+		rcCompactHeightfield* chf = rcAllocCompactHeightfield();
+		if (!chf) return nullptr;
+
+		InputMemoryStream stream(blob);
+		stream.read(chf->width);
+		stream.read(chf->height);
+		stream.read(chf->spanCount);
+		stream.read(chf->walkableHeight);
+		stream.read(chf->walkableClimb);
+		stream.read(chf->borderSize);
+		stream.read(chf->maxDistance);
+		stream.read(chf->maxRegions);
+		stream.read(chf->bmin);
+		stream.read(chf->bmax);
+		stream.read(chf->cs);
+		stream.read(chf->ch);
+		chf->cells = (rcCompactCell*)rcAlloc(sizeof(rcCompactCell) * chf->width * chf->height, RC_ALLOC_PERM);
+		chf->spans = (rcCompactSpan*)rcAlloc(sizeof(rcCompactSpan) * chf->spanCount, RC_ALLOC_PERM);
+		chf->areas = (u8*)rcAlloc(sizeof(u8) * chf->spanCount, RC_ALLOC_PERM);
+		if (!chf->cells || !chf->spans || !chf->areas) {
+			rcFreeCompactHeightfield(chf);
+			return nullptr;
+		}
+		stream.read(chf->cells, sizeof(rcCompactCell) * chf->width * chf->height);
+		stream.read(chf->spans, sizeof(rcCompactSpan) * chf->spanCount);
+		stream.read(chf->areas, sizeof(u8) * chf->spanCount);
+		return chf;
+	}
+
+	void clearTileCache(RecastZone& zone) {
+		zone.tile_cache.clear();
+	}
+
+	void initTileCache(RecastZone& zone) {
+		const u32 tiles_count = zone.m_num_tiles_x * zone.m_num_tiles_z;
+		if ((u32)zone.tile_cache.size() == tiles_count) return;
+		
+		clearTileCache(zone);
+		zone.tile_cache.reserve(tiles_count);
+		for (u32 i = 0; i < tiles_count; ++i) zone.tile_cache.emplace(m_allocator);
+	}
+
+	// border is rounded up, so small changes of agent radius keep voxelization cached
+	static i32 getVoxelBorderSize(const NavmeshZone& zone) {
+		const i32 walkable_radius = i32(zone.agent_radius / zone.cell_size + 0.99f);
+		return (walkable_radius + 3 + 7) & ~7;
+	}
+
+	static AABB getTileAABB(const NavmeshZone& zone, i32 x, i32 z, i32 border_size) {
+		const float cs = zone.cell_size;
+		const Vec3 min = -zone.extents;
+		const Vec3 max = zone.extents;
+		Vec3 bmin(min.x + x * CELLS_PER_TILE_SIDE * cs - (1 + border_size) * cs,
+			min.y,
+			min.z + z * CELLS_PER_TILE_SIDE * cs - (1 + border_size) * cs);
+		Vec3 bmax(bmin.x + CELLS_PER_TILE_SIDE * cs + (1 + border_size) * cs * 2,
+			max.y,
+			bmin.z + CELLS_PER_TILE_SIDE * cs + (1 + border_size) * cs * 2);
+		return AABB(bmin, bmax);
+	}
+
+	// models and terrain rows intersecting the built area, their triangles are extracted in parallel
+	struct NavmeshInputSource {
+		Model* model = nullptr;
+		Matrix mtx;
+		EntityPtr terrain = INVALID_ENTITY;
+		Transform to_zone;
+		float scale_xz;
+		i32 row;
+		i32 from_x;
+		i32 to_x;
+		u32 triangles_offset = 0;
+		u32 triangles_count = 0;
+	};
 
+	void gatherTerrainSources(const Transform& zone_tr, const AABB& area, Array<NavmeshInputSource>& sources) {
 		auto render_module = static_cast<RenderModule*>(m_world.getModule("renderer"));
 		if (!render_module) return;
 
@@ -178,126 +414,68 @@ struct NavigationModuleImpl final : NavigationModule
 		while (entity_ptr.isValid()) {
 			const EntityRef entity = (EntityRef)entity_ptr;
 			const DVec3 terrain_pos = m_world.getPosition(entity);
-			const Transform to_zone = Transform::computeLocal(zone_tr, Transform(terrain_pos, Quat::IDENTITY, {1, 1, 1}));
 			const Transform to_terrain = Transform::computeLocal(Transform(terrain_pos, Quat::IDENTITY, {1, 1, 1}), zone_tr);
-			float scaleXZ = render_module->getTerrainXZScale(entity);
+			const float scale_xz = render_module->getTerrainXZScale(entity);
 			Matrix mtx = to_terrain.rot.toMatrix();
 			mtx.setTranslation(Vec3(to_terrain.pos));
-			AABB aabb = tile_aabb;
+			AABB aabb = area;
 			aabb.transform(mtx);
-			const IVec2 from = IVec2(aabb.min.xz() / scaleXZ);
-			const IVec2 to = IVec2(aabb.max.xz() / scaleXZ + Vec2(1));
-			for (int j = from.y; j < to.y; ++j) {
-				for (int i = from.x; i < to.x; ++i) {
-					float x = i * scaleXZ;
-					float z = j * scaleXZ;
-
-					const float h0 = render_module->getTerrainHeightAt(entity, x, z);
-					const Vec3 p0 = Vec3(to_zone.transform(Vec3(x, h0, z)));
-
-					x = (i + 1) * scaleXZ;
-					z = j * scaleXZ;
-					const float h1 = render_module->getTerrainHeightAt(entity, x, z);
-					const Vec3 p1 = Vec3(to_zone.transform(Vec3(x, h1, z)));
-
-					x = (i + 1) * scaleXZ;
-					z = (j + 1) * scaleXZ;
-					const float h2 = render_module->getTerrainHeightAt(entity, x, z);
-					const Vec3 p2 = Vec3(to_zone.transform(Vec3(x, h2, z)));
-
-					x = i * scaleXZ;
-					z = (j + 1) * scaleXZ;
-					const float h3 = render_module->getTerrainHeightAt(entity, x, z);
-					const Vec3 p3 = Vec3(to_zone.transform(Vec3(x, h3, z)));
-
-					Vec3 n = normalize(cross(p1 - p0, p0 - p2));
-					u8 area = n.y > walkable_threshold ? RC_WALKABLE_AREA : 0;
-					rcRasterizeTriangle(&ctx, &p0.x, &p1.x, &p2.x, area, solid);
-
-					n = normalize(cross(p2 - p0, p0 - p3));
-					area = n.y > walkable_threshold ? RC_WALKABLE_AREA : 0;
-					rcRasterizeTriangle(&ctx, &p0.x, &p2.x, &p3.x, area, solid);
-				}
+			const IVec2 from = IVec2(aabb.min.xz() / scale_xz);
+			const IVec2 to = IVec2(aabb.max.xz() / scale_xz + Vec2(1));
+			for (i32 j = from.y; j < to.y; ++j) {
+				if (from.x >= to.x) break;
+				NavmeshInputSource& src = sources.emplace();
+				src.terrain = entity;
+				src.to_zone = Transform::computeLocal(zone_tr, Transform(terrain_pos, Quat::IDENTITY, {1, 1, 1}));
+				src.scale_xz = scale_xz;
+				src.row = j;
+				src.from_x = from.x;
+				src.to_x = to.x;
+				src.triangles_count = (to.x - from.x) * 2;
 			}
 			entity_ptr = render_module->getNextTerrain(entity);
 		}
 	}
 
-	LUMIX_FORCE_INLINE void rasterizeModel(Model* model
-		, const Transform& tr
-		, const AABB& zone_aabb
-		, const Transform& zone_tr
-		, u32 no_navigation_flag
-		, u32 nonwalkable_flag
-		, rcContext& ctx
-		, rcHeightfield& solid)
-	{
-		ASSERT(model->isReady());
-
-		AABB model_aabb = model->getAABB();
+	void addModelSource(Model* model, const Transform& tr, const Transform& zone_tr, const AABB& area, u32 no_navigation_flag, Array<NavmeshInputSource>& sources) {
 		const Transform rel_tr = Transform::computeLocal(zone_tr, tr);
 		Matrix mtx = rel_tr.rot.toMatrix();
 		mtx.setTranslation(Vec3(rel_tr.pos));
 		mtx.multiply3x3(rel_tr.scale);
+		AABB model_aabb = model->getAABB();
 		model_aabb.transform(mtx);
-		if (!model_aabb.overlaps(zone_aabb)) return;;
-		const float walkable_threshold = cosf(degreesToRadians(45));
+		if (!model_aabb.overlaps(area)) return;
 
-		auto lod = model->getLODIndices()[0];
-		for (int mesh_idx = lod.from; mesh_idx <= lod.to; ++mesh_idx) {
+		// LOD0 might not be loaded if models are streamed
+		u32 triangles_count = 0;
+		const auto lod = model->getLODIndices()[model->getResidentLOD()];
+		for (i32 mesh_idx = lod.from; mesh_idx <= lod.to; ++mesh_idx) {
+			if (model->getMeshMaterial(mesh_idx).material->isCustomFlag(no_navigation_flag)) continue;
 			const Mesh& mesh = model->getMesh(mesh_idx);
-			const MeshMaterial& mesh_mat = model->getMeshMaterial(mesh_idx);
-			bool is16 = mesh.areIndices16();
-
-			if (mesh_mat.material->isCustomFlag(no_navigation_flag)) continue;
-			bool is_walkable = !mesh_mat.material->isCustomFlag(nonwalkable_flag);
-			auto* vertices = &mesh.vertices[0];
-			if (is16) {
-				const u16* indices16 = (const u16*)mesh.indices.data();
-				for (i32 i = 0; i < (i32)mesh.indices.size() / 2; i += 3) {
-					Vec3 a = mtx.transformPoint(vertices[indices16[i]]);
-					Vec3 b = mtx.transformPoint(vertices[indices16[i + 1]]);
-					Vec3 c = mtx.transformPoint(vertices[indices16[i + 2]]);
-
-					Vec3 n = normalize(cross(a - b, a - c));
-					u8 area = n.y > walkable_threshold && is_walkable ? RC_WALKABLE_AREA : 0;
-					rcRasterizeTriangle(&ctx, &a.x, &b.x, &c.x, area, solid);
-				}
-			}
-			else {
-				const u32* indices32 = (const u32*)mesh.indices.data();
-				for (i32 i = 0; i < (i32)mesh.indices.size() / 4; i += 3) {
-					Vec3 a = mtx.transformPoint(vertices[indices32[i]]);
-					Vec3 b = mtx.transformPoint(vertices[indices32[i + 1]]);
-					Vec3 c = mtx.transformPoint(vertices[indices32[i + 2]]);
-
-					Vec3 n = normalize(cross(a - b, a - c));
-					u8 area = n.y > walkable_threshold && is_walkable ? RC_WALKABLE_AREA : 0;
-					rcRasterizeTriangle(&ctx, &a.x, &b.x, &c.x, area, solid);
-				}
-			}
+			triangles_count += u32(mesh.indices.size() / (mesh.areIndices16() ? 2 : 4) / 3);
 		}
-	}
+		if (triangles_count == 0) return;
 
-	void rasterizeMeshes(const Transform& zone_tr, const AABB& aabb, rcContext& ctx, rcConfig& cfg, rcHeightfield& solid)
-	{
-		PROFILE_FUNCTION();
+		NavmeshInputSource& src = sources.emplace();
+		src.model = model;
+		src.mtx = mtx;
+		src.triangles_count = triangles_count;
+	}
 
+	void gatherModelSources(const Transform& zone_tr, const AABB& area, Array<NavmeshInputSource>& sources) {
 		auto render_module = static_cast<RenderModule*>(m_world.getModule("renderer"));
 		if (!render_module) return;
 
 		const u32 no_navigation_flag = Material::getCustomFlag("no_navigation");
-		const u32 nonwalkable_flag = Material::getCustomFlag("nonwalkable");
 		for (EntityPtr model_instance = render_module->getFirstModelInstance(); 
 			model_instance.isValid();
 			model_instance = render_module->getNextModelInstance(model_instance))
 		{
 			const EntityRef entity = (EntityRef)model_instance;
-			auto* model = render_module->getModelInstanceModel(entity);
-			if (!model) return;
+			Model* model = render_module->getModelInstanceModel(entity);
+			if (!model || !model->isReady()) continue;
 		
-			const Transform tr = m_world.getTransform(entity);
-			rasterizeModel(model, tr, aabb, zone_tr, no_navigation_flag, nonwalkable_flag, ctx, solid);
+			addModelSource(model, m_world.getTransform(entity), zone_tr, area, no_navigation_flag, sources);
 		}
 
 		const HashMap<EntityRef, InstancedModel>& ims = render_module->getInstancedModels();
@@ -309,16 +487,6 @@ struct NavigationModuleImpl final : NavigationModule
 				continue;
 			}
 
-			bool all_meshes_no_nav = true;
-			for (i32 i = 0; i < im.model->getMeshCount(); ++i) {
-				if (!im.model->getMeshMaterial(i).material->isCustomFlag(no_navigation_flag)) {
-					all_meshes_no_nav = false;
-					break;
-				}
-			}
-
-			if (all_meshes_no_nav) continue;
-
 			Transform im_tr = m_world.getTransform(iter.key());
 			im_tr.rot = Quat::IDENTITY;
 			im_tr.scale = Vec3(1);
@@ -329,7 +497,139 @@ struct NavigationModuleImpl final : NavigationModule
 				tr.rot.w = sqrtf(1 - dot(i.rot_quat, i.rot_quat));
 				tr.scale = Vec3(i.scale);
 				tr = im_tr.compose(tr);
-				rasterizeModel(im.model, tr, aabb, zone_tr, no_navigation_flag, nonwalkable_flag, ctx, solid);
+				addModelSource(im.model, tr, zone_tr, area, no_navigation_flag, sources);
+			}
+		}
+	}
+
+	void extractTriangles(const NavmeshInputSource& src, NavmeshInputGeometry& geom, u32 no_navigation_flag, u32 nonwalkable_flag) {
+		Vec3* out_verts = &geom.verts[src.triangles_offset * 3];
+		u8* out_areas = &geom.areas[src.triangles_offset];
+
+		if (src.terrain.isValid()) {
+			const float walkable_threshold = cosf(degreesToRadians(60));
+			auto render_module = static_cast<RenderModule*>(m_world.getModule("renderer"));
+			const EntityRef entity = (EntityRef)src.terrain;
+			const float s = src.scale_xz;
+			const i32 j = src.row;
+			for (i32 i = src.from_x; i < src.to_x; ++i) {
+				const Vec3 p0 = Vec3(src.to_zone.transform(Vec3(i * s, render_module->getTerrainHeightAt(entity, i * s, j * s), j * s)));
+				const Vec3 p1 = Vec3(src.to_zone.transform(Vec3((i + 1) * s, render_module->getTerrainHeightAt(entity, (i + 1) * s, j * s), j * s)));
+				const Vec3 p2 = Vec3(src.to_zone.transform(Vec3((i + 1) * s, render_module->getTerrainHeightAt(entity, (i + 1) * s, (j + 1) * s), (j + 1) * s)));
+				const Vec3 p3 = Vec3(src.to_zone.transform(Vec3(i * s, render_module->getTerrainHeightAt(entity, i * s, (j + 1) * s), (j + 1) * s)));
+
+				Vec3 n = normalize(cross(p1 - p0, p0 - p2));
+				*out_areas++ = n.y > walkable_threshold ? RC_WALKABLE_AREA : 0;
+				*out_verts++ = p0; *out_verts++ = p1; *out_verts++ = p2;
+
+				n = normalize(cross(p2 - p0, p0 - p3));
+				*out_areas++ = n.y > walkable_threshold ? RC_WALKABLE_AREA : 0;
+				*out_verts++ = p0; *out_verts++ = p2; *out_verts++ = p3;
+			}
+			return;
+		}
+
+		const float walkable_threshold = cosf(degreesToRadians(45));
+		Model* model = src.model;
+		const auto lod = model->getLODIndices()[model->getResidentLOD()];
+		for (i32 mesh_idx = lod.from; mesh_idx <= lod.to; ++mesh_idx) {
+			const Mesh& mesh = model->getMesh(mesh_idx);
+			const MeshMaterial& mesh_mat = model->getMeshMaterial(mesh_idx);
+			if (mesh_mat.material->isCustomFlag(no_navigation_flag)) continue;
+
+			const bool is_walkable = !mesh_mat.material->isCustomFlag(nonwalkable_flag);
+			const Vec3* vertices = &mesh.vertices[0];
+			const bool is16 = mesh.areIndices16();
+			const u16* indices16 = (const u16*)mesh.indices.data();
+			const u32* indices32 = (const u32*)mesh.indices.data();
+			const i32 indices_count = i32(mesh.indices.size() / (is16 ? 2 : 4)) / 3 * 3;
+			for (i32 i = 0; i < indices_count; i += 3) {
+				const Vec3 a = src.mtx.transformPoint(vertices[is16 ? indices16[i] : indices32[i]]);
+				const Vec3 b = src.mtx.transformPoint(vertices[is16 ? indices16[i + 1] : indices32[i + 1]]);
+				const Vec3 c = src.mtx.transformPoint(vertices[is16 ? indices16[i + 2] : indices32[i + 2]]);
+
+				const Vec3 n = normalize(cross(a - b, a - c));
+				*out_areas++ = n.y > walkable_threshold && is_walkable ? RC_WALKABLE_AREA : 0;
+				*out_verts++ = a; *out_verts++ = b; *out_verts++ = c;
+			}
+		}
+	}
+
+	// collects zone-space triangles of all inputs overlapping tiles [from_tile, to_tile) and buckets them by tile,
+	// so tile jobs do not have to go through all model instances and terrains
+	void buildInputGeometry(RecastZone& zone, IVec2 from_tile, IVec2 to_tile, i32 border_size, NavmeshInputGeometry& geom) {
+		PROFILE_FUNCTION();
+		const Transform zone_tr = m_world.getTransform(zone.entity);
+		AABB area = getTileAABB(zone.zone, from_tile.x, from_tile.y, border_size);
+		area.merge(getTileAABB(zone.zone, to_tile.x - 1, to_tile.y - 1, border_size));
+
+		Array<NavmeshInputSource> sources(m_allocator);
+		gatherModelSources(zone_tr, area, sources);
+		gatherTerrainSources(zone_tr, area, sources);
+
+		u32 triangles_count = 0;
+		for (NavmeshInputSource& src : sources) {
+			src.triangles_offset = triangles_count;
+			triangles_count += src.triangles_count;
+		}
+
+		geom.from_tile = from_tile;
+		geom.to_tile = to_tile;
+		geom.verts.resize(triangles_count * 3);
+		geom.areas.resize(triangles_count);
+		
+		const u32 no_navigation_flag = Material::getCustomFlag("no_navigation");
+		const u32 nonwalkable_flag = Material::getCustomFlag("nonwalkable");
+		jobs::forEach(sources.size(), 1, [&](i32 from, i32 to){
+			PROFILE_BLOCK("extract navmesh input");
+			for (i32 i = from; i < to; ++i) extractTriangles(sources[i], geom, no_navigation_flag, nonwalkable_flag);
+		});
+
+		// bucket triangles by tiles they overlap, including tile border
+		const i32 tiles_w = to_tile.x - from_tile.x;
+		const i32 tiles_count = tiles_w * (to_tile.y - from_tile.y);
+		const float tile_size = CELLS_PER_TILE_SIDE * zone.zone.cell_size;
+		const float pad = (1 + border_size) * zone.zone.cell_size;
+		const Vec3 min = -zone.zone.extents;
+		const Vec3 max = zone.zone.extents;
+		Array<IVec2> tri_from(m_allocator);
+		Array<IVec2> tri_to(m_allocator);
+		tri_from.resize(triangles_count);
+		tri_to.resize(triangles_count);
+		geom.tile_offsets.resize(tiles_count + 1);
+		memset(geom.tile_offsets.begin(), 0, sizeof(u32) * (tiles_count + 1));
+		for (u32 i = 0; i < triangles_count; ++i) {
+			const Vec3* v = &geom.verts[i * 3];
+			const Vec3 tmin = minimum(v[0], minimum(v[1], v[2]));
+			const Vec3 tmax = maximum(v[0], maximum(v[1], v[2]));
+			IVec2& f = tri_from[i];
+			IVec2& t = tri_to[i];
+			f = IVec2(0);
+			t = IVec2(0);
+			if (tmax.y < min.y || tmin.y > max.y) continue;
+			const Vec2 tmin_xz = (tmin.xz() - min.xz() - Vec2(pad)) / tile_size - Vec2(1);
+			const Vec2 tmax_xz = (tmax.xz() - min.xz() + Vec2(pad)) / tile_size;
+			f = IVec2(maximum(i32(ceilf(tmin_xz.x)), from_tile.x), maximum(i32(ceilf(tmin_xz.y)), from_tile.y));
+			t = IVec2(minimum(i32(floorf(tmax_xz.x)) + 1, to_tile.x), minimum(i32(floorf(tmax_xz.y)) + 1, to_tile.y));
+			for (i32 z = f.y; z < t.y; ++z) {
+				for (i32 x = f.x; x < t.x; ++x) {
+					++geom.tile_offsets[(z - from_tile.y) * tiles_w + (x - from_tile.x) + 1];
+				}
+			}
+		}
+		for (i32 i = 0; i < tiles_count; ++i) geom.tile_offsets[i + 1] += geom.tile_offsets[i];
+		geom.tile_triangles.resize(geom.tile_offsets[tiles_count]);
+		
+		Array<u32> fill(m_allocator);
+		fill.resize(tiles_count);
+		memcpy(fill.begin(), geom.tile_offsets.begin(), sizeof(u32) * tiles_count);
+		for (u32 i = 0; i < triangles_count; ++i) {
+			const IVec2 f = tri_from[i];
+			const IVec2 t = tri_to[i];
+			for (i32 z = f.y; z < t.y; ++z) {
+				for (i32 x = f.x; x < t.x; ++x) {
+					geom.tile_triangles[fill[(z - from_tile.y) * tiles_w + (x - from_tile.x)]++] = i;
+				}
 			}
 		}
 	}
@@ -370,10 +670,8 @@ struct NavigationModuleImpl final : NavigationModule
 
 
 	void update(RecastZone& zone, float time_delta) {
-		for (auto& agent : m_agents) {
-			if (agent.agent < 0) continue;
-			if (agent.zone != zone.entity) continue;
-			
+		for (EntityRef e : zone.agents) {
+			Agent& agent = m_agents[e];
 			const dtCrowdAgent* dt_agent = zone.crowd->getAgent(agent.agent);
 			//if (dt_agent->paused) continue;
 
@@ -399,14 +697,34 @@ struct NavigationModuleImpl final : NavigationModule
 		}
 	}
 
+	bool usesFixedTimestep() const override { return true; }
+
+	bool getUpdateAccess(ModuleUpdateAccess& access) const override {
+		// update only reads transforms and writes agents' speed and yaw
+		access.reads = u64(1) << NAVMESH_ZONE_TYPE.index;
+		access.writes = u64(1) << NAVMESH_AGENT_TYPE.index;
+		access.reads_transforms = true;
+		return true;
+	}
+
 	void updateParallel(float time_delta) override {
 		if (!m_is_game_running) return;
 		
+		m_crowd_zones.clear();
 		for (RecastZone& zone : m_zones) {
-			if (!zone.crowd) continue;
-			PROFILE_BLOCK("dtCrowd::update");
-			zone.crowd->update(time_delta, nullptr);
+			if (zone.crowd) m_crowd_zones.push(&zone);
 		}
+
+		// paths found this frame are followed already in this frame's crowd update
+		for (RecastZone* zone : m_crowd_zones) processPathRequests(*zone);
+
+		// crowds do not share any state, so each zone is updated in its own job
+		jobs::forEach(m_crowd_zones.size(), 1, [&](i32 from, i32 to){
+			for (i32 i = from; i < to; ++i) {
+				PROFILE_BLOCK("dtCrowd::update");
+				m_crowd_zones[i]->crowd->update(time_delta, nullptr);
+			}
+		});
 	}
 
 	void lateUpdate(RecastZone& zone, float time_delta) {
@@ -416,16 +734,16 @@ struct NavigationModuleImpl final : NavigationModule
 
 		zone.crowd->doMove(time_delta);
 
-		for (auto& agent : m_agents) {
-			if (agent.agent < 0) continue;
-			if (agent.zone != zone.entity) continue;
-
-			const dtCrowdAgent* dt_agent = zone.crowd->getAgent(agent.agent);
+		m_moved_entities.clear();
+		m_moved_transforms.clear();
+		for (EntityRef e : zone.agents) {
+			const Agent& agent = m_agents[e];
+			dtCrowdAgent* dt_agent = zone.crowd->getEditableAgent(agent.agent);
 			//if (dt_agent->paused) continue;
 
 			if (agent.flags & Agent::MOVE_ENTITY) {
-				m_moving_agent = agent.entity;
-				m_world.setPosition(agent.entity, zone_tr.transform(*(Vec3*)dt_agent->npos));
+				Transform tr = m_world.getTransform(agent.entity);
+				tr.pos = zone_tr.transform(*(Vec3*)dt_agent->npos);
 
 				Vec3 vel = *(Vec3*)dt_agent->nvel;
 				vel.y = 0;
@@ -434,15 +752,26 @@ struct NavigationModuleImpl final : NavigationModule
 					vel *= 1 / len;
 					float angle = atan2f(vel.x, vel.z);
 					Quat wanted_rot(Vec3(0, 1, 0), angle);
-					Quat old_rot = m_world.getRotation(agent.entity);
-					Quat new_rot = nlerp(wanted_rot, old_rot, 0.90f);
-					m_world.setRotation(agent.entity, new_rot);
+					tr.rot = nlerp(wanted_rot, tr.rot, 0.90f);
 				}
+				m_moved_entities.push(agent.entity);
+				m_moved_transforms.push(tr);
 			}
 			else {
 				*(Vec3*)dt_agent->npos = Vec3(zone_tr.invTransform(m_world.getPosition(agent.entity)));
 			}
+		}
+
+		// all agents at once, so components are notified in batches, see onAgentMoved
+		m_moving_agents = true;
+		m_world.setTransforms(m_moved_entities, m_moved_transforms);
+		m_moving_agents = false;
 
+		for (EntityRef e : zone.agents) {
+			Agent& agent = m_agents[e];
+			if (agent.path_pending) continue;
+
+			const dtCrowdAgent* dt_agent = zone.crowd->getAgent(agent.agent);
 			if (dt_agent->ncorners == 0 && dt_agent->targetState != DT_CROWDAGENT_TARGET_REQUESTING) {
 				if (!agent.is_finished) {
 					zone.crowd->resetMoveTarget(agent.agent);
@@ -463,16 +792,347 @@ struct NavigationModuleImpl final : NavigationModule
 			else {
 				agent.is_finished = false;
 			}
-			m_moving_agent = INVALID_ENTITY;
 		}
 	}
 
 	void lateUpdate(float time_delta) override {
 		PROFILE_FUNCTION();
-		if (!m_is_game_running) return;
+		// callbacks are not safe in updateParallel, where paths are found
+		for (const FinishedPathRequest& finished : m_finished_path_requests) {
+			m_path_request_finished.invoke(finished.agent, finished.success);
+			if (finished.success) continue;
+			auto iter = m_agents.find(finished.agent);
+			if (iter.isValid()) onPathFinished(iter.value());
+		}
+		m_finished_path_requests.clear();
+
+		if (m_is_game_running) {
+			for (RecastZone& zone : m_zones) {
+				lateUpdate(zone, time_delta);
+			}
+		}
+		// after crowds moved, next crowd update replans agents on swapped tiles
+		processTileRebuilds();
+	}
+
+	struct FinishedPathRequest {
+		EntityRef agent;
+		bool success;
+	};
+
+	bool startPathSearch(RecastZone& zone, RecastZone::PathQuery& q) {
+		auto iter = m_agents.find(q.request.agent);
+		if (!iter.isValid()) return false;
+		const Agent& agent = iter.value();
+		if (agent.path_request_id != q.request.id) return false;
+		if (agent.agent < 0 || !agent.zone.isValid() || (EntityRef)agent.zone != zone.entity) return false;
+
+		const dtCrowdAgent* dt_agent = zone.crowd->getAgent(agent.agent);
+		if (dt_agent->state == DT_CROWDAGENT_STATE_INVALID) return false;
+
+		const dtQueryFilter* filter = zone.crowd->getFilter(dt_agent->params.queryFilterType);
+		static const float ext[] = { 1.0f, 20.0f, 1.0f };
+		q.target_ref = 0;
+		q.query->findNearestPoly(&q.request.dest.x, ext, filter, &q.target_ref, nullptr);
+		if (!q.target_ref) return false;
+
+		const dtPolyRef start_ref = dt_agent->corridor.getFirstPoly();
+		if (!start_ref) return false;
+		return !dtStatusFailed(q.query->initSlicedFindPath(start_ref, q.target_ref, dt_agent->npos, &q.request.dest.x, filter));
+	}
+
+	static void finishPathSearch(RecastZone::PathQuery& q, dtStatus status) {
+		q.busy = false;
+		RecastZone::PathResult& result = q.results.emplace();
+		result.request = q.request;
+		result.target_ref = q.target_ref;
+		result.path_offset = q.result_polys.size();
+		result.path_count = 0;
+		if (dtStatusFailed(status)) return;
+
+		// same as dtCrowd's max path result
+		dtPolyRef path[256];
+		i32 count = 0;
+		if (dtStatusFailed(q.query->finalizeSlicedFindPath(path, &count, lengthOf(path)))) return;
+		for (i32 i = 0; i < count; ++i) q.result_polys.push(path[i]);
+		result.path_count = count;
+	}
+
+	// runs on a worker, takes requests from the shared queue until it spends `iterations`
+	void updatePathQuery(RecastZone& zone, RecastZone::PathQuery& q, AtomicI32& next_request, i32 iterations) {
+		while (iterations > 0) {
+			if (!q.busy) {
+				const i32 idx = next_request.inc();
+				if (idx >= zone.path_requests.size()) return;
+				q.request = zone.path_requests[idx];
+				q.busy = true;
+				q.restart = true;
+			}
+			if (q.restart) {
+				q.restart = false;
+				if (!startPathSearch(zone, q)) {
+					finishPathSearch(q, DT_FAILURE);
+					continue;
+				}
+			}
+			i32 done_iterations = 0;
+			const dtStatus status = q.query->updateSlicedFindPath(iterations, &done_iterations);
+			iterations -= maximum(done_iterations, 1);
+			if (!dtStatusInProgress(status)) finishPathSearch(q, status);
+		}
+	}
+
+	void applyPathResult(RecastZone& zone, const RecastZone::PathQuery& q, const RecastZone::PathResult& result) {
+		auto iter = m_agents.find(result.request.agent);
+		if (!iter.isValid()) return;
+		Agent& agent = iter.value();
+		// canceled or replaced by newer request
+		if (!agent.path_pending || agent.path_request_id != result.request.id) return;
+
+		agent.path_pending = false;
+		const bool success = result.path_count > 0
+			&& agent.agent >= 0
+			&& agent.zone.isValid()
+			&& (EntityRef)agent.zone == zone.entity
+			&& zone.crowd->setMoveTargetPath(agent.agent, result.target_ref, &result.request.dest.x, &q.result_polys[result.path_offset], result.path_count);
+		if (!success) agent.is_finished = true;
+		m_finished_path_requests.push({agent.entity, success});
+	}
+
+	// finds paths for navigate requests by sliced A* on several queries in parallel
+	// each frame, all queries of a zone together spend at most m_path_iterations_budget
+	void processPathRequests(RecastZone& zone) {
+		bool any_busy = false;
+		for (const RecastZone::PathQuery& q : zone.path_queries) any_busy = any_busy || q.busy;
+		if (!any_busy && zone.path_requests.empty()) return;
+
+		PROFILE_FUNCTION();
+		if (zone.path_queries.empty()) {
+			for (u8 i = 0; i < jobs::getWorkersCount(); ++i) {
+				RecastZone::PathQuery& q = zone.path_queries.emplace(m_allocator);
+				q.query = dtAllocNavMeshQuery();
+				if (!q.query || dtStatusFailed(q.query->init(zone.navmesh, 4096))) {
+					logError("Could not init Detour navmesh query");
+					clearPathRequests(zone);
+					return;
+				}
+			}
+		}
+
+		AtomicI32 next_request = 0;
+		const i32 iterations = maximum(m_path_iterations_budget / zone.path_queries.size(), 1);
+		jobs::forEach(zone.path_queries.size(), 1, [&](i32 from, i32 to){
+			for (i32 i = from; i < to; ++i) {
+				PROFILE_BLOCK("find path");
+				updatePathQuery(zone, zone.path_queries[i], next_request, iterations);
+			}
+		});
+
+		zone.path_requests.eraseRange(0, minimum((i32)next_request, zone.path_requests.size()));
+		for (RecastZone::PathQuery& q : zone.path_queries) {
+			for (const RecastZone::PathResult& result : q.results) applyPathResult(zone, q, result);
+			q.results.clear();
+			q.result_polys.clear();
+		}
+	}
+
+	void setPathfindingBudget(u32 iterations) override { m_path_iterations_budget = iterations; }
+	DelegateList<void(EntityRef, bool)>& pathRequestFinished() override { return m_path_request_finished; }
+
+	// tile rebuilt in background because obstacles changed
+	struct TileRebuild {
+		TileRebuild(IAllocator& allocator)
+			: geom(allocator)
+			, cache(allocator)
+			, obstacles(allocator)
+		{}
+
+		EntityRef zone;
+		u32 navmesh_version;
+		NavmeshZone params;
+		u32 tile;
+		i32 x;
+		i32 z;
+		// geometry is gathered only if the tile is not in cache yet
+		bool has_geom = false;
+		NavmeshInputGeometry geom;
+		RecastZone::CachedTile cache;
+		Array<NavmeshObstacle> obstacles;
+		u8* nav_data = nullptr;
+		i32 nav_data_size = 0;
+		bool success = false;
+		AtomicI32 done = 0;
+	};
+
+	u32 addBoxObstacle(EntityRef zone_entity, const DVec3& center, const Vec3& half_extents) override {
+		RecastZone& zone = m_zones[zone_entity];
+		const Transform zone_tr = m_world.getTransform(zone_entity);
+		NavmeshObstacle& obstacle = zone.obstacles.emplace();
+		obstacle.id = m_next_obstacle_id++;
+		obstacle.pos = Vec3(zone_tr.invTransform(center));
+		obstacle.half_extents = half_extents;
+		markTilesDirty(zone, obstacle.getAABB());
+		return obstacle.id;
+	}
+
+	u32 addCylinderObstacle(EntityRef zone_entity, const DVec3& pos, float radius, float height) override {
+		RecastZone& zone = m_zones[zone_entity];
+		const Transform zone_tr = m_world.getTransform(zone_entity);
+		NavmeshObstacle& obstacle = zone.obstacles.emplace();
+		obstacle.id = m_next_obstacle_id++;
+		obstacle.pos = Vec3(zone_tr.invTransform(pos));
+		obstacle.half_extents = Vec3(radius, height * 0.5f, radius);
+		obstacle.radius = radius;
+		obstacle.height = height;
+		markTilesDirty(zone, obstacle.getAABB());
+		return obstacle.id;
+	}
+
+	void removeObstacle(EntityRef zone_entity, u32 obstacle) override {
+		RecastZone& zone = m_zones[zone_entity];
+		for (i32 i = 0; i < zone.obstacles.size(); ++i) {
+			if (zone.obstacles[i].id != obstacle) continue;
+			markTilesDirty(zone, zone.obstacles[i].getAABB());
+			zone.obstacles.swapAndPop(i);
+			return;
+		}
+	}
+
+	void setTileRebuildBudget(float ms) override { m_tile_rebuild_budget_ms = ms; }
+
+	void markTilesDirty(RecastZone& zone, const AABB& aabb) {
+		if (!zone.navmesh || zone.m_num_tiles_x == 0 || zone.m_num_tiles_z == 0) return;
+
+		// tiles' borders overlap their neighbours
+		const float tile_size = CELLS_PER_TILE_SIDE * zone.zone.cell_size;
+		const float pad = (1 + getVoxelBorderSize(zone.zone)) * zone.zone.cell_size;
+		const Vec2 min = -zone.zone.extents.xz();
+		const Vec2 from = (aabb.min.xz() - min - Vec2(pad)) / tile_size;
+		const Vec2 to = (aabb.max.xz() - min + Vec2(pad)) / tile_size;
+		const i32 from_x = maximum(i32(floorf(from.x)), 0);
+		const i32 from_z = maximum(i32(floorf(from.y)), 0);
+		const i32 to_x = minimum(i32(floorf(to.x)), i32(zone.m_num_tiles_x) - 1);
+		const i32 to_z = minimum(i32(floorf(to.y)), i32(zone.m_num_tiles_z) - 1);
+		for (i32 z = from_z; z <= to_z; ++z) {
+			for (i32 x = from_x; x <= to_x; ++x) {
+				const u32 tile = z * zone.m_num_tiles_x + x;
+				if (zone.dirty_tiles.indexOf(tile) < 0) zone.dirty_tiles.push(tile);
+			}
+		}
+	}
+
+	bool isTileRebuilding(EntityRef zone, u32 tile) const {
+		for (const TileRebuild* rebuild : m_tile_rebuilds) {
+			if (rebuild->zone == zone && rebuild->tile == tile) return true;
+		}
+		return false;
+	}
+
+	void startTileRebuild(RecastZone& zone, u32 tile) {
+		PROFILE_FUNCTION();
+		initTileCache(zone);
+
+		TileRebuild* rebuild = LUMIX_NEW(m_allocator, TileRebuild)(m_allocator);
+		rebuild->zone = zone.entity;
+		rebuild->navmesh_version = zone.navmesh_version;
+		rebuild->params = zone.zone;
+		rebuild->tile = tile;
+		rebuild->x = tile % zone.m_num_tiles_x;
+		rebuild->z = tile / zone.m_num_tiles_x;
+		for (const NavmeshObstacle& obstacle : zone.obstacles) rebuild->obstacles.push(obstacle);
+		
+		const RecastZone::CachedTile& cached = zone.tile_cache[tile];
+		if (cached.size > 0) {
+			rebuild->cache.key = cached.key;
+			rebuild->cache.size = cached.size;
+			rebuild->cache.data.write(cached.data.data(), cached.data.size());
+		}
+		else {
+			// world is accessed only on main thread
+			rebuild->has_geom = true;
+			buildInputGeometry(zone, IVec2(rebuild->x, rebuild->z), IVec2(rebuild->x + 1, rebuild->z + 1), getVoxelBorderSize(zone.zone), rebuild->geom);
+		}
+		m_tile_rebuilds.push(rebuild);
+
+		jobs::runLambda([this, rebuild](){
+			rebuild->success = buildTileData(rebuild->params
+				, rebuild->has_geom ? &rebuild->geom : nullptr
+				, rebuild->obstacles
+				, rebuild->x
+				, rebuild->z
+				, &rebuild->cache
+				, nullptr
+				, &rebuild->nav_data
+				, &rebuild->nav_data_size);
+			rebuild->done = 1;
+		}, &m_tile_rebuild_signal, jobs::ANY_WORKER, jobs::Priority::BACKGROUND);
+	}
+
+	void finishTileRebuild(TileRebuild& rebuild) {
+		PROFILE_FUNCTION();
+		auto iter = m_zones.find(rebuild.zone);
+		const bool valid = rebuild.success
+			&& iter.isValid()
+			&& iter.value().navmesh
+			&& iter.value().navmesh_version == rebuild.navmesh_version;
+		if (!valid) {
+			dtFree(rebuild.nav_data);
+			return;
+		}
+
+		RecastZone& zone = iter.value();
+		if (rebuild.cache.size > 0) zone.tile_cache[rebuild.tile] = static_cast<RecastZone::CachedTile&&>(rebuild.cache);
+
+		// searches in progress could reference removed polygons
+		for (RecastZone::PathQuery& q : zone.path_queries) q.restart = q.busy;
+
+		// crowd agents on removed polygons get replanned by dtCrowd's path validity check
+		zone.navmesh->removeTile(zone.navmesh->getTileRefAt(rebuild.x, rebuild.z, 0), 0, 0);
+		if (!rebuild.nav_data) return;
+		if (dtStatusFailed(zone.navmesh->addTile(rebuild.nav_data, rebuild.nav_data_size, DT_TILE_FREE_DATA, 0, nullptr))) {
+			dtFree(rebuild.nav_data);
+			logError("Could not add Detour tile.");
+		}
+	}
+
+	// swaps in finished tiles and starts rebuilds of dirty tiles, while within the time budget
+	void processTileRebuilds() {
+		if (m_tile_rebuilds.empty()) {
+			bool any_dirty = false;
+			for (const RecastZone& zone : m_zones) any_dirty = any_dirty || !zone.dirty_tiles.empty();
+			if (!any_dirty) return;
+		}
+
+		PROFILE_FUNCTION();
+		const os::Timer timer;
+		const float budget = m_tile_rebuild_budget_ms / 1000.f;
+
+		for (i32 i = 0; i < m_tile_rebuilds.size();) {
+			if (timer.getTimeSinceStart() > budget) return;
+			TileRebuild* rebuild = m_tile_rebuilds[i];
+			if (rebuild->done == 0) {
+				++i;
+				continue;
+			}
+			finishTileRebuild(*rebuild);
+			LUMIX_DELETE(m_allocator, rebuild);
+			m_tile_rebuilds.erase(i);
+		}
 
 		for (RecastZone& zone : m_zones) {
-			lateUpdate(zone, time_delta);
+			for (i32 i = 0; i < zone.dirty_tiles.size();) {
+				if (m_tile_rebuilds.size() >= (i32)jobs::getWorkersCount()) return;
+				if (timer.getTimeSinceStart() > budget) return;
+				
+				const u32 tile = zone.dirty_tiles[i];
+				// dirty again while being rebuilt, wait for the current rebuild to finish
+				if (isTileRebuilding(zone.entity, tile)) {
+					++i;
+					continue;
+				}
+				zone.dirty_tiles.erase(i);
+				startTileRebuild(zone, tile);
+			}
 		}
 	}
 
@@ -491,7 +1151,9 @@ struct NavigationModuleImpl final : NavigationModule
 	}
 
 
-	static void drawPoly(RenderModule* render_module, const Transform& tr, const dtMeshTile& tile, const dtPoly& poly)
+	// `out` is RenderModule or DebugGeometry
+	template <typename T>
+	static void drawPoly(T& out, const Transform& tr, const dtMeshTile& tile, const dtPoly& poly)
 	{
 		const unsigned int ip = (unsigned int)(&poly - tile.polys);
 		const dtPolyDetail& pd = tile.detailMeshes[ip];
@@ -511,7 +1173,7 @@ struct NavigationModuleImpl final : NavigationModule
 					v[k] = *(Vec3*)&tile.detailVerts[(pd.vertBase + t[k] - poly.vertCount) * 3];
 				}
 			}
-			render_module->addDebugTriangle(tr.transform(v[0]), tr.transform(v[1]), tr.transform(v[2]), 0xff00aaff);
+			out.addDebugTriangle(tr.transform(v[0]), tr.transform(v[1]), tr.transform(v[2]), 0xff00aaff);
 		}
 
 		for (int k = 0; k < pd.triCount; ++k)
@@ -528,7 +1190,7 @@ struct NavigationModuleImpl final : NavigationModule
 			for (int m = 0, n = 2; m < 3; n = m++)
 			{
 				if (((t[3] >> (n * 2)) & 0x3) == 0) continue; // Skip inner detail edges.
-				render_module->addDebugLine(tr.transform(*(Vec3*)tv[n]), tr.transform(*(Vec3*)tv[m]), 0xff0000ff);
+				out.addDebugLine(tr.transform(*(Vec3*)tv[n]), tr.transform(*(Vec3*)tv[m]), 0xff0000ff);
 			}
 		}
 	}
@@ -581,7 +1243,7 @@ struct NavigationModuleImpl final : NavigationModule
 				const dtPoly* poly = nullptr;
 				if (dtStatusFailed(zone.navmesh->getTileAndPolyByRef(ref, &tile, &poly))) continue;
 
-				drawPoly(render_module, zone_tr, *tile, *poly);
+				drawPoly(*render_module, zone_tr, *tile, *poly);
 			}
 		}
 
@@ -723,6 +1385,8 @@ struct NavigationModuleImpl final : NavigationModule
 	bool loadZone(EntityRef zone_entity) override {
 		RecastZone& zone = m_zones[zone_entity];
 		clearNavmesh(zone);
+		// loaded navmesh might not match cached tiles
+		clearTileCache(zone);
 
 		LoadCallback* lcb = LUMIX_NEW(m_allocator, LoadCallback)(*this, zone_entity);
 
@@ -846,7 +1510,8 @@ struct NavigationModuleImpl final : NavigationModule
 	}
 
 
-	static void drawPolyBoundaries(RenderModule* render_module,
+	template <typename T>
+	static void drawPolyBoundaries(T& out,
 		const Transform& tr,
 		const dtMeshTile& tile,
 		const unsigned int col,
@@ -913,7 +1578,7 @@ struct NavigationModuleImpl final : NavigationModule
 						if (((t[3] >> (n * 2)) & 0x3) == 0) continue; // Skip inner detail edges.
 						if (distancePtLine2d(tv[n], v0, v1) < thr && distancePtLine2d(tv[m], v0, v1) < thr)
 						{
-							render_module->addDebugLine(tr.transform(*(Vec3*)tv[n] + Vec3(0, 0.5f, 0))
+							out.addDebugLine(tr.transform(*(Vec3*)tv[n] + Vec3(0, 0.5f, 0))
 								, tr.transform(*(Vec3*)tv[m] + Vec3(0, 0.5f, 0))
 								, c);
 						}
@@ -923,7 +1588,8 @@ struct NavigationModuleImpl final : NavigationModule
 		}
 	}
 
-	static void drawTilePortal(RenderModule* render_module, const Transform& zone_tr, const dtMeshTile& tile) {
+	template <typename T>
+	static void drawTilePortal(T& out, const Transform& zone_tr, const dtMeshTile& tile) {
 		const float padx = 0.04f;
 		const float pady = tile.header->walkableClimb;
 
@@ -945,20 +1611,20 @@ struct NavigationModuleImpl final : NavigationModule
 
 						const float x = va[0] + ((side == 0) ? -padx : padx);
 
-						render_module->addDebugLine(zone_tr.transform(Vec3(x, va[1] - pady, va[2])), zone_tr.transform(Vec3(x, va[1] + pady, va[2])), col);
-						render_module->addDebugLine(zone_tr.transform(Vec3(x, va[1] + pady, va[2])), zone_tr.transform(Vec3(x, vb[1] + pady, vb[2])), col);
-						render_module->addDebugLine(zone_tr.transform(Vec3(x, vb[1] + pady, vb[2])), zone_tr.transform(Vec3(x, vb[1] - pady, vb[2])), col);
-						render_module->addDebugLine(zone_tr.transform(Vec3(x, vb[1] - pady, vb[2])), zone_tr.transform(Vec3(x, va[1] - pady, va[2])), col);
+						out.addDebugLine(zone_tr.transform(Vec3(x, va[1] - pady, va[2])), zone_tr.transform(Vec3(x, va[1] + pady, va[2])), col);
+						out.addDebugLine(zone_tr.transform(Vec3(x, va[1] + pady, va[2])), zone_tr.transform(Vec3(x, vb[1] + pady, vb[2])), col);
+						out.addDebugLine(zone_tr.transform(Vec3(x, vb[1] + pady, vb[2])), zone_tr.transform(Vec3(x, vb[1] - pady, vb[2])), col);
+						out.addDebugLine(zone_tr.transform(Vec3(x, vb[1] - pady, vb[2])), zone_tr.transform(Vec3(x, va[1] - pady, va[2])), col);
 					}
 					else if (side == 2 || side == 6) {
 						unsigned int col = side == 2 ? 0xff00aa00 : 0xffaaaa00;
 
 						const float z = va[2] + ((side == 2) ? -padx : padx);
 
-						render_module->addDebugLine(zone_tr.transform(Vec3(va[0], va[1] - pady, z)), zone_tr.transform(Vec3(va[0], va[1] + pady, z)), col);
-						render_module->addDebugLine(zone_tr.transform(Vec3(va[0], va[1] + pady, z)), zone_tr.transform(Vec3(vb[0], vb[1] + pady, z)), col);
-						render_module->addDebugLine(zone_tr.transform(Vec3(vb[0], vb[1] + pady, z)), zone_tr.transform(Vec3(vb[0], vb[1] - pady, z)), col);
-						render_module->addDebugLine(zone_tr.transform(Vec3(vb[0], vb[1] - pady, z)), zone_tr.transform(Vec3(va[0], va[1] - pady, z)), col);
+						out.addDebugLine(zone_tr.transform(Vec3(va[0], va[1] - pady, z)), zone_tr.transform(Vec3(va[0], va[1] + pady, z)), col);
+						out.addDebugLine(zone_tr.transform(Vec3(va[0], va[1] + pady, z)), zone_tr.transform(Vec3(vb[0], vb[1] + pady, z)), col);
+						out.addDebugLine(zone_tr.transform(Vec3(vb[0], vb[1] + pady, z)), zone_tr.transform(Vec3(vb[0], vb[1] - pady, z)), col);
+						out.addDebugLine(zone_tr.transform(Vec3(vb[0], vb[1] - pady, z)), zone_tr.transform(Vec3(va[0], va[1] - pady, z)), col);
 					}
 				}
 			}
@@ -968,7 +1634,7 @@ struct NavigationModuleImpl final : NavigationModule
 
 	void debugDrawNavmesh(EntityRef zone_entity, const DVec3& world_pos, bool inner_boundaries, bool outer_boundaries, bool portals) override
 	{
-		const RecastZone& zone = m_zones[zone_entity];
+		RecastZone& zone = m_zones[zone_entity];
 		if (!zone.navmesh) return;
 
 		const Transform tr = m_world.getTransform(zone_entity);
@@ -986,16 +1652,39 @@ struct NavigationModuleImpl final : NavigationModule
 		const dtMeshTile* tile = zone.navmesh->getTileAt(x, z, 0);
 		if (!tile) return;
 
-		for (int i = 0; i < tile->header->polyCount; ++i) {
-			const dtPoly* p = &tile->polys[i];
-			if (p->getType() == DT_POLYTYPE_OFFMESH_CONNECTION) continue;
-			drawPoly(render_module, tr, *tile, *p);
-		}
+		// geometry is generated and uploaded only when something changes, tile's salt changes when it's rebuilt
+		struct {
+			const dtMeshTile* tile;
+			u32 salt;
+			u32 navmesh_version;
+			u32 flags;
+			Transform tr;
+		} key;
+		memset(&key, 0, sizeof(key));
+		key.tile = tile;
+		key.salt = tile->salt;
+		key.navmesh_version = zone.navmesh_version;
+		key.flags = (inner_boundaries ? 1 : 0) | (outer_boundaries ? 2 : 0) | (portals ? 4 : 0);
+		key.tr = tr;
+		const RuntimeHash key_hash(&key, sizeof(key));
+
+		if (zone.debug_batch == INVALID_DEBUG_BATCH) zone.debug_batch = render_module->createDebugBatch();
+		if (zone.debug_batch_key != key_hash) {
+			zone.debug_batch_key = key_hash;
+			DebugGeometry geometry(m_allocator);
+			for (int i = 0; i < tile->header->polyCount; ++i) {
+				const dtPoly* p = &tile->polys[i];
+				if (p->getType() == DT_POLYTYPE_OFFMESH_CONNECTION) continue;
+				drawPoly(geometry, tr, *tile, *p);
+			}
 
-		if (outer_boundaries) drawPolyBoundaries(render_module, tr, *tile, 0xffff0000, false);
-		if (inner_boundaries) drawPolyBoundaries(render_module, tr, *tile, 0xffff0000, true);
+			if (outer_boundaries) drawPolyBoundaries(geometry, tr, *tile, 0xffff0000, false);
+			if (inner_boundaries) drawPolyBoundaries(geometry, tr, *tile, 0xffff0000, true);
 
-		if (portals) drawTilePortal(render_module, tr, *tile);
+			if (portals) drawTilePortal(geometry, tr, *tile);
+			render_module->setDebugBatch(zone.debug_batch, geometry);
+		}
+		render_module->drawDebugBatch(zone.debug_batch);
 	}
 
 
@@ -1004,12 +1693,8 @@ struct NavigationModuleImpl final : NavigationModule
 		m_is_game_running = false;
 		for (RecastZone& zone : m_zones) {
 			if (zone.crowd) {
-				for (Agent& agent : m_agents) {
-					if (agent.zone == zone.entity) {
-						zone.crowd->removeAgent(agent.agent);
-						agent.agent = -1;
-					}
-				}
+				for (EntityRef e : zone.agents) m_agents[e].agent = -1;
+				zone.agents.clear();
 				dtFreeCrowd(zone.crowd);
 				zone.crowd = nullptr;
 			}
@@ -1029,6 +1714,13 @@ struct NavigationModuleImpl final : NavigationModule
 	}
 
 
+	static void crowdParallelFor(void*, const int count, void (*func)(void* data, const int idx), void* data) {
+		jobs::forEach(count, 1, [&](i32 from, i32 to){
+			PROFILE_BLOCK("dtCrowd batch");
+			for (i32 i = from; i < to; ++i) func(data, i);
+		});
+	}
+
 	bool initCrowd(RecastZone& zone) {
 		ASSERT(!zone.crowd);
 
@@ -1038,6 +1730,7 @@ struct NavigationModuleImpl final : NavigationModule
 			zone.crowd = nullptr;
 			return false;
 		}
+		zone.crowd->setParallelFor(&crowdParallelFor, nullptr, jobs::getWorkersCount());
 
 		const Transform zone_tr = m_world.getTransform(zone.entity);
 		const Vec3 min = -zone.zone.extents;
@@ -1072,6 +1765,9 @@ struct NavigationModuleImpl final : NavigationModule
 		
 		RecastZone* zone = getZone(agent);
 
+		// result of pending request is dropped
+		++agent.path_request_id;
+		agent.path_pending = false;
 		if (zone) {
 			zone->crowd->resetMoveTarget(agent.agent);
 		}
@@ -1088,29 +1784,23 @@ struct NavigationModuleImpl final : NavigationModule
 
 		RecastZone& zone = m_zones[(EntityRef)agent.zone];
 
-		if (!zone.navquery) return false;
 		if (!zone.crowd) return false;
 
-		dtPolyRef end_poly_ref;
-		dtQueryFilter filter;
-		static const float ext[] = { 1.0f, 20.0f, 1.0f };
-
 		const Transform zone_tr = m_world.getTransform(zone.entity);
-		const Vec3 dest = Vec3(zone_tr.invTransform(world_dest));
 
-		zone.navquery->findNearestPoly(&dest.x, ext, &filter, &end_poly_ref, 0);
 		dtCrowdAgentParams params = zone.crowd->getAgent(agent.agent)->params;
 		params.maxSpeed = speed;
 		zone.crowd->updateAgentParameters(agent.agent, &params);
-		if (zone.crowd->requestMoveTarget(agent.agent, end_poly_ref, &dest.x)) {
-			agent.stop_distance = stop_distance;
-			agent.is_finished = false;
-		}
-		else {
-			logError("requestMoveTarget failed, entity ", entity.index);
-			agent.is_finished = true;
-		}
-		return !agent.is_finished;
+
+		// path is found later in updateParallel, see processPathRequests
+		PathRequest& request = zone.path_requests.emplace();
+		request.agent = entity;
+		request.id = ++agent.path_request_id;
+		request.dest = Vec3(zone_tr.invTransform(world_dest));
+		agent.path_pending = true;
+		agent.stop_distance = stop_distance;
+		agent.is_finished = false;
+		return true;
 	}
 
 	bool generateTileAt(EntityRef zone_entity, const DVec3& world_pos, bool keep_data) override {
@@ -1124,83 +1814,170 @@ struct NavigationModuleImpl final : NavigationModule
 		const int z = int((pos.z - min.z + (1 + zone.getBorderSize()) * zone.zone.cell_size) / (CELLS_PER_TILE_SIDE * zone.zone.cell_size));
 		zone.navmesh->removeTile(zone.navmesh->getTileRefAt(x, z, 0), 0, 0);
 
+		NavmeshInputGeometry geom(m_allocator);
+		buildInputGeometry(zone, IVec2(x, z), IVec2(x + 1, z + 1), getVoxelBorderSize(zone.zone), geom);
 		Mutex mutex;
-		return generateTile(zone, zone_entity, x, z, keep_data, mutex);
+		return generateTile(zone, geom, zone.obstacles, x, z, keep_data, nullptr, mutex);
+	}
+
+	StableHash hashTileInput(const NavmeshInputGeometry& geom, i32 tile, const rcConfig& config) {
+		RollingStableHasher hasher;
+		hasher.begin();
+		hasher.update(&config.cs, sizeof(config.cs));
+		hasher.update(&config.ch, sizeof(config.ch));
+		hasher.update(&config.borderSize, sizeof(config.borderSize));
+		hasher.update(&config.walkableHeight, sizeof(config.walkableHeight));
+		hasher.update(&config.walkableClimb, sizeof(config.walkableClimb));
+		hasher.update(config.bmin, sizeof(config.bmin));
+		hasher.update(config.bmax, sizeof(config.bmax));
+		for (u32 i = geom.tile_offsets[tile], end = geom.tile_offsets[tile + 1]; i < end; ++i) {
+			const u32 tri = geom.tile_triangles[i];
+			hasher.update(&geom.verts[tri * 3], sizeof(Vec3) * 3);
+			hasher.update(&geom.areas[tri], sizeof(u8));
+		}
+		return hasher.end64();
+	}
+
+	bool generateTile(RecastZone& zone, const NavmeshInputGeometry& geom, Span<const NavmeshObstacle> obstacles, int x, int z, bool keep_data, RecastZone::CachedTile* cached, Mutex& mutex) {
+		ASSERT(zone.navmesh);
+		if (keep_data) m_debug_tile_origin = getTileAABB(zone.zone, x, z, getVoxelBorderSize(zone.zone)).min;
+
+		u8* nav_data = nullptr;
+		i32 nav_data_size = 0;
+		if (!buildTileData(zone.zone, &geom, obstacles, x, z, cached, keep_data ? &zone : nullptr, &nav_data, &nav_data_size)) return false;
+		// no geometry in tile
+		if (!nav_data) return true;
+
+		MutexGuard guard(mutex);
+		if (dtStatusFailed(zone.navmesh->addTile(nav_data, nav_data_size, DT_TILE_FREE_DATA, 0, nullptr))) {
+			dtFree(nav_data);
+			logError("Could not add Detour tile.");
+			return false;
+		}
+		return true;
 	}
 
-	bool generateTile(RecastZone& zone, EntityRef zone_entity, int x, int z, bool keep_data, Mutex& mutex) {
+	// builds Detour data of tile `x`, `z` into `nav_data`, which is null if there is no walkable geometry in the tile
+	// `cached` is used instead of voxelizing `geom` if it's valid or if there's no `geom`, and updated otherwise
+	// `debug_zone` keeps intermediate data for debug drawing
+	bool buildTileData(const NavmeshZone& zone
+		, const NavmeshInputGeometry* geom
+		, Span<const NavmeshObstacle> obstacles
+		, int x
+		, int z
+		, RecastZone::CachedTile* cached
+		, RecastZone* debug_zone
+		, u8** nav_data
+		, i32* nav_data_size)
+	{
 		PROFILE_FUNCTION();
 		// TODO some stuff leaks on errors
-		ASSERT(zone.navmesh);
+		ASSERT(geom || (cached && cached->size > 0));
+		const bool keep_data = debug_zone != nullptr;
+		*nav_data = nullptr;
+		*nav_data_size = 0;
 
 		rcConfig config;
 		static const float DETAIL_SAMPLE_DIST = 6;
 		static const float DETAIL_SAMPLE_MAX_ERROR = 1;
 
-		config.cs = zone.zone.cell_size;
-		config.ch = zone.zone.cell_height;
-		config.walkableSlopeAngle = zone.zone.walkable_slope_angle;
-		config.walkableHeight = int(zone.zone.agent_height / config.ch + 0.99f);
-		config.walkableClimb = int(zone.zone.max_climb / config.ch);
-		config.walkableRadius = int(zone.zone.agent_radius / config.cs + 0.99f);
+		config.cs = zone.cell_size;
+		config.ch = zone.cell_height;
+		config.walkableSlopeAngle = zone.walkable_slope_angle;
+		config.walkableHeight = int(zone.agent_height / config.ch + 0.99f);
+		config.walkableClimb = int(zone.max_climb / config.ch);
+		config.walkableRadius = int(zone.agent_radius / config.cs + 0.99f);
 		config.maxEdgeLen = int(12 / config.cs);
 		config.maxSimplificationError = 1.3f;
 		config.minRegionArea = 8 * 8;
 		config.mergeRegionArea = 20 * 20;
 		config.maxVertsPerPoly = 6;
-		config.detailSampleDist = DETAIL_SAMPLE_DIST < 0.9f ? 0 : zone.zone.cell_size * DETAIL_SAMPLE_DIST;
+		config.detailSampleDist = DETAIL_SAMPLE_DIST < 0.9f ? 0 : zone.cell_size * DETAIL_SAMPLE_DIST;
 		config.detailSampleMaxError = config.ch * DETAIL_SAMPLE_MAX_ERROR;
-		config.borderSize = config.walkableRadius + 3;
+		config.borderSize = getVoxelBorderSize(zone);
 		config.tileSize = CELLS_PER_TILE_SIDE;
 		config.width = config.tileSize + config.borderSize * 2;
 		config.height = config.tileSize + config.borderSize * 2;
 
 		rcContext ctx;
-		const Vec3 min = -zone.zone.extents;
-		const Vec3 max = zone.zone.extents;
-		Vec3 bmin(min.x + x * CELLS_PER_TILE_SIDE * zone.zone.cell_size - (1 + config.borderSize) * config.cs,
-			min.y,
-			min.z + z * CELLS_PER_TILE_SIDE * zone.zone.cell_size - (1 + config.borderSize) * config.cs);
-		Vec3 bmax(bmin.x + CELLS_PER_TILE_SIDE * zone.zone.cell_size + (1 + config.borderSize) * config.cs * 2,
-			max.y,
-			bmin.z + CELLS_PER_TILE_SIDE * zone.zone.cell_size + (1 + config.borderSize) * config.cs * 2);
-		if (keep_data) m_debug_tile_origin = bmin;
-		rcVcopy(config.bmin, &bmin.x);
-		rcVcopy(config.bmax, &bmax.x);
-		rcHeightfield* solid = rcAllocHeightfield();
-		zone.debug_heightfield = keep_data ? solid : nullptr;
-		if (!solid) {
-			logError("Could not generate navmesh: Out of memory 'solid'.");
-			return false;
+		const AABB tile_aabb = getTileAABB(zone, x, z, config.borderSize);
+		rcVcopy(config.bmin, &tile_aabb.min.x);
+		rcVcopy(config.bmax, &tile_aabb.max.x);
+
+		const i32 geom_tile = geom ? (z - geom->from_tile.y) * (geom->to_tile.x - geom->from_tile.x) + (x - geom->from_tile.x) : 0;
+		const StableHash cache_key = cached && geom ? hashTileInput(*geom, geom_tile, config) : StableHash();
+		rcCompactHeightfield* chf = nullptr;
+		if (cached && cached->size > 0 && (!geom || cached->key == cache_key)) {
+			chf = decompressTile(*cached);
+			if (!chf) {
+				logError("Could not generate navmesh: Could not decompress cached tile.");
+				return false;
+			}
 		}
+		if (debug_zone) debug_zone->debug_heightfield = nullptr;
 
-		if (!rcCreateHeightfield(
-				&ctx, *solid, config.width, config.height, config.bmin, config.bmax, config.cs, config.ch))
-		{
-			logError("Could not generate navmesh: Could not create solid heightfield.");
-			return false;
-		}
+		if (!chf) {
+			PROFILE_BLOCK("voxelize");
+			rcHeightfield* solid = rcAllocHeightfield();
+			if (debug_zone) debug_zone->debug_heightfield = solid;
+			if (!solid) {
+				logError("Could not generate navmesh: Out of memory 'solid'.");
+				return false;
+			}
 
-		const Transform tr = m_world.getTransform(zone_entity);
-		rasterizeGeometry(tr, AABB(bmin, bmax), ctx, config, *solid);
+			if (!rcCreateHeightfield(
+					&ctx, *solid, config.width, config.height, config.bmin, config.bmax, config.cs, config.ch))
+			{
+				logError("Could not generate navmesh: Could not create solid heightfield.");
+				return false;
+			}
 
-		rcFilterLowHangingWalkableObstacles(&ctx, config.walkableClimb, *solid);
-		rcFilterLedgeSpans(&ctx, config.walkableHeight, config.walkableClimb, *solid);
-		rcFilterWalkableLowHeightSpans(&ctx, config.walkableHeight, *solid);
+			for (u32 i = geom->tile_offsets[geom_tile], end = geom->tile_offsets[geom_tile + 1]; i < end; ++i) {
+				const u32 tri = geom->tile_triangles[i];
+				const Vec3* v = &geom->verts[tri * 3];
+				rcRasterizeTriangle(&ctx, &v[0].x, &v[1].x, &v[2].x, geom->areas[tri], *solid);
+			}
 
-		rcCompactHeightfield* chf = rcAllocCompactHeightfield();
-		zone.debug_compact_heightfield = keep_data ? chf : nullptr;
-		if (!chf) {
-			logError("Could not generate navmesh: Out of memory 'chf'.");
-			return false;
-		}
+			rcFilterLowHangingWalkableObstacles(&ctx, config.walkableClimb, *solid);
+			rcFilterLedgeSpans(&ctx, config.walkableHeight, config.walkableClimb, *solid);
+			rcFilterWalkableLowHeightSpans(&ctx, config.walkableHeight, *solid);
 
-		if (!rcBuildCompactHeightfield(&ctx, config.walkableHeight, config.walkableClimb, *solid, *chf)) {
-			logError("Could not generate navmesh: Could not build compact data.");
-			return false;
+			chf = rcAllocCompactHeightfield();
+			if (!chf) {
+				logError("Could not generate navmesh: Out of memory 'chf'.");
+				return false;
+			}
+
+			if (!rcBuildCompactHeightfield(&ctx, config.walkableHeight, config.walkableClimb, *solid, *chf)) {
+				logError("Could not generate navmesh: Could not build compact data.");
+				return false;
+			}
+
+			if (!keep_data) rcFreeHeightField(solid);
+
+			if (cached) {
+				// obstacles, erosion and regions modify chf, so cache a compressed copy of it
+				if (compressTile(*chf, *cached)) {
+					cached->key = cache_key;
+				}
+				else {
+					cached->size = 0;
+				}
+			}
 		}
+		if (debug_zone) debug_zone->debug_compact_heightfield = chf;
 
-		if (!zone.debug_heightfield) rcFreeHeightField(solid);
+		for (const NavmeshObstacle& obstacle : obstacles) {
+			if (!obstacle.getAABB().overlaps(tile_aabb)) continue;
+			if (obstacle.radius > 0) {
+				rcMarkCylinderArea(&ctx, &obstacle.pos.x, obstacle.radius, obstacle.height, RC_NULL_AREA, *chf);
+			}
+			else {
+				const Vec3 bmin = obstacle.pos - obstacle.half_extents;
+				const Vec3 bmax = obstacle.pos + obstacle.half_extents;
+				rcMarkBoxArea(&ctx, &bmin.x, &bmax.x, RC_NULL_AREA, *chf);
+			}
+		}
 
 		if (!rcErodeWalkableArea(&ctx, config.walkableRadius, *chf)) {
 			logError("Could not generate navmesh: Could not erode.");
@@ -1218,7 +1995,7 @@ struct NavigationModuleImpl final : NavigationModule
 		}
 
 		rcContourSet* cset = rcAllocContourSet();
-		zone.debug_contours = keep_data ? cset : nullptr;
+		if (debug_zone) debug_zone->debug_contours = cset;
 		if (!cset) {
 			ctx.log(RC_LOG_ERROR, "Could not generate navmesh: Out of memory 'cset'.");
 			return false;
@@ -1240,7 +2017,7 @@ struct NavigationModuleImpl final : NavigationModule
 		}
 		
 		rcPolyMeshDetail* detail_mesh = nullptr;
-		if (zone.zone.flags & NavmeshZone::DETAILED) {
+		if (zone.flags & NavmeshZone::DETAILED) {
 			detail_mesh = rcAllocPolyMeshDetail();
 			if (!detail_mesh) {
 				logError("Could not generate navmesh: Out of memory 'pmdtl'.");
@@ -1254,11 +2031,10 @@ struct NavigationModuleImpl final : NavigationModule
 			}
 		}
 
-		if (!zone.debug_compact_heightfield) rcFreeCompactHeightfield(chf);
-		if (!zone.debug_contours) rcFreeContourSet(cset);
-
-		unsigned char* nav_data = 0;
-		int nav_data_size = 0;
+		if (!keep_data) {
+			rcFreeCompactHeightfield(chf);
+			rcFreeContourSet(cset);
+		}
 
 		for (int i = 0; i < polymesh->npolys; ++i) {
 			polymesh->flags[i] = polymesh->areas[i] == RC_WALKABLE_AREA ? 1 : 0;
@@ -1290,8 +2066,7 @@ struct NavigationModuleImpl final : NavigationModule
 		params.ch = config.ch;
 		params.buildBvTree = false;
 
-		MutexGuard guard(mutex);
-		if (!dtCreateNavMeshData(&params, &nav_data, &nav_data_size)) {
+		if (!dtCreateNavMeshData(&params, nav_data, nav_data_size)) {
 			if (polymesh->npolys == 0) {
 				// no geometry in tile
 				rcFreePolyMesh(polymesh);
@@ -1304,12 +2079,6 @@ struct NavigationModuleImpl final : NavigationModule
 
 		rcFreePolyMesh(polymesh);
 		if (detail_mesh) rcFreePolyMeshDetail(detail_mesh);
-
-		if (dtStatusFailed(zone.navmesh->addTile(nav_data, nav_data_size, DT_TILE_FREE_DATA, 0, nullptr))) {
-			logError("Could not add Detour tile.");
-			return false;
-		}
-
 		return true;
 	}
 
@@ -1341,6 +2110,8 @@ struct NavigationModuleImpl final : NavigationModule
 	}
 
 	struct NavmeshBuildJobImpl : NavmeshBuildJob {
+		NavmeshBuildJobImpl(IAllocator& allocator) : geom(allocator), obstacles(allocator) {}
+
 		~NavmeshBuildJobImpl() {
 			jobs::wait(&signal);
 		}
@@ -1360,7 +2131,7 @@ struct NavigationModuleImpl final : NavigationModule
 					return;
 				}
 
-				if (!module->generateTile(*zone, zone_entity, i % zone->m_num_tiles_x, i / zone->m_num_tiles_x, false, mutex)) {
+				if (!module->generateTile(*zone, geom, obstacles, i % zone->m_num_tiles_x, i / zone->m_num_tiles_x, false, &zone->tile_cache[i], mutex)) {
 					fail_counter.inc();
 				}
 				else {
@@ -1368,7 +2139,7 @@ struct NavigationModuleImpl final : NavigationModule
 				}
 
 				pushJob();
-			}, &signal);
+			}, &signal, jobs::ANY_WORKER, jobs::Priority::BACKGROUND);
 		}
 
 		void run() {
@@ -1386,6 +2157,8 @@ struct NavigationModuleImpl final : NavigationModule
 		RecastZone* zone;
 		EntityRef zone_entity;
 		NavigationModuleImpl* module;
+		NavmeshInputGeometry geom;
+		Array<NavmeshObstacle> obstacles;
 
 		jobs::Counter signal;
 	};
@@ -1423,7 +2196,11 @@ struct NavigationModuleImpl final : NavigationModule
 			}
 		}
 
-		NavmeshBuildJobImpl* job = LUMIX_NEW(m_allocator, NavmeshBuildJobImpl);
+		initTileCache(zone);
+
+		NavmeshBuildJobImpl* job = LUMIX_NEW(m_allocator, NavmeshBuildJobImpl)(m_allocator);
+		buildInputGeometry(zone, IVec2(0), IVec2(zone.m_num_tiles_x, zone.m_num_tiles_z), getVoxelBorderSize(zone.zone), job->geom);
+		for (const NavmeshObstacle& obstacle : zone.obstacles) job->obstacles.push(obstacle);
 		job->zone = &zone;
 		job->zone_entity = zone_entity;
 		job->module = this;
@@ -1448,16 +2225,25 @@ struct NavigationModuleImpl final : NavigationModule
 		agent.agent = zone.crowd->addAgent(&pos.x, &params);
 		if (agent.agent < 0) {
 			logError("Failed to create navigation actor");
+			return;
 		}
+		zone.agents.push(agent.entity);
+	}
+
+	void removeCrowdAgent(Agent& agent, RecastZone& zone) {
+		ASSERT(zone.crowd && agent.agent >= 0);
+		zone.crowd->removeAgent(agent.agent);
+		zone.agents.swapAndPopItem(agent.entity);
+		agent.agent = -1;
 	}
 
 	void createZone(EntityRef entity) override {
-		RecastZone zone;
+		RecastZone zone(m_allocator);
 		zone.zone.extents = Vec3(1);
 		zone.zone.guid = randGUID();
 		zone.zone.flags = NavmeshZone::AUTOLOAD | NavmeshZone::DETAILED;
 		zone.entity = entity;
-		m_zones.insert(entity, zone);
+		m_zones.insert(entity, static_cast<RecastZone&&>(zone));
 		m_world.onComponentCreated(entity, NAVMESH_ZONE_TYPE, this);
 	}
 
@@ -1466,16 +2252,17 @@ struct NavigationModuleImpl final : NavigationModule
 			if (agent.zone == entity) agent.zone = INVALID_ENTITY;
 		}
 		auto iter = m_zones.find(entity);
-		const RecastZone& zone = iter.value();
+		RecastZone& zone = iter.value();
+		clearPathRequests(zone);
 		if (zone.crowd) {
-			for (Agent& agent : m_agents) {
-				if (agent.zone == zone.entity) {
-					zone.crowd->removeAgent(agent.agent);
-					agent.agent = -1;
-				}
-			}
+			for (EntityRef e : zone.agents) m_agents[e].agent = -1;
 			dtFreeCrowd(zone.crowd);
 		}
+		clearTileCache(iter.value());
+		if (zone.debug_batch != INVALID_DEBUG_BATCH) {
+			auto* render_module = static_cast<RenderModule*>(m_world.getModule("renderer"));
+			if (render_module) render_module->destroyDebugBatch(zone.debug_batch);
+		}
 
 		m_zones.erase(iter);
 		m_world.onComponentDestroyed(entity, NAVMESH_ZONE_TYPE, this);
@@ -1514,10 +2301,10 @@ struct NavigationModuleImpl final : NavigationModule
 
 	void destroyAgent(EntityRef entity) override {
 		auto iter = m_agents.find(entity);
-		const Agent& agent = iter.value();
+		Agent& agent = iter.value();
 		if (agent.zone.isValid()) {
 			RecastZone& zone = m_zones[(EntityRef)agent.zone];
-			if (zone.crowd && agent.agent >= 0) zone.crowd->removeAgent(agent.agent);
+			if (zone.crowd && agent.agent >= 0) removeCrowdAgent(agent, zone);
 		}
 		m_agents.erase(iter);
 		m_world.onComponentDestroyed(entity, NAVMESH_AGENT_TYPE, this);
@@ -1562,7 +2349,7 @@ struct NavigationModuleImpl final : NavigationModule
 		serializer.read(count);
 		m_zones.reserve(count + m_zones.size());
 		for (u32 i = 0; i < count; ++i) {
-			RecastZone zone;
+			RecastZone zone(m_allocator);
 			EntityRef e;
 			serializer.read(e);
 			e = entity_map.get(e);
@@ -1589,7 +2376,7 @@ struct NavigationModuleImpl final : NavigationModule
 				serializer.read(zone.zone.agent_radius);
 			}
 
-			m_zones.insert(e, zone);
+			m_zones.insert(e, static_cast<RecastZone&&>(zone));
 			m_world.onComponentCreated(e, NAVMESH_ZONE_TYPE, this);
 			if (version > (i32)NavigationModuleVersion::ZONE_GUID && (zone.zone.flags & NavmeshZone::AUTOLOAD) != 0) {
 				loadZone(e);
@@ -1682,9 +2469,19 @@ struct NavigationModuleImpl final : NavigationModule
 	ISystem& m_system;
 	Engine& m_engine;
 	HashMap<EntityRef, RecastZone> m_zones;
+	Array<RecastZone*> m_crowd_zones;
 	HashMap<EntityRef, Agent> m_agents;
-	EntityPtr m_moving_agent = INVALID_ENTITY;
+	bool m_moving_agents = false;
+	Array<EntityRef> m_moved_entities;
+	Array<Transform> m_moved_transforms;
 	bool m_is_game_running = false;
+	Array<TileRebuild*> m_tile_rebuilds;
+	jobs::Counter m_tile_rebuild_signal;
+	float m_tile_rebuild_budget_ms = 1;
+	u32 m_next_obstacle_id = 0;
+	u32 m_path_iterations_budget = 2048;
+	Array<FinishedPathRequest> m_finished_path_requests;
+	DelegateList<void(EntityRef, bool)> m_path_request_finished;
 	
 	Vec3 m_debug_tile_origin;
 	LuaScriptModule* m_script_module;
@@ -9,6 +9,9 @@ reflection::build_module("navigation")
 		.function<(void (NavigationModule::*)(EntityRef zone))&NavigationModule::debugDrawContours>("drawContours")
 		.function<(NavmeshBuildJob* (NavigationModule::*)(EntityRef zone))&NavigationModule::generateNavmesh>("generateNavmesh")
 		.function<(bool (NavigationModule::*)(EntityRef zone_entity))&NavigationModule::saveZone>("saveZone")
+		.function<(u32 (NavigationModule::*)(EntityRef zone, const DVec3& center, const Vec3& half_extents))&NavigationModule::addBoxObstacle>("addBoxObstacle")
+		.function<(u32 (NavigationModule::*)(EntityRef zone, const DVec3& pos, float radius, float height))&NavigationModule::addCylinderObstacle>("addCylinderObstacle")
+		.function<(void (NavigationModule::*)(EntityRef zone, u32 obstacle))&NavigationModule::removeObstacle>("removeObstacle")
 		.var_prop<&NavigationModule::getZone, &NavmeshZone::extents>("Extents")
 		.var_prop<&NavigationModule::getZone, &NavmeshZone::cell_size>("Cell size")
 			.minAttribute(0)
@@ -15,6 +15,7 @@ namespace Lumix
 
 
 struct IAllocator;
+template <typename T> struct DelegateList;
 
 
 //@ component_struct label "Zone" name Zone
@@ -59,6 +60,11 @@ struct NavigationModule : IModule {
 	virtual bool getZoneDetailed(EntityRef entity) = 0;
 	virtual void setZoneDetailed(EntityRef entity, bool value) = 0;
 	virtual bool saveZone(EntityRef zone_entity) = 0;
+	// obstacles cut holes into navmesh, affected tiles are rebuilt in background, see setTileRebuildBudget
+	// box is axis aligned in zone space, returns obstacle id
+	virtual u32 addBoxObstacle(EntityRef zone, const DVec3& center, const Vec3& half_extents) = 0;
+	virtual u32 addCylinderObstacle(EntityRef zone, const DVec3& pos, float radius, float height) = 0;
+	virtual void removeObstacle(EntityRef zone, u32 obstacle) = 0;
 	//@ end
 	virtual void createZone(EntityRef entity) = 0;
 	virtual void destroyZone(EntityRef entity) = 0;
@@ -70,6 +76,7 @@ struct NavigationModule : IModule {
 	virtual float getAgentHeight(EntityRef entity) = 0;
 	virtual bool getAgentMoveEntity(EntityRef entity) = 0;
 	virtual void setAgentMoveEntity(EntityRef entity, bool value) = 0;
+	// queues a path request, the path is found in following frames, see pathRequestFinished
 	virtual bool navigate(EntityRef entity, const struct DVec3& dest, float speed, float stop_distance) = 0;
 	virtual void cancelNavigation(EntityRef entity) = 0;
 	virtual void debugDrawPath(EntityRef agent_entity, bool include_polygons) = 0;	//@ alias drawPath
@@ -82,6 +89,12 @@ struct NavigationModule : IModule {
 	virtual float getAgentYawDiff(EntityRef entity) = 0;
 	virtual void free(NavmeshBuildJob* job) = 0;
 	virtual bool generateTileAt(EntityRef zone, const DVec3& pos, bool keep_data) = 0;
+	// max time per frame spent starting tile rebuilds and swapping rebuilt tiles in
+	virtual void setTileRebuildBudget(float ms) = 0;
+	// max pathfinding iterations per zone per frame, split between workers
+	virtual void setPathfindingBudget(u32 iterations) = 0;
+	// called with agent entity and whether a path was found, unless the request was canceled or replaced
+	virtual DelegateList<void(EntityRef, bool)>& pathRequestFinished() = 0;
 	virtual const dtCrowdAgent* getDetourAgent(EntityRef entity) = 0;
 	virtual bool isNavmeshReady(EntityRef zone) const = 0;
 	virtual bool hasDebugDrawData(EntityRef zoneko) const = 0;
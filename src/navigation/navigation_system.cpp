@@ -45,6 +45,7 @@ struct NavigationSystem final : ISystem {
 
 	const char* getName() const override { return "navigation"; }
 	void createModules(World& world) override;
+	bool createModulesLazily() const override { return true; }
 
 	static NavigationSystem* s_instance;
 
@@ -698,6 +698,11 @@ struct PhysicsUIPlugin final : StudioApp::GUIPlugin
 		if (!ImGui::CollapsingHeader("Debug")) return;
 
 		ImGui::Indent();
+		auto* module = static_cast<PhysicsModule*>(editor.getWorld()->getModule("physics"));
+		bool async_simulation = module->isAsyncSimulation();
+		if (ImGui::Checkbox("Async simulation", &async_simulation)) {
+			module->setAsyncSimulation(async_simulation);
+		}
 		onVisualizationGUI(editor);
 		onJointGUI(editor);
 		onActorGUI(editor);
@@ -38,9 +38,11 @@
 #include "core/job_system.h"
 #include "core/log.h"
 #include "core/math.h"
+#include "core/os.h"
 #include "core/path.h"
 #include "core/profiler.h"
 #include "core/stream.h"
+#include "core/sync.h"
 #include "engine/engine.h"
 #include "engine/reflection.h"
 #include "engine/resource_manager.h"
@@ -255,17 +257,64 @@ struct PhysicsModuleImpl final : PhysicsModule
 {
 	struct CPUDispatcher : physx::PxCpuDispatcher
 	{
+		struct TaskStats {
+			const char* name;
+			u64 ticks;
+			u32 counter;
+		};
+
+		CPUDispatcher(IAllocator& allocator) : m_task_stats(allocator) {}
+
 		void submitTask(PxBaseTask& task) override
 		{
-			jobs::runLambda([&task]() {
-					PROFILE_BLOCK(task.getName());
+			u8 worker = jobs::ANY_WORKER;
+			if (m_workers_count > 0) worker = u8(u32(m_next_worker.inc()) % m_workers_count);
+			jobs::runLambda([this, &task]() {
+					const char* name = task.getName();
+					PROFILE_BLOCK(name);
 					profiler::blockColor(Color(0x50, 0xff, 0x50, 0xff).abgr());
+					const u64 start = os::Timer::getRawTimestamp();
 					task.run();
+					addTaskTime(name, os::Timer::getRawTimestamp() - start);
 					task.release();
 				},
-				nullptr);
+				nullptr, worker, m_priority);
+		}
+
+		PxU32 getWorkerCount() const override { return m_workers_count > 0 ? m_workers_count : jobs::getWorkersCount(); }
+
+		// physx task names are literals, so they can be compared by pointer
+		void addTaskTime(const char* name, u64 ticks) {
+			MutexGuard lock(m_task_stats_mutex);
+			for (TaskStats& stats : m_task_stats) {
+				if (stats.name == name) {
+					stats.ticks += ticks;
+					return;
+				}
+			}
+			m_task_stats.push({name, ticks, profiler::INVALID_COUNTER});
+		}
+
+		// pushes time (ms) spent in each kind of task since the last call to profiler counters
+		void flushTaskStats() {
+			MutexGuard lock(m_task_stats_mutex);
+			const double to_ms = 1000.0 / os::Timer::getFrequency();
+			for (TaskStats& stats : m_task_stats) {
+				if (stats.counter == profiler::INVALID_COUNTER) {
+					stats.counter = profiler::getCounterHandle(stats.name);
+					if (stats.counter == profiler::INVALID_COUNTER) stats.counter = profiler::createCounter(stats.name, 0);
+				}
+				profiler::pushCounter(stats.counter, float(stats.ticks * to_ms));
+				stats.ticks = 0;
+			}
 		}
-		PxU32 getWorkerCount() const override { return jobs::getWorkersCount(); }
+
+		jobs::Priority m_priority = jobs::Priority::NORMAL;
+		// tasks are distributed to the first `m_workers_count` workers, 0 means any worker
+		u8 m_workers_count = 0;
+		AtomicI32 m_next_worker = 0;
+		Mutex m_task_stats_mutex;
+		Array<TaskStats> m_task_stats;
 	};
 
 
@@ -347,6 +396,7 @@ struct PhysicsModuleImpl final : PhysicsModule
 			, dynamic_type(rhs.dynamic_type)
 			, is_trigger(rhs.is_trigger)
 			, ccd(rhs.ccd)
+			, lod_asleep(rhs.lod_asleep)
 		{
 			rhs.mesh = nullptr;
 			rhs.material = nullptr;
@@ -378,24 +428,33 @@ struct PhysicsModuleImpl final : PhysicsModule
 		DynamicType dynamic_type = DynamicType::STATIC;
 		bool is_trigger = false;
 		bool ccd = false;
+		// put to sleep because it's far from all simulation sources, see updateSimulationLOD
+		bool lod_asleep = false;
 	};
 
 
 	PhysicsModuleImpl(Engine& engine, World& world, PhysicsSystem& system, IAllocator& allocator);
 
 
-	PxBatchQuery* createVehicleBatchQuery(u8* mem)
-	{
-		const PxU32 maxNumQueriesInBatch = 64;
-		const PxU32 maxNumHitResultsInBatch = 64;
+	// vehicles are updated in parallel in batches, each batch has its own scene query and buffers
+	struct VehicleBatch {
+		static constexpr u32 MAX_VEHICLES = 16;
+		static constexpr u32 MAX_WHEELS = MAX_VEHICLES * 4;
 
-		PxBatchQueryDesc desc(maxNumQueriesInBatch, maxNumQueriesInBatch, 0);
+		PxBatchQuery* query = nullptr;
+		PxRaycastQueryResult results[MAX_WHEELS];
+		PxRaycastHit hits[MAX_WHEELS];
+		// must persist until PxVehiclePostUpdates
+		PxVehicleWheelConcurrentUpdateData wheel_updates[MAX_WHEELS];
+	};
 
-		desc.queryMemory.userRaycastResultBuffer = (PxRaycastQueryResult*)(mem + sizeof(PxRaycastHit) * 64);
-		desc.queryMemory.userRaycastTouchBuffer = (PxRaycastHit*)mem;
-		desc.queryMemory.raycastTouchBufferSize = maxNumHitResultsInBatch;
+	PxBatchQuery* createVehicleBatchQuery(VehicleBatch& batch)
+	{
+		PxBatchQueryDesc desc(VehicleBatch::MAX_WHEELS, 0, 0);
 
-		m_vehicle_results = desc.queryMemory.userRaycastResultBuffer;
+		desc.queryMemory.userRaycastResultBuffer = batch.results;
+		desc.queryMemory.userRaycastTouchBuffer = batch.hits;
+		desc.queryMemory.raycastTouchBufferSize = VehicleBatch::MAX_WHEELS;
 
 		desc.preFilterShader = [](PxFilterData queryFilterData, PxFilterData objectFilterData, const void* constantBlock, PxU32 constantBlockSize, PxHitFlags& hitFlags) -> PxQueryHitType::Enum {
 			if (objectFilterData.word3 == (u32)FilterFlags::VEHICLE) return PxQueryHitType::eNONE;
@@ -426,6 +485,7 @@ struct PhysicsModuleImpl final : PhysicsModule
 	const char* getName() const override { return "physics"; }
 
 	~PhysicsModuleImpl() {
+		finishSimulation();
 		for (auto& controller : m_controllers) {
 			controller.controller->release();
 		}
@@ -471,7 +531,8 @@ struct PhysicsModuleImpl final : PhysicsModule
 
 		m_terrains.clear();
 
-		m_vehicle_batch_query->release();
+		for (UniquePtr<VehicleBatch>& batch : m_vehicle_batches) batch->query->release();
+		m_vehicle_batches.clear();
 		m_vehicle_frictions->release();
 		m_controller_manager->release();
 		m_default_material->release();
@@ -600,7 +661,7 @@ struct PhysicsModuleImpl final : PhysicsModule
 		PxFilterData data;
 		data.word0 = 1 << layer;
 		data.word1 = m_layers.filter[layer];
-		controller.filter_data = data;
+		controller.filter.m_filter_data = data;
 		PxShape* shapes[8];
 		int shapes_count = controller.controller->getActor()->getShapes(shapes, lengthOf(shapes));
 		for (int i = 0; i < shapes_count; ++i)
@@ -848,6 +909,7 @@ struct PhysicsModuleImpl final : PhysicsModule
 	}
 
 
+	// samples are collected and sent to physx once per frame in flushHeightfieldUpdates, so brush strokes are cheap
 	void updateHeighfieldData(EntityRef entity,
 		int x,
 		int y,
@@ -857,16 +919,55 @@ struct PhysicsModuleImpl final : PhysicsModule
 		int bytes_per_pixel) override
 	{
 		PROFILE_FUNCTION();
-		Heightfield& terrain = m_terrains[entity];
-
-		PxShape* shape;
-		terrain.m_actor->getShapes(&shape, 1);
-		PxHeightFieldGeometry geom;
-		shape->getHeightFieldGeometry(geom);
-
-		Array<PxHeightFieldSample> heights(m_allocator);
+		auto iter = m_heightfield_updates.find(entity);
+		if (!iter.isValid()) iter = m_heightfield_updates.insert(entity, HeightfieldUpdate(m_allocator));
+		HeightfieldUpdate& update = iter.value();
+
+		// rows go along x, columns along y
+		const i32 row0 = x;
+		const i32 col0 = y;
+		const i32 row1 = x + width;
+		const i32 col1 = y + height;
+		if (update.row0 >= update.row1) {
+			update.row0 = row0;
+			update.col0 = col0;
+			update.row1 = row1;
+			update.col1 = col1;
+			update.samples.resize(width * height);
+		}
+		else if (row0 < update.row0 || col0 < update.col0 || row1 > update.row1 || col1 > update.col1) {
+			// grow dirty region, cells which are neither dirty nor in the new rectangle are taken from physx
+			Heightfield& terrain = m_terrains[entity];
+			PxShape* shape;
+			terrain.m_actor->getShapes(&shape, 1);
+			PxHeightFieldGeometry geom;
+			shape->getHeightFieldGeometry(geom);
+
+			const i32 new_row0 = minimum(row0, update.row0);
+			const i32 new_col0 = minimum(col0, update.col0);
+			const i32 new_row1 = maximum(row1, update.row1);
+			const i32 new_col1 = maximum(col1, update.col1);
+			const i32 stride = update.col1 - update.col0;
+			const i32 new_stride = new_col1 - new_col0;
+			m_tmp_heightfield_samples.resize((new_row1 - new_row0) * new_stride);
+			for (i32 r = new_row0; r < new_row1; ++r) {
+				for (i32 c = new_col0; c < new_col1; ++c) {
+					PxHeightFieldSample& sample = m_tmp_heightfield_samples[(r - new_row0) * new_stride + c - new_col0];
+					const bool is_dirty = r >= update.row0 && r < update.row1 && c >= update.col0 && c < update.col1;
+					sample = is_dirty
+						? update.samples[(r - update.row0) * stride + c - update.col0]
+						: geom.heightField->getSample(r, c);
+				}
+			}
+			m_tmp_heightfield_samples.swap(update.samples);
+			update.row0 = new_row0;
+			update.col0 = new_col0;
+			update.row1 = new_row1;
+			update.col1 = new_col1;
+		}
 
-		heights.resize(width * height);
+		const i32 stride = update.col1 - update.col0;
+		PxHeightFieldSample* LUMIX_RESTRICT samples = &update.samples[(row0 - update.row0) * stride + col0 - update.col0];
 		if (bytes_per_pixel == 2)
 		{
 			const i16* LUMIX_RESTRICT data = (const i16*)src_data;
@@ -874,10 +975,9 @@ struct PhysicsModuleImpl final : PhysicsModule
 			{
 				for (int i = 0; i < width; ++i)
 				{
-					int idx = j + i * height;
-					int idx2 = i + j * width;
-					heights[idx].height = PxI16((i32)data[idx2] - 0x7fff);
-					heights[idx].materialIndex0 = heights[idx].materialIndex1 = 0;
+					PxHeightFieldSample& sample = samples[j + i * stride];
+					sample.height = PxI16((i32)data[i + j * width] - 0x7fff);
+					sample.materialIndex0 = sample.materialIndex1 = 0;
 				}
 			}
 		}
@@ -889,25 +989,48 @@ struct PhysicsModuleImpl final : PhysicsModule
 			{
 				for (int i = 0; i < width; ++i)
 				{
-					int idx = j + i * height;
-					int idx2 = i + j * width;
-					heights[idx].height = PxI16((i32)data[idx2] - 0x7f);
-					heights[idx].materialIndex0 = heights[idx].materialIndex1 = 0;
+					PxHeightFieldSample& sample = samples[j + i * stride];
+					sample.height = PxI16((i32)data[i + j * width] - 0x7f);
+					sample.materialIndex0 = sample.materialIndex1 = 0;
 				}
 			}
 		}
+	}
 
-		PxHeightFieldDesc hfDesc;
-		hfDesc.format = PxHeightFieldFormat::eS16_TM;
-		hfDesc.nbColumns = height;
-		hfDesc.nbRows = width;
-		hfDesc.samples.data = &heights[0];
-		hfDesc.samples.stride = sizeof(PxHeightFieldSample);
-
-		geom.heightField->modifySamples(y, x, hfDesc);
-		shape->setGeometry(geom);
+	// sends dirty region of each modified heightfield to physx
+	void flushHeightfieldUpdates() {
+		for (auto iter = m_heightfield_updates.begin(), end = m_heightfield_updates.end(); iter != end; ++iter) {
+			HeightfieldUpdate& update = iter.value();
+			if (update.row0 >= update.row1) continue;
+
+			PROFILE_BLOCK("update heightfield");
+			// physx reads heightfield samples during simulation
+			finishSimulation();
+			auto terrain_iter = m_terrains.find(iter.key());
+			if (terrain_iter.isValid() && terrain_iter.value().m_actor) {
+				PxShape* shape;
+				terrain_iter.value().m_actor->getShapes(&shape, 1);
+				PxHeightFieldGeometry geom;
+				shape->getHeightFieldGeometry(geom);
+
+				PxHeightFieldDesc hfDesc;
+				hfDesc.format = PxHeightFieldFormat::eS16_TM;
+				hfDesc.nbColumns = update.col1 - update.col0;
+				hfDesc.nbRows = update.row1 - update.row0;
+				hfDesc.samples.data = update.samples.begin();
+				hfDesc.samples.stride = sizeof(PxHeightFieldSample);
+
+				geom.heightField->modifySamples(update.col0, update.row0, hfDesc);
+				shape->setGeometry(geom);
+			}
+			// keep the samples' memory for next strokes
+			update.row0 = update.row1 = 0;
+			update.col0 = update.col1 = 0;
+		}
 	}
 
+	void endFrame() override { flushHeightfieldUpdates(); }
+
 
 	int getJointCount() override { return m_joints.size(); }
 	EntityRef getJointEntity(int index) override { return {m_joints.getKey(index).index}; }
@@ -1337,6 +1460,7 @@ struct PhysicsModuleImpl final : PhysicsModule
 
 	void destroyHeightfield(EntityRef entity)
 	{
+		m_heightfield_updates.erase(entity);
 		m_terrains.erase(entity);
 		m_world.onComponentDestroyed(entity, HEIGHTFIELD_TYPE, this);
 	}
@@ -1577,7 +1701,7 @@ struct PhysicsModuleImpl final : PhysicsModule
 		int controller_layer = c.layer;
 		data.word0 = 1 << controller_layer;
 		data.word1 = m_layers.filter[controller_layer];
-		c.filter_data = data;
+		c.filter.m_filter_data = data;
 		PxShape* shapes[8];
 		int shapes_count = c.controller->getActor()->getShapes(shapes, lengthOf(shapes));
 		c.controller->getActor()->userData = (void*)(intptr_t)entity.index;
@@ -1744,36 +1868,60 @@ struct PhysicsModuleImpl final : PhysicsModule
 	void updateDynamicActors(bool vehicles)
 	{
 		PROFILE_FUNCTION();
-		for (EntityRef e : m_dynamic_actors) {
-			RigidActor& actor = m_actors[e];
-			m_update_in_progress = &actor;
-			PxTransform trans = actor.physx_actor->getGlobalPose();
-			m_world.setTransform(actor.entity, fromPhysx(trans));
-		}
-		m_update_in_progress = nullptr;
+		// only actors physx moved in the last simulation, sleeping actors keep their transforms
+		// in async mode there might be no new results, e.g. in the first step after startGame
+		PxU32 active_count = 0;
+		PxActor** active_actors = m_has_new_results ? m_scene->getActiveActors(active_count) : nullptr;
+		m_has_new_results = false;
+		m_active_entities.clear();
+		m_dynamic_transforms.clear();
+		m_active_entities.reserve(active_count);
+		m_dynamic_transforms.reserve(active_count);
+		for (PxU32 i = 0; i < active_count; ++i) {
+			const EntityRef e = {(i32)(intptr_t)active_actors[i]->userData};
+			auto iter = m_actors.find(e);
+			// e.g. vehicles, synced separately
+			if (!iter.isValid()) continue;
+			const RigidActor& actor = iter.value();
+			if (actor.physx_actor != active_actors[i] || actor.dynamic_type != DynamicType::DYNAMIC) continue;
+
+			const RigidTransform trans = fromPhysx(actor.physx_actor->getGlobalPose());
+			m_active_entities.push(e);
+			m_dynamic_transforms.push(Transform(trans.pos, trans.rot, m_world.getScale(e)));
+		}
+		// dynamic actors are already where physx moved them, see onActorsMoved
+		m_updating_dynamic_actors = true;
+		m_world.setTransforms(m_active_entities, m_dynamic_transforms);
+		m_updating_dynamic_actors = false;
 
 		if (!vehicles) return;
 
+		// cars and their wheels are set in one batch, wheels are children of cars
+		m_active_entities.clear();
+		m_dynamic_transforms.clear();
 		for (auto iter : m_vehicles.iterated()) {
 			Vehicle* veh = iter.value().get();
-			if (veh->actor) {
-				const PxTransform car_trans = veh->actor->getGlobalPose();
-				m_world.setTransform(iter.key(), fromPhysx(car_trans));
-
-				EntityPtr wheels[4];
-				getWheels(iter.key(), Span(wheels));
-
-				PxShape* shapes[5];
-				veh->actor->getShapes(shapes, 5);
-				for (u32 i = 0; i < 4; ++i) {
-					if (!wheels[i].isValid()) continue;
-					const PxTransform trans = shapes[i]->getLocalPose();
-					m_world.setTransform((EntityRef)wheels[i], fromPhysx(car_trans * trans));
-				
-				}
-
+			if (!veh->actor) continue;
+
+			const PxTransform car_trans = veh->actor->getGlobalPose();
+			const RigidTransform car_rigid = fromPhysx(car_trans);
+			m_active_entities.push(iter.key());
+			m_dynamic_transforms.push(Transform(car_rigid.pos, car_rigid.rot, m_world.getScale(iter.key())));
+
+			EntityPtr wheels[4];
+			getWheels(iter.key(), Span(wheels));
+
+			PxShape* shapes[5];
+			veh->actor->getShapes(shapes, 5);
+			for (u32 i = 0; i < 4; ++i) {
+				if (!wheels[i].isValid()) continue;
+				const EntityRef wheel = (EntityRef)wheels[i];
+				const RigidTransform trans = fromPhysx(car_trans * shapes[i]->getLocalPose());
+				m_active_entities.push(wheel);
+				m_dynamic_transforms.push(Transform(trans.pos, trans.rot, m_world.getScale(wheel)));
 			}
 		}
+		m_world.setTransforms(m_active_entities, m_dynamic_transforms);
 	}
 
 
@@ -1781,6 +1929,7 @@ struct PhysicsModuleImpl final : PhysicsModule
 	{
 		PROFILE_FUNCTION();
 		m_scene->simulate(time_delta);
+		m_simulating = true;
 	}
 
 
@@ -1788,12 +1937,25 @@ struct PhysicsModuleImpl final : PhysicsModule
 	{
 		PROFILE_FUNCTION();
 		m_scene->fetchResults(true);
+		m_simulating = false;
+		m_has_new_results = true;
+		m_cpu_dispatcher.flushTaskStats();
+	}
+
+
+	// waits for simulation started in lateUpdate in async mode
+	void finishSimulation() {
+		if (m_simulating) fetchResults();
 	}
 
 
 	void updateControllers(float time_delta)
 	{
 		PROFILE_FUNCTION();
+		m_controller_entities.clear();
+		m_controller_transforms.clear();
+		m_controller_entities.reserve(m_controllers.size());
+		m_controller_transforms.reserve(m_controllers.size());
 		for (auto& controller : m_controllers) {
 			Vec3 dif = controller.frame_change;
 			controller.frame_change = Vec3(0, 0, 0);
@@ -1819,9 +1981,7 @@ struct PhysicsModuleImpl final : PhysicsModule
 				controller.gravity_speed = 0;
 			}
 
-			m_moving_controller = controller.entity;
-			m_filter_callback.m_filter_data = controller.filter_data;
-			PxControllerFilters filters(nullptr, &m_filter_callback);
+			PxControllerFilters filters(nullptr, &controller.filter);
 			controller.controller->move(toPhysx(dif), 0.001f, time_delta, filters);
 
 			// if dif.y > 0, somebody is trying to move the controller up (e.g. jump), we should allow that
@@ -1830,39 +1990,121 @@ struct PhysicsModuleImpl final : PhysicsModule
 				controller.controller->move(physx::PxVec3(0, -0.05f, 0), 0.001f, time_delta, filters);
 			}
 
-			PxExtendedVec3 p = controller.controller->getFootPosition();
-			m_world.setPosition(controller.entity, {p.x, p.y, p.z});
-			m_moving_controller = INVALID_ENTITY;
+			const PxExtendedVec3 p = controller.controller->getFootPosition();
+			Transform tr = m_world.getTransform(controller.entity);
+			tr.pos = {p.x, p.y, p.z};
+			m_controller_entities.push(controller.entity);
+			m_controller_transforms.push(tr);
 		}
+		// controllers are already where they moved, see onControllerMoved
+		m_updating_controllers = true;
+		m_world.setTransforms(m_controller_entities, m_controller_transforms);
+		m_updating_controllers = false;
 	}
 
 	void updateVehicles(float time_delta) {
-		PxVehicleWheels* vehicles[16];
-
-		u32 valid_count = 0;
+		PROFILE_FUNCTION();
+		m_vehicle_drives.clear();
+		m_vehicle_drives.reserve(m_vehicles.size());
 		for (UniquePtr<Vehicle>& veh : m_vehicles) {
 			if (!veh->drive) continue;
 
-			vehicles[valid_count] = veh->drive;
+			m_vehicle_drives.push(veh->drive);
 			PxVehicleDrive4WSmoothAnalogRawInputsAndSetAnalogInputs(pad_smoothing, steer_vs_forward_speed, veh->raw_input, time_delta, false, *veh->drive);
-			++valid_count;
+		}
+		if (m_vehicle_drives.empty()) return;
+
+		const u32 batches_count = (m_vehicle_drives.size() + VehicleBatch::MAX_VEHICLES - 1) / VehicleBatch::MAX_VEHICLES;
+		// batch queries can not be created while the batches run
+		while ((u32)m_vehicle_batches.size() < batches_count) {
+			UniquePtr<VehicleBatch>& batch = m_vehicle_batches.emplace(UniquePtr<VehicleBatch>::create(m_allocator));
+			batch->query = createVehicleBatchQuery(*batch.get());
+		}
+		m_vehicle_updates.resize(m_vehicle_drives.size());
+
+		// physx writes to actors are deferred to PxVehiclePostUpdates, so batches can run concurrently
+		const PxVec3 gravity = m_scene->getGravity();
+		jobs::forEach(batches_count, 1, [&](u32 batch_idx, u32){
+			PROFILE_BLOCK("vehicle batch");
+			VehicleBatch& batch = *m_vehicle_batches[batch_idx].get();
+			const u32 from = batch_idx * VehicleBatch::MAX_VEHICLES;
+			const u32 count = minimum(VehicleBatch::MAX_VEHICLES, m_vehicle_drives.size() - from);
+			PxVehicleWheels** vehicles = m_vehicle_drives.begin() + from;
+			PxVehicleConcurrentUpdateData* updates = m_vehicle_updates.begin() + from;
+			for (u32 i = 0; i < count; ++i) {
+				updates[i] = PxVehicleConcurrentUpdateData();
+				updates[i].concurrentWheelUpdates = batch.wheel_updates + i * 4;
+				updates[i].nbConcurrentWheelUpdates = 4;
+			}
+			PxVehicleSuspensionRaycasts(batch.query, count, vehicles, count * 4, batch.results);
+			PxVehicleUpdates(time_delta, gravity, *m_vehicle_frictions, count, vehicles, nullptr, updates);
+		});
+
+		PxVehiclePostUpdates(m_vehicle_updates.begin(), m_vehicle_drives.size(), m_vehicle_drives.begin());
+	}
+
+	void addSimulationSource(EntityRef entity) override {
+		if (m_simulation_sources.indexOf(entity) < 0) m_simulation_sources.push(entity);
+	}
+
+	void removeSimulationSource(EntityRef entity) override {
+		m_simulation_sources.eraseItem(entity);
+		if (!m_simulation_sources.empty()) return;
+
+		// without sources everything is simulated
+		for (EntityRef e : m_dynamic_actors) wakeUpLOD(m_actors[e]);
+	}
+
+	void setSimulationLODRadius(float radius) override { m_simulation_lod_radius = radius; }
+	float getSimulationLODRadius() override { return m_simulation_lod_radius; }
 
-			if (valid_count == lengthOf(vehicles)) {
-				PxVehicleSuspensionRaycasts(m_vehicle_batch_query, valid_count, vehicles, valid_count * 4, m_vehicle_results);
-				PxVehicleUpdates(time_delta, m_scene->getGravity(), *m_vehicle_frictions, valid_count, vehicles, nullptr);
-				valid_count = 0;
+	void wakeUpLOD(RigidActor& actor) {
+		if (!actor.lod_asleep) return;
+		actor.lod_asleep = false;
+		PxRigidDynamic* body = actor.physx_actor ? actor.physx_actor->is<PxRigidDynamic>() : nullptr;
+		if (body && body->getScene()) body->wakeUp();
+	}
+
+	// dynamic actors far from all simulation sources are put to sleep, so physx does not simulate them
+	// contacts with awake actors still wake them up, such actors are put to sleep again in next check
+	void updateSimulationLOD() {
+		PROFILE_FUNCTION();
+		if (m_simulation_sources.empty() || m_dynamic_actors.empty()) return;
+
+		m_simulation_source_positions.clear();
+		for (EntityRef e : m_simulation_sources) m_simulation_source_positions.push(m_world.getPosition(e));
+
+		// amortized over several steps, so it's cheap even with a lot of actors
+		constexpr u32 ACTORS_PER_STEP = 1024;
+		const u32 count = minimum(m_dynamic_actors.size(), ACTORS_PER_STEP);
+		const double radius2 = double(m_simulation_lod_radius) * m_simulation_lod_radius;
+		for (u32 i = 0; i < count; ++i) {
+			m_simulation_lod_cursor = (m_simulation_lod_cursor + 1) % m_dynamic_actors.size();
+			const EntityRef e = m_dynamic_actors[m_simulation_lod_cursor];
+			RigidActor& actor = m_actors[e];
+
+			const DVec3 pos = m_world.getPosition(e);
+			bool is_near = false;
+			for (const DVec3& source_pos : m_simulation_source_positions) {
+				if (squaredLength(source_pos - pos) < radius2) {
+					is_near = true;
+					break;
+				}
+			}
+
+			if (is_near) {
+				wakeUpLOD(actor);
+				continue;
 			}
-		}
 
-		if (valid_count > 0) {
-			PxVehicleSuspensionRaycasts(m_vehicle_batch_query, valid_count, vehicles, valid_count * 4, m_vehicle_results);
-			PxVehicleUpdates(time_delta, m_scene->getGravity(), *m_vehicle_frictions, valid_count, vehicles, nullptr);
+			PxRigidDynamic* body = actor.physx_actor ? actor.physx_actor->is<PxRigidDynamic>() : nullptr;
+			if (!body || !body->getScene()) continue;
+			if (!body->isSleeping()) body->putToSleep();
+			actor.lod_asleep = true;
 		}
 	}
 
-	void lateUpdate(float time_delta) override {
-		if (!m_is_game_running) return;
-
+	void applyControllersRootMotion() {
 		AnimationModule* anim_module = (AnimationModule*)m_world.getModule("animation");
 		if (!anim_module) return;
 
@@ -1875,28 +2117,62 @@ struct PhysicsModuleImpl final : PhysicsModule
 			}
 		}
 	}
+
+	void lateUpdate(float time_delta) override {
+		if (!m_is_game_running) return;
+
+		applyControllersRootMotion();
+
+		// runs in parallel with the rest of the frame, physx buffers writes and queries see the state before simulate
+		if (m_async_simulation) simulateScene(minimum(1 / 20.0f, time_delta));
+	}
 	
 	const Array<EntityRef>& getDynamicActors() override { return m_dynamic_actors; }
 
 	void forceUpdateDynamicActors(float time_delta) override {
+		finishSimulation();
 		simulateScene(time_delta);
 		fetchResults();
 		updateDynamicActors(false);
 	}
 
+	void setAsyncSimulation(bool enable) override {
+		if (!enable) finishSimulation();
+		m_async_simulation = enable;
+	}
+
+	bool isAsyncSimulation() const override { return m_async_simulation; }
+
+	void setHighPriorityTasks(bool enable) override {
+		m_cpu_dispatcher.m_priority = enable ? jobs::Priority::HIGH : jobs::Priority::NORMAL;
+	}
+
+	void setTaskWorkersCount(u32 count) override {
+		m_cpu_dispatcher.m_workers_count = (u8)minimum(count, jobs::getWorkersCount());
+	}
+
 	void updateParallel(float time_delta) override {
 		if (!m_is_game_running) return;
 
 		time_delta = minimum(1 / 20.0f, time_delta);
+		if (m_async_simulation) {
+			// step started in the previous lateUpdate
+			finishSimulation();
+			updateVehicles(time_delta);
+			return;
+		}
 		updateVehicles(time_delta);
 		simulateScene(time_delta);
 		fetchResults();
 	}
 
+	bool usesFixedTimestep() const override { return true; }
+
 	void update(float time_delta) override {
 		if (!m_is_game_running) return;
 
 		updateDynamicActors(true);
+		updateSimulationLOD();
 		updateControllers(time_delta);
 
 		render();
@@ -2293,7 +2569,10 @@ struct PhysicsModuleImpl final : PhysicsModule
 	}
 
 
-	void stopGame() override { m_is_game_running = false; }
+	void stopGame() override {
+		finishSimulation();
+		m_is_game_running = false;
+	}
 
 
 	float getControllerRadius(EntityRef entity) override { return m_controllers[entity].radius; }
@@ -2501,8 +2780,49 @@ struct PhysicsModuleImpl final : PhysicsModule
 		return status;
 	}
 
+	// scene queries only read the scene, so they can run in parallel, see "Threading" in physx docs
+	void raycastBatch(Span<const RaycastQuery> queries, Span<RaycastHit> hits) override {
+		PROFILE_FUNCTION();
+		ASSERT(queries.length() == hits.length());
+		jobs::forEach(queries.length(), 16, [&](u32 from, u32 to){
+			for (u32 i = from; i < to; ++i) {
+				const RaycastQuery& q = queries[i];
+				if (!raycastEx(q.origin, q.dir, q.distance, hits[i], q.ignored, q.layer)) hits[i].entity = INVALID_ENTITY;
+			}
+		});
+	}
+
+	void sweepSphereBatch(Span<const SweepSphereQuery> queries, Span<SweepHit> hits) override {
+		PROFILE_FUNCTION();
+		ASSERT(queries.length() == hits.length());
+		jobs::forEach(queries.length(), 16, [&](u32 from, u32 to){
+			for (u32 i = from; i < to; ++i) {
+				const SweepSphereQuery& q = queries[i];
+				if (!sweepSphere(q.pos, q.radius, q.dir, q.distance, hits[i], q.ignored, q.layer)) hits[i].entity = INVALID_ENTITY;
+			}
+		});
+	}
+
+	// inactive actors are removed from scene, but keep their physx actor, so they can be readded cheaply
+	void onEntityActiveChanged(EntityRef entity, bool active) {
+		auto iter = m_actors.find(entity);
+		if (!iter.isValid()) return;
+		PxRigidActor* actor = iter.value().physx_actor;
+		if (!actor) return;
+		if (active) {
+			if (!actor->getScene()) {
+				m_scene->addActor(*actor);
+				actor->setGlobalPose(toPhysx(m_world.getTransform(entity).getRigidPart()));
+			}
+		}
+		else if (actor->getScene()) {
+			m_scene->removeActor(*actor);
+		}
+	}
+
 	void onEntityDestroyed(EntityRef entity)
 	{
+		if (m_simulation_sources.indexOf(entity) >= 0) removeSimulationSource(entity);
 		for (int i = 0, c = m_joints.size(); i < c; ++i)
 		{
 			if (m_joints.at(i).connected_body == entity)
@@ -2513,7 +2833,7 @@ struct PhysicsModuleImpl final : PhysicsModule
 	}
 
 	void onControllerMoved(EntityRef entity) {
-		if (m_moving_controller == entity) return;
+		if (m_updating_controllers) return;
 		auto iter = m_controllers.find(entity);
 		ASSERT(iter.isValid());
 
@@ -2523,11 +2843,14 @@ struct PhysicsModuleImpl final : PhysicsModule
 		controller.controller->setFootPosition(pvec);
 	}
 
-	void onActorMoved(EntityRef entity) {
-		auto iter = m_actors.find(entity);
-		ASSERT(iter.isValid());
-		RigidActor& actor = iter.value();
-		if (actor.physx_actor && m_update_in_progress != &actor) {
+	void onActorsMoved(Span<const EntityRef> entities) {
+		for (EntityRef entity : entities) {
+			auto iter = m_actors.find(entity);
+			ASSERT(iter.isValid());
+			RigidActor& actor = iter.value();
+			if (!actor.physx_actor || m_update_in_progress == &actor) continue;
+			if (m_updating_dynamic_actors && actor.dynamic_type == DynamicType::DYNAMIC) continue;
+		
 			Transform trans = m_world.getTransform(entity);
 			if (actor.dynamic_type == DynamicType::KINEMATIC) {
 				auto* rigid_dynamic = (PxRigidDynamic*)actor.physx_actor;
@@ -2682,7 +3005,7 @@ struct PhysicsModuleImpl final : PhysicsModule
 			int controller_layer = controller.layer;
 			data.word0 = 1 << controller_layer;
 			data.word1 = m_layers.filter[controller_layer];
-			controller.filter_data = data;
+			controller.filter.m_filter_data = data;
 			PxShape* shapes[8];
 			int shapes_count = controller.controller->getActor()->getShapes(shapes, lengthOf(shapes));
 			for (int i = 0; i < shapes_count; ++i)
@@ -3399,7 +3722,7 @@ struct PhysicsModuleImpl final : PhysicsModule
 			PxFilterData data;
 			data.word0 = 1 << c.layer;
 			data.word1 = m_layers.filter[c.layer];
-			c.filter_data = data;
+			c.filter.m_filter_data = data;
 			PxShape* shapes[8];
 			const u32 shapes_count = c.controller->getActor()->getShapes(shapes, lengthOf(shapes));
 			for (u32 i = 0; i < shapes_count; ++i) shapes[i]->setSimulationFilterData(data);
@@ -3761,22 +4084,6 @@ struct PhysicsModuleImpl final : PhysicsModule
 		Vec3 force;
 	};
 
-	struct Controller
-	{
-		PxController* controller;
-		EntityRef entity;
-		Vec3 frame_change;
-		float radius;
-		float height;
-		float custom_gravity_acceleration;
-		u32 layer;
-		PxFilterData filter_data;
-
-		bool custom_gravity = false;
-		bool use_root_motion = 0;
-		float gravity_speed = 0;
-	};
-	
 	struct FilterCallback : PxQueryFilterCallback
 	{
 		PxQueryHitType::Enum preFilter(const PxFilterData& filterData,
@@ -3798,6 +4105,23 @@ struct PhysicsModuleImpl final : PhysicsModule
 		PxFilterData m_filter_data;
 	};
 
+	struct Controller
+	{
+		PxController* controller;
+		EntityRef entity;
+		Vec3 frame_change;
+		float radius;
+		float height;
+		float custom_gravity_acceleration;
+		u32 layer;
+		// each controller has its own filter, so controllers do not share state while moving
+		FilterCallback filter;
+
+		bool custom_gravity = false;
+		bool use_root_motion = 0;
+		float gravity_speed = 0;
+	};
+	
 	struct HitReport : PxUserControllerHitReport {
 		HitReport(PhysicsModuleImpl& module) : module(module) {}
 		void onShapeHit(const PxControllerShapeHit& hit) override {
@@ -3838,7 +4162,6 @@ struct PhysicsModuleImpl final : PhysicsModule
 	PxRigidDynamic* m_dummy_actor;
 	PxControllerManager* m_controller_manager;
 	PxMaterial* m_default_material;
-	FilterCallback m_filter_callback;
 
 	HashMap<EntityRef, RigidActor> m_actors;
 	HashMap<PhysicsGeometry*, EntityRef> m_resource_actor_map;
@@ -3850,13 +4173,37 @@ struct PhysicsModuleImpl final : PhysicsModule
 	HashMap<EntityRef, InstancedCube> m_instanced_cubes;
 	HashMap<EntityRef, InstancedMesh> m_instanced_meshes;
 	PxVehicleDrivableSurfaceToTireFrictionPairs* m_vehicle_frictions;
-	PxBatchQuery* m_vehicle_batch_query;
-	u8 m_vehicle_query_mem[sizeof(PxRaycastQueryResult) * 64 + sizeof(PxRaycastHit) * 64];
-	PxRaycastQueryResult* m_vehicle_results;
+	Array<UniquePtr<VehicleBatch>> m_vehicle_batches;
+	Array<PxVehicleWheels*> m_vehicle_drives;
+	Array<PxVehicleConcurrentUpdateData> m_vehicle_updates;
 
 	Array<EntityRef> m_dynamic_actors;
+	Array<EntityRef> m_active_entities;
+	Array<Transform> m_dynamic_transforms;
 	RigidActor* m_update_in_progress;
-	EntityPtr m_moving_controller = INVALID_ENTITY;
+	bool m_updating_dynamic_actors = false;
+	bool m_async_simulation = false;
+	bool m_simulating = false;
+	bool m_has_new_results = false;
+	struct HeightfieldUpdate {
+		HeightfieldUpdate(IAllocator& allocator) : samples(allocator) {}
+		// dirty region, [row0, row1) x [col0, col1), samples are in physx layout
+		i32 row0 = 0;
+		i32 col0 = 0;
+		i32 row1 = 0;
+		i32 col1 = 0;
+		Array<PxHeightFieldSample> samples;
+	};
+
+	HashMap<EntityRef, HeightfieldUpdate> m_heightfield_updates;
+	Array<PxHeightFieldSample> m_tmp_heightfield_samples;
+	Array<EntityRef> m_simulation_sources;
+	Array<DVec3> m_simulation_source_positions;
+	float m_simulation_lod_radius = 100;
+	u32 m_simulation_lod_cursor = 0;
+	Array<EntityRef> m_controller_entities;
+	Array<Transform> m_controller_transforms;
+	bool m_updating_controllers = false;
 	DelegateList<void(const ContactData&)> m_contact_callbacks;
 	bool m_is_game_running;
 	u32 m_debug_visualization_flags;
@@ -3873,6 +4220,15 @@ PhysicsModuleImpl::PhysicsModuleImpl(Engine& engine, World& world, PhysicsSystem
 	, m_wheels(m_allocator)
 	, m_terrains(m_allocator)
 	, m_dynamic_actors(m_allocator)
+	, m_active_entities(m_allocator)
+	, m_dynamic_transforms(m_allocator)
+	, m_heightfield_updates(m_allocator)
+	, m_tmp_heightfield_samples(m_allocator)
+	, m_simulation_sources(m_allocator)
+	, m_simulation_source_positions(m_allocator)
+	, m_controller_entities(m_allocator)
+	, m_controller_transforms(m_allocator)
+	, m_cpu_dispatcher(m_allocator)
 	, m_instanced_cubes(m_allocator)
 	, m_instanced_meshes(m_allocator)
 	, m_world(world)
@@ -3883,7 +4239,9 @@ PhysicsModuleImpl::PhysicsModuleImpl(Engine& engine, World& world, PhysicsSystem
 	, m_script_module(nullptr)
 	, m_debug_visualization_flags(0)
 	, m_update_in_progress(nullptr)
-	, m_vehicle_batch_query(nullptr)
+	, m_vehicle_batches(m_allocator)
+	, m_vehicle_drives(m_allocator)
+	, m_vehicle_updates(m_allocator)
 	, m_system(&system)
 	, m_hit_report(*this)
 	, m_layers(m_system->getCollisionLayers())
@@ -3897,9 +4255,10 @@ UniquePtr<PhysicsModule> PhysicsModule::create(PhysicsSystem& system, World& wor
 {
 	PhysicsModuleImpl* impl = LUMIX_NEW(allocator, PhysicsModuleImpl)(engine, world, system, allocator);
 	impl->m_world.componentTransformed(CONTROLLER_TYPE).bind<&PhysicsModuleImpl::onControllerMoved>(impl);
-	impl->m_world.componentTransformed(RIGID_ACTOR_TYPE).bind<&PhysicsModuleImpl::onActorMoved>(impl);
+	impl->m_world.componentTransformedBatch(RIGID_ACTOR_TYPE).bind<&PhysicsModuleImpl::onActorsMoved>(impl);
 	
 	impl->m_world.entityDestroyed().bind<&PhysicsModuleImpl::onEntityDestroyed>(impl);
+	impl->m_world.entityActiveChanged().bind<&PhysicsModuleImpl::onEntityActiveChanged>(impl);
 	PxSceneDesc sceneDesc(system.getPhysics()->getTolerancesScale());
 	sceneDesc.gravity = PxVec3(0.0f, -9.8f, 0.0f);
 	sceneDesc.cpuDispatcher = &impl->m_cpu_dispatcher;
@@ -3907,6 +4266,8 @@ UniquePtr<PhysicsModule> PhysicsModule::create(PhysicsSystem& system, World& wor
 	sceneDesc.filterShader = impl->filterShader;
 	sceneDesc.simulationEventCallback = &impl->m_contact_callback;
 	sceneDesc.flags |= PxSceneFlag::eENABLE_CCD;
+	// kinematic actors are driven by the world, they do not need to be synced back
+	sceneDesc.flags |= PxSceneFlag::eENABLE_ACTIVE_ACTORS | PxSceneFlag::eEXCLUDE_KINEMATICS_FROM_ACTIVE_ACTORS;
 
 	impl->m_scene = system.getPhysics()->createScene(sceneDesc);
 	if (!impl->m_scene)
@@ -3920,7 +4281,6 @@ UniquePtr<PhysicsModule> PhysicsModule::create(PhysicsSystem& system, World& wor
 	impl->m_default_material = impl->m_system->getPhysics()->createMaterial(0.5f, 0.5f, 0.1f);
 	PxSphereGeometry geom(1);
 	impl->m_dummy_actor = PxCreateDynamic(impl->m_scene->getPhysics(), PxTransform(PxIdentity), geom, *impl->m_default_material, 1);
-	impl->m_vehicle_batch_query = impl->createVehicleBatchQuery(impl->m_vehicle_query_mem);
 	return UniquePtr<PhysicsModuleImpl>(impl, &allocator);
 }
 
@@ -3996,13 +4356,13 @@ void PhysicsModuleImpl::RigidActor::setPhysxActor(PxRigidActor* actor)
 {
 	if (physx_actor)
 	{
-		module.m_scene->removeActor(*physx_actor);
+		if (physx_actor->getScene()) module.m_scene->removeActor(*physx_actor);
 		physx_actor->release();
 	}
 	physx_actor = actor;
 	if (actor)
 	{
-		module.m_scene->addActor(*actor);
+		if (module.m_world.isEntityActive(entity)) module.m_scene->addActor(*actor);
 		actor->userData = (void*)(intptr_t)entity.index;
 		module.updateFilterData(actor, layer);
 		setIsTrigger(is_trigger);
@@ -49,6 +49,23 @@ struct SweepHit {
 	float distance;
 };
 
+struct RaycastQuery {
+	Vec3 origin;
+	Vec3 dir;
+	float distance;
+	EntityPtr ignored = INVALID_ENTITY;
+	i32 layer = -1;
+};
+
+struct SweepSphereQuery {
+	DVec3 pos;
+	float radius;
+	Vec3 dir;
+	float distance;
+	EntityPtr ignored = INVALID_ENTITY;
+	i32 layer = -1;
+};
+
 //@ module PhysicsModule physics "Physics"
 struct PhysicsModule : IModule {
 	//@ enum full PhysicsModule::D6Motion
@@ -85,6 +102,20 @@ struct PhysicsModule : IModule {
 	virtual ~PhysicsModule() {}
 	virtual void forceUpdateDynamicActors(float time_delta) = 0;
 	virtual const Array<EntityRef>& getDynamicActors() = 0;
+	// simulation is started at the end of a step and fetched at the start of the next one, so it runs in parallel with rendering
+	// adds one step of latency, queries and writes during simulation work on the state before simulation
+	virtual void setAsyncSimulation(bool enable) = 0;
+	virtual bool isAsyncSimulation() const = 0;
+	// physx tasks are scheduled as high priority jobs, e.g. when physics is on the critical path of the frame
+	virtual void setHighPriorityTasks(bool enable) = 0;
+	// limits physx tasks to the first `count` workers, 0 means any worker
+	virtual void setTaskWorkersCount(u32 count) = 0;
+	// dynamic actors farther than LOD radius from all simulation sources (e.g. players) are put to sleep
+	// and woken up when a source comes near; without any source, all actors are simulated
+	virtual void addSimulationSource(EntityRef entity) = 0;
+	virtual void removeSimulationSource(EntityRef entity) = 0;
+	virtual void setSimulationLODRadius(float radius) = 0;
+	virtual float getSimulationLODRadius() = 0;
 	virtual DelegateList<void(const ContactData&)>& onContact() = 0;
 	
 	//@ functions
@@ -93,6 +124,9 @@ struct PhysicsModule : IModule {
 	//@ end
 	virtual bool raycastEx(Vec3 origin, Vec3 dir, float distance, RaycastHit& result, EntityPtr ignored, i32 layer) = 0;
 	virtual bool sweepSphere(DVec3 pos, float radius, Vec3 dir, float distance, SweepHit& result, EntityPtr ignored, i32 layer) = 0;
+	// queries run in parallel on workers, hits[i] is the result of queries[i], its entity is INVALID_ENTITY if nothing was hit
+	virtual void raycastBatch(Span<const RaycastQuery> queries, Span<RaycastHit> hits) = 0;
+	virtual void sweepSphereBatch(Span<const SweepSphereQuery> queries, Span<SweepHit> hits) = 0;
 
 	virtual void createInstancedMesh(EntityRef entity) = 0;
 	virtual void createInstancedCube(EntityRef entity) = 0;
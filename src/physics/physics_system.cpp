@@ -109,7 +109,10 @@ namespace Lumix
 			
 			m_material_manager.create(PhysicsMaterial::TYPE, engine.getResourceManager());
 			m_geometry_manager.create(PhysicsGeometry::TYPE, engine.getResourceManager());
+		}
 
+		void initAsync() override {
+			PROFILE_FUNCTION();
 			m_foundation = PxCreateFoundation(PX_PHYSICS_VERSION, m_physx_allocator, m_error_callback);
 
 			#ifdef LUMIX_DEBUG
@@ -136,6 +139,9 @@ namespace Lumix
 		{
 			m_material_manager.destroy();
 			m_geometry_manager.destroy();
+			// initAsync was not called
+			if (!m_foundation) return;
+
 			physx::PxCloseVehicleSDK();
 			m_cooking->release();
 			m_physics->release();
@@ -162,6 +168,8 @@ namespace Lumix
 			return true;
 		}
 
+		bool createModulesLazily() const override { return true; }
+
 		void createModules(World& world) override {
 			UniquePtr<PhysicsModule> module = PhysicsModule::create(*this, world, m_engine, m_allocator);
 			world.addModule(module.move());
@@ -233,12 +241,12 @@ namespace Lumix
 
 
 		TagAllocator m_allocator;
-		physx::PxPhysics* m_physics;
-		physx::PxFoundation* m_foundation;
+		physx::PxPhysics* m_physics = nullptr;
+		physx::PxFoundation* m_foundation = nullptr;
 		physx::PxControllerManager* m_controller_manager;
 		PhysxAllocator m_physx_allocator;
 		CustomErrorCallback m_error_callback;
-		physx::PxCooking* m_cooking;
+		physx::PxCooking* m_cooking = nullptr;
 		PhysicsGeometryManager m_geometry_manager;
 		PhysicsMaterialManager m_material_manager;
 		Engine& m_engine;
@@ -2,6 +2,7 @@
 
 #include "core/array.h"
 #include "core/crt.h"
+#include "core/delegate.h"
 #include "core/geometry.h"
 #include "core/hash_map.h"
 #include "core/allocator.h"
@@ -20,11 +21,17 @@ namespace Lumix
 
 static_assert(sizeof(CullResult) == PageAllocator::PAGE_SIZE);
 
+// floor, so cell `i` contains [i * cell_size, (i + 1) * cell_size) on all axes, including negative ones
+static IVec3 toCellPos(const DVec3& pos, float cell_size) {
+	const DVec3 tmp = pos * (1 / cell_size);
+	return IVec3(i32(floor(tmp.x)), i32(floor(tmp.y)), i32(floor(tmp.z)));
+}
+
 struct CellIndices
 {
 	CellIndices() {}
 	CellIndices(const DVec3& pos, float cell_size, u8 type, bool is_big)
-		: pos(pos * (1 / cell_size))
+		: pos(toCellPos(pos, cell_size))
 		, is_big(is_big)
 		, type(type)
 	{}
@@ -41,8 +48,8 @@ struct CellIndicesHasher
 {
 	// http://www.beosil.com/download/CollisionDetectionHashing_VMV03.pdf
 	static u32 get(const CellIndices& indices) {
-		// TODO indices.is_big, indices.type
-		return (u32)indices.pos.x * 73856093 + (u32)indices.pos.y * 19349663 + (u32)indices.pos.z * 83492791; 
+		const u32 h = (u32)indices.pos.x * 73856093 ^ (u32)indices.pos.y * 19349663 ^ (u32)indices.pos.z * 83492791;
+		return h ^ ((u32)indices.type * 2654435761) ^ (indices.is_big ? 0x9e3779b9 : 0);
 	}
 };
 
@@ -54,6 +61,8 @@ struct alignas(4096) CellPage {
 		DVec3 origin;
 		CellIndices indices;
 		int count = 0;
+		// changed whenever any sphere in the page changes, unique across pages, so cached results of a reused page are not valid
+		u32 version = 0;
 	} header;
 
 	enum { MAX_COUNT = (PageAllocator::PAGE_SIZE - sizeof(header)) / (sizeof(Sphere) + sizeof(EntityPtr)) };
@@ -65,8 +74,102 @@ struct alignas(4096) CellPage {
 static_assert(sizeof(CellPage) == PageAllocator::PAGE_SIZE);
 
 
+// calls `f(i)` for each sphere intersecting `frustum`, spheres are relative to `frustum`
+template <typename F>
+static LUMIX_FORCE_INLINE void forEachVisible(const Sphere* LUMIX_RESTRICT spheres, int count, const Frustum& frustum, F&& f)
+{
+	static_assert((int)Frustum::Planes::COUNT == 8);
+	const float8 px = f8LoadUnaligned(frustum.xs);
+	const float8 py = f8LoadUnaligned(frustum.ys);
+	const float8 pz = f8LoadUnaligned(frustum.zs);
+	const float8 pd = f8LoadUnaligned(frustum.ds);
+
+	for (int i = 0; i < count; ++i) {
+		const Sphere& sphere = spheres[i];
+		const float8 cx = f8Splat(sphere.position.x);
+		const float8 cy = f8Splat(sphere.position.y);
+		const float8 cz = f8Splat(sphere.position.z);
+		const float8 r = f8Splat(-sphere.radius);
+
+		const float8 t = cx * px + cy * py + cz * pz + pd - r;
+		if (f8MoveMask(t)) continue;
+
+		f(i);
+	}
+}
+
+// appends entities to a list of result pages of a single type
+struct CullResultWriter {
+	LUMIX_FORCE_INLINE void push(EntityPtr entity, float squared_distance) {
+		if (result->header.count == lengthOf(result->entities)) {
+			result = list.push();
+			result->header.type = type;
+		}
+		const u32 idx = result->header.count;
+		result->entities[idx] = (EntityRef)entity;
+		result->squared_distances[idx] = squared_distance;
+		++result->header.count;
+	}
+
+	CullResult*& result;
+	PagedList<CullResult>& list;
+	u8 type;
+};
+
+// pushes entities with spheres intersecting `frustum`, spheres are relative to `frustum`
+// `lod_offset` is position of spheres' origin relative to the LOD reference point
+static LUMIX_FORCE_INLINE void doCulling(const Sphere* LUMIX_RESTRICT spheres
+	, const EntityPtr* LUMIX_RESTRICT entities
+	, int count
+	, const Frustum& frustum
+	, const Vec3& lod_offset
+	, CullResultWriter& writer)
+{
+	PROFILE_FUNCTION();
+	forEachVisible(spheres, count, frustum, [&](int i){
+		writer.push(entities[i], squaredLength(spheres[i].position + lod_offset));
+	});
+}
+
+// pushes all entities, used when their container is completely inside frustum
+static void copyAll(const Sphere* LUMIX_RESTRICT spheres
+	, const EntityPtr* LUMIX_RESTRICT entities
+	, int count
+	, const Vec3& lod_offset
+	, CullResultWriter& writer)
+{
+	for (int i = 0; i < count; ++i) {
+		writer.push(entities[i], squaredLength(spheres[i].position + lod_offset));
+	}
+}
+
+// indices of visible spheres of cells, which are not completely inside frustum, from the last cull with the same frustum
+// static cells culled by an unchanged view only copy these, instead of testing all their spheres
+struct CullCache {
+	struct Cell {
+		Cell(IAllocator& allocator) : visible(allocator) {}
+
+		const CellPage* page = nullptr;
+		u32 version = 0;
+		Array<u16> visible;
+	};
+
+	CullCache(IAllocator& allocator) : cells(allocator) {}
+
+	ShiftedFrustum frustum;
+	u8 type;
+	u32 last_used = 0;
+	bool in_use = false;
+	// same order as CullingSystemImpl::m_cells
+	Array<Cell> cells;
+};
+
+
 struct CullingSystemImpl final : CullingSystem
 {
+	// views with the same frustum in consecutive frames, e.g. static camera and its shadow cascades
+	static constexpr u32 MAX_CULL_CACHES = 8;
+
 	CullingSystemImpl(IAllocator& allocator, PageAllocator& page_allocator) 
 		: m_allocator(allocator)
 		, m_cell_map(allocator)
@@ -74,7 +177,14 @@ struct CullingSystemImpl final : CullingSystem
 		, m_cells(allocator)
 		, m_cell_size(300.0f)
 		, m_page_allocator(page_allocator)
+		, m_cull_caches(allocator)
 	{
+		m_cull_caches.reserve(MAX_CULL_CACHES);
+	}
+
+	void touch(CellPage& cell) {
+		++m_version;
+		cell.header.version = m_version;
 	}
 	
 	~CullingSystemImpl()
@@ -104,6 +214,7 @@ struct CullingSystemImpl final : CullingSystem
 			cell.spheres[count] = {rel_pos, radius};
 			cell.entities[count] = entity;
 			++cell.header.count;
+			touch(cell);
 			return &cell.spheres[count];
 		}
 
@@ -123,6 +234,7 @@ struct CullingSystemImpl final : CullingSystem
 		new_cell->spheres[0] = {rel_pos, radius};
 		new_cell->entities[0] = entity;
 		new_cell->header.count = 1;
+		touch(*new_cell);
 
 		return &new_cell->spheres[0];
 	}
@@ -183,6 +295,7 @@ struct CullingSystemImpl final : CullingSystem
 			cell.spheres[idx] = cell.spheres[cell.header.count - 1];
 			m_entity_to_cell[last.index] = &cell.spheres[idx];
 			--cell.header.count;
+			touch(cell);
 		}
 		m_entity_to_cell[entity.index] = nullptr;
 	}
@@ -201,10 +314,11 @@ struct CullingSystemImpl final : CullingSystem
 		Sphere* sphere = m_entity_to_cell[entity.index];
 		CellPage& cell = getCell(*sphere);
 
-		const IVec3 new_indices(pos * (1 / m_cell_size));
+		const IVec3 new_indices = toCellPos(pos, m_cell_size);
 
 		if(new_indices == cell.header.indices.pos) {
 			sphere->position = Vec3(pos - cell.header.origin);
+			touch(cell);
 			return;
 		}
 
@@ -223,7 +337,7 @@ struct CullingSystemImpl final : CullingSystem
 	void set(EntityRef entity, const DVec3& pos, float radius) override {
 		Sphere* sphere = m_entity_to_cell[entity.index];
 		CellPage& cell = getCell(*sphere);
-		const IVec3 new_indices(pos * (1 / m_cell_size));
+		const IVec3 new_indices = toCellPos(pos, m_cell_size);
 		
 		const bool was_big = cell.header.indices.is_big;
 		const bool is_big = radius > m_cell_size;
@@ -231,6 +345,7 @@ struct CullingSystemImpl final : CullingSystem
 		if (was_big == is_big && new_indices == cell.header.indices.pos) {
 			sphere->radius = radius;
 			sphere->position = Vec3(pos - cell.header.origin);
+			touch(cell);
 			return;
 		}
 
@@ -249,6 +364,7 @@ struct CullingSystemImpl final : CullingSystem
 
 		if (was_big == is_big) {
 			sphere->radius = radius;
+			touch(cell);
 			return;
 		}
 		const u8 type = cell.header.indices.type;
@@ -257,74 +373,61 @@ struct CullingSystemImpl final : CullingSystem
 		add(entity, type, pos, radius);
 	}
 
-	LUMIX_FORCE_INLINE void doCulling(const CellPage& cell
-		, const Frustum& frustum
-		, CullResult* LUMIX_RESTRICT results
-		, PagedList<CullResult>& list
-		, u8 type)
-	{
-		PROFILE_FUNCTION();
-		const Sphere* LUMIX_RESTRICT start = cell.spheres;
-		const Sphere* LUMIX_RESTRICT end = cell.spheres + cell.header.count;
-		const EntityPtr* LUMIX_RESTRICT sphere_to_entity_map = cell.entities;
-
-		const float4 px = f4Load(frustum.xs);
-		const float4 py = f4Load(frustum.ys);
-		const float4 pz = f4Load(frustum.zs);
-		const float4 pd = f4Load(frustum.ds);
-		const float4 px2 = f4Load(&frustum.xs[4]);
-		const float4 py2 = f4Load(&frustum.ys[4]);
-		const float4 pz2 = f4Load(&frustum.zs[4]);
-		const float4 pd2 = f4Load(&frustum.ds[4]);
-		int cursor = results->header.count;
-
-		int i = 0;
-
-		for (const Sphere *sphere = start; sphere < end; ++sphere, ++i) {
-			const float4 cx = f4Splat(sphere->position.x);
-			const float4 cy = f4Splat(sphere->position.y);
-			const float4 cz = f4Splat(sphere->position.z);
-			const float4 r = f4Splat(-sphere->radius);
-
-			float4 t = cx * px + cy * py + cz * pz + pd;
-			t = t - r;
-			if (f4MoveMask(t)) continue;
-
-			t = cx * px2 + cy * py2 + cz * pz2 + pd2;
-			t = t - r;
-			if (f4MoveMask(t)) continue;
-
-			if(cursor == lengthOf(results->entities)) {
-				results->header.count = cursor;
-				results = list.push();
-				results->header.type = type;
-				cursor = 0;
-			}
-
-			results->entities[cursor] = (EntityRef)sphere_to_entity_map[i];
-			++cursor;
-		}
-		results->header.count = cursor;
-	}
-
 	CullResult* cull(const ShiftedFrustum& frustum, u8 type) override
 	{
 		ASSERT(type != 0xff); // 0xff type is reserved for `all types`
-		return cullInternal(frustum, type);
+		return cullInternal(frustum, type, frustum.origin);
 	}
 
-	CullResult* cull(const ShiftedFrustum& frustum) override
+	CullResult* cull(const ShiftedFrustum& frustum, const DVec3& lod_ref_point) override
 	{
-		return cullInternal(frustum, 0xff);
+		return cullInternal(frustum, 0xff, lod_ref_point);
 	}
 	
-	CullResult* cullInternal(const ShiftedFrustum& frustum, u8 type) {
+	// returns cache of the last cull with the same `frustum` and `type`, or the least recently used one
+	// returns null if all caches are used by concurrent culls
+	CullCache* acquireCache(const ShiftedFrustum& frustum, u8 type) {
+		jobs::MutexGuard guard(m_cull_caches_mutex);
+		++m_cull_counter;
+		CullCache* lru = nullptr;
+		for (CullCache& cache : m_cull_caches) {
+			if (cache.in_use) continue;
+			if (cache.type == type && memcmp(&cache.frustum, &frustum, sizeof(frustum)) == 0) {
+				cache.in_use = true;
+				cache.last_used = m_cull_counter;
+				return &cache;
+			}
+			if (!lru || cache.last_used < lru->last_used) lru = &cache;
+		}
+		if (m_cull_caches.size() < MAX_CULL_CACHES) lru = &m_cull_caches.emplace(m_allocator);
+		if (!lru) return nullptr;
+		
+		lru->frustum = frustum;
+		lru->type = type;
+		lru->in_use = true;
+		lru->last_used = m_cull_counter;
+		for (CullCache::Cell& cell : lru->cells) cell.page = nullptr;
+		return lru;
+	}
+
+	void releaseCache(CullCache* cache) {
+		if (!cache) return;
+		jobs::MutexGuard guard(m_cull_caches_mutex);
+		cache->in_use = false;
+	}
+
+	CullResult* cullInternal(const ShiftedFrustum& frustum, u8 type, const DVec3& lod_ref_point) {
 		if (m_cells.empty()) return nullptr;
 
 		PagedList<CullResult> list(m_page_allocator);
+		CullCache* cache = acquireCache(frustum, type);
+		if (cache) {
+			while (cache->cells.size() < m_cells.size()) cache->cells.emplace(m_allocator);
+		}
 
+		// cell contains sphere centers in [origin, origin + cell_size), radii of non-big spheres are <= cell_size
+		const Vec3 v3_3_cell_size(3 * m_cell_size);
 		const Vec3 v3_cell_size(m_cell_size);
-		const Vec3 v3_2_cell_size(2 * m_cell_size);
 
 		jobs::forEach(m_cells.size(), 1, [&](u32 cell_idx, u32){
 			PROFILE_BLOCK("culling");
@@ -339,32 +442,38 @@ struct CullingSystemImpl final : CullingSystem
 			}
 
 			total_count += cell.header.count;
-			if (cell.header.indices.is_big) {
-				doCulling(cell, frustum.getRelative(cell.header.origin), result, list, cell.header.indices.type);
+			CullResultWriter writer = { result, list, cell.header.indices.type };
+			const Vec3 lod_offset = Vec3(cell.header.origin - lod_ref_point);
+			const DVec3 bounds_min = cell.header.origin - v3_cell_size;
+			const bool is_big = cell.header.indices.is_big;
+			if (!is_big && frustum.containsAABB(bounds_min, v3_3_cell_size)) {
+				copyAll(cell.spheres, cell.entities, cell.header.count, lod_offset, writer);
 			}
-			else if (frustum.containsAABB(cell.header.origin + v3_cell_size, v3_cell_size)) {
-				int to_cpy = cell.header.count;
-				int src_offset = 0;
-				while (to_cpy > 0) {
-					if(result->header.count == lengthOf(result->entities)) {
-						result = list.push();
-						result->header.type = cell.header.indices.type;
+			else if (is_big || frustum.intersectsAABB(bounds_min, v3_3_cell_size)) {
+				CullCache::Cell* cached = cache ? &cache->cells[cell_idx] : nullptr;
+				if (!cached) {
+					doCulling(cell.spheres, cell.entities, cell.header.count, frustum.getRelative(cell.header.origin), lod_offset, writer);
+				}
+				else {
+					if (cached->page != &cell || cached->version != cell.header.version) {
+						cached->page = &cell;
+						cached->version = cell.header.version;
+						cached->visible.clear();
+						forEachVisible(cell.spheres, cell.header.count, frustum.getRelative(cell.header.origin), [&](int i){
+							cached->visible.push(u16(i));
+						});
+					}
+					// distances are not cached, LOD reference point can differ between views with the same frustum
+					for (u16 i : cached->visible) {
+						writer.push(cell.entities[i], squaredLength(cell.spheres[i].position + lod_offset));
 					}
-					const int rem_space = lengthOf(result->entities) - result->header.count;
-					const int step = minimum(to_cpy, rem_space);
-					memcpy(result->entities + result->header.count, cell.entities + src_offset, step * sizeof(cell.entities[0]));
-					src_offset += step;
-					result->header.count += step;
-					to_cpy -= step;
 				}
 			}
-			else if (frustum.intersectsAABB(cell.header.origin - v3_cell_size, v3_2_cell_size)) {
-				doCulling(cell, frustum.getRelative(cell.header.origin), result, list, cell.header.indices.type);
-			}
 			
 			profiler::pushInt("count", total_count);
 		});
 
+		releaseCache(cache);
 		return list.detach();
 	}
 	
@@ -374,6 +483,17 @@ struct CullingSystemImpl final : CullingSystem
 		return entity.index < m_entity_to_cell.size() && m_entity_to_cell[entity.index] != nullptr;
 	}
 
+	CullingStructure getStructure() const override { return CullingStructure::GRID; }
+
+	void forEach(const Delegate<void(EntityRef entity, u8 type, const DVec3& pos, float radius)>& f) const override {
+		for (const CellPage* cell : m_cells) {
+			for (i32 i = 0; i < cell->header.count; ++i) {
+				const Sphere& sphere = cell->spheres[i];
+				f.invoke((EntityRef)cell->entities[i], cell->header.indices.type, cell->header.origin + sphere.position, sphere.radius);
+			}
+		}
+	}
+
 
 	IAllocator& m_allocator;
 	PageAllocator& m_page_allocator;
@@ -381,8 +501,306 @@ struct CullingSystemImpl final : CullingSystem
 	Array<CellPage*> m_cells;
 	Array<Sphere*> m_entity_to_cell;
 	float m_cell_size;
+	u32 m_version = 0;
+	jobs::Mutex m_cull_caches_mutex;
+	Array<CullCache> m_cull_caches;
+	u32 m_cull_counter = 0;
+};
+
+
+
+struct OctreeNode;
+
+struct alignas(4096) OctreePage {
+	struct {
+		OctreePage* next = nullptr;
+		OctreeNode* node = nullptr;
+		int count = 0;
+	} header;
+
+	enum { MAX_COUNT = (PageAllocator::PAGE_SIZE - sizeof(header)) / (sizeof(Sphere) + sizeof(EntityPtr)) };
+
+	Sphere spheres[MAX_COUNT];
+	EntityPtr entities[MAX_COUNT];
 };
 
+static_assert(sizeof(OctreePage) == PageAllocator::PAGE_SIZE);
+
+
+// node's cell is center +- half_size, loose bounds are center +- 2 * half_size
+// sphere is in the deepest node whose cell contains sphere's center and half_size >= radius, so the sphere is inside loose bounds
+// huge nodes contain spheres too big for roots, they do not have children and their spheres are always tested one by one
+struct OctreeNode {
+	OctreeNode* parent = nullptr;
+	OctreeNode* children[8] = {};
+	// only the first page can be partially filled
+	OctreePage* pages = nullptr;
+	DVec3 center;
+	float half_size;
+	// number of spheres in this node and all its descendants, empty nodes are destroyed
+	u32 subtree_count = 0;
+	u8 depth = 0;
+	u8 child_idx = 0;
+	CellIndices key;
+};
+
+
+struct LooseOctreeCullingSystem final : CullingSystem
+{
+	static constexpr float ROOT_SIZE = 1024;
+	static constexpr u8 MAX_DEPTH = 8;
+
+	LooseOctreeCullingSystem(IAllocator& allocator, PageAllocator& page_allocator) 
+		: m_allocator(allocator)
+		, m_page_allocator(page_allocator)
+		, m_roots(allocator)
+		, m_entity_to_sphere(allocator)
+	{}
+
+	~LooseOctreeCullingSystem() {
+		for (OctreeNode* root : m_roots) destroySubtree(root);
+	}
+
+	void destroySubtree(OctreeNode* node) {
+		for (OctreeNode* child : node->children) {
+			if (child) destroySubtree(child);
+		}
+		OctreePage* page = node->pages;
+		while (page) {
+			OctreePage* tmp = page;
+			page = page->header.next;
+			tmp->~OctreePage();
+			m_page_allocator.deallocate(tmp);
+		}
+		LUMIX_DELETE(m_allocator, node);
+	}
+
+	CullingStructure getStructure() const override { return CullingStructure::LOOSE_OCTREE; }
+
+	static OctreePage& getPage(const Sphere& sphere) {
+		const intptr_t ptr = (intptr_t)&sphere;
+		return *(OctreePage*)(ptr - (ptr % PageAllocator::PAGE_SIZE));
+	}
+
+	static bool isHuge(const OctreeNode& node) { return node.key.is_big; }
+
+	// can the sphere stay in `node` without breaking loose bounds
+	static bool fits(const OctreeNode& node, const DVec3& pos, float radius) {
+		const DVec3 d = pos - node.center;
+		const double h = node.half_size;
+		if (fabs(d.x) > h || fabs(d.y) > h || fabs(d.z) > h) return false;
+		return isHuge(node) ? radius > ROOT_SIZE * 0.5f : radius <= node.half_size;
+	}
+
+	OctreeNode* getRoot(const DVec3& pos, float radius, u8 type) {
+		const CellIndices key(pos, ROOT_SIZE, type, radius > ROOT_SIZE * 0.5f);
+		auto iter = m_roots.find(key);
+		if (iter.isValid()) return iter.value();
+
+		OctreeNode* root = LUMIX_NEW(m_allocator, OctreeNode);
+		root->center = (key.pos * double(ROOT_SIZE)) + DVec3(ROOT_SIZE * 0.5);
+		root->half_size = ROOT_SIZE * 0.5f;
+		root->key = key;
+		m_roots.insert(key, root);
+		return root;
+	}
+
+	void add(EntityRef entity, u8 type, const DVec3& pos, float radius) override {
+		while (m_entity_to_sphere.size() <= entity.index) m_entity_to_sphere.push(nullptr);
+
+		OctreeNode* node = getRoot(pos, radius, type);
+		if (!isHuge(*node)) {
+			while (node->depth < MAX_DEPTH && radius <= node->half_size * 0.5f) {
+				const u8 child_idx = (pos.x >= node->center.x ? 1 : 0) | (pos.y >= node->center.y ? 2 : 0) | (pos.z >= node->center.z ? 4 : 0);
+				OctreeNode* child = node->children[child_idx];
+				if (!child) {
+					child = LUMIX_NEW(m_allocator, OctreeNode);
+					const double offset = node->half_size * 0.5;
+					child->center = node->center + DVec3(child_idx & 1 ? offset : -offset, child_idx & 2 ? offset : -offset, child_idx & 4 ? offset : -offset);
+					child->half_size = node->half_size * 0.5f;
+					child->parent = node;
+					child->depth = node->depth + 1;
+					child->child_idx = child_idx;
+					child->key = node->key;
+					node->children[child_idx] = child;
+				}
+				node = child;
+			}
+		}
+
+		OctreePage* page = node->pages;
+		if (!page || page->header.count == OctreePage::MAX_COUNT) {
+			void* mem = m_page_allocator.allocate();
+			page = new (NewPlaceholder(), mem) OctreePage;
+			page->header.node = node;
+			page->header.next = node->pages;
+			node->pages = page;
+		}
+
+		const int idx = page->header.count;
+		page->spheres[idx] = { Vec3(pos - node->center), radius };
+		page->entities[idx] = entity;
+		++page->header.count;
+		m_entity_to_sphere[entity.index] = &page->spheres[idx];
+
+		for (OctreeNode* n = node; n; n = n->parent) ++n->subtree_count;
+	}
+
+	void remove(EntityRef entity) override {
+		if (m_entity_to_sphere.size() <= entity.index) return;
+		Sphere* sphere = m_entity_to_sphere[entity.index];
+		if (!sphere) return;
+		m_entity_to_sphere[entity.index] = nullptr;
+
+		OctreePage& page = getPage(*sphere);
+		OctreeNode* node = page.header.node;
+		
+		// move the last sphere of the node to the removed one
+		OctreePage& first = *node->pages;
+		const int last = first.header.count - 1;
+		const int idx = int(sphere - page.spheres);
+		if (&first != &page || idx != last) {
+			page.spheres[idx] = first.spheres[last];
+			page.entities[idx] = first.entities[last];
+			m_entity_to_sphere[first.entities[last].index] = &page.spheres[idx];
+		}
+		--first.header.count;
+		if (first.header.count == 0) {
+			node->pages = first.header.next;
+			first.~OctreePage();
+			m_page_allocator.deallocate(&first);
+		}
+
+		while (node) {
+			OctreeNode* parent = node->parent;
+			--node->subtree_count;
+			if (node->subtree_count == 0) {
+				// children are already destroyed, since their subtree_count is 0 too
+				if (parent) parent->children[node->child_idx] = nullptr;
+				else m_roots.erase(node->key);
+				LUMIX_DELETE(m_allocator, node);
+			}
+			node = parent;
+		}
+	}
+
+	void set(EntityRef entity, const DVec3& pos, float radius) override {
+		Sphere* sphere = m_entity_to_sphere[entity.index];
+		const OctreeNode& node = *getPage(*sphere).header.node;
+		if (fits(node, pos, radius)) {
+			sphere->position = Vec3(pos - node.center);
+			sphere->radius = radius;
+			return;
+		}
+		const u8 type = node.key.type;
+		remove(entity);
+		add(entity, type, pos, radius);
+	}
+
+	void setPosition(EntityRef entity, const DVec3& pos) override {
+		set(entity, pos, m_entity_to_sphere[entity.index]->radius);
+	}
+
+	void setRadius(EntityRef entity, float radius) override {
+		Sphere* sphere = m_entity_to_sphere[entity.index];
+		const DVec3 pos = getPage(*sphere).header.node->center + sphere->position;
+		set(entity, pos, radius);
+	}
+
+	float getRadius(EntityRef entity) override {
+		return m_entity_to_sphere[entity.index]->radius;
+	}
+
+	bool isAdded(EntityRef entity) override {
+		return entity.index < m_entity_to_sphere.size() && m_entity_to_sphere[entity.index] != nullptr;
+	}
+
+	void forEach(const Delegate<void(EntityRef entity, u8 type, const DVec3& pos, float radius)>& f) const override {
+		for (const Sphere* sphere : m_entity_to_sphere) {
+			if (!sphere) continue;
+			const OctreePage& page = getPage(*sphere);
+			const i32 idx = i32(sphere - page.spheres);
+			const OctreeNode& node = *page.header.node;
+			f.invoke((EntityRef)page.entities[idx], node.key.type, node.center + sphere->position, sphere->radius);
+		}
+	}
+
+	struct CullTask {
+		const OctreePage* page;
+		// node's loose bounds are completely inside frustum
+		bool inside;
+	};
+
+	void gather(const OctreeNode& node, const ShiftedFrustum& frustum, bool inside, Array<CullTask>& tasks) const {
+		if (!inside && !isHuge(node)) {
+			const DVec3 bounds_min = node.center - Vec3(2 * node.half_size);
+			const Vec3 bounds_size(4 * node.half_size);
+			if (!frustum.intersectsAABB(bounds_min, bounds_size)) return;
+			inside = frustum.containsAABB(bounds_min, bounds_size);
+		}
+		for (const OctreePage* page = node.pages; page; page = page->header.next) {
+			tasks.push({page, inside});
+		}
+		for (const OctreeNode* child : node.children) {
+			if (child) gather(*child, frustum, inside, tasks);
+		}
+	}
+
+	CullResult* cullInternal(const ShiftedFrustum& frustum, u8 type, const DVec3& lod_ref_point) {
+		PROFILE_FUNCTION();
+		if (m_roots.empty()) return nullptr;
+
+		// nodes are traversed on this thread, spheres in visible nodes are tested in parallel
+		Array<CullTask> tasks(m_allocator);
+		for (const OctreeNode* root : m_roots) {
+			if (type != 0xff && root->key.type != type) continue;
+			gather(*root, frustum, false, tasks);
+		}
+
+		PagedList<CullResult> list(m_page_allocator);
+		jobs::forEach(tasks.size(), [&](u32 from, u32 to){
+			PROFILE_BLOCK("culling");
+			CullResult* result = nullptr;
+			u32 total_count = 0;
+			for (u32 i = from; i < to; ++i) {
+				const CullTask& task = tasks[i];
+				const OctreePage& page = *task.page;
+				const OctreeNode& node = *page.header.node;
+				const u8 page_type = node.key.type;
+				if (!result || result->header.type != page_type) {
+					result = list.push();
+					result->header.type = page_type;
+				}
+				total_count += page.header.count;
+				CullResultWriter writer = { result, list, page_type };
+				const Vec3 lod_offset = Vec3(node.center - lod_ref_point);
+				if (task.inside) {
+					copyAll(page.spheres, page.entities, page.header.count, lod_offset, writer);
+				}
+				else {
+					doCulling(page.spheres, page.entities, page.header.count, frustum.getRelative(node.center), lod_offset, writer);
+				}
+			}
+			profiler::pushInt("count", total_count);
+		});
+
+		return list.detach();
+	}
+
+	CullResult* cull(const ShiftedFrustum& frustum, u8 type) override {
+		ASSERT(type != 0xff); // 0xff type is reserved for `all types`
+		return cullInternal(frustum, type, frustum.origin);
+	}
+
+	CullResult* cull(const ShiftedFrustum& frustum, const DVec3& lod_ref_point) override {
+		return cullInternal(frustum, 0xff, lod_ref_point);
+	}
+
+	IAllocator& m_allocator;
+	PageAllocator& m_page_allocator;
+	HashMap<CellIndices, OctreeNode*, CellIndicesHasher> m_roots;
+	Array<Sphere*> m_entity_to_sphere;
+};
 
 
 void CullResult::free(PageAllocator& allocator)
@@ -396,8 +814,12 @@ void CullResult::free(PageAllocator& allocator)
 }
 
 
-UniquePtr<CullingSystem> CullingSystem::create(IAllocator& allocator, PageAllocator& page_allocator)
+UniquePtr<CullingSystem> CullingSystem::create(IAllocator& allocator, PageAllocator& page_allocator, CullingStructure structure)
 {
+	switch (structure) {
+		case CullingStructure::LOOSE_OCTREE: return UniquePtr<LooseOctreeCullingSystem>::create(allocator, allocator, page_allocator);
+		case CullingStructure::GRID: break;
+	}
 	return UniquePtr<CullingSystemImpl>::create(allocator, allocator, page_allocator);
 }
 
@@ -6,6 +6,7 @@ namespace Lumix
 {
 
 template <typename T> struct Array;
+template <typename T> struct Delegate;
 template <typename T> struct UniquePtr;
 struct DVec3;
 struct IAllocator;
@@ -52,7 +53,19 @@ struct CullResult {
 		u8 type;
 	} header;
 
-	EntityRef entities[(4096 - sizeof(header)) / sizeof(EntityRef)];
+	static constexpr u32 MAX_COUNT = (4096 - sizeof(header)) / (sizeof(EntityRef) + sizeof(float));
+
+	EntityRef entities[MAX_COUNT];
+	// squared distances of entities' bounding sphere centers to the LOD reference point of cull
+	float squared_distances[MAX_COUNT];
+};
+
+// spatial structure used to store renderables, all behave the same, they differ only in performance
+enum class CullingStructure : u8 {
+	// sparse grid of fixed size cells, cheap updates, good for uniformly dense worlds
+	GRID,
+	// loose octree, better for very sparse or very dense worlds and for objects of very different sizes
+	LOOSE_OCTREE
 };
 
 struct LUMIX_RENDERER_API CullingSystem
@@ -60,10 +73,16 @@ struct LUMIX_RENDERER_API CullingSystem
 	CullingSystem() { }
 	virtual ~CullingSystem() { }
 
-	static UniquePtr<CullingSystem> create(IAllocator& allocator, PageAllocator& page_allocator);
+	static UniquePtr<CullingSystem> create(IAllocator& allocator, PageAllocator& page_allocator, CullingStructure structure = CullingStructure::GRID);
+
+	virtual CullingStructure getStructure() const = 0;
+	// calls `f` for every added entity, e.g. to move them to a culling system with a different structure
+	virtual void forEach(const Delegate<void(EntityRef entity, u8 type, const DVec3& pos, float radius)>& f) const = 0;
 
+	// CullResult::squared_distances are relative to frustum's origin
 	virtual CullResult* cull(const ShiftedFrustum& frustum, u8 type) = 0;
-	virtual CullResult* cull(const ShiftedFrustum& frustum) = 0;
+	// all types, CullResult::squared_distances are relative to `lod_ref_point`, e.g. main camera for shadow views
+	virtual CullResult* cull(const ShiftedFrustum& frustum, const DVec3& lod_ref_point) = 0;
 
 	virtual bool isAdded(EntityRef entity) = 0;
 	virtual void add(EntityRef entity, u8 type, const DVec3& pos, float radius) = 0;
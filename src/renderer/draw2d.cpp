@@ -5,8 +5,10 @@
 namespace Lumix {
 
 
-Draw2D::Draw2D(IAllocator& allocator) 
+Draw2D::Draw2D(IAllocator& allocator)
 	: m_cmds(allocator)
+	, m_textures(allocator)
+	, m_clip_rects(allocator)
 	, m_indices(allocator)
 	, m_vertices(allocator)
 	, m_clip_queue(allocator)
@@ -18,15 +20,23 @@ void Draw2D::clear(Vec2 atlas_size) {
 	m_cmds.clear();
 	m_indices.clear();
 	m_vertices.clear();
+	m_textures.clear();
+	m_clip_rects.clear();
 	m_atlas_size = atlas_size;
-	Cmd& cmd = m_cmds.emplace();
-	cmd.texture = nullptr;
-	cmd.indices_count = 0;
-	cmd.index_offset = 0;
-	cmd.clip_pos = { -1, -1 };
-	cmd.clip_size = { -1, -1 };
 	m_clip_queue.clear();
 	m_clip_queue.push({{-1, -1}, {-2, -2}});
+	beginCmd();
+}
+
+void Draw2D::beginCmd() {
+	Cmd& cmd = m_cmds.emplace();
+	cmd.indices_count = 0;
+	cmd.index_offset = m_indices.size();
+	cmd.textures_offset = m_textures.size();
+	cmd.textures_count = 0;
+	cmd.clip_rects_offset = m_clip_rects.size();
+	cmd.clip_rects_count = 0;
+	m_clip_rect_idx = -1;
 }
 
 void Draw2D::pushClipRect(const Vec2& from, const Vec2& to) {
@@ -44,53 +54,50 @@ void Draw2D::pushClipRect(const Vec2& from, const Vec2& to) {
 	r.to.y = maximum(r.from.y, r.to.y);
 
 	m_clip_queue.push({r.from, r.to});
-	Cmd& cmd = m_cmds.emplace();
-	cmd.texture = nullptr;
-	cmd.clip_pos = r.from;
-	cmd.clip_size = r.to - r.from;
-	cmd.indices_count = 0;
-	cmd.index_offset = m_indices.size();
+	m_clip_rect_idx = -1;
 }
 
 void Draw2D::popClipRect() {
 	m_clip_queue.pop();
-	const Rect& r = m_clip_queue.back();
-	Cmd& cmd = m_cmds.emplace();
-	cmd.texture = nullptr;
-	cmd.clip_pos = r.from;
-	cmd.clip_size = r.to - r.from;
-	cmd.indices_count = 0;
-	cmd.index_offset = m_indices.size();
+	m_clip_rect_idx = -1;
 }
 
-void Draw2D::addLine(const Vec2& p0, const Vec2& p1, Color color, float width) {
+void Draw2D::addQuad(gpu::TextureHandle* tex, const Vertex (&vertices)[4]) {
 	Cmd* cmd = &m_cmds.back();
 
-	if (cmd->texture != nullptr && cmd->indices_count != 0) {
-		cmd = &m_cmds.emplace();
-		const Rect& r = m_clip_queue.back();
-		cmd->clip_pos = r.from;
-		cmd->clip_size = r.to - r.from;
-		cmd->indices_count = 0;
-		cmd->index_offset = m_indices.size();
+	i32 tex_idx = -1;
+	for (i32 i = cmd->textures_count - 1; i >= 0; --i) {
+		if (m_textures[cmd->textures_offset + i] == tex) {
+			tex_idx = i;
+			break;
+		}
 	}
-	
-	Vec2 from = p0 + Vec2(0.5f);
-	Vec2 to = p1 + Vec2(0.5f);
 
-	cmd->texture = nullptr;
-	const Vec2 uv = Vec2(0.5f) / m_atlas_size;
-	const Vec2 dir = normalize(to - from);
-	const Vec2 n = Vec2(dir.y, -dir.x) * (width * 0.5f);
-	const u32 voff = m_vertices.size();
-	
-	from = from - dir * width * 0.5f;
-	to = to + dir * width * 0.5f;
+	const bool textures_full = tex_idx < 0 && cmd->textures_count == MAX_CMD_TEXTURES;
+	const bool clip_rects_full = m_clip_rect_idx < 0 && cmd->clip_rects_count == MAX_CMD_CLIP_RECTS;
+	if (textures_full || clip_rects_full) {
+		beginCmd();
+		cmd = &m_cmds.back();
+		tex_idx = -1;
+	}
 
-	m_vertices.push({from + n, uv, color});
-	m_vertices.push({from - n, uv, color});
-	m_vertices.push({to - n, uv, color});
-	m_vertices.push({to + n, uv, color});
+	if (tex_idx < 0) {
+		m_textures.push(tex);
+		tex_idx = cmd->textures_count;
+		++cmd->textures_count;
+	}
+	if (m_clip_rect_idx < 0) {
+		m_clip_rects.push(m_clip_queue.back());
+		m_clip_rect_idx = cmd->clip_rects_count;
+		++cmd->clip_rects_count;
+	}
+
+	const u32 voff = m_vertices.size();
+	for (const Vertex& v : vertices) {
+		Vertex& dst = m_vertices.emplace(v);
+		dst.texture = (u16)tex_idx;
+		dst.clip_rect = (u16)m_clip_rect_idx;
+	}
 
 	m_indices.push(voff);
 	m_indices.push(voff + 1);
@@ -103,6 +110,85 @@ void Draw2D::addLine(const Vec2& p0, const Vec2& p1, Color color, float width) {
 	cmd->indices_count += 6;
 }
 
+void Draw2D::append(const Draw2D& src) {
+	for (const Cmd& src_cmd : src.m_cmds) {
+		if (src_cmd.indices_count == 0) continue;
+
+		// merge src cmd's tables into the current cmd if they fit, otherwise start a new cmd
+		Cmd* cmd = &m_cmds.back();
+		auto find_texture = [&](gpu::TextureHandle* tex) -> i32 {
+			for (i32 i = cmd->textures_count - 1; i >= 0; --i) {
+				if (m_textures[cmd->textures_offset + i] == tex) return i;
+			}
+			return -1;
+		};
+		u32 new_textures = 0;
+		for (u32 i = 0; i < src_cmd.textures_count; ++i) {
+			if (find_texture(src.m_textures[src_cmd.textures_offset + i]) < 0) ++new_textures;
+		}
+		if (cmd->textures_count + new_textures > MAX_CMD_TEXTURES || cmd->clip_rects_count + src_cmd.clip_rects_count > MAX_CMD_CLIP_RECTS) {
+			beginCmd();
+			cmd = &m_cmds.back();
+		}
+
+		u16 textures_map[MAX_CMD_TEXTURES];
+		for (u32 i = 0; i < src_cmd.textures_count; ++i) {
+			gpu::TextureHandle* tex = src.m_textures[src_cmd.textures_offset + i];
+			i32 idx = find_texture(tex);
+			if (idx < 0) {
+				m_textures.push(tex);
+				idx = cmd->textures_count;
+				++cmd->textures_count;
+			}
+			textures_map[i] = (u16)idx;
+		}
+		u16 clip_rects_map[MAX_CMD_CLIP_RECTS];
+		for (u32 i = 0; i < src_cmd.clip_rects_count; ++i) {
+			m_clip_rects.push(src.m_clip_rects[src_cmd.clip_rects_offset + i]);
+			clip_rects_map[i] = (u16)cmd->clip_rects_count;
+			++cmd->clip_rects_count;
+		}
+		m_clip_rect_idx = -1;
+
+		// everything is a quad, so cmd's vertices are contiguous and start at its first index
+		const u32 src_voff = src.m_indices[src_cmd.index_offset];
+		const u32 vertices_count = src_cmd.indices_count / 6 * 4;
+		const u32 voff = m_vertices.size();
+		m_vertices.reserve(voff + vertices_count);
+		for (u32 i = 0; i < vertices_count; ++i) {
+			Vertex& v = m_vertices.emplace(src.m_vertices[src_voff + i]);
+			v.texture = textures_map[v.texture];
+			v.clip_rect = clip_rects_map[v.clip_rect];
+		}
+
+		const u32 ioff = m_indices.size();
+		m_indices.resize(ioff + src_cmd.indices_count);
+		for (u32 i = 0; i < src_cmd.indices_count; ++i) {
+			m_indices[ioff + i] = src.m_indices[src_cmd.index_offset + i] - src_voff + voff;
+		}
+		cmd->indices_count += src_cmd.indices_count;
+	}
+}
+
+void Draw2D::addLine(const Vec2& p0, const Vec2& p1, Color color, float width) {
+	Vec2 from = p0 + Vec2(0.5f);
+	Vec2 to = p1 + Vec2(0.5f);
+
+	const Vec2 uv = Vec2(0.5f) / m_atlas_size;
+	const Vec2 dir = normalize(to - from);
+	const Vec2 n = Vec2(dir.y, -dir.x) * (width * 0.5f);
+
+	from = from - dir * width * 0.5f;
+	to = to + dir * width * 0.5f;
+
+	addQuad(nullptr, {
+		{from + n, uv, color},
+		{from - n, uv, color},
+		{to - n, uv, color},
+		{to + n, uv, color}
+	});
+}
+
 void Draw2D::addRect(const Vec2& from, const Vec2& to, Color color, float width) {
 	addLine(from, {from.x, to.y}, color, width);
 	addLine({from.x, to.y}, to, color, width);
@@ -111,82 +197,28 @@ void Draw2D::addRect(const Vec2& from, const Vec2& to, Color color, float width)
 }
 
 void Draw2D::addRectFilled(const Vec2& from, const Vec2& to, Color color) {
-	Cmd* cmd = &m_cmds.back();
-
-	if (cmd->texture != nullptr && cmd->indices_count != 0) {
-		cmd = &m_cmds.emplace();
-		const Rect& r = m_clip_queue.back();
-		cmd->clip_pos = r.from;
-		cmd->clip_size = r.to - r.from;
-		cmd->indices_count = 0;
-		cmd->index_offset = m_indices.size();
-	}
-
-	cmd->texture = nullptr;
-	const u32 voff = m_vertices.size();
-	m_indices.push(voff);
-	m_indices.push(voff + 1);
-	m_indices.push(voff + 2);
-
-	m_indices.push(voff);
-	m_indices.push(voff + 2);
-	m_indices.push(voff + 3);
-
 	const Vec2 uv = Vec2(0.5f) / m_atlas_size;
 
-	m_vertices.push({from, uv, color});
-	m_vertices.push({{from.x, to.y}, uv, color});
-	m_vertices.push({to, uv, color});
-	m_vertices.push({{to.x, from.y}, uv, color});
-	
-	cmd->indices_count += 6;
+	addQuad(nullptr, {
+		{from, uv, color},
+		{{from.x, to.y}, uv, color},
+		{to, uv, color},
+		{{to.x, from.y}, uv, color}
+	});
 }
 
 void Draw2D::addImage(gpu::TextureHandle* tex, const Vec2& from, const Vec2& to, const Vec2& uv0, const Vec2& uv1, Color color) {
-	Cmd* cmd = &m_cmds.back();
-
-	if (cmd->texture != tex && cmd->indices_count != 0) {
-		cmd = &m_cmds.emplace();
-		const Rect& r = m_clip_queue.back();
-		cmd->clip_pos = r.from;
-		cmd->clip_size = r.to - r.from;
-		cmd->indices_count = 0;
-		cmd->index_offset = m_indices.size();
-	}
-
-	cmd->texture = tex;
-	const u32 voff = m_vertices.size();
-	m_indices.push(voff);
-	m_indices.push(voff + 1);
-	m_indices.push(voff + 2);
-
-	m_indices.push(voff);
-	m_indices.push(voff + 2);
-	m_indices.push(voff + 3);
-
-	m_vertices.push({from, uv0, color});
-	m_vertices.push({{from.x, to.y}, {uv0.x, uv1.y}, color});
-	m_vertices.push({to, uv1, color});
-	m_vertices.push({{to.x, from.y}, {uv1.x, uv0.y}, color});
-	
-	cmd->indices_count += 6;
+	addQuad(tex, {
+		{from, uv0, color},
+		{{from.x, to.y}, {uv0.x, uv1.y}, color},
+		{to, uv1, color},
+		{{to.x, from.y}, {uv1.x, uv0.y}, color}
+	});
 }
 
 void Draw2D::addText(const Font& font, const Vec2& pos, Color color, const char* str) {
 	if (!*str) return;
-	Cmd* cmd = &m_cmds.back();
-
-	if (cmd->texture != nullptr && cmd->indices_count != 0) {
-		cmd = &m_cmds.emplace();
-		const Rect& r = m_clip_queue.back();
-		cmd->clip_pos = r.from;
-		cmd->clip_size = r.to - r.from;
-		cmd->indices_count = 0;
-		cmd->index_offset = m_indices.size();
-	}
 
-	cmd->texture = nullptr;
-	
 	Vec2 p = pos;
 	p.x = float(int(p.x));
 	p.y = float(int(p.y));
@@ -198,29 +230,62 @@ void Draw2D::addText(const Font& font, const Vec2& pos, Color color, const char*
 			p.y += getAdvanceY(font);
 			continue;
 		}
-		const Glyph* glyph = findGlyph(font, *c);
+		const Glyph* glyph = findGlyph(font, (u8)*c);
 		if (!glyph) {
 			p.x += 16;
 			continue;
 		}
-	
-		const u32 voff = m_vertices.size();
-		m_indices.push(voff);
-		m_indices.push(voff + 1);
-		m_indices.push(voff + 2);
-
-		m_indices.push(voff);
-		m_indices.push(voff + 2);
-		m_indices.push(voff + 3);
-
-		m_vertices.push({ p + Vec2(glyph->x0, glyph->y0), { glyph->u0, glyph->v0 }, color });
-		m_vertices.push({ p + Vec2(glyph->x1, glyph->y0), { glyph->u1, glyph->v0 }, color });
-		m_vertices.push({ p + Vec2(glyph->x1, glyph->y1), { glyph->u1, glyph->v1 }, color });
-		m_vertices.push({ p + Vec2(glyph->x0, glyph->y1), { glyph->u0, glyph->v1 }, color });
-		
+
+		addQuad(nullptr, {
+			{ p + Vec2(glyph->x0, glyph->y0), { glyph->u0, glyph->v0 }, color },
+			{ p + Vec2(glyph->x1, glyph->y0), { glyph->u1, glyph->v0 }, color },
+			{ p + Vec2(glyph->x1, glyph->y1), { glyph->u1, glyph->v1 }, color },
+			{ p + Vec2(glyph->x0, glyph->y1), { glyph->u0, glyph->v1 }, color }
+		});
+
 		p.x += glyph->advance_x;
-		cmd->indices_count += 6;
 	}
 }
 
-} // namespace Lumix
\ No newline at end of file
+void Draw2D::layoutText(const Font& font, const char* str, TextLayout& layout) {
+	layout.quads.clear();
+	layout.size = measureTextA(font, str, nullptr);
+
+	// origin is snapped to integer coordinates in addText, so the layout is relative to it
+	Vec2 p(0);
+	for (const char* c = str; *c; ++c) {
+		if (*c == '\r') continue;
+		if (*c == '\n') {
+			p.x = 0;
+			p.y += getAdvanceY(font);
+			continue;
+		}
+		const Glyph* glyph = findGlyph(font, (u8)*c);
+		if (!glyph) {
+			p.x += 16;
+			continue;
+		}
+
+		TextLayout::Quad& quad = layout.quads.emplace();
+		quad.from = p + Vec2(glyph->x0, glyph->y0);
+		quad.to = p + Vec2(glyph->x1, glyph->y1);
+		quad.uv0 = { glyph->u0, glyph->v0 };
+		quad.uv1 = { glyph->u1, glyph->v1 };
+
+		p.x += glyph->advance_x;
+	}
+}
+
+void Draw2D::addText(const TextLayout& layout, const Vec2& pos, Color color) {
+	const Vec2 p(float(int(pos.x)), float(int(pos.y)));
+	for (const TextLayout::Quad& quad : layout.quads) {
+		addQuad(nullptr, {
+			{ p + quad.from, quad.uv0, color },
+			{ p + Vec2(quad.to.x, quad.from.y), { quad.uv1.x, quad.uv0.y }, color },
+			{ p + quad.to, quad.uv1, color },
+			{ p + Vec2(quad.from.x, quad.to.y), { quad.uv0.x, quad.uv1.y }, color }
+		});
+	}
+}
+
+} // namespace Lumix
@@ -12,18 +12,45 @@ namespace Lumix
 struct Font;
 
 struct LUMIX_RENDERER_API Draw2D {
+	// textures and clip rects are per vertex, so one cmd can draw many images and clip rects in one draw call
+	// new cmd is started only when its texture or clip rect table is full
+	static constexpr u32 MAX_CMD_TEXTURES = 64;
+	static constexpr u32 MAX_CMD_CLIP_RECTS = 64;
+
+	struct Rect {
+		Vec2 from;
+		Vec2 to;
+	};
+
 	struct Cmd {
-		gpu::TextureHandle* texture;
 		u32 indices_count;
 		u32 index_offset;
-		Vec2 clip_pos;
-		Vec2 clip_size;
+		// ranges in getTextures() and getClipRects()
+		u32 textures_offset;
+		u32 textures_count;
+		u32 clip_rects_offset;
+		u32 clip_rects_count;
+	};
+
+	// glyphs of a text positioned relative to its origin, so the text can be drawn again without glyph lookups
+	struct TextLayout {
+		struct Quad {
+			Vec2 from, to;
+			Vec2 uv0, uv1;
+		};
+		TextLayout(IAllocator& allocator) : quads(allocator) {}
+		Array<Quad> quads;
+		// same as measureTextA
+		Vec2 size = Vec2(0);
 	};
 
 	struct Vertex {
 		Vec2 pos;
 		Vec2 uv;
 		Color color; 
+		// indices into cmd's texture and clip rect tables
+		u16 texture;
+		u16 clip_rect;
 	};
 
 	Draw2D(IAllocator& allocator);
@@ -35,19 +62,31 @@ struct LUMIX_RENDERER_API Draw2D {
 	void addRect(const Vec2& from, const Vec2& to, Color color, float width);
 	void addRectFilled(const Vec2& from, const Vec2& to, Color color);
 	void addText(const Font& font, const Vec2& pos, Color color, const char* text);
+	void addText(const TextLayout& layout, const Vec2& pos, Color color);
+	static void layoutText(const Font& font, const char* text, TextLayout& layout);
 	void addImage(gpu::TextureHandle* tex, const Vec2& from, const Vec2& to, const Vec2& uv0, const Vec2& uv1, Color color);
+	// copies already built geometry, so retained draw lists do not have to be rebuilt every frame
+	// clip rects of `src` are used as they are, they are not intersected with the current clip rect
+	void append(const Draw2D& src);
+	Vec2 getAtlasSize() const { return m_atlas_size; }
 	const Array<Vertex>& getVertices() const { return m_vertices; }
 	const Array<u32>& getIndices() const { return m_indices; }
 	const Array<Cmd>& getCmds() const { return m_cmds; }
+	// nullptr is font atlas
+	const Array<gpu::TextureHandle*>& getTextures() const { return m_textures; }
+	// rect with negative `to` does not clip
+	const Array<Rect>& getClipRects() const { return m_clip_rects; }
 
 private:
-	struct Rect {
-		Vec2 from;
-		Vec2 to;
-	};
+	void beginCmd();
+	void addQuad(gpu::TextureHandle* tex, const Vertex (&vertices)[4]);
 
 	Vec2 m_atlas_size;
 	Array<Cmd> m_cmds;
+	Array<gpu::TextureHandle*> m_textures;
+	Array<Rect> m_clip_rects;
+	// index of current clip rect in the last cmd, -1 if it's not there yet
+	i32 m_clip_rect_idx = -1;
 	Array<u32> m_indices;
 	Array<Vertex> m_vertices;
 	Array<Rect> m_clip_queue;
@@ -1,8 +1,11 @@
 #include "draw_stream.h"
+#include "draw_stream_capture.h"
 #include "core/array.h"
+#include "core/job_system.h"
 #include "core/math.h"
 #include "core/os.h"
 #include "core/page_allocator.h"
+#include "core/profiler.h"
 #include "core/string.h"
 #include "engine/engine.h"
 #include "renderer/renderer.h"
@@ -42,16 +45,21 @@ enum class DrawStream::Instruction : u8 {
 	TEXTURE_BARRIER,
 	BUFFER_BARRIER,
 	DRAW_INDIRECT,
+	DRAW_ARRAYS_INDIRECT,
 	BIND_SHADER_BUFFER,
 	DISPATCH,
 	CREATE_BUFFER,
 	CREATE_TEXTURE,
+	CREATE_PLACED_TEXTURE,
+	CREATE_HEAP,
+	ALIASING_BARRIER,
 	COPY_TEXTURE,
 	COPY_TEXTURE_TO_BUFFER,
 	COPY_BUFFER,
 	DESTROY_TEXTURE,
 	DESTROY_BUFFER,
 	DESTROY_PROGRAM,
+	DESTROY_HEAP,
 	UPDATE_TEXTURE,
 	UPDATE_BUFFER,
 	FREE_MEMORY,
@@ -65,7 +73,12 @@ enum class DrawStream::Instruction : u8 {
 	END_PROFILE_BLOCK,
 	USER_ALLOC,
 	SET_TEXTURE_DEBUG_NAME,
-	READ_TEXTURE
+	READ_TEXTURE,
+	READ_BUFFER,
+	SET_TEXTURE_MIN_LOD,
+	SET_QUEUE,
+	SYNC_QUEUES,
+	PARALLEL_SUBSTREAMS
 };
 
 namespace {
@@ -143,6 +156,11 @@ struct BufferBarrierData {
 	gpu::BarrierType type;
 };
 
+struct SyncQueuesData {
+	gpu::QueueType waiting;
+	gpu::QueueType signaling;
+};
+
 struct DrawIndirectData {
 	gpu::DataType index_type;
 	u32 indirect_buffer_offset;
@@ -154,8 +172,15 @@ struct ReadTextureData {
 };
 
 struct ReadBufferData {
-	gpu::BufferHandle handle;
-	Span<u8> buf;
+	gpu::BufferHandle buffer;
+	u32 offset;
+	u32 size;
+	gpu::BufferReadCallback callback;
+};
+
+struct SetMinLODData {
+	gpu::TextureHandle texture;
+	u32 mip;
 };
 
 struct CopyTextureData {
@@ -194,6 +219,18 @@ struct CreateTextureData {
 	gpu::TextureFlags flags;
 };
 
+struct CreatePlacedTextureData {
+	CreateTextureData texture;
+	gpu::HeapHandle heap;
+	u64 offset;
+};
+
+struct CreateHeapData {
+	gpu::HeapHandle heap;
+	u64 size;
+	gpu::TextureFlags flags;
+};
+
 struct ClearData {
 	gpu::ClearFlags flags;
 	Vec4 color;
@@ -276,6 +313,10 @@ void DrawStream::destroy(gpu::TextureHandle texture) {
 	if (texture) write(Instruction::DESTROY_TEXTURE, texture);
 }
 
+void DrawStream::destroy(gpu::HeapHandle heap) {
+	if (heap) write(Instruction::DESTROY_HEAP, heap);
+}
+
 void DrawStream::destroy(gpu::ProgramHandle program) {
 	if (program) write(Instruction::DESTROY_PROGRAM, program);
 }
@@ -289,6 +330,11 @@ void DrawStream::readTexture(gpu::TextureHandle texture, gpu::TextureReadCallbac
 	write(Instruction::READ_TEXTURE, data);
 }
 
+void DrawStream::readBuffer(gpu::BufferHandle buffer, u32 offset, u32 size, gpu::BufferReadCallback callback) {
+	ReadBufferData data = { buffer, offset, size, callback };
+	write(Instruction::READ_BUFFER, data);
+}
+
 void DrawStream::copy(gpu::BufferHandle dst, gpu::TextureHandle src) {
 	CopyTextureToBufferData data = { dst, src };
 	write(Instruction::COPY_TEXTURE_TO_BUFFER, data);
@@ -367,6 +413,39 @@ void DrawStream::createTexture(gpu::TextureHandle handle, u32 w, u32 h, u32 dept
 	WRITE_ARRAY(debug_name, len);
 }
 
+void DrawStream::createTexture(gpu::TextureHandle handle, u32 w, u32 h, u32 depth, gpu::TextureFormat format, gpu::TextureFlags flags, gpu::HeapHandle heap, u64 offset, const char* debug_name) {
+	ASSERT(debug_name);
+	CreatePlacedTextureData desc = {{handle, w, h, depth, format, flags}, heap, offset};
+	const u32 len = stringLength(debug_name) + 1;
+	u8* data = alloc(sizeof(Instruction) + sizeof(desc) + len + sizeof(len));
+	ASSERT(w < 64*1024);
+	ASSERT(h < 64*1024);
+	WRITE_CONST(Instruction::CREATE_PLACED_TEXTURE);
+	WRITE(desc);
+	WRITE(len);
+	WRITE_ARRAY(debug_name, len);
+}
+
+void DrawStream::createHeap(gpu::HeapHandle heap, u64 size, gpu::TextureFlags flags, const char* debug_name) {
+	ASSERT(debug_name);
+	CreateHeapData desc = {heap, size, flags};
+	const u32 len = stringLength(debug_name) + 1;
+	u8* data = alloc(sizeof(Instruction) + sizeof(desc) + len + sizeof(len));
+	WRITE_CONST(Instruction::CREATE_HEAP);
+	WRITE(desc);
+	WRITE(len);
+	WRITE_ARRAY(debug_name, len);
+}
+
+void DrawStream::aliasingBarrier(gpu::TextureHandle texture) {
+	write(Instruction::ALIASING_BARRIER, texture);
+}
+
+void DrawStream::setMinLOD(gpu::TextureHandle texture, u32 mip) {
+	SetMinLODData data = { texture, mip };
+	write(Instruction::SET_TEXTURE_MIN_LOD, data);
+}
+
 void DrawStream::setDebugName(gpu::TextureHandle texture, const char* debug_name) {
 	const u32 len = stringLength(debug_name) + 1;
 	u8* data = alloc(sizeof(Instruction) + sizeof(texture) + len + sizeof(len));
@@ -382,6 +461,16 @@ DrawStream& DrawStream::createSubstream() {
 	return *new (NewPlaceholder(), data) DrawStream(renderer);
 }
 
+void DrawStream::createParallelSubstreams(u32 count, DrawStream** out) {
+	u8* data = alloc(sizeof(Instruction) + sizeof(count) + sizeof(DrawStream) * count);
+	WRITE_CONST(Instruction::PARALLEL_SUBSTREAMS);
+	WRITE(count);
+	for (u32 i = 0; i < count; ++i) {
+		out[i] = new (NewPlaceholder(), data) DrawStream(renderer);
+		data += sizeof(DrawStream);
+	}
+}
+
 static const char* getAttrDefine(u32 idx) {
 	switch (idx) {
 		case 0 : return "#define _HAS_ATTR0\n";
@@ -549,6 +638,11 @@ void DrawStream::drawIndirect(gpu::DataType index_type, u32 indirect_buffer_offs
 	write(Instruction::DRAW_INDIRECT, data);
 }
 
+void DrawStream::drawArraysIndirect(u32 indirect_buffer_offset) {
+	submitCached();
+	write(Instruction::DRAW_ARRAYS_INDIRECT, indirect_buffer_offset);
+}
+
 void DrawStream::barrier(gpu::TextureHandle texture, gpu::BarrierType type) {
 	TextureBarrierData data = {texture, type};
 	write(Instruction::TEXTURE_BARRIER, data);
@@ -559,6 +653,15 @@ void DrawStream::barrier(gpu::BufferHandle buffer, gpu::BarrierType type) {
 	write(Instruction::BUFFER_BARRIER, data);
 }
 
+void DrawStream::setQueue(gpu::QueueType queue) {
+	write(Instruction::SET_QUEUE, queue);
+}
+
+void DrawStream::syncQueues(gpu::QueueType waiting, gpu::QueueType signaling) {
+	SyncQueuesData data = {waiting, signaling};
+	write(Instruction::SYNC_QUEUES, data);
+}
+
 void DrawStream::memoryBarrier(gpu::BufferHandle buffer) {
 	write(Instruction::MEMORY_BARRIER, buffer);
 }
@@ -739,6 +842,11 @@ void DrawStream::run() {
 					gpu::drawIndirect(data.index_type, data.indirect_buffer_offset);
 					break;
 				}
+				case Instruction::DRAW_ARRAYS_INDIRECT: {
+					READ(u32, indirect_buffer_offset);
+					gpu::drawArraysIndirect(indirect_buffer_offset);
+					break;
+				}
 				case Instruction::MEMORY_BARRIER: {
 					READ(gpu::BufferHandle, buffer);
 					gpu::memoryBarrier(buffer);
@@ -759,6 +867,16 @@ void DrawStream::run() {
 					gpu::barrier(data.buffer, data.type);
 					break;
 				}
+				case Instruction::SET_QUEUE: {
+					READ(gpu::QueueType, queue);
+					gpu::setQueue(queue);
+					break;
+				}
+				case Instruction::SYNC_QUEUES: {
+					READ(SyncQueuesData, data);
+					gpu::syncQueues(data.waiting, data.signaling);
+					break;
+				}
 				case Instruction::POP_DEBUG_GROUP:
 					gpu::popDebugGroup();
 					break;
@@ -875,6 +993,28 @@ void DrawStream::run() {
 					gpu::createTexture(data.handle, data.w, data.h, data.depth, data.format, data.flags, debug_name);
 					break;
 				}
+				case Instruction::CREATE_PLACED_TEXTURE: {
+					READ(CreatePlacedTextureData, data);
+					READ(u32, len);
+					const char* debug_name = (const char*)ptr;
+					ptr += len;
+					const CreateTextureData& tex = data.texture;
+					gpu::createTexture(tex.handle, tex.w, tex.h, tex.depth, tex.format, tex.flags, data.heap, data.offset, debug_name);
+					break;
+				}
+				case Instruction::CREATE_HEAP: {
+					READ(CreateHeapData, data);
+					READ(u32, len);
+					const char* debug_name = (const char*)ptr;
+					ptr += len;
+					gpu::createHeap(data.heap, data.size, data.flags, debug_name);
+					break;
+				}
+				case Instruction::ALIASING_BARRIER: {
+					READ(gpu::TextureHandle, texture);
+					gpu::aliasingBarrier(texture);
+					break;
+				}
 				case Instruction::CREATE_BUFFER: {
 					READ(CreateBufferData, data);
 					READ(u32, len);
@@ -908,6 +1048,16 @@ void DrawStream::run() {
 					gpu::readTexture(data.texture, data.callback);
 					break;
 				}
+				case Instruction::READ_BUFFER: {
+					READ(ReadBufferData, data);
+					gpu::readBuffer(data.buffer, data.offset, data.size, data.callback);
+					break;
+				}
+				case Instruction::SET_TEXTURE_MIN_LOD: {
+					READ(SetMinLODData, data);
+					gpu::setMinLOD(data.texture, data.mip);
+					break;
+				}
 				case Instruction::DESTROY_TEXTURE: {
 					READ(gpu::TextureHandle, texture);
 					gpu::destroy(texture);
@@ -918,6 +1068,11 @@ void DrawStream::run() {
 					gpu::destroy(program);
 					break;
 				}
+				case Instruction::DESTROY_HEAP: {
+					READ(gpu::HeapHandle, heap);
+					gpu::destroy(heap);
+					break;
+				}
 				case Instruction::DESTROY_BUFFER: {
 					READ(gpu::BufferHandle, buffer);
 					gpu::destroy(buffer);
@@ -957,6 +1112,26 @@ void DrawStream::run() {
 					ptr += sizeof(DrawStream);
 					break;
 				}
+				case Instruction::PARALLEL_SUBSTREAMS: {
+					READ(u32, count);
+					DrawStream* streams = (DrawStream*)ptr;
+					gpu::beginParallel(count);
+					jobs::forEach(count, 1, [&](u32 i, u32){
+						PROFILE_BLOCK("record commands");
+						gpu::bindParallelContext(i);
+						streams[i].run();
+						gpu::unbindParallelContext();
+					});
+					gpu::endParallel();
+					for (u32 i = 0; i < count; ++i) {
+						num_drawcalls += streams[i].num_drawcalls;
+						upload_duration += streams[i].upload_duration;
+						upload_size += streams[i].upload_size;
+						streams[i].~DrawStream();
+					}
+					ptr += sizeof(DrawStream) * count;
+					break;
+				}
 				case Instruction::CAPTURE_FRAME: {
 					gpu::captureFrame();
 					break;
@@ -996,4 +1171,443 @@ void DrawStream::run() {
 	}
 }
 
+void DrawStream::record(DrawStreamCapture& capture) {
+	using Cmd = DrawStreamCaptureCommand;
+	const Instruction end_instr = Instruction::END;
+	memcpy(current->data + current->header.size, &end_instr, sizeof(end_instr));
+
+	// resource commands are always passed to `capture`, the rest only if the frame is captured
+	const bool capturing = capture.isCapturingFrame();
+	OutputMemoryStream& out = capture.frame();
+	auto write_id = [&](const void* handle){ out.write(capture.id(handle)); };
+
+	Page* page = first;
+	while (page) {
+		const u8* ptr = page->data;
+		for (;;) {
+			READ(Instruction, instr);
+			switch(instr) {
+				case Instruction::END: goto next_page;
+				case Instruction::DRAW: {
+					READ(gpu::Drawcall, drawcall);
+					if (!capturing) break;
+					out.write(Cmd::DRAW);
+					write_id(drawcall.program);
+					write_id(drawcall.index_buffer);
+					write_id(drawcall.vertex_buffers[0]);
+					write_id(drawcall.vertex_buffers[1]);
+					out.write(drawcall.vertex_buffer_offsets);
+					out.write(drawcall.vertex_buffer_sizes);
+					out.write(drawcall.indices_count);
+					out.write(drawcall.instances_count);
+					out.write(drawcall.index_type);
+					break;
+				}
+				case Instruction::DIRTY_CACHE: {
+					READ(u32, dirty);
+					if (dirty & Dirty::PROGRAM) {
+						READ(gpu::ProgramHandle, program);
+						if (capturing) {
+							out.write(Cmd::USE_PROGRAM);
+							write_id(program);
+						}
+					}
+					if (dirty & Dirty::INDEX_BUFFER) {
+						READ(gpu::BufferHandle, buf);
+						if (capturing) {
+							out.write(Cmd::BIND_INDEX_BUFFER);
+							write_id(buf);
+						}
+					}
+					if (dirty & Dirty::INDIRECT_BUFFER) {
+						READ(gpu::BufferHandle, buf);
+						if (capturing) {
+							out.write(Cmd::BIND_INDIRECT_BUFFER);
+							write_id(buf);
+						}
+					}
+					for (u32 i = 0; i < 2; ++i) {
+						if (!(dirty & (i == 0 ? Dirty::VERTEX_BUFFER0 : Dirty::VERTEX_BUFFER1))) continue;
+						READ(Cache::VertexBuffer, buf);
+						if (!capturing) continue;
+						out.write(Cmd::BIND_VERTEX_BUFFER);
+						out.write(i);
+						write_id(buf.buffer);
+						out.write(buf.offset);
+						out.write(buf.stride);
+					}
+					break;
+				}
+				case Instruction::DRAW_INDIRECT: {
+					READ(DrawIndirectData, data);
+					if (!capturing) break;
+					out.write(Cmd::DRAW_INDIRECT);
+					out.write(data.index_type);
+					out.write(data.indirect_buffer_offset);
+					break;
+				}
+				case Instruction::DRAW_ARRAYS_INDIRECT: {
+					READ(u32, indirect_buffer_offset);
+					if (!capturing) break;
+					out.write(Cmd::DRAW_ARRAYS_INDIRECT);
+					out.write(indirect_buffer_offset);
+					break;
+				}
+				case Instruction::MEMORY_BARRIER: {
+					READ(gpu::BufferHandle, buffer);
+					if (!capturing) break;
+					out.write(Cmd::MEMORY_BARRIER);
+					write_id(buffer);
+					break;
+				}
+				case Instruction::MEMORY_BARRIER_TEXTURE: {
+					READ(gpu::TextureHandle, texture);
+					if (!capturing) break;
+					out.write(Cmd::MEMORY_BARRIER_TEXTURE);
+					write_id(texture);
+					break;
+				}
+				case Instruction::TEXTURE_BARRIER: {
+					READ(TextureBarrierData, data);
+					if (!capturing) break;
+					out.write(Cmd::TEXTURE_BARRIER);
+					write_id(data.texture);
+					out.write(data.type);
+					break;
+				}
+				case Instruction::BUFFER_BARRIER: {
+					READ(BufferBarrierData, data);
+					if (!capturing) break;
+					out.write(Cmd::BUFFER_BARRIER);
+					write_id(data.buffer);
+					out.write(data.type);
+					break;
+				}
+				case Instruction::SET_QUEUE: {
+					READ(gpu::QueueType, queue);
+					if (!capturing) break;
+					out.write(Cmd::SET_QUEUE);
+					out.write(queue);
+					break;
+				}
+				case Instruction::SYNC_QUEUES: {
+					READ(SyncQueuesData, data);
+					if (!capturing) break;
+					out.write(Cmd::SYNC_QUEUES);
+					out.write(data.waiting);
+					out.write(data.signaling);
+					break;
+				}
+				case Instruction::POP_DEBUG_GROUP:
+					if (capturing) out.write(Cmd::POP_DEBUG_GROUP);
+					break;
+				case Instruction::PUSH_DEBUG_GROUP: {
+					READ(const char*, msg);
+					if (!capturing) break;
+					out.write(Cmd::PUSH_DEBUG_GROUP);
+					out.writeString(msg);
+					break;
+				}
+				case Instruction::UPDATE_BUFFER: {
+					READ(UpdateBufferData, data);
+					capture.update(data.buffer, data.data, data.size);
+					break;
+				}
+				case Instruction::UPDATE_TEXTURE: {
+					READ(UpdateTextureData, data);
+					capture.update(data.texture, data.mip, data.x, data.y, data.z, data.w, data.h, data.format, data.buf, data.size);
+					break;
+				}
+				case Instruction::BIND_SHADER_BUFFER: {
+					READ(BinderShaderBufferData, data);
+					if (!capturing) break;
+					out.write(Cmd::BIND_SHADER_BUFFERS);
+					for (gpu::BufferHandle buffer : data.buffers) write_id(buffer);
+					break;
+				}
+				case Instruction::CREATE_PROGRAM: {
+					READ(CreateProgramData*, data);
+					capture.createProgram(data->program, data->state, data->decl, data->src, data->type, data->name.c_str());
+					break;
+				}
+				case Instruction::SET_FRAMEBUFFER_CUBE: {
+					READ(SetFramebufferCubeData, data);
+					if (!capturing) break;
+					out.write(Cmd::SET_FRAMEBUFFER_CUBE);
+					write_id(data.cube);
+					out.write(data.face);
+					out.write(data.mip);
+					break;
+				}
+				case Instruction::SET_FRAMEBUFFER: {
+					READ(u32, num);
+					READ(gpu::TextureHandle, ds);
+					READ(gpu::FramebufferFlags, flags);
+					const gpu::TextureHandle* attachments = (const gpu::TextureHandle*)ptr;
+					ptr += sizeof(gpu::TextureHandle) * num;
+					if (!capturing) break;
+					out.write(Cmd::SET_FRAMEBUFFER);
+					out.write(num);
+					write_id(ds);
+					out.write(flags);
+					for (u32 i = 0; i < num; ++i) {
+						gpu::TextureHandle attachment;
+						memcpy(&attachment, attachments + i, sizeof(attachment));
+						write_id(attachment);
+					}
+					break;
+				}
+				case Instruction::CLEAR: {
+					READ(ClearData, data);
+					if (!capturing) break;
+					out.write(Cmd::CLEAR);
+					out.write(data.flags);
+					out.write(data.color);
+					out.write(data.depth);
+					break;
+				}
+				case Instruction::BIND_UNIFORM_BUFFER: {
+					READ(BindUniformBufferData, data);
+					if (!capturing) break;
+					out.write(Cmd::BIND_UNIFORM_BUFFER);
+					out.write(data.ub_index);
+					write_id(data.buffer);
+					out.write((u64)data.offset);
+					out.write((u64)data.size);
+					break;
+				}
+				case Instruction::DRAW_ARRAYS: {
+					READ(DrawArraysData, data);
+					if (!capturing) break;
+					out.write(Cmd::DRAW_ARRAYS);
+					out.write(data.offset);
+					out.write(data.count);
+					break;
+				}
+				case Instruction::REQUEST_DISASSEMBLY: {
+					READ(gpu::ProgramHandle, program);
+					break;
+				}
+				case Instruction::DRAW_INDEXED_INSTANCED: {
+					READ(DrawIndexedInstancedDat, data);
+					if (!capturing) break;
+					out.write(Cmd::DRAW_INDEXED_INSTANCED);
+					out.write(data.indices_count);
+					out.write(data.instances_count);
+					out.write(data.index_type);
+					break;
+				}
+				case Instruction::DRAW_ARRAYS_INSTANCED: {
+					READ(DrawArraysInstancedData, data);
+					if (!capturing) break;
+					out.write(Cmd::DRAW_ARRAYS_INSTANCED);
+					out.write(data.indices_count);
+					out.write(data.instances_count);
+					break;
+				}
+				case Instruction::DRAW_INDEXED: {
+					READ(DrawIndexedData, data);
+					if (!capturing) break;
+					out.write(Cmd::DRAW_INDEXED);
+					out.write(data.offset);
+					out.write(data.count);
+					out.write(data.type);
+					break;
+				}
+				case Instruction::SET_CURRENT_WINDOW: {
+					// replay renders to its own window
+					READ(void*, window_handle);
+					break;
+				}
+				case Instruction::SCISSOR: {
+					READ(IVec4, vec);
+					if (!capturing) break;
+					out.write(Cmd::SCISSOR);
+					out.write(vec);
+					break;
+				}
+				case Instruction::SET_TEXTURE_DEBUG_NAME: {
+					READ(gpu::TextureHandle, texture);
+					READ(u32, len);
+					ptr += len;
+					break;
+				}
+				case Instruction::CREATE_TEXTURE: {
+					READ(CreateTextureData, data);
+					READ(u32, len);
+					const char* debug_name = (const char*)ptr;
+					ptr += len;
+					capture.createTexture(data.handle, data.w, data.h, data.depth, data.format, data.flags, gpu::INVALID_HEAP, 0, debug_name);
+					break;
+				}
+				case Instruction::CREATE_PLACED_TEXTURE: {
+					READ(CreatePlacedTextureData, data);
+					READ(u32, len);
+					const char* debug_name = (const char*)ptr;
+					ptr += len;
+					const CreateTextureData& tex = data.texture;
+					capture.createTexture(tex.handle, tex.w, tex.h, tex.depth, tex.format, tex.flags, data.heap, data.offset, debug_name);
+					break;
+				}
+				case Instruction::CREATE_HEAP: {
+					READ(CreateHeapData, data);
+					READ(u32, len);
+					const char* debug_name = (const char*)ptr;
+					ptr += len;
+					capture.createHeap(data.heap, data.size, data.flags, debug_name);
+					break;
+				}
+				case Instruction::ALIASING_BARRIER: {
+					READ(gpu::TextureHandle, texture);
+					if (!capturing) break;
+					out.write(Cmd::ALIASING_BARRIER);
+					write_id(texture);
+					break;
+				}
+				case Instruction::CREATE_BUFFER: {
+					READ(CreateBufferData, data);
+					READ(u32, len);
+					const char* debug_name = (const char*)ptr;
+					ptr += len;
+					capture.createBuffer(data.buffer, data.flags, data.size, data.data, debug_name);
+					break;
+				}
+				case Instruction::COPY_TEXTURE_TO_BUFFER: {
+					READ(CopyTextureToBufferData, data);
+					if (!capturing) break;
+					out.write(Cmd::COPY_TEXTURE_TO_BUFFER);
+					write_id(data.dst);
+					write_id(data.src);
+					break;
+				}
+				case Instruction::COPY_TEXTURE: {
+					READ(CopyTextureData, data);
+					if (!capturing) break;
+					out.write(Cmd::COPY_TEXTURE);
+					write_id(data.dst);
+					write_id(data.src);
+					out.write(data.dst_x);
+					out.write(data.dst_y);
+					break;
+				}
+				case Instruction::COPY_BUFFER: {
+					READ(CopyBufferData, data);
+					if (!capturing) break;
+					out.write(Cmd::COPY_BUFFER);
+					write_id(data.dst);
+					write_id(data.src);
+					out.write(data.dst_offset);
+					out.write(data.src_offset);
+					out.write(data.size);
+					break;
+				}
+				// readbacks only feed engine's callbacks, they are not part of the replayed work
+				case Instruction::READ_TEXTURE: {
+					READ(ReadTextureData, data);
+					break;
+				}
+				case Instruction::READ_BUFFER: {
+					READ(ReadBufferData, data);
+					break;
+				}
+				case Instruction::SET_TEXTURE_MIN_LOD: {
+					READ(SetMinLODData, data);
+					capture.setMinLOD(data.texture, data.mip);
+					break;
+				}
+				case Instruction::DESTROY_TEXTURE: {
+					READ(gpu::TextureHandle, texture);
+					capture.destroy(texture);
+					break;
+				}
+				case Instruction::DESTROY_PROGRAM: {
+					READ(gpu::ProgramHandle, program);
+					capture.destroy(program);
+					break;
+				}
+				case Instruction::DESTROY_HEAP: {
+					READ(gpu::HeapHandle, heap);
+					capture.destroy(heap);
+					break;
+				}
+				case Instruction::DESTROY_BUFFER: {
+					READ(gpu::BufferHandle, buffer);
+					capture.destroy(buffer);
+					break;
+				}
+				case Instruction::FREE_MEMORY:
+				case Instruction::FREE_ALIGNED_MEMORY: {
+					READ(DeleteMemoryData, data);
+					break;
+				}
+				case Instruction::DISPATCH: {
+					READ(IVec3, size);
+					if (!capturing) break;
+					out.write(Cmd::DISPATCH);
+					out.write(size);
+					break;
+				}
+				case Instruction::FUNCTION: {
+					// arbitrary engine code, can't be captured
+					READ(u32, payload_size);
+					using F = void (*)(void*);
+					READ(F, func);
+					ptr += payload_size;
+					break;
+				}
+				case Instruction::SUBSTREAM: {
+					DrawStream* stream = (DrawStream*)ptr;
+					stream->record(capture);
+					ptr += sizeof(DrawStream);
+					break;
+				}
+				case Instruction::PARALLEL_SUBSTREAMS: {
+					// replayed serially
+					READ(u32, count);
+					DrawStream* streams = (DrawStream*)ptr;
+					for (u32 i = 0; i < count; ++i) streams[i].record(capture);
+					ptr += sizeof(DrawStream) * count;
+					break;
+				}
+				case Instruction::CAPTURE_FRAME: break;
+				case Instruction::END_PROFILE_BLOCK: {
+					if (capturing) out.write(Cmd::END_PROFILE_BLOCK);
+					break;
+				}
+				case Instruction::BEGIN_PROFILE_BLOCK: {
+					READ(i64, link);
+					READ(bool, stats);
+					READ(u32, len);
+					if (capturing) {
+						out.write(Cmd::BEGIN_PROFILE_BLOCK);
+						out.writeString((const char*)ptr);
+					}
+					ptr += len;
+					break;
+				}
+				case Instruction::CREATE_TEXTURE_VIEW: {
+					READ(CreateTextureViewData, data);
+					capture.createTextureView(data.view, data.texture, data.layer, data.mip);
+					break;
+				}
+				case Instruction::USER_ALLOC: {
+					READ(u32, size);
+					ptr += size;
+					break;
+				}
+				case Instruction::VIEWPORT: {
+					READ(IVec4, vec);
+					if (!capturing) break;
+					out.write(Cmd::VIEWPORT);
+					out.write(vec);
+					break;
+				}
+			}
+		}
+		next_page:
+
+		page = page->header.next;
+	}
+}
+
 } // namespace Lumix
@@ -17,11 +17,15 @@ struct DrawStream {
 	void createProgram(gpu::ProgramHandle prog, gpu::StateFlags state, const gpu::VertexDecl& decl, const char* srcs, gpu::ShaderType type, const char** prefixes, u32 prefixes_count, const char* name);
 	void createBuffer(gpu::BufferHandle buffer, gpu::BufferFlags flags, size_t size, const void* data, const char* debug_name);
 	void createTexture(gpu::TextureHandle handle, u32 w, u32 h, u32 depth, gpu::TextureFormat format, gpu::TextureFlags flags, const char* debug_name);
+	// texture placed in heap's memory, see gpu::createTexture
+	void createTexture(gpu::TextureHandle handle, u32 w, u32 h, u32 depth, gpu::TextureFormat format, gpu::TextureFlags flags, gpu::HeapHandle heap, u64 offset, const char* debug_name);
+	void createHeap(gpu::HeapHandle heap, u64 size, gpu::TextureFlags flags, const char* debug_name);
 	void createTextureView(gpu::TextureHandle view, gpu::TextureHandle texture, u32 layer, u32 mip);
 
 	void destroy(gpu::TextureHandle texture);
 	void destroy(gpu::BufferHandle buffer);
 	void destroy(gpu::ProgramHandle program);
+	void destroy(gpu::HeapHandle heap);
 	
 	void setCurrentWindow(void* window_handle);
 	void setFramebuffer(const gpu::TextureHandle* attachments, u32 num, gpu::TextureHandle ds, gpu::FramebufferFlags flags);
@@ -49,6 +53,7 @@ struct DrawStream {
 	gpu::Drawcall& draw();
 	void drawArrays(u32 offset, u32 count);
 	void drawIndirect(gpu::DataType index_type, u32 indirect_buffer_offset);
+	void drawArraysIndirect(u32 indirect_buffer_offset);
 	void drawIndexed(u32 offset, u32 count, gpu::DataType type);
 	void drawArraysInstanced(u32 indices_count, u32 instances_count);
 	void drawIndexedInstanced(u32 indices_count, u32 instances_count, gpu::DataType index_type);
@@ -58,17 +63,26 @@ struct DrawStream {
 	void barrier(gpu::BufferHandle buffer, gpu::BarrierType type);
 	void memoryBarrier(gpu::BufferHandle buffer);
 	void memoryBarrier(gpu::TextureHandle texture);
+	void aliasingBarrier(gpu::TextureHandle texture);
+	// see gpu::setQueue and gpu::syncQueues, bindings must be set again after syncQueues
+	void setQueue(gpu::QueueType queue);
+	void syncQueues(gpu::QueueType waiting, gpu::QueueType signaling);
 	
 	void copy(gpu::BufferHandle dst, gpu::TextureHandle src);
 	void copy(gpu::TextureHandle dst, gpu::TextureHandle src, u32 dst_x, u32 dst_y);
 	void copy(gpu::BufferHandle dst, gpu::BufferHandle src, u32 dst_offset, u32 src_offset, u32 size);
 	
 	void readTexture(gpu::TextureHandle texture, gpu::TextureReadCallback callback);
+	void readBuffer(gpu::BufferHandle buffer, u32 offset, u32 size, gpu::BufferReadCallback callback);
 	void setDebugName(gpu::TextureHandle texture, const char* debug_name);
+	void setMinLOD(gpu::TextureHandle texture, u32 mip);
 	
 	void update(gpu::TextureHandle texture, u32 mip, u32 x, u32 y, u32 z, u32 w, u32 h, gpu::TextureFormat format, const void* buf, u32 size);
 	void update(gpu::BufferHandle buffer, const void* data, size_t size);
 	DrawStream& createSubstream();
+	// `count` substreams recorded to separate command lists in parallel jobs, see gpu::beginParallel
+	// only bindings, draws, dispatches, viewport and scissor can be used in them
+	void createParallelSubstreams(u32 count, DrawStream** out);
 
 	u8* userAlloc(u32 size);
 	void freeMemory(void* data, IAllocator& allocator);
@@ -77,6 +91,8 @@ struct DrawStream {
 	template <typename F> void pushLambda(const F& f);
 
 	void run();
+	// passes the content to `capture` without running it, call it right before run()
+	void record(struct DrawStreamCapture& capture);
 	void reset();
 	
 	// merge rhs into this, rhs is left empty
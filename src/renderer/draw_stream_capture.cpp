@@ -0,0 +1,306 @@
+#include "draw_stream_capture.h"
+#include "core/log.h"
+#include "core/os.h"
+#include "core/profiler.h"
+#include "core/sort.h"
+
+namespace Lumix {
+
+using Cmd = DrawStreamCaptureCommand;
+
+DrawStreamCapture::DrawStreamCapture(IAllocator& allocator)
+	: m_allocator(allocator)
+	, m_resources(allocator)
+	, m_retired(allocator)
+	, m_frame(allocator)
+{}
+
+DrawStreamCapture::~DrawStreamCapture() {
+	for (Resource* res : m_resources) LUMIX_DELETE(m_allocator, res);
+	for (Resource* res : m_retired) LUMIX_DELETE(m_allocator, res);
+}
+
+void DrawStreamCapture::requestCapture(const char* path) {
+	MutexGuard lock(m_mutex);
+	m_requested_path = path;
+}
+
+bool DrawStreamCapture::beginFrame() {
+	ASSERT(!m_capturing);
+	{
+		MutexGuard lock(m_mutex);
+		if (!m_requested_path.data[0]) return false;
+		m_path = m_requested_path;
+		m_requested_path = "";
+	}
+	m_capturing = true;
+	m_unknown_handles = 0;
+	m_frame.clear();
+	return true;
+}
+
+DrawStreamCapture::Resource& DrawStreamCapture::create(const void* handle, ResourceType type, const char* name) {
+	// handle reused before the capture ended
+	destroy(handle);
+
+	Resource* res = LUMIX_NEW(m_allocator, Resource)(m_allocator);
+	res->id = m_next_id++;
+	res->type = type;
+	res->handle = handle;
+	res->name = name ? name : "";
+	m_resources.insert(handle, res);
+	return *res;
+}
+
+void DrawStreamCapture::destroy(const void* handle) {
+	auto iter = m_resources.find(handle);
+	if (!iter.isValid()) return;
+
+	Resource* res = iter.value();
+	m_resources.erase(iter);
+	// the frame can use the resource before it's destroyed
+	if (m_capturing) m_retired.push(res);
+	else LUMIX_DELETE(m_allocator, res);
+}
+
+u32 DrawStreamCapture::id(const void* handle) {
+	if (!handle) return 0;
+	auto iter = m_resources.find(handle);
+	if (iter.isValid()) return iter.value()->id;
+	++m_unknown_handles;
+	return 0;
+}
+
+void DrawStreamCapture::externalBuffer(gpu::BufferHandle buffer, gpu::BufferFlags flags, u32 size, const void* data, u32 data_size, const char* name) {
+	ASSERT(m_capturing);
+	Resource& res = create(buffer, ResourceType::BUFFER, name);
+	res.bindless = gpu::getBindlessHandle(buffer).value;
+	res.flags = (u32)flags;
+	res.size = size;
+	res.external = true;
+	if (data && data_size > 0) {
+		res.data.resize(data_size);
+		memcpy(res.data.begin(), data, data_size);
+	}
+}
+
+void DrawStreamCapture::createBuffer(gpu::BufferHandle buffer, gpu::BufferFlags flags, size_t size, const void* data, const char* name) {
+	Resource& res = create(buffer, ResourceType::BUFFER, name);
+	res.bindless = gpu::getBindlessHandle(buffer).value;
+	res.flags = (u32)flags;
+	res.size = size;
+	if (data && size > 0) {
+		res.data.resize((u32)size);
+		memcpy(res.data.begin(), data, size);
+	}
+}
+
+void DrawStreamCapture::createTexture(gpu::TextureHandle texture, u32 w, u32 h, u32 depth, gpu::TextureFormat format, gpu::TextureFlags flags, gpu::HeapHandle heap, u64 offset, const char* name) {
+	Resource& res = create(texture, ResourceType::TEXTURE, name);
+	res.bindless = gpu::getBindlessHandle(texture).value;
+	res.w = w;
+	res.h = h;
+	res.depth = depth;
+	res.format = (u32)format;
+	res.flags = (u32)flags;
+	res.parent = heap;
+	res.offset = offset;
+}
+
+void DrawStreamCapture::createHeap(gpu::HeapHandle heap, u64 size, gpu::TextureFlags flags, const char* name) {
+	Resource& res = create(heap, ResourceType::HEAP, name);
+	res.size = size;
+	res.flags = (u32)flags;
+}
+
+void DrawStreamCapture::createTextureView(gpu::TextureHandle view, gpu::TextureHandle texture, u32 layer, u32 mip) {
+	Resource& res = create(view, ResourceType::TEXTURE_VIEW, nullptr);
+	res.bindless = gpu::getBindlessHandle(view).value;
+	res.parent = texture;
+	res.layer = layer;
+	res.mip = mip;
+}
+
+void DrawStreamCapture::createProgram(gpu::ProgramHandle program, gpu::StateFlags state, const gpu::VertexDecl& decl, const char* src, gpu::ShaderType type, const char* name) {
+	Resource& res = create(program, ResourceType::PROGRAM, name);
+	res.state = state;
+	res.decl = decl;
+	res.shader_type = type;
+	const u32 len = stringLength(src) + 1;
+	res.data.resize(len);
+	memcpy(res.data.begin(), src, len);
+}
+
+void DrawStreamCapture::update(gpu::BufferHandle buffer, const void* data, size_t size) {
+	if (m_capturing) {
+		m_frame.write(Cmd::UPDATE_BUFFER);
+		m_frame.write(id(buffer));
+		m_frame.write((u64)size);
+		m_frame.write(data, size);
+	}
+
+	auto iter = m_resources.find(buffer);
+	if (!iter.isValid()) return;
+	Array<u8>& content = iter.value()->data;
+	if (content.size() < size) content.resize((u32)size);
+	memcpy(content.begin(), data, size);
+}
+
+void DrawStreamCapture::update(gpu::TextureHandle texture, u32 mip, u32 x, u32 y, u32 z, u32 w, u32 h, gpu::TextureFormat format, const void* data, u32 size) {
+	if (m_capturing) {
+		m_frame.write(Cmd::UPDATE_TEXTURE);
+		m_frame.write(id(texture));
+		m_frame.write(mip);
+		m_frame.write(x);
+		m_frame.write(y);
+		m_frame.write(z);
+		m_frame.write(w);
+		m_frame.write(h);
+		m_frame.write(format);
+		m_frame.write(size);
+		m_frame.write(data, size);
+	}
+
+	auto iter = m_resources.find(texture);
+	if (!iter.isValid()) return;
+
+	Array<TextureUpdate>& updates = iter.value()->updates;
+	TextureUpdate* update = nullptr;
+	// streamed textures update the same regions again, keep only the latest content
+	for (TextureUpdate& u : updates) {
+		if (u.mip == mip && u.x == x && u.y == y && u.z == z && u.w == w && u.h == h) {
+			update = &u;
+			break;
+		}
+	}
+	if (!update) update = &updates.emplace(m_allocator);
+	update->mip = mip;
+	update->x = x;
+	update->y = y;
+	update->z = z;
+	update->w = w;
+	update->h = h;
+	update->format = format;
+	update->data.resize(size);
+	memcpy(update->data.begin(), data, size);
+}
+
+void DrawStreamCapture::setMinLOD(gpu::TextureHandle texture, u32 mip) {
+	auto iter = m_resources.find(texture);
+	if (iter.isValid()) iter.value()->min_lod = mip;
+}
+
+void DrawStreamCapture::write(OutputMemoryStream& out, const Resource& res) {
+	switch (res.type) {
+		case ResourceType::BUFFER:
+			out.write(Cmd::CREATE_BUFFER);
+			out.write(res.id);
+			out.write(res.bindless);
+			out.write(res.flags);
+			out.write(res.size);
+			out.writeString(res.name);
+			out.write((u64)res.data.size());
+			out.write(res.data.begin(), res.data.byte_size());
+			break;
+		case ResourceType::TEXTURE:
+			out.write(Cmd::CREATE_TEXTURE);
+			out.write(res.id);
+			out.write(res.bindless);
+			out.write(res.w);
+			out.write(res.h);
+			out.write(res.depth);
+			out.write(res.format);
+			out.write(res.flags);
+			out.write(id(res.parent));
+			out.write(res.offset);
+			out.writeString(res.name);
+			for (const TextureUpdate& u : res.updates) {
+				out.write(Cmd::UPDATE_TEXTURE);
+				out.write(res.id);
+				out.write(u.mip);
+				out.write(u.x);
+				out.write(u.y);
+				out.write(u.z);
+				out.write(u.w);
+				out.write(u.h);
+				out.write(u.format);
+				out.write(u.data.size());
+				out.write(u.data.begin(), u.data.byte_size());
+			}
+			if (res.min_lod != 0) {
+				out.write(Cmd::SET_TEXTURE_MIN_LOD);
+				out.write(res.id);
+				out.write(res.min_lod);
+			}
+			break;
+		case ResourceType::HEAP:
+			out.write(Cmd::CREATE_HEAP);
+			out.write(res.id);
+			out.write(res.size);
+			out.write(res.flags);
+			out.writeString(res.name);
+			break;
+		case ResourceType::TEXTURE_VIEW:
+			out.write(Cmd::CREATE_TEXTURE_VIEW);
+			out.write(res.id);
+			out.write(res.bindless);
+			out.write(id(res.parent));
+			out.write(res.layer);
+			out.write(res.mip);
+			break;
+		case ResourceType::PROGRAM:
+			out.write(Cmd::CREATE_PROGRAM);
+			out.write(res.id);
+			out.write(res.state);
+			out.write(res.decl);
+			out.write(res.shader_type);
+			out.writeString(res.name);
+			out.writeString((const char*)res.data.begin());
+			break;
+	}
+}
+
+void DrawStreamCapture::endFrame() {
+	if (!m_capturing) return;
+	PROFILE_FUNCTION();
+
+	// resources are created in the order they were created in the engine, views and placed textures depend on that
+	Array<Resource*> resources(m_allocator);
+	resources.reserve(m_resources.size() + m_retired.size());
+	for (Resource* res : m_resources) resources.push(res);
+	for (Resource* res : m_retired) resources.push(res);
+	sort(resources.begin(), resources.end(), [](const Resource* a, const Resource* b){ return a->id < b->id; });
+
+	OutputMemoryStream blob(m_allocator);
+	for (const Resource* res : resources) write(blob, *res);
+	blob.write(Cmd::FRAME);
+	blob.write(m_frame.data(), m_frame.size());
+	blob.write(Cmd::END);
+
+	Header header;
+	header.resources_count = resources.size();
+	header.unknown_handles = m_unknown_handles;
+	os::OutputFile file;
+	if (!file.open(m_path)) {
+		logError("Failed to create ", m_path);
+	}
+	else {
+		if (!file.write(&header, sizeof(header)) || !file.write(blob.data(), blob.size())) logError("Failed to write ", m_path);
+		else logInfo("Draw stream captured to ", m_path, " (", blob.size() / 1024, " KB, ", resources.size(), " resources)");
+		file.close();
+	}
+	if (m_unknown_handles > 0) {
+		logWarning("Draw stream capture: ", m_unknown_handles, " handles were not created through draw streams, replay will use null resources instead");
+	}
+
+	m_capturing = false;
+	for (Resource* res : m_retired) LUMIX_DELETE(m_allocator, res);
+	m_retired.clear();
+	// external buffers are captured again with each frame
+	for (const Resource* res : resources) {
+		if (res->external) destroy(res->handle);
+	}
+	m_frame.clear();
+}
+
+} // namespace Lumix
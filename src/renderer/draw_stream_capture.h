@@ -0,0 +1,168 @@
+#pragma once
+
+#include "core/array.h"
+#include "core/hash_map.h"
+#include "core/stream.h"
+#include "core/string.h"
+#include "core/sync.h"
+#include "gpu/gpu.h"
+
+namespace Lumix {
+
+// keep order, this is serialized, bump DrawStreamCapture::VERSION when changed
+// handles are serialized as u32 ids, 0 is invalid handle, all payloads are inline
+enum class DrawStreamCaptureCommand : u8 {
+	END,
+
+	// setup - resources alive in the captured frame
+	CREATE_BUFFER,
+	CREATE_TEXTURE,
+	CREATE_HEAP,
+	CREATE_TEXTURE_VIEW,
+	CREATE_PROGRAM,
+	UPDATE_BUFFER,
+	UPDATE_TEXTURE,
+	SET_TEXTURE_MIN_LOD,
+
+	// following commands are replayed every frame
+	FRAME,
+	DRAW,
+	USE_PROGRAM,
+	BIND_INDEX_BUFFER,
+	BIND_INDIRECT_BUFFER,
+	BIND_VERTEX_BUFFER,
+	BIND_UNIFORM_BUFFER,
+	BIND_SHADER_BUFFERS,
+	DRAW_ARRAYS,
+	DRAW_INDEXED,
+	DRAW_ARRAYS_INSTANCED,
+	DRAW_INDEXED_INSTANCED,
+	DRAW_INDIRECT,
+	DRAW_ARRAYS_INDIRECT,
+	DISPATCH,
+	SET_FRAMEBUFFER,
+	SET_FRAMEBUFFER_CUBE,
+	VIEWPORT,
+	SCISSOR,
+	CLEAR,
+	MEMORY_BARRIER,
+	MEMORY_BARRIER_TEXTURE,
+	TEXTURE_BARRIER,
+	BUFFER_BARRIER,
+	ALIASING_BARRIER,
+	SET_QUEUE,
+	SYNC_QUEUES,
+	COPY_TEXTURE,
+	COPY_TEXTURE_TO_BUFFER,
+	COPY_BUFFER,
+	PUSH_DEBUG_GROUP,
+	POP_DEBUG_GROUP,
+	BEGIN_PROFILE_BLOCK,
+	END_PROFILE_BLOCK
+};
+
+// Records draw streams, so a single frame can be written to a file and replayed offline by gpu_replay tool.
+// Enabled with -gpu_capture, since then all resources created through draw streams are shadowed on CPU,
+// including their content, so the capture can recreate everything the frame uses.
+// Content written by gpu (render targets, compute output, copies) is not captured.
+struct DrawStreamCapture {
+	static constexpr u32 MAGIC = '_LDC';
+	static constexpr u32 VERSION = 0;
+
+	struct Header {
+		u32 magic = MAGIC;
+		u32 version = VERSION;
+		u32 resources_count = 0;
+		u32 unknown_handles = 0;
+	};
+
+	DrawStreamCapture(IAllocator& allocator);
+	~DrawStreamCapture();
+
+	// the next frame is written to `path`, can be called from any thread
+	void requestCapture(const char* path);
+	// called on render thread before frame's draw streams are recorded, returns true if the frame is captured
+	bool beginFrame();
+	// writes the capture file if the frame is captured
+	void endFrame();
+	bool isCapturingFrame() const { return m_capturing; }
+
+	// buffers created directly with gpu::, e.g. transient buffers, `data` is their current content
+	void externalBuffer(gpu::BufferHandle buffer, gpu::BufferFlags flags, u32 size, const void* data, u32 data_size, const char* name);
+
+	// resource commands, shadowed in every frame
+	void createBuffer(gpu::BufferHandle buffer, gpu::BufferFlags flags, size_t size, const void* data, const char* name);
+	void createTexture(gpu::TextureHandle texture, u32 w, u32 h, u32 depth, gpu::TextureFormat format, gpu::TextureFlags flags, gpu::HeapHandle heap, u64 offset, const char* name);
+	void createHeap(gpu::HeapHandle heap, u64 size, gpu::TextureFlags flags, const char* name);
+	void createTextureView(gpu::TextureHandle view, gpu::TextureHandle texture, u32 layer, u32 mip);
+	void createProgram(gpu::ProgramHandle program, gpu::StateFlags state, const gpu::VertexDecl& decl, const char* src, gpu::ShaderType type, const char* name);
+	void update(gpu::BufferHandle buffer, const void* data, size_t size);
+	void update(gpu::TextureHandle texture, u32 mip, u32 x, u32 y, u32 z, u32 w, u32 h, gpu::TextureFormat format, const void* data, u32 size);
+	void setMinLOD(gpu::TextureHandle texture, u32 mip);
+	void destroy(const void* handle);
+
+	// frame commands, valid only if isCapturingFrame()
+	OutputMemoryStream& frame() { return m_frame; }
+	// id of `handle` in the capture file, 0 if the handle is not known
+	u32 id(const void* handle);
+
+private:
+	enum class ResourceType : u8 {
+		BUFFER,
+		TEXTURE,
+		HEAP,
+		TEXTURE_VIEW,
+		PROGRAM
+	};
+
+	struct TextureUpdate {
+		TextureUpdate(IAllocator& allocator) : data(allocator) {}
+		u32 mip, x, y, z, w, h;
+		gpu::TextureFormat format;
+		Array<u8> data;
+	};
+
+	struct Resource {
+		Resource(IAllocator& allocator) : name(allocator), data(allocator), updates(allocator) {}
+
+		u32 id;
+		ResourceType type;
+		const void* handle;
+		String name;
+		// buffer content or program source
+		Array<u8> data;
+		Array<TextureUpdate> updates;
+		u64 size = 0;
+		u64 offset = 0;
+		u32 w = 0, h = 0, depth = 0;
+		u32 layer = 0, mip = 0;
+		u32 flags = 0;
+		u32 format = 0;
+		u32 min_lod = 0;
+		// replay allocates handles so they get the same bindless indices, shaders read them from uniforms
+		u32 bindless = 0;
+		gpu::StateFlags state = gpu::StateFlags::NONE;
+		gpu::VertexDecl decl = gpu::VertexDecl(gpu::PrimitiveType::NONE);
+		gpu::ShaderType shader_type = gpu::ShaderType::SURFACE;
+		// placed textures - heap, views - texture
+		const void* parent = nullptr;
+		bool external = false;
+	};
+
+	Resource& create(const void* handle, ResourceType type, const char* name);
+	void write(OutputMemoryStream& out, const Resource& res);
+
+	IAllocator& m_allocator;
+	HashMap<const void*, Resource*> m_resources;
+	// destroyed during the captured frame, written to the capture and deleted after it
+	Array<Resource*> m_retired;
+	OutputMemoryStream m_frame;
+	Mutex m_mutex;
+	StaticString<MAX_PATH> m_requested_path;
+	StaticString<MAX_PATH> m_path;
+	u32 m_next_id = 1;
+	u32 m_unknown_handles = 0;
+	bool m_capturing = false;
+};
+
+} // namespace Lumix
@@ -191,17 +191,20 @@ struct FBXImporter : ModelImporter {
 		const u8* positions = unindexed_triangles.getMutableData();
 		u8* normals = unindexed_triangles.getMutableData() + layout.normal_offset;
 
-		for (int i = 0; i < vertex_count; i += 3) {
-			Vec3 v0; memcpy(&v0, positions + i * vertex_size, sizeof(v0));
-			Vec3 v1; memcpy(&v1, positions + (i + 1) * vertex_size, sizeof(v1));
-			Vec3 v2; memcpy(&v2, positions + (i + 2) * vertex_size, sizeof(v2));
-			Vec3 n = normalize(cross(v1 - v0, v2 - v0));
-			u32 npacked = packF4u(n);
-
-			memcpy(normals + i * vertex_size, &npacked, sizeof(npacked));
-			memcpy(normals + (i + 1) * vertex_size, &npacked, sizeof(npacked));
-			memcpy(normals + (i + 2) * vertex_size, &npacked, sizeof(npacked));
-		}
+		// triangles are independent, so big meshes are split to ranges of triangles
+		jobs::forEach(vertex_count / 3, 4096, [&](i32 from, i32 to){
+			for (int i = from * 3; i < to * 3; i += 3) {
+				Vec3 v0; memcpy(&v0, positions + i * vertex_size, sizeof(v0));
+				Vec3 v1; memcpy(&v1, positions + (i + 1) * vertex_size, sizeof(v1));
+				Vec3 v2; memcpy(&v2, positions + (i + 2) * vertex_size, sizeof(v2));
+				Vec3 n = normalize(cross(v1 - v0, v2 - v0));
+				u32 npacked = packF4u(n);
+
+				memcpy(normals + i * vertex_size, &npacked, sizeof(npacked));
+				memcpy(normals + (i + 1) * vertex_size, &npacked, sizeof(npacked));
+				memcpy(normals + (i + 2) * vertex_size, &npacked, sizeof(npacked));
+			}
+		});
 	}
 
 	static void computeTangents(OutputMemoryStream& unindexed_triangles, const VertexLayout& layout, const Path& path) {
@@ -286,35 +289,37 @@ struct FBXImporter : ModelImporter {
 		const u8* uvs = unindexed_triangles.data() + layout.uv_offset;
 		u8* tangents = unindexed_triangles.getMutableData() + layout.tangent_offset;
 
-		for (int i = 0; i < vertex_count; i += 3) {
-			Vec3 v0; memcpy(&v0, positions + i * vertex_size, sizeof(v0));
-			Vec3 v1; memcpy(&v1, positions + (i + 1) * vertex_size, sizeof(v1));
-			Vec3 v2; memcpy(&v2, positions + (i + 2) * vertex_size, sizeof(v2));
-			Vec2 uv0; memcpy(&uv0, uvs + i * vertex_size, sizeof(uv0));
-			Vec2 uv1; memcpy(&uv1, uvs + (i + 1) * vertex_size, sizeof(uv1));
-			Vec2 uv2; memcpy(&uv2, uvs + (i + 2) * vertex_size, sizeof(uv2));
-
-			const Vec3 dv10 = v1 - v0;
-			const Vec3 dv20 = v2 - v0;
-			const Vec2 duv10 = uv1 - uv0;
-			const Vec2 duv20 = uv2 - uv0;
-
-			const float dir = duv20.x * duv10.y - duv20.y * duv10.x < 0 ? -1.f : 1.f;
-			Vec3 tangent; 
-			tangent.x = (dv20.x * duv10.y - dv10.x * duv20.y) * dir;
-			tangent.y = (dv20.y * duv10.y - dv10.y * duv20.y) * dir;
-			tangent.z = (dv20.z * duv10.y - dv10.z * duv20.y) * dir;
-			const float l = 1 / sqrtf(float(tangent.x * tangent.x + tangent.y * tangent.y + tangent.z * tangent.z));
-			tangent.x *= l;
-			tangent.y *= l;
-			tangent.z *= l;
+		jobs::forEach(vertex_count / 3, 4096, [&](i32 from, i32 to){
+			for (int i = from * 3; i < to * 3; i += 3) {
+				Vec3 v0; memcpy(&v0, positions + i * vertex_size, sizeof(v0));
+				Vec3 v1; memcpy(&v1, positions + (i + 1) * vertex_size, sizeof(v1));
+				Vec3 v2; memcpy(&v2, positions + (i + 2) * vertex_size, sizeof(v2));
+				Vec2 uv0; memcpy(&uv0, uvs + i * vertex_size, sizeof(uv0));
+				Vec2 uv1; memcpy(&uv1, uvs + (i + 1) * vertex_size, sizeof(uv1));
+				Vec2 uv2; memcpy(&uv2, uvs + (i + 2) * vertex_size, sizeof(uv2));
+
+				const Vec3 dv10 = v1 - v0;
+				const Vec3 dv20 = v2 - v0;
+				const Vec2 duv10 = uv1 - uv0;
+				const Vec2 duv20 = uv2 - uv0;
+
+				const float dir = duv20.x * duv10.y - duv20.y * duv10.x < 0 ? -1.f : 1.f;
+				Vec3 tangent; 
+				tangent.x = (dv20.x * duv10.y - dv10.x * duv20.y) * dir;
+				tangent.y = (dv20.y * duv10.y - dv10.y * duv20.y) * dir;
+				tangent.z = (dv20.z * duv10.y - dv10.z * duv20.y) * dir;
+				const float l = 1 / sqrtf(float(tangent.x * tangent.x + tangent.y * tangent.y + tangent.z * tangent.z));
+				tangent.x *= l;
+				tangent.y *= l;
+				tangent.z *= l;
 			
-			u32 tangent_packed = packF4u(tangent);
+				u32 tangent_packed = packF4u(tangent);
 
-			memcpy(tangents + i * vertex_size, &tangent_packed, sizeof(tangent_packed));
-			memcpy(tangents + (i + 1) * vertex_size, &tangent_packed, sizeof(tangent_packed));
-			memcpy(tangents + (i + 2) * vertex_size, &tangent_packed, sizeof(tangent_packed));
-		}
+				memcpy(tangents + i * vertex_size, &tangent_packed, sizeof(tangent_packed));
+				memcpy(tangents + (i + 1) * vertex_size, &tangent_packed, sizeof(tangent_packed));
+				memcpy(tangents + (i + 2) * vertex_size, &tangent_packed, sizeof(tangent_packed));
+			}
+		});
 	}
 
 	static void remap(const OutputMemoryStream& unindexed_triangles, ImportGeometry& mesh) {
@@ -308,7 +308,12 @@ void GameView::windowUI(const char* window_name) {
 				vp.rot = Quat(0, 0, 0, 1);
 			}
 			m_pipeline->setViewport(vp);
-			m_pipeline->render(false);
+			const bool focused = ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows) || ImGui::IsWindowHovered(ImGuiHoveredFlags_RootAndChildWindows);
+			const bool render = editor.isGameMode()
+				? m_throttle.shouldRender(focused)
+				: m_throttle.shouldRender(ViewThrottle::getWorldViewState(vp, editor), focused);
+			if (render) m_pipeline->render(false);
+			else m_pipeline->skipRender();
 			const gpu::TextureHandle texture_handle = m_pipeline->getOutput();
 			
 			controlsGUI(editor);
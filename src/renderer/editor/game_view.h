@@ -2,6 +2,7 @@
 
 #include "editor/studio_app.h"
 #include "editor/action.h"
+#include "editor/utils.h"
 #include "core/allocator.h"
 #include "core/math.h"
 #include "core/os.h"
@@ -57,6 +58,7 @@ private:
 	bool m_is_ingame_cursor;
 	bool m_is_fullscreen;
 	bool m_was_game_mode = false;
+	ViewThrottle m_throttle;
 	bool m_focus_on_game_start = false;
 	os::CursorType m_cursor_type = os::CursorType::DEFAULT;
 	struct
@@ -62,77 +62,111 @@ struct BitWriter {
 	u8* ptr;
 };
 
-struct TranslationTrack {
-	Vec3 min, max;
-	u8 bitsizes[4] = {};
-	bool is_const = false;
-};
-
-struct RotationTrack {
-	Quat min, max;
-	u8 bitsizes[4];
-	bool is_const;
-	u8 skipped_channel;
-};
+// encodes animated tracks into Animation::SEGMENT_FRAMES long segments, see Animation::SegmentTrack
+struct SegmentEncoder {
+	struct PackedKey {
+		u64 value;
+		u32 bitsize;
+	};
 
-u64 pack(float v, float min, float range, u32 bitsize) {
-	double normalized = double(v - min) / range;
-	return u64(normalized * double((1 << bitsize) - 1) + 0.5f);
-}
+	SegmentEncoder(IAllocator& allocator)
+		: headers(allocator)
+		, keys(allocator)
+	{}
 
-u64 pack(const Quat& r, const RotationTrack& track) {
-	u64 res = 0;
-	if (track.skipped_channel != 3) {
-		res |= pack(r.w, track.min.w, track.max.w - track.min.w, track.bitsizes[3]);
-	}
-	
-	if (track.skipped_channel != 2) {
-		res <<= track.bitsizes[2];
-		res |= pack(r.z, track.min.z, track.max.z - track.min.z, track.bitsizes[2]);
-	}
-
-	if (track.skipped_channel != 1) {
-		res <<= track.bitsizes[1];
-		res |= pack(r.y, track.min.y, track.max.y - track.min.y, track.bitsizes[1]);
+	static float normalize(float v, float min, float range) {
+		return range > 0 ? (v - min) / range : 0;
 	}
 
-	if (track.skipped_channel != 0) {
-		res <<= track.bitsizes[0];
-		res |= pack(r.x, track.min.x, track.max.x - track.min.x, track.bitsizes[0]);
+	// finds the longest key stride where linear interpolation of keys is still within `max_error`
+	template <typename T, typename F>
+	static u8 findStride(const T* values, u32 segment_length, float max_error, F interpolated_error) {
+		for (u8 stride_log2 = 4; stride_log2 > 0; --stride_log2) {
+			const u32 stride = 1 << stride_log2;
+			bool valid = true;
+			for (u32 f = 0; f <= segment_length && valid; ++f) {
+				const u32 key_frame = f & ~(stride - 1);
+				if (key_frame == f) continue;
+				const u32 next_key_frame = minimum(key_frame + stride, segment_length);
+				const float t = float(f - key_frame) / float(next_key_frame - key_frame);
+				valid = interpolated_error(values[key_frame], values[next_key_frame], t, values[f]) <= max_error;
+			}
+			if (valid) return stride_log2;
+		}
+		return 0;
 	}
-	return res;
-}
-
-u64 pack(const Vec3& p, const TranslationTrack& track) {
-	u64 res = 0;
-	res |= pack(p.z, track.min.z, track.max.z - track.min.z, track.bitsizes[2]);
-	res <<= track.bitsizes[1];
-
-	res |= pack(p.y, track.min.y, track.max.y - track.min.y, track.bitsizes[1]);
-	res <<= track.bitsizes[0];
 
-	res |= pack(p.x, track.min.x, track.max.x - track.min.x, track.bitsizes[0]);
-	return res;
-}
-
-bool clampBitsizes(Span<u8> values) {
-	u32 total = 0;
-	for (u8 v : values) total += v;
-	if (total > 64) {
-		u32 over = total - 64;
-		u32 i =  0;
-		while (over) {
-			if (values[i] > 0) {
-				--values[i];
-				--over;
+	// `channels` - 3 stored channels of each frame in segment, `signs` - optional sign bit of each frame
+	void encode(const Vec3* channels, const bool* signs, u32 segment_length, u8 stride_log2, const Vec3& min, const Vec3& range, float max_error) {
+		const u32 stride = 1 << stride_log2;
+		const u32 keys_count = (segment_length + stride - 1) / stride + 1;
+		auto key_frame = [&](u32 key) { return minimum(key * stride, segment_length); };
+
+		u8 header[10];
+		u8* range_min = header;
+		u8* range_extent = header + 3;
+		u8* bitsizes = header + 6;
+		header[9] = stride_log2;
+
+		for (u32 c = 0; c < 3; ++c) {
+			float nmin = FLT_MAX, nmax = -FLT_MAX;
+			for (u32 k = 0; k < keys_count; ++k) {
+				const float n = normalize((&channels[key_frame(k)].x)[c], (&min.x)[c], (&range.x)[c]);
+				nmin = minimum(nmin, n);
+				nmax = maximum(nmax, n);
 			}
-			i = (i + 1) % values.length();
+			const u32 rmin = minimum(u32(clamp(nmin, 0.f, 1.f) * 255), 254u);
+			const u32 rmax = clamp(u32(ceilf(clamp(nmax, 0.f, 1.f) * 255)), rmin + 1, 255u);
+			range_min[c] = u8(rmin);
+			range_extent[c] = u8(rmax - rmin);
+
+			// half of the error budget is for quantization, the other half for key reduction
+			const float channel_range = (&range.x)[c];
+			if ((nmax - rmin / 255.f) * channel_range <= max_error * 0.5f) {
+				bitsizes[c] = 0;
+				continue;
+			}
+			const float span = channel_range * range_extent[c] / 255.f;
+			u32 bitsize = 1;
+			while (bitsize < Animation::MAX_CHANNEL_BITS && span / float((1 << bitsize) - 1) > max_error) ++bitsize;
+			bitsizes[c] = u8(bitsize);
+		}
+		headers.write(header, sizeof(header));
+
+		for (u32 k = 0; k < keys_count; ++k) {
+			const u32 f = key_frame(k);
+			PackedKey& key = keys.emplace();
+			key.value = 0;
+			key.bitsize = 0;
+			if (signs) {
+				key.value = signs[f] ? 1 : 0;
+				key.bitsize = 1;
+			}
+			for (u32 c = 0; c < 3; ++c) {
+				if (bitsizes[c] == 0) continue;
+				const u64 mask = (u64(1) << bitsizes[c]) - 1;
+				const float n = normalize((&channels[f].x)[c], (&min.x)[c], (&range.x)[c]);
+				const float seg_n = (n * 255 - range_min[c]) / range_extent[c];
+				const u64 q = u64(clamp(seg_n, 0.f, 1.f) * mask + 0.5f);
+				key.value |= minimum(q, mask) << key.bitsize;
+				key.bitsize += bitsizes[c];
+			}
+			ASSERT(key.bitsize <= 57);
 		}
-		
-		return true;
 	}
-	return false;
-}
+
+	void write(OutputMemoryStream& blob) const {
+		blob.write(headers.data(), headers.size());
+		u32 total_bits = 0;
+		for (const PackedKey& k : keys) total_bits += k.bitsize;
+		blob.write(total_bits);
+		BitWriter bit_writer(blob, total_bits);
+		for (const PackedKey& k : keys) bit_writer.write(k.value, k.bitsize);
+	}
+
+	OutputMemoryStream headers;
+	Array<PackedKey> keys;
+};
 
 } // anonymous namespace
 
@@ -180,6 +214,66 @@ static bool hasAutoLOD(const ModelMeta& meta, u32 idx) {
 	return meta.autolod_mask & (1 << idx);
 }
 
+// reorders indices so each meshlet is a contiguous range, returns number of indices in each meshlet
+static void buildMeshlets(Array<u32>& indices, Local<Array<u32>>& meshlets, const OutputMemoryStream& vertices, u32 vertex_size, IAllocator& allocator) {
+	PROFILE_FUNCTION();
+	const u32 MAX_VERTICES = 64;
+	const u32 MAX_TRIANGLES = 124;
+	const u32 max_meshlets = (u32)meshopt_buildMeshletsBound(indices.size(), MAX_VERTICES, MAX_TRIANGLES);
+	Array<meshopt_Meshlet> tmp_meshlets(allocator);
+	Array<u32> meshlet_vertices(allocator);
+	Array<u8> meshlet_triangles(allocator);
+	tmp_meshlets.resize(max_meshlets);
+	meshlet_vertices.resize(max_meshlets * MAX_VERTICES);
+	meshlet_triangles.resize(max_meshlets * MAX_TRIANGLES * 3);
+
+	const u32 meshlet_count = (u32)meshopt_buildMeshlets(tmp_meshlets.begin()
+		, meshlet_vertices.begin()
+		, meshlet_triangles.begin()
+		, indices.begin()
+		, indices.size()
+		, (const float*)vertices.data()
+		, u32(vertices.size() / vertex_size)
+		, vertex_size
+		, MAX_VERTICES
+		, MAX_TRIANGLES
+		, 0.25f);
+
+	meshlets.create(allocator);
+	meshlets->reserve(meshlet_count);
+	u32 idx = 0;
+	for (u32 i = 0; i < meshlet_count; ++i) {
+		const meshopt_Meshlet& m = tmp_meshlets[i];
+		for (u32 j = 0; j < m.triangle_count * 3; ++j) {
+			indices[idx] = meshlet_vertices[m.vertex_offset + meshlet_triangles[m.triangle_offset + j]];
+			++idx;
+		}
+		meshlets->push(m.triangle_count * 3);
+	}
+	ASSERT(idx == indices.size());
+}
+
+// reorders triangles for post-transform vertex cache and overdraw, then vertices in order of first use
+// must run before anything that stores vertex or triangle order, such as autolods and meshlets
+static void optimizeGeometry(ModelImporter::ImportGeometry& geom, IAllocator& allocator) {
+	if (geom.indices.empty()) return;
+	PROFILE_FUNCTION();
+	profiler::pushInt("Triangle count", geom.indices.size() / 3);
+
+	u32* indices = geom.indices.begin();
+	const u32 index_count = geom.indices.size();
+	const u32 vertex_count = u32(geom.vertex_buffer.size() / geom.vertex_size);
+	meshopt_optimizeVertexCache(indices, indices, index_count, vertex_count);
+	// position is always the first attribute
+	meshopt_optimizeOverdraw(indices, indices, index_count, (const float*)geom.vertex_buffer.data(), vertex_count, geom.vertex_size, 1.05f);
+
+	OutputMemoryStream tmp(allocator);
+	tmp.resize(geom.vertex_buffer.size());
+	const size_t used_vertex_count = meshopt_optimizeVertexFetch(tmp.getMutableData(), indices, index_count, geom.vertex_buffer.data(), vertex_count, geom.vertex_size);
+	memcpy(geom.vertex_buffer.getMutableData(), tmp.data(), used_vertex_count * geom.vertex_size);
+	geom.vertex_buffer.resize(used_vertex_count * geom.vertex_size);
+}
+
 static bool areIndices16Bit(const ModelImporter::ImportGeometry& mesh) {
 	int vertex_size = mesh.vertex_size;
 	return mesh.vertex_buffer.size() / vertex_size < (1 << 16);
@@ -229,6 +323,7 @@ ModelImporter::ModelImporter(struct StudioApp& app)
 	, m_allocator(app.getAllocator())
 	, m_materials(app.getAllocator())
 	, m_out_file(app.getAllocator())
+	, m_meshlets(app.getAllocator())
 	, m_bones(app.getAllocator())
 	, m_meshes(app.getAllocator())
 	, m_animations(app.getAllocator())
@@ -317,34 +412,68 @@ void ModelImporter::postprocessCommon(const ModelMeta& meta, StringView src_file
 		}
 	}
 	
-	jobs::forEach(m_meshes.size(), 1, [&](i32 mesh_idx, i32){
-		// TODO this can process the same geom multiple times
-
-		PROFILE_FUNCTION();
-		ImportMesh& mesh = m_meshes[mesh_idx];
-		ImportGeometry& geom = m_geometries[mesh.geometry_idx];
+	jobs::forEach(m_geometries.size(), 1, [&](i32 geom_idx, i32){
+		optimizeGeometry(m_geometries[geom_idx], m_allocator);
+	});
 
+	// every (geometry, lod) pair is a separate item, so a single big mesh still runs its lods in parallel
+	struct LODItem {
+		i32 geom_idx;
+		u32 lod;
+	};
+	Array<LODItem> lod_items(m_allocator);
+	Array<bool> has_lods(m_allocator);
+	has_lods.resize(m_geometries.size());
+	for (bool& b : has_lods) b = false;
+	for (const ImportMesh& mesh : m_meshes) {
+		if (mesh.lod != 0 || has_lods[mesh.geometry_idx]) continue;
+		has_lods[mesh.geometry_idx] = true;
 		for (u32 i = 0; i < meta.lod_count; ++i) {
 			if ((meta.autolod_mask & (1 << i)) == 0) continue;
-			if (mesh.lod != 0) continue;
-			
-			geom.autolod_indices[i].create(m_allocator);
-			geom.autolod_indices[i]->resize(geom.indices.size());
-			const size_t lod_index_count = meshopt_simplifySloppy(geom.autolod_indices[i]->begin()
-				, geom.indices.begin()
-				, geom.indices.size()
-				, (const float*)geom.vertex_buffer.data()
-				, u32(geom.vertex_buffer.size() / geom.vertex_size)
-				, geom.vertex_size
-				, size_t(geom.indices.size() * meta.autolod_coefs[i])
-				, 0.5f
-				);
-			geom.autolod_indices[i]->resize((u32)lod_index_count);
+			lod_items.push({mesh.geometry_idx, i});
 		}
+	}
+
+	jobs::forEach(lod_items.size(), 1, [&](i32 item_idx, i32){
+		PROFILE_BLOCK("autolod");
+		const LODItem& item = lod_items[item_idx];
+		ImportGeometry& geom = m_geometries[item.geom_idx];
+		const u32 vertex_count = u32(geom.vertex_buffer.size() / geom.vertex_size);
+		Local<Array<u32>>& lod_indices = geom.autolod_indices[item.lod];
+
+		lod_indices.create(m_allocator);
+		lod_indices->resize(geom.indices.size());
+		const size_t lod_index_count = meshopt_simplifySloppy(lod_indices->begin()
+			, geom.indices.begin()
+			, geom.indices.size()
+			, (const float*)geom.vertex_buffer.data()
+			, vertex_count
+			, geom.vertex_size
+			, size_t(geom.indices.size() * meta.autolod_coefs[item.lod])
+			, 0.5f
+			);
+		lod_indices->resize((u32)lod_index_count);
+		meshopt_optimizeVertexCache(lod_indices->begin(), lod_indices->begin(), lod_indices->size(), vertex_count);
 	});
 
+	if (meta.build_meshlets) {
+		// base indices and up to 4 autolods per geometry
+		jobs::forEach(m_geometries.size() * 5, 1, [&](i32 item_idx, i32){
+			ImportGeometry& geom = m_geometries[item_idx / 5];
+			const u32 lod = item_idx % 5;
+			if (lod == 0) {
+				buildMeshlets(geom.indices, geom.meshlets, geom.vertex_buffer, geom.vertex_size, m_allocator);
+			}
+			else if (geom.autolod_indices[lod - 1].get()) {
+				buildMeshlets(*geom.autolod_indices[lod - 1], geom.autolod_meshlets[lod - 1], geom.vertex_buffer, geom.vertex_size, m_allocator);
+			}
+		});
+	}
+
 	// TODO check this
 	if (meta.bake_vertex_ao) bakeVertexAO(meta.min_bake_vertex_ao);
+	// must be last, everything above expects uncompressed vertices
+	if (meta.compress_vertices) compressVertices();
 
 	u32 mesh_data_size = 0;
 	for (const ImportGeometry& g : m_geometries) {
@@ -374,6 +503,7 @@ bool ModelImporter::writeSubmodels(const Path& src, const ModelMeta& meta) {
 		write(lod_count);
 		write(to_mesh);
 		write(factor);
+		write(m_meshlets.data(), m_meshlets.size());
 
 		Path path(m_geometries[i].name, ".fbx:", src);
 
@@ -462,8 +592,6 @@ void ModelImporter::createImpostorTextures(Model* model, ImpostorTexturesContext
 				Vec3 up = Vec3(0, 1, 0);
 				if (col == IMPOSTOR_COLS >> 1 && j == IMPOSTOR_COLS >> 1) up = Vec3(1, 0, 0);
 				model_mtx.lookAt(center - v * 1.01f * radius, center, up);
-				const Renderer::TransientSlice ub = renderer->allocUniform(&model_mtx, sizeof(model_mtx));
-				stream.bindUniformBuffer(UniformBuffer::DRAWCALL, ub.buffer, ub.offset, ub.size);
 
 				for (u32 i = 0; i <= (u32)model->getLODIndices()[0].to; ++i) {
 					const MeshMaterial& mesh_mat = model->getMeshMaterial(i);
@@ -473,9 +601,15 @@ void ModelImporter::createImpostorTextures(Model* model, ImpostorTexturesContext
 					const gpu::StateFlags state = gpu::StateFlags::DEPTH_FN_GREATER | gpu::StateFlags::DEPTH_WRITE | material->m_render_states;
 					const gpu::ProgramHandle program = shader->getProgram(state, mesh.vertex_decl, capture_define | material->getDefineMask(), mesh.semantics_defines);
 
-					ASSERT(false);
-					// TODO
-					// material->bind(stream);
+					struct {
+						Matrix mtx;
+						MaterialIndex material_index;
+					} ub_data = {
+						model_mtx,
+						material->getIndex()
+					};
+					const Renderer::TransientSlice ub = renderer->allocUniform(&ub_data, sizeof(ub_data));
+					stream.bindUniformBuffer(UniformBuffer::DRAWCALL, ub.buffer, ub.offset, ub.size);
 					stream.useProgram(program);
 					stream.bindIndexBuffer(mesh.index_buffer_handle);
 					stream.bindVertexBuffer(0, mesh.vertex_buffer_handle, 0, mesh.vb_stride);
@@ -775,6 +909,9 @@ void ModelImporter::writeGeometry(u32 geom_idx) {
 	write((i32)geom.vertex_buffer.size());
 	write(geom.vertex_buffer.data(), geom.vertex_buffer.size());
 
+	m_meshlets.clear();
+	writeMeshlets(geom.indices, geom.meshlets.get(), geom.vertex_buffer.data(), vertex_count, vertex_size);
+
 	write(sqrtf(origin_radius_squared));
 	write(sqrtf(center_radius_squared));
 	write(aabb);
@@ -1021,6 +1158,7 @@ void ModelImporter::writeGeometry(const ModelMeta& meta) {
 		center_xz0 = Vec3(0, center.y, 0);
 	}
 
+	m_meshlets.clear();
 	const u8* out = m_out_file.getMutableData() + output_vertex_data_offset;
 	for (u32 lod = 0; lod < meta.lod_count - (meta.create_impostor ? 1 : 0); ++lod) {
 		for (const ImportMesh& import_mesh : m_meshes) {
@@ -1030,6 +1168,13 @@ void ModelImporter::writeGeometry(const ModelMeta& meta) {
 			const u32 vertex_size = geom.vertex_size;
 			const u32 vertex_count = u32(geom.vertex_buffer.size() / geom.vertex_size);
 			out += sizeof(i32);
+
+			if (import_mesh.lod == lod && !hasAutoLOD(meta, lod)) {
+				writeMeshlets(geom.indices, geom.meshlets.get(), out, vertex_count, vertex_size);
+			}
+			else {
+				writeMeshlets(*geom.autolod_indices[lod].get(), geom.autolod_meshlets[lod].get(), out, vertex_count, vertex_size);
+			}
 			
 			for (u32 i = 0; i < vertex_count; ++i) {
 				Vec3 p;
@@ -1047,6 +1192,7 @@ void ModelImporter::writeGeometry(const ModelMeta& meta) {
 		}
 	}
 	bounding_cylinder.x = sqrtf(bounding_cylinder.x);
+	if (meta.create_impostor) m_meshlets.write((u32)0);
 
 	if (meta.create_impostor) writeImpostorVertices((aabb.max.y + aabb.min.y) * 0.5f, bounding_cylinder);
 
@@ -1065,6 +1211,29 @@ void ModelImporter::writeGeometry(const ModelMeta& meta) {
 }
 
 
+void ModelImporter::writeMeshlets(const Array<u32>& indices, const Array<u32>* meshlets, const u8* vertices, u32 vertex_count, u32 vertex_size) {
+	if (!meshlets) {
+		m_meshlets.write((u32)0);
+		return;
+	}
+
+	m_meshlets.write(meshlets->size());
+	u32 offset = 0;
+	for (u32 count : *meshlets) {
+		const meshopt_Bounds bounds = meshopt_computeClusterBounds(&indices[offset], count, (const float*)vertices, vertex_count, vertex_size);
+		Meshlet meshlet;
+		meshlet.center = Vec3(bounds.center[0], bounds.center[1], bounds.center[2]);
+		meshlet.radius = bounds.radius;
+		meshlet.cone_apex = Vec3(bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2]);
+		meshlet.cone_cutoff = bounds.cone_cutoff;
+		meshlet.cone_axis = Vec3(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]);
+		meshlet.indices_offset = offset;
+		meshlet.indices_count = count;
+		m_meshlets.write(meshlet);
+		offset += count;
+	}
+}
+
 void ModelImporter::writeImpostorMesh(StringView dir, StringView model_name)
 {
 	const i32 attribute_count = 2;
@@ -1236,6 +1405,7 @@ void ModelImporter::bakeVertexAO(float min_ao) {
 
 	Voxels voxels(m_allocator);
 	voxels.beginRaster(aabb, 64);
+	Array<Vec3> triangles(m_allocator);
 	for (ImportMesh& mesh : m_meshes) {
 		const ImportGeometry& geom = m_geometries[mesh.geometry_idx];
 		const u8* positions = geom.vertex_buffer.data();
@@ -1243,17 +1413,26 @@ void ModelImporter::bakeVertexAO(float min_ao) {
 		const i32 count = geom.indices.size();
 		const u32* indices = geom.indices.data();
 
-		for (i32 i = 0; i < count; i += 3) {
-			Vec3 p[3];
-			memcpy(&p[0], positions + indices[i + 0] * vertex_size, sizeof(p[0]));
-			memcpy(&p[1], positions + indices[i + 1] * vertex_size, sizeof(p[1]));
-			memcpy(&p[2], positions + indices[i + 2] * vertex_size, sizeof(p[2]));
-			voxels.raster(p[0], p[1], p[2]);
+		for (i32 i = 0; i < count; ++i) {
+			memcpy(&triangles.emplace(), positions + indices[i] * vertex_size, sizeof(Vec3));
 		}
 	}
-	voxels.computeAO(32);
+
+	// throughput is visible in profiler, so regressions are easy to spot
+	os::Timer timer;
+	voxels.raster(triangles);
+	const float raster_time = timer.tick();
+	const u32 ray_count = 32;
+	voxels.computeAO(ray_count);
+	const float ao_time = timer.tick();
 	voxels.blurAO();
 
+	static u32 raster_counter = profiler::createCounter("Vertex AO raster (K triangles/s)", 0);
+	static u32 rays_counter = profiler::createCounter("Vertex AO rays (M rays/s)", 0);
+	const IVec3 res = voxels.m_grid_resolution;
+	profiler::pushCounter(raster_counter, triangles.size() / 3 / maximum(raster_time, 1e-6f) / 1000.f);
+	profiler::pushCounter(rays_counter, float(double(res.x) * res.y * res.z * ray_count / maximum(ao_time, 1e-6f) / 1e6));
+
 	for (ImportMesh& mesh : m_meshes) {
 		ImportGeometry& geom = m_geometries[mesh.geometry_idx];
 		const u8* positions = geom.vertex_buffer.data();
@@ -1267,20 +1446,103 @@ void ModelImporter::bakeVertexAO(float min_ao) {
 		const i32 vertex_size = geom.vertex_size;
 		const i32 vertex_count = i32(geom.vertex_buffer.size() / vertex_size);
 
-		for (i32 i = 0; i < vertex_count; ++i) {
-			Vec3 p;
-			memcpy(&p, positions + i * vertex_size, sizeof(p));
-			float ao;
-			bool res = voxels.sampleAO(p, &ao);
-			ASSERT(res);
-			if (res) {
-				const u8 ao8 = u8(clamp((ao + min_ao) * 255, 0.f, 255.f) + 0.5f);
-				memcpy(AOs + i * vertex_size, &ao8, sizeof(ao8));
+		jobs::forEach(vertex_count, 4096, [&](i32 from, i32 to){
+			PROFILE_BLOCK("sample AO");
+			for (i32 i = from; i < to; ++i) {
+				Vec3 p;
+				memcpy(&p, positions + i * vertex_size, sizeof(p));
+				float ao;
+				bool res = voxels.sampleAO(p, &ao);
+				ASSERT(res);
+				if (res) {
+					const u8 ao8 = u8(clamp((ao + min_ao) * 255, 0.f, 255.f) + 0.5f);
+					memcpy(AOs + i * vertex_size, &ao8, sizeof(ao8));
+				}
 			}
-		}
+		});
 	}
 }
 
+// UV0 float2 -> half2, weights float4 -> unorm8x4
+// positions stay float, so bounds, physics and meshlets work on compressed geometry as is
+void ModelImporter::compressVertices() {
+	PROFILE_FUNCTION();
+	jobs::forEach(m_geometries.size(), 1, [&](i32 geom_idx, i32){
+		ImportGeometry& geom = m_geometries[geom_idx];
+		const u32 vertex_count = u32(geom.vertex_buffer.size() / geom.vertex_size);
+
+		Array<AttributeDesc> attributes(m_allocator);
+		u32 vertex_size = 0;
+		bool any_compressed = false;
+		for (const AttributeDesc& desc : geom.attributes) {
+			AttributeDesc& out = attributes.emplace(desc);
+			if (desc.type == gpu::AttributeType::FLOAT) {
+				if (desc.semantic == AttributeSemantic::TEXCOORD0) {
+					out.type = gpu::AttributeType::F16;
+					any_compressed = true;
+				}
+				else if (desc.semantic == AttributeSemantic::WEIGHTS && desc.num_components == 4) {
+					out.type = gpu::AttributeType::U8;
+					any_compressed = true;
+				}
+			}
+			vertex_size += gpu::getSize(out.type) * out.num_components;
+		}
+		if (!any_compressed) return;
+
+		OutputMemoryStream vertices(m_allocator);
+		vertices.resize(vertex_count * vertex_size);
+		const u8* src = geom.vertex_buffer.data();
+		u8* dst = vertices.getMutableData();
+		for (u32 i = 0; i < vertex_count; ++i) {
+			for (i32 j = 0; j < geom.attributes.size(); ++j) {
+				const AttributeDesc& in_desc = geom.attributes[j];
+				const AttributeDesc& out_desc = attributes[j];
+				const u32 in_size = gpu::getSize(in_desc.type) * in_desc.num_components;
+				const u32 out_size = gpu::getSize(out_desc.type) * out_desc.num_components;
+				if (in_desc.type == out_desc.type) {
+					memcpy(dst, src, in_size);
+				}
+				else if (out_desc.type == gpu::AttributeType::F16) {
+					for (u32 k = 0; k < in_desc.num_components; ++k) {
+						float f;
+						memcpy(&f, src + k * sizeof(f), sizeof(f));
+						const u16 h = meshopt_quantizeHalf(f);
+						memcpy(dst + k * sizeof(h), &h, sizeof(h));
+					}
+				}
+				else {
+					// round so that weights still sum to 255
+					Vec4 w;
+					memcpy(&w, src, sizeof(w));
+					const float sum = w.x + w.y + w.z + w.w;
+					if (sum > 0) w = w * (255 / sum);
+					u8 q[4];
+					i32 total = 0;
+					for (u32 k = 0; k < 4; ++k) {
+						q[k] = u8(clamp(w[k] + 0.5f, 0.f, 255.f));
+						total += q[k];
+					}
+					if (sum > 0 && total != 255) {
+						u32 max_k = 0;
+						for (u32 k = 1; k < 4; ++k) {
+							if (q[k] > q[max_k]) max_k = k;
+						}
+						q[max_k] = u8(clamp(q[max_k] + 255 - total, 0, 255));
+					}
+					memcpy(dst, q, sizeof(q));
+				}
+				src += in_size;
+				dst += out_size;
+			}
+		}
+
+		geom.vertex_buffer = static_cast<OutputMemoryStream&&>(vertices);
+		geom.attributes = static_cast<Array<AttributeDesc>&&>(attributes);
+		geom.vertex_size = vertex_size;
+	});
+}
+
 void ModelImporter::writeModelHeader()
 {
 	Model::FileHeader header;
@@ -1289,6 +1551,38 @@ void ModelImporter::writeModelHeader()
 	write(header);
 }
 
+// bump if cooking params change
+static constexpr u32 COOKING_CACHE_VERSION = 0;
+
+// cooked meshes are cached by their content, so reimport does not cook unchanged meshes again
+// appends cooked data to `blob`
+static bool cookMesh(PhysicsSystem& ps
+	, AssetCompiler& compiler
+	, bool convex
+	, Span<const Vec3> verts
+	, Span<const u32> indices
+	, OutputMemoryStream& blob
+	, IAllocator& allocator)
+{
+	PROFILE_FUNCTION();
+	RollingStableHasher hasher;
+	hasher.begin();
+	const u32 versions[] = { COOKING_CACHE_VERSION, (u32)PhysicsGeometry::Versions::LAST, (u32)convex };
+	hasher.update(versions, sizeof(versions));
+	hasher.update(verts.begin(), verts.length() * sizeof(verts[0]));
+	if (!convex) hasher.update(indices.begin(), indices.length() * sizeof(indices[0]));
+	const StableHash key = hasher.end64();
+	if (compiler.getCachedBlob(key, blob)) return true;
+
+	OutputMemoryStream cooked(allocator);
+	const bool res = convex ? ps.cookConvex(verts, cooked) : ps.cookTriMesh(verts, indices, cooked);
+	if (!res) return false;
+
+	compiler.cacheBlob(key, cooked);
+	blob.write(cooked.data(), cooked.size());
+	return true;
+}
+
 bool ModelImporter::writePhysics(const Path& src, const ModelMeta& meta) {
 	PhysicsSystem* ps = (PhysicsSystem*)m_app.getEngine().getSystemManager().getSystem("physics");
 	if (!ps) return true;
@@ -1296,48 +1590,48 @@ bool ModelImporter::writePhysics(const Path& src, const ModelMeta& meta) {
 	if (m_meshes.empty()) return true;
 	if (meta.physics == ModelMeta::Physics::NONE) return true;
 
-	Array<Vec3> verts(m_allocator);
 	PhysicsGeometry::Header header;
 	header.m_magic = PhysicsGeometry::HEADER_MAGIC;
 	header.m_version = (u32)PhysicsGeometry::Versions::LAST;
 	const bool to_convex = meta.physics == ModelMeta::Physics::CONVEX;
 	header.m_convex = (u32)to_convex;
+	AssetCompiler& compiler = m_app.getAssetCompiler();
 
 	if (meta.split) {
-		for (const ImportMesh& mesh : m_meshes) {
-			const ImportGeometry& geom = m_geometries[mesh.geometry_idx];
-			m_out_file.clear();
-			m_out_file.write(&header, sizeof(header));
-
-			verts.clear();
-			int vertex_size = geom.vertex_size;
-			int vertex_count = (i32)(geom.vertex_buffer.size() / vertex_size);
+		// meshes are cooked in parallel, failed ones have empty blob
+		Array<OutputMemoryStream> blobs(m_allocator);
+		blobs.reserve(m_meshes.size());
+		for (i32 i = 0; i < m_meshes.size(); ++i) blobs.emplace(m_allocator);
 
+		jobs::forEach(m_meshes.size(), 1, [&](i32 mesh_idx, i32){
+			const ImportMesh& mesh = m_meshes[mesh_idx];
+			const ImportGeometry& geom = m_geometries[mesh.geometry_idx];
+			const int vertex_size = geom.vertex_size;
+			const int vertex_count = (i32)(geom.vertex_buffer.size() / vertex_size);
 			const u8* vd = geom.vertex_buffer.data();
 
+			Array<Vec3> verts(m_allocator);
+			verts.reserve(vertex_count);
 			for (int i = 0; i < vertex_count; ++i) {
 				Vec3 p;
 				memcpy(&p, vd + i * vertex_size, sizeof(p));
-				p = mesh.matrix.transformPoint(p);
-				verts.push(p);
+				verts.push(mesh.matrix.transformPoint(p));
 			}
 
-			if (to_convex) {
-				if (!ps->cookConvex(verts, m_out_file)) {
-					logError("Failed to cook ", src);
-					return false;
-				}
-			}
-			else {
-				if (!ps->cookTriMesh(verts, geom.indices, m_out_file)) {
-					logError("Failed to cook ", src);
-					return false;
-				}
+			OutputMemoryStream& blob = blobs[mesh_idx];
+			blob.write(&header, sizeof(header));
+			if (!cookMesh(*ps, compiler, to_convex, verts, geom.indices, blob, m_allocator)) blob.clear();
+		});
+
+		for (i32 i = 0; i < m_meshes.size(); ++i) {
+			const OutputMemoryStream& blob = blobs[i];
+			if (blob.empty()) {
+				logError("Failed to cook ", src);
+				return false;
 			}
 
-			Path phy_path(mesh.name, ".phy:", src);
-			AssetCompiler& compiler = m_app.getAssetCompiler();
-			if (!compiler.writeCompiledResource(phy_path, Span(m_out_file.data(), (i32)m_out_file.size()))) {
+			Path phy_path(m_meshes[i].name, ".phy:", src);
+			if (!compiler.writeCompiledResource(phy_path, Span(blob.data(), (i32)blob.size()))) {
 				return false;
 			}
 		}
@@ -1347,6 +1641,7 @@ bool ModelImporter::writePhysics(const Path& src, const ModelMeta& meta) {
 	m_out_file.clear();
 	m_out_file.write(&header, sizeof(header));
 
+	Array<Vec3> verts(m_allocator);
 	i32 total_vertex_count = 0;
 	for (const ImportMesh& mesh : m_meshes)	{
 		const ImportGeometry& geom = m_geometries[mesh.geometry_idx];
@@ -1370,13 +1665,8 @@ bool ModelImporter::writePhysics(const Path& src, const ModelMeta& meta) {
 		}
 	}
 
-	if (to_convex) {
-		if (!ps->cookConvex(verts, m_out_file)) {
-			logError("Failed to cook ", src);
-			return false;
-		}
-	} else {
-		Array<u32> indices(m_allocator);
+	Array<u32> indices(m_allocator);
+	if (!to_convex) {
 		i32 count = 0;
 		for (const ImportMesh& mesh : m_meshes) {
 			const ImportGeometry& geom = m_geometries[mesh.geometry_idx];
@@ -1393,15 +1683,14 @@ bool ModelImporter::writePhysics(const Path& src, const ModelMeta& meta) {
 			int vertex_count = (i32)(geom.vertex_buffer.size() / geom.vertex_size);
 			offset += vertex_count;
 		}
+	}
 
-		if (!ps->cookTriMesh(verts, indices, m_out_file)) {
-			logError("Failed to cook ", src);
-			return false;
-		}
+	if (!cookMesh(*ps, compiler, to_convex, verts, indices, m_out_file, m_allocator)) {
+		logError("Failed to cook ", src);
+		return false;
 	}
 
 	Path phy_path(".phy:", src);
-	AssetCompiler& compiler = m_app.getAssetCompiler();
 	return compiler.writeCompiledResource(phy_path, Span(m_out_file.data(), (i32)m_out_file.size()));
 }
 
@@ -1431,6 +1720,7 @@ bool ModelImporter::writeModel(const Path& src, const ModelMeta& meta) {
 	writeGeometry(meta);
 	writeSkeleton(meta);
 	writeLODs(meta);
+	write(m_meshlets.data(), m_meshlets.size());
 
 	AssetCompiler& compiler = m_app.getAssetCompiler();
 	return compiler.writeCompiledResource(Path(src), Span(m_out_file.data(), m_out_file.size()));
@@ -1439,14 +1729,27 @@ bool ModelImporter::writeModel(const Path& src, const ModelMeta& meta) {
 bool ModelImporter::writeAnimations(const Path& src, const ModelMeta& meta) {
 	PROFILE_FUNCTION();
 	bool any_failed = false;
+
+	// errors of a bone are amplified by its descendants, so bones with short chains below them get a bigger error budget
+	Array<u32> heights(m_allocator);
+	heights.resize(m_bones.size());
+	memset(heights.begin(), 0, heights.byte_size());
+	for (const Bone& bone : m_bones) {
+		u32 height = 1;
+		for (i32 parent_idx = getParentIndex(m_bones, bone); parent_idx >= 0; parent_idx = getParentIndex(m_bones, m_bones[parent_idx])) {
+			heights[parent_idx] = maximum(heights[parent_idx], height);
+			++height;
+		}
+	}
+	Array<float> error_scales(m_allocator);
+	error_scales.resize(m_bones.size());
+	for (u32 i = 0; i < (u32)m_bones.size(); ++i) {
+		error_scales[i] = maximum(1.f, 4.f / (1 + heights[i]));
+	}
+
 	for (const ImportAnimation& anim : m_animations) { 
 		if (anim.length <= 0) continue;
 
-		Array<TranslationTrack> translation_tracks(m_allocator);
-		Array<RotationTrack> rotation_tracks(m_allocator);
-		translation_tracks.resize(m_bones.size());
-		rotation_tracks.resize(m_bones.size());
-
 		auto write_animation = [&](StringView name, u32 from_sample, u32 samples_count) {
 			m_out_file.clear();
 			Animation::Header header;
@@ -1461,112 +1764,79 @@ bool ModelImporter::writeAnimations(const Path& src, const ModelMeta& meta) {
 			Array<Array<Key>> all_keys(m_allocator);
 			fillTracks(anim, all_keys, from_sample, samples_count);
 
-			{
-				u32 total_bits = 0;
-				u32 translation_curves_count = 0;
-				u64 toffset = m_out_file.size();
-				u16 offset_bits = 0;
-				write(translation_curves_count);
-				for (const Bone& bone : m_bones) {
-					const u32 bone_idx = u32(&bone - m_bones.begin());
-					Array<Key>& keys = all_keys[bone_idx];
-					if (keys.empty()) continue;
-
-					Vec3 bind_pos;
-					if (bone.parent_id == 0) {
-						bind_pos = m_bones[bone_idx].bind_pose_matrix.getTranslation();
-					}
-					else {
-						const int parent_idx = getParentIndex(m_bones, bone);
-						bind_pos = (m_bones[parent_idx].bind_pose_matrix.inverted() * m_bones[bone_idx].bind_pose_matrix).getTranslation();
-					}
-
-					if (isBindPosePositionTrack(keys.size(), keys, bind_pos)) continue;
-			
-					const BoneNameHash name_hash(bone.name.c_str());
-					write(name_hash);
-
-					Vec3 min(FLT_MAX), max(-FLT_MAX);
-					for (const Key& k : keys) {
-						const Vec3 p = k.pos;
-						min = minimum(p, min);
-						max = maximum(p, max);
-					}
-					const u8 bitsizes[] = {
-						(u8)log2(u32((max.x - min.x) / 0.00005f / meta.anim_translation_error)),
-						(u8)log2(u32((max.y - min.y) / 0.00005f / meta.anim_translation_error)),
-						(u8)log2(u32((max.z - min.z) / 0.00005f / meta.anim_translation_error))
-					};
-					const u8 bitsize = (bitsizes[0] + bitsizes[1] + bitsizes[2]);
+			struct AnimatedTrack {
+				u32 bone_idx;
+				Vec3 min;
+				Vec3 range;
+				u8 skipped_channel;
+				float max_error;
+			};
+			Array<AnimatedTrack> translation_tracks(m_allocator);
+			Array<AnimatedTrack> rotation_tracks(m_allocator);
+
+			u32 translation_curves_count = 0;
+			const u64 toffset = m_out_file.size();
+			write(translation_curves_count);
+			for (const Bone& bone : m_bones) {
+				const u32 bone_idx = u32(&bone - m_bones.begin());
+				Array<Key>& keys = all_keys[bone_idx];
+				if (keys.empty()) continue;
 
-					if (bitsize == 0) {
-						translation_tracks[bone_idx].is_const = true;
-						write(Animation::TrackType::CONSTANT);
-						write(keys[0].pos);
-					}
-					else {
-						translation_tracks[bone_idx].is_const = false;
-						write(Animation::TrackType::ANIMATED);
-
-						write(min);
-						write((max.x - min.x) / ((1 << bitsizes[0]) - 1));
-						write((max.y - min.y) / ((1 << bitsizes[1]) - 1));
-						write((max.z - min.z) / ((1 << bitsizes[2]) - 1));
-						write(bitsizes);
-						write(offset_bits);
-						offset_bits += bitsize;
-
-						memcpy(translation_tracks[bone_idx].bitsizes, bitsizes, sizeof(bitsizes));
-						translation_tracks[bone_idx].max = max;
-						translation_tracks[bone_idx].min = min;
-						total_bits += bitsize * keys.size();
-					}				
-
-					++translation_curves_count;
+				Vec3 bind_pos;
+				if (bone.parent_id == 0) {
+					bind_pos = m_bones[bone_idx].bind_pose_matrix.getTranslation();
+				}
+				else {
+					const int parent_idx = getParentIndex(m_bones, bone);
+					bind_pos = (m_bones[parent_idx].bind_pose_matrix.inverted() * m_bones[bone_idx].bind_pose_matrix).getTranslation();
 				}
 
-				BitWriter bit_writer(m_out_file, total_bits);
-
-				for (u32 i = 0; i < samples_count; ++i) {
-					for (u32 bone_idx = 0, num_bones = m_bones.size(); bone_idx < num_bones; ++bone_idx) {
-						Array<Key>& keys = all_keys[bone_idx];
-						const TranslationTrack& track = translation_tracks[bone_idx];
+				if (isBindPosePositionTrack(keys.size(), keys, bind_pos)) continue;
+			
+				const BoneNameHash name_hash(bone.name.c_str());
+				write(name_hash);
 
-						if (!keys.empty() && !track.is_const) {
-							const Key& k = keys[i];
-							Vec3 p = k.pos;
-							const u64 packed = pack(p, track);
-							const u32 bitsize = (track.bitsizes[0] + track.bitsizes[1] + track.bitsizes[2]);
-							ASSERT(bitsize <= 64);
-							bit_writer.write(packed, bitsize);
-						}
-					}
+				Vec3 min(FLT_MAX), max(-FLT_MAX);
+				for (const Key& k : keys) {
+					min = minimum(k.pos, min);
+					max = maximum(k.pos, max);
 				}
+				const float max_error = 0.00005f * meta.anim_translation_error * error_scales[bone_idx];
+				const Vec3 range = max - min;
 
-				memcpy(m_out_file.getMutableData() + toffset, &translation_curves_count, sizeof(translation_curves_count));
+				if (range.x <= max_error && range.y <= max_error && range.z <= max_error) {
+					write(Animation::TrackType::CONSTANT);
+					write(keys[0].pos);
+				}
+				else {
+					write(Animation::TrackType::ANIMATED);
+					write(min);
+					write(range);
+					AnimatedTrack& track = translation_tracks.emplace();
+					track.bone_idx = bone_idx;
+					track.min = min;
+					track.range = range;
+					track.skipped_channel = 0;
+					track.max_error = max_error;
+				}
+				++translation_curves_count;
 			}
+			memcpy(m_out_file.getMutableData() + toffset, &translation_curves_count, sizeof(translation_curves_count));
 
 			u32 rotation_curves_count = 0;
-			u64 roffset = m_out_file.size();
+			const u64 roffset = m_out_file.size();
 			write(rotation_curves_count);
-
-			u32 total_bits = 0;
-			u16 offset_bits = 0;
 			for (const Bone& bone : m_bones) {
 				const u32 bone_idx = u32(&bone - m_bones.begin());
 				Array<Key>& keys = all_keys[bone_idx];
 				if (keys.empty()) continue;
-			
-				Quat bind_rot;
-				if (bone.parent_id == 0) {
-					bind_rot = m_bones[bone_idx].bind_pose_matrix.getRotation();
-				}
-				else {
-					const i32 parent_idx = getParentIndex(m_bones, bone);
-					bind_rot = (m_bones[parent_idx].bind_pose_matrix.inverted() * m_bones[bone_idx].bind_pose_matrix).getRotation();
-				}
 
-				//if (isBindPoseRotationTrack(count, keys, bind_rot, meta.rotation_error)) continue;
+				// q and -q are the same rotation, keep neighbours in the same hemisphere so ranges stay small
+				for (u32 i = 1; i < (u32)keys.size(); ++i) {
+					const Quat& p = keys[i - 1].rot;
+					Quat& q = keys[i].rot;
+					if (p.x * q.x + p.y * q.y + p.z * q.z + p.w * q.w < 0) q = -q;
+				}
 
 				const BoneNameHash name_hash(bone.name.c_str());
 				write(name_hash);
@@ -1579,82 +1849,80 @@ bool ModelImporter::writeAnimations(const Path& src, const ModelMeta& meta) {
 					min.z = minimum(min.z, r.z); max.z = maximum(max.z, r.z);
 					min.w = minimum(min.w, r.w); max.w = maximum(max.w, r.w);
 				}
-				
-				u8 bitsizes[] = {
-					(u8)log2(u32((max.x - min.x) / 0.000001f / meta.anim_rotation_error)),
-					(u8)log2(u32((max.y - min.y) / 0.000001f / meta.anim_rotation_error)),
-					(u8)log2(u32((max.z - min.z) / 0.000001f / meta.anim_rotation_error)),
-					(u8)log2(u32((max.w - min.w) / 0.000001f / meta.anim_rotation_error))
-				};
-				if (clampBitsizes(bitsizes)) {
-					logWarning("Clamping bone ", bone.name, " in ", src);
+				const float max_error = 0.000001f * meta.anim_rotation_error * error_scales[bone_idx];
+
+				u8 skipped_channel = 0;
+				bool is_const = true;
+				for (u32 i = 0; i < 4; ++i) {
+					const float range = (&max.x)[i] - (&min.x)[i];
+					if (range > (&max.x)[skipped_channel] - (&min.x)[skipped_channel]) skipped_channel = i;
+					if (range > max_error) is_const = false;
 				}
 
-				if (bitsizes[0] + bitsizes[1] + bitsizes[2] + bitsizes[3] == 0) {
-					rotation_tracks[bone_idx].is_const = true;
+				if (is_const) {
 					write(Animation::TrackType::CONSTANT);
 					write(keys[0].rot);
 				}
 				else {
-					rotation_tracks[bone_idx].is_const = false;
 					write(Animation::TrackType::ANIMATED);
-
-					u8 skipped_channel = 0;
-					for (u32 i = 1; i < 4; ++i) {
-						if (bitsizes[i] > bitsizes[skipped_channel]) skipped_channel = i;
-					}
-
-					for (u32 i = 0; i < 4; ++i) {
-						if (skipped_channel == i) continue;
-						write((&min.x)[i]);
-					}
-					for (u32 i = 0; i < 4; ++i) {
-						if (skipped_channel == i) continue;
-						write(((&max.x)[i] - (&min.x)[i]) / ((1 << bitsizes[i]) - 1));
-					}
-					for (u32 i = 0; i < 4; ++i) {
-						if (skipped_channel == i) continue;
-						write(bitsizes[i]);
+					AnimatedTrack& track = rotation_tracks.emplace();
+					track.bone_idx = bone_idx;
+					track.skipped_channel = skipped_channel;
+					track.max_error = max_error;
+					for (u32 i = 0, j = 0; i < 4; ++i) {
+						if (i == skipped_channel) continue;
+						(&track.min.x)[j] = (&min.x)[i];
+						(&track.range.x)[j] = (&max.x)[i] - (&min.x)[i];
+						++j;
 					}
-					u8 bitsize = bitsizes[0] + bitsizes[1] + bitsizes[2] + bitsizes[3] + 1;
-					bitsize -= bitsizes[skipped_channel];
-					write(offset_bits);
 					write(skipped_channel);
-
-					offset_bits += bitsize;
-					ASSERT(bitsize > 0 && bitsize <= 64);
-				
-					memcpy(rotation_tracks[bone_idx].bitsizes, bitsizes, sizeof(bitsizes));
-					rotation_tracks[bone_idx].max = max;
-					rotation_tracks[bone_idx].min = min;
-					rotation_tracks[bone_idx].skipped_channel = skipped_channel;
-					total_bits += bitsize * keys.size();
+					write(track.min);
+					write(track.range);
 				}
 				++rotation_curves_count;
 			}
 			memcpy(m_out_file.getMutableData() + roffset, &rotation_curves_count, sizeof(rotation_curves_count));
 
-			BitWriter bit_writer(m_out_file, total_bits);
-
-			for (u32 i = 0; i < samples_count; ++i) {
-				for (u32 bone_idx = 0, num_bones = m_bones.size(); bone_idx < num_bones; ++bone_idx) {
-					Array<Key>& keys = all_keys[bone_idx];
-					const RotationTrack& track = rotation_tracks[bone_idx];
-
-					if (!keys.empty() && !track.is_const) {
-						const Key& k = keys[i];
-						Quat q = k.rot;
-						u32 bitsize = (track.bitsizes[0] + track.bitsizes[1] + track.bitsizes[2] + track.bitsizes[3]);
-						bitsize -= track.bitsizes[track.skipped_channel];
-						++bitsize; // sign bit
-						ASSERT(bitsize <= 64);
-						u64 packed = pack(q, track);
-						packed <<= 1;
-						packed |= (&q.x)[track.skipped_channel] < 0 ? 1 : 0;
-						bit_writer.write(packed, bitsize);
+			const u32 frame_count = samples_count - 1;
+			const u32 segments_count = frame_count == 0 ? 1 : (frame_count + Animation::SEGMENT_FRAMES - 1) / Animation::SEGMENT_FRAMES;
+			SegmentEncoder encoder(m_allocator);
+			Vec3 channels[Animation::SEGMENT_FRAMES + 1];
+			bool signs[Animation::SEGMENT_FRAMES + 1];
+			for (u32 segment = 0; segment < segments_count; ++segment) {
+				const u32 first_frame = segment * Animation::SEGMENT_FRAMES;
+				const u32 segment_length = minimum(Animation::SEGMENT_FRAMES, frame_count - first_frame);
+
+				for (const AnimatedTrack& track : translation_tracks) {
+					const Key* keys = all_keys[track.bone_idx].begin() + first_frame;
+					for (u32 f = 0; f <= segment_length; ++f) channels[f] = keys[f].pos;
+					const u8 stride_log2 = SegmentEncoder::findStride(channels, segment_length, track.max_error * 0.5f, [](const Vec3& a, const Vec3& b, float t, const Vec3& expected){
+						const Vec3 d = lerp(a, b, t) - expected;
+						return maximum(fabsf(d.x), fabsf(d.y), fabsf(d.z));
+					});
+					encoder.encode(channels, nullptr, segment_length, stride_log2, track.min, track.range, track.max_error);
+				}
+
+				for (const AnimatedTrack& track : rotation_tracks) {
+					const Key* keys = all_keys[track.bone_idx].begin() + first_frame;
+					Quat rots[Animation::SEGMENT_FRAMES + 1];
+					for (u32 f = 0; f <= segment_length; ++f) {
+						rots[f] = keys[f].rot;
+						signs[f] = (&rots[f].x)[track.skipped_channel] < 0;
+						for (u32 i = 0, j = 0; i < 4; ++i) {
+							if (i == track.skipped_channel) continue;
+							(&channels[f].x)[j] = (&rots[f].x)[i];
+							++j;
+						}
 					}
+					const u8 stride_log2 = SegmentEncoder::findStride(rots, segment_length, track.max_error * 0.5f, [](const Quat& a, const Quat& b, float t, const Quat& expected){
+						Quat q = nlerp(a, b, t);
+						if (q.x * expected.x + q.y * expected.y + q.z * expected.z + q.w * expected.w < 0) q = -q;
+						return maximum(fabsf(q.x - expected.x), fabsf(q.y - expected.y), maximum(fabsf(q.z - expected.z), fabsf(q.w - expected.w)));
+					});
+					encoder.encode(channels, signs, segment_length, stride_log2, track.min, track.range, track.max_error);
 				}
 			}
+			encoder.write(m_out_file);
 
 			Path anim_path(name, ".ani:", src);
 			AssetCompiler& compiler = m_app.getAssetCompiler();
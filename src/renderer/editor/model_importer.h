@@ -80,6 +80,10 @@ struct ModelImporter {
 		Array<u32> indices;
 		u32 index_size = 0;
 		Local<Array<u32>> autolod_indices[4];
+		// indices are reordered so each meshlet is a contiguous range, we keep only range sizes
+		// bounds are computed in writeGeometry, after vertices are transformed
+		Local<Array<u32>> meshlets;
+		Local<Array<u32>> autolod_meshlets[4];
 		i32 submesh = -1;
 		u32 material_index;
 		bool is_skinned;
@@ -148,9 +152,11 @@ protected:
 	void writeLODs(const ModelMeta& meta);
 	void writeGeometry(const ModelMeta& meta);
 	void writeGeometry(u32 geom_idx);
+	void writeMeshlets(const Array<u32>& indices, const Array<u32>* meshlets, const u8* vertices, u32 vertex_count, u32 vertex_size);
 	void writeSkeleton(const ModelMeta& meta);
 	bool findTexture(StringView src_dir, StringView ext, ImportTexture& tex) const;
 	void bakeVertexAO(float min_ao);
+	void compressVertices();
 	bool writeSubmodels(const Path& src, const ModelMeta& meta);
 	bool writeDummyModel(const Path& src);
 	bool writeModel(const Path& src, const ModelMeta& meta);
@@ -164,6 +170,8 @@ protected:
 	StudioApp& m_app;
 	IAllocator& m_allocator;
 	OutputMemoryStream m_out_file;
+	// written after LODs, see Model::FileVersion::MESHLETS
+	OutputMemoryStream m_meshlets;
 	struct Shader* m_impostor_shadow_shader = nullptr;
 
 	// importers must fill these members
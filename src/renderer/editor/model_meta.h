@@ -88,6 +88,8 @@ struct ModelMeta {
 		WRITE_BOOL(force_recompute_tangents, false);
 		WRITE_BOOL(force_skin, false);
 		WRITE_BOOL(bake_vertex_ao, false);
+		WRITE_BOOL(build_meshlets, false);
+		WRITE_BOOL(compress_vertices, false);
 		WRITE_BOOL(bake_impostor_normals, false);
 		WRITE_BOOL(split, false);
 		WRITE_BOOL(use_specular_as_roughness, true);
@@ -161,6 +163,8 @@ struct ModelMeta {
 			{ "split", &split },
 			{ "bake_impostor_normals", &bake_impostor_normals },
 			{ "bake_vertex_ao", &bake_vertex_ao },
+			{ "build_meshlets", &build_meshlets },
+			{ "compress_vertices", &compress_vertices },
 			{ "min_bake_vertex_ao", &min_bake_vertex_ao },
 			{ "create_impostor", &create_impostor },
 			{ "import_vertex_colors", &import_vertex_colors },
@@ -281,6 +285,10 @@ struct ModelMeta {
 	bool use_mikktspace = false;
 	bool import_vertex_colors = false;
 	bool bake_vertex_ao = false;
+	// split meshes into clusters, which are culled separately, useful for dense meshes
+	bool build_meshlets = false;
+	// store UVs as half floats and skin weights as 8bit unorm
+	bool compress_vertices = false;
 	bool use_specular_as_roughness = true;
 	bool use_specular_as_metallic = false;
 	bool vertex_color_is_ao = false;
@@ -42,6 +42,7 @@ enum class Version {
 	EMIT_NODE,
 	WORLD_SPACE,
 	STREAM_NODE_CHANNELS,
+	GPU_SIMULATION,
 
 	LAST
 };
@@ -435,6 +436,10 @@ struct ParticleEmitterEditorResource {
 			blob.read(m_init_emit_count);
 			blob.read(m_emit_per_second);
 		}
+		if (version > Version::GPU_SIMULATION) {
+			blob.read(m_gpu_simulation);
+			blob.read(m_gpu_capacity);
+		}
 
 		i32 count;
 
@@ -493,6 +498,8 @@ struct ParticleEmitterEditorResource {
 		blob.writeString(m_mat_path);
 		blob.write(m_init_emit_count);
 		blob.write(m_emit_per_second);
+		blob.write(m_gpu_simulation);
+		blob.write(m_gpu_capacity);
 		
 		blob.write((i32)m_streams.size());
 		blob.write(m_streams.begin(), m_streams.byte_size());
@@ -661,6 +668,8 @@ struct ParticleEmitterEditorResource {
 	int m_last_id = 0;
 	u32 m_init_emit_count = 0;
 	float m_emit_per_second = 100;
+	bool m_gpu_simulation = false;
+	u32 m_gpu_capacity = 64 * 1024;
 };
 
 Node::Node(struct ParticleEmitterEditorResource& res) 
@@ -2779,6 +2788,8 @@ struct ParticleEditorImpl : ParticleEditor {
 			output.write(emitter->m_init_emit_count);
 			output.write(emitter->m_emit_per_second);
 			output.write(getCount(emitter->m_emit_inputs));
+			output.write(emitter->m_gpu_simulation);
+			output.write(emitter->m_gpu_capacity);
 		}
 		return true;
 	}
@@ -3255,6 +3266,13 @@ struct ParticleEditorWindow : AssetEditorWindow, NodeEditor {
 		changed = ImGui::DragFloat("##eps", &m_active_emitter->m_emit_per_second) || changed;
 		ImGuiEx::Label("Emit at start");
 		changed = ImGui::DragInt("##eas", (i32*)&m_active_emitter->m_init_emit_count) || changed;
+		ImGuiEx::Label("GPU simulation");
+		changed = ImGui::Checkbox("##gpu", &m_active_emitter->m_gpu_simulation) || changed;
+		if (ImGui::IsItemHovered()) ImGui::SetTooltip("Emitters using spline, mesh or emit nodes or emitted by other emitters are simulated on CPU");
+		if (m_active_emitter->m_gpu_simulation) {
+			ImGuiEx::Label("Max particles");
+			changed = ImGui::DragInt("##gpucap", (i32*)&m_active_emitter->m_gpu_capacity, 1, 1, 16 * 1024 * 1024) || changed;
+		}
 		ImGuiEx::Label("Register count");
 		ImGui::Text("%d", m_active_emitter->m_registers_count);
 		ImGuiEx::Label("Update instructions");
@@ -3378,7 +3396,9 @@ struct ParticleEditorWindow : AssetEditorWindow, NodeEditor {
 				, editor_emitter->m_init_emit_count
 				, getCount(editor_emitter->m_emit_inputs)
 				, editor_emitter->m_emit_per_second
-				, Path(editor_emitter->m_mat_path));
+				, Path(editor_emitter->m_mat_path)
+				, editor_emitter->m_gpu_simulation
+				, editor_emitter->m_gpu_capacity);
 		}
 	}
 
@@ -3394,6 +3414,14 @@ struct ParticleEditorWindow : AssetEditorWindow, NodeEditor {
 						const ParticleSystem::Emitter& emitter = emitters[emitter_idx];
 						const ParticleSystemResource::Emitter& res_emitter = res_emitters[emitter_idx];
 						if (ImGui::BeginTabItem(StaticString<64>(emitter_idx + 1))) {
+							if (ImGui::Button("Benchmark")) {
+								m_benchmark = system->benchmark(emitter_idx, 100, m_app.getEngine().getPageAllocator());
+								m_benchmark_emitter = emitter_idx;
+							}
+							if (m_benchmark_emitter == emitter_idx) {
+								ImGui::SameLine();
+								ImGui::Text("Interpreted: %.1f, fused: %.1f particles/us", m_benchmark.interpreted, m_benchmark.fused);
+							}
 							if (ImGui::BeginTable("tab", res_emitter.channels_count + 1)) {
 								for (u32 j = 0; j < emitter.particles_count; ++j) {
 									ImGui::TableNextRow();
@@ -3579,6 +3607,8 @@ struct ParticleEditorWindow : AssetEditorWindow, NodeEditor {
 	ParticleEditorImpl& m_editor;
 	char m_function_filter[128] = "";
 	bool m_show_debug = false;
+	ParticleSystem::BenchmarkResult m_benchmark;
+	i32 m_benchmark_emitter = -1;
 	bool m_show_save_as = false;
 	ParticleSystemEditorResource m_resource;
 	ParticleEmitterEditorResource* m_active_emitter = nullptr;
@@ -46,6 +46,7 @@
 #include "renderer/editor/composite_texture.h"
 #include "renderer/editor/model_importer.h"
 #include "renderer/editor/particle_editor.h"
+#include "renderer/editor/render_plugins.h"
 #include "renderer/draw_stream.h"
 #include "renderer/font.h"
 #include "renderer/gpu/gpu.h"
@@ -56,6 +57,7 @@
 #include "renderer/render_module.h"
 #include "renderer/renderer.h"
 #include "renderer/shader.h"
+#include "renderer/shader_usage.h"
 #include "renderer/texture.h"
 #include "renderer/terrain.h"
 #include "scene_view.h"
@@ -66,6 +68,7 @@
 #include <rgbcx/rgbcx.h>
 #include "stb/stb_image.h"
 #include <stb/stb_image_resize2.h>
+#include <stb/stb_rect_pack.h>
 
 
 using namespace Lumix;
@@ -88,11 +91,23 @@ static const ComponentType PROCEDURAL_GEOM_TYPE = reflection::getComponentType("
 
 namespace TextureCompressor {
 
+struct Input;
+
+// generates mips of single-mip `src` into `dst`, which has full mip chain; returns false if it can not, mips are then generated on cpu
+struct IMipGenerator {
+	virtual ~IMipGenerator() {}
+	virtual bool generateMips(const Input& src, Input& dst) = 0;
+};
+
 struct Options {
 	bool compress = true;
+	// BC7 instead of BC1/BC3 for color textures, better quality, but opaque textures take twice as much memory as BC1
+	bool bc7 = false;
 	bool generate_mipmaps = false;
 	bool stochastic_mipmap = false;
 	float scale_coverage_ref = -0.5f;
+	// optional, not used for stochastic mipmaps and texture arrays
+	IMipGenerator* mip_generator = nullptr;
 };
 
 struct Input {
@@ -228,36 +243,54 @@ static void computeMip(Span<const u8> src, Span<u8> dst, u32 w, u32 h, u32 dst_w
 	}
 }
 
-static void compressBC1(Span<const u8> src, OutputMemoryStream& dst, u32 w, u32 h) {
-	PROFILE_FUNCTION();
-	
-	const u32 dst_block_size = 8;
+// copies 4x4 block starting at (x, y) to `tmp`, pixels outside the image are replaced by the nearest edge pixel
+static void loadBlock(const u8* src, u32 w, u32 h, u32 x, u32 y, u32 (&tmp)[16]) {
+	const u32* src32 = (const u32*)src;
+	if (x + 4 <= w && y + 4 <= h) {
+		for (u32 j = 0; j < 4; ++j) {
+			memcpy(&tmp[j * 4], &src32[(y + j) * w + x], 16);
+		}
+		return;
+	}
+
+	for (u32 j = 0; j < 4; ++j) {
+		const u32 sy = minimum(y + j, h - 1);
+		for (u32 i = 0; i < 4; ++i) {
+			const u32 sx = minimum(x + i, w - 1);
+			tmp[j * 4 + i] = src32[sy * w + sx];
+		}
+	}
+}
+
+// one item is one row of blocks
+template <typename F>
+static void compressBlocks(Span<const u8> src, OutputMemoryStream& dst, u32 w, u32 h, u32 dst_block_size, F encoder) {
 	const u32 size = getCompressedMipSize(w, h, dst_block_size);
 	const u64 offset = dst.size();
 	dst.resize(offset + size);
 	u8* out = dst.getMutableData() + offset;
+	const u32 blocks_w = (w + 3) >> 2;
 
-	jobs::forEach(h, 4, [&](i32 j, i32){
-		PROFILE_FUNCTION();
-		u32 tmp[32];
-		const u8* src_row_begin = &src[j * w * 4];
-
-		const u32 src_block_h = minimum(h - j, 4);
-		for (u32 i = 0; i < w; i += 4) {
-			const u8* src_block_begin = src_row_begin + i * 4;
-			
-			const u32 src_block_w = minimum(w - i, 4);
-			for (u32 jj = 0; jj < src_block_h; ++jj) {
-				memcpy(&tmp[jj * 4], &src_block_begin[jj * w * 4], 4 * src_block_w);
+	jobs::forEach((h + 3) >> 2, [&](u32 from, u32 to){
+		PROFILE_BLOCK("compress blocks");
+		u32 tmp[16];
+		for (u32 bj = from; bj < to; ++bj) {
+			u8* out_row = &out[bj * blocks_w * dst_block_size];
+			for (u32 bi = 0; bi < blocks_w; ++bi) {
+				loadBlock(src.begin(), w, h, bi << 2, bj << 2, tmp);
+				encoder(out_row + bi * dst_block_size, (const u8*)tmp);
 			}
-
-			const u32 bi = i >> 2;
-			const u32 bj = j >> 2;
-			rgbcx::encode_bc1(10, &out[(bi + bj * ((w + 3) >> 2)) * dst_block_size], (const u8*)tmp, true, false);
 		}
 	});
 }
 
+static void compressBC1(Span<const u8> src, OutputMemoryStream& dst, u32 w, u32 h) {
+	PROFILE_FUNCTION();
+	compressBlocks(src, dst, w, h, 8, [](u8* out, const u8* pixels){
+		rgbcx::encode_bc1(10, out, pixels, true, false);
+	});
+}
+
 static void compressRGBA(Span<const u8> src, OutputMemoryStream& dst, u32 w, u32 h) {
 	PROFILE_FUNCTION();
 	dst.write(src.begin(), src.length());
@@ -265,62 +298,189 @@ static void compressRGBA(Span<const u8> src, OutputMemoryStream& dst, u32 w, u32
 
 static void compressBC5(Span<const u8> src, OutputMemoryStream& dst, u32 w, u32 h) {
 	PROFILE_FUNCTION();
-	
-	const u32 dst_block_size = 16;
-	const u32 size = getCompressedMipSize(w, h, dst_block_size);
-	const u64 offset = dst.size();
-	dst.resize(offset + size);
-	u8* out = dst.getMutableData() + offset;
+	compressBlocks(src, dst, w, h, 16, [](u8* out, const u8* pixels){
+		rgbcx::encode_bc5(out, pixels);
+	});
+}
 
-	jobs::forEach(h, 4, [&](i32 j, i32){
-		PROFILE_FUNCTION();
-		u32 tmp[32];
-		const u8* src_row_begin = &src[j * w * 4];
+static void compressBC3(Span<const u8> src, OutputMemoryStream& dst, u32 w, u32 h) {
+	PROFILE_FUNCTION();
+	compressBlocks(src, dst, w, h, 16, [](u8* out, const u8* pixels){
+		rgbcx::encode_bc3(10, out, pixels);
+	});
+}
 
-		const u32 src_block_h = minimum(h - j, 4);
-		for (u32 i = 0; i < w; i += 4) {
-			const u8* src_block_begin = src_row_begin + i * 4;
-			
-			const u32 src_block_w = minimum(w - i, 4);
-			for (u32 jj = 0; jj < src_block_h; ++jj) {
-				memcpy(&tmp[jj * 4], &src_block_begin[jj * w * 4], 4 * src_block_w);
+// BC7 mode 6 - single subset, RGBA 7.7.7.7 endpoints with unique p-bits, 4bit indices
+namespace BC7 {
+
+static constexpr u32 WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct Endpoints {
+	u8 c7[2][4];
+	u8 pbits[2];
+
+	u8 get(u32 e, u32 c) const { return u8((c7[e][c] << 1) | pbits[e]); }
+};
+
+static u32 fitIndices(const u8* pixels, const Endpoints& e, u8 (&indices)[16]) {
+	i32 palette[16][4];
+	for (u32 c = 0; c < 4; ++c) {
+		const i32 e0 = e.get(0, c);
+		const i32 e1 = e.get(1, c);
+		for (u32 i = 0; i < 16; ++i) {
+			palette[i][c] = ((64 - WEIGHTS[i]) * e0 + WEIGHTS[i] * e1 + 32) >> 6;
+		}
+	}
+
+	u32 total = 0;
+	for (u32 p = 0; p < 16; ++p) {
+		const u8* px = pixels + p * 4;
+		u32 best_err = 0xffFFffFF;
+		u8 best_idx = 0;
+		for (u32 i = 0; i < 16; ++i) {
+			const i32 dr = px[0] - palette[i][0];
+			const i32 dg = px[1] - palette[i][1];
+			const i32 db = px[2] - palette[i][2];
+			const i32 da = px[3] - palette[i][3];
+			const u32 err = u32(dr * dr + dg * dg + db * db + da * da);
+			if (err < best_err) {
+				best_err = err;
+				best_idx = u8(i);
 			}
+		}
+		indices[p] = best_idx;
+		total += best_err;
+	}
+	return total;
+}
 
-			const u32 bi = i >> 2;
-			const u32 bj = j >> 2;
-			rgbcx::encode_bc5(&out[(bi + bj * ((w + 3) >> 2)) * dst_block_size], (const u8*)tmp);
+// tries all p-bit combinations for float endpoints `ep`, keeps the best one in `best`
+static void quantize(const u8* pixels, const float (&ep)[2][4], Endpoints& best, u8 (&best_indices)[16], u32& best_err) {
+	for (u32 p = 0; p < 4; ++p) {
+		Endpoints e;
+		e.pbits[0] = p & 1;
+		e.pbits[1] = p >> 1;
+		for (u32 j = 0; j < 2; ++j) {
+			for (u32 c = 0; c < 4; ++c) {
+				e.c7[j][c] = u8(clamp(i32((ep[j][c] - e.pbits[j]) * 0.5f + 0.5f), 0, 127));
+			}
 		}
-	});
+		u8 indices[16];
+		const u32 err = fitIndices(pixels, e, indices);
+		if (err < best_err) {
+			best_err = err;
+			best = e;
+			memcpy(best_indices, indices, sizeof(indices));
+		}
+	}
 }
 
-static void compressBC3(Span<const u8> src, OutputMemoryStream& dst, u32 w, u32 h) {
-	PROFILE_FUNCTION();
-	
-	const u32 dst_block_size = 16;
-	const u32 size = getCompressedMipSize(w, h, dst_block_size);
-	const u64 offset = dst.size();
-	dst.resize(offset + size);
-	u8* out = dst.getMutableData() + offset;
+static void writeBits(u8* out, u32& bit, u32 value, u32 count) {
+	for (u32 i = 0; i < count; ++i, ++bit) {
+		if (value & (1 << i)) out[bit >> 3] |= 1 << (bit & 7);
+	}
+}
 
-	jobs::forEach(h, 4, [&](i32 j, i32){
-		PROFILE_FUNCTION();
-		u32 tmp[32] = {};
-		const u8* src_row_begin = &src[j * w * 4];
+static void encode(u8* out, const u8* pixels) {
+	float mean[4] = {};
+	for (u32 p = 0; p < 16; ++p) {
+		for (u32 c = 0; c < 4; ++c) mean[c] += pixels[p * 4 + c];
+	}
+	for (float& m : mean) m *= 1 / 16.f;
 
-		const u32 src_block_h = minimum(h - j, 4);
-		for (u32 i = 0; i < w; i += 4) {
-			const u8* src_block_begin = src_row_begin + i * 4;
-			
-			const u32 src_block_w = minimum(w - i, 4);
-			for (u32 jj = 0; jj < src_block_h; ++jj) {
-				memcpy(&tmp[jj * 4], &src_block_begin[jj * w * 4], 4 * src_block_w);
-			}
+	float cov[4][4] = {};
+	for (u32 p = 0; p < 16; ++p) {
+		float d[4];
+		for (u32 c = 0; c < 4; ++c) d[c] = pixels[p * 4 + c] - mean[c];
+		for (u32 a = 0; a < 4; ++a) {
+			for (u32 b = 0; b < 4; ++b) cov[a][b] += d[a] * d[b];
+		}
+	}
 
-			const u32 bi = i >> 2;
-			const u32 bj = j >> 2;
-			rgbcx::encode_bc3(10, &out[(bi + bj * ((w + 3) >> 2)) * dst_block_size], (const u8*)tmp);
+	// principal axis by power iteration
+	float axis[4] = {1, 1, 1, 1};
+	for (u32 iter = 0; iter < 8; ++iter) {
+		float tmp[4] = {};
+		for (u32 a = 0; a < 4; ++a) {
+			for (u32 b = 0; b < 4; ++b) tmp[a] += cov[a][b] * axis[b];
 		}
-	});
+		const float len = sqrtf(tmp[0] * tmp[0] + tmp[1] * tmp[1] + tmp[2] * tmp[2] + tmp[3] * tmp[3]);
+		if (len < 1e-6f) break;
+		for (u32 c = 0; c < 4; ++c) axis[c] = tmp[c] / len;
+	}
+
+	float tmin = FLT_MAX;
+	float tmax = -FLT_MAX;
+	for (u32 p = 0; p < 16; ++p) {
+		float t = 0;
+		for (u32 c = 0; c < 4; ++c) t += (pixels[p * 4 + c] - mean[c]) * axis[c];
+		tmin = minimum(tmin, t);
+		tmax = maximum(tmax, t);
+	}
+
+	float ep[2][4];
+	for (u32 c = 0; c < 4; ++c) {
+		ep[0][c] = clamp(mean[c] + axis[c] * tmin, 0.f, 255.f);
+		ep[1][c] = clamp(mean[c] + axis[c] * tmax, 0.f, 255.f);
+	}
+
+	Endpoints e;
+	u8 indices[16];
+	u32 err = 0xffFFffFF;
+	quantize(pixels, ep, e, indices, err);
+
+	// refine endpoints with least squares fit to the selected indices
+	if (err > 0) {
+		float aa = 0, ab = 0, bb = 0;
+		float ax[4] = {}, bx[4] = {};
+		for (u32 p = 0; p < 16; ++p) {
+			const float b = WEIGHTS[indices[p]] / 64.f;
+			const float a = 1 - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (u32 c = 0; c < 4; ++c) {
+				ax[c] += a * pixels[p * 4 + c];
+				bx[c] += b * pixels[p * 4 + c];
+			}
+		}
+		const float det = aa * bb - ab * ab;
+		if (fabsf(det) > 1e-6f) {
+			const float inv_det = 1 / det;
+			for (u32 c = 0; c < 4; ++c) {
+				ep[0][c] = clamp((ax[c] * bb - bx[c] * ab) * inv_det, 0.f, 255.f);
+				ep[1][c] = clamp((bx[c] * aa - ax[c] * ab) * inv_det, 0.f, 255.f);
+			}
+			quantize(pixels, ep, e, indices, err);
+		}
+	}
+
+	// msb of the first index is implicit zero
+	if (indices[0] & 8) {
+		for (u32 c = 0; c < 4; ++c) swap(e.c7[0][c], e.c7[1][c]);
+		swap(e.pbits[0], e.pbits[1]);
+		for (u8& i : indices) i = 15 - i;
+	}
+
+	memset(out, 0, 16);
+	u32 bit = 0;
+	writeBits(out, bit, 1 << 6, 7);
+	for (u32 c = 0; c < 4; ++c) {
+		writeBits(out, bit, e.c7[0][c], 7);
+		writeBits(out, bit, e.c7[1][c], 7);
+	}
+	writeBits(out, bit, e.pbits[0], 1);
+	writeBits(out, bit, e.pbits[1], 1);
+	writeBits(out, bit, indices[0], 3);
+	for (u32 i = 1; i < 16; ++i) writeBits(out, bit, indices[i], 4);
+	ASSERT(bit == 128);
+}
+
+} // namespace BC7
+
+static void compressBC7(Span<const u8> src, OutputMemoryStream& dst, u32 w, u32 h) {
+	PROFILE_FUNCTION();
+	compressBlocks(src, dst, w, h, 16, BC7::encode);
 }
 
 static void writeLBCHeader(OutputMemoryStream& out, u32 w, u32 h, u32 slices, u32 mips, gpu::TextureFormat format, bool is_3d, bool is_cubemap) {
@@ -373,7 +533,7 @@ static void scaleCoverage(Span<u8> data, u32 w, u32 h, float ref_norm, float wan
 static void compress(void (*compressor)(Span<const u8>, OutputMemoryStream&, u32, u32), const Input& src_data, const Options& options, OutputMemoryStream& dst, IAllocator& allocator) {
 	const u32 mips = options.generate_mipmaps ? 1 + log2(maximum(src_data.w, src_data.h)) : src_data.mips;
 	const u32 faces = src_data.is_cubemap ? 6 : 1;
-	const u32 block_size = src_data.has_alpha || src_data.is_normalmap ? 16 : 8;
+	const u32 block_size = src_data.has_alpha || src_data.is_normalmap || options.bc7 ? 16 : 8;
 	const u32 total_compressed_size = getCompressedSize(src_data.w, src_data.h, mips, faces, block_size);
 	dst.reserve(dst.size() + total_compressed_size);
 	Array<u8> mip_data(allocator);
@@ -426,34 +586,89 @@ static bool isValid(const Input& src_data, const Options& options) {
 	return true;
 }
 
+// block compressed textures must have size multiple of 4, so we resample them instead of using uncompressed format
+static void resampleToBlockSize(const Input& src_data, Input& dst_data) {
+	PROFILE_FUNCTION();
+	dst_data.is_srgb = src_data.is_srgb;
+	dst_data.is_normalmap = src_data.is_normalmap;
+	dst_data.has_alpha = src_data.has_alpha;
+	dst_data.is_cubemap = src_data.is_cubemap;
+	for (const Input::Image& img : src_data.images) {
+		Input::Image& dst_img = dst_data.add(img.face, img.slice, 0);
+		if (src_data.is_srgb) {
+			u8* res = stbir_resize_uint8_srgb(img.pixels.data(), src_data.w, src_data.h, 0, dst_img.pixels.getMutableData(), dst_data.w, dst_data.h, 0, STBIR_RGBA);
+			ASSERT(res);
+		}
+		else {
+			u8* res = stbir_resize_uint8_linear(img.pixels.data(), src_data.w, src_data.h, 0, dst_img.pixels.getMutableData(), dst_data.w, dst_data.h, 0, STBIR_RGBA);
+			ASSERT(res);
+		}
+	}
+}
+
 [[nodiscard]] static bool compress(const Input& src_data, const Options& options, OutputMemoryStream& dst, IAllocator& allocator) {
 	PROFILE_FUNCTION();
 
 	if (!isValid(src_data, options)) return false;
 
+	const bool is_block_aligned = (src_data.w % 4) == 0 && (src_data.h % 4) == 0;
+	if (options.compress && !is_block_aligned && src_data.mips == 1) {
+		Input resampled((src_data.w + 3) & ~3, (src_data.h + 3) & ~3, src_data.slices, 1, allocator);
+		resampleToBlockSize(src_data, resampled);
+		return compress(resampled, options, dst, allocator);
+	}
+
+	if (options.generate_mipmaps && options.mip_generator && !options.stochastic_mipmap && src_data.slices == 1) {
+		Input with_mips(src_data.w, src_data.h, 1, 1 + log2(maximum(src_data.w, src_data.h)), allocator);
+		with_mips.is_srgb = src_data.is_srgb;
+		with_mips.is_normalmap = src_data.is_normalmap;
+		with_mips.has_alpha = src_data.has_alpha;
+		with_mips.is_cubemap = src_data.is_cubemap;
+		if (options.mip_generator->generateMips(src_data, with_mips)) {
+			if (options.scale_coverage_ref >= 0.f) {
+				const float coverage = computeCoverage(src_data.get(0, 0, 0).pixels, src_data.w, src_data.h, options.scale_coverage_ref);
+				for (Input::Image& img : with_mips.images) {
+					if (img.mip == 0) continue;
+					const u32 mip_w = maximum(src_data.w >> img.mip, 1);
+					const u32 mip_h = maximum(src_data.h >> img.mip, 1);
+					scaleCoverage(Span(img.pixels.getMutableData(), (u32)img.pixels.size()), mip_w, mip_h, options.scale_coverage_ref, coverage);
+				}
+			}
+			Options precomputed = options;
+			precomputed.generate_mipmaps = false;
+			precomputed.mip_generator = nullptr;
+			return compress(with_mips, precomputed, dst, allocator);
+		}
+	}
+
 	const u32 mips = options.generate_mipmaps ? 1 + log2(maximum(src_data.w, src_data.h)) : src_data.mips;
 	gpu::TextureFormat format;
+	void (*compressor)(Span<const u8>, OutputMemoryStream&, u32, u32);
 
-	const bool can_compress = options.compress && (src_data.w % 4) == 0 && (src_data.h % 4) == 0;
-	if (!can_compress) format = gpu::TextureFormat::RGBA8;
-	else if (src_data.is_normalmap) format = gpu::TextureFormat::BC5;
-	else if (src_data.has_alpha) format = gpu::TextureFormat::BC3;
-	else format = gpu::TextureFormat::BC1;
-		
-	writeLBCHeader(dst, src_data.w, src_data.h, src_data.slices, mips, format, false, src_data.is_cubemap);
-
+	const bool can_compress = options.compress && is_block_aligned;
 	if (!can_compress) {
-		compress(compressRGBA, src_data, options, dst, allocator);
+		format = gpu::TextureFormat::RGBA8;
+		compressor = compressRGBA;
+	}
+	else if (src_data.is_normalmap) {
+		format = gpu::TextureFormat::BC5;
+		compressor = compressBC5;
 	}
-	if (src_data.is_normalmap) {
-		compress(compressBC5, src_data, options, dst, allocator);
+	else if (options.bc7) {
+		format = gpu::TextureFormat::BC7;
+		compressor = compressBC7;
 	}
 	else if (src_data.has_alpha) {
-		compress(compressBC3, src_data, options, dst, allocator);
+		format = gpu::TextureFormat::BC3;
+		compressor = compressBC3;
 	}
 	else {
-		compress(compressBC1, src_data, options, dst, allocator);
+		format = gpu::TextureFormat::BC1;
+		compressor = compressBC1;
 	}
+		
+	writeLBCHeader(dst, src_data.w, src_data.h, src_data.slices, mips, format, false, src_data.is_cubemap);
+	compress(compressor, src_data, options, dst, allocator);
 	return true;
 }
 
@@ -913,6 +1128,7 @@ struct TextureMeta {
 		const ParseItemDesc descs[] = {
 			{ "srgb", &srgb },
 			{ "compress", &compress },
+			{ "bc7", &bc7 },
 			{ "mip_scale_coverage", &mip_scale_coverage },
 			{ "stochastic_mip", &stochastic_mip },
 			{ "normalmap", &normalmap },
@@ -925,6 +1141,7 @@ struct TextureMeta {
 	void serialize(OutputMemoryStream& blob, const Path&) {
 		blob << "srgb = " << (srgb ? "true" : "false")
 			<< "\ncompress = " << (compress ? "true" : "false")
+			<< "\nbc7 = " << (bc7 ? "true" : "false")
 			<< "\nstochastic_mip = " << (stochastic_mip ? "true" : "false")
 			<< "\nmip_scale_coverage = " << mip_scale_coverage
 			<< "\nmips = " << (mips ? "true" : "false")
@@ -952,6 +1169,7 @@ struct TextureMeta {
 	float mip_scale_coverage = -0.5f;
 	bool stochastic_mip = false;
 	bool compress = true;
+	bool bc7 = false;
 };
 
 struct TextureAssetEditorWindow : AssetEditorWindow, SimpleUndoRedo {
@@ -1035,6 +1253,7 @@ struct TextureAssetEditorWindow : AssetEditorWindow, SimpleUndoRedo {
 			case gpu::TextureFormat::BC3: return "BC3";
 			case gpu::TextureFormat::BC4: return "BC4";
 			case gpu::TextureFormat::BC5: return "BC5";
+			case gpu::TextureFormat::BC7: return "BC7";
 		}
 		ASSERT(false);
 		return "Unknown";
@@ -1090,9 +1309,9 @@ struct TextureAssetEditorWindow : AssetEditorWindow, SimpleUndoRedo {
 
 		ImGuiEx::Label("Compress");
 		saveUndo(ImGui::Checkbox("##cmprs", &m_meta.compress));
-			
-		if (m_meta.compress && (m_texture->width % 4 != 0 || m_texture->height % 4 != 0)) {
-			ImGui::TextUnformatted(ICON_FA_EXCLAMATION_TRIANGLE " Block compression will not be used because texture size is not multiple of 4");
+		if (m_meta.compress && !m_meta.normalmap) {
+			ImGuiEx::Label("High quality (BC7)");
+			saveUndo(ImGui::Checkbox("##bc7", &m_meta.bc7));
 		}
 
 		bool scale_coverage = m_meta.mip_scale_coverage >= 0;
@@ -1324,13 +1543,15 @@ struct MultiEditor {
 	bool m_open;
 };
 
-struct TexturePlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
+struct TexturePlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin, TextureCompressor::IMipGenerator {
 	explicit TexturePlugin(StudioApp& app)
 		: m_app(app)
 		, m_allocator(app.getAllocator(), "texture editor")
+		, m_gpu_mips_requests(m_allocator)
 	{
 		PROFILE_FUNCTION();
 		rgbcx::init();
+		m_gpu_mips = CommandLineParser::isOn("-gpu_texture_mips");
 
 		app.getAssetCompiler().registerExtension("png", Texture::TYPE);
 		app.getAssetCompiler().registerExtension("jpeg", Texture::TYPE);
@@ -1465,13 +1686,166 @@ struct TexturePlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 		Color m_tint = Color::WHITE;
 	};
 
+	~TexturePlugin() {
+		jobs::MutexGuard guard(m_gpu_mips_mutex);
+		for (GPUMipsRequest* req : m_gpu_mips_requests) jobs::turnGreen(&req->done);
+	}
+
+	// compile jobs wait for this, it's filled on main thread in update() and completed by texture readback a few frames later
+	struct GPUMipsRequest {
+		void readCallback(Span<const u8> mem) {
+			const u8* ptr = mem.begin();
+			const u8* end = mem.end();
+			const u32 faces = src->is_cubemap ? 6 : 1;
+			success = true;
+			for (u32 face = 0; face < faces && success; ++face) {
+				for (u32 mip = 0; mip < dst->mips; ++mip) {
+					const u32 size = maximum(dst->w >> mip, 1) * maximum(dst->h >> mip, 1) * 4;
+					if (ptr + size > end) {
+						success = false;
+						break;
+					}
+					TextureCompressor::Input::Image& img = dst->add(face, 0, mip);
+					memcpy(img.pixels.getMutableData(), ptr, size);
+					ptr += size;
+				}
+			}
+			jobs::turnGreen(&done);
+		}
+
+		const TextureCompressor::Input* src;
+		TextureCompressor::Input* dst;
+		jobs::Signal done;
+		bool success = false;
+	};
+
+	bool generateMips(const TextureCompressor::Input& src, TextureCompressor::Input& dst) override {
+		if (!m_gpu_mips) return false;
+		PROFILE_FUNCTION();
+		GPUMipsRequest req;
+		req.src = &src;
+		req.dst = &dst;
+		jobs::turnRed(&req.done);
+		{
+			jobs::MutexGuard guard(m_gpu_mips_mutex);
+			m_gpu_mips_requests.push(&req);
+		}
+		jobs::wait(&req.done);
+		return req.success;
+	}
+
+	void recordGPUMips(Renderer& renderer, DrawStream& stream, GPUMipsRequest& req) {
+		const TextureCompressor::Input& src = *req.src;
+		const u32 faces = src.is_cubemap ? 6 : 1;
+		const u32 mips = req.dst->mips;
+		ASSERT(mips <= 16);
+
+		gpu::TextureHandle texture = gpu::allocTextureHandle();
+		gpu::TextureFlags flags = gpu::TextureFlags::COMPUTE_WRITE;
+		if (src.is_cubemap) flags = flags | gpu::TextureFlags::IS_CUBE;
+		stream.createTexture(texture, src.w, src.h, 1, gpu::TextureFormat::RGBA8, flags, "gpu_mips");
+		for (u32 face = 0; face < faces; ++face) {
+			const TextureCompressor::Input::Image& img = src.get(face, 0, 0);
+			stream.update(texture, 0, 0, 0, face, src.w, src.h, gpu::TextureFormat::RGBA8, img.pixels.data(), (u32)img.pixels.size());
+		}
+
+		stream.useProgram(m_gpu_mips_program);
+		for (u32 face = 0; face < faces; ++face) {
+			gpu::TextureHandle mip_views[16];
+			for (u32 mip = 0; mip < mips; ++mip) {
+				mip_views[mip] = gpu::allocTextureHandle();
+				stream.createTextureView(mip_views[mip], texture, face, mip);
+			}
+
+			for (u32 mip = 1; mip < mips; ++mip) {
+				const struct {
+					IVec2 src_size;
+					u32 flags;
+					gpu::BindlessHandle src;
+					gpu::RWBindlessHandle dst;
+				} ubdata = {
+					.src_size = IVec2(maximum(src.w >> (mip - 1), 1), maximum(src.h >> (mip - 1), 1)),
+					.flags = (src.is_srgb ? 1u : 0) | (src.is_normalmap ? 2u : 0),
+					.src = gpu::getBindlessHandle(mip_views[mip - 1]),
+					.dst = gpu::getRWBindlessHandle(mip_views[mip]),
+				};
+				const Renderer::TransientSlice ub_slice = renderer.allocUniform(&ubdata, sizeof(ubdata));
+				stream.bindUniformBuffer(4, ub_slice.buffer, ub_slice.offset, ub_slice.size);
+				stream.dispatch((maximum(src.w >> mip, 1) + 15) / 16, (maximum(src.h >> mip, 1) + 15) / 16, 1);
+				stream.memoryBarrier(texture);
+			}
+
+			for (u32 mip = 0; mip < mips; ++mip) stream.destroy(mip_views[mip]);
+		}
+
+		stream.readTexture(texture, makeDelegate<&GPUMipsRequest::readCallback>(&req));
+		stream.destroy(texture);
+	}
+
+	void processGPUMipsRequests() {
+		jobs::MutexGuard guard(m_gpu_mips_mutex);
+		if (m_gpu_mips_requests.empty()) return;
+		
+		PROFILE_FUNCTION();
+		auto* renderer = (Renderer*)m_app.getEngine().getSystemManager().getSystem("renderer");
+		DrawStream& stream = renderer->getDrawStream();
+		if (!m_gpu_mips_program) {
+			// 2x2 box filter, in linear space for srgb textures, normals are renormalized
+			static const char* mips_src = R"#(
+				struct Data {
+					int2 u_src_size;
+					uint u_flags;
+					uint u_src;
+					uint u_dst;
+				};
+
+				ConstantBuffer<Data> cb : register(b4);
+
+				float3 toLinear(float3 c) { return lerp(pow((c + 0.055) / 1.055, 2.4), c / 12.92, step(c, 0.04045)); }
+				float3 toSRGB(float3 c) { return lerp(1.055 * pow(c, 1 / 2.4) - 0.055, c * 12.92, step(c, 0.0031308)); }
+
+				float4 load(int2 coord) {
+					float4 v = bindless_textures[cb.u_src][min(coord, cb.u_src_size - 1)];
+					if (cb.u_flags & 1) v.rgb = toLinear(v.rgb);
+					return v;
+				}
+
+				[numthreads(16, 16, 1)]
+				void main(uint3 thread_id : SV_DispatchThreadID) {
+					int2 dst_size = max(cb.u_src_size >> 1, 1);
+					int2 dst = int2(thread_id.xy);
+					if (any(dst >= dst_size)) return;
+					
+					int2 src = dst * 2;
+					float4 v = (load(src) + load(src + int2(1, 0)) + load(src + int2(0, 1)) + load(src + int2(1, 1))) * 0.25;
+					if (cb.u_flags & 2) {
+						float3 n = v.xyz * 2 - 1;
+						float len = length(n);
+						v.xyz = len > 1e-5 ? n / len * 0.5 + 0.5 : float3(0.5, 0.5, 1);
+					}
+					if (cb.u_flags & 1) v.rgb = toSRGB(saturate(v.rgb));
+					bindless_rw_textures[cb.u_dst][dst] = v;
+				}
+			)#";
+
+			m_gpu_mips_program = gpu::allocProgramHandle();
+			stream.createProgram(m_gpu_mips_program, gpu::StateFlags::NONE, gpu::VertexDecl(gpu::PrimitiveType::NONE), mips_src, gpu::ShaderType::COMPUTE, nullptr, 0, "texture_mips");
+		}
+
+		stream.beginProfileBlock("texture mips", 0, false);
+		for (GPUMipsRequest* req : m_gpu_mips_requests) recordGPUMips(*renderer, stream, *req);
+		stream.endProfileBlock();
+		m_gpu_mips_requests.clear();
+	}
+
 	void update() override {
 		if (m_multi_editor) m_multi_editor->gui();
-		if (!m_jobs_tail) return;
+		processGPUMipsRequests();
+		if (!m_jobs_head) return;
 
-		TextureTileJob* job = m_jobs_tail;
-		m_jobs_tail = job->m_next;
-		if (!m_jobs_tail) m_jobs_head = nullptr;
+		// newest first, asset browser requests tiles only when they are visible
+		TextureTileJob* job = m_jobs_head;
+		m_jobs_head = job->m_next;
 
 		// to keep editor responsive, we don't want to create too many tiles per frame 
 		jobs::run(job, &TextureTileJob::execute, nullptr, jobs::getWorkersCount() - 1);
@@ -1484,10 +1858,7 @@ struct TexturePlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 			job->m_tint = tint;
 			job->m_in_path = in_path;
 			job->m_out_path = out_path;
-			if (m_jobs_head) m_jobs_head->m_next = job;
-			else {
-				m_jobs_tail = job;
-			}
+			job->m_next = m_jobs_head;
 			m_jobs_head = job;
 			return true;
 		}
@@ -1550,6 +1921,8 @@ struct TexturePlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 		options.generate_mipmaps = meta.mips;
 		options.stochastic_mipmap = meta.stochastic_mip;
 		options.scale_coverage_ref = meta.mip_scale_coverage;
+		options.bc7 = meta.bc7;
+		options.mip_generator = this;
 		return TextureCompressor::compress(input, options, dst, m_allocator);
 	}
 
@@ -1638,6 +2011,8 @@ struct TexturePlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 			options.stochastic_mipmap = meta.stochastic_mip; 
 			options.scale_coverage_ref = meta.mip_scale_coverage;
 			options.compress = meta.compress;
+			options.bc7 = meta.bc7;
+			options.mip_generator = this;
 			const bool res = TextureCompressor::compress(input, options, dst, m_allocator);
 			stbi_image_free(stb_data);
 			return res;
@@ -1679,6 +2054,11 @@ struct TexturePlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 		return m_app.getAssetCompiler().writeCompiledResource(src, Span(out.data(), (i32)out.size()));
 	}
 
+	u32 getCacheVersion(const Path& src) const override {
+		// composite textures depend on other files
+		return Path::hasExtension(src, "ltc") ? 0 : 1;
+	}
+
 	const char* getIcon() const override { return ICON_FA_FILE_IMAGE; }
 	const char* getLabel() const override { return "Texture"; }
 	ResourceType getResourceType() const override { return Texture::TYPE; }
@@ -1692,7 +2072,10 @@ struct TexturePlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 	TagAllocator m_allocator;
 	StudioApp& m_app;
 	TextureTileJob* m_jobs_head = nullptr;
-	TextureTileJob* m_jobs_tail = nullptr;
+	bool m_gpu_mips = false;
+	jobs::Mutex m_gpu_mips_mutex;
+	Array<GPUMipsRequest*> m_gpu_mips_requests;
+	gpu::ProgramHandle m_gpu_mips_program = gpu::INVALID_PROGRAM;
 	TextureMeta m_meta;
 	FilePathHash m_meta_res;
 	UniquePtr<MultiEditor<Asset>> m_multi_editor;
@@ -1971,6 +2354,8 @@ struct ImpostorTexturesContextImpl final : public ImpostorTexturesContext {
 		to_read = 4;
 	}
 
+	bool isBusy() const { return to_read != 0; }
+
 	void readCallback0(Span<const u8> data) override {
 		gb0_rgba.resize(data.length() / sizeof(u32));
 		memcpy(gb0_rgba.begin(), data.begin(), data.length());
@@ -2075,6 +2460,10 @@ struct ModelPlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 					ImGuiEx::Label("Min bake vertex AO");
 					saveUndo(ImGui::DragFloat("##minvrtxao", &m_meta.min_bake_vertex_ao, 0.01f, 0, 1));
 				}
+				ImGuiEx::Label("Build meshlets");
+				saveUndo(ImGui::Checkbox("##meshlets", &m_meta.build_meshlets));
+				ImGuiEx::Label("Compress vertices");
+				saveUndo(ImGui::Checkbox("##cmprvrtx", &m_meta.compress_vertices));
 				ImGuiEx::Label("Use specular as roughness");
 				saveUndo(ImGui::Checkbox("##spcrgh", &m_meta.use_specular_as_roughness));
 				ImGuiEx::Label("Use specular as metallic");
@@ -2547,11 +2936,15 @@ struct ModelPlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 	explicit ModelPlugin(StudioApp& app)
 		: m_app(app)
 		, m_tile(app.getAllocator())
+		, m_impostor_queue(app.getAllocator())
+		, m_impostor_context(app, app.getAllocator())
 	{
 		app.getAssetCompiler().registerExtension("fbx", Model::TYPE);
 	}
 
 	~ModelPlugin() {
+		if (m_impostor_model) m_impostor_model->decRefCount();
+		if (m_impostor_shader) m_impostor_shader->decRefCount();
 		if (m_downscale_program) m_renderer->getEndFrameDrawStream().destroy(m_downscale_program);
 		jobs::wait(&m_subres_signal);
 		
@@ -2643,9 +3036,50 @@ struct ModelPlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 		result = result && importer->write(src, meta);
 		destroyFBXImporter(*importer);
 
+		if (result && meta.create_impostor && src == filepath) {
+			// impostor textures are baked only if they do not exist, when the mesh changes, they must be recreated manually in model editor
+			const PathInfo fi(filepath);
+			const Path albedo_path(fi.dir, fi.basename, "_impostor0.tga");
+			if (!m_app.getEngine().getFileSystem().fileExists(albedo_path)) {
+				jobs::MutexGuard guard(m_impostor_mutex);
+				m_impostor_queue.push({filepath, meta.bake_impostor_normals});
+			}
+		}
+
 		return result;
 	}
 
+	// bakes impostor textures of compiled models, one model at a time, since it needs the model and its materials loaded
+	void updateImpostorBaking() {
+		if (m_impostor_context.isBusy()) return;
+		
+		if (!m_impostor_model) {
+			jobs::MutexGuard guard(m_impostor_mutex);
+			if (m_impostor_queue.empty()) return;
+			
+			ResourceManagerHub& rm = m_app.getEngine().getResourceManager();
+			if (!m_impostor_shader) m_impostor_shader = rm.load<Shader>(Path("shaders/impostor_shadow.hlsl"));
+			m_impostor_bake_normals = m_impostor_queue.last().bake_normals;
+			m_impostor_model = rm.load<Model>(m_impostor_queue.last().path);
+			m_impostor_queue.pop();
+		}
+
+		if (m_impostor_model->isFailure()) {
+			logError("Failed to create impostor textures for ", m_impostor_model->getPath());
+			m_impostor_model->decRefCount();
+			m_impostor_model = nullptr;
+			return;
+		}
+		if (!m_impostor_model->isReady() || !m_impostor_shader->isReady()) return;
+
+		ModelImporter* importer = createFBXImporter(m_app, m_app.getAllocator());
+		importer->init();
+		importer->createImpostorTextures(m_impostor_model, m_impostor_context, m_impostor_bake_normals);
+		destroyFBXImporter(*importer);
+		m_impostor_model->decRefCount();
+		m_impostor_model = nullptr;
+	}
+
 
 	void createTileWorld()
 	{
@@ -2732,6 +3166,7 @@ struct ModelPlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 	void update() override
 	{
 		if (m_multi_editor) m_multi_editor->gui();
+		updateImpostorBaking();
 		if (m_tile.waiting) {
 			if (!m_app.getEngine().getFileSystem().hasWork()) {
 				renderPrefabSecondStage();
@@ -2768,12 +3203,14 @@ struct ModelPlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 		if (m_tile.entity.isValid()) return;
 		if (m_tile.queue.empty()) return;
 
+		// newest first, asset browser requests tiles only when they are visible
 		for (u32 i = 0; i < 8; ++i) {
 			if (i >= (u32)m_tile.queue.size()) break;
 
-			TileData::Job* job = m_tile.queue[i];
+			const u32 idx = m_tile.queue.size() - 1 - i;
+			TileData::Job* job = m_tile.queue[idx];
 			if (job->prepare(*this) && !m_tile.wait_for_readback) {
-				m_tile.queue.erase(i);
+				m_tile.queue.erase(idx);
 				job->execute(*this);
 				LUMIX_DELETE(m_app.getAllocator(), job);
 				break;
@@ -3106,12 +3543,23 @@ struct ModelPlugin final : AssetBrowser::IPlugin, AssetCompiler::IPlugin {
 		ModelMeta meta;
 	};
 
+	struct ImpostorRequest {
+		Path path;
+		bool bake_normals;
+	};
+
 	StudioApp& m_app;
 	Renderer* m_renderer = nullptr;
 	TexturePlugin* m_texture_plugin;
 	jobs::Counter m_subres_signal;
 	gpu::ProgramHandle m_downscale_program = gpu::INVALID_PROGRAM;
 	UniquePtr<MultiEditor<Asset>> m_multi_editor;
+	jobs::Mutex m_impostor_mutex;
+	Array<ImpostorRequest> m_impostor_queue;
+	ImpostorTexturesContextImpl m_impostor_context;
+	Model* m_impostor_model = nullptr;
+	Shader* m_impostor_shader = nullptr;
+	bool m_impostor_bake_normals = false;
 };
 
 struct CodeEditorWindow : AssetEditorWindow {
@@ -3510,6 +3958,7 @@ struct EnvironmentProbePlugin final : PropertyGrid::IPlugin {
 		, m_model_plugin(model_plugin)
 		, m_generate_action("Studio", "Generate probes", "Generate probes", "generate_probes", "", Action::TOOL)
 		, m_add_bounce_action("Studio", "Add bounce", "Add light bounce to probes", "probes_add_bounce", "", Action::TOOL)
+		, m_generate_selected_action("Studio", "Generate selected probes", "Generate selected probes", "generate_selected_probes", "", Action::TOOL)
 	{}
 
 	~EnvironmentProbePlugin() {
@@ -3525,19 +3974,12 @@ struct EnvironmentProbePlugin final : PropertyGrid::IPlugin {
 		m_ibl_filter_shader = rm.load<Shader>(Path("shaders/ibl_filter.hlsl"));
 	}
 
-	bool saveCubemap(u64 probe_guid, const Vec4* data, u32 texture_size, u32 num_src_mips, u32 num_saved_mips) {
+	// RGBM encoded and compressed to BC3, runs in a worker job, so probes are compressed in parallel
+	static bool compressCubemap(const Vec4* data, u32 texture_size, u32 num_src_mips, u32 num_saved_mips, OutputMemoryStream& blob, IAllocator& allocator) {
+		PROFILE_FUNCTION();
 		ASSERT(data);
-		const char* base_path = m_app.getEngine().getFileSystem().getBasePath();
-		Path path(base_path, "probes_tmp/");
-		if (!os::makePath(path.c_str()) && !os::dirExists(path)) {
-			logError("Failed to create ", path);
-		}
-		path.append(probe_guid, ".lbc");
-
-		OutputMemoryStream blob(m_app.getAllocator());
-
 		const Vec4* mip_pixels = data;
-		TextureCompressor::Input input(texture_size, texture_size, 1, num_saved_mips, m_app.getAllocator());
+		TextureCompressor::Input input(texture_size, texture_size, 1, num_saved_mips, allocator);
 		for (int face = 0; face < 6; ++face) {
 			for (u32 mip = 0; mip < num_src_mips; ++mip) {
 				const u32 mip_size = texture_size >> mip;
@@ -3557,20 +3999,77 @@ struct EnvironmentProbePlugin final : PropertyGrid::IPlugin {
 		}
 		input.has_alpha = true;
 		input.is_cubemap = true;
-		if (!TextureCompressor::compress(input, TextureCompressor::Options(), blob, m_app.getAllocator())) return false;
+		return TextureCompressor::compress(input, TextureCompressor::Options(), blob, allocator);
+	}
 
-		os::OutputFile file;
-		if (!file.open(path.c_str())) {
-			logError("Failed to create ", path);
+	// all reflection probes are in one file, newly baked probes replace their entries, other entries are kept,
+	// so only a subset of probes can be rebaked
+	bool saveReflectionProbesPack() {
+		FileSystem& fs = m_app.getEngine().getFileSystem();
+		IAllocator& allocator = m_app.getAllocator();
+
+		struct Item {
+			u64 guid;
+			const u8* data;
+			u32 size;
+		};
+		Array<Item> items(allocator);
+		for (ProbeJob* job : m_probe_jobs) {
+			if (!job->is_reflection || job->compressed.empty()) continue;
+			items.push({job->reflection_probe.guid, job->compressed.data(), (u32)job->compressed.size()});
+		}
+		if (items.empty()) return true;
+
+		OutputMemoryStream old_pack(allocator);
+		if (fs.fileExists(ReflectionProbesPack::PATH) && fs.getContentSync(Path(ReflectionProbesPack::PATH), old_pack)) {
+			InputMemoryStream blob(old_pack);
+			ReflectionProbesPack::Header header;
+			if (old_pack.size() >= sizeof(header)) blob.read(header);
+			const bool valid = header.magic == ReflectionProbesPack::MAGIC
+				&& header.version == ReflectionProbesPack::VERSION
+				&& header.count * sizeof(ReflectionProbesPack::Entry) <= blob.remaining();
+			const u32 count = valid ? header.count : 0;
+			for (u32 i = 0; i < count; ++i) {
+				const ReflectionProbesPack::Entry entry = blob.read<ReflectionProbesPack::Entry>();
+				if (entry.offset + (u64)entry.size > old_pack.size()) continue;
+				const bool rebaked = items.find([&](const Item& item){ return item.guid == entry.guid; }) >= 0;
+				if (!rebaked) items.push({entry.guid, old_pack.data() + entry.offset, entry.size});
+			}
+		}
+
+		OutputMemoryStream pack(allocator);
+		ReflectionProbesPack::Header header;
+		header.count = items.size();
+		pack.write(header);
+		u32 offset = sizeof(header) + items.size() * sizeof(ReflectionProbesPack::Entry);
+		for (const Item& item : items) {
+			ReflectionProbesPack::Entry entry;
+			entry.guid = item.guid;
+			entry.offset = offset;
+			entry.size = item.size;
+			pack.write(entry);
+			offset += item.size;
+		}
+		for (const Item& item : items) pack.write(item.data, item.size);
+
+		if (!fs.saveContentSync(Path(ReflectionProbesPack::PATH), pack)) {
+			logError("Failed to save ", ReflectionProbesPack::PATH);
 			return false;
 		}
-		bool res = file.write(blob.data(), blob.size());
-		file.close();
-		return res;
+
+		// probes baked before packing are in separate files
+		const char* base_path = fs.getBasePath();
+		for (ProbeJob* job : m_probe_jobs) {
+			if (!job->is_reflection || job->compressed.empty()) continue;
+			const Path lbc_path(base_path, "probes/", job->reflection_probe.guid, ".lbc");
+			if (os::fileExists(lbc_path)) os::deleteFile(lbc_path);
+		}
+		return true;
 	}
 
 
-	void generateProbes(bool bounce, World& world) {
+	// `selected_only` - rebake only selected probes, the rest is kept as is
+	void generateProbes(bool bounce, World& world, bool selected_only = false) {
 		if (!m_probe_jobs.empty()) return;
 
 		m_pipeline->setIndirectLightMultiplier(bounce ? 1.f : 0.f);
@@ -3578,9 +4077,17 @@ struct EnvironmentProbePlugin final : PropertyGrid::IPlugin {
 		RenderModule* module = (RenderModule*)world.getModule(ENVIRONMENT_PROBE_TYPE);
 		const Span<EntityRef> env_probes = module->getEnvironmentProbesEntities();
 		const Span<EntityRef> reflection_probes = module->getReflectionProbesEntities();
+		const Span<const EntityRef> selected = m_app.getWorldEditor().getSelectedEntities();
+		auto is_selected = [&](EntityRef e){
+			for (EntityRef s : selected) {
+				if (s == e) return true;
+			}
+			return false;
+		};
 		m_probe_jobs.reserve(env_probes.length() + reflection_probes.length());
 		IAllocator& allocator = m_app.getAllocator();
 		for (EntityRef p : env_probes) {
+			if (selected_only && !is_selected(p)) continue;
 			ProbeJob* job = LUMIX_NEW(m_app.getAllocator(), ProbeJob)(*this, world, p, allocator);
 			
 			job->env_probe = module->getEnvironmentProbe(p);
@@ -3591,6 +4098,7 @@ struct EnvironmentProbePlugin final : PropertyGrid::IPlugin {
 		}
 
 		for (EntityRef p : reflection_probes) {
+			if (selected_only && !is_selected(p)) continue;
 			ProbeJob* job = LUMIX_NEW(m_app.getAllocator(), ProbeJob)(*this, world, p, allocator);
 			
 			job->reflection_probe = module->getReflectionProbe(p);
@@ -3607,6 +4115,7 @@ struct EnvironmentProbePlugin final : PropertyGrid::IPlugin {
 		ProbeJob(EnvironmentProbePlugin& plugin, World& world, EntityRef& entity, IAllocator& allocator) 
 			: entity(entity)
 			, data(allocator)
+			, compressed(allocator)
 			, plugin(plugin)
 			, world(world)
 		{}
@@ -3622,6 +4131,8 @@ struct EnvironmentProbePlugin final : PropertyGrid::IPlugin {
 
 		World& world;
 		Array<Vec4> data;
+		// lbc of reflection probe
+		OutputMemoryStream compressed;
 		SphericalHarmonics sh;
 		bool render_dispatched = false;
 		bool done = false;
@@ -3718,10 +4229,20 @@ struct EnvironmentProbePlugin final : PropertyGrid::IPlugin {
 
 			struct Callback {
 				void callback(Span<const u8> mem) {
-					const u32 num_mips = 1 + log2(texture_size);
-					plugin->saveCubemap(job->reflection_probe.guid, (const Vec4*)mem.begin(), texture_size, num_mips, roughness_levels);
-					memoryBarrier();
-					job->done = true;
+					job->data.resize(u32(mem.length() / sizeof(Vec4)));
+					memcpy(job->data.begin(), mem.begin(), job->data.byte_size());
+					jobs::runLambda([job = job, texture_size = texture_size](){
+						const u32 num_mips = 1 + log2(texture_size);
+						IAllocator& allocator = job->plugin.m_app.getAllocator();
+						if (!compressCubemap(job->data.begin(), texture_size, num_mips, roughness_levels, job->compressed, allocator)) {
+							logError("Failed to compress reflection probe ", job->reflection_probe.guid);
+							job->compressed.clear();
+						}
+						// free readback memory, only compressed data are kept until all probes are done
+						job->data = Array<Vec4>(allocator);
+						memoryBarrier();
+						job->done = true;
+					}, nullptr);
 					LUMIX_DELETE(*allocator, this);
 				}
 				EnvironmentProbePlugin* plugin;
@@ -3769,6 +4290,7 @@ struct EnvironmentProbePlugin final : PropertyGrid::IPlugin {
 		World& world = *m_app.getWorldEditor().getWorld();
 		if (m_app.checkShortcut(m_add_bounce_action, true)) generateProbes(true, world);
 		if (m_app.checkShortcut(m_generate_action, true)) generateProbes(false, world);
+		if (m_app.checkShortcut(m_generate_selected_action, true)) generateProbes(false, world, true);
 
 		if (m_ibl_filter_shader->isReady() && !m_ibl_filter_program) {
 			m_ibl_filter_program = m_ibl_filter_shader->getProgram(gpu::StateFlags::NONE, gpu::VertexDecl(gpu::PrimitiveType::TRIANGLE_STRIP), 0, "");
@@ -3799,15 +4321,23 @@ struct EnvironmentProbePlugin final : PropertyGrid::IPlugin {
 			m_done_counter = 0;
 		}
 
+		// several probes are rendered per frame and read back and compressed in parallel
+		memoryBarrier();
+		u32 in_flight = 0;
+		for (ProbeJob* j : m_probe_jobs) {
+			if (j->render_dispatched && !j->done) ++in_flight;
+		}
+		u32 rendered = 0;
 		for (ProbeJob* j : m_probe_jobs) {
+			if (in_flight >= MAX_PROBES_IN_FLIGHT || rendered >= MAX_PROBES_RENDERED_PER_FRAME) break;
 			if (!j->render_dispatched) {
 				j->render_dispatched = true;
 				render(*j);
-				break;
+				++in_flight;
+				++rendered;
 			}
 		}
 
-		memoryBarrier();
 		for (ProbeJob* j : m_probe_jobs) {
 			if (j->done && !j->done_counted) {
 				j->done_counted = true;
@@ -3821,6 +4351,8 @@ struct EnvironmentProbePlugin final : PropertyGrid::IPlugin {
 			if (!os::dirExists(dir_path) && !os::makePath(dir_path.c_str())) {
 				logError("Failed to create ", dir_path);
 			}
+			saveReflectionProbesPack();
+
 			RenderModule* module = nullptr;
 			while (!m_probe_jobs.empty()) {
 				ProbeJob& job = *m_probe_jobs.back();
@@ -3828,20 +4360,7 @@ struct EnvironmentProbePlugin final : PropertyGrid::IPlugin {
 				ASSERT(job.done);
 				ASSERT(job.done_counted);
 
-				if (job.is_reflection) {
-
-					const u64 guid = job.reflection_probe.guid;
-
-					const Path tmp_path(base_path, "/probes_tmp/", guid, ".lbc");
-					const Path path(base_path, "/probes/", guid, ".lbc");
-					if (!os::fileExists(tmp_path)) {
-						if (module) module->reloadReflectionProbes();
-						return;
-					}
-					if (!os::moveFile(tmp_path, path)) {
-						logError("Failed to move file ", tmp_path, " to ", path);
-					}
-				}
+				if (job.is_reflection) module = (RenderModule*)job.world.getModule(REFLECTION_PROBE_TYPE);
 
 				if (job.world.hasComponent(job.entity, ENVIRONMENT_PROBE_TYPE)) {
 					module = (RenderModule*)job.world.getModule(ENVIRONMENT_PROBE_TYPE);
@@ -3892,11 +4411,14 @@ struct EnvironmentProbePlugin final : PropertyGrid::IPlugin {
 	gpu::ProgramHandle m_ibl_filter_program = gpu::INVALID_PROGRAM;
 	
 	// TODO to be used with http://casual-effects.blogspot.com/2011/08/plausible-environment-lighting-in-two.html
+	static constexpr u32 MAX_PROBES_IN_FLIGHT = 8;
+	static constexpr u32 MAX_PROBES_RENDERED_PER_FRAME = 4;
 	Array<ProbeJob*> m_probe_jobs;
 	u32 m_done_counter = 0;
 	u32 m_probe_counter = 0;
 	Action m_generate_action;
 	Action m_add_bounce_action;
+	Action m_generate_selected_action;
 };
 
 struct InstancedModelPlugin final : PropertyGrid::IPlugin, StudioApp::MousePlugin {
@@ -4435,7 +4957,7 @@ struct ProceduralGeomPlugin final : PropertyGrid::IPlugin, StudioApp::MousePlugi
 		, const World& world
 		, EntityRef entity
 		, ProceduralGeometry& pg
-		, Renderer& renderer) const
+		, RenderModule& module) const
 	{
 		if (!m_is_open) return;
 		if (pg.vertex_data.size() == 0) return;
@@ -4453,11 +4975,17 @@ struct ProceduralGeomPlugin final : PropertyGrid::IPlugin, StudioApp::MousePlugi
 		const u32 offset = pg.vertex_decl.attributes[4].byte_offset + (m_paint_as_color ? 0 : m_brush_channel);
 		ImGuiIO& io = ImGui::GetIO();
 		const u8 color[4] = { u8(m_brush_color.x * 0xff), u8(m_brush_color.y * 0xff), u8(m_brush_color.z * 0xff), u8(m_brush_color.w * 0xff) };
-		for (u8* iter = pg.vertex_data.getMutableData(); iter < end; iter += stride) {
+		u8* const begin = pg.vertex_data.getMutableData();
+		// only painted range is uploaded
+		u8* painted_from = nullptr;
+		u8* painted_to = nullptr;
+		for (u8* iter = begin; iter < end; iter += stride) {
 			Vec3 p;
 			memcpy(&p, iter, sizeof(p));
 
 			if (squaredLength(p - center) < R2) {
+				if (!painted_from) painted_from = iter;
+				painted_to = iter + stride;
 				if (m_paint_as_color) {
 					memcpy(iter + offset, color, pg.vertex_decl.attributes[4].components_count);
 				}
@@ -4467,9 +4995,8 @@ struct ProceduralGeomPlugin final : PropertyGrid::IPlugin, StudioApp::MousePlugi
 			}
 		}
 
-		if (pg.vertex_buffer) renderer.getEndFrameDrawStream().destroy(pg.vertex_buffer);
-		const Renderer::MemRef mem = renderer.copy(pg.vertex_data.data(), (u32)pg.vertex_data.size());
-		pg.vertex_buffer = renderer.createBuffer(mem, gpu::BufferFlags::IMMUTABLE, "pg_vertices");	
+		if (!painted_from) return;
+		module.updateProceduralGeometryVertices(entity, u32(painted_from - begin), Span((const u8*)painted_from, (const u8*)painted_to));
 	}
 
 	bool paint(WorldView& view, i32 x, i32 y) {
@@ -4491,11 +5018,8 @@ struct ProceduralGeomPlugin final : PropertyGrid::IPlugin, StudioApp::MousePlugi
 		if (!hit.is_hit) return false;
 		if (hit.entity != entity) return false;
 
-		Renderer* renderer = (Renderer*)editor.getEngine().getSystemManager().getSystem("renderer");
-		ASSERT(renderer);
-
 		ProceduralGeometry& pg = module->getProceduralGeometry(entity);
-		paint(hit.origin + hit.t * hit.dir, world, entity, pg, *renderer);
+		paint(hit.origin + hit.t * hit.dir, world, entity, pg, *module);
 
 		return true;
 	}
@@ -4904,6 +5428,10 @@ struct EditorUIRenderPlugin final : StudioApp::GUIPlugin
 
 	const char* getName() const override { return "editor_ui_render"; }
 
+	// shaders compiled in editor (and in previous editor sessions, see local cache) are shipped with the game
+	// after "Precompile used shaders", only permutations recorded in ShaderUsage::FILENAME are shipped
+	bool exportData(const char* dest_dir) override { return gpu::saveShaderCache(dest_dir, m_export_used_shaders_only); }
+
 	void shutdownImGui()
 	{
 		ImGui::DestroyContext();
@@ -5120,6 +5648,7 @@ struct EditorUIRenderPlugin final : StudioApp::GUIPlugin
 	HashMap<void*, gpu::ProgramHandle> m_programs;
 	Local<RenderInterfaceImpl> m_render_interface;
 	Array<gpu::TextureHandle> m_imgui_textures;
+	bool m_export_used_shaders_only = false;
 };
 
 struct AddTerrainComponentPlugin final : StudioApp::IAddComponentPlugin {
@@ -5326,7 +5855,44 @@ struct StudioAppPlugin : StudioApp::IPlugin
 				renderer->getDrawStream().captureFrame();
 			}
 		}
+		if (m_draw_stream_capture_action.get()) {
+			if (m_app.checkShortcut(*m_draw_stream_capture_action, true)) {
+				auto* renderer = (Renderer*)m_app.getEngine().getSystemManager().getSystem("renderer");
+				renderer->captureDrawStream("draw_stream.ldc");
+			}
+		}
 		//Local<Action> m_renderdoc_capture_action{"Capture frame", "Tools - capture frame with RenderDoc", "capture_renderdoc", "", Action::TOOL};
+
+		if (m_app.checkShortcut(m_shader_usage_report_action, true)) {
+			if (loadShaderUsage()) m_shader_usage->logReport();
+		}
+		if (m_app.checkShortcut(m_precompile_shaders_action, true) && loadShaderUsage()) {
+			// stages compiled or found in caches from now on are exported, see EditorUIRenderPlugin::exportData
+			gpu::trackShaderCacheUsage();
+			m_precompiling_shaders = true;
+		}
+		if (m_precompiling_shaders) {
+			auto* renderer = (Renderer*)m_app.getEngine().getSystemManager().getSystem("renderer");
+			if (m_shader_usage->precompile(*renderer)) {
+				m_precompiling_shaders = false;
+				m_editor_ui_render_plugin.m_export_used_shaders_only = true;
+			}
+		}
+	}
+
+	// permutations recorded by games run with -shader_usage, files from several runs can be concatenated
+	bool loadShaderUsage() {
+		if (m_precompiling_shaders) return true;
+		// reloaded, so changes in the file are visible without restarting the editor
+		if (m_shader_usage.get()) m_shader_usage.destroy();
+		m_shader_usage.create(m_app.getAllocator());
+		const StaticString<MAX_PATH> path(m_app.getEngine().getFileSystem().getBasePath(), "/", ShaderUsage::FILENAME);
+		if (!m_shader_usage->load(path)) {
+			logError("Could not load ", path, ", run the game with -shader_usage to create it");
+			m_shader_usage.destroy();
+			return false;
+		}
+		return true;
 	}
 
 	const char* getName() const override { return "renderer"; }
@@ -5341,6 +5907,9 @@ struct StudioAppPlugin : StudioApp::IPlugin
 		if (CommandLineParser::isOn("-renderdoc")) {
 			m_renderdoc_capture_action.create("Studio", "Capture frame", "Capture frame with RenderDoc", "capture_renderdoc", "", Action::TOOL);
 		}
+		if (CommandLineParser::isOn("-gpu_capture")) {
+			m_draw_stream_capture_action.create("Studio", "Capture draw stream", "Capture frame's draw streams for gpu_replay", "capture_draw_stream", "", Action::TOOL);
+		}
 
 		AddTerrainComponentPlugin* add_terrain_plugin = LUMIX_NEW(allocator, AddTerrainComponentPlugin)(m_app);
 		m_app.registerComponent(ICON_FA_MAP, "terrain", *add_terrain_plugin);
@@ -5623,6 +6192,11 @@ struct StudioAppPlugin : StudioApp::IPlugin
 	StudioApp& m_app;
 	ModelImporter* m_fbx_importer = nullptr; // only for preloading impostor shadow shader // TODO do this in a better way
 	Local<Action> m_renderdoc_capture_action;
+	Local<Action> m_draw_stream_capture_action;
+	Action m_precompile_shaders_action{"Studio", "Precompile used shaders", "Compile shader permutations recorded with -shader_usage, only those are exported", "precompile_used_shaders", "", Action::TOOL};
+	Action m_shader_usage_report_action{"Studio", "Shader usage report", "Log number of shader permutations recorded with -shader_usage per shader and define", "shader_usage_report", "", Action::TOOL};
+	Local<ShaderUsage> m_shader_usage;
+	bool m_precompiling_shaders = false;
 	UniquePtr<ParticleEditor> m_particle_editor;
 	EditorUIRenderPlugin m_editor_ui_render_plugin;
 	MaterialPlugin m_material_plugin;
@@ -5657,6 +6231,117 @@ void createModelEditor(const Path& path, StudioApp& app) {
 	app.getAssetBrowser().addWindow(win.move());
 }
 
+bool packTextureAtlas(StudioApp& app, TextureAtlas& atlas) {
+	PROFILE_FUNCTION();
+	FileSystem& fs = app.getEngine().getFileSystem();
+	IAllocator& allocator = app.getAllocator();
+	Array<stbrp_rect> rects(allocator);
+	rects.reserve(atlas.images.size());
+	OutputMemoryStream data(allocator);
+	u64 area = 0;
+	for (TextureAtlas::Image& img : atlas.images) {
+		data.clear();
+		if (!fs.getContentSync(img.path, data)) {
+			logError("Failed to read ", img.path);
+			return false;
+		}
+		int w, h, comps;
+		if (!stbi_info_from_memory(data.data(), (int)data.size(), &w, &h, &comps)) {
+			logError(img.path, ": unsupported image format");
+			return false;
+		}
+		img.w = w;
+		img.h = h;
+		stbrp_rect& r = rects.emplace();
+		r = {};
+		r.id = i32(&img - atlas.images.begin());
+		r.w = stbrp_coord(w + 2 * atlas.padding);
+		r.h = stbrp_coord(h + 2 * atlas.padding);
+		area += u64(r.w) * r.h;
+	}
+
+	// block compression needs sizes divisible by 4
+	u32 w = 4, h = 4;
+	auto grow = [&](){ if (w > h) h *= 2; else w *= 2; };
+	while (u64(w) * h < area) grow();
+
+	Array<stbrp_node> nodes(allocator);
+	for (;;) {
+		if (w > atlas.max_size || h > atlas.max_size) {
+			logError("Images do not fit in ", atlas.max_size, "x", atlas.max_size, " atlas");
+			return false;
+		}
+		nodes.resize(w);
+		stbrp_context ctx;
+		stbrp_init_target(&ctx, w, h, nodes.begin(), nodes.size());
+		if (stbrp_pack_rects(&ctx, rects.begin(), rects.size())) break;
+		grow();
+	}
+
+	for (const stbrp_rect& r : rects) {
+		TextureAtlas::Image& img = atlas.images[r.id];
+		img.x = r.x + atlas.padding;
+		img.y = r.y + atlas.padding;
+	}
+	atlas.width = w;
+	atlas.height = h;
+	return true;
+}
+
+bool compileTextureAtlas(StudioApp& app, TextureAtlas& atlas, OutputMemoryStream& out) {
+	PROFILE_FUNCTION();
+	if (!packTextureAtlas(app, atlas)) return false;
+
+	FileSystem& fs = app.getEngine().getFileSystem();
+	IAllocator& allocator = app.getAllocator();
+	TextureCompressor::Input input(atlas.width, atlas.height, 1, 1, allocator);
+	input.is_srgb = atlas.srgb;
+	input.has_alpha = true;
+	TextureCompressor::Input::Image& dst = input.add(0, 0, 0);
+	memset(dst.pixels.getMutableData(), 0, dst.pixels.size());
+	u32* dst_pixels = (u32*)dst.pixels.getMutableData();
+
+	OutputMemoryStream data(allocator);
+	for (const TextureAtlas::Image& img : atlas.images) {
+		data.clear();
+		if (!fs.getContentSync(img.path, data)) {
+			logError("Failed to read ", img.path);
+			return false;
+		}
+		int w, h, comps;
+		stbi_uc* pixels = stbi_load_from_memory(data.data(), (int)data.size(), &w, &h, &comps, 4);
+		if (!pixels) {
+			logError("Failed to load ", img.path);
+			return false;
+		}
+		if (u32(w) != img.w || u32(h) != img.h) {
+			logError(img.path, " changed while packing atlas");
+			stbi_image_free(pixels);
+			return false;
+		}
+
+		const i32 pad = atlas.padding;
+		for (i32 j = -pad; j < h + pad; ++j) {
+			const i32 src_y = clamp(j, 0, h - 1);
+			for (i32 i = -pad; i < w + pad; ++i) {
+				const i32 src_x = clamp(i, 0, w - 1);
+				const u32 dst_idx = u32(img.x + i) + u32(img.y + j) * atlas.width;
+				memcpy(&dst_pixels[dst_idx], &pixels[(src_x + src_y * w) * 4], 4);
+			}
+		}
+		stbi_image_free(pixels);
+	}
+
+	out.write("lbc", 3);
+	const u32 flags = atlas.srgb ? (u32)Texture::Flags::SRGB : 0;
+	out.write(flags);
+	TextureCompressor::Options options;
+	// mips would mix neighbouring images
+	options.generate_mipmaps = false;
+	options.compress = atlas.compress;
+	return TextureCompressor::compress(input, options, out, allocator);
+}
+
 }
 
 LUMIX_STUDIO_ENTRY(renderer) {
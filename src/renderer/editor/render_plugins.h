@@ -1,10 +1,41 @@
 #pragma once
 
+#include "core/array.h"
+#include "core/path.h"
+
 namespace Lumix {
 
-struct Path;
+struct OutputMemoryStream;
 struct StudioApp;
 
+// images packed in one texture, e.g. GUI sprites, so they can be drawn without switching textures
+struct TextureAtlas {
+	struct Image {
+		Path path;
+		// rect in the atlas, without padding, in pixels
+		u32 x = 0;
+		u32 y = 0;
+		u32 w = 0;
+		u32 h = 0;
+	};
+
+	TextureAtlas(IAllocator& allocator) : images(allocator) {}
+
+	Array<Image> images;
+	// edge pixels are repeated into padding, so neighbours do not bleed in when filtering
+	u32 padding = 2;
+	u32 max_size = 4096;
+	bool compress = true;
+	bool srgb = false;
+	u32 width = 0;
+	u32 height = 0;
+};
+
 LUMIX_RENDERER_API void createModelEditor(const Path& path, StudioApp& app);
+// reads only sizes of `atlas.images` and places them in the smallest power of two texture
+// the placement depends only on the sizes and the order of the images, so it can be computed separately for each image
+LUMIX_RENDERER_API bool packTextureAtlas(StudioApp& app, TextureAtlas& atlas);
+// packs `atlas` and writes the compiled texture to `out`
+LUMIX_RENDERER_API bool compileTextureAtlas(StudioApp& app, TextureAtlas& atlas, OutputMemoryStream& out);
 
-} // namespace Lumix
\ No newline at end of file
+} // namespace Lumix
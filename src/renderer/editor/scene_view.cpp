@@ -649,7 +649,6 @@ struct SceneView::RenderPlugin : Lumix::RenderPlugin {
 				const u32 skinned_define = 1 << renderer.getShaderDefineIdx("SKINNED");
 				const u32 depth_define = 1 << renderer.getShaderDefineIdx("DEPTH");
 				const DVec3 view_pos = m_scene_view.m_view->getViewport().pos;
-				Array<DualQuat> dq_pose(renderer.getAllocator());
 				for (EntityRef e : entities) {
 					if (!module->getWorld().hasComponent(e, MODEL_INSTANCE_TYPE)) continue;
 
@@ -657,6 +656,12 @@ struct SceneView::RenderPlugin : Lumix::RenderPlugin {
 					if (!model || !model->isReady()) continue;
 
 					const Pose* pose = module->lockPose(e);
+					// shared by all skinned meshes of the model
+					Renderer::TransientSlice bones = {};
+					if (pose && pose->count > 0) {
+						bones = renderer.allocTransient(sizeof(DualQuat) * pose->count);
+						computeSkinningPalette(*model, *pose, (DualQuat*)bones.ptr);
+					}
 					for (int i = 0; i <= model->getLODIndices()[0].to; ++i) {
 						const Mesh& mesh = model->getMesh(i);
 						const MeshMaterial& mesh_mat = model->getMeshMaterial(i);
@@ -664,19 +669,10 @@ struct SceneView::RenderPlugin : Lumix::RenderPlugin {
 						Material* material = mesh_mat.material;
 						u32 define_mask = material->getDefineMask() | depth_define;
 						const Matrix mtx = world.getRelativeMatrix(e, view_pos);
-						dq_pose.clear();
-						if (pose && pose->count > 0 && mesh.type == Mesh::SKINNED) {
-							define_mask |= skinned_define;
-							dq_pose.reserve(pose->count);
-							for (int j = 0, c = pose->count; j < c; ++j) {
-								const Model::Bone& bone = model->getBone(j);
-								const LocalRigidTransform tmp = {pose->positions[j], pose->rotations[j]};
-								dq_pose.push((tmp * bone.inv_bind_transform).toDualQuat());
-							}
-						}
+						const bool is_skinned = pose && pose->count > 0 && mesh.type == Mesh::SKINNED;
 			
 						Renderer::TransientSlice ub;
-						if (dq_pose.empty()) {
+						if (!is_skinned) {
 							struct UBData {
 								Matrix mtx;
 								MaterialIndex material_index;
@@ -687,22 +683,17 @@ struct SceneView::RenderPlugin : Lumix::RenderPlugin {
 							ub = renderer.allocUniform(&ub_data, sizeof(ub_data));
 						}
 						else {
-							struct UBPrefix {
-								float layer;
-								float fur_scale;
-								float gravity;
-								float padding;
-								Matrix model_mtx;
-								// DualQuat bones[];
-							};
-
-							ub = renderer.allocUniform(sizeof(UBPrefix) + dq_pose.byte_size());
-							UBPrefix* dc = (UBPrefix*)ub.ptr;
-							dc->layer = 0;
+							define_mask |= skinned_define;
+							ub = renderer.allocUniform(sizeof(SkinnedDrawcallUniforms));
+							SkinnedDrawcallUniforms* dc = (SkinnedDrawcallUniforms*)ub.ptr;
 							dc->fur_scale = 0;
 							dc->gravity = 0;
+							dc->layers = 1;
+							dc->material_index = material->getIndex();
 							dc->model_mtx = mtx;
-							memcpy(ub.ptr + sizeof(UBPrefix), dq_pose.begin(), dq_pose.byte_size());
+							dc->prev_model_mtx = mtx;
+							dc->bones = gpu::getBindlessHandle(bones.buffer);
+							dc->bones_offset = bones.offset;
 						}
 		
 						const gpu::StateFlags state = gpu::StateFlags::DEPTH_WRITE | gpu::StateFlags::DEPTH_FUNCTION;
@@ -1514,7 +1505,8 @@ void SceneView::cameraPreviewGUI(Vec2 size) {
 
 	m_camera_preview_pipeline->setWorld(m_editor.getWorld());
 	m_camera_preview_pipeline->setViewport(vp);
-	m_camera_preview_pipeline->render(false);
+	if (m_rendered_this_frame) m_camera_preview_pipeline->render(false);
+	else m_camera_preview_pipeline->skipRender();
 	const gpu::TextureHandle texture_handle = m_camera_preview_pipeline->getOutput();
 
 	if (!texture_handle) return;
@@ -1707,7 +1699,14 @@ void SceneView::onGUI() {
 		vp.h = (int)view_size.y;
 		m_view->setViewport(vp);
 		m_pipeline->setViewport(vp);
-		m_pipeline->render(false);
+		const bool focused = ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows) || ImGui::IsWindowHovered(ImGuiHoveredFlags_RootAndChildWindows);
+		// input can change gizmos, hover highlights or debug options of the pipeline
+		if (focused && m_app.getEvents().length() > 0) m_throttle.invalidate();
+		m_rendered_this_frame = is_game_mode 
+			? m_throttle.shouldRender(focused)
+			: m_throttle.shouldRender(ViewThrottle::getWorldViewState(vp, m_editor), focused);
+		if (m_rendered_this_frame) m_pipeline->render(false);
+		else m_pipeline->skipRender();
 		profiler::pushInt("Width", vp.w);
 		profiler::pushInt("Height", vp.h);
 		m_view->m_draw_vertices.clear();
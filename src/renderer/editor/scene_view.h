@@ -5,6 +5,7 @@
 #include "editor/render_interface.h"
 #include "editor/studio_app.h"
 #include "editor/text_filter.h"
+#include "editor/utils.h"
 #include "core/allocator.h"
 #include "renderer/gpu/gpu.h"
 #include "renderer/pipeline.h"
@@ -119,6 +120,9 @@ private:
 	bool m_show_camera_preview = true;
 	bool m_mouse_wheel_changes_speed = true;
 	bool m_was_game_mode = false;
+	ViewThrottle m_throttle;
+	// the camera preview is rendered only when the view is, it shows the same world
+	bool m_rendered_this_frame = false;
 	bool m_use_grid_snapping = false;
 
 	WorldEditor& m_editor;
@@ -93,6 +93,7 @@ struct FillClearGrassCommand final : IEditorCommand {
 		texture->onDataUpdated(0, 0, texture->width, texture->height);
 
 		RenderModule* module = (RenderModule*)m_world_editor.getWorld()->getModule(TERRAIN_TYPE);
+		module->getTerrain(m_terrain)->onMapUpdated(*texture, 0, 0, texture->width, texture->height);
 		module->getTerrain(m_terrain)->setGrassDirty();
 
 		return true;
@@ -113,6 +114,7 @@ struct FillClearGrassCommand final : IEditorCommand {
 		texture->onDataUpdated(0, 0, texture->width, texture->height);
 
 		RenderModule* module = (RenderModule*)m_world_editor.getWorld()->getModule(TERRAIN_TYPE);
+		module->getTerrain(m_terrain)->onMapUpdated(*texture, 0, 0, texture->width, texture->height);
 		module->getTerrain(m_terrain)->setGrassDirty();
 	}
 	const char* getType() override { return "fill_clear_grass"; }
@@ -560,6 +562,8 @@ private:
 			}
 		}
 		texture->onDataUpdated(m_x, m_y, m_width, m_height);
+		RenderModule* render_module = (RenderModule*)m_world_editor.getWorld()->getModule(TERRAIN_TYPE);
+		render_module->getTerrain(m_terrain)->onMapUpdated(*texture, m_x, m_y, m_width, m_height);
 
 		if (m_action_type != TerrainEditor::LAYER && m_action_type != TerrainEditor::REMOVE_GRASS)
 		{
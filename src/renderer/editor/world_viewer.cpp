@@ -152,7 +152,10 @@ void WorldViewer::gui() {
 		vp.pos += m_world->getPosition(*m_mesh);
 	}
 	m_pipeline->setViewport(vp);
-	m_pipeline->render(false);
+	// previews can be animated, so only previews which are not focused are throttled
+	const bool focused = m_is_mouse_captured || ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows) || ImGui::IsWindowHovered(ImGuiHoveredFlags_RootAndChildWindows);
+	if (m_throttle.shouldRender(focused)) m_pipeline->render(false);
+	else m_pipeline->skipRender();
 	gpu::TextureHandle preview = m_pipeline->getOutput();
 	const ImVec2 view_pos = ImGui::GetCursorScreenPos();
 	if (gpu::isOriginBottomLeft()) {
@@ -3,6 +3,7 @@
 #include "engine/engine.h"
 #include "core/geometry.h"
 #include "core/os.h"
+#include "editor/utils.h"
 #include "engine/world.h"
 #include "renderer/pipeline.h"
 
@@ -29,6 +30,7 @@ struct LUMIX_RENDERER_API WorldViewer {
 	bool m_follow_mesh = true;
 	os::Point m_captured_mouse_pos;
 	Viewport m_viewport;
+	ViewThrottle m_throttle;
 };
 
 }
\ No newline at end of file
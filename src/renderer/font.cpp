@@ -1,7 +1,10 @@
 #include "core/array.h"
+#include "core/command_line_parser.h"
 #include "core/log.h"
+#include "core/profiler.h"
 #include "core/stream.h"
 #include "font.h"
+#include "renderer/draw_stream.h"
 #include "renderer/texture.h"
 #include "renderer/renderer.h"
 
@@ -17,24 +20,69 @@
 namespace Lumix
 {
 
+// glyphs are packed incrementally into a fixed size R8 atlas, when it's full, it's cleared and glyphs are rasterized again
+static constexpr u32 ATLAS_SIZE = 2048;
+static constexpr u32 GLYPH_PADDING = 1;
+// in SDF mode, glyphs are rasterized once at this size and scaled for all other sizes
+static constexpr u32 SDF_BASE_SIZE = 48;
+// distance in pixels (at SDF_BASE_SIZE) covered by the distance field outside/inside of glyph's outline
+static constexpr u32 SDF_SPREAD = 6;
+
 struct Font {
-	Font(IAllocator& allocator) : glyphs(allocator) {}
+	Font(IAllocator& allocator) : glyphs(allocator), missing(allocator) {}
 	FontResource* resource;
+	// glyphs are rasterized when they are first needed, see findGlyph
 	HashMap<u32, Glyph> glyphs;
+	// copies of ASCII glyphs, so the most common lookups do not hash
+	Glyph ascii[128];
+	// 0 - not looked up yet, 1 - in `ascii`, 2 - missing
+	u8 ascii_state[128] = {};
+	// codepoints without glyph in the font
+	Array<u32> missing;
+	FT_Face face = nullptr;
+	// SDF mode - fonts of all sizes share glyphs of the base font, only metrics are scaled
+	Font* sdf_base = nullptr;
+	bool is_sdf_base = false;
+	float scale = 1;
 	u32 font_size = 0;
 	float descender = 0;
 	float ascender = 0;
 	u32 ref = 0;
 };
 
+struct FontManager::AtlasPacker {
+	stbrp_context ctx;
+	stbrp_node nodes[ATLAS_SIZE];
+};
+
 float getAdvanceY(const Font& font) { return float(font.font_size); }
 float getDescender(const Font& font) { return font.descender; }
 float getAscender(const Font& font) { return font.ascender; }
 
-const Glyph* findGlyph(const Font& font, u32 codepoint) {
+static const Glyph* findGlyphSlow(const Font& font, u32 codepoint) {
 	auto iter = font.glyphs.find(codepoint);
-	if (!iter.isValid()) return nullptr;
-	return &iter.value();
+	if (iter.isValid()) return &iter.value();
+	if (font.missing.indexOf(codepoint) >= 0) return nullptr;
+
+	FontManager& manager = (FontManager&)font.resource->getResourceManager();
+	return manager.rasterizeGlyph(const_cast<Font&>(font), codepoint);
+}
+
+const Glyph* findGlyph(const Font& font, u32 codepoint) {
+	if (codepoint >= lengthOf(font.ascii)) return findGlyphSlow(font, codepoint);
+
+	switch (font.ascii_state[codepoint]) {
+		case 1: return &font.ascii[codepoint];
+		case 2: return nullptr;
+		default: break;
+	}
+
+	const Glyph* glyph = findGlyphSlow(font, codepoint);
+	Font& f = const_cast<Font&>(font);
+	f.ascii_state[codepoint] = glyph ? 1 : 2;
+	if (!glyph) return nullptr;
+	f.ascii[codepoint] = *glyph;
+	return &f.ascii[codepoint];
 }
 
 Vec2 measureTextA(const Font& font, const char* str, const char* str_end) {
@@ -43,188 +91,269 @@ Vec2 measureTextA(const Font& font, const char* str, const char* str_end) {
 	res.y = (float)font.font_size;
 	const char* c = str;
 	while (*c && c != str_end) {
-		auto iter = font.glyphs.find(*c);
-		if (iter.isValid()) {
-			const Glyph& glyph = iter.value();
-			res.x += glyph.advance_x;
-		}
+		const Glyph* glyph = findGlyph(font, (u8)*c);
+		if (glyph) res.x += glyph->advance_x;
 		++c;
 	}
 	return res;
 }
 
-struct ToChar {
-	Font* font;
-	u32 codepoint;
-	u32 bmp_offset;
-	u32 advance_x;
-};
+Texture* FontManager::getAtlasTexture() {
+	return m_atlas_texture;
+}
 
-static void blit(FT_Bitmap* bitmap,  Array<u8>* out) {
-	ASSERT(bitmap->pixel_mode == FT_PIXEL_MODE_GRAY);
-	const u32 offset = out->size();
-	const u32 src_pitch = bitmap->pitch;
-	const u8* src = bitmap->buffer;
-	u8* dst = out->begin() + offset;
-	out->resize(out->size() + bitmap->width * bitmap->rows);
-	for (u32 y = 0; y < bitmap->rows; ++y, src += src_pitch, dst += bitmap->width) {
-		memcpy(dst, src, bitmap->width);
-	}
+bool FontManager::isSDF() const {
+	return m_sdf;
 }
 
-static void blit(const ToChar& tc, const Array<u8>& src_bmp, const IVec2& size, Array<u32>* out) {
-	const Glyph& c = tc.font->glyphs[tc.codepoint];
-	const u8* src = &src_bmp[tc.bmp_offset];
-	const u32 u0 = u32(c.u0 * size.x + 0.5f);
-	const u32 v0 = u32(c.v0 * size.y + 0.5f);
-	const u32 u1 = u32(c.u1 * size.x + 0.5f);
-	const u32 v1 = u32(c.v1 * size.y + 0.5f);
-	const u32 w = u1 - u0;
-	const u32 h = v1 - v0;
-	u32* dst = &(*out)[u0 + v0 * size.x];
-	for (u32 y = 0; y < h; ++y, dst += size.x, src += w) {
-		for (u32 x = 0; x < w; ++x) {
-			dst[x] = 0x00ffFFff | ((u32)src[x] << 24);
-		}
+bool FontManager::initFace(Font& font) {
+	if (font.sdf_base) {
+		if (!initFace(*font.sdf_base)) return false;
+		font.scale = font.font_size / (float)font.sdf_base->font_size;
+		font.descender = font.sdf_base->descender * font.scale;
+		font.ascender = font.sdf_base->ascender * font.scale;
+		return true;
+	}
+
+	if (font.face) return true;
+	if (!m_ft_library || !font.resource->isReady()) return false;
+
+	FT_Error error = FT_New_Memory_Face(m_ft_library, font.resource->m_file_data.data(), (u32)font.resource->m_file_data.size(), 0, &font.face);
+	if (error != 0) {
+		logError("Failed to create font ", font.resource->getPath());
+		font.face = nullptr;
+		return false;
+	}
+
+	FT_Size_RequestRec size_req;
+	size_req.type = FT_SIZE_REQUEST_TYPE_REAL_DIM;
+	size_req.width = 0;
+	size_req.height = (u32)font.font_size * 64;
+	size_req.horiResolution = 0;
+	size_req.vertResolution = 0;
+	error = FT_Request_Size(font.face, &size_req);
+	if (error != 0) {
+		logError("Failed to request font size ", font.font_size, " for ", font.resource->getPath());
+		FT_Done_Face(font.face);
+		font.face = nullptr;
+		return false;
+	}
+
+	error = FT_Select_Charmap(font.face, FT_ENCODING_UNICODE);
+	if (error != 0) {
+		logError("Failed to select unicode charmap of font ", font.resource->getPath());
+		FT_Done_Face(font.face);
+		font.face = nullptr;
+		return false;
 	}
+
+	font.descender = font.face->size->metrics.descender / 64.f;
+	font.ascender = font.face->size->metrics.ascender / 64.f;
+	return true;
 }
 
-Texture* FontManager::getAtlasTexture() {
-	if (m_dirty) build();
-	return m_atlas_texture;
+void FontManager::doneFace(Font& font) {
+	if (font.face) FT_Done_Face(font.face);
+	font.face = nullptr;
+	font.glyphs.clear();
+	font.missing.clear();
 }
 
-bool FontManager::build()
-{
-	ASSERT(m_dirty);
-	for(Font* font : m_fonts) {
-		if (!font->resource->isReady()) return false;
+// uploads w x h pixels to the atlas at x, y
+void FontManager::uploadToAtlas(u32 x, u32 y, u32 w, u32 h, const u8* pixels) {
+	const Renderer::MemRef mem = m_renderer.copy(pixels, w * h);
+	DrawStream& stream = m_renderer.getDrawStream();
+	stream.update(m_atlas_texture->handle, 0, x, y, 0, w, h, gpu::TextureFormat::R8, mem.data, mem.size);
+	stream.freeMemory(mem.data, m_renderer.getAllocator());
+}
+
+void FontManager::resetAtlas() {
+	++m_atlas_version;
+	stbrp_init_target(&m_packer->ctx, ATLAS_SIZE, ATLAS_SIZE, m_packer->nodes, lengthOf(m_packer->nodes));
+	for (Font* font : m_fonts) {
+		font->glyphs.clear();
+		font->missing.clear();
+		memset(font->ascii_state, 0, sizeof(font->ascii_state));
 	}
-	m_dirty = false;
-	FT_MemoryRec_ memory_rec = {};
-	memory_rec.user = &m_allocator;
-	memory_rec.alloc = [](FT_Memory memory, long size) -> void* { 
-		IAllocator* alloc = (IAllocator*)memory->user;
-		return alloc->allocate(size, 8);
-	};
-	memory_rec.free = [](FT_Memory memory, void* block) -> void { 
-		IAllocator* alloc = (IAllocator*)memory->user;
-		alloc->deallocate(block);
-	};
-	memory_rec.realloc = [](FT_Memory memory, long cur_size, long new_size, void* block) -> void* {
-		IAllocator* alloc = (IAllocator*)memory->user;
-		return alloc->reallocate(block, new_size, cur_size, 8);
-	};
 
-	FT_Library ft_library;
-	FT_Error error = FT_New_Library(&memory_rec, &ft_library);
-	if (error != 0) return false;
+	// white pixel used by lines and rects, see Draw2D
+	stbrp_rect r = {};
+	r.w = r.h = 1 + GLYPH_PADDING;
+	stbrp_pack_rects(&m_packer->ctx, &r, 1);
+	ASSERT(r.was_packed && r.x == 0 && r.y == 0);
+	const u8 white[4] = { 0xff, 0, 0, 0 };
+	uploadToAtlas(0, 0, 2, 2, white);
+}
 
-	FT_Add_Default_Modules(ft_library);
+// 1D squared euclidean distance transform, Felzenszwalb & Huttenlocher
+static void edt1D(float* grid, u32 offset, u32 stride, u32 length, float* f, float* z, u32* v) {
+	v[0] = 0;
+	z[0] = -FLT_MAX;
+	z[1] = FLT_MAX;
+	f[0] = grid[offset];
+	for (u32 q = 1, k = 0; q < length; ++q) {
+		f[q] = grid[offset + q * stride];
+		const float q2 = float(q * q);
+		float s;
+		for (;;) {
+			const u32 r = v[k];
+			s = (f[q] - f[r] + q2 - float(r * r)) / float(q - r) * 0.5f;
+			if (s > z[k] || k == 0) break;
+			--k;
+		}
+		if (s > z[k]) ++k;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = FLT_MAX;
+	}
+	for (u32 q = 0, k = 0; q < length; ++q) {
+		while (z[k + 1] < q) ++k;
+		const u32 r = v[k];
+		const float qr = float(q) - float(r);
+		grid[offset + q * stride] = f[r] + qr * qr;
+	}
+}
 
-	Array<u8> tmp_bmp(m_allocator);
-	tmp_bmp.reserve(1024 * 1024);
-	Array<stbrp_rect> rects(m_allocator);
-	Array<ToChar> to_char(m_allocator);
-	constexpr u32 PADDING = 1;
+static void edt2D(float* grid, u32 w, u32 h, float* f, float* z, u32* v) {
+	for (u32 x = 0; x < w; ++x) edt1D(grid, x, w, h, f, z, v);
+	for (u32 y = 0; y < h; ++y) edt1D(grid, y * w, 1, w, f, z, v);
+}
 
-	for(Font* font : m_fonts) {
-		FT_Face face;
-		error = FT_New_Memory_Face(ft_library, font->resource->m_file_data.data(), (u32)font->resource->m_file_data.size(), 0, &face);
-		if (error != 0) {
-			logError("Failed to create font ", font->resource->getPath());
-			continue;
-		}
-	
-		FT_Size_RequestRec size_req;
-		size_req.type = FT_SIZE_REQUEST_TYPE_REAL_DIM;
-		size_req.width = 0;
-		size_req.height = (u32)font->font_size * 64;
-		size_req.horiResolution = 0;
-		size_req.vertResolution = 0;
-		error = FT_Request_Size(face, &size_req);
-		if (error != 0) {
-			logError("Failed to request font size ", font->font_size, " for ", font->resource->getPath());
-			continue;
-		}
+// converts coverage bitmap to signed distance field, 0.5 is on the outline, inside is > 0.5
+// coverage of antialiased pixels is used as subpixel distance to outline
+static void coverageToSDF(const FT_Bitmap& bitmap, u32 pitch, u32 w, u32 h, u8* out, IAllocator& allocator) {
+	Array<float> outer(allocator);
+	Array<float> inner(allocator);
+	Array<float> f(allocator);
+	Array<float> z(allocator);
+	Array<u32> v(allocator);
+	const u32 max_dim = maximum(w, h);
+	outer.resize(w * h);
+	inner.resize(w * h);
+	f.resize(max_dim);
+	z.resize(max_dim + 1);
+	v.resize(max_dim);
+
+	for (u32 i = 0; i < w * h; ++i) {
+		outer[i] = FLT_MAX;
+		inner[i] = 0;
+	}
 
-		error = FT_Select_Charmap(face, FT_ENCODING_UNICODE);
-		if (error != 0) {
-			logError("Failed to select unicode charmap of font ", font->resource->getPath());
-			continue;
+	for (u32 y = 0; y < bitmap.rows; ++y) {
+		for (u32 x = 0; x < bitmap.width; ++x) {
+			const float a = bitmap.buffer[y * bitmap.pitch + x] / 255.f;
+			if (a == 0) continue;
+			const u32 idx = (y + SDF_SPREAD) * w + x + SDF_SPREAD;
+			if (a == 1) {
+				outer[idx] = 0;
+				inner[idx] = FLT_MAX;
+			}
+			else {
+				const float d = 0.5f - a;
+				outer[idx] = d > 0 ? d * d : 0;
+				inner[idx] = d < 0 ? d * d : 0;
+			}
 		}
-		
-		font->descender = face->size->metrics.descender / 64.f;
-		font->ascender = face->size->metrics.ascender / 64.f;
-		for (Glyph& c : font->glyphs) {
-			c.u0 = c.v0 = 0;
-			c.u1 = c.v1 = 1;
-
-			const u32 glyph_index = FT_Get_Char_Index(face, c.codepoint);
-			if (glyph_index == 0) continue;
-
-			error = FT_Load_Glyph(face, glyph_index, FT_LOAD_NO_BITMAP);
-			if (error) continue;
-
-			FT_GlyphSlot slot = face->glyph;
-			error = FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL);
-			if (error != 0) continue;
-
-			FT_Bitmap* ft_bitmap = &face->glyph->bitmap;
-			stbrp_rect& r = rects.emplace();
-			r.w = ft_bitmap->width + 2 * PADDING;
-			r.h = ft_bitmap->rows + 2 * PADDING;
-			to_char.push({font, c.codepoint, (u32)tmp_bmp.size(), static_cast<u32>(slot->advance.x)});
-			blit(ft_bitmap, &tmp_bmp);
-			c.x0 = float(slot->bitmap_left);
-			c.y0 = float(-slot->bitmap_top);
-			c.x1 = float(c.x0 + r.w - 2 * PADDING);
-			c.y1 = float(c.y0 + r.h - 2 * PADDING);
+	}
+
+	edt2D(outer.begin(), w, h, f.begin(), z.begin(), v.begin());
+	edt2D(inner.begin(), w, h, f.begin(), z.begin(), v.begin());
+
+	for (u32 y = 0; y < h; ++y) {
+		for (u32 x = 0; x < w; ++x) {
+			const u32 idx = y * w + x;
+			const float d = sqrtf(outer[idx]) - sqrtf(inner[idx]);
+			out[y * pitch + x] = u8(clamp(0.5f - d / (2 * SDF_SPREAD), 0.f, 1.f) * 255.f + 0.5f);
 		}
 	}
+}
 
-	stbrp_context ctx;
-	Array<stbrp_node> nodes(m_allocator);
-	nodes.resize(2048);
-	stbrp_init_target(&ctx, 2048, 32 * 1024, nodes.begin(), nodes.size());
-	stbrp_pack_rects(&ctx, rects.begin(), rects.size());
-
-	u32 w = 2048;
-	u32 h = 1;
-	for (const stbrp_rect& r : rects) {
-		ASSERT(u32(r.x + r.w) <= w);
-		h = maximum(h, r.y + r.h);
+// glyph of SDF font of any size is the base font's glyph with scaled metrics
+const Glyph* FontManager::scaleSDFGlyph(Font& font, u32 codepoint) {
+	ASSERT(font.sdf_base);
+	if (!initFace(font)) return nullptr;
+
+	const Glyph* base = findGlyph(*font.sdf_base, codepoint);
+	if (!base) {
+		font.missing.push(codepoint);
+		return nullptr;
 	}
 
-	for (const stbrp_rect& r : rects) {
-		const ToChar& tc = to_char[int(&r - rects.begin())];
-		Glyph& c = tc.font->glyphs[tc.codepoint];
-		c.advance_x = float(((tc.advance_x + 63) & -64) / 64);
-		c.u0 = (r.x + PADDING) / (float)w;
-		c.v0 = (r.y + PADDING) / (float)h;
-		c.u1 = float(r.x + r.w - PADDING) / w;
-		c.v1 = float(r.y + r.h - PADDING) / h;
+	Glyph glyph = *base;
+	glyph.x0 *= font.scale;
+	glyph.y0 *= font.scale;
+	glyph.x1 *= font.scale;
+	glyph.y1 *= font.scale;
+	glyph.advance_x = float(int(base->advance_x * font.scale + 0.5f));
+	return &font.glyphs.insert(codepoint, glyph).value();
+}
+
+const Glyph* FontManager::rasterizeGlyph(Font& font, u32 codepoint) {
+	PROFILE_FUNCTION();
+	if (font.sdf_base) return scaleSDFGlyph(font, codepoint);
+	if (!initFace(font)) return nullptr;
+
+	const u32 glyph_index = FT_Get_Char_Index(font.face, codepoint);
+	if (glyph_index == 0 
+		|| FT_Load_Glyph(font.face, glyph_index, FT_LOAD_NO_BITMAP) != 0
+		|| FT_Render_Glyph(font.face->glyph, FT_RENDER_MODE_NORMAL) != 0)
+	{
+		font.missing.push(codepoint);
+		return nullptr;
 	}
 
-	Array<u32> pixels(m_allocator);
-	pixels.resize(w * h);
-	for (u32& p : pixels) p = 0;
-	for (const ToChar& tc : to_char) {
-		blit(tc, tmp_bmp, IVec2(w, h), &pixels);
+	FT_GlyphSlot slot = font.face->glyph;
+	const FT_Bitmap& bitmap = slot->bitmap;
+	ASSERT(bitmap.pixel_mode == FT_PIXEL_MODE_GRAY || bitmap.width == 0);
+
+	// distance field extends outside of the glyph's bitmap
+	const u32 spread = font.is_sdf_base ? SDF_SPREAD : 0;
+	const u32 glyph_w = bitmap.width == 0 ? 0 : bitmap.width + 2 * spread;
+	const u32 glyph_h = bitmap.rows == 0 ? 0 : bitmap.rows + 2 * spread;
+
+	stbrp_rect r = {};
+	r.w = stbrp_coord(glyph_w + 2 * GLYPH_PADDING);
+	r.h = stbrp_coord(glyph_h + 2 * GLYPH_PADDING);
+	stbrp_pack_rects(&m_packer->ctx, &r, 1);
+	if (!r.was_packed) {
+		// atlas is full, glyphs are rasterized again, when they are needed
+		resetAtlas();
+		stbrp_pack_rects(&m_packer->ctx, &r, 1);
+		if (!r.was_packed) {
+			logError("Glyph ", codepoint, " of ", font.resource->getPath(), " does not fit in font atlas");
+			font.missing.push(codepoint);
+			return nullptr;
+		}
 	}
 
-	pixels[0] = 0xffFFffFF;
-	if (m_atlas_texture) {
-		m_atlas_texture->destroy();
+	// padding is uploaded too, so stale pixels of glyphs from before reset do not bleed
+	Array<u8> pixels(m_allocator);
+	pixels.resize(r.w * r.h);
+	memset(pixels.begin(), 0, pixels.byte_size());
+	if (font.is_sdf_base && glyph_w > 0 && glyph_h > 0) {
+		coverageToSDF(bitmap, r.w, glyph_w, glyph_h, &pixels[GLYPH_PADDING * r.w + GLYPH_PADDING], m_allocator);
 	}
 	else {
-		auto& texture_manager = m_renderer.getTextureManager();
-		m_atlas_texture = LUMIX_NEW(m_allocator, Texture)(Path("draw2d_atlas"), texture_manager, m_renderer, m_allocator);
+		const u8* src = bitmap.buffer;
+		for (u32 y = 0; y < bitmap.rows; ++y, src += bitmap.pitch) {
+			memcpy(&pixels[(y + GLYPH_PADDING) * r.w + GLYPH_PADDING], src, bitmap.width);
+		}
 	}
-	m_atlas_texture->create(w, h, gpu::TextureFormat::RGBA8, pixels.begin(), pixels.byte_size());
-
-	FT_Done_Library(ft_library);
-	return true;
+	uploadToAtlas(r.x, r.y, r.w, r.h, pixels.begin());
+
+	Glyph glyph;
+	glyph.codepoint = codepoint;
+	// SDF glyphs are scaled, so advance is rounded after scaling, see scaleSDFGlyph
+	glyph.advance_x = font.is_sdf_base ? slot->advance.x / 64.f : float(((slot->advance.x + 63) & -64) / 64);
+	glyph.x0 = float(slot->bitmap_left) - spread;
+	glyph.y0 = float(-slot->bitmap_top) - spread;
+	glyph.x1 = glyph.x0 + glyph_w;
+	glyph.y1 = glyph.y0 + glyph_h;
+	glyph.u0 = (r.x + GLYPH_PADDING) / (float)ATLAS_SIZE;
+	glyph.v0 = (r.y + GLYPH_PADDING) / (float)ATLAS_SIZE;
+	glyph.u1 = float(r.x + r.w - GLYPH_PADDING) / ATLAS_SIZE;
+	glyph.v1 = float(r.y + r.h - GLYPH_PADDING) / ATLAS_SIZE;
+	return &font.glyphs.insert(codepoint, glyph).value();
 }
 
 
@@ -239,6 +368,16 @@ FontResource::FontResource(const Path& path, ResourceManager& manager, IAllocato
 }
 
 
+void FontResource::unload() {
+	// faces point to file data
+	auto& manager = (FontManager&)m_resource_manager;
+	for (Font* font : manager.m_fonts) {
+		if (font->resource == this) manager.doneFace(*font);
+	}
+	m_file_data.free();
+}
+
+
 bool FontResource::load(Span<const u8> mem) {
 	if (mem.length() == 0) return false;
 	
@@ -252,7 +391,7 @@ Font* FontResource::addRef(int font_size)
 {
 	auto& manager = (FontManager&)m_resource_manager;
 	for (Font* f : manager.m_fonts) {
-		if (f->resource == this && f->font_size == font_size) {
+		if (f->resource == this && f->font_size == font_size && !f->is_sdf_base) {
 			++f->ref;
 			return f;
 		}
@@ -261,14 +400,30 @@ Font* FontResource::addRef(int font_size)
 	font->ref = 1;
 	font->resource = this;
 	font->font_size = font_size;
-	for(u32 cp = 0x20; cp < 0xff; ++cp) {
-		Glyph c;
-		c.codepoint = cp;
-		font->glyphs.insert(cp, c);
+	if (manager.m_sdf) font->sdf_base = getSDFBase();
+	manager.m_fonts.push(font);
+	// metrics are needed before any glyph is rasterized
+	manager.initFace(*font);
+	return font;
+}
+
+
+// all sizes of SDF font reference the same base font, which owns the glyphs in the atlas
+Font* FontResource::getSDFBase()
+{
+	auto& manager = (FontManager&)m_resource_manager;
+	for (Font* f : manager.m_fonts) {
+		if (f->resource == this && f->is_sdf_base) {
+			++f->ref;
+			return f;
+		}
 	}
+	Font* font = LUMIX_NEW(manager.m_allocator, Font)(manager.m_allocator);
+	font->ref = 1;
+	font->resource = this;
+	font->font_size = SDF_BASE_SIZE;
+	font->is_sdf_base = true;
 	manager.m_fonts.push(font);
-	manager.m_dirty = true;
-	if (isReady()) manager.build();
 	return font;
 }
 
@@ -278,11 +433,13 @@ void FontResource::removeRef(Font& font)
 	ASSERT(font.ref > 0);
 	--font.ref;
 	if(font.ref == 0) {
+		// space of font's glyphs in the atlas is reused after the atlas is full and reset
 		auto& manager = (FontManager&)m_resource_manager;
-		LUMIX_DELETE(manager.m_allocator, &font);
+		Font* sdf_base = font.sdf_base;
+		manager.doneFace(font);
 		manager.m_fonts.eraseItem(&font);
-		manager.m_dirty = true;
-		if (isReady()) manager.build();
+		LUMIX_DELETE(manager.m_allocator, &font);
+		if (sdf_base) removeRef(*sdf_base);
 	}
 }
 
@@ -294,16 +451,55 @@ FontManager::FontManager(Renderer& renderer, IAllocator& allocator)
 	, m_atlas_texture(nullptr)
 	, m_fonts(allocator)
 {
-	build();
+	m_sdf = CommandLineParser::isOn("-sdf_fonts");
+
+	FT_MemoryRec_* memory_rec = LUMIX_NEW(m_allocator, FT_MemoryRec_)();
+	memory_rec->user = &m_allocator;
+	memory_rec->alloc = [](FT_Memory memory, long size) -> void* { 
+		IAllocator* alloc = (IAllocator*)memory->user;
+		return alloc->allocate(size, 8);
+	};
+	memory_rec->free = [](FT_Memory memory, void* block) -> void { 
+		IAllocator* alloc = (IAllocator*)memory->user;
+		alloc->deallocate(block);
+	};
+	memory_rec->realloc = [](FT_Memory memory, long cur_size, long new_size, void* block) -> void* {
+		IAllocator* alloc = (IAllocator*)memory->user;
+		return alloc->reallocate(block, new_size, cur_size, 8);
+	};
+	m_ft_memory = memory_rec;
+
+	if (FT_New_Library(memory_rec, &m_ft_library) != 0) {
+		logError("Failed to initialize FreeType");
+		m_ft_library = nullptr;
+	}
+	else {
+		FT_Add_Default_Modules(m_ft_library);
+	}
+
+	Array<u8> pixels(m_allocator);
+	pixels.resize(ATLAS_SIZE * ATLAS_SIZE);
+	memset(pixels.begin(), 0, pixels.byte_size());
+	auto& texture_manager = m_renderer.getTextureManager();
+	m_atlas_texture = LUMIX_NEW(m_allocator, Texture)(Path("draw2d_atlas"), texture_manager, m_renderer, m_allocator);
+	m_atlas_texture->create(ATLAS_SIZE, ATLAS_SIZE, gpu::TextureFormat::R8, pixels.begin(), pixels.byte_size());
+
+	m_packer = LUMIX_NEW(m_allocator, AtlasPacker);
+	resetAtlas();
 }
 
 
 FontManager::~FontManager()
 {
 	for (Font* font : m_fonts) {
+		doneFace(*font);
 		LUMIX_DELETE(m_allocator, font);
 	}
 
+	if (m_ft_library) FT_Done_Library(m_ft_library);
+	LUMIX_DELETE(m_allocator, (FT_MemoryRec_*)m_ft_memory);
+	LUMIX_DELETE(m_allocator, m_packer);
+
 	if (m_atlas_texture) {
 		m_atlas_texture->destroy();
 		LUMIX_DELETE(m_allocator, m_atlas_texture);
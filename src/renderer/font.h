@@ -9,6 +9,9 @@
 #include "engine/resource_manager.h"
 
 
+struct FT_LibraryRec_;
+
+
 namespace Lumix
 {
 
@@ -39,10 +42,11 @@ struct LUMIX_RENDERER_API FontResource final : Resource
 
 	ResourceType getType() const override { return TYPE; }
 
-	void unload() override { m_file_data.free(); }
+	void unload() override;
 	bool load(Span<const u8> mem) override;
 	Font* addRef(int font_size);
 	void removeRef(Font& font);
+	Font* getSDFBase();
 
 	TagAllocator m_allocator;
 	OutputMemoryStream m_file_data;
@@ -58,19 +62,35 @@ public:
 	FontManager(Renderer& renderer, IAllocator& allocator);
 	~FontManager();
 
+	// R8 texture, glyphs are added to it when they are first used, see findGlyph
 	Texture* getAtlasTexture();
+	// glyphs in the atlas are signed distance fields, rasterized once and used for all sizes, enabled by -sdf_fonts
+	bool isSDF() const;
+	// changes when the atlas is reset, glyphs rasterized before that are no longer valid
+	u32 getAtlasVersion() const { return m_atlas_version; }
+	const Glyph* rasterizeGlyph(Font& font, u32 codepoint);
 
 private:
+	struct AtlasPacker;
+
 	Resource* createResource(const Path& path) override;
 	void destroyResource(Resource& resource) override;
-	bool build();
+	bool initFace(Font& font);
+	void doneFace(Font& font);
+	void resetAtlas();
+	const Glyph* scaleSDFGlyph(Font& font, u32 codepoint);
+	void uploadToAtlas(u32 x, u32 y, u32 w, u32 h, const u8* pixels);
 
 private:
 	TagAllocator m_allocator;
 	Renderer& m_renderer;
 	Texture* m_atlas_texture;
 	Array<Font*> m_fonts;
-	bool m_dirty = true;
+	AtlasPacker* m_packer = nullptr;
+	::FT_LibraryRec_* m_ft_library = nullptr;
+	void* m_ft_memory = nullptr;
+	u32 m_atlas_version = 0;
+	bool m_sdf = false;
 };
 
 
@@ -83,8 +83,8 @@ struct FSR3Plugin : RenderPlugin {
 	}
 
 	Context& getOrCreateContext(Pipeline& pipeline) {
-		const Viewport& vp = pipeline.getViewport();
-		IVec2 size = {vp.w, vp.h};
+		// render size can change with dynamic resolution, it's always <= display size
+		const IVec2 size = pipeline.getDisplaySize();
 		// look for existing context
 		for (const UniquePtr<Context>& ctx : m_contexts) {
 			if (ctx->pipeline == &pipeline) {
@@ -147,9 +147,10 @@ struct FSR3Plugin : RenderPlugin {
 		gpu::TextureHandle depth = renderer.toTexture(gbuffer.DS);
 		gpu::TextureHandle motion_vectors = renderer.toTexture(gbuffer.D);
 		const Viewport& vp = pipeline.getViewport();
+		const IVec2 display_size = pipeline.getDisplaySize();
 
 		RenderBufferHandle output = renderer.createRenderbuffer({
-			.size = {vp.w, vp.h},
+			.size = display_size,
 			.format = gpu::TextureFormat::RGBA16F,
 			.flags = gpu::TextureFlags::RENDER_TARGET | gpu::TextureFlags::NO_MIPS | gpu::TextureFlags::COMPUTE_WRITE,
 			.debug_name = "fsr3_output"
@@ -159,8 +160,8 @@ struct FSR3Plugin : RenderPlugin {
 
 		pipeline.enablePixelJitter(true);
 		pipeline.beginBlock("FSR3 Upscale");
-		stream.pushLambda([color, depth, motion_vectors, output_tex, vp, time_delta, ctx_ptr = &ctx](){
-			dispatch(color, depth, motion_vectors, output_tex, vp, time_delta, *ctx_ptr);
+		stream.pushLambda([color, depth, motion_vectors, output_tex, vp, display_size, time_delta, ctx_ptr = &ctx](){
+			dispatch(color, depth, motion_vectors, output_tex, vp, display_size, time_delta, *ctx_ptr);
 		});
 		pipeline.endBlock();
 		renderer.releaseRenderbuffer(input);
@@ -186,7 +187,7 @@ struct FSR3Plugin : RenderPlugin {
 		return res;
 	}
 
-	static void dispatch(gpu::TextureHandle color, gpu::TextureHandle depth, gpu::TextureHandle motion_vectors, gpu::TextureHandle output, const Viewport& vp, float time_delta, Context& ctx) {
+	static void dispatch(gpu::TextureHandle color, gpu::TextureHandle depth, gpu::TextureHandle motion_vectors, gpu::TextureHandle output, const Viewport& vp, IVec2 display_size, float time_delta, Context& ctx) {
 		const IVec2 size = { (int)vp.w, (int)vp.h };
 		gpu::barrier(color, gpu::BarrierType::COMMON);
 		gpu::barrier(depth, gpu::BarrierType::COMMON);
@@ -198,11 +199,11 @@ struct FSR3Plugin : RenderPlugin {
 			.color = toFFXResource(color, FfxResourceStates::FFX_RESOURCE_STATE_COMMON, false, size),
 			.depth = toFFXResource(depth, FfxResourceStates::FFX_RESOURCE_STATE_COMMON, true, size),
 			.motionVectors = toFFXResource(motion_vectors, FfxResourceStates::FFX_RESOURCE_STATE_COMMON, false, size),
-			.output = toFFXResource(output, FfxResourceStates::FFX_RESOURCE_STATE_COMMON, false, size),
+			.output = toFFXResource(output, FfxResourceStates::FFX_RESOURCE_STATE_COMMON, false, display_size),
 			.jitterOffset = { vp.pixel_offset.x, vp.pixel_offset.y },
 			.motionVectorScale = {  0.5f * vp.w, -0.5f * vp.h },
 			.renderSize = {(u32)vp.w, (u32)vp.h}, // The resolution that was used for rendering the input resources.
-			.upscaleSize = {(u32)vp.w, (u32)vp.h}, // The resolution that the upscaler will upscale to
+			.upscaleSize = {(u32)display_size.x, (u32)display_size.y}, // The resolution that the upscaler will upscale to
 			.enableSharpening = false,
 			.frameTimeDelta = time_delta * 1000.f,
 			.preExposure = 1.f,
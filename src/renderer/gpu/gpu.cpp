@@ -62,6 +62,7 @@ int getSize(AttributeType type)
 		case AttributeType::I16: return 2;
 		case AttributeType::U16: return 2;
 		case AttributeType::U32: return 4;
+		case AttributeType::F16: return 2;
 	}
 	ASSERT(false);
 	return 0;
@@ -15,10 +15,14 @@ using BufferHandle = struct Buffer*;
 using ProgramHandle = struct Program*;
 using TextureHandle = struct Texture*;
 using QueryHandle = struct Query*;
+using HeapHandle = struct Heap*;
 const BufferHandle INVALID_BUFFER = nullptr;
 const ProgramHandle INVALID_PROGRAM = nullptr;
 const TextureHandle INVALID_TEXTURE = nullptr;
 const QueryHandle INVALID_QUERY = nullptr;
+const HeapHandle INVALID_HEAP = nullptr;
+// offsets of textures placed in a heap must be aligned to this
+static constexpr u64 HEAP_PLACEMENT_ALIGNMENT = 64 * 1024;
 
 struct BindlessHandle {
 	constexpr BindlessHandle() {}
@@ -50,6 +54,12 @@ enum class BarrierType : u8 {
 	COMMON,
 };
 
+enum class QueueType : u8 {
+	GRAPHICS,
+	// async compute, runs in parallel with graphics queue
+	COMPUTE,
+};
+
 enum class FramebufferFlags : u32 {
 	NONE = 0,
 	SRGB = 1 << 0,
@@ -78,6 +88,16 @@ enum class QueryType : u32 {
 	STATS
 };
 
+// result of QueryType::STATS query
+struct PipelineStats {
+	u64 input_primitives;
+	u64 vs_invocations;
+	u64 clipper_invocations;	// primitives sent to the rasterizer
+	u64 clipper_primitives;		// primitives which survived clipping
+	u64 ps_invocations;
+	u64 cs_invocations;
+};
+
 enum class PrimitiveType : u8 {
 	TRIANGLES,
 	TRIANGLE_STRIP,
@@ -145,7 +165,8 @@ enum class AttributeType : u8 {
 	I16,
 	I8,
 	U16,
-	U32
+	U32,
+	F16
 };
 
 
@@ -174,7 +195,8 @@ enum class TextureFormat : u32 {
 	R11G11B10F,
 	RGB32F,
 	RG16,
-	RG16F
+	RG16F,
+	BC7
 };
 
 enum class TextureFlags : u32 {
@@ -242,11 +264,17 @@ struct TextureDesc {
 
 struct MemoryStats {
 	u64 total_available_mem;
+	// budget - usage
 	u64 current_available_mem;
 	u64 dedicated_vidmem;
+	// committed resources and heaps by category, individual resources are tracked with debug::registerAlloc
 	u64 render_target_mem;
 	u64 buffer_mem;
 	u64 texture_mem;
+	// local memory budget given by OS, can change any time, 0 if unknown
+	u64 budget;
+	// local memory used by the process
+	u64 usage;
 };
 
 // Most common combination of arguments, can be drawn with single function call
@@ -270,11 +298,19 @@ bool getMemoryStats(MemoryStats& stats);
 u32 present();
 void enableVSync(bool enable);
 bool isVSyncEnabled();
+// waits until the main window's swapchain can accept a new frame, can be called from any thread
+void waitForSwapchain();
 void waitFrame(u32 frame);
 bool frameFinished(u32 frame);
 LUMIX_RENDERER_API bool isOriginBottomLeft();
 void checkThread();
 void shutdown();
+// writes all shaders compiled so far and loaded from caches to `dest_dir`, the file is loaded on init if it's in working directory
+// ship it with the game, so shaders do not need to be compiled on user's machine, can be called from any thread
+// if `used_only` is true, only shaders compiled or loaded from caches since trackShaderCacheUsage are written
+LUMIX_RENDERER_API bool saveShaderCache(const char* dest_dir, bool used_only = false);
+// starts (or restarts) tracking which cached shaders are used, see saveShaderCache
+LUMIX_RENDERER_API void trackShaderCacheUsage();
 int getSize(AttributeType type);
 u32 getSize(TextureFormat format, u32 w, u32 h);
 u32 getBytesPerPixel(TextureFormat format);
@@ -286,23 +322,57 @@ void pushGPUCounters();
 TextureHandle allocTextureHandle();
 BufferHandle allocBufferHandle();
 ProgramHandle allocProgramHandle();
+HeapHandle allocHeapHandle();
 
 QueryHandle createQuery(QueryType type);
 
 void createProgram(ProgramHandle prog, StateFlags state, const VertexDecl& decl, const char* src, ShaderType type, const char* name);
 void createBuffer(BufferHandle handle, BufferFlags flags, size_t size, const void* data, const char* debug_name);
 void createTexture(TextureHandle handle, u32 w, u32 h, u32 depth, TextureFormat format, TextureFlags flags, const char* debug_name);
+// memory for textures placed in the heap, textures in one heap must either all have RENDER_TARGET flag or none of them
+void createHeap(HeapHandle heap, u64 size, TextureFlags flags, const char* debug_name);
+// texture is placed at `offset` in `heap`'s memory, it can overlap other textures in the heap, see aliasingBarrier
+void createTexture(TextureHandle handle, u32 w, u32 h, u32 depth, TextureFormat format, TextureFlags flags, HeapHandle heap, u64 offset, const char* debug_name);
+// size of memory texture needs when placed in a heap, aligned to HEAP_PLACEMENT_ALIGNMENT, safe to call from any thread
+u64 getPlacedTextureSize(u32 w, u32 h, u32 depth, TextureFormat format, TextureFlags flags);
 void createTextureView(TextureHandle view, TextureHandle texture, u32 layer, u32 mip);
+// mips finer than `mip` are not sampled, so they can be uploaded later
+void setMinLOD(TextureHandle texture, u32 mip);
+
+// following commands are recorded to `queue`, graphics queue is active at the beginning of each frame
+// compute queue accepts only compute work - dispatch, bindings, UAV barriers, copies and timestamp queries
+// resources used on compute queue must not be in graphics-only states, e.g. render target
+// access to resources from both queues must be synchronized with syncQueues
+void setQueue(QueueType queue);
+// commands recorded to `waiting` queue after this call are executed only after gpu finishes all commands recorded so far to `signaling` queue
+// both queues are submitted, so call it only between passes, after this call graphics queue has the same framebuffer,
+// viewport and scissor, but vertex buffers must be set again
+void syncQueues(QueueType waiting, QueueType signaling);
+
+// `count` command lists are recorded in parallel and executed in index order after commands recorded so far
+// each list starts with the render thread's state - framebuffer, viewport, scissor, program and bindings
+// only bindings, draws, dispatches, viewport and scissor can be recorded to them, resources must already be in the right states
+// must be called on render thread, graphics queue must be active
+void beginParallel(u32 count);
+// called from a job, following commands from this thread are recorded to `idx`-th parallel command list
+void bindParallelContext(u32 idx);
+void unbindParallelContext();
+// submits parallel command lists, all jobs recording to them must be finished before this call
+void endParallel();
 
 void memoryBarrier(BufferHandle buffer);
 void memoryBarrier(TextureHandle texture);
 void barrier(TextureHandle texture, BarrierType type);
 void barrier(BufferHandle buffer, BarrierType type);
+// placed `texture` becomes the user of its memory, content of textures overlapping it, including `texture`, is undefined after this
+void aliasingBarrier(TextureHandle texture);
 
 void destroy(TextureHandle texture);
 void destroy(BufferHandle buffer);
 void destroy(ProgramHandle program);
 void destroy(QueryHandle query);
+// textures placed in the heap must be destroyed before the heap
+void destroy(HeapHandle heap);
 	
 void setCurrentWindow(void* window_handle);
 void setFramebuffer(const TextureHandle* attachments, u32 num, TextureHandle ds, FramebufferFlags flags);
@@ -333,6 +403,7 @@ void bindShaderBuffers(Span<BufferHandle> buffers);
 
 void drawArrays(u32 offset, u32 count);
 void drawIndirect(DataType index_type, u32 indirect_buffer_offset);
+void drawArraysIndirect(u32 indirect_buffer_offset);
 void drawIndexed(u32 offset, u32 count, DataType type);
 void drawArraysInstanced(u32 indices_count, u32 instances_count);
 void drawIndexedInstanced(u32 indices_count, u32 instances_count, DataType index_type);
@@ -343,8 +414,12 @@ void copy(TextureHandle dst, TextureHandle src, u32 dst_x, u32 dst_y);
 void copy(BufferHandle dst, BufferHandle src, u32 dst_offset, u32 src_offset, u32 size);
 void copy(BufferHandle dst, TextureHandle src);
 	
+// reads are asynchronous, callback is called a few frames later, once gpu finished the frame the read was recorded in
+// the data passed to callback are valid only during the call
 using TextureReadCallback = Delegate<void(Span<const u8>)>;
+using BufferReadCallback = Delegate<void(Span<const u8>)>;
 void readTexture(TextureHandle texture, TextureReadCallback callback);
+void readBuffer(BufferHandle buffer, u32 offset, u32 size, BufferReadCallback callback);
 void setDebugName(TextureHandle texture, const char* debug_name);
 	
 void update(TextureHandle texture, u32 mip, u32 x, u32 y, u32 z, u32 w, u32 h, TextureFormat format, const void* buf, u32 size);
@@ -356,7 +431,9 @@ void queryTimestamp(QueryHandle query);
 
 void beginQuery(QueryHandle query);
 void endQuery(QueryHandle query);
+// for QueryType::STATS queries it's clipper_invocations
 u64 getQueryResult(QueryHandle query);
+PipelineStats getQueryPipelineStats(QueryHandle query);
 u64 getQueryFrequency();
 bool isQueryReady(QueryHandle query);
 
@@ -4,6 +4,7 @@
 #include "core/array.h"
 #include "core/atomic.h"
 #include "core/debug.h"
+#include "core/flat_hash_map.h"
 #include "core/hash_map.h"
 #include "core/hash.h"
 #include "core/job_system.h"
@@ -13,6 +14,7 @@
 #include "core/path.h"
 #include "core/profiler.h"
 #include "core/ring_buffer.h"
+#include "core/sort.h"
 #include "core/stream.h"
 #include "core/string.h"
 #include "core/sync.h"
@@ -87,6 +89,7 @@ static DXGI_FORMAT getDXGIFormat(const Attribute& attr) {
 			break;
 		case AttributeType::U16: 
 			switch(attr.components_count) {
+				case 2: return as_int ? DXGI_FORMAT_R16G16_UINT : DXGI_FORMAT_R16G16_UNORM;
 				case 4: return as_int ? DXGI_FORMAT_R16G16B16A16_UINT : DXGI_FORMAT_R16G16B16A16_UNORM;
 			}
 			break;
@@ -95,6 +98,12 @@ static DXGI_FORMAT getDXGIFormat(const Attribute& attr) {
 				case 1: ASSERT(!as_int); return DXGI_FORMAT_R32_UINT;
 			}
 			break;
+		case AttributeType::F16:
+			switch(attr.components_count) {
+				case 2: return DXGI_FORMAT_R16G16_FLOAT;
+				case 4: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+			}
+			break;
 	}
 	ASSERT(false);
 	return DXGI_FORMAT_R32_FLOAT;
@@ -128,6 +137,7 @@ struct FormatDesc {
 			case DXGI_FORMAT_BC3_UNORM : return get(TextureFormat::BC3);
 			case DXGI_FORMAT_BC4_UNORM : return get(TextureFormat::BC4);
 			case DXGI_FORMAT_BC5_UNORM : return get(TextureFormat::BC5);
+			case DXGI_FORMAT_BC7_UNORM : return get(TextureFormat::BC7);
 			case DXGI_FORMAT_R16_UNORM : return get(TextureFormat::R16);
 			case DXGI_FORMAT_R8_UNORM : return get(TextureFormat::R8);
 			case DXGI_FORMAT_R8G8_UNORM : return get(TextureFormat::RG8);
@@ -154,6 +164,7 @@ struct FormatDesc {
 			case TextureFormat::BC3: return {			true,		16,	DXGI_FORMAT_BC3_TYPELESS,			DXGI_FORMAT_BC3_UNORM,				DXGI_FORMAT_BC3_UNORM_SRGB};
 			case TextureFormat::BC4: return {			true,		8,	DXGI_FORMAT_BC4_TYPELESS,			DXGI_FORMAT_BC4_UNORM,				DXGI_FORMAT_UNKNOWN};
 			case TextureFormat::BC5: return {			true,		16,	DXGI_FORMAT_BC5_TYPELESS,			DXGI_FORMAT_BC5_UNORM,				DXGI_FORMAT_UNKNOWN};
+			case TextureFormat::BC7: return {			true,		16,	DXGI_FORMAT_BC7_TYPELESS,			DXGI_FORMAT_BC7_UNORM,				DXGI_FORMAT_BC7_UNORM_SRGB};
 			case TextureFormat::R16: return {			false,		2,	DXGI_FORMAT_R16_TYPELESS,			DXGI_FORMAT_R16_UNORM,				DXGI_FORMAT_UNKNOWN};
 			case TextureFormat::RG16: return {			false,		4,	DXGI_FORMAT_R16G16_TYPELESS,		DXGI_FORMAT_R16G16_UNORM,			DXGI_FORMAT_UNKNOWN};
 			case TextureFormat::R8: return {			false,		1,	DXGI_FORMAT_R8_TYPELESS,			DXGI_FORMAT_R8_UNORM,				DXGI_FORMAT_UNKNOWN};
@@ -293,6 +304,7 @@ static void switchState(ID3D12GraphicsCommandList* cmd_list, ID3D12Resource* res
 
 struct Query {
 	u64 result = 0;
+	PipelineStats stats = {};
 	u32 idx;
 	QueryType type;
 	bool ready;
@@ -354,12 +366,24 @@ struct Texture {
 	u32 w;
 	u32 h;
 	bool is_view = false;
+	// placed in a heap, can alias other textures
+	bool is_placed = false;
+	D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {}; // used to recreate srv in setMinLOD
 
 	debug::AllocationInfo allocation_info;
 	Local<TagAllocator> tag_allocator;
 	StaticString<64> name;
 };
 
+struct Heap {
+	ID3D12Heap* heap = nullptr;
+	u64 size = 0;
+	bool render_targets = false;
+
+	debug::AllocationInfo allocation_info;
+	Local<TagAllocator> tag_allocator;
+};
+
 struct FrameBuffer {
 	D3D12_CPU_DESCRIPTOR_HANDLE depth_stencil = {};
 	D3D12_CPU_DESCRIPTOR_HANDLE render_targets[8] = {};
@@ -367,12 +391,103 @@ struct FrameBuffer {
 	DXGI_FORMAT ds_format = {};
 	TextureHandle attachments[9] = {};
 	u32 count = 0;
+	// PSOs for current formats, set in setFramebuffer, so draws do not need to hash formats
+	struct PSOLayout* pso_layout = nullptr;
 };
 
+// precompiled shaders shipped with game, see gpu::saveShaderCache
+static const char* SHIPPED_SHADER_CACHE = "shader_cache_dx.lsc";
+
 struct ShaderCompiler {
+	// packed cache layout: header, entries sorted by hash, blobs
+	// shipped with game and mapped to memory, so lookup does not need to read or parse the whole file
+	struct PackedCacheHeader {
+		static constexpr u32 MAGIC = '_LSC';
+		u32 magic = MAGIC;
+		u32 version = 1;
+		u32 count = 0;
+		u32 reserved = 0;
+	};
+
+	struct PackedCacheEntry {
+		StableHash hash;
+		u32 offset; // from the beginning of file
+		u32 size;
+	};
+
 	ShaderCompiler(IAllocator& allocator)
 		: m_allocator(allocator, "shader compiler")
-		, m_cache(m_allocator) {}
+		, m_cache(m_allocator)
+		, m_packed_blobs(m_allocator)
+		, m_used(m_allocator) {}
+
+	// finds compiled stage in cache loaded by loadCache, or in packed cache opened by openPackedCache
+	ID3DBlob* getCached(StableHash hash) {
+		MutexGuard guard(m_mutex);
+		auto iter = m_cache.find(hash);
+		if (iter.isValid()) {
+			markUsed(hash);
+			return iter.value();
+		}
+		iter = m_packed_blobs.find(hash);
+		if (iter.isValid()) {
+			markUsed(hash);
+			return iter.value();
+		}
+
+		const PackedCacheEntry* entry = findPacked(hash);
+		if (!entry) return nullptr;
+		markUsed(hash);
+		ID3DBlob* blob;
+		if (FAILED(D3DCreateBlob(entry->size, &blob))) return nullptr;
+		memcpy(blob->GetBufferPointer(), m_packed.data().begin() + entry->offset, entry->size);
+		// not in m_cache, so it's not duplicated in the local cache
+		m_packed_blobs.insert(hash, blob);
+		return blob;
+	}
+
+	const PackedCacheEntry* findPacked(StableHash hash) const {
+		u32 lo = 0;
+		u32 hi = m_packed_entries.length();
+		while (lo < hi) {
+			const u32 mid = (lo + hi) / 2;
+			if (m_packed_entries[mid].hash < hash) lo = mid + 1;
+			else hi = mid;
+		}
+		if (lo == m_packed_entries.length() || m_packed_entries[lo].hash != hash) return nullptr;
+		return &m_packed_entries[lo];
+	}
+
+	void openPackedCache(const char* filename) {
+		PROFILE_FUNCTION();
+		if (!os::fileExists(filename)) return;
+		if (!m_packed.open(filename)) {
+			logError("Could not open ", filename);
+			return;
+		}
+		const Span<const u8> data = m_packed.data();
+		const PackedCacheHeader* header = (const PackedCacheHeader*)data.begin();
+		if (data.length() < sizeof(PackedCacheHeader)
+			|| header->magic != PackedCacheHeader::MAGIC
+			|| header->version != 1
+			|| data.length() < sizeof(PackedCacheHeader) + u64(header->count) * sizeof(PackedCacheEntry))
+		{
+			logError("Invalid shader cache ", filename);
+			m_packed.close();
+			return;
+		}
+		const PackedCacheEntry* entries = (const PackedCacheEntry*)(header + 1);
+		m_packed_entries = Span(entries, header->count);
+		for (const PackedCacheEntry& e : m_packed_entries) {
+			if (u64(e.offset) + e.size > data.length()) {
+				logError("Invalid shader cache ", filename);
+				m_packed_entries = {};
+				m_packed.close();
+				return;
+			}
+		}
+		logInfo("Shader cache ", filename, " with ", header->count, " shaders opened");
+	}
 
 	bool compile(const VertexDecl& decl
 		, const char* src
@@ -407,22 +522,16 @@ struct ShaderCompiler {
 		program.shader_hash = hash;
 
 		if (type == ShaderType::SURFACE) {
-			auto iter = m_cache.find(hash);
-			if (iter.isValid()) {
-				program.vs = iter.value();
-			}
-			else {
+			program.vs = getCached(hash);
+			if (!program.vs) {
 				program.vs = compileStage(hash, src, "vs_5_1", name, "mainVS");
 				if (!program.vs) return false;
 			}
 
 			const StableHash ps_hash = StableHash::fromU64(hash.getHashValue() + 1);
 
-			iter = m_cache.find(ps_hash);
-			if (iter.isValid()) {
-				program.ps = iter.value();
-			}
-			else {
+			program.ps = getCached(ps_hash);
+			if (!program.ps) {
 				program.ps = compileStage(ps_hash, src, "ps_5_1", name, "mainPS");
 				if (!program.ps) return false;
 			}
@@ -430,11 +539,8 @@ struct ShaderCompiler {
 		}
 
 		ASSERT(type == ShaderType::COMPUTE);
-		auto iter = m_cache.find(hash);
-		if (iter.isValid()) {
-			program.cs = iter.value();
-			return true;
-		}
+		program.cs = getCached(hash);
+		if (program.cs) return true;
 
 		program.cs = compileStage(hash, src, "cs_5_1", name, "main");
 		if (!program.cs) return false;
@@ -480,7 +586,11 @@ struct ShaderCompiler {
 			output->Release();
 			return nullptr;
 		}
-		m_cache.insert(hash, output);
+		{
+			MutexGuard guard(m_mutex);
+			m_cache.insert(hash, output);
+			markUsed(hash);
+		}
 
 		// save disassembled files
 		#if 0
@@ -499,52 +609,122 @@ struct ShaderCompiler {
 		return output;
 	};
 
-	void saveCache(const char* filename) {
-		os::OutputFile file;
-		if (file.open(filename)) {
-			u32 version = 0;
-			bool success = file.write(&version, sizeof(version));
-			for (auto iter = m_cache.begin(), end = m_cache.end(); iter != end; ++iter) {
-				const StableHash hash = iter.key();
-				ID3DBlob* blob = iter.value();
-				const u32 size = (u32)blob->GetBufferSize();
-				success = file.write(&hash, sizeof(hash)) && success;
-				success = file.write(&size, sizeof(size)) && success;
-				success = file.write(blob->GetBufferPointer(), size) && success;
-			}
-			if (!success) {
-				logError("Could not write ", filename);
+	// must be called with m_mutex locked
+	void markUsed(StableHash hash) {
+		if (m_track_usage && !m_used.find(hash).isValid()) m_used.insert(hash, true);
+	}
+
+	void trackUsage() {
+		MutexGuard guard(m_mutex);
+		m_track_usage = true;
+		m_used.clear();
+	}
+
+	// writes packed cache, with shaders from packed cache too if `include_packed` is true
+	// only stages used since trackUsage if `used_only` is true
+	bool saveCache(const char* filename, bool include_packed, bool used_only = false) {
+		PROFILE_FUNCTION();
+		MutexGuard guard(m_mutex);
+		struct Item {
+			StableHash hash;
+			const void* data;
+			u32 size;
+		};
+		used_only = used_only && m_track_usage;
+		Array<Item> items(m_allocator);
+		items.reserve(m_cache.size() + (include_packed ? m_packed_entries.length() : 0));
+		for (auto iter = m_cache.begin(), end = m_cache.end(); iter != end; ++iter) {
+			if (used_only && !m_used.find(iter.key()).isValid()) continue;
+			ID3DBlob* blob = iter.value();
+			items.push({iter.key(), blob->GetBufferPointer(), (u32)blob->GetBufferSize()});
+		}
+		if (include_packed) {
+			for (const PackedCacheEntry& e : m_packed_entries) {
+				if (m_cache.find(e.hash).isValid()) continue;
+				if (used_only && !m_used.find(e.hash).isValid()) continue;
+				items.push({e.hash, m_packed.data().begin() + e.offset, e.size});
 			}
-			file.close();
 		}
+		sort(items.begin(), items.end(), [](const Item& a, const Item& b){ return a.hash < b.hash; });
+
+		os::OutputFile file;
+		if (!file.open(filename)) {
+			logError("Could not create ", filename);
+			return false;
+		}
+		PackedCacheHeader header;
+		header.count = items.size();
+		bool success = file.write(&header, sizeof(header));
+		u32 offset = sizeof(PackedCacheHeader) + items.size() * sizeof(PackedCacheEntry);
+		for (const Item& item : items) {
+			PackedCacheEntry entry;
+			entry.hash = item.hash;
+			entry.offset = offset;
+			entry.size = item.size;
+			success = file.write(&entry, sizeof(entry)) && success;
+			offset += item.size;
+		}
+		for (const Item& item : items) {
+			success = file.write(item.data, item.size) && success;
+		}
+		file.close();
+		if (!success) logError("Could not write ", filename);
+		return success;
 	}
 
+	// loads local cache, blobs are copied to m_cache, since the file is overwritten in shutdown
 	void loadCache(const char* filename) {
 		PROFILE_FUNCTION();
 		os::InputFile file;
-		if (file.open(filename)) {
-			u32 version;
-			if (!file.read(&version, sizeof(version))) {
-				logError("Could not read ", filename);
-			}
-			ASSERT(version == 0);
+		if (!file.open(filename)) return;
+		
+		OutputMemoryStream content(m_allocator);
+		content.resize(file.size());
+		if (!file.read(content.getMutableData(), content.size())) {
+			logError("Could not read ", filename);
+			file.close();
+			return;
+		}
+		file.close();
+
+		InputMemoryStream blob(content);
+		const u32 magic = blob.read<u32>();
+		// version 0 - the file starts with u32 0 and contains (hash, size, data) triplets
+		if (magic == 0) {
 			StableHash hash;
-			while (file.read(&hash, sizeof(hash))) {
-				u32 size;
-				if (file.read(&size, sizeof(size))) {
-					ID3DBlob* blob;
-					HRESULT res = D3DCreateBlob(size, &blob);
-					if (FAILED(res)) {
-						logError("Failed to create blob");
-						break;
-					}
-					if (!file.read(blob->GetBufferPointer(), size)) break;
-					m_cache.insert(hash, blob);
-				} else {
+			while (blob.read(hash)) {
+				const u32 size = blob.read<u32>();
+				if (blob.hasOverflow() || size > blob.remaining()) break;
+				ID3DBlob* d3d_blob;
+				if (FAILED(D3DCreateBlob(size, &d3d_blob))) {
+					logError("Failed to create blob");
 					break;
 				}
+				blob.read(d3d_blob->GetBufferPointer(), size);
+				m_cache.insert(hash, d3d_blob);
 			}
-			file.close();
+			return;
+		}
+
+		blob.setPosition(0);
+		PackedCacheHeader header;
+		blob.read(header);
+		if (header.magic != PackedCacheHeader::MAGIC || header.version != 1 || blob.remaining() < u64(header.count) * sizeof(PackedCacheEntry)) {
+			logError("Invalid shader cache ", filename);
+			return;
+		}
+		const PackedCacheEntry* entries = (const PackedCacheEntry*)blob.skip(header.count * sizeof(PackedCacheEntry));
+		m_cache.reserve(header.count);
+		for (u32 i = 0; i < header.count; ++i) {
+			const PackedCacheEntry& e = entries[i];
+			if (u64(e.offset) + e.size > content.size()) break;
+			ID3DBlob* d3d_blob;
+			if (FAILED(D3DCreateBlob(e.size, &d3d_blob))) {
+				logError("Failed to create blob");
+				break;
+			}
+			memcpy(d3d_blob->GetBufferPointer(), content.data() + e.offset, e.size);
+			m_cache.insert(e.hash, d3d_blob);
 		}
 	}
 
@@ -553,18 +733,144 @@ struct ShaderCompiler {
 	}
 
 	TagAllocator m_allocator;
+	Mutex m_mutex;
 	
 	// cache source code -> binary blob
-	HashMap<StableHash, ID3DBlob*> m_cache;
+	FlatHashMap<StableHash, ID3DBlob*> m_cache;
+	// blobs created from m_packed
+	FlatHashMap<StableHash, ID3DBlob*> m_packed_blobs;
+	// stages compiled or found in caches since trackUsage
+	FlatHashMap<StableHash, bool> m_used;
+	bool m_track_usage = false;
+	os::MappedFile m_packed;
+	Span<const PackedCacheEntry> m_packed_entries;
+};
+
+// graphics PSOs are created in background jobs, draws using PSO which is not ready yet are skipped
+// compute PSOs are created synchronously, since compute is often used for one-off work (baking, mip generation)
+// all PSOs are stored in pipeline library, which is serialized in shutdown, so next run can skip driver compilation
+// PSOs with the same formats of render targets
+struct PSOLayout {
+	PSOLayout(IAllocator& allocator) : psos(allocator) {}
+
+	StableHash hash;
+	// Program::shader_hash -> PSO, shader_hash includes state
+	FlatHashMap<StableHash, ID3D12PipelineState*> psos;
 };
 
 struct PSOCache {
+	struct PendingPSO {
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+		// copy of program's data, program can be destroyed before the job finishes
+		D3D12_INPUT_ELEMENT_DESC attributes[16];
+		ID3DBlob* vs = nullptr;
+		ID3DBlob* ps = nullptr;
+		WCHAR name[17];
+		ID3D12PipelineState* pso = nullptr;
+		AtomicI32 done = 0;
+	};
+
 	PSOCache(IAllocator& in_allocator)
 		: allocator(in_allocator, "pso cache")
 		, cache(allocator)
+		, layouts(allocator)
+		, pending(allocator)
+		, library_data(allocator)
 	{}
 
+	void init(ID3D12Device* device, const char* filename) {
+		PROFILE_FUNCTION();
+		if (FAILED(device->QueryInterface(IID_PPV_ARGS(&device1)))) {
+			device1 = nullptr;
+			return;
+		}
+
+		os::InputFile file;
+		if (file.open(filename)) {
+			library_data.resize(file.size());
+			if (!file.read(library_data.getMutableData(), library_data.size())) {
+				logError("Could not read ", filename);
+				library_data.clear();
+			}
+			file.close();
+		}
+
+		// library_data must be alive as long as the library
+		if (!library_data.empty() && FAILED(device1->CreatePipelineLibrary(library_data.data(), library_data.size(), IID_PPV_ARGS(&library)))) {
+			// driver or adapter changed
+			library = nullptr;
+			library_data.clear();
+		}
+		if (!library && FAILED(device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&library)))) {
+			library = nullptr;
+		}
+	}
+
+	void shutdown(const char* filename) {
+		PROFILE_FUNCTION();
+		jobs::wait(&jobs_counter);
+		for (auto iter = pending.begin(), end = pending.end(); iter != end; ++iter) {
+			PendingPSO* job = iter.value();
+			if (job->pso) job->pso->Release();
+			releasePending(job);
+		}
+		pending.clear();
+
+		for (auto iter = cache.begin(), end = cache.end(); iter != end; ++iter) {
+			if (iter.value()) iter.value()->Release();
+		}
+		cache.clear();
+		for (auto iter = layouts.begin(), end = layouts.end(); iter != end; ++iter) {
+			PSOLayout* layout = iter.value();
+			for (auto pso_iter = layout->psos.begin(), pso_end = layout->psos.end(); pso_iter != pso_end; ++pso_iter) {
+				if (pso_iter.value()) pso_iter.value()->Release();
+			}
+			LUMIX_DELETE(allocator, layout);
+		}
+		layouts.clear();
+
+		if (library && library_dirty) {
+			OutputMemoryStream blob(allocator);
+			blob.resize(library->GetSerializedSize());
+			if (SUCCEEDED(library->Serialize(blob.getMutableData(), blob.size()))) {
+				os::OutputFile file;
+				if (file.open(filename)) {
+					if (!file.write(blob.data(), blob.size())) logError("Could not write ", filename);
+					file.close();
+				}
+				else {
+					logError("Could not create ", filename);
+				}
+			}
+		}
+		if (library) library->Release();
+		if (device1) device1->Release();
+		library = nullptr;
+		device1 = nullptr;
+	}
+
+	static void toPSOName(StableHash hash, WCHAR (&name)[17]) {
+		const u64 value = hash.getHashValue();
+		for (u32 i = 0; i < 16; ++i) {
+			name[i] = L"0123456789abcdef"[(value >> (60 - i * 4)) & 0xf];
+		}
+		name[16] = 0;
+	}
+
+	void storeToLibrary(const WCHAR* name, ID3D12PipelineState* pso) {
+		if (!library) return;
+		MutexGuard guard(library_mutex);
+		if (SUCCEEDED(library->StorePipeline(name, pso))) library_dirty = true;
+	}
+
+	void releasePending(PendingPSO* job) {
+		if (job->vs) job->vs->Release();
+		if (job->ps) job->ps->Release();
+		LUMIX_DELETE(allocator, job);
+	}
+
 	ID3D12PipelineState* getPipelineStateCompute(ID3D12Device* device, ID3D12RootSignature* root_signature, ProgramHandle program) {
+		MutexGuard guard(mutex);
 		auto iter = cache.find(program->shader_hash);
 		if (iter.isValid()) return iter.value();
 
@@ -577,13 +883,43 @@ struct PSOCache {
 		desc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
 		desc.pRootSignature = root_signature;
 
-		ID3D12PipelineState* pso;
-		HRESULT hr = device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pso));
-		ASSERT(hr == S_OK);
+		WCHAR name[17];
+		toPSOName(program->shader_hash, name);
+		ID3D12PipelineState* pso = nullptr;
+		if (library) {
+			MutexGuard guard(library_mutex);
+			if (FAILED(library->LoadComputePipeline(name, &desc, IID_PPV_ARGS(&pso)))) pso = nullptr;
+		}
+		if (!pso) {
+			HRESULT hr = device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pso));
+			ASSERT(hr == S_OK);
+			storeToLibrary(name, pso);
+		}
 		cache.insert(program->shader_hash, pso);
 		return pso;
 	}
 
+	PSOLayout* getLayout(const FrameBuffer& fb) {
+		MutexGuard guard(mutex);
+		return getLayoutLocked(fb);
+	}
+
+	PSOLayout* getLayoutLocked(const FrameBuffer& fb) {
+		RollingStableHasher hasher;
+		hasher.begin();
+		hasher.update(&fb.ds_format, sizeof(fb.ds_format));
+		hasher.update(&fb.formats[0], sizeof(fb.formats[0]) * fb.count);
+		const StableHash hash = hasher.end64();
+
+		auto iter = layouts.find(hash);
+		if (iter.isValid()) return iter.value();
+
+		PSOLayout* layout = LUMIX_NEW(allocator, PSOLayout)(allocator);
+		layout->hash = hash;
+		layouts.insert(hash, layout);
+		return layout;
+	}
+
 	ID3D12PipelineState* getPipelineState(ID3D12Device* device
 		, ProgramHandle program
 		, const FrameBuffer& fb
@@ -592,6 +928,14 @@ struct PSOCache {
 		ASSERT(program);
 
 		Program& p = *program;
+		MutexGuard guard(mutex);
+		PSOLayout* layout = fb.pso_layout ? fb.pso_layout : getLayoutLocked(fb);
+		auto iter = layout->psos.find(p.shader_hash);
+		if (iter.isValid()) {
+			return iter.value();
+		}
+
+		// miss, hash of everything is used as a key for pending PSOs and in pipeline library
 		RollingStableHasher hasher;
 		hasher.begin();
 		hasher.update(&p.shader_hash, sizeof(p.shader_hash));
@@ -599,10 +943,17 @@ struct PSOCache {
 		hasher.update(&fb.formats[0], sizeof(fb.formats[0]) * fb.count);
 		const StableHash hash = hasher.end64();
 
-		auto iter = cache.find(hash);
-		if (iter.isValid()) {
-			last = iter.value();
-			return iter.value();
+		auto pending_iter = pending.find(hash);
+		if (pending_iter.isValid()) {
+			PendingPSO* job = pending_iter.value();
+			if (job->done == 0) return nullptr;
+
+			ID3D12PipelineState* pso = job->pso;
+			pending.erase(pending_iter);
+			releasePending(job);
+			// failed PSO is cached too, so we do not try to create it every frame
+			layout->psos.insert(p.shader_hash, pso);
+			return pso;
 		}
 
 		if (!program->vs && !program->ps && !program->cs) return nullptr;
@@ -742,19 +1093,58 @@ struct PSOCache {
 			desc.RTVFormats[i] = fb.formats[i];
 		}
 
-		ID3D12PipelineState* pso;
-		HRESULT hr = device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pso));
-		ASSERT(hr == S_OK);
-		cache.insert(hash, pso);
-		last = pso;
-		return pso;
+		PendingPSO* job = LUMIX_NEW(allocator, PendingPSO);
+		toPSOName(hash, job->name);
+
+		// loading from library is cheap, so it's done synchronously
+		if (library) {
+			ID3D12PipelineState* pso = nullptr;
+			MutexGuard guard(library_mutex);
+			if (SUCCEEDED(library->LoadGraphicsPipeline(job->name, &desc, IID_PPV_ARGS(&pso)))) {
+				LUMIX_DELETE(allocator, job);
+				layout->psos.insert(p.shader_hash, pso);
+				return pso;
+			}
+		}
+
+		job->desc = desc;
+		memcpy(job->attributes, p.attributes, sizeof(p.attributes[0]) * p.attribute_count);
+		job->desc.InputLayout.pInputElementDescs = job->attributes;
+		job->vs = p.vs;
+		job->ps = p.ps;
+		if (job->vs) job->vs->AddRef();
+		if (job->ps) job->ps->AddRef();
+		pending.insert(hash, job);
+
+		jobs::runLambda([this, device, job](){
+			PROFILE_BLOCK("create PSO");
+			if (FAILED(device->CreateGraphicsPipelineState(&job->desc, IID_PPV_ARGS(&job->pso)))) {
+				logError("Failed to create pipeline state");
+				job->pso = nullptr;
+			}
+			else {
+				storeToLibrary(job->name, job->pso);
+			}
+			job->done = 1;
+		}, &jobs_counter, jobs::ANY_WORKER, jobs::Priority::BACKGROUND);
+		return nullptr;
 	}
 
-	// TODO separate compute and graphics cache
-	// TODO graphics cache should be [framebuffer][shader_hash] -> PSO, and [framebuffer] can be computed once in setFramebuffer
 	TagAllocator allocator;
-	HashMap<StableHash, ID3D12PipelineState*> cache;
-	ID3D12PipelineState* last = nullptr;
+	// compute PSOs, Program::shader_hash -> PSO
+	FlatHashMap<StableHash, ID3D12PipelineState*> cache;
+	// graphics PSOs, layouts are never destroyed, so FrameBuffer can keep pointer to its layout
+	FlatHashMap<StableHash, PSOLayout*> layouts;
+	// jobs access only their PendingPSO
+	FlatHashMap<StableHash, PendingPSO*> pending;
+	// lookups can be done from parallel recording jobs, see beginParallel
+	Mutex mutex;
+	jobs::Counter jobs_counter;
+	ID3D12Device1* device1 = nullptr;
+	ID3D12PipelineLibrary* library = nullptr;
+	OutputMemoryStream library_data;
+	Mutex library_mutex;
+	bool library_dirty = false;
 };
 
 // TODO actually use gpu::TextureHandle.flags 
@@ -824,17 +1214,18 @@ struct SRVUAVHeap {
 
 	D3D12_GPU_DESCRIPTOR_HANDLE allocTransient(ID3D12Device* device, Span<ID3D12Resource*> resources, Span<const D3D12_SHADER_RESOURCE_VIEW_DESC> srv_descs) {
 		ASSERT(resources.length() == srv_descs.length());
-		ASSERT(transient_count + resources.length() <= max_transient_count);
+		// can be called from parallel recording jobs
+		const u32 offset = (u32)transient_count.add(resources.length());
+		ASSERT(offset + resources.length() <= max_transient_count);
 		D3D12_GPU_DESCRIPTOR_HANDLE gpu = heap->GetGPUDescriptorHandleForHeapStart();
 		ASSERT(gpu.ptr);
 		D3D12_CPU_DESCRIPTOR_HANDLE cpu = heap->GetCPUDescriptorHandleForHeapStart();
-		gpu.ptr += (frame * max_transient_count + transient_count) * handle_increment_size;
-		cpu.ptr += (frame * max_transient_count + transient_count) * handle_increment_size;
+		gpu.ptr += (frame * max_transient_count + offset) * handle_increment_size;
+		cpu.ptr += (frame * max_transient_count + offset) * handle_increment_size;
 		for (u32 i = 0; i < resources.length(); ++i) {
 			if (resources[i]) device->CreateShaderResourceView(resources[i], &srv_descs[i], cpu);
 			cpu.ptr += handle_increment_size;
 		}
-		transient_count += resources.length();
 		return gpu;
 	}
 
@@ -909,7 +1300,7 @@ struct SRVUAVHeap {
 	u32 num_resouces = 0;
 	u32 max_resource_count = 0;
 	u32 max_transient_count = 0;
-	u32 transient_count = 0;
+	AtomicI32 transient_count = 0;
 	u32 frame = 0;
 	jobs::Mutex mutex;
 };
@@ -1031,13 +1422,230 @@ static ID3D12Resource* createBuffer(ID3D12Device* device, const void* data, u64
 	return upload_buffer;
 }
 
+// uploads to resources in COMMON state are recorded to copy queue, so they do not take time on graphics queue
+// staging memory is a persistent ring buffer, its space is reclaimed when copy queue's fence passes
+// copies are submitted and graphics queue waits for them before any graphics work is submitted, see submit()
+struct CopyQueue {
+	static constexpr u64 RING_SIZE = 64 * 1024 * 1024;
+	// bigger uploads are done on graphics queue
+	static constexpr u64 MAX_UPLOAD_SIZE = RING_SIZE / 4;
+
+	struct Batch {
+		ID3D12CommandAllocator* allocator = nullptr;
+		ID3D12GraphicsCommandList* cmd_list = nullptr;
+		// signaled when the batch is finished
+		u64 fence_value = 0;
+		// ring memory before this offset can be reused when the batch is finished
+		u64 ring_end = 0;
+	};
+
+	CopyQueue(IAllocator& allocator) : batches(allocator) {}
+
+	bool init(ID3D12Device* in_device) {
+		device = in_device;
+		D3D12_COMMAND_QUEUE_DESC desc = {};
+		desc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+		desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+		desc.NodeMask = 1;
+		if (device->CreateCommandQueue(&desc, IID_PPV_ARGS(&queue)) != S_OK) return false;
+		if (device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)) != S_OK) return false;
+		ring = createBuffer(device, nullptr, RING_SIZE, D3D12_HEAP_TYPE_UPLOAD, "copy queue staging");
+		if (!ring) return false;
+		// upload heap can stay mapped
+		return ring->Map(0, nullptr, (void**)&ring_ptr) == S_OK;
+	}
+
+	void shutdown() {
+		if (fence && fence_value != 0) fence->SetEventOnCompletion(fence_value, nullptr);
+		for (Batch& b : batches) {
+			b.cmd_list->Release();
+			b.allocator->Release();
+		}
+		batches.clear();
+		if (ring) ring->Release();
+		if (fence) fence->Release();
+		if (queue) queue->Release();
+	}
+
+	// submits copies recorded so far, `graphics_queue` waits for them on gpu
+	void submit(ID3D12CommandQueue* graphics_queue) {
+		MutexGuard guard(mutex);
+		if (current >= 0) submitBatch();
+		if (waited_value != fence_value) {
+			graphics_queue->Wait(fence, fence_value);
+			waited_value = fence_value;
+		}
+	}
+
+	// returns false if the copy can not be done on copy queue
+	bool update(ID3D12Resource* dst, u64 dst_offset, const void* data, u64 size) {
+		if (size > MAX_UPLOAD_SIZE) return false;
+		MutexGuard guard(mutex);
+		const u64 offset = allocStaging(size, 16);
+		memcpy(ring_ptr + offset, data, size);
+		getCmdList()->CopyBufferRegion(dst, dst_offset, ring, offset, size);
+		return true;
+	}
+
+	// returns false if the copy can not be done on copy queue
+	bool update(ID3D12Resource* dst
+		, u32 subresource
+		, u32 x
+		, u32 y
+		, D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout
+		, u32 num_rows
+		, u64 total_bytes
+		, const u8* data
+		, u32 src_pitch
+		, const D3D12_BOX& box)
+	{
+		if (total_bytes > MAX_UPLOAD_SIZE) return false;
+		MutexGuard guard(mutex);
+		layout.Offset = allocStaging(total_bytes, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+		u8* staging = ring_ptr + layout.Offset;
+		for (u32 i = 0; i < num_rows; ++i) {
+			memcpy(&staging[i * layout.Footprint.RowPitch], &data[i * src_pitch], src_pitch);
+		}
+		D3D12_TEXTURE_COPY_LOCATION dst_loc = {dst, D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX, {}};
+		dst_loc.SubresourceIndex = subresource;
+		D3D12_TEXTURE_COPY_LOCATION src_loc = {ring, D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT, {layout}};
+		getCmdList()->CopyTextureRegion(&dst_loc, x, y, 0, &src_loc, &box);
+		return true;
+	}
+
+private:
+	void submitBatch() {
+		Batch& b = batches[current];
+		HRESULT hr = b.cmd_list->Close();
+		ASSERT(hr == S_OK);
+		queue->ExecuteCommandLists(1, (ID3D12CommandList* const*)&b.cmd_list);
+		++fence_value;
+		hr = queue->Signal(fence, fence_value);
+		ASSERT(hr == S_OK);
+		b.fence_value = fence_value;
+		b.ring_end = head;
+		current = -1;
+	}
+
+	void reclaim() {
+		const u64 completed = fence->GetCompletedValue();
+		for (const Batch& b : batches) {
+			if (b.fence_value != 0 && b.fence_value <= completed) tail = maximum(tail, b.ring_end);
+		}
+	}
+
+	ID3D12GraphicsCommandList* getCmdList() {
+		if (current >= 0) return batches[current].cmd_list;
+		
+		const u64 completed = fence->GetCompletedValue();
+		for (i32 i = 0, c = batches.size(); i < c; ++i) {
+			Batch& b = batches[i];
+			if (b.fence_value > completed) continue;
+			b.allocator->Reset();
+			b.cmd_list->Reset(b.allocator, nullptr);
+			current = i;
+			return b.cmd_list;
+		}
+
+		Batch& b = batches.emplace();
+		HRESULT hr = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&b.allocator));
+		ASSERT(hr == S_OK);
+		hr = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, b.allocator, nullptr, IID_PPV_ARGS(&b.cmd_list));
+		ASSERT(hr == S_OK);
+		current = batches.size() - 1;
+		return b.cmd_list;
+	}
+
+	// returns offset in ring, waits for gpu if the ring is full
+	u64 allocStaging(u64 size, u64 align) {
+		ASSERT(size <= MAX_UPLOAD_SIZE);
+		// RING_SIZE is multiple of align, so offsets in ring are aligned too
+		u64 offset = (head + align - 1) / align * align;
+		if (offset % RING_SIZE + size > RING_SIZE) offset = (offset / RING_SIZE + 1) * RING_SIZE;
+		
+		reclaim();
+		while (offset + size - tail > RING_SIZE) {
+			PROFILE_BLOCK("wait for copy queue");
+			// memory used by current batch is reclaimed only after the batch is submitted
+			if (current >= 0) submitBatch();
+			u64 oldest = 0;
+			const u64 completed = fence->GetCompletedValue();
+			for (const Batch& b : batches) {
+				if (b.fence_value > completed && (oldest == 0 || b.fence_value < oldest)) oldest = b.fence_value;
+			}
+			ASSERT(oldest != 0);
+			fence->SetEventOnCompletion(oldest, nullptr);
+			reclaim();
+		}
+		head = offset + size;
+		return offset % RING_SIZE;
+	}
+
+	ID3D12Device* device = nullptr;
+	ID3D12CommandQueue* queue = nullptr;
+	ID3D12Fence* fence = nullptr;
+	u64 fence_value = 0;
+	// last fence value graphics queue waits for
+	u64 waited_value = 0;
+	ID3D12Resource* ring = nullptr;
+	u8* ring_ptr = nullptr;
+	// [tail, head) is used, offsets grow monotonically, offset in ring is offset % RING_SIZE
+	u64 head = 0;
+	u64 tail = 0;
+	Array<Batch> batches;
+	// index of batch which is being recorded, -1 if none
+	i32 current = -1;
+	Mutex mutex;
+};
+
+// persistently mapped readback memory for readTexture and readBuffer, so reads do not create a staging resource each time
+// reads recorded in a frame are delivered when the frame's fence passes (see Frame::begin), i.e. a few frames later, without waiting for gpu
+// frames finish in order, so space is reclaimed up to the ring head recorded by the finished frame
+struct ReadbackRing {
+	static constexpr u64 RING_SIZE = 32 * 1024 * 1024;
+
+	bool init(ID3D12Device* device) {
+		ring = createBuffer(device, nullptr, RING_SIZE, D3D12_HEAP_TYPE_READBACK, "readback ring");
+		if (!ring) return false;
+		// readback heap can stay mapped, data are read only after the fence of the frame which wrote them
+		return ring->Map(0, nullptr, (void**)&ring_ptr) == S_OK;
+	}
+
+	void shutdown() {
+		if (ring) ring->Release();
+		ring = nullptr;
+	}
+
+	// returns false if the ring is full, caller falls back to a dedicated staging buffer instead of waiting
+	bool alloc(u64 size, u64 align, u64& ring_offset) {
+		// RING_SIZE is multiple of align, so offsets in ring are aligned too
+		u64 offset = (head + align - 1) / align * align;
+		if (offset % RING_SIZE + size > RING_SIZE) offset = (offset / RING_SIZE + 1) * RING_SIZE;
+		if (offset + size - tail > RING_SIZE) return false;
+		head = offset + size;
+		ring_offset = offset % RING_SIZE;
+		return true;
+	}
+
+	ID3D12Resource* ring = nullptr;
+	u8* ring_ptr = nullptr;
+	// [tail, head) is used, offsets grow monotonically, offset in ring is offset % RING_SIZE
+	u64 head = 0;
+	u64 tail = 0;
+};
+
 struct Frame {
-	struct TextureRead {
+	struct Read {
+		// readback ring or a dedicated buffer if the read did not fit in the ring
 		ID3D12Resource* staging;
+		bool owns_staging;
 		TextureReadCallback callback;
 		// TODO size
 		D3D12_PLACED_SUBRESOURCE_FOOTPRINT layouts[16 * 6];
+		// 0 for buffer reads
 		u32 num_layouts;
+		// offset of buffer data in staging, unused for textures, offsets are in layouts
+		u64 offset;
 		u32 dst_total_bytes;
 	};
 
@@ -1046,13 +1654,15 @@ struct Frame {
 		, to_heap_release(allocator)
 		, to_resolve(allocator)
 		, to_resolve_stats(allocator)
-		, texture_reads(allocator)
+		, reads(allocator)
+		, parallel_allocators(allocator)
 	{}
 
 	void clear();
 
 	bool init(ID3D12Device* device) {
 		if (device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&cmd_allocator)) != S_OK) return false;
+		if (device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COMPUTE, IID_PPV_ARGS(&compute_cmd_allocator)) != S_OK) return false;
 		if (device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)) != S_OK) return false;
 
 		scratch_buffer = createBuffer(device, nullptr, SCRATCH_BUFFER_SIZE, D3D12_HEAP_TYPE_UPLOAD, "scratch buffer");
@@ -1085,13 +1695,18 @@ struct Frame {
 	u8* scratch_buffer_ptr = nullptr;
 	u8* scratch_buffer_begin = nullptr;
 	ID3D12CommandAllocator* cmd_allocator = nullptr;
+	ID3D12CommandAllocator* compute_cmd_allocator = nullptr;
+	// one for each parallel command list, created on demand
+	Array<ID3D12CommandAllocator*> parallel_allocators;
 	Array<IUnknown*> to_release;
 	Array<u32> to_heap_release;
 	ID3D12Fence* fence = nullptr;
 	u64 fence_value = 0;
 	Array<Query*> to_resolve;
 	Array<Query*> to_resolve_stats;
-	Array<TextureRead> texture_reads;
+	Array<Read> reads;
+	// readback ring head after the last read recorded in this frame
+	u64 readback_ring_end = 0;
 	ID3D12Resource* timestamp_query_buffer;
 	ID3D12Resource* stats_query_buffer;
 	u8* timestamp_query_buffer_ptr;
@@ -1104,11 +1719,31 @@ struct SRV {
 	BufferHandle buffer;
 };
 
+// state of a command list being recorded, render thread has one, and there's one for each list recorded in parallel, see beginParallel
+struct CmdContext {
+	ID3D12GraphicsCommandList* cmd_list = nullptr;
+	BufferHandle current_indirect_buffer = INVALID_BUFFER;
+	BufferHandle current_index_buffer = INVALID_BUFFER;
+	ProgramHandle current_program = INVALID_PROGRAM;
+	// program whose PSO and root tables are set in cmd_list
+	ProgramHandle last_program = INVALID_PROGRAM;
+	FrameBuffer current_framebuffer;
+	D3D12_GPU_VIRTUAL_ADDRESS uniform_blocks[6] = {};
+	u32 dirty_compute_uniform_blocks = 0;
+	u32 dirty_gfx_uniform_blocks = 0;
+	D3D12_GPU_DESCRIPTOR_HANDLE bound_shader_buffers = {};
+	// kept so new command lists can continue with the same state
+	D3D12_VIEWPORT viewport = {};
+	D3D12_RECT scissor = {};
+};
+
 struct D3D {
 	struct Window {
 		void* handle = nullptr;
 		IDXGISwapChain3* swapchain = nullptr;
 		ID3D12Resource* backbuffers[NUM_BACKBUFFERS] = {};
+		// signaled when swapchain can accept a new frame, see waitForSwapchain
+		HANDLE latency_waitable = nullptr;
 		IVec2 size = IVec2(800, 600);
 		u64 last_used_frame = 0;
 	};
@@ -1123,6 +1758,8 @@ struct D3D {
 		, shader_compiler(allocator)
 		, frames(allocator)
 		, pso_cache(allocator)
+		, copy_queue(allocator)
+		, parallel_ctxs(allocator)
 	{}
 
 	static IAllocator& getRoot(IAllocator& allocator) {
@@ -1136,6 +1773,14 @@ struct D3D {
 	TagAllocator texture_tag_allocator;
 	TagAllocator buffer_tag_allocator;
 	TagAllocator rendertarget_tag_allocator;
+	// bytes of committed resources and heaps by category, see getMemoryStats
+	AtomicI64 texture_mem = 0;
+	AtomicI64 render_target_mem = 0;
+	AtomicI64 buffer_mem = 0;
+	// used to query OS budget, see getMemoryStats
+	IDXGIAdapter3* adapter = nullptr;
+	u64 dedicated_vidmem = 0;
+	u64 shared_sysmem = 0;
 	DWORD thread;
 	RENDERDOC_API_1_0_2* rdoc_api = nullptr;
 	ID3D12Device* device = nullptr;
@@ -1143,17 +1788,29 @@ struct D3D {
 	ID3D12Debug* debug = nullptr;
 	ID3D12CommandQueue* cmd_queue = nullptr;
 	u64 fence_value = 0;
+	// cmd_list is the list of current queue, one of these
+	ID3D12GraphicsCommandList* graphics_cmd_list = nullptr;
+	ID3D12GraphicsCommandList* compute_cmd_list = nullptr;
+	ID3D12CommandQueue* compute_queue = nullptr;
+	QueueType current_queue = QueueType::GRAPHICS;
+	// something was recorded to compute_cmd_list this frame
+	bool compute_used = false;
+	// used to synchronize queues, indexed by QueueType
+	ID3D12Fence* queue_fences[2] = {};
+	u64 queue_fence_values[2] = {};
 	u64 query_frequency = 1;
-	BufferHandle current_indirect_buffer = INVALID_BUFFER;
-	BufferHandle current_index_buffer = INVALID_BUFFER;
-	ProgramHandle current_program = INVALID_PROGRAM;
 	PSOCache pso_cache;
+	CopyQueue copy_queue;
+	ReadbackRing readback_ring;
 	Window windows[64];
 	Window* current_window = windows;
-	FrameBuffer current_framebuffer;
 	Array<Frame> frames;
 	Frame* frame;
-	ID3D12GraphicsCommandList* cmd_list = nullptr;
+	// recording state of render thread
+	CmdContext main_ctx;
+	// see beginParallel, lists are created on demand and reused
+	Array<CmdContext> parallel_ctxs;
+	u32 parallel_count = 0;
 	HMODULE d3d_dll;
 	HMODULE dxgi_dll;
 	SRVUAVHeap srv_heap;
@@ -1165,33 +1822,181 @@ struct D3D {
 	RTVDSVHeap rtv_heap;
 	RTVDSVHeap ds_heap;
 	ShaderCompiler shader_compiler;
-	D3D12_GPU_VIRTUAL_ADDRESS uniform_blocks[6];
-	u32 dirty_compute_uniform_blocks = 0;
-	u32 dirty_gfx_uniform_blocks = 0;
 	u64 frame_number = 0;
 	u32 debug_groups_depth = 0;
 	StaticString<128> debug_groups_queue[8];
-	D3D12_GPU_DESCRIPTOR_HANDLE bound_shader_buffers = {};
 	void* nvml_lib = nullptr;
 	nvmlDevice_t nvml_device;
 
 	bool vsync = true;
 	bool vsync_dirty = false;
 	Mutex vsync_mutex;
+	// guards Window::latency_waitable, it's used from other threads in waitForSwapchain
+	Mutex latency_mutex;
 	Mutex disassembly_mutex;
 };
 
 static Local<D3D> d3d;
+// render thread uses d3d->main_ctx, jobs recording in parallel use one of d3d->parallel_ctxs
+static thread_local CmdContext* t_ctx = nullptr;
+
+static LUMIX_FORCE_INLINE CmdContext& ctx() {
+	ASSERT(t_ctx);
+	return *t_ctx;
+}
 
 void resetCommandList() {
-	d3d->cmd_list->SetGraphicsRootSignature(d3d->root_signature);
-	d3d->cmd_list->SetComputeRootSignature(d3d->root_signature);
+	ctx().cmd_list->SetGraphicsRootSignature(d3d->root_signature);
+	ctx().cmd_list->SetComputeRootSignature(d3d->root_signature);
 	ID3D12DescriptorHeap* heaps[] = {d3d->srv_heap.heap, d3d->sampler_heap.heap};
-	d3d->cmd_list->SetDescriptorHeaps(lengthOf(heaps), heaps);
+	ctx().cmd_list->SetDescriptorHeaps(lengthOf(heaps), heaps);
+}
+
+static void resetComputeCommandList() {
+	d3d->compute_cmd_list->Reset(d3d->frame->compute_cmd_allocator, nullptr);
+	d3d->compute_cmd_list->SetComputeRootSignature(d3d->root_signature);
+	ID3D12DescriptorHeap* heaps[] = {d3d->srv_heap.heap, d3d->sampler_heap.heap};
+	d3d->compute_cmd_list->SetDescriptorHeaps(lengthOf(heaps), heaps);
+}
+
+// bindings are per command list, so they must be applied again after command list is changed
+static void invalidateBindings(CmdContext& c);
+
+// sets state of `c` in its new command list, the list must be a direct one
+static void applyState(CmdContext& c) {
+	c.cmd_list->SetGraphicsRootSignature(d3d->root_signature);
+	c.cmd_list->SetComputeRootSignature(d3d->root_signature);
+	ID3D12DescriptorHeap* heaps[] = {d3d->srv_heap.heap, d3d->sampler_heap.heap};
+	c.cmd_list->SetDescriptorHeaps(lengthOf(heaps), heaps);
+	D3D12_CPU_DESCRIPTOR_HANDLE* ds = c.current_framebuffer.depth_stencil.ptr ? &c.current_framebuffer.depth_stencil : nullptr;
+	c.cmd_list->OMSetRenderTargets(c.current_framebuffer.count, c.current_framebuffer.render_targets, FALSE, ds);
+	if (c.viewport.Width > 0) c.cmd_list->RSSetViewports(1, &c.viewport);
+	if (c.scissor.right > c.scissor.left) c.cmd_list->RSSetScissorRects(1, &c.scissor);
+	invalidateBindings(c);
+}
+
+// executes commands recorded so far to `queue` and continues with a new command list
+static void flushQueue(QueueType queue) {
+	if (queue == QueueType::COMPUTE) {
+		if (!d3d->compute_used) return;
+		HRESULT hr = d3d->compute_cmd_list->Close();
+		ASSERT(hr == S_OK);
+		d3d->compute_queue->ExecuteCommandLists(1, (ID3D12CommandList* const*)&d3d->compute_cmd_list);
+		resetComputeCommandList();
+		d3d->compute_used = d3d->current_queue == QueueType::COMPUTE;
+		return;
+	}
+
+	HRESULT hr = d3d->graphics_cmd_list->Close();
+	ASSERT(hr == S_OK);
+	d3d->copy_queue.submit(d3d->cmd_queue);
+	d3d->cmd_queue->ExecuteCommandLists(1, (ID3D12CommandList* const*)&d3d->graphics_cmd_list);
+	d3d->graphics_cmd_list->Reset(d3d->frame->cmd_allocator, nullptr);
+	ID3D12GraphicsCommandList* prev = ctx().cmd_list;
+	ctx().cmd_list = d3d->graphics_cmd_list;
+	applyState(ctx());
+	ctx().cmd_list = prev;
+}
+
+void setQueue(QueueType queue) {
+	checkThread();
+	if (queue == d3d->current_queue) return;
+	d3d->current_queue = queue;
+	ctx().cmd_list = queue == QueueType::COMPUTE ? d3d->compute_cmd_list : d3d->graphics_cmd_list;
+	if (queue == QueueType::COMPUTE) d3d->compute_used = true;
+	invalidateBindings(ctx());
+}
+
+void syncQueues(QueueType waiting, QueueType signaling) {
+	checkThread();
+	ASSERT(waiting != signaling);
+	// commands recorded before this call do not need to wait
+	flushQueue(waiting);
+	flushQueue(signaling);
+	ID3D12Fence* fence = d3d->queue_fences[(u32)signaling];
+	const u64 value = ++d3d->queue_fence_values[(u32)signaling];
+	ID3D12CommandQueue* signaling_queue = signaling == QueueType::COMPUTE ? d3d->compute_queue : d3d->cmd_queue;
+	ID3D12CommandQueue* waiting_queue = waiting == QueueType::COMPUTE ? d3d->compute_queue : d3d->cmd_queue;
+	HRESULT hr = signaling_queue->Signal(fence, value);
+	ASSERT(hr == S_OK);
+	hr = waiting_queue->Wait(fence, value);
+	ASSERT(hr == S_OK);
+	invalidateBindings(ctx());
+}
+
+void beginParallel(u32 count) {
+	checkThread();
+	ASSERT(d3d->current_queue == QueueType::GRAPHICS);
+	ASSERT(d3d->parallel_count == 0);
+	Array<ID3D12CommandAllocator*>& allocators = d3d->frame->parallel_allocators;
+	while (allocators.size() < count) {
+		ID3D12CommandAllocator* a;
+		if (d3d->device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&a)) != S_OK) {
+			ASSERT(false);
+			return;
+		}
+		allocators.push(a);
+	}
+
+	while (d3d->parallel_ctxs.size() < count) {
+		ID3D12GraphicsCommandList* list;
+		if (d3d->device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocators[d3d->parallel_ctxs.size()], nullptr, IID_PPV_ARGS(&list)) != S_OK) {
+			ASSERT(false);
+			return;
+		}
+		list->Close();
+		d3d->parallel_ctxs.emplace().cmd_list = list;
+	}
+
+	for (u32 i = 0; i < count; ++i) {
+		CmdContext& c = d3d->parallel_ctxs[i];
+		ID3D12GraphicsCommandList* list = c.cmd_list;
+		c = d3d->main_ctx;
+		c.cmd_list = list;
+		list->Reset(allocators[i], nullptr);
+		applyState(c);
+	}
+	d3d->parallel_count = count;
+}
+
+void bindParallelContext(u32 idx) {
+	ASSERT(idx < d3d->parallel_count);
+	t_ctx = &d3d->parallel_ctxs[idx];
+}
+
+void unbindParallelContext() {
+	// jobs can run on render thread too
+	t_ctx = d3d->thread == GetCurrentThreadId() ? &d3d->main_ctx : nullptr;
+}
+
+void endParallel() {
+	checkThread();
+	ID3D12CommandList* lists[65];
+	const u32 count = d3d->parallel_count;
+	ASSERT(count < lengthOf(lists));
+	HRESULT hr = d3d->graphics_cmd_list->Close();
+	ASSERT(hr == S_OK);
+	lists[0] = d3d->graphics_cmd_list;
+	for (u32 i = 0; i < count; ++i) {
+		hr = d3d->parallel_ctxs[i].cmd_list->Close();
+		ASSERT(hr == S_OK);
+		lists[i + 1] = d3d->parallel_ctxs[i].cmd_list;
+	}
+	d3d->copy_queue.submit(d3d->cmd_queue);
+	d3d->cmd_queue->ExecuteCommandLists(count + 1, lists);
+	d3d->parallel_count = 0;
+
+	d3d->graphics_cmd_list->Reset(d3d->frame->cmd_allocator, nullptr);
+	applyState(d3d->main_ctx);
+}
+
+// compute command lists can not use graphics-only states included in GENERIC_READ
+static D3D12_RESOURCE_STATES getReadState() {
+	return d3d->current_queue == QueueType::COMPUTE ? D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE : D3D12_RESOURCE_STATE_GENERIC_READ;
 }
 
 void* getDX12CommandList() {
-	return d3d->cmd_list;
+	return ctx().cmd_list;
 }
 
 void* getDX12Device() {
@@ -1204,24 +2009,42 @@ void* getDX12Resource(TextureHandle h) {
 
 void barrier(BufferHandle buffer, BarrierType type) {
 	switch(type) {
-		case BarrierType::WRITE: buffer->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_UNORDERED_ACCESS); break;
-		case BarrierType::READ: buffer->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_GENERIC_READ); break;
-		case BarrierType::COMMON: buffer->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_COMMON); break;
+		case BarrierType::WRITE: buffer->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_UNORDERED_ACCESS); break;
+		case BarrierType::READ: buffer->setState(ctx().cmd_list, getReadState()); break;
+		case BarrierType::COMMON: buffer->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_COMMON); break;
 	}
 }
 
 void barrier(TextureHandle texture, BarrierType type) {
 	switch(type) {
-		case BarrierType::WRITE: texture->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_UNORDERED_ACCESS); break;
+		case BarrierType::WRITE: texture->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_UNORDERED_ACCESS); break;
 		case BarrierType::READ: 
 			if (isDepthFormat(texture->dxgi_format)) {
-				texture->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_DEPTH_READ |  D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+				texture->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_DEPTH_READ |  D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 			}
 			else {
-				texture->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_GENERIC_READ);
+				texture->setState(ctx().cmd_list, getReadState());
 			}
 			break;
-		case BarrierType::COMMON: texture->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_COMMON); break;
+		case BarrierType::COMMON: texture->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_COMMON); break;
+	}
+}
+
+void aliasingBarrier(TextureHandle texture) {
+	ASSERT(texture->is_placed);
+	ID3D12GraphicsCommandList* cmd_list = ctx().cmd_list;
+	D3D12_RESOURCE_BARRIER barrier;
+	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+	barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+	barrier.Aliasing.pResourceBefore = nullptr;
+	barrier.Aliasing.pResourceAfter = texture->resource;
+	cmd_list->ResourceBarrier(1, &barrier);
+
+	// placed render targets must be initialized by clear, copy or discard before they are used
+	if (isFlagSet(texture->flags, TextureFlags::RENDER_TARGET)) {
+		const bool is_depth = isDepthFormat(texture->dxgi_format);
+		texture->setState(cmd_list, is_depth ? D3D12_RESOURCE_STATE_DEPTH_WRITE : D3D12_RESOURCE_STATE_RENDER_TARGET);
+		cmd_list->DiscardResource(texture->resource, nullptr);
 	}
 }
 
@@ -1230,7 +2053,7 @@ void memoryBarrier(BufferHandle buffer) {
 	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
 	barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
 	barrier.UAV.pResource = buffer->resource;
-	d3d->cmd_list->ResourceBarrier(1, &barrier);
+	ctx().cmd_list->ResourceBarrier(1, &barrier);
 }
 
 void memoryBarrier(TextureHandle texture) {
@@ -1239,7 +2062,7 @@ void memoryBarrier(TextureHandle texture) {
 	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
 	barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
 	barrier.UAV.pResource = texture->resource;
-	d3d->cmd_list->ResourceBarrier(1, &barrier);
+	ctx().cmd_list->ResourceBarrier(1, &barrier);
 }
 
 void Frame::end(ID3D12CommandQueue* cmd_queue, ID3D12GraphicsCommandList* cmd_list, ID3D12QueryHeap* timestamp_query_heap, ID3D12QueryHeap* stats_query_heap) {
@@ -1303,6 +2126,12 @@ void Frame::begin() {
 		D3D12_QUERY_DATA_PIPELINE_STATISTICS stats;
 		memcpy(&stats, stats_query_buffer_ptr + i * sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS), sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS));
 		q->result = stats.CInvocations;
+		q->stats.input_primitives = stats.IAPrimitives;
+		q->stats.vs_invocations = stats.VSInvocations;
+		q->stats.clipper_invocations = stats.CInvocations;
+		q->stats.clipper_primitives = stats.CPrimitives;
+		q->stats.ps_invocations = stats.PSInvocations;
+		q->stats.cs_invocations = stats.CSInvocations;
 		q->ready = true;
 	}
 	to_resolve_stats.clear();
@@ -1314,27 +2143,36 @@ void Frame::begin() {
 	to_release.clear();
 	to_heap_release.clear();
 
-	for (const TextureRead& read : texture_reads) {
-		u8* src = nullptr; 
-		HRESULT hr = read.staging->Map(0, nullptr, (void**)&src);
+	for (const Read& read : reads) {
+		// readback ring is mapped all the time
+		u8* src = d3d->readback_ring.ring_ptr;
+		HRESULT hr = S_OK;
+		if (read.owns_staging) hr = read.staging->Map(0, nullptr, (void**)&src);
 		if (src && hr == S_OK) {
-			u8* dst = (u8*)d3d->allocator.allocate(read.dst_total_bytes, 16);
-			u8* dst_start = dst;
-			for (u32 i = 0; i < read.num_layouts; ++i) {
-				const auto& footprint = read.layouts[i].Footprint;
-				u32 dst_row_size = footprint.Width * getSize(footprint.Format);
-				for (u32 row = 0; row < footprint.Height; ++row) {
-					memcpy(dst, src + read.layouts[i].Offset + row * footprint.RowPitch, dst_row_size);
-					dst += dst_row_size;
+			if (read.num_layouts == 0) {
+				// buffer data are tightly packed, no need to copy
+				read.callback.invoke(Span((const u8*)src + read.offset, read.dst_total_bytes));
+			}
+			else {
+				u8* dst = (u8*)d3d->allocator.allocate(read.dst_total_bytes, 16);
+				u8* dst_start = dst;
+				for (u32 i = 0; i < read.num_layouts; ++i) {
+					const auto& footprint = read.layouts[i].Footprint;
+					u32 dst_row_size = footprint.Width * getSize(footprint.Format);
+					for (u32 row = 0; row < footprint.Height; ++row) {
+						memcpy(dst, src + read.layouts[i].Offset + row * footprint.RowPitch, dst_row_size);
+						dst += dst_row_size;
+					}
 				}
+				read.callback.invoke(Span(dst_start, read.dst_total_bytes));
+				d3d->allocator.deallocate(dst_start);
 			}
-			read.callback.invoke(Span(dst_start, read.dst_total_bytes));
-			d3d->allocator.deallocate(dst_start);
-			read.staging->Unmap(0, nullptr);
+			if (read.owns_staging) read.staging->Unmap(0, nullptr);
 		}
-		read.staging->Release();
+		if (read.owns_staging) read.staging->Release();
 	}
-	texture_reads.clear();
+	reads.clear();
+	d3d->readback_ring.tail = maximum(d3d->readback_ring.tail, readback_ring_end);
 }
 
 void Frame::clear() {
@@ -1342,10 +2180,16 @@ void Frame::clear() {
 		res->Release();
 	}
 	for (u32 i : to_heap_release) d3d->srv_heap.free(i);
+	for (const Read& read : reads) {
+		if (read.owns_staging) read.staging->Release();
+	}
+	reads.clear();
 	fence->Release();
+	for (ID3D12CommandAllocator* a : parallel_allocators) a->Release();
 		
 	to_release.clear();
 	to_heap_release.clear();
+	parallel_allocators.clear();
 
 	scratch_buffer->Release();
 	timestamp_query_buffer->Release();
@@ -1407,11 +2251,26 @@ void destroy(TextureHandle texture) {
 	ASSERT(texture);
 	Texture& t = *texture;
 	debug::unregisterAlloc(t.allocation_info);
+	if (!t.is_placed && !t.is_view) {
+		AtomicI64& counter = isFlagSet(t.flags, TextureFlags::RENDER_TARGET) ? d3d->render_target_mem : d3d->texture_mem;
+		counter.subtract(i64(t.allocation_info.size));
+	}
 	if (t.resource && !t.is_view) d3d->frame->to_release.push(t.resource);
 	if (t.heap_id != INVALID_HEAP_ID) d3d->frame->to_heap_release.push(t.heap_id);
 	LUMIX_DELETE(d3d->allocator, texture);
 }
 
+void destroy(HeapHandle heap) {
+	checkThread();
+	ASSERT(heap);
+	if (heap->heap) {
+		debug::unregisterAlloc(heap->allocation_info);
+		(heap->render_targets ? d3d->render_target_mem : d3d->texture_mem).subtract(i64(heap->allocation_info.size));
+		d3d->frame->to_release.push(heap->heap);
+	}
+	LUMIX_DELETE(d3d->allocator, heap);
+}
+
 void destroy(QueryHandle query) {
 	checkThread();
 	LUMIX_DELETE(d3d->allocator, query);
@@ -1419,8 +2278,6 @@ void destroy(QueryHandle query) {
 
 void update(TextureHandle texture, u32 mip, u32 x, u32 y, u32 z, u32 w, u32 h, TextureFormat format, const void* buf, u32 buf_size) {
 	PROFILE_FUNCTION();
-	const D3D12_RESOURCE_STATES prev_state = texture->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_COPY_DEST);
-
 	const FormatDesc& fd = FormatDesc::get(format);
 	D3D12_RESOURCE_DESC desc = texture->resource->GetDesc();
 	if (fd.compressed) {
@@ -1437,18 +2294,7 @@ void update(TextureHandle texture, u32 mip, u32 x, u32 y, u32 z, u32 w, u32 h, T
 	d3d->device->GetCopyableFootprints(&desc, 0, 1, 0, &layout, &num_rows, NULL, &total_bytes);
 
 	const u32 tmp_row_pitch = layout.Footprint.RowPitch;
-
-	ID3D12Resource* staging = createBuffer(d3d->device, nullptr, total_bytes, D3D12_HEAP_TYPE_UPLOAD, "staging");
-	u8* tmp;
-
-	staging->Map(0, nullptr, (void**)&tmp);
-
 	const u32 src_pitch = fd.getRowPitch(w);
-	for (u32 i = 0, height = num_rows; i < height; ++i) {
-		memcpy(&tmp[i * tmp_row_pitch], &((u8*)buf)[i * src_pitch], src_pitch);
-	}
-
-	staging->Unmap(0, nullptr);
 
 	D3D12_BOX box;
 	box.left = 0;
@@ -1460,13 +2306,31 @@ void update(TextureHandle texture, u32 mip, u32 x, u32 y, u32 z, u32 w, u32 h, T
 
 	const bool no_mips = u32(texture->flags & TextureFlags::NO_MIPS);
 	const u32 mip_count = no_mips ? 1 : 1 + log2(maximum(texture->w, texture->h));
+	const u32 subresource = z * mip_count + mip;
+
+	// copy queue can access only resources in COMMON state, it decays back to COMMON after the copy
+	if (texture->state == D3D12_RESOURCE_STATE_COMMON && !isFlagSet(texture->flags, TextureFlags::RENDER_TARGET)) {
+		if (d3d->copy_queue.update(texture->resource, subresource, x, y, layout, num_rows, total_bytes, (const u8*)buf, src_pitch, box)) return;
+	}
+
+	const D3D12_RESOURCE_STATES prev_state = texture->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_COPY_DEST);
+	ID3D12Resource* staging = createBuffer(d3d->device, nullptr, total_bytes, D3D12_HEAP_TYPE_UPLOAD, "staging");
+	u8* tmp;
+
+	staging->Map(0, nullptr, (void**)&tmp);
+
+	for (u32 i = 0, height = num_rows; i < height; ++i) {
+		memcpy(&tmp[i * tmp_row_pitch], &((u8*)buf)[i * src_pitch], src_pitch);
+	}
+
+	staging->Unmap(0, nullptr);
 
 	D3D12_TEXTURE_COPY_LOCATION dst = {texture->resource, D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX, {}};
-	dst.SubresourceIndex = z * mip_count + mip;
+	dst.SubresourceIndex = subresource;
 	D3D12_TEXTURE_COPY_LOCATION src = {staging, D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT, {layout}};
-	d3d->cmd_list->CopyTextureRegion(&dst, x, y, 0, &src, &box);
+	ctx().cmd_list->CopyTextureRegion(&dst, x, y, 0, &src, &box);
 
-	texture->setState(d3d->cmd_list, prev_state);
+	texture->setState(ctx().cmd_list, prev_state);
 
 	d3d->frame->to_release.push(staging);
 }
@@ -1515,7 +2379,7 @@ void copy(BufferHandle dst_handle, TextureHandle src_handle) {
 		box.front = 0;
 		box.back = 1;
 
-		d3d->cmd_list->CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, &box);
+		ctx().cmd_list->CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, &box);
 	}
 }
 
@@ -1527,8 +2391,8 @@ void copy(TextureHandle dst, TextureHandle src, u32 dst_x, u32 dst_y) {
 	const u32 src_mip_count = no_mips ? 1 : 1 + log2(maximum(src->w, src->h));
 	const u32 dst_mip_count = no_mips ? 1 : 1 + log2(maximum(dst->w, dst->h));
 
-	const D3D12_RESOURCE_STATES src_prev_state = src->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_COPY_SOURCE);
-	const D3D12_RESOURCE_STATES dst_prev_state = dst->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_COPY_DEST);
+	const D3D12_RESOURCE_STATES src_prev_state = src->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	const D3D12_RESOURCE_STATES dst_prev_state = dst->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_COPY_DEST);
 
 	u32 mip = 0;
 	while ((src->w >> mip) != 0 || (src->h >> mip) != 0) {
@@ -1543,8 +2407,8 @@ void copy(TextureHandle dst, TextureHandle src, u32 dst_x, u32 dst_y) {
 				D3D12_TEXTURE_COPY_LOCATION dst = {};
 				D3D12_TEXTURE_COPY_LOCATION src = {};
 				D3D12_BOX src_box;
-				d3d->cmd_list->CopyTextureRegion(&dst, dst_x, dst_y, 0, &src, &src_box);
-				//d3d->cmd_list->CopyTextureRegion(dst->texture2D, dst_subres, dst_x, dst_y, 0, src->texture2D, src_subres, nullptr);
+				ctx().cmd_list->CopyTextureRegion(&dst, dst_x, dst_y, 0, &src, &src_box);
+				//ctx().cmd_list->CopyTextureRegion(dst->texture2D, dst_subres, dst_x, dst_y, 0, src->texture2D, src_subres, nullptr);
 			}
 		}
 		else {
@@ -1556,14 +2420,26 @@ void copy(TextureHandle dst, TextureHandle src, u32 dst_x, u32 dst_y) {
 			dst_loc.pResource = dst->resource;
 			dst_loc.SubresourceIndex = mip;
 			dst_loc.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-			d3d->cmd_list->CopyTextureRegion(&dst_loc, dst_x, dst_y, 0, &src_loc, nullptr);
+			ctx().cmd_list->CopyTextureRegion(&dst_loc, dst_x, dst_y, 0, &src_loc, nullptr);
 		}
 		++mip;
 		if (u32(src->flags & TextureFlags::NO_MIPS)) break;
 		if (u32(dst->flags & TextureFlags::NO_MIPS)) break;
 	}
-	src->setState(d3d->cmd_list, src_prev_state);
-	dst->setState(d3d->cmd_list, dst_prev_state);
+	src->setState(ctx().cmd_list, src_prev_state);
+	dst->setState(ctx().cmd_list, dst_prev_state);
+}
+
+// returns staging resource and offset of the read in it, see ReadbackRing
+static ID3D12Resource* allocReadback(u64 size, u64 align, u64& offset, bool& owns_staging) {
+	if (d3d->readback_ring.alloc(size, align, offset)) {
+		d3d->frame->readback_ring_end = d3d->readback_ring.head;
+		owns_staging = false;
+		return d3d->readback_ring.ring;
+	}
+	offset = 0;
+	owns_staging = true;
+	return createBuffer(d3d->device, nullptr, size, D3D12_HEAP_TYPE_READBACK, "staging");
 }
 
 void readTexture(TextureHandle texture, TextureReadCallback callback) {
@@ -1583,8 +2459,12 @@ void readTexture(TextureHandle texture, TextureReadCallback callback) {
 		, &face_bytes
 	);
 
-	ID3D12Resource* staging = createBuffer(d3d->device, nullptr, face_bytes * (is_cubemap ? 6 : 1), D3D12_HEAP_TYPE_READBACK, "staging");
-	const D3D12_RESOURCE_STATES prev_state = texture->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	u64 staging_offset;
+	bool owns_staging;
+	ID3D12Resource* staging = allocReadback(face_bytes * (is_cubemap ? 6 : 1), D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, staging_offset, owns_staging);
+	const u32 num_layouts = desc.DepthOrArraySize * desc.MipLevels;
+	for (u32 i = 0; i < num_layouts; ++i) layouts[i].Offset += staging_offset;
+	const D3D12_RESOURCE_STATES prev_state = texture->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_COPY_SOURCE);
 	
 	D3D12_TEXTURE_COPY_LOCATION src_location = {};
 	src_location.pResource = texture->resource;
@@ -1609,15 +2489,17 @@ void readTexture(TextureHandle texture, TextureReadCallback callback) {
 			box.front = 0;
 			box.back = 1;
 
-			d3d->cmd_list->CopyTextureRegion(&dst_location, 0, 0, 0, &src_location, nullptr);
+			ctx().cmd_list->CopyTextureRegion(&dst_location, 0, 0, 0, &src_location, nullptr);
 		}
 	}
-	texture->setState(d3d->cmd_list, prev_state);
+	texture->setState(ctx().cmd_list, prev_state);
 
-	Frame::TextureRead& wait = d3d->frame->texture_reads.emplace();
+	Frame::Read& wait = d3d->frame->reads.emplace();
 	wait.staging = staging;
+	wait.owns_staging = owns_staging;
 	wait.callback = callback;
-	wait.num_layouts = desc.DepthOrArraySize * desc.MipLevels;
+	wait.num_layouts = num_layouts;
+	wait.offset = staging_offset;
 	wait.dst_total_bytes = 0;
 	for (u32 mip = 0; mip < desc.MipLevels; ++mip) {
 		const auto& footprint = layouts[mip].Footprint;
@@ -1626,18 +2508,38 @@ void readTexture(TextureHandle texture, TextureReadCallback callback) {
 	memcpy(wait.layouts, layouts, sizeof(layouts[0]) * wait.num_layouts);
 }
 
+void readBuffer(BufferHandle buffer, u32 offset, u32 size, BufferReadCallback callback) {
+	ASSERT(buffer);
+	ASSERT(offset + size <= buffer->size);
+	u64 staging_offset;
+	bool owns_staging;
+	ID3D12Resource* staging = allocReadback(size, 16, staging_offset, owns_staging);
+
+	const D3D12_RESOURCE_STATES prev_state = buffer->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	ctx().cmd_list->CopyBufferRegion(staging, staging_offset, buffer->resource, offset, size);
+	buffer->setState(ctx().cmd_list, prev_state);
+
+	Frame::Read& wait = d3d->frame->reads.emplace();
+	wait.staging = staging;
+	wait.owns_staging = owns_staging;
+	wait.callback = callback;
+	wait.num_layouts = 0;
+	wait.offset = staging_offset;
+	wait.dst_total_bytes = size;
+}
+
 void beginQuery(QueryHandle query) {
 	checkThread();
 	ASSERT(query);
 	query->ready = false;
-	d3d->cmd_list->BeginQuery(d3d->stats_query_heap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, query->idx);
+	ctx().cmd_list->BeginQuery(d3d->stats_query_heap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, query->idx);
 }
 
 void endQuery(QueryHandle query) {
 	checkThread();
 	ASSERT(query);
 	d3d->frame->to_resolve_stats.push(query);
-	d3d->cmd_list->EndQuery(d3d->stats_query_heap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, query->idx);
+	ctx().cmd_list->EndQuery(d3d->stats_query_heap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, query->idx);
 }
 
 void queryTimestamp(QueryHandle query) {
@@ -1645,7 +2547,7 @@ void queryTimestamp(QueryHandle query) {
 	ASSERT(query);
 	query->ready = false;
 	d3d->frame->to_resolve.push(query);
-	d3d->cmd_list->EndQuery(d3d->timestamp_query_heap, D3D12_QUERY_TYPE_TIMESTAMP, query->idx);
+	ctx().cmd_list->EndQuery(d3d->timestamp_query_heap, D3D12_QUERY_TYPE_TIMESTAMP, query->idx);
 }
 
 u64 getQueryFrequency() {
@@ -1659,6 +2561,14 @@ u64 getQueryResult(QueryHandle query) {
 	return query->result;
 }
 
+PipelineStats getQueryPipelineStats(QueryHandle query) {
+	checkThread();
+	ASSERT(query);
+	ASSERT(query->ready);
+	ASSERT(query->type == QueryType::STATS);
+	return query->stats;
+}
+
 bool isQueryReady(QueryHandle query) {
 	checkThread();
 	ASSERT(query);
@@ -1745,8 +2655,18 @@ void preinit(IAllocator& allocator, bool load_renderdoc) {
 	}();
 }
 
+bool saveShaderCache(const char* dest_dir, bool used_only) {
+	const StaticString<MAX_PATH> path(dest_dir, SHIPPED_SHADER_CACHE);
+	return d3d->shader_compiler.saveCache(path, true, used_only);
+}
+
+void trackShaderCacheUsage() {
+	d3d->shader_compiler.trackUsage();
+}
+
 void shutdown() {
-	d3d->shader_compiler.saveCache(".lumix/shader_cache_dx");
+	d3d->shader_compiler.saveCache(".lumix/shader_cache_dx", false);
+	d3d->pso_cache.shutdown(".lumix/pso_cache_dx");
 
 	if (d3d->nvml_lib) {
 		nvmlShutdown();
@@ -1761,14 +2681,21 @@ void shutdown() {
 
 	for (D3D::Window& w : d3d->windows) {
 		if (!w.handle) continue;
-		w.swapchain->Release();
+		releaseSwapchain(w);
 	}
 	
 	d3d->root_signature->Release();
 	d3d->timestamp_query_heap->Release();
 	d3d->stats_query_heap->Release();
 	d3d->cmd_queue->Release();
-	d3d->cmd_list->Release();
+	d3d->graphics_cmd_list->Release();
+	d3d->compute_cmd_list->Release();
+	d3d->compute_queue->Release();
+	for (CmdContext& c : d3d->parallel_ctxs) c.cmd_list->Release();
+	for (ID3D12Fence* fence : d3d->queue_fences) fence->Release();
+	d3d->copy_queue.shutdown();
+	d3d->readback_ring.shutdown();
+	if (d3d->adapter) d3d->adapter->Release();
 	if(d3d->debug) d3d->debug->Release();
 	d3d->device->Release();
 
@@ -1783,6 +2710,7 @@ void shutdown() {
 	FreeLibrary(d3d->d3d_dll);
 	FreeLibrary(d3d->dxgi_dll);
 	d3d.destroy();
+	t_ctx = nullptr;
 }
 
 ID3D12RootSignature* createRootSignature() {
@@ -1855,6 +2783,18 @@ ID3D12RootSignature* createRootSignature() {
 	return res;
 }
 
+static void releaseSwapchain(D3D::Window& window) {
+	for (ID3D12Resource* res : window.backbuffers) {
+		res->Release();
+	}
+	{
+		MutexGuard guard(d3d->latency_mutex);
+		if (window.latency_waitable) CloseHandle(window.latency_waitable);
+		window.latency_waitable = nullptr;
+	}
+	window.swapchain->Release();
+}
+
 [[nodiscard]] static bool createSwapchain(HWND hwnd, D3D::Window& window, bool vsync) {
 	PROFILE_FUNCTION();
 	DXGI_SWAP_CHAIN_DESC1 sd = {};
@@ -1881,6 +2821,10 @@ ID3D12RootSignature* createRootSignature() {
 	swapChain1->Release();
 	dxgi_factory->Release();
 	window.swapchain->SetMaximumFrameLatency(1);
+	{
+		MutexGuard guard(d3d->latency_mutex);
+		window.latency_waitable = window.swapchain->GetFrameLatencyWaitableObject();
+	}
 
 	for (u32 i = 0; i < NUM_BACKBUFFERS; ++i) {
 		ID3D12Resource* backbuffer;
@@ -1890,7 +2834,7 @@ ID3D12RootSignature* createRootSignature() {
 	}
 
 	const UINT current_bb_idx = window.swapchain->GetCurrentBackBufferIndex();
-	switchState(d3d->cmd_list, window.backbuffers[current_bb_idx], D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	switchState(ctx().cmd_list, window.backbuffers[current_bb_idx], D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RENDER_TARGET);
 	return true;
 }
 
@@ -1903,6 +2847,7 @@ bool init(void* hwnd, InitFlags flags) {
 
 	d3d->vsync = true;
 	d3d->thread = GetCurrentThreadId();
+	t_ctx = &d3d->main_ctx;
 
 	RECT rect;
 	GetClientRect((HWND)hwnd, &rect);
@@ -1987,6 +2932,9 @@ bool init(void* hwnd, InitFlags flags) {
 	D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_12_0;
 	hr = api_D3D12CreateDevice(selected_adapter, featureLevel, IID_PPV_ARGS(&d3d->device));
 
+	if (selected_adapter->QueryInterface(IID_PPV_ARGS(&d3d->adapter)) != S_OK) d3d->adapter = nullptr;
+	d3d->dedicated_vidmem = selected_desc.DedicatedVideoMemory;
+	d3d->shared_sysmem = selected_desc.SharedSystemMemory;
 	selected_adapter->Release();
 	dxgi_factory->Release();
 
@@ -2046,21 +2994,36 @@ bool init(void* hwnd, InitFlags flags) {
 		if (!f.init(d3d->device)) return false;
 	}
 
-	if (d3d->device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, d3d->frames[0].cmd_allocator, NULL, IID_PPV_ARGS(&d3d->cmd_list)) != S_OK) return false;
-	d3d->cmd_list->Close();
+	desc.Type = D3D12_COMMAND_LIST_TYPE_COMPUTE;
+	if (d3d->device->CreateCommandQueue(&desc, IID_PPV_ARGS(&d3d->compute_queue)) != S_OK) return false;
+	if (!d3d->copy_queue.init(d3d->device)) return false;
+	if (!d3d->readback_ring.init(d3d->device)) return false;
+	for (ID3D12Fence*& fence : d3d->queue_fences) {
+		if (d3d->device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)) != S_OK) return false;
+	}
+
+	if (d3d->device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, d3d->frames[0].cmd_allocator, NULL, IID_PPV_ARGS(&ctx().cmd_list)) != S_OK) return false;
+	ctx().cmd_list->Close();
+	d3d->graphics_cmd_list = ctx().cmd_list;
+	if (d3d->device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COMPUTE, d3d->frames[0].compute_cmd_allocator, NULL, IID_PPV_ARGS(&d3d->compute_cmd_list)) != S_OK) return false;
+	d3d->compute_cmd_list->Close();
 
 	d3d->frame->timestamp_query_buffer->Map(0, nullptr, (void**)&d3d->frame->timestamp_query_buffer_ptr);
 	d3d->frame->stats_query_buffer->Map(0, nullptr, (void**)&d3d->frame->stats_query_buffer_ptr);
 	d3d->frame->cmd_allocator->Reset();
-	d3d->cmd_list->Reset(d3d->frame->cmd_allocator, nullptr);
+	ctx().cmd_list->Reset(d3d->frame->cmd_allocator, nullptr);
 	
 	resetCommandList();
+	d3d->frame->compute_cmd_allocator->Reset();
+	resetComputeCommandList();
 
 	if (!createSwapchain((HWND)hwnd, d3d->windows[0], d3d->vsync)) return false;
 
-	for (TextureHandle& h : d3d->current_framebuffer.attachments) h = INVALID_TEXTURE;
+	for (TextureHandle& h : ctx().current_framebuffer.attachments) h = INVALID_TEXTURE;
 
+	d3d->shader_compiler.openPackedCache(SHIPPED_SHADER_CACHE);
 	d3d->shader_compiler.loadCache(".lumix/shader_cache_dx");
+	d3d->pso_cache.init(d3d->device, ".lumix/pso_cache_dx");
 
 	{
 		D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
@@ -2098,19 +3061,18 @@ void pushDebugGroup(const char* msg) {
 		++d3d->debug_groups_depth;
 		WCHAR tmp[128];
 		toWChar(tmp, msg);
-		PIXBeginEvent(d3d->cmd_list, PIX_COLOR(0x55, 0xff, 0x55), tmp);
+		PIXBeginEvent(ctx().cmd_list, PIX_COLOR(0x55, 0xff, 0x55), tmp);
 	#endif
 }
 
 void popDebugGroup() {
 	#ifdef USE_PIX
 		--d3d->debug_groups_depth;
-		PIXEndEvent(d3d->cmd_list);
+		PIXEndEvent(ctx().cmd_list);
 	#endif
 }
 
 void setFramebufferCube(TextureHandle cube, u32 face, u32 mip) {
-	d3d->pso_cache.last = nullptr;
 	D3D12_CPU_DESCRIPTOR_HANDLE rt;
 
 	D3D12_RENDER_TARGET_VIEW_DESC desc = {};
@@ -2121,21 +3083,21 @@ void setFramebufferCube(TextureHandle cube, u32 face, u32 mip) {
 	desc.Texture2DArray.FirstArraySlice = face;
 
 	rt = d3d->rtv_heap.allocRTV(d3d->device, cube->resource, desc);
-	d3d->current_framebuffer.count = 1;
-	d3d->current_framebuffer.formats[0] = cube->dxgi_format;
-	d3d->current_framebuffer.render_targets[0] = rt;
-	d3d->current_framebuffer.depth_stencil = {};
-	d3d->current_framebuffer.ds_format = DXGI_FORMAT_UNKNOWN;
-	cube->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_RENDER_TARGET);
-	d3d->cmd_list->OMSetRenderTargets(1, &rt, FALSE, nullptr);
+	ctx().current_framebuffer.count = 1;
+	ctx().current_framebuffer.formats[0] = cube->dxgi_format;
+	ctx().current_framebuffer.render_targets[0] = rt;
+	ctx().current_framebuffer.depth_stencil = {};
+	ctx().current_framebuffer.ds_format = DXGI_FORMAT_UNKNOWN;
+	ctx().current_framebuffer.pso_layout = d3d->pso_cache.getLayout(ctx().current_framebuffer);
+	cube->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	ctx().cmd_list->OMSetRenderTargets(1, &rt, FALSE, nullptr);
 }
 
 void setFramebuffer(const TextureHandle* attachments, u32 num, TextureHandle depth_stencil, FramebufferFlags flags) {
 	checkThread();
-	d3d->pso_cache.last = nullptr;
 
-	for (TextureHandle& texture : d3d->current_framebuffer.attachments) {
-		if (texture) texture->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_GENERIC_READ);
+	for (TextureHandle& texture : ctx().current_framebuffer.attachments) {
+		if (texture) texture->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_GENERIC_READ);
 	}
 
 	const bool readonly_depth = u32(flags & FramebufferFlags::READONLY_DEPTH);
@@ -2146,20 +3108,20 @@ void setFramebuffer(const TextureHandle* attachments, u32 num, TextureHandle dep
 		rtv_desc.Texture2D.MipSlice = 0;
 		rtv_desc.Texture2D.PlaneSlice = 0;
 
-		d3d->current_framebuffer.count = 1;
-		d3d->current_framebuffer.formats[0] = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
-		d3d->current_framebuffer.render_targets[0] = d3d->rtv_heap.allocRTV(d3d->device, d3d->current_window->backbuffers[d3d->current_window->swapchain->GetCurrentBackBufferIndex()], rtv_desc);
-		d3d->current_framebuffer.depth_stencil = {};
-		d3d->current_framebuffer.ds_format = DXGI_FORMAT_UNKNOWN;
+		ctx().current_framebuffer.count = 1;
+		ctx().current_framebuffer.formats[0] = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		ctx().current_framebuffer.render_targets[0] = d3d->rtv_heap.allocRTV(d3d->device, d3d->current_window->backbuffers[d3d->current_window->swapchain->GetCurrentBackBufferIndex()], rtv_desc);
+		ctx().current_framebuffer.depth_stencil = {};
+		ctx().current_framebuffer.ds_format = DXGI_FORMAT_UNKNOWN;
 	} else {
-		d3d->current_framebuffer.count = 0;
+		ctx().current_framebuffer.count = 0;
 		for (u32 i = 0; i < num; ++i) {
-			d3d->current_framebuffer.attachments[i] = attachments[i];
+			ctx().current_framebuffer.attachments[i] = attachments[i];
 			ASSERT(attachments[i]);
 			Texture& t = *attachments[i];
-			ASSERT(d3d->current_framebuffer.count < (u32)lengthOf(d3d->current_framebuffer.render_targets));
-			t.setState(d3d->cmd_list, D3D12_RESOURCE_STATE_RENDER_TARGET);
-			d3d->current_framebuffer.formats[d3d->current_framebuffer.count] = t.dxgi_format;
+			ASSERT(ctx().current_framebuffer.count < (u32)lengthOf(ctx().current_framebuffer.render_targets));
+			t.setState(ctx().cmd_list, D3D12_RESOURCE_STATE_RENDER_TARGET);
+			ctx().current_framebuffer.formats[ctx().current_framebuffer.count] = t.dxgi_format;
 			
 			D3D12_RENDER_TARGET_VIEW_DESC rtv_desc = {};
 			rtv_desc.Format = t.dxgi_format;
@@ -2167,29 +3129,30 @@ void setFramebuffer(const TextureHandle* attachments, u32 num, TextureHandle dep
 			rtv_desc.Texture2D.MipSlice = 0;
 			rtv_desc.Texture2D.PlaneSlice = 0;
 
-			d3d->current_framebuffer.render_targets[d3d->current_framebuffer.count] = d3d->rtv_heap.allocRTV(d3d->device, t.resource, rtv_desc);
-			++d3d->current_framebuffer.count;
+			ctx().current_framebuffer.render_targets[ctx().current_framebuffer.count] = d3d->rtv_heap.allocRTV(d3d->device, t.resource, rtv_desc);
+			++ctx().current_framebuffer.count;
 		}
 		if (depth_stencil) {
-			depth_stencil->setState(d3d->cmd_list, readonly_depth 
+			depth_stencil->setState(ctx().cmd_list, readonly_depth 
 				? D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
 				 : D3D12_RESOURCE_STATE_DEPTH_WRITE);
-			d3d->current_framebuffer.depth_stencil = d3d->ds_heap.allocDSV(d3d->device, *depth_stencil, flags);
-			d3d->current_framebuffer.ds_format = toDSViewFormat(depth_stencil->dxgi_format);
+			ctx().current_framebuffer.depth_stencil = d3d->ds_heap.allocDSV(d3d->device, *depth_stencil, flags);
+			ctx().current_framebuffer.ds_format = toDSViewFormat(depth_stencil->dxgi_format);
 		}
 		else {
-			d3d->current_framebuffer.depth_stencil = {};
-			d3d->current_framebuffer.ds_format = DXGI_FORMAT_UNKNOWN;
+			ctx().current_framebuffer.depth_stencil = {};
+			ctx().current_framebuffer.ds_format = DXGI_FORMAT_UNKNOWN;
 		}
 	}
-	D3D12_CPU_DESCRIPTOR_HANDLE* ds = d3d->current_framebuffer.depth_stencil.ptr ? &d3d->current_framebuffer.depth_stencil : nullptr;
-	d3d->cmd_list->OMSetRenderTargets(d3d->current_framebuffer.count, d3d->current_framebuffer.render_targets, FALSE, ds);
+	ctx().current_framebuffer.pso_layout = d3d->pso_cache.getLayout(ctx().current_framebuffer);
+	D3D12_CPU_DESCRIPTOR_HANDLE* ds = ctx().current_framebuffer.depth_stencil.ptr ? &ctx().current_framebuffer.depth_stencil : nullptr;
+	ctx().cmd_list->OMSetRenderTargets(ctx().current_framebuffer.count, ctx().current_framebuffer.render_targets, FALSE, ds);
 }
 
 void clear(ClearFlags flags, const float* color, float depth) {
 	if (u32(flags & ClearFlags::COLOR)) {
-		for (u32 i = 0; i < d3d->current_framebuffer.count; ++i) {
-			d3d->cmd_list->ClearRenderTargetView(d3d->current_framebuffer.render_targets[i], color, 0, nullptr);
+		for (u32 i = 0; i < ctx().current_framebuffer.count; ++i) {
+			ctx().cmd_list->ClearRenderTargetView(ctx().current_framebuffer.render_targets[i], color, 0, nullptr);
 		}
 	}
 
@@ -2200,8 +3163,8 @@ void clear(ClearFlags flags, const float* color, float depth) {
 	if (u32(flags & ClearFlags::STENCIL)) {
 		dx_flags |= D3D12_CLEAR_FLAG_STENCIL;
 	}
-	if (dx_flags && d3d->current_framebuffer.depth_stencil.ptr) {
-		d3d->cmd_list->ClearDepthStencilView(d3d->current_framebuffer.depth_stencil, dx_flags, depth, 0, 0, nullptr);
+	if (dx_flags && ctx().current_framebuffer.depth_stencil.ptr) {
+		ctx().cmd_list->ClearDepthStencilView(ctx().current_framebuffer.depth_stencil, dx_flags, depth, 0, 0, nullptr);
 	}
 }
 
@@ -2226,7 +3189,23 @@ void unmap(BufferHandle buffer) {
 }
 
 bool getMemoryStats(MemoryStats& stats) {
-	return false;
+	stats.dedicated_vidmem = d3d->dedicated_vidmem;
+	stats.total_available_mem = d3d->dedicated_vidmem + d3d->shared_sysmem;
+	stats.texture_mem = d3d->texture_mem;
+	stats.render_target_mem = d3d->render_target_mem;
+	stats.buffer_mem = d3d->buffer_mem;
+	stats.budget = 0;
+	stats.usage = 0;
+	stats.current_available_mem = 0;
+	if (!d3d->adapter) return true;
+
+	// budget is set by OS and can change any time, e.g. when other applications need more memory
+	DXGI_QUERY_VIDEO_MEMORY_INFO info;
+	if (d3d->adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info) != S_OK) return true;
+	stats.budget = info.Budget;
+	stats.usage = info.CurrentUsage;
+	stats.current_available_mem = info.Budget > info.CurrentUsage ? info.Budget - info.CurrentUsage : 0;
+	return true;
 }
 
 void setCurrentWindow(void* window_handle) {
@@ -2295,7 +3274,27 @@ void enableVSync(bool enable) {
 	d3d->vsync_dirty = true;
 }
 
-static ProgramHandle g_last_program = INVALID_PROGRAM;
+void waitForSwapchain() {
+	PROFILE_FUNCTION();
+	HANDLE handle = nullptr;
+	{
+		MutexGuard guard(d3d->latency_mutex);
+		const HANDLE src = d3d->windows[0].latency_waitable;
+		if (!src) return;
+		// swapchain can be recreated on render thread while we wait, so we wait on our own handle
+		const HANDLE process = GetCurrentProcess();
+		if (!DuplicateHandle(process, src, process, &handle, 0, FALSE, DUPLICATE_SAME_ACCESS)) return;
+	}
+	WaitForSingleObjectEx(handle, 1000, TRUE);
+	CloseHandle(handle);
+}
+
+
+static void invalidateBindings(CmdContext& c) {
+	c.last_program = INVALID_PROGRAM;
+	c.dirty_compute_uniform_blocks = (1 << lengthOf(c.uniform_blocks)) - 1;
+	c.dirty_gfx_uniform_blocks = (1 << lengthOf(c.uniform_blocks)) - 1;
+}
 
 void pushGPUCounters() {
 	if (!d3d->nvml_lib) return;
@@ -2324,17 +3323,26 @@ u32 present() {
 	const bool vsync_dirty = d3d->vsync_dirty;
 	d3d->vsync_dirty = false;
 	d3d->vsync_mutex.exit();
-	d3d->pso_cache.last = nullptr;
+	setQueue(QueueType::GRAPHICS);
+	// frame's fence is signaled on graphics queue, so it must wait for compute work of the frame, even the work submitted in syncQueues
+	d3d->compute_cmd_list->Close();
+	if (d3d->compute_used) d3d->compute_queue->ExecuteCommandLists(1, (ID3D12CommandList* const*)&d3d->compute_cmd_list);
+	d3d->compute_used = false;
+	const u64 compute_fence_value = ++d3d->queue_fence_values[(u32)QueueType::COMPUTE];
+	d3d->compute_queue->Signal(d3d->queue_fences[(u32)QueueType::COMPUTE], compute_fence_value);
+	d3d->cmd_queue->Wait(d3d->queue_fences[(u32)QueueType::COMPUTE], compute_fence_value);
+
 	for (auto& window : d3d->windows) {
 		if (!window.handle) continue;
 
 		if (window.last_used_frame == d3d->frame_number || &window == d3d->windows) {
 			const UINT current_idx = window.swapchain->GetCurrentBackBufferIndex();
-			switchState(d3d->cmd_list, window.backbuffers[current_idx], D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+			switchState(ctx().cmd_list, window.backbuffers[current_idx], D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
 		}
 	}
 
-	d3d->frame->end(d3d->cmd_queue, d3d->cmd_list, d3d->timestamp_query_heap, d3d->stats_query_heap);
+	d3d->copy_queue.submit(d3d->cmd_queue);
+	d3d->frame->end(d3d->cmd_queue, ctx().cmd_list, d3d->timestamp_query_heap, d3d->stats_query_heap);
 	const u32 frame_idx = u32(d3d->frame - d3d->frames.begin());
 
 	++d3d->frame;
@@ -2348,24 +3356,24 @@ u32 present() {
 		if (!window.handle) continue;
 		if (window.last_used_frame + 2 < d3d->frame_number && &window != d3d->windows) {
 			window.handle = nullptr;
-			for (ID3D12Resource* res : window.backbuffers) {
-				res->Release();
-			}
-			window.swapchain->Release();
+			releaseSwapchain(window);
 		}
 	}
 	++d3d->frame_number;
 
-	for (TextureHandle& h : d3d->current_framebuffer.attachments) h = INVALID_TEXTURE;
+	for (TextureHandle& h : ctx().current_framebuffer.attachments) h = INVALID_TEXTURE;
 	
 	d3d->frame->begin();
 	d3d->frame->scratch_buffer_ptr = d3d->frame->scratch_buffer_begin;
 	d3d->frame->cmd_allocator->Reset();
-	d3d->cmd_list->Reset(d3d->frame->cmd_allocator, nullptr);
-	d3d->cmd_list->SetGraphicsRootSignature(d3d->root_signature);
-	d3d->cmd_list->SetComputeRootSignature(d3d->root_signature);
+	ctx().cmd_list->Reset(d3d->frame->cmd_allocator, nullptr);
+	ctx().cmd_list->SetGraphicsRootSignature(d3d->root_signature);
+	ctx().cmd_list->SetComputeRootSignature(d3d->root_signature);
 	ID3D12DescriptorHeap* heaps[] = { d3d->srv_heap.heap, d3d->sampler_heap.heap };
-	d3d->cmd_list->SetDescriptorHeaps(lengthOf(heaps), heaps);
+	ctx().cmd_list->SetDescriptorHeaps(lengthOf(heaps), heaps);
+	d3d->frame->compute_cmd_allocator->Reset();
+	resetComputeCommandList();
+	for (ID3D12CommandAllocator* a : d3d->frame->parallel_allocators) a->Reset();
 
 	for (auto& window : d3d->windows) {
 		if (!window.handle) continue;
@@ -2381,10 +3389,7 @@ u32 present() {
 		if (vsync_dirty) {
 			for (Frame& f : d3d->frames) f.wait();
 
-			for (ID3D12Resource* res : window.backbuffers) {
-				res->Release();
-			}
-			window.swapchain->Release();
+			releaseSwapchain(window);
 			window.last_used_frame = 0;
 			if (!createSwapchain((HWND)window.handle, window, vsync)) {
 				logError("Failed to create swapchain");
@@ -2428,11 +3433,11 @@ u32 present() {
 			//window.swapchain->GetFrameStatistics(&stats);
 
 			const UINT current_idx = window.swapchain->GetCurrentBackBufferIndex();
-			switchState(d3d->cmd_list, window.backbuffers[current_idx], D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+			switchState(ctx().cmd_list, window.backbuffers[current_idx], D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
 		}
 	}
 
-	g_last_program = INVALID_PROGRAM;
+	ctx().last_program = INVALID_PROGRAM;
 	return frame_idx;
 }
 
@@ -2495,11 +3500,12 @@ void createBuffer(BufferHandle buffer, BufferFlags flags, size_t size, const voi
 		d3d->srv_heap.alloc(d3d->device, buffer->heap_id, buffer->resource, srv_desc, nullptr);
 	}
 
-	if (data) {
+	// new buffer is in COMMON state, so copy queue can upload to it
+	if (data && (mappable || !d3d->copy_queue.update(buffer->resource, 0, data, buffer->size))) {
 		ID3D12Resource* upload_buffer = createBuffer(d3d->device, data, size, D3D12_HEAP_TYPE_UPLOAD, "upload");
-		D3D12_RESOURCE_STATES old_state = buffer->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_COPY_DEST);
-		d3d->cmd_list->CopyResource(buffer->resource, upload_buffer);
-		buffer->setState(d3d->cmd_list, old_state);
+		D3D12_RESOURCE_STATES old_state = buffer->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_COPY_DEST);
+		ctx().cmd_list->CopyResource(buffer->resource, upload_buffer);
+		buffer->setState(ctx().cmd_list, old_state);
 		d3d->frame->to_release.push(upload_buffer);
 	}
 
@@ -2511,6 +3517,7 @@ void createBuffer(BufferHandle buffer, BufferFlags flags, size_t size, const voi
 	buffer->tag_allocator.create(d3d->buffer_tag_allocator, buffer->name);
 	buffer->allocation_info.tag = buffer->tag_allocator.get();
 	debug::registerAlloc(buffer->allocation_info);
+	d3d->buffer_mem.add(size);
 
 	if (debug_name) {
 		WCHAR tmp[MAX_PATH];
@@ -2621,7 +3628,74 @@ void createTextureView(TextureHandle view_handle, TextureHandle texture_handle,
 	d3d->srv_heap.alloc(d3d->device, view.heap_id, texture.resource, srv_desc, compute_write ? &uav_desc : nullptr);
 }
 
+static D3D12_RESOURCE_DESC getTextureResourceDesc(u32 w, u32 h, u32 depth, TextureFormat format, TextureFlags flags) {
+	const bool no_mips = u32(flags & TextureFlags::NO_MIPS);
+	const bool is_3d = u32(flags & TextureFlags::IS_3D);
+	const bool is_cubemap = u32(flags & TextureFlags::IS_CUBE);
+	const bool compute_write = u32(flags & TextureFlags::COMPUTE_WRITE);
+	const bool render_target = u32(flags & TextureFlags::RENDER_TARGET);
+
+	D3D12_RESOURCE_DESC desc = {};
+	desc.Dimension = is_3d ? D3D12_RESOURCE_DIMENSION_TEXTURE3D : D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	desc.Width = w;
+	desc.Height = h;
+	desc.DepthOrArraySize = depth * (is_cubemap ? 6 : 1);
+	desc.MipLevels = no_mips ? 1 : 1 + log2(maximum(w, h, depth));
+	desc.Format = FormatDesc::get(format).backing;
+	desc.SampleDesc.Count = 1;
+	desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	desc.Flags = render_target ? (isDepthFormat(desc.Format) ? D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL : D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET) : D3D12_RESOURCE_FLAG_NONE;
+	if (compute_write) desc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+	return desc;
+}
+
+u64 getPlacedTextureSize(u32 w, u32 h, u32 depth, TextureFormat format, TextureFlags flags) {
+	const D3D12_RESOURCE_DESC desc = getTextureResourceDesc(w, h, depth, format, flags);
+	const D3D12_RESOURCE_ALLOCATION_INFO info = d3d->device->GetResourceAllocationInfo(0, 1, &desc);
+	ASSERT(info.Alignment <= HEAP_PLACEMENT_ALIGNMENT);
+	return (info.SizeInBytes + HEAP_PLACEMENT_ALIGNMENT - 1) & ~(HEAP_PLACEMENT_ALIGNMENT - 1);
+}
+
+HeapHandle allocHeapHandle() {
+	return LUMIX_NEW(d3d->allocator, Heap);
+}
+
+void createHeap(HeapHandle handle, u64 size, TextureFlags flags, const char* debug_name) {
+	ASSERT(handle);
+	Heap& heap = *handle;
+	heap.size = size;
+	heap.render_targets = u32(flags & TextureFlags::RENDER_TARGET);
+
+	D3D12_HEAP_DESC desc = {};
+	desc.SizeInBytes = size;
+	desc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+	desc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	desc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	desc.Alignment = HEAP_PLACEMENT_ALIGNMENT;
+	// resource heap tier 1 can not mix render targets with other textures in one heap
+	desc.Flags = heap.render_targets ? D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+	if (d3d->device->CreateHeap(&desc, IID_PPV_ARGS(&heap.heap)) != S_OK) return;
+
+	if (debug_name) {
+		WCHAR tmp[MAX_PATH];
+		toWChar(tmp, debug_name);
+		heap.heap->SetName(tmp);
+	}
+
+	heap.allocation_info.align = (u32)HEAP_PLACEMENT_ALIGNMENT;
+	heap.allocation_info.size = size;
+	heap.allocation_info.flags = debug::AllocationInfo::IS_VRAM;
+	heap.tag_allocator.create(heap.render_targets ? d3d->rendertarget_tag_allocator : d3d->texture_tag_allocator, debug_name);
+	heap.allocation_info.tag = heap.tag_allocator.get();
+	debug::registerAlloc(heap.allocation_info);
+	(heap.render_targets ? d3d->render_target_mem : d3d->texture_mem).add(size);
+}
+
 void createTexture(TextureHandle handle, u32 w, u32 h, u32 depth, TextureFormat format, TextureFlags flags, const char* debug_name) {
+	createTexture(handle, w, h, depth, format, flags, INVALID_HEAP, 0, debug_name);
+}
+
+void createTexture(TextureHandle handle, u32 w, u32 h, u32 depth, TextureFormat format, TextureFlags flags, HeapHandle heap, u64 offset, const char* debug_name) {
 	ASSERT(handle);
 
 	const bool is_srgb = u32(flags & TextureFlags::SRGB);
@@ -2646,7 +3720,8 @@ void createTexture(TextureHandle handle, u32 w, u32 h, u32 depth, TextureFormat
 		case TextureFormat::BC2:
 		case TextureFormat::BC3:
 		case TextureFormat::BC4:
-		case TextureFormat::BC5: break;
+		case TextureFormat::BC5:
+		case TextureFormat::BC7: break;
 
 		case TextureFormat::RG8:
 		case TextureFormat::R16:
@@ -2668,17 +3743,7 @@ void createTexture(TextureHandle handle, u32 w, u32 h, u32 depth, TextureFormat
 	props.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
 	props.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
 
-	D3D12_RESOURCE_DESC desc = {};
-	desc.Dimension = is_3d ? D3D12_RESOURCE_DIMENSION_TEXTURE3D : D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-	desc.Width = w;
-	desc.Height = h;
-	desc.DepthOrArraySize = depth * (is_cubemap ? 6 : 1);
-	desc.MipLevels = mip_count;
-	desc.Format = FormatDesc::get(format).backing;
-	desc.SampleDesc.Count = 1;
-	desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-	desc.Flags = render_target ? (isDepthFormat(desc.Format) ? D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL : D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET) : D3D12_RESOURCE_FLAG_NONE;
-	if (compute_write) desc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+	D3D12_RESOURCE_DESC desc = getTextureResourceDesc(w, h, depth, format, flags);
 
 	texture.name = debug_name;
 	texture.is_view = false;
@@ -2705,8 +3770,17 @@ void createTexture(TextureHandle handle, u32 w, u32 h, u32 depth, TextureFormat
 		}
 	}
 
-	texture.state = isDepthFormat(desc.Format) ? D3D12_RESOURCE_STATE_COMMON : (compute_write ? D3D12_RESOURCE_STATE_UNORDERED_ACCESS : D3D12_RESOURCE_STATE_GENERIC_READ);
-	if (d3d->device->CreateCommittedResource(&props, D3D12_HEAP_FLAG_NONE, &desc, texture.state, clear_val_ptr, IID_PPV_ARGS(&texture.resource)) != S_OK) return;
+	// textures which are not written on gpu start in COMMON, so they can be uploaded by copy queue, and they are implicitly promoted when sampled
+	if (compute_write) texture.state = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+	else if (render_target && !isDepthFormat(desc.Format)) texture.state = D3D12_RESOURCE_STATE_GENERIC_READ;
+	else texture.state = D3D12_RESOURCE_STATE_COMMON;
+	if (heap) {
+		ASSERT(render_target == heap->render_targets);
+		ASSERT(offset % HEAP_PLACEMENT_ALIGNMENT == 0);
+		texture.is_placed = true;
+		if (d3d->device->CreatePlacedResource(heap->heap, offset, &desc, texture.state, clear_val_ptr, IID_PPV_ARGS(&texture.resource)) != S_OK) return;
+	}
+	else if (d3d->device->CreateCommittedResource(&props, D3D12_HEAP_FLAG_NONE, &desc, texture.state, clear_val_ptr, IID_PPV_ARGS(&texture.resource)) != S_OK) return;
 	
 	D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
 	D3D12_UNORDERED_ACCESS_VIEW_DESC uav_desc = {};
@@ -2769,6 +3843,7 @@ void createTexture(TextureHandle handle, u32 w, u32 h, u32 depth, TextureFormat
 		uav_desc.Texture2D.PlaneSlice = 0;
 	}
 
+	texture.srv_desc = srv_desc;
 	d3d->srv_heap.alloc(d3d->device, texture.heap_id, texture.resource, srv_desc, compute_write ? &uav_desc : nullptr);
 
 	if (debug_name) {
@@ -2801,7 +3876,28 @@ void createTexture(TextureHandle handle, u32 w, u32 h, u32 depth, TextureFormat
 		texture.tag_allocator.create(d3d->texture_tag_allocator, texture.name);
 	}
 	texture.allocation_info.tag = texture.tag_allocator.get();
-	debug::registerAlloc(texture.allocation_info);
+	// memory of placed textures is registered by their heap
+	if (!texture.is_placed) {
+		debug::registerAlloc(texture.allocation_info);
+		(render_target ? d3d->render_target_mem : d3d->texture_mem).add(info.SizeInBytes);
+	}
+}
+
+void setMinLOD(TextureHandle handle, u32 mip) {
+	Texture& texture = *handle;
+	ASSERT(!texture.is_view);
+	D3D12_SHADER_RESOURCE_VIEW_DESC& desc = texture.srv_desc;
+	const float lod = (float)mip;
+	switch (desc.ViewDimension) {
+		case D3D12_SRV_DIMENSION_TEXTURE2D: desc.Texture2D.ResourceMinLODClamp = lod; break;
+		case D3D12_SRV_DIMENSION_TEXTURE2DARRAY: desc.Texture2DArray.ResourceMinLODClamp = lod; break;
+		case D3D12_SRV_DIMENSION_TEXTURE3D: desc.Texture3D.ResourceMinLODClamp = lod; break;
+		case D3D12_SRV_DIMENSION_TEXTURECUBE: desc.TextureCube.ResourceMinLODClamp = lod; break;
+		case D3D12_SRV_DIMENSION_TEXTURECUBEARRAY: desc.TextureCubeArray.ResourceMinLODClamp = lod; break;
+		default: ASSERT(false); return;
+	}
+	// uav, if there's any, is not affected
+	d3d->srv_heap.alloc(d3d->device, texture.heap_id, texture.resource, desc, nullptr);
 }
 
 void setDebugName(TextureHandle texture, const char* debug_name) {
@@ -2820,13 +3916,16 @@ void viewport(u32 x, u32 y, u32 w, u32 h) {
 	vp.MaxDepth = 1.0f;
 	vp.TopLeftX = (float)x;
 	vp.TopLeftY = (float)y;
-	d3d->cmd_list->RSSetViewports(1, &vp);
+	CmdContext& c = ctx();
+	c.cmd_list->RSSetViewports(1, &vp);
 	D3D12_RECT scissor;
 	scissor.left = x;
 	scissor.top = y;
 	scissor.right = x + w;
 	scissor.bottom = y + h;
-	d3d->cmd_list->RSSetScissorRects(1, &scissor);
+	c.cmd_list->RSSetScissorRects(1, &scissor);
+	c.viewport = vp;
+	c.scissor = scissor;
 }
 
 void requestDisassembly(ProgramHandle program) {
@@ -2865,9 +3964,8 @@ bool getDisassembly(ProgramHandle program, String& output) {
 
 
 void useProgram(ProgramHandle handle) {
-	if (handle != d3d->current_program) {
-		d3d->pso_cache.last = nullptr;
-		d3d->current_program = handle;
+	if (handle != ctx().current_program) {
+		ctx().current_program = handle;
 	}
 }
 
@@ -2877,7 +3975,9 @@ void scissor(u32 x, u32 y, u32 w, u32 h) {
 	rect.top = y;
 	rect.right = x + w;
 	rect.bottom = y + h;
-	d3d->cmd_list->RSSetScissorRects(1, &rect);
+	CmdContext& c = ctx();
+	c.cmd_list->RSSetScissorRects(1, &rect);
+	c.scissor = rect;
 }
 
 enum class PipelineType {
@@ -2887,67 +3987,67 @@ enum class PipelineType {
 };
 
 static void applyComputeUniformBlocks() {
-	if (d3d->dirty_compute_uniform_blocks == 0) return;
+	if (ctx().dirty_compute_uniform_blocks == 0) return;
 	for (u32 i = 0; i < 6; ++i) {
-		if (d3d->dirty_compute_uniform_blocks & (1 << i)) {
-			d3d->cmd_list->SetComputeRootConstantBufferView(i, d3d->uniform_blocks[i]);
+		if (ctx().dirty_compute_uniform_blocks & (1 << i)) {
+			ctx().cmd_list->SetComputeRootConstantBufferView(i, ctx().uniform_blocks[i]);
 		}
 	}
-	d3d->dirty_compute_uniform_blocks = 0;
+	ctx().dirty_compute_uniform_blocks = 0;
 }
 
 [[nodiscard]] static bool setPipelineStateCompute() {
-	if (g_last_program != d3d->current_program) {
-		g_last_program = d3d->current_program;
-		ID3D12PipelineState* pso = d3d->pso_cache.getPipelineStateCompute(d3d->device, d3d->root_signature, d3d->current_program);
+	if (ctx().last_program != ctx().current_program) {
+		ctx().last_program = ctx().current_program;
+		ID3D12PipelineState* pso = d3d->pso_cache.getPipelineStateCompute(d3d->device, d3d->root_signature, ctx().current_program);
 		if (!pso) return false;
-		d3d->cmd_list->SetPipelineState(pso);
-		d3d->cmd_list->SetComputeRootDescriptorTable(BINDLESS_SRV_ROOT_PARAMETER_INDEX, d3d->srv_heap.gpu_begin);
-		d3d->cmd_list->SetComputeRootDescriptorTable(BINDLESS_SAMPLERS_ROOT_PARAMETER_INDEX, d3d->sampler_heap.gpu_begin);
-		if (d3d->bound_shader_buffers.ptr) d3d->cmd_list->SetComputeRootDescriptorTable(SRV_ROOT_PARAMETER_INDEX, d3d->bound_shader_buffers);
+		ctx().cmd_list->SetPipelineState(pso);
+		ctx().cmd_list->SetComputeRootDescriptorTable(BINDLESS_SRV_ROOT_PARAMETER_INDEX, d3d->srv_heap.gpu_begin);
+		ctx().cmd_list->SetComputeRootDescriptorTable(BINDLESS_SAMPLERS_ROOT_PARAMETER_INDEX, d3d->sampler_heap.gpu_begin);
+		if (ctx().bound_shader_buffers.ptr) ctx().cmd_list->SetComputeRootDescriptorTable(SRV_ROOT_PARAMETER_INDEX, ctx().bound_shader_buffers);
 	}
 	applyComputeUniformBlocks();
 	return true;
 }
 
 [[nodiscard]] static bool setPipelineStateGraphics() {
-	if (g_last_program != d3d->current_program) {
-		const u8 stencil_ref = u8(u64(d3d->current_program->state) >> 34);
-		d3d->cmd_list->OMSetStencilRef(stencil_ref);
+	if (ctx().last_program != ctx().current_program) {
+		const u8 stencil_ref = u8(u64(ctx().current_program->state) >> 34);
+		ctx().cmd_list->OMSetStencilRef(stencil_ref);
 
-		ID3D12PipelineState* pso = d3d->pso_cache.getPipelineState(d3d->device, d3d->current_program, d3d->current_framebuffer, d3d->root_signature);
+		ID3D12PipelineState* pso = d3d->pso_cache.getPipelineState(d3d->device, ctx().current_program, ctx().current_framebuffer, d3d->root_signature);
 		if (!pso) return false;
-		d3d->cmd_list->SetPipelineState(pso);
-		d3d->cmd_list->SetGraphicsRootDescriptorTable(BINDLESS_SRV_ROOT_PARAMETER_INDEX, d3d->srv_heap.gpu_begin);
-		d3d->cmd_list->SetGraphicsRootDescriptorTable(BINDLESS_SAMPLERS_ROOT_PARAMETER_INDEX, d3d->sampler_heap.gpu_begin);
-		if (d3d->bound_shader_buffers.ptr) d3d->cmd_list->SetGraphicsRootDescriptorTable(SRV_ROOT_PARAMETER_INDEX, d3d->bound_shader_buffers);
-		g_last_program = d3d->current_program;
+		ctx().cmd_list->SetPipelineState(pso);
+		ctx().cmd_list->SetGraphicsRootDescriptorTable(BINDLESS_SRV_ROOT_PARAMETER_INDEX, d3d->srv_heap.gpu_begin);
+		ctx().cmd_list->SetGraphicsRootDescriptorTable(BINDLESS_SAMPLERS_ROOT_PARAMETER_INDEX, d3d->sampler_heap.gpu_begin);
+		if (ctx().bound_shader_buffers.ptr) ctx().cmd_list->SetGraphicsRootDescriptorTable(SRV_ROOT_PARAMETER_INDEX, ctx().bound_shader_buffers);
+		ctx().last_program = ctx().current_program;
 	}
 	
-	if (d3d->dirty_gfx_uniform_blocks == 0) return true;
+	if (ctx().dirty_gfx_uniform_blocks == 0) return true;
 	for (u32 i = 0; i < 6; ++i) {
-		if (d3d->dirty_gfx_uniform_blocks & (1 << i)) {
-			d3d->cmd_list->SetGraphicsRootConstantBufferView(i, d3d->uniform_blocks[i]);
+		if (ctx().dirty_gfx_uniform_blocks & (1 << i)) {
+			ctx().cmd_list->SetGraphicsRootConstantBufferView(i, ctx().uniform_blocks[i]);
 		}
 	}
-	d3d->dirty_gfx_uniform_blocks = 0;
+	ctx().dirty_gfx_uniform_blocks = 0;
 	
 	return true;
 }
 
 void drawArraysInstanced(u32 indices_count, u32 instances_count) {
-	ASSERT(d3d->current_program);
+	ASSERT(ctx().current_program);
 	if (setPipelineStateGraphics()) {
-		d3d->cmd_list->IASetPrimitiveTopology(d3d->current_program->primitive_topology);
-		d3d->cmd_list->DrawInstanced(indices_count, instances_count, 0, 0);
+		ctx().cmd_list->IASetPrimitiveTopology(ctx().current_program->primitive_topology);
+		ctx().cmd_list->DrawInstanced(indices_count, instances_count, 0, 0);
 	}
 }
 
 void drawArrays(u32 offset, u32 count) {
-	ASSERT(d3d->current_program);
+	ASSERT(ctx().current_program);
 	if (setPipelineStateGraphics()) {
-		d3d->cmd_list->IASetPrimitiveTopology(d3d->current_program->primitive_topology);
-		d3d->cmd_list->DrawInstanced(count, 1, offset, 0);
+		ctx().cmd_list->IASetPrimitiveTopology(ctx().current_program->primitive_topology);
+		ctx().cmd_list->DrawInstanced(count, 1, offset, 0);
 	}
 }
 
@@ -2963,6 +4063,7 @@ void destroy(BufferHandle buffer) {
 	if (t.heap_id != INVALID_HEAP_ID) d3d->frame->to_heap_release.push(t.heap_id);
 
 	debug::unregisterAlloc(buffer->allocation_info);
+	d3d->buffer_mem.subtract(i64(buffer->allocation_info.size));
 
 	LUMIX_DELETE(d3d->allocator, buffer);
 }
@@ -2983,38 +4084,38 @@ void bindShaderBuffers(Span<BufferHandle> buffers) {
 			descs[i].Buffer.NumElements = UINT(buffers[i]->size / sizeof(u32));
 			descs[i].Buffer.StructureByteStride = 0;
 			descs[i].Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
-			buffers[i]->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_GENERIC_READ);
+			buffers[i]->setState(ctx().cmd_list, getReadState());
 		}
 	}
-	d3d->bound_shader_buffers = d3d->srv_heap.allocTransient(d3d->device, Span(resources, buffers.length()), Span(descs, buffers.length()));
+	ctx().bound_shader_buffers = d3d->srv_heap.allocTransient(d3d->device, Span(resources, buffers.length()), Span(descs, buffers.length()));
 }
 
 void bindUniformBuffer(u32 index, BufferHandle buffer, size_t offset, size_t size) {
-	ASSERT(index < lengthOf(d3d->uniform_blocks));
+	ASSERT(index < lengthOf(ctx().uniform_blocks));
 	if (buffer) {
-		d3d->uniform_blocks[index] = buffer->gpu_address + offset;
+		ctx().uniform_blocks[index] = buffer->gpu_address + offset;
 	} else {
 		D3D12_GPU_VIRTUAL_ADDRESS dummy = {};
-		d3d->uniform_blocks[index] = dummy;
+		ctx().uniform_blocks[index] = dummy;
 	}
-	d3d->dirty_compute_uniform_blocks |= 1 << index;
-	d3d->dirty_gfx_uniform_blocks |= 1 << index;
+	ctx().dirty_compute_uniform_blocks |= 1 << index;
+	ctx().dirty_gfx_uniform_blocks |= 1 << index;
 }
 
 
 void bindIndirectBuffer(BufferHandle handle) {
-	d3d->current_indirect_buffer = handle;
-	if (handle) handle->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+	ctx().current_indirect_buffer = handle;
+	if (handle) handle->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
 }
 
 void bindIndexBuffer(BufferHandle handle) {
-	d3d->current_index_buffer = handle;
+	ctx().current_index_buffer = handle;
 }
 
 void dispatch(u32 num_groups_x, u32 num_groups_y, u32 num_groups_z) {
-	ASSERT(d3d->current_program);
+	ASSERT(ctx().current_program);
 	if (setPipelineStateCompute()) {
-		d3d->cmd_list->Dispatch(num_groups_x, num_groups_y, num_groups_z);
+		ctx().cmd_list->Dispatch(num_groups_x, num_groups_y, num_groups_z);
 	}
 }
 
@@ -3024,13 +4125,13 @@ void bindVertexBuffer(u32 binding_idx, BufferHandle buffer, u32 buffer_offset, u
 		vbv.BufferLocation = buffer->gpu_address + buffer_offset;
 		vbv.StrideInBytes = stride_in_bytes;
 		vbv.SizeInBytes = UINT(buffer->size - buffer_offset);
-		d3d->cmd_list->IASetVertexBuffers(binding_idx, 1, &vbv);
+		ctx().cmd_list->IASetVertexBuffers(binding_idx, 1, &vbv);
 	} else {
 		D3D12_VERTEX_BUFFER_VIEW vbv = {};
 		vbv.BufferLocation = 0;
 		vbv.StrideInBytes = stride_in_bytes;
 		vbv.SizeInBytes = 0;
-		d3d->cmd_list->IASetVertexBuffers(binding_idx, 1, &vbv);
+		ctx().cmd_list->IASetVertexBuffers(binding_idx, 1, &vbv);
 	}
 }
 
@@ -3051,7 +4152,7 @@ RWBindlessHandle getRWBindlessHandle(BufferHandle buffer) {
 }
 
 void drawIndirect(DataType index_type, u32 indirect_buffer_offset) {
-	ASSERT(d3d->current_program);
+	ASSERT(ctx().current_program);
 	if (!setPipelineStateGraphics()) return;
 
 	DXGI_FORMAT dxgi_index_type;
@@ -3064,13 +4165,13 @@ void drawIndirect(DataType index_type, u32 indirect_buffer_offset) {
 			break;
 	}
 
-	ASSERT(d3d->current_index_buffer);
+	ASSERT(ctx().current_index_buffer);
 	D3D12_INDEX_BUFFER_VIEW ibv = {};
-	ibv.BufferLocation = d3d->current_index_buffer->gpu_address;
+	ibv.BufferLocation = ctx().current_index_buffer->gpu_address;
 	ibv.Format = dxgi_index_type;
-	ibv.SizeInBytes = d3d->current_index_buffer->size;
-	d3d->cmd_list->IASetIndexBuffer(&ibv);
-	d3d->cmd_list->IASetPrimitiveTopology(d3d->current_program->primitive_topology);
+	ibv.SizeInBytes = ctx().current_index_buffer->size;
+	ctx().cmd_list->IASetIndexBuffer(&ibv);
+	ctx().cmd_list->IASetPrimitiveTopology(ctx().current_program->primitive_topology);
 
 	static ID3D12CommandSignature* signature = [&]() {
 		D3D12_INDIRECT_ARGUMENT_DESC arg_desc = {};
@@ -3086,15 +4187,36 @@ void drawIndirect(DataType index_type, u32 indirect_buffer_offset) {
 		return result;
 	}();
 
-	d3d->cmd_list->ExecuteIndirect(signature, 1, d3d->current_indirect_buffer->resource, indirect_buffer_offset, nullptr, 0);
+	ctx().cmd_list->ExecuteIndirect(signature, 1, ctx().current_indirect_buffer->resource, indirect_buffer_offset, nullptr, 0);
+}
+
+// non-indexed version of drawIndirect, draw arguments are 4 u32s - vertex count, instance count, first vertex, first instance
+void drawArraysIndirect(u32 indirect_buffer_offset) {
+	ASSERT(ctx().current_program);
+	if (!setPipelineStateGraphics()) return;
+
+	ctx().cmd_list->IASetPrimitiveTopology(ctx().current_program->primitive_topology);
+
+	static ID3D12CommandSignature* signature = [&]() {
+		D3D12_INDIRECT_ARGUMENT_DESC arg_desc = {};
+		arg_desc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW;
+
+		D3D12_COMMAND_SIGNATURE_DESC desc = {};
+		desc.NodeMask = 1;
+		desc.ByteStride = sizeof(u32) * 4;
+		desc.NumArgumentDescs = 1;
+		desc.pArgumentDescs = &arg_desc;
+		ID3D12CommandSignature* result;
+		d3d->device->CreateCommandSignature(&desc, nullptr, IID_PPV_ARGS(&result));
+		return result;
+	}();
+
+	ctx().cmd_list->ExecuteIndirect(signature, 1, ctx().current_indirect_buffer->resource, indirect_buffer_offset, nullptr, 0);
 }
 
 void draw(const Drawcall& draw) {
-	D3D* d = d3d.get();
-	if (draw.program != d->current_program) {
-		d->pso_cache.last = nullptr;
-		d->current_program = draw.program;
-	}
+	CmdContext& c = ctx();
+	c.current_program = draw.program;
 
 	if (!setPipelineStateGraphics()) return;
 	
@@ -3116,7 +4238,7 @@ void draw(const Drawcall& draw) {
 		}
 	};
 
-	d->cmd_list->IASetVertexBuffers(0, 2, vbv);
+	c.cmd_list->IASetVertexBuffers(0, 2, vbv);
 
 	DXGI_FORMAT dxgi_index_type;
 	u32 offset_shift = 0;
@@ -3136,13 +4258,13 @@ void draw(const Drawcall& draw) {
 		.SizeInBytes = draw.indices_count * (1 << offset_shift),
 		.Format = dxgi_index_type,
 	};
-	d->cmd_list->IASetIndexBuffer(&ibv);
-	d->cmd_list->IASetPrimitiveTopology(draw.program->primitive_topology);
-	d->cmd_list->DrawIndexedInstanced(draw.indices_count, draw.instances_count, 0, 0, 0);
+	c.cmd_list->IASetIndexBuffer(&ibv);
+	c.cmd_list->IASetPrimitiveTopology(draw.program->primitive_topology);
+	c.cmd_list->DrawIndexedInstanced(draw.indices_count, draw.instances_count, 0, 0, 0);
 }
 
 void drawIndexedInstanced(u32 indices_count, u32 instances_count, DataType index_type) {
-	ASSERT(d3d->current_program);
+	ASSERT(ctx().current_program);
 	if (!setPipelineStateGraphics()) return;
 
 	DXGI_FORMAT dxgi_index_type;
@@ -3158,14 +4280,14 @@ void drawIndexedInstanced(u32 indices_count, u32 instances_count, DataType index
 			break;
 	}
 
-	ASSERT(d3d->current_index_buffer);
+	ASSERT(ctx().current_index_buffer);
 	D3D12_INDEX_BUFFER_VIEW ibv = {};
-	ibv.BufferLocation = d3d->current_index_buffer->gpu_address;
+	ibv.BufferLocation = ctx().current_index_buffer->gpu_address;
 	ibv.Format = dxgi_index_type;
 	ibv.SizeInBytes = indices_count * (1 << offset_shift);
-	d3d->cmd_list->IASetIndexBuffer(&ibv);
-	d3d->cmd_list->IASetPrimitiveTopology(d3d->current_program->primitive_topology);
-	d3d->cmd_list->DrawIndexedInstanced(indices_count, instances_count, 0, 0, 0);
+	ctx().cmd_list->IASetIndexBuffer(&ibv);
+	ctx().cmd_list->IASetPrimitiveTopology(ctx().current_program->primitive_topology);
+	ctx().cmd_list->DrawIndexedInstanced(indices_count, instances_count, 0, 0, 0);
 }
 
 void drawIndexed(u32 offset_bytes, u32 count, DataType index_type) {
@@ -3185,24 +4307,24 @@ void drawIndexed(u32 offset_bytes, u32 count, DataType index_type) {
 	}
 
 	ASSERT((offset_bytes & (offset_shift - 1)) == 0);
-	ASSERT(d3d->current_index_buffer);
+	ASSERT(ctx().current_index_buffer);
 	D3D12_INDEX_BUFFER_VIEW ibv = {};
-	ibv.BufferLocation = d3d->current_index_buffer->gpu_address + offset_bytes;
+	ibv.BufferLocation = ctx().current_index_buffer->gpu_address + offset_bytes;
 	ibv.Format = dxgi_index_type;
 	ibv.SizeInBytes = count * (1 << offset_shift);
-	d3d->cmd_list->IASetIndexBuffer(&ibv);
-	d3d->cmd_list->IASetPrimitiveTopology(d3d->current_program->primitive_topology);
-	d3d->cmd_list->DrawIndexedInstanced(count, 1, 0, 0, 0);
+	ctx().cmd_list->IASetIndexBuffer(&ibv);
+	ctx().cmd_list->IASetPrimitiveTopology(ctx().current_program->primitive_topology);
+	ctx().cmd_list->DrawIndexedInstanced(count, 1, 0, 0, 0);
 }
 
 void copy(BufferHandle dst, BufferHandle src, u32 dst_offset, u32 src_offset, u32 size) {
 	ASSERT(src);
 	ASSERT(dst);
-	D3D12_RESOURCE_STATES prev_dst = dst->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_COPY_DEST);
-	D3D12_RESOURCE_STATES prev_src = src->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_GENERIC_READ);
-	d3d->cmd_list->CopyBufferRegion(dst->resource, dst_offset, src->resource, src_offset, size);
-	dst->setState(d3d->cmd_list, prev_dst);
-	src->setState(d3d->cmd_list, prev_src);
+	D3D12_RESOURCE_STATES prev_dst = dst->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_COPY_DEST);
+	D3D12_RESOURCE_STATES prev_src = src->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_GENERIC_READ);
+	ctx().cmd_list->CopyBufferRegion(dst->resource, dst_offset, src->resource, src_offset, size);
+	dst->setState(ctx().cmd_list, prev_dst);
+	src->setState(ctx().cmd_list, prev_src);
 }
 
 void update(BufferHandle buffer, const void* data, size_t size) {
@@ -3214,9 +4336,9 @@ void update(BufferHandle buffer, const void* data, size_t size) {
 	ASSERT(size + dst <= d3d->frame->scratch_buffer_begin + SCRATCH_BUFFER_SIZE);
 	memcpy(dst, data, size);
 	UINT64 src_offset = dst - d3d->frame->scratch_buffer_begin;
-	D3D12_RESOURCE_STATES prev_state = buffer->setState(d3d->cmd_list, D3D12_RESOURCE_STATE_COPY_DEST);
-	d3d->cmd_list->CopyBufferRegion(buffer->resource, 0, d3d->frame->scratch_buffer, src_offset, size);
-	buffer->setState(d3d->cmd_list, prev_state);
+	D3D12_RESOURCE_STATES prev_state = buffer->setState(ctx().cmd_list, D3D12_RESOURCE_STATE_COPY_DEST);
+	ctx().cmd_list->CopyBufferRegion(buffer->resource, 0, d3d->frame->scratch_buffer, src_offset, size);
+	buffer->setState(ctx().cmd_list, prev_state);
 
 	d3d->frame->scratch_buffer_ptr += size;
 }
@@ -1,5 +1,7 @@
+#include "core/crt.h"
 #include "core/hash.h"
 #include "core/log.h"
+#include "core/math.h"
 #include "core/path.h"
 #include "core/profiler.h"
 #include "core/stream.h"
@@ -38,6 +40,7 @@ Material::Material(const Path& path, ResourceManager& resource_manager, Renderer
 	, m_render_states(gpu::StateFlags::CULL_BACK)
 	, m_define_mask(0)
 	, m_custom_flags(0)
+	, m_streaming_distance(0x7f7fFFff) // FLT_MAX
 {
 	m_layer = m_renderer.getLayerIdx("default");
 	for (int i = 0; i < MAX_TEXTURE_COUNT; ++i)
@@ -60,6 +63,29 @@ int Material::getCustomFlagCount()
 	return s_custom_flags.count;
 }
 
+void Material::requestStreaming(float distance) {
+	i32 bits;
+	memcpy(&bits, &distance, sizeof(bits));
+	for (;;) {
+		const i32 current = m_streaming_distance;
+		if (bits >= current) return;
+		if (m_streaming_distance.compareExchange(bits, current)) return;
+	}
+}
+
+void Material::updateTextureStreaming() {
+	const i32 bits = m_streaming_distance;
+	if (bits == 0x7f7fFFff) return; // not rendered since the last update
+	m_streaming_distance = 0x7f7fFFff;
+
+	float distance;
+	memcpy(&distance, &bits, sizeof(distance));
+	const u32 mip = distance <= STREAMING_FULL_RES_DISTANCE ? 0 : log2(u32(distance / STREAMING_FULL_RES_DISTANCE));
+	for (u32 i = 0; i < m_texture_count; ++i) {
+		if (m_textures[i]) m_textures[i]->requestMip(mip);
+	}
+}
+
 void Material::setLayer(u8 layer) { 
 	if (m_layer == layer) return;
 	m_layer = layer;
@@ -223,6 +249,10 @@ void Material::setTexturePath(int i, const Path& path)
 	{
 		setTexture(i, nullptr);
 	}
+	else if (m_renderer.isHeadless()) {
+		// textures are used only by GPU
+		setTexture(i, nullptr);
+	}
 	else
 	{
 		Texture* texture = m_resource_manager.getOwner().load<Texture>(path);
@@ -338,7 +368,7 @@ void Material::getUniformData(Span<float> data) const {
 		}
 	}
 	for (u32 i = 0; i < m_shader->m_texture_slot_count; ++i) {
-		const gpu::BindlessHandle bindless_handle = m_textures[i] ? gpu::getBindlessHandle(m_textures[i]->handle) : gpu::BindlessHandle();
+		const gpu::BindlessHandle bindless_handle = m_textures[i] && m_textures[i]->handle ? gpu::getBindlessHandle(m_textures[i]->handle) : gpu::BindlessHandle();
 		memcpy((u8*)cs + textures_offset + i * sizeof(bindless_handle), &bindless_handle, sizeof(bindless_handle));
 	}
 }
@@ -369,7 +399,7 @@ void Material::updateRenderData(bool on_before_ready)
 		}
 	}
 	for (u32 i = 0; i < m_shader->m_texture_slot_count; ++i) {
-		const gpu::BindlessHandle bindless_handle = m_textures[i] ? gpu::getBindlessHandle(m_textures[i]->handle) : gpu::BindlessHandle();
+		const gpu::BindlessHandle bindless_handle = m_textures[i] && m_textures[i]->handle ? gpu::getBindlessHandle(m_textures[i]->handle) : gpu::BindlessHandle();
 		memcpy((u8*)cs + textures_offset + i * sizeof(bindless_handle), &bindless_handle, sizeof(bindless_handle));
 	}
 
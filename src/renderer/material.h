@@ -2,6 +2,7 @@
 
 
 #include "core/array.h"
+#include "core/atomic.h"
 #include "core/hash.h"
 #include "engine/resource.h"
 #include "engine/resource_manager.h"
@@ -87,6 +88,12 @@ struct LUMIX_RENDERER_API Material final : Resource {
 	void serialize(struct OutputMemoryStream& blob);
 	u32 getBufferOffset() const { return u32(m_material_constants) * MAX_UNIFORMS_BYTES; }
 	MaterialIndex getIndex() const { return m_material_constants; }
+	// the material is rendered `distance` units from camera, thread safe
+	void requestStreaming(float distance);
+	// request texture mips according to distances from requestStreaming since the last call
+	void updateTextureStreaming();
+	// textures are streamed with full resolution closer than this, each doubling of distance drops one mip
+	static constexpr float STREAMING_FULL_RES_DISTANCE = 8;
 
 	gpu::StateFlags m_render_states;
 
@@ -106,6 +113,7 @@ private:
 
 	Array<Uniform> m_uniforms;
 	u32 m_custom_flags;
+	AtomicI32 m_streaming_distance; // float bits, positive floats can be compared as ints
 };
 
 } // namespace Lumix
@@ -39,6 +39,8 @@ Mesh::Mesh(const gpu::VertexDecl& vertex_decl,
 	, indices(allocator)
 	, vertices(allocator)
 	, skin(allocator)
+	, meshlets(allocator)
+	, bvh(allocator)
 	, vertex_decl(vertex_decl)
 	, renderer(renderer)
 	, vb_stride(vb_stride)
@@ -63,6 +65,8 @@ Mesh::Mesh(Mesh&& rhs)
 	, indices(rhs.indices)
 	, vertices(rhs.vertices.move())
 	, skin(rhs.skin.move())
+	, meshlets(rhs.meshlets.move())
+	, bvh(rhs.bvh.nodes.getAllocator())
 	, flags(rhs.flags)
 	, name(rhs.name)
 	, vertex_decl(rhs.vertex_decl)
@@ -91,6 +95,7 @@ Model::Model(const Path& path, ResourceManager& resource_manager, Renderer& rend
 	, m_meshes(m_allocator)
 	, m_mesh_material(m_allocator)
 	, m_bones(m_allocator)
+	, m_mesh_data(m_allocator)
 	, m_first_nonroot_bone_index(0)
 	, m_renderer(renderer)
 {
@@ -99,7 +104,7 @@ Model::Model(const Path& path, ResourceManager& resource_manager, Renderer& rend
 }
 
 
-static Vec3 evaluateSkin(Vec3& p, Mesh::Skin s, const Matrix* matrices)
+static Vec3 evaluateSkin(const Vec3& p, Mesh::Skin s, const Matrix* matrices)
 {
 	Matrix m = matrices[s.indices[0]] * s.weights.x + matrices[s.indices[1]] * s.weights.y +
 			   matrices[s.indices[2]] * s.weights.z + matrices[s.indices[3]] * s.weights.w;
@@ -149,6 +154,26 @@ bool Model::isSkinned() const
 }
 
 
+// hits both sides of the triangle
+static bool getRayTriangleHit(const Vec3& origin, const Vec3& dir, const Vec3& p0, const Vec3& p1, const Vec3& p2, float& out_t) {
+	const Vec3 normal = cross(p1 - p0, p2 - p0);
+	const float q = dot(normal, dir);
+	if (q == 0) return false;
+
+	const float d = -dot(normal, p0);
+	const float t = -(dot(normal, origin) + d) / q;
+	if (t < 0) return false;
+
+	const Vec3 hit_point = origin + dir * t;
+	if (dot(normal, cross(p1 - p0, hit_point - p0)) < 0) return false;
+	if (dot(normal, cross(p2 - p1, hit_point - p1)) < 0) return false;
+	if (dot(normal, cross(p0 - p2, hit_point - p2)) < 0) return false;
+
+	out_t = t;
+	return true;
+}
+
+
 RayCastModelHit Model::castRay(const Vec3& origin, const Vec3& dir, const Pose* pose, EntityPtr entity, const RayCastModelHit::Filter* filter)
 {
 	static const ComponentType MODEL_INSTANCE_TYPE = reflection::getComponentType("model_instance");
@@ -160,7 +185,8 @@ RayCastModelHit Model::castRay(const Vec3& origin, const Vec3& dir, const Pose*
 	Matrix matrices[256];
 	ASSERT(!pose || pose->count <= lengthOf(matrices));
 	bool is_skinned = false;
-	for (int mesh_index = m_lod_indices[0].from; mesh_index <= m_lod_indices[0].to; ++mesh_index) {
+	const LODMeshIndices& lod = m_lod_indices[m_resident_lod];
+	for (int mesh_index = lod.from; mesh_index <= lod.to; ++mesh_index) {
 		Mesh& mesh = m_meshes[mesh_index];
 		is_skinned = pose && !mesh.skin.empty() && pose->count <= lengthOf(matrices);
 	}
@@ -168,69 +194,53 @@ RayCastModelHit Model::castRay(const Vec3& origin, const Vec3& dir, const Pose*
 		computeSkinMatrices(*pose, *this, matrices);
 	}
 
-	for (int mesh_index = m_lod_indices[0].from; mesh_index <= m_lod_indices[0].to; ++mesh_index) {
-		const Mesh& mesh = m_meshes[mesh_index];
+	auto addHit = [&](float t, u32 mesh_index) {
+		if (hit.is_hit && hit.t <= t) return;
+		RayCastModelHit prev = hit;
+		hit.is_hit = true;
+		hit.t = t;
+		hit.entity = entity;
+		hit.mesh = &m_meshes[mesh_index];
+		hit.component_type = MODEL_INSTANCE_TYPE;
+		if (filter && !filter->invoke(hit)) hit = prev;
+	};
+
+	for (int mesh_index = lod.from; mesh_index <= lod.to; ++mesh_index) {
+		Mesh& mesh = m_meshes[mesh_index];
 		const bool is_mesh_skinned = !mesh.skin.empty() && is_skinned;
 		const u16* indices16 = (const u16*)mesh.indices.data();
 		const u32* indices32 = (const u32*)mesh.indices.data();
 		const bool is16 = mesh.flags & Mesh::Flags::INDICES_16_BIT;
 		const int index_size = is16 ? 2 : 4;
 		const Vec3* vertices = mesh.vertices.begin();
+		const i32 triangle_count = (i32)mesh.indices.size() / index_size / 3;
+		auto getIndex = [&](i32 i) -> u32 { return is16 ? indices16[i] : indices32[i]; };
 		
-		for (i32 i = 0, c = (i32)mesh.indices.size() / index_size; i < c; i += 3) {
-			Vec3 p0, p1, p2;
-			if (is16) {
-				p0 = vertices[indices16[i]];
-				p1 = vertices[indices16[i + 1]];
-				p2 = vertices[indices16[i + 2]];
-				if (is_mesh_skinned) {
-					p0 = evaluateSkin(p0, mesh.skin[indices16[i]], matrices);
-					p1 = evaluateSkin(p1, mesh.skin[indices16[i + 1]], matrices);
-					p2 = evaluateSkin(p2, mesh.skin[indices16[i + 2]], matrices);
-				}
-			} else {
-				p0 = vertices[indices32[i]];
-				p1 = vertices[indices32[i + 1]];
-				p2 = vertices[indices32[i + 2]];
-				if (is_mesh_skinned) {
-					p0 = evaluateSkin(p0, mesh.skin[indices32[i]], matrices);
-					p1 = evaluateSkin(p1, mesh.skin[indices32[i + 1]], matrices);
-					p2 = evaluateSkin(p2, mesh.skin[indices32[i + 2]], matrices);
-				}
+		if (!is_mesh_skinned) {
+			if (mesh.bvh.empty() && triangle_count > 0) {
+				PROFILE_BLOCK("build mesh bvh");
+				Array<Vec3> corners(m_allocator);
+				corners.resize(triangle_count * 3);
+				for (i32 i = 0; i < triangle_count * 3; ++i) corners[i] = vertices[getIndex(i)];
+				mesh.bvh.build(corners);
 			}
 
-			Vec3 normal = cross(p1 - p0, p2 - p0);
-			float q = dot(normal, dir);
-			if (q == 0)	continue;
-
-			float d = -dot(normal, p0);
-			float t = -(dot(normal, origin) + d) / q;
-			if (t < 0) continue;
-
-			Vec3 hit_point = origin + dir * t;
-
-			Vec3 edge0 = p1 - p0;
-			Vec3 VP0 = hit_point - p0;
-			if (dot(normal, cross(edge0, VP0)) < 0) continue;
-
-			Vec3 edge1 = p2 - p1;
-			Vec3 VP1 = hit_point - p1;
-			if (dot(normal, cross(edge1, VP1)) < 0) continue;
-
-			Vec3 edge2 = p0 - p2;
-			Vec3 VP2 = hit_point - p2;
-			if (dot(normal, cross(edge2, VP2)) < 0) continue;
+			mesh.bvh.castRay(origin, dir, hit.is_hit ? hit.t : FLT_MAX, [&](u32 triangle, float& max_t){
+				float t;
+				const i32 i = triangle * 3;
+				if (!getRayTriangleHit(origin, dir, vertices[getIndex(i)], vertices[getIndex(i + 1)], vertices[getIndex(i + 2)], t)) return;
+				addHit(t, mesh_index);
+				if (hit.is_hit) max_t = hit.t;
+			});
+			continue;
+		}
 
-			if (!hit.is_hit || hit.t > t)
-			{
-				RayCastModelHit prev = hit;
-				hit.is_hit = true;
-				hit.t = t;
-				hit.entity = entity;
-				hit.mesh = &m_meshes[mesh_index];
-				hit.component_type = MODEL_INSTANCE_TYPE;
-				if (filter && !filter->invoke(hit)) hit = prev;
-			}
+		for (i32 i = 0; i < triangle_count * 3; i += 3) {
+			const Vec3 p0 = evaluateSkin(vertices[getIndex(i)], mesh.skin[getIndex(i)], matrices);
+			const Vec3 p1 = evaluateSkin(vertices[getIndex(i + 1)], mesh.skin[getIndex(i + 1)], matrices);
+			const Vec3 p2 = evaluateSkin(vertices[getIndex(i + 2)], mesh.skin[getIndex(i + 2)], matrices);
+			float t;
+			if (getRayTriangleHit(origin, dir, p0, p1, p2, t)) addHit(t, mesh_index);
 		}
 	}
 	hit.origin = DVec3(origin.x, origin.y, origin.z);
@@ -283,6 +293,9 @@ static bool parseVertexDecl(IInputStream& file, gpu::VertexDecl* vertex_decl, At
 
 		switch(semantics[i]) {
 			case AttributeSemantic::WEIGHTS:
+				// 8bit weights are normalized, see ModelMeta::compress_vertices
+				vertex_decl->addAttribute(offset, cmp_count, type, type == gpu::AttributeType::U8 ? gpu::Attribute::NORMALIZED : 0);
+				break;
 			case AttributeSemantic::POSITION:
 			case AttributeSemantic::TEXCOORD0:
 				vertex_decl->addAttribute(offset, cmp_count, type, 0);
@@ -318,7 +331,9 @@ void Model::onBeforeReady()
 {
 	for (u32 i = 0, n = m_meshes.size(); i < n; ++i) {
 		Mesh& mesh = m_meshes[i];
-		mesh.type = getBoneCount() == 0 || mesh.skin.empty() ? Mesh::RIGID : Mesh::SKINNED;
+		// skin is not loaded for streamed meshes, so we check attributes
+		const bool has_skin = hasAttribute(mesh, AttributeSemantic::WEIGHTS) && hasAttribute(mesh, AttributeSemantic::JOINTS);
+		mesh.type = getBoneCount() == 0 || !has_skin ? Mesh::RIGID : Mesh::SKINNED;
 	}
 
 	for (u32 i = 0; i < 4; ++i) {
@@ -396,6 +411,12 @@ bool Model::parseBones(InputMemoryStream& file)
 	{
 			m_bones[i].inv_bind_transform = invert(m_bones[i].transform);
 	}
+
+	// parents are before children
+	for (int i = m_bones.size() - 1; i >= 0; --i) {
+		const int p = m_bones[i].parent_idx;
+		if (p >= 0) m_bones[p].height = maximum(m_bones[p].height, m_bones[i].height + 1);
+	}
 	
 	for (int i = 0; i < m_bones.size(); ++i)
 	{
@@ -436,6 +457,17 @@ static int getAttributeOffset(Mesh& mesh, AttributeSemantic attr)
 }
 
 
+static gpu::AttributeType getAttributeType(Mesh& mesh, AttributeSemantic attr)
+{
+	for (u32 i = 0; i < lengthOf(mesh.attributes_semantic); ++i) {
+		if(mesh.attributes_semantic[i] == attr) {
+			return mesh.vertex_decl.attributes[i].type;
+		}
+	}
+	return gpu::AttributeType::FLOAT;
+}
+
+
 bool Model::parseMeshes(InputMemoryStream& file, FileVersion version)
 {
 	int object_count = 0;
@@ -469,6 +501,8 @@ bool Model::parseMeshes(InputMemoryStream& file, FileVersion version)
 		addDependency(*material);
 	}
 
+	// only remember where the data are, buffers are created in loadMeshData, so LODs can be streamed
+	m_mesh_data.resize(object_count);
 	for (int i = 0; i < object_count; ++i)
 	{
 		Mesh& mesh = m_meshes[i];
@@ -484,30 +518,59 @@ bool Model::parseMeshes(InputMemoryStream& file, FileVersion version)
 			logError(m_path, ": has no geometry data");
 			return false;
 		}
-		mesh.indices.resize(index_size * indices_count);
 		mesh.indices_count = indices_count;
-		file.read(mesh.indices.getMutableData(), mesh.indices.size());
-
 		if (index_size == 2) mesh.flags |= Mesh::Flags::INDICES_16_BIT;
-		const Renderer::MemRef mem = m_renderer.copy(mesh.indices.data(), (u32)mesh.indices.size());
-		mesh.index_buffer_handle = m_renderer.createBuffer(mem, gpu::BufferFlags::IMMUTABLE, m_path.c_str());
 		mesh.index_type = index_size == 2 ? gpu::DataType::U16 : gpu::DataType::U32;
-		if (!mesh.index_buffer_handle) {
-			logError(m_path, ": failed to create index buffer");
-			return false;
-		}
+		m_mesh_data[i].indices_offset = u32(file.getPosition());
+		file.skip(index_size * indices_count);
 	}
 
 	for (int i = 0; i < object_count; ++i)
 	{
-		Mesh& mesh = m_meshes[i];
 		int data_size;
 		file.read(data_size);
-		Renderer::MemRef vertices_mem = m_renderer.allocate(data_size);
-		file.read(vertices_mem.data, data_size);
+		if (data_size <= 0) {
+			logError(m_path, ": has no geometry data");
+			return false;
+		}
+		m_mesh_data[i].vertices_offset = u32(file.getPosition());
+		m_mesh_data[i].vertices_size = data_size;
+		file.skip(data_size);
+	}
+	file.read(m_origin_bounding_radius);
+	file.read(m_center_bounding_radius);
+	file.read(m_aabb);
+
+	return !file.hasOverflow();
+}
+
+
+bool Model::loadMeshData(Span<const u8> mem, i32 from_mesh, i32 to_mesh) {
+	for (i32 i = from_mesh; i <= to_mesh; ++i) {
+		Mesh& mesh = m_meshes[i];
+		const MeshData& mesh_data = m_mesh_data[i];
+		const u32 index_size = mesh.areIndices16() ? 2 : 4;
+		const u32 indices_size = index_size * mesh.indices_count;
+		if (u64(mesh_data.indices_offset) + indices_size > mem.length() || u64(mesh_data.vertices_offset) + mesh_data.vertices_size > mem.length()) {
+			logError(m_path, ": corrupted file");
+			return false;
+		}
+
+		mesh.indices.resize(indices_size);
+		memcpy(mesh.indices.getMutableData(), mem.begin() + mesh_data.indices_offset, indices_size);
+		const Renderer::MemRef mem_indices = m_renderer.copy(mesh.indices.data(), (u32)mesh.indices.size());
+		mesh.index_buffer_handle = m_renderer.createBuffer(mem_indices, gpu::BufferFlags::IMMUTABLE, m_path.c_str());
+		if (!mesh.index_buffer_handle) {
+			logError(m_path, ": failed to create index buffer");
+			return false;
+		}
+
+		const u32 data_size = mesh_data.vertices_size;
+		Renderer::MemRef vertices_mem = m_renderer.copy(mem.begin() + mesh_data.vertices_offset, data_size);
 
 		int position_attribute_offset = getAttributeOffset(mesh, AttributeSemantic::POSITION);
 		int weights_attribute_offset = getAttributeOffset(mesh, AttributeSemantic::WEIGHTS);
+		const bool u8_weights = getAttributeType(mesh, AttributeSemantic::WEIGHTS) == gpu::AttributeType::U8;
 		int bone_indices_attribute_offset = getAttributeOffset(mesh, AttributeSemantic::JOINTS);
 		bool keep_skin = hasAttribute(mesh, AttributeSemantic::WEIGHTS) && hasAttribute(mesh, AttributeSemantic::JOINTS);
 
@@ -521,7 +584,13 @@ bool Model::parseMeshes(InputMemoryStream& file, FileVersion version)
 			int offset = j * vertex_size;
 			if (keep_skin)
 			{
-				mesh.skin[j].weights = *(const Vec4*)&vertices[offset + weights_attribute_offset];
+				if (u8_weights) {
+					const u8* w = &vertices[offset + weights_attribute_offset];
+					mesh.skin[j].weights = Vec4(w[0], w[1], w[2], w[3]) * (1 / 255.f);
+				}
+				else {
+					mesh.skin[j].weights = *(const Vec4*)&vertices[offset + weights_attribute_offset];
+				}
 				memcpy(mesh.skin[j].indices,
 					&vertices[offset + bone_indices_attribute_offset],
 					sizeof(mesh.skin[j].indices));
@@ -534,14 +603,83 @@ bool Model::parseMeshes(InputMemoryStream& file, FileVersion version)
 			return false;
 		}
 	}
-	file.read(m_origin_bounding_radius);
-	file.read(m_center_bounding_radius);
-	file.read(m_aabb);
-
 	return true;
 }
 
 
+void Model::requestLOD(u32 lod) const {
+	if (lod < m_resident_lod && m_lod_requested == 0) m_lod_requested = 1;
+	if (lod == 0 && m_lod0_used == 0) m_lod0_used = 1;
+}
+
+
+void Model::updateStreaming() {
+	if (m_resident_lod == 0 || m_lod_requested == 0 || m_stream_op.isValid() || !isReady()) return;
+	m_lod_requested = 0;
+
+	FileSystem& fs = m_resource_manager.getOwner().getFileSystem();
+	const Path res_path(".lumix/resources/", getPath().getHash(), ".res");
+	m_stream_op = fs.getContent(res_path, makeDelegate<&Model::streamedIn>(this));
+}
+
+
+void Model::streamedIn(Span<const u8> blob, bool success) {
+	m_stream_op = FileSystem::AsyncHandle::invalid();
+	if (!success || !isReady() || m_resident_lod == 0) return;
+
+	OutputMemoryStream tmp(m_allocator);
+	Span<const u8> content;
+	if (!getCompiledContent(blob, tmp, content)) return;
+	// file changed, model is going to be reloaded
+	if (content.length() != m_content_size) return;
+
+	const LODMeshIndices& lod = m_lod_indices[0];
+	if (!loadMeshData(content, lod.from, lod.to)) return;
+
+	m_resident_lod = 0;
+	m_lod0_used = 1;
+	updateMemoryUsage();
+}
+
+
+void Model::releaseStreamed() {
+	if (m_resident_lod > 0 || !m_renderer.isModelStreaming() || m_lod_indices[1].to < m_lod_indices[1].from) return;
+	if (m_lod0_used != 0) {
+		// used since the last call
+		m_lod0_used = 0;
+		return;
+	}
+
+	DrawStream& stream = m_renderer.getDrawStream();
+	m_resident_lod = 1;
+	for (i32 i = m_lod_indices[0].from; i <= m_lod_indices[0].to; ++i) {
+		Mesh& mesh = m_meshes[i];
+		if (mesh.index_buffer_handle) stream.destroy(mesh.index_buffer_handle);
+		if (mesh.vertex_buffer_handle) stream.destroy(mesh.vertex_buffer_handle);
+		mesh.index_buffer_handle = gpu::INVALID_BUFFER;
+		mesh.vertex_buffer_handle = gpu::INVALID_BUFFER;
+		mesh.indices.free();
+		Array<Vec3> vertices(m_allocator);
+		Array<Mesh::Skin> skin(m_allocator);
+		mesh.vertices.swap(vertices);
+		mesh.skin.swap(skin);
+	}
+	updateMemoryUsage();
+}
+
+
+u64 Model::getMemoryUsage() const {
+	u64 size = 0;
+	for (i32 i = 0, c = m_meshes.size(); i < c; ++i) {
+		const Mesh& mesh = m_meshes[i];
+		if (!mesh.vertex_buffer_handle) continue;
+		// GPU buffers and CPU copies
+		size += m_mesh_data[i].vertices_size + mesh.indices.size() * 2 + mesh.vertices.byte_size() + mesh.skin.byte_size();
+	}
+	return size;
+}
+
+
 bool Model::parseLODs(InputMemoryStream& file)
 {
 	u32 lod_count;
@@ -563,6 +701,24 @@ bool Model::parseLODs(InputMemoryStream& file)
 }
 
 
+bool Model::parseMeshlets(InputMemoryStream& file) {
+	for (Mesh& mesh : m_meshes) {
+		u32 count;
+		file.read(count);
+		mesh.meshlets.resize(count);
+		if (count == 0) continue;
+		file.read(mesh.meshlets.begin(), mesh.meshlets.byte_size());
+		for (const Meshlet& meshlet : mesh.meshlets) {
+			if (u64(meshlet.indices_offset) + meshlet.indices_count > mesh.indices_count) {
+				logError(m_path, ": invalid meshlet");
+				return false;
+			}
+		}
+	}
+	return !file.hasOverflow();
+}
+
+
 bool Model::load(Span<const u8> mem)
 {
 	PROFILE_FUNCTION();
@@ -586,14 +742,22 @@ bool Model::load(Span<const u8> mem)
 		file.read(m_root_motion_bone);
 	}
 
-	if (parseMeshes(file, (FileVersion)header.version)
-		&& parseBones(file)
-		&& parseLODs(file))
+	if (!parseMeshes(file, (FileVersion)header.version)
+		|| !parseBones(file)
+		|| !parseLODs(file))
 	{
-		return true;
+		return false;
 	}
 
-	return false;
+	if (header.version > FileVersion::MESHLETS && !parseMeshlets(file)) return false;
+
+	m_content_size = mem.length();
+	// LOD0 is loaded when an instance gets close, other LODs are always resident
+	const bool has_lod1 = m_lod_indices[1].to >= m_lod_indices[1].from;
+	m_resident_lod = m_renderer.isModelStreaming() && has_lod1 ? 1 : 0;
+	m_lod_requested = 0;
+	m_lod0_used = 0;
+	return loadMeshData(mem, m_lod_indices[m_resident_lod].from, m_meshes.size() - 1);
 }
 
 
@@ -619,9 +783,15 @@ void Model::unload()
 		mesh.index_buffer_handle = gpu::INVALID_BUFFER;
 		mesh.vertex_buffer_handle = gpu::INVALID_BUFFER;
 	}
+	if (m_stream_op.isValid()) {
+		m_resource_manager.getOwner().getFileSystem().cancel(m_stream_op);
+		m_stream_op = FileSystem::AsyncHandle::invalid();
+	}
 	m_meshes.clear();
 	m_mesh_material.clear();
+	m_mesh_data.clear();
 	m_bones.clear();
+	m_resident_lod = 0;
 }
 
 
@@ -3,6 +3,7 @@
 #include "engine/lumix.h"
 
 #include "core/array.h"
+#include "core/atomic.h"
 #include "core/geometry.h"
 #include "core/hash.h"
 #include "core/hash_map.h"
@@ -12,6 +13,7 @@
 
 #include "engine/resource.h"
 #include "gpu/gpu.h"
+#include "renderer/triangle_bvh.h"
 
 
 namespace Lumix {
@@ -67,6 +69,19 @@ struct MeshMaterial {
 	Flags flags;
 };
 
+// cluster of up to 64 vertices / 124 triangles, used to cull parts of dense meshes per view
+// triangles of a meshlet are a contiguous range in mesh's index buffer
+struct Meshlet {
+	Vec3 center;
+	float radius;
+	// normal cone, meshlet is backfacing if dot(normalize(cone_apex - camera_pos), cone_axis) >= cone_cutoff
+	Vec3 cone_apex;
+	float cone_cutoff;
+	Vec3 cone_axis;
+	u32 indices_offset;
+	u32 indices_count;
+};
+
 struct LUMIX_RENDERER_API Mesh {
 	struct Skin {
 		Vec4 weights;
@@ -101,6 +116,10 @@ struct LUMIX_RENDERER_API Mesh {
 	OutputMemoryStream indices;
 	Array<Vec3> vertices;
 	Array<Skin> skin;
+	// empty if the model was not imported with meshlets
+	Array<Meshlet> meshlets;
+	// of bind pose triangles, built on first raycast, see Model::castRay
+	TriangleBVH bvh;
 	Flags flags = Flags::NONE;
 	String name;
 	gpu::VertexDecl vertex_decl;
@@ -130,6 +149,7 @@ public:
 
 	enum class FileVersion : u32 {
 		ROOT_MOTION_BONE,
+		MESHLETS,
 
 		LATEST // keep this last
 	};
@@ -158,6 +178,8 @@ public:
 		LocalRigidTransform relative_transform;
 		LocalRigidTransform inv_bind_transform;
 		int parent_idx;
+		// length of the longest chain of descendants, 0 for leaf bones such as finger tips, see Animation::SampleContext::min_bone_height
+		u32 height = 0;
 	};
 
 	static const ResourceType TYPE;
@@ -167,14 +189,42 @@ public:
 
 	ResourceType getType() const override { return TYPE; }
 
+	// returns resident LOD, if the one at `squared_distance` is not loaded yet, it's requested
 	u32 getLODMeshIndices(float squared_distance) const {
-		if (squared_distance < m_lod_distances[0]) return 0;
+		if (squared_distance < m_lod_distances[0]) {
+			if (m_resident_lod > 0) {
+				requestLOD(0);
+				return m_resident_lod;
+			}
+			if (m_lod0_used == 0) m_lod0_used = 1;
+			return 0;
+		}
 		if (squared_distance < m_lod_distances[1]) return 1;
 		if (squared_distance < m_lod_distances[2]) return 2;
 		if (squared_distance < m_lod_distances[3]) return 3;
 		return 4;
 	}
 
+	// same as above, but `prev_lod` is kept until `squared_distance` is far enough from the LOD boundary,
+	// so instances near the boundary do not switch back and forth each frame
+	u32 getLODMeshIndices(float squared_distance, u32 prev_lod) const {
+		const u32 lod = getLODMeshIndices(squared_distance);
+		if (prev_lod < m_resident_lod) return lod;
+		if (lod == prev_lod + 1 && squared_distance < m_lod_distances[prev_lod] * LOD_HYSTERESIS) return prev_lod;
+		if (lod + 1 == prev_lod && squared_distance * LOD_HYSTERESIS > m_lod_distances[lod]) return prev_lod;
+		return lod;
+	}
+
+	// LOD streaming, see Renderer::isModelStreaming
+	// LOD0 meshes have no buffers nor CPU data until LOD0 is requested and streamed in
+	u32 getResidentLOD() const { return m_resident_lod; }
+	// thread safe
+	void requestLOD(u32 lod) const;
+	// start streaming requested LODs, call from main thread
+	void updateStreaming();
+	u64 getMemoryUsage() const override;
+	void releaseStreamed() override;
+
 	Mesh& getMesh(u32 index) { return m_meshes[index]; }
 	const Mesh& getMesh(u32 index) const { return m_meshes[index]; }
 	Span<MeshMaterial> getMeshMaterials() { return m_mesh_material; }
@@ -203,6 +253,8 @@ public:
 
 public:
 	static constexpr u32 MAX_LOD_COUNT = 4;
+	// LOD distances are squared, this is ~10% of distance
+	static constexpr float LOD_HYSTERESIS = 1.21f;
 
 private:
 	Model(const Model&);
@@ -211,11 +263,21 @@ private:
 	bool parseBones(InputMemoryStream& file);
 	bool parseMeshes(InputMemoryStream& file, FileVersion version);
 	bool parseLODs(InputMemoryStream& file);
+	bool parseMeshlets(InputMemoryStream& file);
 	int getBoneIdx(const char* name);
+	bool loadMeshData(Span<const u8> mem, i32 from_mesh, i32 to_mesh);
+	void streamedIn(Span<const u8> blob, bool success);
 
 	void unload() override;
 	bool load(Span<const u8> mem) override;
 
+	// where mesh data are in the compiled file
+	struct MeshData {
+		u32 indices_offset;
+		u32 vertices_offset;
+		u32 vertices_size;
+	};
+
 private:
 	TagAllocator m_allocator;
 	Renderer& m_renderer;
@@ -230,6 +292,12 @@ private:
 	AABB m_aabb;
 	BoneNameHash m_root_motion_bone;
 	int m_first_nonroot_bone_index;
+	Array<MeshData> m_mesh_data;
+	u64 m_content_size = 0;
+	u32 m_resident_lod = 0;
+	mutable AtomicI32 m_lod_requested = 0;
+	mutable AtomicI32 m_lod0_used = 0; // since the last releaseStreamed
+	FileSystem::AsyncHandle m_stream_op = FileSystem::AsyncHandle::invalid();
 };
 
 
@@ -6,16 +6,20 @@
 #include "core/log.h"
 #include "core/math.h"
 #include "core/metaprogramming.h"
+#include "core/os.h"
 #include "core/page_allocator.h"
 #include "core/profiler.h"
 #include "engine/resource_manager.h"
 #include "core/simd.h"
 #include "core/stack_array.h"
 #include "core/stream.h"
+#include "core/string.h"
 #include "editor/gizmo.h"
 #include "editor/world_editor.h"
+#include "renderer/draw_stream.h"
 #include "renderer/material.h"
 #include "renderer/model.h"
+#include "renderer/pipeline.h"
 #include "renderer/render_module.h"
 #include "engine/world.h"
 
@@ -36,6 +40,7 @@ ParticleSystemResource::Emitter::~Emitter() {
 ParticleSystemResource::Emitter::Emitter(ParticleSystemResource& resource)
 	: resource(resource)
 	, instructions(resource.m_allocator)
+	, fused_instructions(resource.m_allocator)
 	, material(nullptr)
 	, vertex_decl(gpu::PrimitiveType::TRIANGLE_STRIP)
 {
@@ -49,6 +54,7 @@ ParticleSystemResource::ParticleSystemResource(const Path& path
 	: Resource(path, manager, allocator)
 	, m_allocator(allocator)
 	, m_emitters(allocator)
+	, m_renderer(renderer)
 {
 }
 
@@ -62,7 +68,9 @@ void ParticleSystemResource::unload()
 			removeDependency(*tmp);
 			tmp->decRefCount();
 		}
+		destroyGPUProgram(emitter);
 		emitter.instructions.clear();
+		emitter.fused_instructions.clear();
 	}
 	m_emitters.clear();
 }
@@ -79,6 +87,8 @@ void ParticleSystemResource::overrideData(u32 emitter_idx
 	, u32 emit_inputs_count
 	, float emit_rate
 	, const Path& material
+	, bool gpu_simulation
+	, u32 gpu_capacity
 )
 {
 	++m_empty_dep_count;
@@ -95,7 +105,11 @@ void ParticleSystemResource::overrideData(u32 emitter_idx
 	emitter.init_emit_count = init_emit_count;
 	emitter.emit_per_second = emit_rate;
 	emitter.emit_inputs_count = emit_inputs_count;
+	emitter.gpu_simulation = gpu_simulation;
+	emitter.gpu_capacity = gpu_capacity;
 	emitter.setMaterial(material);
+	fuseInstructions(emitter);
+	createGPUProgram(emitter);
 	
 	--m_empty_dep_count;
 	checkState();
@@ -179,10 +193,450 @@ bool ParticleSystemResource::load(Span<const u8> mem) {
 		if (header.version > Version::EMIT) {
 			blob.read(emitter.emit_inputs_count);
 		}
+		if (header.version > Version::GPU_SIMULATION) {
+			blob.read(emitter.gpu_simulation);
+			blob.read(emitter.gpu_capacity);
+		}
+		fuseInstructions(emitter);
+		createGPUProgram(emitter);
 	}
 	return true;
 }
 
+// gpu simulation - instructions are translated to hlsl, each thread runs the instructions for one particle
+// channels, registers and outputs are local variables, channels are stored in particle buffers between updates
+enum class GPUParticlePass : u32 {
+	PREPARE,
+	EMIT,
+	UPDATE,
+	FINALIZE
+};
+
+static const char* GPU_PARTICLES_PROLOGUE = R"#(
+	cbuffer Data : register(b4) {
+		float u_time_delta;
+		float u_total_time;
+		float u_emit_time;
+		float u_emit_time_step;
+		float4 u_delta_rot;
+		float4 u_delta_pos;
+		float4 u_delta_scale;
+		uint u_pass;
+		uint u_current;
+		uint u_emit_count;
+		uint u_emit_index;
+		uint u_capacity;
+		uint u_seed;
+		uint u_world_space;
+		uint u_src;
+		uint u_dst;
+		uint u_instances;
+		uint u_state;
+	};
+
+	float hash(uint n) {
+		n = (n << 13U) ^ n;
+		n = n * (n * n * 15731U + 789221U) + 1376312589U;
+		return float(n & 0x0fffffffU) / float(0x0fffffff);
+	}
+
+	float gnoise(float p) {
+		uint i = uint(floor(p));
+		float f = p - i;
+		float u = f * f * (3.0 - 2.0 * f);
+		float g0 = hash(i + 0u) * 2.0 - 1.0;
+		float g1 = hash(i + 1u) * 2.0 - 1.0;
+		return 2.4 * lerp(g0 * (f - 0.0), g1 * (f - 1.0), u);
+	}
+
+	float randFloat(inout uint seed, float from, float to) {
+		seed = seed * 747796405u + 2891336453u;
+		uint v = ((seed >> ((seed >> 28u) + 4u)) ^ seed) * 277803737u;
+		v = (v >> 22u) ^ v;
+		return lerp(from, to, v / 4294967295.0);
+	}
+
+	// conditions are masks, same as on cpu
+	float toMask(bool v) { return asfloat(v ? 0xffffffff : 0); }
+	bool isSet(float mask) { return (asuint(mask) & 0x80000000) != 0; }
+	float maskAnd(float a, float b) { return asfloat(asuint(a) & asuint(b)); }
+	float maskOr(float a, float b) { return asfloat(asuint(a) | asuint(b)); }
+	float blend(float false_val, float true_val, float mask) { return isSet(mask) ? true_val : false_val; }
+
+	float3 rotate(float4 q, float3 v) {
+		return v + 2 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+	}
+)#";
+
+// String::append does not format numbers
+template <typename... Args>
+static void appendHLSL(String& code, Args... args) {
+	code.append(StaticString<512>(args...));
+}
+
+static StaticString<32> toHLSL(float value) {
+	// bit exact
+	u32 bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return StaticString<32>("asfloat(", bits, "u)");
+}
+
+static StaticString<32> toHLSL(DataStream stream) {
+	switch (stream.type) {
+		case DataStream::CHANNEL: return StaticString<32>("c", (u32)stream.index);
+		case DataStream::REGISTER: return StaticString<32>("r", (u32)stream.index);
+		case DataStream::OUT: return StaticString<32>("o", (u32)stream.index);
+		case DataStream::CONST: return StaticString<32>("k", (u32)stream.index);
+		case DataStream::LITERAL: return toHLSL(stream.value);
+		default: ASSERT(false); return StaticString<32>("0");
+	}
+}
+
+// translates instructions up to END, returns false if there's an instruction not supported on gpu
+static bool generateHLSL(InputMemoryStream& ip, String& code) {
+	auto op1 = [&](const char* func){
+		const DataStream dst = ip.read<DataStream>();
+		const DataStream op0 = ip.read<DataStream>();
+		appendHLSL(code, "\t", toHLSL(dst), " = ", func, "(", toHLSL(op0), ");\n");
+	};
+	auto op2 = [&](const char* func){
+		const DataStream dst = ip.read<DataStream>();
+		const DataStream op0 = ip.read<DataStream>();
+		const DataStream op1 = ip.read<DataStream>();
+		appendHLSL(code, "\t", toHLSL(dst), " = ", func, "(", toHLSL(op0), ", ", toHLSL(op1), ");\n");
+	};
+	auto binary = [&](const char* op){
+		const DataStream dst = ip.read<DataStream>();
+		const DataStream op0 = ip.read<DataStream>();
+		const DataStream op1 = ip.read<DataStream>();
+		appendHLSL(code, "\t", toHLSL(dst), " = ", toHLSL(op0), " ", op, " ", toHLSL(op1), ";\n");
+	};
+
+	for (;;) {
+		const InstructionType it = ip.read<InstructionType>();
+		switch (it) {
+			case InstructionType::END: return !ip.hasOverflow();
+			case InstructionType::ADD: binary("+"); break;
+			case InstructionType::SUB: binary("-"); break;
+			case InstructionType::MUL: binary("*"); break;
+			case InstructionType::DIV: binary("/"); break;
+			case InstructionType::MOD: op2("fmod"); break;
+			case InstructionType::AND: op2("maskAnd"); break;
+			case InstructionType::OR: op2("maskOr"); break;
+			case InstructionType::COS: op1("cos"); break;
+			case InstructionType::SIN: op1("sin"); break;
+			case InstructionType::SQRT: op1("sqrt"); break;
+			case InstructionType::NOISE: op1("gnoise"); break;
+			case InstructionType::MOV: op1(""); break;
+			case InstructionType::LT:
+			case InstructionType::GT: {
+				const DataStream dst = ip.read<DataStream>();
+				const DataStream op0 = ip.read<DataStream>();
+				const DataStream op1 = ip.read<DataStream>();
+				const char* cmp = it == InstructionType::LT ? " < " : " > ";
+				appendHLSL(code, "\t", toHLSL(dst), " = toMask(", toHLSL(op0), cmp, toHLSL(op1), ");\n");
+				break;
+			}
+			case InstructionType::MULTIPLY_ADD:
+			case InstructionType::MIX:
+			case InstructionType::BLEND: {
+				const DataStream dst = ip.read<DataStream>();
+				const DataStream op0 = ip.read<DataStream>();
+				const DataStream op1 = ip.read<DataStream>();
+				const DataStream op2 = ip.read<DataStream>();
+				const StaticString<32> a = toHLSL(op0);
+				const StaticString<32> b = toHLSL(op1);
+				const StaticString<32> c = toHLSL(op2);
+				appendHLSL(code, "\t", toHLSL(dst), " = ");
+				switch (it) {
+					case InstructionType::MULTIPLY_ADD: appendHLSL(code, a, " * ", b, " + ", c, ";\n"); break;
+					case InstructionType::MIX: appendHLSL(code, a, " + (", b, " - ", a, ") * ", c, ";\n"); break;
+					default: appendHLSL(code, "blend(", a, ", ", b, ", ", c, ");\n"); break;
+				}
+				break;
+			}
+			case InstructionType::RAND: {
+				const DataStream dst = ip.read<DataStream>();
+				const float from = ip.read<float>();
+				const float to = ip.read<float>();
+				appendHLSL(code, "\t", toHLSL(dst), " = randFloat(seed, ", toHLSL(from), ", ", toHLSL(to), ");\n");
+				break;
+			}
+			case InstructionType::KILL: {
+				const DataStream condition = ip.read<DataStream>();
+				appendHLSL(code, "\tif (isSet(", toHLSL(condition), ")) return;\n");
+				break;
+			}
+			case InstructionType::GRADIENT: {
+				const DataStream dst = ip.read<DataStream>();
+				const DataStream op0 = ip.read<DataStream>();
+				const u32 count = ip.read<u32>();
+				float keys[8];
+				float values[8];
+				if (count > lengthOf(keys) || count == 0) return false;
+				ip.read(keys, sizeof(keys[0]) * count);
+				ip.read(values, sizeof(values[0]) * count);
+				if (count == 1) {
+					appendHLSL(code, "\t", toHLSL(dst), " = ", toHLSL(values[0]), ";\n");
+					break;
+				}
+
+				// same as on cpu, the first key greater or equal to the argument is used
+				appendHLSL(code, "\t{\n\t\tconst float v = clamp(", toHLSL(op0), ", ", toHLSL(keys[0]), ", ", toHLSL(keys[count - 1]), ");\n");
+				appendHLSL(code, "\t\t", toHLSL(dst), " = ");
+				for (u32 i = 1; i < count; ++i) {
+					const float m = (values[i] - values[i - 1]) / (keys[i] - keys[i - 1]);
+					const StaticString<32> key = toHLSL(keys[i]);
+					if (i + 1 < count) appendHLSL(code, "v <= ", key, " ? ");
+					appendHLSL(code, toHLSL(values[i]), " - (", key, " - v) * ", toHLSL(m));
+					if (i + 1 < count) appendHLSL(code, " : ");
+				}
+				appendHLSL(code, ";\n\t}\n");
+				break;
+			}
+			// emitting other emitters, splines and meshes need data from cpu
+			case InstructionType::EMIT:
+			case InstructionType::SPLINE:
+			case InstructionType::MESH:
+			case InstructionType::FUSED:
+				return false;
+		}
+	}
+}
+
+static bool generateGPUProgram(const ParticleSystemResource::Emitter& emitter, String& code) {
+	const u32 channels_count = emitter.channels_count;
+	const u32 outputs_count = emitter.outputs_count;
+	code.append(GPU_PARTICLES_PROLOGUE);
+	appendHLSL(code, "[numthreads(64, 1, 1)]\nvoid main(uint3 thread_id : SV_DispatchThreadID) {\n");
+	appendHLSL(code, "\tconst uint next = 1 - u_current;\n");
+	appendHLSL(code, "\tif (u_pass == ", (u32)GPUParticlePass::PREPARE, ") {\n");
+	appendHLSL(code, "\t\tif (thread_id.x == 0) bindless_rw_buffers[u_state].Store(next * 4, 0);\n");
+	appendHLSL(code, "\t\treturn;\n\t}\n");
+	appendHLSL(code, "\tif (u_pass == ", (u32)GPUParticlePass::FINALIZE, ") {\n");
+	appendHLSL(code, "\t\tif (thread_id.x == 0) {\n");
+	appendHLSL(code, "\t\t\tconst uint count = min(bindless_rw_buffers[u_state].Load(next * 4), u_capacity);\n");
+	appendHLSL(code, "\t\t\tbindless_rw_buffers[u_state].Store(next * 4, count);\n");
+	appendHLSL(code, "\t\t\tbindless_rw_buffers[u_state].Store(", ParticleSystem::GPUEmitter::INDIRECT_OFFSET + 4, ", count);\n");
+	appendHLSL(code, "\t\t}\n\t\treturn;\n\t}\n");
+
+	appendHLSL(code, "\tfloat k0 = u_time_delta;\n\tfloat k1 = u_total_time;\n\tfloat k2 = 0;\n");
+	appendHLSL(code, "\tuint seed = u_seed + thread_id.x * 1664525u;\n");
+	appendHLSL(code, "\tuint idx;\n");
+	for (u32 i = 0; i < channels_count; ++i) appendHLSL(code, "\tfloat c", i, " = 0;\n");
+	for (u32 i = 0; i < emitter.registers_count; ++i) appendHLSL(code, "\tfloat r", i, " = 0;\n");
+	for (u32 i = 0; i < outputs_count; ++i) appendHLSL(code, "\tfloat o", i, " = 0;\n");
+
+	auto storeChannels = [&](const char* buffer){
+		for (u32 i = 0; i < channels_count; ++i) {
+			appendHLSL(code, "\tbindless_rw_buffers[", buffer, "].Store((idx * ", channels_count, " + ", i, ") * 4, asuint(c", i, "));\n");
+		}
+	};
+
+	InputMemoryStream ip(emitter.instructions);
+
+	// emitted particles are appended to the current buffer, so they are updated in the same frame, same as on cpu
+	appendHLSL(code, "\tif (u_pass == ", (u32)GPUParticlePass::EMIT, ") {\n");
+	appendHLSL(code, "\tif (thread_id.x >= u_emit_count) return;\n");
+	appendHLSL(code, "\tbindless_rw_buffers[u_state].InterlockedAdd(u_current * 4, 1, idx);\n");
+	appendHLSL(code, "\tif (idx >= u_capacity) return;\n");
+	appendHLSL(code, "\tk1 = u_emit_time + thread_id.x * u_emit_time_step;\n");
+	appendHLSL(code, "\tk2 = float(u_emit_index + thread_id.x);\n");
+	ip.setPosition(emitter.emit_offset);
+	if (!generateHLSL(ip, code)) return false;
+	storeChannels("u_src");
+	appendHLSL(code, "\treturn;\n\t}\n");
+
+	appendHLSL(code, "\tif (thread_id.x >= min(bindless_rw_buffers[u_state].Load(u_current * 4), u_capacity)) return;\n");
+	for (u32 i = 0; i < channels_count; ++i) {
+		appendHLSL(code, "\tc", i, " = asfloat(bindless_rw_buffers[u_src].Load((thread_id.x * ", channels_count, " + ", i, ") * 4));\n");
+	}
+	// first 3 channels are position, see ParticleSystem::applyTransform
+	if (channels_count >= 3) {
+		appendHLSL(code, "\tif (u_world_space) {\n");
+		appendHLSL(code, "\t\tconst float3 p = rotate(u_delta_rot, float3(c0, c1, c2) * u_delta_scale.xyz) + u_delta_pos.xyz;\n");
+		appendHLSL(code, "\t\tc0 = p.x;\n\t\tc1 = p.y;\n\t\tc2 = p.z;\n\t}\n");
+	}
+	ip.setPosition(0);
+	if (!generateHLSL(ip, code)) return false;
+	appendHLSL(code, "\tbindless_rw_buffers[u_state].InterlockedAdd(next * 4, 1, idx);\n");
+	storeChannels("u_dst");
+
+	ip.setPosition(emitter.output_offset);
+	if (!generateHLSL(ip, code)) return false;
+	for (u32 i = 0; i < outputs_count; ++i) {
+		appendHLSL(code, "\tbindless_rw_buffers[u_instances].Store((idx * ", outputs_count, " + ", i, ") * 4, asuint(o", i, "));\n");
+	}
+	appendHLSL(code, "}\n");
+	return true;
+}
+
+// superinstructions - runs of the same elementwise instruction are executed in one pass over a chunk, see ProcessHelper::runFused
+// FUSED, instruction type, u8 count, count * (dst, args)
+static constexpr u32 MAX_FUSED_INSTRUCTIONS = 4;
+
+static u32 getFusableArgsCount(InstructionType type) {
+	switch (type) {
+		case InstructionType::ADD:
+		case InstructionType::SUB:
+		case InstructionType::MUL:
+		case InstructionType::DIV:
+			return 2;
+		case InstructionType::MULTIPLY_ADD:
+		case InstructionType::MIX:
+			return 3;
+		default: return 0;
+	}
+}
+
+static bool isFusable(const u8* ptr, const u8* end, InstructionType type, u32 args_count) {
+	if (ptr + sizeof(InstructionType) + sizeof(DataStream) * (args_count + 1) > end) return false;
+	if (*(const InstructionType*)ptr != type) return false;
+	ptr += sizeof(InstructionType);
+
+	DataStream dst;
+	memcpy(&dst, ptr, sizeof(dst));
+	if (dst.type != DataStream::CHANNEL && dst.type != DataStream::REGISTER) return false;
+
+	for (u32 i = 0; i < args_count; ++i) {
+		DataStream arg;
+		memcpy(&arg, ptr + sizeof(DataStream) * (i + 1), sizeof(arg));
+		switch (arg.type) {
+			case DataStream::CHANNEL:
+			case DataStream::REGISTER:
+			case DataStream::LITERAL:
+			case DataStream::CONST:
+				break;
+			default: return false;
+		}
+	}
+	return true;
+}
+
+// copies instruction, `type` is already read from `ip`
+static void copyInstruction(InstructionType type, InputMemoryStream& ip, OutputMemoryStream& out) {
+	out.write(type);
+	u32 size = 0;
+	switch (type) {
+		case InstructionType::END: break;
+		case InstructionType::KILL: size = sizeof(DataStream); break;
+		case InstructionType::COS:
+		case InstructionType::SIN:
+		case InstructionType::NOISE:
+		case InstructionType::SQRT:
+		case InstructionType::MOV:
+			size = sizeof(DataStream) * 2;
+			break;
+		case InstructionType::ADD:
+		case InstructionType::SUB:
+		case InstructionType::MUL:
+		case InstructionType::DIV:
+		case InstructionType::MOD:
+		case InstructionType::LT:
+		case InstructionType::GT:
+		case InstructionType::OR:
+		case InstructionType::AND:
+			size = sizeof(DataStream) * 3;
+			break;
+		case InstructionType::MULTIPLY_ADD:
+		case InstructionType::MIX:
+		case InstructionType::BLEND:
+			size = sizeof(DataStream) * 4;
+			break;
+		case InstructionType::RAND: size = sizeof(DataStream) + sizeof(float) * 2; break;
+		case InstructionType::SPLINE:
+		case InstructionType::MESH:
+			size = sizeof(DataStream) * 2 + sizeof(u8);
+			break;
+		case InstructionType::GRADIENT: {
+			out.write(ip.skip(sizeof(DataStream) * 2), sizeof(DataStream) * 2);
+			const u32 count = ip.read<u32>();
+			out.write(count);
+			size = sizeof(float) * 2 * count;
+			break;
+		}
+		case InstructionType::EMIT: {
+			// condition, emitter index and emit subroutine, which is run by ParticleSystem::run, so it's not fused
+			out.write(ip.skip(sizeof(DataStream) + sizeof(u32)), sizeof(DataStream) + sizeof(u32));
+			for (;;) {
+				const InstructionType sub_type = ip.read<InstructionType>();
+				copyInstruction(sub_type, ip, out);
+				if (sub_type == InstructionType::END || ip.hasOverflow()) break;
+			}
+			break;
+		}
+		case InstructionType::FUSED: ASSERT(false); break;
+	}
+	if (size > 0) out.write(ip.skip(size), size);
+}
+
+// fuses one program, up to END
+static void fuseProgram(InputMemoryStream& ip, OutputMemoryStream& out) {
+	const u8* end = (const u8*)ip.getData() + ip.size();
+	for (;;) {
+		const InstructionType type = ip.read<InstructionType>();
+		if (ip.hasOverflow()) return;
+
+		const u32 args_count = getFusableArgsCount(type);
+		const u8* start = (const u8*)ip.getData() + ip.getPosition() - sizeof(InstructionType);
+		const u32 instruction_size = sizeof(InstructionType) + sizeof(DataStream) * (args_count + 1);
+		u32 count = 0;
+		if (args_count > 0) {
+			while (count < MAX_FUSED_INSTRUCTIONS && isFusable(start + count * instruction_size, end, type, args_count)) ++count;
+		}
+
+		if (count < 2) {
+			copyInstruction(type, ip, out);
+			if (type == InstructionType::END) return;
+			continue;
+		}
+
+		out.write(InstructionType::FUSED);
+		out.write(type);
+		out.write(u8(count));
+		for (u32 i = 0; i < count; ++i) {
+			out.write(start + i * instruction_size + sizeof(InstructionType), instruction_size - sizeof(InstructionType));
+		}
+		ip.skip(count * instruction_size - sizeof(InstructionType));
+	}
+}
+
+void ParticleSystemResource::fuseInstructions(Emitter& emitter) {
+	emitter.fused_instructions.clear();
+	InputMemoryStream ip(emitter.instructions);
+	fuseProgram(ip, emitter.fused_instructions);
+	emitter.fused_output_offset = (u32)emitter.fused_instructions.size();
+	ip.setPosition(emitter.output_offset);
+	fuseProgram(ip, emitter.fused_instructions);
+}
+
+void ParticleSystemResource::destroyGPUProgram(Emitter& emitter) {
+	if (!emitter.gpu_program) return;
+	m_renderer.getEndFrameDrawStream().destroy(emitter.gpu_program);
+	emitter.gpu_program = gpu::INVALID_PROGRAM;
+}
+
+void ParticleSystemResource::createGPUProgram(Emitter& emitter) {
+	destroyGPUProgram(emitter);
+	if (!emitter.gpu_simulation) return;
+
+	// emit data from other emitters are on cpu
+	if (emitter.emit_inputs_count > 0) {
+		logWarning(getPath(), ": emitters emitted by other emitters can not be simulated on GPU, CPU is used");
+		return;
+	}
+
+	String code(m_allocator);
+	if (!generateGPUProgram(emitter, code)) {
+		logWarning(getPath(), ": emitter uses nodes not supported on GPU, CPU is used");
+		return;
+	}
+
+	emitter.gpu_program = gpu::allocProgramHandle();
+	const gpu::VertexDecl decl(gpu::PrimitiveType::NONE);
+	m_renderer.getDrawStream().createProgram(emitter.gpu_program, gpu::StateFlags::NONE, decl, code.c_str(), gpu::ShaderType::COMPUTE, nullptr, 0, getPath().c_str());
+}
+
 ParticleSystem::ParticleSystem(EntityPtr entity, World& world, IAllocator& allocator)
 	: m_allocator(allocator)
 	, m_world(world)
@@ -197,6 +651,8 @@ ParticleSystem::Emitter::Emitter(ParticleSystem::Emitter&& rhs)
 {
 	memcpy(channels, rhs.channels, sizeof(channels));
 	memset(rhs.channels, 0, sizeof(rhs.channels));
+	gpu = rhs.gpu;
+	rhs.gpu = {};
 }
 
 ParticleSystem::ParticleSystem(ParticleSystem&& rhs)
@@ -209,6 +665,14 @@ ParticleSystem::ParticleSystem(ParticleSystem&& rhs)
 	, m_total_time(rhs.m_total_time)
 	, m_prev_frame_transform(rhs.m_prev_frame_transform)
 	, m_last_update_stats(rhs.m_last_update_stats)
+	, m_update_policy(rhs.m_update_policy)
+	, m_throttle_distance(rhs.m_throttle_distance)
+	, m_offscreen_updates((i32)rhs.m_offscreen_updates)
+	, m_view_distance_squared(rhs.m_view_distance_squared)
+	, m_skipped_time(rhs.m_skipped_time)
+	, m_skipped_updates(rhs.m_skipped_updates)
+	, m_bounds_center(rhs.m_bounds_center)
+	, m_bounds_radius(rhs.m_bounds_radius)
 {
 	memcpy(m_constants, rhs.m_constants, sizeof(m_constants));
 	
@@ -228,15 +692,29 @@ ParticleSystem::~ParticleSystem()
 		for (const Channel& c : emitter.channels) {
 			m_allocator.deallocate(c.data);
 		}
+		destroyGPUEmitter(emitter);
 	}
 }
 
+void ParticleSystem::destroyGPUEmitter(Emitter& emitter) {
+	GPUEmitter& gpu = emitter.gpu;
+	if (!gpu.renderer) return;
+
+	DrawStream& stream = gpu.renderer->getEndFrameDrawStream();
+	stream.destroy(gpu.particles[0]);
+	stream.destroy(gpu.particles[1]);
+	stream.destroy(gpu.instances);
+	stream.destroy(gpu.state);
+	gpu = {};
+}
+
 void ParticleSystem::reset() {
 	m_total_time = 0;
 	for (Emitter& emitter : m_emitters) {
 		emitter.particles_count = 0;
 		emitter.emit_index = 0;
 		emitter.emit_timer = 0;
+		destroyGPUEmitter(emitter);
 	}
 }
 
@@ -246,6 +724,7 @@ void ParticleSystem::onResourceChanged(Resource::State old_state, Resource::Stat
 			for (Channel& c : emitter.channels) {
 				m_allocator.deallocate(c.data);
 			}
+			destroyGPUEmitter(emitter);
 		}
 		m_emitters.clear();
 		for (u32 i = 0, c = m_resource->getEmitters().size(); i < c; ++i) {
@@ -260,6 +739,7 @@ void ParticleSystem::onResourceChanged(Resource::State old_state, Resource::Stat
 			m_allocator.deallocate(c.data);
 			c.data = nullptr;
 		}
+		destroyGPUEmitter(emitter);
 	}
 }
 
@@ -326,6 +806,10 @@ void ParticleSystem::ensureCapacity(Emitter& emitter, u32 num_new_particles) {
 void ParticleSystem::emit(u32 emitter_idx, Span<const float> emit_data, u32 count, float time_step) {
 	Emitter& emitter = m_emitters[emitter_idx];
 	const ParticleSystemResource::Emitter& res_emitter = m_resource->getEmitters()[emitter_idx];
+	if (res_emitter.gpu_program) {
+		emitGPU(emitter, count, time_step);
+		return;
+	}
 	ensureCapacity(emitter, count);
 
 	RunningContext ctx(emitter, m_allocator);
@@ -349,16 +833,33 @@ void ParticleSystem::emit(u32 emitter_idx, Span<const float> emit_data, u32 coun
 	m_constants[1] = c1;
 }
 
+// particles are emitted in the next updateGPU
+void ParticleSystem::emitGPU(Emitter& emitter, u32 count, float time_step) {
+	GPUEmitter& gpu = emitter.gpu;
+	if (gpu.emit_count == 0) {
+		gpu.emit_index = emitter.emit_index;
+		gpu.emit_time = m_constants[1];
+		gpu.emit_time_step = time_step;
+	}
+	const u32 capacity = emitter.resource_emitter.gpu_capacity;
+	count = minimum(count, capacity - minimum(capacity, gpu.emit_count));
+	gpu.emit_count += count;
+	emitter.emit_index += count;
+	m_last_update_stats.emitted.add(count);
+}
+
 
 void ParticleSystem::serialize(OutputMemoryStream& blob) const
 {
 	blob.write(m_entity);
 	blob.write(m_autodestroy);
+	blob.write(m_update_policy);
+	blob.write(m_throttle_distance);
 	blob.writeString(m_resource ? m_resource->getPath().c_str() : "");
 }
 
 
-void ParticleSystem::deserialize(InputMemoryStream& blob, bool has_autodestroy, bool emit_rate_removed, ResourceManagerHub& manager)
+void ParticleSystem::deserialize(InputMemoryStream& blob, bool has_autodestroy, bool emit_rate_removed, bool has_update_policy, ResourceManagerHub& manager)
 {
 	blob.read(m_entity);
 	if (!emit_rate_removed) {
@@ -367,6 +868,10 @@ void ParticleSystem::deserialize(InputMemoryStream& blob, bool has_autodestroy,
 	}
 	m_autodestroy = false;
 	if (has_autodestroy) blob.read(m_autodestroy);
+	if (has_update_policy) {
+		blob.read(m_update_policy);
+		blob.read(m_throttle_distance);
+	}
 	const char* path = blob.readString();
 	auto* res = manager.load<ParticleSystemResource>(Path(path));
 	setResource(res);
@@ -397,12 +902,14 @@ struct ProcessHelper {
 		, reg_mem(reg_mem)
 	{}
 
-	static float4 madd(float4 a, float4 b, float4 c) {
-		return f4Add(f4Mul(a, b), c);
+	template <typename T>
+	static T madd(T a, T b, T c) {
+		return a * b + c;
 	}
 
-	static float4 mix(float4 a, float4 b, float4 c) {
-		return f4Add(a, f4Mul(f4Sub(b, a), c));
+	template <typename T>
+	static T mix(T a, T b, T c) {
+		return a + (b - a) * c;
 	}
 
 	template <auto F>
@@ -458,6 +965,7 @@ struct ProcessHelper {
 	float4** reg_mem;
 	float* out_mem = nullptr;
 
+	// each literal takes 2 float4s, so it can be loaded as float8
 	LUMIX_FORCE_INLINE void readArgs(InputMemoryStream& ip, Stream* s, float4* literals, u32 num_args) {
 		for (u32 i = 0; i < num_args; ++i) {
 			const DataStream stream = ip.read<DataStream>();;
@@ -468,14 +976,14 @@ struct ProcessHelper {
 				break;
 			}
 			case DataStream::LITERAL: {
-				literals[i] = f4Splat(stream.value);
-				s[i].data = &literals[i];
+				literals[i * 2] = literals[i * 2 + 1] = f4Splat(stream.value);
+				s[i].data = &literals[i * 2];
 				s[i].step = 0;
 				break;
 			}
 			case DataStream::CONST: {
-				literals[i] = f4Splat(emitter.system.m_constants[stream.index]);
-				s[i].data = &literals[i];
+				literals[i * 2] = literals[i * 2 + 1] = f4Splat(emitter.system.m_constants[stream.index]);
+				s[i].data = &literals[i * 2];
 				s[i].step = 0;
 				break;
 			}
@@ -489,11 +997,12 @@ struct ProcessHelper {
 		}
 	}
 
-	template <auto F>
+	// F is float4 version of op, F8 is float8 version used where the destination is contiguous
+	template <auto F, auto F8>
 	void run2(InputMemoryStream& ip) {
 		const DataStream dst = ip.read<DataStream>();
 		Stream s[2];
-		float4 literals[2];
+		float4 literals[4];
 
 		readArgs(ip, s, literals, 2);
 
@@ -518,18 +1027,22 @@ struct ProcessHelper {
 		else {
 			float4* result = getStream(emitter, dst, fromf4, reg_mem);
 			const float4* const end = result + stepf4;
+			const float4* const end8 = result + (stepf4 & ~1);
 
+			for (; result != end8; result += 2, arg0 += s[0].step * 2, arg1 += s[1].step * 2) {
+				f8StoreUnaligned(result, F8(f8LoadUnaligned(arg0), f8LoadUnaligned(arg1)));
+			}
 			for (; result != end; ++result, arg0 += s[0].step, arg1 += s[1].step) {
 				*result = F(*arg0, *arg1);
 			}
 		}
 	}
 
-	template <auto F>
+	template <auto F, auto F8>
 	void run3(InputMemoryStream& ip) {
 		const DataStream dst = ip.read<DataStream>();
 		Stream s[3];
-		float4 literals[3];
+		float4 literals[6];
 
 		readArgs(ip, s, literals, 3);
 
@@ -554,12 +1067,64 @@ struct ProcessHelper {
 		else {
 			float4* result = getStream(emitter, dst, fromf4, reg_mem);
 			const float4* const end = result + stepf4;
+			const float4* const end8 = result + (stepf4 & ~1);
 
+			for (; result != end8; result += 2, arg0 += s[0].step * 2, arg1 += s[1].step * 2, arg2 += s[2].step * 2) {
+				f8StoreUnaligned(result, F8(f8LoadUnaligned(arg0), f8LoadUnaligned(arg1), f8LoadUnaligned(arg2)));
+			}
 			for (; result != end; ++result, arg0 += s[0].step, arg1 += s[1].step, arg2 += s[2].step) {
 				*result = F(*arg0, *arg1, *arg2);
 			}
 		}
 	}
+
+	template <auto F, u32 ARGS_COUNT, u32 COUNT>
+	void runFused(InputMemoryStream& ip) {
+		float4* dst[COUNT];
+		Stream s[COUNT][ARGS_COUNT];
+		float4 literals[COUNT][ARGS_COUNT * 2];
+		for (u32 i = 0; i < COUNT; ++i) {
+			dst[i] = getStream(emitter, ip.read<DataStream>(), fromf4, reg_mem);
+			readArgs(ip, s[i], literals[i], ARGS_COUNT);
+		}
+
+		// instructions are elementwise, so executing all of them for each float4 gives the same result as executing them one by one
+		for (i32 j = 0; j < stepf4; ++j) {
+			for (u32 i = 0; i < COUNT; ++i) {
+				if constexpr (ARGS_COUNT == 2) {
+					dst[i][j] = F(s[i][0].data[j * s[i][0].step], s[i][1].data[j * s[i][1].step]);
+				}
+				else {
+					dst[i][j] = F(s[i][0].data[j * s[i][0].step], s[i][1].data[j * s[i][1].step], s[i][2].data[j * s[i][2].step]);
+				}
+			}
+		}
+	}
+
+	template <auto F, u32 ARGS_COUNT>
+	void runFused(InputMemoryStream& ip, u32 count) {
+		switch (count) {
+			case 2: runFused<F, ARGS_COUNT, 2>(ip); break;
+			case 3: runFused<F, ARGS_COUNT, 3>(ip); break;
+			case 4: runFused<F, ARGS_COUNT, 4>(ip); break;
+			default: ASSERT(false); break;
+		}
+	}
+
+	void runFused(InputMemoryStream& ip) {
+		static_assert(MAX_FUSED_INSTRUCTIONS == 4);
+		const InstructionType type = ip.read<InstructionType>();
+		const u32 count = ip.read<u8>();
+		switch (type) {
+			case InstructionType::ADD: runFused<f4Add, 2>(ip, count); break;
+			case InstructionType::SUB: runFused<f4Sub, 2>(ip, count); break;
+			case InstructionType::MUL: runFused<f4Mul, 2>(ip, count); break;
+			case InstructionType::DIV: runFused<f4Div, 2>(ip, count); break;
+			case InstructionType::MULTIPLY_ADD: runFused<madd<float4>, 3>(ip, count); break;
+			case InstructionType::MIX: runFused<mix<float4>, 3>(ip, count); break;
+			default: ASSERT(false); break;
+		}
+	}
 };
 
 
@@ -772,6 +1337,7 @@ void ParticleSystem::run(RunningContext& ctx) {
 			case InstructionType::BLEND:
 			case InstructionType::LT:
 			case InstructionType::GT:
+			case InstructionType::FUSED:
 				ASSERT(false);
 				break;
 		}
@@ -800,10 +1366,12 @@ struct ParticleSystem::ChunkProcessorContext {
 	i32 from;
 	float4* registers[16] = {};
 
+	// fused_instructions or instructions, offsets are different in each
+	const OutputMemoryStream* instructions = &emitter.resource_emitter.fused_instructions;
 	u32 instructions_offset = 0;
 	u32* kill_counter = nullptr;
-	jobs::Mutex* emit_mutex = nullptr;
-	OutputPagedStream* emit_stream = nullptr;
+	// one stream per chunk, created on the first emit, so chunks do not need to synchronize and emits are in deterministic order
+	OutputPagedStream** emit_streams = nullptr;
 	float time_delta = 0;
 	float* output_memory = nullptr;
 };
@@ -815,7 +1383,7 @@ void ParticleSystem::processChunk(ChunkProcessorContext& ctx) {
 	ParticleSystemResource::Emitter& res_emitter = emitter.resource_emitter;
 	const i32 fromf4 = from / 4;
 	const i32 stepf4 = minimum(1024, emitter.particles_count - from + 3) / 4;
-	InputMemoryStream ip = InputMemoryStream(res_emitter.instructions);
+	InputMemoryStream ip = InputMemoryStream(*ctx.instructions);
 	ip.skip(ctx.instructions_offset);
 	InstructionType itype = ip.read<InstructionType>();
 
@@ -858,6 +1426,7 @@ void ParticleSystem::processChunk(ChunkProcessorContext& ctx) {
 				const float4* cond = getStream(emitter, condition_stream, fromf4, ctx.registers);
 				const float4* const end = cond + stepf4;
 				RunningContext emit_ctx(emitter, m_allocator);
+				OutputPagedStream*& emit_stream = ctx.emit_streams[from / 1024];
 				for (const float4* beg = cond; cond != end; ++cond) {
 					const int m = f4MoveMask(*cond);
 					if (m) {
@@ -872,11 +1441,10 @@ void ParticleSystem::processChunk(ChunkProcessorContext& ctx) {
 								emit_ctx.outputs.resize(m_resource->getEmitters()[emitter_idx].emit_inputs_count);
 								run(emit_ctx);
 								
-								jobs::enter(ctx.emit_mutex);
-								ctx.emit_stream->write(emitter_idx);
-								ctx.emit_stream->write(emit_ctx.outputs.size());
-								ctx.emit_stream->write(emit_ctx.outputs.begin(), emit_ctx.outputs.byte_size());
-								jobs::exit(ctx.emit_mutex);
+								if (!emit_stream) emit_stream = LUMIX_NEW(m_allocator, OutputPagedStream)(ctx.page_allocator);
+								emit_stream->write(emitter_idx);
+								emit_stream->write(emit_ctx.outputs.size());
+								emit_stream->write(emit_ctx.outputs.begin(), emit_ctx.outputs.byte_size());
 							}
 						}
 					}
@@ -952,17 +1520,18 @@ void ParticleSystem::processChunk(ChunkProcessorContext& ctx) {
 				}
 				break;
 			}
-			case InstructionType::BLEND: op_helper.run3<f4Blend>(ip); break;
-			case InstructionType::LT: op_helper.run2<f4CmpLT>(ip); break;
-			case InstructionType::GT: op_helper.run2<f4CmpGT>(ip); break;
-			case InstructionType::MUL: op_helper.run2<f4Mul>(ip); break; 
-			case InstructionType::DIV: op_helper.run2<f4Div>(ip); break; 
-			case InstructionType::SUB: op_helper.run2<f4Sub>(ip); break; 
-			case InstructionType::AND: op_helper.run2<f4And>(ip); break; 
-			case InstructionType::OR: op_helper.run2<f4Or>(ip); break; 
-			case InstructionType::ADD: op_helper.run2<f4Add>(ip); break; 
-			case InstructionType::MIX: op_helper.run3<ProcessHelper::mix>(ip); break; 
-			case InstructionType::MULTIPLY_ADD: op_helper.run3<ProcessHelper::madd>(ip); break; 
+			case InstructionType::FUSED: op_helper.runFused(ip); break;
+			case InstructionType::BLEND: op_helper.run3<f4Blend, f8Blend>(ip); break;
+			case InstructionType::LT: op_helper.run2<f4CmpLT, f8CmpLT>(ip); break;
+			case InstructionType::GT: op_helper.run2<f4CmpGT, f8CmpGT>(ip); break;
+			case InstructionType::MUL: op_helper.run2<f4Mul, f8Mul>(ip); break; 
+			case InstructionType::DIV: op_helper.run2<f4Div, f8Div>(ip); break; 
+			case InstructionType::SUB: op_helper.run2<f4Sub, f8Sub>(ip); break; 
+			case InstructionType::AND: op_helper.run2<f4And, f8And>(ip); break; 
+			case InstructionType::OR: op_helper.run2<f4Or, f8Or>(ip); break; 
+			case InstructionType::ADD: op_helper.run2<f4Add, f8Add>(ip); break; 
+			case InstructionType::MIX: op_helper.run3<ProcessHelper::mix<float4>, ProcessHelper::mix<float8>>(ip); break; 
+			case InstructionType::MULTIPLY_ADD: op_helper.run3<ProcessHelper::madd<float4>, ProcessHelper::madd<float8>>(ip); break; 
 			case InstructionType::MOD: op_helper.run1<fmodf>(ip); break; 
 			case InstructionType::SQRT: op_helper.run1<sqrtf>(ip); break;
 			case InstructionType::COS: op_helper.run1<cosf>(ip); break;
@@ -1029,6 +1598,10 @@ void ParticleSystem::applyTransform(const Transform& new_tr) {
 	for (i32 emitter_idx = 0; emitter_idx < m_emitters.size(); ++emitter_idx) {
 		Emitter& emitter = m_emitters[emitter_idx];
 		if ((u32)m_resource->getFlags() & (u32)ParticleSystemResource::Flags::WORLD_SPACE) {
+			if (emitter.resource_emitter.gpu_program) {
+				emitter.gpu.delta_transform = delta_tr.compose(emitter.gpu.delta_transform);
+				continue;
+			}
 			jobs::forEach(emitter.particles_count, 4096, [&](u32 from, u32 to){
 				PROFILE_BLOCK("to world space");
 				// TODO make sure first 3 channels are position
@@ -1067,6 +1640,11 @@ void ParticleSystem::update(float dt, u32 emitter_idx, PageAllocator& page_alloc
 		}
 	}
 
+	if (res_emitter.gpu_program) {
+		emitter.gpu.time_delta += dt;
+		return;
+	}
+
 	if (emitter.particles_count == 0) return;
 
 	m_constants[1] = m_total_time;
@@ -1075,8 +1653,9 @@ void ParticleSystem::update(float dt, u32 emitter_idx, PageAllocator& page_alloc
 	const u32 chunks_count = (emitter.particles_count + 1023) / 1024;
 	ASSERT(chunks_count <= PageAllocator::PAGE_SIZE / sizeof(u32));
 	memset(kill_counter, 0, chunks_count * sizeof(u32));
-	OutputPagedStream emit_stream(page_allocator);
-	jobs::Mutex emit_mutex;
+	Array<OutputPagedStream*> emit_streams(m_allocator);
+	emit_streams.resize(chunks_count);
+	memset(emit_streams.begin(), 0, emit_streams.byte_size());
 
 	AtomicI32 counter = 0;
 	auto update = [&](){
@@ -1084,8 +1663,7 @@ void ParticleSystem::update(float dt, u32 emitter_idx, PageAllocator& page_alloc
 		
 		ChunkProcessorContext ctx(emitter, page_allocator);
 		ctx.kill_counter = kill_counter;
-		ctx.emit_mutex = &emit_mutex;
-		ctx.emit_stream = &emit_stream;
+		ctx.emit_streams = emit_streams.begin();
 		ctx.time_delta = dt;
 
 		u32 processed = 0;
@@ -1143,19 +1721,25 @@ void ParticleSystem::update(float dt, u32 emitter_idx, PageAllocator& page_alloc
 		page_allocator.deallocate(kill_counter);
 	}
 
-	InputPagedStream blob(emit_stream);
-	while (!blob.isEnd()) {
-		u32 emitter_idx = blob.read<u32>();
-		u32 outputs_count = blob.read<u32>();
-		float outputs[64];
-		ASSERT(outputs_count < lengthOf(outputs));
-		blob.read(outputs, outputs_count * sizeof(float));
-	
-		Emitter& dst_emitter = m_emitters[emitter_idx];
-			
-		PROFILE_BLOCK("emit from graph");
-		profiler::pushInt("count", dst_emitter.resource_emitter.init_emit_count);
-		emit(emitter_idx, Span(outputs, outputs_count), dst_emitter.resource_emitter.init_emit_count, 0);
+	// merge emits from all chunks in chunk order
+	for (OutputPagedStream* emit_stream : emit_streams) {
+		if (!emit_stream) continue;
+
+		InputPagedStream blob(*emit_stream);
+		while (!blob.isEnd()) {
+			u32 emitter_idx = blob.read<u32>();
+			u32 outputs_count = blob.read<u32>();
+			float outputs[64];
+			ASSERT(outputs_count < lengthOf(outputs));
+			blob.read(outputs, outputs_count * sizeof(float));
+		
+			Emitter& dst_emitter = m_emitters[emitter_idx];
+				
+			PROFILE_BLOCK("emit from graph");
+			profiler::pushInt("count", dst_emitter.resource_emitter.init_emit_count);
+			emit(emitter_idx, Span(outputs, outputs_count), dst_emitter.resource_emitter.init_emit_count, 0);
+		}
+		LUMIX_DELETE(m_allocator, emit_stream);
 	}
 }
 
@@ -1182,14 +1766,157 @@ bool ParticleSystem::update(float dt, PageAllocator& page_allocator)
 	for (i32 emitter_idx = 0; emitter_idx < m_emitters.size(); ++emitter_idx) {
 		update(dt, emitter_idx, page_allocator);
 	}
+	updateBounds();
 
+	// particle count of gpu emitters is not read back, so systems with gpu emitters are not autodestroyed
 	u32 c = 0;
 	for (const Emitter& emitter : m_emitters) {
 		c += emitter.particles_count;
+		if (emitter.resource_emitter.gpu_program) ++c;
 	}
 	return c == 0 && m_autodestroy;
 }
 
+bool ParticleSystem::hasGPUEmitters() const {
+	if (!m_resource || !m_resource->isReady()) return false;
+	for (const Emitter& emitter : m_emitters) {
+		if (emitter.resource_emitter.gpu_program) return true;
+	}
+	return false;
+}
+
+void ParticleSystem::updateGPU(Renderer& renderer) {
+	PROFILE_FUNCTION();
+	if (!m_resource || !m_resource->isReady()) return;
+
+	const bool world_space = (u32)m_resource->getFlags() & (u32)ParticleSystemResource::Flags::WORLD_SPACE;
+	DrawStream& stream = renderer.getDrawStream();
+	for (Emitter& emitter : m_emitters) {
+		const ParticleSystemResource::Emitter& res_emitter = emitter.resource_emitter;
+		if (!res_emitter.gpu_program) continue;
+
+		GPUEmitter& gpu = emitter.gpu;
+		if (gpu.time_delta == 0 && gpu.emit_count == 0) continue;
+
+		if (!gpu.renderer) {
+			gpu.renderer = &renderer;
+			gpu.capacity = res_emitter.gpu_capacity;
+			const u32 particles_size = gpu.capacity * res_emitter.channels_count * sizeof(float);
+			gpu.particles[0] = renderer.createBuffer({ particles_size, nullptr, false }, gpu::BufferFlags::SHADER_BUFFER, "particles");
+			gpu.particles[1] = renderer.createBuffer({ particles_size, nullptr, false }, gpu::BufferFlags::SHADER_BUFFER, "particles");
+			const u32 instances_size = gpu.capacity * res_emitter.outputs_count * sizeof(float);
+			gpu.instances = renderer.createBuffer({ instances_size, nullptr, false }, gpu::BufferFlags::SHADER_BUFFER, "particle_instances");
+			// counts, padding, indirect draw arguments - 4 vertices per particle
+			const u32 init_state[] = { 0, 0, 0, 0, 4, 0, 0, 0 };
+			static_assert(sizeof(init_state[0]) * 4 == GPUEmitter::INDIRECT_OFFSET);
+			gpu.state = renderer.createBuffer(renderer.copy(init_state, sizeof(init_state)), gpu::BufferFlags::SHADER_BUFFER, "particle_state");
+		}
+
+		// we do not know how many particles died, so we dispatch for all particles that can be alive
+		gpu.alive_upper_bound = minimum(gpu.capacity, gpu.alive_upper_bound + gpu.emit_count);
+
+		struct {
+			float time_delta;
+			float total_time;
+			float emit_time;
+			float emit_time_step;
+			Quat delta_rot;
+			Vec4 delta_pos;
+			Vec4 delta_scale;
+			GPUParticlePass pass;
+			u32 current;
+			u32 emit_count;
+			u32 emit_index;
+			u32 capacity;
+			u32 seed;
+			u32 world_space;
+			gpu::RWBindlessHandle src;
+			gpu::RWBindlessHandle dst;
+			gpu::RWBindlessHandle instances;
+			gpu::RWBindlessHandle state;
+		} ub = {
+			.time_delta = gpu.time_delta,
+			.total_time = m_total_time,
+			.emit_time = gpu.emit_time,
+			.emit_time_step = gpu.emit_time_step,
+			.delta_rot = gpu.delta_transform.rot,
+			.delta_pos = Vec4(Vec3(gpu.delta_transform.pos), 0),
+			.delta_scale = Vec4(gpu.delta_transform.scale, 0),
+			.pass = GPUParticlePass::PREPARE,
+			.current = gpu.current,
+			.emit_count = gpu.emit_count,
+			.emit_index = gpu.emit_index,
+			.capacity = gpu.capacity,
+			.seed = rand(),
+			.world_space = world_space ? 1u : 0u,
+			.src = gpu::getRWBindlessHandle(gpu.particles[gpu.current]),
+			.dst = gpu::getRWBindlessHandle(gpu.particles[1 - gpu.current]),
+			.instances = gpu::getRWBindlessHandle(gpu.instances),
+			.state = gpu::getRWBindlessHandle(gpu.state)
+		};
+
+		auto dispatch = [&](GPUParticlePass pass, u32 threads_count){
+			ub.pass = pass;
+			const Renderer::TransientSlice slice = renderer.allocUniform(&ub, sizeof(ub));
+			stream.bindUniformBuffer(UniformBuffer::DRAWCALL, slice.buffer, slice.offset, slice.size);
+			stream.dispatch((threads_count + 63) / 64, 1, 1);
+			stream.memoryBarrier(gpu.state);
+		};
+
+		stream.barrier(gpu.state, gpu::BarrierType::WRITE);
+		stream.barrier(gpu.particles[0], gpu::BarrierType::WRITE);
+		stream.barrier(gpu.particles[1], gpu::BarrierType::WRITE);
+		stream.barrier(gpu.instances, gpu::BarrierType::WRITE);
+		stream.useProgram(res_emitter.gpu_program);
+		dispatch(GPUParticlePass::PREPARE, 1);
+		if (gpu.emit_count > 0) {
+			dispatch(GPUParticlePass::EMIT, gpu.emit_count);
+			stream.memoryBarrier(gpu.particles[gpu.current]);
+		}
+		dispatch(GPUParticlePass::UPDATE, gpu.alive_upper_bound);
+		dispatch(GPUParticlePass::FINALIZE, 1);
+		stream.barrier(gpu.instances, gpu::BarrierType::READ);
+
+		gpu.current = 1 - gpu.current;
+		gpu.time_delta = 0;
+		gpu.emit_count = 0;
+		gpu.delta_transform = Transform::IDENTITY;
+	}
+}
+
+
+void ParticleSystem::updateBounds() {
+	PROFILE_FUNCTION();
+	// particle size is computed by output program, so we do not know it, this should be enough for common effects
+	static constexpr float SIZE_MARGIN = 2.f;
+	// positions of gpu particles are not read back
+	static constexpr float GPU_BOUNDS_RADIUS = 100.f;
+
+	Vec3 min(FLT_MAX);
+	Vec3 max(-FLT_MAX);
+	for (const Emitter& emitter : m_emitters) {
+		// first 3 channels are position, see applyTransform
+		const float* LUMIX_RESTRICT x = emitter.channels[0].data;
+		const float* LUMIX_RESTRICT y = emitter.channels[1].data;
+		const float* LUMIX_RESTRICT z = emitter.channels[2].data;
+		if (!x || !y || !z) continue;
+		for (u32 i = 0, c = emitter.particles_count; i < c; ++i) {
+			min = minimum(min, Vec3(x[i], y[i], z[i]));
+			max = maximum(max, Vec3(x[i], y[i], z[i]));
+		}
+	}
+
+	if (min.x > max.x) {
+		m_bounds_center = Vec3::ZERO;
+		m_bounds_radius = SIZE_MARGIN;
+	}
+	else {
+		m_bounds_center = (min + max) * 0.5f;
+		m_bounds_radius = length(max - min) * 0.5f + SIZE_MARGIN;
+	}
+	if (hasGPUEmitters()) m_bounds_radius = maximum(m_bounds_radius, length(m_bounds_center) + GPU_BOUNDS_RADIUS);
+}
+
 
 u32 ParticleSystem::Emitter::getParticlesDataSizeBytes() const {
 	return ((particles_count + 3) & ~3) * resource_emitter.outputs_count * sizeof(float);
@@ -1204,7 +1931,7 @@ void ParticleSystem::Emitter::fillInstanceData(float* data, PageAllocator& page_
 		PROFILE_BLOCK("fill particle gpu data");
 
 		ChunkProcessorContext ctx(*this, page_allocator);
-		ctx.instructions_offset = resource_emitter.output_offset;
+		ctx.instructions_offset = resource_emitter.fused_output_offset;
 		ctx.output_memory = data;
 
 		for (;;) {
@@ -1219,5 +1946,67 @@ void ParticleSystem::Emitter::fillInstanceData(float* data, PageAllocator& page_
 	else jobs::runOnWorkers(fill);
 }
 
+ParticleSystem::BenchmarkResult ParticleSystem::benchmark(u32 emitter_idx, u32 iterations, PageAllocator& page_allocator) const {
+	PROFILE_FUNCTION();
+	BenchmarkResult result;
+	const Emitter& emitter = m_emitters[emitter_idx];
+	ParticleSystemResource::Emitter& res_emitter = emitter.resource_emitter;
+	if (emitter.particles_count == 0 || emitter.gpu.renderer) return result;
+
+	// copy, so the benchmark does not change the simulation
+	Emitter tmp(emitter.system, res_emitter);
+	tmp.particles_count = emitter.particles_count;
+	tmp.capacity = emitter.capacity;
+	const u32 channels_size = emitter.capacity * sizeof(float);
+	for (u32 i = 0; i < res_emitter.channels_count; ++i) {
+		tmp.channels[i].data = (float*)m_allocator.allocate(channels_size, 16);
+	}
+	float* output_memory = (float*)m_allocator.allocate(emitter.getParticlesDataSizeBytes(), 16);
+	u32* kill_counter = (u32*)page_allocator.allocate();
+	const u32 chunks_count = (emitter.particles_count + 1023) / 1024;
+	Array<OutputPagedStream*> emit_streams(m_allocator);
+	emit_streams.resize(chunks_count);
+	memset(emit_streams.begin(), 0, emit_streams.byte_size());
+
+	auto measure = [&](bool fused) {
+		u64 ticks = 0;
+		for (u32 iter = 0; iter < iterations; ++iter) {
+			for (u32 i = 0; i < res_emitter.channels_count; ++i) {
+				memcpy(tmp.channels[i].data, emitter.channels[i].data, channels_size);
+			}
+
+			ChunkProcessorContext ctx(tmp, page_allocator);
+			ctx.instructions = fused ? &res_emitter.fused_instructions : &res_emitter.instructions;
+			ctx.kill_counter = kill_counter;
+			ctx.emit_streams = emit_streams.begin();
+			ctx.output_memory = output_memory;
+
+			const u64 start = os::Timer::getRawTimestamp();
+			for (ctx.from = 0; ctx.from < (i32)tmp.particles_count; ctx.from += 1024) {
+				ctx.instructions_offset = 0;
+				emitter.system.processChunk(ctx);
+				ctx.instructions_offset = fused ? res_emitter.fused_output_offset : res_emitter.output_offset;
+				emitter.system.processChunk(ctx);
+			}
+			ticks += os::Timer::getRawTimestamp() - start;
+		}
+		const float us = maximum(os::Timer::rawToSeconds(ticks) * 1e6f, 1e-3f);
+		return float(tmp.particles_count) * iterations / us;
+	};
+
+	result.interpreted = measure(false);
+	result.fused = measure(true);
+
+	for (OutputPagedStream* emit_stream : emit_streams) {
+		LUMIX_DELETE(m_allocator, emit_stream);
+	}
+	page_allocator.deallocate(kill_counter);
+	m_allocator.deallocate(output_memory);
+	for (u32 i = 0; i < res_emitter.channels_count; ++i) {
+		m_allocator.deallocate(tmp.channels[i].data);
+	}
+	return result;
+}
+
 
 } // namespace Lumix
\ No newline at end of file
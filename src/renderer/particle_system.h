@@ -4,6 +4,7 @@
 
 #include "core/array.h"
 #include "core/atomic.h"
+#include "core/crt.h"
 #include "core/math.h"
 #include "core/stream.h"
 
@@ -30,6 +31,7 @@ struct ParticleSystemResource final : Resource {
 		EMIT,
 		FLAGS,
 		NEW_VERTEX_DECL,
+		GPU_SIMULATION,
 
 		LAST
 	};
@@ -46,6 +48,9 @@ struct ParticleSystemResource final : Resource {
 		
 		ParticleSystemResource& resource;
 		OutputMemoryStream instructions;
+		// update and output programs with common instruction sequences fused to superinstructions, used by ParticleSystem::processChunk
+		OutputMemoryStream fused_instructions;
+		u32 fused_output_offset = 0;
 		u32 emit_offset;
 		u32 output_offset;
 		u32 channels_count;
@@ -56,6 +61,12 @@ struct ParticleSystemResource final : Resource {
 		u32 init_emit_count = 0;
 		float emit_per_second = 100;
 		gpu::VertexDecl vertex_decl;
+		// particles are simulated by a compute shader generated from `instructions`, see ParticleSystem::updateGPU
+		bool gpu_simulation = false;
+		// gpu buffers are not resized, particles over this limit are not emitted
+		u32 gpu_capacity = 64 * 1024;
+		// invalid if the emitter can not be simulated on gpu, it's simulated on cpu then
+		gpu::ProgramHandle gpu_program = gpu::INVALID_PROGRAM;
 	};
 	
 	struct DataStream {
@@ -106,7 +117,9 @@ struct ParticleSystemResource final : Resource {
 		MOD,
 		OR,
 		AND,
-		BLEND
+		BLEND,
+		// superinstruction, created at runtime, never saved
+		FUSED
 	};
 
 	static const ResourceType TYPE;
@@ -127,20 +140,38 @@ struct ParticleSystemResource final : Resource {
 		, u32 emit_inputs_count
 		, float emit_rate
 		, const Path& material
+		, bool gpu_simulation
+		, u32 gpu_capacity
 	);
 
 	Array<Emitter>& getEmitters() { return m_emitters; }
 	Flags getFlags() const { return m_flags; }
 
 private:
+	void fuseInstructions(Emitter& emitter);
+	void createGPUProgram(Emitter& emitter);
+	void destroyGPUProgram(Emitter& emitter);
+
 	Array<Emitter> m_emitters;
 	IAllocator& m_allocator;
+	Renderer& m_renderer;
 	Flags m_flags = Flags::NONE;
 };
 
 
 struct ResourceManagerHub;
 
+//@ enum
+enum class ParticleEmitterUpdatePolicy : u8 {
+	// simulated every update, even when not visible
+	ALWAYS,
+	// simulated at a reduced rate when off screen or far from camera
+	THROTTLE,
+	// not simulated when off screen, catches up when visible again; reduced rate when far from camera
+	PAUSE,
+
+	COUNT
+};
 
 struct LUMIX_RENDERER_API ParticleSystem {
 	struct Channel {
@@ -154,6 +185,36 @@ struct LUMIX_RENDERER_API ParticleSystem {
 		AtomicI32 processed = 0;
 	};
 
+	// state of gpu simulated emitter
+	struct GPUEmitter {
+		Renderer* renderer = nullptr;
+		// channels of particles, ping-ponged each update
+		gpu::BufferHandle particles[2] = { gpu::INVALID_BUFFER, gpu::INVALID_BUFFER };
+		// output of the output program, used as instance data
+		gpu::BufferHandle instances = gpu::INVALID_BUFFER;
+		// particle counts of both particle buffers followed by indirect draw arguments at INDIRECT_OFFSET
+		gpu::BufferHandle state = gpu::INVALID_BUFFER;
+		u32 current = 0;
+		u32 capacity = 0;
+		// particle count is not read back, we only know how many particles can be alive
+		u32 alive_upper_bound = 0;
+		// accumulated since the last dispatch
+		float time_delta = 0;
+		u32 emit_count = 0;
+		u32 emit_index = 0;
+		float emit_time = 0;
+		float emit_time_step = 0;
+		Transform delta_transform = Transform::IDENTITY;
+
+		static constexpr u32 INDIRECT_OFFSET = 16;
+	};
+
+	// throughput in particles per microsecond
+	struct BenchmarkResult {
+		float interpreted = 0;
+		float fused = 0;
+	};
+
 	struct Emitter {
 		Emitter(Emitter&& rhs);
 		Emitter(ParticleSystem& system, ParticleSystemResource::Emitter& resource_emitter) 
@@ -171,6 +232,7 @@ struct LUMIX_RENDERER_API ParticleSystem {
 		float emit_timer = 0;
 		u32 emit_index = 0;
 		Renderer::TransientSlice slice;
+		GPUEmitter gpu;
 	};
 
 	ParticleSystem(EntityPtr entity, struct World& world, IAllocator& allocator);
@@ -178,14 +240,22 @@ struct LUMIX_RENDERER_API ParticleSystem {
 	~ParticleSystem();
 
 	void serialize(OutputMemoryStream& blob) const;
-	void deserialize(InputMemoryStream& blob, bool has_autodestroy, bool emit_rate_removed, ResourceManagerHub& manager);
+	void deserialize(InputMemoryStream& blob, bool has_autodestroy, bool emit_rate_removed, bool has_update_policy, ResourceManagerHub& manager);
 	void applyTransform(const Transform& new_tr);
 	bool update(float dt, PageAllocator& page_allocator);
+	// dispatches simulation of gpu emitters, must be called on the main thread after update
+	void updateGPU(Renderer& renderer);
+	bool hasGPUEmitters() const;
+	// runs update and output programs on a copy of emitter's particles, with and without superinstructions, single threaded
+	BenchmarkResult benchmark(u32 emitter_idx, u32 iterations, PageAllocator& page_allocator) const;
 	ParticleSystemResource* getResource() const { return m_resource; }
 	void setResource(ParticleSystemResource* res);
 	const Emitter& getEmitter(u32 emitter_idx) const { return m_emitters[emitter_idx]; }
 	const Array<Emitter>& getEmitters() const { return m_emitters; }
 	void reset();
+	// bounds of particles' positions in entity space, enlarged by a margin for particle size, updated in update()
+	const Vec3& getBoundsCenter() const { return m_bounds_center; }
+	float getBoundsRadius() const { return m_bounds_radius; }
 
 	World& m_world;
 	EntityPtr m_entity;
@@ -193,6 +263,16 @@ struct LUMIX_RENDERER_API ParticleSystem {
 	float m_constants[16];
 	float m_total_time = 0;
 	Stats m_last_update_stats;
+	ParticleEmitterUpdatePolicy m_update_policy = ParticleEmitterUpdatePolicy::THROTTLE;
+	// systems rendered farther than this are simulated at a reduced rate, 0 = never
+	float m_throttle_distance = 0;
+	// updates since the system was rendered last time, reset by pipeline
+	mutable AtomicI32 m_offscreen_updates = 0;
+	// squared distance to the nearest camera which rendered the system since the last update, set by pipeline
+	mutable float m_view_distance_squared = FLT_MAX;
+	// time not simulated yet, because updates were skipped
+	float m_skipped_time = 0;
+	u32 m_skipped_updates = 0;
 
 private:
 	struct RunningContext;
@@ -205,11 +285,16 @@ private:
 	void ensureCapacity(Emitter& emitter, u32 num_new_particles);
 	void run(RunningContext& ctx);
 	void processChunk(ChunkProcessorContext& ctx);
+	void updateBounds();
+	void emitGPU(Emitter& emitter, u32 count, float time_step);
+	void destroyGPUEmitter(Emitter& emitter);
 
 	IAllocator& m_allocator;
 	Array<Emitter> m_emitters;
 	ParticleSystemResource* m_resource = nullptr;
 	Transform m_prev_frame_transform;
+	Vec3 m_bounds_center = Vec3::ZERO;
+	float m_bounds_radius = 0;
 };
 
 
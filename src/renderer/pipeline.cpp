@@ -49,6 +49,8 @@ static constexpr u64 SORT_KEY_INSTANCED_FLAG = (u64)1 << 55;
 static constexpr u64 SORT_KEY_INSTANCER_SHIFT = 16;
 static constexpr u64 SORT_KEY_MESH_IDX_SHIFT = 40;
 static constexpr u64 SORT_KEY_EMITTER_SHIFT = 40;
+// LODs per second, i.e. crossfade between two LODs takes 1 / LOD_CROSSFADE_SPEED seconds, keep in sync with instancing.hlsl
+static constexpr float LOD_CROSSFADE_SPEED = 4;
 
 namespace {
 
@@ -107,17 +109,36 @@ struct GlobalState {
 	gpu::BindlessHandle reflection_probes_bindless;
 };
 
+// which renderables are rendered in a view
+enum class CasterFilter : u8 {
+	ALL,
+	// meshes, instanced models, procedural geometry and terrains
+	STATIC,
+	// skinned meshes, fur and particles
+	DYNAMIC
+};
+
 struct ShadowAtlas {
 	static constexpr u32 SIZE = 2048;
 	
+	// what is cached in a slot
+	enum class Baked : u8 {
+		NONE,
+		// all casters, in `texture`
+		ALL,
+		// static casters, in `static_texture`, dynamic casters are rendered on top of it every frame
+		STATIC
+	};
+
 	ShadowAtlas(IAllocator& allocator)
 		: map(allocator)
 	{
-		for (EntityPtr& e : inv_map) e = INVALID_ENTITY;
+		clear();
 	}
 
 	void clear() {
 		for (EntityPtr& e : inv_map) e = INVALID_ENTITY;
+		for (Baked& b : baked) b = Baked::NONE;
 		map.clear();
 	}
 
@@ -157,6 +178,7 @@ struct ShadowAtlas {
 			if (!inv_map[i].isValid()) {
 				map.insert(e, i);
 				inv_map[i] = e;
+				baked[i] = Baked::NONE;
 				return i;
 			}
 		}
@@ -172,11 +194,136 @@ struct ShadowAtlas {
 	}
 
 	gpu::TextureHandle texture = gpu::INVALID_TEXTURE;
+	// same layout as `texture`, created when the first light with dynamic shadows is baked
+	gpu::TextureHandle static_texture = gpu::INVALID_TEXTURE;
 	HashMap<EntityRef, u32> map;
 	EntityPtr inv_map[64];
+	Baked baked[64];
+};
+
+// hierarchical depth of the main view, each texel contains the farthest depth of the area it covers
+// built at the end of opaque geometry and used to occlusion cull the next frame
+struct HiZ {
+	static constexpr u32 MAX_MIPS = 16;
+	// mips of this width or smaller are read back to CPU
+	static constexpr i32 MAX_CPU_WIDTH = 64;
+
+	RenderBufferHandle rb = INVALID_RENDERBUFFER;
+	IVec2 size = IVec2(0);
+	u32 mips = 0;
+	DVec3 camera_pos;
+	// relative to camera_pos
+	Matrix view_projection;
+};
+
+// CPU copy of hierarchical depth of the main view, used to occlusion cull CPU culling results
+struct HiZCPU {
+	HiZCPU(IAllocator& allocator) : depths(allocator) {}
+
+	// `pos` is absolute, sphere is occluded if it's behind all occluders in the area it covers
+	bool isOccluded(const DVec3& pos, float radius) const {
+		if (size.x == 0) return false;
+		const Vec3 rel_pos = Vec3(pos - camera_pos);
+		// camera is inside or too close to the sphere
+		if (squaredLength(rel_pos) < radius * radius * 4) return false;
+
+		Vec2 min(FLT_MAX), max(-FLT_MAX);
+		float max_depth = 0;
+		for (u32 i = 0; i < 8; ++i) {
+			const Vec3 corner = rel_pos + Vec3(i & 1 ? radius : -radius, i & 2 ? radius : -radius, i & 4 ? radius : -radius);
+			Vec4 p = view_projection * Vec4(corner, 1);
+			if (p.w <= 0) return false;
+			p = p / p.w;
+			const Vec2 uv(p.x * 0.5f + 0.5f, 0.5f - p.y * 0.5f);
+			min = minimum(min, uv);
+			max = maximum(max, uv);
+			max_depth = maximum(max_depth, p.z);
+		}
+		// not in the view, we don't know if it's occluded
+		if (max.x < 0 || max.y < 0 || min.x > 1 || min.y > 1) return false;
+
+		const i32 x0 = clamp(i32(min.x * size.x), 0, size.x - 1);
+		const i32 y0 = clamp(i32(min.y * size.y), 0, size.y - 1);
+		const i32 x1 = clamp(i32(max.x * size.x), 0, size.x - 1);
+		const i32 y1 = clamp(i32(max.y * size.y), 0, size.y - 1);
+		// too big on screen, it's probably visible, do not waste time
+		if ((x1 - x0 + 1) * (y1 - y0 + 1) > 64) return false;
+		for (i32 y = y0; y <= y1; ++y) {
+			for (i32 x = x0; x <= x1; ++x) {
+				// depth is reversed, so bigger is closer
+				if (depths[x + y * size.x] <= max_depth) return false;
+			}
+		}
+		return true;
+	}
+
+	Array<float> depths;
+	IVec2 size = IVec2(0);
+	DVec3 camera_pos;
+	// relative to camera_pos
+	Matrix view_projection;
+};
+
+// Hi-Z is read back to CPU with a few frames of latency, shared by the pipeline and pending reads
+struct HiZReadback {
+	HiZReadback(IAllocator& allocator) : allocator(allocator), latest(allocator) {}
+
+	// the last owner deletes the object
+	void release() {
+		bool destroy;
+		{
+			jobs::MutexGuard guard(mutex);
+			--refs;
+			destroy = refs == 0;
+		}
+		if (destroy) LUMIX_DELETE(allocator, this);
+	}
+
+	IAllocator& allocator;
+	jobs::Mutex mutex;
+	HiZCPU latest;
+	u32 latest_id = 0;
+	u32 refs = 1;
+};
+
+// bones of a skinned model instance in transient memory, see PipelineImpl::prepareSkinningPalettes
+struct SkinningPalette {
+	gpu::BindlessHandle buffer;
+	u32 offset;
+};
+
+struct HiZReadRequest {
+	// called on render thread
+	void callback(Span<const u8> data) {
+		if (data.length() == size.x * size.y * sizeof(float)) {
+			jobs::MutexGuard guard(readback->mutex);
+			if (id > readback->latest_id) {
+				HiZCPU& latest = readback->latest;
+				latest.depths.resize(size.x * size.y);
+				memcpy(latest.depths.begin(), data.begin(), data.length());
+				latest.size = size;
+				latest.camera_pos = camera_pos;
+				latest.view_projection = view_projection;
+				readback->latest_id = id;
+			}
+		}
+		HiZReadback* tmp = readback;
+		LUMIX_DELETE(tmp->allocator, this);
+		tmp->release();
+	}
+
+	HiZReadback* readback;
+	u32 id;
+	IVec2 size;
+	DVec3 camera_pos;
+	Matrix view_projection;
 };
 
 static const float SHADOW_CAM_FAR = 500.0f;
+// indirect draws of instanced models and GPU driven model instances in all views of a frame
+static constexpr u32 INDIRECT_BUFFER_SIZE = 1024 * 1024;
+// fur closer than this is rendered with all layers, number of layers decreases with distance after that
+static constexpr float FUR_FULL_LAYERS_DISTANCE = 10.f;
 
 } // anonymous namespace
 
@@ -185,9 +332,7 @@ struct PipelineImpl final : Pipeline {
 		Bucket(Renderer& renderer) 
 			: stream(renderer)
 		{
-			for (DrawStream*& s : substreams) {
-				s = &stream.createSubstream();
-			}
+			stream.createParallelSubstreams(lengthOf(substreams), substreams);
 		}
 
 		u8 layer;
@@ -346,7 +491,7 @@ struct PipelineImpl final : Pipeline {
 		
 		static_assert(sizeof(Page) == PageAllocator::PAGE_SIZE);
 
-		AutoInstancer(ArenaAllocator& allocator, PageAllocator& page_allocator)
+		AutoInstancer(FrameArena& allocator, PageAllocator& page_allocator)
 			: instances(allocator)
 			, page_allocator(page_allocator)
 		{
@@ -429,7 +574,7 @@ struct PipelineImpl final : Pipeline {
 	};
 	
 	struct View {
-		View(ArenaAllocator& allocator, PageAllocator& page_allocator) 
+		View(FrameArena& allocator, PageAllocator& page_allocator) 
 			: sorter(allocator, page_allocator)
 			, instancers(allocator)
 			, buckets(allocator)
@@ -449,6 +594,11 @@ struct PipelineImpl final : Pipeline {
 		CameraParams cp;
 		u8 layer_to_bucket[255];
 		jobs::Signal ready;
+		bool occlusion_culling = false;
+		CasterFilter caster_filter = CasterFilter::ALL;
+		// previous frame's depth pyramid, invalid bindless handle if not used by this view
+		gpu::BindlessHandle hiz_bindless;
+		HiZ hiz;
 	};
 
 	// converts float to u32 so it can be used in radix sort
@@ -480,21 +630,29 @@ struct PipelineImpl final : Pipeline {
 		, m_2D_decl(gpu::PrimitiveType::TRIANGLES)
 		, m_instance_data(m_allocator)
 		, m_material_override_refresh_queue(m_allocator)
+		, m_hiz_cpu(m_allocator)
+		, m_skinning_palettes(m_allocator)
 	{
 		m_viewport.w = m_viewport.h = 800;
 		ResourceManagerHub& rm = renderer.getEngine().getResourceManager();
 		m_tonemap_shader = rm.load<Shader>(Path("shaders/tonemap.hlsl"));
 		m_blit_shader = rm.load<Shader>(Path("shaders/blit.hlsl"));
+		m_upscale_shader = rm.load<Shader>(Path("shaders/upscale.hlsl"));
 		m_lighting_shader = rm.load<Shader>(Path("shaders/lighting.hlsl"));
 		m_draw2d_shader = rm.load<Shader>(Path("shaders/draw2d.hlsl"));
 		m_downscale_depth_shader = rm.load<Shader>(Path("shaders/downscale_depth.hlsl"));
+		m_hiz_shader = rm.load<Shader>(Path("shaders/hiz.hlsl"));
 		m_debug_shape_shader = rm.load<Shader>(Path("shaders/debug_shape.hlsl"));
 		m_debug_clusters_shader = rm.load<Shader>(Path("shaders/debug_clusters.hlsl"));
 		m_debug_velocity_shader = rm.load<Shader>(Path("shaders/debug_velocity.hlsl"));
 		m_instancing_shader = rm.load<Shader>(Path("shaders/instancing.hlsl"));
+		m_terrain_lod_shader = rm.load<Shader>(Path("shaders/terrain_lod.hlsl"));
 		m_flatten_shader = rm.load<Shader>(Path("shaders/flatten_cube.hlsl"));
+		m_shadow_composite_shader = rm.load<Shader>(Path("shaders/shadow_composite.hlsl"));
+		m_decal_shader = rm.load<Shader>(Path("shaders/decal.hlsl"));
 		
 		m_draw2d.clear({1, 1});
+		m_hiz_readback = LUMIX_NEW(m_allocator, HiZReadback)(m_allocator);
 
 		float cube_verts[] = {
 			-1, -1, -1,
@@ -527,7 +685,7 @@ struct PipelineImpl final : Pipeline {
 		const Renderer::MemRef ib_mem = m_renderer.copy(cube_indices, sizeof(cube_indices));
 		m_cube_ib = m_renderer.createBuffer(ib_mem, gpu::BufferFlags::IMMUTABLE, "cube_indices");
 
-		const Renderer::MemRef ind_mem = { 64 * 1024, nullptr, false }; // TODO size
+		const Renderer::MemRef ind_mem = { INDIRECT_BUFFER_SIZE, nullptr, false };
 		m_indirect_buffer = m_renderer.createBuffer(ind_mem, gpu::BufferFlags::SHADER_BUFFER, "indirect");
 
 		m_base_vertex_decl.addAttribute(0, 3, gpu::AttributeType::FLOAT, 0);
@@ -553,6 +711,7 @@ struct PipelineImpl final : Pipeline {
 		m_2D_decl.addAttribute(0, 2, gpu::AttributeType::FLOAT, 0);
 		m_2D_decl.addAttribute(8, 2, gpu::AttributeType::FLOAT, 0);
 		m_2D_decl.addAttribute(16, 4, gpu::AttributeType::U8, gpu::Attribute::NORMALIZED);
+		m_2D_decl.addAttribute(20, 2, gpu::AttributeType::U16, gpu::Attribute::AS_INT);
 
 		if (m_type == PipelineType::PREVIEW) m_clear_color = { 0.2f, 0.2f, 0.2f };
 	}
@@ -570,28 +729,40 @@ struct PipelineImpl final : Pipeline {
 
 		m_tonemap_shader->decRefCount();
 		m_blit_shader->decRefCount();
+		m_upscale_shader->decRefCount();
 		m_lighting_shader->decRefCount();
 		m_draw2d_shader->decRefCount();
 		m_downscale_depth_shader->decRefCount();
+		m_hiz_shader->decRefCount();
 		m_debug_shape_shader->decRefCount();
 		m_debug_clusters_shader->decRefCount();
 		m_debug_velocity_shader->decRefCount();
 		m_instancing_shader->decRefCount();
+		m_terrain_lod_shader->decRefCount();
 		m_flatten_shader->decRefCount();
+		m_shadow_composite_shader->decRefCount();
+		m_decal_shader->decRefCount();
 
 		stream.destroy(m_cube_ib);
 		stream.destroy(m_cube_vb);
 		stream.destroy(m_indirect_buffer);
 		stream.destroy(m_shadow_atlas.texture);
+		stream.destroy(m_shadow_atlas.static_texture);
 		stream.destroy(m_cluster_buffers.clusters.buffer);
 		stream.destroy(m_cluster_buffers.lights.buffer);
 		stream.destroy(m_cluster_buffers.maps.buffer);
 		stream.destroy(m_cluster_buffers.env_probes.buffer);
 		stream.destroy(m_cluster_buffers.refl_probes.buffer);
+		stream.destroy(m_cluster_buffers.decals.buffer);
 		
 		if (m_blit_screen_program) {
 			stream.destroy(m_blit_screen_program);
 		}
+
+		m_renderer.releaseRenderbuffer(m_hiz.rb);
+		m_renderer.releaseRenderbuffer(m_cached_shadowmap);
+		// pending reads keep it alive
+		m_hiz_readback->release();
 	}
 
 	const Viewport& getViewport() override {
@@ -605,16 +776,33 @@ struct PipelineImpl final : Pipeline {
 		m_viewport = viewport;
 		m_display_size.x = m_viewport.w;
 		m_display_size.y = m_viewport.h;
-		m_viewport.w = i32(m_viewport.w / m_render_to_display_scale);
-		m_viewport.h = i32(m_viewport.h / m_render_to_display_scale);
+		m_viewport.w = maximum(1, i32(m_viewport.w / m_render_to_display_scale));
+		m_viewport.h = maximum(1, i32(m_viewport.h / m_render_to_display_scale));
 		if (m_first_set_viewport) {
 			m_prev_viewport = viewport;
 			m_first_set_viewport = false;
 		}
 	}
 
+	// cached shadow camera still contains the whole camera frustum slice and the light did not rotate
+	bool isShadowCameraValid(const Viewport& vp, const Frustum& camera_frustum, const Vec3& light_forward) const {
+		if (dot(vp.rot.rotate(Vec3(0, 0, -1)), light_forward) < 0.9999f) return false;
+
+		const Quat inv_rot = vp.rot.conjugated();
+		const Vec3 offset = Vec3(m_viewport.pos - vp.pos);
+		for (const Vec3& point : camera_frustum.points) {
+			const Vec3 p = inv_rot.rotate(offset + point);
+			if (fabsf(p.x) > vp.ortho_size || fabsf(p.y) > vp.ortho_size) return false;
+			if (p.z > 0 || -p.z > vp.far) return false;
+		}
+		return true;
+	}
+
 	void prepareShadowCameras(GlobalState& global_state)
 	{
+		// the first cascade is updated every frame, the others round-robin, each one every 3rd frame
+		const bool lazy_cascades = m_renderer.isLazyShadowCascades();
+		const bool has_cached_cascades = lazy_cascades && m_cached_shadowmap != INVALID_RENDERBUFFER;
 		for (int slice = 0; slice < 4; ++slice) {
 			const int shadowmap_width = 1024;
 
@@ -667,9 +855,18 @@ struct PipelineImpl final : Pipeline {
 				max.y = maximum(max.y, proj.y);
 			}
 
-			const float ortho_size = maximum(max.x - min.x, max.y - min.y) * 0.5f;
-			Vec3 shadow_cam_pos = xvec * (max.x + min.x) * 0.5f;
-			shadow_cam_pos += yvec * (max.y + min.y) * 0.5f;
+			float ortho_size = maximum(max.x - min.x, max.y - min.y) * 0.5f;
+			// cached cascades must cover the camera for a few frames
+			if (lazy_cascades && slice > 0) ortho_size *= 1.1f;
+			
+			// snap to texels, so the shadow does not shimmer when camera moves
+			const double texel = 2.0 * ortho_size / shadowmap_width;
+			auto snap = [&](float rel, const Vec3& axis){
+				const double cam = axis.x * m_viewport.pos.x + axis.y * m_viewport.pos.y + axis.z * m_viewport.pos.z;
+				return float(floor((cam + rel) / texel) * texel - cam);
+			};
+			Vec3 shadow_cam_pos = xvec * snap((max.x + min.x) * 0.5f, xvec);
+			shadow_cam_pos += yvec * snap((max.y + min.y) * 0.5f, yvec);
 			shadow_cam_pos -= light_forward * (SHADOW_CAM_FAR - 2 * bb_size);
 			Matrix view_matrix;
 			view_matrix.lookAt(shadow_cam_pos, shadow_cam_pos + light_forward, yvec);
@@ -682,15 +879,24 @@ struct PipelineImpl final : Pipeline {
 				Vec4(0.5, 0.5, 0.0, 1.0));
 
 			Viewport& vp = m_shadow_camera_viewports[slice];
-			vp.is_ortho = true;
-			vp.w = shadowmap_width;
-			vp.h = shadowmap_width;
-			vp.ortho_size = ortho_size;
-			vp.pos = m_viewport.pos + shadow_cam_pos;
-			vp.rot = view_matrix.getRotation().conjugated();
-			vp.near = 0;
-			vp.far = SHADOW_CAM_FAR + 2 * bb_size;
+			const bool update = !has_cached_cascades
+				|| slice == 0
+				|| slice == i32(1 + m_renderer.frameNumber() % 3)
+				|| !isShadowCameraValid(vp, camera_frustum, light_forward);
+			m_shadow_slice_updated[slice] = update;
+			if (update) {
+				vp.is_ortho = true;
+				vp.w = shadowmap_width;
+				vp.h = shadowmap_width;
+				vp.ortho_size = ortho_size;
+				vp.pos = m_viewport.pos + shadow_cam_pos;
+				vp.rot = view_matrix.getRotation().conjugated();
+				vp.near = 0;
+				vp.far = SHADOW_CAM_FAR + 2 * bb_size;
+				m_shadow_slice_radius[slice] = bb_size;
+			}
 
+			// cached cascade is reprojected relative to the current camera
 			view_matrix = vp.getView(m_viewport.pos);
 
 			const Matrix projection_matrix = vp.getProjectionNoJitter();
@@ -699,7 +905,7 @@ struct PipelineImpl final : Pipeline {
 			global_state.sm_slices[slice].world_to_slice = Matrix4x3(m).transposed();
 			global_state.sm_slices[slice].size = shadowmap_width;
 			global_state.sm_slices[slice].rcp_size = 1.f / shadowmap_width;
-			global_state.sm_slices[slice].size_world = bb_size * 2;
+			global_state.sm_slices[slice].size_world = m_shadow_slice_radius[slice] * 2;
 			global_state.sm_slices[slice].texel_world = global_state.sm_slices[slice].size_world * global_state.sm_slices[slice].rcp_size;
 			global_state.shadow_cam_depth_range = SHADOW_CAM_FAR;
 			global_state.shadow_cam_rcp_depth_range = 1.f / SHADOW_CAM_FAR;
@@ -715,7 +921,8 @@ struct PipelineImpl final : Pipeline {
 		return {(float)atlas_texture->width, (float)atlas_texture->height};
 	}
 
-	bool bakeShadow(const PointLight& light, u32 atlas_idx) {
+	// renders `light`'s shadow into `atlas_idx` slot of `dst`, which has the same layout as shadow atlas
+	bool bakeShadow(const PointLight& light, u32 atlas_idx, CasterFilter caster_filter, gpu::TextureHandle dst) {
 		PROFILE_FUNCTION();
 		if (!m_flatten_shader->isReady()) return false;
 
@@ -765,13 +972,12 @@ struct PipelineImpl final : Pipeline {
 				CameraParams cp = getMainCamera();
 				pass(cp);
 
-				u32 view_idx = cull(cp, bucket);
+				u32 view_idx = cull(cp, bucket, false, caster_filter);
 				renderBucket(view_idx, 0);
-				renderTerrains(cp, gpu::StateFlags::NONE, "DEPTH");
+				if (caster_filter != CasterFilter::DYNAMIC) renderTerrains(cp, gpu::StateFlags::NONE, "DEPTH");
 
 				// copy into atlas
 				const gpu::TextureHandle src = m_renderer.toTexture(depthbuf);
-				const gpu::TextureHandle dst = m_shadow_atlas.texture;
 				stream.barrier(dst, gpu::BarrierType::WRITE);
 
 				struct UBData {
@@ -828,12 +1034,11 @@ struct PipelineImpl final : Pipeline {
 			CameraParams cp = getMainCamera();
 			pass(cp);
 
-			u32 view_idx = cull(cp, bucket);
+			u32 view_idx = cull(cp, bucket, false, caster_filter);
 			renderBucket(view_idx, 0);
-			renderTerrains(cp, gpu::StateFlags::NONE, "DEPTH");
+			if (caster_filter != CasterFilter::DYNAMIC) renderTerrains(cp, gpu::StateFlags::NONE, "DEPTH");
 			
 			const gpu::TextureHandle src = m_renderer.toTexture(depthbuf);
-			const gpu::TextureHandle dst = m_shadow_atlas.texture;
 			const u32 x = u32(ShadowAtlas::SIZE * uv.x + 0.5f);
 			const u32 y = u32(ShadowAtlas::SIZE * uv.y + 0.5f);
 			m_renderer.getDrawStream().copy(dst, src, x, y);
@@ -844,6 +1049,38 @@ struct PipelineImpl final : Pipeline {
 		return true;
 	}
 
+	// dynamic casters were rendered into `atlas_idx` slot of shadow atlas, add cached static casters
+	void compositeShadow(u32 atlas_idx) {
+		if (!m_shadow_composite_shader->isReady()) return;
+
+		DrawStream& stream = m_renderer.getDrawStream();
+		const Vec4 uv = ShadowAtlas::getUV(atlas_idx);
+		struct {
+			u32 x;
+			u32 y;
+			u32 w;
+			u32 h;
+			gpu::BindlessHandle src;
+			gpu::RWBindlessHandle dst;
+		} ub = {
+			.x = u32(ShadowAtlas::SIZE * uv.x + 0.5f),
+			.y = u32(ShadowAtlas::SIZE * uv.y + 0.5f),
+			.w = u32(ShadowAtlas::SIZE * uv.z + 0.5f),
+			.h = u32(ShadowAtlas::SIZE * uv.w + 0.5f),
+			.src = gpu::getBindlessHandle(m_shadow_atlas.static_texture),
+			.dst = gpu::getRWBindlessHandle(m_shadow_atlas.texture)
+		};
+
+		stream.barrier(m_shadow_atlas.static_texture, gpu::BarrierType::READ);
+		stream.barrier(m_shadow_atlas.texture, gpu::BarrierType::WRITE);
+		const Renderer::TransientSlice ub_mem = m_renderer.allocUniform(&ub, sizeof(ub));
+		stream.bindUniformBuffer(UniformBuffer::DRAWCALL, ub_mem.buffer, ub_mem.offset, ub_mem.size);
+		stream.useProgram(m_shadow_composite_shader->getProgram(0));
+		stream.dispatch((ub.w + 15) / 16, (ub.h + 15) / 16, 1);
+		// static texture is written by copy or compute in the next bake
+		stream.barrier(m_shadow_atlas.static_texture, gpu::BarrierType::WRITE);
+	}
+
 	void render3DUI(EntityRef e, const Draw2D& drawdata, Vec2 canvas_size, bool orient_to_cam) override {
 		Matrix matrix = m_module->getWorld().getRelativeMatrix(e, m_viewport.pos);
 		Matrix normalize(
@@ -875,12 +1112,24 @@ struct PipelineImpl final : Pipeline {
 	}
 
 	u32 cull(const CameraParams& cp, Span<const BucketDesc> buckets) override {
+		return cull(cp, buckets, false);
+	}
+
+	// `occlusion_culling` - results are tested against the previous frame's depth, only for views similar to the main camera
+	// `caster_filter` - only these renderables are rendered, used to bake static and dynamic shadows separately
+	u32 cull(const CameraParams& cp, Span<const BucketDesc> buckets, bool occlusion_culling, CasterFilter caster_filter = CasterFilter::ALL) {
 		PROFILE_FUNCTION();
 
 		UniquePtr<View>& view = m_views.emplace();
-		ArenaAllocator& allocator = m_renderer.getCurrentFrameAllocator();
+		FrameArena& allocator = m_renderer.getCurrentFrameAllocator();
 		view = UniquePtr<View>::create(allocator, allocator, m_renderer.getEngine().getPageAllocator());
 		view->cp = cp;
+		view->occlusion_culling = occlusion_culling;
+		view->caster_filter = caster_filter;
+		if (occlusion_culling && m_hiz.rb != INVALID_RENDERBUFFER) {
+			view->hiz = m_hiz;
+			view->hiz_bindless = gpu::getBindlessHandle(m_renderer.toTexture(m_hiz.rb));
+		}
 		memset(view->layer_to_bucket, 0xff, sizeof(view->layer_to_bucket));
 
 		view->buckets.reserve(buckets.length());
@@ -908,17 +1157,24 @@ struct PipelineImpl final : Pipeline {
 					m_module->initInstancedModelGPUData(iter.key());
 				}
 			}
+			const HashMap<Model*, GPUDrivenModel>& gpu_driven_models = m_module->getGPUDrivenModels();
+			for (auto iter = gpu_driven_models.begin(), end = gpu_driven_models.end(); iter != end; ++iter) {
+				if (iter.value().im.dirty) {
+					m_module->initGPUDrivenModelGPUData(iter.key());
+				}
+			}
 		}
 
 		View* view_ptr = view.get();
 		jobs::turnRed(&view->ready);
 		m_renderer.pushJob("prepare view", [this, view_ptr](DrawStream& stream) {
-			setupFur(*view_ptr);
-			setupParticles(*view_ptr);
-			encodeInstancedModels(stream, *view_ptr);
-			encodeProceduralGeometry(*view_ptr);
+			if (view_ptr->caster_filter != CasterFilter::STATIC) setupParticles(*view_ptr);
+			if (view_ptr->caster_filter != CasterFilter::DYNAMIC) {
+				encodeInstancedModels(stream, *view_ptr);
+				encodeProceduralGeometry(*view_ptr);
+			}
 
-			view_ptr->renderables = m_module->getRenderables(view_ptr->cp.frustum);
+			view_ptr->renderables = m_module->getRenderables(view_ptr->cp.frustum, m_viewport.pos);
 
 			if (view_ptr->renderables) {
 				createSortKeys(*view_ptr);
@@ -927,7 +1183,9 @@ struct PipelineImpl final : Pipeline {
 			view_ptr->sorter.pack();
 
 			if (!view_ptr->sorter.keys.empty()) {
-				radixSort(view_ptr->sorter.keys.begin(), view_ptr->sorter.values.begin(), view_ptr->sorter.keys.size());
+				PROFILE_BLOCK("sort");
+				profiler::pushInt("count", view_ptr->sorter.keys.size());
+				radixSort(view_ptr->sorter.keys.begin(), view_ptr->sorter.values.begin(), view_ptr->sorter.keys.size(), m_allocator);
 				createCommands(*view_ptr);
 			}
 
@@ -1085,6 +1343,49 @@ struct PipelineImpl final : Pipeline {
 		return cp;
 	}
 
+	// only cascades updated in prepareShadowCameras are rendered, the others are kept from previous frames
+	RenderBufferHandle lazyShadowPass(Span<const BucketDesc> buckets) {
+		DrawStream& stream = m_renderer.getDrawStream();
+		if (m_cached_shadowmap == INVALID_RENDERBUFFER) {
+			m_cached_shadowmap = m_renderer.createRenderbuffer({
+				.size = {4096, 1024},
+				.format = gpu::TextureFormat::D32,
+				.debug_name = "cached_shadowmap"
+			});
+		}
+		const RenderBufferHandle slice_rb = m_renderer.createRenderbuffer({
+			.size = {1024, 1024},
+			.format = gpu::TextureFormat::D32,
+			.debug_name = "shadowmap_slice"
+		});
+
+		for (u32 slice = 0; slice < 4; ++slice) {
+			if (!m_shadow_slice_updated[slice]) continue;
+
+			PROFILE_BLOCK("slice");
+			CameraParams view_params = getShadowCamera(slice);
+			m_renderer.setRenderTargets({}, slice_rb);
+			clear(gpu::ClearFlags::DEPTH, 0, 0, 0, 0, 0);
+			pass(view_params);
+
+			u32 shadow_view = cull(view_params, buckets);
+
+			renderBucket(shadow_view, 0);
+			renderBucket(shadow_view, 1);
+
+			const u32 grass_depth_defines = 1 << m_renderer.getShaderDefineIdx("GRASS") | 1 << m_renderer.getShaderDefineIdx("DEPTH");
+			const gpu::StateFlags shadow_state = gpu::StateFlags::DEPTH_FUNCTION | gpu::StateFlags::DEPTH_WRITE | gpu::StateFlags::CULL_BACK;
+			renderGrass(view_params, shadow_state, grass_depth_defines);
+			renderTerrains(view_params, shadow_state, "DEPTH");
+
+			stream.copy(m_renderer.toTexture(m_cached_shadowmap), m_renderer.toTexture(slice_rb), slice * 1024, 0);
+		}
+		m_renderer.releaseRenderbuffer(slice_rb);
+		endBlock();
+		stream.barrier(m_renderer.toTexture(m_cached_shadowmap), gpu::BarrierType::READ);
+		return m_cached_shadowmap;
+	}
+
 	RenderBufferHandle shadowPass() {
 		PROFILE_FUNCTION();
 		beginBlock("shadow pass", true);
@@ -1102,6 +1403,8 @@ struct PipelineImpl final : Pipeline {
 		}
 
 		if (!cast_shadows) {
+			m_renderer.releaseRenderbuffer(m_cached_shadowmap);
+			m_cached_shadowmap = INVALID_RENDERBUFFER;
 			const RenderBufferHandle shadowmap_rb = m_renderer.createRenderbuffer({
 				.size = {1, 1},
 				.format = gpu::TextureFormat::D32,
@@ -1114,6 +1417,8 @@ struct PipelineImpl final : Pipeline {
 			return shadowmap_rb;
 		}
 
+		if (m_renderer.isLazyShadowCascades()) return lazyShadowPass(Span(buckets));
+
 		const RenderBufferHandle shadowmap_rb = m_renderer.createRenderbuffer({
 			.size = {4096, 1024},
 			.format = gpu::TextureFormat::D32,
@@ -1191,11 +1496,11 @@ struct PipelineImpl final : Pipeline {
 			},
 		};
 
-		view_idx = cull(cp, buckets);
+		view_idx = cull(cp, buckets, true);
 		const gpu::StateFlags terrain_state = gpu::StateFlags::DEPTH_WRITE 
 			| gpu::StateFlags::DEPTH_FUNCTION 
 			| gpu::getStencilStateBits(0xff, gpu::StencilFuncs::ALWAYS, 2, 0xff, gpu::StencilOps::KEEP, gpu::StencilOps::KEEP, gpu::StencilOps::REPLACE);
-		renderTerrains(cp, terrain_state, "DEFERRED");
+		renderTerrains(cp, terrain_state, "DEFERRED", m_views[view_idx].get());
 		renderBucket(view_idx, 0);
 		renderBucket(view_idx, 4);
 		renderGrass(cp, default_state);
@@ -1205,10 +1510,15 @@ struct PipelineImpl final : Pipeline {
 		}
 		endBlock();
 
+		buildHiZ(gbuffer.DS, cp);
 
 		beginBlock("decals");
 		m_renderer.setRenderTargets(Span(gbuffer_rbs), gbuffer.DS, gpu::FramebufferFlags::READONLY_DEPTH_STENCIL);
 		setUniform(toBindless(gbuffer.DS, stream));
+		if (m_clustered_decals_count > 0) {
+			const gpu::StateFlags decal_state = gpu::getBlendStateBits(gpu::BlendFactors::SRC_ALPHA, gpu::BlendFactors::ONE_MINUS_SRC_ALPHA, gpu::BlendFactors::SRC_ALPHA, gpu::BlendFactors::ONE_MINUS_SRC_ALPHA);
+			drawArray(0, 3, *m_decal_shader, 1 << m_renderer.getShaderDefineIdx("CLUSTERED"), decal_state);
+		}
 		renderBucket(view_idx, 3);
 		endBlock();
 
@@ -1388,6 +1698,100 @@ struct PipelineImpl final : Pipeline {
 		return gpu::getBindlessHandle(tex);
 	}
 
+	void buildHiZ(RenderBufferHandle depth_buffer, const CameraParams& cp) {
+		if (!m_renderer.isOcclusionCulling() || !m_hiz_shader->isReady()) return;
+		PROFILE_FUNCTION();
+
+		// power of two, so each texel of a mip covers exactly 2x2 texels of the previous mip
+		IVec2 size(1);
+		while (size.x * 2 <= (i32)m_viewport.w) size.x *= 2;
+		while (size.y * 2 <= (i32)m_viewport.h) size.y *= 2;
+		if (m_hiz.rb != INVALID_RENDERBUFFER && m_hiz.size != size) {
+			m_renderer.releaseRenderbuffer(m_hiz.rb);
+			m_hiz.rb = INVALID_RENDERBUFFER;
+		}
+		if (m_hiz.rb == INVALID_RENDERBUFFER) {
+			m_hiz.rb = m_renderer.createRenderbuffer({
+				.size = size,
+				.format = gpu::TextureFormat::R32F,
+				.flags = gpu::TextureFlags::COMPUTE_WRITE,
+				.debug_name = "hiz"
+			});
+		}
+		m_hiz.size = size;
+		m_hiz.mips = 1;
+		while (m_hiz.mips < HiZ::MAX_MIPS && (maximum(size.x, size.y) >> m_hiz.mips) > 0) ++m_hiz.mips;
+		m_hiz.camera_pos = cp.pos;
+		m_hiz.view_projection = cp.projection * cp.view;
+
+		DrawStream& stream = m_renderer.getDrawStream();
+		DrawStream& end_frame_stream = m_renderer.getEndFrameDrawStream();
+		stream.beginProfileBlock("hiz", 0, false);
+		gpu::TextureHandle tex = m_renderer.toTexture(m_hiz.rb);
+		gpu::TextureHandle mip_views[HiZ::MAX_MIPS];
+		for (u32 i = 0; i < m_hiz.mips; ++i) {
+			mip_views[i] = gpu::allocTextureHandle();
+			stream.createTextureView(mip_views[i], tex, 0, i);
+			end_frame_stream.destroy(mip_views[i]);
+		}
+
+		struct {
+			IVec2 src_size;
+			IVec2 dst_size;
+			u32 input;
+			gpu::RWBindlessHandle output;
+		} udata;
+
+		stream.barrier(tex, gpu::BarrierType::WRITE);
+		IVec2 src_size(m_viewport.w, m_viewport.h);
+		u32 cpu_mip = m_hiz.mips - 1;
+		for (u32 i = 0; i < m_hiz.mips; ++i) {
+			const IVec2 dst_size(maximum(size.x >> i, 1), maximum(size.y >> i, 1));
+			if (dst_size.x <= HiZ::MAX_CPU_WIDTH && cpu_mip > i) cpu_mip = i;
+			udata.src_size = src_size;
+			udata.dst_size = dst_size;
+			udata.input = i == 0 ? toBindless(depth_buffer, stream).value : gpu::getRWBindlessHandle(mip_views[i - 1]).value;
+			udata.output = gpu::getRWBindlessHandle(mip_views[i]);
+			setUniform(udata);
+			dispatch(*m_hiz_shader, (dst_size.x + 7) / 8, (dst_size.y + 7) / 8, 1, i == 0 ? "FROM_DEPTH" : nullptr);
+			stream.memoryBarrier(tex);
+			src_size = dst_size;
+		}
+
+		// copy of a small mip is read back to CPU, it's available a few frames later
+		const IVec2 cpu_size(maximum(size.x >> cpu_mip, 1), maximum(size.y >> cpu_mip, 1));
+		const RenderBufferHandle cpu_rb = m_renderer.createRenderbuffer({
+			.size = cpu_size,
+			.format = gpu::TextureFormat::R32F,
+			.flags = gpu::TextureFlags::COMPUTE_WRITE | gpu::TextureFlags::NO_MIPS,
+			.debug_name = "hiz_cpu"
+		});
+		gpu::TextureHandle cpu_tex = m_renderer.toTexture(cpu_rb);
+		stream.barrier(cpu_tex, gpu::BarrierType::WRITE);
+		udata.src_size = cpu_size;
+		udata.dst_size = cpu_size;
+		udata.input = gpu::getRWBindlessHandle(mip_views[cpu_mip]).value;
+		udata.output = gpu::getRWBindlessHandle(cpu_tex);
+		setUniform(udata);
+		dispatch(*m_hiz_shader, (cpu_size.x + 7) / 8, (cpu_size.y + 7) / 8, 1);
+
+		HiZReadRequest* request = LUMIX_NEW(m_allocator, HiZReadRequest);
+		{
+			jobs::MutexGuard guard(m_hiz_readback->mutex);
+			++m_hiz_readback->refs;
+		}
+		request->readback = m_hiz_readback;
+		request->id = ++m_hiz_read_id;
+		request->size = cpu_size;
+		request->camera_pos = m_hiz.camera_pos;
+		request->view_projection = m_hiz.view_projection;
+		stream.readTexture(cpu_tex, makeDelegate<&HiZReadRequest::callback>(request));
+		m_renderer.releaseRenderbuffer(cpu_rb);
+
+		stream.barrier(tex, gpu::BarrierType::READ);
+		stream.endProfileBlock();
+	}
+
 	RenderBufferHandle getDownscaledDepth(RenderBufferHandle depth_buffer) override {
 		if (m_downscaled_depth != INVALID_RENDERBUFFER) return m_downscaled_depth;
 		if (!m_downscale_depth_shader->isReady()) return INVALID_RENDERBUFFER;
@@ -1443,6 +1847,32 @@ struct PipelineImpl final : Pipeline {
 		return gpu::getRWBindlessHandle(tex);
 	}
 
+	// bilinear upscale from internal to display resolution
+	RenderBufferHandle upscale(RenderBufferHandle input) {
+		beginBlock("upscale");
+		const RenderBufferHandle rb = m_renderer.createRenderbuffer({
+			.size = m_display_size,
+			.format = gpu::TextureFormat::RGBA16F,
+			.flags = gpu::TextureFlags::NO_MIPS | gpu::TextureFlags::COMPUTE_WRITE,
+			.debug_name = "upscaled"
+		});
+		DrawStream& stream = m_renderer.getDrawStream();
+		struct {
+			Vec2 rcp_size;
+			gpu::BindlessHandle input;
+			gpu::RWBindlessHandle output;
+		} ubdata = {
+			Vec2(1.f / m_display_size.x, 1.f / m_display_size.y),
+			toBindless(input, stream),
+			toRWBindless(rb, stream)
+		};
+		setUniform(ubdata);
+		dispatch(*m_upscale_shader, (m_display_size.x + 15) / 16, (m_display_size.y + 15) / 16, 1);
+		m_renderer.releaseRenderbuffer(input);
+		endBlock();
+		return rb;
+	}
+
 	void render2DOnly() {
 		m_renderer.releaseRenderbuffer(m_output);
 		const RenderBufferHandle rb = m_renderer.createRenderbuffer({
@@ -1486,13 +1916,26 @@ struct PipelineImpl final : Pipeline {
 			return;
 		}
 
+		bool upscaled = false;
 		for (RenderPlugin* plugin : m_renderer.getPlugins()) {
 			RenderBufferHandle rb = plugin->renderAA(gbuffer, result, *this);
 			if (rb != INVALID_RENDERBUFFER) {
 				result = rb;
+				upscaled = true;
 				break;
 			}
 		}
+		if (m_viewport.w != m_display_size.x || m_viewport.h != m_display_size.y) {
+			// no AA plugin to upscale the result
+			if (!upscaled) result = upscale(result);
+			// everything after AA is in display resolution
+			m_viewport.w = m_display_size.x;
+			m_viewport.h = m_display_size.y;
+			m_global_state.framebuffer_size = m_display_size;
+			m_global_state.rcp_framebuffer_size = Vec2(1.f / m_display_size.x, 1.f / m_display_size.y);
+			Renderer::TransientSlice display_gsb = m_renderer.allocUniform(&m_global_state, sizeof(GlobalState));
+			stream.bindUniformBuffer(UniformBuffer::GLOBAL, display_gsb.buffer, display_gsb.offset, sizeof(GlobalState));
+		}
 		
 		render2D(result);
 
@@ -1515,7 +1958,7 @@ struct PipelineImpl final : Pipeline {
 		m_renderer.releaseRenderbuffer(gbuffer.C);
 		m_renderer.releaseRenderbuffer(gbuffer.D);
 		m_renderer.releaseRenderbuffer(gbuffer.DS);
-		m_renderer.releaseRenderbuffer(shadowmap);
+		if (shadowmap != m_cached_shadowmap) m_renderer.releaseRenderbuffer(shadowmap);
 
 		m_output = result;
 	}
@@ -1577,20 +2020,102 @@ struct PipelineImpl final : Pipeline {
 		stream.endProfileBlock();
 	}
 
+	static constexpr float MAX_RENDER_TO_DISPLAY_RATIO = 2;
+
+	// adjusts internal resolution so GPU frame time stays under m_dynamic_resolution_target
+	// the ratio changes in steps and not too often, so renderbuffers of only few sizes are created
+	void updateDynamicResolution() {
+		if (!m_renderer.isDynamicResolution() || m_type != PipelineType::GAME_VIEW) return;
+
+		const float gpu_time = m_renderer.getGPUFrameTime();
+		if (gpu_time <= 0) return;
+		m_dynamic_resolution_gpu_time = m_dynamic_resolution_gpu_time <= 0 ? gpu_time : lerp(m_dynamic_resolution_gpu_time, gpu_time, 0.1f);
+
+		// timestamps are few frames old, give previous change time to show up
+		const u32 frame = m_renderer.frameNumber();
+		if (frame - m_dynamic_resolution_last_change < 30) return;
+
+		// GPU time is roughly proportional to pixel count
+		const float pixels_ratio = m_dynamic_resolution_target / m_dynamic_resolution_gpu_time;
+		const float render_fraction = 1 / m_render_to_display_scale;
+		float desired_fraction = render_fraction * sqrtf(pixels_ratio);
+		desired_fraction = clamp(desired_fraction, 1 / MAX_RENDER_TO_DISPLAY_RATIO, 1.f);
+		// 5% steps
+		const float STEP = 0.05f;
+		const float step_fraction = floorf(desired_fraction / STEP + 0.5f) * STEP;
+		// go down as soon as we are over budget, but go up only when there's enough headroom
+		if (step_fraction < render_fraction - STEP * 0.5f || (step_fraction > render_fraction + STEP * 0.5f && pixels_ratio > 1.1f)) {
+			m_render_to_display_scale = clamp(1 / step_fraction, 1.f, MAX_RENDER_TO_DISPLAY_RATIO);
+			m_dynamic_resolution_last_change = frame;
+		}
+	}
+
+	// bones of skinned model instances are computed once per frame, all views and meshes of the instance read them
+	void prepareSkinningPalettes() {
+		PROFILE_FUNCTION();
+		if (!m_module) return;
+
+		Span<ModelInstance> instances = m_module->getModelInstances();
+		m_skinning_palettes.resize(instances.length());
+		jobs::forEach(instances.length(), [&](u32 from, u32 to){
+			PROFILE_BLOCK("skinning palettes");
+			for (u32 i = from; i < to; ++i) {
+				const ModelInstance& mi = instances[i];
+				SkinningPalette& palette = m_skinning_palettes[i];
+				palette.buffer = gpu::INVALID_BINDLESS_HANDLE;
+				if (!mi.pose || mi.pose->count == 0 || !isFlagSet(mi.flags, ModelInstance::VALID)) continue;
+
+				bool is_skinned = false;
+				for (u32 j = 0; j < mi.mesh_count; ++j) {
+					is_skinned = is_skinned || mi.meshes[j].type == Mesh::SKINNED;
+				}
+				if (!is_skinned) continue;
+
+				const Renderer::TransientSlice slice = m_renderer.allocTransient(sizeof(DualQuat) * mi.pose->count);
+				computeSkinningPalette(*mi.model, *mi.pose, (DualQuat*)slice.ptr);
+				palette.buffer = gpu::getBindlessHandle(slice.buffer);
+				palette.offset = slice.offset;
+			}
+		});
+	}
+
+	void skipRender() override {
+		if (m_module) {
+			m_module->clearDebugLines();
+			m_module->clearDebugTriangles();
+			m_module->clearDebugBatchDraws();
+		}
+		m_draw2d.clear(getAtlasSize());
+	}
+
 	bool render(bool only_2d) override {
 		PROFILE_FUNCTION();
 
 		if (m_viewport.w <= 0 || m_viewport.h <= 0) {
-			if (m_module) {
-				m_module->clearDebugLines();
-				m_module->clearDebugTriangles();
-			}
-			m_draw2d.clear(getAtlasSize());
+			skipRender();
 			return false;
 		}
 
+		// viewport is in display resolution after the previous frame, see renderMain
+		if (!only_2d) updateDynamicResolution();
+		const float render_scale = only_2d ? 1 : m_render_to_display_scale;
+		m_viewport.w = maximum(1, i32(m_display_size.x / render_scale));
+		m_viewport.h = maximum(1, i32(m_display_size.y / render_scale));
+
 		m_renderer.waitCanSetup();
 
+		{
+			jobs::MutexGuard guard(m_hiz_readback->mutex);
+			const HiZCPU& latest = m_hiz_readback->latest;
+			m_hiz_cpu.depths.resize(latest.depths.size());
+			if (!latest.depths.empty()) memcpy(m_hiz_cpu.depths.begin(), latest.depths.begin(), latest.depths.byte_size());
+			m_hiz_cpu.size = latest.size;
+			m_hiz_cpu.camera_pos = latest.camera_pos;
+			m_hiz_cpu.view_projection = latest.view_projection;
+		}
+		// readback is a few frames old, disocclusions after fast camera moves would be too visible
+		if (squaredLength(m_hiz_cpu.camera_pos - m_viewport.pos) > 4) m_hiz_cpu.size = IVec2(0);
+
 		m_viewport.pixel_offset = Vec2(0);
 
 		if (m_is_pixel_jitter_enabled) {
@@ -1652,6 +2177,7 @@ struct PipelineImpl final : Pipeline {
 
 		if (!only_2d) {
 			prepareShadowCameras(global_state);
+			prepareSkinningPalettes();
 		}
 
 		switch (m_type) {
@@ -1692,28 +2218,68 @@ struct PipelineImpl final : Pipeline {
 		return true;
 	}
 
+	void renderDebugBatches() {
+		if (m_module->getDebugBatchDraws().length() == 0 || !m_debug_shape_shader->isReady()) return;
+
+		m_renderer.pushJob("debug batches", [this](DrawStream& stream){
+			struct BaseVertex {
+				Vec3 pos;
+				u32 color;
+			};
+			const gpu::StateFlags tris_state = gpu::StateFlags::DEPTH_FN_GREATER | gpu::StateFlags::DEPTH_WRITE | gpu::StateFlags::CULL_BACK;
+			const gpu::StateFlags lines_state = gpu::StateFlags::DEPTH_FN_GREATER | gpu::StateFlags::DEPTH_WRITE;
+			const gpu::ProgramHandle tris_program = m_debug_shape_shader->getProgram(tris_state, m_base_vertex_decl, 0, "");
+			const gpu::ProgramHandle lines_program = m_debug_shape_shader->getProgram(lines_state, m_base_line_vertex_decl, 0, "");
+			stream.bindIndexBuffer(gpu::INVALID_BUFFER);
+			stream.bindVertexBuffer(1, gpu::INVALID_BUFFER, 0, 0);
+			// buffers are already on GPU, we only need a transform per batch
+			for (const DebugBatch& batch : m_module->getDebugBatchDraws()) {
+				Matrix mtx = Matrix::IDENTITY;
+				mtx.setTranslation(Vec3(batch.origin - m_viewport.pos));
+				const Renderer::TransientSlice ub = m_renderer.allocUniform(&mtx.columns[0].x, sizeof(Matrix));
+				stream.bindUniformBuffer(UniformBuffer::DRAWCALL, ub.buffer, ub.offset, sizeof(Matrix));
+				if (batch.triangles_count > 0) {
+					stream.useProgram(tris_program);
+					stream.bindVertexBuffer(0, batch.triangles, 0, sizeof(BaseVertex));
+					stream.drawArrays(0, batch.triangles_count * 3);
+				}
+				if (batch.lines_count > 0) {
+					stream.useProgram(lines_program);
+					stream.bindVertexBuffer(0, batch.lines, 0, sizeof(BaseVertex));
+					stream.drawArrays(0, batch.lines_count * 2);
+				}
+			}
+			m_module->clearDebugBatchDraws();
+		});
+	}
+
 	void renderDebugTriangles() {
-		const Array<DebugTriangle>& tris = m_module->getDebugTriangles();
-		if (tris.empty() || !m_debug_shape_shader->isReady()) return;
+		if (!m_module->getDebugTriangles() || !m_debug_shape_shader->isReady()) return;
 
 		m_renderer.pushJob("debug triangles", [this](DrawStream& stream){
 			struct BaseVertex {
 				Vec3 pos;
 				u32 color;
 			};
-			const Array<DebugTriangle>& tris = m_module->getDebugTriangles();
+			u32 count = 0;
+			for (const DebugChunk<DebugTriangle>* chunk = m_module->getDebugTriangles(); chunk; chunk = chunk->next) {
+				count += chunk->count;
+			}
 			const gpu::StateFlags state = gpu::StateFlags::DEPTH_FN_GREATER | gpu::StateFlags::DEPTH_WRITE | gpu::StateFlags::CULL_BACK;
 			const gpu::ProgramHandle program = m_debug_shape_shader->getProgram(state, m_base_vertex_decl, 0, "");
-			const Renderer::TransientSlice vb = m_renderer.allocTransient(sizeof(BaseVertex) * tris.size() * 3);
+			const Renderer::TransientSlice vb = m_renderer.allocTransient(sizeof(BaseVertex) * count * 3);
 			const Renderer::TransientSlice ub = m_renderer.allocUniform(&Matrix::IDENTITY.columns[0].x, sizeof(Matrix));
 			BaseVertex* vertices = (BaseVertex*)vb.ptr;
-			for (u32 i = 0, c = tris.size(); i < c; ++i) {
-				vertices[3 * i + 0].color = tris[i].color.abgr();
-				vertices[3 * i + 0].pos = Vec3(tris[i].p0 - m_viewport.pos);
-				vertices[3 * i + 1].color = tris[i].color.abgr();
-				vertices[3 * i + 1].pos = Vec3(tris[i].p1 - m_viewport.pos);
-				vertices[3 * i + 2].color = tris[i].color.abgr();
-				vertices[3 * i + 2].pos = Vec3(tris[i].p2 - m_viewport.pos);
+			for (const DebugChunk<DebugTriangle>* chunk = m_module->getDebugTriangles(); chunk; chunk = chunk->next) {
+				for (const DebugTriangle& tri : *chunk) {
+					vertices[0].color = tri.color.abgr();
+					vertices[0].pos = Vec3(tri.p0 - m_viewport.pos);
+					vertices[1].color = tri.color.abgr();
+					vertices[1].pos = Vec3(tri.p1 - m_viewport.pos);
+					vertices[2].color = tri.color.abgr();
+					vertices[2].pos = Vec3(tri.p2 - m_viewport.pos);
+					vertices += 3;
+				}
 			}
 			m_module->clearDebugTriangles();
 
@@ -1727,25 +2293,30 @@ struct PipelineImpl final : Pipeline {
 	}
 
 	void renderDebugLines()	{
-		const Array<DebugLine>& lines = m_module->getDebugLines();
-		if (lines.empty() || !m_debug_shape_shader->isReady()) return;
+		if (!m_module->getDebugLines() || !m_debug_shape_shader->isReady()) return;
 
 		m_renderer.pushJob("debug lines", [this](DrawStream& stream){
 			struct BaseVertex {
 				Vec3 pos;
 				u32 color;
 			};
-			const Array<DebugLine>& lines = m_module->getDebugLines();
+			u32 count = 0;
+			for (const DebugChunk<DebugLine>* chunk = m_module->getDebugLines(); chunk; chunk = chunk->next) {
+				count += chunk->count;
+			}
 			const gpu::StateFlags state = gpu::StateFlags::DEPTH_FN_GREATER | gpu::StateFlags::DEPTH_WRITE;
 			const gpu::ProgramHandle program = m_debug_shape_shader->getProgram(state, m_base_line_vertex_decl, 0, "");
-			const Renderer::TransientSlice vb = m_renderer.allocTransient(sizeof(BaseVertex) * lines.size() * 2);
+			const Renderer::TransientSlice vb = m_renderer.allocTransient(sizeof(BaseVertex) * count * 2);
 			const Renderer::TransientSlice ub = m_renderer.allocUniform(&Matrix::IDENTITY.columns[0].x, sizeof(Matrix));
 			BaseVertex* vertices = (BaseVertex*)vb.ptr;
-			for (u32 i = 0, c = lines.size(); i < c; ++i) {
-				vertices[2 * i + 0].color = lines[i].color.abgr();
-				vertices[2 * i + 0].pos = Vec3(lines[i].from - m_viewport.pos);
-				vertices[2 * i + 1].color = lines[i].color.abgr();
-				vertices[2 * i + 1].pos = Vec3(lines[i].to - m_viewport.pos);
+			for (const DebugChunk<DebugLine>* chunk = m_module->getDebugLines(); chunk; chunk = chunk->next) {
+				for (const DebugLine& line : *chunk) {
+					vertices[0].color = line.color.abgr();
+					vertices[0].pos = Vec3(line.from - m_viewport.pos);
+					vertices[1].color = line.color.abgr();
+					vertices[1].pos = Vec3(line.to - m_viewport.pos);
+					vertices += 2;
+				}
 			}
 			m_module->clearDebugLines();
 
@@ -1759,6 +2330,7 @@ struct PipelineImpl final : Pipeline {
 	}
 
 	void renderDebugShapes() {
+		renderDebugBatches();
 		renderDebugTriangles();
 		renderDebugLines();
 		//renderDebugPoints();
@@ -1777,6 +2349,7 @@ struct PipelineImpl final : Pipeline {
 		if (data.getIndices().empty()) return;
 
 		const Texture* atlas_texture = m_renderer.getFontManager().getAtlasTexture();
+		const u32 atlas_mode = m_renderer.getFontManager().isSDF() ? 2 : 1;
 
 		DrawStream& stream = m_renderer.getDrawStream();
 		
@@ -1790,48 +2363,45 @@ struct PipelineImpl final : Pipeline {
 		const gpu::ProgramHandle program = m_draw2d_shader->getProgram(state, m_2D_decl, 0, "");
 
 		stream.pushDebugGroup("draw2d");
+		// textures and clip rects are in tables indexed by vertices, so whole cmd is a single draw call
 		struct {
 			Matrix mtx;
-			gpu::BindlessHandle texture;
-		} ubdata = {
-			matrix,
-			gpu::BindlessHandle()
-		};
-		u32 elem_offset = 0;
+			gpu::BindlessHandle atlas;
+			// font atlas has only alpha (or distance to glyph's outline in SDF mode) in red channel
+			u32 atlas_mode;
+			u32 padding[2];
+			Vec4 clip_rects[Draw2D::MAX_CMD_CLIP_RECTS];
+			gpu::BindlessHandle textures[Draw2D::MAX_CMD_TEXTURES];
+		} ubdata;
+		ubdata.mtx = matrix;
+		ubdata.atlas = gpu::getBindlessHandle(atlas_texture->handle);
+		ubdata.atlas_mode = atlas_mode;
+
 		stream.useProgram(program);
 		stream.bindIndexBuffer(idx_buffer_mem.buffer);
-		stream.bindVertexBuffer(0, vtx_buffer_mem.buffer, vtx_buffer_mem.offset, 20);
+		stream.bindVertexBuffer(0, vtx_buffer_mem.buffer, vtx_buffer_mem.offset, sizeof(Draw2D::Vertex));
 		stream.bindVertexBuffer(1, gpu::INVALID_BUFFER, 0, 0);
+		// clipping is done in the shader
+		stream.scissor(0, 0, m_viewport.w, m_viewport.h);
+
+		const Array<gpu::TextureHandle*>& textures = data.getTextures();
+		const Array<Draw2D::Rect>& clip_rects = data.getClipRects();
+		for (const Draw2D::Cmd& cmd : data.getCmds()) {
+			if (cmd.indices_count == 0) continue;
 
-		for (Draw2D::Cmd& cmd : data.getCmds()) {
-			if(cmd.clip_size.x < 0) {
-				stream.scissor(0, 0, m_viewport.w, m_viewport.h);
+			for (u32 i = 0; i < cmd.clip_rects_count; ++i) {
+				const Draw2D::Rect& r = clip_rects[cmd.clip_rects_offset + i];
+				ubdata.clip_rects[i] = Vec4(r.from, r.to);
 			}
-			else {
-				const u32 h = u32(clamp(cmd.clip_size.y, 0.f, 65535.f));
-				if (gpu::isOriginBottomLeft()) {
-					stream.scissor(u32(maximum(cmd.clip_pos.x, 0.0f)),
-						m_viewport.h - u32(maximum(cmd.clip_pos.y, 0.0f)) - h,
-						u32(minimum(cmd.clip_size.x, 65535.0f)),
-						u32(minimum(cmd.clip_size.y, 65535.0f)));
-				}
-				else {
-					stream.scissor(u32(maximum(cmd.clip_pos.x, 0.0f)),
-						u32(maximum(cmd.clip_pos.y, 0.0f)),
-						u32(minimum(cmd.clip_size.x, 65535.0f)),
-						u32(minimum(cmd.clip_size.y, 65535.0f)));
-				}
+			for (u32 i = 0; i < cmd.textures_count; ++i) {
+				gpu::TextureHandle* tex = textures[cmd.textures_offset + i];
+				gpu::TextureHandle texture_id = tex ? *tex : atlas_texture->handle;
+				if (!texture_id) texture_id = atlas_texture->handle;
+				ubdata.textures[i] = gpu::getBindlessHandle(texture_id);
 			}
-			
-			gpu::TextureHandle texture_id = atlas_texture->handle;
-			if (cmd.texture) texture_id = *cmd.texture;
-			if (!texture_id) texture_id = atlas_texture->handle;
 
-			ubdata.texture = gpu::getBindlessHandle(texture_id);
 			setUniform(ubdata);
-			stream.drawIndexed(idx_buffer_mem.offset + elem_offset * sizeof(u32), cmd.indices_count, gpu::DataType::U32);
-
-			elem_offset += cmd.indices_count;
+			stream.drawIndexed(idx_buffer_mem.offset + cmd.index_offset * sizeof(u32), cmd.indices_count, gpu::DataType::U32);
 		}
 		stream.popDebugGroup();
 	}
@@ -1841,20 +2411,54 @@ struct PipelineImpl final : Pipeline {
 		if (m_module == module) return;
 		m_module = module;
 		m_shadow_atlas.clear();
+		m_renderer.releaseRenderbuffer(m_cached_shadowmap);
+		m_cached_shadowmap = INVALID_RENDERBUFFER;
 	}
 	
 	Renderer& getRenderer() const override { return m_renderer; }
 
 	RenderModule* getModule() const override { return m_module; }
 
-	void renderTerrains(const CameraParams& cp, gpu::StateFlags state, const char* define) {
+	// `view` - with GPU LODs, terrain patches are occlusion culled against its depth pyramid
+	void renderTerrains(const CameraParams& cp, gpu::StateFlags state, const char* define, const View* view = nullptr) {
 		const u32 define_mask = define ? 1 << m_renderer.getShaderDefineIdx(define) : 0;
-		m_renderer.pushJob("terrain", [this, cp, state, define_mask](DrawStream& stream){
+		const bool gpu_lod = m_renderer.isTerrainGPULOD() && m_terrain_lod_shader->isReady();
+		// clipmaps follow the viewport, same as terrain LODs
+		for (Terrain* terrain : m_module->getTerrains()) {
+			const Transform tr = m_module->getWorld().getTransform(terrain->m_entity);
+			terrain->updateClipmap(tr.rot.conjugated().rotate(Vec3(m_viewport.pos - tr.pos)), m_renderer.frameNumber());
+			if (gpu_lod) terrain->updateLODTree();
+		}
+
+		struct LODCulling {
+			gpu::ProgramHandle init_program;
+			gpu::ProgramHandle select_program;
+			gpu::BindlessHandle hiz;
+			IVec2 hiz_size;
+			u32 hiz_mips;
+			Matrix hiz_mtx;
+		} lod_culling = {};
+		if (gpu_lod) {
+			lod_culling.init_program = m_terrain_lod_shader->getProgram(1 << m_renderer.getShaderDefineIdx("PASS0"));
+			lod_culling.select_program = m_terrain_lod_shader->getProgram(0);
+			if (view && view->hiz_bindless.value != 0) {
+				// patches are relative to the current camera, hiz is relative to the previous one
+				Matrix translation = Matrix::IDENTITY;
+				translation.setTranslation(Vec3(view->cp.pos - view->hiz.camera_pos));
+				lod_culling.hiz = view->hiz_bindless;
+				lod_culling.hiz_size = view->hiz.size;
+				lod_culling.hiz_mips = view->hiz.mips;
+				lod_culling.hiz_mtx = view->hiz.view_projection * translation;
+			}
+		}
+
+		m_renderer.pushJob("terrain", [this, cp, state, define_mask, gpu_lod, lod_culling](DrawStream& stream){
 			const HashMap<EntityRef, Terrain*>& terrains = m_module->getTerrains();
 			if(terrains.empty()) return;
 
 			World& world = m_module->getWorld();
 			gpu::VertexDecl decl(gpu::PrimitiveType::TRIANGLE_STRIP);
+			gpu::VertexDecl lod_decl(gpu::PrimitiveType::TRIANGLES);
 			for (const Terrain* terrain : terrains) {
 				if (!terrain->m_heightmap) continue;
 				if (!terrain->m_heightmap->isReady()) continue;
@@ -1880,6 +2484,16 @@ struct PipelineImpl final : Pipeline {
 					Vec2 hm_size;
 					float cell_size;
 					MaterialIndex material_index;
+					u32 clipmap_levels;
+					gpu::BindlessHandle clipmap_heightmap;
+					gpu::BindlessHandle clipmap_splatmap;
+					u32 clipmap_size;
+					IVec4 clipmap_origins[Terrain::MAX_CLIPMAP_LEVELS];
+					// see Terrain::LODTree, invalid if terrain is drawn in rings
+					gpu::BindlessHandle lod_patches;
+					u32 lod_patch_res = 0;
+					float lod_range = 0;
+					u32 lod_pad = 0;
 				};
 
 				Quad quad;
@@ -1887,8 +2501,103 @@ struct PipelineImpl final : Pipeline {
 				quad.lpos = Vec4(rot.conjugated().rotate(-pos), 0);
 				quad.hm_size = hm_size;
 				quad.material_index = material->getIndex();
+				// 0 levels - shader samples material's heightmap and splatmap
+				const Terrain::Clipmap& clipmap = terrain->m_clipmap;
+				quad.clipmap_levels = clipmap.levels;
+				quad.clipmap_size = Terrain::CLIPMAP_SIZE;
+				if (clipmap.levels > 0) {
+					quad.clipmap_heightmap = gpu::getBindlessHandle(clipmap.heightmap);
+					quad.clipmap_splatmap = gpu::getBindlessHandle(clipmap.splatmap);
+				}
+				for (u32 i = 0; i < Terrain::MAX_CLIPMAP_LEVELS; ++i) {
+					quad.clipmap_origins[i] = IVec4(clipmap.origins[i], IVec2(0));
+				}
 
 				ref_pos = rot.conjugated().rotate(-ref_pos);
+				
+				if (gpu_lod && terrain->m_lod_tree.minmax) {
+					// patches are selected and culled on GPU, CPU cost does not depend on view distance
+					const Terrain::LODTree& tree = terrain->m_lod_tree;
+					const u32 patch_res = Terrain::LOD_PATCH_CELLS * terrain->m_tesselation;
+					const float leaf_size = Terrain::LOD_PATCH_CELLS * scale.x;
+					// CDLOD needs the range to grow by more than node's diagonal between levels
+					const float lod_range = maximum(3 * leaf_size, 0.5f * terrain->m_base_grid_res * scale.x / terrain->m_tesselation);
+
+					// see terrain_lod.hlsl
+					struct {
+						Vec4 camera_planes[6];
+						Vec4 pos;
+						Vec4 lpos;
+						Vec4 terrain_scale;
+						Vec2 hm_size;
+						float leaf_size;
+						float lod_range;
+						u32 levels;
+						u32 nodes_count;
+						gpu::BindlessHandle minmax;
+						gpu::RWBindlessHandle patches;
+						u32 vertex_count;
+						gpu::BindlessHandle hiz;
+						IVec2 hiz_size;
+						u32 hiz_mips;
+						u32 pad[3];
+						u32 level_offsets[Terrain::MAX_LOD_LEVELS];
+						u32 level_widths[Terrain::MAX_LOD_LEVELS];
+						Matrix hiz_mtx;
+					} lod_ub = {};
+					toPlanes(cp, Span(lod_ub.camera_planes));
+					lod_ub.pos = Vec4(pos, 0);
+					// LODs follow the viewport, so all views, e.g. shadows, draw the same patches
+					lod_ub.lpos = Vec4(ref_pos, 0);
+					lod_ub.terrain_scale = Vec4(scale, 0);
+					lod_ub.hm_size = hm_size;
+					lod_ub.leaf_size = leaf_size;
+					lod_ub.lod_range = lod_range;
+					lod_ub.levels = tree.levels;
+					lod_ub.nodes_count = tree.nodes_count;
+					lod_ub.minmax = gpu::getBindlessHandle(tree.minmax);
+					lod_ub.patches = gpu::getRWBindlessHandle(tree.patches);
+					lod_ub.vertex_count = patch_res * patch_res * 6;
+					lod_ub.hiz = lod_culling.hiz;
+					lod_ub.hiz_size = lod_culling.hiz_size;
+					lod_ub.hiz_mips = lod_culling.hiz_mips;
+					lod_ub.hiz_mtx = lod_culling.hiz_mtx;
+					for (u32 i = 0; i < tree.levels; ++i) {
+						lod_ub.level_offsets[i] = tree.offsets[i];
+						lod_ub.level_widths[i] = tree.sizes[i].x;
+					}
+
+					const Renderer::TransientSlice lod_slice = m_renderer.allocUniform(&lod_ub, sizeof(lod_ub));
+					stream.bindUniformBuffer(UniformBuffer::DRAWCALL, lod_slice.buffer, lod_slice.offset, lod_slice.size);
+					stream.barrier(tree.minmax, gpu::BarrierType::READ);
+					stream.barrier(tree.patches, gpu::BarrierType::WRITE);
+					stream.useProgram(lod_culling.init_program);
+					stream.dispatch(1, 1, 1);
+					stream.memoryBarrier(tree.patches);
+					stream.useProgram(lod_culling.select_program);
+					stream.dispatch((tree.nodes_count + 255) / 256, 1, 1);
+					stream.memoryBarrier(tree.patches);
+					stream.barrier(tree.patches, gpu::BarrierType::READ);
+
+					quad.lpos = lod_ub.lpos;
+					quad.terrain_scale = Vec4(scale, 0);
+					quad.lod_patches = gpu::getBindlessHandle(tree.patches);
+					quad.lod_patch_res = patch_res;
+					quad.lod_range = lod_range;
+					const Renderer::TransientSlice ub = m_renderer.allocUniform(&quad, sizeof(quad));
+
+					const gpu::ProgramHandle lod_program = shader->getProgram(state | material->m_render_states, lod_decl, define_mask | material->getDefineMask(), "");
+					stream.useProgram(lod_program);
+					stream.bindIndexBuffer(gpu::INVALID_BUFFER);
+					stream.bindVertexBuffer(0, gpu::INVALID_BUFFER, 0, 0);
+					stream.bindVertexBuffer(1, gpu::INVALID_BUFFER, 0, 0);
+					stream.bindUniformBuffer(UniformBuffer::DRAWCALL, ub.buffer, ub.offset, ub.size);
+					stream.bindIndirectBuffer(tree.patches);
+					stream.drawArraysIndirect(0);
+					stream.bindIndirectBuffer(gpu::INVALID_BUFFER);
+					continue;
+				}
+
 				IVec4 prev_from_to;
 				float s = scale.x / terrain->m_tesselation;
 				bool first = true;
@@ -1981,9 +2690,12 @@ struct PipelineImpl final : Pipeline {
 
 				for (const Terrain::GrassType& type : terrain->m_grass_types) {
 					if (!type.m_grass_model || !type.m_grass_model->isReady()) continue;
+					// grass uses only LOD0
+					type.m_grass_model->requestLOD(0);
+					if (type.m_grass_model->getResidentLOD() > 0) continue;
 
 					const i32 to_mesh = type.m_grass_model->getLODIndices()[0].to;
-					const HashMap<u64, Terrain::GrassQuad>& quads = type.m_quads;
+					const FlatHashMap<u64, Terrain::GrassQuad>& quads = type.m_quads;
 					if (quads.empty()) continue;
 
 					for (i32 i = 0; i <= to_mesh; ++i) {
@@ -2033,7 +2745,7 @@ struct PipelineImpl final : Pipeline {
 							};
 							const Renderer::TransientSlice drawcall_ub = m_renderer.allocUniform(&drawcall_data, sizeof(drawcall_data));
 							stream.bindUniformBuffer(UniformBuffer::DRAWCALL, drawcall_ub.buffer, drawcall_ub.offset, drawcall_ub.size);
-							stream.bindVertexBuffer(1, quad.instances, 0, sizeof(Vec4) * 2);
+							stream.bindVertexBuffer(1, terrain->m_grass_buffer, quad.slot * Terrain::GRASS_SLOT_SIZE, sizeof(Vec4) * 2);
 							stream.drawIndexedInstanced(mesh.indices_count, instance_count, mesh.index_type);
 							++quad_count;
 							total_instance_count += instance_count;
@@ -2058,12 +2770,25 @@ struct PipelineImpl final : Pipeline {
 		const auto& particle_systems = m_module->getParticleEmitters();
 		if (particle_systems.size() == 0) return;
 			
+		CullResult* visible = m_module->getRenderables(view.cp.frustum, RenderableTypes::PARTICLES);
+		if (!visible) return;
+
+		Array<const ParticleSystem*> systems(m_allocator);
+		systems.reserve(visible->count());
+		const World& world = m_module->getWorld();
+		visible->forEach([&](EntityRef e){
+			const ParticleSystem& system = m_module->getParticleEmitter(e);
+			system.m_offscreen_updates = 0;
+			const float distance_squared = (float)squaredLength(world.getPosition(e) - view.cp.pos);
+			system.m_view_distance_squared = minimum(system.m_view_distance_squared, distance_squared);
+			systems.push(&system);
+		});
+		visible->free(m_renderer.getEngine().getPageAllocator());
+
 		Sorter::Inserter inserter(view.sorter);
-		// TODO culling
 
-		jobs::forEach(particle_systems.capacity(), 1, [&](i32 idx, i32){
-			const ParticleSystem* system = particle_systems.getFromIndex(idx);
-			if (!system) return;
+		jobs::forEach(systems.size(), 1, [&](i32 idx, i32){
+			const ParticleSystem* system = systems[idx];
 			
 			PROFILE_BLOCK("setup particles");
 			for (ParticleSystem::Emitter& emitter : system->getEmitters()) {
@@ -2072,6 +2797,8 @@ struct PipelineImpl final : Pipeline {
 
 				const u8 bucket_idx = view.layer_to_bucket[material->getLayer()];
 				if (bucket_idx == 0xff) continue;
+				// gpu emitters have instance data in gpu buffer
+				if (emitter.gpu.renderer) continue;
 
 				const u32 size = emitter.getParticlesDataSizeBytes();
 				if (size == 0) continue;
@@ -2081,7 +2808,8 @@ struct PipelineImpl final : Pipeline {
 			}
 		});
 
-		for (const ParticleSystem& system : particle_systems) {
+		for (const ParticleSystem* system_ptr : systems) {
+			const ParticleSystem& system = *system_ptr;
 			for (ParticleSystem::Emitter& emitter : system.getEmitters()) {
 				const Material* material = emitter.resource_emitter.material;
 				if (!material) continue;
@@ -2089,10 +2817,12 @@ struct PipelineImpl final : Pipeline {
 				const u8 bucket_idx = view.layer_to_bucket[material->getLayer()];
 				if (bucket_idx == 0xff) continue;
 
-				const u32 size = emitter.getParticlesDataSizeBytes();
-				if (size == 0) continue;
+				if (!emitter.gpu.renderer) {
+					const u32 size = emitter.getParticlesDataSizeBytes();
+					if (size == 0) continue;
 				
-				ASSERT(emitter.particles_count > 0);
+					ASSERT(emitter.particles_count > 0);
+				}
 
 				const u64 type_mask = (u64)RenderableTypes::PARTICLES << 32;
 				const u32 emitter_idx = u32(&emitter - system.getEmitters().begin());
@@ -2195,52 +2925,14 @@ struct PipelineImpl final : Pipeline {
 		Light lights[64];
 	};
 
-	void setupFur(View& view) {
-		if (view.cp.is_shadow) return;
-
-		HashMap<EntityRef, Fur>& furs = m_module->getFurs();
-		if (furs.empty()) return;
-
-		Span<const ModelInstance> mi = m_module->getModelInstances();
-		Sorter::Inserter inserter(view.sorter);
-		
-		const u64 type_mask = (u64)RenderableTypes::FUR << 32;
-		
-		// TODO frustum culling
-		// TODO render correct LOD
-		for (auto iter : furs.iterated()) {
-			const EntityRef e = iter.key();
-			if (e.index >= (i32)mi.length()) continue;
-			if ((mi[e.index].flags & ModelInstance::VALID) == 0) continue;
-			if (!iter.value().enabled) continue;
-
-			Model* model = mi[e.index].model;
-			if (!model) continue;
-			if (!model->isReady()) continue;
-
-			for (i32 i = 0; i < model->getMeshCount(); ++i) {
-				const Mesh& mesh = model->getMesh(i);
-				if (mesh.type != Mesh::SKINNED) continue;
-				
-				const MeshMaterial& mesh_mat = model->getMeshMaterial(i);
-				const u8 bucket_id = view.layer_to_bucket[mesh_mat.material->getLayer()];
-				if (bucket_id != 0xff) {
-					const u64 key = mesh_mat.sort_key | ((u64)bucket_id << SORT_KEY_BUCKET_SHIFT);
-					const u64 subrenderable = e.index | type_mask | ((u64)i << SORT_KEY_MESH_IDX_SHIFT);
-				
-					inserter.push(key, subrenderable);
-				}
-			}
-		}
-	}
-
 	void encodeProceduralGeometry(View& view) {
 		const World& world = m_module->getWorld();
 		const HashMap<EntityRef, ProceduralGeometry>& geometries = m_module->getProceduralGeometries();
 		const DVec3 camera_pos = view.cp.pos;
 		for (auto iter = geometries.begin(), end = geometries.end(); iter != end; ++iter) {
 			const ProceduralGeometry& pg = iter.value();
-			if (!pg.vertex_buffer) continue;
+			// buffers are kept when geometry is emptied, so they can be reused
+			if (!pg.vertex_buffer || pg.vertex_data.empty()) continue;
 			if (!pg.material || !pg.material->isReady()) continue;
 
 			u8 bucket_idx = view.layer_to_bucket[pg.material->getLayer()];
@@ -2263,12 +2955,13 @@ struct PipelineImpl final : Pipeline {
 
 			const u32 stride = pg.vertex_decl.getStride();
 			
+			const bool indexed = !pg.index_data.empty();
 			bucket.stream.useProgram(program);
-			bucket.stream.bindIndexBuffer(pg.index_buffer);
+			bucket.stream.bindIndexBuffer(indexed ? pg.index_buffer : gpu::INVALID_BUFFER);
 			bucket.stream.bindVertexBuffer(0, pg.vertex_buffer, 0, stride);
 			bucket.stream.bindVertexBuffer(1, gpu::INVALID_BUFFER, 0, 0);
 
-			if (pg.index_buffer) {
+			if (indexed) {
 				const u32 count = (u32)pg.index_data.size() / (pg.index_type == gpu::DataType::U16 ? 2 : 4);
 				bucket.stream.drawIndexed(0, count, pg.index_type);
 			}
@@ -2286,7 +2979,8 @@ struct PipelineImpl final : Pipeline {
 		const float global_lod_multiplier = m_renderer.getLODMultiplier();
 		const World& world = m_module->getWorld();
 		const HashMap<EntityRef, InstancedModel>& ims = m_module->getInstancedModels();
-		if (ims.empty()) return;
+		const HashMap<Model*, GPUDrivenModel>& gpu_driven_models = m_module->getGPUDrivenModels();
+		if (ims.empty() && gpu_driven_models.empty()) return;
 		
 		struct UBValues {
 			Vec4 camera_offset;
@@ -2295,16 +2989,33 @@ struct PipelineImpl final : Pipeline {
 			u32 indirect_offset;
 			float radius;
 			u32 batch_size;
-			float padding;
+			u32 chunk_origins_offset;
 			Vec4 camera_planes[6];
 			IVec4 indices_count[32];
 			gpu::RWBindlessHandle culled_buffer;
 			gpu::RWBindlessHandle instanced_data;
 			gpu::RWBindlessHandle indirect_buffer;
+			gpu::BindlessHandle hiz;
+			IVec2 hiz_size;
+			u32 hiz_mips;
+			u32 hiz_pad;
+			Matrix hiz_mtx;
+			Vec4 quantization_step;
 		};
 
 		UBValues ub_values;
 		toPlanes(view.cp, Span(ub_values.camera_planes));
+		ub_values.hiz = view.hiz_bindless;
+		ub_values.hiz_size = view.hiz.size;
+		ub_values.hiz_mips = view.hiz.mips;
+		ub_values.hiz_mtx = view.hiz.view_projection;
+		if (view.hiz_bindless.value != 0) {
+			// instances are relative to the current camera, hiz is relative to the previous one
+			Matrix translation = Matrix::IDENTITY;
+			translation.setTranslation(Vec3(view.cp.pos - view.hiz.camera_pos));
+			// hiz is left in read state by buildHiZ
+			ub_values.hiz_mtx = view.hiz.view_projection * translation;
+		}
 
 		const gpu::BufferHandle culled_buffer = m_renderer.getInstancedMeshesBuffer();
 		//stream.bindShaderBuffer(m_indirect_buffer, 2, gpu::BindShaderBufferFlags::OUTPUT);
@@ -2316,10 +3027,10 @@ struct PipelineImpl final : Pipeline {
 		const gpu::ProgramHandle init_shader = m_instancing_shader->getProgram(1 << m_renderer.getShaderDefineIdx("PASS0"));
 		const gpu::ProgramHandle update_lods_shader = m_instancing_shader->getProgram(1 << m_renderer.getShaderDefineIdx("UPDATE_LODS"));
 
-		for (auto iter = ims.begin(), end = ims.end(); iter != end; ++iter) {
-			const InstancedModel& im = iter.value();
+		// instanced models and GPU driven model instances are culled and drawn the same way
+		auto encode = [&](const InstancedModel& im, const DVec3& origin) {
 			Model* m = im.model;
-			if (!m || !m->isReady()) continue;
+			if (!m || !m->isReady()) return;
 
 			auto getDrawDistance = [](const Model& model) {
 				const LODMeshIndices* lod_indices = model.getLODIndices();
@@ -2334,51 +3045,70 @@ struct PipelineImpl final : Pipeline {
 
 			const float draw_distance = getDrawDistance(*m);
 
-			const Transform origin = world.getTransform(iter.key());
-			const Frustum frustum = view.cp.frustum.getRelative(origin.pos);
+			const Frustum frustum = view.cp.frustum.getRelative(origin);
 			const float radius = m->getOriginBoundingRadius();
 
-			struct {
+			struct CellRange {
 				u32 offset;
 				u32 count;
 				bool visible;
 				Renderer::TransientSlice ub;
-			} cells[16];
-			u32 cell_count = 0;
+			};
+			Array<CellRange> cells(m_allocator);
+
+			// free slots in gpu_data are never drawn, so neighbouring cells are merged into one range
+			auto pushRange = [&](u32 offset, u32 count, bool visible) {
+				if (!cells.empty()) {
+					CellRange& prev = cells.last();
+					if (prev.visible == visible && prev.offset + prev.count == offset) {
+						prev.count += count;
+						u32* tmp = (u32*)prev.ub.ptr;
+						tmp[1] += count;
+						return;
+					}
+				}
+				const Renderer::TransientSlice ub = m_renderer.allocUniform(sizeof(u32) * 2);
+				u32* tmp =(u32*)ub.ptr;
+				tmp[0] = offset;
+				tmp[1] = count;
+				cells.push({offset, count, visible, ub});
+			};
+
+			auto isInDrawDistance = [&](const AABB& aabb) {
+				const Vec3 center = (aabb.max + aabb.min) * 0.5f;
+				const float aabb_radius = length((aabb.max - aabb.min) * 0.5f);
+				return length(origin - view.cp.pos + center) - aabb_radius < draw_distance;
+			};
+
+			const InstancedModel::Grid& grid = im.grid;
+			const u32 cells_per_block = InstancedModel::Grid::BLOCK_SIZE * InstancedModel::Grid::BLOCK_SIZE;
+			for (u32 block_idx = 0; block_idx < (u32)grid.blocks.size(); ++block_idx) {
+				const InstancedModel::Grid::Block& block = grid.blocks[block_idx];
+				if (block.instance_count == 0) continue;
+				if (!isInDrawDistance(block.aabb)) continue;
+
+				if (!frustum.intersectAABBWithOffset(block.aabb, radius)) {
+					// LODs of invisible instances are still updated
+					pushRange(block.gpu_offset, block.gpu_size, false);
+					continue;
+				}
 
-			for (u32 i = 0; i < 16; ++i) {
-				const InstancedModel::Grid::Cell& cell = im.grid.cells[i];
+				for (u32 i = 0; i < cells_per_block; ++i) {
+					const InstancedModel::Grid::Cell& cell = grid.cells[block_idx * cells_per_block + i];
+					if (cell.instance_count == 0) continue;
+					if (!isInDrawDistance(cell.aabb)) continue;
 
-				if (cell.instance_count > 0) {
 					const bool visible = frustum.intersectAABBWithOffset(cell.aabb, radius);
-					const Vec3 cell_center = (cell.aabb.max + cell.aabb.min) * 0.5f;
-					const Vec3 cell_half_extents = (cell.aabb.max - cell.aabb.min) * 0.5f;
-					const float cell_radius = length(cell_half_extents);
-					if (length(origin.pos - view.cp.pos + cell_center) - cell_radius < draw_distance) {
-						const bool can_merge = cell_count > 0 && cells[cell_count - 1].visible == visible  && cells[cell_count - 1].offset + cells[cell_count - 1].count == cell.from_instance;
-						if (can_merge) {
-							cells[cell_count - 1].count += cell.instance_count;
-							u32* tmp =(u32*)cells[cell_count - 1].ub.ptr;
-							tmp[1] += cell.instance_count;
-						}
-						else {
-							cells[cell_count].visible = visible;
-							cells[cell_count].count = cell.instance_count;
-							cells[cell_count].offset = cell.from_instance;
-							const Renderer::TransientSlice ub = m_renderer.allocUniform(sizeof(u32) * 2);
-							u32* tmp =(u32*)ub.ptr;
-							tmp[0] = cell.from_instance;
-							tmp[1] = cell.instance_count;
-							cells[cell_count].ub = ub;
-							++cell_count;
-						}
-					}
+					pushRange(cell.gpu_offset, cell.gpu_capacity, visible);
 				}
 			}
 				
-			if (cell_count == 0) continue;
+			if (cells.empty()) return;
 
-			Vec4 lod_distances = *(Vec4*)m->getLODDistances() * global_lod_multiplier;
+			Vec4 lod_distances = *(Vec4*)m->getLODDistances() * (global_lod_multiplier / view.cp.lod_multiplier);
+			// LOD is selected on GPU, so we always want all LODs, until they are loaded LOD0 is not used
+			m->requestLOD(0);
+			if (m->getResidentLOD() > 0) lod_distances.x = 0;
 			if (lod_distances.w < 0) lod_distances.w = FLT_MAX;
 			if (lod_distances.z < 0) lod_distances.z = FLT_MAX;
 			if (lod_distances.y < 0) lod_distances.y = FLT_MAX;
@@ -2391,13 +3121,17 @@ struct PipelineImpl final : Pipeline {
 			const u32 instance_count = im.instances.size();
 			
 			const u32 indirect_offset = m_indirect_buffer_offset.add(m->getMeshCount());
+			// out of space in indirect buffer, skip the rest of models
+			if ((indirect_offset + m->getMeshCount()) * sizeof(Indirect) > INDIRECT_BUFFER_SIZE) return;
 
-			ub_values.camera_offset = Vec4(Vec3(origin.pos - view.cp.pos), 1);
+			ub_values.camera_offset = Vec4(Vec3(origin - view.cp.pos), 1);
 			ub_values.lod_distances = lod_distances;
 			ub_values.lod_indices = lod_indices;
 			ub_values.indirect_offset = indirect_offset;
 			ub_values.radius = m->getOriginBoundingRadius();
 			ub_values.batch_size = instance_count;
+			ub_values.chunk_origins_offset = im.gpu_capacity * sizeof(InstancedModel::GPUInstanceData);
+			ub_values.quantization_step = Vec4(im.grid.cell_size / 65535.f, 0);
 			ub_values.culled_buffer = gpu::getRWBindlessHandle(culled_buffer);
 			ub_values.instanced_data = gpu::getRWBindlessHandle(im.gpu_data);
 			ub_values.indirect_buffer = gpu::getRWBindlessHandle(m_indirect_buffer);
@@ -2431,19 +3165,19 @@ struct PipelineImpl final : Pipeline {
 				stream.barrier(im.gpu_data, gpu::BarrierType::WRITE);
 				//stream.bindShaderBuffer(im.gpu_data, 0, gpu::BindShaderBufferFlags::OUTPUT);
 				stream.useProgram(update_lods_shader);
-				for (u32 i = 0; i < cell_count; ++i) {
-					if (!cells[i].visible) {
-						stream.bindUniformBuffer(UniformBuffer::DRAWCALL2, cells[i].ub.buffer, cells[i].ub.offset, cells[i].ub.size);
-						stream.dispatch((cells[i].count + 255) / 256, 1, 1);
+				for (const CellRange& range : cells) {
+					if (!range.visible) {
+						stream.bindUniformBuffer(UniformBuffer::DRAWCALL2, range.ub.buffer, range.ub.offset, range.ub.size);
+						stream.dispatch((range.count + 255) / 256, 1, 1);
 					}
 				}
 			}
 				
 			stream.useProgram(cull_shader);
-			for (u32 i = 0; i < cell_count; ++i) {
-				if (cells[i].visible) {
-					stream.bindUniformBuffer(UniformBuffer::DRAWCALL2, cells[i].ub.buffer, cells[i].ub.offset, cells[i].ub.size);
-					stream.dispatch((cells[i].count + 255) / 256, 1, 1);
+			for (const CellRange& range : cells) {
+				if (range.visible) {
+					stream.bindUniformBuffer(UniformBuffer::DRAWCALL2, range.ub.buffer, range.ub.offset, range.ub.size);
+					stream.dispatch((range.count + 255) / 256, 1, 1);
 				}
 			}
 			stream.memoryBarrier(culled_buffer);
@@ -2458,10 +3192,10 @@ struct PipelineImpl final : Pipeline {
 			stream.memoryBarrier(m_indirect_buffer);
 
 			stream.useProgram(gather_shader);
-			for (u32 i = 0; i < cell_count; ++i) {
-				if (cells[i].visible) {
-					stream.bindUniformBuffer(UniformBuffer::DRAWCALL2, cells[i].ub.buffer, cells[i].ub.offset, cells[i].ub.size);
-					stream.dispatch((cells[i].count + 255) / 256, 1, 1);
+			for (const CellRange& range : cells) {
+				if (range.visible) {
+					stream.bindUniformBuffer(UniformBuffer::DRAWCALL2, range.ub.buffer, range.ub.offset, range.ub.size);
+					stream.dispatch((range.count + 255) / 256, 1, 1);
 				}
 			}
 
@@ -2498,6 +3232,14 @@ struct PipelineImpl final : Pipeline {
 				bucket.stream.bindVertexBuffer(0, gpu::INVALID_BUFFER, 0, 0);
 				bucket.stream.bindVertexBuffer(1, gpu::INVALID_BUFFER, 0, 0);
 			}
+		};
+
+		for (auto iter = ims.begin(), end = ims.end(); iter != end; ++iter) {
+			encode(iter.value(), world.getPosition(iter.key()));
+		}
+
+		for (const GPUDrivenModel& gm : gpu_driven_models) {
+			encode(gm.im, gm.origin);
 		}
 
 		stream.memoryBarrier(m_indirect_buffer);
@@ -2522,8 +3264,9 @@ struct PipelineImpl final : Pipeline {
 		const World& world = m_module->getWorld();
 		const ShiftedFrustum frustum = view.cp.frustum;
 		ModelInstance* LUMIX_RESTRICT model_instances = m_module->getModelInstances().begin();
-		const Transform* LUMIX_RESTRICT transforms = world.getTransforms(); 
+		const Transform* LUMIX_RESTRICT transforms = world.getRenderTransforms();
 		const DVec3 camera_pos = view.cp.pos;
+		const Frustum rel_frustum = frustum.getRelative(camera_pos);
 		
 		gpu::VertexDecl dyn_instance_decl(gpu::PrimitiveType::NONE);
 		dyn_instance_decl.addAttribute(0, 4, gpu::AttributeType::FLOAT, gpu::Attribute::INSTANCED);
@@ -2606,8 +3349,17 @@ struct PipelineImpl final : Pipeline {
 						stream->useProgram(program);
 						stream->bindIndexBuffer(gpu::INVALID_BUFFER);
 						stream->bindVertexBuffer(0, gpu::INVALID_BUFFER, 0, 0);
-						stream->bindVertexBuffer(1, slice.buffer, slice.offset, decl.getStride());
-						stream->drawArraysInstanced(4, particles_count);
+						if (emitter.gpu.renderer) {
+							// particle count is known only on gpu
+							stream->bindVertexBuffer(1, emitter.gpu.instances, 0, decl.getStride());
+							stream->bindIndirectBuffer(emitter.gpu.state);
+							stream->drawArraysIndirect(ParticleSystem::GPUEmitter::INDIRECT_OFFSET);
+							stream->bindIndirectBuffer(gpu::INVALID_BUFFER);
+						}
+						else {
+							stream->bindVertexBuffer(1, slice.buffer, slice.offset, decl.getStride());
+							stream->drawArraysInstanced(4, particles_count);
+						}
 						break;
 					}
 					case RenderableTypes::MESH: {
@@ -2628,6 +3380,49 @@ struct PipelineImpl final : Pipeline {
 							const gpu::StateFlags state = material->m_render_states | render_state;
 							const u32 defines = autoinstanced_define_mask | material->getDefineMask();
 							const gpu::ProgramHandle program = shader->getProgram(state, mesh.vertex_decl, instanced_decl, defines, mesh.semantics_defines);
+
+							if (total_count == 1 && !mesh.meshlets.empty()) {
+								// single instance of a mesh split into meshlets, draw only meshlets which can be visible
+								const Transform& tr = transforms[entity_index];
+								const Vec3 rel_pos = Vec3(tr.pos - camera_pos);
+								const float max_scale = maximum(tr.scale.x, tr.scale.y, tr.scale.z);
+								// normal cones are valid only for uniform positive scale
+								const bool cone_culling = !view.cp.is_shadow
+									&& u64(state & gpu::StateFlags::CULL_BACK)
+									&& tr.scale.x > 0
+									&& tr.scale.x == tr.scale.y
+									&& tr.scale.x == tr.scale.z;
+								const u32 index_size = mesh.areIndices16() ? 2 : 4;
+
+								stream->useProgram(program);
+								stream->bindIndexBuffer(mesh.index_buffer_handle);
+								stream->bindVertexBuffer(0, mesh.vertex_buffer_handle, 0, mesh.vb_stride);
+								stream->bindVertexBuffer(1, instances.slice.buffer, instances.slice.offset, 48);
+								
+								// visible meshlets next to each other are merged into one drawcall
+								u32 range_offset = 0;
+								u32 range_count = 0;
+								for (const Meshlet& meshlet : mesh.meshlets) {
+									const Vec3 center = tr.rot.rotate(meshlet.center * tr.scale) + rel_pos;
+									if (!rel_frustum.isSphereInside(center, meshlet.radius * max_scale)) continue;
+									if (cone_culling) {
+										// camera is at origin
+										const Vec3 apex = tr.rot.rotate(meshlet.cone_apex * tr.scale) + rel_pos;
+										const Vec3 axis = tr.rot.rotate(meshlet.cone_axis);
+										if (dot(normalize(apex), axis) >= meshlet.cone_cutoff) continue;
+									}
+
+									if (range_count > 0 && range_offset + range_count == meshlet.indices_offset) {
+										range_count += meshlet.indices_count;
+										continue;
+									}
+									if (range_count > 0) stream->drawIndexed(range_offset * index_size, range_count, mesh.index_type);
+									range_offset = meshlet.indices_offset;
+									range_count = meshlet.indices_count;
+								}
+								if (range_count > 0) stream->drawIndexed(range_offset * index_size, range_count, mesh.index_type);
+								break;
+							}
 						
 							gpu::Drawcall& dc = stream->draw();
 							dc = {
@@ -2749,22 +3544,21 @@ struct PipelineImpl final : Pipeline {
 						u32 defines = skinned_define_mask | mesh_mat.material->getDefineMask();
 						if (type == RenderableTypes::FUR) defines |= fur_define_mask;
 
-						struct UBPrefix {
-							float fur_scale;
-							float gravity;
-							float layers;
-							MaterialIndex material_index;
-							Matrix model_mtx;
-							Matrix prev_model_mtx;
-						};
+						if (entity.index >= m_skinning_palettes.size()) break;
+						const SkinningPalette& palette = m_skinning_palettes[entity.index];
+						if (palette.buffer.value == gpu::INVALID_BINDLESS_HANDLE.value) break;
 
-						const Renderer::TransientSlice ub = m_renderer.allocUniform(sizeof(DualQuat) * mi->pose->count + sizeof(UBPrefix));
+						const Renderer::TransientSlice ub = m_renderer.allocUniform(sizeof(SkinnedDrawcallUniforms));
 					
-						UBPrefix* prefix = (UBPrefix*)ub.ptr;
+						SkinnedDrawcallUniforms* prefix = (SkinnedDrawcallUniforms*)ub.ptr;
 						u32 layers = 1;
 						if (type == RenderableTypes::FUR) {
 							Fur& fur = m_module->getFur(entity);
-							layers = fur.layers;
+							// shells are thinner than a pixel in distance, so use fewer of them
+							const float dist = length(rel_pos);
+							layers = dist > FUR_FULL_LAYERS_DISTANCE 
+								? clamp(u32(fur.layers * FUR_FULL_LAYERS_DISTANCE / dist), 1u, fur.layers)
+								: fur.layers;
 							prefix->fur_scale = fur.scale;
 							prefix->gravity = fur.gravity;
 						}
@@ -2774,17 +3568,8 @@ struct PipelineImpl final : Pipeline {
 
 						const Vec3 prev_rel_pos = Vec3(mi->prev_frame_transform.pos - camera_pos);
 						prefix->prev_model_mtx = Matrix(prev_rel_pos, mi->prev_frame_transform.rot, mi->prev_frame_transform.scale);
-
-						const Quat* rotations = mi->pose->rotations;
-						const Vec3* positions = mi->pose->positions;
-						Model& model = *mi->model;
-
-						DualQuat* bones_ub_array = (DualQuat*)(ub.ptr + sizeof(UBPrefix));
-						for (int j = 0, c = mi->pose->count; j < c; ++j) {
-							const Model::Bone& bone = model.getBone(j);
-							const LocalRigidTransform tmp = {positions[j], rotations[j]};
-							bones_ub_array[j] = (tmp * bone.inv_bind_transform).toDualQuat();
-						}
+						prefix->bones = palette.buffer;
+						prefix->bones_offset = palette.offset;
 
 						const Material* material = mesh_mat.material;
 						prefix->material_index = material->getIndex();
@@ -2937,6 +3722,11 @@ struct PipelineImpl final : Pipeline {
 		return float(fov * lr3 / length(cam_pos - light_pos));
 	};
 
+	// decals with the builtin shader do not need their own draw calls, they are binned to clusters instead
+	bool isClusteredDecal(const Material& material) const {
+		return material.getShader() == m_decal_shader && m_decal_shader->isReady();
+	}
+
 	void fillClusters(DrawStream& stream, const CameraParams& cp) {
 		PROFILE_FUNCTION();
 		ASSERT(cp.frustum.xs[0] == cp.frustum.xs[0]);
@@ -2957,6 +3747,17 @@ struct PipelineImpl final : Pipeline {
 			u32 lights_count;
 			u32 env_probes_count;
 			u32 refl_probes_count;
+			u32 decals_count;
+		};
+
+		struct ClusterDecal {
+			Vec3 pos;
+			MaterialIndex material_index;
+			Quat rot;
+			Vec3 half_extents;
+			float pad0;
+			Vec2 uv_scale;
+			Vec2 pad1;
 		};
 
 		struct ClusterEnvProbe {
@@ -2978,7 +3779,7 @@ struct PipelineImpl final : Pipeline {
 			float pad1;
 		};
 
-		ArenaAllocator& frame_allocator = m_renderer.getCurrentFrameAllocator();
+		FrameArena& frame_allocator = m_renderer.getCurrentFrameAllocator();
 		const IVec3 size(
 			(m_viewport.w + 63) / 64,
 			(m_viewport.h + 63) / 64,
@@ -3035,6 +3836,21 @@ struct PipelineImpl final : Pipeline {
 		if (!m_shadow_atlas.texture && atlas_sorter.count > 0) {
 			m_shadow_atlas.texture = m_renderer.createTexture(ShadowAtlas::SIZE, ShadowAtlas::SIZE, 1, gpu::TextureFormat::D32, gpu::TextureFlags::NO_MIPS | gpu::TextureFlags::COMPUTE_WRITE, Renderer::MemRef(), "shadow_atlas");
 		}
+		// static casters changed, cached shadows they touch must be rerendered
+		for (const ShadowCasterChange& change : m_module->getShadowCasterChanges()) {
+			for (u32 i = 0; i < lengthOf(m_shadow_atlas.inv_map); ++i) {
+				if (!m_shadow_atlas.inv_map[i].isValid()) continue;
+				if (m_shadow_atlas.baked[i] == ShadowAtlas::Baked::NONE) continue;
+				
+				const EntityRef light_entity = (EntityRef)m_shadow_atlas.inv_map[i];
+				const float range = m_module->getPointLight(light_entity).range;
+				const double max_dist = range + change.radius;
+				if (squaredLength(world.getPosition(light_entity) - change.pos) < max_dist * max_dist) {
+					m_shadow_atlas.baked[i] = ShadowAtlas::Baked::NONE;
+				}
+			}
+		}
+
 		Matrix shadow_atlas_matrices[128];
 		for (u32 i = 0; i < atlas_sorter.count; ++i) {
 			ClusterLight& light = lights[atlas_sorter.lights[i].idx];
@@ -3042,17 +3858,52 @@ struct PipelineImpl final : Pipeline {
 			PointLight& pl = m_module->getPointLight(e);
 			if (light.atlas_idx == -1) {
 				light.atlas_idx = m_shadow_atlas.add(ShadowAtlas::getGroup(i), e);
-				bakeShadow(pl, light.atlas_idx);
 			}
-			else if (pl.flags & PointLight::DYNAMIC) {
-				bakeShadow(pl, light.atlas_idx);
+			ShadowAtlas::Baked& baked = m_shadow_atlas.baked[light.atlas_idx];
+			if (pl.flags & PointLight::DYNAMIC) {
+				// static casters are cached, so only dynamic casters are rendered every frame
+				if (!m_shadow_atlas.static_texture) {
+					m_shadow_atlas.static_texture = m_renderer.createTexture(ShadowAtlas::SIZE, ShadowAtlas::SIZE, 1, gpu::TextureFormat::D32, gpu::TextureFlags::NO_MIPS | gpu::TextureFlags::COMPUTE_WRITE, Renderer::MemRef(), "shadow_atlas_static");
+				}
+				if (baked != ShadowAtlas::Baked::STATIC) {
+					if (bakeShadow(pl, light.atlas_idx, CasterFilter::STATIC, m_shadow_atlas.static_texture)) baked = ShadowAtlas::Baked::STATIC;
+				}
+				if (bakeShadow(pl, light.atlas_idx, CasterFilter::DYNAMIC, m_shadow_atlas.texture)) compositeShadow(light.atlas_idx);
+			}
+			else if (baked != ShadowAtlas::Baked::ALL) {
+				if (bakeShadow(pl, light.atlas_idx, CasterFilter::ALL, m_shadow_atlas.texture)) baked = ShadowAtlas::Baked::ALL;
 			}
 			shadow_atlas_matrices[light.atlas_idx] = getShadowMatrix(pl, light.atlas_idx);
 		}
 		const Renderer::TransientSlice shadow_matrices_ub = m_renderer.allocUniform(&shadow_atlas_matrices, sizeof(shadow_atlas_matrices));
 		stream.bindUniformBuffer(UniformBuffer::SHADOW, shadow_matrices_ub.buffer, shadow_matrices_ub.offset, shadow_matrices_ub.size);
 
-		m_renderer.pushJob("fill clusters", [clusters_count, clusters, lights, lights_count, cam_pos, &world, size, cp, this, &frame_allocator](DrawStream& stream){
+		CullResult* decal_entities = m_module->getRenderables(cp.frustum, RenderableTypes::DECAL);
+		const u32 max_decals = decal_entities ? decal_entities->count() : 0;
+		EntityRef* sorted_decals = (EntityRef*)frame_allocator.allocate(sizeof(EntityRef) * max_decals, alignof(EntityRef));
+		u32 decals_count = 0;
+		if (decal_entities) {
+			decal_entities->forEach([&](EntityRef e){
+				if (isClusteredDecal(*m_module->getDecal(e).material)) sorted_decals[decals_count++] = e;
+			});
+			decal_entities->free(m_renderer.getEngine().getPageAllocator());
+		}
+		// stable order, so overlapping decals do not flicker
+		sort(sorted_decals, sorted_decals + decals_count, [](EntityRef a, EntityRef b){ return a.index < b.index; });
+		ClusterDecal* decals = (ClusterDecal*)frame_allocator.allocate(sizeof(ClusterDecal) * decals_count, alignof(ClusterDecal));
+		for (u32 i = 0; i < decals_count; ++i) {
+			const EntityRef e = sorted_decals[i];
+			const Decal& decal = m_module->getDecal(e);
+			ClusterDecal& d = decals[i];
+			d.pos = Vec3(world.getPosition(e) - cam_pos);
+			d.rot = world.getRotation(e).conjugated();
+			d.half_extents = decal.half_extents;
+			d.uv_scale = decal.uv_scale;
+			d.material_index = decal.material->getIndex();
+		}
+		m_clustered_decals_count = decals_count;
+
+		m_renderer.pushJob("fill clusters", [clusters_count, clusters, lights, lights_count, decals, decals_count, cam_pos, &world, size, cp, this, &frame_allocator](DrawStream& stream){
 			auto bind = [](auto& buffer, const void* data, u32 size, DrawStream& stream, const char* debug_name){
 				if (!size) return;
 				const u32 capacity = (size + 15) & ~15;
@@ -3075,6 +3926,7 @@ struct PipelineImpl final : Pipeline {
 			Vec4 xplanes[65];
 			Vec4 yplanes[65];
 			Vec4 zplanes[17];
+			float zdists[17];
 	
 			const Vec3 cam_dir = normalize(cross(frustum.points[2] - frustum.points[0], frustum.points[1] - frustum.points[0]));
 		
@@ -3085,6 +3937,7 @@ struct PipelineImpl final : Pipeline {
 				const float z = znear * powf(zfar / znear, i / (float)size.z);
 				const Vec3 p = cam_dir * z;
 				zplanes[i] = makePlane(cam_dir, p);
+				zdists[i] = z;
 			}
 	
 			for (i32 i = 0; i < size.y + 1; ++i) {
@@ -3171,13 +4024,49 @@ struct PipelineImpl final : Pipeline {
 				return range;
 			};
 	
-			// TODO tighter fit
-			auto for_each_light_pair = [&](auto f){
+			IVec2* light_zranges = (IVec2*)frame_allocator.allocate(sizeof(IVec2) * lights_count, alignof(IVec2));
+			jobs::forEach(lights_count, 256, [&](u32 from, u32 to){
+				for (u32 i = from; i < to; ++i) {
+					light_zranges[i] = range(lights[i].pos, lights[i].radius, size.z, zplanes);
+				}
+			});
+
+			// clusters in depth slice `z` are touched only by the job processing that slice, so slices can run in parallel
+			auto for_each_light_pair = [&](i32 z, auto f){
 				for (i32 i = 0, c = lights_count; i < c; ++i) {
+					if (z < light_zranges[i].x || z >= light_zranges[i].y) continue;
+
 					ClusterLight& light = lights[i];
 					const float r = light.radius;
 					const Vec3 p = light.pos;
+					const float light_z = dot(cam_dir, p);
 	
+					// part of the light's sphere in this depth slice fits in a smaller sphere on the slice's boundary
+					// so lights do not get into clusters near the corners of their bounding box
+					float d = 0;
+					if (light_z < zdists[z]) d = zdists[z] - light_z;
+					else if (light_z > zdists[z + 1]) d = zdists[z + 1] - light_z;
+					const Vec3 slice_p = p + cam_dir * d;
+					const float slice_r = sqrtf(maximum(0.f, r * r - d * d));
+
+					const IVec2 xrange = range(slice_p, slice_r, size.x, xplanes);
+					const IVec2 yrange = range(slice_p, slice_r, size.y, yplanes);
+
+					for (i32 y = yrange.x; y < yrange.y; ++y) {
+						for (i32 x = xrange.x; x < xrange.y; ++x) {
+							const u32 idx = x + y * size.x + z * size.x * size.y;
+							Cluster& cluster = clusters[idx];
+							f(cluster, i);
+						}
+					}
+				}
+			};
+		
+			auto for_each_env_probe_pair = [&](auto f){
+				for (i32 i = 0, c = module_env_probes.length(); i < c; ++i) {
+					const Vec3 p = env_probes[i].pos;
+					const float r = length(env_probes[i].outer_range);
+			
 					const IVec2 xrange = range(p, r, size.x, xplanes);
 					const IVec2 yrange = range(p, r, size.y, yplanes);
 					const IVec2 zrange = range(p, r, size.z, zplanes);
@@ -3193,11 +4082,11 @@ struct PipelineImpl final : Pipeline {
 					}
 				}
 			};
-		
-			auto for_each_env_probe_pair = [&](auto f){
-				for (i32 i = 0, c = module_env_probes.length(); i < c; ++i) {
-					const Vec3 p = env_probes[i].pos;
-					const float r = length(env_probes[i].outer_range);
+	
+			auto for_each_refl_probe_pair = [&](auto f){
+				for (i32 i = 0, c = module_refl_probes.length(); i < c; ++i) {
+					const Vec3 p = refl_probes[i].pos;
+					const float r = length(refl_probes[i].half_extents);
 			
 					const IVec2 xrange = range(p, r, size.x, xplanes);
 					const IVec2 yrange = range(p, r, size.y, yplanes);
@@ -3215,10 +4104,10 @@ struct PipelineImpl final : Pipeline {
 				}
 			};
 	
-			auto for_each_refl_probe_pair = [&](auto f){
-				for (i32 i = 0, c = module_refl_probes.length(); i < c; ++i) {
-					const Vec3 p = refl_probes[i].pos;
-					const float r = length(refl_probes[i].half_extents);
+			auto for_each_decal_pair = [&](auto f){
+				for (i32 i = 0, c = decals_count; i < c; ++i) {
+					const Vec3 p = decals[i].pos;
+					const float r = length(decals[i].half_extents);
 			
 					const IVec2 xrange = range(p, r, size.x, xplanes);
 					const IVec2 yrange = range(p, r, size.y, yplanes);
@@ -3236,8 +4125,11 @@ struct PipelineImpl final : Pipeline {
 				}
 			};
 	
-			for_each_light_pair([](Cluster& cluster, i32 light_idx){
-				++cluster.lights_count;
+			jobs::forEach(size.z, 1, [&](i32 z, i32){
+				PROFILE_BLOCK("count lights");
+				for_each_light_pair(z, [](Cluster& cluster, i32 light_idx){
+					++cluster.lights_count;
+				});
 			});
 	
 			for_each_env_probe_pair([](Cluster& cluster, i32){
@@ -3247,19 +4139,26 @@ struct PipelineImpl final : Pipeline {
 			for_each_refl_probe_pair([](Cluster& cluster, i32){
 				++cluster.refl_probes_count;
 			});
+
+			for_each_decal_pair([](Cluster& cluster, i32){
+				++cluster.decals_count;
+			});
 	
 			u32 offset = 0;
 			for (u32 i = 0; i < clusters_count; ++i) {
 				Cluster& cluster = clusters[i];
 				cluster.offset = offset;
-				offset += cluster.lights_count + cluster.env_probes_count + cluster.refl_probes_count;
+				offset += cluster.lights_count + cluster.env_probes_count + cluster.refl_probes_count + cluster.decals_count;
 			}
 		
 			i32* map = (i32*)frame_allocator.allocate(offset * sizeof(i32), alignof(i32));
 	
-			for_each_light_pair([&](Cluster& cluster, i32 light_idx){
-				map[cluster.offset] = light_idx;
-				++cluster.offset;
+			jobs::forEach(size.z, 1, [&](i32 z, i32){
+				PROFILE_BLOCK("map lights");
+				for_each_light_pair(z, [&](Cluster& cluster, i32 light_idx){
+					map[cluster.offset] = light_idx;
+					++cluster.offset;
+				});
 			});
 	
 			for_each_env_probe_pair([&](Cluster& cluster, i32 probe_idx){
@@ -3271,10 +4170,15 @@ struct PipelineImpl final : Pipeline {
 				map[cluster.offset] = probe_idx;
 				++cluster.offset;
 			});
+
+			for_each_decal_pair([&](Cluster& cluster, i32 decal_idx){
+				map[cluster.offset] = decal_idx;
+				++cluster.offset;
+			});
 	
 			for (u32 i = 0; i < clusters_count; ++i) {
 				Cluster& cluster = clusters[i];
-				cluster.offset -= cluster.lights_count + cluster.env_probes_count + cluster.refl_probes_count;
+				cluster.offset -= cluster.lights_count + cluster.env_probes_count + cluster.refl_probes_count + cluster.decals_count;
 			}
 		
 			bind(m_cluster_buffers.lights, lights, lights_count * sizeof(lights[0]), stream, "lights");
@@ -3282,13 +4186,15 @@ struct PipelineImpl final : Pipeline {
 			bind(m_cluster_buffers.maps, map, offset * sizeof(i32), stream, "cluster_map");
 			bind(m_cluster_buffers.env_probes, env_probes, module_env_probes.length() * sizeof(env_probes[0]), stream, "env_probes");
 			bind(m_cluster_buffers.refl_probes, refl_probes, module_refl_probes.length() * sizeof(refl_probes[0]), stream, "refl_probes");
+			bind(m_cluster_buffers.decals, decals, decals_count * sizeof(decals[0]), stream, "decals");
 			gpu::BufferHandle sbs[] = {
 				m_cluster_buffers.lights.buffer,
 				m_cluster_buffers.clusters.buffer,
 				m_cluster_buffers.maps.buffer,
 				m_cluster_buffers.env_probes.buffer,
 				m_cluster_buffers.refl_probes.buffer,
-				m_renderer.getMaterialUniformBuffer()
+				m_renderer.getMaterialUniformBuffer(),
+				m_cluster_buffers.decals.buffer
 			};
 			stream.bindShaderBuffers(sbs);
 		});
@@ -3343,14 +4249,14 @@ struct PipelineImpl final : Pipeline {
 		PagedListIterator<const CullResult> iterator(view.renderables);
 
 		view.instancers.reserve(jobs::getWorkersCount());
-		ArenaAllocator& allocator = m_renderer.getCurrentFrameAllocator();
+		FrameArena& allocator = m_renderer.getCurrentFrameAllocator();
 		for (u8 i = 0; i < jobs::getWorkersCount(); ++i) {
 			view.instancers.emplace(allocator, m_renderer.getEngine().getPageAllocator());
 		}
 
-		const float global_lod_multiplier = m_renderer.getLODMultiplier();
-		const float global_lod_multiplier_rcp = 1 / global_lod_multiplier;
-		const float time_delta = m_renderer.getEngine().getLastTimeDelta();
+		// LOD is selected by projected size, squared distances are relative to the main camera, even in shadow views, so we use its FOV
+		const float lod_distance_scale = m_module->getCameraLODMultiplier(m_viewport.fov, m_viewport.is_ortho) / m_renderer.getLODMultiplier();
+		const float lod_fade = m_renderer.getEngine().getLastTimeDelta() * LOD_CROSSFADE_SPEED;
 		AtomicI32 worker_idx = 0;
 
 		u32 bucket_map[255];
@@ -3367,9 +4273,12 @@ struct PipelineImpl final : Pipeline {
 			PROFILE_BLOCK("create keys");
 			int total = 0;
 			ModelInstance* LUMIX_RESTRICT model_instances = m_module->getModelInstances().begin();
-			const Transform* LUMIX_RESTRICT transforms = m_module->getWorld().getTransforms();
+			const Transform* LUMIX_RESTRICT transforms = m_module->getWorld().getRenderTransforms();
 			const DVec3 camera_pos = view.cp.pos;
-			const DVec3 lod_ref_point = m_viewport.pos;
+			const bool texture_streaming = !view.cp.is_shadow && m_renderer.isTextureStreaming();
+			const HiZCPU* hiz = view.occlusion_culling && m_hiz_cpu.size.x > 0 ? &m_hiz_cpu : nullptr;
+			// fur is not rendered in shadows
+			const HashMap<EntityRef, Fur>* furs = view.cp.is_shadow || m_module->getFurs().empty() ? nullptr : &m_module->getFurs();
 			Sorter::Inserter inserter(view.sorter);
 
 			const i32 instancer_idx = worker_idx.inc();
@@ -3381,8 +4290,12 @@ struct PipelineImpl final : Pipeline {
 				if(!page) break;
 				total += page->header.count;
 				const EntityRef* LUMIX_RESTRICT renderables = page->entities;
+				// computed by culling, relative to main camera
+				const float* LUMIX_RESTRICT squared_distances = page->squared_distances;
 				const RenderableTypes type = (RenderableTypes)page->header.type;
 				const u64 type_mask = (u64)type << 32;
+				if (view.caster_filter == CasterFilter::STATIC && type == RenderableTypes::SKINNED) continue;
+				if (view.caster_filter == CasterFilter::DYNAMIC && type == RenderableTypes::MESH) continue;
 				
 				switch(type) {
 					case RenderableTypes::LOCAL_LIGHT: break;
@@ -3390,6 +4303,8 @@ struct PipelineImpl final : Pipeline {
 						for (int i = 0, c = page->header.count; i < c; ++i) {
 							const EntityRef e = renderables[i];
 							const Material* material = m_module->getDecal(e).material;
+							// rendered in one pass in geometry pass
+							if (isClusteredDecal(*material)) continue;
 							const int layer = material->getLayer();
 							const u8 bucket = bucket_map[layer];
 							if (bucket < 0xff) {
@@ -3418,17 +4333,36 @@ struct PipelineImpl final : Pipeline {
 							const DVec3 pos = transforms[e.index].pos;
 							ModelInstance& mi = model_instances[e.index];
 							
-							const float squared_length = float(squaredLength(pos - lod_ref_point));
-							const u32 lod_idx = mi.model->getLODMeshIndices(squared_length * global_lod_multiplier_rcp);
+							const float squared_length = squared_distances[i];
+							const Vec3 scale = transforms[e.index].scale;
+							const float max_scale = maximum(scale.x, scale.y, scale.z, 1e-5f);
+							const u32 lod_idx = mi.model->getLODMeshIndices(squared_length * lod_distance_scale / (max_scale * max_scale), mi.lod_target);
+							if (!view.cp.is_shadow) mi.lod_target = (u8)lod_idx;
 
 							if (mi.dirty) {
 								queueMaterialOverrideRefresh(e);
 								continue;
 							}
+							// finer LODs might not be loaded, don't blend with them
+							const float resident_lod = float(mi.model->getResidentLOD());
+							if (mi.lod < resident_lod) mi.lod = resident_lod;
+
+							// distance to bounding sphere, so big meshes get full resolution textures when camera is close to their surface
+							const float streaming_distance = texture_streaming 
+								? maximum(0.f, sqrtf(squared_length) - mi.model->getOriginBoundingRadius() * max_scale)
+								: 0;
+							if (hiz && hiz->isOccluded(pos, mi.model->getOriginBoundingRadius() * max_scale)) continue;
+
+							bool has_fur = false;
+							if (furs) {
+								auto fur_iter = furs->find(e);
+								has_fur = fur_iter.isValid() && fur_iter.value().enabled;
+							}
 
 							auto create_key = [&](const LODMeshIndices& lod){
 								for (int mesh_idx = lod.from; mesh_idx <= lod.to; ++mesh_idx) {
 									const MeshMaterial& mesh_mat = mi.mesh_materials[mesh_idx];
+									if (texture_streaming) mesh_mat.material->requestStreaming(streaming_distance);
 									const u8 layer = mesh_mat.material->getLayer();
 									const u32 mesh_sort_key = mesh_mat.sort_key;
 									const u32 bucket = bucket_map[layer];
@@ -3436,6 +4370,10 @@ struct PipelineImpl final : Pipeline {
 									if (bucket < 0xff) {
 										const u64 key = mesh_sort_key | ((u64)bucket << SORT_KEY_BUCKET_SHIFT);
 										inserter.push(key, subrenderable);
+										if (has_fur && mi.meshes[mesh_idx].type == Mesh::SKINNED) {
+											const u64 fur_subrenderable = e.index | ((u64)RenderableTypes::FUR << 32) | ((u64)mesh_idx << SORT_KEY_MESH_IDX_SHIFT);
+											inserter.push(key, fur_subrenderable);
+										}
 									} else if (bucket < 0xffFF) {
 										const DVec3 pos = transforms[e.index].pos;
 										const DVec3 rel_pos = pos - camera_pos;
@@ -3456,12 +4394,12 @@ struct PipelineImpl final : Pipeline {
 									const float d = lod_idx - mi.lod;
 									const float ad = fabsf(d);
 									
-									if (ad <= time_delta) {
+									if (ad <= lod_fade) {
 										mi.lod = float(lod_idx);
 										create_key(mi.model->getLODIndices()[lod_idx]);
 									}
 									else {
-										mi.lod += d / ad * time_delta;
+										mi.lod += d / ad * lod_fade;
 										const u32 cur_lod_idx = u32(mi.lod);
 										create_key(mi.model->getLODIndices()[cur_lod_idx]);
 										if (cur_lod_idx < 3) create_key(mi.model->getLODIndices()[cur_lod_idx + 1]);
@@ -3482,17 +4420,30 @@ struct PipelineImpl final : Pipeline {
 							const DVec3 pos = transforms[e.index].pos;
 							ModelInstance& mi = model_instances[e.index];
 
-							const float squared_length = float(squaredLength(pos - lod_ref_point));
-							const u32 lod_idx = mi.model->getLODMeshIndices(squared_length * global_lod_multiplier_rcp);
+							const float squared_length = squared_distances[i];
+							const Vec3 scale = transforms[e.index].scale;
+							const float max_scale = maximum(scale.x, scale.y, scale.z, 1e-5f);
+							const u32 lod_idx = mi.model->getLODMeshIndices(squared_length * lod_distance_scale / (max_scale * max_scale), mi.lod_target);
+							if (!view.cp.is_shadow) mi.lod_target = (u8)lod_idx;
 
 							if (mi.dirty) {
 								queueMaterialOverrideRefresh(e);
 								continue;
 							}
+							// finer LODs might not be loaded, don't blend with them
+							const float resident_lod = float(mi.model->getResidentLOD());
+							if (mi.lod < resident_lod) mi.lod = resident_lod;
+
+							// distance to bounding sphere, so big meshes get full resolution textures when camera is close to their surface
+							const float streaming_distance = texture_streaming 
+								? maximum(0.f, sqrtf(squared_length) - mi.model->getOriginBoundingRadius() * max_scale)
+								: 0;
+							if (hiz && hiz->isOccluded(pos, mi.model->getOriginBoundingRadius() * max_scale)) continue;
 
 							auto create_key = [&](const LODMeshIndices& lod){
 								for (int mesh_idx = lod.from; mesh_idx <= lod.to; ++mesh_idx) {
 									const MeshMaterial& mesh_mat = mi.mesh_materials[mesh_idx];
+									if (texture_streaming) mesh_mat.material->requestStreaming(streaming_distance);
 									const u32 bucket = bucket_map[mesh_mat.material->getLayer()];
 									const u32 mesh_sort_key = mesh_mat.sort_key;
 									const u64 subrenderable = e.index | type_mask | ((u64)mesh_idx << SORT_KEY_MESH_IDX_SHIFT);
@@ -3520,12 +4471,12 @@ struct PipelineImpl final : Pipeline {
 								const float d = lod_idx - mi.lod;
 								const float ad = fabsf(d);
 									
-								if (ad <= time_delta) {
+								if (ad <= lod_fade) {
 									mi.lod = float(lod_idx);
 									create_key(mi.model->getLODIndices()[lod_idx]);
 								}
 								else {
-									if (!is_shadow) mi.lod += d / ad * time_delta;
+									if (!is_shadow) mi.lod += d / ad * lod_fade;
 									const u32 cur_lod_idx = u32(mi.lod);
 									create_key(mi.model->getLODIndices()[cur_lod_idx]);
 									if (cur_lod_idx < 3) create_key(mi.model->getLODIndices()[cur_lod_idx + 1]);
@@ -3538,7 +4489,8 @@ struct PipelineImpl final : Pipeline {
 						}
 						break;
 					}
-					case RenderableTypes::PARTICLES:
+					// sort keys for particles are created in setupParticles
+					case RenderableTypes::PARTICLES: break;
 					case RenderableTypes::FUR:
 					case RenderableTypes::COUNT:
 						ASSERT(false);
@@ -3607,115 +4559,6 @@ struct PipelineImpl final : Pipeline {
 		});
 	}
 
-	struct Histogram {
-		static constexpr u32 BITS = 11;
-		static constexpr u32 SIZE = 1 << BITS;
-		static constexpr u32 BIT_MASK = SIZE - 1;
-		static constexpr i32 STEP = 4096;
-
-		u32 m_histogram[SIZE];
-		bool m_sorted;
-		jobs::Mutex m_cs;
-
-		void compute(const u64* keys, const u64* values, int size, u16 shift) {
-			memset(m_histogram, 0, sizeof(m_histogram));
-			m_sorted = true;
-
-			AtomicI32 counter = 0;
-			auto work = [&](){
-				PROFILE_BLOCK("compute histogram");
-				u32 histogram[SIZE];
-				bool sorted = true;
-				memset(histogram, 0, sizeof(histogram));
-
-				i32 begin = counter.add(STEP);
-
-				while (begin < size) {
-					const i32 end = minimum(size, begin + STEP);
-
-					u64 key = begin > 0 ? keys[begin - 1] : keys[0];
-					u64 prev_key = key;
-					for (i32 i = begin; i < end; ++i) {
-						key = keys[i];
-						const u16 index = (key >> shift) & BIT_MASK;
-						++histogram[index];
-						sorted &= prev_key <= key;
-						prev_key = key;
-					}
-					begin = counter.add(STEP);
-				}
-
-				jobs::MutexGuard lock(m_cs);
-				m_sorted &= sorted;
-				for (u32 i = 0; i < lengthOf(m_histogram); ++i) {
-					m_histogram[i] += histogram[i]; 
-				}
-			};
-
-			if (size < STEP) {
-				work();
-			}
-			else {
-				jobs::runOnWorkers(work);
-			}
-		}
-	};
-
-
-	void radixSort(u64* _keys, u64* _values, int size) {
-		PROFILE_FUNCTION();
-		profiler::pushInt("count", size);
-		if (size == 0) return;
-
-		Array<u64> tmp_mem(m_allocator);
-
-		u64* keys = _keys;
-		u64* values = _values;
-		u64* tmp_keys = nullptr;
-		u64* tmp_values = nullptr;
-
-		Histogram histogram;
-		u16 shift = 0;
-
-		for (int pass = 0; pass < 6; ++pass) {
-			histogram.compute(keys, values, size, shift);
-
-			if (histogram.m_sorted) {
-				if (pass & 1) {
-					memcpy(_keys, tmp_mem.begin(), tmp_mem.byte_size() / 2);
-					memcpy(_values, &tmp_mem[size], tmp_mem.byte_size() / 2);
-				}
-				return;
-			}
-
-			if (!tmp_keys) {
-				tmp_mem.resize(size * 2);
-				tmp_keys = tmp_mem.begin();
-				tmp_values = &tmp_mem[size];
-			}
-
-			u32 offset = 0;
-			for (int i = 0; i < Histogram::SIZE; ++i) {
-				const u32 count = histogram.m_histogram[i];
-				histogram.m_histogram[i] = offset;
-				offset += count;
-			}
-
-			for (int i = 0; i < size; ++i) {
-				const u64 key = keys[i];
-				const u16 index = (key >> shift) & Histogram::BIT_MASK;
-				const u32 dest = histogram.m_histogram[index]++;
-				tmp_keys[dest] = key;
-				tmp_values[dest] = values[i];
-			}
-
-			swap(tmp_keys, keys);
-			swap(tmp_values, values);
-
-			shift += Histogram::BITS;
-		}
-	}
-
 	void viewport(int x, int y, int w, int h) override {
 		DrawStream& stream = m_renderer.getDrawStream();
 		stream.viewport(x, y, w, h);
@@ -3742,8 +4585,9 @@ struct PipelineImpl final : Pipeline {
 		return m_module->getEnvironmentCastShadows((EntityRef)env);
 	}
 
-	float getRenderToDisplayRatio() const { return m_render_to_display_scale; }
-	void setRenderToDisplayRatio(float scale) { m_render_to_display_scale = scale; }
+	float getRenderToDisplayRatio() const override { return m_render_to_display_scale; }
+	void setRenderToDisplayRatio(float scale) override { m_render_to_display_scale = clamp(scale, 1.f, MAX_RENDER_TO_DISPLAY_RATIO); }
+	void setDynamicResolutionTarget(float seconds) override { m_dynamic_resolution_target = seconds; }
 
 	void clearDraw2D() override { return m_draw2d.clear(getAtlasSize()); }
 	Draw2D& getDraw2D() override { return m_draw2d; }
@@ -3765,9 +4609,11 @@ struct PipelineImpl final : Pipeline {
 	Draw2D m_draw2d;
 	Shader* m_tonemap_shader = nullptr;
 	Shader* m_blit_shader = nullptr;
+	Shader* m_upscale_shader = nullptr;
 	Shader* m_lighting_shader = nullptr;
 	Shader* m_draw2d_shader = nullptr;
 	Shader* m_downscale_depth_shader = nullptr;
+	Shader* m_hiz_shader = nullptr;
 	gpu::ProgramHandle m_blit_screen_program = gpu::INVALID_PROGRAM;
 	Array<UniquePtr<View>> m_views;
 	jobs::Signal m_buckets_ready;
@@ -3776,15 +4622,28 @@ struct PipelineImpl final : Pipeline {
 	Viewport m_prev_viewport;
 	IVec2 m_display_size;
 	float m_render_to_display_scale = 1;
+	float m_dynamic_resolution_target = 1 / 60.f;
+	// smoothed GPU frame time
+	float m_dynamic_resolution_gpu_time = 0;
+	u32 m_dynamic_resolution_last_change = 0;
 	float m_indirect_light_multiplier = 1;
 	bool m_first_set_viewport = true;
 	RenderBufferHandle m_output = INVALID_RENDERBUFFER;
 	RenderBufferHandle m_downscaled_depth = INVALID_RENDERBUFFER;
+	HiZ m_hiz;
+	HiZReadback* m_hiz_readback;
+	u32 m_hiz_read_id = 0;
+	// used by CPU culling of the current frame, only touched when no culling job is running
+	HiZCPU m_hiz_cpu;
 	Shader* m_debug_shape_shader;
 	Shader* m_debug_clusters_shader;
 	Shader* m_debug_velocity_shader;
 	Shader* m_instancing_shader;
+	Shader* m_terrain_lod_shader;
 	Shader* m_flatten_shader;
+	Shader* m_shadow_composite_shader;
+	// decals with this shader are clustered, see isClusteredDecal
+	Shader* m_decal_shader;
 	Array<gpu::TextureHandle> m_textures;
 	Array<gpu::BufferHandle> m_buffers;
 	os::Timer m_timer;
@@ -3811,11 +4670,20 @@ struct PipelineImpl final : Pipeline {
 		Buffer maps;
 		Buffer env_probes;
 		Buffer refl_probes;
+		Buffer decals;
 	} m_cluster_buffers;
+	// number of decals in m_cluster_buffers, drawn in geometry pass
+	u32 m_clustered_decals_count = 0;
 	Viewport m_shadow_camera_viewports[4];
+	// see Renderer::isLazyShadowCascades
+	RenderBufferHandle m_cached_shadowmap = INVALID_RENDERBUFFER;
+	bool m_shadow_slice_updated[4] = {};
+	float m_shadow_slice_radius[4] = {};
 	GlobalState m_global_state;
 	Array<EntityRef> m_material_override_refresh_queue;
 	jobs::Mutex m_material_override_refresh_mutex;
+	// indexed by entity.index, see prepareSkinningPalettes
+	Array<SkinningPalette> m_skinning_palettes;
 };
 
 
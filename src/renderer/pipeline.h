@@ -39,6 +39,19 @@ struct PassState {
 	Vec4 shadow_to_camera;
 };
 
+// drawcall uniforms of skinned meshes, see ModelState in surface_base.hlsli
+struct SkinnedDrawcallUniforms {
+	float fur_scale;
+	float gravity;
+	float layers;
+	MaterialIndex material_index;
+	Matrix model_mtx;
+	Matrix prev_model_mtx;
+	// buffer with DualQuat per bone, see computeSkinningPalette
+	gpu::BindlessHandle bones;
+	u32 bones_offset;
+};
+
 namespace UniformBuffer {
 	enum Enum {
 		GLOBAL,
@@ -86,6 +99,8 @@ struct LUMIX_RENDERER_API Pipeline {
 	virtual ~Pipeline() {}
 
 	virtual bool render(bool only_2d) = 0;
+	// call instead of render() to keep the previous output, drops debug shapes and 2D draws queued for the frame
+	virtual void skipRender() = 0;
 	virtual void render3DUI(EntityRef e, const struct Draw2D& drawdata, Vec2 canvas_size, bool orient_to_cam) = 0;
 	virtual void setWorld(struct World* world) = 0;
 	virtual RenderModule* getModule() const = 0;
@@ -93,6 +108,11 @@ struct LUMIX_RENDERER_API Pipeline {
 	virtual void setViewport(const Viewport& viewport) = 0;
 	virtual const Viewport& getViewport() = 0;
 	virtual const IVec2& getDisplaySize() const = 0;
+	// internal resolution is display size / ratio, AA plugins upscale to display size, see RenderPlugin::renderAA
+	virtual float getRenderToDisplayRatio() const = 0;
+	virtual void setRenderToDisplayRatio(float ratio) = 0;
+	// with Renderer::isDynamicResolution, render to display ratio is adjusted every frame to hold this GPU frame time
+	virtual void setDynamicResolutionTarget(float seconds) = 0;
 	virtual void setIndirectLightMultiplier(float value) = 0;
 	virtual void enablePixelJitter(bool enable) = 0;
 	virtual void setClearColor(Vec3 color) = 0;
@@ -31,11 +31,16 @@ void Pose::blend(Pose& rhs, float weight)
 	ASSERT(count == rhs.count);
 	if (weight <= 0.001f) return;
 	weight = clamp(weight, 0.0f, 1.0f);
-	float inv = 1.0f - weight;
-	for (int i = 0, c = count; i < c; ++i)
-	{
-		positions[i] = positions[i] * inv + rhs.positions[i] * weight;
-		rotations[i] = nlerp(rotations[i], rhs.rotations[i], weight);
+	lerp(positions, rhs.positions, positions, count, weight);
+	nlerp(rotations, rhs.rotations, rotations, count, weight);
+}
+
+
+void computeSkinningPalette(const Model& model, const Pose& pose, DualQuat* out) {
+	for (u32 i = 0, c = pose.count; i < c; ++i) {
+		const Model::Bone& bone = model.getBone(i);
+		const LocalRigidTransform tmp = {pose.positions[i], pose.rotations[i]};
+		out[i] = (tmp * bone.inv_bind_transform).toDualQuat();
 	}
 }
 
@@ -43,6 +48,9 @@ void Pose::blend(Pose& rhs, float weight)
 void Pose::resize(int count)
 {
 	is_absolute = false;
+	// e.g. reloaded model with the same skeleton
+	if (u32(count) == this->count) return;
+
 	allocator.deallocate(positions);
 	allocator.deallocate(rotations);
 	this->count = count;
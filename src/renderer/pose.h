@@ -8,6 +8,7 @@ namespace Lumix
 {
 
 
+struct DualQuat;
 struct IAllocator;
 struct Matrix;
 struct Model;
@@ -37,4 +38,8 @@ struct LUMIX_RENDERER_API Pose
 };
 
 
+// bone transforms used for skinning, i.e. pose * inverse bind pose; `out` must have room for `pose.count` elements
+LUMIX_RENDERER_API void computeSkinningPalette(const Model& model, const Pose& pose, DualQuat* out);
+
+
 } // namespace Lumix
@@ -11,13 +11,71 @@
 
 namespace Lumix {
 
+// UI for downscale setting of postprocess effects, 0 - full resolution, 1 - half, 2 - quarter
+static void downscaleUI(u32& downscale) {
+	const char* downscale_values[] = { "Disabled", "2x", "4x" };
+	ImGui::TextUnformatted("Downscale");
+	for (const char*& v : downscale_values) {
+		const u32 idx = u32(&v - downscale_values);
+		ImGui::SameLine();
+		if (ImGui::RadioButton(v, downscale == idx)) downscale = idx;
+	} 
+}
+
+static IVec2 getDownscaledSize(const Viewport& vp, u32 downscale) {
+	const i32 mask = (1 << downscale) - 1;
+	return IVec2((vp.w + mask) >> downscale, (vp.h + mask) >> downscale);
+}
+
+// creates depth buffer for depth-aware upsampling, see getDepthAwareUpsampleWeights in common.hlsli
+// `shader` is shaders/ssao_downscale_depth.hlsl
+static RenderBufferHandle downscaleDepth(Pipeline& pipeline, Shader& shader, RenderBufferHandle depth, u32 downscale, IVec2 size) {
+	Renderer& renderer = pipeline.getRenderer();
+	DrawStream& stream = renderer.getDrawStream();
+	const RenderBufferHandle res = renderer.createRenderbuffer({ 
+		.size = size,
+		.format = gpu::TextureFormat::R32F, 
+		.flags = gpu::TextureFlags::COMPUTE_WRITE | gpu::TextureFlags::NO_MIPS, 
+		.debug_name = "downscaled depth"
+	});
+	pipeline.beginBlock("downscale depth");
+	struct {
+		u32 scale;
+		gpu::BindlessHandle input;
+		gpu::RWBindlessHandle output;
+	} udata = {
+		.scale = u32(1 << downscale),
+		.input = pipeline.toBindless(depth, stream),
+		.output = pipeline.toRWBindless(res, stream)
+	};
+	pipeline.setUniform(udata);
+	pipeline.dispatch(shader, (size.x + 7) / 8, (size.y + 7) / 8, 1);
+	pipeline.endBlock();
+	return res;
+}
+
 struct Atmo : public RenderPlugin {
+	static constexpr u32 INSCATTER_WIDTH = 64;
+	static constexpr u32 INSCATTER_HEIGHT = 128;
+
 	Renderer& m_renderer;
 	Shader* m_shader = nullptr;
 	Shader* m_scattering_shader = nullptr;
 	Shader* m_optical_depth_shader = nullptr;
+	Shader* m_downscale_depth_shader = nullptr;
 	gpu::TextureHandle m_optical_depth_precomputed = gpu::INVALID_TEXTURE;
-	gpu::TextureHandle m_inscatter_precomputed = gpu::INVALID_TEXTURE;
+	// optical depth depends only on these, we recompute it only when they change
+	Vec4 m_optical_depth_params = Vec4(-1);
+	float m_depth_diff_weight = 2;
+
+	struct PipelineInstanceData {
+		// inscatter depends on camera, so it's per pipeline
+		RenderBufferHandle inscatter = INVALID_RENDERBUFFER;
+		u32 downscale = 0;
+		// inscatter LUT is ray marched over this number of frames
+		u32 lut_update_frames = 1;
+		u32 lut_update_idx = 0;
+	};
 
 	Atmo(Renderer& renderer)
 		: m_renderer(renderer)
@@ -26,11 +84,11 @@ struct Atmo : public RenderPlugin {
 	void shutdown() {
 		if (m_optical_depth_precomputed != gpu::INVALID_TEXTURE) {
 			m_renderer.getEndFrameDrawStream().destroy(m_optical_depth_precomputed);
-			m_renderer.getEndFrameDrawStream().destroy(m_inscatter_precomputed);
 		}
 		m_shader->decRefCount();
 		m_scattering_shader->decRefCount();
 		m_optical_depth_shader->decRefCount();
+		m_downscale_depth_shader->decRefCount();
 	}
 
 	void init() {
@@ -38,11 +96,28 @@ struct Atmo : public RenderPlugin {
 		m_shader = rm.load<Shader>(Path("shaders/atmo.hlsl"));
 		m_scattering_shader = rm.load<Shader>(Path("shaders/atmo_scattering.hlsl"));
 		m_optical_depth_shader = rm.load<Shader>(Path("shaders/atmo_optical_depth.hlsl"));
+		m_downscale_depth_shader = rm.load<Shader>(Path("shaders/ssao_downscale_depth.hlsl"));
+	}
+
+	void debugUI(Pipeline& pipeline) override {
+		if (!ImGui::BeginMenu("Atmosphere")) return;
+		PipelineInstanceData* data = pipeline.getData<PipelineInstanceData>();
+		downscaleUI(data->downscale);
+		ImGui::DragFloat("Depth difference weight", &m_depth_diff_weight, 0.1f, FLT_MIN, FLT_MAX);
+		const char* lut_frames_values[] = { "1", "2", "4", "8" };
+		ImGui::TextUnformatted("LUT update frames");
+		for (const char*& v : lut_frames_values) {
+			const u32 frames = 1 << u32(&v - lut_frames_values);
+			ImGui::SameLine();
+			if (ImGui::RadioButton(v, data->lut_update_frames == frames)) data->lut_update_frames = frames;
+		}
+		ImGui::EndMenu();
 	}
 
 	RenderBufferHandle renderBeforeTransparent(const GBuffer& gbuffer, RenderBufferHandle hdr_rb, Pipeline& pipeline) override {
 		PROFILE_FUNCTION();
 		if (pipeline.getType() == PipelineType::PREVIEW) return hdr_rb;
+		if (!m_downscale_depth_shader->isReady()) return hdr_rb;
 
 		RenderModule* module = pipeline.getModule();
 		EntityPtr env_entity = module->getActiveEnvironment();
@@ -50,13 +125,24 @@ struct Atmo : public RenderPlugin {
 		Environment& env = module->getEnvironment(*env_entity);
 		if (!env.atmo_enabled) return hdr_rb;
 
+		Renderer& renderer = pipeline.getRenderer();
+		PipelineInstanceData* data = pipeline.getData<PipelineInstanceData>();
+		bool update_whole_lut = false;
 		if (m_optical_depth_precomputed == gpu::INVALID_TEXTURE) {
 			const gpu::TextureFlags flags = gpu::TextureFlags::COMPUTE_WRITE | gpu::TextureFlags::NO_MIPS;
-			m_optical_depth_precomputed = pipeline.getRenderer().createTexture(128, 128, 1, gpu::TextureFormat::RG32F, flags, {}, "optical_depth_precomputed");
-			m_inscatter_precomputed = pipeline.getRenderer().createTexture(64, 128, 1, gpu::TextureFormat::RGBA32F, flags, {}, "inscatter_precomputed");
+			m_optical_depth_precomputed = renderer.createTexture(128, 128, 1, gpu::TextureFormat::RG32F, flags, {}, "optical_depth_precomputed");
+		}
+		if (data->inscatter == INVALID_RENDERBUFFER) {
+			data->inscatter = renderer.createRenderbuffer({
+				.size = IVec2(INSCATTER_WIDTH, INSCATTER_HEIGHT),
+				.format = gpu::TextureFormat::RGBA32F,
+				.flags = gpu::TextureFlags::COMPUTE_WRITE | gpu::TextureFlags::NO_MIPS,
+				.debug_name = "inscatter_precomputed"
+			});
+			update_whole_lut = true;
 		}
 		
-		DrawStream& stream = pipeline.getRenderer().getDrawStream();
+		DrawStream& stream = renderer.getDrawStream();
 		pipeline.beginBlock("atmo");
 
 		struct {
@@ -80,6 +166,12 @@ struct Atmo : public RenderPlugin {
 			gpu::BindlessHandle optical_depth;
 			gpu::BindlessHandle depth_buffer;
 			gpu::BindlessHandle inscatter_precomputed;
+			u32 downscale;
+			float depth_diff_weight;
+			gpu::BindlessHandle depth_buffer_small;
+			gpu::RWBindlessHandle transmittance;
+			gpu::BindlessHandle atmo_small;
+			gpu::BindlessHandle transmittance_small;
 		} ub_data = {
 			env.ground_r * 1000,
 			env.atmo_r * 1000,
@@ -100,36 +192,85 @@ struct Atmo : public RenderPlugin {
 			gpu::getRWBindlessHandle(m_optical_depth_precomputed),
 			gpu::INVALID_BINDLESS_HANDLE,
 			pipeline.toBindless(gbuffer.DS, stream),
+			gpu::INVALID_BINDLESS_HANDLE,
+			data->downscale,
+			m_depth_diff_weight,
+			gpu::INVALID_BINDLESS_HANDLE,
+			gpu::INVALID_RW_BINDLESS_HANDLE,
+			gpu::INVALID_BINDLESS_HANDLE,
 			gpu::INVALID_BINDLESS_HANDLE
 		};
 
-		stream.barrier(m_optical_depth_precomputed, gpu::BarrierType::WRITE);
-		pipeline.beginBlock("precompute_transmittance");
-		pipeline.setUniform(ub_data);
-		pipeline.dispatch(*m_optical_depth_shader, 128 / 16, 128 / 16, 1);
-		pipeline.endBlock();
-		
-		stream.barrier(m_inscatter_precomputed, gpu::BarrierType::WRITE);
-		stream.memoryBarrier(m_optical_depth_precomputed);
+		const Vec4 optical_depth_params(ub_data.bot, ub_data.top, ub_data.distribution_rayleigh, ub_data.distribution_mie);
+		if (optical_depth_params != m_optical_depth_params) {
+			m_optical_depth_params = optical_depth_params;
+			update_whole_lut = true;
+			stream.barrier(m_optical_depth_precomputed, gpu::BarrierType::WRITE);
+			pipeline.beginBlock("precompute_transmittance");
+			pipeline.setUniform(ub_data);
+			pipeline.dispatch(*m_optical_depth_shader, 128 / 16, 128 / 16, 1);
+			pipeline.endBlock();
+			stream.memoryBarrier(m_optical_depth_precomputed);
+		}
 		stream.barrier(m_optical_depth_precomputed, gpu::BarrierType::READ);
 
+		// inscatter is ray marched in horizontal slices, one slice per frame
+		const u32 groups_y = INSCATTER_HEIGHT / 16;
+		const u32 lut_update_frames = update_whole_lut ? 1 : clamp(data->lut_update_frames, 1u, groups_y);
+		const u32 slice_groups = groups_y / lut_update_frames;
+		data->lut_update_idx = (data->lut_update_idx + 1) % lut_update_frames;
 		pipeline.beginBlock("precompute_inscatter");
-		ub_data.resolution = Vec4(64, 128, 1, 0);
-		ub_data.output = gpu::getRWBindlessHandle(m_inscatter_precomputed);
+		ub_data.resolution = Vec4(INSCATTER_WIDTH, INSCATTER_HEIGHT, 1, float(data->lut_update_idx * slice_groups * 16));
+		ub_data.output = pipeline.toRWBindless(data->inscatter, stream);
+		ub_data.optical_depth = gpu::getBindlessHandle(m_optical_depth_precomputed);
 		pipeline.setUniform(ub_data);
-		pipeline.dispatch(*m_scattering_shader, 64 / 16, 128 / 16, 1);
+		pipeline.dispatch(*m_scattering_shader, INSCATTER_WIDTH / 16, slice_groups, 1);
 		pipeline.endBlock();
 		
-		stream.memoryBarrier(m_inscatter_precomputed);
-		stream.barrier(m_inscatter_precomputed, gpu::BarrierType::READ);
+		stream.memoryBarrier(renderer.toTexture(data->inscatter));
 		
-		ub_data.inscatter_precomputed = gpu::getBindlessHandle(m_inscatter_precomputed);
-		ub_data.optical_depth = gpu::getBindlessHandle(m_optical_depth_precomputed);
+		ub_data.inscatter_precomputed = pipeline.toBindless(data->inscatter, stream);
+		const Viewport& vp = pipeline.getViewport();
+		if (data->downscale == 0) {
+			ub_data.output = pipeline.toRWBindless(hdr_rb, stream);
+			pipeline.setUniform(ub_data);
+			pipeline.dispatch(*m_shader, (vp.w + 15) / 16, (vp.h + 15) / 16, 1);
+			pipeline.endBlock();
+			return hdr_rb;
+		}
+
+		const IVec2 size = getDownscaledSize(vp, data->downscale);
+		const RenderBufferHandle depth_small = downscaleDepth(pipeline, *m_downscale_depth_shader, gbuffer.DS, data->downscale, size);
+		RenderbufferDesc desc = {
+			.size = size,
+			.format = gpu::TextureFormat::RGBA16F,
+			.flags = gpu::TextureFlags::COMPUTE_WRITE | gpu::TextureFlags::NO_MIPS,
+			.debug_name = "atmo"
+		};
+		const RenderBufferHandle atmo_rb = renderer.createRenderbuffer(desc);
+		desc.debug_name = "atmo_transmittance";
+		const RenderBufferHandle transmittance_rb = renderer.createRenderbuffer(desc);
+		
+		ub_data.output = pipeline.toRWBindless(atmo_rb, stream);
+		ub_data.transmittance = pipeline.toRWBindless(transmittance_rb, stream);
+		pipeline.setUniform(ub_data);
+		pipeline.dispatch(*m_shader, (size.x + 15) / 16, (size.y + 15) / 16, 1);
+		stream.memoryBarrier(renderer.toTexture(atmo_rb));
+		stream.memoryBarrier(renderer.toTexture(transmittance_rb));
+
+		pipeline.beginBlock("atmo_upsample");
 		ub_data.output = pipeline.toRWBindless(hdr_rb, stream);
+		ub_data.transmittance = gpu::INVALID_RW_BINDLESS_HANDLE;
+		ub_data.depth_buffer_small = pipeline.toBindless(depth_small, stream);
+		ub_data.atmo_small = pipeline.toBindless(atmo_rb, stream);
+		ub_data.transmittance_small = pipeline.toBindless(transmittance_rb, stream);
 		pipeline.setUniform(ub_data);
-		const Viewport& vp = pipeline.getViewport();
-		pipeline.dispatch(*m_shader, (vp.w + 15) / 16, (vp.h + 15) / 16, 1);
+		pipeline.dispatch(*m_shader, (vp.w + 15) / 16, (vp.h + 15) / 16, 1, "UPSAMPLE");
+		pipeline.endBlock();
 
+		renderer.releaseRenderbuffer(atmo_rb);
+		renderer.releaseRenderbuffer(transmittance_rb);
+		renderer.releaseRenderbuffer(depth_small);
 		pipeline.endBlock();
 		return hdr_rb;
 	}
@@ -600,13 +741,17 @@ struct SSS : public RenderPlugin {
 	Renderer& m_renderer;
 	Shader* m_shader = nullptr;
 	Shader* m_shader_blit = nullptr;
+	Shader* m_downscale_depth_shader = nullptr;
 	u32 m_max_steps = 20;
 	float m_stride = 4;
 	float m_current_frame_weight = 0.1f;
+	float m_depth_diff_weight = 2;
 	bool m_is_enabled = false;
 
 	struct PipelineInstanceData {
 		RenderBufferHandle history = INVALID_RENDERBUFFER;
+		IVec2 history_size = IVec2(0);
+		u32 downscale = 0;
 	};
 
 	SSS(Renderer& renderer) : m_renderer(renderer) {}
@@ -614,12 +759,14 @@ struct SSS : public RenderPlugin {
 	void shutdown() {
 		m_shader->decRefCount();
 		m_shader_blit->decRefCount();
+		m_downscale_depth_shader->decRefCount();
 	}
 
 	void init() {
 		ResourceManagerHub& rm = m_renderer.getEngine().getResourceManager();
 		m_shader = rm.load<Shader>(Path("shaders/sss.hlsl"));
 		m_shader_blit = rm.load<Shader>(Path("shaders/sss_blit.hlsl"));
+		m_downscale_depth_shader = rm.load<Shader>(Path("shaders/ssao_downscale_depth.hlsl"));
 	}
 
 	void debugUI(Pipeline& pipeline) override {
@@ -627,6 +774,7 @@ struct SSS : public RenderPlugin {
 		if (!ImGui::BeginMenu("SSS")) return;
 
 		ImGui::Checkbox("Enable", &m_is_enabled);
+		downscaleUI(pipeline.getData<PipelineInstanceData>()->downscale);
 		
 		if (ImGui::RadioButton("Debug", pipeline.m_debug_show_plugin == this)) {
 			pipeline.m_debug_show_plugin = this;
@@ -637,15 +785,15 @@ struct SSS : public RenderPlugin {
 
 	bool debugOutput(RenderBufferHandle input, Pipeline& pipeline) override {
 		if (pipeline.m_debug_show_plugin != this) return false;
-		RenderBufferHandle rb = pipeline.getData<PipelineInstanceData>()->history;
-		const Viewport& vp = pipeline.getViewport();
-		if (rb != INVALID_RENDERBUFFER) pipeline.copy(input, rb, {(i32)vp.w, (i32)vp.h});
+		PipelineInstanceData* data = pipeline.getData<PipelineInstanceData>();
+		if (data->history != INVALID_RENDERBUFFER) pipeline.copy(input, data->history, data->history_size);
 		return true;
 	}
 
 	void renderBeforeLightPass(const GBuffer& gbuffer, Pipeline& pipeline) override {
 		if (!m_shader->isReady()) return;
 		if (!m_shader_blit->isReady()) return;
+		if (!m_downscale_depth_shader->isReady()) return;
 		
 		PipelineInstanceData* data = pipeline.getData<PipelineInstanceData>();	
 		if (!m_is_enabled) {
@@ -654,10 +802,12 @@ struct SSS : public RenderPlugin {
 		}
 		
 		const Viewport& vp = pipeline.getViewport();
+		const u32 downscale = data->downscale;
+		const IVec2 size = getDownscaledSize(vp, downscale);
 
 		pipeline.beginBlock("SSS");
 		const RenderbufferDesc rb_desc = {
-			.size = {vp.w, vp.h},
+			.size = size,
 			.format = gpu::TextureFormat::R8,
 			.flags = gpu::TextureFlags::COMPUTE_WRITE | gpu::TextureFlags::RENDER_TARGET,
 			.debug_name = "sss"
@@ -665,45 +815,86 @@ struct SSS : public RenderPlugin {
 		Renderer& renderer = pipeline.getRenderer();
 		RenderBufferHandle sss =  renderer.createRenderbuffer(rb_desc);
 
-		if (data->history == INVALID_RENDERBUFFER) {
+		if (data->history == INVALID_RENDERBUFFER || data->history_size != size) {
+			if (data->history != INVALID_RENDERBUFFER) renderer.releaseRenderbuffer(data->history);
 			data->history = renderer.createRenderbuffer(rb_desc);
+			data->history_size = size;
 			renderer.setRenderTargets(Span(&data->history, 1));
 			pipeline.clear(gpu::ClearFlags::ALL, 1, 1, 1, 1, 0);
 		}
 
 		DrawStream& stream = renderer.getDrawStream();
+		const RenderBufferHandle depth_small = downscale > 0 ? downscaleDepth(pipeline, *m_downscale_depth_shader, gbuffer.DS, downscale, size) : gbuffer.DS;
 
 		struct {
 			float max_steps;
 			float stride;
+			Vec2 size;
 			gpu::BindlessHandle depth;
 			gpu::RWBindlessHandle sss_buffer;
 		} ubdata = {
 			(float)m_max_steps,
 			m_stride,
+			Vec2(size),
 			pipeline.toBindless(gbuffer.DS, stream),
 			pipeline.toRWBindless(sss, stream)
 		};
 		pipeline.setUniform(ubdata);
-		pipeline.dispatch(*m_shader, (vp.w + 15) / 16, (vp.h + 15) / 16, 1);
+		pipeline.dispatch(*m_shader, (size.x + 15) / 16, (size.y + 15) / 16, 1);
 		stream.memoryBarrier(renderer.toTexture(sss));
 
 		struct {
 			float current_frame_weight;
+			u32 downscale;
+			Vec2 rcp_size;
+			float depth_diff_weight;
 			gpu::RWBindlessHandle sss;
 			gpu::BindlessHandle history;
 			gpu::BindlessHandle depthbuf;
+			gpu::BindlessHandle depthbuf_small;
 			gpu::RWBindlessHandle gbufferC;
 		} ubdata2 = {
 			m_current_frame_weight,
+			downscale,
+			Vec2(1.f / size.x, 1.f / size.y),
+			m_depth_diff_weight,
 			pipeline.toRWBindless(sss, stream),
 			pipeline.toBindless(data->history, stream),
 			pipeline.toBindless(gbuffer.DS, stream),
+			pipeline.toBindless(depth_small, stream),
 			pipeline.toRWBindless(gbuffer.C, stream)
 		};
 
 		pipeline.setUniform(ubdata2);
-		pipeline.dispatch(*m_shader_blit, (vp.w + 15) / 16, (vp.h + 15) / 16, 1);
+		pipeline.dispatch(*m_shader_blit, (size.x + 15) / 16, (size.y + 15) / 16, 1);
+
+		if (downscale > 0) {
+			stream.memoryBarrier(renderer.toTexture(sss));
+			struct {
+				float current_frame_weight;
+				u32 downscale;
+				Vec2 rcp_size;
+				float depth_diff_weight;
+				gpu::BindlessHandle sss;
+				gpu::BindlessHandle history;
+				gpu::BindlessHandle depthbuf;
+				gpu::BindlessHandle depthbuf_small;
+				gpu::RWBindlessHandle gbufferC;
+			} upsample_data = {
+				m_current_frame_weight,
+				downscale,
+				Vec2(1.f / size.x, 1.f / size.y),
+				m_depth_diff_weight,
+				pipeline.toBindless(sss, stream),
+				gpu::INVALID_BINDLESS_HANDLE,
+				pipeline.toBindless(gbuffer.DS, stream),
+				pipeline.toBindless(depth_small, stream),
+				pipeline.toRWBindless(gbuffer.C, stream)
+			};
+			pipeline.setUniform(upsample_data);
+			pipeline.dispatch(*m_shader_blit, (vp.w + 15) / 16, (vp.h + 15) / 16, 1, "UPSAMPLE");
+			renderer.releaseRenderbuffer(depth_small);
+		}
 		stream.memoryBarrier(renderer.toTexture(gbuffer.C));
 
 		swap(data->history, sss);
@@ -721,14 +912,14 @@ struct SSAO : public RenderPlugin {
 	bool m_enabled = true;
 	bool m_temporal = true;
 	u32 m_blur_iterations = 1;
-	u32 m_downscale = 1;
 	float m_depth_diff_weight = 2;
 	float m_radius = 0.4f;
 	float m_intensity = 1.f;
-	IVec2 m_temporal_size;
 
 	struct PipelineInstanceData {
 		RenderBufferHandle m_history_rb = INVALID_RENDERBUFFER;
+		IVec2 m_temporal_size = IVec2(0);
+		u32 m_downscale = 1;
 	};
 
 	SSAO(Renderer& renderer) : m_renderer(renderer) {}
@@ -756,13 +947,7 @@ struct SSAO : public RenderPlugin {
 			ImGui::DragFloat("Intensity", &m_intensity, 0.1f, FLT_MIN, FLT_MAX);
 			ImGui::DragFloat("Depth difference weight", &m_depth_diff_weight, 0.1f, FLT_MIN, FLT_MAX);
 			ImGui::DragInt("Blur iterations", (i32*)&m_blur_iterations, 1, 0, 50);
-			const char* downscale_values[] = { "Disabled", "2x", "4x" };
-			ImGui::TextUnformatted("Downscale");
-			for (const char*& v : downscale_values) {
-				const u32 idx = u32(&v - downscale_values);
-				ImGui::SameLine();
-				if (ImGui::RadioButton(v, m_downscale == idx)) m_downscale = idx;
-			} 
+			downscaleUI(pipeline.getData<PipelineInstanceData>()->m_downscale);
 			ImGui::EndMenu();
 		}
 	}
@@ -773,8 +958,10 @@ struct SSAO : public RenderPlugin {
 		Renderer& renderer = pipeline.getRenderer();
 
 		const Viewport& vp = pipeline.getViewport();
-		const u32 width = vp.w >> m_downscale;
-		const u32 height = vp.h >> m_downscale;
+		const u32 downscale = data->m_downscale;
+		const IVec2 size = getDownscaledSize(vp, downscale);
+		const u32 width = size.x;
+		const u32 height = size.y;
 
 		if (!m_shader->isReady()
 			|| !m_blit_shader->isReady() 
@@ -799,30 +986,10 @@ struct SSAO : public RenderPlugin {
 		DrawStream& stream = pipeline.getRenderer().getDrawStream();
 		RenderBufferHandle depth_buffer = gbuffer.DS;
 		pipeline.beginBlock("ssao");
-		if (m_downscale > 0) {
-			depth_buffer = renderer.createRenderbuffer({ 
-				.size = IVec2(width, height),
-				.format = gpu::TextureFormat::R32F, 
-				.flags = gpu::TextureFlags::COMPUTE_WRITE | gpu::TextureFlags::NO_MIPS, 
-				.debug_name = "ssao downscaled depth"
-			});
-			pipeline.beginBlock("ssao downscale depth");
-			struct {
-				u32 scale;
-				gpu::BindlessHandle input;
-				gpu::RWBindlessHandle output;
-			} udata = {
-				.scale = u32(1 << m_downscale),
-				.input = pipeline.toBindless(gbuffer.DS, stream),
-				.output = pipeline.toRWBindless(depth_buffer, stream)
-			};
-			pipeline.setUniform(udata);
-			pipeline.dispatch(*m_downscale_shader, (width + 7) / 8, (height + 7) / 8, 1);
-			pipeline.endBlock();
-		}
+		if (downscale > 0) depth_buffer = downscaleDepth(pipeline, *m_downscale_shader, gbuffer.DS, downscale, size);
 
 		if (m_temporal) {
-			if (data->m_history_rb == INVALID_RENDERBUFFER || width != m_temporal_size.x || height != m_temporal_size.y) {
+			if (data->m_history_rb == INVALID_RENDERBUFFER || size != data->m_temporal_size) {
 				renderer.releaseRenderbuffer(data->m_history_rb);
 				data->m_history_rb = renderer.createRenderbuffer({
 					.size = IVec2(width, height),
@@ -830,7 +997,7 @@ struct SSAO : public RenderPlugin {
 					.flags = gpu::TextureFlags::COMPUTE_WRITE | gpu::TextureFlags::NO_MIPS | gpu::TextureFlags::RENDER_TARGET,
 					.debug_name = "ssao"
 				});
-				m_temporal_size = IVec2(width, height);
+				data->m_temporal_size = size;
 				// TODO compute shader
 				renderer.setRenderTargets(Span(&data->m_history_rb, 1), INVALID_RENDERBUFFER);
 				pipeline.clear(gpu::ClearFlags::ALL, 1, 1, 1, 1, 1);
@@ -855,7 +1022,7 @@ struct SSAO : public RenderPlugin {
 			.rcp_size = Vec2(1.0f / width, 1.0f / height),
 			.radius = m_radius,
 			.intensity = m_intensity,
-			.downscale = m_downscale,
+			.downscale = downscale,
 			.normal_buffer = pipeline.toBindless(gbuffer.B, stream),
 			.depth_buffer = pipeline.toBindless(depth_buffer, stream),
 			.history = pipeline.toBindless(data->m_history_rb, stream),
@@ -886,7 +1053,7 @@ struct SSAO : public RenderPlugin {
 			} blur_data = {
 				.rcp_size = Vec2(1.0f / width, 1.0f / height),
 				.weight_scale = 0.01f,
-				.downscale = m_downscale,
+				.downscale = downscale,
 				.depth_buffer = pipeline.toBindless(depth_buffer, stream),
 			};
 
@@ -912,7 +1079,7 @@ struct SSAO : public RenderPlugin {
 			gpu::BindlessHandle depth_buffer_small;
 			gpu::RWBindlessHandle gbufferB;
 		} udata2 = {
-			.downscale = m_downscale,
+			.downscale = downscale,
 			.depth_diff_weight = m_depth_diff_weight,
 			.ssao_buf = pipeline.toBindless(ssao_rb, stream),
 			.depth_buffer = pipeline.toBindless(gbuffer.DS, stream),
@@ -936,26 +1103,35 @@ struct SSAO : public RenderPlugin {
 struct TDAO : public RenderPlugin {
 	Renderer& m_renderer;
 	Shader* m_shader = nullptr;
+	Shader* m_downscale_depth_shader = nullptr;
+	Shader* m_blit_shader = nullptr;
 	float m_xz_range = 100;
 	float m_y_range = 200;
 	float m_intensity = 0.9f;
 	bool m_enabled = true;
 	float m_scale = 0.01f;
+	float m_depth_diff_weight = 2;
 	DVec3 m_last_camera_pos = DVec3(DBL_MAX);
 	
 	struct PipelineInstanceData {
 		RenderBufferHandle rb = INVALID_RENDERBUFFER;
+		u32 downscale = 0;
 	};
 
 	TDAO(Renderer& renderer) : m_renderer(renderer) {}
 
 	void shutdown() {
 		m_shader->decRefCount();
+		m_downscale_depth_shader->decRefCount();
+		m_blit_shader->decRefCount();
 	}
 
 	void init() {
 		ResourceManagerHub& rm = m_renderer.getEngine().getResourceManager();
 		m_shader = rm.load<Shader>(Path("shaders/tdao.hlsl"));
+		m_downscale_depth_shader = rm.load<Shader>(Path("shaders/ssao_downscale_depth.hlsl"));
+		// downscaled tdao is applied to gbuffer the same way as ssao
+		m_blit_shader = rm.load<Shader>(Path("shaders/ssao_blit.hlsl"));
 	}
 
 	void debugUI(Pipeline& pipeline) override {
@@ -963,6 +1139,7 @@ struct TDAO : public RenderPlugin {
 		ImGui::Checkbox("Enable", &m_enabled);
 		ImGui::DragFloat("Intensity", &m_intensity, 0.01f, FLT_MIN, FLT_MAX);
 		ImGui::DragFloat("Scale", &m_scale, 0.01f, FLT_MIN, FLT_MAX);
+		downscaleUI(pipeline.getData<PipelineInstanceData>()->downscale);
 		if (ImGui::RadioButton("Debug", pipeline.m_debug_show_plugin == this)) {
 			pipeline.m_debug_show_plugin = this;
 			pipeline.m_debug_show = Pipeline::DebugShow::PLUGIN;
@@ -983,6 +1160,7 @@ struct TDAO : public RenderPlugin {
 
 	void renderBeforeLightPass(const GBuffer& gbuffer, Pipeline& pipeline) override {
 		if (pipeline.getType() == PipelineType::PREVIEW) return;
+		if (!m_downscale_depth_shader->isReady() || !m_blit_shader->isReady()) return;
 		PROFILE_FUNCTION();
 		auto* inst_data = pipeline.getData<PipelineInstanceData>();
 
@@ -1058,6 +1236,8 @@ struct TDAO : public RenderPlugin {
 			gpu::BindlessHandle u_depth_buffer;
 			gpu::RWBindlessHandle u_gbufferB;
 			gpu::BindlessHandle u_topdown_depthmap;
+			u32 u_downscale;
+			gpu::RWBindlessHandle u_output;
 		} ubdata = {
 			Vec4(Vec3(vp.pos - m_last_camera_pos), 0),
 			Vec2(1.f / vp.w, 1.f / vp.h),
@@ -1069,10 +1249,51 @@ struct TDAO : public RenderPlugin {
 			pipeline.toBindless(gbuffer.DS, stream),
 			pipeline.toRWBindless(gbuffer.B, stream),
 			pipeline.toBindless(inst_data->rb, stream),
+			inst_data->downscale,
+			gpu::INVALID_RW_BINDLESS_HANDLE
 		};
 
+		if (inst_data->downscale == 0) {
+			pipeline.setUniform(ubdata);
+			pipeline.dispatch(*m_shader, (vp.w + 15) / 16, (vp.h + 15) / 16, 1);
+			pipeline.endBlock();
+			return;
+		}
+
+		const u32 downscale = inst_data->downscale;
+		const IVec2 size = getDownscaledSize(vp, downscale);
+		const RenderBufferHandle depth_small = downscaleDepth(pipeline, *m_downscale_depth_shader, gbuffer.DS, downscale, size);
+		const RenderBufferHandle ao_rb = renderer.createRenderbuffer({
+			.size = size,
+			.format = gpu::TextureFormat::R8,
+			.flags = gpu::TextureFlags::COMPUTE_WRITE | gpu::TextureFlags::NO_MIPS,
+			.debug_name = "tdao_downscaled"
+		});
+		ubdata.u_output = pipeline.toRWBindless(ao_rb, stream);
 		pipeline.setUniform(ubdata);
-		pipeline.dispatch(*m_shader, (vp.w + 15) / 16, (vp.h + 15) / 16, 1);
+		pipeline.dispatch(*m_shader, (size.x + 15) / 16, (size.y + 15) / 16, 1);
+		stream.memoryBarrier(renderer.toTexture(ao_rb));
+
+		struct {
+			u32 downscale;
+			float depth_diff_weight;
+			gpu::BindlessHandle ao;
+			gpu::BindlessHandle depth_buffer;
+			gpu::BindlessHandle depth_buffer_small;
+			gpu::RWBindlessHandle gbufferB;
+		} blit_data = {
+			.downscale = downscale,
+			.depth_diff_weight = m_depth_diff_weight,
+			.ao = pipeline.toBindless(ao_rb, stream),
+			.depth_buffer = pipeline.toBindless(gbuffer.DS, stream),
+			.depth_buffer_small = pipeline.toBindless(depth_small, stream),
+			.gbufferB = pipeline.toRWBindless(gbuffer.B, stream)
+		};
+		pipeline.setUniform(blit_data);
+		pipeline.dispatch(*m_blit_shader, (vp.w + 15) / 16, (vp.h + 15) / 16, 1);
+
+		renderer.releaseRenderbuffer(ao_rb);
+		renderer.releaseRenderbuffer(depth_small);
 		
 		pipeline.endBlock();
 	}
@@ -1086,6 +1307,7 @@ struct TAA : public RenderPlugin {
 
 	struct PipelineInstanceData {
 		RenderBufferHandle history_rb = INVALID_RENDERBUFFER;
+		IVec2 history_size = IVec2(0);
 	};
 
 	TAA(Renderer& renderer)
@@ -1116,10 +1338,13 @@ struct TAA : public RenderPlugin {
 		Renderer& renderer = pipeline.getRenderer();
 		pipeline.enablePixelJitter(true);
 		pipeline.beginBlock("taa");
-		const Viewport& vp = pipeline.getViewport();
-		if (data->history_rb == INVALID_RENDERBUFFER) {
+		// hdr_buffer can be in lower resolution than display, TAA upscales it to display resolution
+		const IVec2& display_size = pipeline.getDisplaySize();
+		if (data->history_rb == INVALID_RENDERBUFFER || data->history_size != display_size) {
+			if (data->history_rb != INVALID_RENDERBUFFER) renderer.releaseRenderbuffer(data->history_rb);
+			data->history_size = display_size;
 			data->history_rb = renderer.createRenderbuffer({
-				.size = {vp.w, vp.h},
+				.size = display_size,
 				.format = gpu::TextureFormat::RGBA16F,
 				.flags = gpu::TextureFlags::RENDER_TARGET | gpu::TextureFlags::NO_MIPS | gpu::TextureFlags::COMPUTE_WRITE,
 				.debug_name = "taa"
@@ -1129,13 +1354,12 @@ struct TAA : public RenderPlugin {
 		}
 
 		RenderBufferHandle taa_tmp = renderer.createRenderbuffer({
-			.size = {vp.w, vp.h},
+			.size = display_size,
 			.format = gpu::TextureFormat::RGBA16F,
 			.flags = gpu::TextureFlags::RENDER_TARGET | gpu::TextureFlags::NO_MIPS | gpu::TextureFlags::COMPUTE_WRITE,
 			.debug_name = "taa2"
 		});
 		
-		const IVec2& display_size = pipeline.getDisplaySize();
 		DrawStream& stream = pipeline.getRenderer().getDrawStream();
 
 		struct {
@@ -1156,7 +1380,7 @@ struct TAA : public RenderPlugin {
 		pipeline.dispatch(*m_shader, (display_size.x + 15) / 16, (display_size.y + 15) / 16, 1);
 
 		const RenderBufferHandle taa_output = renderer.createRenderbuffer({
-			.size = {vp.w, vp.h},
+			.size = display_size,
 			.format = gpu::TextureFormat::RGBA16F,
 			.flags = gpu::TextureFlags::RENDER_TARGET | gpu::TextureFlags::NO_MIPS | gpu::TextureFlags::COMPUTE_WRITE,
 			.debug_name = "taa_output"	
@@ -3,6 +3,7 @@
 #include "core/array.h"
 #include "core/associative_array.h"
 #include "core/crt.h"
+#include "core/delegate.h"
 #include "engine/engine.h"
 #include "engine/file_system.h"
 #include "core/geometry.h"
@@ -12,6 +13,7 @@
 #include "core/math.h"
 #include "core/page_allocator.h"
 #include "core/profiler.h"
+#include "core/ring_buffer.h"
 #include "engine/reflection.h"
 #include "engine/resource_manager.h"
 #include "core/stack_array.h"
@@ -49,6 +51,14 @@ static const ComponentType ENVIRONMENT_PROBE_TYPE = reflection::getComponentType
 static const ComponentType REFLECTION_PROBE_TYPE = reflection::getComponentType("reflection_probe");
 static const ComponentType FUR_TYPE = reflection::getComponentType("fur");
 static const ComponentType PROCEDURAL_GEOM_TYPE = reflection::getComponentType("procedural_geom");
+// particle systems not rendered for this many updates are simulated at a reduced rate
+static constexpr i32 OFFSCREEN_PARTICLES_GRACE_UPDATES = 30;
+static constexpr u32 OFFSCREEN_PARTICLES_UPDATE_RATE = 4;
+static constexpr u32 FAR_PARTICLES_UPDATE_RATE = 2;
+// accumulated time is simulated in steps of at most this length
+static constexpr float MAX_PARTICLES_TIME_STEP = 0.1f;
+// paused particle systems catch up at most this much time when they are visible again
+static constexpr float MAX_PARTICLES_CATCH_UP_TIME = 1.f;
 
 
 struct BoneAttachment
@@ -59,6 +69,130 @@ struct BoneAttachment
 	LocalRigidTransform relative_transform;
 };
 
+// unique for every clear of every ThreadDebugBuffer, so stale thread blocks are detected even if a buffer is allocated at the same address
+static AtomicI32 g_debug_generation = 1;
+
+// per-frame debug primitives, each thread adds to its own chunk, so they can be added from any thread without locking
+// chunks are published to a lock-free list when they are allocated
+// must not be used while the pipeline renders them
+template <typename T>
+struct ThreadDebugBuffer {
+	using Chunk = DebugChunk<T>;
+
+	struct ThreadBlock {
+		const void* owner = nullptr;
+		u32 generation = 0;
+		Chunk* chunk = nullptr;
+	};
+
+	explicit ThreadDebugBuffer(IAllocator& allocator)
+		: m_allocator(allocator)
+		, m_free_chunks(allocator)
+		, m_generation(g_debug_generation.inc())
+	{}
+
+	~ThreadDebugBuffer() {
+		clear();
+		Chunk* chunk;
+		while (m_free_chunks.pop(chunk)) m_allocator.deallocate(chunk);
+	}
+
+	// returns `count` consecutive items
+	T* add(u32 count) {
+		static thread_local ThreadBlock blocks[4];
+		static thread_local u32 next_block = 0;
+		ThreadBlock* block = nullptr;
+		for (ThreadBlock& b : blocks) {
+			if (b.owner == this) {
+				block = &b;
+				break;
+			}
+		}
+		if (!block) {
+			// more buffers than blocks, it still works, but some chunk tails are wasted
+			block = &blocks[next_block % lengthOf(blocks)];
+			++next_block;
+			block->owner = this;
+			block->generation = 0;
+		}
+
+		if (block->generation != m_generation || block->chunk->count + count > block->chunk->capacity) {
+			block->chunk = allocChunk(count);
+			block->generation = m_generation;
+		}
+		T* res = block->chunk->begin() + block->chunk->count;
+		block->chunk->count += count;
+		return res;
+	}
+
+	void clear() {
+		Chunk* chunk = (Chunk*)m_chunks;
+		m_chunks = nullptr;
+		m_generation = g_debug_generation.inc();
+		while (chunk) {
+			Chunk* next = chunk->next;
+			if (chunk->capacity == Chunk::CAPACITY) m_free_chunks.push(chunk);
+			else m_allocator.deallocate(chunk);
+			chunk = next;
+		}
+	}
+
+	const Chunk* getChunks() const { return (const Chunk*)m_chunks; }
+
+private:
+	Chunk* allocChunk(u32 count) {
+		Chunk* chunk = nullptr;
+		if (count > Chunk::CAPACITY || !m_free_chunks.pop(chunk)) {
+			// big requests, e.g. from physics, get their own chunk
+			const u32 capacity = maximum(count, Chunk::CAPACITY);
+			chunk = (Chunk*)m_allocator.allocate(sizeof(Chunk) + sizeof(T) * capacity, alignof(T));
+			chunk->capacity = capacity;
+		}
+		chunk->count = 0;
+		for (;;) {
+			Chunk* head = (Chunk*)m_chunks;
+			chunk->next = head;
+			if (compareExchangePtr(&m_chunks, chunk, head)) return chunk;
+		}
+	}
+
+	IAllocator& m_allocator;
+	void* volatile m_chunks = nullptr;
+	LockFreeStack<Chunk*> m_free_chunks;
+	volatile u32 m_generation;
+};
+
+// layout of m_base_vertex_decl and m_base_line_vertex_decl in pipeline
+struct DebugVertex {
+	Vec3 pos;
+	u32 color;
+};
+
+DebugGeometry::DebugGeometry(IAllocator& allocator)
+	: lines(allocator)
+	, triangles(allocator)
+{}
+
+void DebugGeometry::clear() {
+	lines.clear();
+	triangles.clear();
+}
+
+void DebugGeometry::addDebugLine(const DVec3& from, const DVec3& to, Color color) {
+	DebugLine& line = lines.emplace();
+	line.from = from;
+	line.to = to;
+	line.color = color;
+}
+
+void DebugGeometry::addDebugTriangle(const DVec3& p0, const DVec3& p1, const DVec3& p2, Color color) {
+	DebugTriangle& tri = triangles.emplace();
+	tri.p0 = p0;
+	tri.p1 = p1;
+	tri.p2 = p2;
+	tri.color = color;
+}
+
 u32 ProceduralGeometry::getVertexCount() const {
 	return vertex_decl.getStride() ? u32(vertex_data.size() / vertex_decl.getStride()) : 0;
 }
@@ -178,7 +312,7 @@ struct RenderModuleImpl final : RenderModule {
 
 
 	~RenderModuleImpl() {
-		m_world.componentTransformed(MODEL_INSTANCE_TYPE).unbind<&RenderModuleImpl::onModelInstanceMoved>(this);
+		m_world.componentTransformedBatch(MODEL_INSTANCE_TYPE).unbind<&RenderModuleImpl::onModelInstancesMoved>(this);
 		m_world.componentTransformed(DECAL_TYPE).unbind<&RenderModuleImpl::onDecalMoved>(this);
 		m_world.componentTransformed(CURVE_DECAL_TYPE).unbind<&RenderModuleImpl::onCurveDecalMoved>(this);
 		m_world.componentTransformed(PARTICLE_EMITTER_TYPE).unbind<&RenderModuleImpl::onParticleEmitterMoved>(this);
@@ -204,6 +338,12 @@ struct RenderModuleImpl final : RenderModule {
 			if (im.gpu_data) m_renderer.getEndFrameDrawStream().destroy(im.gpu_data);
 		}
 
+		for (DebugBatch& batch : m_debug_batches) freeDebugBatchBuffers(batch);
+
+		for (GPUDrivenModel& gm : m_gpu_driven_models) {
+			if (gm.im.gpu_data) m_renderer.getEndFrameDrawStream().destroy(gm.im.gpu_data);
+		}
+
 		for (ModelInstance& r : m_model_instances) {
 			if (!isFlagSet(r.flags, ModelInstance::VALID)) continue;
 			
@@ -237,9 +377,11 @@ struct RenderModuleImpl final : RenderModule {
 		for (const ReflectionProbe& probe : m_reflection_probes) {
 			LUMIX_DELETE(m_allocator, probe.load_job);
 		}
+		if (m_probes_pack_handle.isValid()) m_engine.getFileSystem().cancel(m_probes_pack_handle);
 
 		m_renderer.getEndFrameDrawStream().destroy(m_reflection_probes_texture);
 		m_world.entityDestroyed().unbind<&RenderModuleImpl::onEntityDestroyed>(this);
+		m_world.entityActiveChanged().unbind<&RenderModuleImpl::onEntityActiveChanged>(this);
 		m_culling_system.reset();
 	}
 
@@ -506,6 +648,10 @@ struct RenderModuleImpl final : RenderModule {
 		{
 			ModelInstance& mi = m_model_instances[parent.index];
 			mi.flags |= ModelInstance::IS_BONE_ATTACHMENT_PARENT;
+			if (mi.flags & ModelInstance::GPU_DRIVEN) {
+				removeRenderable((EntityRef)parent);
+				addRenderable((EntityRef)parent);
+			}
 		}
 		updateRelativeMatrix(ba);
 	}
@@ -521,6 +667,42 @@ struct RenderModuleImpl final : RenderModule {
 			m_model_instances[e.index].prev_frame_transform = m_world.getTransform(e);
 		}
 		m_moved_instances.clear();
+		m_shadow_caster_changes.clear();
+	}
+
+	// returns time the particle system should simulate in this update, 0 if the update is skipped
+	static float getParticleSystemTimeStep(ParticleSystem& ps, float dt) {
+		const i32 offscreen_updates = ps.m_offscreen_updates.inc();
+		const float view_distance_squared = ps.m_view_distance_squared;
+		ps.m_view_distance_squared = FLT_MAX;
+		ps.m_skipped_time += dt;
+
+		if (ps.m_update_policy == ParticleEmitterUpdatePolicy::ALWAYS) {
+			const float res = ps.m_skipped_time;
+			ps.m_skipped_time = 0;
+			ps.m_skipped_updates = 0;
+			return res;
+		}
+
+		u32 rate = 1;
+		if (offscreen_updates > OFFSCREEN_PARTICLES_GRACE_UPDATES) {
+			if (ps.m_update_policy == ParticleEmitterUpdatePolicy::PAUSE) {
+				ps.m_skipped_time = minimum(ps.m_skipped_time, MAX_PARTICLES_CATCH_UP_TIME);
+				return 0;
+			}
+			rate = OFFSCREEN_PARTICLES_UPDATE_RATE;
+		}
+		else if (ps.m_throttle_distance > 0 && view_distance_squared > ps.m_throttle_distance * ps.m_throttle_distance) {
+			rate = FAR_PARTICLES_UPDATE_RATE;
+		}
+
+		++ps.m_skipped_updates;
+		if (ps.m_skipped_updates < rate) return 0;
+
+		const float res = ps.m_skipped_time;
+		ps.m_skipped_time = 0;
+		ps.m_skipped_updates = 0;
+		return res;
 	}
 
 	void update(float dt) override {
@@ -536,15 +718,25 @@ struct RenderModuleImpl final : RenderModule {
 			ParticleSystem* ps = m_particle_emitters.getFromIndex(idx);
 			if (!ps) return;
 
-			if (ps->update(dt, m_engine.getPageAllocator())) {
-				jobs::enter(&mutex);
-				to_delete.push(*ps->m_entity);
-				jobs::exit(&mutex);
-			}
+			const float ps_dt = getParticleSystemTimeStep(*ps, dt);
+			if (ps_dt <= 0) return;
+
+			// long accumulated time (catch up after pause) is split, so emit timers and integration do not see one huge step
+			const u32 steps = (u32)ceilf(ps_dt / MAX_PARTICLES_TIME_STEP);
+			for (u32 i = 0; i < steps; ++i) {
+				const bool finished = ps->update(ps_dt / steps, m_engine.getPageAllocator());
+
+				stats.emitted.add(ps->m_last_update_stats.emitted);
+				stats.killed.add(ps->m_last_update_stats.killed);
+				stats.processed.add(ps->m_last_update_stats.processed);
 
-			stats.emitted.add(ps->m_last_update_stats.emitted);
-			stats.killed.add(ps->m_last_update_stats.killed);
-			stats.processed.add(ps->m_last_update_stats.processed);
+				if (finished) {
+					jobs::enter(&mutex);
+					to_delete.push(*ps->m_entity);
+					jobs::exit(&mutex);
+					break;
+				}
+			}
 		});
 
 		static u32 emitted_particles_stat = profiler::createCounter("Emitted particles", 0);
@@ -555,6 +747,11 @@ struct RenderModuleImpl final : RenderModule {
 		profiler::pushCounter(killed_particles_stat, (float)stats.killed);
 		profiler::pushCounter(processed_particles_stat, (float)stats.processed);
 
+		for (ParticleSystem& ps : m_particle_emitters) {
+			if (ps.hasGPUEmitters()) ps.updateGPU(m_renderer);
+			updateParticleEmitterBounds(ps);
+		}
+
 		for (EntityRef e : to_delete) {
 			m_world.destroyEntity(e);
 		}
@@ -843,15 +1040,70 @@ struct RenderModuleImpl final : RenderModule {
 			serializer.read(probe.flags);
 			serializer.read(probe.size);
 			serializer.read(probe.half_extents);
-			load(probe, entity);
 
 			m_world.onComponentCreated(entity, REFLECTION_PROBE_TYPE, this);
 		}
+		if (count > 0) loadReflectionProbes();
 	}
 
-	void load(ReflectionProbe& probe, EntityRef entity) {
-		ASSERT(!probe.load_job);
+	// loads all probes from the pack, probes which are not in the pack are loaded from their own files
+	void loadReflectionProbes() {
+		FileSystem& fs = m_engine.getFileSystem();
+		if (m_probes_pack_handle.isValid()) fs.cancel(m_probes_pack_handle);
+		m_probes_pack_handle = FileSystem::AsyncHandle::invalid();
+
+		if (!fs.fileExists(ReflectionProbesPack::PATH)) {
+			reflectionProbesPackLoaded({}, false);
+			return;
+		}
+
+		FileSystem::ContentCallback cb = makeDelegate<&RenderModuleImpl::reflectionProbesPackLoaded>(this);
+		m_probes_pack_handle = fs.getContent(Path(ReflectionProbesPack::PATH), cb);
+	}
+
+	void reflectionProbesPackLoaded(Span<const u8> data, bool success) {
+		m_probes_pack_handle = FileSystem::AsyncHandle::invalid();
+
+		Span<const ReflectionProbesPack::Entry> entries;
+		if (success && data.length() >= sizeof(ReflectionProbesPack::Header)) {
+			InputMemoryStream blob(data);
+			ReflectionProbesPack::Header header;
+			blob.read(header);
+			if (header.magic != ReflectionProbesPack::MAGIC || header.version != ReflectionProbesPack::VERSION) {
+				logError("Unsupported ", ReflectionProbesPack::PATH);
+			}
+			else if (header.count * sizeof(ReflectionProbesPack::Entry) > blob.remaining()) {
+				logError("Corrupted ", ReflectionProbesPack::PATH);
+			}
+			else {
+				entries = Span((const ReflectionProbesPack::Entry*)blob.skip(0), header.count);
+			}
+		}
+
+		for (i32 i = 0; i < m_reflection_probes.size(); ++i) {
+			ReflectionProbe& probe = m_reflection_probes.at(i);
+			const EntityRef e = m_reflection_probes.getKey(i);
+			if (probe.load_job) continue;
+
+			const ReflectionProbesPack::Entry* entry = nullptr;
+			for (const ReflectionProbesPack::Entry& iter : entries) {
+				if (iter.guid == probe.guid) {
+					entry = &iter;
+					break;
+				}
+			}
 
+			if (entry && entry->offset + (u64)entry->size <= data.length()) {
+				if (allocTextureID(probe)) uploadReflectionProbe(probe, Span(data.begin() + entry->offset, entry->size));
+			}
+			else {
+				// baked before probes were packed
+				load(probe, e);
+			}
+		}
+	}
+
+	bool allocTextureID(ReflectionProbe& probe) {
 		if (probe.texture_id == 0xffFFffFF) {
 			u32 mask = 0;
 			for (auto& p : m_reflection_probes) {
@@ -866,12 +1118,46 @@ struct RenderModuleImpl final : RenderModule {
 			}
 		}
 
-		const Path path("probes/", probe.guid, ".lbc");
 		if (probe.texture_id == 0xffFFffFF) {
-			logError("There's not enough space for ", path);
+			logError("There's not enough space for reflection probe ", probe.guid);
+			return false;
+		}
+		return true;
+	}
+
+	void uploadReflectionProbe(const ReflectionProbe& probe, Span<const u8> data) {
+		gpu::TextureDesc desc;
+		const u8* image_data = Texture::getLBCInfo(data.begin(), desc);
+		if (!image_data) {
+			logError("Failed to load probe ", probe.guid);
 			return;
 		}
-		
+
+		ASSERT(desc.depth == 1);
+		ASSERT(desc.is_cubemap);
+
+		const u32 layer = probe.texture_id;
+		DrawStream& stream = m_renderer.getDrawStream();
+		const u32 offset = u32(image_data - data.begin());
+		const Renderer::MemRef mem = m_renderer.copy(image_data, data.length() - offset);
+		InputMemoryStream blob(mem.data, data.length() - offset);
+		for (u32 side = 0; side < 6; ++side) {
+			for (u32 mip = 0; mip < desc.mips; ++mip) {
+				u32 w = maximum(desc.width >> mip, 1);
+				u32 h = maximum(desc.height >> mip, 1);
+				const u32 mip_size_bytes = gpu::getSize(desc.format, w, h);
+				stream.update(m_reflection_probes_texture, mip, 0, 0, layer * 6 + side, w, h, desc.format, blob.skip(mip_size_bytes), mip_size_bytes);
+			}
+		}
+		stream.freeMemory(mem.data, m_renderer.getAllocator());
+	}
+
+	void load(ReflectionProbe& probe, EntityRef entity) {
+		ASSERT(!probe.load_job);
+
+		if (!allocTextureID(probe)) return;
+
+		const Path path("probes/", probe.guid, ".lbc");
 		probe.load_job = LUMIX_NEW(m_allocator, ReflectionProbe::LoadJob)(*this, entity, m_allocator);
 		FileSystem::ContentCallback cb = makeDelegate<&ReflectionProbe::LoadJob::callback>(probe.load_job);
 		probe.load_job->m_handle = m_engine.getFileSystem().getContent(path, cb);
@@ -921,11 +1207,13 @@ struct RenderModuleImpl final : RenderModule {
 			ParticleSystem emitter(INVALID_ENTITY, m_world, m_allocator);
 			bool has_autodestroy = version > (i32)RenderModuleVersion::AUTODESTROY_EMITTER;
 			bool emit_rate_removed = version > (i32)RenderModuleVersion::EMIT_RATE_REMOVED;
-			emitter.deserialize(serializer, has_autodestroy, emit_rate_removed, m_engine.getResourceManager());
+			bool has_update_policy = version > (i32)RenderModuleVersion::PARTICLE_UPDATE_POLICY;
+			emitter.deserialize(serializer, has_autodestroy, emit_rate_removed, has_update_policy, m_engine.getResourceManager());
 			emitter.m_entity = entity_map.get(emitter.m_entity);
 			if (emitter.m_entity.isValid()) {
 				EntityRef e = *emitter.m_entity;
 				m_particle_emitters.insert(e, static_cast<ParticleSystem&&>(emitter));
+				addParticleEmitterToCulling(e);
 				m_world.onComponentCreated(e, PARTICLE_EMITTER_TYPE, this);
 			}
 		}
@@ -959,6 +1247,7 @@ struct RenderModuleImpl final : RenderModule {
 
 	void serialize(OutputMemoryStream& serializer) override
 	{
+		serializer.write(m_culling_system->getStructure());
 		serializeCameras(serializer);
 		serializeModelInstances(serializer);
 		serializeLights(serializer);
@@ -1192,14 +1481,7 @@ struct RenderModuleImpl final : RenderModule {
 				blob.read(pg.index_type);
 			}
 			pg.vertex_decl.computeHash();
-			if (!pg.vertex_data.empty()) {
-				const Renderer::MemRef mem = m_renderer.copy(pg.vertex_data.data(), (u32)pg.vertex_data.size());
-				pg.vertex_buffer = m_renderer.createBuffer(mem, gpu::BufferFlags::IMMUTABLE, "pg_vb");			
-			}
-			if (!pg.index_data.empty()) {
-				const Renderer::MemRef mem = m_renderer.copy(pg.index_data.data(), (u32)pg.index_data.size());
-				pg.index_buffer = m_renderer.createBuffer(mem, gpu::BufferFlags::IMMUTABLE, "pg_ib");			
-			}
+			uploadProceduralGeometry(pg);
 			computeAABB(pg);
 			m_procedural_geometries.insert(e, static_cast<ProceduralGeometry&&>(pg));
 			m_world.onComponentCreated(e, PROCEDURAL_GEOM_TYPE, this);
@@ -1223,6 +1505,9 @@ struct RenderModuleImpl final : RenderModule {
 
 	void deserialize(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) override
 	{
+		if (version > (i32)RenderModuleVersion::CULLING_STRUCTURE) {
+			setCullingStructure(serializer.read<CullingStructure>());
+		}
 		deserializeCameras(serializer, entity_map, version);
 		if (version > (i32)RenderModuleVersion::SMALLER_MODEL_INSTANCES) {
 			deserializeModelInstances(serializer, entity_map, (RenderModuleVersion)version);
@@ -1283,84 +1568,358 @@ struct RenderModuleImpl final : RenderModule {
 
 	void initInstancedModelGPUData(EntityRef entity) override {
 		PROFILE_FUNCTION();
-		InstancedModel& im = m_instanced_models[entity];
-		if (im.gpu_data) {
-			if (im.gpu_capacity < (u32)im.instances.size()) {
-				m_renderer.getEndFrameDrawStream().destroy(im.gpu_data);
-				im.gpu_data = gpu::INVALID_BUFFER;
-				im.gpu_capacity = 0;
-			}
+		initGPUData(m_instanced_models[entity]);
+	}
+
+	const HashMap<Model*, GPUDrivenModel>& getGPUDrivenModels() const override {
+		return m_gpu_driven_models;
+	}
+
+	void initGPUDrivenModelGPUData(Model* model) override {
+		PROFILE_FUNCTION();
+		GPUDrivenModel& gm = m_gpu_driven_models[model];
+		InstancedModel& im = gm.im;
+		// instances are kept up to date by add/remove/move, initGPUData uploads only cells whose content changed
+		im.instances.resize(gm.instances.size());
+		if (!gm.instances.empty()) memcpy(im.instances.begin(), gm.instances.begin(), gm.instances.byte_size());
+		initGPUData(im);
+	}
+
+	void setGPUDrivenInstance(GPUDrivenModel& gm, u32 slot, EntityRef entity) {
+		const Transform tr = m_world.getTransform(entity);
+		InstancedModel::InstanceData& id = gm.instances[slot];
+		id.rot_quat = Vec3(tr.rot.x, tr.rot.y, tr.rot.z);
+		if (tr.rot.w < 0) id.rot_quat = -id.rot_quat;
+		id.lod = 3;
+		id.pos = Vec3(tr.pos - gm.origin);
+		id.scale = tr.scale.x;
+		gm.im.dirty = true;
+	}
+
+	// instance of a static model, which can be rendered as a part of GPUDrivenModel
+	bool isGPUDrivenCandidate(EntityRef entity) const {
+		if (!m_renderer.isGPUDriven()) return false;
+		const ModelInstance& mi = m_model_instances[entity.index];
+		if (!mi.model || !mi.model->isReady() || mi.model->isSkinned()) return false;
+		if (hasMaterialOverride(mi) || (mi.flags & ModelInstance::IS_BONE_ATTACHMENT_PARENT)) return false;
+		// see indices_count in instancing shader
+		if (mi.model->getMeshCount() > 32) return false;
+		const Vec3 scale = m_world.getScale(entity);
+		return scale.x == scale.y && scale.x == scale.z;
+	}
+
+	// model instance is rendered either from culling system or as a part of GPUDrivenModel
+	void addRenderable(EntityRef entity) {
+		ModelInstance& mi = m_model_instances[entity.index];
+		if (isGPUDrivenCandidate(entity)) {
+			auto iter = m_gpu_driven_models.find(mi.model);
+			if (!iter.isValid()) iter = m_gpu_driven_models.insert(mi.model, GPUDrivenModel(m_allocator));
+			GPUDrivenModel& gm = iter.value();
+			if (gm.entities.empty()) gm.origin = m_world.getPosition(entity);
+			const u32 slot = gm.entities.size();
+			gm.entities.push(entity);
+			gm.instances.emplace();
+			gm.entity_to_slot.insert(entity, slot);
+			gm.im.model = mi.model;
+			setGPUDrivenInstance(gm, slot, entity);
+			mi.flags |= ModelInstance::GPU_DRIVEN;
+			return;
 		}
 
-		// grid aabb
-		im.grid.aabb = AABB(Vec3(FLT_MAX), Vec3(-FLT_MAX));
-		for (const InstancedModel::InstanceData& id : im.instances) {
-			im.grid.aabb.addPoint(id.pos);
+		const DVec3 pos = m_world.getPosition(entity);
+		const Vec3& scale = m_world.getScale(entity);
+		const float radius = mi.model->getOriginBoundingRadius() * maximum(scale.x, scale.y, scale.z);
+		m_culling_system->add(entity, (u8)getRenderableType(*mi.model), pos, radius);
+		if (!mi.model->isSkinned()) m_shadow_caster_changes.push({pos, radius});
+	}
+
+	void removeRenderable(EntityRef entity) {
+		ModelInstance& mi = m_model_instances[entity.index];
+		if (!mi.model->isSkinned()) {
+			const Transform tr = m_world.getTransform(entity);
+			const float radius = mi.model->getOriginBoundingRadius() * maximum(tr.scale.x, tr.scale.y, tr.scale.z);
+			m_shadow_caster_changes.push({tr.pos, radius});
+		}
+		if (!(mi.flags & ModelInstance::GPU_DRIVEN)) {
+			m_culling_system->remove(entity);
+			return;
 		}
 
-		// cells aabb
-		const Vec2 cell_size = (im.grid.aabb.max.xz() - im.grid.aabb.min.xz()) * 0.25f;
-		for (u32 j = 0; j < 4; ++j) {
-			for (u32 i = 0; i < 4; ++i) {
-				InstancedModel::Grid::Cell& cell = im.grid.cells[i + j * 4];
-				cell.from_instance = 0;
-				cell.instance_count = 0;
-				cell.aabb.min.x = im.grid.aabb.min.x + cell_size.x * i;
-				cell.aabb.min.y = im.grid.aabb.min.y;
-				cell.aabb.min.z = im.grid.aabb.min.z + cell_size.y * j;
-				cell.aabb.max.x = cell.aabb.min.x + cell_size.x;
-				cell.aabb.max.y = im.grid.aabb.max.y;
-				cell.aabb.max.z = cell.aabb.min.z + cell_size.y;
-				cell.aabb.shrink(-0.01f);
-			}
+		mi.flags &= ~ModelInstance::GPU_DRIVEN;
+		auto iter = m_gpu_driven_models.find(mi.model);
+		if (!iter.isValid()) return;
+		GPUDrivenModel& gm = iter.value();
+		// swap with the last one, so only the cells of these two instances change
+		auto slot_iter = gm.entity_to_slot.find(entity);
+		ASSERT(slot_iter.isValid());
+		const u32 slot = slot_iter.value();
+		gm.entity_to_slot.erase(slot_iter);
+		const EntityRef last = gm.entities.back();
+		if (last != entity) {
+			gm.entities[slot] = last;
+			gm.instances[slot] = gm.instances.back();
+			gm.entity_to_slot[last] = slot;
+		}
+		gm.entities.pop();
+		gm.instances.pop();
+		gm.im.dirty = true;
+		if (gm.entities.empty()) {
+			// model can be destroyed before next frame, so the group must not outlive its instances
+			if (gm.im.gpu_data) m_renderer.getEndFrameDrawStream().destroy(gm.im.gpu_data);
+			m_gpu_driven_models.erase(iter);
+		}
+	}
+
+	static u32 computeGridResolution(u32 instance_count) {
+		const u32 block_size = InstancedModel::Grid::BLOCK_SIZE;
+		// ~1024 instances per cell
+		const u32 resolution = (u32)ceilf(sqrtf(instance_count / 1024.f));
+		return clamp((resolution + block_size - 1) / block_size * block_size, block_size, 128);
+	}
+
+	// see InstancedModel::GPUInstanceData and decodeInstanceData in instancing.hlsl
+	static InstancedModel::GPUInstanceData quantizeInstanceData(const InstancedModel::InstanceData& id, const Vec3& cell_origin, const Vec3& cell_size) {
+		InstancedModel::GPUInstanceData res;
+		auto quantize = [](float v, float range, u32 max) {
+			return (u32)clamp(i32(v / range * max + 0.5f), 0, (i32)max);
+		};
+
+		const Vec3 rel = id.pos - cell_origin;
+		const u32 x = quantize(rel.x, cell_size.x, 0xffFF);
+		const u32 y = quantize(rel.y, cell_size.y, 0xffFF);
+		const u32 z = quantize(rel.z, cell_size.z, 0xffFF);
+		// log2 scale with 1/16 steps, 0 is reserved for zero scale
+		const u32 scale = id.scale <= 0 ? 0 : (u32)clamp(i32(log2f(id.scale) * 16 + 128.5f), 1, 255);
+		// 63 steps per LOD, same as in instancing.hlsl
+		const u32 lod = quantize(id.lod, 4, 63 * 4);
+		res.pos_xy = x | (y << 16);
+		res.pos_z_scale_lod = z | (scale << 16) | (lod << 24);
+
+		float q[4] = { id.rot_quat.x, id.rot_quat.y, id.rot_quat.z, sqrtf(maximum(0.f, 1 - dot(id.rot_quat, id.rot_quat))) };
+		u32 largest = 3;
+		for (u32 i = 0; i < 3; ++i) {
+			if (fabsf(q[i]) > fabsf(q[largest])) largest = i;
+		}
+		const float sign = q[largest] < 0 ? -1.f : 1.f;
+		res.rot = largest << 30;
+		u32 shift = 20;
+		for (u32 i = 0; i < 4; ++i) {
+			if (i == largest) continue;
+			// other components are in [-1/sqrt(2), 1/sqrt(2)]
+			res.rot |= quantize(q[i] * sign * SQRT2 * 0.5f + 0.5f, 1, 1023) << shift;
+			shift -= 10;
+		}
+		return res;
+	}
+
+	// sorts instances to grid cells and uploads them to gpu
+	// grid layout is kept if possible, in which case only changed cells are uploaded
+	void initGPUData(InstancedModel& im) {
+		using Grid = InstancedModel::Grid;
+		using InstanceData = InstancedModel::InstanceData;
+		using GPUInstanceData = InstancedModel::GPUInstanceData;
+		Grid& grid = im.grid;
+		const u32 instance_count = im.instances.size();
+		im.dirty = false;
+		
+		if (instance_count == 0) {
+			grid.resolution = 0;
+			grid.cells.clear();
+			grid.blocks.clear();
+			return;
 		}
 
+		AABB aabb(Vec3(FLT_MAX), Vec3(-FLT_MAX));
+		grid.max_scale = 0;
+		for (const InstanceData& id : im.instances) {
+			aabb.addPoint(id.pos);
+			grid.max_scale = maximum(grid.max_scale, id.scale);
+		}
+
+		const u32 resolution = computeGridResolution(instance_count);
+		bool relayout = !im.gpu_data
+			|| resolution != grid.resolution
+			|| !grid.aabb.contains(aabb.min)
+			|| !grid.aabb.contains(aabb.max);
+
+		if (relayout) {
+			// some space around, so instances painted close to the border do not cause relayout
+			const Vec3 margin = (aabb.max - aabb.min) * 0.05f + Vec3(0.01f);
+			grid.aabb = AABB(aabb.min - margin, aabb.max + margin);
+			grid.resolution = resolution;
+			grid.cells.resize(resolution * resolution);
+			grid.blocks.resize(resolution * resolution / (Grid::BLOCK_SIZE * Grid::BLOCK_SIZE));
+		}
+
+		// cells are sorted by blocks
+		const Vec2 cell_size = (grid.aabb.max.xz() - grid.aabb.min.xz()) / float(resolution);
+		grid.cell_size = Vec3(cell_size.x, grid.aabb.max.y - grid.aabb.min.y, cell_size.y);
+		const u32 blocks_per_side = resolution / Grid::BLOCK_SIZE;
+		auto getCellIndex = [&](const Vec3& pos) {
+			const u32 x = (u32)clamp(i32((pos.x - grid.aabb.min.x) / cell_size.x), 0, i32(resolution - 1));
+			const u32 z = (u32)clamp(i32((pos.z - grid.aabb.min.z) / cell_size.y), 0, i32(resolution - 1));
+			const u32 block = (z / Grid::BLOCK_SIZE) * blocks_per_side + x / Grid::BLOCK_SIZE;
+			return block * Grid::BLOCK_SIZE * Grid::BLOCK_SIZE + (z % Grid::BLOCK_SIZE) * Grid::BLOCK_SIZE + x % Grid::BLOCK_SIZE;
+		};
+		auto getCellOrigin = [&](u32 cell_idx) {
+			const u32 block = cell_idx / (Grid::BLOCK_SIZE * Grid::BLOCK_SIZE);
+			const u32 in_block = cell_idx % (Grid::BLOCK_SIZE * Grid::BLOCK_SIZE);
+			const u32 x = (block % blocks_per_side) * Grid::BLOCK_SIZE + in_block % Grid::BLOCK_SIZE;
+			const u32 z = (block / blocks_per_side) * Grid::BLOCK_SIZE + in_block / Grid::BLOCK_SIZE;
+			return grid.aabb.min + Vec3(x * cell_size.x, 0, z * cell_size.y);
+		};
+
 		// count
-		for (const InstancedModel::InstanceData& id : im.instances) {
-			for (u32 i = 0; i < 16; ++i) {
-				if (im.grid.cells[i].aabb.contains(id.pos)) {
-					++im.grid.cells[i].instance_count;
-					break;
-				}
-			}
+		for (Grid::Cell& cell : grid.cells) {
+			cell.instance_count = 0;
+			cell.aabb = AABB(Vec3(FLT_MAX), Vec3(-FLT_MAX));
+		}
+		Array<u32> cell_indices(m_allocator);
+		cell_indices.resize(instance_count);
+		for (u32 i = 0; i < instance_count; ++i) {
+			const Vec3 pos = im.instances[i].pos;
+			const u32 cell_idx = getCellIndex(pos);
+			cell_indices[i] = cell_idx;
+			++grid.cells[cell_idx].instance_count;
+			grid.cells[cell_idx].aabb.addPoint(pos);
 		}
 
 		// offsets
-		for (u32 i = 1; i < 16; ++i) {
-			im.grid.cells[i].from_instance = im.grid.cells[i - 1].instance_count + im.grid.cells[i - 1].from_instance;
+		u32 offset = 0;
+		for (Grid::Cell& cell : grid.cells) {
+			cell.from_instance = offset;
+			offset += cell.instance_count;
+			cell.instance_count = 0;
 		}
 
-		for (u32 i = 0; i < 16; ++i) im.grid.cells[i].instance_count = 0;
-
 		// scatter
-		Array<InstancedModel::InstanceData> tmp(m_allocator);
-		tmp.resize(im.instances.size());
-		for (const InstancedModel::InstanceData& id : im.instances) {
-			for (u32 i = 0; i < 16; ++i) {
-				if (im.grid.cells[i].aabb.contains(id.pos)) {
-					tmp[im.grid.cells[i].instance_count + im.grid.cells[i].from_instance] = id;
-					++im.grid.cells[i].instance_count;
+		Array<InstanceData> tmp(m_allocator);
+		tmp.resize(instance_count);
+		for (u32 i = 0; i < instance_count; ++i) {
+			Grid::Cell& cell = grid.cells[cell_indices[i]];
+			tmp[cell.from_instance + cell.instance_count] = im.instances[i];
+			++cell.instance_count;
+		}
+		im.instances.swap(tmp);
+
+		if (!relayout) {
+			for (const Grid::Cell& cell : grid.cells) {
+				if (cell.instance_count > cell.gpu_capacity) {
+					relayout = true;
 					break;
 				}
 			}
 		}
-		im.instances.swap(tmp);
 
-		if (!im.instances.empty()) {
-			if (im.gpu_data) {
-				Renderer::MemRef mem = m_renderer.copy(im.instances.begin(), im.instances.byte_size());
-				DrawStream& stream = m_renderer.getDrawStream();
-				stream.update(im.gpu_data, mem.data, mem.size);
-				stream.freeMemory(mem.data, m_renderer.getAllocator());
+		u32 gpu_size = 0;
+		if (relayout) {
+			for (Grid::Cell& cell : grid.cells) {
+				cell.gpu_offset = gpu_size;
+				// aligned to chunks, so each chunk belongs to one cell
+				const u32 capacity = cell.instance_count + cell.instance_count / 4 + 4;
+				cell.gpu_capacity = (capacity + InstancedModel::GPU_CHUNK_SIZE - 1) / InstancedModel::GPU_CHUNK_SIZE * InstancedModel::GPU_CHUNK_SIZE;
+				gpu_size += cell.gpu_capacity;
 			}
-			else {
-				Renderer::MemRef mem = m_renderer.copy(im.instances.begin(), im.instances.capacity() * sizeof(im.instances[0]));
-				im.gpu_data = m_renderer.createBuffer(mem, gpu::BufferFlags::SHADER_BUFFER, "instances");
-				im.gpu_capacity = im.instances.capacity();
+		}
+
+		for (u32 i = 0; i < (u32)grid.blocks.size(); ++i) {
+			Grid::Block& block = grid.blocks[i];
+			const Grid::Cell* cells = &grid.cells[i * Grid::BLOCK_SIZE * Grid::BLOCK_SIZE];
+			const Grid::Cell& last = cells[Grid::BLOCK_SIZE * Grid::BLOCK_SIZE - 1];
+			block.aabb = AABB(Vec3(FLT_MAX), Vec3(-FLT_MAX));
+			block.instance_count = 0;
+			block.gpu_offset = cells[0].gpu_offset;
+			block.gpu_size = last.gpu_offset + last.gpu_capacity - block.gpu_offset;
+			for (u32 j = 0; j < Grid::BLOCK_SIZE * Grid::BLOCK_SIZE; ++j) {
+				if (cells[j].instance_count == 0) continue;
+				block.aabb.merge(cells[j].aabb);
+				block.instance_count += cells[j].instance_count;
 			}
 		}
 
-		im.dirty = false;
+		// free slots are filled with zero scale instances beyond the last LOD, so they are never drawn
+		// this way neighbouring cells can be processed in one dispatch even if there are free slots between them
+		InstanceData free_slot;
+		free_slot.rot_quat = Vec3(0);
+		free_slot.lod = 4;
+		free_slot.pos = grid.aabb.min;
+		free_slot.scale = 0;
+		const InstancedModel::GPUInstanceData gpu_free_slot = quantizeInstanceData(free_slot, grid.aabb.min, grid.cell_size);
+		auto writeCell = [&](u32 cell_idx, GPUInstanceData* dst) {
+			const Grid::Cell& cell = grid.cells[cell_idx];
+			const Vec3 cell_origin = getCellOrigin(cell_idx);
+			for (u32 i = 0; i < cell.instance_count; ++i) {
+				dst[i] = quantizeInstanceData(im.instances[cell.from_instance + i], cell_origin, grid.cell_size);
+			}
+			for (u32 i = cell.instance_count; i < cell.gpu_capacity; ++i) dst[i] = gpu_free_slot;
+		};
+		auto hashCell = [&](const Grid::Cell& cell) {
+			if (cell.instance_count == 0) return RuntimeHash();
+			return RuntimeHash(&im.instances[cell.from_instance], cell.instance_count * sizeof(InstanceData));
+		};
+
+		DrawStream& stream = m_renderer.getDrawStream();
+		if (!relayout) {
+			PROFILE_BLOCK("update cells");
+			for (u32 i = 0, c = grid.cells.size(); i < c; ++i) {
+				Grid::Cell& cell = grid.cells[i];
+				const RuntimeHash hash = hashCell(cell);
+				if (hash == cell.hash) continue;
+
+				cell.hash = hash;
+				const u32 size = cell.gpu_capacity * sizeof(GPUInstanceData);
+				const Renderer::TransientSlice slice = m_renderer.allocTransient(size);
+				writeCell(i, (GPUInstanceData*)slice.ptr);
+				stream.copy(im.gpu_data, slice.buffer, cell.gpu_offset * sizeof(GPUInstanceData), slice.offset, size);
+			}
+			return;
+		}
+
+		for (Grid::Cell& cell : grid.cells) cell.hash = hashCell(cell);
+
+		if (im.gpu_data && im.gpu_capacity < gpu_size) {
+			m_renderer.getEndFrameDrawStream().destroy(im.gpu_data);
+			im.gpu_data = gpu::INVALID_BUFFER;
+			im.gpu_capacity = 0;
+		}
+
+		// instances followed by origins of chunks
+		auto writeAll = [&](u8* dst, u32 capacity) {
+			GPUInstanceData* instances = (GPUInstanceData*)dst;
+			for (u32 i = 0, c = grid.cells.size(); i < c; ++i) writeCell(i, instances + grid.cells[i].gpu_offset);
+			for (u32 i = gpu_size; i < capacity; ++i) instances[i] = gpu_free_slot;
+
+			Vec4* chunk_origins = (Vec4*)(instances + capacity);
+			for (u32 i = 0, c = grid.cells.size(); i < c; ++i) {
+				const Grid::Cell& cell = grid.cells[i];
+				const Vec4 origin(getCellOrigin(i), 0);
+				for (u32 j = 0; j < cell.gpu_capacity; j += InstancedModel::GPU_CHUNK_SIZE) {
+					chunk_origins[(cell.gpu_offset + j) / InstancedModel::GPU_CHUNK_SIZE] = origin;
+				}
+			}
+			for (u32 i = gpu_size; i < capacity; i += InstancedModel::GPU_CHUNK_SIZE) {
+				chunk_origins[i / InstancedModel::GPU_CHUNK_SIZE] = Vec4(grid.aabb.min, 0);
+			}
+		};
+		auto getBufferSize = [](u32 capacity) {
+			return capacity * sizeof(GPUInstanceData) + capacity / InstancedModel::GPU_CHUNK_SIZE * sizeof(Vec4);
+		};
+
+		if (im.gpu_data) {
+			const u32 size = getBufferSize(im.gpu_capacity);
+			const Renderer::TransientSlice slice = m_renderer.allocTransient(size);
+			writeAll(slice.ptr, im.gpu_capacity);
+			stream.copy(im.gpu_data, slice.buffer, 0, slice.offset, size);
+		}
+		else {
+			// some free space, so the buffer does not need to be recreated on each relayout
+			u32 capacity = gpu_size + gpu_size / 4;
+			capacity = (capacity + InstancedModel::GPU_CHUNK_SIZE - 1) / InstancedModel::GPU_CHUNK_SIZE * InstancedModel::GPU_CHUNK_SIZE;
+			Renderer::MemRef mem = m_renderer.allocate(getBufferSize(capacity));
+			writeAll((u8*)mem.data, capacity);
+			im.gpu_data = m_renderer.createBuffer(mem, gpu::BufferFlags::SHADER_BUFFER, "instances");
+			im.gpu_capacity = capacity;
+		}
 	}
 
 	void destroyInstancedModel(EntityRef entity) override {
@@ -1431,6 +1990,7 @@ struct RenderModuleImpl final : RenderModule {
 	void destroyParticleEmitter(EntityRef entity) override {
 		const ParticleSystem& emitter = m_particle_emitters[entity];
 		m_world.onComponentDestroyed(*emitter.m_entity, PARTICLE_EMITTER_TYPE, this);
+		m_culling_system->remove(entity);
 		m_particle_emitters.erase(*emitter.m_entity);
 	}
 
@@ -1467,9 +2027,22 @@ struct RenderModuleImpl final : RenderModule {
 
 	void createParticleEmitter(EntityRef entity) override {
 		m_particle_emitters.insert(entity, ParticleSystem(entity, m_world, m_allocator));
+		addParticleEmitterToCulling(entity);
 		m_world.onComponentCreated(entity, PARTICLE_EMITTER_TYPE, this);
 	}
 
+	// particles are rendered without entity's scale, see Pipeline::createCommands
+	void addParticleEmitterToCulling(EntityRef entity) {
+		const Transform tr = m_world.getTransform(entity);
+		const ParticleSystem& ps = m_particle_emitters[entity];
+		m_culling_system->add(entity, (u8)RenderableTypes::PARTICLES, tr.pos + tr.rot.rotate(ps.getBoundsCenter()), ps.getBoundsRadius());
+	}
+
+	void updateParticleEmitterBounds(const ParticleSystem& ps) {
+		const Transform tr = m_world.getTransform(*ps.m_entity);
+		m_culling_system->set(*ps.m_entity, tr.pos + tr.rot.rotate(ps.getBoundsCenter()), ps.getBoundsRadius());
+	}
+
 	Path getEnvironmentSkyTexture(EntityRef entity)	const override {
 		return m_environments[entity].cubemap_sky ? m_environments[entity].cubemap_sky->getPath() : Path();
 	}
@@ -1511,6 +2084,8 @@ struct RenderModuleImpl final : RenderModule {
 	}
 
 
+	Span<const ShadowCasterChange> getShadowCasterChanges() const override { return m_shadow_caster_changes; }
+
 	Span<ModelInstance> getModelInstances() override
 	{
 		return m_model_instances;
@@ -1532,6 +2107,16 @@ struct RenderModuleImpl final : RenderModule {
 		}
 	}
 
+	// inactive model instances keep their ENABLED flag, they are just not in culling system
+	void onEntityActiveChanged(EntityRef entity, bool active) {
+		if (!m_world.hasComponent(entity, MODEL_INSTANCE_TYPE)) return;
+		if (!active) {
+			removeRenderable(entity);
+			return;
+		}
+		if (m_model_instances[entity.index].flags & ModelInstance::ENABLED) enableModelInstance(entity, true);
+	}
+
 	void onBoneAttachmentMoved(EntityRef entity) {
 		updateRelativeMatrix(m_bone_attachments[entity]);
 // TODO update bont attachment's relative matrix if the attachment is moved not by moving its parent
@@ -1551,25 +2136,49 @@ struct RenderModuleImpl final : RenderModule {
 #endif
 	}
 
-	void onModelInstanceMoved(EntityRef entity) {
-		if (!m_culling_system->isAdded(entity)) return;
-		
-		const Transform& tr = m_world.getTransform(entity);
-		ModelInstance& mi = m_model_instances[entity.index];
-		m_moved_instances.push(entity);
-		mi.flags |= ModelInstance::MOVED;
-		const Model* model = mi.model;
-		ASSERT(model);
-		const float bounding_radius = model->getOriginBoundingRadius();
-		m_culling_system->set(entity, tr.pos, bounding_radius * maximum(tr.scale.x, tr.scale.y, tr.scale.z));
-
-		if (mi.flags & ModelInstance::IS_BONE_ATTACHMENT_PARENT) {
-			for (auto& attachment : m_bone_attachments) {
-				if (attachment.parent_entity == entity) {
-					EntityPtr backup = m_updating_attachment;
-					m_updating_attachment = attachment.entity;
-					updateBoneAttachment(attachment);
-					m_updating_attachment = backup;
+	void onModelInstancesMoved(Span<const EntityRef> entities) {
+		m_moved_instances.reserve(m_moved_instances.size() + entities.length());
+		for (EntityRef entity : entities) {
+			ModelInstance& mi = m_model_instances[entity.index];
+			if (mi.flags & ModelInstance::GPU_DRIVEN) {
+				if (isGPUDrivenCandidate(entity)) {
+					GPUDrivenModel& gm = m_gpu_driven_models[mi.model];
+					setGPUDrivenInstance(gm, gm.entity_to_slot[entity], entity);
+					const Transform& tr = m_world.getTransform(entity);
+					const float radius = mi.model->getOriginBoundingRadius();
+					const Vec3 prev_scale = mi.prev_frame_transform.scale;
+					m_shadow_caster_changes.push({mi.prev_frame_transform.pos, radius * maximum(prev_scale.x, prev_scale.y, prev_scale.z)});
+					m_shadow_caster_changes.push({tr.pos, radius * maximum(tr.scale.x, tr.scale.y, tr.scale.z)});
+				}
+				else {
+					removeRenderable(entity);
+					addRenderable(entity);
+				}
+				continue;
+			}
+			if (!m_culling_system->isAdded(entity)) continue;
+			
+			const Transform& tr = m_world.getTransform(entity);
+			m_moved_instances.push(entity);
+			mi.flags |= ModelInstance::MOVED;
+			const Model* model = mi.model;
+			ASSERT(model);
+			const float bounding_radius = model->getOriginBoundingRadius();
+			if (!model->isSkinned()) {
+				// shadows must be updated both where the instance was and where it is now
+				m_shadow_caster_changes.push({mi.prev_frame_transform.pos, m_culling_system->getRadius(entity)});
+				m_shadow_caster_changes.push({tr.pos, bounding_radius * maximum(tr.scale.x, tr.scale.y, tr.scale.z)});
+			}
+			m_culling_system->set(entity, tr.pos, bounding_radius * maximum(tr.scale.x, tr.scale.y, tr.scale.z));
+
+			if (mi.flags & ModelInstance::IS_BONE_ATTACHMENT_PARENT) {
+				for (auto& attachment : m_bone_attachments) {
+					if (attachment.parent_entity == entity) {
+						EntityPtr backup = m_updating_attachment;
+						m_updating_attachment = attachment.entity;
+						updateBoneAttachment(attachment);
+						m_updating_attachment = backup;
+					}
 				}
 			}
 		}
@@ -1602,7 +2211,9 @@ struct RenderModuleImpl final : RenderModule {
 	}
 
 	void onParticleEmitterMoved(EntityRef entity) {
-		m_particle_emitters[entity].applyTransform(m_world.getTransform(entity));
+		ParticleSystem& ps = m_particle_emitters[entity];
+		ps.applyTransform(m_world.getTransform(entity));
+		updateParticleEmitterBounds(ps);
 	}
 
 	Engine& getEngine() const override { return m_engine; }
@@ -1872,14 +2483,6 @@ struct RenderModuleImpl final : RenderModule {
 		ProceduralGeometry& pg = m_procedural_geometries[entity];
 		pg.index_data.clear();
 		pg.vertex_data.clear();
-		if (pg.vertex_buffer) {
-			m_renderer.getEndFrameDrawStream().destroy(pg.vertex_buffer);
-			pg.vertex_buffer = gpu::INVALID_BUFFER;
-		}
-		if (pg.index_buffer) {
-			m_renderer.getEndFrameDrawStream().destroy(pg.index_buffer);
-			pg.index_buffer = gpu::INVALID_BUFFER;
-		}
 		
 		value.read(pg.vertex_decl);
 		value.read(pg.index_type);
@@ -1887,20 +2490,43 @@ struct RenderModuleImpl final : RenderModule {
 		if (size > 0) {
 			pg.vertex_data.resize(size);
 			value.read(pg.vertex_data.getMutableData(), pg.vertex_data.size());
-			const Renderer::MemRef mem = m_renderer.copy(pg.vertex_data.data(), (u32)pg.vertex_data.size());
-			pg.vertex_buffer = m_renderer.createBuffer(mem, gpu::BufferFlags::IMMUTABLE, "pg_vb");
 		}
 
 		size = value.read<u32>();
 		if (size > 0) {
 			pg.index_data.resize(size);
 			value.read(pg.index_data.getMutableData(), pg.index_data.size());
-			const Renderer::MemRef mem = m_renderer.copy(pg.index_data.data(), (u32)pg.index_data.size());
-			pg.index_buffer = m_renderer.createBuffer(mem, gpu::BufferFlags::IMMUTABLE, "pg_ib");
 		}
+		uploadProceduralGeometry(pg);
+		computeAABB(pg);
 	}
 
+	// `data` are uploaded to `buffer`, which is recreated only if they do not fit
+	void uploadProceduralBuffer(gpu::BufferHandle& buffer, u32& capacity, Span<const u8> data, const char* debug_name) {
+		if (data.length() == 0) return;
+		if (buffer && data.length() <= capacity) {
+			const Renderer::TransientSlice slice = m_renderer.allocTransient(data.length());
+			memcpy(slice.ptr, data.begin(), data.length());
+			m_renderer.getDrawStream().copy(buffer, slice.buffer, 0, slice.offset, data.length());
+			return;
+		}
+
+		if (buffer) m_renderer.getEndFrameDrawStream().destroy(buffer);
+		capacity = maximum(capacity * 2, data.length());
+		const Renderer::MemRef mem = m_renderer.allocate(capacity);
+		memcpy(mem.data, data.begin(), data.length());
+		memset((u8*)mem.data + data.length(), 0, capacity - data.length());
+		buffer = m_renderer.createBuffer(mem, gpu::BufferFlags::NONE, debug_name);
+	}
+
+	void uploadProceduralGeometry(ProceduralGeometry& pg) {
+		uploadProceduralBuffer(pg.vertex_buffer, pg.vertex_buffer_capacity, Span(pg.vertex_data.data(), (u32)pg.vertex_data.size()), "pg_vb");
+		uploadProceduralBuffer(pg.index_buffer, pg.index_buffer_capacity, Span(pg.index_data.data(), (u32)pg.index_data.size()), "pg_ib");
+	}
+
+	// called whenever vertex data change, so it also invalidates raycast BVH
 	static void computeAABB(ProceduralGeometry& pg) {
+		pg.bvh.clear();
 		pg.aabb.min = Vec3(FLT_MAX);
 		pg.aabb.max = Vec3(-FLT_MAX);
 
@@ -1930,18 +2556,22 @@ struct RenderModuleImpl final : RenderModule {
 		pg.index_data.clear();
 		pg.index_type = index_type;
 		pg.vertex_data.write(vertex_data.begin(), vertex_data.length());
+		pg.index_data.write(indices.begin(), indices.length());
+		uploadProceduralGeometry(pg);
+		computeAABB(pg);
+	}
+
+	void updateProceduralGeometryVertices(EntityRef entity, u32 offset, Span<const u8> data) override {
+		PROFILE_FUNCTION();
+		ProceduralGeometry& pg = m_procedural_geometries[entity];
+		ASSERT(offset + data.length() <= pg.vertex_data.size());
+		if (data.length() == 0) return;
+		// data can point into vertex_data
+		memmove(pg.vertex_data.getMutableData() + offset, data.begin(), data.length());
 		
-		if (pg.index_buffer) m_renderer.getEndFrameDrawStream().destroy(pg.index_buffer);
-		if (pg.vertex_buffer) m_renderer.getEndFrameDrawStream().destroy(pg.vertex_buffer);
-		
-		if (indices.length() > 0) {
-			pg.index_data.write(indices.begin(), indices.length());
-			const Renderer::MemRef mem = m_renderer.copy(indices.begin(), indices.length());
-			pg.index_buffer = m_renderer.createBuffer(mem, gpu::BufferFlags::IMMUTABLE, "pg_ib");
-		}
-		
-		const Renderer::MemRef mem = m_renderer.copy(vertex_data.begin(), vertex_data.length());
-		pg.vertex_buffer = m_renderer.createBuffer(mem, gpu::BufferFlags::IMMUTABLE, "pg_vb");
+		const Renderer::TransientSlice slice = m_renderer.allocTransient(data.length());
+		memcpy(slice.ptr, pg.vertex_data.data() + offset, data.length());
+		m_renderer.getDrawStream().copy(pg.vertex_buffer, slice.buffer, offset, slice.offset, data.length());
 		computeAABB(pg);
 	}
 	
@@ -2032,18 +2662,15 @@ struct RenderModuleImpl final : RenderModule {
 		if (enable)
 		{
 			if (!model_instance.model || !model_instance.model->isReady()) return;
+			if (!m_world.isEntityActive(entity)) return;
 
-			const DVec3 pos = m_world.getPosition(entity);
-			const Vec3& scale = m_world.getScale(entity);
-			const float radius = model_instance.model->getOriginBoundingRadius() * maximum(scale.x, scale.y, scale.z);
-			if (!m_culling_system->isAdded(entity)) {
-				const RenderableTypes type = getRenderableType(*model_instance.model);
-				m_culling_system->add(entity, (u8)type, pos, radius);
+			if (!m_culling_system->isAdded(entity) && !(model_instance.flags & ModelInstance::GPU_DRIVEN)) {
+				addRenderable(entity);
 			}
 		}
 		else
 		{
-			m_culling_system->remove(entity);
+			removeRenderable(entity);
 		}
 	}
 
@@ -2091,6 +2718,12 @@ struct RenderModuleImpl final : RenderModule {
 		mat.sort_key = 0;
 		mat.material_index = MaterialIndex{0};
 		mi.dirty = true;
+
+		// instances with material override are not GPU driven
+		if (mi.flags & ModelInstance::GPU_DRIVEN) {
+			removeRenderable(entity);
+			addRenderable(entity);
+		}
 	}
 
 	Path getModelInstanceMaterialOverride(EntityRef entity, u32 mesh_idx) override {
@@ -2126,6 +2759,7 @@ struct RenderModuleImpl final : RenderModule {
 
 	void setModelInstanceLOD(EntityRef entity, u32 lod) override {
 		m_model_instances[entity.index].lod = float(lod);
+		m_model_instances[entity.index].lod_target = (u8)lod;
 	}
 
 	void setModelInstancePath(EntityRef entity, const Path& path) override
@@ -2254,9 +2888,21 @@ struct RenderModuleImpl final : RenderModule {
 	}
 
 
-	CullResult* getRenderables(const ShiftedFrustum& frustum) const override
+	CullResult* getRenderables(const ShiftedFrustum& frustum, const DVec3& lod_ref_point) const override
 	{
-		return m_culling_system->cull(frustum);
+		return m_culling_system->cull(frustum, lod_ref_point);
+	}
+
+	CullingStructure getCullingStructure() const override { return m_culling_system->getStructure(); }
+
+	void setCullingStructure(CullingStructure structure) override {
+		if (m_culling_system->getStructure() == structure) return;
+
+		UniquePtr<CullingSystem> culling_system = CullingSystem::create(m_allocator, m_engine.getPageAllocator(), structure);
+		m_culling_system->forEach([&](EntityRef entity, u8 type, const DVec3& pos, float radius){
+			culling_system->add(entity, type, pos, radius);
+		});
+		m_culling_system = culling_system.move();
 	}
 
 
@@ -2311,8 +2957,71 @@ struct RenderModuleImpl final : RenderModule {
 	void clearDebugLines() override { m_debug_lines.clear(); }
 	void clearDebugTriangles() override { m_debug_triangles.clear(); }
 
-	const Array<DebugTriangle>& getDebugTriangles() const override { return m_debug_triangles; }
-	const Array<DebugLine>& getDebugLines() const override { return m_debug_lines; }
+	const DebugChunk<DebugTriangle>* getDebugTriangles() const override { return m_debug_triangles.getChunks(); }
+	const DebugChunk<DebugLine>* getDebugLines() const override { return m_debug_lines.getChunks(); }
+
+	DebugBatchHandle createDebugBatch() override {
+		if (!m_free_debug_batches.empty()) {
+			const DebugBatchHandle handle = m_free_debug_batches.back();
+			m_free_debug_batches.pop();
+			return handle;
+		}
+		m_debug_batches.emplace();
+		return m_debug_batches.size() - 1;
+	}
+
+	void freeDebugBatchBuffers(DebugBatch& batch) {
+		if (batch.lines) m_renderer.getEndFrameDrawStream().destroy(batch.lines);
+		if (batch.triangles) m_renderer.getEndFrameDrawStream().destroy(batch.triangles);
+		batch = {};
+	}
+
+	void destroyDebugBatch(DebugBatchHandle handle) override {
+		freeDebugBatchBuffers(m_debug_batches[handle]);
+		m_free_debug_batches.push(handle);
+	}
+
+	void setDebugBatch(DebugBatchHandle handle, const DebugGeometry& geometry) override {
+		PROFILE_FUNCTION();
+		DebugBatch& batch = m_debug_batches[handle];
+		freeDebugBatchBuffers(batch);
+		// vertices are stored as floats, so they are relative to a point close to them
+		if (!geometry.lines.empty()) batch.origin = geometry.lines[0].from;
+		else if (!geometry.triangles.empty()) batch.origin = geometry.triangles[0].p0;
+
+		if (!geometry.lines.empty()) {
+			const Renderer::MemRef mem = m_renderer.allocate(sizeof(DebugVertex) * 2 * geometry.lines.size());
+			DebugVertex* vertices = (DebugVertex*)mem.data;
+			for (const DebugLine& line : geometry.lines) {
+				vertices[0] = { Vec3(line.from - batch.origin), line.color.abgr() };
+				vertices[1] = { Vec3(line.to - batch.origin), line.color.abgr() };
+				vertices += 2;
+			}
+			batch.lines = m_renderer.createBuffer(mem, gpu::BufferFlags::IMMUTABLE, "debug_lines");
+			batch.lines_count = geometry.lines.size();
+		}
+
+		if (!geometry.triangles.empty()) {
+			const Renderer::MemRef mem = m_renderer.allocate(sizeof(DebugVertex) * 3 * geometry.triangles.size());
+			DebugVertex* vertices = (DebugVertex*)mem.data;
+			for (const DebugTriangle& tri : geometry.triangles) {
+				vertices[0] = { Vec3(tri.p0 - batch.origin), tri.color.abgr() };
+				vertices[1] = { Vec3(tri.p1 - batch.origin), tri.color.abgr() };
+				vertices[2] = { Vec3(tri.p2 - batch.origin), tri.color.abgr() };
+				vertices += 3;
+			}
+			batch.triangles = m_renderer.createBuffer(mem, gpu::BufferFlags::IMMUTABLE, "debug_triangles");
+			batch.triangles_count = geometry.triangles.size();
+		}
+	}
+
+	void drawDebugBatch(DebugBatchHandle handle) override {
+		const DebugBatch& batch = m_debug_batches[handle];
+		if (batch.lines_count + batch.triangles_count > 0) m_debug_batch_draws.push(batch);
+	}
+
+	Span<const DebugBatch> getDebugBatchDraws() const override { return m_debug_batch_draws; }
+	void clearDebugBatchDraws() override { m_debug_batch_draws.clear(); }
 
 
 	void addDebugHalfSphere(const RigidTransform& transform, float radius, bool top, u32 color)
@@ -2410,7 +3119,7 @@ struct RenderModuleImpl final : RenderModule {
 		const DVec3& p2,
 		Color color) override
 	{
-		DebugTriangle& tri = m_debug_triangles.emplace();
+		DebugTriangle& tri = *m_debug_triangles.add(1);
 		tri.p0 = p0;
 		tri.p1 = p1;
 		tri.p2 = p2;
@@ -2581,7 +3290,7 @@ struct RenderModuleImpl final : RenderModule {
 
 	void addDebugLine(DVec3 from, DVec3 to, Color color) override 
 	{
-		DebugLine& line = m_debug_lines.emplace();
+		DebugLine& line = *m_debug_lines.add(1);
 		line.from = from;
 		line.to = to;
 		line.color = color;
@@ -2589,23 +3298,13 @@ struct RenderModuleImpl final : RenderModule {
 
 	DebugTriangle* addDebugTriangles(int count) override
 	{
-		const u32 new_size = m_debug_triangles.size() + count;
-		if (new_size > m_debug_triangles.capacity()) {
-			m_debug_triangles.reserve(maximum(new_size, m_debug_triangles.capacity() * 3 / 2));
-		}
-		m_debug_triangles.resize(new_size);
-		return &m_debug_triangles[new_size - count];
+		return m_debug_triangles.add(count);
 	}
 
 
 	DebugLine* addDebugLines(int count) override
 	{
-		const u32 new_size = m_debug_lines.size() + count;
-		if (new_size > m_debug_lines.capacity()) {
-			m_debug_lines.reserve(maximum(new_size, m_debug_lines.capacity() * 3 / 2));
-		}
-		m_debug_lines.resize(new_size);
-		return &m_debug_lines[new_size - count];
+		return m_debug_lines.add(count);
 	}
 
 
@@ -2629,6 +3328,7 @@ struct RenderModuleImpl final : RenderModule {
 	}
 	
 	RayCastModelHit castRayInstancedModels(const Ray& ray, const RayCastModelHit::Filter& filter) override {
+		using Grid = InstancedModel::Grid;
 		RayCastModelHit hit;
 		hit.is_hit = false;
 		for (auto iter : m_instanced_models.iterated()) {
@@ -2638,6 +3338,7 @@ struct RenderModuleImpl final : RenderModule {
 			if (!im.model || !im.model->isReady()) continue;
 			
 			const float model_radius = im.model->getOriginBoundingRadius();
+			const Vec3 ray_origin = Vec3(ray.origin - tr.pos);
 			auto getInstanceQuat = [](Vec3 q) {
 				Quat res;
 				res.x = q.x;
@@ -2646,8 +3347,8 @@ struct RenderModuleImpl final : RenderModule {
 				res.w = sqrtf(1 - (q.x * q.x + q.y * q.y + q.z * q.z));
 				return res;
 			};
-			for (const InstancedModel::InstanceData& id : im.instances) {
-				Vec3 rel_pos = Vec3(ray.origin - tr.pos) - id.pos;
+			auto castRayInstance = [&](const InstancedModel::InstanceData& id) {
+				Vec3 rel_pos = ray_origin - id.pos;
 				const float radius = model_radius * id.scale;
 				float intersection_t;
 				if (getRaySphereIntersection(rel_pos, ray.dir, Vec3::ZERO, radius, intersection_t) && intersection_t >= 0) {
@@ -2664,6 +3365,38 @@ struct RenderModuleImpl final : RenderModule {
 						hit.subindex = u32(&id - im.instances.begin());
 					}
 				}
+			};
+
+			// instances are not sorted to the grid until initGPUData
+			const Grid& grid = im.grid;
+			if (im.dirty || grid.resolution == 0) {
+				for (const InstancedModel::InstanceData& id : im.instances) castRayInstance(id);
+				continue;
+			}
+
+			// cell and block AABBs contain only instance positions
+			const Vec3 margin(model_radius * grid.max_scale);
+			auto isAABBHit = [&](const AABB& aabb) {
+				const Vec3 min = aabb.min - margin;
+				const Vec3 max = aabb.max + margin;
+				Vec3 aabb_hit;
+				if (!getRayAABBIntersection(ray_origin, ray.dir, min, max - min, aabb_hit)) return false;
+				return !hit.is_hit || squaredLength(aabb_hit - ray_origin) <= hit.t * hit.t;
+			};
+
+			for (u32 block_idx = 0, c = grid.blocks.size(); block_idx < c; ++block_idx) {
+				const Grid::Block& block = grid.blocks[block_idx];
+				if (block.instance_count == 0 || !isAABBHit(block.aabb)) continue;
+				
+				const Grid::Cell* cells = &grid.cells[block_idx * Grid::BLOCK_SIZE * Grid::BLOCK_SIZE];
+				for (u32 i = 0; i < Grid::BLOCK_SIZE * Grid::BLOCK_SIZE; ++i) {
+					const Grid::Cell& cell = cells[i];
+					if (cell.instance_count == 0 || !isAABBHit(cell.aabb)) continue;
+
+					for (u32 j = cell.from_instance, end = cell.from_instance + cell.instance_count; j < end; ++j) {
+						castRayInstance(im.instances[j]);
+					}
+				}
 			}
 		}
 		return hit;
@@ -2673,13 +3406,12 @@ struct RenderModuleImpl final : RenderModule {
 		RayCastModelHit hit;
 		hit.is_hit = false;
 		for (auto iter : m_procedural_geometries.iterated()) {
-			const ProceduralGeometry& pg = iter.value();
+			ProceduralGeometry& pg = iter.value();
 			if (pg.vertex_data.empty()) continue;
 			if (pg.vertex_decl.primitive_type != gpu::PrimitiveType::TRIANGLES) continue;
 
 			const u32 stride = pg.vertex_decl.getStride();
 			const u8* data = pg.vertex_data.data();
-			Vec3 a, b, c;
 			RayCastModelHit pg_hit;
 
 			const Transform& tr = m_world.getTransform(iter.key());
@@ -2694,39 +3426,36 @@ struct RenderModuleImpl final : RenderModule {
 			const u32 triangles = (is_indexed ? pg.getIndexCount() : u32(pg.vertex_data.size() / stride)) / 3;
 			const u16* indices16 = (const u16*)pg.index_data.data();
 			const u32* indices32 = (const u32*)pg.index_data.data();
-			for (u32 i = 0; i < triangles * 3; i += 3) {
-				float t;
+			auto getVertex = [&](u32 i) {
+				u32 index = i;
+				if (is_indexed) index = pg.index_type == gpu::DataType::U16 ? indices16[i] : indices32[i];
+				Vec3 v;
+				memcpy(&v, data + index * stride, sizeof(v));
+				return v;
+			};
 
-				u32 tindices[3];
-				if (is_indexed) {
-					if (pg.index_type == gpu::DataType::U16) {
-						tindices[0] = indices16[i];
-						tindices[1] = indices16[i + 1];
-						tindices[2] = indices16[i + 2];
-					}
-					else {
-						tindices[0] = indices32[i];
-						tindices[1] = indices32[i + 1];
-						tindices[2] = indices32[i + 2];
-					}
-				}
-				else {
-					tindices[0] = i;
-					tindices[1] = i + 1;
-					tindices[2] = i + 2;
-				}
+			if (pg.bvh.empty() && triangles > 0) {
+				PROFILE_BLOCK("build procedural geometry bvh");
+				Array<Vec3> corners(m_allocator);
+				corners.resize(triangles * 3);
+				for (u32 i = 0; i < triangles * 3; ++i) corners[i] = getVertex(i);
+				pg.bvh.build(corners);
+			}
 
-				memcpy(&a, data + tindices[0] * stride, sizeof(a));
-				memcpy(&b, data + tindices[1] * stride, sizeof(b));
-				memcpy(&c, data + tindices[2] * stride, sizeof(c));
-				if (getRayTriangleIntersection(ro, rd, a, b, c, &t) && (t < hit.t || !hit.is_hit)) {
+			pg.bvh.castRay(ro, rd, hit.is_hit ? hit.t : FLT_MAX, [&](u32 triangle, float& max_t){
+				float t;
+				const u32 i = triangle * 3;
+				if (getRayTriangleIntersection(ro, rd, getVertex(i), getVertex(i + 1), getVertex(i + 2), &t) && (t < hit.t || !hit.is_hit)) {
 					pg_hit.is_hit = true;
 					pg_hit.mesh = nullptr;
 					pg_hit.entity = iter.key();
 					pg_hit.t = t;
-					if (filter.invoke(pg_hit)) hit = pg_hit;
+					if (filter.invoke(pg_hit)) {
+						hit = pg_hit;
+						max_t = t;
+					}
 				}
-			}
+			});
 		}
 		hit.origin = ray.origin;
 		hit.dir = ray.dir;
@@ -2877,11 +3606,7 @@ struct RenderModuleImpl final : RenderModule {
 	}
 
 	void reloadReflectionProbes() override {
-		for (i32 i = 0; i < m_reflection_probes.size(); ++i) {
-			ReflectionProbe& probe = m_reflection_probes.at(i);
-			const EntityRef e = m_reflection_probes.getKey(i);
-			load(probe, e);
-		}
+		loadReflectionProbes();
 	}
 
 
@@ -2921,7 +3646,7 @@ struct RenderModuleImpl final : RenderModule {
 		LUMIX_DELETE(m_allocator, r.pose);
 		r.pose = nullptr;
 
-		m_culling_system->remove(entity);
+		removeRenderable(entity);
 	}
 
 
@@ -2929,14 +3654,6 @@ struct RenderModuleImpl final : RenderModule {
 		ASSERT(model->isReady());
 		auto& r = m_model_instances[entity.index];
 
-		float bounding_radius = r.model->getOriginBoundingRadius();
-		const Vec3& scale = m_world.getScale(entity);
-		const DVec3 pos = m_world.getPosition(entity);
-		const float radius = bounding_radius * maximum(scale.x, scale.y, scale.z);
-		if(r.flags & ModelInstance::ENABLED) {
-			const RenderableTypes type = getRenderableType(*model);
-			m_culling_system->add(entity, (u8)type, pos, radius);
-		}
 		ASSERT(!r.pose);
 		if (model->getBoneCount() > 0) {
 			r.pose = LUMIX_NEW(m_allocator, Pose)(m_allocator);
@@ -2960,11 +3677,13 @@ struct RenderModuleImpl final : RenderModule {
 		for (i32 i = 3; i >= 0; --i) {
 			if (r.model->getLODIndices()[i].to != -1) {
 				r.lod = float(i);
+				r.lod_target = (u8)i;
 				break;
 			}
 		}
 		
 		r.dirty = r.mesh_materials.begin() != r.model->getMeshMaterials().begin();
+		if ((r.flags & ModelInstance::ENABLED) && m_world.isEntityActive(entity)) addRenderable(entity);
 	}
 
 	u32 computeSortKey(const Material& material, const Mesh& mesh) const override {
@@ -3152,7 +3871,7 @@ struct RenderModuleImpl final : RenderModule {
 			removeFromModelEntityMap(old_model, entity);
 
 			if (old_model->isReady()) {
-				m_culling_system->remove(entity);
+				removeRenderable(entity);
 			}
 			old_model->decRefCount();
 		}
@@ -3309,7 +4028,12 @@ struct RenderModuleImpl final : RenderModule {
 		m_world.onComponentCreated(entity, MODEL_INSTANCE_TYPE, this);
 	}
 
-	void updateParticleEmitter(EntityRef entity, float dt) override { m_particle_emitters[entity].update(dt, m_engine.getPageAllocator()); }
+	void updateParticleEmitter(EntityRef entity, float dt) override {
+		ParticleSystem& ps = m_particle_emitters[entity];
+		ps.update(dt, m_engine.getPageAllocator());
+		if (ps.hasGPUEmitters()) ps.updateGPU(m_renderer);
+		updateParticleEmitterBounds(ps);
+	}
 
 	void setParticleEmitterAutodestroy(EntityRef entity, bool enable) override {
 		m_particle_emitters[entity].m_autodestroy = enable;
@@ -3318,6 +4042,22 @@ struct RenderModuleImpl final : RenderModule {
 	bool getParticleEmitterAutodestroy(EntityRef entity) override {
 		return m_particle_emitters[entity].m_autodestroy;
 	}
+
+	void setParticleEmitterUpdatePolicy(EntityRef entity, ParticleEmitterUpdatePolicy policy) override {
+		m_particle_emitters[entity].m_update_policy = policy;
+	}
+
+	ParticleEmitterUpdatePolicy getParticleEmitterUpdatePolicy(EntityRef entity) override {
+		return m_particle_emitters[entity].m_update_policy;
+	}
+
+	void setParticleEmitterThrottleDistance(EntityRef entity, float distance) override {
+		m_particle_emitters[entity].m_throttle_distance = distance;
+	}
+
+	float getParticleEmitterThrottleDistance(EntityRef entity) override {
+		return m_particle_emitters[entity].m_throttle_distance;
+	}
 	
 	void setParticleEmitterPath(EntityRef entity, const Path& path) override {
 		ParticleSystemResource* res = m_engine.getResourceManager().load<ParticleSystemResource>(path);
@@ -3351,7 +4091,9 @@ struct RenderModuleImpl final : RenderModule {
 	HashMap<EntityRef, CurveDecal> m_curve_decals;
 	Array<ModelInstance> m_model_instances;
 	Array<EntityRef> m_moved_instances;
+	Array<ShadowCasterChange> m_shadow_caster_changes;
 	HashMap<EntityRef, InstancedModel> m_instanced_models;
+	HashMap<Model*, GPUDrivenModel> m_gpu_driven_models;
 	HashMap<EntityRef, Environment> m_environments;
 	HashMap<EntityRef, Camera> m_cameras;
 	EntityPtr m_active_camera = INVALID_ENTITY;
@@ -3362,9 +4104,14 @@ struct RenderModuleImpl final : RenderModule {
 	HashMap<EntityRef, Terrain*> m_terrains;
 	HashMap<EntityRef, ParticleSystem> m_particle_emitters;
 	gpu::TextureHandle m_reflection_probes_texture = gpu::INVALID_TEXTURE;
-
-	Array<DebugTriangle> m_debug_triangles;
-	Array<DebugLine> m_debug_lines;
+	FileSystem::AsyncHandle m_probes_pack_handle = FileSystem::AsyncHandle::invalid();
+
+	ThreadDebugBuffer<DebugTriangle> m_debug_triangles;
+	ThreadDebugBuffer<DebugLine> m_debug_lines;
+	Array<DebugBatch> m_debug_batches;
+	Array<DebugBatchHandle> m_free_debug_batches;
+	// batches drawn in this frame
+	Array<DebugBatch> m_debug_batch_draws;
 	HashMap<EntityRef, Fur> m_furs;
 
 	EntityPtr m_updating_attachment = INVALID_ENTITY;
@@ -3392,27 +4139,7 @@ void ReflectionProbe::LoadJob::callback(Span<const u8> data, bool success) {
 		return;
 	}
 
-	gpu::TextureDesc desc;
-	const u8* image_data = Texture::getLBCInfo(data.begin(), desc);
-	if (!image_data) return;
-
-	ASSERT(desc.depth == 1);
-	ASSERT(desc.is_cubemap);
-
-	u32 layer = probe.texture_id;
-	DrawStream& stream = m_module.m_renderer.getDrawStream();
-	const u32 offset = u32(image_data - data.begin());
-	const Renderer::MemRef mem = m_module.m_renderer.copy(image_data, data.length() - offset);
-	InputMemoryStream blob(mem.data, data.length() - offset);
-	for (u32 side = 0; side < 6; ++side) {
-		for (u32 mip = 0; mip < desc.mips; ++mip) {
-			u32 w = maximum(desc.width >> mip, 1);
-			u32 h = maximum(desc.height >> mip, 1);
-			const u32 mip_size_bytes = gpu::getSize(desc.format, w, h);
-			stream.update(m_module.m_reflection_probes_texture, mip, 0, 0, layer * 6 + side, w, h, desc.format, blob.skip(mip_size_bytes), mip_size_bytes);
-		}
-	}
-	stream.freeMemory(mem.data, m_module.m_renderer.getAllocator());
+	m_module.uploadReflectionProbe(probe, data);
 	LUMIX_DELETE(m_allocator, this);
 }
 
@@ -3432,6 +4159,20 @@ void RenderModule::reflect() {
 		}
 	};
 
+	struct ParticleEmitterUpdatePolicyEnum : reflection::EnumAttribute {
+		u32 count(ComponentUID cmp) const override { return (u32)ParticleEmitterUpdatePolicy::COUNT; }
+		const char* name(ComponentUID cmp, u32 idx) const override {
+			switch((ParticleEmitterUpdatePolicy)idx) {
+				case ParticleEmitterUpdatePolicy::ALWAYS: return "Always";
+				case ParticleEmitterUpdatePolicy::THROTTLE: return "Throttle";
+				case ParticleEmitterUpdatePolicy::PAUSE: return "Pause";
+				case ParticleEmitterUpdatePolicy::COUNT: break;
+			}
+			ASSERT(false);
+			return "N/A";
+		}
+	};
+
 	struct BoneEnum : reflection::EnumAttribute {
 		u32 count(ComponentUID cmp) const override {
 			RenderModule* render_module = static_cast<RenderModule*>(cmp.module);
@@ -3477,7 +4218,9 @@ RenderModuleImpl::RenderModuleImpl(Renderer& renderer,
 	, m_model_entity_map(m_allocator)
 	, m_model_instances(m_allocator)
 	, m_moved_instances(m_allocator)
+	, m_shadow_caster_changes(m_allocator)
 	, m_instanced_models(m_allocator)
+	, m_gpu_driven_models(m_allocator)
 	, m_cameras(m_allocator) 
 	, m_terrains(m_allocator)
 	, m_point_lights(m_allocator)
@@ -3486,6 +4229,9 @@ RenderModuleImpl::RenderModuleImpl(Renderer& renderer,
 	, m_curve_decals(m_allocator)
 	, m_debug_triangles(m_allocator)
 	, m_debug_lines(m_allocator)
+	, m_debug_batches(m_allocator)
+	, m_free_debug_batches(m_allocator)
+	, m_debug_batch_draws(m_allocator)
 	, m_active_global_light_entity(INVALID_ENTITY)
 	, m_active_camera(INVALID_ENTITY)
 	, m_is_game_running(false)
@@ -3498,7 +4244,7 @@ RenderModuleImpl::RenderModuleImpl(Renderer& renderer,
 	, m_material_curve_decal_map(m_allocator)
 	, m_furs(m_allocator)
 {
-	m_world.componentTransformed(MODEL_INSTANCE_TYPE).bind<&RenderModuleImpl::onModelInstanceMoved>(this);
+	m_world.componentTransformedBatch(MODEL_INSTANCE_TYPE).bind<&RenderModuleImpl::onModelInstancesMoved>(this);
 	m_world.componentTransformed(DECAL_TYPE).bind<&RenderModuleImpl::onDecalMoved>(this);
 	m_world.componentTransformed(CURVE_DECAL_TYPE).bind<&RenderModuleImpl::onCurveDecalMoved>(this);
 	m_world.componentTransformed(PARTICLE_EMITTER_TYPE).bind<&RenderModuleImpl::onParticleEmitterMoved>(this);
@@ -3506,6 +4252,7 @@ RenderModuleImpl::RenderModuleImpl(Renderer& renderer,
 	m_world.componentTransformed(BONE_ATTACHMENT_TYPE).bind<&RenderModuleImpl::onBoneAttachmentMoved>(this);
 
 	m_world.entityDestroyed().bind<&RenderModuleImpl::onEntityDestroyed>(this);
+	m_world.entityActiveChanged().bind<&RenderModuleImpl::onEntityActiveChanged>(this);
 	m_culling_system = CullingSystem::create(m_allocator, engine.getPageAllocator());
 	m_model_instances.reserve(1024);
 
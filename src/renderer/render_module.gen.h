@@ -126,6 +126,10 @@ reflection::build_module("renderer")
 		.prop<&RenderModule::getParticleEmitterPath, &RenderModule::setParticleEmitterPath>("Source")
 			.resourceAttribute(ParticleSystemResource::TYPE)
 		.prop<&RenderModule::getParticleEmitterAutodestroy, &RenderModule::setParticleEmitterAutodestroy>("Autodestroy")
+		.prop<&RenderModule::getParticleEmitterUpdatePolicy, &RenderModule::setParticleEmitterUpdatePolicy>("Update policy")
+			.attribute<ParticleEmitterUpdatePolicyEnum>()
+		.prop<&RenderModule::getParticleEmitterThrottleDistance, &RenderModule::setParticleEmitterThrottleDistance>("Throttle distance")
+			.minAttribute(0)
 	.cmp<&RenderModule::createInstancedModel, &RenderModule::destroyInstancedModel>("instanced_model", "Render / Instanced model")
 		.prop<&RenderModule::getInstancedModelPath, &RenderModule::setInstancedModelPath>("Model")
 			.resourceAttribute(Model::TYPE)
@@ -5,12 +5,14 @@
 #include "core/color.h"
 #include "core/array.h"
 #include "core/geometry.h"
+#include "core/hash.h"
 #include "core/hash_map.h"
 #include "core/math.h"
 #include "core/stream.h"
 
 #include "engine/plugin.h"
 #include "gpu/gpu.h"
+#include "renderer/triangle_bvh.h"
 
 
 //@ module RenderModule renderer "Render"
@@ -38,16 +40,19 @@ struct ShiftedFrustum;
 struct Terrain;
 struct Texture;
 struct World;
+enum class CullingStructure : u8;
 template <typename T> struct Array;
 template <typename T> struct Delegate;
 template <typename T, typename T2> struct AssociativeArray;
 enum class GrassRotationMode : i32;
+enum class ParticleEmitterUpdatePolicy : u8;
 
 struct ProceduralGeometry {
 	ProceduralGeometry(IAllocator& allocator) 
 		: vertex_data(allocator)
 		, index_data(allocator)
 		, vertex_decl(gpu::PrimitiveType::TRIANGLES)
+		, bvh(allocator)
 	{}
 
 	Material* material = nullptr;
@@ -55,9 +60,14 @@ struct ProceduralGeometry {
 	OutputMemoryStream index_data;
 	gpu::VertexDecl vertex_decl;
 	gpu::DataType index_type;
+	// buffers are updated in place and recreated only when data do not fit, capacity grows by doubling
 	gpu::BufferHandle vertex_buffer = gpu::INVALID_BUFFER;
 	gpu::BufferHandle index_buffer = gpu::INVALID_BUFFER;
+	u32 vertex_buffer_capacity = 0;
+	u32 index_buffer_capacity = 0;
 	AABB aabb;
+	// built on first raycast, cleared when vertex or index data change
+	TriangleBVH bvh;
 	
 	u32 getVertexCount() const;
 	u32 getIndexCount() const;
@@ -189,6 +199,27 @@ struct ReflectionProbe {
 };
 //@ end
 
+// reflection probes baked in editor are packed in a single file, so they are loaded with one read
+// file = Header, Entry[header.count], lbc data of probes
+struct ReflectionProbesPack {
+	static constexpr const char* PATH = "probes/reflection_probes.lrp";
+	static constexpr u32 MAGIC = '_LRP';
+	static constexpr u32 VERSION = 0;
+
+	struct Header {
+		u32 magic = MAGIC;
+		u32 version = VERSION;
+		u32 count = 0;
+	};
+
+	struct Entry {
+		u64 guid;
+		// from the beginning of the file
+		u32 offset;
+		u32 size;
+	};
+};
+
 //@ component_struct
 struct EnvironmentProbe {
 	enum Flags {
@@ -210,6 +241,8 @@ struct ModelInstance {
 		ENABLED = 1 << 1,
 		VALID = 1 << 2,
 		MOVED = 1 << 3,
+		// rendered as a part of GPUDrivenModel, not in culling system
+		GPU_DRIVEN = 1 << 4,
 	};
 
 	Model* model = nullptr;
@@ -218,16 +251,26 @@ struct ModelInstance {
 	Pose* pose = nullptr;
 	EntityPtr next_model = INVALID_ENTITY;
 	EntityPtr prev_model = INVALID_ENTITY;
+	// current LOD, fractional while crossfading between `lod` and `lod + 1`
 	float lod = 4;
+	// LOD `lod` is moving to, used for hysteresis
+	u8 lod_target = 4;
 	Transform prev_frame_transform;
 	Flags flags = Flags::NONE;
 	u16 mesh_count = 0;
 	bool dirty = true;
 };
 
+// bounding sphere of a static (not skinned) model instance, which was added, removed or moved
+struct ShadowCasterChange {
+	DVec3 pos;
+	float radius;
+};
+
 struct InstancedModel {
 	InstancedModel(IAllocator& allocator) 
-		: instances(allocator)
+		: grid(allocator)
+		, instances(allocator)
 	{}
 
 	struct InstanceData {
@@ -237,25 +280,91 @@ struct InstancedModel {
 		float scale;
 	};
 
+	// quantized InstanceData, as stored in gpu_data, decoded in instancing.hlsl
+	// position is relative to the cell, see Grid::cell_size
+	struct GPUInstanceData {
+		// 16b x, 16b y
+		u32 pos_xy;
+		// 16b z, 8b log2 scale, 8b lod
+		u32 pos_z_scale_lod;
+		// smallest three, 2b index of the largest component, 3 x 10b
+		u32 rot;
+	};
+
+	// gpu_data contains capacity GPUInstanceData followed by float4 origin for each chunk of instances
+	// cells start on chunk boundary, so all instances in a chunk share the same cell, must match instancing.hlsl
+	static constexpr u32 GPU_CHUNK_SIZE = 16;
+
+	// 2-level grid, cells are grouped in blocks, so whole blocks can be culled at once
+	// resolution depends on number of instances, instances are sorted to cells
 	struct Grid {
+		// cells per block side
+		static constexpr u32 BLOCK_SIZE = 4;
+
+		Grid(IAllocator& allocator)
+			: cells(allocator)
+			, blocks(allocator)
+		{}
+
 		struct Cell {
 			AABB aabb;
 			u32 from_instance;
 			u32 instance_count;
+			// each cell has some free space in gpu_data, so editing a cell does not move other cells
+			u32 gpu_offset;
+			u32 gpu_capacity;
+			// of cell's instances, to detect which cells need to be uploaded
+			RuntimeHash hash;
+		};
+
+		// BLOCK_SIZE x BLOCK_SIZE cells, cells of blocks[i] are cells[i * BLOCK_SIZE * BLOCK_SIZE ...]
+		struct Block {
+			AABB aabb;
+			u32 instance_count;
+			u32 gpu_offset;
+			u32 gpu_size;
 		};
 
 		AABB aabb;
-		Cell cells[4 * 4];
+		// size of a quantization range, cells span the whole grid in y
+		Vec3 cell_size;
+		// cells per side
+		u32 resolution = 0;
+		// of all instances, cell and block AABBs contain only instance positions, raycasts extend them by model radius * max_scale
+		float max_scale = 0;
+		Array<Cell> cells;
+		Array<Block> blocks;
 	};
 
 	Grid grid;
 	Model* model = nullptr;
 	Array<InstanceData> instances;
 	gpu::BufferHandle gpu_data = gpu::INVALID_BUFFER;
+	// in instances, multiple of GPU_CHUNK_SIZE
 	u32 gpu_capacity = 0;
 	bool dirty = false;
 };
 
+// static model instances with the same model, culled, LODed and drawn on GPU the same way as InstancedModel
+// enabled with -gpu_driven, only instances without skinning, material override and with uniform scale are included
+struct GPUDrivenModel {
+	GPUDrivenModel(IAllocator& allocator)
+		: im(allocator)
+		, entities(allocator)
+		, instances(allocator)
+		, entity_to_slot(allocator)
+	{}
+
+	// im.instances[i] is not entities[i], instances are sorted to grid cells
+	InstancedModel im;
+	// positions in instances are relative to origin, origin does not change once set, so adding or removing an instance does not touch other instances
+	DVec3 origin;
+	Array<EntityRef> entities;
+	// instances[i] belongs to entities[i], kept up to date incrementally, copied to im.instances when im is dirty
+	Array<InstancedModel::InstanceData> instances;
+	HashMap<EntityRef, u32> entity_to_slot;
+};
+
 struct MeshInstance
 {
 	EntityRef owner;
@@ -292,6 +401,48 @@ struct DebugLine
 };
 
 
+// debug lines or triangles added in this frame by a single thread, see RenderModule::getDebugLines
+template <typename T>
+struct DebugChunk {
+	static constexpr u32 CAPACITY = 4096;
+
+	T* begin() { return (T*)(this + 1); }
+	const T* begin() const { return (const T*)(this + 1); }
+	const T* end() const { return begin() + count; }
+
+	DebugChunk* next;
+	u32 count;
+	u32 capacity;
+	// items follow
+};
+
+
+// CPU side of a debug batch, has the same interface as immediate debug draw functions in RenderModule
+struct LUMIX_RENDERER_API DebugGeometry {
+	explicit DebugGeometry(IAllocator& allocator);
+	void clear();
+	void addDebugLine(const DVec3& from, const DVec3& to, Color color);
+	void addDebugTriangle(const DVec3& p0, const DVec3& p1, const DVec3& p2, Color color);
+
+	Array<DebugLine> lines;
+	Array<DebugTriangle> triangles;
+};
+
+
+// static debug geometry, e.g. navmesh or collision shapes, uploaded to GPU only when it changes
+using DebugBatchHandle = u32;
+constexpr DebugBatchHandle INVALID_DEBUG_BATCH = 0xffFFffFF;
+
+struct DebugBatch {
+	// vertices are relative to origin
+	DVec3 origin = DVec3(0);
+	gpu::BufferHandle lines = gpu::INVALID_BUFFER;
+	gpu::BufferHandle triangles = gpu::INVALID_BUFFER;
+	u32 lines_count = 0;
+	u32 triangles_count = 0;
+};
+
+
 enum class RenderableTypes : u8 {
 	MESH,
 	SKINNED,
@@ -331,6 +482,8 @@ enum class RenderModuleVersion : i32 {
 	FOG_DENSITY,
 	CLOUDS,
 	MATERIAL_OVERRIDE,
+	CULLING_STRUCTURE,
+	PARTICLE_UPDATE_POLICY,
 
 	LATEST
 };
@@ -426,10 +579,21 @@ struct LUMIX_RENDERER_API RenderModule : IModule
 	virtual HashMap<EntityRef, Fur>& getFurs() = 0;
 	virtual Fur& getFur(EntityRef e) = 0;
 
+	// immediate debug lines and triangles can be added from any thread, but not while a pipeline renders them
 	virtual void clearDebugLines() = 0;
 	virtual void clearDebugTriangles() = 0;
-	virtual const Array<DebugTriangle>& getDebugTriangles() const = 0;
-	virtual const Array<DebugLine>& getDebugLines() const = 0;
+	// linked list of chunks, nullptr if there's nothing to draw
+	virtual const DebugChunk<DebugTriangle>* getDebugTriangles() const = 0;
+	virtual const DebugChunk<DebugLine>* getDebugLines() const = 0;
+
+	virtual DebugBatchHandle createDebugBatch() = 0;
+	virtual void destroyDebugBatch(DebugBatchHandle batch) = 0;
+	// uploads `geometry` to GPU, call only when it changes
+	virtual void setDebugBatch(DebugBatchHandle batch, const DebugGeometry& geometry) = 0;
+	// draw `batch` in this frame, call every frame it should be visible
+	virtual void drawDebugBatch(DebugBatchHandle batch) = 0;
+	virtual Span<const DebugBatch> getDebugBatchDraws() const = 0;
+	virtual void clearDebugBatchDraws() = 0;
 
 	virtual Camera& getCamera(EntityRef entity) = 0;
 	virtual Matrix getCameraProjection(EntityRef entity) = 0;
@@ -443,6 +607,10 @@ struct LUMIX_RENDERER_API RenderModule : IModule
 	virtual Path getParticleEmitterPath(EntityRef entity) = 0;
 	virtual bool getParticleEmitterAutodestroy(EntityRef entity) = 0;
 	virtual void setParticleEmitterAutodestroy(EntityRef entity, bool enable) = 0;
+	virtual ParticleEmitterUpdatePolicy getParticleEmitterUpdatePolicy(EntityRef entity) = 0;
+	virtual void setParticleEmitterUpdatePolicy(EntityRef entity, ParticleEmitterUpdatePolicy policy) = 0;
+	virtual float getParticleEmitterThrottleDistance(EntityRef entity) = 0;				//@ min 0
+	virtual void setParticleEmitterThrottleDistance(EntityRef entity, float distance) = 0;
 	//@ end
 	virtual void updateParticleEmitter(EntityRef entity, float dt) = 0;
 	virtual const HashMap<EntityRef, struct ParticleSystem>& getParticleEmitters() const = 0;
@@ -458,6 +626,8 @@ struct LUMIX_RENDERER_API RenderModule : IModule
 	virtual InstancedModel& beginInstancedModelEditing(EntityRef entity) = 0;
 	virtual void endInstancedModelEditing(EntityRef entity) = 0;
 	virtual void initInstancedModelGPUData(EntityRef entity) = 0;
+	virtual const HashMap<Model*, GPUDrivenModel>& getGPUDrivenModels() const = 0;
+	virtual void initGPUDrivenModelGPUData(Model* model) = 0;
 
 	//@ component ModelInstance label "Mesh"
 	virtual bool isModelInstanceEnabled(EntityRef entity) = 0;
@@ -470,11 +640,17 @@ struct LUMIX_RENDERER_API RenderModule : IModule
 	virtual ModelInstance* getModelInstance(EntityRef entity) = 0;
 	virtual Span<const ModelInstance> getModelInstances() const = 0;
 	virtual Span<ModelInstance> getModelInstances() = 0;
+	// changes since the last endFrame, cached shadows overlapping them are outdated
+	virtual Span<const ShadowCasterChange> getShadowCasterChanges() const = 0;
 	virtual void setModelInstanceLOD(EntityRef entity, u32 lod) = 0;
 	virtual void setModelInstanceMaterialOverride(EntityRef entity, u32 mesh_idx, const Path& path) = 0;
 	virtual Path getModelInstanceMaterialOverride(EntityRef entity, u32 mesh_idx) = 0;
 	virtual CullResult* getRenderables(const ShiftedFrustum& frustum, RenderableTypes type) const = 0;
-	virtual CullResult* getRenderables(const ShiftedFrustum& frustum) const = 0;
+	// all types, CullResult::squared_distances are relative to `lod_ref_point`
+	virtual CullResult* getRenderables(const ShiftedFrustum& frustum, const DVec3& lod_ref_point) const = 0;
+	// per world, serialized, changing it moves all renderables to the new structure
+	virtual CullingStructure getCullingStructure() const = 0;
+	virtual void setCullingStructure(CullingStructure structure) = 0;
 	virtual EntityPtr getFirstModelInstance() = 0;
 	virtual EntityPtr getNextModelInstance(EntityPtr entity) = 0;
 
@@ -543,6 +719,8 @@ struct LUMIX_RENDERER_API RenderModule : IModule
 		, const gpu::VertexDecl& vertex_decl
 		, Span<const u8> index_data
 		, gpu::DataType index_type) = 0;
+	// updates vertex data in [offset, offset + data.length()) bytes, without recreating GPU buffers
+	virtual void updateProceduralGeometryVertices(EntityRef entity, u32 offset, Span<const u8> data) = 0;
 	//@ component ProceduralGeometry id procedural_geom
 	virtual void setProceduralGeometryMaterial(EntityRef entity, const Path& path) = 0;	//@ resource_type Material::TYPE
 	virtual Path getProceduralGeometryMaterial(EntityRef entity) = 0;
@@ -6,6 +6,7 @@
 #include "core/command_line_parser.h"
 #include "engine/engine.h"
 #include "core/hash.h"
+#include "core/hash_map.h"
 #include "core/log.h"
 #include "core/job_system.h"
 #include "core/page_allocator.h"
@@ -14,11 +15,13 @@
 #include "core/os.h"
 #include "core/profiler.h"
 #include "core/stack_array.h"
+#include "engine/file_system.h"
 #include "engine/reflection.h"
 #include "engine/resource_manager.h"
 #include "core/string.h"
 #include "engine/world.h"
 #include "renderer/draw_stream.h"
+#include "renderer/draw_stream_capture.h"
 #include "renderer/font.h"
 #include "renderer/material.h"
 #include "renderer/model.h"
@@ -27,6 +30,7 @@
 #include "renderer/postprocess.h"
 #include "renderer/render_module.h"
 #include "renderer/shader.h"
+#include "renderer/shader_usage.h"
 #include "renderer/terrain.h"
 #include "renderer/texture.h"
 
@@ -64,27 +68,136 @@ struct Renderbuffer {
 	gpu::TextureFormat format;
 	gpu::TextureFlags flags;
 	State state;
+	// index of RenderbufferHeap the buffer is placed in, -1 if the buffer has its own memory
+	i32 heap = -1;
+	u64 offset = 0;
+	u64 mem_size = 0;
 };
 
+// Transient render targets are placed in shared heaps (with -renderbuffer_aliasing), so buffers
+// with different descs, which are not active at the same time, can share memory.
+// Buffers are used in the order they are created and released on the render thread, so a buffer can be placed
+// over memory of any buffer which is not active; aliasing barrier is recorded every time a placed buffer is activated.
+struct RenderbufferHeap {
+	static constexpr u64 MIN_SIZE = 128 * 1024 * 1024;
+
+	gpu::HeapHandle handle = gpu::INVALID_HEAP;
+	u64 size = 0;
+	// number of renderbuffers placed in the heap
+	u32 users = 0;
+};
+
+// size of transient buffers, shared by all frames, so when one frame needs more memory, buffers of other frames grow too
+// buffers shrink if the peak usage during the whole SHRINK_PERIOD fits in a smaller buffer
+struct TransientBufferSizing {
+	static constexpr u32 SHRINK_PERIOD = 600; // frames
+
+	explicit TransientBufferSizing(u32 min_size) : min_size(min_size), size(min_size) {}
+
+	// returns the size buffers should have
+	u32 frameDone(u32 used) {
+		jobs::MutexGuard guard(mutex);
+		last_used = used;
+		peak = maximum(peak, used);
+		period_peak = maximum(period_peak, used);
+		// headroom, so slightly heavier frames do not overflow
+		const u32 needed = nextPow2(used + used / 4);
+		if (needed > size) size = needed;
+		++period_frames;
+		if (period_frames >= SHRINK_PERIOD) {
+			const u32 period_size = maximum(min_size, nextPow2(period_peak + period_peak / 4));
+			if (period_size < size) size = period_size;
+			period_frames = 0;
+			period_peak = 0;
+		}
+		return size;
+	}
+
+	jobs::Mutex mutex;
+	const u32 min_size;
+	u32 size;
+	u32 last_used = 0;
+	u32 peak = 0; // high water mark since start
+	u32 period_peak = 0;
+	u32 period_frames = 0;
+};
+
+// part of a transient buffer owned by a single thread, small allocations are taken from it without atomics
+struct TransientBlock {
+	const void* owner = nullptr;
+	u32 generation = 0;
+	u32 offset = 0;
+	u32 end = 0;
+	bool overflowed = false;
+};
+
+// small allocations are sub-allocated from per-thread blocks, bigger ones are a single atomic add
+// unused tails of blocks are reclaimed when the whole buffer is reset at the end of frame
 template <u32 ALIGN>
 struct TransientBuffer {
-	static constexpr u32 INIT_SIZE = 1024 * 1024;
 	static constexpr u32 OVERFLOW_BUFFER_SIZE = 512 * 1024 * 1024;
+	static constexpr u32 BLOCK_SIZE = 64 * 1024;
+	static constexpr u32 MAX_BLOCK_ALLOC_SIZE = BLOCK_SIZE / 8;
+	static_assert(BLOCK_SIZE % ALIGN == 0);
 	
-	void init() {
+	void init(TransientBufferSizing& sizing) {
+		m_sizing = &sizing;
 		m_buffer = gpu::allocBufferHandle();
 		m_offset = 0;
-		gpu::createBuffer(m_buffer, gpu::BufferFlags::MAPPABLE, INIT_SIZE, nullptr, "transient");
-		m_size = INIT_SIZE;
-		m_ptr = (u8*)gpu::map(m_buffer, INIT_SIZE);
-		memset(m_ptr, 0, INIT_SIZE);
+		m_size = sizing.size;
+		gpu::createBuffer(m_buffer, gpu::BufferFlags::MAPPABLE, m_size, nullptr, "transient");
+		m_ptr = (u8*)gpu::map(m_buffer, m_size);
+		memset(m_ptr, 0, m_size);
+	}
+
+	TransientBlock& getThreadBlock() {
+		static thread_local TransientBlock blocks[4];
+		static thread_local u32 next_block = 0;
+		for (TransientBlock& block : blocks) {
+			if (block.owner == this) return block;
+		}
+		// more buffers than blocks, it still works, but some block tails are wasted
+		TransientBlock& block = blocks[next_block % lengthOf(blocks)];
+		++next_block;
+		block.owner = this;
+		block.generation = 0;
+		return block;
 	}
 
 	Renderer::TransientSlice alloc(u32 size) {
 		Renderer::TransientSlice slice;
 		size = (size + (ALIGN - 1)) & ~(ALIGN - 1);
-		slice.offset = m_offset.add(size);
 		slice.size = size;
+
+		if (size <= MAX_BLOCK_ALLOC_SIZE) {
+			TransientBlock& block = getThreadBlock();
+			if (block.generation != m_generation) {
+				block.generation = m_generation;
+				block.offset = block.end = 0;
+				block.overflowed = false;
+			}
+			if (block.offset + size > block.end && !block.overflowed) {
+				const u32 offset = m_offset.add(BLOCK_SIZE);
+				if (offset + BLOCK_SIZE <= m_size) {
+					block.offset = offset;
+					block.end = offset + BLOCK_SIZE;
+				}
+				else {
+					// the rest of this frame goes through the overflow path
+					block.overflowed = true;
+				}
+			}
+			if (!block.overflowed) {
+				ASSERT(m_ptr);
+				slice.offset = block.offset;
+				slice.buffer = m_buffer;
+				slice.ptr = m_ptr + slice.offset;
+				block.offset += size;
+				return slice;
+			}
+		}
+
+		slice.offset = m_offset.add(size);
 		if (slice.offset + size <= m_size) {
 			ASSERT(m_ptr);
 			slice.buffer = m_buffer;
@@ -125,25 +238,56 @@ struct TransientBuffer {
 		m_overflow.commit = 0;
 	}
 
-	void renderDone() {
+	// call before prepareToRender, overflow data are released there
+	void capture(DrawStreamCapture& capture) {
+		capture.externalBuffer(m_buffer, gpu::BufferFlags::MAPPABLE, m_size, m_ptr, minimum((u32)m_offset, m_size), "transient");
+		if (m_overflow.buffer) {
+			capture.externalBuffer(m_overflow.buffer, gpu::BufferFlags::MAPPABLE, nextPow2(m_overflow.size + m_size), m_overflow.data, m_overflow.size, "transient");
+		}
+	}
+
+	// resizing calls gpu::destroy, so it must run on render thread, see needsResize
+	bool needsResize() const {
+		return m_overflow.buffer || m_size != m_sizing->size;
+	}
+
+	void renderDone(bool can_resize) {
+		// offset keeps growing on overflow, so it's the real usage, including unused tails of blocks
+		const u32 used = (u32)m_offset;
 		m_offset = 0;
-		if (!m_overflow.buffer) return;
+		// invalidates all threads' blocks
+		++m_generation;
+		const u32 size = m_sizing->frameDone(used);
+
+		if (m_overflow.buffer) {
+			ASSERT(can_resize);
+			ASSERT(m_size < 1024*1024*1024);
+			m_size = nextPow2(m_overflow.size + m_size);
+			ASSERT(m_size < 1024*1024*1024);
+			gpu::destroy(m_buffer);
+			m_buffer = m_overflow.buffer;
+			m_overflow.buffer = gpu::INVALID_BUFFER;
+			m_overflow.size = 0;
+			m_ptr = (u8*)gpu::map(m_buffer, m_size);
+			return;
+		}
 
-		ASSERT(m_size < 1024*1024*1024);
-		m_size = nextPow2(m_overflow.size + m_size);
-		ASSERT(m_size < 1024*1024*1024);
+		// gpu is done with this frame, so the buffer can be replaced before the frame overflows
+		if (!can_resize || m_size == size) return;
 		gpu::destroy(m_buffer);
-		m_buffer = m_overflow.buffer;
-		m_overflow.buffer = gpu::INVALID_BUFFER;
-		m_overflow.size = 0;
+		m_buffer = gpu::allocBufferHandle();
+		m_size = size;
+		gpu::createBuffer(m_buffer, gpu::BufferFlags::MAPPABLE, m_size, nullptr, "transient");
 		m_ptr = (u8*)gpu::map(m_buffer, m_size);
 	}
 
 	gpu::BufferHandle m_buffer = gpu::INVALID_BUFFER;
 	AtomicI32 m_offset = 0;
 	u32 m_size = 0;
+	u32 m_generation = 1;
 	u8* m_ptr = nullptr;
 	jobs::Mutex m_mutex;
+	TransientBufferSizing* m_sizing = nullptr;
 
 	struct {
 		gpu::BufferHandle buffer = gpu::INVALID_BUFFER;
@@ -168,8 +312,10 @@ struct FrameData {
 	TransientBuffer<16> transient_buffer;
 	TransientBuffer<256> uniform_buffer;
 	u32 gpu_frame = 0xffFFffFF;
+	// raw timestamp taken when the frame started on CPU, i.e. before input for it was sampled
+	u64 input_time = 0;
 
-	ArenaAllocator arena_allocator;
+	FrameArena arena_allocator;
 	jobs::Mutex shader_mutex;
 	Array<ShaderToCompile> to_compile_shaders;
 	RendererImpl& renderer;
@@ -222,10 +368,26 @@ struct GPUProfiler
 	};
 
 
+	// every GPU block pushes its duration as "GPU <name> (ms)" counter, blocks with stats push pipeline stats too
+	// so they can be queried by name with profiler::getCounterHandle and shown as graphs
+	struct PassCounters {
+		u32 time = profiler::INVALID_COUNTER;
+		u32 input_primitives = profiler::INVALID_COUNTER;
+		u32 culled_primitives = profiler::INVALID_COUNTER;
+		u32 vs_invocations = profiler::INVALID_COUNTER;
+		u32 ps_invocations = profiler::INVALID_COUNTER;
+	};
+
+	struct OpenQuery {
+		StaticString<32> name;
+		u64 timestamp;
+	};
+
 	GPUProfiler(IAllocator& allocator) 
 		: m_queries(allocator)
 		, m_pool(allocator)
 		, m_stats_pool(allocator)
+		, m_pass_counters(allocator)
 		, m_gpu_to_cpu_offset(0)
 	{
 	}
@@ -274,6 +436,7 @@ struct GPUProfiler
 			if (!q.is_frame) gpu::destroy(q.handle);
 		}
 		m_queries.clear();
+		m_depth = 0;
 
 		for(const gpu::QueryHandle h : m_pool) {
 			gpu::destroy(h);
@@ -352,6 +515,23 @@ struct GPUProfiler
 	}
 
 
+	PassCounters& getPassCounters(const char* name, bool stats) {
+		const RuntimeHash hash(name);
+		auto iter = m_pass_counters.find(hash);
+		if (!iter.isValid()) iter = m_pass_counters.insert(hash, {});
+		PassCounters& counters = iter.value();
+		if (counters.time == profiler::INVALID_COUNTER) {
+			counters.time = profiler::createCounter(StaticString<64>("GPU ", name, " (ms)"), 0);
+		}
+		if (stats && counters.input_primitives == profiler::INVALID_COUNTER) {
+			counters.input_primitives = profiler::createCounter(StaticString<64>("GPU ", name, " primitives (K)"), 0);
+			counters.culled_primitives = profiler::createCounter(StaticString<64>("GPU ", name, " culled primitives (K)"), 0);
+			counters.vs_invocations = profiler::createCounter(StaticString<64>("GPU ", name, " VS invocations (K)"), 0);
+			counters.ps_invocations = profiler::createCounter(StaticString<64>("GPU ", name, " PS invocations (M)"), 0);
+		}
+		return counters;
+	}
+
 	void frame()
 	{
 		PROFILE_FUNCTION();
@@ -364,16 +544,37 @@ struct GPUProfiler
 			if (q.is_end) {
 				if (q.stats && !gpu::isQueryReady(q.stats)) break;
 
+				ASSERT(m_depth > 0);
+				const OpenQuery& open = m_open_queries[minimum(m_depth - 1, (u32)lengthOf(m_open_queries) - 1)];
 				const u64 timestamp = toCPUTimestamp(gpu::getQueryResult(q.handle));
+				PassCounters& counters = getPassCounters(open.name, q.stats);
 				if (q.stats) {
 					profiler::gpuStats(gpu::getQueryResult(q.stats));
+					const gpu::PipelineStats s = gpu::getQueryPipelineStats(q.stats);
+					profiler::GPUPipelineStats stats;
+					stats.input_primitives = s.input_primitives;
+					stats.vs_invocations = s.vs_invocations;
+					stats.culled_primitives = s.input_primitives > s.clipper_primitives ? s.input_primitives - s.clipper_primitives : 0;
+					stats.ps_invocations = s.ps_invocations;
+					profiler::gpuPipelineStats(stats);
+					profiler::pushCounter(counters.input_primitives, stats.input_primitives / 1000.f);
+					profiler::pushCounter(counters.culled_primitives, stats.culled_primitives / 1000.f);
+					profiler::pushCounter(counters.vs_invocations, stats.vs_invocations / 1000.f);
+					profiler::pushCounter(counters.ps_invocations, stats.ps_invocations / 1000000.f);
 					m_stats_pool.push(q.stats);
 				}
+				profiler::pushCounter(counters.time, float((timestamp - open.timestamp) * 1000 / double(os::Timer::getFrequency())));
 				profiler::endGPUBlock(timestamp);
+				--m_depth;
+				// outermost block is the whole frame
+				if (m_depth == 0) m_last_frame_time = float((timestamp - m_frame_begin) / double(os::Timer::getFrequency()));
 			}
 			else {
 				const u64 timestamp = toCPUTimestamp(gpu::getQueryResult(q.handle));
 				profiler::beginGPUBlock(q.name, timestamp, q.profiler_link);
+				if (m_depth == 0) m_frame_begin = timestamp;
+				if (m_depth < lengthOf(m_open_queries)) m_open_queries[m_depth] = {q.name, timestamp};
+				++m_depth;
 			}
 			m_pool.push(q.handle);
 			m_queries.erase(0);
@@ -384,9 +585,14 @@ struct GPUProfiler
 	Array<Query> m_queries;
 	Array<gpu::QueryHandle> m_pool;
 	Array<gpu::QueryHandle> m_stats_pool;
+	HashMap<RuntimeHash, PassCounters> m_pass_counters;
+	OpenQuery m_open_queries[32];
 	jobs::Mutex m_mutex;
 	i64 m_gpu_to_cpu_offset;
 	u32 m_stats_counter = 0;
+	u32 m_depth = 0;
+	u64 m_frame_begin = 0;
+	float m_last_frame_time = 0;
 	gpu::QueryHandle m_stats_query = gpu::INVALID_QUERY;
 };
 
@@ -411,7 +617,9 @@ struct RendererImpl final : Renderer {
 		, m_semantic_defines(m_allocator)
 		, m_free_frames(m_allocator)
 		, m_renderbuffers(m_allocator)
+		, m_renderbuffer_heaps(m_allocator)
 		, m_frame_thread(*this)
+		, m_gpu_memory_budget_exceeded(m_allocator)
 		, m_atmo(*this)
 		, m_cubemap_sky(*this)
 		, m_tdao(*this)
@@ -430,6 +638,24 @@ struct RendererImpl final : Renderer {
 		m_shader_defines.reserve(32);
 
 		bool try_load_renderdoc = CommandLineParser::isOn("-renderdoc");
+		m_texture_streaming = CommandLineParser::isOn("-texture_streaming");
+		m_model_streaming = CommandLineParser::isOn("-model_streaming");
+		m_gpu_driven = CommandLineParser::isOn("-gpu_driven");
+		m_occlusion_culling = CommandLineParser::isOn("-occlusion_culling");
+		m_lazy_shadow_cascades = CommandLineParser::isOn("-lazy_shadow_cascades");
+		m_terrain_clipmap = CommandLineParser::isOn("-terrain_clipmap");
+		m_terrain_gpu_lod = CommandLineParser::isOn("-terrain_gpu_lod");
+		m_renderbuffer_aliasing = CommandLineParser::isOn("-renderbuffer_aliasing");
+		m_dynamic_resolution = CommandLineParser::isOn("-dynamic_resolution");
+		m_low_latency = CommandLineParser::isOn("-low_latency");
+		m_headless = m_engine.isHeadless();
+		parseFramesInFlight();
+		parseDrawStreamCapture();
+		if (CommandLineParser::isOn("-shader_usage")) {
+			m_shader_usage.create(m_allocator);
+			// merged with permutations from previous sessions
+			m_shader_usage->load(getShaderUsagePath());
+		}
 		gpu::preinit(m_allocator, try_load_renderdoc);
 		for (Local<FrameData>& f : m_frames) f.create(*this, m_allocator, m_engine.getPageAllocator());
 
@@ -447,16 +673,92 @@ struct RendererImpl final : Renderer {
 
 	float getLODMultiplier() const override { return m_lod_multiplier; }
 	void setLODMultiplier(float value) override { m_lod_multiplier = maximum(0.f, value); }
+	bool isTextureStreaming() const override { return m_texture_streaming; }
+	bool isModelStreaming() const override { return m_model_streaming; }
+	bool isGPUDriven() const override { return m_gpu_driven; }
+	bool isOcclusionCulling() const override { return m_occlusion_culling; }
+	bool isLazyShadowCascades() const override { return m_lazy_shadow_cascades; }
+	bool isTerrainClipmap() const override { return m_terrain_clipmap; }
+	bool isTerrainGPULOD() const override { return m_terrain_gpu_lod; }
+	bool isHeadless() const override { return m_headless; }
+	bool isDynamicResolution() const override { return m_dynamic_resolution; }
+	bool isLowLatency() const override { return m_low_latency; }
+	void setLowLatency(bool enable) override { m_low_latency = enable; }
+	u32 getFramesInFlight() const override { return m_frames_in_flight; }
+
+	void setFramesInFlight(u32 count) override {
+		jobs::MutexGuard guard(m_frames_mutex);
+		m_frames_in_flight = clamp(count, 1, lengthOf(m_frames));
+		updateFreeFramesSignal();
+	}
+
+	void parseFramesInFlight() {
+		char cmd_line[2048];
+		os::getCommandLine(Span(cmd_line));
+		CommandLineParser parser(cmd_line);
+		while (parser.next()) {
+			if (!parser.currentEquals("-frames_in_flight")) continue;
+			if (!parser.next()) break;
+			char tmp[32];
+			parser.getCurrent(tmp, sizeof(tmp));
+			u32 count;
+			if (!fromCString(tmp, count) || count < 1 || count > lengthOf(m_frames)) {
+				logError("Invalid number of frames in flight: ", tmp);
+				continue;
+			}
+			m_frames_in_flight = count;
+		}
+	}
+
+	void parseDrawStreamCapture() {
+		if (!CommandLineParser::isOn("-gpu_capture")) return;
+		m_capture.create(m_allocator);
+
+		char cmd_line[2048];
+		os::getCommandLine(Span(cmd_line));
+		CommandLineParser parser(cmd_line);
+		while (parser.next()) {
+			if (!parser.currentEquals("-gpu_capture_frame")) continue;
+			if (!parser.next()) break;
+			char tmp[32];
+			parser.getCurrent(tmp, sizeof(tmp));
+			if (!fromCString(tmp, m_capture_frame)) logError("Invalid capture frame: ", tmp);
+		}
+	}
+
+	StaticString<MAX_PATH> getShaderUsagePath() {
+		return StaticString<MAX_PATH>(m_engine.getFileSystem().getBasePath(), "/", ShaderUsage::FILENAME);
+	}
+
+	ShaderUsage* getShaderUsage() override { return m_shader_usage.get(); }
+
+	bool captureDrawStream(const char* path) override {
+		if (!m_capture.get()) {
+			logError("Draw stream capture is not enabled, use -gpu_capture");
+			return false;
+		}
+		m_capture->requestCapture(path);
+		return true;
+	}
+
+	float getGPUFrameTime() const override { return m_profiler.m_last_frame_time; }
+	DelegateList<void(const gpu::MemoryStats&)>& gpuMemoryBudgetExceeded() override { return m_gpu_memory_budget_exceeded; }
 
 	void serialize(OutputMemoryStream& stream) const override {}
 	bool deserialize(i32 version, InputMemoryStream& stream) override { return version == 0; }
 
 	~RendererImpl() {
+		if (m_shader_usage.get()) m_shader_usage->save(getShaderUsagePath());
+
 		DrawStream& stream = getEndFrameDrawStream();
 		for (Renderbuffer& rb : m_renderbuffers) {
 			stream.destroy(rb.handle);
 			rb.handle = gpu::INVALID_TEXTURE;
 		}
+		for (RenderbufferHeap& heap : m_renderbuffer_heaps) {
+			stream.destroy(heap.handle);
+			heap.handle = gpu::INVALID_HEAP;
+		}
 		
 		m_particle_emitter_manager.destroy();
 		m_texture_manager.destroy();
@@ -466,6 +768,14 @@ struct RendererImpl final : Renderer {
 		m_font_manager->destroy();
 		LUMIX_DELETE(m_allocator, m_font_manager);
 		
+		if (m_headless) {
+			m_frame_thread.finished = true;
+			m_frame_thread.semaphore.signal();
+			m_frame_thread.destroy();
+			ASSERT(m_sort_key_map.size() == 1); // only null key left
+			return;
+		}
+
 		frame();
 		frame();
 		frame();
@@ -538,6 +848,8 @@ struct RendererImpl final : Renderer {
 	}
 
 	void initEnd() override {
+		// postprocesses need shaders
+		if (m_headless) return;
 		m_bloom.init();
 		m_atmo.init();
 		m_cubemap_sky.init();
@@ -550,6 +862,7 @@ struct RendererImpl final : Renderer {
 	}
 
 	void shutdownStarted() override {
+		if (m_headless) return;
 		m_bloom.shutdown();
 		m_atmo.shutdown();
 		m_cubemap_sky.shutdown();
@@ -581,6 +894,11 @@ struct RendererImpl final : Renderer {
 		jobs::Signal signal;
 		jobs::runLambda([this, flags]() {
 			PROFILE_BLOCK("init_render");
+			if (m_headless) {
+				// frames are never rendered, but resources can still put commands to draw streams
+				for (const Local<FrameData>& frame : m_frames) jobs::turnGreen(&frame->can_setup);
+				return;
+			}
 			os::WindowHandle window_handle = m_engine.getMainWindow();
 			if (window_handle == os::INVALID_WINDOW) {
 				logError("Trying to initialize renderer without any window");
@@ -599,15 +917,16 @@ struct RendererImpl final : Renderer {
 			}
 
 			for (const Local<FrameData>& frame : m_frames) {
-				frame->transient_buffer.init();
-				frame->uniform_buffer.init();
+				frame->transient_buffer.init(m_transient_sizing);
+				frame->uniform_buffer.init(m_uniform_sizing);
 				jobs::turnGreen(&frame->can_setup);
 			}
-			gpu::createBuffer(m_instanced_meshes_buffer, gpu::BufferFlags::SHADER_BUFFER, 64 * 1024 * 1024, nullptr, "instanced_meshes");
+			gpu::createBuffer(m_instanced_meshes_buffer, gpu::BufferFlags::SHADER_BUFFER, INSTANCED_MESHES_BUFFER_SIZE, nullptr, "instanced_meshes");
 			m_profiler.init();
 		}, &m_init_signal, 1);
 
 		m_cpu_frame = m_frames[0].get();
+		m_cpu_frame->input_time = os::Timer::getRawTimestamp();
 		for (u32 i = 1; i < lengthOf(m_frames); ++i) {
 			pushFreeFrame(*m_frames[i].get());
 		}
@@ -625,8 +944,13 @@ struct RendererImpl final : Renderer {
 			mb.data[i].next_free = i + 1;
 		}
 		mb.data.back().next_free = -1;
+		mb.cpu_data.resize(Material::MAX_UNIFORMS_BYTES * MAX_MATERIAL_CONSTS_COUNT);
+		memset(mb.cpu_data.begin(), 0, mb.cpu_data.byte_size());
+		mb.dirty.resize((MAX_MATERIAL_CONSTS_COUNT + 63) / 64);
+		memset(mb.dirty.begin(), 0, mb.dirty.byte_size());
 			
-		DrawStream& stream = m_cpu_frame->draw_stream;
+		// material changes are flushed to begin frame stream, so the buffer must be created there too
+		DrawStream& stream = m_cpu_frame->begin_frame_draw_stream;
 		stream.createBuffer(mb.buffer
 			, gpu::BufferFlags::NONE
 			, Material::MAX_UNIFORMS_BYTES * MAX_MATERIAL_CONSTS_COUNT
@@ -642,7 +966,8 @@ struct RendererImpl final : Renderer {
 		m_model_manager.create(Model::TYPE, manager);
 		m_material_manager.create(Material::TYPE, manager);
 		m_particle_emitter_manager.create(ParticleSystemResource::TYPE, manager);
-		m_shader_manager.create(Shader::TYPE, manager);
+		// without shader manager, shaders fail to load and materials are ready without them
+		if (!m_headless) m_shader_manager.create(Shader::TYPE, manager);
 		m_font_manager = LUMIX_NEW(m_allocator, FontManager)(*this, m_allocator);
 		m_font_manager->create(FontResource::TYPE, manager);
 		m_layers.emplace("default");
@@ -726,39 +1051,99 @@ struct RendererImpl final : Renderer {
 			if (rb.format != desc.format) continue;
 			if (rb.flags != desc.flags) continue;
 
+			// memory of a placed buffer can be used by another active buffer
+			if (rb.heap >= 0 && overlapsActiveRenderbuffer(rb.heap, rb.offset, rb.mem_size)) continue;
+
 			rb.state = Renderbuffer::ACTIVE;
 			#ifdef LUMIX_DEBUG
 				rb.debug_name = desc.debug_name;
 			#endif
 			StaticString<128> name(desc.debug_name, " ", u32(&rb - m_renderbuffers.begin()));
-			getDrawStream().setDebugName(rb.handle, name);
+			DrawStream& stream = getDrawStream();
+			stream.setDebugName(rb.handle, name);
+			if (rb.heap >= 0) stream.aliasingBarrier(rb.handle);
 			return RenderBufferHandle(u32(&rb - m_renderbuffers.begin()));
 		}
 
-		for (Renderbuffer& rb : m_renderbuffers) {
-			if (rb.handle) continue;
+		Renderbuffer* rb = nullptr;
+		for (Renderbuffer& iter : m_renderbuffers) {
+			if (iter.handle) continue;
+			rb = &iter;
+			break;
+		}
+		if (!rb) rb = &m_renderbuffers.emplace();
+
+		rb->state = Renderbuffer::ACTIVE;
+		rb->flags = desc.flags;
+		rb->format = desc.format;
+		rb->size = desc.size;
+		rb->heap = -1;
+		#ifdef LUMIX_DEBUG
+			rb->debug_name = desc.debug_name;
+		#endif
+		
+		// readback and non-render-target buffers are rare and small, so only render targets are aliased
+		const bool aliasable = m_renderbuffer_aliasing 
+			&& isFlagSet(desc.flags, gpu::TextureFlags::RENDER_TARGET)
+			&& !isFlagSet(desc.flags, gpu::TextureFlags::READBACK);
+		if (aliasable) {
+			placeRenderbuffer(*rb);
+			rb->handle = gpu::allocTextureHandle();
+			DrawStream& stream = getDrawStream();
+			stream.createTexture(rb->handle, desc.size.x, desc.size.y, 1, desc.format, desc.flags, m_renderbuffer_heaps[rb->heap].handle, rb->offset, desc.debug_name);
+			stream.aliasingBarrier(rb->handle);
+		}
+		else {
+			rb->handle = createTexture(desc.size.x, desc.size.y, 1, desc.format, desc.flags, Renderer::MemRef(), desc.debug_name);
+		}
+		return RenderBufferHandle(u32(rb - m_renderbuffers.begin()));
+	}
 
-			rb.handle = createTexture(desc.size.x, desc.size.y, 1, desc.format, desc.flags, Renderer::MemRef(), desc.debug_name);
-			rb.state = Renderbuffer::ACTIVE;
-			rb.flags = desc.flags;
-			rb.format = desc.format;
-			rb.size = desc.size;
-			#ifdef LUMIX_DEBUG
-				rb.debug_name = desc.debug_name;
-			#endif
-			return RenderBufferHandle(u32(&rb - m_renderbuffers.begin()));
+	bool overlapsActiveRenderbuffer(i32 heap, u64 offset, u64 size) const {
+		for (const Renderbuffer& rb : m_renderbuffers) {
+			if (rb.heap != heap || rb.state != Renderbuffer::ACTIVE || !rb.handle) continue;
+			if (rb.offset < offset + size && offset < rb.offset + rb.mem_size) return true;
 		}
+		return false;
+	}
 
-		Renderbuffer& rb = m_renderbuffers.emplace();
-		rb.handle = createTexture(desc.size.x, desc.size.y, 1, desc.format, desc.flags, Renderer::MemRef(), desc.debug_name);
-		rb.state = Renderbuffer::ACTIVE;
-		rb.flags = desc.flags;
-		rb.format = desc.format;
-		rb.size = desc.size;
-		#ifdef LUMIX_DEBUG		
-			rb.debug_name = desc.debug_name;
-		#endif
-		return RenderBufferHandle(m_renderbuffers.size() - 1);
+	// finds memory not used by any active buffer, creates new heap if there's none
+	void placeRenderbuffer(Renderbuffer& rb) {
+		rb.mem_size = gpu::getPlacedTextureSize(rb.size.x, rb.size.y, 1, rb.format, rb.flags);
+
+		for (i32 heap_idx = 0; heap_idx < m_renderbuffer_heaps.size(); ++heap_idx) {
+			RenderbufferHeap& heap = m_renderbuffer_heaps[heap_idx];
+			if (!heap.handle || heap.size < rb.mem_size) continue;
+
+			// candidates are the start of the heap and ends of active buffers
+			auto try_place = [&](u64 offset) {
+				if (offset + rb.mem_size > heap.size) return false;
+				if (overlapsActiveRenderbuffer(heap_idx, offset, rb.mem_size)) return false;
+				rb.heap = heap_idx;
+				rb.offset = offset;
+				++heap.users;
+				return true;
+			};
+
+			if (try_place(0)) return;
+			for (const Renderbuffer& other : m_renderbuffers) {
+				if (other.heap != heap_idx || other.state != Renderbuffer::ACTIVE || &other == &rb) continue;
+				if (try_place(other.offset + other.mem_size)) return;
+			}
+		}
+
+		i32 heap_idx = m_renderbuffer_heaps.find([](const RenderbufferHeap& heap){ return !heap.handle; });
+		if (heap_idx < 0) {
+			heap_idx = m_renderbuffer_heaps.size();
+			m_renderbuffer_heaps.emplace();
+		}
+		RenderbufferHeap& heap = m_renderbuffer_heaps[heap_idx];
+		heap.size = maximum(RenderbufferHeap::MIN_SIZE, rb.mem_size);
+		heap.handle = gpu::allocHeapHandle();
+		heap.users = 1;
+		getDrawStream().createHeap(heap.handle, heap.size, gpu::TextureFlags::RENDER_TARGET, "renderbuffers");
+		rb.heap = heap_idx;
+		rb.offset = 0;
 	}
 
 	void releaseRenderbuffer(RenderBufferHandle handle) override {
@@ -800,6 +1185,8 @@ struct RendererImpl final : Renderer {
 					if (rb.handle) {
 						getEndFrameDrawStream().destroy(rb.handle);
 						rb.handle = gpu::INVALID_TEXTURE;
+						if (rb.heap >= 0) --m_renderbuffer_heaps[rb.heap].users;
+						rb.heap = -1;
 					}
 					break;
 			}
@@ -809,6 +1196,17 @@ struct RendererImpl final : Renderer {
 			if (m_renderbuffers.last().handle) break;
 			m_renderbuffers.pop();
 		}
+
+		u64 heaps_size = 0;
+		for (RenderbufferHeap& heap : m_renderbuffer_heaps) {
+			if (heap.handle && heap.users == 0) {
+				getEndFrameDrawStream().destroy(heap.handle);
+				heap.handle = gpu::INVALID_HEAP;
+			}
+			if (heap.handle) heaps_size += heap.size;
+		}
+		static u32 heaps_counter = profiler::createCounter("Renderbuffer heaps (MB)", 0);
+		profiler::pushCounter(heaps_counter, float(double(heaps_size) / (1024 * 1024)));
 	}
 
 	MaterialIndex createMaterialInstance(Span<const float> data) override {
@@ -822,21 +1220,39 @@ struct RendererImpl final : Renderer {
 		m_material_buffer.data[idx].ref_count = 1;
 		m_material_buffer.data[idx].is_instance = true;
 		m_material_buffer.data[idx].hash = RuntimeHash(data.begin(), data.length() * sizeof(float));
-		
-		jobs::wait(&m_cpu_frame->can_setup);
-		const u32 size = u32(data.length() * sizeof(float));
-		const TransientSlice slice = m_cpu_frame->uniform_buffer.alloc(size);
-		memcpy(slice.ptr, data.begin(), size);
-		m_cpu_frame->draw_stream.copy(m_material_buffer.buffer, slice.buffer, idx * Material::MAX_UNIFORMS_BYTES, slice.offset, size);
+		m_material_buffer.write(idx, 0, data.begin(), u32(data.length() * sizeof(float)));
 		return MaterialIndex{idx};
 	}
 
 	void updateMaterialConstants(MaterialIndex handle, Span<const float> data, u32 offset) override {
-		jobs::wait(&m_cpu_frame->can_setup);
-		const u32 size = u32(data.length() * sizeof(float));
-		const TransientSlice slice = m_cpu_frame->uniform_buffer.alloc(size);
-		memcpy(slice.ptr, data.begin(), size);
-		m_cpu_frame->draw_stream.copy(m_material_buffer.buffer, slice.buffer, u32(handle) * Material::MAX_UNIFORMS_BYTES, slice.offset, size);
+		m_material_buffer.write(u32(handle), offset, data.begin(), u32(data.length() * sizeof(float)));
+	}
+
+	// uploads all materials changed since the last flush, consecutive materials are uploaded with a single copy
+	void flushMaterialBuffer() {
+		PROFILE_FUNCTION();
+		MaterialBuffer& mb = m_material_buffer;
+		DrawStream& stream = m_cpu_frame->begin_frame_draw_stream;
+		const u32 count = mb.data.size();
+		u32 idx = 0;
+		while (idx < count) {
+			if (!mb.dirty[idx / 64]) {
+				idx = (idx / 64 + 1) * 64;
+				continue;
+			}
+			if (!mb.isDirty(idx)) {
+				++idx;
+				continue;
+			}
+			const u32 from = idx;
+			while (idx < count && mb.isDirty(idx)) ++idx;
+			
+			const u32 size = (idx - from) * Material::MAX_UNIFORMS_BYTES;
+			const TransientSlice slice = m_cpu_frame->transient_buffer.alloc(size);
+			memcpy(slice.ptr, &mb.cpu_data[from * Material::MAX_UNIFORMS_BYTES], size);
+			stream.copy(mb.buffer, slice.buffer, from * Material::MAX_UNIFORMS_BYTES, slice.offset, size);
+		}
+		memset(mb.dirty.begin(), 0, mb.dirty.byte_size());
 	}
 
 	MaterialIndex createMaterialConstants(Span<const float> data) override {
@@ -858,12 +1274,7 @@ struct RendererImpl final : Renderer {
 			m_material_buffer.data[idx].is_instance = false;
 			m_material_buffer.data[idx].hash = RuntimeHash(data.begin(), data.length() * sizeof(float));
 			m_material_buffer.map.insert(hash, idx);
-			
-			jobs::wait(&m_cpu_frame->can_setup);
-			const u32 size = u32(data.length() * sizeof(float));
-			const TransientSlice slice = m_cpu_frame->uniform_buffer.alloc(size);
-			memcpy(slice.ptr, data.begin(), size);
-			m_cpu_frame->draw_stream.copy(m_material_buffer.buffer, slice.buffer, idx * Material::MAX_UNIFORMS_BYTES, slice.offset, size);
+			m_material_buffer.write(idx, 0, data.begin(), u32(data.length() * sizeof(float)));
 		}
 		++m_material_buffer.data[idx].ref_count;
 		return MaterialIndex{idx};
@@ -992,7 +1403,7 @@ struct RendererImpl final : Renderer {
 
 
 	void setupJob(void* user_ptr, void(*task)(void*)) override {
-		jobs::run(user_ptr, task, &m_cpu_frame->setup_done);
+		jobs::run(user_ptr, task, &m_cpu_frame->setup_done, jobs::ANY_WORKER, jobs::Priority::HIGH);
 	}
 
 	void addPlugin(RenderPlugin& plugin) override {
@@ -1041,6 +1452,7 @@ struct RendererImpl final : Renderer {
 		}
 		gpu::ProgramHandle program = gpu::allocProgramHandle();
 		shader.compile(program, key, decl, m_cpu_frame->begin_frame_draw_stream);
+		if (m_shader_usage.get()) m_shader_usage->record(shader, key, decl);
 		m_cpu_frame->to_compile_shaders.push({&shader, shader.m_content_hash, decl, program, key});
 		return program;
 	}
@@ -1073,6 +1485,13 @@ struct RendererImpl final : Renderer {
 
 		FrameData& frame = popGPUQueue();
 		profiler::pushInt("Frame", frame.frame_number);
+		DrawStreamCapture* capture = m_capture.get();
+		if (capture && capture->beginFrame()) {
+			// buffers written directly by CPU or GPU, not through draw streams
+			frame.transient_buffer.capture(*capture);
+			frame.uniform_buffer.capture(*capture);
+			capture->externalBuffer(m_instanced_meshes_buffer, gpu::BufferFlags::SHADER_BUFFER, INSTANCED_MESHES_BUFFER_SIZE, nullptr, 0, "instanced_meshes");
+		}
 		frame.transient_buffer.prepareToRender();
 		frame.uniform_buffer.prepareToRender();
 		
@@ -1084,6 +1503,8 @@ struct RendererImpl final : Renderer {
 			static u32 buffer_counter = profiler::createCounter("Buffer memory (MB)", 0);
 			static u32 texture_counter = profiler::createCounter("Texture memory (MB)", 0);
 			static u32 rt_counter = profiler::createCounter("Render target memory (MB)", 0);
+			static u32 budget_counter = profiler::createCounter("GPU memory budget (MB)", 0);
+			static u32 usage_counter = profiler::createCounter("GPU memory usage (MB)", 0);
 			auto to_MB = [](u64 B){
 				return float(double(B) / (1024.0 * 1024.0));
 			};
@@ -1093,14 +1514,29 @@ struct RendererImpl final : Renderer {
 			profiler::pushCounter(buffer_counter, to_MB(mem_stats.buffer_mem));
 			profiler::pushCounter(texture_counter, to_MB(mem_stats.texture_mem));
 			profiler::pushCounter(rt_counter, to_MB(mem_stats.render_target_mem));
+			profiler::pushCounter(budget_counter, to_MB(mem_stats.budget));
+			profiler::pushCounter(usage_counter, to_MB(mem_stats.usage));
+		}
+
+		{
+			static u32 transient_counter = profiler::createCounter("Transient buffer (KB)", 0);
+			static u32 transient_peak_counter = profiler::createCounter("Transient buffer peak (KB)", 0);
+			static u32 uniform_counter = profiler::createCounter("Uniform buffer (KB)", 0);
+			static u32 uniform_peak_counter = profiler::createCounter("Uniform buffer peak (KB)", 0);
+			profiler::pushCounter(transient_counter, m_transient_sizing.last_used / 1024.f);
+			profiler::pushCounter(transient_peak_counter, m_transient_sizing.peak / 1024.f);
+			profiler::pushCounter(uniform_counter, m_uniform_sizing.last_used / 1024.f);
+			profiler::pushCounter(uniform_peak_counter, m_uniform_sizing.peak / 1024.f);
 		}
 
 		m_profiler.beginQuery("frame", 0, false);
+		if (capture) frame.begin_frame_draw_stream.record(*capture);
 		frame.begin_frame_draw_stream.run();
 		frame.begin_frame_draw_stream.reset();
 
 		{
 			PROFILE_BLOCK("draw stream");
+			if (capture) frame.draw_stream.record(*capture);
 			frame.draw_stream.run();
 			profiler::pushInt("Drawcalls", frame.draw_stream.num_drawcalls);
 			
@@ -1112,6 +1548,10 @@ struct RendererImpl final : Renderer {
 			frame.draw_stream.reset();
 		}
 
+		if (capture) {
+			frame.end_frame_draw_stream.record(*capture);
+			capture->endFrame();
+		}
 		frame.end_frame_draw_stream.run();
 		frame.end_frame_draw_stream.reset();
 
@@ -1121,10 +1561,16 @@ struct RendererImpl final : Renderer {
 		frame.gpu_frame = gpu::present();
 		m_profiler.frame();
 
+		{
+			static u32 latency_counter = profiler::createCounter("Input to present (ms)", 0);
+			const u64 now = os::Timer::getRawTimestamp();
+			profiler::pushCounter(latency_counter, float((now - frame.input_time) * 1000.0 / os::Timer::getFrequency()));
+		}
+
 		if (gpu::frameFinished(frame.gpu_frame)) {
 			frame.gpu_frame = 0xFFffFFff;
-			frame.transient_buffer.renderDone();
-			frame.uniform_buffer.renderDone();
+			frame.transient_buffer.renderDone(true);
+			frame.uniform_buffer.renderDone(true);
 			jobs::turnGreen(&frame.can_setup);
 			pushFreeFrame(frame);
 		}
@@ -1134,7 +1580,7 @@ struct RendererImpl final : Renderer {
 		}
 	}
 
-	ArenaAllocator& getCurrentFrameAllocator() override { return m_cpu_frame->arena_allocator; }
+	FrameArena& getCurrentFrameAllocator() override { return m_cpu_frame->arena_allocator; }
 
 	void waitForCommandSetup() override
 	{
@@ -1160,22 +1606,32 @@ struct RendererImpl final : Renderer {
 
 	u32 frameNumber() const override { return m_cpu_frame->frame_number; }
 
+	// frames above m_frames_in_flight stay in m_free_frames, so CPU can not get further ahead of GPU
+	u32 reservedFreeFrames() const { return lengthOf(m_frames) - m_frames_in_flight; }
+
+	// call with m_frames_mutex locked
+	void updateFreeFramesSignal() {
+		if ((u32)m_free_frames.size() > reservedFreeFrames()) jobs::turnGreen(&m_has_free_frames);
+		else jobs::turnRed(&m_has_free_frames);
+	}
+
 	void pushFreeFrame(FrameData& frame) {
 		jobs::MutexGuard guard(m_frames_mutex);
 		m_free_frames.push(&frame);
-		jobs::turnGreen(&m_has_free_frames);
+		updateFreeFramesSignal();
 	}
 
 	FrameData* popFreeFrame() {
 		jobs::MutexGuard guard(m_frames_mutex);
-		if (m_free_frames.empty()) {
+		// frames in flight can change while we wait
+		while ((u32)m_free_frames.size() <= reservedFreeFrames()) {
 			jobs::exit(&m_frames_mutex);
 			jobs::wait(&m_has_free_frames);
 			jobs::enter(&m_frames_mutex);
 		}
 		FrameData* frame = m_free_frames.back();
 		m_free_frames.pop();
-		if (m_free_frames.empty()) jobs::turnRed(&m_has_free_frames);
+		updateFreeFramesSignal();
 		return frame;
 	}
 
@@ -1210,6 +1666,10 @@ struct RendererImpl final : Renderer {
 		jobs::wait(&m_cpu_frame->setup_done);
 		clearBuffers();
 
+		if (m_capture_frame != 0 && m_cpu_frame->frame_number == m_capture_frame) {
+			m_capture->requestCapture("draw_stream.ldc");
+		}
+
 		m_cpu_frame->draw_stream.useProgram(gpu::INVALID_PROGRAM);
 		m_cpu_frame->draw_stream.bindIndexBuffer(gpu::INVALID_BUFFER);
 		m_cpu_frame->draw_stream.bindVertexBuffer(0, gpu::INVALID_BUFFER, 0, 0);
@@ -1219,14 +1679,34 @@ struct RendererImpl final : Renderer {
 		}
 
 		for (const auto& i : m_cpu_frame->to_compile_shaders) {
-			i.shader->m_programs.push({i.key, i.program});
+			i.shader->addProgram(i.key, i.program);
 		}
 		m_cpu_frame->to_compile_shaders.clear();
 
+		if (m_texture_streaming) {
+			PROFILE_BLOCK("texture streaming");
+			for (Resource* material : m_material_manager.getResourceTable()) {
+				((Material*)material)->updateTextureStreaming();
+			}
+		}
+
+		if (m_model_streaming) {
+			PROFILE_BLOCK("model streaming");
+			for (Resource* model : m_model_manager.getResourceTable()) {
+				((Model*)model)->updateStreaming();
+			}
+		}
+
+		flushMaterialBuffer();
+		checkGPUMemoryBudget();
+
 		jobs::turnRed(&m_cpu_frame->can_setup);
 		pushToGPUQueue(*m_cpu_frame);
 
 		m_cpu_frame = popFreeFrame();
+		// wait here, before the next frame samples input, instead of blocking in present with stale input
+		if (m_low_latency) gpu::waitForSwapchain();
+		m_cpu_frame->input_time = os::Timer::getRawTimestamp();
 		++m_frame_number;
 		profiler::pushInt("Frame", m_cpu_frame->frame_number);
 		m_cpu_frame->frame_number = m_frame_number;
@@ -1238,6 +1718,34 @@ struct RendererImpl final : Renderer {
 
 	}
 
+	void checkGPUMemoryBudget() {
+		gpu::MemoryStats mem_stats;
+		if (!gpu::getMemoryStats(mem_stats) || mem_stats.budget == 0) return;
+
+		const bool over_budget = mem_stats.usage > mem_stats.budget;
+		if (over_budget && !m_over_gpu_memory_budget) {
+			logWarning("GPU memory over budget (", mem_stats.usage / (1024 * 1024), " MB / ", mem_stats.budget / (1024 * 1024), " MB)");
+			m_gpu_memory_budget_exceeded.invoke(mem_stats);
+		}
+		m_over_gpu_memory_budget = over_budget;
+
+		// textures are the only resources with residency management, so they make room for the rest
+		// budget set by user is restored when there's enough headroom again
+		ResourceManager& textures = m_texture_manager;
+		if (m_user_texture_budget == 0 && textures.getBudget() == 0) return;
+		if (over_budget) {
+			if (m_user_texture_budget == 0) m_user_texture_budget = textures.getBudget();
+			const u64 overflow = mem_stats.usage - mem_stats.budget;
+			const u64 texture_usage = textures.getMemoryUsage();
+			const u64 new_budget = texture_usage > overflow * 2 ? texture_usage - overflow : texture_usage / 2;
+			if (new_budget < textures.getBudget()) textures.setBudget(new_budget);
+		}
+		else if (m_user_texture_budget != 0 && mem_stats.usage < mem_stats.budget / 10 * 9) {
+			textures.setBudget(m_user_texture_budget);
+			m_user_texture_budget = 0;
+		}
+	}
+
 	// wait till gpu is done with a frame and reuse it
 	struct FrameThread : Thread {
 		FrameThread(RendererImpl& renderer)
@@ -1278,21 +1786,21 @@ struct RendererImpl final : Renderer {
 				PROFILE_BLOCK("frame finished");
 				profiler::pushInt("Frame", f->frame_number);
 				
-				// If overflowed buffers exist, we must reuse the frame in the render thread
+				// If buffers need to be resized, we must reuse the frame in the render thread
 				// because TransientBuffer::renderDone calls gpu::destroy
-				const bool can_run_on_any_worker = !f->transient_buffer.m_overflow.buffer && !f->uniform_buffer.m_overflow.buffer;
+				const bool resize = f->transient_buffer.needsResize() || f->uniform_buffer.needsResize();
 
 				// running this on render thread might wait till other jobs are done on render thread, causing delay
 				// therefore we try to run on any worker if we can
-				jobs::runLambda([f]() {
+				jobs::runLambda([f, resize]() {
 					PROFILE_BLOCK("reuse frame");
 					profiler::pushInt("Frame", f->frame_number);
 					f->gpu_frame = 0xFFffFFff;
-					f->transient_buffer.renderDone();
-					f->uniform_buffer.renderDone();
+					f->transient_buffer.renderDone(resize);
+					f->uniform_buffer.renderDone(resize);
 					jobs::turnGreen(&f->can_setup);
 					f->renderer.pushFreeFrame(*f);
-				}, nullptr, can_run_on_any_worker ? jobs::ANY_WORKER : 1);
+				}, nullptr, resize ? 1 : jobs::ANY_WORKER);
 			}
 			return 0;
 		}
@@ -1323,11 +1831,25 @@ struct RendererImpl final : Renderer {
 	RenderResourceManager<Material> m_material_manager;
 	u32 m_frame_number = 0;
 	float m_lod_multiplier = 1;
+	bool m_texture_streaming = false;
+	bool m_model_streaming = false;
+	bool m_gpu_driven = false;
+	bool m_occlusion_culling = false;
+	bool m_lazy_shadow_cascades = false;
+	bool m_terrain_clipmap = false;
+	bool m_terrain_gpu_lod = false;
+	bool m_headless = false;
+	bool m_renderbuffer_aliasing = false;
+	bool m_dynamic_resolution = false;
+	bool m_low_latency = false;
+	u32 m_frames_in_flight = 2;
 	jobs::Counter m_init_signal;
 	HashMap<RuntimeHash, String> m_semantic_defines;
 
 	Array<RenderPlugin*> m_plugins;
-	Local<FrameData> m_frames[2];
+	TransientBufferSizing m_transient_sizing{4 * 1024 * 1024};
+	TransientBufferSizing m_uniform_sizing{4 * 1024 * 1024};
+	Local<FrameData> m_frames[3];
 	jobs::Signal m_gpu_queue_empty;
 	FrameData* m_gpu_queue = nullptr;
 	FrameData* m_cpu_frame = nullptr;
@@ -1338,13 +1860,27 @@ struct RendererImpl final : Renderer {
 
 	GPUProfiler m_profiler;
 	FrameThread m_frame_thread;
+	DelegateList<void(const gpu::MemoryStats&)> m_gpu_memory_budget_exceeded;
+	bool m_over_gpu_memory_budget = false;
+	// texture manager's budget before it was lowered because of GPU memory budget, 0 if not lowered
+	u64 m_user_texture_budget = 0;
 
 	struct MaterialBuffer {
 		MaterialBuffer(IAllocator& alloc) 
 			: map(alloc)
 			, data(alloc)
+			, cpu_data(alloc)
+			, dirty(alloc)
 		{}
 
+		void write(u32 idx, u32 offset, const void* src, u32 size) {
+			ASSERT(offset + size <= Material::MAX_UNIFORMS_BYTES);
+			memcpy(&cpu_data[idx * Material::MAX_UNIFORMS_BYTES + offset], src, size);
+			dirty[idx / 64] |= u64(1) << (idx % 64);
+		}
+
+		bool isDirty(u32 idx) const { return dirty[idx / 64] & (u64(1) << (idx % 64)); }
+
 		struct Data {
 			Data() {}
 			u32 ref_count;
@@ -1359,6 +1895,9 @@ struct RendererImpl final : Renderer {
 		Array<Data> data;
 		int first_free;
 		HashMap<RuntimeHash, u32> map;
+		// CPU copy of the buffer, changed materials are marked dirty and uploaded once per frame, see flushMaterialBuffer
+		Array<u8> cpu_data;
+		Array<u64> dirty;
 	} m_material_buffer;
 
 	Array<SortKey> m_sort_keys;
@@ -1366,7 +1905,14 @@ struct RendererImpl final : Renderer {
 	i32 m_first_free_sort_key = -1;
 
 	Array<Renderbuffer> m_renderbuffers;
+	Array<RenderbufferHeap> m_renderbuffer_heaps;
 	gpu::BufferHandle m_instanced_meshes_buffer = gpu::INVALID_BUFFER;
+	static constexpr u32 INSTANCED_MESHES_BUFFER_SIZE = 64 * 1024 * 1024;
+	// see -gpu_capture, -gpu_capture_frame N captures N-th frame to draw_stream.ldc
+	Local<DrawStreamCapture> m_capture;
+	u32 m_capture_frame = 0;
+	// see -shader_usage
+	Local<ShaderUsage> m_shader_usage;
 	// built-in postprocesses
 	// environment
 	Atmo m_atmo;
@@ -4,6 +4,7 @@
 
 #include "core/allocator.h"
 #include "core/color.h"
+#include "core/delegate_list.h"
 #include "core/math.h"
 #include "core/profiler.h"
 #include "draw_stream.h"
@@ -79,8 +80,44 @@ struct LUMIX_RENDERER_API Renderer : ISystem {
 	virtual struct Engine& getEngine() = 0;
 	virtual float getLODMultiplier() const = 0;
 	virtual void setLODMultiplier(float value) = 0;
+	// enabled with -texture_streaming, textures load only coarse mips
+	// finer mips are loaded when materials using them are rendered close to camera, see Material::requestStreaming
+	virtual bool isTextureStreaming() const = 0;
+	// enabled with -model_streaming, LOD0 of models with more LODs is loaded when an instance gets close
+	virtual bool isModelStreaming() const = 0;
+	// enabled with -gpu_driven, static model instances are culled and drawn on GPU, see GPUDrivenModel
+	virtual bool isGPUDriven() const = 0;
+	// enabled with -occlusion_culling, main view is occlusion culled against the previous frame's depth
+	virtual bool isOcclusionCulling() const = 0;
+	// enabled with -lazy_shadow_cascades, far shadow cascades are updated round-robin and reused while they cover the view
+	virtual bool isLazyShadowCascades() const = 0;
+	// enabled with -terrain_clipmap, terrains sample heightmap and splatmap from clipmaps around the camera, see Terrain::Clipmap
+	virtual bool isTerrainClipmap() const = 0;
+	// enabled with -terrain_gpu_lod, terrain patches are selected and culled on GPU and drawn indirectly, see Terrain::LODTree
+	virtual bool isTerrainGPULOD() const = 0;
+	// see Engine::isHeadless, GPU is not initialized, shaders and material textures are not loaded, nothing can be rendered
+	virtual bool isHeadless() const = 0;
+	// enabled with -dynamic_resolution, game view's internal resolution is scaled to hold GPU frame time target, see Pipeline::setDynamicResolutionTarget
+	virtual bool isDynamicResolution() const = 0;
+	// enabled with -low_latency, frame() waits for the swapchain before the next frame samples input, shortening input to present latency
+	virtual bool isLowLatency() const = 0;
+	virtual void setLowLatency(bool enable) = 0;
+	// how many frames CPU can work on before GPU finishes the oldest one, 1-3, default 2, can be set with -frames_in_flight N
+	virtual u32 getFramesInFlight() const = 0;
+	virtual void setFramesInFlight(u32 count) = 0;
+	// GPU duration of the last frame with available timestamps, in seconds, few frames old
+	virtual float getGPUFrameTime() const = 0;
+	// invoked from frame() when GPU memory usage goes over the budget given by OS
+	// texture manager reacts by itself if it has a budget, see ResourceManager::setBudget
+	virtual DelegateList<void(const gpu::MemoryStats&)>& gpuMemoryBudgetExceeded() = 0;
+	// writes the next frame's draw streams to `path`, replay it with gpu_replay tool
+	// requires -gpu_capture, returns false if it's not enabled
+	virtual bool captureDrawStream(const char* path) = 0;
+	// permutations compiled in this session merged with previous sessions, saved on shutdown
+	// requires -shader_usage, returns nullptr if it's not enabled
+	virtual struct ShaderUsage* getShaderUsage() = 0;
 	
-	virtual struct ArenaAllocator& getCurrentFrameAllocator() = 0;
+	virtual struct FrameArena& getCurrentFrameAllocator() = 0;
 	virtual IAllocator& getAllocator() = 0;
 	virtual MemRef allocate(u32 size) = 0;
 	virtual MemRef copy(const void* data, u32 size) = 0 ;
@@ -106,8 +143,10 @@ struct LUMIX_RENDERER_API Renderer : ISystem {
 	virtual struct FontManager& getFontManager() = 0;
 	virtual struct ResourceManager& getTextureManager() = 0;
 	
+	// material constants are written to a CPU copy and changes are uploaded in frame(), so these do not wait for the GPU
 	virtual MaterialIndex createMaterialConstants(Span<const float> data) = 0;
 	virtual MaterialIndex createMaterialInstance(Span<const float> data) = 0;
+	// `offset` is in bytes
 	virtual void updateMaterialConstants(MaterialIndex handle, Span<const float> data, u32 offset) = 0;
 	virtual void destroyMaterialConstants(MaterialIndex id) = 0;
 	virtual gpu::BufferHandle getMaterialUniformBuffer() = 0;
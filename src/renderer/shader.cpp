@@ -37,6 +37,7 @@ Shader::Shader(const Path& path, ResourceManager& resource_manager, Renderer& re
 	, m_all_defines_mask(0)
 	, m_defines(m_allocator)
 	, m_programs(m_allocator)
+	, m_program_map(m_allocator)
 	, m_code(m_allocator)
 {}
 
@@ -72,9 +73,8 @@ gpu::ProgramHandle Shader::getProgram(gpu::StateFlags state, const gpu::VertexDe
 	key.defines = defines;
 	key.state = state;
 	key.semantic_defines = semantic_defines;
-	for (const ProgramPair& p : m_programs) {
-		if (p.key == key) return p.program;
-	}
+	auto iter = m_program_map.find(key);
+	if (iter.isValid()) return iter.value();
 	return m_renderer.queueShaderCompile(*this, key, decl);
 }
 
@@ -95,9 +95,8 @@ gpu::ProgramHandle Shader::getProgram(gpu::StateFlags state, const gpu::VertexDe
 	key.state = state;
 	key.semantic_defines = semantic_defines;
 
-	for (const ProgramPair& p : m_programs) {
-		if (p.key == key) return p.program;
-	}
+	auto iter = m_program_map.find(key);
+	if (iter.isValid()) return iter.value();
 	
 	gpu::VertexDecl merged_decl = merge(decl, decl2);
 
@@ -113,12 +112,17 @@ gpu::ProgramHandle Shader::getProgram(u32 defines) {
 	key.defines = defines;
 	key.state = gpu::StateFlags::NONE;
 	key.semantic_defines = no_def;
-	for (const ProgramPair& p : m_programs) {
-		if (p.key == key) return p.program;
-	}
+	auto iter = m_program_map.find(key);
+	if (iter.isValid()) return iter.value();
 	return m_renderer.queueShaderCompile(*this, key, dummy_decl);
 }
 
+void Shader::addProgram(const ShaderKey& key, gpu::ProgramHandle program) {
+	m_programs.push({key, program});
+	// the same key can be queued in two frames in flight, the first program is used, but both are destroyed in unload
+	if (!m_program_map.find(key).isValid()) m_program_map.insert(key, program);
+}
+
 bool Shader::load(Span<const u8> mem) {
 	InputMemoryStream stream(mem);
 	Header header;
@@ -186,6 +190,7 @@ void Shader::unload()
 	}
 	m_code = "";
 	m_programs.clear();
+	m_program_map.clear();
 	m_uniforms.clear();
 	for (u32 i = 0; i < m_texture_slot_count; ++i) {
 		if (m_texture_slots[i].default_texture) {
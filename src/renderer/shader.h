@@ -24,6 +24,21 @@ struct ShaderKey {
 	const char* semantic_defines;
 };
 
+template<>
+struct HashFunc<ShaderKey> {
+	static u32 mix(u32 a, u32 b) {
+		b *= 0x5bd1e995;
+		b ^= b >> 24;
+		b *= 0x5bd1e995;
+		a *= 0x5bd1e995;
+		return a ^ b;
+	}
+
+	static u32 get(const ShaderKey& key) {
+		return mix(HashFunc<u64>::get(((u64*)&key)[0]), HashFunc<u64>::get(((u64*)&key)[1]));
+	}
+};
+
 struct LUMIX_RENDERER_API Shader final : Resource {
 	struct Header {
 		static const u32 MAGIC = '_SHD';
@@ -82,6 +97,8 @@ struct LUMIX_RENDERER_API Shader final : Resource {
 	gpu::ProgramHandle getProgram(gpu::StateFlags state, const gpu::VertexDecl& decl, u32 defines, const char* attr_defines);
 	gpu::ProgramHandle getProgram(gpu::StateFlags state, const gpu::VertexDecl& decl, const gpu::VertexDecl& decl2, u32 defines, const char* attr_defines);
 	void compile(gpu::ProgramHandle program, const ShaderKey& key, gpu::VertexDecl decl, DrawStream& stream);
+	// called by renderer at the beginning of a frame, when no getProgram can run
+	void addProgram(const ShaderKey& key, gpu::ProgramHandle program);
 	static void toUniformVarName(Span<char> out, const char* in);
 	static void toTextureVarName(Span<char> out, const char* in);
 
@@ -97,6 +114,8 @@ struct LUMIX_RENDERER_API Shader final : Resource {
 		gpu::ProgramHandle program;
 	};
 	Array<ProgramPair> m_programs;
+	// getProgram is called for every drawcall, so it must not search m_programs
+	HashMap<ShaderKey, gpu::ProgramHandle> m_program_map;
 	gpu::ShaderType m_type;
 	String m_code;
 
@@ -109,18 +128,4 @@ private:
 	void onBeforeReady() override;
 };
 
-template<>
-struct HashFunc<ShaderKey> {
-	static u32 mix(u32 a, u32 b) {
-		b *= 0x5bd1e995;
-		b ^= b >> 24;
-		a *= 0x5bd1e995;
-		return a * 0x5bd1e995;
-	}
-
-	static u32 get(const ShaderKey& key) {
-		return mix(HashFunc<u64>::get(((u64*)&key)[0]), HashFunc<u64>::get(((u64*)&key)[1]));
-	}
-};
-
 } // namespace Lumix
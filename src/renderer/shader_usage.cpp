@@ -0,0 +1,247 @@
+#include "shader_usage.h"
+#include "core/log.h"
+#include "core/os.h"
+#include "core/profiler.h"
+#include "core/sort.h"
+#include "core/stream.h"
+#include "engine/engine.h"
+#include "engine/resource_manager.h"
+#include "renderer/renderer.h"
+#include "renderer/shader.h"
+
+namespace Lumix {
+
+// line format, separated by tabs: shader path, state, vertex decl, defines, semantic defines
+// vertex decl is primitive type, attributes count and 4 numbers per attribute, separated by spaces
+// semantic defines are on a single line, so their newlines are replaced with `;`
+static void serialize(OutputMemoryStream& out, const ShaderUsage::Permutation& p) {
+	out << p.shader.c_str() << "\t" << (u64)p.state << "\t";
+	out << (u32)p.decl.primitive_type << " " << (u32)p.decl.attributes_count;
+	for (u32 i = 0; i < p.decl.attributes_count; ++i) {
+		const gpu::Attribute& attr = p.decl.attributes[i];
+		out << " " << (u32)attr.components_count << " " << (u32)attr.byte_offset << " " << (u32)attr.type << " " << (u32)attr.flags;
+	}
+	out << "\t" << p.defines << "\t";
+	const char* semantic_defines = p.semantic_defines.c_str();
+	for (u32 i = 0, c = p.semantic_defines.length(); i < c; ++i) out.write(semantic_defines[i] == '\n' ? ';' : semantic_defines[i]);
+	out << "\n";
+}
+
+static StringView nextToken(StringView& str, char separator) {
+	StringView res;
+	res.begin = str.begin;
+	res.end = str.begin;
+	while (res.end != str.end && *res.end != separator) ++res.end;
+	str.begin = res.end == str.end ? res.end : res.end + 1;
+	return res;
+}
+
+static bool nextNumber(StringView& str, u32& value) {
+	while (str.begin != str.end && *str.begin == ' ') ++str.begin;
+	const char* next = fromCString(str, value);
+	if (!next) return false;
+	str.begin = next;
+	return true;
+}
+
+static bool deserialize(StringView line, ShaderUsage::Permutation& p) {
+	const StringView path = nextToken(line, '\t');
+	const StringView state = nextToken(line, '\t');
+	StringView decl = nextToken(line, '\t');
+	const StringView defines = nextToken(line, '\t');
+	const StringView semantic_defines = nextToken(line, '\t');
+	if (path.empty()) return false;
+
+	p.shader = path;
+	u64 state_value;
+	if (!fromCString(state, state_value)) return false;
+	p.state = (gpu::StateFlags)state_value;
+
+	u32 primitive_type, attributes_count;
+	if (!nextNumber(decl, primitive_type) || !nextNumber(decl, attributes_count)) return false;
+	if (attributes_count > gpu::VertexDecl::MAX_ATTRIBUTES) return false;
+	p.decl = gpu::VertexDecl((gpu::PrimitiveType)primitive_type);
+	for (u32 i = 0; i < attributes_count; ++i) {
+		u32 components_count, byte_offset, type, flags;
+		if (!nextNumber(decl, components_count) || !nextNumber(decl, byte_offset) || !nextNumber(decl, type) || !nextNumber(decl, flags)) return false;
+		p.decl.addAttribute((u8)byte_offset, (u8)components_count, (gpu::AttributeType)type, (u8)flags);
+	}
+	p.decl.computeHash();
+
+	p.defines = defines;
+	p.semantic_defines = semantic_defines;
+	char* semantic_defines_data = p.semantic_defines.getMutableData();
+	for (u32 i = 0, c = p.semantic_defines.length(); i < c; ++i) {
+		if (semantic_defines_data[i] == ';') semantic_defines_data[i] = '\n';
+	}
+	return true;
+}
+
+ShaderUsage::ShaderUsage(IAllocator& allocator)
+	: m_allocator(allocator)
+	, m_permutations(allocator)
+	, m_map(allocator)
+	, m_precompile_shaders(allocator)
+{}
+
+ShaderUsage::~ShaderUsage() {
+	for (Shader* shader : m_precompile_shaders) shader->decRefCount();
+}
+
+static void add(ShaderUsage& usage, ShaderUsage::Permutation&& p) {
+	OutputMemoryStream line(usage.m_allocator);
+	serialize(line, p);
+	const RuntimeHash hash(line.data(), (u32)line.size());
+	if (usage.m_map.find(hash).isValid()) return;
+	usage.m_map.insert(hash, usage.m_permutations.size());
+	usage.m_permutations.push(static_cast<ShaderUsage::Permutation&&>(p));
+}
+
+void ShaderUsage::record(const Shader& shader, const ShaderKey& key, const gpu::VertexDecl& decl) {
+	Permutation p(m_allocator);
+	p.shader = shader.getPath();
+	p.state = key.state;
+	p.decl = decl;
+	for (u32 i = 0; i < sizeof(key.defines) * 8; ++i) {
+		if ((key.defines & (1 << i)) == 0) continue;
+		if (p.defines.length() > 0) p.defines.append(" ");
+		p.defines.append(shader.m_renderer.getShaderDefine(i));
+	}
+	if (key.semantic_defines) p.semantic_defines = key.semantic_defines;
+
+	MutexGuard lock(m_mutex);
+	add(*this, static_cast<Permutation&&>(p));
+}
+
+bool ShaderUsage::load(const char* path) {
+	PROFILE_FUNCTION();
+	os::InputFile file;
+	if (!file.open(path)) return false;
+
+	OutputMemoryStream content(m_allocator);
+	content.resize(file.size());
+	if (!file.read(content.getMutableData(), content.size())) {
+		logError("Could not read ", path);
+		file.close();
+		return false;
+	}
+	file.close();
+
+	MutexGuard lock(m_mutex);
+	StringView lines((const char*)content.data(), (u32)content.size());
+	u32 line_idx = 0;
+	while (lines.begin != lines.end) {
+		StringView line = nextToken(lines, '\n');
+		++line_idx;
+		if (line.size() > 0 && line.end[-1] == '\r') line.removeSuffix(1);
+		if (line.empty()) continue;
+
+		Permutation p(m_allocator);
+		if (!deserialize(line, p)) {
+			logError(path, "(", line_idx, "): invalid shader permutation");
+			continue;
+		}
+		add(*this, static_cast<Permutation&&>(p));
+	}
+	return true;
+}
+
+bool ShaderUsage::save(const char* path) {
+	PROFILE_FUNCTION();
+	OutputMemoryStream content(m_allocator);
+	{
+		MutexGuard lock(m_mutex);
+		for (const Permutation& p : m_permutations) serialize(content, p);
+	}
+
+	os::OutputFile file;
+	if (!file.open(path)) {
+		logError("Could not create ", path);
+		return false;
+	}
+	const bool success = file.write(content.data(), content.size());
+	file.close();
+	if (!success) logError("Could not write ", path);
+	return success;
+}
+
+void ShaderUsage::logReport() {
+	struct Item {
+		StringView name;
+		u32 count;
+	};
+	Array<Item> shaders(m_allocator);
+	Array<Item> defines(m_allocator);
+	auto inc = [](Array<Item>& items, StringView name){
+		for (Item& item : items) {
+			if (item.name == name) {
+				++item.count;
+				return;
+			}
+		}
+		items.push({name, 1});
+	};
+
+	MutexGuard lock(m_mutex);
+	for (const Permutation& p : m_permutations) {
+		inc(shaders, p.shader.c_str());
+		StringView names = p.defines;
+		while (names.begin != names.end) {
+			const StringView name = nextToken(names, ' ');
+			if (!name.empty()) inc(defines, name);
+		}
+	}
+	sort(shaders.begin(), shaders.end(), [](const Item& a, const Item& b){ return a.count > b.count; });
+	sort(defines.begin(), defines.end(), [](const Item& a, const Item& b){ return a.count > b.count; });
+
+	logInfo(m_permutations.size(), " shader permutations used");
+	for (const Item& item : shaders) logInfo("  ", item.name, ": ", item.count);
+	logInfo("Shader permutations per define:");
+	for (const Item& item : defines) logInfo("  ", item.name, ": ", item.count);
+}
+
+bool ShaderUsage::precompile(Renderer& renderer) {
+	MutexGuard lock(m_mutex);
+	if (!m_precompiling) {
+		m_precompiling = true;
+		ResourceManagerHub& rm = renderer.getEngine().getResourceManager();
+		for (const Permutation& p : m_permutations) {
+			Shader* shader = rm.load<Shader>(p.shader);
+			if (m_precompile_shaders.indexOf(shader) < 0) m_precompile_shaders.push(shader);
+			else shader->decRefCount();
+		}
+	}
+
+	for (Shader* shader : m_precompile_shaders) {
+		if (shader->isEmpty()) return false;
+	}
+
+	PROFILE_FUNCTION();
+	u32 compiled = 0;
+	for (const Permutation& p : m_permutations) {
+		Shader* shader = nullptr;
+		for (Shader* s : m_precompile_shaders) {
+			if (s->getPath() == p.shader) shader = s;
+		}
+		if (!shader || !shader->isReady()) continue;
+
+		u32 defines = 0;
+		StringView names = p.defines;
+		while (names.begin != names.end) {
+			const StringView name = nextToken(names, ' ');
+			if (name.empty()) continue;
+			const StaticString<64> tmp(name);
+			defines |= 1 << renderer.getShaderDefineIdx(tmp);
+		}
+
+		// programs are never used, we just want the shader cache to contain the permutation
+		if (shader->m_type == gpu::ShaderType::COMPUTE) shader->getProgram(defines);
+		else shader->getProgram(p.state, p.decl, defines, p.semantic_defines.c_str());
+		++compiled;
+	}
+	logInfo(compiled, " of ", m_permutations.size(), " shader permutations precompiled");
+	m_precompiling = false;
+	return true;
+}
+
+} // namespace Lumix
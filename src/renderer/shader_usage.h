@@ -0,0 +1,56 @@
+#pragma once
+
+#include "core/array.h"
+#include "core/hash_map.h"
+#include "core/path.h"
+#include "core/string.h"
+#include "core/sync.h"
+#include "gpu/gpu.h"
+
+namespace Lumix {
+
+struct Renderer;
+struct Shader;
+struct ShaderKey;
+
+// shader permutations the game actually uses, recorded when they are compiled (see -shader_usage)
+// saved as text, one permutation per line, so files from several QA runs can be merged by concatenating them
+// editor precompiles only these permutations and exports only them, see gpu::saveShaderCache
+struct LUMIX_RENDERER_API ShaderUsage {
+	static constexpr const char* FILENAME = "shader_usage.txt";
+
+	struct Permutation {
+		Permutation(IAllocator& allocator) : defines(allocator), semantic_defines(allocator) {}
+
+		Path shader;
+		gpu::StateFlags state = gpu::StateFlags::NONE;
+		gpu::VertexDecl decl = gpu::VertexDecl(gpu::PrimitiveType::NONE);
+		// define names separated by spaces, define indices are not the same in different sessions
+		String defines;
+		// see Renderer::getSemanticDefines
+		String semantic_defines;
+	};
+
+	ShaderUsage(IAllocator& allocator);
+	~ShaderUsage();
+
+	// can be called from any thread
+	void record(const Shader& shader, const ShaderKey& key, const gpu::VertexDecl& decl);
+	// merges permutations from `path` with already known permutations
+	bool load(const char* path);
+	bool save(const char* path);
+	// logs how many permutations each shader and each define costs
+	void logReport();
+	// loads shaders and compiles all known permutations, call every frame until it returns true
+	bool precompile(Renderer& renderer);
+
+	IAllocator& m_allocator;
+	Mutex m_mutex;
+	Array<Permutation> m_permutations;
+	// hash of serialized permutation -> index in m_permutations
+	HashMap<RuntimeHash, u32> m_map;
+	Array<Shader*> m_precompile_shaders;
+	bool m_precompiling = false;
+};
+
+} // namespace Lumix
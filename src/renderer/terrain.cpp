@@ -2,9 +2,11 @@
 #include "core/crt.h"
 #include "engine/engine.h"
 #include "core/geometry.h"
+#include "core/job_system.h"
 #include "core/log.h"
 #include "core/math.h"
 #include "core/profiler.h"
+#include "core/sort.h"
 #include "engine/resource_manager.h"
 #include "core/stream.h"
 #include "renderer/draw_stream.h"
@@ -27,13 +29,41 @@ struct Sample
 	float u, v;
 };
 
+struct GrassInstance {
+	Vec3 position;
+	float scale;
+	Quat rotation;
+};
+static_assert(sizeof(GrassInstance) == Terrain::GRASS_INSTANCE_SIZE);
+
+u32 Terrain::allocGrassSlot() {
+	if (m_free_grass_slots.empty()) {
+		// grow the buffer, existing slots are copied, so quads keep their slots
+		const u32 new_slots = maximum(m_grass_buffer_slots * 2, 64u);
+		const Renderer::MemRef mem = { new_slots * GRASS_SLOT_SIZE, nullptr, false };
+		const gpu::BufferHandle buffer = m_renderer.createBuffer(mem, gpu::BufferFlags::NONE, "grass_instances");
+		if (m_grass_buffer) {
+			m_renderer.getDrawStream().copy(buffer, m_grass_buffer, 0, 0, m_grass_buffer_slots * GRASS_SLOT_SIZE);
+			m_renderer.getEndFrameDrawStream().destroy(m_grass_buffer);
+		}
+		for (u32 i = new_slots; i > m_grass_buffer_slots; --i) m_free_grass_slots.push(i - 1);
+		m_grass_buffer = buffer;
+		m_grass_buffer_slots = new_slots;
+	}
+	const u32 slot = m_free_grass_slots.last();
+	m_free_grass_slots.pop();
+	return slot;
+}
+
+void Terrain::freeGrassSlot(const GrassQuad& quad) {
+	if (quad.instances_count > 0) m_free_grass_slots.push(quad.slot);
+}
+
 void Terrain::createGrass(const Vec2& center, u32 frame) {
 	PROFILE_FUNCTION();
 	if (m_is_grass_dirty) {
 		for (GrassType& type : m_grass_types) {
-			for (const GrassQuad& quad : type.m_quads) {
-				m_renderer.getEndFrameDrawStream().destroy(quad.instances);
-			}
+			for (const GrassQuad& quad : type.m_quads) freeGrassSlot(quad);
 			type.m_quads.clear();
 		}
 		m_is_grass_dirty = false;
@@ -45,103 +75,165 @@ void Terrain::createGrass(const Vec2& center, u32 frame) {
 	if (!m_splatmap->isReady()) return;
 
 	for (GrassType& type : m_grass_types) {
-		HashMap<u64, GrassQuad>& quads = type.m_quads;
+		FlatHashMap<u64, GrassQuad>& quads = type.m_quads;
 		quads.eraseIf([&](const GrassQuad& q){
 			if (q.last_used_frame < frame - 3) {
-				m_renderer.getEndFrameDrawStream().destroy(q.instances);
+				freeGrassSlot(q);
 				return true;
 			}
 			return false;
 		});
 	}
 
+	// camera velocity, used to create quads ahead of the camera before they are needed
+	if (frame != m_grass_frame) {
+		const Vec2 delta = (center - m_grass_prev_center) / float(frame - m_grass_frame);
+		// teleport, e.g. a jump in the editor, do not predict from it
+		m_grass_velocity = squaredLength(delta) > GRASS_MAX_PREDICTED_SPEED * GRASS_MAX_PREDICTED_SPEED ? Vec2(0) : lerp(m_grass_velocity, delta, 0.5f);
+		m_grass_prev_center = center;
+		m_grass_frame = frame;
+		m_grass_quads_created = 0;
+	}
+	if (m_grass_quads_created >= MAX_NEW_GRASS_QUADS_PER_FRAME) return;
+
+	struct NewQuad {
+		u64 key;
+		u32 type_idx;
+		IVec2 ij;
+		bool predicted;
+		float distance_squared;
+		u32 instances_count;
+		AABB aabb;
+	};
+	Array<NewQuad> new_quads(m_allocator);
+
 	for (u32 type_idx = 0; type_idx < (u32)m_grass_types.size(); ++type_idx) {
 		Terrain::GrassType& type = m_grass_types[type_idx];
 		if (type.m_spacing <= 0) continue;
 
-		HashMap<u64, GrassQuad>& quads = type.m_quads;
+		FlatHashMap<u64, GrassQuad>& quads = type.m_quads;
 		const Vec2 half_extents(type.m_distance);
 		const Vec2 size(type.m_distance * 2);
 		const Vec2 quad_size(type.m_spacing * 32);
 		const IVec2 ij = maximum(IVec2((center - half_extents) / quad_size), IVec2(0));
 		
-		struct Instance {
-			Vec3 position;
-			float scale;
-			Quat rotation;
-		};
-
-		Array<Instance> instances(m_allocator);
-		
 		const u32 cols = 1 + u32(size.x / quad_size.x);
 		const u32 rows = 1 + u32(size.y / quad_size.y);
 
-		for (u32 j = ij.y; j < ij.y + rows; ++j) {
-			for (u32 i = ij.x; i < ij.x + cols; ++i) {
-				
-				const u64 key = (u64(i) << 32) | u32(j);
-				auto quad_iter = quads.find(key);
+		Vec2 prediction = m_grass_velocity * (float)GRASS_PREDICTED_FRAMES;
+		const float prediction_len = length(prediction);
+		if (prediction_len > type.m_distance) prediction *= type.m_distance / prediction_len;
+		const IVec2 predicted_ij = maximum(IVec2((center + prediction - half_extents) / quad_size), IVec2(0));
 
-				if (quad_iter.isValid()) {
-					quad_iter.value().last_used_frame = frame;
-					continue;
-				}
+		auto collect = [&](const IVec2& from, bool predicted){
+			for (u32 j = from.y; j < from.y + rows; ++j) {
+				for (u32 i = from.x; i < from.x + cols; ++i) {
+					// already collected as a required quad
+					if (predicted && (i32)i >= ij.x && (i32)i < ij.x + (i32)cols && (i32)j >= ij.y && (i32)j < ij.y + (i32)rows) continue;
 
-				PROFILE_BLOCK("create grass quad")
-				const Vec2 from = Vec2((float)i, (float)j) * quad_size;
-
-				instances.clear();
-				AABB aabb(Vec3(FLT_MAX), Vec3(-FLT_MAX));
-				RandomGenerator rg(i + 13, j + 57);
-
-				for (u32 k = 0; k < 1024; ++k) {
-					const Vec2 pn = Vec2(rg.randFloat(), rg.randFloat());
-					Vec4 p;
-					p.x = from.x + pn.x * quad_size.x;
-					p.z = from.y + pn.y * quad_size.y;
-					const u32 splat = m_splatmap->getPixelNearest(u32(p.x / m_scale.x), u32(p.z / m_scale.x));
-					if ((splat >> 16) & (1 << type_idx)) {
-						p.y = getHeight(p.x, p.z);
-						p.w = rg.randFloat(0.7f, 1.f);
-						Instance& inst = instances.emplace();
-						inst.position = p.xyz();
-						inst.scale = p.w;
-						switch (type.m_rotation_mode) {
-							case GrassRotationMode::Y_UP: {
-								const float angle = rg.randFloat();
-								inst.rotation = Quat(0, sinf(angle * PI), 0, cosf(angle * PI));
-								break;
-							}
-							case GrassRotationMode::ALL_RANDOM: {
-								const Vec3 axis = normalize(Vec3(rg.randFloat(), rg.randFloat(), rg.randFloat()) * 2.f - 1.f);
-								inst.rotation = Quat(axis, rg.randFloat() * 2 * PI);
-								break;
-							}
-							default: 
-								inst.rotation = Quat::IDENTITY;
-								ASSERT(false);
-								break;
-						}
-						instances.push(inst);
-						aabb.addPoint(p.xyz());
+					const u64 key = (u64(i) << 32) | u32(j);
+					auto quad_iter = quads.find(key);
+
+					if (quad_iter.isValid()) {
+						quad_iter.value().last_used_frame = frame;
+						continue;
 					}
+
+					NewQuad& nq = new_quads.emplace();
+					nq.key = key;
+					nq.type_idx = type_idx;
+					nq.ij = IVec2(i, j);
+					nq.predicted = predicted;
+					nq.distance_squared = squaredLength(Vec2(nq.ij) * quad_size + quad_size * 0.5f - center);
 				}
+			}
+		};
+		collect(ij, false);
+		if (predicted_ij != ij) collect(predicted_ij, true);
+	}
 
-				GrassQuad& quad = quads.insert(key);
-				quad.aabb = aabb;
-				quad.ij = IVec2(i, j);
-				quad.type = type_idx;
-				quad.last_used_frame = frame;
-				if (!instances.empty()) {
-					const Renderer::MemRef mem = m_renderer.copy(instances.begin(), instances.byte_size());
-					quad.instances = m_renderer.createBuffer(mem, gpu::BufferFlags::IMMUTABLE, "grass_instances");
-					quad.instances_count = instances.size();
+	if (new_quads.empty()) return;
+
+	// only a limited number of quads is created per frame, required quads closest to camera first, predicted quads last
+	const u32 budget = MAX_NEW_GRASS_QUADS_PER_FRAME - m_grass_quads_created;
+	if ((u32)new_quads.size() > budget) {
+		sort(new_quads.begin(), new_quads.end(), [](const NewQuad& a, const NewQuad& b){
+			if (a.predicted != b.predicted) return b.predicted;
+			return a.distance_squared < b.distance_squared;
+		});
+		new_quads.resize(budget);
+	}
+	m_grass_quads_created += new_quads.size();
+
+	// a whole row of quads appears at once when the camera moves, so they are generated in parallel
+	Array<GrassInstance> instances(m_allocator);
+	instances.resize(new_quads.size() * GRASS_QUAD_INSTANCES);
+	jobs::forEach(new_quads.size(), 1, [&](u32 quad_idx, u32){
+		PROFILE_BLOCK("create grass quad");
+		NewQuad& nq = new_quads[quad_idx];
+		const GrassType& type = m_grass_types[nq.type_idx];
+		const Vec2 quad_size(type.m_spacing * 32);
+		const Vec2 from = Vec2(nq.ij) * quad_size;
+		GrassInstance* out = &instances[quad_idx * GRASS_QUAD_INSTANCES];
+
+		nq.instances_count = 0;
+		nq.aabb = AABB(Vec3(FLT_MAX), Vec3(-FLT_MAX));
+		RandomGenerator rg(nq.ij.x + 13, nq.ij.y + 57);
+
+		for (u32 k = 0; k < GRASS_QUAD_INSTANCES; ++k) {
+			const Vec2 pn = Vec2(rg.randFloat(), rg.randFloat());
+			Vec4 p;
+			p.x = from.x + pn.x * quad_size.x;
+			p.z = from.y + pn.y * quad_size.y;
+			const u32 splat = m_splatmap->getPixelNearest(u32(p.x / m_scale.x), u32(p.z / m_scale.x));
+			if ((splat >> 16) & (1 << nq.type_idx)) {
+				p.y = getHeight(p.x, p.z);
+				p.w = rg.randFloat(0.7f, 1.f);
+				GrassInstance& inst = out[nq.instances_count];
+				++nq.instances_count;
+				inst.position = p.xyz();
+				inst.scale = p.w;
+				switch (type.m_rotation_mode) {
+					case GrassRotationMode::Y_UP: {
+						const float angle = rg.randFloat();
+						inst.rotation = Quat(0, sinf(angle * PI), 0, cosf(angle * PI));
+						break;
+					}
+					case GrassRotationMode::ALL_RANDOM: {
+						const Vec3 axis = normalize(Vec3(rg.randFloat(), rg.randFloat(), rg.randFloat()) * 2.f - 1.f);
+						inst.rotation = Quat(axis, rg.randFloat() * 2 * PI);
+						break;
+					}
+					default: 
+						inst.rotation = Quat::IDENTITY;
+						ASSERT(false);
+						break;
 				}
+				nq.aabb.addPoint(p.xyz());
 			}
 		}
+	});
+
+	DrawStream& stream = m_renderer.getDrawStream();
+	for (u32 quad_idx = 0; quad_idx < (u32)new_quads.size(); ++quad_idx) {
+		const NewQuad& nq = new_quads[quad_idx];
+		GrassQuad& quad = m_grass_types[nq.type_idx].m_quads.insert(nq.key);
+		quad.aabb = nq.aabb;
+		quad.ij = nq.ij;
+		quad.type = nq.type_idx;
+		quad.last_used_frame = frame;
+		quad.instances_count = nq.instances_count;
+		if (nq.instances_count > 0) {
+			quad.slot = allocGrassSlot();
+			const u32 size = nq.instances_count * sizeof(GrassInstance);
+			const Renderer::TransientSlice slice = m_renderer.allocTransient(size);
+			memcpy(slice.ptr, &instances[quad_idx * GRASS_QUAD_INSTANCES], size);
+			stream.copy(m_grass_buffer, slice.buffer, quad.slot * GRASS_SLOT_SIZE, slice.offset, size);
+		}
 	}
 }
 
+
 Terrain::Terrain(Renderer& renderer, EntityPtr entity, RenderModule& module, IAllocator& allocator)
 	: m_material(nullptr)
 	, m_albedomap(nullptr)
@@ -156,11 +248,249 @@ Terrain::Terrain(Renderer& renderer, EntityPtr entity, RenderModule& module, IAl
 	, m_allocator(allocator)
 	, m_grass_types(m_allocator)
 	, m_renderer(renderer)
+	, m_free_grass_slots(m_allocator)
+	, m_lod_minmax(m_allocator)
 	, m_tesselation(1)
 	, m_base_grid_res(64)
 {
 }
 
+void Terrain::destroyClipmap() {
+	DrawStream& stream = m_renderer.getEndFrameDrawStream();
+	if (m_clipmap.heightmap) stream.destroy(m_clipmap.heightmap);
+	if (m_clipmap.splatmap) stream.destroy(m_clipmap.splatmap);
+	m_clipmap = Clipmap();
+}
+
+void Terrain::uploadClipmapRect(const Texture& map, gpu::TextureHandle dst, u32 level, const IVec2& from, const IVec2& to) {
+	const u32 bpp = gpu::getBytesPerPixel(map.format);
+	const u8* src = map.getData();
+	DrawStream& stream = m_renderer.getDrawStream();
+	for (i32 y = from.y; y < to.y;) {
+		const i32 wrapped_y = y % (i32)CLIPMAP_SIZE;
+		const i32 h = minimum(to.y - y, (i32)CLIPMAP_SIZE - wrapped_y);
+		for (i32 x = from.x; x < to.x;) {
+			const i32 wrapped_x = x % (i32)CLIPMAP_SIZE;
+			const i32 w = minimum(to.x - x, (i32)CLIPMAP_SIZE - wrapped_x);
+			const Renderer::MemRef mem = m_renderer.allocate(w * h * bpp);
+			u8* dst_mem = (u8*)mem.data;
+			for (i32 j = 0; j < h; ++j) {
+				// point sampled, map can have different resolution than heightmap, texels outside of the map are clamped to its edge
+				const u32 src_y = minimum(u32((u64(y + j) << level) * map.height / m_height), map.height - 1);
+				for (i32 i = 0; i < w; ++i) {
+					const u32 src_x = minimum(u32((u64(x + i) << level) * map.width / m_width), map.width - 1);
+					memcpy(dst_mem + (i + j * w) * bpp, src + (src_x + src_y * map.width) * bpp, bpp);
+				}
+			}
+			stream.update(dst, 0, wrapped_x, wrapped_y, level, w, h, map.format, mem.data, mem.size);
+			stream.freeMemory(mem.data, m_renderer.getAllocator());
+			x += w;
+		}
+		y += h;
+	}
+}
+
+void Terrain::updateClipmap(const Vec3& camera_pos, u32 frame) {
+	if (!m_renderer.isTerrainClipmap()) return;
+	if (m_clipmap.levels > 0 && m_clipmap.frame == frame) return;
+	if (!m_heightmap || !m_heightmap->isReady() || !m_heightmap->getData()) return;
+	if (!m_splatmap || !m_splatmap->isReady() || !m_splatmap->getData()) return;
+	// texels are copied one by one, compressed formats are not supported
+	if (m_heightmap->format != gpu::TextureFormat::R16 || m_splatmap->format != gpu::TextureFormat::RGBA8) return;
+
+	PROFILE_FUNCTION();
+	const bool is_new = m_clipmap.levels == 0;
+	if (is_new) {
+		const u32 size = maximum(m_width, m_height);
+		u32 levels = 1;
+		while (levels < MAX_CLIPMAP_LEVELS && ((CLIPMAP_SIZE - 2 * CLIPMAP_MARGIN) << (levels - 1)) < size) ++levels;
+		const Renderer::MemRef no_data;
+		m_clipmap.heightmap = m_renderer.createTexture(CLIPMAP_SIZE, CLIPMAP_SIZE, levels, m_heightmap->format, gpu::TextureFlags::NO_MIPS, no_data, "terrain_height_clipmap");
+		m_clipmap.splatmap = m_renderer.createTexture(CLIPMAP_SIZE, CLIPMAP_SIZE, levels, m_splatmap->format, gpu::TextureFlags::NO_MIPS, no_data, "terrain_splat_clipmap");
+		m_clipmap.levels = levels;
+	}
+	m_clipmap.frame = frame;
+
+	const IVec2 camera_texel(camera_pos.xz() / m_scale.x);
+	for (u32 level = 0; level < m_clipmap.levels; ++level) {
+		const i32 level_w = (m_width + (1 << level) - 1) >> level;
+		const i32 level_h = (m_height + (1 << level) - 1) >> level;
+		// centered on camera, but kept inside the map as much as possible
+		IVec2 origin;
+		origin.x = ((camera_texel.x >> level) - (i32)CLIPMAP_SIZE / 2) & ~((i32)CLIPMAP_SNAP - 1);
+		origin.y = ((camera_texel.y >> level) - (i32)CLIPMAP_SIZE / 2) & ~((i32)CLIPMAP_SNAP - 1);
+		origin.x = clamp(origin.x, 0, maximum(0, level_w + (i32)CLIPMAP_MARGIN - (i32)CLIPMAP_SIZE));
+		origin.y = clamp(origin.y, 0, maximum(0, level_h + (i32)CLIPMAP_MARGIN - (i32)CLIPMAP_SIZE));
+
+		auto upload = [&](const IVec2& from, const IVec2& to){
+			if (from.x >= to.x || from.y >= to.y) return;
+			uploadClipmapRect(*m_heightmap, m_clipmap.heightmap, level, from, to);
+			uploadClipmapRect(*m_splatmap, m_clipmap.splatmap, level, from, to);
+		};
+
+		IVec2& prev = m_clipmap.origins[level];
+		const IVec2 end = origin + IVec2(CLIPMAP_SIZE);
+		const IVec2 delta = origin - prev;
+		if (is_new || delta.x >= (i32)CLIPMAP_SIZE || -delta.x >= (i32)CLIPMAP_SIZE || delta.y >= (i32)CLIPMAP_SIZE || -delta.y >= (i32)CLIPMAP_SIZE) {
+			upload(origin, end);
+		}
+		else {
+			// only newly exposed columns and rows, the rest is already in the layer
+			if (delta.x > 0) upload(IVec2(prev.x + CLIPMAP_SIZE, origin.y), end);
+			else if (delta.x < 0) upload(origin, IVec2(prev.x, end.y));
+			if (delta.y > 0) upload(IVec2(origin.x, prev.y + CLIPMAP_SIZE), end);
+			else if (delta.y < 0) upload(origin, IVec2(end.x, prev.y));
+		}
+		prev = origin;
+	}
+}
+
+void Terrain::onMapUpdated(const Texture& map, u32 x, u32 y, u32 w, u32 h) {
+	if (&map == m_heightmap && m_lod_tree.levels > 0) {
+		// leaves containing changed texels, including shared edges
+		const IVec2 from((i32(x) - 1) / (i32)LOD_PATCH_CELLS, (i32(y) - 1) / (i32)LOD_PATCH_CELLS);
+		const IVec2 to(i32(x + w) / LOD_PATCH_CELLS + 1, i32(y + h) / LOD_PATCH_CELLS + 1);
+		m_lod_tree.dirty_from = minimum(m_lod_tree.dirty_from, maximum(from, IVec2(0)));
+		m_lod_tree.dirty_to = maximum(m_lod_tree.dirty_to, minimum(to, m_lod_tree.sizes[0]));
+	}
+
+	if (m_clipmap.levels == 0) return;
+	gpu::TextureHandle dst;
+	if (&map == m_heightmap) dst = m_clipmap.heightmap;
+	else if (&map == m_splatmap) dst = m_clipmap.splatmap;
+	else return;
+
+	// map texels to heightmap texels
+	const i32 from_x = i32(u64(x) * m_width / map.width);
+	const i32 from_y = i32(u64(y) * m_height / map.height);
+	const i32 to_x = i32((u64(x + w) * m_width + map.width - 1) / map.width);
+	const i32 to_y = i32((u64(y + h) * m_height + map.height - 1) / map.height);
+
+	for (u32 level = 0; level < m_clipmap.levels; ++level) {
+		// level texel `k` is heightmap texel `k << level`
+		const i32 round = (1 << level) - 1;
+		const IVec2 origin = m_clipmap.origins[level];
+		const IVec2 from = maximum(IVec2((from_x + round) >> level, (from_y + round) >> level), origin);
+		const IVec2 to = minimum(IVec2((to_x + round) >> level, (to_y + round) >> level), origin + IVec2(CLIPMAP_SIZE));
+		if (from.x >= to.x || from.y >= to.y) continue;
+		uploadClipmapRect(map, dst, level, from, to);
+	}
+}
+
+void Terrain::destroyLODTree() {
+	DrawStream& stream = m_renderer.getEndFrameDrawStream();
+	if (m_lod_tree.minmax) stream.destroy(m_lod_tree.minmax);
+	if (m_lod_tree.patches) stream.destroy(m_lod_tree.patches);
+	m_lod_tree = LODTree();
+	m_lod_minmax.clear();
+}
+
+bool Terrain::updateLODTree() {
+	if (!m_heightmap || !m_heightmap->isReady() || !m_heightmap->getData()) return false;
+	// texels are read one by one, compressed formats are not supported
+	const bool is_r16 = m_heightmap->format == gpu::TextureFormat::R16;
+	if (!is_r16 && m_heightmap->format != gpu::TextureFormat::RGBA8) return false;
+	if (m_width < 2 || m_height < 2) return false;
+
+	LODTree& tree = m_lod_tree;
+	if (tree.levels == 0) {
+		IVec2 size((m_width - 2) / LOD_PATCH_CELLS + 1, (m_height - 2) / LOD_PATCH_CELLS + 1);
+		for (;;) {
+			tree.offsets[tree.levels] = tree.nodes_count;
+			tree.sizes[tree.levels] = size;
+			tree.nodes_count += size.x * size.y;
+			++tree.levels;
+			// if the map is too big, nodes of the last level are all roots
+			if ((size.x == 1 && size.y == 1) || tree.levels == MAX_LOD_LEVELS) break;
+			size = IVec2((size.x + 1) / 2, (size.y + 1) / 2);
+		}
+		m_lod_minmax.resize(tree.nodes_count);
+		tree.dirty_from = IVec2(0);
+		tree.dirty_to = tree.sizes[0];
+	}
+	if (tree.dirty_from.x >= tree.dirty_to.x || tree.dirty_from.y >= tree.dirty_to.y) return true;
+
+	PROFILE_FUNCTION();
+	const u8* data = m_heightmap->getData();
+	auto getTexel = [&](i32 x, i32 z) {
+		const i32 idx = x + z * m_width;
+		if (is_r16) return ((const u16*)data)[idx] * (1 / 65535.f);
+		return (((const u32*)data)[idx] & 0xff) * (1 / 255.f);
+	};
+
+	// leaves share edge texels with their neighbours
+	for (i32 j = tree.dirty_from.y; j < tree.dirty_to.y; ++j) {
+		for (i32 i = tree.dirty_from.x; i < tree.dirty_to.x; ++i) {
+			const i32 from_x = i * LOD_PATCH_CELLS;
+			const i32 from_z = j * LOD_PATCH_CELLS;
+			const i32 to_x = minimum(from_x + (i32)LOD_PATCH_CELLS, m_width - 1);
+			const i32 to_z = minimum(from_z + (i32)LOD_PATCH_CELLS, m_height - 1);
+			Vec2 minmax(FLT_MAX, -FLT_MAX);
+			for (i32 z = from_z; z <= to_z; ++z) {
+				for (i32 x = from_x; x <= to_x; ++x) {
+					const float h = getTexel(x, z);
+					minmax.x = minimum(minmax.x, h);
+					minmax.y = maximum(minmax.y, h);
+				}
+			}
+			m_lod_minmax[i + j * tree.sizes[0].x] = minmax;
+		}
+	}
+
+	auto parentRange = [](IVec2& from, IVec2& to) {
+		from = IVec2(from.x / 2, from.y / 2);
+		to = IVec2((to.x + 1) / 2, (to.y + 1) / 2);
+	};
+
+	IVec2 from = tree.dirty_from;
+	IVec2 to = tree.dirty_to;
+	for (u32 level = 1; level < tree.levels; ++level) {
+		parentRange(from, to);
+		const IVec2 child_size = tree.sizes[level - 1];
+		const Vec2* children = &m_lod_minmax[tree.offsets[level - 1]];
+		Vec2* nodes = &m_lod_minmax[tree.offsets[level]];
+		for (i32 j = from.y; j < to.y; ++j) {
+			for (i32 i = from.x; i < to.x; ++i) {
+				Vec2 minmax(FLT_MAX, -FLT_MAX);
+				for (i32 k = 0; k < 4; ++k) {
+					const i32 child_x = i * 2 + (k & 1);
+					const i32 child_z = j * 2 + (k >> 1);
+					if (child_x >= child_size.x || child_z >= child_size.y) continue;
+					const Vec2 child = children[child_x + child_z * child_size.x];
+					minmax.x = minimum(minmax.x, child.x);
+					minmax.y = maximum(minmax.y, child.y);
+				}
+				nodes[i + j * tree.sizes[level].x] = minmax;
+			}
+		}
+	}
+
+	if (!tree.minmax) {
+		const Renderer::MemRef mem = m_renderer.copy(m_lod_minmax.begin(), m_lod_minmax.byte_size());
+		tree.minmax = m_renderer.createBuffer(mem, gpu::BufferFlags::SHADER_BUFFER, "terrain_lod_minmax");
+		// indirect draw arguments and at most one patch per node
+		const Renderer::MemRef patches_mem = { (tree.nodes_count + 1) * 16, nullptr, false };
+		tree.patches = m_renderer.createBuffer(patches_mem, gpu::BufferFlags::SHADER_BUFFER, "terrain_lod_patches");
+	}
+	else {
+		// dirty rows of each level
+		DrawStream& stream = m_renderer.getDrawStream();
+		from = tree.dirty_from;
+		to = tree.dirty_to;
+		for (u32 level = 0; level < tree.levels; ++level) {
+			if (level > 0) parentRange(from, to);
+			const u32 first = tree.offsets[level] + from.y * tree.sizes[level].x;
+			const u32 size = (to.y - from.y) * tree.sizes[level].x * sizeof(Vec2);
+			const Renderer::TransientSlice slice = m_renderer.allocTransient(size);
+			memcpy(slice.ptr, &m_lod_minmax[first], size);
+			stream.copy(tree.minmax, slice.buffer, first * sizeof(Vec2), slice.offset, size);
+		}
+	}
+	tree.dirty_from = tree.sizes[0];
+	tree.dirty_to = IVec2(0);
+	return true;
+}
+
 Terrain::GrassType::~GrassType()
 {
 	if (m_grass_model)
@@ -171,11 +501,9 @@ Terrain::GrassType::~GrassType()
 
 Terrain::~Terrain()
 {
-	for (const GrassType& type : m_grass_types) {
-		for (const GrassQuad& quad : type.m_quads) {
-			m_renderer.getEndFrameDrawStream().destroy(quad.instances);
-		}
-	}
+	if (m_grass_buffer) m_renderer.getEndFrameDrawStream().destroy(m_grass_buffer);
+	destroyClipmap();
+	destroyLODTree();
 	setMaterial(nullptr);
 }
 
@@ -539,16 +867,29 @@ RayCastModelHit Terrain::castRay(const Ray& ray)
 }
 
 
+// with clipmap, raw maps are sampled on GPU only through the clipmap, so their full resolution GPU textures are not created
+static void requestCPUData(Texture* texture, bool cpu_only) {
+	if (!texture) return;
+	if (cpu_only && !texture->cpu_only && Path::hasExtension(texture->getPath(), "raw")) {
+		texture->cpu_only = true;
+		if (texture->getData()) {
+			texture->getResourceManager().reload(*texture);
+			return;
+		}
+	}
+	if (!texture->getData()) texture->addDataReference();
+}
+
 void Terrain::onMaterialLoaded(Resource::State, Resource::State new_state, Resource&)
 {
 	PROFILE_FUNCTION();
 	if (new_state == Resource::State::READY)
 	{
+		// maps could be changed or resized
+		destroyClipmap();
+		destroyLODTree();
 		m_heightmap = m_material->getTextureByName("Heightmap");
-		if (m_heightmap && m_heightmap->getData() == nullptr)
-		{
-			m_heightmap->addDataReference();
-		}
+		requestCPUData(m_heightmap, m_renderer.isTerrainClipmap());
 		if (m_heightmap)
 		{
 			m_width = m_heightmap->width;
@@ -558,9 +899,7 @@ void Terrain::onMaterialLoaded(Resource::State, Resource::State new_state, Resou
 		m_albedomap = m_material->getTextureByName("Detail albedo");
 		m_splatmap = m_material->getTextureByName("Splatmap");
 
-		if (m_splatmap && !m_splatmap->getData()) {
-			m_splatmap->addDataReference();
-		}
+		requestCPUData(m_splatmap, m_renderer.isTerrainClipmap());
 	}
 }
 
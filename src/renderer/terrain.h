@@ -2,7 +2,7 @@
 
 
 #include "core/array.h"
-#include "core/hash_map.h"
+#include "core/flat_hash_map.h"
 #include "core/math.h"
 #include "core/geometry.h"
 #include "engine/resource.h"
@@ -37,8 +37,19 @@ enum class GrassRotationMode : i32 {
 };
 
 struct LUMIX_RENDERER_API Terrain {
+	// grass instances of all quads live in a single buffer, each quad owns one fixed-size slot
+	static constexpr u32 GRASS_QUAD_INSTANCES = 1024;
+	static constexpr u32 GRASS_INSTANCE_SIZE = 32;
+	static constexpr u32 GRASS_SLOT_SIZE = GRASS_QUAD_INSTANCES * GRASS_INSTANCE_SIZE;
+	// the rest of missing quads is created in following frames, so moving the camera does not cause spikes
+	static constexpr u32 MAX_NEW_GRASS_QUADS_PER_FRAME = 16;
+	// quads are created where the camera will be in this number of frames
+	static constexpr u32 GRASS_PREDICTED_FRAMES = 30;
+	// faster movement is considered a teleport and it's not predicted, in units per frame
+	static constexpr float GRASS_MAX_PREDICTED_SPEED = 10.f;
+
 	struct GrassQuad {
-		gpu::BufferHandle instances = gpu::INVALID_BUFFER;
+		u32 slot = 0xffFFffFF;
 		u32 instances_count = 0;
 		IVec2 ij;
 		u32 type;
@@ -56,7 +67,7 @@ struct LUMIX_RENDERER_API Terrain {
 		GrassType(GrassType&& rhs);
 		~GrassType();
 
-		HashMap<u64, GrassQuad> m_quads;
+		FlatHashMap<u64, GrassQuad> m_quads;
 		Model* m_grass_model;
 		Terrain& m_terrain;
 		float m_spacing;
@@ -65,6 +76,48 @@ struct LUMIX_RENDERER_API Terrain {
 		GrassRotationMode m_rotation_mode = GrassRotationMode::Y_UP;
 	};
 
+	// with Renderer::isTerrainClipmap, GPU samples heightmap and splatmap only from clipmaps around the camera
+	// so GPU memory does not depend on terrain size, raw maps are kept only on CPU (for getHeight, grass, physics and editor)
+	// level `l` is a window of CLIPMAP_SIZE x CLIPMAP_SIZE texels, each (1 << l)-th texel of the map
+	// and it's stored toroidally in layer `l`, so only newly exposed strips are uploaded when the window moves
+	// the last level always covers the whole map
+	static constexpr u32 CLIPMAP_SIZE = 1024;
+	static constexpr u32 MAX_CLIPMAP_LEVELS = 8;
+	// windows move in steps of this many level texels
+	static constexpr u32 CLIPMAP_SNAP = 16;
+	// shader needs this many valid level texels around a sample for filtering and normals
+	static constexpr u32 CLIPMAP_MARGIN = 2;
+
+	struct Clipmap {
+		gpu::TextureHandle heightmap = gpu::INVALID_TEXTURE;
+		gpu::TextureHandle splatmap = gpu::INVALID_TEXTURE;
+		u32 levels = 0;
+		// first texel of each level's window, in level texels
+		IVec2 origins[MAX_CLIPMAP_LEVELS];
+		u32 frame = 0;
+	};
+
+	// with Renderer::isTerrainGPULOD, patches are selected from a CDLOD quadtree in a compute pass, see terrain_lod.hlsl
+	// node at level `l` covers (LOD_PATCH_CELLS << l) heightmap cells, leaves are level 0, the last level is a single root
+	static constexpr u32 LOD_PATCH_CELLS = 32;
+	static constexpr u32 MAX_LOD_LEVELS = 16;
+
+	struct LODTree {
+		// normalized min and max height of each node, as two floats, levels are stored one after another, row by row
+		gpu::BufferHandle minmax = gpu::INVALID_BUFFER;
+		// indirect draw arguments followed by selected patches, written by the compute pass
+		gpu::BufferHandle patches = gpu::INVALID_BUFFER;
+		u32 levels = 0;
+		u32 nodes_count = 0;
+		// first node of each level
+		u32 offsets[MAX_LOD_LEVELS];
+		// nodes per row and column of each level
+		IVec2 sizes[MAX_LOD_LEVELS];
+		// leaves, which need to be recomputed, [from, to)
+		IVec2 dirty_from;
+		IVec2 dirty_to;
+	};
+
 	Terrain(Renderer& renderer, EntityPtr entity, RenderModule& module, IAllocator& allocator);
 	~Terrain();
 
@@ -107,6 +160,12 @@ struct LUMIX_RENDERER_API Terrain {
 	void removeGrassType(int index);
 	void createGrass(const Vec2& center, u32 frame);
 	void setGrassDirty() { m_is_grass_dirty = true; }
+	// moves clipmap windows around `camera_pos`, which is in terrain's local space, once per frame
+	void updateClipmap(const Vec3& camera_pos, u32 frame);
+	// call after `map` data in the rectangle are changed, e.g. by editor, to update clipmap
+	void onMapUpdated(const Texture& map, u32 x, u32 y, u32 w, u32 h);
+	// creates the LOD tree or recomputes its dirty nodes, returns false if the tree can not be used
+	bool updateLODTree();
 
 	IAllocator& m_allocator;
 	i32 m_width;
@@ -124,8 +183,24 @@ struct LUMIX_RENDERER_API Terrain {
 	Array<GrassType> m_grass_types;
 	Renderer& m_renderer;
 	bool m_is_grass_dirty = false;
+	gpu::BufferHandle m_grass_buffer = gpu::INVALID_BUFFER;
+	u32 m_grass_buffer_slots = 0;
+	Array<u32> m_free_grass_slots;
+	Vec2 m_grass_prev_center = Vec2(0);
+	Vec2 m_grass_velocity = Vec2(0);
+	u32 m_grass_frame = 0;
+	u32 m_grass_quads_created = 0;
+	Clipmap m_clipmap;
+	LODTree m_lod_tree;
+	Array<Vec2> m_lod_minmax;
 
 private: 
+	u32 allocGrassSlot();
+	void freeGrassSlot(const GrassQuad& quad);
+	void destroyClipmap();
+	void destroyLODTree();
+	// uploads level texels [from, to) of `map`, splits the rectangle where it wraps around in the toroidal layer
+	void uploadClipmapRect(const Texture& map, gpu::TextureHandle dst, u32 level, const IVec2& from, const IVec2& to);
 	void onMaterialLoaded(Resource::State, Resource::State new_state, Resource&);
 };
 
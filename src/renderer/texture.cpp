@@ -243,6 +243,7 @@ void Texture::save() {
 void Texture::onDataUpdated(u32 x, u32 y, u32 w, u32 h)
 {
 	PROFILE_FUNCTION();
+	if (!handle) return;
 
 	u32 bytes_per_pixel = getBytesPerPixel(format);
 
@@ -306,10 +307,13 @@ static bool loadRaw(Texture& texture, InputMemoryStream& file, IAllocator& alloc
 	const u64 size = file.size() - file.getPosition();
 	const u8* data = (const u8*)file.getData() + file.getPosition();
 
-	if (texture.data_reference) {
+	if (texture.data_reference || texture.cpu_only) {
 		texture.data.resize((int)size);
 		file.read(texture.data.getMutableData(), size);
 	}
+	texture.mips = 1;
+	texture.is_cubemap = false;
+	if (texture.cpu_only) return true;
 
 	const Renderer::MemRef dst_mem = texture.renderer.copy(data, (u32)size);
 
@@ -322,8 +326,6 @@ static bool loadRaw(Texture& texture, InputMemoryStream& file, IAllocator& alloc
 		, (texture.getGPUFlags() & ~gpu::TextureFlags::SRGB) | flag_3d | gpu::TextureFlags::NO_MIPS 
 		, dst_mem
 		, texture.getPath().c_str());
-	texture.mips = 1;
-	texture.is_cubemap = false;
 	return texture.handle;
 }
 
@@ -360,17 +362,20 @@ u8* Texture::getLBCInfo(const void* data, gpu::TextureDesc& desc) {
 	return (u8*)data + sizeof(*hdr);
 }
 
-static gpu::TextureHandle loadTexture(Renderer& renderer, const gpu::TextureDesc& desc, const Renderer::MemRef& memory, gpu::TextureFlags flags, const char* debug_name)
+// `skip_mips` top mips are not uploaded to GPU, the texture is created smaller
+// `first_mip` mips of the created texture are allocated, but not uploaded and clamped by min lod, they are streamed later
+static gpu::TextureHandle loadTexture(Renderer& renderer, const gpu::TextureDesc& desc, const Renderer::MemRef& memory, gpu::TextureFlags flags, const char* debug_name, u32 skip_mips = 0, u32 first_mip = 0)
 {
 	ASSERT(memory.size > 0);
+	ASSERT(skip_mips < maximum(desc.mips, 1));
 
 	const gpu::TextureHandle handle = gpu::allocTextureHandle();
 	if (!handle) return handle;
 
 	DrawStream& stream = renderer.getDrawStream();
 	if (desc.is_cubemap) flags = flags | gpu::TextureFlags::IS_CUBE;
-	if (desc.mips < 2) flags = flags | gpu::TextureFlags::NO_MIPS;
-	stream.createTexture(handle, desc.width, desc.height, desc.depth, desc.format, flags, debug_name);
+	if (desc.mips - skip_mips < 2) flags = flags | gpu::TextureFlags::NO_MIPS;
+	stream.createTexture(handle, maximum(desc.width >> skip_mips, 1), maximum(desc.height >> skip_mips, 1), desc.depth, desc.format, flags, debug_name);
 				
 	const u8* ptr = (const u8*)memory.data;
 	for (u32 layer = 0; layer < desc.depth; ++layer) {
@@ -380,11 +385,14 @@ static gpu::TextureHandle loadTexture(Renderer& renderer, const gpu::TextureDesc
 				const u32 w = maximum(desc.width >> mip, 1);
 				const u32 h = maximum(desc.height >> mip, 1);
 				const u32 mip_size_bytes = gpu::getSize(desc.format, w, h);
-				stream.update(handle, mip, 0, 0, z, w, h, desc.format, ptr, mip_size_bytes);
+				if (mip >= skip_mips + first_mip) {
+					stream.update(handle, mip - skip_mips, 0, 0, z, w, h, desc.format, ptr, mip_size_bytes);
+				}
 				ptr += mip_size_bytes;
 			}
 		}
 	}
+	if (first_mip > 0) stream.setMinLOD(handle, first_mip);
 	ASSERT(memory.own);
 	stream.freeMemory(memory.data, renderer.getAllocator());
 	return handle;
@@ -469,7 +477,7 @@ static gpu::TextureHandle loadTexture(Renderer& renderer, const gpu::TextureDesc
 #endif
 
 
-static bool loadLBC(Texture& texture, const u8* data, u32 size)
+static bool loadLBC(Texture& texture, const u8* data, u32 size, u32 quality_bias, bool streaming)
 {
 	gpu::TextureDesc desc;
 	const u8* image_data = Texture::getLBCInfo(data, desc);
@@ -491,12 +499,28 @@ static bool loadLBC(Texture& texture, const u8* data, u32 size)
 		}
 	}
 
+	// drop top mips to lower memory usage, but keep small textures intact
+	u32 skip_mips = texture.data_reference > 0 ? 0 : minimum(quality_bias, maximum(desc.mips, 1) - 1);
+	while (skip_mips > 0 && ((desc.width >> skip_mips) < 64 || (desc.height >> skip_mips) < 64)) --skip_mips;
+
+	// only coarse mips are uploaded now, finer are streamed in when requested
+	u32 resident_mip = 0;
+	if (streaming && texture.data_reference == 0 && desc.depth == 1 && !desc.is_cubemap) {
+		const u32 w = desc.width >> skip_mips;
+		const u32 h = desc.height >> skip_mips;
+		while (resident_mip + skip_mips + 1 < desc.mips && maximum(w >> resident_mip, h >> resident_mip) > Texture::STREAMING_RESIDENT_SIZE) {
+			++resident_mip;
+		}
+	}
+
 	Renderer::MemRef mem = texture.renderer.copy(image_data, size - offset);
-	texture.handle = loadTexture(texture.renderer, desc, mem, texture.getGPUFlags(), texture.getPath().c_str());
+	texture.handle = loadTexture(texture.renderer, desc, mem, texture.getGPUFlags(), texture.getPath().c_str(), skip_mips, resident_mip);
+	texture.skipped_mips = skip_mips;
+	texture.resident_mip = resident_mip;
 	if (texture.handle) {
-		texture.width = desc.width;
-		texture.height = desc.height;
-		texture.mips = desc.mips;
+		texture.width = maximum(desc.width >> skip_mips, 1);
+		texture.height = maximum(desc.height >> skip_mips, 1);
+		texture.mips = maximum(desc.mips, 1) - skip_mips;
 		texture.depth = desc.depth;
 		texture.is_cubemap = desc.is_cubemap;
 		texture.format = desc.format;
@@ -539,7 +563,12 @@ bool Texture::load(Span<const u8> mem)
 	}
 	
 	if (equalIStrings(ext, "lbc")) {
-		loaded = loadLBC(*this, (const u8*)file.getData() + file.getPosition(), u32(file.remaining()));
+		m_quality_bias = getResourceManager().getQualityBias();
+		// textures from asset tiles are not compiled resources, so they can not be streamed
+		const bool streaming = renderer.isTextureStreaming() && !startsWith(getPath(), ".lumix/asset_tiles/");
+		loaded = loadLBC(*this, (const u8*)file.getData() + file.getPosition(), u32(file.remaining()), m_quality_bias, streaming);
+		m_requested_mip = resident_mip;
+		m_streamed_mip = resident_mip;
 	}
 	else if (equalIStrings(ext, "raw")) {
 		loaded = loadRaw(*this, file, allocator);
@@ -556,8 +585,92 @@ bool Texture::load(Span<const u8> mem)
 }
 
 
+void Texture::requestMip(u32 mip) {
+	if (!handle || resident_mip == 0) return;
+
+	if (m_streamed_mip < resident_mip && renderer.frameNumber() >= m_min_lod_frame) {
+		resident_mip = m_streamed_mip;
+		renderer.getDrawStream().setMinLOD(handle, resident_mip);
+	}
+
+	m_requested_mip = minimum(m_requested_mip, mip);
+	if (m_requested_mip >= m_streamed_mip || m_stream_op.isValid()) return;
+
+	// we need the whole file anyway, so only finer mips are loaded again
+	FileSystem& fs = getResourceManager().getOwner().getFileSystem();
+	const Path res_path(".lumix/resources/", getPath().getHash(), ".res");
+	m_stream_op = fs.getContent(res_path, makeDelegate<&Texture::streamedIn>(this), FileSystem::Priority::LOW);
+}
+
+
+void Texture::streamedIn(Span<const u8> blob, bool success) {
+	m_stream_op = FileSystem::AsyncHandle::invalid();
+	if (!success || !handle) return;
+	
+	OutputMemoryStream tmp(allocator);
+	Span<const u8> content;
+	if (!getCompiledContent(blob, tmp, content)) return;
+
+	InputMemoryStream file(content);
+	char ext[4] = {};
+	u32 file_flags;
+	if (!file.read(ext, 3) || !file.read(file_flags) || !equalIStrings(ext, "lbc")) return;
+
+	const u8* data = (const u8*)file.getData() + file.getPosition();
+	gpu::TextureDesc desc;
+	const u8* image_data = getLBCInfo(data, desc);
+	// file is changed, it will be reloaded
+	if (!image_data || desc.format != format || (desc.width >> skipped_mips) != width || (desc.height >> skipped_mips) != height) return;
+
+	// mips are stored from the biggest, each requested mip is uploaded from its own offset
+	const u32 to_mip = m_streamed_mip + skipped_mips;
+	const u32 from_mip = m_requested_mip + skipped_mips;
+	u64 offset = 0;
+	u64 streamed_size = 0;
+	for (u32 mip = 0; mip < to_mip; ++mip) {
+		const u32 size = gpu::getSize(format, maximum(desc.width >> mip, 1), maximum(desc.height >> mip, 1));
+		if (mip < from_mip) offset += size;
+		else streamed_size += size;
+	}
+	if (image_data + offset + streamed_size > content.end()) return;
+
+	Renderer::MemRef mem = renderer.copy(image_data + offset, u32(streamed_size));
+	DrawStream& stream = renderer.getDrawStream();
+	const u8* ptr = (const u8*)mem.data;
+	for (u32 mip = from_mip; mip < to_mip; ++mip) {
+		const u32 w = maximum(desc.width >> mip, 1);
+		const u32 h = maximum(desc.height >> mip, 1);
+		const u32 size = gpu::getSize(format, w, h);
+		stream.update(handle, mip - skipped_mips, 0, 0, 0, w, h, format, ptr, size);
+		ptr += size;
+	}
+	stream.freeMemory(mem.data, renderer.getAllocator());
+	
+	// frames already in flight must not sample mips which are not uploaded yet
+	m_streamed_mip = m_requested_mip;
+	m_min_lod_frame = renderer.frameNumber() + 4;
+}
+
+
+u64 Texture::getMemoryUsage() const {
+	u64 size = 0;
+	for (u32 mip = 0; mip < maximum(mips, 1); ++mip) {
+		size += gpu::getSize(format, maximum(width >> mip, 1), maximum(height >> mip, 1));
+	}
+	return size * maximum(depth, 1) * (is_cubemap ? 6 : 1) + data.size();
+}
+
+
 void Texture::unload()
 {
+	if (m_stream_op.isValid()) {
+		getResourceManager().getOwner().getFileSystem().cancel(m_stream_op);
+		m_stream_op = FileSystem::AsyncHandle::invalid();
+	}
+	skipped_mips = 0;
+	resident_mip = 0;
+	m_requested_mip = 0;
+	m_streamed_mip = 0;
 	if (handle) {
 		renderer.getEndFrameDrawStream().destroy(handle);
 		handle = gpu::INVALID_TEXTURE;
@@ -96,6 +96,8 @@ struct LUMIX_RENDERER_API Texture final : Resource {
 	u32 getPixelNearest(u32 x, u32 y) const;
 	u32 getPixel(float x, float y) const;
 	gpu::TextureFlags getGPUFlags() const;
+	u64 getMemoryUsage() const override;
+	bool supportsQualityBias() const override { return mips > 1 && data_reference == 0; }
 
 	static u8* getLBCInfo(const void* data, gpu::TextureDesc& desc);
 	static bool saveTGA(IOutputStream* file,
@@ -107,7 +109,13 @@ struct LUMIX_RENDERER_API Texture final : Resource {
 		const Path& path,
 		IAllocator& allocator);
 
+	// texture streaming, see Renderer::isTextureStreaming
+	// mips finer than resident_mip are loaded when requested, call from main thread
+	void requestMip(u32 mip);
+
 	static const ResourceType TYPE;
+	// with streaming, mips bigger than this are not loaded until requested
+	static constexpr u32 STREAMING_RESIDENT_SIZE = 256;
 
 	u32 width;
 	u32 height;
@@ -119,12 +127,22 @@ struct LUMIX_RENDERER_API Texture final : Resource {
 	gpu::TextureHandle handle;
 	TagAllocator allocator;
 	u32 data_reference;
+	// only CPU data of raw textures are loaded, no GPU texture is created, see Terrain::Clipmap
+	bool cpu_only = false;
 	OutputMemoryStream data;
 	Renderer& renderer;
+	u32 skipped_mips = 0; // top mips in file which are not in GPU texture, see ResourceManager::getQualityBias
+	u32 resident_mip = 0; // finest mip uploaded to GPU and not clamped
 
 private:
 	void unload() override;
 	bool load(Span<const u8> mem) override;
+	void streamedIn(Span<const u8> blob, bool success);
+
+	FileSystem::AsyncHandle m_stream_op = FileSystem::AsyncHandle::invalid();
+	u32 m_requested_mip = 0;
+	u32 m_streamed_mip = 0; // uploaded to GPU, but min lod is not set yet
+	u32 m_min_lod_frame = 0; // frame when it's safe to set min lod to m_streamed_mip
 };
 
 
@@ -0,0 +1,95 @@
+#include "core/geometry.h"
+#include "core/span.h"
+#include "renderer/triangle_bvh.h"
+
+namespace Lumix {
+
+TriangleBVH::TriangleBVH(IAllocator& allocator)
+	: nodes(allocator)
+	, triangles(allocator)
+{}
+
+void TriangleBVH::clear() {
+	nodes.clear();
+	triangles.clear();
+}
+
+namespace {
+
+struct Builder {
+	// top-down, split at the middle of centroids' bounds along their longest axis
+	void build(u32 node_idx, u32 from, u32 count, u32 depth) {
+		AABB bounds(Vec3(FLT_MAX), Vec3(-FLT_MAX));
+		AABB centroid_bounds(Vec3(FLT_MAX), Vec3(-FLT_MAX));
+		for (u32 i = from; i < from + count; ++i) {
+			const Vec3* tri = &corners[bvh.triangles[i] * 3];
+			bounds.addPoint(tri[0]);
+			bounds.addPoint(tri[1]);
+			bounds.addPoint(tri[2]);
+			centroid_bounds.addPoint(centroids[i]);
+		}
+
+		TriangleBVH::Node& node = bvh.nodes[node_idx];
+		node.min = bounds.min;
+		node.max = bounds.max;
+		if (count <= TriangleBVH::MAX_LEAF_SIZE || depth >= TriangleBVH::MAX_DEPTH) {
+			node.offset = from;
+			node.count = count;
+			return;
+		}
+
+		const Vec3 extent = centroid_bounds.max - centroid_bounds.min;
+		const u32 axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		const float mid = (centroid_bounds.min[axis] + centroid_bounds.max[axis]) * 0.5f;
+		u32 i = from;
+		u32 j = from + count;
+		while (i < j) {
+			if (centroids[i][axis] < mid) {
+				++i;
+			}
+			else {
+				--j;
+				swap(bvh.triangles[i], bvh.triangles[j]);
+				swap(centroids[i], centroids[j]);
+			}
+		}
+		u32 left_count = i - from;
+		// all centroids on one side, split in half
+		if (left_count == 0 || left_count == count) left_count = count / 2;
+
+		const u32 children = bvh.nodes.size();
+		node.offset = children;
+		node.count = 0;
+		bvh.nodes.emplace();
+		bvh.nodes.emplace();
+		build(children, from, left_count, depth + 1);
+		build(children + 1, from + left_count, count - left_count, depth + 1);
+	}
+
+	TriangleBVH& bvh;
+	Span<const Vec3> corners;
+	Array<Vec3>& centroids;
+};
+
+} // anonymous namespace
+
+void TriangleBVH::build(Span<const Vec3> corners) {
+	clear();
+	const u32 count = corners.length() / 3;
+	if (count == 0) return;
+
+	Array<Vec3> centroids(nodes.getAllocator());
+	centroids.resize(count);
+	triangles.resize(count);
+	for (u32 i = 0; i < count; ++i) {
+		triangles[i] = i;
+		centroids[i] = (corners[i * 3] + corners[i * 3 + 1] + corners[i * 3 + 2]) * (1 / 3.f);
+	}
+
+	nodes.reserve(count / MAX_LEAF_SIZE * 2 + 1);
+	nodes.emplace();
+	Builder builder = {*this, corners, centroids};
+	builder.build(0, 0, count, 0);
+}
+
+} // namespace Lumix
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "engine/lumix.h"
+#include "core/array.h"
+#include "core/math.h"
+
+namespace Lumix {
+
+template <typename T> struct Span;
+
+// bounding volume hierarchy of triangles, used to accelerate raycasts against meshes and procedural geometries
+struct LUMIX_RENDERER_API TriangleBVH {
+	struct Node {
+		Vec3 min;
+		// inner node: index of the first of two consecutive children; leaf: index of the first triangle in `triangles`
+		u32 offset;
+		Vec3 max;
+		// number of triangles in leaf, 0 for inner node
+		u32 count;
+	};
+
+	static constexpr u32 MAX_LEAF_SIZE = 4;
+	static constexpr u32 MAX_DEPTH = 48;
+
+	explicit TriangleBVH(IAllocator& allocator);
+
+	// `corners` contains 3 vertices per triangle, triangle index passed to castRay's callback is index of triangle in `corners`
+	void build(Span<const Vec3> corners);
+	void clear();
+	bool empty() const { return nodes.empty(); }
+
+	// calls `f(u32 triangle, float& max_t)` for triangles in leaves hit by the ray closer than `max_t`
+	// `f` decreases `max_t` when it finds a hit, so farther nodes are skipped, near child is visited first
+	template <typename F> void castRay(const Vec3& origin, const Vec3& dir, float max_t, F&& f) const;
+
+	Array<Node> nodes;
+	Array<u32> triangles;
+};
+
+template <typename F>
+void TriangleBVH::castRay(const Vec3& origin, const Vec3& dir, float max_t, F&& f) const {
+	if (nodes.empty()) return;
+
+	const Vec3 inv_dir(1 / (dir.x == 0 ? 1e-8f : dir.x), 1 / (dir.y == 0 ? 1e-8f : dir.y), 1 / (dir.z == 0 ? 1e-8f : dir.z));
+	auto intersect = [&](const Node& node, float& t) {
+		const Vec3 t0 = (node.min - origin) * inv_dir;
+		const Vec3 t1 = (node.max - origin) * inv_dir;
+		const float tmin = maximum(minimum(t0.x, t1.x), minimum(t0.y, t1.y), minimum(t0.z, t1.z));
+		const float tmax = minimum(maximum(t0.x, t1.x), maximum(t0.y, t1.y), maximum(t0.z, t1.z));
+		t = maximum(tmin, 0.f);
+		return tmax >= t;
+	};
+
+	struct StackEntry {
+		u32 node;
+		float t;
+	};
+	StackEntry stack[MAX_DEPTH + 2];
+	u32 stack_size = 0;
+	float t;
+	if (!intersect(nodes[0], t) || t > max_t) return;
+	stack[stack_size++] = {0, t};
+
+	while (stack_size > 0) {
+		const StackEntry entry = stack[--stack_size];
+		if (entry.t > max_t) continue;
+		
+		const Node& node = nodes[entry.node];
+		if (node.count > 0) {
+			for (u32 i = node.offset, end = node.offset + node.count; i < end; ++i) {
+				f(triangles[i], max_t);
+			}
+			continue;
+		}
+
+		StackEntry a = {node.offset, 0};
+		StackEntry b = {node.offset + 1, 0};
+		const bool hit_a = intersect(nodes[a.node], a.t) && a.t <= max_t;
+		const bool hit_b = intersect(nodes[b.node], b.t) && b.t <= max_t;
+		if (hit_a && hit_b) {
+			// far child is pushed first, so the near one is popped first
+			if (a.t < b.t) {
+				stack[stack_size++] = b;
+				stack[stack_size++] = a;
+			}
+			else {
+				stack[stack_size++] = a;
+				stack[stack_size++] = b;
+			}
+		}
+		else if (hit_a) stack[stack_size++] = a;
+		else if (hit_b) stack[stack_size++] = b;
+	}
+}
+
+} // namespace Lumix
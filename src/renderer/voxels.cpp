@@ -1,4 +1,6 @@
+#include "core/job_system.h"
 #include "core/profiler.h"
+#include "core/simd.h"
 #include "renderer/model.h"
 #include "voxels.h"
 
@@ -30,6 +32,88 @@ static void forEachTriangle(const Mesh& mesh, const F& f) {
 	}
 }
 
+// z slab processed by a single job in Voxels::raster
+static constexpr i32 RASTER_SLAB_SIZE = 4;
+
+// traces 4 rays at once, returns mask of rays which hit a voxel
+// positions are stepped in SIMD, voxel lookups are scalar
+static u32 castRays4(const Voxels& voxels, const Vec3 (&p)[4], const Vec3 (&d)[4]) {
+	alignas(16) float tmp[3][4];
+	auto load = [&](const Vec3 (&v)[4], u32 axis){
+		for (u32 i = 0; i < 4; ++i) tmp[axis][i] = (&v[i].x)[axis];
+		return f4Load(tmp[axis]);
+	};
+	float4 x = load(p, 0), y = load(p, 1), z = load(p, 2);
+	const float4 dx = load(d, 0), dy = load(d, 1), dz = load(d, 2);
+	const float4 zero = f4Splat(0);
+	const IVec3 res = voxels.m_grid_resolution;
+	const float4 sx = f4Splat((float)res.x), sy = f4Splat((float)res.y), sz = f4Splat((float)res.z);
+	const u8* data = voxels.m_voxels.data();
+
+	u32 hit = 0;
+	for (;;) {
+		x = f4Add(x, dx);
+		y = f4Add(y, dy);
+		z = f4Add(z, dz);
+		// once a ray leaves the grid, it can not get back
+		const float4 inside = f4And(
+			f4And(f4And(f4CmpGT(x, zero), f4CmpGT(y, zero)), f4And(f4CmpGT(z, zero), f4CmpLT(x, sx))),
+			f4And(f4CmpLT(y, sy), f4CmpLT(z, sz)));
+		const u32 active = f4MoveMask(inside) & ~hit;
+		if (!active) return hit;
+
+		f4Store(tmp[0], x);
+		f4Store(tmp[1], y);
+		f4Store(tmp[2], z);
+		for (u32 i = 0; i < 4; ++i) {
+			if ((active & (1 << i)) == 0) continue;
+			const u32 idx = i32(tmp[0][i]) + (i32(tmp[1][i]) + i32(tmp[2][i]) * res.y) * res.x;
+			if (data[idx]) hit |= 1 << i;
+		}
+	}
+}
+
+// rasterizes part of the triangle in [k_from, k_to) z range
+static void rasterSlab(Voxels& voxels, const Vec3& p0, const Vec3& p1, const Vec3& p2, i32 k_from, i32 k_to) {
+	const float voxel_size = voxels.m_voxel_size;
+	const Vec3 grid_min = voxels.m_aabb.min;
+	const IVec3 res = voxels.m_grid_resolution;
+	auto to_grid = [&](const Vec3& p){
+		return IVec3((p - grid_min) / voxel_size + Vec3(0.5f));
+	};
+
+	auto from_grid = [&](const IVec3& p){
+		return Vec3(p) * voxel_size + Vec3(0.5f * voxel_size) + grid_min;
+	};
+
+	auto intersect = [&](const Vec3& p0, const Vec3& p1, const Vec3& p2, IVec3 voxel){
+		Vec3 center = from_grid(voxel);
+		Vec3 half(0.5f * voxel_size);
+		return testAABBTriangleCollision(AABB(center - half, center + half), p0, p1, p2);
+	};
+
+	AABB aabb;
+	aabb.min = aabb.max = p0;
+	aabb.addPoint(p1);
+	aabb.addPoint(p2);
+
+	IVec3 ming = to_grid(aabb.min - Vec3(voxel_size));
+	IVec3 maxg = to_grid(aabb.max);
+	ming = IVec3(maximum(ming.x, 0), maximum(ming.y, 0), maximum(ming.z, k_from));
+	maxg = IVec3(minimum(maxg.x, res.x - 1), minimum(maxg.y, res.y - 1), minimum(maxg.z, k_to - 1));
+
+	u8* data = voxels.m_voxels.getMutableData();
+	for (i32 k = ming.z; k <= maxg.z; ++k) {
+		for (i32 j = ming.y; j <= maxg.y; ++j) {
+			for (i32 i = ming.x; i <= maxg.x; ++i) {
+				if (intersect(p0, p1, p2, IVec3(i, j, k))) {
+					data[i + j * res.x + k * (res.x * res.y)] = 1;
+				}
+			}
+		}
+	}
+}
+
 Voxels::Voxels(IAllocator& allocator)
 	: m_allocator(allocator)
 	, m_voxels(allocator)
@@ -120,27 +204,45 @@ float Voxels::computeAO(const Vec3& p, u32 ray_count) {
 }
 
 void Voxels::computeAO(u32 ray_count) {
+	PROFILE_FUNCTION();
 	m_ao.resize(m_grid_resolution.x * m_grid_resolution.y * m_grid_resolution.z);
-	for (i32 z = 0; z < m_grid_resolution.z; ++z) {
+	jobs::forEach(m_grid_resolution.z, 1, [&](i32 z, i32){
+		PROFILE_BLOCK("ao slice");
+		// seeded by slice, so results do not depend on scheduling
+		RandomGenerator rng(521288629 + z, 362436069);
+		auto randomDir = [&](){
+			Vec3 dir = Vec3(rng.randFloat(), rng.randFloat(), rng.randFloat()) * 2.f - 1.f;
+			return dir / maximum(fabsf(dir.x), fabsf(dir.y), fabsf(dir.z));
+		};
+
 		for (i32 y = 0; y < m_grid_resolution.y; ++y) {
 			for (i32 x = 0; x < m_grid_resolution.x; ++x) {
-				float ao = 1;
-				for (u32 d = 0; d < ray_count; ++d) {
-					Vec3 dir = Vec3(randFloat(), randFloat(), randFloat()) * 2.f - 1.f;
-					dir /= maximum(fabsf(dir.x), fabsf(dir.y), fabsf(dir.z));
-					Vec3 p((float)x + 0.5f, (float)y + 0.5f, (float)z + 0.5f);
-					p += dir;
-					if (castRay(p, dir)) {
-						ao -= 1.f / ray_count;
+				const Vec3 center((float)x + 0.5f, (float)y + 0.5f, (float)z + 0.5f);
+				u32 hits = 0;
+				u32 d = 0;
+				for (; d + 4 <= ray_count; d += 4) {
+					Vec3 dirs[4];
+					Vec3 origins[4];
+					for (u32 i = 0; i < 4; ++i) {
+						dirs[i] = randomDir();
+						// castRays4 steps before the first lookup, same as castRay
+						origins[i] = center + dirs[i];
 					}
+					const u32 mask = castRays4(*this, origins, dirs);
+					hits += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + (mask >> 3);
+				}
+				for (; d < ray_count; ++d) {
+					const Vec3 dir = randomDir();
+					if (castRay(center + dir, dir)) ++hits;
 				}
-				m_ao[x + (y + z * m_grid_resolution.y) * m_grid_resolution.x] = ao;
+				m_ao[x + (y + z * m_grid_resolution.y) * m_grid_resolution.x] = 1 - hits / (float)ray_count;
 			}
 		}
-	}
+	});
 }
 
 void Voxels::blurAO() {
+	PROFILE_FUNCTION();
 	Array<float> blurred(m_allocator);
 	blurred.resize(m_ao.size());
 	auto sampleAO = [&](i32 x, i32 y, i32 z){
@@ -150,7 +252,7 @@ void Voxels::blurAO() {
 		const u32 idx = x + (y + z * m_grid_resolution.y) * m_grid_resolution.x;
 		return m_ao[idx];
 	};
-	for (i32 z = 0; z < m_grid_resolution.z; ++z) {
+	jobs::forEach(m_grid_resolution.z, 1, [&](i32 z, i32){
 		for (i32 y = 0; y < m_grid_resolution.y; ++y) {
 			for (i32 x = 0; x < m_grid_resolution.x; ++x) {
 				float v = 0;
@@ -165,7 +267,7 @@ void Voxels::blurAO() {
 				blurred[idx] = v / 9.f;
 			}
 		}
-	}
+	});
 	m_ao = blurred.move();
 }
 
@@ -185,46 +287,57 @@ void Voxels::beginRaster(AABB aabb, u32 max_res) {
 }
 
 void Voxels::raster(const Vec3& p0, const Vec3& p1, const Vec3& p2) {
-	auto to_grid = [&](const Vec3& p){
-		return IVec3((p - m_aabb.min) / m_voxel_size + Vec3(0.5f));
-	};
-
-	auto from_grid = [&](const IVec3& p){
-		return Vec3(p) * m_voxel_size + Vec3(0.5f * m_voxel_size) + m_aabb.min;
-	};
-
-	auto intersect = [&](const Vec3& p0, const Vec3& p1, const Vec3& p2, IVec3 voxel){
-		Vec3 center = from_grid(voxel);
-		Vec3 half(0.5f * m_voxel_size);
-		return testAABBTriangleCollision(AABB(center - half, center + half), p0, p1, p2);
-	};
-
-	auto setVoxel = [&](i32 i, i32 j, i32 k, u8 value){
-		if (i < 0 || j < 0 || k < 0) return;
-		if (i >= m_grid_resolution.x) return;
-		if (j >= m_grid_resolution.y) return;
-		if (k >= m_grid_resolution.z) return;
+	rasterSlab(*this, p0, p1, p2, 0, m_grid_resolution.z);
+}
 
-		m_voxels[i + j * (m_grid_resolution.x) + k * (m_grid_resolution.x * m_grid_resolution.y)] = value;
+void Voxels::raster(Span<const Vec3> triangles) {
+	PROFILE_FUNCTION();
+	const u32 triangle_count = triangles.length() / 3;
+	const i32 slab_count = (m_grid_resolution.z + RASTER_SLAB_SIZE - 1) / RASTER_SLAB_SIZE;
+
+	// same range as in rasterSlab
+	auto getSlabs = [&](u32 tri_idx){
+		const Vec3* p = &triangles[tri_idx * 3];
+		const float min_z = minimum(p[0].z, p[1].z, p[2].z) - m_voxel_size;
+		const float max_z = maximum(p[0].z, p[1].z, p[2].z);
+		const i32 from = i32((min_z - m_aabb.min.z) / m_voxel_size + 0.5f);
+		const i32 to = i32((max_z - m_aabb.min.z) / m_voxel_size + 0.5f);
+		return IVec2(clamp(from / RASTER_SLAB_SIZE, 0, slab_count - 1), clamp(to / RASTER_SLAB_SIZE, 0, slab_count - 1));
 	};
 
-	AABB aabb;
-	aabb.min = aabb.max = p0;
-	aabb.addPoint(p1);
-	aabb.addPoint(p2);
-
-	const IVec3 ming = to_grid(aabb.min - Vec3(m_voxel_size));
-	const IVec3 maxg = to_grid(aabb.max);
-
-	for (i32 k = ming.z; k <= maxg.z; ++k) {
-		for (i32 j = ming.y; j <= maxg.y; ++j) {
-			for (i32 i = ming.x; i <= maxg.x; ++i) {
-				if (intersect(p0, p1, p2, IVec3(i, j, k))) {
-					setVoxel(i, j, k, 1);
-				}
-			}
+	// bin triangles, a triangle can be in multiple slabs
+	Array<u32> bin_offsets(m_allocator);
+	bin_offsets.resize(slab_count + 1);
+	memset(bin_offsets.begin(), 0, bin_offsets.byte_size());
+	for (u32 i = 0; i < triangle_count; ++i) {
+		const IVec2 slabs = getSlabs(i);
+		for (i32 s = slabs.x; s <= slabs.y; ++s) ++bin_offsets[s + 1];
+	}
+	for (i32 s = 0; s < slab_count; ++s) bin_offsets[s + 1] += bin_offsets[s];
+
+	Array<u32> bins(m_allocator);
+	bins.resize(bin_offsets[slab_count]);
+	Array<u32> bin_sizes(m_allocator);
+	bin_sizes.resize(slab_count);
+	memset(bin_sizes.begin(), 0, bin_sizes.byte_size());
+	for (u32 i = 0; i < triangle_count; ++i) {
+		const IVec2 slabs = getSlabs(i);
+		for (i32 s = slabs.x; s <= slabs.y; ++s) {
+			bins[bin_offsets[s] + bin_sizes[s]] = i;
+			++bin_sizes[s];
 		}
 	}
+
+	// slabs do not overlap, so jobs do not write to the same voxels
+	jobs::forEach(slab_count, 1, [&](i32 slab, i32){
+		PROFILE_BLOCK("raster slab");
+		const i32 k_from = slab * RASTER_SLAB_SIZE;
+		const i32 k_to = minimum(k_from + RASTER_SLAB_SIZE, m_grid_resolution.z);
+		for (u32 i = bin_offsets[slab]; i < bin_offsets[slab + 1]; ++i) {
+			const Vec3* p = &triangles[bins[i] * 3];
+			rasterSlab(*this, p[0], p[1], p[2], k_from, k_to);
+		}
+	});
 }
 
 void Voxels::voxelize(Model& model, u32 max_res) {
@@ -249,12 +362,16 @@ void Voxels::voxelize(Model& model, u32 max_res) {
 
 	beginRaster({min, max}, max_res);
 
+	Array<Vec3> triangles(m_allocator);
 	for (u32 mesh_idx = 0; mesh_idx < (u32)model.getMeshCount(); ++mesh_idx) {
 		const Mesh& mesh = model.getMesh(mesh_idx);
 		forEachTriangle(mesh, [&](const Vec3& p0, const Vec3& p1, const Vec3& p2){
-			raster(p0, p1, p2);
+			triangles.push(p0);
+			triangles.push(p1);
+			triangles.push(p2);
 		});
 	}
+	raster(triangles);
 }
 
 } // namespace Lumix
@@ -13,7 +13,10 @@ struct Voxels {
 	void set(const Voxels& rhs);
 	void beginRaster(struct AABB aabb, u32 max_res);
 	void raster(const Vec3& a, const Vec3& b, const Vec3& c);
+	// each 3 consecutive points form a triangle, triangles are binned to z slabs, which are rasterized in parallel
+	void raster(Span<const Vec3> triangles);
 	void voxelize(struct Model& model, u32 max_res);
+	// multithreaded, rays are traced in packets of 4
 	void computeAO(u32 ray_count);
 	float computeAO(const Vec3& p, u32 ray_count);
 	void blurAO();